@@ -51,7 +51,9 @@ public class ColumnSchema {
     GROUP_VARINT(EncodingType.GROUP_VARINT),
     RLE(EncodingType.RLE),
     DICT_ENCODING(EncodingType.DICT_ENCODING),
-    BIT_SHUFFLE(EncodingType.BIT_SHUFFLE);
+    BIT_SHUFFLE(EncodingType.BIT_SHUFFLE),
+    FRAME_OF_REFERENCE(EncodingType.FRAME_OF_REFERENCE),
+    ADAPTIVE_ENCODING(EncodingType.ADAPTIVE_ENCODING);
 
     final EncodingType internalPbType;
 
@@ -74,7 +76,8 @@ public class ColumnSchema {
     NO_COMPRESSION(CompressionType.NO_COMPRESSION),
     SNAPPY(CompressionType.SNAPPY),
     LZ4(CompressionType.LZ4),
-    ZLIB(CompressionType.ZLIB);
+    ZLIB(CompressionType.ZLIB),
+    ZSTD(CompressionType.ZSTD);
 
     final CompressionType internalPbType;
 
@@ -37,6 +37,7 @@ from kudu.schema import (int8, int16, int32, int64, string_ as string,  # noqa
                          COMPRESSION_SNAPPY,
                          COMPRESSION_LZ4,
                          COMPRESSION_ZLIB,
+                         COMPRESSION_ZSTD,
                          ENCODING_AUTO,
                          ENCODING_PLAIN,
                          ENCODING_PREFIX,
@@ -22,6 +22,7 @@ from libcpp.string cimport string
 from libcpp cimport bool as c_bool
 
 cimport cpython
+from cpython.buffer cimport PyBUF_WRITABLE
 from cython.operator cimport dereference as deref
 
 from libkudu_client cimport *
@@ -47,6 +48,31 @@ cdef dict _type_names = {
     KUDU_UNIXTIME_MICROS : "KUDU_UNIXTIME_MICROS"
 }
 
+# The buffer protocol format and the size of the cells of the fixed-length
+# types, as laid out by columnar scans.
+cdef dict _columnar_formats = {
+    KUDU_BOOL : (b'?', 1),
+    KUDU_INT8 : (b'b', 1),
+    KUDU_INT16 : (b'h', 2),
+    KUDU_INT32 : (b'i', 4),
+    KUDU_INT64 : (b'q', 8),
+    KUDU_FLOAT : (b'f', 4),
+    KUDU_DOUBLE : (b'd', 8),
+    KUDU_UNIXTIME_MICROS : (b'q', 8)
+}
+
+# The NumPy dtypes of the fixed-length types.
+cdef dict _numpy_dtypes = {
+    KUDU_BOOL : 'bool',
+    KUDU_INT8 : 'int8',
+    KUDU_INT16 : 'int16',
+    KUDU_INT32 : 'int32',
+    KUDU_INT64 : 'int64',
+    KUDU_FLOAT : 'float32',
+    KUDU_DOUBLE : 'float64',
+    KUDU_UNIXTIME_MICROS : 'datetime64[us]'
+}
+
 
 cdef class TimeDelta:
     """
@@ -1088,6 +1114,54 @@ cdef class Row:
         return self.row.IsNull(i)
 
 
+cdef class ColumnBuffer:
+    """
+    A read-only view of one of the buffers of a column of a RowBatch scanned
+    in the columnar layout. It supports the buffer protocol, so it may be
+    wrapped without copying, e.g. by memoryview, numpy.frombuffer() or
+    pyarrow.py_buffer(). It keeps the RowBatch it belongs to alive.
+    """
+
+    cdef:
+        RowBatch parent
+        const uint8_t* data
+        bytes fmt
+        Py_ssize_t shape[1]
+        Py_ssize_t strides[1]
+
+    def __len__(self):
+        return self.shape[0]
+
+    def __getbuffer__(self, Py_buffer* buffer, int flags):
+        if flags & PyBUF_WRITABLE:
+            raise BufferError("ColumnBuffer is read-only")
+        buffer.buf = <void*> self.data
+        buffer.obj = self
+        buffer.len = self.shape[0] * self.strides[0]
+        buffer.readonly = 1
+        buffer.itemsize = self.strides[0]
+        buffer.format = self.fmt
+        buffer.ndim = 1
+        buffer.shape = self.shape
+        buffer.strides = self.strides
+        buffer.suboffsets = NULL
+        buffer.internal = NULL
+
+    def __releasebuffer__(self, Py_buffer* buffer):
+        pass
+
+
+cdef ColumnBuffer _column_buffer(RowBatch parent, Slice slice, bytes fmt,
+                                 Py_ssize_t itemsize):
+    cdef ColumnBuffer result = ColumnBuffer()
+    result.parent = parent
+    result.data = slice.data()
+    result.fmt = fmt
+    result.shape[0] = slice.size() // itemsize
+    result.strides[0] = itemsize
+    return result
+
+
 cdef class RowBatch:
     """
     Class holding a batch of rows from a Scanner
@@ -1118,6 +1192,97 @@ cdef class RowBatch:
             tuples.append(self.get_row(i).as_tuple())
         return tuples
 
+    def column_buffers(self, int i):
+        """
+        Return the buffers of column i of a batch scanned in the columnar
+        layout (see Scanner.set_columnar_layout), without copying them.
+
+        The buffers are laid out like those of Arrow arrays. The data of a
+        fixed-length column holds one cell per row, whose contents are
+        undefined if the cell is NULL. For STRING and BINARY columns, the
+        data holds the concatenated values, and the value of row j spans
+        offsets[j] to offsets[j + 1]. The validity bitmap has one bit per
+        row, least significant bit first, set if the cell is not NULL.
+
+        Parameters
+        ----------
+        i : int
+            Index of the column in the projection
+
+        Returns
+        -------
+        buffers : tuple of ColumnBuffer (data, offsets, validity)
+            offsets is None for fixed-length columns, and validity is None
+            for columns which are not nullable.
+        """
+        cdef:
+            Slice data
+            Slice offsets
+            Slice bitmap
+            KuduColumnSchema col = self.batch.projection_schema().Column(i)
+            DataType t = col.type()
+            ColumnBuffer offsets_buf = None
+            ColumnBuffer validity_buf = None
+            ColumnBuffer data_buf
+
+        if t == KUDU_STRING or t == KUDU_BINARY:
+            check_status(self.batch.GetVariableLengthColumn(i, &offsets,
+                                                            &data))
+            offsets_buf = _column_buffer(self, offsets, b'I', 4)
+            data_buf = _column_buffer(self, data, b'B', 1)
+        elif t in _columnar_formats:
+            check_status(self.batch.GetFixedLengthColumn(i, &data))
+            fmt, itemsize = _columnar_formats[t]
+            data_buf = _column_buffer(self, data, fmt, itemsize)
+        else:
+            raise TypeError("Cannot get kudu type <{0}>"
+                                .format(_type_names[t]))
+        if col.is_nullable():
+            check_status(self.batch.GetNonNullBitmapForColumn(i, &bitmap))
+            validity_buf = _column_buffer(self, bitmap, b'B', 1)
+        return data_buf, offsets_buf, validity_buf
+
+    def to_numpy(self):
+        """
+        Return the columns of a batch scanned in the columnar layout as NumPy
+        arrays. The arrays of fixed-length columns share the memory of the
+        batch, while STRING and BINARY values are copied into object arrays.
+        Nullable columns are returned as masked arrays.
+
+        Returns
+        -------
+        columns : dict of column name to numpy.ndarray
+        """
+        import numpy as np
+
+        cdef:
+            const KuduSchema* schema = self.batch.projection_schema()
+            int nrows = self.batch.NumRows()
+            DataType t
+            uint32_t start, end
+
+        result = {}
+        for i in range(schema.num_columns()):
+            t = schema.Column(i).type()
+            data, offsets, validity = self.column_buffers(i)
+            if offsets is None:
+                arr = np.frombuffer(data, dtype=_numpy_dtypes[t])
+            else:
+                raw = memoryview(data)
+                offs = memoryview(offsets)
+                arr = np.empty(nrows, dtype=object)
+                for j in range(nrows):
+                    start = offs[j]
+                    end = offs[j + 1]
+                    value = raw[start:end].tobytes()
+                    arr[j] = frombytes(value) if t == KUDU_STRING else value
+            if validity is not None:
+                valid = np.unpackbits(np.frombuffer(validity, dtype=np.uint8),
+                                      bitorder='little')[:nrows]
+                arr = np.ma.masked_array(arr, mask=(valid == 0))
+            result[frombytes(schema.Column(i).name())] = arr
+        return result
+
     cdef Row get_row(self, i):
         # TODO: boundscheck
 
@@ -1240,6 +1405,21 @@ cdef class Scanner:
         check_status(self.scanner.SetFaultTolerant())
         return self
 
+    def set_columnar_layout(self):
+        """
+        Makes the scanner return the cells of each column contiguously, so
+        that batches may be converted in bulk with RowBatch.column_buffers()
+        or RowBatch.to_numpy(). The rows of such batches can't be read one at
+        a time. Requires tablet servers which support columnar scans.
+        Returns a reference to itself to facilitate chaining.
+
+        Returns
+        -------
+        self : Scanner
+        """
+        check_status(self.scanner.SetRowLayout(COLUMNAR))
+        return self
+
     def new_bound(self):
         """
         Returns a new instance of a ScanBound (subclass of PartialRow) to be
@@ -132,6 +132,7 @@ cdef extern from "kudu/client/schema.h" namespace "kudu::client" nogil:
         CompressionType_SNAPPY " kudu::client::KuduColumnStorageAttributes::SNAPPY"
         CompressionType_LZ4 " kudu::client::KuduColumnStorageAttributes::LZ4"
         CompressionType_ZLIB " kudu::client::KuduColumnStorageAttributes::ZLIB"
+        CompressionType_ZSTD " kudu::client::KuduColumnStorageAttributes::ZSTD"
 
     cdef struct KuduColumnStorageAttributes:
         KuduColumnStorageAttributes()
@@ -198,6 +199,12 @@ cdef extern from "kudu/client/scan_batch.h" namespace "kudu::client" nogil:
         KuduRowPtr Row(int idx) const;
         const KuduSchema* projection_schema() const;
 
+        # Accessors for batches in the columnar layout.
+        Status GetFixedLengthColumn(int idx, Slice* data) const
+        Status GetVariableLengthColumn(int idx, Slice* offsets,
+                                       Slice* data) const
+        Status GetNonNullBitmapForColumn(int idx, Slice* bitmap) const
+
     cdef cppclass KuduRowPtr " kudu::client::KuduScanBatch::RowPtr":
         c_bool IsNull(Slice& col_name)
         c_bool IsNull(int col_idx)
@@ -453,6 +460,8 @@ cdef extern from "kudu/client/client.h" namespace "kudu::client" nogil:
         LEADER_ONLY " kudu::client::KuduClient::LEADER_ONLY"
         CLOSEST_REPLICA " kudu::client::KuduClient::CLOSEST_REPLICA"
         FIRST_REPLICA " kudu::client::KuduClient::FIRST_REPLICA"
+        CLOSEST_NON_VOTER " kudu::client::KuduClient::CLOSEST_NON_VOTER"
+        LOWEST_LATENCY " kudu::client::KuduClient::LOWEST_LATENCY"
 
     cdef cppclass KuduClient:
 
@@ -601,6 +610,10 @@ cdef extern from "kudu/client/client.h" namespace "kudu::client" nogil:
         READ_LATEST " kudu::client::KuduScanner::READ_LATEST"
         READ_AT_SNAPSHOT " kudu::client::KuduScanner::READ_AT_SNAPSHOT"
 
+    enum RowLayout" kudu::client::KuduScanner::RowLayout":
+        ROWWISE " kudu::client::KuduScanner::ROWWISE"
+        COLUMNAR " kudu::client::KuduScanner::COLUMNAR"
+
     cdef cppclass KuduScanner:
         KuduScanner(KuduTable* table)
 
@@ -621,6 +634,7 @@ cdef extern from "kudu/client/client.h" namespace "kudu::client" nogil:
         Status SetProjectedColumnNames(const vector[string]& col_names)
         Status SetProjectedColumnIndexes(const vector[int]& col_indexes)
         Status SetFaultTolerant()
+        Status SetRowLayout(RowLayout layout)
         Status AddLowerBound(const KuduPartialRow& key)
         Status AddExclusiveUpperBound(const KuduPartialRow& key)
 
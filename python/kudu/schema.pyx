@@ -53,6 +53,7 @@ COMPRESSION_NONE = CompressionType_NONE
 COMPRESSION_SNAPPY = CompressionType_SNAPPY
 COMPRESSION_LZ4 = CompressionType_LZ4
 COMPRESSION_ZLIB = CompressionType_ZLIB
+COMPRESSION_ZSTD = CompressionType_ZSTD
 
 cdef dict _compression_types = {
     'default': COMPRESSION_DEFAULT,
@@ -60,6 +61,7 @@ cdef dict _compression_types = {
     'snappy': COMPRESSION_SNAPPY,
     'lz4': COMPRESSION_LZ4,
     'zlib': COMPRESSION_ZLIB,
+    'zstd': COMPRESSION_ZSTD,
 }
 
 cdef dict _compression_type_to_name = _reverse_dict(_compression_types)
@@ -225,7 +227,7 @@ cdef class ColumnSpec:
         Parameters
         ----------
         compression : string or int
-          One of {'default', 'none', 'snappy', 'lz4', 'zlib'}
+          One of {'default', 'none', 'snappy', 'lz4', 'zlib', 'zstd'}
           Or see kudu.COMPRESSION_* constants
 
         Returns
@@ -360,7 +362,7 @@ cdef class SchemaBuilder:
           New columns are nullable by default. Set boolean value for explicit
           nullable / not-nullable
         compression : string or int
-          One of {'default', 'none', 'snappy', 'lz4', 'zlib'}
+          One of {'default', 'none', 'snappy', 'lz4', 'zlib', 'zstd'}
           Or see kudu.COMPRESSION_* constants
         encoding : string or int
           One of {'auto', 'plain', 'prefix', 'group_varint', 'rle'}
@@ -143,6 +143,62 @@ class TestScanner(TestScanBase):
 
         self.assertEqual(sorted(tuples), self.tuples[10:90])
 
+    def _open_columnar_scanner(self):
+        scanner = self.table.scanner()
+        scanner.set_projected_column_names(['key', 'int_val', 'string_val'])
+        scanner.set_fault_tolerant().set_columnar_layout()
+        upper_bound = scanner.new_bound()
+        upper_bound['key'] = self.nrows
+        scanner.add_exclusive_upper_bound(upper_bound)
+        return scanner.open()
+
+    def test_scan_columnar_buffers(self):
+        scanner = self._open_columnar_scanner()
+
+        tuples = []
+        while scanner.has_more_rows():
+            batch = scanner.next_batch()
+            keys, offsets, validity = batch.column_buffers(0)
+            self.assertIsNone(offsets)
+            self.assertIsNone(validity)
+            keys = memoryview(keys)
+            int_vals = memoryview(batch.column_buffers(1)[0])
+
+            data, offsets, validity = batch.column_buffers(2)
+            data = memoryview(data)
+            offsets = memoryview(offsets)
+            validity = memoryview(validity)
+            for j in range(len(keys)):
+                if validity[j // 8] & (1 << (j % 8)):
+                    s = data[offsets[j]:offsets[j + 1]].tobytes()
+                    s = s.decode('utf8')
+                else:
+                    s = None
+                tuples.append((keys[j], int_vals[j], s))
+
+        self.assertEqual(sorted(tuples),
+                         [t[0:3] for t in self.tuples[:self.nrows]])
+
+    def test_scan_columnar_to_numpy(self):
+        try:
+            import numpy as np
+        except ImportError:
+            self.skipTest('numpy is not installed')
+        scanner = self._open_columnar_scanner()
+
+        tuples = []
+        while scanner.has_more_rows():
+            columns = scanner.next_batch().to_numpy()
+            self.assertEqual(columns['key'].dtype, np.int32)
+            self.assertTrue(np.ma.isMaskedArray(columns['string_val']))
+            strings = columns['string_val'].tolist()
+            tuples.extend(zip(columns['key'].tolist(),
+                              columns['int_val'].tolist(),
+                              strings))
+
+        self.assertEqual(sorted(tuples),
+                         [t[0:3] for t in self.tuples[:self.nrows]])
+
     def test_unixtime_micros(self):
         """
         Test setting and getting unixtime_micros fields
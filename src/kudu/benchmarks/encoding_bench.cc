@@ -0,0 +1,577 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+//
+// Micro benchmark for the cfile encodings and compression codecs.
+//
+// For every combination of data type, encoding, compression codec and data
+// distribution, writes a cfile of --encoding_bench_num_rows cells, then
+// measures the speed of encoding, decoding, random seeks and of evaluating
+// a range predicate. Combinations which the type doesn't support are
+// skipped. Each result is printed to stdout as a JSON object on its own
+// line, e.g.:
+//
+//   {"type":"INT32","encoding":"BIT_SHUFFLE","compression":"LZ4",
+//    "distribution":"sorted","rows":1000000,"raw_bytes":4000000,
+//    "encoded_bytes":1407023,"encode_mb_per_sec":311.2,
+//    "decode_mb_per_sec":1795.3,"seek_us":4.1,"predicate_selectivity":0.1,
+//    "predicate_mrows_per_sec":201.7}
+//
+// Usage:
+//   encoding_bench -encoding_bench_types=INT32,STRING
+//                  -encoding_bench_compressions=NO_COMPRESSION,LZ4
+
+#include <algorithm>
+#include <cinttypes>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include "kudu/cfile/cfile_reader.h"
+#include "kudu/cfile/cfile_writer.h"
+#include "kudu/cfile/type_encodings.h"
+#include "kudu/common/column_materialization_context.h"
+#include "kudu/common/column_predicate.h"
+#include "kudu/common/columnblock.h"
+#include "kudu/common/rowblock.h"
+#include "kudu/common/schema.h"
+#include "kudu/common/types.h"
+#include "kudu/fs/fs_manager.h"
+#include "kudu/gutil/stringprintf.h"
+#include "kudu/gutil/strings/split.h"
+#include "kudu/util/bitmap.h"
+#include "kudu/util/env.h"
+#include "kudu/util/flags.h"
+#include "kudu/util/jsonwriter.h"
+#include "kudu/util/logging.h"
+#include "kudu/util/random.h"
+#include "kudu/util/random_util.h"
+#include "kudu/util/stopwatch.h"
+
+DEFINE_string(encoding_bench_fs_root, "/tmp/encoding_bench",
+              "Directory in which the benchmarked cfiles are written. It is wiped "
+              "before running.");
+DEFINE_int32(encoding_bench_num_rows, 1000000, "Number of cells in each benchmarked cfile.");
+DEFINE_int32(encoding_bench_num_iterations, 3,
+             "Number of times each measurement is repeated. The best one is reported.");
+DEFINE_int32(encoding_bench_num_seeks, 1000, "Number of random seeks to time per cfile.");
+DEFINE_int32(encoding_bench_cardinality, 16,
+             "Number of distinct values of the low_cardinality distribution.");
+DEFINE_int32(encoding_bench_block_size, 0,
+             "Size of the cfile data blocks, in bytes. 0 uses the default size.");
+DEFINE_string(encoding_bench_types, "",
+              "Comma-separated list of the data types to benchmark, e.g. INT32,STRING. "
+              "Empty for all of them.");
+DEFINE_string(encoding_bench_encodings, "",
+              "Comma-separated list of the encodings to benchmark, e.g. PLAIN_ENCODING,RLE. "
+              "Empty for all of them.");
+DEFINE_string(encoding_bench_compressions, "",
+              "Comma-separated list of the compression codecs to benchmark, e.g. "
+              "NO_COMPRESSION,LZ4. Empty for all of them.");
+DEFINE_string(encoding_bench_distributions, "",
+              "Comma-separated list of the data distributions to benchmark, among "
+              "sorted, random, low_cardinality and nulls. Empty for all of them.");
+
+using std::string;
+using std::vector;
+
+namespace kudu {
+namespace cfile {
+
+using fs::ReadableBlock;
+using fs::WritableBlock;
+
+namespace {
+
+// The distributions of the benchmarked cells.
+enum Distribution {
+  // Uniformly random values, sorted.
+  kSorted,
+  // Uniformly random values.
+  kRandom,
+  // Random values among --encoding_bench_cardinality distinct ones.
+  kLowCardinality,
+  // Uniformly random values in a nullable column, a quarter of them null.
+  kNulls,
+};
+
+const Distribution kAllDistributions[] = { kSorted, kRandom, kLowCardinality, kNulls };
+
+const char* DistributionName(Distribution d) {
+  switch (d) {
+    case kSorted: return "sorted";
+    case kRandom: return "random";
+    case kLowCardinality: return "low_cardinality";
+    case kNulls: return "nulls";
+  }
+  LOG(FATAL) << "Unknown distribution: " << d;
+  return nullptr;
+}
+
+// The batch size of the reads, as used by tablet scans.
+const size_t kBatchSize = 1024;
+
+// The number of cells appended to the writer at once. A multiple of 8, so
+// that the batches start on a byte of the null bitmap.
+const size_t kAppendSize = 8192;
+
+// The number of cells sampled to pick the bounds of the predicate.
+const size_t kPredicateSampleSize = 10000;
+
+struct BenchResult {
+  int64_t raw_bytes = 0;
+  int64_t encoded_bytes = 0;
+  double encode_mb_per_sec = 0;
+  double decode_mb_per_sec = 0;
+  double seek_us = 0;
+  double predicate_selectivity = 0;
+  double predicate_mrows_per_sec = 0;
+};
+
+// Converts a random 64-bit number into a cell. Binary cells are formatted
+// into 'strings', which must not be resized while the cells are in use.
+template<class CppType>
+CppType MakeCell(uint64_t seed, std::string* /* str */) {
+  return static_cast<CppType>(seed);
+}
+
+template<>
+bool MakeCell<bool>(uint64_t seed, std::string* /* str */) {
+  return seed & 1;
+}
+
+template<>
+float MakeCell<float>(uint64_t seed, std::string* /* str */) {
+  return static_cast<float>(seed % 100000000) / 100;
+}
+
+template<>
+double MakeCell<double>(uint64_t seed, std::string* /* str */) {
+  return static_cast<double>(seed % 100000000) / 100;
+}
+
+template<>
+Slice MakeCell<Slice>(uint64_t seed, std::string* str) {
+  *str = StringPrintf("%016" PRIx64, seed);
+  return Slice(*str);
+}
+
+template<DataType Type>
+class EncodingBench {
+ public:
+  typedef typename DataTypeTraits<Type>::cpp_type cpp_type;
+
+  EncodingBench(FsManager* fs_manager, Distribution dist)
+      : fs_manager_(fs_manager),
+        dist_(dist),
+        type_info_(GetTypeInfo(Type)),
+        num_cells_(FLAGS_encoding_bench_num_rows) {
+    Generate();
+  }
+
+  Status Run(EncodingType encoding, CompressionType compression, BenchResult* result);
+
+ private:
+  void Generate();
+  Status Write(EncodingType encoding, CompressionType compression, BlockId* id);
+  Status TimeDecode(CFileReader* reader, double* secs);
+  Status TimeSeeks(CFileReader* reader, double* us);
+  Status TimePredicate(CFileReader* reader, double* secs, size_t* selected);
+  ColumnPredicate MakePredicate();
+
+  bool nullable() const { return dist_ == kNulls; }
+
+  FsManager* const fs_manager_;
+  const Distribution dist_;
+  const TypeInfo* const type_info_;
+
+  // The cells, in an array rather than a vector since they may be bools.
+  const size_t num_cells_;
+  vector<string> strings_;
+  std::unique_ptr<cpp_type[]> cells_;
+  vector<uint8_t> non_null_bitmap_;
+  int64_t raw_bytes_ = 0;
+
+  // The bounds of a predicate selecting about a tenth of the cells.
+  cpp_type lower_;
+  cpp_type upper_;
+};
+
+template<DataType Type>
+void EncodingBench<Type>::Generate() {
+  const size_t n = num_cells_;
+  Random r(GetRandomSeed32());
+  vector<uint64_t> dict;
+  for (int i = 0; i < FLAGS_encoding_bench_cardinality; i++) {
+    dict.push_back(r.Next64());
+  }
+  strings_.resize(n);
+  cells_.reset(new cpp_type[n]);
+  non_null_bitmap_.assign(BitmapSize(n), 0xff);
+  for (size_t i = 0; i < n; i++) {
+    uint64_t seed = dist_ == kLowCardinality ? dict[r.Uniform(dict.size())] : r.Next64();
+    cells_[i] = MakeCell<cpp_type>(seed, &strings_[i]);
+    if (dist_ == kNulls && r.Uniform(4) == 0) {
+      BitmapClear(non_null_bitmap_.data(), i);
+    }
+  }
+  auto less = [&](const cpp_type& a, const cpp_type& b) {
+    return type_info_->Compare(&a, &b) < 0;
+  };
+  if (dist_ == kSorted) {
+    std::sort(cells_.get(), cells_.get() + n, less);
+  }
+
+  vector<cpp_type> sample;
+  for (size_t i = 0; i < n; i += std::max<size_t>(n / kPredicateSampleSize, 1)) {
+    if (BitmapTest(non_null_bitmap_.data(), i)) {
+      sample.push_back(cells_[i]);
+    }
+  }
+  CHECK(!sample.empty());
+  std::sort(sample.begin(), sample.end(), less);
+  lower_ = sample[sample.size() * 45 / 100];
+  upper_ = sample[sample.size() * 55 / 100];
+
+  for (size_t i = 0; i < n; i++) {
+    raw_bytes_ += type_info_->physical_type() == BINARY ? strings_[i].size() : sizeof(cpp_type);
+  }
+}
+
+template<DataType Type>
+ColumnPredicate EncodingBench<Type>::MakePredicate() {
+  ColumnSchema col("c", Type, nullable());
+  if (type_info_->Compare(&lower_, &upper_) == 0) {
+    return ColumnPredicate::Equality(col, &lower_);
+  }
+  return ColumnPredicate::Range(col, &lower_, &upper_);
+}
+
+template<DataType Type>
+Status EncodingBench<Type>::Write(EncodingType encoding, CompressionType compression,
+                                  BlockId* id) {
+  gscoped_ptr<WritableBlock> sink;
+  RETURN_NOT_OK(fs_manager_->CreateNewBlock(&sink));
+  *id = sink->id();
+  WriterOptions opts;
+  opts.write_posidx = true;
+  opts.storage_attributes.encoding = encoding;
+  opts.storage_attributes.compression = compression;
+  if (FLAGS_encoding_bench_block_size > 0) {
+    opts.storage_attributes.cfile_block_size = FLAGS_encoding_bench_block_size;
+  }
+  CFileWriter w(opts, type_info_, nullable(), std::move(sink));
+  RETURN_NOT_OK(w.Start());
+  for (size_t i = 0; i < num_cells_; i += kAppendSize) {
+    size_t count = std::min(kAppendSize, num_cells_ - i);
+    if (nullable()) {
+      RETURN_NOT_OK(w.AppendNullableEntries(&non_null_bitmap_[i / 8], &cells_[i], count));
+    } else {
+      RETURN_NOT_OK(w.AppendEntries(&cells_[i], count));
+    }
+  }
+  return w.Finish();
+}
+
+template<DataType Type>
+Status EncodingBench<Type>::TimeDecode(CFileReader* reader, double* secs) {
+  gscoped_ptr<CFileIterator> iter;
+  RETURN_NOT_OK(reader->NewIterator(&iter, CFileReader::DONT_CACHE_BLOCK));
+  ScopedColumnBlock<Type> cb(kBatchSize);
+  SelectionVector sel(cb.nrows());
+  ColumnMaterializationContext ctx(0, nullptr, &cb, &sel);
+  ctx.SetDecoderEvalNotSupported();
+
+  Stopwatch sw;
+  sw.start();
+  RETURN_NOT_OK(iter->SeekToFirst());
+  while (iter->HasNext()) {
+    size_t n = cb.nrows();
+    RETURN_NOT_OK(iter->CopyNextValues(&n, &ctx));
+    cb.arena()->Reset();
+  }
+  sw.stop();
+  *secs = sw.elapsed().wall_seconds();
+  return Status::OK();
+}
+
+template<DataType Type>
+Status EncodingBench<Type>::TimeSeeks(CFileReader* reader, double* us) {
+  gscoped_ptr<CFileIterator> iter;
+  RETURN_NOT_OK(reader->NewIterator(&iter, CFileReader::CACHE_BLOCK));
+  ScopedColumnBlock<Type> cb(1);
+  SelectionVector sel(cb.nrows());
+  ColumnMaterializationContext ctx(0, nullptr, &cb, &sel);
+  ctx.SetDecoderEvalNotSupported();
+
+  Random r(GetRandomSeed32());
+  const int num_seeks = std::max(FLAGS_encoding_bench_num_seeks, 1);
+  Stopwatch sw;
+  sw.start();
+  for (int i = 0; i < num_seeks; i++) {
+    RETURN_NOT_OK(iter->SeekToOrdinal(r.Uniform(num_cells_)));
+    size_t n = 1;
+    RETURN_NOT_OK(iter->CopyNextValues(&n, &ctx));
+    cb.arena()->Reset();
+  }
+  sw.stop();
+  *us = sw.elapsed().wall_seconds() * 1e6 / num_seeks;
+  return Status::OK();
+}
+
+template<DataType Type>
+Status EncodingBench<Type>::TimePredicate(CFileReader* reader, double* secs, size_t* selected) {
+  ColumnPredicate pred = MakePredicate();
+  gscoped_ptr<CFileIterator> iter;
+  RETURN_NOT_OK(reader->NewIterator(&iter, CFileReader::DONT_CACHE_BLOCK));
+  ScopedColumnBlock<Type> cb(kBatchSize);
+  SelectionVector sel(cb.nrows());
+
+  *selected = 0;
+  Stopwatch sw;
+  sw.start();
+  RETURN_NOT_OK(iter->SeekToFirst());
+  while (iter->HasNext()) {
+    size_t n = cb.nrows();
+    sel.Resize(n);
+    sel.SetAllTrue();
+    ColumnMaterializationContext ctx(0, &pred, &cb, &sel);
+    RETURN_NOT_OK(iter->CopyNextValues(&n, &ctx));
+    sel.Resize(n);
+    if (ctx.DecoderEvalNotSupported()) {
+      ColumnBlock block(type_info_, cb.null_bitmap(), cb.data(), n, cb.arena());
+      pred.Evaluate(block, &sel);
+    }
+    *selected += sel.CountSelected();
+    cb.arena()->Reset();
+  }
+  sw.stop();
+  *secs = sw.elapsed().wall_seconds();
+  return Status::OK();
+}
+
+template<DataType Type>
+Status EncodingBench<Type>::Run(EncodingType encoding, CompressionType compression,
+                                BenchResult* result) {
+  const int iters = std::max(FLAGS_encoding_bench_num_iterations, 1);
+  const double mb = static_cast<double>(raw_bytes_) / (1024 * 1024);
+  result->raw_bytes = raw_bytes_;
+
+  BlockId id;
+  for (int i = 0; i < iters; i++) {
+    if (i > 0) {
+      RETURN_NOT_OK(fs_manager_->DeleteBlock(id));
+    }
+    Stopwatch sw;
+    sw.start();
+    RETURN_NOT_OK(Write(encoding, compression, &id));
+    sw.stop();
+    result->encode_mb_per_sec = std::max(result->encode_mb_per_sec,
+                                         mb / sw.elapsed().wall_seconds());
+  }
+
+  gscoped_ptr<ReadableBlock> block;
+  RETURN_NOT_OK(fs_manager_->OpenBlock(id, &block));
+  uint64_t size;
+  RETURN_NOT_OK(block->Size(&size));
+  result->encoded_bytes = size;
+  gscoped_ptr<CFileReader> reader;
+  RETURN_NOT_OK(CFileReader::Open(std::move(block), ReaderOptions(), &reader));
+
+  double decode_secs = 0;
+  double seek_us = 0;
+  double pred_secs = 0;
+  size_t selected = 0;
+  for (int i = 0; i < iters; i++) {
+    double secs;
+    RETURN_NOT_OK(TimeDecode(reader.get(), &secs));
+    decode_secs = i == 0 ? secs : std::min(decode_secs, secs);
+    double us;
+    RETURN_NOT_OK(TimeSeeks(reader.get(), &us));
+    seek_us = i == 0 ? us : std::min(seek_us, us);
+    RETURN_NOT_OK(TimePredicate(reader.get(), &secs, &selected));
+    pred_secs = i == 0 ? secs : std::min(pred_secs, secs);
+  }
+  result->decode_mb_per_sec = mb / decode_secs;
+  result->seek_us = seek_us;
+  result->predicate_selectivity = static_cast<double>(selected) / num_cells_;
+  result->predicate_mrows_per_sec = num_cells_ / pred_secs / 1e6;
+
+  reader.reset();
+  return fs_manager_->DeleteBlock(id);
+}
+
+void PrintResult(DataType type, EncodingType encoding, CompressionType compression,
+                 Distribution dist, const BenchResult& r) {
+  std::ostringstream out;
+  JsonWriter jw(&out, JsonWriter::COMPACT);
+  jw.StartObject();
+  jw.String("type");
+  jw.String(DataType_Name(type));
+  jw.String("encoding");
+  jw.String(EncodingType_Name(encoding));
+  jw.String("compression");
+  jw.String(CompressionType_Name(compression));
+  jw.String("distribution");
+  jw.String(DistributionName(dist));
+  jw.String("rows");
+  jw.Int64(FLAGS_encoding_bench_num_rows);
+  jw.String("raw_bytes");
+  jw.Int64(r.raw_bytes);
+  jw.String("encoded_bytes");
+  jw.Int64(r.encoded_bytes);
+  jw.String("encode_mb_per_sec");
+  jw.Double(r.encode_mb_per_sec);
+  jw.String("decode_mb_per_sec");
+  jw.Double(r.decode_mb_per_sec);
+  jw.String("seek_us");
+  jw.Double(r.seek_us);
+  jw.String("predicate_selectivity");
+  jw.Double(r.predicate_selectivity);
+  jw.String("predicate_mrows_per_sec");
+  jw.Double(r.predicate_mrows_per_sec);
+  jw.EndObject();
+  std::cout << out.str() << std::endl;
+}
+
+// Returns the elements of 'all' whose names, as given by 'name', are in the
+// comma-separated list 'filter', or all of them if 'filter' is empty.
+template<class T, class F>
+vector<T> Filter(const vector<T>& all, const string& filter, const F& name) {
+  if (filter.empty()) {
+    return all;
+  }
+  vector<string> names = strings::Split(filter, ",", strings::SkipEmpty());
+  vector<T> ret;
+  for (const string& n : names) {
+    auto it = std::find_if(all.begin(), all.end(), [&](const T& t) { return name(t) == n; });
+    if (it == all.end()) {
+      LOG(FATAL) << "Unknown value: " << n;
+    }
+    ret.push_back(*it);
+  }
+  return ret;
+}
+
+template<DataType Type>
+void RunForType(FsManager* fs_manager,
+                const vector<EncodingType>& encodings,
+                const vector<CompressionType>& compressions,
+                const vector<Distribution>& dists) {
+  const TypeInfo* type_info = GetTypeInfo(Type);
+  for (Distribution dist : dists) {
+    EncodingBench<Type> bench(fs_manager, dist);
+    for (EncodingType encoding : encodings) {
+      const TypeEncodingInfo* info;
+      if (!TypeEncodingInfo::Get(type_info, encoding, &info).ok()) {
+        continue;
+      }
+      for (CompressionType compression : compressions) {
+        BenchResult result;
+        Status s = bench.Run(encoding, compression, &result);
+        if (!s.ok()) {
+          LOG(WARNING) << DataType_Name(Type) << "/" << EncodingType_Name(encoding) << "/"
+                       << CompressionType_Name(compression) << "/" << DistributionName(dist)
+                       << " failed: " << s.ToString();
+          continue;
+        }
+        PrintResult(Type, encoding, compression, dist, result);
+      }
+    }
+  }
+}
+
+void RunAll(FsManager* fs_manager) {
+  // Decimals are left out, since they need type attributes.
+  const vector<DataType> kTypes = { BOOL, INT8, UINT8, INT16, UINT16, INT32, UINT32,
+                                    INT64, UINT64, UNIXTIME_MICROS, FLOAT, DOUBLE,
+                                    STRING, BINARY };
+  vector<EncodingType> all_encodings;
+  for (int i = EncodingType_MIN; i <= EncodingType_MAX; i++) {
+    // AUTO_ENCODING is the default encoding of the type, benchmarked as such.
+    if (EncodingType_IsValid(i) && i != AUTO_ENCODING && i != UNKNOWN_ENCODING) {
+      all_encodings.push_back(static_cast<EncodingType>(i));
+    }
+  }
+  vector<CompressionType> all_compressions;
+  for (int i = CompressionType_MIN; i <= CompressionType_MAX; i++) {
+    if (CompressionType_IsValid(i) && i != DEFAULT_COMPRESSION && i != UNKNOWN_COMPRESSION) {
+      all_compressions.push_back(static_cast<CompressionType>(i));
+    }
+  }
+  const vector<Distribution> all_dists(std::begin(kAllDistributions),
+                                       std::end(kAllDistributions));
+
+  vector<DataType> types = Filter(kTypes, FLAGS_encoding_bench_types,
+                                  [](DataType t) { return DataType_Name(t); });
+  vector<EncodingType> encodings = Filter(all_encodings, FLAGS_encoding_bench_encodings,
+                                          [](EncodingType e) { return EncodingType_Name(e); });
+  vector<CompressionType> compressions = Filter(
+      all_compressions, FLAGS_encoding_bench_compressions,
+      [](CompressionType c) { return CompressionType_Name(c); });
+  vector<Distribution> dists = Filter(all_dists, FLAGS_encoding_bench_distributions,
+                                      [](Distribution d) { return string(DistributionName(d)); });
+
+  for (DataType type : types) {
+    switch (type) {
+#define RUN_FOR_TYPE(t) \
+      case t: RunForType<t>(fs_manager, encodings, compressions, dists); break
+      RUN_FOR_TYPE(BOOL);
+      RUN_FOR_TYPE(INT8);
+      RUN_FOR_TYPE(UINT8);
+      RUN_FOR_TYPE(INT16);
+      RUN_FOR_TYPE(UINT16);
+      RUN_FOR_TYPE(INT32);
+      RUN_FOR_TYPE(UINT32);
+      RUN_FOR_TYPE(INT64);
+      RUN_FOR_TYPE(UINT64);
+      RUN_FOR_TYPE(UNIXTIME_MICROS);
+      RUN_FOR_TYPE(FLOAT);
+      RUN_FOR_TYPE(DOUBLE);
+      RUN_FOR_TYPE(STRING);
+      RUN_FOR_TYPE(BINARY);
+#undef RUN_FOR_TYPE
+      default:
+        LOG(FATAL) << "Unexpected type: " << DataType_Name(type);
+    }
+  }
+}
+
+} // anonymous namespace
+} // namespace cfile
+} // namespace kudu
+
+int main(int argc, char** argv) {
+  kudu::ParseCommandLineFlags(&argc, &argv, true);
+  kudu::InitGoogleLoggingSafe(argv[0]);
+
+  kudu::Env* env = kudu::Env::Default();
+  const string& root = FLAGS_encoding_bench_fs_root;
+  if (env->FileExists(root)) {
+    CHECK_OK(env->DeleteRecursively(root));
+  }
+  kudu::FsManager fs_manager(env, root);
+  CHECK_OK(fs_manager.CreateInitialFileSystemLayout());
+  CHECK_OK(fs_manager.Open());
+
+  kudu::cfile::RunAll(&fs_manager);
+  return 0;
+}
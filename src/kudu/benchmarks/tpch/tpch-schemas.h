@@ -19,6 +19,7 @@
 #ifndef KUDU_BENCHMARKS_TPCH_SCHEMAS_H
 #define KUDU_BENCHMARKS_TPCH_SCHEMAS_H
 
+#include <algorithm>
 #include <string>
 #include <vector>
 
@@ -103,6 +104,110 @@ inline client::KuduSchema CreateLineItemSchema() {
   return s;
 }
 
+// A column of a TPC-H table.
+struct TpchColumn {
+  const char* name;
+  client::KuduColumnSchema::DataType type;
+};
+
+// Describes a TPC-H table: its columns, in the order of the fields of the
+// '|'-separated files written by dbgen, and the names of its primary key
+// columns. dbgen writes each table sorted by its first key column.
+struct TpchTable {
+  const char* name;
+  std::vector<TpchColumn> columns;
+  std::vector<std::string> key_columns;
+};
+
+// Returns the descriptions of the eight TPC-H tables. Decimals are stored
+// as doubles and dates as strings, like in the lineitem schema above.
+inline const std::vector<TpchTable>& GetTpchTables() {
+  static const std::vector<TpchTable> kTables = {
+    { "part",
+      { { "p_partkey", kInt32 }, { "p_name", kString }, { "p_mfgr", kString },
+        { "p_brand", kString }, { "p_type", kString }, { "p_size", kInt32 },
+        { "p_container", kString }, { "p_retailprice", kDouble },
+        { "p_comment", kString } },
+      { "p_partkey" } },
+    { "supplier",
+      { { "s_suppkey", kInt32 }, { "s_name", kString }, { "s_address", kString },
+        { "s_nationkey", kInt32 }, { "s_phone", kString }, { "s_acctbal", kDouble },
+        { "s_comment", kString } },
+      { "s_suppkey" } },
+    { "partsupp",
+      { { "ps_partkey", kInt32 }, { "ps_suppkey", kInt32 }, { "ps_availqty", kInt32 },
+        { "ps_supplycost", kDouble }, { "ps_comment", kString } },
+      { "ps_partkey", "ps_suppkey" } },
+    { "customer",
+      { { "c_custkey", kInt32 }, { "c_name", kString }, { "c_address", kString },
+        { "c_nationkey", kInt32 }, { "c_phone", kString }, { "c_acctbal", kDouble },
+        { "c_mktsegment", kString }, { "c_comment", kString } },
+      { "c_custkey" } },
+    { "orders",
+      { { "o_orderkey", kInt64 }, { "o_custkey", kInt32 }, { "o_orderstatus", kString },
+        { "o_totalprice", kDouble }, { "o_orderdate", kString },
+        { "o_orderpriority", kString }, { "o_clerk", kString },
+        { "o_shippriority", kInt32 }, { "o_comment", kString } },
+      { "o_orderkey" } },
+    { "lineitem",
+      { { kOrderKeyColName, kInt64 }, { kPartKeyColName, kInt32 },
+        { kSuppKeyColName, kInt32 }, { kLineNumberColName, kInt32 },
+        { kQuantityColName, kInt32 }, { kExtendedPriceColName, kDouble },
+        { kDiscountColName, kDouble }, { kTaxColName, kDouble },
+        { kReturnFlagColName, kString }, { kLineStatusColName, kString },
+        { kShipDateColName, kString }, { kCommitDateColName, kString },
+        { kReceiptDateColName, kString }, { kShipInstructColName, kString },
+        { kShipModeColName, kString }, { kCommentColName, kString } },
+      { kOrderKeyColName, kLineNumberColName } },
+    { "nation",
+      { { "n_nationkey", kInt32 }, { "n_name", kString }, { "n_regionkey", kInt32 },
+        { "n_comment", kString } },
+      { "n_nationkey" } },
+    { "region",
+      { { "r_regionkey", kInt32 }, { "r_name", kString }, { "r_comment", kString } },
+      { "r_regionkey" } },
+  };
+  return kTables;
+}
+
+// Returns the description of the TPC-H table 'name', or NULL if there is
+// no such table.
+inline const TpchTable* FindTpchTable(const std::string& name) {
+  for (const auto& table : GetTpchTables()) {
+    if (name == table.name) {
+      return &table;
+    }
+  }
+  return nullptr;
+}
+
+// Creates the schema of 'table': its key columns first, then the others in
+// the order of the fields of its data file. For lineitem, this is the same
+// layout as CreateLineItemSchema().
+inline client::KuduSchema CreateTpchSchema(const TpchTable& table) {
+  client::KuduSchemaBuilder b;
+  client::KuduSchema s;
+  auto is_key = [&](const TpchColumn& col) {
+    return std::find(table.key_columns.begin(), table.key_columns.end(),
+                     col.name) != table.key_columns.end();
+  };
+  for (const auto& key : table.key_columns) {
+    for (const auto& col : table.columns) {
+      if (key == col.name) {
+        b.AddColumn(col.name)->Type(col.type)->NotNull();
+      }
+    }
+  }
+  for (const auto& col : table.columns) {
+    if (!is_key(col)) {
+      b.AddColumn(col.name)->Type(col.type)->NotNull();
+    }
+  }
+  b.SetPrimaryKey(table.key_columns);
+  CHECK_OK(b.Build(&s));
+  return s;
+}
+
 inline std::vector<std::string> GetTpchQ1QueryColumns() {
   return { kShipDateColName,
            kReturnFlagColName,
@@ -0,0 +1,203 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+//
+// Loads the TPC-H tables needed by a list of query kernels, using several
+// threads per table, and reports the time taken by each kernel.
+//
+// The data must be in the format written by dbgen, with one '|'-separated
+// file per table called <table>.tbl. Tables which already exist are not
+// reloaded.
+//
+// Usage:
+//   tpch_bench -tpch_data_dir=/data/tpch-sf10
+//              -tpch_queries=q1,q6,q6_agg
+//              -tpch_num_query_iterations=3
+#include <algorithm>
+#include <iostream>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include "kudu/benchmarks/tpch/tpch-schemas.h"
+#include "kudu/benchmarks/tpch/tpch_loader.h"
+#include "kudu/benchmarks/tpch/tpch_queries.h"
+#include "kudu/client/client.h"
+#include "kudu/gutil/stringprintf.h"
+#include "kudu/gutil/strings/split.h"
+#include "kudu/integration-tests/mini_cluster.h"
+#include "kudu/master/mini_master.h"
+#include "kudu/util/env.h"
+#include "kudu/util/flags.h"
+#include "kudu/util/logging.h"
+#include "kudu/util/path_util.h"
+#include "kudu/util/stopwatch.h"
+
+DEFINE_string(tpch_data_dir, "/tmp/tpch-data",
+              "Directory containing the '|' separated <table>.tbl files written by dbgen.");
+DEFINE_string(tpch_queries, "q1,q6,q6_agg,count,count_agg,q4_orders",
+              "Comma-separated list of the query kernels to run.");
+DEFINE_int32(tpch_num_query_iterations, 3, "Number of times each query is run.");
+DEFINE_int32(tpch_num_load_threads, 8,
+             "Number of threads loading each table. Each thread writes its chunk of "
+             "the table's file to its own tablet.");
+DEFINE_int32(tpch_load_batch_size, 1000,
+             "Number of rows written by each loading thread between flushes.");
+DEFINE_int32(tpch_num_replicas, 1, "Replication factor of the loaded tables.");
+DEFINE_bool(use_mini_cluster, true,
+            "Create a mini cluster for the work to be performed against.");
+DEFINE_string(mini_cluster_base_dir, "/tmp/tpch",
+              "If using a mini cluster, directory for master/ts data.");
+DEFINE_int32(mini_cluster_num_tablet_servers, 1,
+             "If using a mini cluster, the number of tablet servers to start.");
+DEFINE_string(master_address, "localhost",
+              "Address of master for the cluster to operate on");
+
+using std::set;
+using std::string;
+using std::vector;
+
+namespace kudu {
+
+using client::KuduClient;
+using client::KuduClientBuilder;
+using tpch::TpchQuery;
+using tpch::TpchQueryResult;
+
+namespace {
+
+void LoadTable(const client::sp::shared_ptr<KuduClient>& client, const string& name) {
+  const tpch::TpchTable* table = tpch::FindTpchTable(name);
+  CHECK(table) << "unknown table " << name;
+  TpchTableLoader::Options opts;
+  opts.num_threads = FLAGS_tpch_num_load_threads;
+  opts.batch_size = FLAGS_tpch_load_batch_size;
+  opts.num_replicas = FLAGS_tpch_num_replicas;
+  TpchTableLoader loader(client, table, JoinPathSegments(FLAGS_tpch_data_dir, name + ".tbl"),
+                         opts);
+  int64_t rows = 0;
+  Stopwatch sw;
+  sw.start();
+  Status s = loader.Run(&rows);
+  sw.stop();
+  if (s.IsAlreadyPresent()) {
+    LOG(INFO) << "Table " << name << " already loaded";
+    return;
+  }
+  CHECK_OK(s);
+  LOG(INFO) << StringPrintf("Loaded %lld rows into %s in %.3fs (%.0f rows/s)",
+                            static_cast<long long>(rows), name.c_str(),
+                            sw.elapsed().wall_seconds(),
+                            rows / std::max(sw.elapsed().wall_seconds(), 1e-9));
+}
+
+void RunQueries(const client::sp::shared_ptr<KuduClient>& client,
+                const vector<const TpchQuery*>& queries) {
+  struct Timing {
+    double min_s;
+    double max_s;
+    double total_s;
+    int64_t rows;
+  };
+  vector<Timing> timings;
+  for (const TpchQuery* query : queries) {
+    Timing t = { 0, 0, 0, 0 };
+    for (int i = 0; i < FLAGS_tpch_num_query_iterations; i++) {
+      TpchQueryResult result;
+      Stopwatch sw;
+      sw.start();
+      CHECK_OK(query->run(client.get(), &result));
+      sw.stop();
+      double s = sw.elapsed().wall_seconds();
+      LOG(INFO) << StringPrintf("%s iteration %d: %lld rows in %.3fs",
+                                query->name, i, static_cast<long long>(result.rows), s);
+      if (i == 0) {
+        LOG(INFO) << query->name << " result:\n" << result.summary;
+        t.min_s = s;
+      }
+      t.min_s = std::min(t.min_s, s);
+      t.max_s = std::max(t.max_s, s);
+      t.total_s += s;
+      t.rows = result.rows;
+    }
+    timings.push_back(t);
+  }
+
+  std::cout << StringPrintf("%-12s %14s %10s %10s %10s", "query", "rows", "min_s", "avg_s",
+                            "max_s") << std::endl;
+  for (int i = 0; i < queries.size(); i++) {
+    const Timing& t = timings[i];
+    std::cout << StringPrintf("%-12s %14lld %10.3f %10.3f %10.3f", queries[i]->name,
+                              static_cast<long long>(t.rows), t.min_s,
+                              t.total_s / std::max(FLAGS_tpch_num_query_iterations, 1),
+                              t.max_s)
+              << "  # " << queries[i]->description << std::endl;
+  }
+}
+
+} // anonymous namespace
+} // namespace kudu
+
+int main(int argc, char** argv) {
+  kudu::ParseCommandLineFlags(&argc, &argv, true);
+  kudu::InitGoogleLoggingSafe(argv[0]);
+
+  vector<const kudu::tpch::TpchQuery*> queries;
+  set<string> tables;
+  vector<string> names = strings::Split(FLAGS_tpch_queries, ",", strings::SkipEmpty());
+  for (const string& name : names) {
+    const kudu::tpch::TpchQuery* query = kudu::tpch::FindTpchQuery(name);
+    if (!query) {
+      std::cerr << "Unknown query: " << name << std::endl;
+      return 1;
+    }
+    queries.push_back(query);
+    tables.insert(query->table);
+  }
+
+  gscoped_ptr<kudu::MiniCluster> cluster;
+  string master_address;
+  if (FLAGS_use_mini_cluster) {
+    kudu::Status s = kudu::Env::Default()->CreateDir(FLAGS_mini_cluster_base_dir);
+    CHECK(s.IsAlreadyPresent() || s.ok()) << s.ToString();
+    kudu::MiniClusterOptions options;
+    options.data_root = FLAGS_mini_cluster_base_dir;
+    options.num_tablet_servers = FLAGS_mini_cluster_num_tablet_servers;
+    cluster.reset(new kudu::MiniCluster(kudu::Env::Default(), options));
+    CHECK_OK(cluster->StartSync());
+    master_address = cluster->mini_master()->bound_rpc_addr_str();
+  } else {
+    master_address = FLAGS_master_address;
+  }
+
+  kudu::client::sp::shared_ptr<kudu::client::KuduClient> client;
+  CHECK_OK(kudu::client::KuduClientBuilder()
+           .add_master_server_addr(master_address)
+           .Build(&client));
+
+  for (const string& table : tables) {
+    kudu::LoadTable(client, table);
+  }
+  kudu::RunQueries(client, queries);
+
+  if (cluster) {
+    cluster->Shutdown();
+  }
+  return 0;
+}
@@ -0,0 +1,199 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "kudu/benchmarks/tpch/tpch-schemas.h"
+#include "kudu/benchmarks/tpch/tpch_loader.h"
+#include "kudu/benchmarks/tpch/tpch_queries.h"
+#include "kudu/client/client.h"
+#include "kudu/common/partial_row.h"
+#include "kudu/gutil/stl_util.h"
+#include "kudu/gutil/stringprintf.h"
+#include "kudu/integration-tests/mini_cluster.h"
+#include "kudu/master/mini_master.h"
+#include "kudu/util/env.h"
+#include "kudu/util/test_util.h"
+
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+namespace kudu {
+
+using client::KuduClientBuilder;
+using client::KuduScanToken;
+using client::KuduScanTokenBuilder;
+using client::KuduSchema;
+using client::KuduTable;
+using tpch::TpchQueryResult;
+
+class TpchLoaderTest : public KuduTest {
+ public:
+  virtual void SetUp() OVERRIDE {
+    KuduTest::SetUp();
+    cluster_.reset(new MiniCluster(env_.get(), MiniClusterOptions()));
+    ASSERT_OK(cluster_->Start());
+    ASSERT_OK(KuduClientBuilder()
+              .add_master_server_addr(cluster_->mini_master()->bound_rpc_addr_str())
+              .Build(&client_));
+  }
+
+  virtual void TearDown() OVERRIDE {
+    cluster_->Shutdown();
+    KuduTest::TearDown();
+  }
+
+ protected:
+  // Writes a lineitem file of 'num_orders' orders with four lines each,
+  // returning the number of rows which match the predicates of Q6. The last
+  // line doesn't end with a newline.
+  int WriteLineItemFile(const string& path, int num_orders) {
+    string data;
+    int q6_rows = 0;
+    for (int o = 1; o <= num_orders; o++) {
+      for (int l = 1; l <= 4; l++) {
+        int quantity = (o * 4 + l) % 50 + 1;
+        double discount = ((o + l) % 11) / 100.0;
+        int year = 1992 + o % 7;
+        string shipdate = StringPrintf("%d-06-15", year);
+        if (year == 1994 && discount >= 0.05 && discount <= 0.07 && quantity < 24) {
+          q6_rows++;
+        }
+        if (!data.empty()) {
+          data.push_back('\n');
+        }
+        StringAppendF(&data, "%d|%d|%d|%d|%d|%.2f|%.2f|0.02|%c|%c|%s|%s|%s|NONE|MAIL|line %d|",
+                      o, o % 100, o % 10, l, quantity, quantity * 100.5, discount,
+                      "ANR"[l % 3], "OF"[o % 2], shipdate.c_str(), shipdate.c_str(),
+                      shipdate.c_str(), l);
+      }
+    }
+    CHECK_OK(WriteStringToFile(env_.get(), data, path));
+    return q6_rows;
+  }
+
+  int CountTablets(const string& table_name) {
+    client::sp::shared_ptr<KuduTable> table;
+    CHECK_OK(client_->OpenTable(table_name, &table));
+    vector<KuduScanToken*> tokens;
+    ElementDeleter d(&tokens);
+    KuduScanTokenBuilder builder(table.get());
+    CHECK_OK(builder.Build(&tokens));
+    return tokens.size();
+  }
+
+  gscoped_ptr<MiniCluster> cluster_;
+  client::sp::shared_ptr<client::KuduClient> client_;
+};
+
+TEST_F(TpchLoaderTest, TestParseLine) {
+  const tpch::TpchTable* table = tpch::FindTpchTable("region");
+  ASSERT_TRUE(table != nullptr);
+  KuduSchema schema = tpch::CreateTpchSchema(*table);
+  vector<int> col_idxs = { 0, 1, 2 };
+
+  unique_ptr<KuduPartialRow> row(schema.NewRow());
+  ASSERT_OK(TpchTableLoader::ParseLine(*table, col_idxs, "3|EUROPE|a comment|", row.get()));
+  ASSERT_EQ("int32 r_regionkey=3, string r_name=EUROPE, string r_comment=a comment",
+            row->ToString());
+
+  row.reset(schema.NewRow());
+  ASSERT_OK(TpchTableLoader::ParseLine(*table, col_idxs, "4|ASIA|no separator", row.get()));
+  ASSERT_TRUE(row->IsKeySet());
+
+  row.reset(schema.NewRow());
+  Status s = TpchTableLoader::ParseLine(*table, col_idxs, "x|ASIA|bad key|", row.get());
+  ASSERT_TRUE(s.IsCorruption()) << s.ToString();
+  ASSERT_STR_CONTAINS(s.ToString(), "r_regionkey");
+
+  row.reset(schema.NewRow());
+  s = TpchTableLoader::ParseLine(*table, col_idxs, "5|ASIA", row.get());
+  ASSERT_TRUE(s.IsCorruption()) << s.ToString();
+}
+
+TEST_F(TpchLoaderTest, TestParallelLoad) {
+  const int kNumOrders = 1000;
+  const int kNumThreads = 4;
+  string path = GetTestPath("lineitem.tbl");
+  int q6_rows = WriteLineItemFile(path, kNumOrders);
+
+  TpchTableLoader::Options opts;
+  opts.num_threads = kNumThreads;
+  opts.batch_size = 100;
+  int64_t rows = 0;
+  {
+    TpchTableLoader loader(client_, tpch::FindTpchTable("lineitem"), path, opts);
+    ASSERT_OK(loader.Run(&rows));
+  }
+  ASSERT_EQ(kNumOrders * 4, rows);
+  ASSERT_EQ(kNumThreads, CountTablets("lineitem"));
+
+  // Loading an existing table leaves it untouched.
+  {
+    TpchTableLoader loader(client_, tpch::FindTpchTable("lineitem"), path, opts);
+    Status s = loader.Run(&rows);
+    ASSERT_TRUE(s.IsAlreadyPresent()) << s.ToString();
+  }
+
+  for (const char* name : { "count", "count_agg" }) {
+    SCOPED_TRACE(name);
+    TpchQueryResult result;
+    ASSERT_OK(tpch::FindTpchQuery(name)->run(client_.get(), &result));
+    ASSERT_EQ(kNumOrders * 4, result.rows);
+  }
+  for (const char* name : { "q6", "q6_agg" }) {
+    SCOPED_TRACE(name);
+    TpchQueryResult result;
+    ASSERT_OK(tpch::FindTpchQuery(name)->run(client_.get(), &result));
+    ASSERT_EQ(q6_rows, result.rows);
+  }
+  TpchQueryResult result;
+  ASSERT_OK(tpch::FindTpchQuery("q1")->run(client_.get(), &result));
+  ASSERT_GT(result.rows, 0);
+  ASSERT_STR_CONTAINS(result.summary, "A|F: ");
+}
+
+TEST_F(TpchLoaderTest, TestLoadSmallTable) {
+  // A table with fewer lines than threads gets as many tablets as lines.
+  string path = GetTestPath("region.tbl");
+  ASSERT_OK(WriteStringToFile(env_.get(),
+                              "0|AFRICA|x|\n1|AMERICA|y|\n2|ASIA|z|\n", path));
+  TpchTableLoader::Options opts;
+  opts.num_threads = 8;
+  TpchTableLoader loader(client_, tpch::FindTpchTable("region"), path, opts);
+  int64_t rows = 0;
+  ASSERT_OK(loader.Run(&rows));
+  ASSERT_EQ(3, rows);
+  ASSERT_EQ(3, CountTablets("region"));
+}
+
+TEST_F(TpchLoaderTest, TestMalformedFile) {
+  string path = GetTestPath("nation.tbl");
+  ASSERT_OK(WriteStringToFile(env_.get(), "0|ALGERIA|0|x|\n1|ARGENTINA|one|y|\n", path));
+  TpchTableLoader loader(client_, tpch::FindTpchTable("nation"), path);
+  int64_t rows = 0;
+  Status s = loader.Run(&rows);
+  ASSERT_TRUE(s.IsCorruption()) << s.ToString();
+  ASSERT_STR_CONTAINS(s.ToString(), "n_regionkey");
+}
+
+} // namespace kudu
@@ -0,0 +1,339 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/benchmarks/tpch/tpch_loader.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <glog/logging.h>
+
+#include "kudu/client/write_op.h"
+#include "kudu/common/partial_row.h"
+#include "kudu/gutil/stl_util.h"
+#include "kudu/gutil/strings/numbers.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/env.h"
+#include "kudu/util/env_util.h"
+#include "kudu/util/thread.h"
+
+using std::string;
+using std::unique_ptr;
+using std::vector;
+using strings::Substitute;
+
+namespace kudu {
+
+using client::KuduColumnSchema;
+using client::KuduError;
+using client::KuduInsert;
+using client::KuduSchema;
+using client::KuduSession;
+using client::KuduTableCreator;
+
+// The size of the reads of each loading thread.
+static const size_t kReadSize = 1024 * 1024;
+
+// The size of the reads done while looking for the start of a line.
+static const size_t kSeekReadSize = 4096;
+
+TpchTableLoader::TpchTableLoader(client::sp::shared_ptr<client::KuduClient> client,
+                                 const tpch::TpchTable* table,
+                                 string path,
+                                 Options options)
+    : client_(std::move(client)),
+      table_(DCHECK_NOTNULL(table)),
+      path_(std::move(path)),
+      options_(options),
+      env_(Env::Default()),
+      file_size_(0) {
+}
+
+TpchTableLoader::~TpchTableLoader() {
+}
+
+Status TpchTableLoader::Run(int64_t* rows_loaded) {
+  client::sp::shared_ptr<client::KuduTable> existing;
+  Status s = client_->OpenTable(table_->name, &existing);
+  if (s.ok()) {
+    return Status::AlreadyPresent(Substitute("table $0 already exists", table_->name));
+  }
+  if (!s.IsNotFound()) {
+    return s;
+  }
+
+  RETURN_NOT_OK(env_->NewRandomAccessFile(path_, &file_));
+  RETURN_NOT_OK(file_->Size(&file_size_));
+
+  vector<Chunk> chunks;
+  RETURN_NOT_OK(ComputeChunks(&chunks));
+  RETURN_NOT_OK(CreateTable(chunks));
+  RETURN_NOT_OK(client_->OpenTable(table_->name, &kudu_table_));
+
+  const KuduSchema& schema = kudu_table_->schema();
+  col_idxs_.clear();
+  for (const auto& col : table_->columns) {
+    for (int i = 0; i < schema.num_columns(); i++) {
+      if (schema.Column(i).name() == col.name) {
+        col_idxs_.push_back(i);
+        break;
+      }
+    }
+  }
+  CHECK_EQ(col_idxs_.size(), table_->columns.size());
+
+  vector<scoped_refptr<Thread>> threads;
+  vector<Status> statuses(chunks.size());
+  vector<int64_t> rows(chunks.size(), 0);
+  for (int i = 0; i < chunks.size(); i++) {
+    scoped_refptr<Thread> t;
+    RETURN_NOT_OK(Thread::Create("tpch", Substitute("load-$0-$1", table_->name, i),
+                                 &TpchTableLoader::LoadChunk, this, chunks[i],
+                                 &statuses[i], &rows[i], &t));
+    threads.push_back(t);
+  }
+  for (const auto& t : threads) {
+    t->Join();
+  }
+
+  *rows_loaded = 0;
+  for (int i = 0; i < chunks.size(); i++) {
+    *rows_loaded += rows[i];
+    RETURN_NOT_OK_PREPEND(statuses[i], Substitute("failed to load $0", path_));
+  }
+  return Status::OK();
+}
+
+Status TpchTableLoader::ComputeChunks(vector<Chunk>* chunks) {
+  int num_chunks = std::max(options_.num_threads, 1);
+  uint64_t prev = 0;
+  for (int i = 1; i <= num_chunks; i++) {
+    uint64_t end = file_size_;
+    if (i < num_chunks) {
+      end = file_size_ * i / num_chunks;
+      RETURN_NOT_OK(FindLineStart(&end));
+    }
+    if (end > prev) {
+      chunks->emplace_back(prev, end);
+      prev = end;
+    }
+  }
+  return Status::OK();
+}
+
+Status TpchTableLoader::FindLineStart(uint64_t* offset) {
+  if (*offset == 0) {
+    return Status::OK();
+  }
+  // Look for the end of the line which contains the byte before 'offset'.
+  uint64_t pos = *offset - 1;
+  unique_ptr<uint8_t[]> scratch(new uint8_t[kSeekReadSize]);
+  while (pos < file_size_) {
+    size_t n = std::min<uint64_t>(kSeekReadSize, file_size_ - pos);
+    Slice data;
+    RETURN_NOT_OK(env_util::ReadFully(file_.get(), pos, n, &data, scratch.get()));
+    const void* nl = memchr(data.data(), '\n', data.size());
+    if (nl != nullptr) {
+      *offset = pos + (reinterpret_cast<const uint8_t*>(nl) - data.data()) + 1;
+      return Status::OK();
+    }
+    pos += n;
+  }
+  *offset = file_size_;
+  return Status::OK();
+}
+
+Status TpchTableLoader::ReadFirstKey(uint64_t offset, int64_t* key) {
+  size_t n = std::min<uint64_t>(kSeekReadSize, file_size_ - offset);
+  unique_ptr<uint8_t[]> scratch(new uint8_t[n]);
+  Slice data;
+  RETURN_NOT_OK(env_util::ReadFully(file_.get(), offset, n, &data, scratch.get()));
+  const void* sep = memchr(data.data(), '|', data.size());
+  int len = sep ? reinterpret_cast<const uint8_t*>(sep) - data.data() : data.size();
+  if (!safe_strto64(reinterpret_cast<const char*>(data.data()), len, key)) {
+    return Status::Corruption(Substitute("bad key at offset $0 of $1", offset, path_));
+  }
+  return Status::OK();
+}
+
+Status TpchTableLoader::CreateTable(const vector<Chunk>& chunks) {
+  const KuduSchema schema = tpch::CreateTpchSchema(*table_);
+  const string& range_col = table_->key_columns[0];
+  KuduColumnSchema::DataType range_type = schema.Column(0).type();
+
+  gscoped_ptr<KuduTableCreator> table_creator(client_->NewTableCreator());
+  table_creator->table_name(table_->name)
+      .schema(&schema)
+      .num_replicas(options_.num_replicas)
+      .set_range_partition_columns({ range_col });
+
+  // Split at the first key of each chunk but the first. A key may span
+  // several chunks, so skip the splits which don't increase.
+  bool have_prev = false;
+  int64_t prev_key = 0;
+  for (int i = 1; i < chunks.size(); i++) {
+    int64_t key;
+    RETURN_NOT_OK(ReadFirstKey(chunks[i].first, &key));
+    if (have_prev && key <= prev_key) {
+      continue;
+    }
+    KuduPartialRow* split = schema.NewRow();
+    if (range_type == KuduColumnSchema::INT64) {
+      CHECK_OK(split->SetInt64(0, key));
+    } else {
+      CHECK_OK(split->SetInt32(0, key));
+    }
+    table_creator->add_range_partition_split(split);
+    have_prev = true;
+    prev_key = key;
+  }
+  return table_creator->Create();
+}
+
+Status TpchTableLoader::ParseLine(const tpch::TpchTable& table,
+                                  const vector<int>& col_idxs,
+                                  const Slice& line,
+                                  KuduPartialRow* row) {
+  const char* p = reinterpret_cast<const char*>(line.data());
+  const char* end = p + line.size();
+  for (int i = 0; i < table.columns.size(); i++) {
+    if (p > end) {
+      return Status::Corruption("too few fields", line.ToString());
+    }
+    const char* sep = static_cast<const char*>(memchr(p, '|', end - p));
+    if (sep == nullptr) {
+      sep = end;
+    }
+    Slice field(p, sep - p);
+    p = sep + 1;
+
+    int idx = col_idxs[i];
+    bool ok = true;
+    switch (table.columns[i].type) {
+      case KuduColumnSchema::INT32: {
+        int32_t v;
+        ok = safe_strto32(field.ToString(), &v);
+        if (ok) RETURN_NOT_OK(row->SetInt32(idx, v));
+        break;
+      }
+      case KuduColumnSchema::INT64: {
+        int64_t v;
+        ok = safe_strto64(field.ToString(), &v);
+        if (ok) RETURN_NOT_OK(row->SetInt64(idx, v));
+        break;
+      }
+      case KuduColumnSchema::DOUBLE: {
+        double v;
+        ok = safe_strtod(field.ToString(), &v);
+        if (ok) RETURN_NOT_OK(row->SetDouble(idx, v));
+        break;
+      }
+      case KuduColumnSchema::STRING:
+        RETURN_NOT_OK(row->SetStringCopy(idx, field));
+        break;
+      default:
+        LOG(FATAL) << "unexpected type of column " << table.columns[i].name;
+    }
+    if (!ok) {
+      return Status::Corruption(Substitute("bad value for column $0: '$1'",
+                                           table.columns[i].name, field.ToString()),
+                                line.ToString());
+    }
+  }
+  return Status::OK();
+}
+
+void TpchTableLoader::LoadChunk(Chunk chunk, Status* status, int64_t* rows_loaded) {
+  *status = DoLoadChunk(chunk, rows_loaded);
+}
+
+Status TpchTableLoader::DoLoadChunk(Chunk chunk, int64_t* rows_loaded) {
+  client::sp::shared_ptr<KuduSession> session = client_->NewSession();
+  RETURN_NOT_OK(session->SetFlushMode(KuduSession::MANUAL_FLUSH));
+  session->SetTimeoutMillis(60000);
+  // Allow a whole batch to be buffered.
+  RETURN_NOT_OK(session->SetMutationBufferSpace(64 * 1024 * 1024));
+
+  unique_ptr<uint8_t[]> scratch(new uint8_t[kReadSize]);
+  // The beginning of a line which started in the previous read.
+  string partial;
+  int64_t num_buffered = 0;
+
+  auto apply = [&](const Slice& line) -> Status {
+    if (line.empty()) {
+      return Status::OK();
+    }
+    gscoped_ptr<KuduInsert> insert(kudu_table_->NewInsert());
+    RETURN_NOT_OK(ParseLine(*table_, col_idxs_, line, insert->mutable_row()));
+    RETURN_NOT_OK(session->Apply(insert.release()));
+    if (++num_buffered == options_.batch_size) {
+      RETURN_NOT_OK(FlushSession(session.get()));
+      *rows_loaded += num_buffered;
+      num_buffered = 0;
+    }
+    return Status::OK();
+  };
+
+  uint64_t offset = chunk.first;
+  while (offset < chunk.second) {
+    size_t n = std::min<uint64_t>(kReadSize, chunk.second - offset);
+    Slice data;
+    RETURN_NOT_OK(env_util::ReadFully(file_.get(), offset, n, &data, scratch.get()));
+    offset += n;
+
+    const char* p = reinterpret_cast<const char*>(data.data());
+    const char* end = p + data.size();
+    while (p < end) {
+      const char* nl = static_cast<const char*>(memchr(p, '\n', end - p));
+      if (nl == nullptr) {
+        partial.append(p, end - p);
+        break;
+      }
+      if (!partial.empty()) {
+        partial.append(p, nl - p);
+        RETURN_NOT_OK(apply(partial));
+        partial.clear();
+      } else {
+        RETURN_NOT_OK(apply(Slice(p, nl - p)));
+      }
+      p = nl + 1;
+    }
+  }
+  // The last line of the file may not end with a newline.
+  RETURN_NOT_OK(apply(partial));
+  RETURN_NOT_OK(FlushSession(session.get()));
+  *rows_loaded += num_buffered;
+  return Status::OK();
+}
+
+Status TpchTableLoader::FlushSession(KuduSession* session) {
+  Status s = session->Flush();
+  if (s.ok()) {
+    return s;
+  }
+  vector<KuduError*> errors;
+  ElementDeleter d(&errors);
+  bool overflow;
+  session->GetPendingErrors(&errors, &overflow);
+  if (!errors.empty()) {
+    return errors[0]->status().CloneAndPrepend(
+        Substitute("failed to write $0 rows, first error", errors.size()));
+  }
+  return s;
+}
+
+} // namespace kudu
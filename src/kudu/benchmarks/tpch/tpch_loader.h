@@ -0,0 +1,130 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#ifndef KUDU_BENCHMARKS_TPCH_TPCH_LOADER_H
+#define KUDU_BENCHMARKS_TPCH_TPCH_LOADER_H
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "kudu/benchmarks/tpch/tpch-schemas.h"
+#include "kudu/client/client.h"
+#include "kudu/gutil/gscoped_ptr.h"
+#include "kudu/gutil/macros.h"
+#include "kudu/util/slice.h"
+#include "kudu/util/status.h"
+
+namespace kudu {
+
+class Env;
+class KuduPartialRow;
+class RandomAccessFile;
+
+// Loads the '|'-separated data file of a TPC-H table, as written by dbgen,
+// into a Kudu table using several threads.
+//
+// The file is split into one newline-aligned chunk per thread. Since dbgen
+// writes each table sorted by its first key column, the table is created
+// range-partitioned on that column with a split at the first key of every
+// chunk, so that each thread writes to its own tablet.
+class TpchTableLoader {
+ public:
+  // Options which control the load. The defaults are suited to loading a
+  // table into a mini cluster.
+  struct Options {
+    // The number of loading threads, and so of chunks of the file.
+    int num_threads = 4;
+
+    // The number of rows written by each thread between flushes.
+    int batch_size = 1000;
+
+    // The replication factor of the created table.
+    int num_replicas = 1;
+
+    Options() {}
+  };
+
+  // Loads 'table' from the file at 'path'. The Kudu table has the same
+  // name as the TPC-H table.
+  TpchTableLoader(client::sp::shared_ptr<client::KuduClient> client,
+                  const tpch::TpchTable* table,
+                  std::string path,
+                  Options options = Options());
+  ~TpchTableLoader();
+
+  // Creates the table and loads the file into it, setting 'rows_loaded' to
+  // the number of rows written.
+  //
+  // Returns Status::AlreadyPresent if the table already exists, in which
+  // case it is left untouched, and Status::Corruption if a line of the file
+  // can't be parsed. Any write error is returned as well, though some rows
+  // may have been loaded by then.
+  Status Run(int64_t* rows_loaded);
+
+  // Parses 'line' into the columns of 'row', which must be a row of a
+  // table created from 'table'. 'col_idxs' maps each field of the line to
+  // the index of its column in the schema. Exposed for tests.
+  static Status ParseLine(const tpch::TpchTable& table,
+                          const std::vector<int>& col_idxs,
+                          const Slice& line,
+                          KuduPartialRow* row);
+
+ private:
+  // A range [start, end) of byte offsets of the file, starting at the
+  // beginning of a line.
+  typedef std::pair<uint64_t, uint64_t> Chunk;
+
+  // Splits the file into at most 'options_.num_threads' chunks.
+  Status ComputeChunks(std::vector<Chunk>* chunks);
+
+  // Sets 'offset' to the offset of the first line starting at or after it,
+  // or to the size of the file if there is none.
+  Status FindLineStart(uint64_t* offset);
+
+  // Reads the key in the first field of the line at 'offset'.
+  Status ReadFirstKey(uint64_t offset, int64_t* key);
+
+  Status CreateTable(const std::vector<Chunk>& chunks);
+
+  // Loads the rows of 'chunk', setting 'status' to the first error, if any,
+  // and adding the number of rows written to 'rows_loaded'.
+  void LoadChunk(Chunk chunk, Status* status, int64_t* rows_loaded);
+  Status DoLoadChunk(Chunk chunk, int64_t* rows_loaded);
+
+  // Flushes 'session', returning the first of its errors, if any.
+  static Status FlushSession(client::KuduSession* session);
+
+  const client::sp::shared_ptr<client::KuduClient> client_;
+  const tpch::TpchTable* const table_;
+  const std::string path_;
+  const Options options_;
+
+  Env* const env_;
+  gscoped_ptr<RandomAccessFile> file_;
+  uint64_t file_size_;
+
+  client::sp::shared_ptr<client::KuduTable> kudu_table_;
+
+  // The index in the table's schema of the column of each field.
+  std::vector<int> col_idxs_;
+
+  DISALLOW_COPY_AND_ASSIGN(TpchTableLoader);
+};
+
+} // namespace kudu
+#endif
@@ -0,0 +1,326 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/benchmarks/tpch/tpch_queries.h"
+
+#include <map>
+#include <memory>
+#include <utility>
+
+#include "kudu/benchmarks/tpch/tpch-schemas.h"
+#include "kudu/client/scan_batch.h"
+#include "kudu/client/value.h"
+#include "kudu/gutil/stringprintf.h"
+#include "kudu/gutil/strings/join.h"
+#include "kudu/gutil/strings/substitute.h"
+
+using std::map;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+using strings::Substitute;
+
+namespace kudu {
+namespace tpch {
+
+using client::KuduClient;
+using client::KuduPredicate;
+using client::KuduScanBatch;
+using client::KuduScanner;
+using client::KuduTable;
+using client::KuduValue;
+
+namespace {
+
+// The bounds of the predicates of the queries, using the values of the
+// validation queries of the TPC-H specification.
+const char* const kQ1ShipDateUpperBound = "1998-09-02";
+const char* const kQ6ShipDateLowerBound = "1994-01-01";
+const char* const kQ6ShipDateUpperBound = "1995-01-01";
+const double kQ6DiscountLowerBound = 0.05;
+const double kQ6DiscountUpperBound = 0.07;
+const int kQ6QuantityUpperBound = 24;
+const char* const kQ4OrderDateLowerBound = "1993-07-01";
+const char* const kQ4OrderDateUpperBound = "1993-10-01";
+
+// Opens a scanner of 'table_name' which projects 'columns' and has the
+// predicates created by 'add_preds'.
+template<class F>
+Status OpenScanner(KuduClient* client,
+                   const string& table_name,
+                   const vector<string>& columns,
+                   const F& add_preds,
+                   client::sp::shared_ptr<KuduTable>* table,
+                   unique_ptr<KuduScanner>* scanner) {
+  RETURN_NOT_OK(client->OpenTable(table_name, table));
+  scanner->reset(new KuduScanner(table->get()));
+  RETURN_NOT_OK((*scanner)->SetProjectedColumnNames(columns));
+  vector<KuduPredicate*> preds;
+  add_preds(table->get(), &preds);
+  for (KuduPredicate* pred : preds) {
+    RETURN_NOT_OK((*scanner)->AddConjunctPredicate(pred));
+  }
+  return (*scanner)->Open();
+}
+
+// Calls 'f' on each row returned by 'scanner', counting them in 'rows'.
+template<class F>
+Status ForEachRow(KuduScanner* scanner, int64_t* rows, const F& f) {
+  KuduScanBatch batch;
+  while (scanner->HasMoreRows()) {
+    RETURN_NOT_OK(scanner->NextBatch(&batch));
+    for (const KuduScanBatch::RowPtr& row : batch) {
+      RETURN_NOT_OK(f(row));
+    }
+    *rows += batch.NumRows();
+  }
+  return Status::OK();
+}
+
+// Reads all the batches of the aggregating scan 'scanner'.
+Status DrainAggregatingScan(KuduScanner* scanner) {
+  KuduScanBatch batch;
+  while (scanner->HasMoreRows()) {
+    RETURN_NOT_OK(scanner->NextBatch(&batch));
+  }
+  return Status::OK();
+}
+
+void AddQ6Predicates(KuduTable* table, vector<KuduPredicate*>* preds) {
+  preds->push_back(table->NewComparisonPredicate(
+      kShipDateColName, KuduPredicate::GREATER_EQUAL,
+      KuduValue::CopyString(kQ6ShipDateLowerBound)));
+  preds->push_back(table->NewComparisonPredicate(
+      kShipDateColName, KuduPredicate::LESS,
+      KuduValue::CopyString(kQ6ShipDateUpperBound)));
+  preds->push_back(table->NewComparisonPredicate(
+      kDiscountColName, KuduPredicate::GREATER_EQUAL,
+      KuduValue::FromDouble(kQ6DiscountLowerBound)));
+  preds->push_back(table->NewComparisonPredicate(
+      kDiscountColName, KuduPredicate::LESS_EQUAL,
+      KuduValue::FromDouble(kQ6DiscountUpperBound)));
+  preds->push_back(table->NewComparisonPredicate(
+      kQuantityColName, KuduPredicate::LESS,
+      KuduValue::FromInt(kQ6QuantityUpperBound)));
+}
+
+void NoPredicates(KuduTable* /* table */, vector<KuduPredicate*>* /* preds */) {
+}
+
+// Q1, the pricing summary report, grouped by the client.
+Status RunQ1(KuduClient* client, TpchQueryResult* result) {
+  struct Group {
+    int64_t sum_qty = 0;
+    double sum_base_price = 0;
+    double sum_disc_price = 0;
+    double sum_charge = 0;
+    double sum_disc = 0;
+    int64_t count = 0;
+  };
+  client::sp::shared_ptr<KuduTable> table;
+  unique_ptr<KuduScanner> scanner;
+  RETURN_NOT_OK(OpenScanner(
+      client, "lineitem",
+      { kReturnFlagColName, kLineStatusColName, kQuantityColName,
+        kExtendedPriceColName, kDiscountColName, kTaxColName },
+      [](KuduTable* t, vector<KuduPredicate*>* preds) {
+        preds->push_back(t->NewComparisonPredicate(
+            kShipDateColName, KuduPredicate::LESS_EQUAL,
+            KuduValue::CopyString(kQ1ShipDateUpperBound)));
+      },
+      &table, &scanner));
+
+  map<string, Group> groups;
+  string key;
+  RETURN_NOT_OK(ForEachRow(scanner.get(), &result->rows,
+                           [&](const KuduScanBatch::RowPtr& row) {
+    Slice returnflag, linestatus;
+    int32_t quantity;
+    double extendedprice, discount, tax;
+    RETURN_NOT_OK(row.GetString(0, &returnflag));
+    RETURN_NOT_OK(row.GetString(1, &linestatus));
+    RETURN_NOT_OK(row.GetInt32(2, &quantity));
+    RETURN_NOT_OK(row.GetDouble(3, &extendedprice));
+    RETURN_NOT_OK(row.GetDouble(4, &discount));
+    RETURN_NOT_OK(row.GetDouble(5, &tax));
+
+    key.assign(reinterpret_cast<const char*>(returnflag.data()), returnflag.size());
+    key.push_back('|');
+    key.append(reinterpret_cast<const char*>(linestatus.data()), linestatus.size());
+    Group& g = groups[key];
+    g.sum_qty += quantity;
+    g.sum_base_price += extendedprice;
+    g.sum_disc_price += extendedprice * (1 - discount);
+    g.sum_charge += extendedprice * (1 - discount) * (1 + tax);
+    g.sum_disc += discount;
+    g.count++;
+    return Status::OK();
+  }));
+
+  vector<string> lines;
+  for (const auto& entry : groups) {
+    const Group& g = entry.second;
+    lines.push_back(StringPrintf(
+        "%s: sum_qty=%lld sum_base_price=%.2f sum_disc_price=%.2f sum_charge=%.2f "
+        "avg_qty=%.2f avg_price=%.2f avg_disc=%.2f count=%lld",
+        entry.first.c_str(), static_cast<long long>(g.sum_qty), g.sum_base_price,
+        g.sum_disc_price, g.sum_charge, static_cast<double>(g.sum_qty) / g.count,
+        g.sum_base_price / g.count, g.sum_disc / g.count,
+        static_cast<long long>(g.count)));
+  }
+  result->summary = JoinStrings(lines, "\n");
+  return Status::OK();
+}
+
+// Q6, the forecasting revenue change query. All of its predicates are
+// pushed down, and the client computes the revenue from the projected
+// columns.
+Status RunQ6(KuduClient* client, TpchQueryResult* result) {
+  client::sp::shared_ptr<KuduTable> table;
+  unique_ptr<KuduScanner> scanner;
+  RETURN_NOT_OK(OpenScanner(client, "lineitem",
+                            { kExtendedPriceColName, kDiscountColName },
+                            AddQ6Predicates, &table, &scanner));
+  double revenue = 0;
+  RETURN_NOT_OK(ForEachRow(scanner.get(), &result->rows,
+                           [&](const KuduScanBatch::RowPtr& row) {
+    double extendedprice, discount;
+    RETURN_NOT_OK(row.GetDouble(0, &extendedprice));
+    RETURN_NOT_OK(row.GetDouble(1, &discount));
+    revenue += extendedprice * discount;
+    return Status::OK();
+  }));
+  result->summary = StringPrintf("revenue=%.2f", revenue);
+  return Status::OK();
+}
+
+// Q6 with its aggregates pushed down. Aggregating scans can't compute the
+// sum of a product of columns, so this sums the columns of the revenue
+// separately; the point is to compare its cost with that of RunQ6().
+Status RunQ6Aggregated(KuduClient* client, TpchQueryResult* result) {
+  client::sp::shared_ptr<KuduTable> table;
+  unique_ptr<KuduScanner> scanner;
+  RETURN_NOT_OK(OpenScanner(client, "lineitem",
+                            { kExtendedPriceColName, kDiscountColName },
+                            AddQ6Predicates, &table, &scanner));
+  RETURN_NOT_OK(scanner->AddAggregate(KuduScanner::COUNT, ""));
+  RETURN_NOT_OK(scanner->AddAggregate(KuduScanner::SUM, kExtendedPriceColName));
+  RETURN_NOT_OK(scanner->AddAggregate(KuduScanner::SUM, kDiscountColName));
+  RETURN_NOT_OK(DrainAggregatingScan(scanner.get()));
+
+  RETURN_NOT_OK(scanner->GetAggregateCount(0, &result->rows));
+  double sum_extendedprice = 0;
+  double sum_discount = 0;
+  if (result->rows > 0) {
+    RETURN_NOT_OK(scanner->GetAggregateDouble(1, &sum_extendedprice));
+    RETURN_NOT_OK(scanner->GetAggregateDouble(2, &sum_discount));
+  }
+  result->summary = StringPrintf("sum_extendedprice=%.2f sum_discount=%.2f",
+                                 sum_extendedprice, sum_discount);
+  return Status::OK();
+}
+
+// A count of all the rows of lineitem, projecting no columns.
+Status RunCount(KuduClient* client, TpchQueryResult* result) {
+  client::sp::shared_ptr<KuduTable> table;
+  unique_ptr<KuduScanner> scanner;
+  RETURN_NOT_OK(OpenScanner(client, "lineitem", {}, NoPredicates, &table, &scanner));
+  KuduScanBatch batch;
+  while (scanner->HasMoreRows()) {
+    RETURN_NOT_OK(scanner->NextBatch(&batch));
+    result->rows += batch.NumRows();
+  }
+  result->summary = Substitute("count=$0", result->rows);
+  return Status::OK();
+}
+
+// The same count, computed by the tablet servers.
+Status RunCountAggregated(KuduClient* client, TpchQueryResult* result) {
+  client::sp::shared_ptr<KuduTable> table;
+  unique_ptr<KuduScanner> scanner;
+  RETURN_NOT_OK(OpenScanner(client, "lineitem", {}, NoPredicates, &table, &scanner));
+  RETURN_NOT_OK(scanner->AddAggregate(KuduScanner::COUNT, ""));
+  RETURN_NOT_OK(DrainAggregatingScan(scanner.get()));
+  RETURN_NOT_OK(scanner->GetAggregateCount(0, &result->rows));
+  result->summary = Substitute("count=$0", result->rows);
+  return Status::OK();
+}
+
+// The scan of orders of Q4, the order priority checking query, without
+// its semi-join with lineitem: the orders of a quarter, counted by
+// priority.
+Status RunQ4Orders(KuduClient* client, TpchQueryResult* result) {
+  client::sp::shared_ptr<KuduTable> table;
+  unique_ptr<KuduScanner> scanner;
+  RETURN_NOT_OK(OpenScanner(
+      client, "orders", { "o_orderpriority" },
+      [](KuduTable* t, vector<KuduPredicate*>* preds) {
+        preds->push_back(t->NewComparisonPredicate(
+            "o_orderdate", KuduPredicate::GREATER_EQUAL,
+            KuduValue::CopyString(kQ4OrderDateLowerBound)));
+        preds->push_back(t->NewComparisonPredicate(
+            "o_orderdate", KuduPredicate::LESS,
+            KuduValue::CopyString(kQ4OrderDateUpperBound)));
+      },
+      &table, &scanner));
+  map<string, int64_t> counts;
+  RETURN_NOT_OK(ForEachRow(scanner.get(), &result->rows,
+                           [&](const KuduScanBatch::RowPtr& row) {
+    Slice priority;
+    RETURN_NOT_OK(row.GetString(0, &priority));
+    counts[priority.ToString()]++;
+    return Status::OK();
+  }));
+  vector<string> lines;
+  for (const auto& entry : counts) {
+    lines.push_back(Substitute("$0: $1", entry.first, entry.second));
+  }
+  result->summary = JoinStrings(lines, "\n");
+  return Status::OK();
+}
+
+} // anonymous namespace
+
+const vector<TpchQuery>& GetTpchQueries() {
+  static const vector<TpchQuery> kQueries = {
+    { "q1", "Q1 with its shipdate predicate pushed down, grouped by the client",
+      "lineitem", &RunQ1 },
+    { "q6", "Q6 with all of its predicates pushed down, summed by the client",
+      "lineitem", &RunQ6 },
+    { "q6_agg", "the predicates of Q6 with COUNT and SUM aggregates pushed down",
+      "lineitem", &RunQ6Aggregated },
+    { "count", "a count of lineitem with an empty projection",
+      "lineitem", &RunCount },
+    { "count_agg", "a count of lineitem with a pushed down COUNT",
+      "lineitem", &RunCountAggregated },
+    { "q4_orders", "the orders scan of Q4, counted by priority by the client",
+      "orders", &RunQ4Orders },
+  };
+  return kQueries;
+}
+
+const TpchQuery* FindTpchQuery(const string& name) {
+  for (const auto& query : GetTpchQueries()) {
+    if (name == query.name) {
+      return &query;
+    }
+  }
+  return nullptr;
+}
+
+} // namespace tpch
+} // namespace kudu
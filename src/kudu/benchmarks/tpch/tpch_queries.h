@@ -0,0 +1,64 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+//
+// Scan-heavy kernels derived from the TPC-H queries, which exercise the
+// predicate pushdown, projection and aggregation pushdown of scans.
+#ifndef KUDU_BENCHMARKS_TPCH_TPCH_QUERIES_H
+#define KUDU_BENCHMARKS_TPCH_TPCH_QUERIES_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "kudu/client/client.h"
+#include "kudu/util/status.h"
+
+namespace kudu {
+namespace tpch {
+
+// The outcome of one run of a query kernel.
+struct TpchQueryResult {
+  // The number of rows which matched the predicates of the query, whether
+  // they were returned to the client or aggregated by the tablet servers.
+  int64_t rows = 0;
+
+  // A short rendering of the result of the query.
+  std::string summary;
+};
+
+// A kernel derived from a TPC-H query. Joins and the expressions which
+// can't be pushed down are left out or computed by the client, as noted in
+// each description.
+struct TpchQuery {
+  const char* name;
+  const char* description;
+
+  // The TPC-H table scanned by the kernel.
+  const char* table;
+
+  Status (*run)(client::KuduClient* client, TpchQueryResult* result);
+};
+
+// Returns all of the query kernels.
+const std::vector<TpchQuery>& GetTpchQueries();
+
+// Returns the kernel called 'name', or NULL if there is none.
+const TpchQuery* FindTpchQuery(const std::string& name);
+
+} // namespace tpch
+} // namespace kudu
+#endif
@@ -0,0 +1,475 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+//
+// Drives Write RPCs against a cluster and reports the write throughput, the
+// client-observed latency of each batch, and a breakdown of the server-side
+// latency of a write into the stages of the write pipeline.
+//
+// Every writer thread has its own session, and flushes batches of
+// --write_bench_batch_size rows synchronously. The breakdown is computed from
+// the difference between two scrapes of the tablet servers' /jsonmetricz
+// pages, taken after the warmup period and at the end of the run, so only
+// writes to the benchmark's table are attributed to the tablet stages.
+//
+// Usage:
+//   write_path_bench -write_bench_num_threads=16
+//                    -write_bench_batch_size=100
+//                    -write_bench_row_size=1000
+//                    -write_bench_key_pattern=random
+//
+// To run against an existing cluster instead of an in-process mini cluster:
+//   write_path_bench -use_mini_cluster=false -master_address=m1:7051
+//                    -tserver_http_addresses=ts1:8050,ts2:8050,ts3:8050
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <rapidjson/document.h>
+
+#include "kudu/client/client.h"
+#include "kudu/client/write_op.h"
+#include "kudu/common/partial_row.h"
+#include "kudu/gutil/gscoped_ptr.h"
+#include "kudu/gutil/stl_util.h"
+#include "kudu/gutil/stringprintf.h"
+#include "kudu/gutil/strings/join.h"
+#include "kudu/gutil/strings/split.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/integration-tests/mini_cluster.h"
+#include "kudu/master/mini_master.h"
+#include "kudu/tserver/mini_tablet_server.h"
+#include "kudu/util/curl_util.h"
+#include "kudu/util/env.h"
+#include "kudu/util/faststring.h"
+#include "kudu/util/flags.h"
+#include "kudu/util/hdr_histogram.h"
+#include "kudu/util/jsonreader.h"
+#include "kudu/util/logging.h"
+#include "kudu/util/monotime.h"
+#include "kudu/util/random.h"
+#include "kudu/util/random_util.h"
+
+DEFINE_int32(write_bench_num_threads, 8, "Number of concurrent writer threads.");
+DEFINE_int32(write_bench_batch_size, 100,
+             "Number of rows written by each thread between flushes.");
+DEFINE_int32(write_bench_row_size, 100,
+             "Size in bytes of the string value of each row, in addition to its "
+             "8-byte key.");
+DEFINE_string(write_bench_key_pattern, "sequential",
+              "Order in which keys are inserted. 'sequential' inserts increasing keys, "
+              "'random' inserts keys in a random order, and 'hot' upserts keys picked "
+              "at random among --write_bench_num_hot_keys keys, so that writes contend "
+              "for row locks.");
+DEFINE_int32(write_bench_num_hot_keys, 1000,
+             "Number of keys written to with --write_bench_key_pattern=hot.");
+DEFINE_int32(write_bench_warmup_seconds, 2,
+             "Seconds to write for before the measured part of the run.");
+DEFINE_int32(write_bench_run_seconds, 20, "Seconds to measure the writes for.");
+DEFINE_int32(write_bench_num_tablets, 4,
+             "Number of hash partitions of the benchmark table.");
+DEFINE_int32(write_bench_num_replicas, 1, "Replication factor of the benchmark table.");
+DEFINE_string(write_bench_table_name, "write_path_bench",
+              "Name of the table to write to. The table must not already exist.");
+DEFINE_bool(use_mini_cluster, true,
+            "Create a mini cluster for the work to be performed against.");
+DEFINE_string(mini_cluster_base_dir, "/tmp/write_path_bench",
+              "If using a mini cluster, directory for master/ts data. Its previous "
+              "contents are deleted.");
+DEFINE_int32(mini_cluster_num_tablet_servers, 1,
+             "If using a mini cluster, the number of tablet servers to start.");
+DEFINE_string(master_address, "localhost",
+              "Address of master for the cluster to operate on");
+DEFINE_string(tserver_http_addresses, "",
+              "If not using a mini cluster, comma-separated list of the web server "
+              "addresses of the tablet servers, from which the latency breakdown "
+              "is scraped. If empty, only the client-side latency is reported.");
+
+using rapidjson::Value;
+using std::string;
+using std::unordered_map;
+using std::vector;
+using strings::Substitute;
+
+namespace kudu {
+
+using client::KuduClient;
+using client::KuduClientBuilder;
+using client::KuduColumnSchema;
+using client::KuduError;
+using client::KuduSchema;
+using client::KuduSchemaBuilder;
+using client::KuduSession;
+using client::KuduTable;
+using client::KuduTableCreator;
+using client::KuduWriteOperation;
+
+namespace {
+
+enum KeyPattern {
+  kSequentialKeys,
+  kRandomKeys,
+  kHotKeys
+};
+
+// Client-observed latencies above this are clamped to it.
+const int64_t kMaxLatencyUs = 60 * 1000 * 1000;
+
+// Keys of different threads are disjoint: each thread writes to its own
+// range of 2^40 keys.
+const int kThreadKeyShift = 40;
+const int64_t kThreadKeyMask = (1LL << kThreadKeyShift) - 1;
+
+// Multiplying by an odd constant is a bijection modulo 2^40, so this visits
+// every key of a thread's range exactly once, in a scattered order.
+const int64_t kKeyScrambleMultiplier = 0x9E3779B97F4A7C15LL;
+
+// A stage of the tablet server write pipeline, and the histogram metric it is
+// read from. The mean of a stage is the growth of the histogram's total_sum
+// over the run, divided by the growth of the total_count of 'per_metric', or
+// of the histogram itself if 'per_metric' is null.
+struct Stage {
+  const char* name;
+  const char* metric;
+  const char* per_metric;
+  const char* description;
+};
+
+// The handler stage covers the stages above it (but the queue), so the stages
+// do not add up to the client latency; the nested stages are indented.
+const Stage kStages[] = {
+  { "queue", "rpc_incoming_queue_time", nullptr,
+    "waiting in the RPC service queue (all RPCs)" },
+  { "prepare", "write_op_prepare_duration", nullptr,
+    "decoding rows and acquiring row locks" },
+  { "  row_locks", "row_lock_wait_duration", "write_op_prepare_duration",
+    "waiting for contended row locks, per write op" },
+  { "replicate", "write_op_replication_duration", nullptr,
+    "from submission to consensus until majority-replicated" },
+  { "  wal_sync", "log_sync_latency", nullptr,
+    "fsync of a WAL group commit, per sync" },
+  { "apply_queue", "op_apply_queue_time", nullptr,
+    "waiting for an apply thread (all ops)" },
+  { "apply", "op_apply_run_time", nullptr,
+    "applying the op to the tablet (all ops)" },
+  { "handler", "handler_latency_kudu_tserver_TabletServerService_Write", nullptr,
+    "from the start of the Write handler to its response" },
+};
+
+struct HistogramTotals {
+  int64_t count = 0;
+  int64_t sum = 0;
+};
+
+typedef unordered_map<string, HistogramTotals> MetricTotals;
+
+// Sums the histograms of 'kStages' across the metric entities of the tablet
+// servers at 'http_addrs'. Tablet entities of tables other than 'table_name'
+// are left out.
+Status ScrapeStageMetrics(const vector<string>& http_addrs, const string& table_name,
+                          MetricTotals* totals) {
+  vector<string> names;
+  for (const Stage& stage : kStages) {
+    names.push_back(stage.metric);
+  }
+  totals->clear();
+  EasyCurl curl;
+  for (const string& addr : http_addrs) {
+    faststring dst;
+    RETURN_NOT_OK(curl.FetchURL(Substitute("http://$0/jsonmetricz?metrics=$1",
+                                           addr, JoinStrings(names, ",")), &dst));
+    JsonReader r(dst.ToString());
+    RETURN_NOT_OK(r.Init());
+    vector<const Value*> entities;
+    RETURN_NOT_OK(r.ExtractObjectArray(r.root(), nullptr, &entities));
+    for (const Value* entity : entities) {
+      string type;
+      RETURN_NOT_OK(r.ExtractString(entity, "type", &type));
+      if (type == "tablet") {
+        const Value* attrs;
+        string entity_table;
+        RETURN_NOT_OK(r.ExtractObject(entity, "attributes", &attrs));
+        if (!r.ExtractString(attrs, "table_name", &entity_table).ok() ||
+            entity_table != table_name) {
+          continue;
+        }
+      }
+      vector<const Value*> metrics;
+      RETURN_NOT_OK(r.ExtractObjectArray(entity, "metrics", &metrics));
+      for (const Value* metric : metrics) {
+        string name;
+        int64_t count;
+        int64_t sum;
+        RETURN_NOT_OK(r.ExtractString(metric, "name", &name));
+        // Substring matches of the requested names may include other metrics.
+        if (std::find(names.begin(), names.end(), name) == names.end() ||
+            !r.ExtractInt64(metric, "total_count", &count).ok() ||
+            !r.ExtractInt64(metric, "total_sum", &sum).ok()) {
+          continue;
+        }
+        HistogramTotals* t = &(*totals)[name];
+        t->count += count;
+        t->sum += sum;
+      }
+    }
+  }
+  return Status::OK();
+}
+
+// Returns the mean latency in microseconds of 'stage' between the scrapes
+// 'before' and 'after', or -1 if nothing was recorded.
+double StageMeanUs(const Stage& stage, const MetricTotals& before, const MetricTotals& after) {
+  auto delta = [&](const char* name, bool sum) {
+    auto b = before.find(name);
+    auto a = after.find(name);
+    if (a == after.end()) return 0.0;
+    int64_t start = b == before.end() ? 0 : (sum ? b->second.sum : b->second.count);
+    return static_cast<double>((sum ? a->second.sum : a->second.count) - start);
+  };
+  double count = delta(stage.per_metric ? stage.per_metric : stage.metric, false);
+  if (count <= 0) {
+    return -1;
+  }
+  return delta(stage.metric, true) / count;
+}
+
+Status CreateTable(const client::sp::shared_ptr<KuduClient>& client, KuduSchema* schema) {
+  bool exists;
+  RETURN_NOT_OK(client->TableExists(FLAGS_write_bench_table_name, &exists));
+  if (exists) {
+    return Status::AlreadyPresent("table already exists", FLAGS_write_bench_table_name);
+  }
+  KuduSchemaBuilder b;
+  b.AddColumn("key")->Type(KuduColumnSchema::INT64)->NotNull()->PrimaryKey();
+  b.AddColumn("val")->Type(KuduColumnSchema::STRING)->NotNull();
+  RETURN_NOT_OK(b.Build(schema));
+  gscoped_ptr<KuduTableCreator> table_creator(client->NewTableCreator());
+  return table_creator->table_name(FLAGS_write_bench_table_name)
+      .schema(schema)
+      .add_hash_partitions({ "key" }, FLAGS_write_bench_num_tablets)
+      .num_replicas(FLAGS_write_bench_num_replicas)
+      .Create();
+}
+
+struct WriterState {
+  KeyPattern key_pattern;
+  std::atomic<bool> measuring { false };
+  std::atomic<bool> stop { false };
+  std::atomic<int64_t> rows_written { 0 };
+  HdrHistogram latency_hist { kMaxLatencyUs, 3 };
+};
+
+void WriterThread(const client::sp::shared_ptr<KuduClient>& client, int thread_idx,
+                  WriterState* state) {
+  client::sp::shared_ptr<KuduTable> table;
+  CHECK_OK(client->OpenTable(FLAGS_write_bench_table_name, &table));
+  client::sp::shared_ptr<KuduSession> session = client->NewSession();
+  session->SetTimeoutMillis(60000);
+  CHECK_OK(session->SetFlushMode(KuduSession::MANUAL_FLUSH));
+  CHECK_OK(session->SetMutationBufferSpace(
+      std::max<int64_t>(2LL * FLAGS_write_bench_batch_size * (FLAGS_write_bench_row_size + 64),
+                        7 * 1024 * 1024)));
+
+  Random rng(GetRandomSeed32());
+  string payload(FLAGS_write_bench_row_size, 'a');
+  for (char& c : payload) {
+    c += rng.Uniform(26);
+  }
+  const int64_t key_base = static_cast<int64_t>(thread_idx) << kThreadKeyShift;
+  int64_t seq = 0;
+  while (!state->stop.load(std::memory_order_relaxed)) {
+    for (int i = 0; i < FLAGS_write_bench_batch_size; i++) {
+      gscoped_ptr<KuduWriteOperation> op;
+      int64_t key = 0;
+      switch (state->key_pattern) {
+        case kSequentialKeys:
+          key = key_base + seq++;
+          break;
+        case kRandomKeys:
+          key = key_base + ((seq++ * kKeyScrambleMultiplier) & kThreadKeyMask);
+          break;
+        case kHotKeys:
+          key = rng.Uniform(FLAGS_write_bench_num_hot_keys);
+          break;
+      }
+      if (state->key_pattern == kHotKeys) {
+        op.reset(table->NewUpsert());
+      } else {
+        op.reset(table->NewInsert());
+      }
+      KuduPartialRow* row = op->mutable_row();
+      CHECK_OK(row->SetInt64(0, key));
+      CHECK_OK(row->SetStringNoCopy(1, payload));
+      CHECK_OK(session->Apply(op.release()));
+    }
+
+    const bool measured = state->measuring.load(std::memory_order_relaxed);
+    MonoTime start = MonoTime::Now();
+    Status s = session->Flush();
+    int64_t latency_us = (MonoTime::Now() - start).ToMicroseconds();
+    if (PREDICT_FALSE(!s.ok())) {
+      vector<KuduError*> errors;
+      ElementDeleter d(&errors);
+      bool overflowed;
+      session->GetPendingErrors(&errors, &overflowed);
+      if (!errors.empty()) {
+        s = s.CloneAndAppend(errors[0]->status().ToString());
+      }
+      LOG(FATAL) << "Write failed: " << s.ToString();
+    }
+    if (measured) {
+      state->latency_hist.Increment(std::min(latency_us, kMaxLatencyUs));
+      state->rows_written.fetch_add(FLAGS_write_bench_batch_size, std::memory_order_relaxed);
+    }
+  }
+}
+
+void RunBenchmark(const client::sp::shared_ptr<KuduClient>& client,
+                  const vector<string>& http_addrs, KeyPattern key_pattern) {
+  KuduSchema schema;
+  CHECK_OK(CreateTable(client, &schema));
+
+  WriterState state;
+  state.key_pattern = key_pattern;
+  vector<std::thread> threads;
+  for (int i = 0; i < FLAGS_write_bench_num_threads; i++) {
+    threads.emplace_back(WriterThread, client, i, &state);
+  }
+
+  SleepFor(MonoDelta::FromSeconds(FLAGS_write_bench_warmup_seconds));
+  MetricTotals before;
+  MetricTotals after;
+  if (!http_addrs.empty()) {
+    CHECK_OK(ScrapeStageMetrics(http_addrs, FLAGS_write_bench_table_name, &before));
+  }
+  state.measuring = true;
+  MonoTime start = MonoTime::Now();
+  SleepFor(MonoDelta::FromSeconds(FLAGS_write_bench_run_seconds));
+  state.measuring = false;
+  double elapsed_s = (MonoTime::Now() - start).ToSeconds();
+  if (!http_addrs.empty()) {
+    CHECK_OK(ScrapeStageMetrics(http_addrs, FLAGS_write_bench_table_name, &after));
+  }
+  state.stop = true;
+  for (std::thread& t : threads) {
+    t.join();
+  }
+
+  const HdrHistogram& hist = state.latency_hist;
+  const int64_t rows = state.rows_written;
+  const int64_t row_bytes = FLAGS_write_bench_row_size + sizeof(int64_t);
+  std::cout << StringPrintf("threads=%d batch_size=%d row_size=%d key_pattern=%s "
+                            "tablets=%d replicas=%d",
+                            FLAGS_write_bench_num_threads, FLAGS_write_bench_batch_size,
+                            FLAGS_write_bench_row_size,
+                            FLAGS_write_bench_key_pattern.c_str(),
+                            FLAGS_write_bench_num_tablets, FLAGS_write_bench_num_replicas)
+            << std::endl;
+  std::cout << StringPrintf("rows/s: %.0f  batches/s: %.0f  MB/s: %.2f",
+                            rows / elapsed_s, hist.TotalCount() / elapsed_s,
+                            rows * row_bytes / elapsed_s / (1024 * 1024))
+            << std::endl;
+  std::cout << StringPrintf("batch latency (us): mean=%.0f p50=%lld p95=%lld p99=%lld "
+                            "p99.9=%lld max=%lld",
+                            hist.MeanValue(),
+                            static_cast<long long>(hist.ValueAtPercentile(50)),
+                            static_cast<long long>(hist.ValueAtPercentile(95)),
+                            static_cast<long long>(hist.ValueAtPercentile(99)),
+                            static_cast<long long>(hist.ValueAtPercentile(99.9)),
+                            static_cast<long long>(hist.MaxValue()))
+            << std::endl;
+  if (http_addrs.empty()) {
+    return;
+  }
+
+  std::cout << StringPrintf("%-12s %10s", "stage", "mean_us") << std::endl;
+  double queue_us = 0;
+  double handler_us = 0;
+  for (const Stage& stage : kStages) {
+    double mean_us = StageMeanUs(stage, before, after);
+    if (strcmp(stage.name, "queue") == 0) queue_us = std::max(mean_us, 0.0);
+    if (strcmp(stage.name, "handler") == 0) handler_us = std::max(mean_us, 0.0);
+    std::cout << StringPrintf("%-12s %10s", stage.name,
+                              mean_us < 0 ? "-" : StringPrintf("%.0f", mean_us).c_str())
+              << "  # " << stage.description << std::endl;
+  }
+  // What is left of the client latency is spent on the network, sending the
+  // response and in the client. A batch spanning several tablets is sent as
+  // several concurrent RPCs, so this is only approximate.
+  std::cout << StringPrintf("%-12s %10.0f", "response", hist.MeanValue() - queue_us - handler_us)
+            << "  # client batch latency not spent in the queue or handler" << std::endl;
+}
+
+} // anonymous namespace
+} // namespace kudu
+
+int main(int argc, char** argv) {
+  kudu::ParseCommandLineFlags(&argc, &argv, true);
+  kudu::InitGoogleLoggingSafe(argv[0]);
+
+  kudu::KeyPattern key_pattern;
+  if (FLAGS_write_bench_key_pattern == "sequential") {
+    key_pattern = kudu::kSequentialKeys;
+  } else if (FLAGS_write_bench_key_pattern == "random") {
+    key_pattern = kudu::kRandomKeys;
+  } else if (FLAGS_write_bench_key_pattern == "hot") {
+    key_pattern = kudu::kHotKeys;
+  } else {
+    std::cerr << "Unknown key pattern: " << FLAGS_write_bench_key_pattern << std::endl;
+    return 1;
+  }
+
+  gscoped_ptr<kudu::MiniCluster> cluster;
+  string master_address;
+  vector<string> http_addrs;
+  if (FLAGS_use_mini_cluster) {
+    kudu::Env* env = kudu::Env::Default();
+    if (env->FileExists(FLAGS_mini_cluster_base_dir)) {
+      CHECK_OK(env->DeleteRecursively(FLAGS_mini_cluster_base_dir));
+    }
+    CHECK_OK(env->CreateDir(FLAGS_mini_cluster_base_dir));
+    kudu::MiniClusterOptions options;
+    options.data_root = FLAGS_mini_cluster_base_dir;
+    options.num_tablet_servers = FLAGS_mini_cluster_num_tablet_servers;
+    cluster.reset(new kudu::MiniCluster(env, options));
+    CHECK_OK(cluster->StartSync());
+    master_address = cluster->mini_master()->bound_rpc_addr_str();
+    for (int i = 0; i < cluster->num_tablet_servers(); i++) {
+      http_addrs.push_back(cluster->mini_tablet_server(i)->bound_http_addr().ToString());
+    }
+  } else {
+    master_address = FLAGS_master_address;
+    http_addrs = strings::Split(FLAGS_tserver_http_addresses, ",", strings::SkipEmpty());
+  }
+
+  kudu::client::sp::shared_ptr<kudu::client::KuduClient> client;
+  CHECK_OK(kudu::client::KuduClientBuilder()
+           .add_master_server_addr(master_address)
+           .Build(&client));
+  kudu::RunBenchmark(client, http_addrs, key_pattern);
+
+  if (cluster) {
+    cluster->Shutdown();
+  }
+  return 0;
+}
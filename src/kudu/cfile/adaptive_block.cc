@@ -0,0 +1,38 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/cfile/adaptive_block.h"
+
+namespace kudu {
+namespace cfile {
+
+void GetAdaptiveCandidateEncodings(const TypeInfo* typeinfo,
+                                   std::vector<const TypeEncodingInfo*>* encodings) {
+  static const EncodingType kCandidates[] = {
+    PLAIN_ENCODING, PREFIX_ENCODING, RLE, BIT_SHUFFLE, FRAME_OF_REFERENCE
+  };
+  encodings->clear();
+  for (EncodingType candidate : kCandidates) {
+    const TypeEncodingInfo* info;
+    if (TypeEncodingInfo::Get(typeinfo, candidate, &info).ok()) {
+      encodings->push_back(info);
+    }
+  }
+}
+
+} // namespace cfile
+} // namespace kudu
@@ -0,0 +1,257 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+//
+// Adaptive encoding: a block is trial-encoded with each of the candidate
+// encodings that support the column's type, and stored with whichever one
+// produced the smallest output. Different blocks of the same column may
+// therefore use different encodings.
+//
+// Block format:
+// 1. the EncodingType of the rest of the block (uint8_t).
+// 2. the block, as written by that encoding's builder.
+//
+// Dictionary encoding is never a candidate, since its dictionary spans the
+// whole cfile rather than a single block.
+#ifndef KUDU_CFILE_ADAPTIVE_BLOCK_H
+#define KUDU_CFILE_ADAPTIVE_BLOCK_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "kudu/cfile/block_encodings.h"
+#include "kudu/cfile/cfile_util.h"
+#include "kudu/cfile/type_encodings.h"
+#include "kudu/common/types.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/faststring.h"
+#include "kudu/util/memory/arena.h"
+
+namespace kudu {
+namespace cfile {
+
+static const size_t kAdaptiveBlockHeaderSize = sizeof(uint8_t);
+
+// Fill 'encodings' with the encodings that adaptive blocks of type
+// 'typeinfo' choose between.
+void GetAdaptiveCandidateEncodings(const TypeInfo* typeinfo,
+                                   std::vector<const TypeEncodingInfo*>* encodings);
+
+template<DataType Type>
+class AdaptiveBlockBuilder : public BlockBuilder {
+ public:
+  explicit AdaptiveBlockBuilder(const WriterOptions* options)
+      : options_(options),
+        candidate_options_(*options),
+        arena_(1024, 32 * 1024 * 1024) {
+    // This builder decides when the block is full, so the candidates are
+    // given enough room that they never turn values away.
+    candidate_options_.storage_attributes.cfile_block_size *= 2;
+
+    std::vector<const TypeEncodingInfo*> encodings;
+    GetAdaptiveCandidateEncodings(GetTypeInfo(Type), &encodings);
+    CHECK(!encodings.empty()) << "no adaptive candidates for " << DataType_Name(Type);
+    for (const TypeEncodingInfo* encoding : encodings) {
+      BlockBuilder* bb;
+      CHECK_OK(encoding->CreateBlockBuilder(&bb, &candidate_options_));
+      candidates_.emplace_back(bb);
+      candidate_encodings_.push_back(encoding->encoding_type());
+    }
+    Reset();
+  }
+
+  virtual int Add(const uint8_t* vals_void, size_t count) OVERRIDE {
+    const CppType* vals = reinterpret_cast<const CppType*>(vals_void);
+    size_t added = 0;
+    while (added < count && !IsBlockFull(options_->storage_attributes.cfile_block_size)) {
+      AppendValue(vals[added]);
+      added++;
+    }
+    return added;
+  }
+
+  virtual bool IsBlockFull(size_t limit) const OVERRIDE {
+    return raw_size_ > limit;
+  }
+
+  virtual Slice Finish(rowid_t ordinal_pos) OVERRIDE {
+    int best = -1;
+    Slice best_block;
+    for (int i = 0; i < candidates_.size(); i++) {
+      BlockBuilder* bb = candidates_[i].get();
+      bb->Reset();
+      if (!values_.empty() &&
+          bb->Add(reinterpret_cast<const uint8_t*>(values_.data()), values_.size()) !=
+          values_.size()) {
+        // The candidate filled up before taking every value.
+        continue;
+      }
+      Slice block = bb->Finish(ordinal_pos);
+      if (best == -1 || block.size() < best_block.size()) {
+        best = i;
+        best_block = block;
+      }
+    }
+    CHECK_NE(best, -1) << "no candidate encoding accepted the block";
+
+    buffer_.clear();
+    buffer_.push_back(static_cast<uint8_t>(candidate_encodings_[best]));
+    buffer_.append(best_block.data(), best_block.size());
+    return Slice(buffer_);
+  }
+
+  virtual void Reset() OVERRIDE {
+    values_.clear();
+    arena_.Reset();
+    raw_size_ = 0;
+    buffer_.clear();
+  }
+
+  virtual size_t Count() const OVERRIDE {
+    return values_.size();
+  }
+
+  virtual Status GetFirstKey(void* key) const OVERRIDE {
+    if (values_.empty()) {
+      return Status::NotFound("no keys in data block");
+    }
+    *reinterpret_cast<CppType*>(key) = values_.front();
+    return Status::OK();
+  }
+
+  virtual Status GetLastKey(void* key) const OVERRIDE {
+    if (values_.empty()) {
+      return Status::NotFound("no keys in data block");
+    }
+    *reinterpret_cast<CppType*>(key) = values_.back();
+    return Status::OK();
+  }
+
+ private:
+  typedef typename TypeTraits<Type>::cpp_type CppType;
+
+  // Account for the per-value offset that binary encodings store alongside
+  // the data, so that the block size limit means roughly the same thing for
+  // the candidates as it does for this builder.
+  static const size_t kBinaryValueOverhead = 5;
+
+  void AppendValue(const Slice& val) {
+    Slice copy;
+    CHECK(arena_.RelocateSlice(val, &copy));
+    values_.push_back(copy);
+    raw_size_ += val.size() + kBinaryValueOverhead;
+  }
+
+  template<class T>
+  void AppendValue(const T& val) {
+    values_.push_back(val);
+    raw_size_ += sizeof(T);
+  }
+
+  const WriterOptions* options_;
+  WriterOptions candidate_options_;
+
+  std::vector<std::unique_ptr<BlockBuilder>> candidates_;
+  std::vector<EncodingType> candidate_encodings_;
+
+  // The values added since the last Reset(). For BINARY, the cell data is
+  // copied into 'arena_'.
+  std::vector<CppType> values_;
+  Arena arena_;
+  size_t raw_size_;
+
+  faststring buffer_;
+};
+
+template<DataType Type>
+class AdaptiveBlockDecoder : public BlockDecoder {
+ public:
+  explicit AdaptiveBlockDecoder(Slice slice)
+      : data_(std::move(slice)) {
+  }
+
+  virtual Status ParseHeader() OVERRIDE {
+    CHECK(!inner_);
+    if (data_.size() < kAdaptiveBlockHeaderSize) {
+      return Status::Corruption("not enough bytes for header in AdaptiveBlockDecoder");
+    }
+    EncodingType encoding = static_cast<EncodingType>(data_[0]);
+    if (encoding == ADAPTIVE_ENCODING || encoding == DICT_ENCODING) {
+      return Status::Corruption(strings::Substitute(
+          "invalid encoding in adaptive block: $0", encoding));
+    }
+    const TypeEncodingInfo* info;
+    RETURN_NOT_OK_PREPEND(TypeEncodingInfo::Get(GetTypeInfo(Type), encoding, &info),
+                          "invalid encoding in adaptive block");
+    BlockDecoder* bd;
+    RETURN_NOT_OK(info->CreateBlockDecoder(
+        &bd, Slice(data_.data() + kAdaptiveBlockHeaderSize,
+                   data_.size() - kAdaptiveBlockHeaderSize), nullptr));
+    inner_.reset(bd);
+    return inner_->ParseHeader();
+  }
+
+  virtual void SeekToPositionInBlock(uint pos) OVERRIDE {
+    inner_->SeekToPositionInBlock(pos);
+  }
+
+  virtual Status SeekAtOrAfterValue(const void* value, bool* exact_match) OVERRIDE {
+    return inner_->SeekAtOrAfterValue(value, exact_match);
+  }
+
+  virtual void SeekForward(int* n) OVERRIDE {
+    inner_->SeekForward(n);
+  }
+
+  virtual Status CopyNextValues(size_t* n, ColumnDataView* dst) OVERRIDE {
+    return inner_->CopyNextValues(n, dst);
+  }
+
+  // CopyNextAndEval() is deliberately not forwarded: whether the decoder
+  // evaluates predicates must be the same for every block of the column.
+
+  virtual bool HasNext() const OVERRIDE {
+    return inner_->HasNext();
+  }
+
+  virtual size_t Count() const OVERRIDE {
+    return inner_->Count();
+  }
+
+  virtual size_t GetCurrentIndex() const OVERRIDE {
+    return inner_->GetCurrentIndex();
+  }
+
+  virtual rowid_t GetFirstRowId() const OVERRIDE {
+    return inner_->GetFirstRowId();
+  }
+
+  // Return the encoding chosen for this block. Only valid after
+  // ParseHeader().
+  EncodingType block_encoding() const {
+    return static_cast<EncodingType>(data_[0]);
+  }
+
+ private:
+  Slice data_;
+  std::unique_ptr<BlockDecoder> inner_;
+};
+
+} // namespace cfile
+} // namespace kudu
+
+#endif // KUDU_CFILE_ADAPTIVE_BLOCK_H
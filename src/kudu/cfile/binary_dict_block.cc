@@ -17,8 +17,11 @@
 
 #include "kudu/cfile/binary_dict_block.h"
 
+#include <gflags/gflags.h>
 #include <glog/logging.h>
 #include <algorithm>
+#include <string>
+#include <vector>
 
 #include "kudu/cfile/cfile_reader.h"
 #include "kudu/cfile/cfile_util.h"
@@ -29,10 +32,22 @@
 #include "kudu/gutil/stringprintf.h"
 #include "kudu/util/coding.h"
 #include "kudu/util/coding-inl.h"
+#include "kudu/util/flag_tags.h"
 #include "kudu/util/group_varint-inl.h"
 #include "kudu/util/hexdump.h"
 #include "kudu/util/memory/arena.h"
 
+DEFINE_int32(cfile_dict_max_pages, 8,
+             "The maximum number of dictionary pages in a dictionary encoded cfile. "
+             "Each page holds up to a cfile block's worth of distinct values; once the "
+             "last page is full, the rest of the cfile is written with plain encoding. "
+             "Cfiles with more than one page can't be read by versions of Kudu that "
+             "predate dictionary pages.");
+TAG_FLAG(cfile_dict_max_pages, advanced);
+
+using std::string;
+using std::vector;
+
 namespace kudu {
 namespace cfile {
 
@@ -47,13 +62,17 @@ BinaryDictBlockBuilder::BinaryDictBlockBuilder(const WriterOptions* options)
 
 void BinaryDictBlockBuilder::Reset() {
   buffer_.clear();
-  buffer_.resize(kMaxHeaderSize);
   buffer_.reserve(options_->storage_attributes.cfile_block_size);
 
   if (mode_ == kCodeWordMode &&
       dict_block_.IsBlockFull(options_->storage_attributes.cfile_block_size)) {
-    mode_ = kPlainBinaryMode;
-    data_builder_.reset(new BinaryPlainBlockBuilder(options_));
+    if (num_dict_pages() < FLAGS_cfile_dict_max_pages) {
+      StartNewDictPage();
+      data_builder_->Reset();
+    } else {
+      mode_ = kPlainBinaryMode;
+      data_builder_.reset(new BinaryPlainBlockBuilder(options_));
+    }
   } else {
     data_builder_->Reset();
   }
@@ -61,10 +80,23 @@ void BinaryDictBlockBuilder::Reset() {
   finished_ = false;
 }
 
+void BinaryDictBlockBuilder::StartNewDictPage() {
+  Slice page = dict_block_.Finish(0);
+  sealed_dict_pages_.emplace_back(page.ToString());
+  dict_block_.Reset();
+  dictionary_.clear();
+  dictionary_strings_arena_.Reset();
+}
+
 Slice BinaryDictBlockBuilder::Finish(rowid_t ordinal_pos) {
   finished_ = true;
 
-  InlineEncodeFixed32(&buffer_[0], mode_);
+  if (mode_ == kCodeWordMode && !sealed_dict_pages_.empty()) {
+    PutFixed32(&buffer_, kPagedCodeWordMode);
+    PutFixed32(&buffer_, sealed_dict_pages_.size());
+  } else {
+    PutFixed32(&buffer_, mode_);
+  }
 
   // TODO: if we could modify the the Finish() API a little bit, we can
   // avoid an extra memory copy (buffer_.append(..))
@@ -75,11 +107,12 @@ Slice BinaryDictBlockBuilder::Finish(rowid_t ordinal_pos) {
 }
 
 // The current block is considered full when the the size of data block
-// exceeds limit or when the size of dictionary block exceeds the
-// CFile block size.
+// exceeds limit or when the size of the current dictionary page exceeds
+// the CFile block size.
 //
-// If it is the latter case, all the subsequent data blocks will switch to
-// StringPlainBlock automatically.
+// If it is the latter case, the next data block starts a new dictionary
+// page, or switches to StringPlainBlock if there are already
+// --cfile_dict_max_pages pages.
 bool BinaryDictBlockBuilder::IsBlockFull(size_t limit) const {
   int block_size = options_->storage_attributes.cfile_block_size;
   if (data_builder_->IsBlockFull(block_size)) return true;
@@ -138,18 +171,21 @@ int BinaryDictBlockBuilder::Add(const uint8_t* vals, size_t count) {
 }
 
 Status BinaryDictBlockBuilder::AppendExtraInfo(CFileWriter* c_writer, CFileFooterPB* footer) {
-  Slice dict_slice = dict_block_.Finish(0);
+  vector<Slice> pages(sealed_dict_pages_.begin(), sealed_dict_pages_.end());
+  pages.push_back(dict_block_.Finish(0));
 
-  std::vector<Slice> dict_v;
-  dict_v.push_back(dict_slice);
+  for (int i = 0; i < pages.size(); i++) {
+    vector<Slice> dict_v;
+    dict_v.push_back(pages[i]);
 
-  BlockPointer ptr;
-  Status s = c_writer->AppendDictBlock(dict_v, &ptr, "Append dictionary block");
-  if (!s.ok()) {
-    LOG(WARNING) << "Unable to append block to file: " << s.ToString();
-    return s;
+    BlockPointer ptr;
+    Status s = c_writer->AppendDictBlock(dict_v, &ptr, "Append dictionary block");
+    if (!s.ok()) {
+      LOG(WARNING) << "Unable to append block to file: " << s.ToString();
+      return s;
+    }
+    ptr.CopyToPB(i == 0 ? footer->mutable_dict_block_ptr() : footer->add_extra_dict_block_ptrs());
   }
-  ptr.CopyToPB(footer->mutable_dict_block_ptr());
   return Status::OK();
 }
 
@@ -188,7 +224,8 @@ Status BinaryDictBlockBuilder::GetLastKey(void* key_void) const {
 BinaryDictBlockDecoder::BinaryDictBlockDecoder(Slice slice, CFileIterator* iter)
     : data_(std::move(slice)),
       parsed_(false),
-      dict_decoder_(iter->GetDictDecoder()),
+      dict_decoder_(nullptr),
+      dict_page_idx_(0),
       parent_cfile_iter_(iter) {
 }
 
@@ -206,9 +243,25 @@ Status BinaryDictBlockDecoder::ParseHeader() {
   if (PREDICT_FALSE(!valid)) {
     return Status::Corruption("header Mode information corrupted");
   }
-  Slice content(data_.data() + 4, data_.size() - 4);
+  size_t header_size = sizeof(uint32_t);
+  if (mode_ == kPagedCodeWordMode) {
+    header_size += sizeof(uint32_t);
+    if (data_.size() < header_size) {
+      return Status::Corruption("not enough bytes for dictionary page index");
+    }
+    dict_page_idx_ = DecodeFixed32(&data_[4]);
+    // Beyond the choice of dictionary page, these blocks are read
+    // just like kCodeWordMode ones.
+    mode_ = kCodeWordMode;
+  }
+  Slice content(data_.data() + header_size, data_.size() - header_size);
 
   if (mode_ == kCodeWordMode) {
+    dict_decoder_ = parent_cfile_iter_->GetDictDecoder(dict_page_idx_);
+    if (PREDICT_FALSE(dict_decoder_ == nullptr)) {
+      return Status::Corruption(strings::Substitute(
+          "data block refers to nonexistent dictionary page $0", dict_page_idx_));
+    }
     data_decoder_.reset(new BShufBlockDecoder<UINT32>(content));
   } else {
     if (mode_ != kPlainBinaryMode) {
@@ -263,7 +316,8 @@ Status BinaryDictBlockDecoder::CopyNextAndEval(size_t* n,
   }
 
   // Predicates that have no matching words should return no data.
-  SelectionVector* codewords_matching_pred = parent_cfile_iter_->GetCodeWordsMatchingPredicate();
+  SelectionVector* codewords_matching_pred =
+      parent_cfile_iter_->GetCodeWordsMatchingPredicate(dict_page_idx_);
   if (!codewords_matching_pred->AnySelected()) {
     // If nothing is selected, move the data_decoder_ pointer forward and clear
     // the corresponding bits in the selection vector.
@@ -319,11 +373,25 @@ Status BinaryDictBlockDecoder::CopyNextDecodeStrings(size_t* n, ColumnDataView*
   BShufBlockDecoder<UINT32>* d_bptr = down_cast<BShufBlockDecoder<UINT32>*>(data_decoder_.get());
   RETURN_NOT_OK(d_bptr->CopyNextValuesToArray(n, codeword_buf_.data()));
 
-  for (int i = 0; i < *n; i++) {
-    uint32_t codeword = *reinterpret_cast<uint32_t*>(&codeword_buf_[i*sizeof(uint32_t)]);
-    Slice elem = dict_decoder_->string_at_index(codeword);
-    CHECK(out_arena->RelocateSlice(elem, out));
-    out++;
+  const uint32_t* codewords = reinterpret_cast<const uint32_t*>(codeword_buf_.data());
+
+  // Size the whole batch first so that every string shares one arena
+  // allocation. Dictionary lookups are random access, so prefetch each
+  // string's data while we're only looking at its length.
+  size_t total = 0;
+  for (size_t i = 0; i < *n; i++) {
+    Slice elem = dict_decoder_->string_at_index(codewords[i]);
+    __builtin_prefetch(elem.data());
+    total += elem.size();
+  }
+  uint8_t* buf = reinterpret_cast<uint8_t*>(out_arena->AllocateBytes(total));
+  CHECK(buf != nullptr || total == 0);
+
+  for (size_t i = 0; i < *n; i++, out++) {
+    Slice elem = dict_decoder_->string_at_index(codewords[i]);
+    memcpy(buf, elem.data(), elem.size());
+    *out = Slice(buf, elem.size());
+    buf += elem.size();
   }
   return Status::OK();
 }
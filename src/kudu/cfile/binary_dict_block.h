@@ -15,15 +15,20 @@
 // specific language governing permissions and limitations
 // under the License.
 //
-// Dictionary encoding for strings. There is only one dictionary block
-// for all the data blocks within a cfile.
+// Dictionary encoding for strings. The dictionary of a cfile is made up of
+// one or more dictionary pages, each a plain binary block of its own.
 // layout for dictionary encoded block:
 // Either header + embedded codeword block, which can be encoded with any
-//        int blockbuilder, when mode_ = kCodeWordMode.
+//        int blockbuilder, when mode_ = kCodeWordMode or kPagedCodeWordMode.
 // Or     header + embedded StringPlainBlock, when mode_ = kPlainStringMode.
-// Data blocks start with mode_ = kCodeWordMode, when the the size of dictionary
-// block go beyond the option_->block_size, the subsequent data blocks will switch
-// to string plain block automatically.
+// The header is the mode (uint32_t), followed in kPagedCodeWordMode by the
+// index of the dictionary page the codewords refer to (uint32_t). Blocks in
+// kCodeWordMode refer to the first page.
+//
+// Data blocks start with mode_ = kCodeWordMode. When the size of the current
+// dictionary page goes beyond the option_->block_size, the next data block
+// starts a new page, up to --cfile_dict_max_pages pages. Once that limit is
+// hit, the subsequent data blocks switch to string plain block automatically.
 
 // You can embed any int block builder encoding formats, such as group-varint,
 // bitshuffle. Currently, we use bitshuffle builder for codewords.
@@ -61,7 +66,8 @@ enum DictEncodingMode {
   DictEncodingMode_min = 1,
   kCodeWordMode = 1,
   kPlainBinaryMode = 2,
-  DictEncodingMode_max = 2
+  kPagedCodeWordMode = 3,
+  DictEncodingMode_max = 3
 };
 
 class BinaryDictBlockBuilder : public BlockBuilder {
@@ -86,11 +92,17 @@ class BinaryDictBlockBuilder : public BlockBuilder {
 
   Status GetLastKey(void* key) const OVERRIDE;
 
-  static const size_t kMaxHeaderSize = sizeof(uint32_t) * 1;
+  static const size_t kMaxHeaderSize = sizeof(uint32_t) * 2;
+
+  // Return the number of dictionary pages started so far.
+  int num_dict_pages() const { return sealed_dict_pages_.size() + 1; }
 
  private:
   int AddCodeWords(const uint8_t* vals, size_t count);
 
+  // Set aside the current dictionary page and start a new, empty one.
+  void StartNewDictPage();
+
   faststring buffer_;
   bool finished_;
   const WriterOptions* options_;
@@ -98,10 +110,14 @@ class BinaryDictBlockBuilder : public BlockBuilder {
   gscoped_ptr<BlockBuilder> data_builder_;
 
   // dict_block_, dictionary_, dictionary_strings_arena_
-  // is related to the dictionary block (one per cfile).
+  // are related to the current dictionary page.
   // They should NOT be cleared in the Reset() method.
   BinaryPlainBlockBuilder dict_block_;
 
+  // The finished dictionary pages before the current one, in order. They
+  // are only written out in AppendExtraInfo().
+  std::vector<std::string> sealed_dict_pages_;
+
   std::unordered_map<StringPiece, uint32_t, GoodFastHash<StringPiece> > dictionary_;
   // Memory to hold the actual content for strings in the dictionary_.
   //
@@ -156,9 +172,12 @@ class BinaryDictBlockDecoder : public BlockDecoder {
   Slice data_;
   bool parsed_;
 
-  // Dictionary block decoder
+  // Decoder for the dictionary page this block's codewords refer to.
   BinaryPlainBlockDecoder* dict_decoder_;
 
+  // Index of that dictionary page.
+  uint32_t dict_page_idx_;
+
   gscoped_ptr<BlockDecoder> data_decoder_;
 
   // Parent CFileIterator, each dictionary decoder in the same CFile will share
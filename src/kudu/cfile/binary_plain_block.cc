@@ -294,10 +294,36 @@ Status BinaryPlainBlockDecoder::HandleBatch(size_t* n, ColumnDataView* dst, Cell
 }
 
 Status BinaryPlainBlockDecoder::CopyNextValues(size_t* n, ColumnDataView* dst) {
-  return HandleBatch(n, dst, [&](size_t i, Slice elem, Slice* out, Arena* out_arena) {
-    CHECK(out_arena->RelocateSlice(elem, out));
-  });
+  DCHECK(parsed_);
+  CHECK_EQ(dst->type_info()->physical_type(), BINARY);
+  DCHECK_LE(*n, dst->nrows());
+  DCHECK_EQ(dst->stride(), sizeof(Slice));
+  if (PREDICT_FALSE(*n == 0 || cur_idx_ >= num_elems_)) {
+    *n = 0;
+    return Status::OK();
+  }
+  size_t max_fetch = std::min(*n, static_cast<size_t>(num_elems_ - cur_idx_));
+
+  // The strings for consecutive rows are laid out contiguously in the block,
+  // so rather than relocating each cell separately we copy the whole run with
+  // a single arena allocation and point the output cells into it.
+  const uint32_t start = offsets_[cur_idx_];
+  const uint32_t total = offsets_[cur_idx_ + max_fetch] - start;
+  uint8_t* buf = reinterpret_cast<uint8_t*>(dst->arena()->AllocateBytes(total));
+  CHECK(buf != nullptr || total == 0);
+  if (total > 0) {
+    memcpy(buf, &data_[start], total);
+  }
+
+  Slice* out = reinterpret_cast<Slice*>(dst->data());
+  for (size_t i = 0; i < max_fetch; i++, out++, cur_idx_++) {
+    const uint32_t offset = offsets_[cur_idx_];
+    *out = Slice(buf + (offset - start), offsets_[cur_idx_ + 1] - offset);
+  }
+  *n = max_fetch;
+  return Status::OK();
 }
+
 Status BinaryPlainBlockDecoder::CopyNextAndEval(size_t* n,
                                                 ColumnMaterializationContext* ctx,
                                                 SelectionVectorView* sel,
@@ -58,10 +58,25 @@ static const uint8_t *DecodeEntryLengths(
 // StringPrefixBlockBuilder encoding
 ////////////////////////////////////////////////////////////
 
+// Bounds of the restart interval derived from the block size.
+static const int kMinDerivedRestartInterval = 4;
+static const int kMaxDerivedRestartInterval = 16;
+
+// Bytes of block per value between restart points when deriving the
+// restart interval: 256KB blocks and larger get the longest interval.
+static const size_t kBlockBytesPerRestartIntervalUnit = 16 * 1024;
+
+int BinaryPrefixBlockBuilder::RestartIntervalForBlockSize(size_t block_size) {
+  int interval = block_size / kBlockBytesPerRestartIntervalUnit;
+  return std::max(kMinDerivedRestartInterval,
+                  std::min(kMaxDerivedRestartInterval, interval));
+}
+
 BinaryPrefixBlockBuilder::BinaryPrefixBlockBuilder(const WriterOptions *options)
   : val_count_(0),
     vals_since_restart_(0),
     finished_(false),
+    restart_interval_(0),
     options_(options) {
   Reset();
 }
@@ -70,6 +85,9 @@ void BinaryPrefixBlockBuilder::Reset() {
   finished_ = false;
   val_count_ = 0;
   vals_since_restart_ = 0;
+  restart_interval_ = options_->block_restart_interval > 0 ?
+      options_->block_restart_interval :
+      RestartIntervalForBlockSize(options_->storage_attributes.cfile_block_size);
 
   buffer_.clear();
   buffer_.resize(kHeaderReservedLength);
@@ -91,7 +109,7 @@ Slice BinaryPrefixBlockBuilder::Finish(rowid_t ordinal_pos) {
   faststring header(kHeaderReservedLength);
 
   AppendGroupVarInt32(&header, val_count_, ordinal_pos,
-                      options_->block_restart_interval, 0);
+                      restart_interval_, 0);
 
   int header_encoded_len = header.size();
 
@@ -125,7 +143,7 @@ Slice BinaryPrefixBlockBuilder::Finish(rowid_t ordinal_pos) {
 int BinaryPrefixBlockBuilder::Add(const uint8_t *vals, size_t count) {
   DCHECK_GT(count, 0);
   DCHECK(!finished_);
-  DCHECK_LE(vals_since_restart_, options_->block_restart_interval);
+  DCHECK_LE(vals_since_restart_, restart_interval_);
 
   int added = 0;
   const Slice* slices = reinterpret_cast<const Slice*>(vals);
@@ -141,7 +159,7 @@ int BinaryPrefixBlockBuilder::Add(const uint8_t *vals, size_t count) {
     uint8_t* dst_p = &buffer_[old_size];
 
     size_t shared = 0;
-    if (vals_since_restart_ < options_->block_restart_interval) {
+    if (vals_since_restart_ < restart_interval_) {
       // See how much sharing to do with previous string
       shared = CommonPrefixLength(prev_val, val);
     } else {
@@ -266,6 +284,10 @@ Status BinaryPrefixBlockDecoder::ParseHeader() {
                    num_restarts_, static_cast<int>(data_.size())));
   }
 
+  if (PREDICT_FALSE(num_elems_ > 0 && restart_interval_ == 0)) {
+    return Status::Corruption("string block has a zero restart interval");
+  }
+
   // TODO: check relationship between num_elems, num_restarts_,
   // and restart_interval_
 
@@ -273,6 +295,7 @@ Status BinaryPrefixBlockDecoder::ParseHeader() {
     data_.data() + data_.size()
     - sizeof(uint32_t) // rewind before the restart length
     - restarts_size);
+  restart_keys_.clear();
 
   SeekToStart();
   parsed_ = true;
@@ -328,6 +351,30 @@ void BinaryPrefixBlockDecoder::SeekToRestartPoint(uint32_t idx) {
   CHECK_OK(ParseNextValue()); // TODO: handle corrupted blocks
 }
 
+// Note: see GetRestartPoint() for 'idx' semantics
+Status BinaryPrefixBlockDecoder::GetRestartKey(uint32_t idx, Slice *key) {
+  DCHECK_LE(idx, num_restarts_);
+  if (PREDICT_FALSE(restart_keys_.empty())) {
+    restart_keys_.resize(num_restarts_ + 1,
+                         Slice(static_cast<const uint8_t *>(nullptr), 0));
+  }
+  Slice *cached = &restart_keys_[idx];
+  if (cached->data() == nullptr) {
+    const uint8_t *entry = GetRestartPoint(idx);
+    uint32_t shared, non_shared;
+    const uint8_t *key_ptr = DecodeEntryLengths(entry, &shared, &non_shared);
+    if (key_ptr == nullptr || (shared != 0)) {
+      string err =
+        StringPrintf("bad entry restart=%d shared=%d\n", idx, shared) +
+        HexDump(Slice(entry, 16));
+      return Status::Corruption(err);
+    }
+    *cached = Slice(key_ptr, non_shared);
+  }
+  *key = *cached;
+  return Status::OK();
+}
+
 Status BinaryPrefixBlockDecoder::SeekAtOrAfterValue(const void *value_void,
                                               bool *exact_match) {
   DCHECK(value_void != nullptr);
@@ -335,21 +382,14 @@ Status BinaryPrefixBlockDecoder::SeekAtOrAfterValue(const void *value_void,
   const Slice &target = *reinterpret_cast<const Slice *>(value_void);
 
   // Binary search in restart array to find the first restart point
-  // with a key >= target
+  // with a key >= target. The restart keys are kept across seeks, so
+  // repeated lookups in the same block skip decoding them again.
   int32_t left = 0;
   int32_t right = num_restarts_;
   while (left < right) {
     uint32_t mid = (left + right + 1) / 2;
-    const uint8_t *entry = GetRestartPoint(mid);
-    uint32_t shared, non_shared;
-    const uint8_t *key_ptr = DecodeEntryLengths(entry, &shared, &non_shared);
-    if (key_ptr == nullptr || (shared != 0)) {
-      string err =
-        StringPrintf("bad entry restart=%d shared=%d\n", mid, shared) +
-        HexDump(Slice(entry, 16));
-      return Status::Corruption(err);
-    }
-    Slice mid_key(key_ptr, non_shared);
+    Slice mid_key;
+    RETURN_NOT_OK(GetRestartKey(mid, &mid_key));
     if (mid_key.compare(target) < 0) {
       // Key at "mid" is smaller than "target".  Therefore all
       // blocks before "mid" are uninteresting.
@@ -362,7 +402,14 @@ Status BinaryPrefixBlockDecoder::SeekAtOrAfterValue(const void *value_void,
   }
 
   // Linear search (within restart block) for first key >= target
-  SeekToRestartPoint(left);
+  if (PREDICT_FALSE(num_elems_ == 0)) {
+    return Status::NotFound("no keys in empty block");
+  }
+  Slice restart_key;
+  RETURN_NOT_OK(GetRestartKey(left, &restart_key));
+  cur_val_.assign_copy(restart_key.data(), restart_key.size());
+  next_ptr_ = restart_key.data() + restart_key.size();
+  cur_idx_ = left * restart_interval_;
 
   while (true) {
 #ifndef NDEBUG
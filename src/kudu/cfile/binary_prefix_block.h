@@ -56,6 +56,12 @@ class BinaryPrefixBlockBuilder : public BlockBuilder {
   // key should be a Slice *
   Status GetFirstKey(void *key) const OVERRIDE;
 
+  // Return the number of values between restart points to use for blocks
+  // of 'block_size' bytes, when the writer options leave it unset (<= 0).
+  // Smaller blocks, which are typically chosen for point lookups, get
+  // denser restart points so that a seek replays fewer prefix deltas.
+  static int RestartIntervalForBlockSize(size_t block_size);
+
   // Return the last added key.
   // key should be a Slice *
   Status GetLastKey(void *key) const OVERRIDE;
@@ -71,6 +77,9 @@ class BinaryPrefixBlockBuilder : public BlockBuilder {
   int vals_since_restart_;
   bool finished_;
 
+  // The number of values between restart points, as written to the header.
+  int restart_interval_;
+
   const WriterOptions *options_;
 
   // Maximum length of a header.
@@ -129,6 +138,11 @@ class BinaryPrefixBlockDecoder : public BlockDecoder {
   const uint8_t *GetRestartPoint(uint32_t idx) const;
   void SeekToRestartPoint(uint32_t idx);
 
+  // Set 'key' to the full key stored at restart point 'idx' (see
+  // GetRestartPoint() for 'idx' semantics), decoding it only the first
+  // time it is needed.
+  Status GetRestartKey(uint32_t idx, Slice *key);
+
   void SeekToStart();
 
   Slice data_;
@@ -144,6 +158,12 @@ class BinaryPrefixBlockDecoder : public BlockDecoder {
 
   const uint8_t *data_start_;
 
+  // The keys of the restart points decoded so far by seeks, pointing into
+  // data_, indexed like GetRestartPoint(). Entries not yet decoded have a
+  // NULL data pointer. Sized lazily by the first seek by value, so that
+  // blocks which are only scanned don't pay for it.
+  std::vector<Slice> restart_keys_;
+
   // Index of the next row to be returned by CopyNextValues, relative to
   // the block's base offset.
   // When the block is exhausted, cur_idx_ == num_elems_
@@ -19,7 +19,9 @@
 
 #include "kudu/cfile/block_cache.h"
 #include "kudu/util/cache.h"
+#include "kudu/util/env.h"
 #include "kudu/util/slice.h"
+#include "kudu/util/test_util.h"
 
 namespace kudu {
 namespace cfile {
@@ -60,6 +62,89 @@ TEST(TestBlockCache, TestBasics) {
   ASSERT_FALSE(cache.Lookup(key1, Cache::EXPECT_IN_CACHE, &retrieved_handle));
 }
 
+TEST(TestBlockCache, TestCompressedTier) {
+  size_t data_size = strlen(DATA_TO_CACHE) + 1;
+  BlockCache cache(512 * 1024 * 1024, 512 * 1024 * 1024);
+  ASSERT_TRUE(cache.has_compressed_tier());
+  BlockCache::CacheKey key(BlockCache::FileId(1234), 1);
+
+  BlockCache::PendingEntry data = cache.Allocate(key, data_size, BlockCache::COMPRESSED);
+  memcpy(data.val_ptr(), DATA_TO_CACHE, data_size);
+  BlockCacheHandle inserted_handle;
+  cache.Insert(&data, &inserted_handle);
+
+  // The entry is only visible in the tier it was inserted into.
+  BlockCacheHandle retrieved_handle;
+  ASSERT_FALSE(cache.Lookup(key, Cache::EXPECT_IN_CACHE, &retrieved_handle));
+  ASSERT_TRUE(cache.Lookup(key, Cache::EXPECT_IN_CACHE, &retrieved_handle,
+                           BlockCache::COMPRESSED));
+  ASSERT_EQ(0, memcmp(retrieved_handle.data().data(), DATA_TO_CACHE, data_size));
+}
+
+class BlockCacheSaveTest : public KuduTest {
+ protected:
+  static void InsertBlock(BlockCache* cache, const BlockCache::CacheKey& key,
+                          BlockCache::Tier tier) {
+    size_t data_size = strlen(DATA_TO_CACHE) + 1;
+    BlockCache::PendingEntry data = cache->Allocate(key, data_size, tier);
+    memcpy(data.val_ptr(), DATA_TO_CACHE, data_size);
+    BlockCacheHandle handle;
+    cache->Insert(&data, &handle);
+  }
+};
+
+TEST_F(BlockCacheSaveTest, TestSaveAndLoad) {
+  const string path = GetTestPath("saved_cache");
+  BlockCache::CacheKey key1(BlockCache::FileId(1234), 1);
+  BlockCache::CacheKey key2(BlockCache::FileId(1234), 2);
+  {
+    BlockCache cache(512 * 1024 * 1024, 512 * 1024 * 1024);
+    InsertBlock(&cache, key1, BlockCache::DECOMPRESSED);
+    InsertBlock(&cache, key2, BlockCache::COMPRESSED);
+    ASSERT_OK(cache.SaveToFile(env_.get(), path));
+  }
+
+  // Each block comes back in the tier it was saved from.
+  BlockCache cache(512 * 1024 * 1024, 512 * 1024 * 1024);
+  int64_t num_loaded;
+  ASSERT_OK(cache.LoadFromFile(env_.get(), path, &num_loaded));
+  ASSERT_EQ(2, num_loaded);
+  BlockCacheHandle handle;
+  ASSERT_TRUE(cache.Lookup(key1, Cache::EXPECT_IN_CACHE, &handle));
+  ASSERT_STREQ(DATA_TO_CACHE, reinterpret_cast<const char*>(handle.data().data()));
+  ASSERT_FALSE(cache.Lookup(key2, Cache::EXPECT_IN_CACHE, &handle));
+  ASSERT_TRUE(cache.Lookup(key2, Cache::EXPECT_IN_CACHE, &handle, BlockCache::COMPRESSED));
+  ASSERT_STREQ(DATA_TO_CACHE, reinterpret_cast<const char*>(handle.data().data()));
+
+  // A cache without a compressed tier skips compressed blocks.
+  BlockCache uncompressed_cache(512 * 1024 * 1024);
+  ASSERT_OK(uncompressed_cache.LoadFromFile(env_.get(), path, &num_loaded));
+  ASSERT_EQ(1, num_loaded);
+}
+
+TEST_F(BlockCacheSaveTest, TestLoadCorruptFile) {
+  const string path = GetTestPath("saved_cache");
+  BlockCache::CacheKey key(BlockCache::FileId(1234), 1);
+  {
+    BlockCache cache(512 * 1024 * 1024);
+    InsertBlock(&cache, key, BlockCache::DECOMPRESSED);
+    ASSERT_OK(cache.SaveToFile(env_.get(), path));
+  }
+
+  // Flip the last byte of the saved block.
+  faststring contents;
+  ASSERT_OK(ReadFileToString(env_.get(), path, &contents));
+  contents.data()[contents.size() - 1] ^= 0xff;
+  ASSERT_OK(WriteStringToFile(env_.get(), Slice(contents), path));
+
+  BlockCache cache(512 * 1024 * 1024);
+  int64_t num_loaded;
+  Status s = cache.LoadFromFile(env_.get(), path, &num_loaded);
+  ASSERT_TRUE(s.IsCorruption()) << s.ToString();
+  ASSERT_EQ(0, num_loaded);
+  BlockCacheHandle handle;
+  ASSERT_FALSE(cache.Lookup(key, Cache::EXPECT_IN_CACHE, &handle));
+}
 
 } // namespace cfile
 } // namespace kudu
@@ -16,10 +16,17 @@
 // under the License.
 
 #include <gflags/gflags.h>
+#include <string>
 
 #include "kudu/cfile/block_cache.h"
 #include "kudu/gutil/port.h"
+#include "kudu/gutil/strings/substitute.h"
 #include "kudu/util/cache.h"
+#include "kudu/util/coding.h"
+#include "kudu/util/crc.h"
+#include "kudu/util/env.h"
+#include "kudu/util/env_util.h"
+#include "kudu/util/faststring.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/metrics.h"
 #include "kudu/util/slice.h"
@@ -28,6 +35,15 @@
 DEFINE_int64(block_cache_capacity_mb, 512, "block cache capacity in MB");
 TAG_FLAG(block_cache_capacity_mb, stable);
 
+DEFINE_int64(block_cache_compressed_capacity_mb, 0,
+             "Capacity in MB of a separate block cache tier which holds blocks of "
+             "compressed CFiles in their compressed form. A block which is missing "
+             "from the regular block cache is then decompressed from this tier "
+             "instead of being read from disk. Since compressed blocks are "
+             "typically several times smaller, this lets a given amount of memory "
+             "cache more data. 0 disables the compressed tier.");
+TAG_FLAG(block_cache_compressed_capacity_mb, experimental);
+
 DEFINE_string(block_cache_type, "DRAM",
               "Which type of block cache to use for caching data. "
               "Valid choices are 'DRAM' or 'NVM'. DRAM, the default, "
@@ -35,6 +51,17 @@ DEFINE_string(block_cache_type, "DRAM",
               "in a memory-mapped file using the NVML library.");
 TAG_FLAG(block_cache_type, experimental);
 
+DEFINE_string(block_cache_eviction_policy, "LRU",
+              "Which eviction policy the block cache uses. Valid choices are "
+              "'LRU', 'SLRU' or 'CLOCK'. 'SLRU', a segmented LRU, keeps blocks "
+              "which were read more than once from being evicted by large scans. "
+              "'CLOCK' approximates LRU with cache hits that do not contend on a "
+              "lock. Only 'LRU' is supported by the NVM block cache.");
+TAG_FLAG(block_cache_eviction_policy, experimental);
+
+using std::string;
+using std::vector;
+
 namespace kudu {
 
 class MetricEntity;
@@ -43,7 +70,7 @@ namespace cfile {
 
 namespace {
 
-Cache* CreateCache(int64_t capacity) {
+Cache* CreateCache(int64_t capacity, const std::string& id) {
   CacheType t;
   ToUpperCase(FLAGS_block_cache_type, &FLAGS_block_cache_type);
   if (FLAGS_block_cache_type == "NVM") {
@@ -54,44 +81,198 @@ Cache* CreateCache(int64_t capacity) {
     LOG(FATAL) << "Unknown block cache type: '" << FLAGS_block_cache_type
                << "' (expected 'DRAM' or 'NVM')";
   }
-  return NewLRUCache(t, capacity, "block_cache");
+
+  CacheEvictionPolicy policy;
+  ToUpperCase(FLAGS_block_cache_eviction_policy, &FLAGS_block_cache_eviction_policy);
+  if (FLAGS_block_cache_eviction_policy == "LRU") {
+    policy = LRU_POLICY;
+  } else if (FLAGS_block_cache_eviction_policy == "SLRU") {
+    policy = SLRU_POLICY;
+  } else if (FLAGS_block_cache_eviction_policy == "CLOCK") {
+    policy = CLOCK_POLICY;
+  } else {
+    LOG(FATAL) << "Unknown block cache eviction policy: '"
+               << FLAGS_block_cache_eviction_policy << "' (expected 'LRU', 'SLRU' or 'CLOCK')";
+  }
+  if (t == NVM_CACHE && policy != LRU_POLICY) {
+    LOG(FATAL) << "The NVM block cache only supports the 'LRU' eviction policy";
+  }
+  return NewLRUCache(t, capacity, id, policy);
 }
 
+// Layout of a file written by BlockCache::SaveToFile():
+//
+//   <magic> <format version: fixed32>
+//   <entry>*
+//
+// where each entry is:
+//
+//   <tier: 1 byte> <CacheKey> <value length: fixed32> <header crc32c: fixed32>
+//   <value crc32c: fixed32> <value>
+//
+// The header crc32c covers the tier, key, and value length.
+const char kSavedCacheMagic[] = "kudublkc";
+const uint32_t kSavedCacheVersion = 1;
+const size_t kSavedCacheMagicSize = sizeof(kSavedCacheMagic) - 1;
+const size_t kSavedEntryHeaderSize = 1 + sizeof(BlockCache::CacheKey) + sizeof(uint32_t);
+
 } // anonymous namespace
 
 BlockCache::BlockCache()
-  : BlockCache(FLAGS_block_cache_capacity_mb * 1024 * 1024) {
+  : BlockCache(FLAGS_block_cache_capacity_mb * 1024 * 1024,
+               FLAGS_block_cache_compressed_capacity_mb * 1024 * 1024) {
 }
 
-BlockCache::BlockCache(size_t capacity)
-  : cache_(CreateCache(capacity)) {
+BlockCache::BlockCache(size_t capacity, size_t compressed_capacity)
+  : cache_(CreateCache(capacity, "block_cache")) {
+  if (compressed_capacity > 0) {
+    compressed_cache_.reset(CreateCache(compressed_capacity, "compressed_block_cache"));
+  }
 }
 
-BlockCache::PendingEntry BlockCache::Allocate(const CacheKey& key, size_t val_size) {
+BlockCache::PendingEntry BlockCache::Allocate(const CacheKey& key, size_t val_size,
+                                              Tier tier) {
   Slice key_slice(reinterpret_cast<const uint8_t*>(&key), sizeof(key));
   int charge = val_size;
-  return PendingEntry(cache_.get(), cache_->Allocate(key_slice, val_size, charge));
+  Cache* cache = cache_for_tier(tier);
+  return PendingEntry(cache, cache->Allocate(key_slice, val_size, charge));
 }
 
 bool BlockCache::Lookup(const CacheKey& key, Cache::CacheBehavior behavior,
-                        BlockCacheHandle *handle) {
-  Cache::Handle *h = cache_->Lookup(Slice(reinterpret_cast<const uint8_t*>(&key),
-                                          sizeof(key)), behavior);
+                        BlockCacheHandle *handle, Tier tier) {
+  Cache* cache = cache_for_tier(tier);
+  Cache::Handle *h = cache->Lookup(Slice(reinterpret_cast<const uint8_t*>(&key),
+                                         sizeof(key)), behavior);
   if (h != nullptr) {
-    handle->SetHandle(cache_.get(), h);
+    handle->SetHandle(cache, h);
   }
   return h != nullptr;
 }
 
 void BlockCache::Insert(BlockCache::PendingEntry* entry, BlockCacheHandle* inserted) {
-  Cache::Handle *h = cache_->Insert(entry->handle_, /* eviction_callback= */ nullptr);
+  Cache::Handle *h = entry->cache_->Insert(entry->handle_, /* eviction_callback= */ nullptr);
   entry->handle_ = nullptr;
-  inserted->SetHandle(cache_.get(), h);
+  inserted->SetHandle(entry->cache_, h);
 }
 
 void BlockCache::StartInstrumentation(const scoped_refptr<MetricEntity>& metric_entity) {
   cache_->SetMetrics(metric_entity);
 }
 
+Status BlockCache::SaveToFile(Env* env, const string& path) {
+  const string tmp_path = path + ".tmp";
+  gscoped_ptr<WritableFile> file;
+  RETURN_NOT_OK(env->NewWritableFile(tmp_path, &file));
+
+  faststring buf;
+  buf.append(kSavedCacheMagic, kSavedCacheMagicSize);
+  PutFixed32(&buf, kSavedCacheVersion);
+  Status s = file->Append(buf);
+
+  for (Tier tier : { COMPRESSED, DECOMPRESSED }) {
+    if (tier == COMPRESSED && !has_compressed_tier()) {
+      continue;
+    }
+    // Entries are saved in eviction order, so that loading them back in the
+    // same order approximately preserves their recency.
+    Cache* cache = cache_for_tier(tier);
+    vector<Cache::Handle*> handles;
+    cache->GetAllEntries(&handles);
+    for (Cache::Handle* h : handles) {
+      if (s.ok()) {
+        Slice key = cache->Key(h);
+        Slice value = cache->Value(h);
+        DCHECK_EQ(sizeof(CacheKey), key.size());
+        buf.clear();
+        buf.push_back(static_cast<uint8_t>(tier));
+        buf.append(key.data(), key.size());
+        PutFixed32(&buf, value.size());
+        PutFixed32(&buf, crc::Crc32c(buf.data(), buf.size()));
+        PutFixed32(&buf, crc::Crc32c(value.data(), value.size()));
+        s = file->AppendVector({ Slice(buf), value });
+      }
+      cache->Release(h);
+    }
+  }
+  RETURN_NOT_OK_PREPEND(s, "Unable to write block cache contents");
+  RETURN_NOT_OK(file->Sync());
+  RETURN_NOT_OK(file->Close());
+  return env->RenameFile(tmp_path, path);
+}
+
+Status BlockCache::LoadFromFile(Env* env, const string& path, int64_t* num_loaded) {
+  *num_loaded = 0;
+  gscoped_ptr<RandomAccessFile> file;
+  RETURN_NOT_OK(env->NewRandomAccessFile(path, &file));
+  uint64_t file_size;
+  RETURN_NOT_OK(file->Size(&file_size));
+
+  uint8_t header[kSavedCacheMagicSize + sizeof(uint32_t)];
+  if (file_size < sizeof(header)) {
+    return Status::Corruption("Saved block cache file is too short", path);
+  }
+  Slice slice;
+  RETURN_NOT_OK(env_util::ReadFully(file.get(), 0, sizeof(header), &slice, header));
+  if (memcmp(slice.data(), kSavedCacheMagic, kSavedCacheMagicSize) != 0) {
+    return Status::Corruption("Bad magic in saved block cache file", path);
+  }
+  uint32_t version = DecodeFixed32(slice.data() + kSavedCacheMagicSize);
+  if (version != kSavedCacheVersion) {
+    return Status::NotSupported(
+        strings::Substitute("Unsupported saved block cache format version $0", version),
+        path);
+  }
+
+  uint64_t offset = sizeof(header);
+  uint8_t entry_header[kSavedEntryHeaderSize + 2 * sizeof(uint32_t)];
+  while (offset < file_size) {
+    if (file_size - offset < sizeof(entry_header)) {
+      return Status::Corruption("Truncated entry in saved block cache file", path);
+    }
+    RETURN_NOT_OK(env_util::ReadFully(file.get(), offset, sizeof(entry_header),
+                                      &slice, entry_header));
+    offset += sizeof(entry_header);
+    const uint8_t* p = slice.data();
+    if (crc::Crc32c(p, kSavedEntryHeaderSize) !=
+        DecodeFixed32(p + kSavedEntryHeaderSize)) {
+      return Status::Corruption("Entry header checksum mismatch in saved block cache file",
+                                path);
+    }
+    Tier tier = static_cast<Tier>(p[0]);
+    CacheKey key(BlockId(0), 0);
+    memcpy(&key, p + 1, sizeof(key));
+    uint32_t value_size = DecodeFixed32(p + 1 + sizeof(key));
+    uint32_t value_crc = DecodeFixed32(p + kSavedEntryHeaderSize + sizeof(uint32_t));
+    if (tier != COMPRESSED && tier != DECOMPRESSED) {
+      return Status::Corruption("Bad tier in saved block cache file", path);
+    }
+    if (file_size - offset < value_size) {
+      return Status::Corruption("Truncated entry in saved block cache file", path);
+    }
+
+    // The compressed tier may have been disabled since the file was saved.
+    if (tier == COMPRESSED && !has_compressed_tier()) {
+      offset += value_size;
+      continue;
+    }
+    PendingEntry entry = Allocate(key, value_size, tier);
+    if (!entry.valid()) {
+      // The cache is full.
+      break;
+    }
+    RETURN_NOT_OK(env_util::ReadFully(file.get(), offset, value_size, &slice,
+                                      entry.val_ptr()));
+    offset += value_size;
+    slice.relocate(entry.val_ptr());
+    if (crc::Crc32c(entry.val_ptr(), value_size) != value_crc) {
+      return Status::Corruption("Block checksum mismatch in saved block cache file", path);
+    }
+    BlockCacheHandle inserted;
+    Insert(&entry, &inserted);
+    (*num_loaded)++;
+  }
+  return Status::OK();
+}
+
 } // namespace cfile
 } // namespace kudu
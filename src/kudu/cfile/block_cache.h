@@ -19,17 +19,20 @@
 
 #include <algorithm>
 #include <glog/logging.h>
+#include <string>
 
 #include "kudu/fs/block_id.h"
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/macros.h"
 #include "kudu/gutil/singleton.h"
 #include "kudu/util/cache.h"
+#include "kudu/util/status.h"
 
 DECLARE_string(block_cache_type);
 
 namespace kudu {
 
+class Env;
 class MetricRegistry;
 
 namespace cfile {
@@ -45,6 +48,22 @@ class BlockCache {
   // which is just a portion of a CFile.
   typedef BlockId FileId;
 
+  // The tiers of the block cache.
+  //
+  // By default, only the DECOMPRESSED tier exists. If
+  // --block_cache_compressed_capacity_mb is set, blocks of compressed CFiles
+  // are additionally kept in their on-disk form in the COMPRESSED tier, so
+  // that a miss in the DECOMPRESSED tier only costs a decompression rather
+  // than a disk read. Each tier has its own capacity and MemTracker. Only the
+  // DECOMPRESSED tier reports block cache metrics.
+  enum Tier {
+    // Blocks as they are used by readers, i.e. after any decompression.
+    DECOMPRESSED,
+
+    // Blocks of compressed CFiles, as they were read from disk.
+    COMPRESSED
+  };
+
   // The unique key identifying entries in the block cache.
   // Each cached block corresponds to a specific offset within
   // a file (called a "block" in other parts of Kudu).
@@ -109,9 +128,16 @@ class BlockCache {
     return Singleton<BlockCache>::get();
   }
 
-  explicit BlockCache(size_t capacity);
+  // Creates a block cache whose COMPRESSED tier holds 'compressed_capacity'
+  // bytes. If 'compressed_capacity' is 0, there is no COMPRESSED tier.
+  explicit BlockCache(size_t capacity, size_t compressed_capacity = 0);
 
-  // Lookup the given block in the cache.
+  // Return true if this cache has a COMPRESSED tier.
+  bool has_compressed_tier() const {
+    return compressed_cache_ != nullptr;
+  }
+
+  // Lookup the given block in the given tier of the cache.
   //
   // If the entry is found, then sets *handle to refer to the entry.
   // This object's destructor will release the cache entry so it may be freed again.
@@ -119,7 +145,7 @@ class BlockCache {
   //
   // Returns true to indicate that the entry was found, false otherwise.
   bool Lookup(const CacheKey& key, Cache::CacheBehavior behavior,
-              BlockCacheHandle* handle);
+              BlockCacheHandle* handle, Tier tier = DECOMPRESSED);
 
   // Pass a metric entity to the cache to start recording metrics.
   // This should be called before the block cache starts serving blocks.
@@ -145,20 +171,49 @@ class BlockCache {
   //   BlockCacheHandle bch;
   //   cache->Insert(&entry, &bch);
 
-  // Allocate a new entry to be inserted into the cache.
-  PendingEntry Allocate(const CacheKey& key, size_t block_size);
+  // Allocate a new entry to be inserted into the given tier of the cache.
+  // The COMPRESSED tier may only be used if has_compressed_tier() is true.
+  PendingEntry Allocate(const CacheKey& key, size_t block_size,
+                        Tier tier = DECOMPRESSED);
 
-  // Insert the given block into the cache. 'inserted' is set to refer to the
-  // entry in the cache.
+  // Insert the given block into the tier it was allocated from. 'inserted' is
+  // set to refer to the entry in the cache.
   void Insert(PendingEntry* entry, BlockCacheHandle* inserted);
 
+  // Warm restart
+  // --------------------
+  // A process which is restarted can avoid starting with a cold cache by saving
+  // the cache's contents to a file when it shuts down and loading them back
+  // when it starts. Since blocks are immutable and their IDs are never reused,
+  // a saved block is still valid after a restart; blocks which were deleted in
+  // the meantime are never looked up and age out of the cache.
+
+  // Write every block in the cache to 'path', replacing it atomically.
+  Status SaveToFile(Env* env, const std::string& path);
+
+  // Insert every block saved in 'path' by SaveToFile() into the cache. Stops at
+  // the first entry which fails validation, keeping the blocks loaded so far.
+  // Sets '*num_loaded' to the number of blocks which were loaded.
+  Status LoadFromFile(Env* env, const std::string& path, int64_t* num_loaded);
+
  private:
   friend class Singleton<BlockCache>;
   BlockCache();
 
   DISALLOW_COPY_AND_ASSIGN(BlockCache);
 
+  Cache* cache_for_tier(Tier tier) const {
+    if (tier == COMPRESSED) {
+      return DCHECK_NOTNULL(compressed_cache_.get());
+    }
+    return cache_.get();
+  }
+
+  // The DECOMPRESSED tier.
   gscoped_ptr<Cache> cache_;
+
+  // The COMPRESSED tier, or NULL if it is disabled.
+  gscoped_ptr<Cache> compressed_cache_;
 };
 
 // Scoped reference to a block from the block cache.
@@ -18,6 +18,9 @@
 #ifndef KUDU_CFILE_BLOCK_HANDLE_H
 #define KUDU_CFILE_BLOCK_HANDLE_H
 
+#include <memory>
+#include <utility>
+
 #include "kudu/cfile/block_cache.h"
 
 namespace kudu {
@@ -27,7 +30,8 @@ namespace cfile {
 // When blocks are read, they are sometimes resident in the block cache, and sometimes skip the
 // block cache. In the case that they came from the cache, we just need to dereference them when
 // they stop being used. In the case that they didn't come from cache, we need to actually free
-// the underlying data.
+// the underlying data. Blocks read without a copy, e.g. from a memory mapping,
+// instead hold a pin which keeps the data valid.
 class BlockHandle {
  public:
   static BlockHandle WithOwnedData(const Slice& data) {
@@ -38,6 +42,10 @@ class BlockHandle {
     return BlockHandle(handle);
   }
 
+  static BlockHandle WithPinnedData(const Slice& data, std::shared_ptr<const void> pin) {
+    return BlockHandle(data, std::move(pin));
+  }
+
   // Constructor to use to Pass to.
   BlockHandle()
     : is_data_owner_(false) { }
@@ -56,7 +64,7 @@ class BlockHandle {
   }
 
   Slice data() const {
-    if (is_data_owner_) {
+    if (is_data_owner_ || pin_) {
       return data_;
     } else {
       return dblk_data_.data();
@@ -67,12 +75,19 @@ class BlockHandle {
   BlockCacheHandle dblk_data_;
   Slice data_;
   bool is_data_owner_;
+  std::shared_ptr<const void> pin_;
 
   explicit BlockHandle(Slice data)
       : data_(std::move(data)),
         is_data_owner_(true) {
   }
 
+  BlockHandle(Slice data, std::shared_ptr<const void> pin)
+      : data_(std::move(data)),
+        is_data_owner_(false),
+        pin_(std::move(pin)) {
+  }
+
   explicit BlockHandle(BlockCacheHandle *dblk_data)
     : is_data_owner_(false) {
     dblk_data_.swap(dblk_data);
@@ -85,9 +100,13 @@ class BlockHandle {
     if (is_data_owner_) {
       data_ = other->data_;
       other->is_data_owner_ = false;
-    } else {
-      dblk_data_.swap(&other->dblk_data_);
+    } else if (other->pin_) {
+      data_ = other->data_;
+      pin_ = std::move(other->pin_);
     }
+    // Always swap the cache handles, so that one this handle held before is
+    // released along with 'other' rather than lingering here.
+    dblk_data_.swap(&other->dblk_data_);
   }
 
   void Reset() {
@@ -95,6 +114,7 @@ class BlockHandle {
       delete [] data_.data();
       is_data_owner_ = false;
     }
+    pin_.reset();
     data_ = "";
   }
 
@@ -18,6 +18,8 @@
 #include "kudu/cfile/bloomfile-test-base.h"
 #include "kudu/fs/fs-test-util.h"
 
+DECLARE_bool(bloom_filter_split_block);
+
 using std::shared_ptr;
 
 namespace kudu {
@@ -66,6 +68,14 @@ TEST_F(BloomFileTest, TestWriteAndRead) {
   VerifyBloomFile();
 }
 
+// Bloom files written in the classic format must remain readable.
+TEST_F(BloomFileTest, TestWriteAndReadClassicFormat) {
+  FLAGS_bloom_filter_split_block = false;
+  ASSERT_NO_FATAL_FAILURE(WriteTestBloomFile());
+  ASSERT_OK(OpenBloomFile());
+  VerifyBloomFile();
+}
+
 #ifdef NDEBUG
 TEST_F(BloomFileTest, Benchmark) {
   ASSERT_NO_FATAL_FAILURE(WriteTestBloomFile());
@@ -25,12 +25,19 @@
 #include "kudu/gutil/stringprintf.h"
 #include "kudu/gutil/sysinfo.h"
 #include "kudu/util/coding.h"
+#include "kudu/util/flag_tags.h"
 #include "kudu/util/hexdump.h"
 #include "kudu/util/malloc.h"
 #include "kudu/util/pb_util.h"
 
 DECLARE_bool(cfile_lazy_open);
 
+DEFINE_bool(bloom_filter_split_block, true,
+            "Whether to write new bloom files using the split block bloom filter "
+            "format, in which checking a key touches a single cache line. Bloom "
+            "files in this format cannot be read by older versions of Kudu.");
+TAG_FLAG(bloom_filter_split_block, advanced);
+
 namespace kudu {
 namespace cfile {
 
@@ -44,7 +51,8 @@ using fs::WritableBlock;
 
 BloomFileWriter::BloomFileWriter(gscoped_ptr<WritableBlock> block,
                                  const BloomFilterSizing &sizing)
-  : bloom_builder_(sizing) {
+  : bloom_builder_(sizing, FLAGS_bloom_filter_split_block ?
+                   BloomFilterFormat::kSplitBlock : BloomFilterFormat::kClassic) {
   cfile::WriterOptions opts;
   opts.write_posidx = false;
   opts.write_validx = true;
@@ -111,6 +119,9 @@ Status BloomFileWriter::FinishCurrentBloomBlock() {
   // Encode the header.
   BloomBlockHeaderPB hdr;
   hdr.set_num_hash_functions(bloom_builder_.n_hashes());
+  if (bloom_builder_.format() == BloomFilterFormat::kSplitBlock) {
+    hdr.set_format(BloomBlockHeaderPB::SPLIT_BLOCK);
+  }
   faststring hdr_str;
   PutFixed32(&hdr_str, hdr.ByteSize());
   CHECK(pb_util::AppendToString(hdr, &hdr_str));
@@ -233,6 +244,12 @@ Status BloomFileReader::ParseBlockHeader(const Slice &block,
   }
 
   data.remove_prefix(header_len);
+  if (hdr->format() == BloomBlockHeaderPB::SPLIT_BLOCK &&
+      (data.empty() || data.size() % BloomFilter::kSplitBlockBucketBytes != 0)) {
+    return Status::Corruption(
+      StringPrintf("Split block bloom filter of size %ld is not a whole number of buckets",
+                   data.size()));
+  }
   *bloom_data = data;
   return Status::OK();
 }
@@ -282,7 +299,9 @@ Status BloomFileReader::CheckKeyPresent(const BloomKeyProbe &probe,
   RETURN_NOT_OK(ParseBlockHeader(dblk_data.data(), &hdr, &bloom_data));
 
   // Actually check the bloom filter.
-  BloomFilter bf(bloom_data, hdr.num_hash_functions());
+  BloomFilter bf(bloom_data, hdr.num_hash_functions(),
+                 hdr.format() == BloomBlockHeaderPB::SPLIT_BLOCK ?
+                 BloomFilterFormat::kSplitBlock : BloomFilterFormat::kClassic);
   *maybe_present = bf.MayContainKey(probe);
   return Status::OK();
 }
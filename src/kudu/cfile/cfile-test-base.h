@@ -213,6 +213,16 @@ class Int32DataGenerator : public DataGenerator<INT32, HAS_NULLS> {
   }
 };
 
+// Generates increasing timestamps, as commonly found in UNIXTIME_MICROS columns.
+template<bool HAS_NULLS>
+class Int64DataGenerator : public DataGenerator<INT64, HAS_NULLS> {
+ public:
+  Int64DataGenerator() {}
+  int64_t BuildTestValue(size_t block_index, size_t value) OVERRIDE {
+    return 1475000000000000L + value * 1000 + value % 7;
+  }
+};
+
 // Floating-point data generator.
 // This works for both floats and doubles.
 template<DataType DATA_TYPE, bool HAS_NULLS>
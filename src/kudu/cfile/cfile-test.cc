@@ -26,6 +26,7 @@
 #include "kudu/cfile/cfile.pb.h"
 #include "kudu/cfile/index_block.h"
 #include "kudu/cfile/index_btree.h"
+#include "kudu/common/column_predicate.h"
 #include "kudu/common/columnblock.h"
 #include "kudu/fs/fs-test-util.h"
 #include "kudu/gutil/gscoped_ptr.h"
@@ -36,6 +37,8 @@
 
 DECLARE_string(block_cache_type);
 DECLARE_string(cfile_do_on_finish);
+DECLARE_int32(cfile_dict_max_pages);
+DECLARE_int32(cfile_readahead_blocks);
 
 #if defined(__linux__)
 DECLARE_string(nvm_cache_path);
@@ -438,12 +441,135 @@ TEST_P(TestCFileBothCacheTypes, TestWrite1MDuplicateFileStringsDictEncoding) {
   }
 }
 
+// A dictionary that overflows starts a new page rather than giving up, and
+// predicates are evaluated against whichever page each block refers to.
+TEST_P(TestCFileBothCacheTypes, TestDictEncodingPages) {
+  FLAGS_cfile_dict_max_pages = 4;
+  const int kNumRows = 10000;
+  BlockId block_id;
+  StringDataGenerator<false> generator("hello %zu");
+  WriteTestFile(&generator, DICT_ENCODING, NO_COMPRESSION, kNumRows, SMALL_BLOCKSIZE,
+                &block_id);
+
+  gscoped_ptr<ReadableBlock> block;
+  ASSERT_OK(fs_manager_->OpenBlock(block_id, &block));
+  gscoped_ptr<CFileReader> reader;
+  ASSERT_OK(CFileReader::Open(std::move(block), ReaderOptions(), &reader));
+  ASSERT_TRUE(reader->footer().has_dict_block_ptr());
+  ASSERT_EQ(FLAGS_cfile_dict_max_pages - 1, reader->footer().extra_dict_block_ptrs_size());
+
+  size_t n;
+  TimeReadFile(fs_manager_.get(), block_id, &n);
+  ASSERT_EQ(kNumRows, n);
+
+  // Matches 1, 10-19, 100-199 and 1000-1999, which span every dictionary
+  // page as well as the plain encoded blocks after them.
+  Slice lower("hello 1");
+  Slice upper("hello 2");
+  ColumnSchema col("c", STRING);
+  ColumnPredicate pred = ColumnPredicate::Range(col, &lower, &upper);
+
+  gscoped_ptr<CFileIterator> iter;
+  ASSERT_OK(reader->NewIterator(&iter, CFileReader::CACHE_BLOCK));
+  ASSERT_OK(iter->SeekToFirst());
+  ScopedColumnBlock<STRING> cb(1000);
+  SelectionVector sel(cb.nrows());
+  ColumnMaterializationContext ctx(0, &pred, &cb, &sel);
+  size_t num_matched = 0;
+  while (iter->HasNext()) {
+    sel.SetAllTrue();
+    size_t nrows = cb.nrows();
+    ASSERT_OK_FAST(iter->CopyNextValues(&nrows, &ctx));
+    ASSERT_FALSE(ctx.DecoderEvalNotSupported());
+    for (size_t i = 0; i < nrows; i++) {
+      if (sel.IsRowSelected(i)) {
+        ASSERT_TRUE(cb[i].starts_with("hello 1")) << cb[i].ToString();
+        num_matched++;
+      }
+    }
+  }
+  ASSERT_EQ(1111, num_matched);
+}
+
 TEST_P(TestCFileBothCacheTypes, TestReadWriteUInt32) {
   for (auto enc : { PLAIN_ENCODING, RLE, GROUP_VARINT }) {
     TestReadWriteFixedSizeTypes<UInt32DataGenerator<false>>(enc);
   }
 }
 
+// Read-ahead must not change the values seen by sequential or seeking scans.
+TEST_P(TestCFileBothCacheTypes, TestReadahead) {
+  FLAGS_cfile_readahead_blocks = 4;
+  TestReadWriteFixedSizeTypes<UInt32DataGenerator<false>>(PLAIN_ENCODING);
+  TestReadWriteStrings(PLAIN_ENCODING);
+
+  BlockId block_id;
+  Int32DataGenerator<true> generator;
+  WriteTestFile(&generator, PLAIN_ENCODING, NO_COMPRESSION, 10000, SMALL_BLOCKSIZE, &block_id);
+  size_t n;
+  TimeReadFile(fs_manager_.get(), block_id, &n);
+  ASSERT_EQ(10000, n);
+  generator.Reset();
+  TimeSeekAndReadFileWithNulls(&generator, block_id, n);
+}
+
+// Runs of rows which are already deselected may be skipped rather than
+// decoded, without affecting the values of the rows which remain selected.
+TEST_P(TestCFileBothCacheTypes, TestSkipUnselectedRows) {
+  const int kNumRows = 10000;
+  for (auto enc : { PLAIN_ENCODING, RLE }) {
+    SCOPED_TRACE(enc);
+    BlockId block_id;
+    Int32DataGenerator<true> generator;
+    WriteTestFile(&generator, enc, NO_COMPRESSION, kNumRows, SMALL_BLOCKSIZE, &block_id);
+
+    gscoped_ptr<ReadableBlock> block;
+    ASSERT_OK(fs_manager_->OpenBlock(block_id, &block));
+    gscoped_ptr<CFileReader> reader;
+    ASSERT_OK(CFileReader::Open(std::move(block), ReaderOptions(), &reader));
+    gscoped_ptr<CFileIterator> iter;
+    ASSERT_OK(reader->NewIterator(&iter, CFileReader::CACHE_BLOCK));
+    ASSERT_OK(iter->SeekToFirst());
+
+    ScopedColumnBlock<INT32> cb(1000);
+    SelectionVector sel(cb.nrows());
+    ColumnMaterializationContext ctx(0, nullptr, &cb, &sel);
+    ctx.SetSkipUnselectedRows();
+    size_t read_offset = 0;
+    size_t num_selected = 0;
+    while (iter->HasNext()) {
+      size_t n = cb.nrows();
+      ASSERT_OK(iter->PrepareBatch(&n));
+      // Select rows in runs of 1500, which span several data blocks, and
+      // scatter a few lone selected rows through the deselected runs.
+      sel.Resize(n);
+      sel.SetAllFalse();
+      for (size_t j = 0; j < n; j++) {
+        size_t row = read_offset + j;
+        if ((row / 1500) % 2 == 0 || row % 977 == 0) {
+          BitmapSet(sel.mutable_bitmap(), j);
+        }
+      }
+      ASSERT_OK(iter->Scan(&ctx));
+      ASSERT_OK(iter->FinishBatch());
+
+      generator.Build(read_offset, n);
+      for (size_t j = 0; j < n; j++) {
+        if (!sel.IsRowSelected(j)) continue;
+        bool expected_null = generator.TestValueShouldBeNull(read_offset + j);
+        ASSERT_EQ(expected_null, cb.is_null(j)) << "row " << read_offset + j;
+        if (!expected_null) {
+          ASSERT_EQ(generator[j], cb[j]) << "row " << read_offset + j;
+        }
+        num_selected++;
+      }
+      read_offset += n;
+    }
+    ASSERT_EQ(kNumRows, read_offset);
+    ASSERT_GT(num_selected, 0);
+  }
+}
+
 TEST_P(TestCFileBothCacheTypes, TestReadWriteInt32) {
   for (auto enc : { PLAIN_ENCODING, RLE }) {
     TestReadWriteFixedSizeTypes<Int32DataGenerator<false>>(enc);
@@ -478,6 +604,40 @@ TYPED_TEST(BitShuffleTest, TestFixedSizeReadWriteBitShuffle) {
   this->TestBitShuffle();
 }
 
+// Test for the frame-of-reference builder for INT32 and INT64.
+template <typename T>
+class FrameOfReferenceTest : public TestCFile {
+  public:
+    void TestFrameOfReference() {
+      TestReadWriteFixedSizeTypes<T>(FRAME_OF_REFERENCE);
+    }
+};
+typedef ::testing::Types<Int32DataGenerator<false>,
+                         Int64DataGenerator<false> > ForTypes;
+TYPED_TEST_CASE(FrameOfReferenceTest, ForTypes);
+TYPED_TEST(FrameOfReferenceTest, TestFixedSizeReadWriteFrameOfReference) {
+  this->TestFrameOfReference();
+}
+
+// Test for the adaptive builder, which picks an encoding for each block.
+template <typename T>
+class AdaptiveEncodingTest : public TestCFile {
+  public:
+    void TestAdaptiveEncoding() {
+      TestReadWriteFixedSizeTypes<T>(ADAPTIVE_ENCODING);
+    }
+};
+typedef ::testing::Types<UInt8DataGenerator<false>,
+                         Int16DataGenerator<false>,
+                         UInt32DataGenerator<false>,
+                         Int32DataGenerator<false>,
+                         Int64DataGenerator<false>,
+                         FPDataGenerator<DOUBLE, false> > AdaptiveTypes;
+TYPED_TEST_CASE(AdaptiveEncodingTest, AdaptiveTypes);
+TYPED_TEST(AdaptiveEncodingTest, TestFixedSizeReadWriteAdaptive) {
+  this->TestAdaptiveEncoding();
+}
+
 void EncodeStringKey(const Schema &schema, const Slice& key,
                      gscoped_ptr<EncodedKey> *encoded_key) {
   EncodedKeyBuilder kb(&schema);
@@ -608,6 +768,10 @@ TEST_P(TestCFileBothCacheTypes, TestReadWriteStringsPrefixEncoding) {
   TestReadWriteStrings(PREFIX_ENCODING);
 }
 
+TEST_P(TestCFileBothCacheTypes, TestReadWriteStringsAdaptiveEncoding) {
+  TestReadWriteStrings(ADAPTIVE_ENCODING);
+}
+
 // Read/Write test for dictionary encoded blocks
 TEST_P(TestCFileBothCacheTypes, TestReadWriteStringsDictEncoding) {
   TestReadWriteStrings(DICT_ENCODING);
@@ -678,6 +842,76 @@ TEST_P(TestCFileBothCacheTypes, TestMetadata) {
   }
 }
 
+// Test that a zone map is written for each data block, and that the zone maps
+// allow ruling out row ranges which cannot match a predicate.
+TEST_P(TestCFileBothCacheTypes, TestZoneMaps) {
+  const int kNumRows = 10000;
+  BlockId block_id;
+
+  // Write a file where every seventh row is null, and other rows hold their
+  // ordinal.
+  {
+    gscoped_ptr<WritableBlock> sink;
+    ASSERT_OK(fs_manager_->CreateNewBlock(&sink));
+    block_id = sink->id();
+    WriterOptions opts;
+    opts.write_posidx = true;
+    opts.write_zone_maps = true;
+    opts.storage_attributes.cfile_block_size = 512;
+    CFileWriter w(opts, GetTypeInfo(INT32), true, std::move(sink));
+    ASSERT_OK(w.Start());
+
+    vector<int32_t> values(kNumRows);
+    vector<uint8_t> non_null(BitmapSize(kNumRows));
+    for (int i = 0; i < kNumRows; i++) {
+      values[i] = i;
+      BitmapChange(non_null.data(), i, i % 7 != 0);
+    }
+    ASSERT_OK(w.AppendNullableEntries(non_null.data(), values.data(), kNumRows));
+    ASSERT_OK(w.Finish());
+  }
+
+  gscoped_ptr<ReadableBlock> source;
+  ASSERT_OK(fs_manager_->OpenBlock(block_id, &source));
+  gscoped_ptr<CFileReader> reader;
+  ASSERT_OK(CFileReader::Open(std::move(source), ReaderOptions(), &reader));
+
+  // The zone maps should cover every row, in order.
+  const auto& zone_maps = reader->footer().zone_maps();
+  ASSERT_GT(zone_maps.size(), 1);
+  int64_t next_ordinal = 0;
+  for (const ZoneMapPB& zone_map : zone_maps) {
+    SCOPED_TRACE(zone_map.ShortDebugString());
+    ASSERT_EQ(next_ordinal, zone_map.first_ordinal());
+    ASSERT_GT(zone_map.null_count(), 0);
+    ASSERT_EQ(sizeof(int32_t), zone_map.min_value().size());
+    ASSERT_EQ(sizeof(int32_t), zone_map.max_value().size());
+    int32_t min;
+    int32_t max;
+    memcpy(&min, zone_map.min_value().data(), sizeof(min));
+    memcpy(&max, zone_map.max_value().data(), sizeof(max));
+    ASSERT_LE(min, max);
+    ASSERT_GE(min, zone_map.first_ordinal());
+    ASSERT_LT(max, zone_map.first_ordinal() + zone_map.num_rows());
+    next_ordinal += zone_map.num_rows();
+  }
+  ASSERT_EQ(kNumRows, next_ordinal);
+
+  ColumnSchema col("c", INT32, true);
+  int32_t lower = 5000;
+  int32_t upper = 5010;
+  ColumnPredicate range = ColumnPredicate::Range(col, &lower, &upper);
+  EXPECT_FALSE(reader->MayMatchPredicate(range, 0, 100));
+  EXPECT_TRUE(reader->MayMatchPredicate(range, 4950, 100));
+  EXPECT_TRUE(reader->MayMatchPredicate(range, 0, kNumRows));
+  EXPECT_FALSE(reader->MayMatchPredicate(range, 6000, kNumRows - 6000));
+
+  int32_t missing = kNumRows * 2;
+  ColumnPredicate equality = ColumnPredicate::Equality(col, &missing);
+  EXPECT_FALSE(reader->MayMatchPredicate(equality, 0, kNumRows));
+  EXPECT_TRUE(reader->MayMatchPredicate(ColumnPredicate::IsNotNull(col), 0, kNumRows));
+}
+
 TEST_P(TestCFileBothCacheTypes, TestDefaultColumnIter) {
   const int kNumItems = 64;
   uint8_t null_bitmap[BitmapSize(kNumItems)];
@@ -732,6 +966,7 @@ TEST_P(TestCFileBothCacheTypes, TestAppendRaw) {
   TestReadWriteRawBlocks(SNAPPY, 1000);
   TestReadWriteRawBlocks(LZ4, 1000);
   TestReadWriteRawBlocks(ZLIB, 1000);
+  TestReadWriteRawBlocks(ZSTD, 1000);
 }
 
 TEST_P(TestCFileBothCacheTypes, TestNullInts) {
@@ -880,6 +1115,55 @@ TEST_P(TestCFileBothCacheTypes, TestCacheKeysAreStable) {
   }
 }
 
+// Tests that the upper levels of a cfile's indexes are pinned in memory by
+// the reader, and released along with it.
+TEST_P(TestCFileBothCacheTypes, TestPinnedIndexBlocks) {
+  BlockId block_id;
+  {
+    const int nrows = 10000;
+    StringDataGenerator<false> generator("hello %04d");
+    WriteTestFile(&generator, PREFIX_ENCODING, NO_COMPRESSION, nrows,
+                  SMALL_BLOCKSIZE | WRITE_VALIDX, &block_id);
+  }
+
+  shared_ptr<MemTracker> tracker =
+      MemTracker::FindOrCreateTracker(-1, "cfile-pinned-index");
+  int64_t initial_pinned = tracker->consumption();
+
+  gscoped_ptr<ReadableBlock> source;
+  ASSERT_OK(fs_manager_->OpenBlock(block_id, &source));
+  gscoped_ptr<CFileReader> reader;
+  ASSERT_OK(CFileReader::Open(std::move(source), ReaderOptions(), &reader));
+  ASSERT_EQ(initial_pinned, tracker->consumption());
+
+  gscoped_ptr<IndexTreeIterator> iter;
+  iter.reset(IndexTreeIterator::Create(reader.get(), reader->validx_root()));
+  ASSERT_OK(iter->SeekAtOrBefore(Slice("hello 5000")));
+  int64_t pinned = tracker->consumption();
+  ASSERT_GT(pinned, initial_pinned);
+
+  // The root is pinned now, so further seeks don't pin any more of it, and
+  // seeks from other iterators don't read it again.
+  BlockHandle root;
+  ASSERT_TRUE(reader->LookupPinnedIndexBlock(reader->validx_root(), &root));
+  ASSERT_OK(iter->SeekAtOrBefore(Slice("hello 5001")));
+  ASSERT_EQ(pinned, tracker->consumption());
+  gscoped_ptr<IndexTreeIterator> iter2;
+  iter2.reset(IndexTreeIterator::Create(reader.get(), reader->validx_root()));
+  ASSERT_OK(iter2->SeekAtOrBefore(Slice("hello 5000")));
+  ASSERT_EQ(iter->GetCurrentBlockPointer().offset(),
+            iter2->GetCurrentBlockPointer().offset());
+  ASSERT_EQ(pinned, tracker->consumption());
+
+  // The pinned blocks are released once nothing refers to them.
+  iter.reset();
+  iter2.reset();
+  reader.reset();
+  ASSERT_EQ(pinned, tracker->consumption());
+  root = BlockHandle();
+  ASSERT_EQ(initial_pinned, tracker->consumption());
+}
+
 #if defined(__linux__)
 // Inject failures in nvm allocation and ensure that we can still read a file.
 TEST_P(TestCFileBothCacheTypes, TestNvmAllocationFailure) {
@@ -20,6 +20,8 @@
 #include <glog/logging.h>
 
 #include <algorithm>
+#include <memory>
+#include <mutex>
 
 #include "kudu/cfile/block_cache.h"
 #include "kudu/cfile/block_handle.h"
@@ -42,13 +44,41 @@
 #include "kudu/util/rle-encoding.h"
 #include "kudu/util/slice.h"
 #include "kudu/util/status.h"
+#include "kudu/util/threadpool.h"
 #include "kudu/util/trace.h"
 
 DEFINE_bool(cfile_lazy_open, true,
             "Allow lazily opening of cfiles");
 TAG_FLAG(cfile_lazy_open, hidden);
 
+DEFINE_int32(cfile_readahead_blocks, 0,
+             "Number of data blocks past the current position which sequential "
+             "CFile scans read into the block cache in the background. Only "
+             "applies to scans which cache the blocks they read. 0 disables "
+             "read-ahead.");
+TAG_FLAG(cfile_readahead_blocks, experimental);
+
+DEFINE_int32(cfile_readahead_threads, 8,
+             "Number of threads which perform CFile read-ahead. Takes effect "
+             "when read-ahead is first used.");
+TAG_FLAG(cfile_readahead_threads, experimental);
+
+DEFINE_bool(cfile_readahead_prefetch, true,
+            "Whether CFile read-ahead first asks the block's storage to fetch all "
+            "of the read-ahead blocks asynchronously. This keeps many reads in "
+            "flight to the device even when there are few read-ahead threads.");
+TAG_FLAG(cfile_readahead_prefetch, experimental);
+
+DEFINE_bool(cfile_pin_index_upper_levels, true,
+            "Whether each open CFile keeps the root and internal blocks of its "
+            "indexes in memory outside of the block cache, so that seeks never "
+            "have to read them again. The pinned blocks are tracked by the "
+            "'cfile-pinned-index' MemTracker.");
+TAG_FLAG(cfile_pin_index_upper_levels, advanced);
+
 using kudu::fs::ReadableBlock;
+using std::unique_ptr;
+using std::vector;
 using strings::Substitute;
 
 namespace kudu {
@@ -56,6 +86,8 @@ namespace cfile {
 
 const char* CFILE_CACHE_MISS_BYTES_METRIC_NAME = "cfile_cache_miss_bytes";
 const char* CFILE_CACHE_HIT_BYTES_METRIC_NAME = "cfile_cache_hit_bytes";
+const char* CFILE_CACHE_MISS_METRIC_NAME = "cfile_cache_miss";
+const char* CFILE_CACHE_HIT_METRIC_NAME = "cfile_cache_hit";
 
 // Magic+Length: 8-byte magic, followed by 4-byte header size
 static const size_t kMagicAndLengthSize = 12;
@@ -63,6 +95,22 @@ static const size_t kMaxHeaderFooterPBSize = 64*1024;
 
 static const size_t kBlockSizeLimit = 16 * 1024 * 1024; // 16MB
 
+static const char* const kPinnedIndexMemTrackerId = "cfile-pinned-index";
+
+// A copy of an index block kept in memory by its reader.
+struct CFileReader::PinnedIndexBlock {
+  PinnedIndexBlock(const Slice& block, std::shared_ptr<MemTracker> tracker)
+      : data(new uint8_t[block.size()]),
+        size(block.size()),
+        consumption(std::move(tracker), block.size()) {
+    memcpy(data.get(), block.data(), block.size());
+  }
+
+  unique_ptr<uint8_t[]> data;
+  const size_t size;
+  ScopedTrackedConsumption consumption;
+};
+
 static Status ParseMagicAndLength(const Slice &data,
                                   uint32_t *parsed_len) {
   if (data.size() != kMagicAndLengthSize) {
@@ -248,9 +296,10 @@ class ScratchMemory {
   // no capacity and cannot evict to make room, this will fall back
   // to allocating from the heap. In that case, IsFromCache() will
   // return false.
-  void TryAllocateFromCache(BlockCache* cache, const BlockCache::CacheKey& key, int size) {
+  void TryAllocateFromCache(BlockCache* cache, const BlockCache::CacheKey& key, int size,
+                            BlockCache::Tier tier = BlockCache::DECOMPRESSED) {
     DCHECK(!ptr_);
-    from_cache_ = cache->Allocate(key, size);
+    from_cache_ = cache->Allocate(key, size, tier);
     if (!from_cache_.valid()) {
       AllocateFromHeap(size);
       return;
@@ -307,6 +356,47 @@ class ScratchMemory {
 };
 } // anonymous namespace
 
+bool CFileReader::LookupPinnedIndexBlock(const BlockPointer &ptr, BlockHandle *ret) const {
+  std::shared_ptr<PinnedIndexBlock> pinned;
+  {
+    std::lock_guard<simple_spinlock> l(pinned_index_lock_);
+    auto it = pinned_index_blocks_.find(ptr.offset());
+    if (it == pinned_index_blocks_.end()) {
+      return false;
+    }
+    pinned = it->second;
+  }
+  Slice data(pinned->data.get(), pinned->size);
+  *ret = BlockHandle::WithPinnedData(data, std::move(pinned));
+  return true;
+}
+
+void CFileReader::PinIndexBlock(const BlockPointer &ptr, const Slice &data,
+                                BlockHandle *ret) const {
+  // Parented to the root so that the pinned blocks of all readers add up.
+  static std::shared_ptr<MemTracker> tracker =
+      MemTracker::FindOrCreateTracker(-1, kPinnedIndexMemTrackerId);
+
+  auto pinned = std::make_shared<PinnedIndexBlock>(data, tracker);
+  {
+    std::lock_guard<simple_spinlock> l(pinned_index_lock_);
+    // Another thread may have pinned the block concurrently.
+    pinned = pinned_index_blocks_.emplace(ptr.offset(), std::move(pinned)).first->second;
+  }
+  Slice pinned_data(pinned->data.get(), pinned->size);
+  *ret = BlockHandle::WithPinnedData(pinned_data, std::move(pinned));
+}
+
+Status CFileReader::PrefetchBlock(const BlockPointer &ptr) const {
+  DCHECK(init_once_.initted());
+  BlockCacheHandle bc_handle;
+  BlockCache::CacheKey key(block_->id(), ptr.offset());
+  if (BlockCache::GetSingleton()->Lookup(key, Cache::EXPECT_IN_CACHE, &bc_handle)) {
+    return Status::OK();
+  }
+  return block_->Prefetch(ptr.offset(), ptr.size());
+}
+
 Status CFileReader::ReadBlock(const BlockPointer &ptr, CacheControl cache_control,
                               BlockHandle *ret) const {
   DCHECK(init_once_.initted());
@@ -320,7 +410,7 @@ Status CFileReader::ReadBlock(const BlockPointer &ptr, CacheControl cache_contro
   BlockCache* cache = BlockCache::GetSingleton();
   BlockCache::CacheKey key(block_->id(), ptr.offset());
   if (cache->Lookup(key, cache_behavior, &bc_handle)) {
-    TRACE_COUNTER_INCREMENT("cfile_cache_hit", 1);
+    TRACE_COUNTER_INCREMENT(CFILE_CACHE_HIT_METRIC_NAME, 1);
     TRACE_COUNTER_INCREMENT(CFILE_CACHE_HIT_BYTES_METRIC_NAME, ptr.size());
     *ret = BlockHandle::WithDataFromCache(&bc_handle);
     // Cache hit
@@ -333,24 +423,63 @@ Status CFileReader::ReadBlock(const BlockPointer &ptr, CacheControl cache_contro
   // from the Linux cache).
   TRACE_EVENT1("io", "CFileReader::ReadBlock(cache miss)",
                "cfile", ToString());
-  TRACE_COUNTER_INCREMENT("cfile_cache_miss", 1);
+  TRACE_COUNTER_INCREMENT(CFILE_CACHE_MISS_METRIC_NAME, 1);
   TRACE_COUNTER_INCREMENT(CFILE_CACHE_MISS_BYTES_METRIC_NAME, ptr.size());
 
-  ScratchMemory scratch;
-  // If we are reading uncompressed data and plan to cache the result,
-  // then we should allocate our scratch memory directly from the cache.
-  // This avoids an extra memory copy in the case of an NVM cache.
-  if (block_uncompressor_ == nullptr && cache_control == CACHE_BLOCK) {
-    scratch.TryAllocateFromCache(cache, key, ptr.size());
-  } else {
-    scratch.AllocateFromHeap(ptr.size());
+  // Compressed blocks which are cached are also kept in their compressed
+  // form if the cache has a tier for them. A hit there saves the disk read.
+  const bool cache_compressed = block_uncompressor_ != nullptr &&
+      cache_control == CACHE_BLOCK && cache->has_compressed_tier();
+  BlockCacheHandle compressed_handle;
+
+  // Uncompressed blocks that won't be cached can be decoded straight from
+  // the underlying storage if the block manager can expose it without a
+  // copy, saving the copy and the allocation.
+  if (block_uncompressor_ == nullptr && cache_control == DONT_CACHE_BLOCK) {
+    Slice block;
+    std::shared_ptr<const void> pin;
+    Status s = block_->ReadZeroCopy(ptr.offset(), ptr.size(), &block, &pin);
+    if (s.ok()) {
+      TRACE_COUNTER_INCREMENT("cfile_zero_copy_reads", 1);
+      *ret = BlockHandle::WithPinnedData(block, std::move(pin));
+      return Status::OK();
+    }
+    if (!s.IsNotSupported()) {
+      return s;
+    }
   }
-  uint8_t* buf = scratch.get();
 
+  ScratchMemory scratch;
+  uint8_t* buf = nullptr;
   Slice block;
-  RETURN_NOT_OK(block_->Read(ptr.offset(), ptr.size(), &block, buf));
-  if (block.size() != ptr.size()) {
-    return Status::IOError("Could not read full block length");
+  if (cache_compressed &&
+      cache->Lookup(key, cache_behavior, &compressed_handle, BlockCache::COMPRESSED)) {
+    TRACE_COUNTER_INCREMENT("cfile_compressed_cache_hit", 1);
+    block = compressed_handle.data();
+  } else {
+    // If we are reading uncompressed data and plan to cache the result,
+    // then we should allocate our scratch memory directly from the cache.
+    // This avoids an extra memory copy in the case of an NVM cache.
+    if (block_uncompressor_ == nullptr && cache_control == CACHE_BLOCK) {
+      scratch.TryAllocateFromCache(cache, key, ptr.size());
+    } else if (cache_compressed) {
+      scratch.TryAllocateFromCache(cache, key, ptr.size(), BlockCache::COMPRESSED);
+    } else {
+      scratch.AllocateFromHeap(ptr.size());
+    }
+    buf = scratch.get();
+
+    RETURN_NOT_OK(block_->Read(ptr.offset(), ptr.size(), &block, buf));
+    if (block.size() != ptr.size()) {
+      return Status::IOError("Could not read full block length");
+    }
+
+    if (cache_compressed && scratch.IsFromCache()) {
+      // Hand the compressed block over to the cache. 'block' stays valid for
+      // as long as 'compressed_handle' is held.
+      cache->Insert(scratch.mutable_pending_entry(), &compressed_handle);
+      ignore_result(scratch.release());
+    }
   }
 
   // Decompress the block
@@ -387,6 +516,7 @@ Status CFileReader::ReadBlock(const BlockPointer &ptr, CacheControl cache_contro
     scratch.Swap(&decompressed_scratch);
 
     // Set the result block to our decompressed data.
+    buf = scratch.get();
     block = Slice(buf, uncompressed_size);
   } else {
     // Some of the File implementations from LevelDB attempt to be tricky
@@ -441,6 +571,39 @@ bool CFileReader::GetMetadataEntry(const string &key, string *val) {
   return false;
 }
 
+bool CFileReader::MayMatchPredicate(const ColumnPredicate& pred,
+                                    rowid_t first_row,
+                                    size_t nrows) const {
+  const auto& zone_maps = footer().zone_maps();
+  if (zone_maps.size() == 0) {
+    return true;
+  }
+
+  // Find the last block starting at or before 'first_row'.
+  auto iter = std::upper_bound(zone_maps.begin(), zone_maps.end(), first_row,
+                               [] (rowid_t row, const ZoneMapPB& zone_map) {
+                                 return row < zone_map.first_ordinal();
+                               });
+  if (iter == zone_maps.begin()) {
+    return true;
+  }
+  --iter;
+
+  const int64_t end_row = static_cast<int64_t>(first_row) + nrows;
+  int64_t covered_row = iter->first_ordinal();
+  for (; iter != zone_maps.end() && iter->first_ordinal() < end_row; ++iter) {
+    if (iter->first_ordinal() != covered_row) {
+      // The zone maps do not cover every row, so nothing can be ruled out.
+      return true;
+    }
+    if (ZoneMapMayMatch(type_info_, pred, *iter)) {
+      return true;
+    }
+    covered_row += iter->num_rows();
+  }
+  return covered_row < end_row;
+}
+
 Status CFileReader::NewIterator(CFileIterator **iter, CacheControl cache_control) {
   *iter = new CFileIterator(this, cache_control);
   return Status::OK();
@@ -513,6 +676,23 @@ Status DefaultColumnValueIterator::FinishBatch() {
 ////////////////////////////////////////////////////////////
 // Iterator
 ////////////////////////////////////////////////////////////
+namespace {
+
+// Returns the thread pool which performs read-ahead for all CFileIterators,
+// creating it on first use. The pool lives until the process exits.
+ThreadPool* ReadaheadPool() {
+  static ThreadPool* pool = []() {
+    gscoped_ptr<ThreadPool> p;
+    CHECK_OK(ThreadPoolBuilder("cfile-readahead")
+             .set_max_threads(FLAGS_cfile_readahead_threads)
+             .Build(&p));
+    return p.release();
+  }();
+  return pool;
+}
+
+} // anonymous namespace
+
 CFileIterator::CFileIterator(CFileReader* reader,
                              CFileReader::CacheControl cache_control)
   : reader_(reader),
@@ -520,10 +700,15 @@ CFileIterator::CFileIterator(CFileReader* reader,
     prepared_(false),
     cache_control_(cache_control),
     last_prepare_idx_(-1),
-    last_prepare_count_(-1) {
+    last_prepare_count_(-1),
+    readahead_distance_(0),
+    readahead_cond_(&readahead_lock_),
+    readahead_pending_(0) {
 }
 
 CFileIterator::~CFileIterator() {
+  // The background reads reference this iterator.
+  WaitForReadahead();
 }
 
 Status CFileIterator::SeekToOrdinal(rowid_t ord_idx) {
@@ -681,6 +866,30 @@ Status CFileIterator::SeekAtOrAfter(const EncodedKey &key,
   return Status::OK();
 }
 
+Status CFileIterator::ReadDictPages() {
+  vector<BlockPointer> ptrs;
+  ptrs.emplace_back(reader_->footer().dict_block_ptr());
+  for (const BlockPointerPB& pb : reader_->footer().extra_dict_block_ptrs()) {
+    ptrs.emplace_back(pb);
+  }
+
+  vector<unique_ptr<DictPage>> pages;
+  for (const BlockPointer& bp : ptrs) {
+    unique_ptr<DictPage> page(new DictPage());
+
+    // Cache the dictionary for performance
+    RETURN_NOT_OK_PREPEND(reader_->ReadBlock(bp, CFileReader::CACHE_BLOCK, &page->block_handle),
+                          "Couldn't read dictionary block");
+
+    page->decoder.reset(new BinaryPlainBlockDecoder(page->block_handle.data()));
+    RETURN_NOT_OK_PREPEND(page->decoder->ParseHeader(),
+                          "Couldn't parse dictionary block header");
+    pages.emplace_back(std::move(page));
+  }
+  dict_pages_.swap(pages);
+  return Status::OK();
+}
+
 Status CFileIterator::PrepareForNewSeek() {
   // Fully open the CFileReader if it was lazily opened earlier.
   //
@@ -697,17 +906,10 @@ Status CFileIterator::PrepareForNewSeek() {
     validx_iter_.reset(IndexTreeIterator::Create(reader_, bp));
   }
 
-  // Initialize the decoder for the dictionary block
+  // Initialize the decoders for the dictionary pages
   // in dictionary encoding mode.
-  if (!dict_decoder_ && reader_->footer().has_dict_block_ptr()) {
-    BlockPointer bp(reader_->footer().dict_block_ptr());
-
-    // Cache the dictionary for performance
-    RETURN_NOT_OK_PREPEND(reader_->ReadBlock(bp, CFileReader::CACHE_BLOCK, &dict_block_handle_),
-                          "Couldn't read dictionary block");
-
-    dict_decoder_.reset(new BinaryPlainBlockDecoder(dict_block_handle_.data()));
-    RETURN_NOT_OK_PREPEND(dict_decoder_->ParseHeader(), "Couldn't parse dictionary block header");
+  if (dict_pages_.empty() && reader_->footer().has_dict_block_ptr()) {
+    RETURN_NOT_OK(ReadDictPages());
   }
 
   seeked_ = nullptr;
@@ -716,9 +918,83 @@ Status CFileIterator::PrepareForNewSeek() {
   }
   prepared_blocks_.clear();
 
+  // Read-ahead restarts once the iterator reads sequentially from its new
+  // position. Reads still in flight from the previous position only warm the
+  // cache, so there is no need to wait for them.
+  readahead_iter_.reset();
+  readahead_distance_ = 0;
+
   return Status::OK();
 }
 
+void CFileIterator::ScheduleReadahead() {
+  if (FLAGS_cfile_readahead_blocks <= 0 || cache_control_ != CFileReader::CACHE_BLOCK) {
+    return;
+  }
+  if (!readahead_iter_) {
+    // Start reading ahead from the block 'seeked_' just moved to.
+    BlockPointer root = seeked_ == posidx_iter_.get() ? reader_->posidx_root()
+                                                      : reader_->validx_root();
+    readahead_iter_.reset(IndexTreeIterator::Create(reader_, root));
+    Status s = readahead_iter_->SeekAtOrBefore(seeked_->GetCurrentKey());
+    if (PREDICT_FALSE(!s.ok())) {
+      VLOG(1) << "Unable to start read-ahead of " << reader_->ToString() << ": "
+              << s.ToString();
+      readahead_iter_.reset();
+      return;
+    }
+    readahead_distance_ = 0;
+  } else if (readahead_distance_ > 0) {
+    readahead_distance_--;
+  } else if (PREDICT_FALSE(!readahead_iter_->Next().ok())) {
+    // 'readahead_iter_' had caught up with 'seeked_' and must skip the block
+    // 'seeked_' is about to read synchronously.
+    return;
+  }
+
+  while (readahead_distance_ < FLAGS_cfile_readahead_blocks && readahead_iter_->HasNext()) {
+    if (PREDICT_FALSE(!readahead_iter_->Next().ok())) {
+      return;
+    }
+    readahead_distance_++;
+
+    BlockPointer ptr = readahead_iter_->GetCurrentBlockPointer();
+    if (FLAGS_cfile_readahead_prefetch) {
+      // The pool reads below then mostly find their data in the page cache.
+      WARN_NOT_OK(reader_->PrefetchBlock(ptr),
+                  Substitute("Unable to prefetch $0", ptr.ToString()));
+    }
+    {
+      MutexLock l(readahead_lock_);
+      readahead_pending_++;
+    }
+    Status s = ReadaheadPool()->SubmitFunc([this, ptr]() {
+        BlockHandle unused;
+        Status s = reader_->ReadBlock(ptr, CFileReader::CACHE_BLOCK, &unused);
+        if (PREDICT_FALSE(!s.ok())) {
+          // The scan will surface the error once it reaches the block.
+          VLOG(1) << "Read-ahead of " << ptr.ToString() << " failed: " << s.ToString();
+        }
+        MutexLock l(readahead_lock_);
+        if (--readahead_pending_ == 0) {
+          readahead_cond_.Broadcast();
+        }
+      });
+    if (PREDICT_FALSE(!s.ok())) {
+      MutexLock l(readahead_lock_);
+      readahead_pending_--;
+      return;
+    }
+  }
+}
+
+void CFileIterator::WaitForReadahead() {
+  MutexLock l(readahead_lock_);
+  while (readahead_pending_ > 0) {
+    readahead_cond_.Wait();
+  }
+}
+
 rowid_t CFileIterator::GetCurrentOrdinal() const {
   CHECK(seeked_) << "not seeked";
   return last_prepare_idx_;
@@ -819,6 +1095,7 @@ Status CFileIterator::PrepareBatch(size_t *n) {
     } else if (!s.ok()) {
       return s;
     }
+    ScheduleReadahead();
     RETURN_NOT_OK(QueueCurrentDataBlock(*seeked_));
   }
 
@@ -904,14 +1181,17 @@ Status CFileIterator::Scan(ColumnMaterializationContext* ctx) {
 
   // Determine the matching codewords for dictionary encoding if they haven't
   // yet been determined for this CFile.
-  if (dict_decoder_ && ctx->DecoderEvalNotDisabled() && !codewords_matching_pred_) {
-    size_t nwords = dict_decoder_->Count();
-    codewords_matching_pred_.reset(new SelectionVector(nwords));
-    codewords_matching_pred_->SetAllFalse();
-    for (size_t i = 0; i < nwords; i++) {
-      Slice cur_string = dict_decoder_->string_at_index(i);
-      if (ctx->pred()->EvaluateCell<BINARY>(static_cast<const void *>(&cur_string))) {
-        BitmapSet(codewords_matching_pred_->mutable_bitmap(), i);
+  if (!dict_pages_.empty() && ctx->DecoderEvalNotDisabled() &&
+      !dict_pages_[0]->codewords_matching_pred) {
+    for (const auto& page : dict_pages_) {
+      size_t nwords = page->decoder->Count();
+      page->codewords_matching_pred.reset(new SelectionVector(nwords));
+      page->codewords_matching_pred->SetAllFalse();
+      for (size_t i = 0; i < nwords; i++) {
+        Slice cur_string = page->decoder->string_at_index(i);
+        if (ctx->pred()->EvaluateCell<BINARY>(static_cast<const void *>(&cur_string))) {
+          BitmapSet(page->codewords_matching_pred->mutable_bitmap(), i);
+        }
       }
     }
   }
@@ -923,6 +1203,33 @@ Status CFileIterator::Scan(ColumnMaterializationContext* ctx) {
       // that might be more efficient (allowing the decoder to save internal state
       // instead of having to reconstruct it)
     }
+
+    // If every row this block contributes to the batch has already been
+    // filtered out, don't decode any of them. The rows run either to the end
+    // of the block or to the end of the batch, so the block isn't read again
+    // in this batch; leaving the decoder where it is keeps it consistent with
+    // idx_in_block_, and the next batch seeks to its start explicitly.
+    size_t rows_in_block = std::min(rem, pb->num_rows_in_block_ - pb->idx_in_block_);
+    if (ctx->skip_unselected_rows() && !remaining_sel.AnySelected(rows_in_block)) {
+      pb->needs_rewind_ = true;
+      io_stats_.cells_skipped += rows_in_block;
+#ifndef NDEBUG
+      kudu::OverwriteWithPattern(reinterpret_cast<char *>(remaining_dst.data()),
+                                 remaining_dst.stride() * rows_in_block,
+                                 "SKIPPEDSKIPPEDSKIPPED");
+#endif
+      if (ctx->block()->is_nullable()) {
+        remaining_dst.SetNullBits(rows_in_block, false);
+      }
+      rem -= rows_in_block;
+      remaining_dst.Advance(rows_in_block);
+      remaining_sel.Advance(rows_in_block);
+      if (rem == 0) {
+        break;
+      }
+      continue;
+    }
+
     if (reader_->is_nullable()) {
       DCHECK(ctx->block()->is_nullable());
 
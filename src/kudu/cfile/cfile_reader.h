@@ -18,7 +18,9 @@
 #ifndef KUDU_CFILE_CFILE_READER_H
 #define KUDU_CFILE_CFILE_READER_H
 
+#include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "kudu/common/columnblock.h"
@@ -35,7 +37,10 @@
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/macros.h"
 #include "kudu/gutil/port.h"
+#include "kudu/util/condition_variable.h"
+#include "kudu/util/locks.h"
 #include "kudu/util/mem_tracker.h"
+#include "kudu/util/mutex.h"
 #include "kudu/util/object_pool.h"
 #include "kudu/util/once.h"
 #include "kudu/util/rle-encoding.h"
@@ -44,6 +49,9 @@
 #include "kudu/common/key_encoder.h"
 
 namespace kudu {
+
+class ColumnPredicate;
+
 namespace cfile {
 
 class BlockCache;
@@ -98,6 +106,23 @@ class CFileReader {
   Status ReadBlock(const BlockPointer &ptr, CacheControl cache_control,
                    BlockHandle *ret) const;
 
+  // If the index block at 'ptr' has been pinned by PinIndexBlock(), points
+  // 'ret' at the pinned copy and returns true. Otherwise returns false.
+  bool LookupPinnedIndexBlock(const BlockPointer &ptr, BlockHandle *ret) const;
+
+  // Keeps a copy of 'data', the index block read from 'ptr', in memory for
+  // the lifetime of this reader, and points 'ret' at it. The copy is charged
+  // to a MemTracker shared by all readers rather than to the block cache, so
+  // the upper levels of the index can't be evicted by data blocks.
+  //
+  // Thread-safe. If the block is already pinned, 'ret' points at the
+  // existing copy.
+  void PinIndexBlock(const BlockPointer &ptr, const Slice &data, BlockHandle *ret) const;
+
+  // Hints to the underlying block that the data of 'ptr' will be read soon,
+  // unless it is already in the block cache. Does not wait for any I/O.
+  Status PrefetchBlock(const BlockPointer &ptr) const;
+
   // Return the number of rows in this cfile.
   // This is assumed to be reasonably fast (i.e does not scan
   // the data)
@@ -110,6 +135,12 @@ class CFileReader {
   // in a hot path.
   bool GetMetadataEntry(const string &key, string *val);
 
+  // Returns false if the zone maps of the data blocks spanning the 'nrows'
+  // rows starting at ordinal 'first_row' show that none of those rows can
+  // satisfy 'pred'. Returns true if any of them may, or if the file was
+  // written without zone maps.
+  bool MayMatchPredicate(const ColumnPredicate& pred, rowid_t first_row, size_t nrows) const;
+
   // Can be called before Init().
   uint64_t file_size() const {
     return file_size_;
@@ -197,6 +228,11 @@ class CFileReader {
   KuduOnceDynamic init_once_;
 
   ScopedTrackedConsumption mem_consumption_;
+
+  // Index blocks pinned by PinIndexBlock(), keyed by offset.
+  struct PinnedIndexBlock;
+  mutable simple_spinlock pinned_index_lock_;
+  mutable std::unordered_map<uint64_t, std::shared_ptr<PinnedIndexBlock>> pinned_index_blocks_;
 };
 
 // Column Iterator interface used by the CFileSet.
@@ -365,17 +401,22 @@ class CFileIterator : public ColumnIterator {
     return io_stats_;
   }
 
-  // If the column is dictionary-coded, returns the decoder
-  // for the cfile's dictionary block. This is called by the
-  // BinaryDictBlockDecoder.
-  BinaryPlainBlockDecoder* GetDictDecoder() { return dict_decoder_.get(); }
+  // If the column is dictionary-coded, returns the decoder for the given
+  // page of the cfile's dictionary, or NULL if there is no such page. This
+  // is called by the BinaryDictBlockDecoder.
+  BinaryPlainBlockDecoder* GetDictDecoder(uint32_t page_idx) {
+    return page_idx < dict_pages_.size() ? dict_pages_[page_idx]->decoder.get() : nullptr;
+  }
 
   // If the column is dictionary-coded and a predicate on the column exists,
-  // returns the set of codewords that pass the predicate. Since a vocabulary
-  // is shared among the multiple BinaryDictBlockDecoders in a single cfile,
-  // the reader must expose an interface for all decoders to access the
-  // single set of predicate-satisfying codewords.
-  SelectionVector* GetCodeWordsMatchingPredicate() { return codewords_matching_pred_.get(); }
+  // returns the set of codewords in the given dictionary page that pass the
+  // predicate. Since a vocabulary is shared among the multiple
+  // BinaryDictBlockDecoders in a single cfile, the reader must expose an
+  // interface for all decoders to access the single set of
+  // predicate-satisfying codewords.
+  SelectionVector* GetCodeWordsMatchingPredicate(uint32_t page_idx) {
+    return dict_pages_[page_idx]->codewords_matching_pred.get();
+  }
 
  private:
   DISALLOW_COPY_AND_ASSIGN(CFileIterator);
@@ -438,17 +479,35 @@ class CFileIterator : public ColumnIterator {
   // seek-related state.
   Status PrepareForNewSeek();
 
+  // Called each time 'seeked_' advances to the next data block. Keeps up to
+  // --cfile_readahead_blocks of the following data blocks being read into
+  // the block cache in the background, so that sequential scans find them
+  // there instead of waiting on the disk.
+  void ScheduleReadahead();
+
+  // Waits for all of the background reads issued by ScheduleReadahead()
+  // to complete.
+  void WaitForReadahead();
+
   CFileReader* reader_;
 
   gscoped_ptr<IndexTreeIterator> posidx_iter_;
   gscoped_ptr<IndexTreeIterator> validx_iter_;
 
-  // Decoder for the dictionary block.
-  gscoped_ptr<BinaryPlainBlockDecoder> dict_decoder_;
-  BlockHandle dict_block_handle_;
+  // A page of the dictionary of a dictionary-coded column.
+  struct DictPage {
+    BlockHandle block_handle;
+    gscoped_ptr<BinaryPlainBlockDecoder> decoder;
+
+    // Set containing the codewords that match the predicate in this page.
+    std::unique_ptr<SelectionVector> codewords_matching_pred;
+  };
+
+  // Read and parse the pages of the cfile's dictionary into dict_pages_.
+  Status ReadDictPages();
 
-  // Set containing the codewords that match the predicate in a dictionary.
-  std::unique_ptr<SelectionVector> codewords_matching_pred_;
+  // The dictionary pages, in the order data blocks refer to them.
+  std::vector<std::unique_ptr<DictPage>> dict_pages_;
 
   // The currently in-use index iterator. This is equal to either
   // posidx_iter_.get(), validx_iter_.get(), or NULL if not seeked.
@@ -478,6 +537,20 @@ class CFileIterator : public ColumnIterator {
 
   IteratorStats io_stats_;
 
+  // Positioned at the last data block scheduled for read-ahead, or NULL if
+  // read-ahead has not started since the last seek.
+  gscoped_ptr<IndexTreeIterator> readahead_iter_;
+
+  // The number of data blocks by which 'readahead_iter_' is ahead of 'seeked_'.
+  int readahead_distance_;
+
+  // Protects 'readahead_pending_'.
+  Mutex readahead_lock_;
+  ConditionVariable readahead_cond_;
+
+  // The number of background reads which have not completed yet.
+  int readahead_pending_;
+
   // a temporary buffer for encoding
   faststring tmp_buf_;
 };
@@ -23,6 +23,7 @@
 
 #include "kudu/cfile/cfile_reader.h"
 #include "kudu/common/column_materialization_context.h"
+#include "kudu/common/column_predicate.h"
 #include "kudu/util/env.h"
 #include "kudu/util/mem_tracker.h"
 
@@ -124,6 +125,42 @@ size_t CommonPrefixLength(const Slice& slice_a, const Slice& slice_b) {
   return a - slice_a.data();
 }
 
+bool ValueBoundsMayMatch(const TypeInfo* type_info,
+                         const ColumnPredicate& pred,
+                         const Slice& min_value,
+                         const Slice& max_value) {
+  if (type_info->physical_type() == BINARY) {
+    return pred.MayMatchRange(&min_value, &max_value);
+  }
+
+  // Copy the values out to respect the alignment of the cell type.
+  uint64_t min;
+  uint64_t max;
+  if (PREDICT_FALSE(type_info->size() > sizeof(min) ||
+                    min_value.size() != type_info->size() ||
+                    max_value.size() != type_info->size())) {
+    LOG(DFATAL) << "Bad value bounds for " << type_info->name() << " column: "
+                << min_value.ToDebugString() << ", " << max_value.ToDebugString();
+    return true;
+  }
+  memcpy(&min, min_value.data(), type_info->size());
+  memcpy(&max, max_value.data(), type_info->size());
+  return pred.MayMatchRange(&min, &max);
+}
+
+bool ZoneMapMayMatch(const TypeInfo* type_info,
+                     const ColumnPredicate& pred,
+                     const ZoneMapPB& zone_map) {
+  if (zone_map.null_count() >= zone_map.num_rows()) {
+    // No predicate matches null rows.
+    return false;
+  }
+  if (!zone_map.has_min_value() || !zone_map.has_max_value()) {
+    return true;
+  }
+  return ValueBoundsMayMatch(type_info, pred, zone_map.min_value(), zone_map.max_value());
+}
+
 void GetSeparatingKey(const Slice& left, Slice* right) {
   DCHECK_LE(left.compare(*right), 0);
   size_t cpl = CommonPrefixLength(left, *right);
@@ -30,6 +30,10 @@
 #include "kudu/util/status.h"
 
 namespace kudu {
+
+class ColumnPredicate;
+class TypeInfo;
+
 namespace cfile {
 
 class CFileReader;
@@ -45,9 +49,11 @@ struct WriterOptions {
   // This parameter can be changed dynamically.  Most clients should
   // leave this parameter alone.
   //
-  // This is currently only used by StringPrefixBlockBuilder
+  // This is currently only used by BinaryPrefixBlockBuilder. If 0, the
+  // interval is derived from storage_attributes.cfile_block_size, see
+  // BinaryPrefixBlockBuilder::RestartIntervalForBlockSize().
   //
-  // Default: 16
+  // Default: 16, or --cfile_prefix_block_restart_interval
   int block_restart_interval;
 
   // Whether the file needs a positional index.
@@ -60,6 +66,10 @@ struct WriterOptions {
   // instead of entire keys.
   bool optimize_index_keys;
 
+  // Whether to record per data block value statistics (zone maps) in the
+  // footer, allowing readers to skip blocks which cannot match a predicate.
+  bool write_zone_maps;
+
   // Column storage attributes.
   //
   // Default: all default values as specified in the constructor in
@@ -92,6 +102,19 @@ size_t CommonPrefixLength(const Slice& a, const Slice& b);
 // Truncate right to give a shortest key satisfying left <= key <= right.
 void GetSeparatingKey(const Slice& left, Slice* right);
 
+// Returns true if 'pred' may match any non-null value between the inclusive
+// bounds 'min_value' and 'max_value', which are stored in the format of the
+// ZoneMapPB values.
+bool ValueBoundsMayMatch(const TypeInfo* type_info,
+                         const ColumnPredicate& pred,
+                         const Slice& min_value,
+                         const Slice& max_value);
+
+// Returns true if any row summarized by 'zone_map' may satisfy 'pred'.
+bool ZoneMapMayMatch(const TypeInfo* type_info,
+                     const ColumnPredicate& pred,
+                     const ZoneMapPB& zone_map);
+
 }  // namespace cfile
 }  // namespace kudu
 
@@ -17,6 +17,7 @@
 
 #include "kudu/cfile/cfile_writer.h"
 
+#include <cmath>
 #include <glog/logging.h>
 #include <string>
 #include <utility>
@@ -46,6 +47,22 @@ DEFINE_string(cfile_default_compression_codec, "none",
               "Default cfile block compression codec.");
 TAG_FLAG(cfile_default_compression_codec, advanced);
 
+DEFINE_bool(cfile_adaptive_auto_encoding, false,
+            "Whether columns with AUTO_ENCODING should use ADAPTIVE_ENCODING, which "
+            "encodes each block with whichever supported encoding makes it smallest, "
+            "instead of the fixed default encoding for their type. Trial-encoding "
+            "every block costs extra CPU on flushes and compactions.");
+TAG_FLAG(cfile_adaptive_auto_encoding, experimental);
+
+DEFINE_int32(cfile_prefix_block_restart_interval, 16,
+             "Number of values between the restart points of prefix-encoded "
+             "binary blocks, at which full keys are stored. Seeks by value "
+             "binary search the restart points, then replay the prefix deltas "
+             "from the nearest one, so shorter intervals speed up point lookups "
+             "at the cost of space. If 0, the interval is derived from the block "
+             "size, with smaller blocks getting shorter intervals.");
+TAG_FLAG(cfile_prefix_block_restart_interval, advanced);
+
 // The default value is optimized for throughput in the case that
 // there are multiple drives backing the tablet. By asynchronously
 // flushing each cfile before issuing any fsyncs, the IO across
@@ -81,13 +98,136 @@ static CompressionType GetDefaultCompressionCodec() {
 ////////////////////////////////////////////////////////////
 WriterOptions::WriterOptions()
   : index_block_size(32*1024),
-    block_restart_interval(16),
+    block_restart_interval(FLAGS_cfile_prefix_block_restart_interval),
     write_posidx(false),
     write_validx(false),
-    optimize_index_keys(true) {
+    optimize_index_keys(true),
+    write_zone_maps(false) {
 }
 
 
+////////////////////////////////////////////////////////////
+// ZoneMapBuilder
+////////////////////////////////////////////////////////////
+
+ZoneMapBuilder::ZoneMapBuilder(const TypeInfo* typeinfo)
+  : typeinfo_(typeinfo),
+    has_values_(false),
+    unbounded_(false),
+    null_count_(0),
+    file_has_values_(false),
+    file_unbounded_(false),
+    file_num_rows_(0),
+    file_null_count_(0) {
+}
+
+void ZoneMapBuilder::AddValues(const void* cells, size_t count) {
+  if (unbounded_) {
+    return;
+  }
+  const uint8_t* cell = reinterpret_cast<const uint8_t*>(cells);
+  Slice min_slice;
+  Slice max_slice;
+  for (size_t i = 0; i < count; i++, cell += typeinfo_->size()) {
+    // NaNs are not ordered, and compare equal to every value, so a block
+    // holding one cannot be bounded. Neither can very large binary values.
+    switch (typeinfo_->physical_type()) {
+      case FLOAT:
+        unbounded_ = std::isnan(*reinterpret_cast<const float*>(cell));
+        break;
+      case DOUBLE:
+        unbounded_ = std::isnan(*reinterpret_cast<const double*>(cell));
+        break;
+      case BINARY:
+        unbounded_ = reinterpret_cast<const Slice*>(cell)->size() > kMaxBinaryValueSize;
+        break;
+      default:
+        break;
+    }
+    if (PREDICT_FALSE(unbounded_)) {
+      return;
+    }
+
+    if (!has_values_) {
+      CopyCell(cell, &min_);
+      CopyCell(cell, &max_);
+      has_values_ = true;
+    } else if (typeinfo_->Compare(cell, CellPtr(min_, &min_slice)) < 0) {
+      CopyCell(cell, &min_);
+    } else if (typeinfo_->Compare(cell, CellPtr(max_, &max_slice)) > 0) {
+      CopyCell(cell, &max_);
+    }
+  }
+}
+
+void ZoneMapBuilder::FinishBlock(rowid_t first_ordinal, uint32_t num_rows, ZoneMapPB* pb) {
+  pb->set_first_ordinal(first_ordinal);
+  pb->set_num_rows(num_rows);
+  if (null_count_ > 0) {
+    pb->set_null_count(null_count_);
+  }
+  if (has_values_ && !unbounded_) {
+    pb->set_min_value(min_.data(), min_.size());
+    pb->set_max_value(max_.data(), max_.size());
+  }
+
+  // Fold the block's statistics into those of the file.
+  file_num_rows_ += num_rows;
+  file_null_count_ += null_count_;
+  if (has_values_) {
+    if (unbounded_) {
+      file_unbounded_ = true;
+    } else if (!file_has_values_) {
+      file_min_.assign_copy(min_.data(), min_.size());
+      file_max_.assign_copy(max_.data(), max_.size());
+    } else {
+      Slice lhs_slice;
+      Slice rhs_slice;
+      if (typeinfo_->Compare(CellPtr(min_, &lhs_slice), CellPtr(file_min_, &rhs_slice)) < 0) {
+        file_min_.assign_copy(min_.data(), min_.size());
+      }
+      if (typeinfo_->Compare(CellPtr(max_, &lhs_slice), CellPtr(file_max_, &rhs_slice)) > 0) {
+        file_max_.assign_copy(max_.data(), max_.size());
+      }
+    }
+    file_has_values_ = true;
+  }
+
+  has_values_ = false;
+  unbounded_ = false;
+  null_count_ = 0;
+}
+
+void ZoneMapBuilder::FinishFile(ZoneMapPB* pb) const {
+  pb->Clear();
+  pb->set_first_ordinal(0);
+  pb->set_num_rows(file_num_rows_);
+  if (file_null_count_ > 0) {
+    pb->set_null_count(file_null_count_);
+  }
+  if (file_has_values_ && !file_unbounded_) {
+    pb->set_min_value(file_min_.data(), file_min_.size());
+    pb->set_max_value(file_max_.data(), file_max_.size());
+  }
+}
+
+void ZoneMapBuilder::CopyCell(const void* cell, faststring* dst) const {
+  if (typeinfo_->physical_type() == BINARY) {
+    const Slice* slice = reinterpret_cast<const Slice*>(cell);
+    dst->assign_copy(slice->data(), slice->size());
+  } else {
+    dst->assign_copy(reinterpret_cast<const uint8_t*>(cell), typeinfo_->size());
+  }
+}
+
+const void* ZoneMapBuilder::CellPtr(const faststring& value, Slice* slice) const {
+  if (typeinfo_->physical_type() == BINARY) {
+    *slice = Slice(value);
+    return slice;
+  }
+  return value.data();
+}
+
 ////////////////////////////////////////////////////////////
 // CFileWriter
 ////////////////////////////////////////////////////////////
@@ -106,6 +246,10 @@ CFileWriter::CFileWriter(const WriterOptions &options,
     key_encoder_(nullptr),
     state_(kWriterInitialized) {
   EncodingType encoding = options_.storage_attributes.encoding;
+  if (encoding == AUTO_ENCODING && FLAGS_cfile_adaptive_auto_encoding &&
+      TypeEncodingInfo::Get(typeinfo_, ADAPTIVE_ENCODING, &type_encoding_info_).ok()) {
+    encoding = ADAPTIVE_ENCODING;
+  }
   Status s = TypeEncodingInfo::Get(typeinfo_, encoding, &type_encoding_info_);
   if (!s.ok()) {
     // TODO: we should somehow pass some contextual info about the
@@ -185,6 +329,10 @@ Status CFileWriter::Start() {
     null_bitmap_builder_.reset(new NullBitmapBuilder(nrows * 8));
   }
 
+  if (options_.write_zone_maps) {
+    zone_map_builder_.reset(new ZoneMapBuilder(typeinfo_));
+  }
+
   state_ = kWriterWriting;
 
   return Status::OK();
@@ -229,6 +377,11 @@ Status CFileWriter::FinishAndReleaseBlock(ScopedWritableBlockCloser* closer) {
     footer.mutable_validx_info()->CopyFrom(validx_info);
   }
 
+  if (zone_map_builder_ != nullptr) {
+    zone_map_builder_->FinishFile(&file_zone_map_);
+    footer.mutable_zone_maps()->Swap(&zone_maps_);
+  }
+
   // Optionally append extra information to the end of cfile.
   // Example: dictionary block for dictionary encoding
   RETURN_NOT_OK(data_block_->AppendExtraInfo(this, &footer));
@@ -298,6 +451,9 @@ Status CFileWriter::AppendEntries(const void *entries, size_t count) {
     int n = data_block_->Add(ptr, rem);
     DCHECK_GE(n, 0);
 
+    if (zone_map_builder_ != nullptr) {
+      zone_map_builder_->AddValues(ptr, n);
+    }
     ptr += typeinfo_->size() * n;
     rem -= n;
     value_count_ += n;
@@ -329,6 +485,9 @@ Status CFileWriter::AppendNullableEntries(const uint8_t *bitmap,
         DCHECK_GE(n, 0);
 
         null_bitmap_builder_->AddRun(true, n);
+        if (zone_map_builder_ != nullptr) {
+          zone_map_builder_->AddValues(ptr, n);
+        }
         ptr += n * typeinfo_->size();
         value_count_ += n;
         rem -= n;
@@ -340,6 +499,9 @@ Status CFileWriter::AppendNullableEntries(const uint8_t *bitmap,
       } while (rem > 0);
     } else {
       null_bitmap_builder_->AddRun(false, nblock);
+      if (zone_map_builder_ != nullptr) {
+        zone_map_builder_->AddNulls(nblock);
+      }
       ptr += nblock * typeinfo_->size();
       value_count_ += nblock;
     }
@@ -362,6 +524,10 @@ Status CFileWriter::FinishCurDataBlock() {
   VLOG(1) << "Appending data block for values " <<
     first_elem_ord << "-" << (first_elem_ord + num_elems_in_block);
 
+  if (zone_map_builder_ != nullptr) {
+    zone_map_builder_->FinishBlock(first_elem_ord, num_elems_in_block, zone_maps_.Add());
+  }
+
   // The current data block is full, need to push it
   // into the file, and add to index
   Slice data = data_block_->Finish(first_elem_ord);
@@ -92,6 +92,61 @@ class NullBitmapBuilder {
   RleEncoder<bool> rle_encoder_;
 };
 
+// Accumulates the zone map (null count and min/max values) of the data block
+// currently being written, as well as that of the whole file.
+class ZoneMapBuilder {
+ public:
+  explicit ZoneMapBuilder(const TypeInfo* typeinfo);
+
+  // Add 'count' contiguous non-null cells to the zone map.
+  void AddValues(const void* cells, size_t count);
+
+  void AddNulls(size_t count) {
+    null_count_ += count;
+  }
+
+  // Fill in 'pb' with the zone map of the block which starts at ordinal
+  // 'first_ordinal' and holds 'num_rows' rows, and reset the builder for the
+  // next block.
+  void FinishBlock(rowid_t first_ordinal, uint32_t num_rows, ZoneMapPB* pb);
+
+  // Fill in 'pb' with the zone map of all of the blocks finished so far.
+  void FinishFile(ZoneMapPB* pb) const;
+
+ private:
+  // Binary values longer than this are not recorded, so that the footer does
+  // not grow unboundedly with large cells.
+  static const size_t kMaxBinaryValueSize = 128;
+
+  // Store the given cell into 'dst', in the format of ZoneMapPB's values.
+  void CopyCell(const void* cell, faststring* dst) const;
+
+  // Return a pointer suitable for TypeInfo::Compare() to the cell stored in
+  // 'value'. 'slice' must outlive the returned pointer.
+  const void* CellPtr(const faststring& value, Slice* slice) const;
+
+  const TypeInfo* typeinfo_;
+
+  // Whether any non-null values have been added to the current block.
+  bool has_values_;
+
+  // Whether the current block holds values which cannot be bounded, in which
+  // case its min and max are not recorded.
+  bool unbounded_;
+
+  uint32_t null_count_;
+  faststring min_;
+  faststring max_;
+
+  // The same as above, for all of the finished blocks.
+  bool file_has_values_;
+  bool file_unbounded_;
+  rowid_t file_num_rows_;
+  rowid_t file_null_count_;
+  faststring file_min_;
+  faststring file_max_;
+};
+
 // Main class used to write a CFile.
 class CFileWriter {
  public:
@@ -162,6 +217,15 @@ class CFileWriter {
 
   std::string ToString() const { return block_->id().ToString(); }
 
+  // Return the zone map covering every row of the file.
+  //
+  // REQUIRES: the writer was configured to write zone maps, and was finished.
+  const ZoneMapPB& file_zone_map() const {
+    DCHECK(options_.write_zone_maps);
+    DCHECK_EQ(state_, kWriterFinished);
+    return file_zone_map_;
+  }
+
   // Wrapper for AddBlock() to append the dictionary block to the end of a Cfile.
   Status AppendDictBlock(const vector<Slice> &data_slices, BlockPointer *block_ptr,
                          const char *name_for_log) {
@@ -216,6 +280,12 @@ class CFileWriter {
   // a temporary buffer for encoding
   faststring tmp_buf_;
 
+  // Zone maps of the data blocks written so far.
+  google::protobuf::RepeatedPtrField<ZoneMapPB> zone_maps_;
+
+  // Zone map of the whole file, set on Finish().
+  ZoneMapPB file_zone_map_;
+
   // Metadata which has been added to the writer but not yet flushed.
   vector<pair<string, string> > unflushed_metadata_;
 
@@ -223,6 +293,7 @@ class CFileWriter {
   gscoped_ptr<IndexTreeBuilder> posidx_builder_;
   gscoped_ptr<IndexTreeBuilder> validx_builder_;
   gscoped_ptr<NullBitmapBuilder> null_bitmap_builder_;
+  gscoped_ptr<ZoneMapBuilder> zone_map_builder_;
   gscoped_ptr<CompressedBlockBuilder> block_compressor_;
 
   enum State {
@@ -111,6 +111,10 @@ TEST_F(TestCompression, TestZlibCompressionCodec) {
   TestCompressionCodec(ZLIB);
 }
 
+TEST_F(TestCompression, TestZstdCompressionCodec) {
+  TestCompressionCodec(ZSTD);
+}
+
 TEST_F(TestCompression, TestCFileNoCompressionReadWrite) {
   TestReadWriteCompressed(NO_COMPRESSION);
 }
@@ -127,5 +131,9 @@ TEST_F(TestCompression, TestCFileZlibReadWrite) {
   TestReadWriteCompressed(ZLIB);
 }
 
+TEST_F(TestCompression, TestCFileZstdReadWrite) {
+  TestReadWriteCompressed(ZSTD);
+}
+
 } // namespace cfile
 } // namespace kudu
@@ -15,10 +15,12 @@
 // specific language governing permissions and limitations
 // under the License.
 
+#include <gflags/gflags.h>
 #include <glog/logging.h>
 #include <snappy-sinksource.h>
 #include <snappy.h>
 #include <zlib.h>
+#include <zstd.h>
 #include <lz4.h>
 #include <string>
 #include <vector>
@@ -26,6 +28,14 @@
 #include "kudu/cfile/compression_codec.h"
 #include "kudu/gutil/singleton.h"
 #include "kudu/gutil/stringprintf.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/flag_tags.h"
+#include "kudu/util/threadlocal.h"
+
+DEFINE_int32(zstd_compression_level, 1,
+             "Compression level used by the zstd codec, from 1 (fastest) to 22 "
+             "(smallest output). Decompression speed hardly depends on it.");
+TAG_FLAG(zstd_compression_level, advanced);
 
 namespace kudu {
 namespace cfile {
@@ -225,6 +235,80 @@ class ZlibCodec : public CompressionCodec {
   }
 };
 
+class ZstdCodec : public CompressionCodec {
+ public:
+  static ZstdCodec *GetSingleton() {
+    return Singleton<ZstdCodec>::get();
+  }
+
+  Status Compress(const Slice& input,
+                  uint8_t *compressed, size_t *compressed_length) const OVERRIDE {
+    size_t n = ZSTD_compressCCtx(ThreadLocalContexts()->cctx,
+                                 compressed, MaxCompressedLength(input.size()),
+                                 input.data(), input.size(),
+                                 FLAGS_zstd_compression_level);
+    if (ZSTD_isError(n)) {
+      return Status::IOError("unable to compress the buffer", ZSTD_getErrorName(n));
+    }
+    *compressed_length = n;
+    return Status::OK();
+  }
+
+  Status Compress(const vector<Slice>& input_slices,
+                  uint8_t *compressed, size_t *compressed_length) const OVERRIDE {
+    if (input_slices.size() == 1) {
+      return Compress(input_slices[0], compressed, compressed_length);
+    }
+
+    SlicesSource source(input_slices);
+    faststring buffer;
+    source.Dump(&buffer);
+    return Compress(Slice(buffer.data(), buffer.size()), compressed, compressed_length);
+  }
+
+  Status Uncompress(const Slice& compressed,
+                    uint8_t *uncompressed, size_t uncompressed_length) const OVERRIDE {
+    size_t n = ZSTD_decompressDCtx(ThreadLocalContexts()->dctx,
+                                   uncompressed, uncompressed_length,
+                                   compressed.data(), compressed.size());
+    if (ZSTD_isError(n)) {
+      return Status::Corruption("unable to uncompress the buffer", ZSTD_getErrorName(n));
+    }
+    if (n != uncompressed_length) {
+      return Status::Corruption(strings::Substitute(
+          "unable to uncompress the buffer: expected $0 bytes, got $1",
+          uncompressed_length, n));
+    }
+    return Status::OK();
+  }
+
+  size_t MaxCompressedLength(size_t source_bytes) const OVERRIDE {
+    return ZSTD_compressBound(source_bytes);
+  }
+
+ private:
+  // Creating a zstd context allocates several hundred KB, so each thread
+  // keeps its own rather than paying for that on every call.
+  struct Contexts {
+    Contexts()
+        : cctx(ZSTD_createCCtx()),
+          dctx(ZSTD_createDCtx()) {
+      CHECK(cctx != nullptr && dctx != nullptr) << "unable to create zstd contexts";
+    }
+    ~Contexts() {
+      ZSTD_freeCCtx(cctx);
+      ZSTD_freeDCtx(dctx);
+    }
+    ZSTD_CCtx* cctx;
+    ZSTD_DCtx* dctx;
+  };
+
+  static Contexts* ThreadLocalContexts() {
+    BLOCK_STATIC_THREAD_LOCAL(Contexts, contexts);
+    return contexts;
+  }
+};
+
 Status GetCompressionCodec(CompressionType compression,
                            const CompressionCodec** codec) {
   switch (compression) {
@@ -240,6 +324,9 @@ Status GetCompressionCodec(CompressionType compression,
     case ZLIB:
       *codec = ZlibCodec::GetSingleton();
       break;
+    case ZSTD:
+      *codec = ZstdCodec::GetSingleton();
+      break;
     default:
       return Status::NotFound("bad compression type");
   }
@@ -253,6 +340,8 @@ CompressionType GetCompressionCodecType(const std::string& name) {
     return LZ4;
   if (name.compare("zlib") == 0)
     return ZLIB;
+  if (name.compare("zstd") == 0)
+    return ZSTD;
   if (name.compare("none") == 0)
     return NO_COMPRESSION;
 
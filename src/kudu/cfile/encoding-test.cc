@@ -22,15 +22,19 @@
 #include <stdlib.h>
 #include <vector>
 
+#include "kudu/cfile/adaptive_block.h"
 #include "kudu/cfile/block_encodings.h"
 #include "kudu/cfile/bshuf_block.h"
 #include "kudu/cfile/cfile_writer.h"
+#include "kudu/cfile/for_block.h"
 #include "kudu/cfile/gvint_block.h"
 #include "kudu/cfile/plain_bitmap_block.h"
 #include "kudu/cfile/plain_block.h"
 #include "kudu/cfile/rle_block.h"
 #include "kudu/cfile/binary_plain_block.h"
 #include "kudu/cfile/binary_prefix_block.h"
+#include "kudu/common/column_materialization_context.h"
+#include "kudu/common/column_predicate.h"
 #include "kudu/common/columnblock.h"
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/stringprintf.h"
@@ -542,6 +546,65 @@ class TestEncoding : public ::testing::Test {
   }
 
 
+  // Test that evaluating a predicate in the decoder produces the same results
+  // as decoding all of the values and evaluating each of them.
+  template <class BuilderType, class DecoderType, DataType IntType>
+  void TestIntBlockCopyNextAndEval(BuilderType* ibb) {
+    typedef typename DataTypeTraits<IntType>::cpp_type CppType;
+
+    srand(123);
+
+    // Insert runs of small values, so that there are both long runs and
+    // literal runs.
+    std::vector<CppType> to_insert;
+    while (to_insert.size() < 10003) {
+      CppType val = random() % 10;
+      int run_length = (random() % 4 == 0) ? random() % 100 : 1;
+      for (int i = 0; i < run_length; i++) {
+        to_insert.push_back(val);
+      }
+    }
+
+    ibb->Add(reinterpret_cast<const uint8_t *>(&to_insert[0]), to_insert.size());
+    Slice s = ibb->Finish(0);
+
+    DecoderType ibd(s);
+    ASSERT_OK(ibd.ParseHeader());
+
+    CppType lower = 3;
+    CppType upper = 7;
+    ColumnSchema column("c", IntType);
+    ColumnPredicate pred = ColumnPredicate::Range(column, &lower, &upper);
+
+    std::vector<CppType> decoded(to_insert.size());
+    ColumnBlock dst_block(GetTypeInfo(IntType), nullptr, &decoded[0],
+                          to_insert.size(), &arena_);
+    SelectionVector sel(to_insert.size());
+    sel.SetAllTrue();
+    ColumnMaterializationContext ctx(0, &pred, &dst_block, &sel);
+    SelectionVectorView sel_view(&sel);
+
+    size_t dec_count = 0;
+    while (ibd.HasNext()) {
+      size_t n = std::min(to_insert.size() - dec_count,
+                          static_cast<size_t>((random() % 30) + 1));
+      ColumnDataView dst_data(&dst_block, dec_count);
+      ASSERT_OK(ibd.CopyNextAndEval(&n, &ctx, &sel_view, &dst_data));
+      ASSERT_FALSE(ctx.DecoderEvalNotSupported());
+      sel_view.Advance(n);
+      dec_count += n;
+    }
+    ASSERT_EQ(to_insert.size(), dec_count);
+
+    for (size_t i = 0; i < to_insert.size(); i++) {
+      bool matches = lower <= to_insert[i] && to_insert[i] < upper;
+      ASSERT_EQ(matches, sel.IsRowSelected(i)) << "row " << i;
+      if (matches) {
+        ASSERT_EQ(to_insert[i], decoded[i]) << "row " << i;
+      }
+    }
+  }
+
   // Test encoding and decoding BOOL datatypes
   template <class BuilderType, class DecoderType>
   void TestBoolBlockRoundTrip() {
@@ -665,6 +728,142 @@ TEST_F(TestEncoding, TestBShufDoubleBlockEncoder) {
                                     BShufBlockDecoder<DOUBLE> >(doubles.get(), kSize);
 }
 
+// Monotonic values with small, varying gaps, like timestamps, are encoded
+// as bit-packed deltas.
+TEST_F(TestEncoding, TestForMonotonicBlockEncoder) {
+  const uint32_t kSize = 10000;
+
+  gscoped_ptr<int64_t[]> ints(new int64_t[kSize]);
+  int64_t v = 1475000000000000L;
+  for (int i = 0; i < kSize; i++) {
+    v += 1000 + random() % 100;
+    ints.get()[i] = v;
+  }
+
+  TestEncodeDecodeTemplateBlockEncoder<INT64, ForBlockBuilder<INT64>,
+                                       ForBlockDecoder<INT64> >(ints.get(), kSize);
+
+  gscoped_ptr<WriterOptions> opts(NewWriterOptions());
+  ForBlockBuilder<INT64> builder(opts.get());
+  builder.Add(reinterpret_cast<const uint8_t*>(ints.get()), kSize);
+  Slice s = builder.Finish(0);
+  ASSERT_EQ(kForDeltaMode, s[8]);
+  ASSERT_EQ(7, s[9]);
+  ASSERT_EQ(kForBlockHeaderSize + BitPackedSize(kSize - 1, 7), s.size());
+}
+
+// Values spanning the whole range of the type need every bit.
+TEST_F(TestEncoding, TestForFullRangeBlockEncoder) {
+  const uint32_t kSize = 1000;
+
+  gscoped_ptr<int64_t[]> ints(new int64_t[kSize]);
+  for (int i = 0; i < kSize; i++) {
+    ints.get()[i] = (static_cast<int64_t>(random()) << 33) ^ random();
+  }
+  ints.get()[0] = std::numeric_limits<int64_t>::min();
+  ints.get()[1] = std::numeric_limits<int64_t>::max();
+
+  TestEncodeDecodeTemplateBlockEncoder<INT64, ForBlockBuilder<INT64>,
+                                       ForBlockDecoder<INT64> >(ints.get(), kSize);
+}
+
+TEST_F(TestEncoding, TestForEmptyBlockEncodeDecode) {
+  TestEmptyBlockEncodeDecode<ForBlockBuilder<INT32>, ForBlockDecoder<INT32> >();
+}
+
+// Every bit width must round-trip through the packing kernels.
+TEST_F(TestEncoding, TestBitPackAllWidths) {
+  const int kNumValues = kBitPackGroupSize * 3 + 5;
+  for (int width = 0; width <= 64; width++) {
+    SCOPED_TRACE(width);
+    const uint64_t mask = width == 64 ? ~0ULL : (1ULL << width) - 1;
+    vector<uint64_t> values;
+    for (int i = 0; i < kNumValues; i++) {
+      values.push_back(((static_cast<uint64_t>(random()) << 33) ^ random()) & mask);
+    }
+    values[0] = mask;
+
+    faststring packed;
+    BitPackValues(values.data(), kNumValues, width, &packed);
+    ASSERT_EQ(BitPackedSize(kNumValues, width), packed.size());
+    vector<uint64_t> unpacked(KUDU_ALIGN_UP(kNumValues, kBitPackGroupSize));
+    BitUnpackValues(packed.data(), kNumValues, width, unpacked.data());
+    for (int i = 0; i < kNumValues; i++) {
+      ASSERT_EQ(values[i], unpacked[i]) << "at index " << i;
+    }
+  }
+}
+
+// Each block of an adaptive column is stored with the encoding that makes
+// it smallest.
+TEST_F(TestEncoding, TestAdaptiveBlockEncoder) {
+  const uint32_t kSize = 10000;
+  gscoped_ptr<WriterOptions> opts(NewWriterOptions());
+  AdaptiveBlockBuilder<INT32> builder(opts.get());
+
+  // A run of identical values is best run-length encoded.
+  vector<int32_t> ints(kSize, 12345);
+  ASSERT_EQ(kSize, builder.Add(reinterpret_cast<const uint8_t*>(ints.data()), kSize));
+  Slice s = builder.Finish(0);
+  ASSERT_EQ(RLE, s[0]);
+  TestEncodeDecodeTemplateBlockEncoder<INT32, AdaptiveBlockBuilder<INT32>,
+                                       AdaptiveBlockDecoder<INT32> >(ints.data(), kSize);
+
+  // Small random values don't run-length encode well, and the block must be
+  // no bigger than the smallest of the alternatives.
+  builder.Reset();
+  for (int i = 0; i < kSize; i++) {
+    ints[i] = random() % 1000;
+  }
+  ASSERT_EQ(kSize, builder.Add(reinterpret_cast<const uint8_t*>(ints.data()), kSize));
+  s = builder.Finish(0);
+  ASSERT_NE(RLE, s[0]);
+  ForBlockBuilder<INT32> for_builder(opts.get());
+  for_builder.Add(reinterpret_cast<const uint8_t*>(ints.data()), kSize);
+  BShufBlockBuilder<INT32> bshuf_builder(opts.get());
+  bshuf_builder.Add(reinterpret_cast<const uint8_t*>(ints.data()), kSize);
+  ASSERT_EQ(kAdaptiveBlockHeaderSize + std::min(for_builder.Finish(0).size(),
+                                                bshuf_builder.Finish(0).size()),
+            s.size());
+  TestEncodeDecodeTemplateBlockEncoder<INT32, AdaptiveBlockBuilder<INT32>,
+                                       AdaptiveBlockDecoder<INT32> >(ints.data(), kSize);
+
+  AdaptiveBlockDecoder<INT32> decoder(s);
+  ASSERT_OK(decoder.ParseHeader());
+  ASSERT_EQ(s[0], decoder.block_encoding());
+  ASSERT_EQ(kSize, decoder.Count());
+}
+
+// The adaptive builder, not its candidates, decides when a block is full.
+TEST_F(TestEncoding, TestAdaptiveBlockFull) {
+  gscoped_ptr<WriterOptions> opts(NewWriterOptions());
+  opts->storage_attributes.cfile_block_size = 1024;
+  AdaptiveBlockBuilder<INT64> builder(opts.get());
+
+  vector<int64_t> ints(10000);
+  for (int i = 0; i < ints.size(); i++) {
+    ints[i] = (static_cast<int64_t>(random()) << 33) ^ random();
+  }
+  int added = builder.Add(reinterpret_cast<const uint8_t*>(ints.data()), ints.size());
+  ASSERT_EQ(1024 / sizeof(int64_t) + 1, added);
+  ASSERT_TRUE(builder.IsBlockFull(1024));
+  ASSERT_EQ(0, builder.Add(reinterpret_cast<const uint8_t*>(ints.data()), ints.size()));
+  ASSERT_EQ(added, builder.Count());
+
+  int64_t key;
+  ASSERT_OK(builder.GetLastKey(&key));
+  ASSERT_EQ(ints[added - 1], key);
+
+  Slice s = builder.Finish(0);
+  AdaptiveBlockDecoder<INT64> decoder(s);
+  ASSERT_OK(decoder.ParseHeader());
+  ASSERT_EQ(added, decoder.Count());
+}
+
+TEST_F(TestEncoding, TestAdaptiveEmptyBlockEncodeDecode) {
+  TestEmptyBlockEncodeDecode<AdaptiveBlockBuilder<INT32>, AdaptiveBlockDecoder<INT32> >();
+}
+
 TEST_F(TestEncoding, TestIntBlockEncoder) {
   gscoped_ptr<WriterOptions> opts(NewWriterOptions());
   GVIntBlockBuilder ibb(opts.get());
@@ -707,6 +906,19 @@ TEST_F(TestEncoding, TestRleIntBlockEncoder) {
   ASSERT_EQ(14UL, s.size());
 }
 
+TEST_F(TestEncoding, TestRleIntBlockCopyNextAndEval) {
+  {
+    RleIntBlockBuilder<UINT32> ibb;
+    TestIntBlockCopyNextAndEval<RleIntBlockBuilder<UINT32>, RleIntBlockDecoder<UINT32>, UINT32>(
+        &ibb);
+  }
+  {
+    RleIntBlockBuilder<INT16> ibb;
+    TestIntBlockCopyNextAndEval<RleIntBlockBuilder<INT16>, RleIntBlockDecoder<INT16>, INT16>(
+        &ibb);
+  }
+}
+
 TEST_F(TestEncoding, TestPlainBitMapRoundTrip) {
   TestBoolBlockRoundTrip<PlainBitMapBlockBuilder, PlainBitMapBlockDecoder>();
 }
@@ -746,6 +958,48 @@ TEST_F(TestEncoding, TestBinaryPlainBlockBuilderSeekByValueLargeBlock) {
   TestStringSeekByValueLargeBlock<BinaryPlainBlockBuilder, BinaryPlainBlockDecoder>();
 }
 
+// Test that an unset restart interval is derived from the block size, and
+// that blocks written with it can be seeked.
+TEST_F(TestEncoding, TestBinaryPrefixBlockDerivedRestartInterval) {
+  ASSERT_EQ(4, BinaryPrefixBlockBuilder::RestartIntervalForBlockSize(4 * 1024));
+  ASSERT_EQ(4, BinaryPrefixBlockBuilder::RestartIntervalForBlockSize(64 * 1024));
+  ASSERT_EQ(8, BinaryPrefixBlockBuilder::RestartIntervalForBlockSize(128 * 1024));
+  ASSERT_EQ(16, BinaryPrefixBlockBuilder::RestartIntervalForBlockSize(256 * 1024));
+  ASSERT_EQ(16, BinaryPrefixBlockBuilder::RestartIntervalForBlockSize(1024 * 1024));
+
+  const int kCount = 1000;
+  gscoped_ptr<WriterOptions> opts(NewWriterOptions());
+  opts->storage_attributes.cfile_block_size = 64 * 1024;
+  BinaryPrefixBlockBuilder fixed_sbb(opts.get());
+  size_t fixed_size = CreateBinaryBlock(&fixed_sbb, kCount, "hello %03d").size();
+
+  opts->block_restart_interval = 0;
+  BinaryPrefixBlockBuilder sbb(opts.get());
+  Slice s = CreateBinaryBlock(&sbb, kCount, "hello %03d");
+  // Four times as many restart points, each storing a full key.
+  ASSERT_GT(s.size(), fixed_size);
+
+  BinaryPrefixBlockDecoder sbd(s);
+  ASSERT_OK(sbd.ParseHeader());
+  for (int i = 0; i < 2; i++) {
+    for (int ord = kCount - 1; ord >= 0; ord--) {
+      string target = StringPrintf("hello %03d", ord);
+      Slice q(target);
+      bool exact;
+      ASSERT_OK(sbd.SeekAtOrAfterValue(&q, &exact));
+      ASSERT_TRUE(exact);
+      ASSERT_EQ(ord, sbd.GetCurrentIndex());
+      Slice ret;
+      CopyOne<STRING>(&sbd, &ret);
+      ASSERT_EQ(target, ret.ToString());
+    }
+  }
+  sbd.SeekToPositionInBlock(kCount - 1);
+  Slice ret;
+  CopyOne<STRING>(&sbd, &ret);
+  ASSERT_EQ("hello 999", ret.ToString());
+}
+
 // Test round-trip encode/decode of a binary block.
 TEST_F(TestEncoding, TestBinaryPrefixBlockBuilderRoundTrip) {
   TestBinaryBlockRoundTrip<BinaryPrefixBlockBuilder, BinaryPrefixBlockDecoder>();
@@ -755,6 +1009,45 @@ TEST_F(TestEncoding, TestBinaryPlainBlockBuilderRoundTrip) {
   TestBinaryBlockRoundTrip<BinaryPlainBlockBuilder, BinaryPlainBlockDecoder>();
 }
 
+// Test copying batches of variable-length strings (including empty ones) out
+// of a plain binary block, spanning several calls and a partial final batch.
+TEST_F(TestEncoding, TestBinaryPlainBlockBatchCopy) {
+  gscoped_ptr<WriterOptions> opts(NewWriterOptions());
+  BinaryPlainBlockBuilder sbb(opts.get());
+  const int kCount = 1000;
+  vector<string> strs;
+  vector<Slice> slices;
+  for (int i = 0; i < kCount; i++) {
+    strs.emplace_back(i % 7, 'a' + i % 26);
+  }
+  for (const string& str : strs) {
+    slices.emplace_back(str);
+  }
+  ASSERT_EQ(kCount, sbb.Add(reinterpret_cast<const uint8_t*>(&slices[0]), kCount));
+  Slice s = sbb.Finish(0);
+
+  BinaryPlainBlockDecoder sbd(s);
+  ASSERT_OK(sbd.ParseHeader());
+
+  const int kBatchSize = 64;
+  ScopedColumnBlock<STRING> cb(kBatchSize);
+  int idx = 0;
+  while (sbd.HasNext()) {
+    ColumnDataView cdv(&cb);
+    size_t n = kBatchSize;
+    ASSERT_OK(sbd.CopyNextValues(&n, &cdv));
+    ASSERT_EQ(std::min(kBatchSize, kCount - idx), n);
+    for (int i = 0; i < n; i++, idx++) {
+      ASSERT_EQ(strs[idx], cb[i].ToString()) << "failed at row " << idx;
+    }
+  }
+  ASSERT_EQ(kCount, idx);
+}
+
+TEST_F(TestEncoding, TestBinaryAdaptiveBlockBuilderRoundTrip) {
+  TestBinaryBlockRoundTrip<AdaptiveBlockBuilder<BINARY>, AdaptiveBlockDecoder<BINARY> >();
+}
+
 // Test empty block encode/decode
 TEST_F(TestEncoding, TestBinaryPlainEmptyBlockEncodeDecode) {
   TestEmptyBlockEncodeDecode<BinaryPlainBlockBuilder, BinaryPlainBlockDecoder>();
@@ -824,7 +1117,24 @@ struct BitshuffleTestTraits {
     typedef BShufBlockDecoder<type> decoder_type;
   };
 };
-typedef testing::Types<RleTestTraits, BitshuffleTestTraits, PlainTestTraits> MyTestFixtures;
+
+struct ForTestTraits {
+  template<DataType type>
+  struct Classes {
+    typedef ForBlockBuilder<type> encoder_type;
+    typedef ForBlockDecoder<type> decoder_type;
+  };
+};
+struct AdaptiveTestTraits {
+  template<DataType type>
+  struct Classes {
+    typedef AdaptiveBlockBuilder<type> encoder_type;
+    typedef AdaptiveBlockDecoder<type> decoder_type;
+  };
+};
+
+typedef testing::Types<RleTestTraits, BitshuffleTestTraits, PlainTestTraits,
+                       ForTestTraits, AdaptiveTestTraits> MyTestFixtures;
 TYPED_TEST_CASE(IntEncodingTest, MyTestFixtures);
 
 template<class TestTraits>
@@ -0,0 +1,116 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/cfile/for_block.h"
+
+#include <string.h>
+
+#include "kudu/gutil/port.h"
+
+namespace kudu {
+namespace cfile {
+
+namespace {
+
+typedef void (*UnpackGroupFunc)(const uint8_t* src, uint64_t* dst);
+
+// Unpack kBitPackGroupSize values of kWidth bits each. Since the width is a
+// compile-time constant, every shift and mask below is too.
+template<int kWidth>
+void UnpackGroup(const uint8_t* src, uint64_t* dst) {
+  const uint64_t mask = kWidth == 64 ? ~0ULL : (1ULL << (kWidth % 64)) - 1;
+  for (int i = 0; i < kBitPackGroupSize; i++) {
+    const int bit = i * kWidth;
+    const uint8_t* p = src + bit / 8;
+    const int shift = bit % 8;
+    uint64_t v = UNALIGNED_LOAD64(p) >> shift;
+    if (kWidth + shift > 64) {
+      // The value straddles the 8 bytes loaded above.
+      v |= static_cast<uint64_t>(p[8]) << (64 - shift);
+    }
+    dst[i] = v & mask;
+  }
+}
+
+template<>
+void UnpackGroup<0>(const uint8_t* src, uint64_t* dst) {
+  memset(dst, 0, sizeof(*dst) * kBitPackGroupSize);
+}
+
+// Fills a table of the kernels for every width from 0 to kWidth.
+template<int kWidth>
+struct UnpackGroupTable {
+  static void Fill(UnpackGroupFunc* table) {
+    table[kWidth] = &UnpackGroup<kWidth>;
+    UnpackGroupTable<kWidth - 1>::Fill(table);
+  }
+};
+
+template<>
+struct UnpackGroupTable<-1> {
+  static void Fill(UnpackGroupFunc* table) {}
+};
+
+struct UnpackKernels {
+  UnpackKernels() {
+    UnpackGroupTable<64>::Fill(funcs);
+  }
+  UnpackGroupFunc funcs[65];
+};
+
+const UnpackKernels& GetUnpackKernels() {
+  static const UnpackKernels kernels;
+  return kernels;
+}
+
+} // anonymous namespace
+
+void BitPackValues(const uint64_t* values, size_t num_values, int width, faststring* dst) {
+  DCHECK_LE(width, 64);
+  const size_t old_size = dst->size();
+  const size_t packed_size = BitPackedSize(num_values, width);
+  dst->resize(old_size + packed_size);
+  uint8_t* out = &(*dst)[old_size];
+  memset(out, 0, packed_size);
+  if (width == 0) {
+    return;
+  }
+  for (size_t i = 0; i < num_values; i++) {
+    const uint64_t v = values[i];
+    DCHECK(width == 64 || v >> width == 0) << v << " does not fit in " << width << " bits";
+    const size_t bit = i * width;
+    uint8_t* p = out + bit / 8;
+    const int shift = bit % 8;
+    UNALIGNED_STORE64(p, UNALIGNED_LOAD64(p) | (v << shift));
+    if (width + shift > 64) {
+      p[8] |= static_cast<uint8_t>(v >> (64 - shift));
+    }
+  }
+}
+
+void BitUnpackValues(const uint8_t* src, size_t num_values, int width, uint64_t* values) {
+  DCHECK_LE(width, 64);
+  UnpackGroupFunc unpack = GetUnpackKernels().funcs[width];
+  const size_t group_bytes = kBitPackGroupSize * width / 8;
+  for (size_t i = 0; i < num_values; i += kBitPackGroupSize) {
+    unpack(src, &values[i]);
+    src += group_bytes;
+  }
+}
+
+} // namespace cfile
+} // namespace kudu
@@ -0,0 +1,340 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+//
+// Frame-of-reference encoding for integer blocks.
+//
+// Each value is stored as its difference from the smallest value in the
+// block, bit-packed using as few bits as the largest such difference needs.
+// For columns whose values increase steadily, such as timestamps or
+// sequential IDs, the builder instead packs the differences between
+// consecutive values (relative to the smallest such difference) whenever
+// that takes fewer bits.
+//
+// Header (all little endian):
+// 1. number of elements in the block (uint32_t).
+// 2. ordinal of the first element within the block (uint32_t).
+// 3. mode: kForMode or kForDeltaMode (uint8_t).
+// 4. bit width of the packed values (uint8_t).
+// 5. reference: the smallest value in kForMode, or the first value in
+//    kForDeltaMode (uint64_t).
+// 6. the smallest difference between consecutive values in kForDeltaMode,
+//    or 0 (uint64_t).
+//
+// The header is followed by the packed values (one per element in kForMode,
+// or one per element after the first in kForDeltaMode), in groups of
+// kBitPackGroupSize, the last of which is padded with zeros, and then
+// kBitPackPaddingBytes bytes of padding. See BitPackValues().
+#ifndef KUDU_CFILE_FOR_BLOCK_H
+#define KUDU_CFILE_FOR_BLOCK_H
+
+#include <algorithm>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "kudu/cfile/block_encodings.h"
+#include "kudu/cfile/cfile_util.h"
+#include "kudu/common/columnblock.h"
+#include "kudu/gutil/bits.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/alignment.h"
+#include "kudu/util/coding.h"
+#include "kudu/util/coding-inl.h"
+
+namespace kudu {
+namespace cfile {
+
+// Values are packed and unpacked in groups of this many.
+static const int kBitPackGroupSize = 32;
+
+// The unpacking kernels may read up to this many bytes past the end of the
+// last group.
+static const int kBitPackPaddingBytes = 8;
+
+static const uint8_t kForMode = 0;
+static const uint8_t kForDeltaMode = 1;
+
+static const size_t kForBlockHeaderSize =
+    sizeof(uint32_t) * 2 + sizeof(uint8_t) * 2 + sizeof(uint64_t) * 2;
+
+// Return the number of bytes taken by 'num_values' values packed with 'width'
+// bits each, including padding.
+inline size_t BitPackedSize(size_t num_values, int width) {
+  size_t num_groups = (num_values + kBitPackGroupSize - 1) / kBitPackGroupSize;
+  return num_groups * kBitPackGroupSize * width / 8 + kBitPackPaddingBytes;
+}
+
+// Append 'num_values' values from 'values', each of which must fit in 'width'
+// bits, to 'dst' in their bit-packed form.
+void BitPackValues(const uint64_t* values, size_t num_values, int width, faststring* dst);
+
+// Unpack the first 'num_values' values of width 'width' bits from 'src' into
+// 'values', which must have room for 'num_values' rounded up to a multiple of
+// kBitPackGroupSize. Each group of values is unpacked by a kernel specialized
+// for its bit width, which the compiler can unroll and vectorize.
+void BitUnpackValues(const uint8_t* src, size_t num_values, int width, uint64_t* values);
+
+// Return the number of bits needed to store 'v'.
+inline int BitWidth(uint64_t v) {
+  return v == 0 ? 0 : Bits::Log2Floor64(v) + 1;
+}
+
+//
+// A frame-of-reference encoder for integer types.
+//
+template<DataType Type>
+class ForBlockBuilder : public BlockBuilder {
+ public:
+  explicit ForBlockBuilder(const WriterOptions* options)
+      : options_(options) {
+    Reset();
+  }
+
+  virtual void Reset() OVERRIDE {
+    values_.clear();
+    values_.reserve(options_->storage_attributes.cfile_block_size / kCppTypeSize);
+    buffer_.clear();
+  }
+
+  virtual bool IsBlockFull(size_t limit) const OVERRIDE {
+    return values_.size() * kCppTypeSize > limit;
+  }
+
+  virtual int Add(const uint8_t* vals_void, size_t count) OVERRIDE {
+    const CppType* vals = reinterpret_cast<const CppType*>(vals_void);
+    values_.insert(values_.end(), vals, vals + count);
+    return count;
+  }
+
+  virtual Slice Finish(rowid_t ordinal_pos) OVERRIDE {
+    const size_t n = values_.size();
+    buffer_.resize(kForBlockHeaderSize);
+    InlineEncodeFixed32(&buffer_[0], n);
+    InlineEncodeFixed32(&buffer_[4], ordinal_pos);
+
+    // All arithmetic happens on the values sign-extended to 64 bits, modulo
+    // 2^64, which makes decoding exact even when the differences overflow.
+    int64_t min = 0;
+    int64_t max = 0;
+    int64_t min_delta = 0;
+    int64_t max_delta = 0;
+    for (size_t i = 0; i < n; i++) {
+      int64_t v = values_[i];
+      if (i == 0 || v < min) min = v;
+      if (i == 0 || v > max) max = v;
+      if (i > 0) {
+        int64_t delta = static_cast<int64_t>(Unsigned(v) - Unsigned(values_[i - 1]));
+        if (i == 1 || delta < min_delta) min_delta = delta;
+        if (i == 1 || delta > max_delta) max_delta = delta;
+      }
+    }
+    const int for_width = BitWidth(Unsigned(max) - Unsigned(min));
+    const int delta_width = BitWidth(Unsigned(max_delta) - Unsigned(min_delta));
+
+    packed_.clear();
+    uint8_t mode;
+    int width;
+    uint64_t reference;
+    if (n > 1 && delta_width < for_width) {
+      mode = kForDeltaMode;
+      width = delta_width;
+      reference = Unsigned(values_[0]);
+      for (size_t i = 1; i < n; i++) {
+        packed_.push_back(Unsigned(values_[i]) - Unsigned(values_[i - 1]) - Unsigned(min_delta));
+      }
+    } else {
+      mode = kForMode;
+      width = for_width;
+      reference = Unsigned(min);
+      min_delta = 0;
+      for (size_t i = 0; i < n; i++) {
+        packed_.push_back(Unsigned(values_[i]) - reference);
+      }
+    }
+    buffer_[8] = mode;
+    buffer_[9] = width;
+    InlineEncodeFixed64(&buffer_[10], reference);
+    InlineEncodeFixed64(&buffer_[18], Unsigned(min_delta));
+    BitPackValues(packed_.data(), packed_.size(), width, &buffer_);
+    return Slice(buffer_);
+  }
+
+  virtual size_t Count() const OVERRIDE {
+    return values_.size();
+  }
+
+  virtual Status GetFirstKey(void* key) const OVERRIDE {
+    if (values_.empty()) {
+      return Status::NotFound("no keys in data block");
+    }
+    *reinterpret_cast<CppType*>(key) = values_.front();
+    return Status::OK();
+  }
+
+  virtual Status GetLastKey(void* key) const OVERRIDE {
+    if (values_.empty()) {
+      return Status::NotFound("no keys in data block");
+    }
+    *reinterpret_cast<CppType*>(key) = values_.back();
+    return Status::OK();
+  }
+
+ private:
+  typedef typename TypeTraits<Type>::cpp_type CppType;
+  enum {
+    kCppTypeSize = TypeTraits<Type>::size
+  };
+
+  static uint64_t Unsigned(int64_t v) {
+    return static_cast<uint64_t>(v);
+  }
+
+  const WriterOptions* options_;
+  std::vector<CppType> values_;
+  std::vector<uint64_t> packed_;
+  faststring buffer_;
+};
+
+//
+// A frame-of-reference decoder for integer types.
+//
+// The whole block is decoded when the header is parsed, after which seeks
+// and copies work on the decoded values.
+//
+template<DataType Type>
+class ForBlockDecoder : public BlockDecoder {
+ public:
+  explicit ForBlockDecoder(Slice slice)
+      : data_(std::move(slice)),
+        parsed_(false),
+        num_elems_(0),
+        ordinal_pos_base_(0),
+        cur_idx_(0) {
+  }
+
+  virtual Status ParseHeader() OVERRIDE {
+    CHECK(!parsed_);
+    if (data_.size() < kForBlockHeaderSize) {
+      return Status::Corruption(
+          strings::Substitute("not enough bytes for header: size $0", data_.size()));
+    }
+    num_elems_ = DecodeFixed32(&data_[0]);
+    ordinal_pos_base_ = DecodeFixed32(&data_[4]);
+    const uint8_t mode = data_[8];
+    const int width = data_[9];
+    const uint64_t reference = DecodeFixed64(&data_[10]);
+    const uint64_t min_delta = DecodeFixed64(&data_[18]);
+    if (mode != kForMode && mode != kForDeltaMode) {
+      return Status::Corruption(strings::Substitute("bad mode $0", mode));
+    }
+    if (width > 64) {
+      return Status::Corruption(strings::Substitute("bad bit width $0", width));
+    }
+    const size_t num_packed =
+        (mode == kForDeltaMode && num_elems_ > 0) ? num_elems_ - 1 : num_elems_;
+    if (data_.size() != kForBlockHeaderSize + BitPackedSize(num_packed, width)) {
+      return Status::Corruption(
+          strings::Substitute("unexpected data size $0 for $1 values of width $2",
+                              data_.size(), num_elems_, width));
+    }
+
+    std::vector<uint64_t> unpacked(
+        KUDU_ALIGN_UP(num_packed, kBitPackGroupSize));
+    BitUnpackValues(&data_[kForBlockHeaderSize], num_packed, width, unpacked.data());
+    values_.resize(num_elems_);
+    if (mode == kForMode) {
+      for (size_t i = 0; i < num_elems_; i++) {
+        values_[i] = static_cast<CppType>(reference + unpacked[i]);
+      }
+    } else if (num_elems_ > 0) {
+      uint64_t v = reference;
+      values_[0] = static_cast<CppType>(v);
+      for (size_t i = 1; i < num_elems_; i++) {
+        v += min_delta + unpacked[i - 1];
+        values_[i] = static_cast<CppType>(v);
+      }
+    }
+
+    parsed_ = true;
+    SeekToPositionInBlock(0);
+    return Status::OK();
+  }
+
+  virtual void SeekToPositionInBlock(uint pos) OVERRIDE {
+    CHECK(parsed_) << "Must call ParseHeader()";
+    DCHECK_LE(pos, num_elems_);
+    cur_idx_ = pos;
+  }
+
+  virtual Status SeekAtOrAfterValue(const void* value, bool* exact_match) OVERRIDE {
+    DCHECK(value != nullptr);
+    const CppType target = *reinterpret_cast<const CppType*>(value);
+    auto it = std::lower_bound(values_.begin(), values_.end(), target);
+    cur_idx_ = it - values_.begin();
+    if (it == values_.end()) {
+      *exact_match = false;
+      return Status::NotFound("after last key in block");
+    }
+    *exact_match = *it == target;
+    return Status::OK();
+  }
+
+  virtual Status CopyNextValues(size_t* n, ColumnDataView* dst) OVERRIDE {
+    DCHECK(parsed_);
+    DCHECK_LE(*n, dst->nrows());
+    DCHECK_EQ(dst->stride(), sizeof(CppType));
+
+    size_t max_fetch = std::min(*n, static_cast<size_t>(num_elems_ - cur_idx_));
+    if (max_fetch > 0) {
+      memcpy(dst->data(), &values_[cur_idx_], max_fetch * sizeof(CppType));
+    }
+    cur_idx_ += max_fetch;
+    *n = max_fetch;
+    return Status::OK();
+  }
+
+  virtual bool HasNext() const OVERRIDE {
+    return cur_idx_ < num_elems_;
+  }
+
+  virtual size_t Count() const OVERRIDE {
+    return num_elems_;
+  }
+
+  virtual size_t GetCurrentIndex() const OVERRIDE {
+    return cur_idx_;
+  }
+
+  virtual rowid_t GetFirstRowId() const OVERRIDE {
+    return ordinal_pos_base_;
+  }
+
+ private:
+  typedef typename TypeTraits<Type>::cpp_type CppType;
+
+  Slice data_;
+  bool parsed_;
+  uint32_t num_elems_;
+  rowid_t ordinal_pos_base_;
+  uint32_t cur_idx_;
+  std::vector<CppType> values_;
+};
+
+} // namespace cfile
+} // namespace kudu
+
+#endif
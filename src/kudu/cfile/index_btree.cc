@@ -17,6 +17,8 @@
 
 #include <vector>
 
+#include <gflags/gflags.h>
+
 #include "kudu/cfile/block_cache.h"
 #include "kudu/cfile/cfile_reader.h"
 #include "kudu/cfile/cfile_writer.h"
@@ -24,6 +26,8 @@
 #include "kudu/common/key_encoder.h"
 #include "kudu/util/debug-util.h"
 
+DECLARE_bool(cfile_pin_index_upper_levels);
+
 namespace kudu {
 namespace cfile {
 
@@ -267,12 +271,27 @@ Status IndexTreeIterator::LoadBlock(const BlockPointer &block, int depth) {
     seeked = seeked_indexes_.back().get();
   }
 
-  RETURN_NOT_OK(reader_->ReadBlock(block, CFileReader::CACHE_BLOCK, &seeked->data));
+  bool pinned = reader_->LookupPinnedIndexBlock(block, &seeked->data);
+  if (!pinned) {
+    RETURN_NOT_OK(reader_->ReadBlock(block, CFileReader::CACHE_BLOCK, &seeked->data));
+  }
   seeked->block_ptr = block;
 
   // Parse the new block.
   RETURN_NOT_OK(seeked->reader.Parse(seeked->data.data()));
 
+  // Every seek goes through the root and the internal blocks, so keep them
+  // in memory for as long as the file is open, leaving the block cache to
+  // the leaves and the data blocks.
+  if (!pinned && FLAGS_cfile_pin_index_upper_levels &&
+      (depth == 0 || !seeked->reader.IsLeaf())) {
+    BlockHandle pinned_data;
+    reader_->PinIndexBlock(block, seeked->data.data(), &pinned_data);
+    seeked->reader.Reset();
+    seeked->data = std::move(pinned_data);
+    RETURN_NOT_OK(seeked->reader.Parse(seeked->data.data()));
+  }
+
   return Status::OK();
 }
 
@@ -404,6 +404,45 @@ class RleIntBlockDecoder : public BlockDecoder {
     return Status::OK();
   }
 
+  // Evaluates the predicate once per run of identical values rather than once
+  // per row. Runs which do not match the predicate are skipped without being
+  // copied into 'dst'.
+  virtual Status CopyNextAndEval(size_t* n,
+                                 ColumnMaterializationContext* ctx,
+                                 SelectionVectorView* sel,
+                                 ColumnDataView* dst) OVERRIDE {
+    DCHECK(parsed_);
+    DCHECK_LE(*n, dst->nrows());
+    DCHECK_EQ(dst->stride(), sizeof(CppType));
+
+    ctx->SetDecoderEvalSupported();
+    if (PREDICT_FALSE(*n == 0 || cur_idx_ >= num_elems_)) {
+      *n = 0;
+      return Status::OK();
+    }
+
+    size_t to_fetch = std::min(*n, static_cast<size_t>(num_elems_ - cur_idx_));
+    size_t remaining = to_fetch;
+    size_t row_idx = 0;
+    CppType* out = reinterpret_cast<CppType*>(dst->data());
+    while (remaining > 0) {
+      CppType val;
+      size_t run_length = rle_decoder_.GetNextRun(&val, remaining);
+      DCHECK_GT(run_length, 0);
+      if (ctx->pred()->EvaluateCell<IntType>(&val)) {
+        std::fill(out + row_idx, out + row_idx + run_length, val);
+      } else {
+        sel->ClearBits(row_idx, run_length);
+      }
+      remaining -= run_length;
+      row_idx += run_length;
+    }
+
+    cur_idx_ += to_fetch;
+    *n = to_fetch;
+    return Status::OK();
+  }
+
   virtual bool HasNext() const OVERRIDE {
     return cur_idx_ < num_elems_;
   }
@@ -22,7 +22,9 @@
 
 #include <glog/logging.h>
 
+#include "kudu/cfile/adaptive_block.h"
 #include "kudu/cfile/bshuf_block.h"
+#include "kudu/cfile/for_block.h"
 #include "kudu/cfile/gvint_block.h"
 #include "kudu/cfile/plain_bitmap_block.h"
 #include "kudu/cfile/plain_block.h"
@@ -85,6 +87,38 @@ struct DataTypeEncodingTraits<Type, BIT_SHUFFLE> {
   }
 };
 
+// Frame-of-reference encoding for integer types.
+template<DataType IntType>
+struct DataTypeEncodingTraits<IntType, FRAME_OF_REFERENCE> {
+
+  static Status CreateBlockBuilder(BlockBuilder **bb, const WriterOptions *options) {
+    *bb = new ForBlockBuilder<IntType>(options);
+    return Status::OK();
+  }
+
+  static Status CreateBlockDecoder(BlockDecoder **bd, const Slice &slice,
+                                   CFileIterator *iter) {
+    *bd = new ForBlockDecoder<IntType>(slice);
+    return Status::OK();
+  }
+};
+
+// Adaptive encoding, which picks one of the other encodings for each block.
+template<DataType Type>
+struct DataTypeEncodingTraits<Type, ADAPTIVE_ENCODING> {
+
+  static Status CreateBlockBuilder(BlockBuilder **bb, const WriterOptions *options) {
+    *bb = new AdaptiveBlockBuilder<Type>(options);
+    return Status::OK();
+  }
+
+  static Status CreateBlockDecoder(BlockDecoder **bd, const Slice &slice,
+                                   CFileIterator *iter) {
+    *bd = new AdaptiveBlockDecoder<Type>(slice);
+    return Status::OK();
+  }
+};
+
 // Template specialization for plain encoded string as they require a
 // specific encoder/decoder.
 template<>
@@ -235,14 +269,16 @@ class TypeEncodingResolver {
     if (e == AUTO_ENCODING) {
       e = GetDefaultEncoding(t);
     }
-    const TypeEncodingInfo *type_info = mapping_[make_pair(t, e)].get();
-    if (PREDICT_FALSE(type_info == nullptr)) {
+    // Don't use operator[] here: it would insert entries for unsupported
+    // pairs, and the resolver is shared between threads.
+    auto it = mapping_.find(make_pair(t, e));
+    if (PREDICT_FALSE(it == mapping_.end())) {
       return Status::NotSupported(
           strings::Substitute("Unsupported type/encoding pair: $0, $1",
                               DataType_Name(t),
                               EncodingType_Name(e)));
     }
-    *out = type_info;
+    *out = it->second.get();
     return Status::OK();
   }
 
@@ -278,10 +314,12 @@ class TypeEncodingResolver {
     AddMapping<INT32, PLAIN_ENCODING>();
     AddMapping<INT32, RLE>();
     AddMapping<INT32, BIT_SHUFFLE>();
+    AddMapping<INT32, FRAME_OF_REFERENCE>();
     AddMapping<UINT64, PLAIN_ENCODING>();
     AddMapping<UINT64, BIT_SHUFFLE>();
     AddMapping<INT64, PLAIN_ENCODING>();
     AddMapping<INT64, BIT_SHUFFLE>();
+    AddMapping<INT64, FRAME_OF_REFERENCE>();
     AddMapping<FLOAT, PLAIN_ENCODING>();
     AddMapping<FLOAT, BIT_SHUFFLE>();
     AddMapping<DOUBLE, PLAIN_ENCODING>();
@@ -291,6 +329,20 @@ class TypeEncodingResolver {
     AddMapping<BINARY, DICT_ENCODING>();
     AddMapping<BOOL, RLE>();
     AddMapping<BOOL, PLAIN_ENCODING>();
+
+    // Adaptive encoding is never the default, so these must come after
+    // the mappings above.
+    AddMapping<UINT8, ADAPTIVE_ENCODING>();
+    AddMapping<INT8, ADAPTIVE_ENCODING>();
+    AddMapping<UINT16, ADAPTIVE_ENCODING>();
+    AddMapping<INT16, ADAPTIVE_ENCODING>();
+    AddMapping<UINT32, ADAPTIVE_ENCODING>();
+    AddMapping<INT32, ADAPTIVE_ENCODING>();
+    AddMapping<UINT64, ADAPTIVE_ENCODING>();
+    AddMapping<INT64, ADAPTIVE_ENCODING>();
+    AddMapping<FLOAT, ADAPTIVE_ENCODING>();
+    AddMapping<DOUBLE, ADAPTIVE_ENCODING>();
+    AddMapping<BINARY, ADAPTIVE_ENCODING>();
   }
 
   template<DataType type, EncodingType encoding> void AddMapping() {
@@ -52,6 +52,7 @@
 #include "kudu/tserver/tserver_service.proxy.h"
 #include "kudu/util/debug-util.h"
 #include "kudu/util/logging.h"
+#include "kudu/util/mem_tracker.h"
 
 using std::pair;
 using std::set;
@@ -123,7 +124,9 @@ struct InFlightOp {
     // MetaCache to perform an RPC to the master and find the correct tablet.
     //
     // OWNERSHIP: the op is present in the 'ops_' set, and also referenced by the
-    // in-flight callback provided to MetaCache.
+    // in-flight callback provided to MetaCache. If the tablet is found in the
+    // batcher's routed tablets or the MetaCache without a lookup, the op moves
+    // to the next state under the batcher lock, and no callback is involved.
     kLookingUpTablet,
 
     // Once the correct tablet has been determined, and the tablet locations have been
@@ -181,6 +184,16 @@ struct InFlightOp {
   }
 };
 
+namespace {
+
+// Return 'write_op' as a chunk of columnar inserts, or nullptr if it is
+// a row operation.
+const ColumnarInsertChunk* AsColumnarInsertChunk(const KuduWriteOperation* write_op) {
+  return dynamic_cast<const ColumnarInsertChunk*>(write_op);
+}
+
+} // anonymous namespace
+
 // A Write RPC which is in-flight to a tablet. Initially, the RPC is sent
 // to the leader replica, but it may be retried with another replica if the
 // leader fails.
@@ -223,6 +236,16 @@ class WriteRpc : public RetriableRpc<RemoteTabletServer, WriteRequestPB, WriteRe
 
   // The id of the tablet being written to.
   string tablet_id_;
+
+  // Whether any of the operations is a chunk of columnar inserts, which
+  // requires a tablet server that supports them.
+  bool has_columnar_inserts_;
+
+  // The replica the current attempt was sent to and when, so that its
+  // latency may be recorded once the attempt completes. Null when no attempt
+  // is in flight.
+  RemoteTabletServer* current_ts_;
+  MonoTime sent_time_;
 };
 
 WriteRpc::WriteRpc(const scoped_refptr<Batcher>& batcher,
@@ -235,7 +258,9 @@ WriteRpc::WriteRpc(const scoped_refptr<Batcher>& batcher,
     : RetriableRpc(replica_picker, request_tracker, deadline, messenger),
       batcher_(batcher),
       ops_(std::move(ops)),
-      tablet_id_(tablet_id) {
+      tablet_id_(tablet_id),
+      has_columnar_inserts_(false),
+      current_ts_(nullptr) {
   const Schema* schema = table()->schema().schema_;
 
   req_.set_tablet_id(tablet_id_);
@@ -272,7 +297,13 @@ WriteRpc::WriteRpc(const scoped_refptr<Batcher>& batcher,
         << " not in partition " << partition_schema.PartitionDebugString(partition, *schema);
 #endif
 
-    enc.Add(ToInternalWriteType(op->write_op->type()), op->write_op->row());
+    const ColumnarInsertChunk* chunk = AsColumnarInsertChunk(op->write_op.get());
+    if (chunk) {
+      enc.AddColumnarInserts(*schema, chunk->rows(), chunk->row_idxs());
+      has_columnar_inserts_ = true;
+    } else {
+      enc.Add(ToInternalWriteType(op->write_op->type()), op->write_op->row());
+    }
 
     // Set the state now, even though we haven't yet sent it -- at this point
     // there is no return, and we're definitely going to send it. If we waited
@@ -288,7 +319,11 @@ WriteRpc::WriteRpc(const scoped_refptr<Batcher>& batcher,
 }
 
 WriteRpc::~WriteRpc() {
-  STLDeleteElements(&ops_);
+  // The ops' memory belongs to the batcher, which 'batcher_' keeps alive
+  // until after this destructor's body has run.
+  for (InFlightOp* op : ops_) {
+    Batcher::DestroyInFlightOp(op);
+  }
 }
 
 string WriteRpc::ToString() const {
@@ -298,6 +333,13 @@ string WriteRpc::ToString() const {
 
 void WriteRpc::Try(RemoteTabletServer* replica, const ResponseCallback& callback) {
   VLOG(2) << "Tablet " << tablet_id_ << ": Writing batch to replica " << replica->ToString();
+  if (has_columnar_inserts_) {
+    mutable_retrier()->mutable_controller()->RequireServerFeature(
+        tserver::TabletServerFeatures::COLUMNAR_INSERTS);
+  }
+  current_ts_ = replica;
+  sent_time_ = MonoTime::Now();
+  replica->RpcStarted();
   replica->proxy()->WriteAsync(req_, &resp_,
                                mutable_retrier()->mutable_controller(),
                                callback);
@@ -325,14 +367,24 @@ RetriableRpcStatus WriteRpc::AnalyzeResponse(const Status& rpc_cb_status) {
     result.status = mutable_retrier()->controller().status();
   }
 
+  bool server_busy = false;
   if (result.status.IsRemoteError()) {
     const ErrorStatusPB* err = mutable_retrier()->controller().error_response();
-    if (err &&
+    server_busy = err &&
         err->has_code() &&
-        err->code() == ErrorStatusPB::ERROR_SERVER_TOO_BUSY) {
-      result.result = RetriableRpcStatus::SERVER_BUSY;
-      return result;
-    }
+        err->code() == ErrorStatusPB::ERROR_SERVER_TOO_BUSY;
+  }
+
+  if (current_ts_) {
+    current_ts_->RpcFinished(sent_time_, server_busy ||
+                             result.status.IsNetworkError() ||
+                             result.status.IsTimedOut());
+    current_ts_ = nullptr;
+  }
+
+  if (server_busy) {
+    result.result = RetriableRpcStatus::SERVER_BUSY;
+    return result;
   }
 
   // Failover to a replica in the event of any network failure or of a DNS resolution problem.
@@ -391,11 +443,17 @@ Batcher::Batcher(KuduClient* client,
     next_op_sequence_number_(0),
     timeout_(MonoDelta::FromSeconds(60)),
     outstanding_lookups_(0),
-    buffer_bytes_used_(0) {
+    buffer_bytes_used_(0),
+    op_arena_(4 * 1024, 1024 * 1024) {
 }
 
 void Batcher::Abort() {
   std::unique_lock<simple_spinlock> l(lock_);
+  if (state_ != kFlushed) {
+    // The batcher won't finish flushing, so return the memory of its
+    // operations to the client here.
+    client_->data_->mem_tracker_->Release(buffer_bytes_used());
+  }
   state_ = kAborted;
 
   vector<InFlightOp*> to_abort;
@@ -462,6 +520,9 @@ void Batcher::CheckForFinishedFlush() {
     state_ = kFlushed;
   }
 
+  // The memory of the operations is returned to the client even if the
+  // session is gone, and before waking up the session's waiters.
+  client_->data_->mem_tracker_->Release(buffer_bytes_used());
   if (session) {
     // Important to do this outside of the lock so that we don't have
     // a lock inversion deadlock -- the session lock should always
@@ -504,16 +565,56 @@ void Batcher::FlushAsync(KuduStatusCallback* cb) {
   FlushBuffersIfReady();
 }
 
+Status Batcher::GetPartitionKey(KuduWriteOperation* write_op, string* partition_key) {
+  return write_op->table_->partition_schema().EncodeKey(write_op->row(), partition_key);
+}
+
 Status Batcher::Add(KuduWriteOperation* write_op) {
-  // As soon as we get the op, start looking up where it belongs,
-  // so that when the user calls Flush, we are ready to go.
-  gscoped_ptr<InFlightOp> op(new InFlightOp());
   string partition_key;
-  RETURN_NOT_OK(write_op->table_->partition_schema().EncodeKey(write_op->row(), &partition_key));
+  RETURN_NOT_OK(GetPartitionKey(write_op, &partition_key));
+  Add(write_op, std::move(partition_key));
+  return Status::OK();
+}
+
+void Batcher::Add(KuduWriteOperation* write_op, string partition_key) {
+  InFlightOp* op = NewInFlightOp();
   op->write_op.reset(write_op);
   op->state = InFlightOp::kLookingUpTablet;
+  const KuduTable* table = write_op->table();
+  int64_t size_in_buffer = write_op->SizeInBuffer();
+
+  // Fast path: if the tablet hosting the op is already known, either because
+  // an earlier op of this batch was routed to it or from the MetaCache, route
+  // the op right away. This avoids an asynchronous lookup and its callback
+  // for each op.
+  {
+    std::lock_guard<simple_spinlock> l(lock_);
+    RemoteTablet* tablet = FindRoutedTabletUnlocked(table, partition_key);
+    if (tablet) {
+      op->tablet = tablet;
+      AddInFlightOpUnlocked(op);
+      BufferInFlightOpUnlocked(op);
+      buffer_bytes_used_.IncrementBy(size_in_buffer);
+      return;
+    }
+  }
+  scoped_refptr<RemoteTablet> tablet;
+  if (client_->data_->meta_cache_->LookupCachedTabletByKey(table, partition_key, &tablet)) {
+    std::lock_guard<simple_spinlock> l(lock_);
+    AddRoutedTabletUnlocked(write_op->table_, tablet);
+    op->tablet = std::move(tablet);
+    AddInFlightOpUnlocked(op);
+    BufferInFlightOpUnlocked(op);
+    buffer_bytes_used_.IncrementBy(size_in_buffer);
+    return;
+  }
 
-  AddInFlightOp(op.get());
+  // As soon as we get the op, start looking up where it belongs,
+  // so that when the user calls Flush, we are ready to go.
+  {
+    std::lock_guard<simple_spinlock> l(lock_);
+    AddInFlightOpUnlocked(op);
+  }
   VLOG(3) << "Looking up tablet for " << op->write_op->ToString();
   // Increment our reference count for the outstanding callback.
   //
@@ -526,18 +627,23 @@ Status Batcher::Add(KuduWriteOperation* write_op) {
       std::move(partition_key),
       deadline,
       &op->tablet,
-      Bind(&Batcher::TabletLookupFinished, this, op.get()));
-  IgnoreResult(op.release());
+      Bind(&Batcher::TabletLookupFinished, this, op));
 
-  buffer_bytes_used_.IncrementBy(write_op->SizeInBuffer());
+  buffer_bytes_used_.IncrementBy(size_in_buffer);
+}
 
-  return Status::OK();
+InFlightOp* Batcher::NewInFlightOp() {
+  void* mem = op_arena_.AllocateBytesAligned(sizeof(InFlightOp), alignof(InFlightOp));
+  CHECK(mem) << "Could not allocate an in-flight op";
+  return new (mem) InFlightOp();
 }
 
-void Batcher::AddInFlightOp(InFlightOp* op) {
-  DCHECK_EQ(op->state, InFlightOp::kLookingUpTablet);
+void Batcher::DestroyInFlightOp(InFlightOp* op) {
+  op->~InFlightOp();
+}
 
-  std::lock_guard<simple_spinlock> l(lock_);
+void Batcher::AddInFlightOpUnlocked(InFlightOp* op) {
+  DCHECK_EQ(op->state, InFlightOp::kLookingUpTablet);
   CHECK_EQ(state_, kGatheringOps);
   InsertOrDie(&ops_, op);
   op->sequence_number_ = next_op_sequence_number_++;
@@ -565,10 +671,21 @@ void Batcher::MarkInFlightOpFailed(InFlightOp* op, const Status& s) {
 void Batcher::MarkInFlightOpFailedUnlocked(InFlightOp* op, const Status& s) {
   CHECK_EQ(1, ops_.erase(op))
     << "Could not remove op " << op->ToString() << " from in-flight list";
-  gscoped_ptr<KuduError> error(new KuduError(op->write_op.release(), s));
-  error_collector_->AddError(std::move(error));
+  AddWriteOpError(std::move(op->write_op), s);
   had_errors_ = true;
-  delete op;
+  DestroyInFlightOp(op);
+}
+
+void Batcher::AddWriteOpError(gscoped_ptr<KuduWriteOperation> write_op, const Status& s) {
+  const ColumnarInsertChunk* chunk = AsColumnarInsertChunk(write_op.get());
+  if (!chunk) {
+    error_collector_->AddError(gscoped_ptr<KuduError>(new KuduError(write_op.release(), s)));
+    return;
+  }
+  for (int i = 0; i < chunk->row_idxs().size(); i++) {
+    error_collector_->AddError(
+        gscoped_ptr<KuduError>(new KuduError(chunk->NewInsertForRow(i), s)));
+  }
 }
 
 void Batcher::TabletLookupFinished(InFlightOp* op, const Status& s) {
@@ -606,38 +723,83 @@ void Batcher::TabletLookupFinished(InFlightOp* op, const Status& s) {
     return;
   }
 
-  {
-    std::lock_guard<simple_spinlock> l2(op->lock_);
-    CHECK_EQ(op->state, InFlightOp::kLookingUpTablet);
-    CHECK(op->tablet != NULL);
+  CHECK(op->tablet != NULL);
+  AddRoutedTabletUnlocked(op->write_op->table_, op->tablet);
+  BufferInFlightOpUnlocked(op);
 
-    op->state = InFlightOp::kBufferedToTabletServer;
+  l.unlock();
 
-    vector<InFlightOp*>& to_ts = per_tablet_ops_[op->tablet.get()];
-    to_ts.push_back(op);
+  FlushBuffersIfReady();
+}
 
-    // "Reverse bubble sort" the operation into the right spot in the tablet server's
-    // buffer, based on the sequence numbers of the ops.
-    //
-    // There is a rare race (KUDU-743) where two operations in the same batch can get
-    // their order inverted with respect to the order that the user originally performed
-    // the operations. This loop re-sequences them back into the correct order. In
-    // the common case, it will break on the first iteration, so we expect the loop to be
-    // constant time, with worst case O(n). This is usually much better than something
-    // like a priority queue which would have O(lg n) in every case and a more complex
-    // code path.
-    for (int i = to_ts.size() - 1; i > 0; --i) {
-      if (to_ts[i]->sequence_number_ < to_ts[i - 1]->sequence_number_) {
-        std::swap(to_ts[i], to_ts[i - 1]);
-      } else {
-        break;
-      }
+void Batcher::BufferInFlightOpUnlocked(InFlightOp* op) {
+  std::lock_guard<simple_spinlock> l(op->lock_);
+  CHECK_EQ(op->state, InFlightOp::kLookingUpTablet);
+  op->state = InFlightOp::kBufferedToTabletServer;
+
+  vector<InFlightOp*>& to_ts = per_tablet_ops_[op->tablet.get()];
+  to_ts.push_back(op);
+
+  // "Reverse bubble sort" the operation into the right spot in the tablet server's
+  // buffer, based on the sequence numbers of the ops.
+  //
+  // There is a rare race (KUDU-743) where two operations in the same batch can get
+  // their order inverted with respect to the order that the user originally performed
+  // the operations. This loop re-sequences them back into the correct order. In
+  // the common case, it will break on the first iteration, so we expect the loop to be
+  // constant time, with worst case O(n). This is usually much better than something
+  // like a priority queue which would have O(lg n) in every case and a more complex
+  // code path.
+  for (int i = to_ts.size() - 1; i > 0; --i) {
+    if (to_ts[i]->sequence_number_ < to_ts[i - 1]->sequence_number_) {
+      std::swap(to_ts[i], to_ts[i - 1]);
+    } else {
+      break;
     }
   }
+}
 
-  l.unlock();
+RemoteTablet* Batcher::FindRoutedTabletUnlocked(const KuduTable* table,
+                                                const string& partition_key) const {
+  const RoutedTablets* routed = FindOrNull(routed_tablets_, table);
+  if (!routed) {
+    return nullptr;
+  }
+  const vector<scoped_refptr<RemoteTablet>>* tablets = &routed->tablets;
+  // Find the last tablet which starts at or before 'partition_key'.
+  auto it = std::upper_bound(tablets->begin(), tablets->end(), partition_key,
+                             [](const string& key, const scoped_refptr<RemoteTablet>& t) {
+                               return key < t->partition().partition_key_start();
+                             });
+  if (it == tablets->begin()) {
+    return nullptr;
+  }
+  RemoteTablet* tablet = (--it)->get();
+  const string& end = tablet->partition().partition_key_end();
+  if ((!end.empty() && partition_key >= end) || tablet->stale()) {
+    return nullptr;
+  }
+  return tablet;
+}
 
-  FlushBuffersIfReady();
+void Batcher::AddRoutedTabletUnlocked(const sp::shared_ptr<KuduTable>& table,
+                                      const scoped_refptr<RemoteTablet>& tablet) {
+  RoutedTablets& routed = routed_tablets_[table.get()];
+  if (!routed.table) {
+    routed.table = table;
+  }
+  vector<scoped_refptr<RemoteTablet>>& tablets = routed.tablets;
+  const string& start = tablet->partition().partition_key_start();
+  auto it = std::lower_bound(tablets.begin(), tablets.end(), start,
+                             [](const scoped_refptr<RemoteTablet>& t, const string& key) {
+                               return t->partition().partition_key_start() < key;
+                             });
+  if (it != tablets.end() && (*it)->partition().partition_key_start() == start) {
+    // Either the same tablet, or one which replaced a stale tablet.
+    *it = tablet;
+    return;
+  }
+  tablets.insert(it, tablet);
 }
 
 void Batcher::FlushBuffersIfReady() {
@@ -707,15 +869,32 @@ void Batcher::ProcessWriteResponse(const WriteRpc& rpc,
   // "aborted" state.
   CHECK_EQ(state_, kFlushing);
 
+  // The index of the first row of each op in the request, since a chunk of
+  // columnar inserts is sent as several rows.
+  vector<int> op_first_rows;
+  int num_rows = rpc.ops().size();
+  if (rpc.resp().per_row_errors_size() > 0) {
+    num_rows = 0;
+    op_first_rows.reserve(rpc.ops().size());
+    for (InFlightOp* op : rpc.ops()) {
+      op_first_rows.push_back(num_rows);
+      const ColumnarInsertChunk* chunk = AsColumnarInsertChunk(op->write_op.get());
+      num_rows += chunk ? chunk->row_idxs().size() : 1;
+    }
+  }
+
   if (s.ok()) {
     if (rpc.resp().has_timestamp()) {
       client_->data_->UpdateLatestObservedTimestamp(rpc.resp().timestamp());
     }
+    if (rpc.resp().has_schema_version()) {
+      client_->data_->NoteTableSchemaVersion(rpc.table()->name(),
+                                             rpc.resp().schema_version());
+    }
   } else {
     // Mark each of the rows in the write op as failed, since the whole RPC failed.
     for (InFlightOp* op : rpc.ops()) {
-      gscoped_ptr<KuduError> error(new KuduError(op->write_op.release(), s));
-      error_collector_->AddError(std::move(error));
+      AddWriteOpError(std::move(op->write_op), s);
     }
 
     MarkHadErrors();
@@ -736,14 +915,23 @@ void Batcher::ProcessWriteResponse(const WriteRpc& rpc,
     // TODO: handle case where we get one of the more specific TS errors
     // like the tablet not being hosted?
 
-    if (err_pb.row_index() >= rpc.ops().size()) {
+    if (err_pb.row_index() >= num_rows) {
       LOG(ERROR) << "Received a per_row_error for an out-of-bound op index "
                  << err_pb.row_index() << " (sent only "
-                 << rpc.ops().size() << " ops)";
+                 << num_rows << " ops)";
       LOG(ERROR) << "Response from tablet " << rpc.tablet_id() << ":\n" << rpc.resp().DebugString();
       continue;
     }
-    gscoped_ptr<KuduWriteOperation> op = std::move(rpc.ops()[err_pb.row_index()]->write_op);
+    int op_idx = std::upper_bound(op_first_rows.begin(), op_first_rows.end(),
+                                  err_pb.row_index()) - op_first_rows.begin() - 1;
+    InFlightOp* in_flight_op = rpc.ops()[op_idx];
+    const ColumnarInsertChunk* chunk = AsColumnarInsertChunk(in_flight_op->write_op.get());
+    gscoped_ptr<KuduWriteOperation> op;
+    if (chunk) {
+      op.reset(chunk->NewInsertForRow(err_pb.row_index() - op_first_rows[op_idx]));
+    } else {
+      op = std::move(in_flight_op->write_op);
+    }
     VLOG(1) << "Error on op " << op->ToString() << ": "
             << err_pb.error().ShortDebugString();
     Status op_status = StatusFromPB(err_pb.error());
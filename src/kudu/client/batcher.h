@@ -17,6 +17,7 @@
 #ifndef KUDU_CLIENT_BATCHER_H
 #define KUDU_CLIENT_BATCHER_H
 
+#include <string>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
@@ -29,6 +30,7 @@
 #include "kudu/util/atomic.h"
 #include "kudu/util/debug-util.h"
 #include "kudu/util/locks.h"
+#include "kudu/util/memory/arena.h"
 #include "kudu/util/status.h"
 
 namespace kudu {
@@ -87,6 +89,10 @@ class Batcher : public RefCountedThreadSafe<Batcher> {
   // NOTE: If this returns not-OK, does not take ownership of 'write_op'.
   Status Add(KuduWriteOperation* write_op) WARN_UNUSED_RESULT;
 
+  // Add a new operation to the batch, whose partition key has already been
+  // computed with GetPartitionKey(). Takes ownership of 'write_op'.
+  void Add(KuduWriteOperation* write_op, std::string partition_key);
+
   // Return true if any operations are still pending. An operation is no longer considered
   // pending once it has either errored or succeeded.  Operations are considering pending
   // as soon as they are added, even if Flush has not been called.
@@ -128,14 +134,35 @@ class Batcher : public RefCountedThreadSafe<Batcher> {
     return write_op->SizeInBuffer();
   }
 
+  // Compute the partition key of the given write operation.
+  static Status GetPartitionKey(KuduWriteOperation* write_op, std::string* partition_key);
+
  private:
   friend class RefCountedThreadSafe<Batcher>;
   friend class WriteRpc;
 
   ~Batcher();
 
-  // Add an op to the in-flight set and increment the ref-count.
-  void AddInFlightOp(InFlightOp* op);
+  // Allocate a new op from 'op_arena_'. Ops must be destroyed with
+  // DestroyInFlightOp() rather than deleted.
+  InFlightOp* NewInFlightOp();
+  static void DestroyInFlightOp(InFlightOp* op);
+
+  // Add an op to the in-flight set and assign it a sequence number.
+  void AddInFlightOpUnlocked(InFlightOp* op);
+
+  // Add an op whose tablet is known to its tablet's buffer, keeping the
+  // buffer ordered by sequence number.
+  void BufferInFlightOpUnlocked(InFlightOp* op);
+
+  // Return the tablet of 'table' which an earlier op of this batch was routed
+  // to and which hosts 'partition_key', or nullptr if there is none.
+  RemoteTablet* FindRoutedTabletUnlocked(const KuduTable* table,
+                                         const std::string& partition_key) const;
+
+  // Remember that an op of 'table' was routed to 'tablet'.
+  void AddRoutedTabletUnlocked(const client::sp::shared_ptr<KuduTable>& table,
+                               const scoped_refptr<RemoteTablet>& tablet);
 
   void RemoveInFlightOp(InFlightOp* op);
 
@@ -153,6 +180,11 @@ class Batcher : public RefCountedThreadSafe<Batcher> {
   void MarkInFlightOpFailed(InFlightOp* op, const Status& s);
   void MarkInFlightOpFailedUnlocked(InFlightOp* op, const Status& s);
 
+  // Report to the ErrorReporter that 'write_op' failed with the given status.
+  // The rows of a chunk of columnar inserts are reported as separate inserts,
+  // so that they can be retried individually.
+  void AddWriteOpError(gscoped_ptr<KuduWriteOperation> write_op, const Status& s);
+
   void CheckForFinishedFlush();
   void FlushBuffersIfReady();
   void FlushBuffer(RemoteTablet* tablet, const std::vector<InFlightOp*>& ops);
@@ -229,6 +261,23 @@ class Batcher : public RefCountedThreadSafe<Batcher> {
   // The number of bytes used in the buffer for pending operations.
   AtomicInt<int64_t> buffer_bytes_used_;
 
+  // Backs the InFlightOps of this batch, so that adding an op doesn't need a
+  // heap allocation. The memory is released along with the batcher, which is
+  // kept alive by the ops' WriteRpcs.
+  ThreadSafeArena op_arena_;
+
+  // The tablets which ops of this batch were routed to, for each table, sorted
+  // by partition key start. Subsequent ops to the same tablets are routed
+  // with a binary search, without going through the MetaCache. The table is
+  // referenced so that its address isn't reused while it is a key.
+  //
+  // Protected by lock_.
+  struct RoutedTablets {
+    client::sp::shared_ptr<KuduTable> table;
+    std::vector<scoped_refptr<RemoteTablet>> tablets;
+  };
+  std::unordered_map<const KuduTable*, RoutedTablets> routed_tablets_;
+
   DISALLOW_COPY_AND_ASSIGN(Batcher);
 };
 
@@ -40,9 +40,11 @@
 #include "kudu/rpc/rpc.h"
 #include "kudu/rpc/rpc_controller.h"
 #include "kudu/rpc/rpc_header.pb.h"
+#include "kudu/util/hdr_histogram.h"
 #include "kudu/util/net/dns_resolver.h"
 #include "kudu/util/net/net_util.h"
 #include "kudu/util/thread_restrictions.h"
+#include "kudu/util/threadpool.h"
 
 using std::set;
 using std::shared_ptr;
@@ -83,9 +85,24 @@ using strings::Substitute;
 namespace client {
 
 using internal::GetTableSchemaRpc;
+using internal::RemoteReplica;
 using internal::RemoteTablet;
 using internal::RemoteTabletServer;
 
+namespace {
+
+// How long a server which failed an RPC is avoided by LOWEST_LATENCY.
+const MonoDelta kRecentTServerFailureWindow = MonoDelta::FromSeconds(10);
+
+// Scanner open latencies are tracked up to a minute, with two significant
+// digits of precision. Scanners don't hedge their opens until the client
+// recorded enough of them for the percentiles to be meaningful.
+const int64_t kMaxScanOpenLatencyUs = 60 * 1000 * 1000;
+const int kScanOpenLatencySignificantDigits = 2;
+const int64_t kMinScanOpensForHedging = 100;
+
+} // anonymous namespace
+
 Status RetryFunc(const MonoTime& deadline,
                  const string& retry_msg,
                  const string& timeout_msg,
@@ -268,7 +285,9 @@ Status KuduClient::Data::SyncLeaderMasterRpc(
     vector<uint32_t> required_feature_flags);
 
 KuduClient::Data::Data()
-    : latest_observed_timestamp_(KuduClient::kNoTimestamp) {
+    : latest_observed_timestamp_(KuduClient::kNoTimestamp),
+      scan_open_latency_histogram_(new HdrHistogram(kMaxScanOpenLatencyUs,
+                                                    kScanOpenLatencySignificantDigits)) {
 }
 
 KuduClient::Data::~Data() {
@@ -279,9 +298,33 @@ KuduClient::Data::~Data() {
   // fix urgently, because typically once a client is shutting down, latency
   // jitter on the reactor is not a big deal (and DNS resolutions are not in flight).
   ThreadRestrictions::ScopedAllowWait allow_wait;
+  if (callback_pool_) {
+    callback_pool_->Shutdown();
+  }
   dns_resolver_.reset();
 }
 
+void KuduClient::Data::RunCallback(const boost::function<void()>& callback) {
+  Status s = callback_pool_->SubmitFunc(callback);
+  if (PREDICT_FALSE(!s.ok())) {
+    callback();
+  }
+}
+
+void KuduClient::Data::RecordScanOpenLatency(const MonoDelta& latency) {
+  scan_open_latency_histogram_->Increment(
+      std::min(std::max<int64_t>(latency.ToMicroseconds(), 0), kMaxScanOpenLatencyUs));
+}
+
+bool KuduClient::Data::GetScanHedgingDelay(double percentile, MonoDelta* delay) const {
+  if (scan_open_latency_histogram_->TotalCount() < kMinScanOpensForHedging) {
+    return false;
+  }
+  *delay = MonoDelta::FromMicroseconds(
+      scan_open_latency_histogram_->ValueAtPercentile(percentile));
+  return true;
+}
+
 RemoteTabletServer* KuduClient::Data::SelectTServer(const scoped_refptr<RemoteTablet>& rt,
                                                     const ReplicaSelection selection,
                                                     const set<string>& blacklist,
@@ -299,6 +342,56 @@ RemoteTabletServer* KuduClient::Data::SelectTServer(const scoped_refptr<RemoteTa
       }
       break;
     }
+    case CLOSEST_NON_VOTER: {
+      // Non-voters are reported with the LEARNER role.
+      vector<RemoteReplica> replicas;
+      rt->GetRemoteReplicas(&replicas);
+      vector<RemoteTabletServer*> learners;
+      for (const RemoteReplica& r : replicas) {
+        if (r.role == RaftPeerPB::LEARNER && !r.failed &&
+            !ContainsKey(blacklist, r.ts->permanent_uuid())) {
+          learners.push_back(r.ts);
+        }
+      }
+      for (RemoteTabletServer* rts : learners) {
+        if (IsTabletServerLocal(*rts)) {
+          ret = rts;
+          break;
+        }
+      }
+      if (ret == nullptr && !learners.empty()) {
+        ret = learners[rand() % learners.size()];
+      }
+      if (ret != nullptr) {
+        rt->GetRemoteTabletServers(candidates);
+        break;
+      }
+      return SelectTServer(rt, CLOSEST_REPLICA, blacklist, candidates);
+    }
+    case LOWEST_LATENCY: {
+      rt->GetRemoteTabletServers(candidates);
+      // Start from a random replica, so that ties are broken randomly.
+      double best_score = 0;
+      bool best_failed_recently = true;
+      size_t n = candidates->size();
+      size_t offset = n > 0 ? rand() % n : 0;
+      for (size_t i = 0; i < n; i++) {
+        RemoteTabletServer* rts = (*candidates)[(offset + i) % n];
+        if (ContainsKey(blacklist, rts->permanent_uuid())) {
+          continue;
+        }
+        bool failed_recently = rts->FailedWithin(kRecentTServerFailureWindow);
+        double score = rts->LatencyScore();
+        if (ret == nullptr ||
+            (best_failed_recently && !failed_recently) ||
+            (best_failed_recently == failed_recently && score < best_score)) {
+          ret = rts;
+          best_score = score;
+          best_failed_recently = failed_recently;
+        }
+      }
+      break;
+    }
     case CLOSEST_REPLICA:
     case FIRST_REPLICA: {
       rt->GetRemoteTabletServers(candidates);
@@ -439,6 +532,7 @@ Status KuduClient::Data::DeleteTable(KuduClient* client,
   Status s = SyncLeaderMasterRpc<DeleteTableRequestPB, DeleteTableResponsePB>(
       deadline, client, req, &resp,
       "DeleteTable", &MasterServiceProxy::DeleteTable, {});
+  InvalidateCachedTableMetadata(table_name);
   RETURN_NOT_OK(s);
   if (resp.has_error()) {
     return StatusFromPB(resp.error().status());
@@ -464,6 +558,10 @@ Status KuduClient::Data::AlterTable(KuduClient* client,
           "AlterTable",
           &MasterServiceProxy::AlterTable,
           std::move(required_feature_flags));
+  InvalidateCachedTableMetadata(req.table().table_name());
+  if (req.has_new_table_name()) {
+    InvalidateCachedTableMetadata(req.new_table_name());
+  }
   RETURN_NOT_OK(s);
   if (resp.has_error()) {
     return StatusFromPB(resp.error().status());
@@ -557,7 +655,8 @@ Status KuduClient::Data::GetTableSchema(KuduClient* client,
                                         KuduSchema* schema,
                                         PartitionSchema* partition_schema,
                                         string* table_id,
-                                        int* num_replicas) {
+                                        int* num_replicas,
+                                        int64_t* schema_version) {
   GetTableSchemaRequestPB req;
   GetTableSchemaResponsePB resp;
 
@@ -593,9 +692,54 @@ Status KuduClient::Data::GetTableSchema(KuduClient* client,
   if (num_replicas) {
     *num_replicas = resp.num_replicas();
   }
+  if (schema_version) {
+    *schema_version = resp.has_schema_version() ? resp.schema_version() : kNoSchemaVersion;
+  }
   return Status::OK();
 }
 
+bool KuduClient::Data::LookupCachedTableMetadata(const string& table_name,
+                                                 TableMetadata* metadata) {
+  std::lock_guard<simple_spinlock> l(table_metadata_cache_lock_);
+  auto it = table_metadata_cache_.find(table_name);
+  if (it == table_metadata_cache_.end()) {
+    return false;
+  }
+  if (it->second.expiration < MonoTime::Now()) {
+    table_metadata_cache_.erase(it);
+    return false;
+  }
+  *metadata = it->second;
+  return true;
+}
+
+void KuduClient::Data::CacheTableMetadata(const string& table_name, TableMetadata metadata) {
+  if (!table_metadata_cache_ttl_.Initialized() ||
+      table_metadata_cache_ttl_.ToNanoseconds() <= 0 ||
+      metadata.schema_version == kNoSchemaVersion) {
+    return;
+  }
+  metadata.expiration = MonoTime::Now() + table_metadata_cache_ttl_;
+  std::lock_guard<simple_spinlock> l(table_metadata_cache_lock_);
+  table_metadata_cache_[table_name] = std::move(metadata);
+}
+
+void KuduClient::Data::InvalidateCachedTableMetadata(const string& table_name) {
+  std::lock_guard<simple_spinlock> l(table_metadata_cache_lock_);
+  table_metadata_cache_.erase(table_name);
+}
+
+void KuduClient::Data::NoteTableSchemaVersion(const string& table_name,
+                                              int64_t schema_version) {
+  std::lock_guard<simple_spinlock> l(table_metadata_cache_lock_);
+  auto it = table_metadata_cache_.find(table_name);
+  if (it != table_metadata_cache_.end() && it->second.schema_version < schema_version) {
+    VLOG(1) << "Table " << table_name << " was altered to schema version "
+            << schema_version << ", dropping its cached metadata";
+    table_metadata_cache_.erase(it);
+  }
+}
+
 void KuduClient::Data::LeaderMasterDetermined(const Status& status,
                                               const HostPort& host_port) {
   Sockaddr leader_sock_addr;
@@ -19,12 +19,15 @@
 
 #include <algorithm>
 #include <boost/function.hpp>
+#include <memory>
 #include <set>
 #include <string>
+#include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
 #include "kudu/client/client.h"
+#include "kudu/common/partition.h"
 #include "kudu/util/atomic.h"
 #include "kudu/util/locks.h"
 #include "kudu/util/monotime.h"
@@ -33,7 +36,10 @@
 namespace kudu {
 
 class DnsResolver;
+class HdrHistogram;
 class HostPort;
+class MemTracker;
+class ThreadPool;
 
 namespace master {
 class AlterTableRequestPB;
@@ -103,13 +109,45 @@ class KuduClient::Data {
                                    const std::string& alter_name,
                                    const MonoTime& deadline);
 
+  // If 'schema_version' is not null, it is set to the version of the
+  // returned schema, or to kNoSchemaVersion if the master didn't report it.
   Status GetTableSchema(KuduClient* client,
                         const std::string& table_name,
                         const MonoTime& deadline,
                         KuduSchema* schema,
                         PartitionSchema* partition_schema,
                         std::string* table_id,
-                        int* num_replicas);
+                        int* num_replicas,
+                        int64_t* schema_version = nullptr);
+
+  static const int64_t kNoSchemaVersion = -1;
+
+  // The metadata of a table, as returned by GetTableSchema().
+  struct TableMetadata {
+    KuduSchema schema;
+    PartitionSchema partition_schema;
+    std::string table_id;
+    int num_replicas;
+    int64_t schema_version;
+    MonoTime expiration;
+  };
+
+  // Looks up the metadata of 'table_name' in the table metadata cache.
+  // Returns false if it isn't cached or has expired.
+  bool LookupCachedTableMetadata(const std::string& table_name, TableMetadata* metadata);
+
+  // Caches 'metadata' for the TTL set with
+  // KuduClientBuilder::table_metadata_cache_ttl(), unless its schema version
+  // is unknown.
+  void CacheTableMetadata(const std::string& table_name, TableMetadata metadata);
+
+  // Drops the cached metadata of 'table_name', if any.
+  void InvalidateCachedTableMetadata(const std::string& table_name);
+
+  // Called with the schema version that a tablet of 'table_name' reported.
+  // Drops the cached metadata of the table if it is for an older version,
+  // so that the next OpenTable() call gets the altered schema.
+  void NoteTableSchemaVersion(const std::string& table_name, int64_t schema_version);
 
   Status InitLocalHostNames();
 
@@ -196,6 +234,21 @@ class KuduClient::Data {
             std::pow(2.0, std::min(8, num_attempts - 1))));
   }
 
+  // Runs 'callback' on a thread of 'callback_pool_'. If the client is
+  // shutting down, 'callback' is run on the calling thread instead, so that
+  // it is never dropped.
+  //
+  // Used to run the user callbacks of asynchronous scanner operations off
+  // the reactor threads, since they may block.
+  void RunCallback(const boost::function<void()>& callback);
+
+  // Records the latency of a Scan RPC which opened a scanner.
+  void RecordScanOpenLatency(const MonoDelta& latency);
+
+  // Sets 'delay' to the given percentile of the scanner open latencies
+  // recorded so far. Returns false if too few were recorded to tell.
+  bool GetScanHedgingDelay(double percentile, MonoDelta* delay) const;
+
   // The unique id of this client.
   std::string client_id_;
 
@@ -204,6 +257,12 @@ class KuduClient::Data {
 
   std::shared_ptr<rpc::Messenger> messenger_;
   gscoped_ptr<DnsResolver> dns_resolver_;
+  gscoped_ptr<ThreadPool> callback_pool_;
+
+  // Tracks the memory used by the write operations buffered in the sessions
+  // of the client and by the batches prefetched by its scanners, and
+  // enforces the limit set with KuduClientBuilder::memory_limit_bytes().
+  std::shared_ptr<MemTracker> mem_tracker_;
   scoped_refptr<internal::MetaCache> meta_cache_;
 
   // Set of hostnames and IPs on the local host.
@@ -214,6 +273,13 @@ class KuduClient::Data {
   std::vector<std::string> master_server_addrs_;
   MonoDelta default_admin_operation_timeout_;
   MonoDelta default_rpc_timeout_;
+  MonoDelta table_metadata_cache_ttl_;
+
+  // The table metadata returned by OpenTable(), by table name. Only used if
+  // 'table_metadata_cache_ttl_' is positive. Protected by
+  // 'table_metadata_cache_lock_'.
+  std::unordered_map<std::string, TableMetadata> table_metadata_cache_;
+  simple_spinlock table_metadata_cache_lock_;
 
   // The host port of the leader master. This is set in
   // LeaderMasterDetermined, which is invoked as a callback by
@@ -238,6 +304,10 @@ class KuduClient::Data {
 
   AtomicInt<uint64_t> latest_observed_timestamp_;
 
+  // The latencies of the scanner opens of the client, from which the delay
+  // after which scanners hedge their opens is derived.
+  gscoped_ptr<HdrHistogram> scan_open_latency_histogram_;
+
  private:
   DISALLOW_COPY_AND_ASSIGN(Data);
 };
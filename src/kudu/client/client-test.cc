@@ -59,6 +59,8 @@
 #include "kudu/tserver/scanners.h"
 #include "kudu/tserver/tablet_server.h"
 #include "kudu/tserver/ts_tablet_manager.h"
+#include "kudu/util/bitmap.h"
+#include "kudu/util/mem_tracker.h"
 #include "kudu/util/metrics.h"
 #include "kudu/util/net/sockaddr.h"
 #include "kudu/util/scoped_cleanup.h"
@@ -75,6 +77,7 @@ DECLARE_int32(log_inject_latency_ms_mean);
 DECLARE_int32(log_inject_latency_ms_stddev);
 DECLARE_int32(master_inject_latency_on_tablet_lookups_ms);
 DECLARE_int32(max_create_tablets_per_ts);
+DECLARE_int32(max_table_locations_per_response);
 DECLARE_int32(scanner_gc_check_interval_us);
 DECLARE_int32(scanner_inject_latency_on_each_batch_ms);
 DECLARE_int32(scanner_max_batch_size_bytes);
@@ -666,6 +669,53 @@ TEST_F(ClientTest, TestScan) {
   DoTestScanWithKeyPredicate();
 }
 
+TEST_F(ClientTest, TestScanProfile) {
+  ASSERT_NO_FATAL_FAILURE(InsertTestRows(
+      client_table_.get(), FLAGS_test_scan_num_rows));
+  // Flush to ensure that some of the rows are read from disk.
+  FlushTablet(GetFirstTabletId(client_table_.get()));
+
+  KuduScanner scanner(client_table_.get());
+  ASSERT_OK(scanner.SetProjectedColumns({ "key", "int_val" }));
+  ASSERT_OK(scanner.SetProfileEnabled(true));
+  ASSERT_OK(scanner.Open());
+  ASSERT_TRUE(scanner.SetProfileEnabled(false).IsIllegalState());
+  KuduScanBatch batch;
+  while (scanner.HasMoreRows()) {
+    ASSERT_OK(scanner.NextBatch(&batch));
+  }
+
+  std::map<string, int64_t> profile = scanner.GetProfile().Get();
+  ASSERT_GT(profile["scan_requests"], 0);
+  ASSERT_EQ(FLAGS_test_scan_num_rows, profile["rows_returned"]);
+  ASSERT_EQ(FLAGS_test_scan_num_rows, profile["rows_scanned"]);
+  ASSERT_GT(profile["rowsets_scanned"], 0);
+  ASSERT_GT(profile["data_blocks_read"], 0);
+  ASSERT_GT(profile["cfile_cache_hits"] + profile["cfile_cache_misses"], 0);
+  ASSERT_GE(profile["handler_us"], profile["iterate_us"]);
+
+  // The tablet profiles add up to the profile of the scan.
+  std::map<string, std::map<string, int64_t>> tablet_profiles;
+  scanner.GetTabletProfiles(&tablet_profiles);
+  ASSERT_FALSE(tablet_profiles.empty());
+  int64_t requests = 0;
+  int64_t rows = 0;
+  for (auto& p : tablet_profiles) {
+    requests += p.second["scan_requests"];
+    rows += p.second["rows_returned"];
+  }
+  ASSERT_EQ(profile["scan_requests"], requests);
+  ASSERT_EQ(FLAGS_test_scan_num_rows, rows);
+
+  // Without a profile, the servers report none.
+  KuduScanner plain_scanner(client_table_.get());
+  ASSERT_OK(plain_scanner.Open());
+  while (plain_scanner.HasMoreRows()) {
+    ASSERT_OK(plain_scanner.NextBatch(&batch));
+  }
+  ASSERT_TRUE(plain_scanner.GetProfile().Get().empty());
+}
+
 TEST_F(ClientTest, TestScanAtSnapshot) {
   int half_the_rows = FLAGS_test_scan_num_rows / 2;
 
@@ -882,6 +932,370 @@ TEST_F(ClientTest, TestScanEmptyProjection) {
   }
 }
 
+TEST_F(ClientTest, TestScanColumnarLayout) {
+  ASSERT_NO_FATAL_FAILURE(InsertTestRows(client_table_.get(),
+                                         FLAGS_test_scan_num_rows));
+  KuduScanner scanner(client_table_.get());
+  ASSERT_OK(scanner.SetProjectedColumns({ "key", "int_val", "string_val" }));
+  ASSERT_OK(scanner.SetRowLayout(KuduScanner::COLUMNAR));
+  ASSERT_OK(scanner.Open());
+
+  KuduScanBatch batch;
+  int count = 0;
+  while (scanner.HasMoreRows()) {
+    ASSERT_OK(scanner.NextBatch(&batch));
+    Slice keys, int_vals, str_offsets, str_data, str_non_null;
+    ASSERT_OK(batch.GetFixedLengthColumn(0, &keys));
+    ASSERT_OK(batch.GetFixedLengthColumn(1, &int_vals));
+    ASSERT_OK(batch.GetVariableLengthColumn(2, &str_offsets, &str_data));
+    ASSERT_OK(batch.GetNonNullBitmapForColumn(2, &str_non_null));
+    ASSERT_EQ(batch.NumRows() * sizeof(int32_t), keys.size());
+    ASSERT_EQ((batch.NumRows() + 1) * sizeof(uint32_t), str_offsets.size());
+
+    // Accessing columns through the wrong accessor fails.
+    Slice unused;
+    ASSERT_TRUE(batch.GetFixedLengthColumn(2, &unused).IsInvalidArgument());
+    ASSERT_TRUE(batch.GetNonNullBitmapForColumn(0, &unused).IsInvalidArgument());
+
+    const int32_t* key_cells = reinterpret_cast<const int32_t*>(keys.data());
+    const int32_t* int_cells = reinterpret_cast<const int32_t*>(int_vals.data());
+    const uint32_t* offsets = reinterpret_cast<const uint32_t*>(str_offsets.data());
+    for (int i = 0; i < batch.NumRows(); i++) {
+      int32_t key = key_cells[i];
+      ASSERT_EQ(key * 2, int_cells[i]);
+      ASSERT_TRUE(BitmapTest(str_non_null.data(), i));
+      Slice str(str_data.data() + offsets[i], offsets[i + 1] - offsets[i]);
+      ASSERT_EQ(StringPrintf("hello %d", key), str.ToString());
+    }
+    count += batch.NumRows();
+  }
+  ASSERT_EQ(FLAGS_test_scan_num_rows, count);
+}
+
+// Test that detached batches stay valid across NextBatch() calls and after
+// the scanner is destroyed.
+TEST_F(ClientTest, TestScanDetachedBatches) {
+  ASSERT_NO_FATAL_FAILURE(InsertTestRows(client_table_.get(),
+                                         FLAGS_test_scan_num_rows));
+  vector<shared_ptr<KuduScanBatch>> batches;
+  {
+    KuduScanner scanner(client_table_.get());
+    ASSERT_OK(scanner.SetProjectedColumns({ "key", "string_val" }));
+    ASSERT_OK(scanner.SetBatchSizeBytes(1024));
+    ASSERT_OK(scanner.Open());
+    KuduScanBatch batch;
+    while (scanner.HasMoreRows()) {
+      ASSERT_OK(scanner.NextBatch(&batch));
+      batches.push_back(batch.Detach());
+      ASSERT_EQ(0, batch.NumRows());
+    }
+  }
+  ASSERT_GT(batches.size(), 1);
+
+  int count = 0;
+  for (const auto& batch : batches) {
+    ASSERT_EQ(2, batch->projection_schema()->num_columns());
+    for (KuduScanBatch::RowPtr row : *batch) {
+      int32_t key;
+      Slice str;
+      ASSERT_OK(row.GetInt32(0, &key));
+      ASSERT_OK(row.GetString(1, &str));
+      ASSERT_EQ(StringPrintf("hello %d", key), str.ToString());
+      count++;
+    }
+  }
+  ASSERT_EQ(FLAGS_test_scan_num_rows, count);
+}
+
+// Test that aggregates computed by the tablet servers are merged across
+// batches and tablets.
+TEST_F(ClientTest, TestScanAggregates) {
+  ASSERT_NO_FATAL_FAILURE(InsertTestRows(client_table_.get(),
+                                         FLAGS_test_scan_num_rows));
+  const int kFirstKey = 10;
+  KuduScanner scanner(client_table_.get());
+  ASSERT_OK(scanner.SetProjectedColumns({ "key", "int_val", "string_val" }));
+  ASSERT_OK(scanner.AddConjunctPredicate(
+      client_table_->NewComparisonPredicate("key", KuduPredicate::GREATER_EQUAL,
+                                            KuduValue::FromInt(kFirstKey))));
+  ASSERT_OK(scanner.SetBatchSizeBytes(1024));
+  ASSERT_OK(scanner.AddAggregate(KuduScanner::COUNT, ""));
+  ASSERT_OK(scanner.AddAggregate(KuduScanner::SUM, "int_val"));
+  ASSERT_OK(scanner.AddAggregate(KuduScanner::MIN, "key"));
+  ASSERT_OK(scanner.AddAggregate(KuduScanner::MAX, "string_val"));
+  ASSERT_TRUE(scanner.AddAggregate(KuduScanner::SUM, "").IsInvalidArgument());
+  ASSERT_OK(scanner.Open());
+
+  KuduScanBatch batch;
+  while (scanner.HasMoreRows()) {
+    ASSERT_OK(scanner.NextBatch(&batch));
+    ASSERT_EQ(0, batch.NumRows());
+  }
+
+  int64_t expected_sum = 0;
+  string expected_max;
+  for (int i = kFirstKey; i < FLAGS_test_scan_num_rows; i++) {
+    expected_sum += i * 2;
+    expected_max = std::max(expected_max, StringPrintf("hello %d", i));
+  }
+  int64_t count, sum, min_key;
+  string max_str;
+  ASSERT_OK(scanner.GetAggregateCount(0, &count));
+  ASSERT_EQ(FLAGS_test_scan_num_rows - kFirstKey, count);
+  ASSERT_OK(scanner.GetAggregateInt(1, &sum));
+  ASSERT_EQ(expected_sum, sum);
+  ASSERT_OK(scanner.GetAggregateInt(2, &min_key));
+  ASSERT_EQ(kFirstKey, min_key);
+  ASSERT_OK(scanner.GetAggregateString(3, &max_str));
+  ASSERT_EQ(expected_max, max_str);
+
+  // Results must be read with an accessor matching their type.
+  double unused;
+  ASSERT_TRUE(scanner.GetAggregateDouble(1, &unused).IsInvalidArgument());
+  ASSERT_TRUE(scanner.GetAggregateInt(0, &sum).IsInvalidArgument());
+  ASSERT_TRUE(scanner.GetAggregateCount(4, &count).IsInvalidArgument());
+}
+
+// Test that limited scans return exactly the requested number of rows, even
+// when the limit spans several batches and tablets.
+TEST_F(ClientTest, TestScanLimit) {
+  ASSERT_NO_FATAL_FAILURE(InsertTestRows(client_table_.get(),
+                                         FLAGS_test_scan_num_rows));
+  for (int64_t limit : { 0, 1, FLAGS_test_scan_num_rows / 2, FLAGS_test_scan_num_rows,
+                         FLAGS_test_scan_num_rows * 2 }) {
+    SCOPED_TRACE(limit);
+    KuduScanner scanner(client_table_.get());
+    ASSERT_OK(scanner.SetBatchSizeBytes(1024));
+    ASSERT_OK(scanner.SetLimit(limit));
+    ASSERT_OK(scanner.Open());
+
+    KuduScanBatch batch;
+    int64_t count = 0;
+    while (scanner.HasMoreRows()) {
+      ASSERT_OK(scanner.NextBatch(&batch));
+      count += batch.NumRows();
+    }
+    ASSERT_EQ(std::min<int64_t>(limit, FLAGS_test_scan_num_rows), count);
+  }
+
+  KuduScanner scanner(client_table_.get());
+  ASSERT_TRUE(scanner.SetLimit(-1).IsInvalidArgument());
+}
+
+TEST_F(ClientTest, TestScanPrefetching) {
+  ASSERT_NO_FATAL_FAILURE(InsertTestRows(client_table_.get(),
+                                         FLAGS_test_scan_num_rows));
+  {
+    KuduScanner scanner(client_table_.get());
+    ASSERT_OK(scanner.SetBatchSizeBytes(1024));
+    ASSERT_OK(scanner.SetPrefetching(true));
+    ASSERT_OK(scanner.Open());
+
+    KuduScanBatch batch;
+    int count = 0;
+    while (scanner.HasMoreRows()) {
+      ASSERT_OK(scanner.NextBatch(&batch));
+      // The prefetch RPC keeps the scanner alive.
+      ASSERT_OK(scanner.KeepAlive());
+      count += batch.NumRows();
+    }
+    ASSERT_EQ(FLAGS_test_scan_num_rows, count);
+  }
+
+  // Closing the scanner while a prefetch is in flight.
+  KuduScanner scanner(client_table_.get());
+  ASSERT_OK(scanner.SetBatchSizeBytes(1024));
+  ASSERT_OK(scanner.SetPrefetching(true));
+  ASSERT_OK(scanner.Open());
+  KuduScanBatch batch;
+  ASSERT_OK(scanner.NextBatch(&batch));
+  ASSERT_TRUE(scanner.HasMoreRows());
+  scanner.Close();
+}
+
+TEST_F(ClientTest, TestParallelScan) {
+  // 5 tablets, each with 10 rows.
+  vector<unique_ptr<KuduPartialRow>> rows;
+  for (int i = 1; i < 5; i++) {
+    unique_ptr<KuduPartialRow> row(schema_.NewRow());
+    CHECK_OK(row->SetInt32(0, i * 10));
+    rows.push_back(std::move(row));
+  }
+  shared_ptr<KuduTable> table;
+  ASSERT_NO_FATAL_FAILURE(CreateTable("TestParallelScan", 1, std::move(rows), {}, &table));
+  ASSERT_NO_FATAL_FAILURE(InsertTestRows(table.get(), 50));
+
+  for (bool preserve_order : { false, true }) {
+    SCOPED_TRACE(preserve_order);
+    KuduScanner scanner(table.get());
+    ASSERT_OK(scanner.SetScanConcurrency(3));
+    // Make every batch exceed the budget, so that the tablet scanners have
+    // to wait for each other.
+    ASSERT_OK(scanner.SetParallelScanMemoryBudget(1));
+    ASSERT_OK(scanner.SetBatchSizeBytes(1));
+    ASSERT_OK(scanner.SetPreserveTabletOrder(preserve_order));
+    ASSERT_OK(scanner.SetProjectedColumns({ "key" }));
+    ASSERT_OK(scanner.Open());
+
+    KuduScanBatch batch;
+    set<int32_t> keys;
+    int32_t last_tablet = 0;
+    while (scanner.HasMoreRows()) {
+      ASSERT_OK(scanner.NextBatch(&batch));
+      for (KuduScanBatch::RowPtr row : batch) {
+        int32_t key;
+        ASSERT_OK(row.GetInt32(0, &key));
+        ASSERT_TRUE(keys.insert(key).second) << key;
+        if (preserve_order) {
+          ASSERT_GE(key / 10, last_tablet);
+          last_tablet = key / 10;
+        }
+      }
+    }
+    ASSERT_EQ(50, keys.size());
+  }
+
+  // Predicates apply to each tablet scan, and pruned tablets are skipped.
+  {
+    KuduScanner scanner(table.get());
+    ASSERT_OK(scanner.SetScanConcurrency(2));
+    ASSERT_OK(scanner.AddConjunctPredicate(table->NewComparisonPredicate(
+        "key", KuduPredicate::GREATER_EQUAL, KuduValue::FromInt(25))));
+    ASSERT_OK(scanner.Open());
+    int count = 0;
+    KuduScanBatch batch;
+    while (scanner.HasMoreRows()) {
+      ASSERT_OK(scanner.NextBatch(&batch));
+      count += batch.NumRows();
+    }
+    ASSERT_EQ(25, count);
+  }
+
+  // Closing a parallel scan before it is done stops the tablet scanners.
+  {
+    KuduScanner scanner(table.get());
+    ASSERT_OK(scanner.SetScanConcurrency(5));
+    ASSERT_OK(scanner.SetBatchSizeBytes(1));
+    ASSERT_OK(scanner.Open());
+    KuduScanBatch batch;
+    ASSERT_OK(scanner.NextBatch(&batch));
+    scanner.Close();
+  }
+
+  // Parallel scans cannot be limited.
+  {
+    KuduScanner scanner(table.get());
+    ASSERT_OK(scanner.SetScanConcurrency(2));
+    ASSERT_OK(scanner.SetLimit(10));
+    Status s = scanner.Open();
+    ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+  }
+
+  KuduScanner scanner(table.get());
+  ASSERT_TRUE(scanner.SetScanConcurrency(0).IsInvalidArgument());
+  ASSERT_TRUE(scanner.SetParallelScanMemoryBudget(0).IsInvalidArgument());
+}
+
+TEST_F(ClientTest, TestColumnarInserts) {
+  // 5 tablets, each with 10 rows.
+  vector<unique_ptr<KuduPartialRow>> split_rows;
+  for (int i = 1; i < 5; i++) {
+    unique_ptr<KuduPartialRow> row(schema_.NewRow());
+    CHECK_OK(row->SetInt32(0, i * 10));
+    split_rows.push_back(std::move(row));
+  }
+  shared_ptr<KuduTable> table;
+  ASSERT_NO_FATAL_FAILURE(CreateTable("TestColumnarInserts", 1, std::move(split_rows), {},
+                                      &table));
+
+  // Build a batch of inserts where every third string is NULL, leaving the
+  // column with a default unset.
+  auto build_batch = [&](int num_rows) {
+    vector<int32_t> keys;
+    vector<int32_t> int_vals;
+    vector<uint32_t> offsets = { 0 };
+    string strings;
+    vector<uint8_t> non_null(BitmapSize(num_rows));
+    for (int i = 0; i < num_rows; i++) {
+      keys.push_back(i);
+      int_vals.push_back(i * 2);
+      if (i % 3 != 0) {
+        strings.append(Substitute("hello $0", i));
+        BitmapSet(non_null.data(), i);
+      }
+      offsets.push_back(strings.size());
+    }
+    unique_ptr<KuduColumnarInsertBatch> batch(table->NewColumnarInsertBatch(num_rows));
+    CHECK_OK(batch->SetColumn(0, Slice(reinterpret_cast<const uint8_t*>(keys.data()),
+                                       keys.size() * sizeof(int32_t))));
+    CHECK_OK(batch->SetColumn(1, Slice(reinterpret_cast<const uint8_t*>(int_vals.data()),
+                                       int_vals.size() * sizeof(int32_t))));
+    CHECK_OK(batch->SetVarlenColumn(2, offsets.data(), strings, non_null.data()));
+    return batch;
+  };
+
+  shared_ptr<KuduSession> session = client_->NewSession();
+  ASSERT_OK(session->SetFlushMode(KuduSession::AUTO_FLUSH_BACKGROUND));
+  // Keep the buffer small, so that the rows of each tablet are split into
+  // several chunks.
+  ASSERT_OK(session->SetMutationBufferSpace(1024));
+  session->SetTimeoutMillis(60000);
+  ASSERT_OK(session->ApplyColumnarInserts(build_batch(50).release()));
+  FlushSessionOrDie(session);
+  ASSERT_EQ(50, CountRowsFromClient(table.get()));
+
+  vector<string> rows;
+  ScanTableToStrings(table.get(), &rows);
+  ASSERT_EQ(50, rows.size());
+  EXPECT_EQ("(int32 key=0, int32 int_val=0, string string_val=NULL, "
+            "int32 non_null_with_default=12345)", rows[0]);
+  EXPECT_EQ("(int32 key=41, int32 int_val=82, string string_val=hello 41, "
+            "int32 non_null_with_default=12345)", rows[41]);
+
+  // Inserting the rows again fails for each of them, and the errors are
+  // reported as inserts of the individual rows.
+  ASSERT_OK(session->SetFlushMode(KuduSession::MANUAL_FLUSH));
+  ASSERT_OK(session->SetMutationBufferSpace(7 * 1024 * 1024));
+  ASSERT_OK(session->ApplyColumnarInserts(build_batch(5).release()));
+  ASSERT_FALSE(session->Flush().ok());
+  vector<KuduError*> errors;
+  ElementDeleter drop(&errors);
+  bool overflowed;
+  session->GetPendingErrors(&errors, &overflowed);
+  ASSERT_FALSE(overflowed);
+  ASSERT_EQ(5, errors.size());
+  set<int32_t> failed_keys;
+  for (const KuduError* error : errors) {
+    ASSERT_TRUE(error->status().IsAlreadyPresent()) << error->status().ToString();
+    int32_t key;
+    ASSERT_OK(error->failed_op().row().GetInt32("key", &key));
+    failed_keys.insert(key);
+  }
+  ASSERT_EQ(5, failed_keys.size());
+
+  // Columns are checked against the schema.
+  unique_ptr<KuduColumnarInsertBatch> batch(table->NewColumnarInsertBatch(2));
+  int32_t vals[] = { 1, 2 };
+  uint8_t non_null = 1;
+  Slice vals_slice(reinterpret_cast<const uint8_t*>(vals), sizeof(vals));
+  ASSERT_TRUE(batch->SetColumn(4, vals_slice).IsInvalidArgument());
+  ASSERT_TRUE(batch->SetColumn(0, Slice(vals_slice.data(), 4)).IsInvalidArgument());
+  ASSERT_TRUE(batch->SetColumn(0, vals_slice, &non_null).IsInvalidArgument());
+  ASSERT_TRUE(batch->SetColumn(2, vals_slice).IsInvalidArgument());
+  ASSERT_OK(batch->SetColumn(1, vals_slice));
+  Status s = session->ApplyColumnarInserts(batch.release());
+  ASSERT_TRUE(s.IsIllegalState()) << s.ToString();
+}
+
+// Test that aggregating a column outside of the projection fails.
+TEST_F(ClientTest, TestScanAggregateNotInProjection) {
+  KuduScanner scanner(client_table_.get());
+  ASSERT_OK(scanner.SetProjectedColumns({ "key" }));
+  ASSERT_OK(scanner.AddAggregate(KuduScanner::SUM, "int_val"));
+  Status s = scanner.Open();
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+}
+
 TEST_F(ClientTest, TestProjectInvalidColumn) {
   KuduScanner scanner(client_table_.get());
   Status s = scanner.SetProjectedColumns({ "column-doesnt-exist" });
@@ -1401,6 +1815,323 @@ TEST_F(ClientTest, TestMetaCacheExpiry) {
   ASSERT_FALSE(entry.stale());
 }
 
+// Tests that writes whose tablets are cached are routed without a lookup,
+// and that they are applied correctly across tablets and batches.
+TEST_F(ClientTest, TestCachedTabletLookup) {
+  auto& meta_cache = client_->data_->meta_cache_;
+  meta_cache->ClearCache();
+  scoped_refptr<internal::RemoteTablet> rt;
+  ASSERT_FALSE(meta_cache->LookupCachedTabletByKey(client_table_.get(), "", &rt));
+
+  scoped_refptr<internal::RemoteTablet> looked_up = MetaCacheLookup(client_table_.get(), "");
+  ASSERT_TRUE(meta_cache->LookupCachedTabletByKey(client_table_.get(), "", &rt));
+  ASSERT_EQ(looked_up.get(), rt.get());
+
+  // The first batch populates the cache for both tablets, so the second one
+  // shouldn't need to contact the master at all.
+  NO_FATALS(InsertTestRows(client_table_.get(), 100));
+  int master_rpcs_before = CountMasterLookupRPCs();
+  NO_FATALS(InsertTestRows(client_table_.get(), 100, 100));
+  ASSERT_EQ(master_rpcs_before, CountMasterLookupRPCs());
+  ASSERT_EQ(200, CountRowsFromClient(client_table_.get()));
+}
+
+// Tests that prefetching a table's locations pages through the master's
+// responses, and doesn't fetch locations which are already cached.
+TEST_F(ClientTest, TestPrefetchTabletLocations) {
+  // Make the master return one tablet per response, so that prefetching the
+  // two tablets of the table takes two pages.
+  FLAGS_max_table_locations_per_response = 1;
+
+  shared_ptr<KuduClient> client;
+  ASSERT_OK(KuduClientBuilder()
+      .add_master_server_addr(cluster_->mini_master()->bound_rpc_addr().ToString())
+      .Build(&client));
+  shared_ptr<KuduTable> table;
+  ASSERT_OK(client->OpenTable(kTableName, &table));
+
+  int master_rpcs_before = CountMasterLookupRPCs();
+  ASSERT_OK(table->PrefetchTabletLocations());
+  ASSERT_EQ(2, CountMasterLookupRPCs() - master_rpcs_before);
+
+  // Everything is cached now.
+  master_rpcs_before = CountMasterLookupRPCs();
+  ASSERT_OK(table->PrefetchTabletLocations());
+  NO_FATALS(InsertTestRows(client.get(), table.get(), 100));
+  ASSERT_EQ(master_rpcs_before, CountMasterLookupRPCs());
+  ASSERT_EQ(100, CountRowsFromClient(table.get()));
+}
+
+TEST_F(ClientTest, TestTableMetadataCache) {
+  shared_ptr<KuduClient> client;
+  ASSERT_OK(KuduClientBuilder()
+      .add_master_server_addr(cluster_->mini_master()->bound_rpc_addr().ToString())
+      .table_metadata_cache_ttl(MonoDelta::FromSeconds(3600))
+      .Build(&client));
+  shared_ptr<KuduTable> table;
+  ASSERT_OK(client->OpenTable(kTableName, &table));
+  size_t num_columns = table->schema().num_columns();
+
+  // Alter the table through another client: the cached schema is still used.
+  {
+    unique_ptr<KuduTableAlterer> alterer(client_->NewTableAlterer(kTableName));
+    alterer->AddColumn("new_col")->Type(KuduColumnSchema::INT32);
+    ASSERT_OK(alterer->Alter());
+  }
+  shared_ptr<KuduTable> cached_table;
+  ASSERT_OK(client->OpenTable(kTableName, &cached_table));
+  ASSERT_EQ(num_columns, cached_table->schema().num_columns());
+
+  // Writing to the table reports its new schema version, which drops the
+  // cached schema.
+  NO_FATALS(InsertTestRows(client.get(), table.get(), 10));
+  shared_ptr<KuduTable> new_table;
+  ASSERT_OK(client->OpenTable(kTableName, &new_table));
+  ASSERT_EQ(num_columns + 1, new_table->schema().num_columns());
+
+  // So does altering the table through the client itself.
+  {
+    unique_ptr<KuduTableAlterer> alterer(client->NewTableAlterer(kTableName));
+    alterer->DropColumn("new_col");
+    ASSERT_OK(alterer->Alter());
+  }
+  ASSERT_OK(client->OpenTable(kTableName, &new_table));
+  ASSERT_EQ(num_columns, new_table->schema().num_columns());
+}
+
+// Drives a scan to completion through the asynchronous scanner API, and
+// counts down 'latch' once done.
+class AsyncScanDriver {
+ public:
+  AsyncScanDriver(KuduTable* table, CountDownLatch* latch)
+      : scanner_(table),
+        latch_(latch),
+        num_rows_(0),
+        open_cb_(this, &AsyncScanDriver::OpenDone),
+        batch_cb_(this, &AsyncScanDriver::BatchDone) {
+  }
+
+  void Start() {
+    // Fetch the rows in many batches.
+    CHECK_OK(scanner_.SetBatchSizeBytes(1));
+    scanner_.OpenAsync(&open_cb_);
+  }
+
+  const Status& status() const { return status_; }
+  int num_rows() const { return num_rows_; }
+
+ private:
+  void OpenDone(const Status& s) {
+    if (!s.ok()) {
+      Finish(s);
+      return;
+    }
+    NextBatch();
+  }
+
+  void BatchDone(const Status& s) {
+    if (!s.ok()) {
+      Finish(s);
+      return;
+    }
+    num_rows_ += batch_.NumRows();
+    NextBatch();
+  }
+
+  void NextBatch() {
+    if (!scanner_.HasMoreRows()) {
+      Finish(Status::OK());
+      return;
+    }
+    scanner_.NextBatchAsync(&batch_, &batch_cb_);
+  }
+
+  void Finish(const Status& s) {
+    status_ = s;
+    latch_->CountDown();
+  }
+
+  KuduScanner scanner_;
+  KuduScanBatch batch_;
+  CountDownLatch* latch_;
+  int num_rows_;
+  Status status_;
+  KuduStatusMemberCallback<AsyncScanDriver> open_cb_;
+  KuduStatusMemberCallback<AsyncScanDriver> batch_cb_;
+};
+
+TEST_F(ClientTest, TestAsyncScan) {
+  const int kNumRows = 200;
+  const int kNumScanners = 10;
+  NO_FATALS(InsertTestRows(client_table_.get(), kNumRows));
+
+  shared_ptr<KuduClient> client;
+  ASSERT_OK(KuduClientBuilder()
+      .add_master_server_addr(cluster_->mini_master()->bound_rpc_addr().ToString())
+      .Build(&client));
+  shared_ptr<KuduTable> table;
+  ASSERT_OK(client->OpenTable(kTableName, &table));
+
+  // In the first round, the tablets are looked up and their replicas are
+  // resolved on the callback threads. In the second, they are cached, so the
+  // scans are driven by the completion of their RPCs.
+  for (int round = 0; round < 2; round++) {
+    CountDownLatch latch(kNumScanners);
+    vector<unique_ptr<AsyncScanDriver>> drivers;
+    for (int i = 0; i < kNumScanners; i++) {
+      drivers.emplace_back(new AsyncScanDriver(table.get(), &latch));
+      drivers.back()->Start();
+    }
+    latch.Wait();
+    for (const auto& driver : drivers) {
+      ASSERT_OK(driver->status());
+      ASSERT_EQ(kNumRows, driver->num_rows());
+    }
+  }
+}
+
+TEST_F(ClientTest, TestRowLookup) {
+  NO_FATALS(InsertTestRows(client_table_.get(), 100));
+
+  KuduRowLookup lookup(client_table_.get());
+  ASSERT_OK(lookup.SetProjectedColumnNames({ "key", "int_val" }));
+  // The keys span both tablets; 200 has no row.
+  for (int key : { 99, 1, 50, 200, 5 }) {
+    unique_ptr<KuduPartialRow> row(client_table_->schema().NewRow());
+    ASSERT_OK(row->SetInt32("key", key));
+    ASSERT_OK(lookup.AddKey(*row));
+  }
+
+  vector<KuduScanBatch*> batches;
+  ElementDeleter deleter(&batches);
+  ASSERT_OK(lookup.Run(&batches));
+  vector<int32_t> keys;
+  for (KuduScanBatch* batch : batches) {
+    ASSERT_EQ(2, batch->projection_schema()->num_columns());
+    for (KuduScanBatch::RowPtr row : *batch) {
+      int32_t key;
+      int32_t val;
+      ASSERT_OK(row.GetInt32(0, &key));
+      ASSERT_OK(row.GetInt32(1, &val));
+      ASSERT_EQ(key * 2, val);
+      keys.push_back(key);
+    }
+  }
+  std::sort(keys.begin(), keys.end());
+  ASSERT_EQ((vector<int32_t>{ 1, 5, 50, 99 }), keys);
+
+  // The keys were consumed by the previous run.
+  STLDeleteElements(&batches);
+  ASSERT_OK(lookup.Run(&batches));
+  ASSERT_TRUE(batches.empty());
+}
+
+// Test that the memory limit of a client is shared by all of its sessions,
+// and that scanners keep working without prefetching once it is reached.
+TEST_F(ClientTest, TestClientMemoryLimit) {
+  const int64_t kMemoryLimit = 16 * 1024;
+  shared_ptr<KuduClient> client;
+  ASSERT_OK(KuduClientBuilder()
+      .add_master_server_addr(cluster_->mini_master()->bound_rpc_addr().ToString())
+      .memory_limit_bytes(kMemoryLimit)
+      .Build(&client));
+  shared_ptr<KuduTable> table;
+  ASSERT_OK(client->OpenTable(kTableName, &table));
+  MemTracker* tracker = client->data_->mem_tracker_.get();
+
+  // Fill the memory with the operations of one session, each of which is far
+  // below the limit of the session's own buffer.
+  shared_ptr<KuduSession> session1 = client->NewSession();
+  ASSERT_OK(session1->SetFlushMode(KuduSession::MANUAL_FLUSH));
+  int num_rows = 0;
+  Status s;
+  while (true) {
+    s = session1->Apply(BuildTestRow(table.get(), num_rows).release());
+    if (!s.ok()) {
+      break;
+    }
+    num_rows++;
+  }
+  ASSERT_TRUE(s.IsIncomplete()) << s.ToString();
+  ASSERT_GT(num_rows, 0);
+  ASSERT_LE(tracker->consumption(), kMemoryLimit);
+
+  // Another session of the client can't buffer anything until the first
+  // one is flushed.
+  shared_ptr<KuduSession> session2 = client->NewSession();
+  ASSERT_OK(session2->SetFlushMode(KuduSession::MANUAL_FLUSH));
+  s = session2->Apply(BuildTestRow(table.get(), num_rows).release());
+  ASSERT_TRUE(s.IsIncomplete()) << s.ToString();
+
+  // The failed operations are reported as errors; drop them.
+  vector<KuduError*> errors;
+  ElementDeleter drop(&errors);
+  bool overflowed;
+  session1->GetPendingErrors(&errors, &overflowed);
+  ASSERT_EQ(1, errors.size());
+  STLDeleteElements(&errors);
+  session2->GetPendingErrors(&errors, &overflowed);
+  ASSERT_EQ(1, errors.size());
+
+  ASSERT_OK(session1->Flush());
+  ASSERT_EQ(0, tracker->consumption());
+  ASSERT_OK(session2->Apply(BuildTestRow(table.get(), num_rows).release()));
+  ASSERT_OK(session2->Flush());
+  num_rows++;
+  ASSERT_EQ(0, tracker->consumption());
+
+  // In AUTO_FLUSH_BACKGROUND mode, Apply() waits for the memory to be freed
+  // instead of failing.
+  ASSERT_OK(session1->SetFlushMode(KuduSession::AUTO_FLUSH_BACKGROUND));
+  for (int i = 0; i < 500; i++) {
+    ASSERT_OK(session1->Apply(BuildTestRow(table.get(), num_rows++).release()));
+  }
+  ASSERT_OK(session1->Flush());
+  ASSERT_EQ(0, tracker->consumption());
+
+  // Batches which fit in the memory are prefetched; bigger ones are not,
+  // but are still returned.
+  for (int batch_size : { 1024, static_cast<int>(kMemoryLimit * 2) }) {
+    KuduScanner scanner(table.get());
+    ASSERT_OK(scanner.SetBatchSizeBytes(batch_size));
+    ASSERT_OK(scanner.SetPrefetching(true));
+    vector<string> rows;
+    ASSERT_NO_FATAL_FAILURE(ScanToStrings(&scanner, &rows));
+    ASSERT_EQ(num_rows, rows.size());
+    scanner.Close();
+    ASSERT_EQ(0, tracker->consumption());
+  }
+}
+
+TEST_F(ClientTest, TestHedgedScans) {
+  shared_ptr<KuduTable> table;
+  ASSERT_NO_FATAL_FAILURE(CreateTable("hedged", 3, GenerateSplitRows(), {}, &table));
+  ASSERT_NO_FATAL_FAILURE(InsertTestRows(table.get(), 100));
+
+  // Hedge almost every open, once enough of them were observed, so that the
+  // scans use whichever replica responds first and close the other scanner.
+  // Snapshot reads make sure that followers return all of the rows.
+  for (int i = 0; i < 100; i++) {
+    KuduScanner scanner(table.get());
+    ASSERT_OK(scanner.SetSelection(KuduClient::CLOSEST_REPLICA));
+    ASSERT_OK(scanner.SetReadMode(KuduScanner::READ_AT_SNAPSHOT));
+    ASSERT_OK(scanner.SetHedgingPercentile(1));
+    ASSERT_OK(scanner.SetBatchSizeBytes(1));
+    ASSERT_OK(scanner.Open());
+    int count = 0;
+    KuduScanBatch batch;
+    while (scanner.HasMoreRows()) {
+      ASSERT_OK(scanner.NextBatch(&batch));
+      count += batch.NumRows();
+    }
+    ASSERT_EQ(100, count);
+  }
+
+  KuduScanner scanner(table.get());
+  ASSERT_TRUE(scanner.SetHedgingPercentile(-1).IsInvalidArgument());
+  ASSERT_TRUE(scanner.SetHedgingPercentile(100).IsInvalidArgument());
+}
+
 TEST_F(ClientTest, TestGetTabletServerBlacklist) {
   shared_ptr<KuduTable> table;
   ASSERT_NO_FATAL_FAILURE(CreateTable("blacklist",
@@ -1459,6 +2190,7 @@ TEST_F(ClientTest, TestGetTabletServerBlacklist) {
   selections.push_back(KuduClient::LEADER_ONLY);
   selections.push_back(KuduClient::CLOSEST_REPLICA);
   selections.push_back(KuduClient::FIRST_REPLICA);
+  selections.push_back(KuduClient::LOWEST_LATENCY);
   for (KuduClient::ReplicaSelection selection : selections) {
     Status s = client_->data_->GetTabletServer(client_.get(), rt, selection,
                                                blacklist, &candidates, &rts);
@@ -2750,6 +3482,56 @@ TEST_F(ClientTest, TestAutoFlushBackgroundApplyBlocks) {
   EXPECT_LT(wait_timeout_ms / 2, sw.elapsed().wall_millis());
 }
 
+// Test that Apply() may be called concurrently from several threads in
+// concurrent apply mode, and that the threads share the buffer space.
+TEST_F(ClientTest, TestConcurrentApply) {
+  const int kNumThreads = 8;
+  const int kRowsPerThread = 500;
+
+  shared_ptr<KuduSession> session = client_->NewSession();
+  ASSERT_OK(session->SetConcurrentApply(true));
+  session->SetTimeoutMillis(60000);
+
+  auto apply_rows = [&](int first_row) {
+    for (int i = first_row; i < first_row + kRowsPerThread; i++) {
+      CHECK_OK(session->Apply(BuildTestRow(client_table_.get(), i).release()));
+    }
+  };
+
+  // In MANUAL_FLUSH mode, the operations of all threads are buffered until
+  // the flush, and are then sent together.
+  ASSERT_OK(session->SetFlushMode(KuduSession::MANUAL_FLUSH));
+  {
+    vector<thread> threads;
+    for (int t = 0; t < kNumThreads; t++) {
+      threads.emplace_back(apply_rows, t * kRowsPerThread);
+    }
+    for (thread& t : threads) {
+      t.join();
+    }
+  }
+  ASSERT_EQ(kNumThreads * kRowsPerThread, session->CountBufferedOperations());
+  ASSERT_TRUE(session->SetConcurrentApply(false).IsIllegalState());
+  FlushSessionOrDie(session);
+  ASSERT_EQ(kNumThreads * kRowsPerThread, CountRowsFromClient(client_table_.get()));
+
+  // In AUTO_FLUSH_BACKGROUND mode, the threads block when the shared buffer
+  // is full, until enough of it is flushed.
+  ASSERT_OK(session->SetFlushMode(KuduSession::AUTO_FLUSH_BACKGROUND));
+  ASSERT_OK(session->SetMutationBufferSpace(4 * 1024));
+  {
+    vector<thread> threads;
+    for (int t = 0; t < kNumThreads; t++) {
+      threads.emplace_back(apply_rows, (kNumThreads + t) * kRowsPerThread);
+    }
+    for (thread& t : threads) {
+      t.join();
+    }
+  }
+  FlushSessionOrDie(session);
+  ASSERT_EQ(2 * kNumThreads * kRowsPerThread, CountRowsFromClient(client_table_.get()));
+}
+
 // Test that update updates and delete deletes with expected use
 TEST_F(ClientTest, TestMutationsWork) {
   shared_ptr<KuduSession> session = client_->NewSession();
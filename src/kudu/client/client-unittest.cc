@@ -19,11 +19,13 @@
 
 #include <boost/bind.hpp>
 #include <gtest/gtest.h>
+#include <memory>
 #include <string>
 #include <vector>
 
 #include "kudu/client/client.h"
 #include "kudu/client/client-internal.h"
+#include "kudu/util/test_macros.h"
 
 using std::string;
 using std::vector;
@@ -151,6 +153,58 @@ TEST(ClientUnitTest, TestSchemaBuilder_CompoundKey_BadColumnName) {
             b.Build(&s).ToString());
 }
 
+TEST(ClientUnitTest, TestSchemaBuilder_Decimals) {
+  KuduSchema s;
+  KuduSchemaBuilder b;
+  b.AddColumn("a")->Type(KuduColumnSchema::INT32)->NotNull()->PrimaryKey();
+  b.AddColumn("small")->Type(KuduColumnSchema::DECIMAL)->Precision(9)->Scale(2);
+  b.AddColumn("large")->Type(KuduColumnSchema::DECIMAL)->Precision(18)->NotNull()
+    ->Default(KuduValue::FromInt(-12345));
+  ASSERT_EQ("OK", b.Build(&s).ToString());
+  ASSERT_EQ(KuduColumnSchema::DECIMAL, s.Column(1).type());
+  ASSERT_EQ(9, s.Column(1).precision());
+  ASSERT_EQ(2, s.Column(1).scale());
+  ASSERT_EQ(18, s.Column(2).precision());
+  ASSERT_EQ(0, s.Column(2).scale());
+
+  std::unique_ptr<KuduPartialRow> row(s.NewRow());
+  ASSERT_OK(row->SetUnscaledDecimal("small", 999999999));
+  int64_t val;
+  ASSERT_OK(row->GetUnscaledDecimal("small", &val));
+  ASSERT_EQ(999999999, val);
+  ASSERT_EQ("Invalid argument: value 10000000.00 out of range for column 'small' "
+            "of type decimal32(9, 2) NULLABLE",
+            row->SetUnscaledDecimal("small", 1000000000).ToString());
+  ASSERT_EQ("Invalid argument: invalid type decimal provided for column 'a' "
+            "(expected int32)",
+            row->SetUnscaledDecimal("a", 1).ToString());
+}
+
+TEST(ClientUnitTest, TestSchemaBuilder_BadDecimals) {
+  KuduSchema s;
+  {
+    KuduSchemaBuilder b;
+    b.AddColumn("a")->Type(KuduColumnSchema::INT32)->NotNull()->PrimaryKey();
+    b.AddColumn("b")->Type(KuduColumnSchema::DECIMAL);
+    ASSERT_EQ("Invalid argument: no precision provided for decimal column: b",
+              b.Build(&s).ToString());
+  }
+  {
+    KuduSchemaBuilder b;
+    b.AddColumn("a")->Type(KuduColumnSchema::INT32)->NotNull()->PrimaryKey();
+    b.AddColumn("b")->Type(KuduColumnSchema::DECIMAL)->Precision(19);
+    ASSERT_EQ("Invalid argument: precision of decimal column must be between 1 and 18: 19: b",
+              b.Build(&s).ToString());
+  }
+  {
+    KuduSchemaBuilder b;
+    b.AddColumn("a")->Type(KuduColumnSchema::INT32)->NotNull()->PrimaryKey();
+    b.AddColumn("b")->Type(KuduColumnSchema::INT64)->Scale(2);
+    ASSERT_EQ("Invalid argument: precision and scale are only valid for decimal columns: b",
+              b.Build(&s).ToString());
+  }
+}
+
 namespace {
 Status TestFunc(const MonoTime& deadline, bool* retry, int* counter) {
   (*counter)++;
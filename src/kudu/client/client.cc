@@ -35,6 +35,7 @@
 #include "kudu/client/error_collector.h"
 #include "kudu/client/meta_cache.h"
 #include "kudu/client/replica-internal.h"
+#include "kudu/client/row_lookup-internal.h"
 #include "kudu/client/row_result.h"
 #include "kudu/client/scan_predicate-internal.h"
 #include "kudu/client/scan_token-internal.h"
@@ -47,20 +48,26 @@
 #include "kudu/client/tablet-internal.h"
 #include "kudu/client/tablet_server-internal.h"
 #include "kudu/client/write_op.h"
+#include "kudu/client/write_op-internal.h"
+#include "kudu/common/aggregate.h"
 #include "kudu/common/common.pb.h"
 #include "kudu/common/partition.h"
 #include "kudu/common/row_operations.h"
 #include "kudu/common/wire_protocol.h"
 #include "kudu/gutil/map-util.h"
+#include "kudu/gutil/stl_util.h"
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/gutil/sysinfo.h"
 #include "kudu/master/master.pb.h"
 #include "kudu/master/master.proxy.h"
 #include "kudu/rpc/messenger.h"
 #include "kudu/rpc/request_tracker.h"
 #include "kudu/util/init.h"
 #include "kudu/util/logging.h"
+#include "kudu/util/mem_tracker.h"
 #include "kudu/util/net/dns_resolver.h"
 #include "kudu/util/oid_generator.h"
+#include "kudu/util/threadpool.h"
 #include "kudu/util/version_info.h"
 
 using kudu::master::AlterTableRequestPB;
@@ -109,6 +116,14 @@ MAKE_ENUM_LIMITS(kudu::client::KuduScanner::OrderMode,
                  kudu::client::KuduScanner::UNORDERED,
                  kudu::client::KuduScanner::ORDERED);
 
+MAKE_ENUM_LIMITS(kudu::client::KuduScanner::RowLayout,
+                 kudu::client::KuduScanner::ROWWISE,
+                 kudu::client::KuduScanner::COLUMNAR);
+
+MAKE_ENUM_LIMITS(kudu::client::KuduScanner::AggregateType,
+                 kudu::client::KuduScanner::COUNT,
+                 kudu::client::KuduScanner::MAX);
+
 namespace kudu {
 namespace client {
 
@@ -220,6 +235,16 @@ KuduClientBuilder& KuduClientBuilder::default_rpc_timeout(const MonoDelta& timeo
   return *this;
 }
 
+KuduClientBuilder& KuduClientBuilder::memory_limit_bytes(int64_t limit_bytes) {
+  data_->memory_limit_bytes_ = limit_bytes;
+  return *this;
+}
+
+KuduClientBuilder& KuduClientBuilder::table_metadata_cache_ttl(const MonoDelta& ttl) {
+  data_->table_metadata_cache_ttl_ = ttl;
+  return *this;
+}
+
 Status KuduClientBuilder::Build(shared_ptr<KuduClient>* client) {
   RETURN_NOT_OK(CheckCPUFlags());
 
@@ -232,6 +257,11 @@ Status KuduClientBuilder::Build(shared_ptr<KuduClient>* client) {
   c->data_->master_server_addrs_ = data_->master_server_addrs_;
   c->data_->default_admin_operation_timeout_ = data_->default_admin_operation_timeout_;
   c->data_->default_rpc_timeout_ = data_->default_rpc_timeout_;
+  c->data_->table_metadata_cache_ttl_ = data_->table_metadata_cache_ttl_;
+  c->data_->mem_tracker_ = MemTracker::CreateTracker(
+      data_->memory_limit_bytes_,
+      Substitute("kudu-client-$0", c->data_->client_id_),
+      MemTracker::GetRootTracker());
 
   // Let's allow for plenty of time for discovering the master the first
   // time around.
@@ -241,6 +271,10 @@ Status KuduClientBuilder::Build(shared_ptr<KuduClient>* client) {
 
   c->data_->meta_cache_.reset(new MetaCache(c.get()));
   c->data_->dns_resolver_.reset(new DnsResolver());
+  RETURN_NOT_OK(ThreadPoolBuilder("client-callback")
+                .set_min_threads(0)
+                .set_max_threads(base::NumCPUs())
+                .Build(&c->data_->callback_pool_));
 
   // Init local host names used for locality decisions.
   RETURN_NOT_OK_PREPEND(c->data_->InitLocalHostNames(),
@@ -371,24 +405,25 @@ Status KuduClient::TableExists(const string& table_name, bool* exists) {
 
 Status KuduClient::OpenTable(const string& table_name,
                              shared_ptr<KuduTable>* table) {
-  KuduSchema schema;
-  string table_id;
-  int num_replicas;
-  PartitionSchema partition_schema;
-  MonoTime deadline = MonoTime::Now() + default_admin_operation_timeout();
-  RETURN_NOT_OK(data_->GetTableSchema(this,
-                                      table_name,
-                                      deadline,
-                                      &schema,
-                                      &partition_schema,
-                                      &table_id,
-                                      &num_replicas));
+  Data::TableMetadata metadata;
+  if (!data_->LookupCachedTableMetadata(table_name, &metadata)) {
+    MonoTime deadline = MonoTime::Now() + default_admin_operation_timeout();
+    RETURN_NOT_OK(data_->GetTableSchema(this,
+                                        table_name,
+                                        deadline,
+                                        &metadata.schema,
+                                        &metadata.partition_schema,
+                                        &metadata.table_id,
+                                        &metadata.num_replicas,
+                                        &metadata.schema_version));
+    data_->CacheTableMetadata(table_name, metadata);
+  }
 
   // TODO: in the future, probably will look up the table in some map to reuse
   // KuduTable instances.
   table->reset(new KuduTable(shared_from_this(),
-                             table_name, table_id, num_replicas,
-                             schema, partition_schema));
+                             table_name, metadata.table_id, metadata.num_replicas,
+                             metadata.schema, metadata.partition_schema));
   return Status::OK();
 }
 
@@ -694,6 +729,10 @@ KuduDelete* KuduTable::NewDelete() {
   return new KuduDelete(shared_from_this());
 }
 
+KuduColumnarInsertBatch* KuduTable::NewColumnarInsertBatch(int num_rows) {
+  return new KuduColumnarInsertBatch(shared_from_this(), num_rows);
+}
+
 KuduClient* KuduTable::client() const {
   return data_->client_.get();
 }
@@ -702,6 +741,11 @@ const PartitionSchema& KuduTable::partition_schema() const {
   return data_->partition_schema_;
 }
 
+Status KuduTable::PrefetchTabletLocations() {
+  MonoTime deadline = MonoTime::Now() + client()->default_admin_operation_timeout();
+  return client()->data_->meta_cache_->PrefetchTableLocations(this, deadline);
+}
+
 KuduPredicate* KuduTable::NewComparisonPredicate(const Slice& col_name,
                                                  KuduPredicate::ComparisonOp op,
                                                  KuduValue* value) {
@@ -721,6 +765,36 @@ KuduPredicate* KuduTable::NewComparisonPredicate(const Slice& col_name,
   return new KuduPredicate(new ComparisonPredicateData(s->column(col_idx), op, value));
 }
 
+KuduPredicate* KuduTable::NewInListPredicate(const Slice& col_name,
+                                             vector<KuduValue*>* values) {
+  StringPiece name_sp(reinterpret_cast<const char*>(col_name.data()), col_name.size());
+  const Schema* s = data_->schema_.schema_;
+  int col_idx = s->find_column(name_sp);
+  if (col_idx == Schema::kColumnNotFound) {
+    // We always take ownership of the values.
+    STLDeleteElements(values);
+    return new KuduPredicate(new ErrorPredicateData(
+                                 Status::NotFound("column not found", col_name)));
+  }
+
+  return new KuduPredicate(new InListPredicateData(s->column(col_idx), values));
+}
+
+KuduPredicate* KuduTable::NewInBloomFilterPredicate(const Slice& col_name,
+                                                    vector<KuduBloomFilter*>* bloom_filters) {
+  StringPiece name_sp(reinterpret_cast<const char*>(col_name.data()), col_name.size());
+  const Schema* s = data_->schema_.schema_;
+  int col_idx = s->find_column(name_sp);
+  if (col_idx == Schema::kColumnNotFound) {
+    // We always take ownership of the filters.
+    STLDeleteElements(bloom_filters);
+    return new KuduPredicate(new ErrorPredicateData(
+                                 Status::NotFound("column not found", col_name)));
+  }
+
+  return new KuduPredicate(new InBloomFilterPredicateData(s->column(col_idx), bloom_filters));
+}
+
 ////////////////////////////////////////////////////////////
 // Error
 ////////////////////////////////////////////////////////////
@@ -803,6 +877,10 @@ Status KuduSession::SetMutationBufferMaxNum(unsigned int max_num) {
   return data_->SetMaxBatchersNum(max_num);
 }
 
+Status KuduSession::SetConcurrentApply(bool enable) {
+  return data_->SetConcurrentApply(enable);
+}
+
 void KuduSession::SetTimeoutMillis(int timeout_ms) {
   data_->SetTimeoutMillis(timeout_ms);
 }
@@ -830,6 +908,18 @@ Status KuduSession::Apply(KuduWriteOperation* write_op) {
   return Status::OK();
 }
 
+Status KuduSession::ApplyColumnarInserts(KuduColumnarInsertBatch* batch) {
+  if (PREDICT_FALSE(!batch)) {
+    return Status::InvalidArgument("NULL batch");
+  }
+  unique_ptr<KuduColumnarInsertBatch> batch_deleter(batch);
+  RETURN_NOT_OK(data_->ApplyColumnarInserts(batch->data_->table_, batch->data_->rows_));
+  if (data_->flush_mode_ == AUTO_FLUSH_SYNC) {
+    RETURN_NOT_OK(data_->Flush());
+  }
+  return Status::OK();
+}
+
 int KuduSession::CountBufferedOperations() const {
   return data_->CountBufferedOperations();
 }
@@ -1025,6 +1115,14 @@ Status KuduScanner::SetBatchSizeBytes(uint32_t batch_size) {
   return data_->mutable_configuration()->SetBatchSizeBytes(batch_size);
 }
 
+Status KuduScanner::SetPrefetching(bool prefetching) {
+  if (data_->open_) {
+    return Status::IllegalState("Prefetching must be set before Open()");
+  }
+  data_->mutable_configuration()->SetPrefetching(prefetching);
+  return Status::OK();
+}
+
 Status KuduScanner::SetReadMode(ReadMode read_mode) {
   if (data_->open_) {
     return Status::IllegalState("Read mode must be set before Open()");
@@ -1035,6 +1133,151 @@ Status KuduScanner::SetReadMode(ReadMode read_mode) {
   return data_->mutable_configuration()->SetReadMode(read_mode);
 }
 
+Status KuduScanner::SetLimit(int64_t limit) {
+  if (data_->open_) {
+    return Status::IllegalState("Limit must be set before Open()");
+  }
+  if (limit < 0) {
+    return Status::InvalidArgument("Limit must not be negative");
+  }
+  data_->mutable_configuration()->SetLimit(limit);
+  return Status::OK();
+}
+
+Status KuduScanner::SetScanConcurrency(int concurrency) {
+  if (data_->open_) {
+    return Status::IllegalState("Scan concurrency must be set before Open()");
+  }
+  if (concurrency < 1) {
+    return Status::InvalidArgument("Scan concurrency must be positive");
+  }
+  data_->mutable_configuration()->SetScanConcurrency(concurrency);
+  return Status::OK();
+}
+
+Status KuduScanner::SetParallelScanMemoryBudget(int64_t budget_bytes) {
+  if (data_->open_) {
+    return Status::IllegalState("Parallel scan memory budget must be set before Open()");
+  }
+  if (budget_bytes <= 0) {
+    return Status::InvalidArgument("Parallel scan memory budget must be positive");
+  }
+  data_->mutable_configuration()->SetParallelScanMemoryBudget(budget_bytes);
+  return Status::OK();
+}
+
+Status KuduScanner::SetPreserveTabletOrder(bool preserve) {
+  if (data_->open_) {
+    return Status::IllegalState("Tablet order must be set before Open()");
+  }
+  data_->mutable_configuration()->SetPreserveTabletOrder(preserve);
+  return Status::OK();
+}
+
+Status KuduScanner::SetHedgingPercentile(double percentile) {
+  if (data_->open_) {
+    return Status::IllegalState("Hedging percentile must be set before Open()");
+  }
+  if (percentile < 0 || percentile >= 100) {
+    return Status::InvalidArgument("Hedging percentile must be in [0, 100)");
+  }
+  data_->mutable_configuration()->SetHedgingPercentile(percentile);
+  return Status::OK();
+}
+
+Status KuduScanner::SetRowLayout(RowLayout layout) {
+  if (data_->open_) {
+    return Status::IllegalState("Row layout must be set before Open()");
+  }
+  if (!tight_enum_test<RowLayout>(layout)) {
+    return Status::InvalidArgument("Bad row layout");
+  }
+  data_->mutable_configuration()->SetRowLayout(layout);
+  return Status::OK();
+}
+
+Status KuduScanner::AddAggregate(AggregateType type, const string& column_name) {
+  if (data_->open_) {
+    return Status::IllegalState("Aggregates must be added before Open()");
+  }
+  AggregatePB::Type pb_type;
+  switch (type) {
+    case COUNT: pb_type = AggregatePB::COUNT; break;
+    case SUM: pb_type = AggregatePB::SUM; break;
+    case MIN: pb_type = AggregatePB::MIN; break;
+    case MAX: pb_type = AggregatePB::MAX; break;
+    default: return Status::InvalidArgument("Bad aggregate type");
+  }
+  if (column_name.empty() && pb_type != AggregatePB::COUNT) {
+    return Status::InvalidArgument("Only COUNT may be computed without a column");
+  }
+  data_->mutable_configuration()->AddAggregate(pb_type, column_name);
+  return Status::OK();
+}
+
+Status KuduScanner::GetAggregateCount(int idx, int64_t* val) const {
+  const AggregateResultPB* result;
+  RETURN_NOT_OK(data_->FindAggregateResult(idx, nullptr, nullptr, &result));
+  *val = result->count();
+  return Status::OK();
+}
+
+Status KuduScanner::GetAggregateInt(int idx, int64_t* val) const {
+  AggregatePB::Type type;
+  const TypeInfo* type_info;
+  const AggregateResultPB* result;
+  RETURN_NOT_OK(data_->FindAggregateResult(idx, &type, &type_info, &result));
+  DataType physical_type = type_info->physical_type();
+  if (physical_type == FLOAT || physical_type == DOUBLE || physical_type == BINARY) {
+    return Status::InvalidArgument("Aggregate result is not an integer value");
+  }
+  if (type == AggregatePB::SUM) {
+    *val = result->int_sum();
+    return Status::OK();
+  }
+  const void* cell = result->value().data();
+  switch (physical_type) {
+    case BOOL: *val = *reinterpret_cast<const bool*>(cell); break;
+    case INT8: *val = *reinterpret_cast<const int8_t*>(cell); break;
+    case INT16: *val = *reinterpret_cast<const int16_t*>(cell); break;
+    case INT32: *val = *reinterpret_cast<const int32_t*>(cell); break;
+    case INT64: *val = *reinterpret_cast<const int64_t*>(cell); break;
+    default: return Status::NotSupported("Unsupported aggregate result type",
+                                         type_info->name());
+  }
+  return Status::OK();
+}
+
+Status KuduScanner::GetAggregateDouble(int idx, double* val) const {
+  AggregatePB::Type type;
+  const TypeInfo* type_info;
+  const AggregateResultPB* result;
+  RETURN_NOT_OK(data_->FindAggregateResult(idx, &type, &type_info, &result));
+  if (type_info->physical_type() != FLOAT && type_info->physical_type() != DOUBLE) {
+    return Status::InvalidArgument("Aggregate result is not a floating-point value");
+  }
+  if (type == AggregatePB::SUM) {
+    *val = result->double_sum();
+  } else if (type_info->physical_type() == FLOAT) {
+    *val = *reinterpret_cast<const float*>(result->value().data());
+  } else {
+    *val = *reinterpret_cast<const double*>(result->value().data());
+  }
+  return Status::OK();
+}
+
+Status KuduScanner::GetAggregateString(int idx, string* val) const {
+  AggregatePB::Type type;
+  const TypeInfo* type_info;
+  const AggregateResultPB* result;
+  RETURN_NOT_OK(data_->FindAggregateResult(idx, &type, &type_info, &result));
+  if (type_info->physical_type() != BINARY) {
+    return Status::InvalidArgument("Aggregate result is not a string value");
+  }
+  *val = result->value();
+  return Status::OK();
+}
+
 Status KuduScanner::SetOrderMode(OrderMode order_mode) {
   if (data_->open_) {
     return Status::IllegalState("Order mode must be set before Open()");
@@ -1131,6 +1374,23 @@ const ResourceMetrics& KuduScanner::GetResourceMetrics() const {
   return data_->resource_metrics_;
 }
 
+Status KuduScanner::SetProfileEnabled(bool enabled) {
+  if (data_->open_) {
+    return Status::IllegalState("Profiling must be enabled before Open()");
+  }
+  data_->mutable_configuration()->SetProfileEnabled(enabled);
+  return Status::OK();
+}
+
+const ResourceMetrics& KuduScanner::GetProfile() const {
+  return data_->profile_;
+}
+
+void KuduScanner::GetTabletProfiles(
+    std::map<string, std::map<string, int64_t>>* profiles) const {
+  data_->GetTabletProfiles(profiles);
+}
+
 namespace {
 // Callback for the RPC sent by Close().
 // We can't use the KuduScanner response and RPC controller members for this
@@ -1161,31 +1421,49 @@ string KuduScanner::ToString() const {
 Status KuduScanner::Open() {
   CHECK(!data_->open_) << "Scanner already open";
 
-  data_->mutable_configuration()->OptimizeScanSpec();
-  data_->partition_pruner_.Init(*data_->table_->schema().schema_,
-                                data_->table_->partition_schema(),
-                                data_->configuration().spec());
-
-  if (data_->configuration().spec().CanShortCircuit() ||
-      !data_->partition_pruner_.HasMorePartitionKeyRanges()) {
+  RETURN_NOT_OK(data_->PrepareOpen());
+  if (data_->short_circuit_) {
     VLOG(1) << "Short circuiting scan " << ToString();
     data_->open_ = true;
-    data_->short_circuit_ = true;
     return Status::OK();
   }
 
   VLOG(1) << "Beginning scan " << ToString();
+  return data_->StartScan();
+}
 
-  MonoTime deadline = MonoTime::Now() + data_->configuration().timeout();
-  set<string> blacklist;
+void KuduScanner::OpenAsync(KuduStatusCallback* cb) {
+  CHECK(!data_->open_) << "Scanner already open";
+  KuduClient::Data* client_data = data_->table_->client()->data_;
 
-  RETURN_NOT_OK(data_->OpenNextTablet(deadline, &blacklist));
+  Status s = data_->PrepareOpen();
+  if (!s.ok() || data_->short_circuit_) {
+    if (s.ok()) {
+      VLOG(1) << "Short circuiting scan " << ToString();
+      data_->open_ = true;
+    }
+    client_data->RunCallback([cb, s]() { cb->Run(s); });
+    return;
+  }
 
-  data_->open_ = true;
-  return Status::OK();
+  VLOG(1) << "Beginning scan " << ToString();
+  if (data_->configuration().scan_concurrency() == 1 &&
+      data_->OpenNextTabletAsync([this, cb](const Status& s) {
+        if (s.ok()) {
+          data_->open_ = true;
+        }
+        cb->Run(s);
+      })) {
+    return;
+  }
+  // Looking up the tablet or its replicas may block.
+  client_data->RunCallback([this, cb]() { cb->Run(data_->StartScan()); });
 }
 
 Status KuduScanner::KeepAlive() {
+  if (data_->parallel_scan_) {
+    return Status::OK();
+  }
   return data_->KeepAlive();
 }
 
@@ -1194,6 +1472,20 @@ void KuduScanner::Close() {
 
   VLOG(1) << "Ending scan " << ToString();
 
+  // The prefetch RPC writes to the scanner's response and controller, so
+  // it must complete first. Its outcome doesn't matter: the server-side
+  // scanner is closed regardless.
+  if (data_->prefetch_in_flight_) {
+    ignore_result(data_->WaitForPrefetch());
+  }
+
+  if (data_->parallel_scan_) {
+    // Stops the tablet scanners, which close their server-side scanners.
+    data_->parallel_scan_.reset();
+    data_->open_ = false;
+    return;
+  }
+
   // Close the scanner on the server-side, if necessary.
   //
   // If the scan did not match any rows, the tserver will not assign a scanner ID.
@@ -1217,28 +1509,69 @@ void KuduScanner::Close() {
 
 bool KuduScanner::HasMoreRows() const {
   CHECK(data_->open_);
+  if (data_->parallel_scan_) {
+    return data_->parallel_scan_->HasMoreRows();
+  }
   return !data_->short_circuit_ &&                 // The scan is not short circuited
       (data_->data_in_open_ ||                     // more data in hand
+       data_->prefetch_in_flight_ ||               // more data on its way
        data_->last_response_.has_more_results() || // more data in this tablet
        data_->MoreTablets());                      // more tablets to scan, possibly with more data
 }
 
 Status KuduScanner::NextBatch(vector<KuduRowResult>* rows) {
+  if (data_->configuration().row_layout() != ROWWISE) {
+    return Status::IllegalState("Rows of a columnar scan can only be read from a KuduScanBatch");
+  }
   RETURN_NOT_OK(NextBatch(&data_->batch_for_old_api_));
   data_->batch_for_old_api_.data_->ExtractRows(rows);
   return Status::OK();
 }
 
 Status KuduScanner::NextBatch(KuduScanBatch* batch) {
-  // TODO: do some double-buffering here -- when we return this batch
-  // we should already have fired off the RPC for the next batch, but
-  // need to do some swapping of the response objects around to avoid
-  // stomping on the memory the user is looking at.
   CHECK(data_->open_);
+  if (data_->parallel_scan_) {
+    return data_->parallel_scan_->NextBatch(batch);
+  }
   CHECK(data_->proxy_);
 
   batch->data_->Clear();
 
+  // Hands the row data of the last response over to 'batch'.
+  auto extract_batch = [&]() -> Status {
+    if (!data_->configuration().aggregates().empty()) {
+      // Aggregating scans return no rows, only partial results.
+      return Status::OK();
+    }
+    if (data_->configuration().row_layout() == COLUMNAR) {
+      RETURN_NOT_OK(batch->data_->ResetColumnar(
+          &data_->controller_,
+          data_->configuration().projection(),
+          data_->configuration().client_projection(),
+          make_gscoped_ptr(data_->last_response_.release_columnar_data())));
+    } else {
+      RETURN_NOT_OK(batch->data_->Reset(
+          &data_->controller_,
+          data_->configuration().projection(),
+          data_->configuration().client_projection(),
+          make_gscoped_ptr(data_->last_response_.release_data())));
+    }
+    data_->num_rows_returned_ += batch->NumRows();
+    return Status::OK();
+  };
+
+  // Like 'extract_batch', but also asks for the next batch of the tablet
+  // right away if prefetching. The data of the batch was moved out of the
+  // response and RPC controller, so they may be reused for the prefetch.
+  auto reset_batch = [&]() -> Status {
+    RETURN_NOT_OK(extract_batch());
+    if (data_->configuration().prefetching() && data_->last_response_.has_more_results() &&
+        data_->TryReservePrefetchMemory()) {
+      data_->SendPrefetchRpc();
+    }
+    return Status::OK();
+  };
+
   if (data_->short_circuit_) {
     return Status::OK();
   }
@@ -1247,20 +1580,28 @@ Status KuduScanner::NextBatch(KuduScanBatch* batch) {
     // We have data from a previous scan.
     VLOG(1) << "Extracting data from scan " << ToString();
     data_->data_in_open_ = false;
-    return batch->data_->Reset(&data_->controller_,
-                               data_->configuration().projection(),
-                               data_->configuration().client_projection(),
-                                make_gscoped_ptr(data_->last_response_.release_data()));
-  } else if (data_->last_response_.has_more_results()) {
+    return reset_batch();
+  } else if (data_->prefetch_in_flight_ || data_->last_response_.has_more_results()) {
     // More data is available in this tablet.
     VLOG(1) << "Continuing scan " << ToString();
 
-    MonoTime batch_deadline = MonoTime::Now() + data_->configuration().timeout();
-    data_->PrepareRequest(KuduScanner::Data::CONTINUE);
+    // If the request for this batch was prefetched, its response is
+    // handled as if the request had just been sent.
+    bool prefetched = data_->prefetch_in_flight_;
+    MonoTime batch_deadline;
+    if (prefetched) {
+      batch_deadline = data_->prefetch_deadline_;
+    } else {
+      batch_deadline = MonoTime::Now() + data_->configuration().timeout();
+      data_->PrepareRequest(KuduScanner::Data::CONTINUE);
+    }
 
     while (true) {
       bool allow_time_for_failover = data_->configuration().is_fault_tolerant();
-      ScanRpcStatus result = data_->SendScanRpc(batch_deadline, allow_time_for_failover);
+      ScanRpcStatus result = prefetched ?
+          data_->WaitForPrefetch() :
+          data_->SendScanRpc(batch_deadline, allow_time_for_failover);
+      prefetched = false;
 
       // Success case.
       if (result.result == ScanRpcStatus::OK) {
@@ -1268,10 +1609,7 @@ Status KuduScanner::NextBatch(KuduScanBatch* batch) {
           data_->last_primary_key_ = data_->last_response_.last_primary_key();
         }
         data_->scan_attempts_ = 0;
-        return batch->data_->Reset(&data_->controller_,
-                                   data_->configuration().projection(),
-                                   data_->configuration().client_projection(),
-                                   make_gscoped_ptr(data_->last_response_.release_data()));
+        return reset_batch();
       }
 
       data_->scan_attempts_++;
@@ -1314,8 +1652,41 @@ Status KuduScanner::NextBatch(KuduScanBatch* batch) {
   }
 }
 
+void KuduScanner::NextBatchAsync(KuduScanBatch* batch, KuduStatusCallback* cb) {
+  CHECK(data_->open_);
+  KuduClient::Data* client_data = data_->table_->client()->data_;
+  auto next_batch = [this, batch, cb]() { cb->Run(NextBatch(batch)); };
+  if (data_->parallel_scan_ || data_->short_circuit_ || data_->data_in_open_) {
+    client_data->RunCallback(next_batch);
+    return;
+  }
+
+  if (data_->prefetch_in_flight_ || data_->last_response_.has_more_results()) {
+    // Fetch the batch as a prefetch, so that NextBatch() finds its response
+    // in hand once the RPC completes.
+    if (!data_->prefetch_in_flight_) {
+      data_->SendPrefetchRpc();
+    }
+    data_->WhenPrefetchDone(next_batch);
+    return;
+  }
+
+  if (data_->MoreTablets()) {
+    VLOG(1) << "Scanning next tablet " << ToString();
+    batch->data_->Clear();
+    data_->last_primary_key_.clear();
+    if (data_->OpenNextTabletAsync([cb](const Status& s) { cb->Run(s); })) {
+      return;
+    }
+  }
+  client_data->RunCallback(next_batch);
+}
+
 Status KuduScanner::GetCurrentServer(KuduTabletServer** server) {
   CHECK(data_->open_);
+  if (data_->parallel_scan_) {
+    return Status::IllegalState("A parallel scan has no single current server");
+  }
   internal::RemoteTabletServer* rts = data_->ts_;
   CHECK(rts);
   vector<HostPort> host_ports;
@@ -1416,6 +1787,11 @@ Status KuduScanTokenBuilder::SetTimeoutMillis(int millis) {
   return Status::OK();
 }
 
+Status KuduScanTokenBuilder::SetSplitSizeBytes(uint64_t split_size_bytes) {
+  data_->set_split_size_bytes(split_size_bytes);
+  return Status::OK();
+}
+
 Status KuduScanTokenBuilder::AddConjunctPredicate(KuduPredicate* pred) {
   return data_->mutable_configuration()->AddConjunctPredicate(pred);
 }
@@ -1436,6 +1812,38 @@ Status KuduScanTokenBuilder::Build(vector<KuduScanToken*>* tokens) {
   return data_->Build(tokens);
 }
 
+////////////////////////////////////////////////////////////
+// KuduRowLookup
+////////////////////////////////////////////////////////////
+
+KuduRowLookup::KuduRowLookup(KuduTable* table)
+    : data_(new KuduRowLookup::Data(table)) {
+}
+
+KuduRowLookup::~KuduRowLookup() {
+  delete data_;
+}
+
+Status KuduRowLookup::SetProjectedColumnNames(const vector<string>& col_names) {
+  return data_->SetProjectedColumnNames(col_names);
+}
+
+Status KuduRowLookup::SetTimeoutMillis(int millis) {
+  if (millis <= 0) {
+    return Status::InvalidArgument("Timeout must be positive");
+  }
+  data_->timeout_ = MonoDelta::FromMilliseconds(millis);
+  return Status::OK();
+}
+
+Status KuduRowLookup::AddKey(const KuduPartialRow& key) {
+  return data_->AddKey(key);
+}
+
+Status KuduRowLookup::Run(vector<KuduScanBatch*>* batches) {
+  return data_->Run(batches);
+}
+
 ////////////////////////////////////////////////////////////
 // KuduReplica
 ////////////////////////////////////////////////////////////
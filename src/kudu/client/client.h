@@ -25,6 +25,7 @@
 #ifndef KUDU_CLIENT_CLIENT_H
 #define KUDU_CLIENT_CLIENT_H
 
+#include <map>
 #include <stdint.h>
 #include <string>
 #include <vector>
@@ -80,6 +81,7 @@ class Batcher;
 class GetTableSchemaRpc;
 class LookupRpc;
 class MetaCache;
+class ParallelScan;
 class RemoteTablet;
 class RemoteTabletServer;
 class WriteRpc;
@@ -193,6 +195,40 @@ class KUDU_EXPORT KuduClientBuilder {
   /// @return Reference to the updated object.
   KuduClientBuilder& default_rpc_timeout(const MonoDelta& timeout);
 
+  /// Set the limit on the memory used by the client for buffered data.
+  ///
+  /// The limit is shared by the write operations buffered in all sessions
+  /// of the client and by the batches prefetched by its scanners. Once it
+  /// is reached, KuduSession::Apply() blocks until the buffered operations
+  /// of some session are flushed if the session is in AUTO_FLUSH_BACKGROUND
+  /// mode, and fails otherwise, while scanners stop prefetching.
+  ///
+  /// If not provided, or negative, the memory is not limited beyond the
+  /// buffer size limits of the individual sessions.
+  ///
+  /// @param [in] limit_bytes
+  ///   The limit, in bytes.
+  /// @return Reference to the updated object.
+  KuduClientBuilder& memory_limit_bytes(int64_t limit_bytes);
+
+  /// Set how long the schema and partitioning of a table are cached for
+  /// KuduClient::OpenTable() calls.
+  ///
+  /// Within that time, opening the table again doesn't contact the master.
+  /// Tablet servers report the schema version of their tablets along with
+  /// the results of writes and scans, and a table's cached metadata is
+  /// dropped as soon as a newer version is reported, as it is when the
+  /// table is altered or deleted through this client. Tables which are
+  /// altered by other clients and not written or scanned through this one
+  /// may still be opened with their previous schema until the TTL expires.
+  ///
+  /// If not provided, or not positive, the metadata is not cached.
+  ///
+  /// @param [in] ttl
+  ///   How long to cache the metadata of a table for.
+  /// @return Reference to the updated object.
+  KuduClientBuilder& table_metadata_cache_ttl(const MonoDelta& ttl);
+
   /// Create a client object.
   ///
   /// @note KuduClients objects are shared amongst multiple threads and,
@@ -372,7 +408,19 @@ class KUDU_EXPORT KuduClient : public sp::enable_shared_from_this<KuduClient> {
     CLOSEST_REPLICA,  ///< Select the closest replica to the client,
                       ///< or a random one if all replicas are equidistant.
 
-    FIRST_REPLICA     ///< Select the first replica in the list.
+    FIRST_REPLICA,    ///< Select the first replica in the list.
+
+    CLOSEST_NON_VOTER, ///< Select the closest non-voting replica to the
+                      ///< client, so that reads are served without
+                      ///< involving the voters which commit writes.
+                      ///< Falls back to @c CLOSEST_REPLICA if the tablet
+                      ///< has no available non-voter.
+
+    LOWEST_LATENCY    ///< Select the replica whose server has shown the lowest
+                      ///< latency to this client recently, accounting for the
+                      ///< RPCs still in flight to it. Servers which failed
+                      ///< RPCs recently are only selected if there is no
+                      ///< other option.
   };
 
   /// @return @c true iff client is configured to talk to multiple
@@ -423,6 +471,7 @@ class KUDU_EXPORT KuduClient : public sp::enable_shared_from_this<KuduClient> {
   friend class internal::WriteRpc;
   friend class ClientTest;
   friend class KuduClientBuilder;
+  friend class KuduRowLookup;
   friend class KuduScanner;
   friend class KuduScanTokenBuilder;
   friend class KuduSession;
@@ -435,6 +484,8 @@ class KUDU_EXPORT KuduClient : public sp::enable_shared_from_this<KuduClient> {
   FRIEND_TEST(ClientTest, TestMasterDown);
   FRIEND_TEST(ClientTest, TestMasterLookupPermits);
   FRIEND_TEST(ClientTest, TestMetaCacheExpiry);
+  FRIEND_TEST(ClientTest, TestCachedTabletLookup);
+  FRIEND_TEST(ClientTest, TestClientMemoryLimit);
   FRIEND_TEST(ClientTest, TestNonCoveringRangePartitions);
   FRIEND_TEST(ClientTest, TestReplicatedTabletWritesWithLeaderElection);
   FRIEND_TEST(ClientTest, TestScanFaultTolerance);
@@ -799,6 +850,13 @@ class KUDU_EXPORT KuduTable : public sp::enable_shared_from_this<KuduTable> {
   ///   KuduSession::Apply().
   KuduDelete* NewDelete();
 
+  /// @param [in] num_rows
+  ///   Number of rows in the batch.
+  /// @return New batch of columnar inserts into this table. It is the
+  ///   caller's responsibility to free the result, unless it is passed to
+  ///   KuduSession::ApplyColumnarInserts().
+  KuduColumnarInsertBatch* NewColumnarInsertBatch(int num_rows);
+
   /// Create a new comparison predicate.
   ///
   /// This method creates new instance of a comparison predicate which
@@ -826,6 +884,52 @@ class KUDU_EXPORT KuduTable : public sp::enable_shared_from_this<KuduTable> {
                                         KuduPredicate::ComparisonOp op,
                                         KuduValue* value);
 
+  /// Create a new IN list predicate.
+  ///
+  /// This method creates a new instance of a predicate which matches rows
+  /// whose column value is equal to any of the given values. The predicate
+  /// can be used for scanners on this table object.
+  ///
+  /// @param [in] col_name
+  ///   Name of column to use for comparison.
+  /// @param [in] values
+  ///   The values to match. The types of the values must correspond to the
+  ///   type of the column, following the same rules as for
+  ///   NewComparisonPredicate(). This method takes ownership of the values,
+  ///   and clears the vector.
+  /// @return Raw pointer to an IN list predicate. The caller owns the
+  ///   predicate until it is passed into KuduScanner::AddConjunctPredicate().
+  ///   Non-NULL is returned both in success and error cases.
+  ///   In the case of an error (e.g. invalid column name), a non-NULL value
+  ///   is still returned. The error will be returned when attempting
+  ///   to add this predicate to a KuduScanner.
+  KuduPredicate* NewInListPredicate(const Slice& col_name,
+                                    std::vector<KuduValue*>* values);
+
+  /// Create a new IN Bloom filter predicate.
+  ///
+  /// This method creates a new instance of a predicate which matches rows
+  /// whose column value may be in all of the given Bloom filters. Like any
+  /// Bloom filter it has false positives, but no false negatives, so it may
+  /// be used to skip rows early but not as the exact condition of a query.
+  /// The filters are evaluated by the tablet servers, before the remaining
+  /// columns of the rows they reject are read.
+  ///
+  /// @param [in] col_name
+  ///   Name of column to use for comparison.
+  /// @param [in] bloom_filters
+  ///   The filters to match against, built from values encoded as described
+  ///   for KuduBloomFilter::Insert(). There must be at least one. This method
+  ///   takes ownership of the filters, and clears the vector.
+  /// @return Raw pointer to an IN Bloom filter predicate. The caller owns the
+  ///   predicate until it is passed into KuduScanner::AddConjunctPredicate().
+  ///   Non-NULL is returned both in success and error cases.
+  ///   In the case of an error (e.g. invalid column name), a non-NULL value
+  ///   is still returned. The error will be returned when attempting
+  ///   to add this predicate to a KuduScanner.
+  KuduPredicate* NewInBloomFilterPredicate(const Slice& col_name,
+                                           std::vector<KuduBloomFilter*>* bloom_filters);
+
   /// @return The KuduClient object associated with the table. The caller
   ///   should not free the returned pointer.
   KuduClient* client() const;
@@ -833,6 +937,19 @@ class KUDU_EXPORT KuduTable : public sp::enable_shared_from_this<KuduTable> {
   /// @return The partition schema for the table.
   const PartitionSchema& partition_schema() const;
 
+  /// Load the locations of all of the table's tablets into the client's
+  /// cache.
+  ///
+  /// Otherwise, tablet locations are fetched lazily, a few tablets at a
+  /// time, by the first writes and scans which need them. For a table with
+  /// many tablets, prefetching the locations takes far fewer round trips to
+  /// the master. Locations which are already cached and have not expired are
+  /// not fetched again, so this may also be called periodically to refresh
+  /// the cache.
+  ///
+  /// @return Operation result status.
+  Status PrefetchTabletLocations();
+
  private:
   class KUDU_NO_EXPORT Data;
 
@@ -1124,7 +1241,9 @@ class KUDU_EXPORT KuduError {
 /// Users who are familiar with the Hibernate ORM framework should find this
 /// concept of a Session familiar.
 ///
-/// @note This class is not thread-safe.
+/// @note This class is not thread-safe, except for Apply(), Flush() and
+///   FlushAsync() when concurrent apply is enabled: see
+///   KuduSession::SetConcurrentApply().
 class KUDU_EXPORT KuduSession : public sp::enable_shared_from_this<KuduSession> {
  public:
   ~KuduSession();
@@ -1314,6 +1433,31 @@ class KUDU_EXPORT KuduSession : public sp::enable_shared_from_this<KuduSession>
   /// @return Operation result status.
   Status SetMutationBufferMaxNum(unsigned int max_num) WARN_UNUSED_RESULT;
 
+  /// Allow Apply() to be called concurrently from multiple threads.
+  ///
+  /// With concurrent apply, each thread buffers the operations it applies
+  /// separately, without taking session-wide locks. The buffered operations
+  /// of all threads are merged into the current mutation buffer when it is
+  /// flushed, so the operations applied by different threads for the same
+  /// tablet are still sent in the same RPCs. The mutation buffer space limit
+  /// (see SetMutationBufferSpace()) is shared by all of the threads. This
+  /// makes the throughput of Apply() on a single session scale with the
+  /// number of threads, instead of requiring a session per thread.
+  ///
+  /// The operations applied by each thread are sent in the order the thread
+  /// applied them; there is no ordering between operations applied by
+  /// different threads at the same time. Apply(), ApplyColumnarInserts(),
+  /// Flush() and FlushAsync() may be called concurrently; the other methods
+  /// of the session must not be called while operations are applied.
+  ///
+  /// By default, concurrent apply is disabled.
+  ///
+  /// @param [in] enable
+  ///   Whether to allow concurrent calls to Apply().
+  /// @return Operation result status. In particular, this method returns
+  ///   a non-OK status if there are pending operations.
+  Status SetConcurrentApply(bool enable) WARN_UNUSED_RESULT;
+
   /// Set the timeout for writes made in this session.
   ///
   /// @param [in] millis
@@ -1350,6 +1494,25 @@ class KUDU_EXPORT KuduSession : public sp::enable_shared_from_this<KuduSession>
   /// @return Operation result status.
   Status Apply(KuduWriteOperation* write_op) WARN_UNUSED_RESULT;
 
+  /// Apply a batch of columnar inserts.
+  ///
+  /// The rows of the batch are split by tablet and buffered like the
+  /// operations given to Apply(), in chunks which are encoded without
+  /// converting the rows back to KuduPartialRow objects. The location of
+  /// every tablet the rows belong to is looked up before this call returns.
+  ///
+  /// Errors on individual rows are reported in the session's error collector
+  /// as failed KuduInsert operations of those rows, so they can be retried
+  /// with Apply(). If a chunk of rows can't be buffered, the error is
+  /// reported for the chunk as a whole, and the remaining chunks are still
+  /// applied.
+  ///
+  /// @param [in] batch
+  ///   The inserts to apply. This method transfers the batch's ownership
+  ///   to the KuduSession.
+  /// @return Operation result status: the first error encountered, if any.
+  Status ApplyColumnarInserts(KuduColumnarInsertBatch* batch) WARN_UNUSED_RESULT;
+
   /// Flush any pending writes.
   ///
   /// This method initiates flushing of the current batch of buffered
@@ -1531,6 +1694,29 @@ class KUDU_EXPORT KuduScanner {
     ORDERED
   };
 
+  /// The layout in which the rows of a scan are returned.
+  enum RowLayout {
+    /// Each row is stored contiguously and may be accessed through
+    /// KuduScanBatch::RowPtr.
+    ///
+    /// This is the default layout.
+    ROWWISE,
+
+    /// The cells of each column are stored contiguously and may be accessed
+    /// through KuduScanBatch::GetFixedLengthColumn() and friends. This
+    /// avoids transposing the data into rows on both the server and the
+    /// client, which is cheaper for clients which process data by column.
+    COLUMNAR
+  };
+
+  /// The aggregate functions which a scan may compute on the tablet servers.
+  enum AggregateType {
+    COUNT, ///< The number of rows, or of non-null cells of a column.
+    SUM,   ///< The sum of the non-null cells of a numeric column.
+    MIN,   ///< The smallest non-null cell of a column.
+    MAX    ///< The largest non-null cell of a column.
+  };
+
   /// Default scanner timeout.
   /// This is set to 3x the default RPC timeout returned by
   /// KuduClientBuilder::default_rpc_timeout().
@@ -1658,6 +1844,22 @@ class KUDU_EXPORT KuduScanner {
   /// @return Result status of the operation (begin scanning).
   Status Open();
 
+  /// Begin scanning without blocking the calling thread.
+  ///
+  /// If the location of the first tablet to scan is cached, the scanner is
+  /// opened without tying up any thread while the tablet server responds.
+  /// Otherwise, the scanner is opened as by Open() on a client callback
+  /// thread.
+  ///
+  /// Unlike the callbacks of other async functions in Kudu, the callback
+  /// always runs on a client callback thread, and may block. The scanner
+  /// must not be used until the callback has run.
+  ///
+  /// @param [in] cb
+  ///   Callback to call with the result Open() would have returned.
+  ///   The @c cb must remain valid until it is invoked.
+  void OpenAsync(KuduStatusCallback* cb);
+
   /// Keep the current remote scanner alive.
   ///
   /// Keep the current remote scanner alive on the Tablet server
@@ -1673,6 +1875,8 @@ class KUDU_EXPORT KuduScanner {
   ///   status returned by this method should not be taken as indication
   ///   that the scan has failed. Subsequent calls to NextBatch() might
   ///   still be successful, particularly if SetFaultTolerant() has been called.
+  ///
+  /// @note This is a no-op for a parallel scan.
   Status KeepAlive();
 
   /// Close the scanner.
@@ -1719,6 +1923,23 @@ class KUDU_EXPORT KuduScanner {
   /// @return Operation result status.
   Status NextBatch(KuduScanBatch* batch);
 
+  /// Fetch the next batch of results for this scanner without blocking
+  /// the calling thread.
+  ///
+  /// While the current tablet has more rows, the request for the batch is
+  /// sent (or its prefetched response awaited) without tying up any thread.
+  /// Moving on to the next tablet is done like OpenAsync() does. As for
+  /// OpenAsync(), the callback always runs on a client callback thread, and
+  /// neither the scanner nor @c batch may be used until it has run.
+  ///
+  /// @param [out] batch
+  ///   Placeholder for the result. It must remain valid until @c cb is
+  ///   invoked.
+  /// @param [in] cb
+  ///   Callback to call with the result NextBatch() would have returned.
+  ///   The @c cb must remain valid until it is invoked.
+  void NextBatchAsync(KuduScanBatch* batch, KuduStatusCallback* cb);
+
   /// Get the KuduTabletServer that is currently handling the scan.
   ///
   /// More concretely, this is the server that handled the most recent
@@ -1732,6 +1953,31 @@ class KUDU_EXPORT KuduScanner {
   /// @return Cumulative resource metrics since the scan was started.
   const ResourceMetrics& GetResourceMetrics() const;
 
+  /// Collect a profile of the scan from the tablet servers.
+  ///
+  /// If enabled, every response of a tablet server reports the work done
+  /// to produce it: the time spent opening the scanner, reading rows and
+  /// adding them to the response, the rowsets pruned and cells skipped,
+  /// the delta stores applied, and the block cache hits and misses. The
+  /// reports are added up for each tablet and for the whole scan.
+  ///
+  /// @param [in] enabled
+  ///   Whether to collect the profile. Default is @c false.
+  /// @return Operation result status.
+  Status SetProfileEnabled(bool enabled) WARN_UNUSED_RESULT;
+
+  /// @return The profile of the scan since it was started, if enabled by
+  ///   SetProfileEnabled(). The @c scan_requests metric counts the requests
+  ///   whose reports were added up.
+  const ResourceMetrics& GetProfile() const;
+
+  /// Get the profile of each tablet scanned so far.
+  ///
+  /// @param [out] profiles
+  ///   The profile of each tablet, as by GetProfile(), keyed by tablet ID.
+  void GetTabletProfiles(
+      std::map<std::string, std::map<std::string, int64_t>>* profiles) const;
+
   /// Set the hint for the size of the next batch in bytes.
   ///
   /// @param [in] batch_size
@@ -1740,6 +1986,95 @@ class KUDU_EXPORT KuduScanner {
   /// @return Operation result status.
   Status SetBatchSizeBytes(uint32_t batch_size);
 
+  /// Fetch the next batch of a tablet while the current one is processed.
+  ///
+  /// If enabled, whenever NextBatch() returns a batch and the tablet being
+  /// scanned has more rows, the request for the following batch is sent
+  /// right away, so that the tablet server and the network work while the
+  /// application processes the returned batch. A single batch is fetched
+  /// ahead, so the additional memory is bounded by the batch size
+  /// (see SetBatchSizeBytes()).
+  ///
+  /// @param [in] prefetching
+  ///   Whether to prefetch batches. Default is @c false.
+  /// @return Operation result status.
+  Status SetPrefetching(bool prefetching) WARN_UNUSED_RESULT;
+
+  /// Limit the number of rows returned by the scan.
+  ///
+  /// Each tablet server stops reading once its tablet has produced the rows
+  /// still missing from the limit, and no further tablets are scanned once
+  /// the limit is reached.
+  ///
+  /// @note Limited scans require a tablet server which supports them, and
+  ///   may not compute aggregates.
+  ///
+  /// @param [in] limit
+  ///   The maximum number of rows to return. Must not be negative.
+  /// @return Operation result status.
+  Status SetLimit(int64_t limit) WARN_UNUSED_RESULT;
+
+  /// Scan several tablets at the same time.
+  ///
+  /// By default the tablets of a scan are scanned one after the other. With
+  /// a concurrency greater than 1, up to @c concurrency tablets are scanned
+  /// at once in the background, and NextBatch() returns their batches as
+  /// they arrive, interleaving the batches of different tablets unless
+  /// SetPreserveTabletOrder() is used.
+  ///
+  /// @note Parallel scans cannot be fault-tolerant, have a limit or compute
+  ///   aggregates. Their tablet scanners only wait for the application when
+  ///   the memory budget is used up, so KeepAlive() is a no-op for them, and
+  ///   GetCurrentServer() fails since there is no single current server.
+  ///
+  /// @param [in] concurrency
+  ///   The maximum number of tablets to scan at once. Must be positive.
+  ///   Default is 1.
+  /// @return Operation result status.
+  Status SetScanConcurrency(int concurrency) WARN_UNUSED_RESULT;
+
+  /// Bound the memory taken by the batches buffered by a parallel scan.
+  ///
+  /// The tablet scanners of a parallel scan stop fetching rows while the
+  /// batches they fetched, but NextBatch() did not return yet, take up at
+  /// least @c budget_bytes.
+  ///
+  /// @param [in] budget_bytes
+  ///   The memory budget. Must be positive. Default is 64 MiB.
+  /// @return Operation result status.
+  Status SetParallelScanMemoryBudget(int64_t budget_bytes) WARN_UNUSED_RESULT;
+
+  /// Return the batches of a parallel scan one tablet after the other.
+  ///
+  /// If set, NextBatch() returns all of the batches of a tablet before any
+  /// batch of the next tablet, in partition key order, as a serial scan does.
+  /// The following tablets are still scanned ahead, within the memory
+  /// budget. Otherwise, batches are returned as soon as they arrive.
+  ///
+  /// @param [in] preserve
+  ///   Whether to preserve the tablet order. Default is @c false.
+  /// @return Operation result status.
+  Status SetPreserveTabletOrder(bool preserve) WARN_UNUSED_RESULT;
+
+  /// Hedge the opens of the tablets of the scan against slow replicas.
+  ///
+  /// If the replica a tablet's scanner is opened on doesn't respond within
+  /// the given percentile of the open latencies this client observed so far,
+  /// the same request is sent to another replica, and the first response is
+  /// used. The scanner opened by the other request is closed. This trims the
+  /// tail latency of scans on servers stalled by e.g. disk or compactions,
+  /// at the cost of some duplicated requests.
+  ///
+  /// @note Opens are only hedged once the client observed enough of them to
+  ///   estimate the percentile, and not with the @c LEADER_ONLY replica
+  ///   selection, since there is no other replica to hedge with.
+  ///
+  /// @param [in] percentile
+  ///   The latency percentile, e.g. 99 to hedge the slowest 1% of the opens.
+  ///   Must be in [0, 100). Default is 0, which disables hedging.
+  /// @return Operation result status.
+  Status SetHedgingPercentile(double percentile) WARN_UNUSED_RESULT;
+
   /// Set the replica selection policy while scanning.
   ///
   /// @param [in] selection
@@ -1750,6 +2085,66 @@ class KUDU_EXPORT KuduScanner {
   Status SetSelection(KuduClient::ReplicaSelection selection)
     WARN_UNUSED_RESULT;
 
+  /// Set the layout of the rows returned by the scan.
+  ///
+  /// @note Scans in the @c COLUMNAR layout require a tablet server which
+  ///   supports it, and the rows of the returned batches can only be
+  ///   accessed through the columnar accessors of KuduScanBatch.
+  ///
+  /// @param [in] layout
+  ///   Row layout to set.
+  /// @return Operation result status.
+  Status SetRowLayout(RowLayout layout) WARN_UNUSED_RESULT;
+
+  /// Compute an aggregate over the rows of the scan instead of returning them.
+  ///
+  /// Once any aggregate is added, the tablet servers fold the rows matching
+  /// the scan's predicates into partial results and the batches returned by
+  /// NextBatch() are always empty. The partial results are merged across
+  /// batches and tablets, and may be retrieved with GetAggregateCount() and its
+  /// siblings once HasMoreRows() returns @c false.
+  ///
+  /// @note Aggregating scans require a tablet server which supports them.
+  ///
+  /// @param [in] type
+  ///   The aggregate function to compute.
+  /// @param [in] column_name
+  ///   The aggregated column, which must be part of the projection. May be
+  ///   empty for a @c COUNT of all rows.
+  /// @return Operation result status.
+  Status AddAggregate(AggregateType type, const std::string& column_name)
+    WARN_UNUSED_RESULT;
+
+  /// @name Accessors for the results of aggregates added with AddAggregate().
+  ///
+  /// The aggregates are identified by their index, in the order in which
+  /// they were added.
+  ///
+  /// GetAggregateCount() returns the number of rows, or of non-null cells,
+  /// which were aggregated, and supports every aggregate. The other
+  /// accessors return @c Status::NotFound if no non-null cell was
+  /// aggregated, and @c Status::InvalidArgument if the result does not have
+  /// the requested type:
+  ///   @li GetAggregateInt() supports a @c SUM of an integer column, and
+  ///     the @c MIN and @c MAX of integer, timestamp and boolean columns.
+  ///   @li GetAggregateDouble() supports a @c SUM, @c MIN or @c MAX of
+  ///     a floating-point column.
+  ///   @li GetAggregateString() supports the @c MIN and @c MAX of string
+  ///     and binary columns.
+  ///
+  /// @param [in] idx
+  ///   The index of the aggregate.
+  /// @param [out] val
+  ///   The result of the aggregate.
+  /// @return Operation result status.
+  ///
+  ///@{
+  Status GetAggregateCount(int idx, int64_t* val) const WARN_UNUSED_RESULT;
+  Status GetAggregateInt(int idx, int64_t* val) const WARN_UNUSED_RESULT;
+  Status GetAggregateDouble(int idx, double* val) const WARN_UNUSED_RESULT;
+  Status GetAggregateString(int idx, std::string* val) const WARN_UNUSED_RESULT;
+  ///@}
+
   /// Set the ReadMode. Default is @c READ_LATEST.
   ///
   /// @param [in] read_mode
@@ -1811,6 +2206,7 @@ class KUDU_EXPORT KuduScanner {
   class KUDU_NO_EXPORT Data;
 
   friend class KuduScanToken;
+  friend class internal::ParallelScan;
   FRIEND_TEST(ClientTest, TestScanCloseProxy);
   FRIEND_TEST(ClientTest, TestScanFaultTolerance);
   FRIEND_TEST(ClientTest, TestScanNoBlockCaching);
@@ -1982,6 +2378,20 @@ class KUDU_EXPORT KuduScanTokenBuilder {
   /// @copydoc KuduScanner::SetTimeoutMillis
   Status SetTimeoutMillis(int millis) WARN_UNUSED_RESULT;
 
+  /// Split the scan of each tablet into multiple tokens.
+  ///
+  /// By default, exactly one token is built per tablet, so the time taken
+  /// by a parallel scan is bound by its largest tablet. With this set, the
+  /// tablet servers are asked to split the range of each tablet into chunks
+  /// of about the given size, based on the key bounds and sizes of the
+  /// tablet's on-disk data, and a token is built for each chunk.
+  ///
+  /// @param [in] split_size_bytes
+  ///   The approximate amount of data scanned by each token, or 0 to build
+  ///   one token per tablet.
+  /// @return Operation result status.
+  Status SetSplitSizeBytes(uint64_t split_size_bytes) WARN_UNUSED_RESULT;
+
   /// Build the set of scan tokens.
   ///
   /// The builder may be reused after this call.
@@ -2004,6 +2414,70 @@ class KUDU_EXPORT KuduScanTokenBuilder {
   DISALLOW_COPY_AND_ASSIGN(KuduScanTokenBuilder);
 };
 
+/// @brief A batched lookup of rows by primary key.
+///
+/// Looking up a set of rows this way is much cheaper than with a scanner
+/// per key: the keys are grouped by tablet, and each tablet looks up all of
+/// its keys in a single RPC, which probes each rowset only for the keys it
+/// may contain and creates no scanner on the tablet server. The rows are
+/// read as of the latest state of each tablet on its leader.
+///
+/// @note This class is not thread-safe.
+class KUDU_EXPORT KuduRowLookup {
+ public:
+  /// Construct an instance of the class.
+  ///
+  /// @param [in] table
+  ///   The table to look up rows in. The given object must remain valid
+  ///   for the lifetime of this object.
+  explicit KuduRowLookup(KuduTable* table);
+  ~KuduRowLookup();
+
+  /// Set the columns to return for each row found, by name. By default,
+  /// all the columns are returned.
+  ///
+  /// @param [in] col_names
+  ///   Column names to use for the projection.
+  /// @return Operation result status.
+  Status SetProjectedColumnNames(const std::vector<std::string>& col_names)
+      WARN_UNUSED_RESULT;
+
+  /// Set the timeout for Run().
+  ///
+  /// @param [in] millis
+  ///   Timeout to set (in milliseconds). Defaults to the client's default
+  ///   RPC timeout.
+  /// @return Operation result status.
+  Status SetTimeoutMillis(int millis) WARN_UNUSED_RESULT;
+
+  /// Add the primary key of a row to look up.
+  ///
+  /// @param [in] key
+  ///   A row of the table with all of its primary key columns set. Only the
+  ///   primary key is read, and it is copied: the caller may invalidate
+  ///   @c key afterward.
+  /// @return Operation result status.
+  Status AddKey(const KuduPartialRow& key) WARN_UNUSED_RESULT;
+
+  /// Look up the rows of all the keys added since the last call.
+  ///
+  /// @param [out] batches
+  ///   The rows found, in no particular order, in a batch per tablet. Keys
+  ///   which have no row are skipped. The caller takes ownership of the
+  ///   container elements, which must not outlive this object.
+  /// @return Operation result status. If looking up the keys of any tablet
+  ///   fails, no batch is returned.
+  Status Run(std::vector<KuduScanBatch*>* batches) WARN_UNUSED_RESULT;
+
+ private:
+  class KUDU_NO_EXPORT Data;
+
+  // Owned.
+  Data* data_;
+
+  DISALLOW_COPY_AND_ASSIGN(KuduRowLookup);
+};
+
 } // namespace client
 } // namespace kudu
 #endif
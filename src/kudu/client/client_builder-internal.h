@@ -34,6 +34,8 @@ class KuduClientBuilder::Data {
   std::vector<std::string> master_server_addrs_;
   MonoDelta default_admin_operation_timeout_;
   MonoDelta default_rpc_timeout_;
+  int64_t memory_limit_bytes_;
+  MonoDelta table_metadata_cache_ttl_;
 
   DISALLOW_COPY_AND_ASSIGN(Data);
 };
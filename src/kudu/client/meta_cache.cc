@@ -33,6 +33,7 @@
 #include "kudu/rpc/messenger.h"
 #include "kudu/rpc/rpc.h"
 #include "kudu/tserver/tserver_service.proxy.h"
+#include "kudu/util/async_util.h"
 #include "kudu/util/net/dns_resolver.h"
 #include "kudu/util/net/net_util.h"
 
@@ -61,12 +62,23 @@ namespace internal {
 
 namespace {
 const int MAX_RETURNED_TABLE_LOCATIONS = 10;
+
+// The number of locations asked for by each master RPC of a prefetch. The
+// master may return fewer, in which case the prefetch takes more RPCs.
+const int MAX_PREFETCHED_TABLE_LOCATIONS = 1000;
+
+// The weight of the latest RPC in the moving average of a server's latency.
+// Recent RPCs dominate, so that a server which becomes overloaded is avoided
+// within a handful of RPCs.
+const double kLatencyEwmaWeight = 0.2;
 } // anonymous namespace
 
 ////////////////////////////////////////////////////////////
 
 RemoteTabletServer::RemoteTabletServer(const master::TSInfoPB& pb)
-  : uuid_(pb.permanent_uuid()) {
+  : uuid_(pb.permanent_uuid()),
+    latency_ewma_us_(0),
+    num_rpcs_in_flight_(0) {
 
   Update(pb);
 }
@@ -139,12 +151,50 @@ const string& RemoteTabletServer::permanent_uuid() const {
   return uuid_;
 }
 
+void RemoteTabletServer::RpcStarted() {
+  std::lock_guard<simple_spinlock> l(lock_);
+  num_rpcs_in_flight_++;
+}
+
+void RemoteTabletServer::RpcFinished(const MonoTime& sent, bool failed) {
+  MonoTime now = MonoTime::Now();
+  double latency_us = (now - sent).ToMicroseconds();
+  std::lock_guard<simple_spinlock> l(lock_);
+  DCHECK_GT(num_rpcs_in_flight_, 0);
+  num_rpcs_in_flight_--;
+  if (latency_ewma_us_ == 0) {
+    latency_ewma_us_ = latency_us;
+  } else {
+    latency_ewma_us_ += kLatencyEwmaWeight * (latency_us - latency_ewma_us_);
+  }
+  if (failed) {
+    last_failure_time_ = now;
+  }
+}
+
+double RemoteTabletServer::LatencyScore() const {
+  std::lock_guard<simple_spinlock> l(lock_);
+  // Adding a microsecond orders the servers without samples by their number
+  // of RPCs in flight.
+  return (latency_ewma_us_ + 1) * (1 + num_rpcs_in_flight_);
+}
+
+bool RemoteTabletServer::FailedWithin(const MonoDelta& window) const {
+  std::lock_guard<simple_spinlock> l(lock_);
+  return last_failure_time_.Initialized() && MonoTime::Now() - last_failure_time_ < window;
+}
+
 shared_ptr<TabletServerServiceProxy> RemoteTabletServer::proxy() const {
   std::lock_guard<simple_spinlock> l(lock_);
   CHECK(proxy_);
   return proxy_;
 }
 
+shared_ptr<TabletServerServiceProxy> RemoteTabletServer::proxy_if_initialized() const {
+  std::lock_guard<simple_spinlock> l(lock_);
+  return proxy_;
+}
+
 string RemoteTabletServer::ToString() const {
   string ret = uuid_;
   std::lock_guard<simple_spinlock> l(lock_);
@@ -526,7 +576,8 @@ class LookupRpc : public Rpc {
             scoped_refptr<RemoteTablet>* remote_tablet,
             const MonoTime& deadline,
             const shared_ptr<Messenger>& messenger,
-            bool is_exact_lookup);
+            bool is_exact_lookup,
+            int max_returned_locations = MAX_RETURNED_TABLE_LOCATIONS);
   virtual ~LookupRpc();
   virtual void SendRpc() OVERRIDE;
   virtual string ToString() const OVERRIDE;
@@ -585,6 +636,9 @@ class LookupRpc : public Rpc {
   // partition key. If false, the next tablet after the partition key should be
   // returned if the partition key falls in a non-covered partition range.
   bool is_exact_lookup_;
+
+  // The number of tablet locations to ask the master for.
+  const int max_returned_locations_;
 };
 
 LookupRpc::LookupRpc(const scoped_refptr<MetaCache>& meta_cache,
@@ -593,7 +647,8 @@ LookupRpc::LookupRpc(const scoped_refptr<MetaCache>& meta_cache,
                      scoped_refptr<RemoteTablet>* remote_tablet,
                      const MonoTime& deadline,
                      const shared_ptr<Messenger>& messenger,
-                     bool is_exact_lookup)
+                     bool is_exact_lookup,
+                     int max_returned_locations)
     : Rpc(deadline, messenger),
       meta_cache_(meta_cache),
       user_cb_(std::move(user_cb)),
@@ -601,7 +656,8 @@ LookupRpc::LookupRpc(const scoped_refptr<MetaCache>& meta_cache,
       partition_key_(std::move(partition_key)),
       remote_tablet_(remote_tablet),
       has_permit_(false),
-      is_exact_lookup_(is_exact_lookup) {
+      is_exact_lookup_(is_exact_lookup),
+      max_returned_locations_(max_returned_locations) {
   DCHECK(deadline.Initialized());
 }
 
@@ -651,7 +707,7 @@ void LookupRpc::SendRpc() {
   // Fill out the request.
   req_.mutable_table()->set_table_id(table_->id());
   req_.set_partition_key_start(partition_key_);
-  req_.set_max_returned_locations(MAX_RETURNED_TABLE_LOCATIONS);
+  req_.set_max_returned_locations(max_returned_locations_);
 
   // The end partition key is left unset intentionally so that we'll prefetch
   // some additional tablets.
@@ -897,9 +953,12 @@ Status MetaCache::ProcessLookupResponse(const LookupRpc& rpc,
       InsertOrDie(&tablets_by_key, tablet_lower_bound, std::move(entry));
     }
 
-    if (!last_upper_bound.empty() && tablet_locations.size() < MAX_RETURNED_TABLE_LOCATIONS) {
+    if (!last_upper_bound.empty() && !rpc.resp().has_next_partition_key() &&
+        tablet_locations.size() < rpc.req().max_returned_locations()) {
       // There is a non-covered range between the last tablet and the end of the
-      // partition key space, such as F.
+      // partition key space, such as F. A master which limits the number of
+      // locations it returns sets the next partition key if there are more
+      // tablets, so a short response doesn't necessarily mean this.
 
       // Clear existing entries which overlap with the discovered non-covered range.
       tablets_by_key.erase(tablets_by_key.lower_bound(last_upper_bound),
@@ -950,6 +1009,23 @@ bool MetaCache::LookupTabletByKeyFastPath(const KuduTable* table,
   return false;
 }
 
+bool MetaCache::LookupCachedTabletByKey(const KuduTable* table,
+                                        const string& partition_key,
+                                        scoped_refptr<RemoteTablet>* remote_tablet) {
+  shared_lock<rw_spinlock> l(lock_);
+  const TabletMap* tablets = FindOrNull(tablets_by_table_and_key_, table->id());
+  if (PREDICT_FALSE(!tablets)) {
+    return false;
+  }
+  const MetaCacheEntry* e = FindFloorOrNull(*tablets, partition_key);
+  if (PREDICT_FALSE(!e) || e->is_non_covered_range() || e->stale() ||
+      !e->Contains(partition_key) || !e->tablet()->HasLeader()) {
+    return false;
+  }
+  *remote_tablet = e->tablet();
+  return true;
+}
+
 void MetaCache::ClearCache() {
   VLOG(3) << "Clearing cache";
   std::lock_guard<rw_spinlock> l(lock_);
@@ -974,6 +1050,37 @@ void MetaCache::LookupTabletByKey(const KuduTable* table,
   rpc->SendRpc();
 }
 
+Status MetaCache::PrefetchTableLocations(const KuduTable* table, const MonoTime& deadline) {
+  string partition_key;
+  while (true) {
+    // Ranges with fresh cache entries are answered by the lookup's fast path.
+    // Otherwise, the lookup fetches the locations of the tablets following
+    // 'partition_key' along with it, so the next iterations hit the cache.
+    scoped_refptr<RemoteTablet> remote_tablet;
+    Synchronizer sync;
+    LookupRpc* rpc = new LookupRpc(this,
+                                   sync.AsStatusCallback(),
+                                   table,
+                                   partition_key,
+                                   &remote_tablet,
+                                   deadline,
+                                   client_->data_->messenger_,
+                                   false,
+                                   MAX_PREFETCHED_TABLE_LOCATIONS);
+    rpc->SendRpc();
+    Status s = sync.Wait();
+    if (s.IsNotFound()) {
+      // The rest of the partition key space is not covered by any tablet.
+      return Status::OK();
+    }
+    RETURN_NOT_OK(s);
+    partition_key = remote_tablet->partition().partition_key_end();
+    if (partition_key.empty()) {
+      return Status::OK();
+    }
+  }
+}
+
 void MetaCache::LookupTabletByKeyOrNext(const KuduTable* table,
                                         string partition_key,
                                         const MonoTime& deadline,
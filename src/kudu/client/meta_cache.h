@@ -87,6 +87,9 @@ class RemoteTabletServer {
   // be called prior to this.
   std::shared_ptr<tserver::TabletServerServiceProxy> proxy() const;
 
+  // Like proxy(), but returns null if InitProxy() hasn't completed yet.
+  std::shared_ptr<tserver::TabletServerServiceProxy> proxy_if_initialized() const;
+
   std::string ToString() const;
 
   void GetHostPorts(std::vector<HostPort>* host_ports) const;
@@ -94,6 +97,23 @@ class RemoteTabletServer {
   // Returns the remote server's uuid.
   const std::string& permanent_uuid() const;
 
+  // Record that an RPC is being sent to this server.
+  void RpcStarted();
+
+  // Record the completion of an RPC to this server which was sent at 'sent'.
+  // 'failed' is whether it failed in a way suggesting that the server is
+  // unhealthy, e.g. with a network error, a timeout, or an overloaded queue.
+  void RpcFinished(const MonoTime& sent, bool failed);
+
+  // An estimate of how long the next RPC to this server would take, for
+  // ranking the replicas of a tablet: the moving average of the latency of
+  // recent RPCs, scaled by the number of RPCs still in flight. Servers which
+  // haven't completed any RPC yet rank first, so that they are tried.
+  double LatencyScore() const;
+
+  // Whether an RPC to this server failed within the last 'window'.
+  bool FailedWithin(const MonoDelta& window) const;
+
  private:
   // Internal callback for DNS resolution.
   void DnsResolutionFinished(const HostPort& hp,
@@ -108,6 +128,12 @@ class RemoteTabletServer {
   std::vector<HostPort> rpc_hostports_;
   std::shared_ptr<tserver::TabletServerServiceProxy> proxy_;
 
+  // Exponentially weighted moving average of the latency of the RPCs to this
+  // server, or 0 if there were none yet.
+  double latency_ewma_us_;
+  int num_rpcs_in_flight_;
+  MonoTime last_failure_time_;
+
   DISALLOW_COPY_AND_ASSIGN(RemoteTabletServer);
 };
 
@@ -377,6 +403,23 @@ class MetaCache : public RefCountedThreadSafe<MetaCache> {
                                scoped_refptr<RemoteTablet>* remote_tablet,
                                const StatusCallback& callback);
 
+  // Look up which tablet hosts the given partition key for a table, only
+  // consulting the cached tablet locations. Returns true and sets
+  // 'remote_tablet' if the key is covered by a fresh cache entry of a tablet
+  // with a LEADER. Otherwise, LookupTabletByKey() must be used.
+  //
+  // Unlike LookupTabletByKey(), this never allocates an RPC or runs a
+  // callback, which makes it suitable for the per-operation write path.
+  bool LookupCachedTabletByKey(const KuduTable* table,
+                               const std::string& partition_key,
+                               scoped_refptr<RemoteTablet>* remote_tablet);
+
+  // Load the locations of all of the tablets of 'table' into the cache,
+  // fetching many of them per master RPC. Ranges of the partition key space
+  // whose cached entries are still fresh are not fetched again, so calling
+  // this periodically refreshes only what has expired.
+  Status PrefetchTableLocations(const KuduTable* table, const MonoTime& deadline);
+
   // Clears the meta cache.
   void ClearCache();
 
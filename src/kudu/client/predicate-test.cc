@@ -261,6 +261,30 @@ class PredicateTest : public KuduTest {
         }));
       }
 
+      { // value IN (v, 0, 49)
+        int count = count_if(values.begin(), values.end(),
+                             [&] (T value) { return value == v || value == 0 || value == 49; });
+        vector<KuduValue*> in_list = {
+          KuduValue::FromInt(v),
+          KuduValue::FromInt(0),
+          KuduValue::FromInt(49),
+        };
+        ASSERT_EQ(count, CountRows(table, { table->NewInListPredicate("value", &in_list) }));
+      }
+
+      { // value IN (v, 0)
+        // value >= 0
+        int count = count_if(values.begin(), values.end(),
+                             [&] (T value) { return (value == v || value == 0) && value >= 0; });
+        vector<KuduValue*> in_list = { KuduValue::FromInt(v), KuduValue::FromInt(0) };
+        ASSERT_EQ(count, CountRows(table, {
+              table->NewInListPredicate("value", &in_list),
+              table->NewComparisonPredicate("value",
+                                            KuduPredicate::GREATER_EQUAL,
+                                            KuduValue::FromInt(0)),
+        }));
+      }
+
       { // value >= 0
         // value <= v
         int count = count_if(values.begin(), values.end(),
@@ -356,6 +380,13 @@ class PredicateTest : public KuduTest {
         }));
       }
 
+      { // value IN (v, "a")
+        int count = count_if(values.begin(), values.end(),
+                             [&] (const string& value) { return value == v || value == "a"; });
+        vector<KuduValue*> in_list = { KuduValue::CopyString(v), KuduValue::CopyString("a") };
+        ASSERT_EQ(count, CountRows(table, { table->NewInListPredicate("value", &in_list) }));
+      }
+
       { // value >= "a"
         // value <= v
         int count = count_if(values.begin(), values.end(),
@@ -0,0 +1,261 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/client/row_lookup-internal.h"
+
+#include <boost/bind.hpp>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "kudu/client/client-internal.h"
+#include "kudu/client/meta_cache.h"
+#include "kudu/client/scanner-internal.h"
+#include "kudu/common/partial_row.h"
+#include "kudu/common/wire_protocol.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/rpc/rpc_controller.h"
+#include "kudu/tserver/tserver_service.proxy.h"
+#include "kudu/util/async_util.h"
+#include "kudu/util/countdown_latch.h"
+
+using std::map;
+using std::set;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+using strings::Substitute;
+
+namespace kudu {
+
+using rpc::RpcController;
+using tserver::LookupRowsRequestPB;
+using tserver::LookupRowsResponsePB;
+using tserver::TabletServerErrorPB;
+using tserver::TabletServerFeatures;
+
+namespace client {
+
+using internal::MetaCache;
+using internal::RemoteTablet;
+using internal::RemoteTabletServer;
+
+// The keys of a single tablet, and the state of the RPC looking them up.
+struct KuduRowLookup::Data::TabletLookup {
+  scoped_refptr<RemoteTablet> tablet;
+
+  // The server the last attempt was sent to, and the error which prevented
+  // sending it, if any.
+  RemoteTabletServer* ts = nullptr;
+  Status send_status;
+
+  LookupRowsRequestPB req;
+  LookupRowsResponsePB resp;
+  RpcController controller;
+};
+
+KuduRowLookup::Data::Data(KuduTable* table)
+    : table_(DCHECK_NOTNULL(table)->shared_from_this()),
+      projection_(table->schema().schema_),
+      client_projection_(&table->schema()),
+      timeout_(table->client()->default_rpc_timeout()) {
+}
+
+KuduRowLookup::Data::~Data() {
+}
+
+Status KuduRowLookup::Data::SetProjectedColumnNames(const vector<string>& col_names) {
+  const Schema& schema = *table_->schema().schema_;
+  vector<ColumnSchema> cols;
+  cols.reserve(col_names.size());
+  for (const string& col_name : col_names) {
+    int idx = schema.find_column(col_name);
+    if (idx == Schema::kColumnNotFound) {
+      return Status::NotFound(Substitute(
+          "Column: \"$0\" was not found in the table schema.", col_name));
+    }
+    cols.push_back(schema.column(idx));
+  }
+  unique_ptr<Schema> projection(new Schema());
+  RETURN_NOT_OK(projection->Reset(cols, 0));
+  projection_ = pool_.Add(projection.release());
+  client_projection_ = pool_.Add(new KuduSchema(*projection_));
+  return Status::OK();
+}
+
+Status KuduRowLookup::Data::AddKey(const KuduPartialRow& key) {
+  if (PREDICT_FALSE(key.schema() != table_->schema().schema_)) {
+    return Status::InvalidArgument("key is not a row of the table",
+                                   key.ToString());
+  }
+  if (PREDICT_FALSE(!key.IsKeySet())) {
+    return Status::IllegalState("key not specified", key.ToString());
+  }
+  string partition_key;
+  RETURN_NOT_OK(table_->partition_schema().EncodeKey(key, &partition_key));
+  string encoded_key;
+  RETURN_NOT_OK(key.EncodeRowKey(&encoded_key));
+  keys_.emplace_back(std::move(partition_key), std::move(encoded_key));
+  return Status::OK();
+}
+
+void KuduRowLookup::Data::SendLookup(TabletLookup* lookup,
+                                     const MonoTime& deadline,
+                                     CountDownLatch* latch) {
+  KuduClient* client = table_->client();
+  vector<RemoteTabletServer*> candidates;
+  lookup->send_status = client->data_->GetTabletServer(client,
+                                                       lookup->tablet,
+                                                       KuduClient::LEADER_ONLY,
+                                                       set<string>(),
+                                                       &candidates,
+                                                       &lookup->ts);
+  if (PREDICT_FALSE(!lookup->send_status.ok())) {
+    latch->CountDown();
+    return;
+  }
+  lookup->resp.Clear();
+  lookup->controller.Reset();
+  lookup->controller.set_deadline(deadline);
+  lookup->controller.RequireServerFeature(TabletServerFeatures::LOOKUP_ROWS);
+  lookup->ts->proxy()->LookupRowsAsync(lookup->req, &lookup->resp, &lookup->controller,
+                                       boost::bind(&CountDownLatch::CountDown, latch));
+}
+
+Status KuduRowLookup::Data::FinishLookup(TabletLookup* lookup, const MonoTime& deadline) {
+  MetaCache* meta_cache = table_->client()->data_->meta_cache_.get();
+  for (int attempt = 1;; attempt++) {
+    Status s;
+    bool retry;
+    if (!lookup->send_status.ok()) {
+      // The tablet has no known leader, which is likely to be elected soon.
+      s = lookup->send_status;
+      retry = s.IsServiceUnavailable();
+    } else if (!lookup->controller.status().ok()) {
+      s = lookup->controller.status();
+      retry = s.IsNetworkError() || s.IsServiceUnavailable();
+      if (s.IsNetworkError()) {
+        meta_cache->MarkTSFailed(lookup->ts, s);
+      }
+    } else if (lookup->resp.has_error()) {
+      s = StatusFromPB(lookup->resp.error().status());
+      switch (lookup->resp.error().code()) {
+        case TabletServerErrorPB::NOT_THE_LEADER:
+          lookup->tablet->MarkTServerAsFollower(lookup->ts);
+          retry = true;
+          break;
+        case TabletServerErrorPB::TABLET_NOT_FOUND:
+        case TabletServerErrorPB::TABLET_NOT_RUNNING:
+          retry = true;
+          break;
+        default:
+          retry = false;
+          break;
+      }
+    } else {
+      return Status::OK();
+    }
+    if (!retry || MonoTime::Now() >= deadline) {
+      return s.CloneAndPrepend(Substitute("Failed to look up rows of tablet $0",
+                                          lookup->tablet->tablet_id()));
+    }
+    VLOG(1) << "Retrying row lookup in tablet " << lookup->tablet->tablet_id()
+            << " after error: " << s.ToString();
+    SleepFor(KuduClient::Data::ComputeExponentialBackoff(attempt));
+
+    // Refresh the replicas of the tablet, in case its leader changed.
+    lookup->tablet->MarkStale();
+    Synchronizer sync;
+    meta_cache->LookupTabletByKey(table_.get(),
+                                  lookup->tablet->partition().partition_key_start(),
+                                  deadline,
+                                  &lookup->tablet,
+                                  sync.AsStatusCallback());
+    RETURN_NOT_OK(sync.Wait());
+
+    CountDownLatch latch(1);
+    SendLookup(lookup, deadline, &latch);
+    latch.Wait();
+  }
+}
+
+Status KuduRowLookup::Data::Run(vector<KuduScanBatch*>* batches) {
+  MonoTime deadline = MonoTime::Now() + timeout_;
+  MetaCache* meta_cache = table_->client()->data_->meta_cache_.get();
+
+  // Group the keys by tablet.
+  map<string, unique_ptr<TabletLookup>> lookups;
+  for (const auto& key : keys_) {
+    scoped_refptr<RemoteTablet> tablet;
+    if (!meta_cache->LookupCachedTabletByKey(table_.get(), key.first, &tablet)) {
+      Synchronizer sync;
+      meta_cache->LookupTabletByKey(table_.get(), key.first, deadline, &tablet,
+                                    sync.AsStatusCallback());
+      Status s = sync.Wait();
+      if (s.IsNotFound()) {
+        // The key is in a non-covered range, so it has no row.
+        continue;
+      }
+      RETURN_NOT_OK(s);
+    }
+    unique_ptr<TabletLookup>& lookup = lookups[tablet->tablet_id()];
+    if (!lookup) {
+      lookup.reset(new TabletLookup);
+      lookup->tablet = tablet;
+      lookup->req.set_tablet_id(tablet->tablet_id());
+      RETURN_NOT_OK(SchemaToColumnPBs(*projection_,
+                                      lookup->req.mutable_projected_columns(),
+                                      SCHEMA_PB_WITHOUT_STORAGE_ATTRIBUTES |
+                                      SCHEMA_PB_WITHOUT_IDS));
+    }
+    lookup->req.add_encoded_primary_keys(key.second);
+  }
+  keys_.clear();
+
+  // Look up the keys of all the tablets in parallel. Failed lookups are
+  // retried one tablet at a time.
+  CountDownLatch latch(lookups.size());
+  for (auto& entry : lookups) {
+    SendLookup(entry.second.get(), deadline, &latch);
+  }
+  latch.Wait();
+
+  vector<unique_ptr<KuduScanBatch>> ret;
+  for (auto& entry : lookups) {
+    TabletLookup* lookup = entry.second.get();
+    RETURN_NOT_OK(FinishLookup(lookup, deadline));
+    if (!lookup->resp.has_data()) {
+      // None of the keys of the tablet were found.
+      continue;
+    }
+    unique_ptr<KuduScanBatch> batch(new KuduScanBatch);
+    RETURN_NOT_OK(batch->data_->Reset(&lookup->controller,
+                                      projection_,
+                                      client_projection_,
+                                      make_gscoped_ptr(lookup->resp.release_data())));
+    ret.emplace_back(std::move(batch));
+  }
+  for (auto& batch : ret) {
+    batches->push_back(batch.release());
+  }
+  return Status::OK();
+}
+
+} // namespace client
+} // namespace kudu
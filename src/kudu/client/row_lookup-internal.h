@@ -0,0 +1,75 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#pragma once
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "kudu/client/client.h"
+#include "kudu/common/schema.h"
+#include "kudu/util/auto_release_pool.h"
+#include "kudu/util/monotime.h"
+
+namespace kudu {
+
+class CountDownLatch;
+
+namespace client {
+
+class KuduRowLookup::Data {
+ public:
+  explicit Data(KuduTable* table);
+  ~Data();
+
+  Status SetProjectedColumnNames(const std::vector<std::string>& col_names);
+
+  Status AddKey(const KuduPartialRow& key);
+
+  Status Run(std::vector<KuduScanBatch*>* batches);
+
+  sp::shared_ptr<KuduTable> table_;
+
+  // The columns to return, and the same projection as seen by the user.
+  // Initially the table schema. Otherwise owned by 'pool_', so that the
+  // batches returned before changing the projection stay valid.
+  const Schema* projection_;
+  const KuduSchema* client_projection_;
+  AutoReleasePool pool_;
+
+  MonoDelta timeout_;
+
+  // The partition key and the encoded primary key of each added key.
+  std::vector<std::pair<std::string, std::string>> keys_;
+
+ private:
+  struct TabletLookup;
+
+  // Sends the lookup RPC of 'lookup' to the leader of its tablet, and counts
+  // down 'latch' once it completes.
+  void SendLookup(TabletLookup* lookup, const MonoTime& deadline, CountDownLatch* latch);
+
+  // Returns the result of the last attempt of 'lookup', retrying it for as
+  // long as the error is transient and 'deadline' allows.
+  Status FinishLookup(TabletLookup* lookup, const MonoTime& deadline);
+
+  DISALLOW_COPY_AND_ASSIGN(Data);
+};
+
+} // namespace client
+} // namespace kudu
@@ -20,6 +20,7 @@
 #include "kudu/client/scanner-internal.h"
 #include "kudu/client/schema.h"
 
+#include <algorithm>
 #include <string>
 
 #include "kudu/common/schema.h"
@@ -54,6 +55,44 @@ const KuduSchema* KuduScanBatch::projection_schema() const {
   return data_->client_projection_;
 }
 
+sp::shared_ptr<KuduScanBatch> KuduScanBatch::Detach() {
+  sp::shared_ptr<KuduScanBatch> detached(new KuduScanBatch());
+  std::swap(data_, detached->data_);
+  detached->data_->OwnProjection();
+  return detached;
+}
+
+Status KuduScanBatch::GetFixedLengthColumn(int idx, Slice* data) const {
+  RETURN_NOT_OK(data_->CheckColumnarColumn(idx));
+  const ColumnSchema& col = data_->projection_->column(idx);
+  if (PREDICT_FALSE(col.type_info()->physical_type() == BINARY)) {
+    return Status::InvalidArgument("Column has a variable-length type", col.name());
+  }
+  *data = data_->column_data_[idx];
+  return Status::OK();
+}
+
+Status KuduScanBatch::GetVariableLengthColumn(int idx, Slice* offsets, Slice* data) const {
+  RETURN_NOT_OK(data_->CheckColumnarColumn(idx));
+  const ColumnSchema& col = data_->projection_->column(idx);
+  if (PREDICT_FALSE(col.type_info()->physical_type() != BINARY)) {
+    return Status::InvalidArgument("Column has a fixed-length type", col.name());
+  }
+  *offsets = data_->column_data_[idx];
+  *data = data_->column_varlen_data_[idx];
+  return Status::OK();
+}
+
+Status KuduScanBatch::GetNonNullBitmapForColumn(int idx, Slice* bitmap) const {
+  RETURN_NOT_OK(data_->CheckColumnarColumn(idx));
+  const ColumnSchema& col = data_->projection_->column(idx);
+  if (PREDICT_FALSE(!col.is_nullable())) {
+    return Status::InvalidArgument("Column is not nullable", col.name());
+  }
+  *bitmap = data_->column_non_null_bitmaps_[idx];
+  return Status::OK();
+}
+
 ////////////////////////////////////////////////////////////
 // KuduScanBatch::RowPtr
 ////////////////////////////////////////////////////////////
@@ -187,6 +226,22 @@ Status KuduScanBatch::RowPtr::GetBinary(int col_idx, Slice* val) const {
   return Get<TypeTraits<BINARY> >(col_idx, val);
 }
 
+Status KuduScanBatch::RowPtr::GetUnscaledDecimal(const Slice& col_name, int64_t* val) const {
+  int col_idx;
+  RETURN_NOT_OK(FindColumn(*schema_, col_name, &col_idx));
+  return GetUnscaledDecimal(col_idx, val);
+}
+
+Status KuduScanBatch::RowPtr::GetUnscaledDecimal(int col_idx, int64_t* val) const {
+  if (schema_->column(col_idx).type_info()->type() == DECIMAL32) {
+    int32_t val32;
+    RETURN_NOT_OK(Get<TypeTraits<DECIMAL32> >(col_idx, &val32));
+    *val = val32;
+    return Status::OK();
+  }
+  return Get<TypeTraits<DECIMAL64> >(col_idx, val);
+}
+
 template<typename T>
 Status KuduScanBatch::RowPtr::Get(const Slice& col_name, typename T::cpp_type* val) const {
   int col_idx;
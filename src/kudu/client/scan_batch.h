@@ -26,6 +26,7 @@
 #include "kudu/client/stubs.h"
 #endif
 
+#include "kudu/client/shared_ptr.h"
 #include "kudu/util/kudu_export.h"
 #include "kudu/util/slice.h"
 
@@ -39,6 +40,10 @@ class ReplicaDumper;
 namespace client {
 class KuduSchema;
 
+namespace internal {
+class ParallelScan;
+} // namespace internal
+
 /// @brief A batch of zero or more rows returned by a scan operation.
 ///
 /// Every call to KuduScanner::NextBatch() returns a batch of zero or more rows.
@@ -116,9 +121,77 @@ class KUDU_EXPORT KuduScanBatch {
   ///   to have this schema.
   const KuduSchema* projection_schema() const;
 
+  /// Take ownership of the rows of this batch without copying them.
+  ///
+  /// Normally the memory backing a batch is reused or freed by the next
+  /// KuduScanner::NextBatch() call. This method instead moves the rows, along
+  /// with the RPC buffers holding them, into a new reference-counted batch
+  /// which stays valid until the last reference to it is dropped. The
+  /// scanner receives the next batch into freshly allocated buffers, so
+  /// the detached rows are never overwritten.
+  ///
+  /// @note After this call, this batch is empty. The detached batch keeps
+  ///   its own copy of the projection schema, so it may also outlive
+  ///   the scanner which produced it.
+  ///
+  /// @return A batch holding the rows formerly held by this batch.
+  sp::shared_ptr<KuduScanBatch> Detach();
+
+  /// @name Accessors for batches in the columnar layout.
+  ///
+  /// If the scanner was configured with
+  /// KuduScanner::SetRowLayout(KuduScanner::COLUMNAR), the cells of each
+  /// column are returned contiguously and must be accessed with the methods
+  /// below rather than through KuduScanBatch::RowPtr. The returned slices
+  /// are only valid for as long as this KuduScanBatch object is valid, and
+  /// column indexes refer to the projection schema.
+  ///
+  ///@{
+  /// Get the cells of a fixed-length column.
+  ///
+  /// @param [in] idx
+  ///   The index of the column in the projection.
+  /// @param [out] data
+  ///   NumRows() cells in the in-memory format of the column's type.
+  ///   The contents of NULL cells are undefined.
+  /// @return Operation result status. Returns a bad Status if the batch
+  ///   is not in the columnar layout, or if the column does not exist or
+  ///   has a variable-length type.
+  Status GetFixedLengthColumn(int idx, Slice* data) const WARN_UNUSED_RESULT;
+
+  /// Get the cells of a variable-length (STRING or BINARY) column.
+  ///
+  /// @param [in] idx
+  ///   The index of the column in the projection.
+  /// @param [out] offsets
+  ///   NumRows() + 1 uint32_t offsets into @c data: the value of row i
+  ///   spans [offsets[i], offsets[i + 1]). NULL cells are empty.
+  /// @param [out] data
+  ///   The concatenated values of the column.
+  /// @return Operation result status. Returns a bad Status if the batch
+  ///   is not in the columnar layout, or if the column does not exist or
+  ///   has a fixed-length type.
+  Status GetVariableLengthColumn(int idx, Slice* offsets, Slice* data) const
+      WARN_UNUSED_RESULT;
+
+  /// Get the non-null bitmap of a nullable column.
+  ///
+  /// @param [in] idx
+  ///   The index of the column in the projection.
+  /// @param [out] bitmap
+  ///   A bitmap with one bit per row, least significant bit first, which is
+  ///   set if the cell in that row is not NULL.
+  /// @return Operation result status. Returns a bad Status if the batch
+  ///   is not in the columnar layout, or if the column does not exist or
+  ///   is not nullable.
+  Status GetNonNullBitmapForColumn(int idx, Slice* bitmap) const WARN_UNUSED_RESULT;
+  ///@}
+
  private:
   class KUDU_NO_EXPORT Data;
+  friend class KuduRowLookup;
   friend class KuduScanner;
+  friend class internal::ParallelScan;
   friend class tools::ReplicaDumper;
 
   Data* data_;
@@ -197,6 +270,24 @@ class KUDU_EXPORT KuduScanBatch::RowPtr {
   Status GetDouble(int col_idx, double* val) const WARN_UNUSED_RESULT;
   ///@}
 
+  /// @name Getters for decimal columns.
+  ///
+  /// Get the unscaled value of a decimal column, i.e. its value multiplied
+  /// by 10 to the power of the scale of the column.
+  ///
+  /// @param [out] val
+  ///   Pointer to the placeholder to put the resulting value.
+  ///
+  /// @return Operation result status. Return a bad Status if at least one
+  ///   of the following is @c true:
+  ///     @li The column is not a decimal.
+  ///     @li The value is @c NULL.
+  ///
+  ///@{
+  Status GetUnscaledDecimal(const Slice& col_name, int64_t* val) const WARN_UNUSED_RESULT;
+  Status GetUnscaledDecimal(int col_idx, int64_t* val) const WARN_UNUSED_RESULT;
+  ///@}
+
   /// @name Getters for string/binary column by column name.
   ///
   /// Get the string/binary value for a column by its name.
@@ -41,6 +41,14 @@ ScanConfiguration::ScanConfiguration(KuduTable* table)
       selection_(KuduClient::CLOSEST_REPLICA),
       read_mode_(KuduScanner::READ_LATEST),
       is_fault_tolerant_(false),
+      row_layout_(KuduScanner::ROWWISE),
+      prefetching_(false),
+      profile_enabled_(false),
+      limit_(-1),
+      scan_concurrency_(1),
+      parallel_scan_memory_budget_(kDefaultParallelScanMemoryBudget),
+      preserve_tablet_order_(false),
+      hedging_percentile_(0),
       snapshot_timestamp_(kNoTimestamp),
       timeout_(MonoDelta::FromMilliseconds(KuduScanner::kScanTimeoutMillis)),
       arena_(1024, 1024 * 1024) {
@@ -159,6 +167,46 @@ Status ScanConfiguration::SetFaultTolerant(bool fault_tolerant) {
   return Status::OK();
 }
 
+void ScanConfiguration::SetRowLayout(KuduScanner::RowLayout layout) {
+  row_layout_ = layout;
+}
+
+void ScanConfiguration::SetPrefetching(bool prefetching) {
+  prefetching_ = prefetching;
+}
+
+void ScanConfiguration::SetProfileEnabled(bool enabled) {
+  profile_enabled_ = enabled;
+}
+
+void ScanConfiguration::AddAggregate(AggregatePB::Type type, const string& column_name) {
+  AggregatePB* agg = aggregates_.Add();
+  agg->set_type(type);
+  if (!column_name.empty()) {
+    agg->set_column(column_name);
+  }
+}
+
+void ScanConfiguration::SetLimit(int64_t limit) {
+  limit_ = limit;
+}
+
+void ScanConfiguration::SetScanConcurrency(int concurrency) {
+  scan_concurrency_ = concurrency;
+}
+
+void ScanConfiguration::SetParallelScanMemoryBudget(int64_t budget_bytes) {
+  parallel_scan_memory_budget_ = budget_bytes;
+}
+
+void ScanConfiguration::SetPreserveTabletOrder(bool preserve) {
+  preserve_tablet_order_ = preserve;
+}
+
+void ScanConfiguration::SetHedgingPercentile(double percentile) {
+  hedging_percentile_ = percentile;
+}
+
 void ScanConfiguration::SetSnapshotMicros(uint64_t snapshot_timestamp_micros) {
   // Shift the HT timestamp bits to get well-formed HT timestamp with the
   // logical bits zeroed out.
@@ -23,6 +23,7 @@
 
 #include "kudu/client/client.h"
 #include "kudu/common/column_predicate.h"
+#include "kudu/common/common.pb.h"
 #include "kudu/common/scan_spec.h"
 #include "kudu/util/auto_release_pool.h"
 #include "kudu/util/memory/arena.h"
@@ -39,6 +40,7 @@ class ScanConfiguration {
 
   static const int64_t kNoTimestamp = -1;
   static const int kHtTimestampBitsToShift = 12;
+  static const int64_t kDefaultParallelScanMemoryBudget = 64 * 1024 * 1024;
 
   explicit ScanConfiguration(KuduTable* table);
   ~ScanConfiguration() = default;
@@ -73,6 +75,24 @@ class ScanConfiguration {
 
   Status SetFaultTolerant(bool fault_tolerant) WARN_UNUSED_RESULT;
 
+  void SetRowLayout(KuduScanner::RowLayout layout);
+
+  void SetPrefetching(bool prefetching);
+
+  void SetProfileEnabled(bool enabled);
+
+  void AddAggregate(AggregatePB::Type type, const std::string& column_name);
+
+  void SetLimit(int64_t limit);
+
+  void SetScanConcurrency(int concurrency);
+
+  void SetParallelScanMemoryBudget(int64_t budget_bytes);
+
+  void SetPreserveTabletOrder(bool preserve);
+
+  void SetHedgingPercentile(double percentile);
+
   void SetSnapshotMicros(uint64_t snapshot_timestamp_micros);
 
   void SetSnapshotRaw(uint64_t snapshot_timestamp);
@@ -124,6 +144,47 @@ class ScanConfiguration {
     return is_fault_tolerant_;
   }
 
+  KuduScanner::RowLayout row_layout() const {
+    return row_layout_;
+  }
+
+  bool prefetching() const {
+    return prefetching_;
+  }
+
+  bool profile_enabled() const {
+    return profile_enabled_;
+  }
+
+  const google::protobuf::RepeatedPtrField<AggregatePB>& aggregates() const {
+    return aggregates_;
+  }
+
+  bool has_limit() const {
+    return limit_ >= 0;
+  }
+
+  int64_t limit() const {
+    DCHECK(has_limit());
+    return limit_;
+  }
+
+  int scan_concurrency() const {
+    return scan_concurrency_;
+  }
+
+  int64_t parallel_scan_memory_budget() const {
+    return parallel_scan_memory_budget_;
+  }
+
+  bool preserve_tablet_order() const {
+    return preserve_tablet_order_;
+  }
+
+  double hedging_percentile() const {
+    return hedging_percentile_;
+  }
+
   int64_t snapshot_timestamp() const {
     return snapshot_timestamp_;
   }
@@ -159,6 +220,31 @@ class ScanConfiguration {
 
   bool is_fault_tolerant_;
 
+  KuduScanner::RowLayout row_layout_;
+
+  bool prefetching_;
+
+  bool profile_enabled_;
+
+  google::protobuf::RepeatedPtrField<AggregatePB> aggregates_;
+
+  // The maximum number of rows returned by the scan, or -1 if unlimited.
+  int64_t limit_;
+
+  // The maximum number of tablets scanned at once. Scans with a concurrency
+  // greater than 1 are driven by an internal::ParallelScan.
+  int scan_concurrency_;
+
+  // The total size of the batches a parallel scan may buffer before its
+  // tablet scanners wait for the application to consume them.
+  int64_t parallel_scan_memory_budget_;
+
+  bool preserve_tablet_order_;
+
+  // The percentile of the open latencies of the client after which the open
+  // of a tablet is hedged to another replica, or 0 if opens aren't hedged.
+  double hedging_percentile_;
+
   int64_t snapshot_timestamp_;
 
   MonoDelta timeout_;
@@ -17,11 +17,15 @@
 #ifndef KUDU_CLIENT_SCAN_PREDICATE_INTERNAL_H
 #define KUDU_CLIENT_SCAN_PREDICATE_INTERNAL_H
 
+#include <memory>
+#include <vector>
+
 #include "kudu/client/scan_predicate.h"
 #include "kudu/client/value.h"
 #include "kudu/client/value-internal.h"
 #include "kudu/common/scan_spec.h"
 #include "kudu/gutil/macros.h"
+#include "kudu/util/bloom_filter.h"
 #include "kudu/util/memory/arena.h"
 #include "kudu/util/status.h"
 
@@ -88,6 +92,61 @@ class ComparisonPredicateData : public KuduPredicate::Data {
   gscoped_ptr<KuduValue> val_;
 };
 
+// A list predicate which matches a column against a set of constant values.
+class InListPredicateData : public KuduPredicate::Data {
+ public:
+  // Takes ownership of the values, and clears the vector.
+  InListPredicateData(ColumnSchema col, std::vector<KuduValue*>* values);
+  virtual ~InListPredicateData();
+
+  Status AddToScanSpec(ScanSpec* spec, Arena* arena) override;
+
+  InListPredicateData* Clone() const override;
+
+ private:
+  friend class KuduScanner;
+
+  ColumnSchema col_;
+  std::vector<KuduValue*> vals_;
+};
+
+class KuduBloomFilter::Data {
+ public:
+  Data(size_t expected_count, double fp_rate)
+      : builder_(BloomFilterSizing::ByCountAndFPRate(expected_count, fp_rate),
+                 BloomFilterFormat::kSplitBlock) {
+  }
+
+  BloomFilterBuilder builder_;
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(Data);
+};
+
+// A predicate which matches a column against a set of Bloom filters.
+class InBloomFilterPredicateData : public KuduPredicate::Data {
+ public:
+  // Takes ownership of the filters, and clears the vector.
+  InBloomFilterPredicateData(ColumnSchema col, std::vector<KuduBloomFilter*>* bloom_filters);
+  virtual ~InBloomFilterPredicateData();
+
+  Status AddToScanSpec(ScanSpec* spec, Arena* arena) override;
+
+  InBloomFilterPredicateData* Clone() const override {
+    return new InBloomFilterPredicateData(col_, bloom_filters_);
+  }
+
+ private:
+  InBloomFilterPredicateData(ColumnSchema col,
+                             std::vector<std::shared_ptr<KuduBloomFilter>> bloom_filters);
+
+  ColumnSchema col_;
+
+  // The filters are immutable once the predicate is created, so clones share
+  // them rather than copying their bit arrays.
+  std::vector<std::shared_ptr<KuduBloomFilter>> bloom_filters_;
+};
+
 } // namespace client
 } // namespace kudu
 #endif /* KUDU_CLIENT_SCAN_PREDICATE_INTERNAL_H */
@@ -19,14 +19,18 @@
 
 #include <boost/optional.hpp>
 #include <utility>
+#include <vector>
 
 #include "kudu/client/scan_predicate-internal.h"
 #include "kudu/client/value-internal.h"
 #include "kudu/client/value.h"
 #include "kudu/common/scan_spec.h"
+#include "kudu/gutil/stl_util.h"
 #include "kudu/gutil/strings/substitute.h"
 
 using std::move;
+using std::shared_ptr;
+using std::vector;
 using boost::optional;
 
 namespace kudu {
@@ -104,5 +108,85 @@ Status ComparisonPredicateData::AddToScanSpec(ScanSpec* spec, Arena* arena) {
   return Status::OK();
 }
 
+InListPredicateData::InListPredicateData(ColumnSchema col,
+                                         vector<KuduValue*>* values)
+    : col_(move(col)) {
+  vals_.swap(*values);
+}
+
+InListPredicateData::~InListPredicateData() {
+  STLDeleteElements(&vals_);
+}
+
+InListPredicateData* InListPredicateData::Clone() const {
+  vector<KuduValue*> values;
+  values.reserve(vals_.size());
+  for (KuduValue* val : vals_) {
+    values.push_back(val->Clone());
+  }
+  return new InListPredicateData(col_, &values);
+}
+
+Status InListPredicateData::AddToScanSpec(ScanSpec* spec, Arena* /*arena*/) {
+  vector<const void*> vals_list;
+  vals_list.reserve(vals_.size());
+  for (KuduValue* value : vals_) {
+    void* val_void;
+    RETURN_NOT_OK(value->data_->CheckTypeAndGetPointer(col_.name(),
+                                                       col_.type_info()->physical_type(),
+                                                       &val_void));
+    vals_list.push_back(val_void);
+  }
+
+  // The predicate sorts and deduplicates the list of values.
+  spec->AddPredicate(ColumnPredicate::InList(col_, &vals_list));
+  return Status::OK();
+}
+
+KuduBloomFilter::KuduBloomFilter(size_t expected_count, double fp_rate)
+    : data_(new Data(expected_count, fp_rate)) {
+}
+
+KuduBloomFilter::~KuduBloomFilter() {
+  delete data_;
+}
+
+void KuduBloomFilter::Insert(const Slice& value) {
+  data_->builder_.AddKey(BloomKeyProbe(value));
+}
+
+InBloomFilterPredicateData::InBloomFilterPredicateData(ColumnSchema col,
+                                                       vector<KuduBloomFilter*>* bloom_filters)
+    : col_(move(col)) {
+  for (KuduBloomFilter* bf : *bloom_filters) {
+    bloom_filters_.emplace_back(bf);
+  }
+  bloom_filters->clear();
+}
+
+InBloomFilterPredicateData::InBloomFilterPredicateData(
+    ColumnSchema col, vector<shared_ptr<KuduBloomFilter>> bloom_filters)
+    : col_(move(col)),
+      bloom_filters_(move(bloom_filters)) {
+}
+
+InBloomFilterPredicateData::~InBloomFilterPredicateData() {
+}
+
+Status InBloomFilterPredicateData::AddToScanSpec(ScanSpec* spec, Arena* /*arena*/) {
+  if (bloom_filters_.empty()) {
+    return Status::InvalidArgument("IN Bloom filter predicate has no filters", col_.name());
+  }
+  vector<BloomFilter> bloom_filters;
+  bloom_filters.reserve(bloom_filters_.size());
+  for (const auto& bf : bloom_filters_) {
+    const BloomFilterBuilder& builder = bf->data_->builder_;
+    bloom_filters.emplace_back(builder.slice(), builder.n_hashes(), builder.format());
+  }
+  spec->AddPredicate(ColumnPredicate::InBloomFilter(col_, move(bloom_filters),
+                                                    nullptr, nullptr));
+  return Status::OK();
+}
+
 } // namespace client
 } // namespace kudu
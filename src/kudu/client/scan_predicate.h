@@ -26,6 +26,7 @@
 
 #include "kudu/client/schema.h"
 #include "kudu/util/kudu_export.h"
+#include "kudu/util/slice.h"
 
 namespace kudu {
 namespace client {
@@ -57,6 +58,8 @@ class KUDU_EXPORT KuduPredicate {
  private:
   friend class ComparisonPredicateData;
   friend class ErrorPredicateData;
+  friend class InBloomFilterPredicateData;
+  friend class InListPredicateData;
   friend class KuduTable;
   friend class ScanConfiguration;
 
@@ -66,6 +69,45 @@ class KUDU_EXPORT KuduPredicate {
   DISALLOW_COPY_AND_ASSIGN(KuduPredicate);
 };
 
+/// @brief A Bloom filter of column values, for IN Bloom filter predicates.
+///
+/// A filter is typically built from the values of the join key on the build
+/// side of a join, and the predicate created from it is pushed down into the
+/// scan of the probe side, to skip the rows which can't have a match.
+///
+/// Call KuduTable::NewInBloomFilterPredicate() to create a predicate
+/// from one or more filters.
+class KUDU_EXPORT KuduBloomFilter {
+ public:
+  /// Create an empty filter.
+  ///
+  /// @param [in] expected_count
+  ///   The expected number of distinct values to be inserted.
+  /// @param [in] fp_rate
+  ///   The desired false positive rate with that many values inserted,
+  ///   e.g. 0.01.
+  KuduBloomFilter(size_t expected_count, double fp_rate);
+
+  ~KuduBloomFilter();
+
+  /// Insert a value into the filter.
+  ///
+  /// @param [in] value
+  ///   The encoding of the value: the bytes of a STRING or BINARY value,
+  ///   and the little-endian representation of a fixed-width value, e.g.
+  ///   4 bytes for an INT32 value, or 8 bytes of microseconds since the
+  ///   Unix epoch for a UNIXTIME_MICROS value.
+  void Insert(const Slice& value);
+
+  /// @brief Forward declaration for the embedded PIMPL class.
+  class KUDU_NO_EXPORT Data;
+ private:
+  friend class InBloomFilterPredicateData;
+
+  Data* data_;
+  DISALLOW_COPY_AND_ASSIGN(KuduBloomFilter);
+};
+
 } // namespace client
 } // namespace kudu
 #endif // KUDU_CLIENT_SCAN_PREDICATE_H
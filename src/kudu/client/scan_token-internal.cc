@@ -32,6 +32,9 @@
 #include "kudu/common/wire_protocol.h"
 #include "kudu/gutil/stl_util.h"
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/rpc/rpc_controller.h"
+#include "kudu/tserver/tserver_service.proxy.h"
+#include "kudu/util/async_util.h"
 #include "kudu/util/pb_util.h"
 #include "kudu/util/status.h"
 
@@ -165,8 +168,76 @@ Status KuduScanToken::Data::PBIntoScanner(KuduClient* client,
   return Status::OK();
 }
 
+Status KuduScanTokenBuilder::Data::NewKuduTablet(internal::RemoteTablet* tablet,
+                                                unique_ptr<KuduTablet>* client_tablet) {
+  vector<internal::RemoteReplica> replicas;
+  tablet->GetRemoteReplicas(&replicas);
+
+  vector<const KuduReplica*> client_replicas;
+  ElementDeleter deleter(&client_replicas);
+
+  for (const auto& r : replicas) {
+    vector<HostPort> host_ports;
+    r.ts->GetHostPorts(&host_ports);
+    if (host_ports.empty()) {
+      return Status::IllegalState(Substitute(
+          "No host found for tablet server $0", r.ts->ToString()));
+    }
+    unique_ptr<KuduTabletServer> client_ts(new KuduTabletServer);
+    client_ts->data_ = new KuduTabletServer::Data(r.ts->permanent_uuid(),
+                                                  host_ports[0]);
+    bool is_leader = r.role == consensus::RaftPeerPB::LEADER;
+    unique_ptr<KuduReplica> client_replica(new KuduReplica);
+    client_replica->data_ = new KuduReplica::Data(is_leader,
+                                                  std::move(client_ts));
+    client_replicas.push_back(client_replica.release());
+  }
+
+  client_tablet->reset(new KuduTablet);
+  (*client_tablet)->data_ = new KuduTablet::Data(tablet->tablet_id(),
+                                                 std::move(client_replicas));
+  client_replicas.clear();
+  return Status::OK();
+}
+
 KuduScanTokenBuilder::Data::Data(KuduTable* table)
-    : configuration_(table) {
+    : configuration_(table),
+      split_size_bytes_(0) {
+}
+
+Status KuduScanTokenBuilder::Data::GetSplitKeys(KuduClient* client,
+                                               internal::RemoteTablet* tablet,
+                                               const ScanTokenPB& pb,
+                                               const MonoTime& deadline,
+                                               vector<string>* split_keys) const {
+  internal::RemoteTabletServer* ts = tablet->LeaderTServer();
+  if (!ts) {
+    return Status::ServiceUnavailable("no leader for tablet", tablet->tablet_id());
+  }
+  Synchronizer sync;
+  ts->InitProxy(client, sync.AsStatusCallback());
+  RETURN_NOT_OK(sync.Wait());
+
+  tserver::SplitKeyRangeRequestPB req;
+  tserver::SplitKeyRangeResponsePB resp;
+  req.set_tablet_id(tablet->tablet_id());
+  if (pb.has_lower_bound_primary_key()) {
+    req.set_start_primary_key(pb.lower_bound_primary_key());
+  }
+  if (pb.has_upper_bound_primary_key()) {
+    req.set_stop_primary_key(pb.upper_bound_primary_key());
+  }
+  req.set_target_chunk_size_bytes(split_size_bytes_);
+
+  rpc::RpcController controller;
+  controller.set_deadline(deadline);
+  controller.RequireServerFeature(tserver::TabletServerFeatures::SPLIT_KEY_RANGE);
+  RETURN_NOT_OK(ts->proxy()->SplitKeyRange(req, &resp, &controller));
+  if (resp.has_error()) {
+    return StatusFromPB(resp.error().status());
+  }
+  split_keys->assign(resp.split_primary_keys().begin(), resp.split_primary_keys().end());
+  return Status::OK();
 }
 
 Status KuduScanTokenBuilder::Data::Build(vector<KuduScanToken*>* tokens) {
@@ -248,49 +319,43 @@ Status KuduScanTokenBuilder::Data::Build(vector<KuduScanToken*>* tokens) {
       continue;
     }
 
-    vector<internal::RemoteReplica> replicas;
-    tablet->GetRemoteReplicas(&replicas);
-
-    vector<const KuduReplica*> client_replicas;
-    ElementDeleter deleter(&client_replicas);
-
-    // Convert the replicas from their internal format to something appropriate
-    // for clients.
-    for (const auto& r : replicas) {
-      vector<HostPort> host_ports;
-      r.ts->GetHostPorts(&host_ports);
-      if (host_ports.empty()) {
-        return Status::IllegalState(Substitute(
-            "No host found for tablet server $0", r.ts->ToString()));
+    // Split the tablet's range of the scan into chunks of about
+    // 'split_size_bytes_', if requested. The split is only an optimization, so
+    // if it fails, the tablet is scanned with a single token.
+    vector<string> split_keys;
+    if (split_size_bytes_ > 0) {
+      Status s = GetSplitKeys(client, tablet.get(), pb, deadline, &split_keys);
+      if (!s.ok()) {
+        LOG(WARNING) << "Unable to split the scan of tablet " << tablet->tablet_id()
+                     << ", scanning it with a single token: " << s.ToString();
+        split_keys.clear();
       }
-      unique_ptr<KuduTabletServer> client_ts(new KuduTabletServer);
-      client_ts->data_ = new KuduTabletServer::Data(r.ts->permanent_uuid(),
-                                                    host_ports[0]);
-      bool is_leader = r.role == consensus::RaftPeerPB::LEADER;
-      unique_ptr<KuduReplica> client_replica(new KuduReplica);
-      client_replica->data_ = new KuduReplica::Data(is_leader,
-                                                    std::move(client_ts));
-      client_replicas.push_back(client_replica.release());
     }
 
-    unique_ptr<KuduTablet> client_tablet(new KuduTablet);
-    client_tablet->data_ = new KuduTablet::Data(tablet->tablet_id(),
-                                                std::move(client_replicas));
-    client_replicas.clear();
-
-    // Create the scan token itself.
-    ScanTokenPB message;
-    message.CopyFrom(pb);
-    message.set_lower_bound_partition_key(
-        tablet->partition().partition_key_start());
-    message.set_upper_bound_partition_key(
-        tablet->partition().partition_key_end());
-    unique_ptr<KuduScanToken> client_scan_token(new KuduScanToken);
-    client_scan_token->data_ =
-        new KuduScanToken::Data(table,
-                                std::move(message),
-                                std::move(client_tablet));
-    tokens->push_back(client_scan_token.release());
+    // Create the scan tokens themselves, one per chunk.
+    for (int i = 0; i <= split_keys.size(); i++) {
+      unique_ptr<KuduTablet> client_tablet;
+      RETURN_NOT_OK(NewKuduTablet(tablet.get(), &client_tablet));
+
+      ScanTokenPB message;
+      message.CopyFrom(pb);
+      message.set_lower_bound_partition_key(
+          tablet->partition().partition_key_start());
+      message.set_upper_bound_partition_key(
+          tablet->partition().partition_key_end());
+      if (i > 0) {
+        message.set_lower_bound_primary_key(split_keys[i - 1]);
+      }
+      if (i < split_keys.size()) {
+        message.set_upper_bound_primary_key(split_keys[i]);
+      }
+      unique_ptr<KuduScanToken> client_scan_token(new KuduScanToken);
+      client_scan_token->data_ =
+          new KuduScanToken::Data(table,
+                                  std::move(message),
+                                  std::move(client_tablet));
+      tokens->push_back(client_scan_token.release());
+    }
     pruner.RemovePartitionKeyRange(tablet->partition().partition_key_end());
   }
   return Status::OK();
@@ -26,8 +26,15 @@
 #include "kudu/client/scan_configuration.h"
 
 namespace kudu {
+
+class MonoTime;
+
 namespace client {
 
+namespace internal {
+class RemoteTablet;
+} // namespace internal
+
 class KuduScanToken::Data {
  public:
   explicit Data(KuduTable* table,
@@ -72,8 +79,28 @@ class KuduScanTokenBuilder::Data {
     return &configuration_;
   }
 
+  void set_split_size_bytes(uint64_t split_size_bytes) {
+    split_size_bytes_ = split_size_bytes;
+  }
+
  private:
+  // Convert the replicas of 'tablet' from their internal format to something
+  // appropriate for clients.
+  static Status NewKuduTablet(internal::RemoteTablet* tablet,
+                              std::unique_ptr<KuduTablet>* client_tablet);
+
+  // Ask the leader of 'tablet' for the primary keys at which to split its
+  // range of the scan described by 'pb' into chunks of 'split_size_bytes_'.
+  Status GetSplitKeys(KuduClient* client,
+                      internal::RemoteTablet* tablet,
+                      const ScanTokenPB& pb,
+                      const MonoTime& deadline,
+                      std::vector<std::string>* split_keys) const;
+
   ScanConfiguration configuration_;
+
+  // If non-zero, the approximate amount of data scanned by each token.
+  uint64_t split_size_bytes_;
 };
 
 } // namespace client
@@ -25,8 +25,11 @@
 #include "kudu/client/client.h"
 #include "kudu/gutil/stl_util.h"
 #include "kudu/integration-tests/mini_cluster.h"
+#include "kudu/tablet/tablet.h"
+#include "kudu/tablet/tablet_peer.h"
 #include "kudu/tserver/mini_tablet_server.h"
 #include "kudu/tserver/tablet_server.h"
+#include "kudu/tserver/ts_tablet_manager.h"
 #include "kudu/util/test_util.h"
 
 namespace kudu {
@@ -322,5 +325,80 @@ TEST_F(ScanTokenTest, TestScanTokensWithNonCoveringRange) {
   }
 }
 
+TEST_F(ScanTokenTest, TestScanTokensWithSplits) {
+  KuduSchema schema;
+  {
+    KuduSchemaBuilder builder;
+    builder.AddColumn("col")->NotNull()->Type(KuduColumnSchema::INT64)->PrimaryKey();
+    ASSERT_OK(builder.Build(&schema));
+  }
+
+  shared_ptr<KuduTable> table;
+  {
+    unique_ptr<client::KuduTableCreator> table_creator(client_->NewTableCreator());
+    ASSERT_OK(table_creator->table_name("table")
+                            .schema(&schema)
+                            .set_range_partition_columns({ "col" })
+                            .num_replicas(1)
+                            .Create());
+    ASSERT_OK(client_->OpenTable("table", &table));
+  }
+
+  vector<scoped_refptr<tablet::TabletPeer>> peers;
+  cluster_->mini_tablet_server(0)->server()->tablet_manager()->GetTabletPeers(&peers);
+  ASSERT_EQ(1, peers.size());
+
+  // Write three rowsets with disjoint key ranges into the single tablet.
+  shared_ptr<KuduSession> session = client_->NewSession();
+  session->SetTimeoutMillis(10000);
+  ASSERT_OK(session->SetFlushMode(KuduSession::MANUAL_FLUSH));
+  for (int i = 0; i < 300; i++) {
+    unique_ptr<KuduInsert> insert(table->NewInsert());
+    ASSERT_OK(insert->mutable_row()->SetInt64("col", i));
+    ASSERT_OK(session->Apply(insert.release()));
+    if (i % 100 == 99) {
+      ASSERT_OK(session->Flush());
+      ASSERT_OK(peers[0]->tablet()->Flush());
+    }
+  }
+
+  { // one token per rowset
+    vector<KuduScanToken*> tokens;
+    ElementDeleter deleter(&tokens);
+    KuduScanTokenBuilder builder(table.get());
+    ASSERT_OK(builder.SetSplitSizeBytes(1));
+    ASSERT_OK(builder.Build(&tokens));
+
+    ASSERT_EQ(3, tokens.size());
+    ASSERT_EQ(300, CountRows(tokens));
+  }
+
+  { // the splits are inside the scanned range
+    vector<KuduScanToken*> tokens;
+    ElementDeleter deleter(&tokens);
+    KuduScanTokenBuilder builder(table.get());
+    unique_ptr<KuduPredicate> predicate(table->NewComparisonPredicate("col",
+                                                                      KuduPredicate::GREATER_EQUAL,
+                                                                      KuduValue::FromInt(150)));
+    ASSERT_OK(builder.AddConjunctPredicate(predicate.release()));
+    ASSERT_OK(builder.SetSplitSizeBytes(1));
+    ASSERT_OK(builder.Build(&tokens));
+
+    ASSERT_EQ(2, tokens.size());
+    ASSERT_EQ(150, CountRows(tokens));
+  }
+
+  { // chunks larger than the tablet
+    vector<KuduScanToken*> tokens;
+    ElementDeleter deleter(&tokens);
+    KuduScanTokenBuilder builder(table.get());
+    ASSERT_OK(builder.SetSplitSizeBytes(1L << 40));
+    ASSERT_OK(builder.Build(&tokens));
+
+    ASSERT_EQ(1, tokens.size());
+    ASSERT_EQ(300, CountRows(tokens));
+  }
+}
+
 } // namespace client
 } // namespace kudu
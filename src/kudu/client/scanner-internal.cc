@@ -20,6 +20,9 @@
 #include <algorithm>
 #include <boost/bind.hpp>
 #include <cmath>
+#include <functional>
+#include <map>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -27,17 +30,25 @@
 #include "kudu/client/meta_cache.h"
 #include "kudu/client/row_result.h"
 #include "kudu/client/table-internal.h"
+#include "kudu/common/aggregate.h"
 #include "kudu/common/common.pb.h"
 #include "kudu/common/wire_protocol.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/rpc/rpc_controller.h"
 #include "kudu/util/hexdump.h"
+#include "kudu/util/mem_tracker.h"
+#include "kudu/util/threadpool.h"
 
 using google::protobuf::FieldDescriptor;
+using google::protobuf::Message;
 using google::protobuf::Reflection;
 
+using std::map;
 using std::set;
+using std::shared_ptr;
 using std::string;
+using std::unique_ptr;
+using std::vector;
 
 namespace kudu {
 
@@ -51,18 +62,239 @@ namespace client {
 
 using internal::RemoteTabletServer;
 
+// The default of --scanner_default_batch_size_bytes on the tablet servers.
+static const int64_t kDefaultBatchSizeBytes = 1024 * 1024;
+
+// The name of the profile metric counting the requests of a scan.
+static const char* const kScanRequestsProfileMetric = "scan_requests";
+
+// Whether the completed RPC of 'controller' failed because of its server,
+// e.g. since it was unreachable or too busy.
+static bool IsServerFailure(const RpcController& controller) {
+  const Status& s = controller.status();
+  if (s.IsRemoteError()) {
+    const rpc::ErrorStatusPB* err = controller.error_response();
+    return err && err->has_code() &&
+        err->code() == rpc::ErrorStatusPB::ERROR_SERVER_TOO_BUSY;
+  }
+  return s.IsNetworkError() || s.IsTimedOut();
+}
+
+namespace {
+
+// The attempts of a hedged Scan RPC, sent to different replicas of a tablet.
+// This is shared with the RPC callbacks, since an attempt which lost may
+// complete after the scanner moved on.
+class HedgedScan : public RefCountedThreadSafe<HedgedScan> {
+ public:
+  struct Attempt {
+    RemoteTabletServer* ts;
+    shared_ptr<tserver::TabletServerServiceProxy> proxy;
+    RpcController controller;
+    tserver::ScanResponsePB resp;
+    MonoTime sent_time;
+    MonoTime finish_time;
+  };
+
+  // 'meta_cache' is held on to since it owns the servers of the attempts.
+  // The server-side scanners opened by attempts which lost are closed with
+  // 'close_timeout'.
+  HedgedScan(scoped_refptr<internal::MetaCache> meta_cache, const MonoDelta& close_timeout)
+      : meta_cache_(std::move(meta_cache)),
+        close_timeout_(close_timeout),
+        num_sent_(0),
+        num_finished_(0),
+        winner_(-1),
+        winner_latch_(1) {
+  }
+
+  // Sends 'req' to 'ts' through 'proxy', after calling 'prepare' on the
+  // controller of the attempt. Returns false, without sending anything, if
+  // an attempt already won or there's no room for another one.
+  bool Send(const tserver::ScanRequestPB& req,
+            RemoteTabletServer* ts,
+            shared_ptr<tserver::TabletServerServiceProxy> proxy,
+            const std::function<void(RpcController*)>& prepare) {
+    int idx;
+    {
+      std::lock_guard<simple_spinlock> l(lock_);
+      if (winner_ != -1 || num_sent_ == kMaxAttempts) {
+        return false;
+      }
+      idx = num_sent_++;
+    }
+    Attempt* a = &attempts_[idx];
+    a->ts = ts;
+    a->proxy = std::move(proxy);
+    prepare(&a->controller);
+    a->sent_time = MonoTime::Now();
+    ts->RpcStarted();
+    scoped_refptr<HedgedScan> self(this);
+    a->proxy->ScanAsync(req, &a->resp, &a->controller,
+                        [self, idx]() { self->AttemptFinished(idx); });
+    return true;
+  }
+
+  // Waits for up to 'delay' for an attempt to win. Returns whether one did.
+  bool WaitFor(const MonoDelta& delay) const {
+    return winner_latch_.WaitFor(delay);
+  }
+
+  // Waits for and returns the first attempt to succeed, or the last one to
+  // fail if they all did.
+  Attempt* WaitForWinner() {
+    winner_latch_.Wait();
+    std::lock_guard<simple_spinlock> l(lock_);
+    return &attempts_[winner_];
+  }
+
+ private:
+  friend class RefCountedThreadSafe<HedgedScan>;
+  ~HedgedScan() {}
+
+  static const int kMaxAttempts = 2;
+
+  void AttemptFinished(int idx) {
+    Attempt* a = &attempts_[idx];
+    a->finish_time = MonoTime::Now();
+    a->ts->RpcFinished(a->sent_time, IsServerFailure(a->controller));
+    bool succeeded = a->controller.status().ok() && !a->resp.has_error();
+    {
+      std::lock_guard<simple_spinlock> l(lock_);
+      num_finished_++;
+      if (winner_ == -1 && (succeeded || num_finished_ == num_sent_)) {
+        winner_ = idx;
+        winner_latch_.CountDown();
+        return;
+      }
+    }
+    // The attempt lost: there's no way to cancel an RPC, but the scanner it
+    // opened on the server can at least be closed right away, rather than
+    // left to expire.
+    if (succeeded && a->resp.has_more_results()) {
+      CloseLoserScanner(a);
+    }
+  }
+
+  void CloseLoserScanner(Attempt* a) {
+    tserver::ScanRequestPB req;
+    req.set_scanner_id(a->resp.scanner_id());
+    req.set_call_seq_id(1);
+    req.set_batch_size_bytes(0);
+    req.set_close_scanner(true);
+    a->controller.Reset();
+    a->controller.set_timeout(close_timeout_);
+    scoped_refptr<HedgedScan> self(this);
+    string scanner_id = req.scanner_id();
+    a->proxy->ScanAsync(req, &a->resp, &a->controller, [self, a, scanner_id]() {
+      if (!a->controller.status().ok()) {
+        LOG(WARNING) << "Couldn't close scanner " << scanner_id << ": "
+                     << a->controller.status().ToString();
+      }
+    });
+  }
+
+  const scoped_refptr<internal::MetaCache> meta_cache_;
+  const MonoDelta close_timeout_;
+
+  Attempt attempts_[kMaxAttempts];
+
+  // Protects the counts and 'winner_'.
+  simple_spinlock lock_;
+  int num_sent_;
+  int num_finished_;
+
+  // The index of the winning attempt, or -1 until one won.
+  int winner_;
+  CountDownLatch winner_latch_;
+
+  DISALLOW_COPY_AND_ASSIGN(HedgedScan);
+};
+
+} // anonymous namespace
+
+// Calls 'f' with the name and value of each int64 field set in 'pb'.
+static void ForEachInt64Field(const Message& pb,
+                              const std::function<void(const string&, int64_t)>& f) {
+  const Reflection* reflection = pb.GetReflection();
+  vector<const FieldDescriptor*> fields;
+  reflection->ListFields(pb, &fields);
+  for (const FieldDescriptor* field : fields) {
+    if (reflection->HasField(pb, field) &&
+        field->cpp_type() == FieldDescriptor::CPPTYPE_INT64) {
+      f(field->name(), reflection->GetInt64(pb, field));
+    }
+  }
+}
+
 KuduScanner::Data::Data(KuduTable* table)
   : configuration_(table),
+    shared_configuration_(nullptr),
+    single_tablet_(false),
+    prefetch_in_flight_(false),
+    prefetch_memory_bytes_(0),
+    prefetch_latch_(0),
     open_(false),
     data_in_open_(false),
     short_circuit_(false),
     table_(DCHECK_NOTNULL(table)->shared_from_this()),
-    scan_attempts_(0) {
+    scan_attempts_(0),
+    num_rows_returned_(0) {
 }
 
 KuduScanner::Data::~Data() {
 }
 
+Status KuduScanner::Data::PrepareOpen() {
+  RETURN_NOT_OK(Aggregator::Validate(*configuration().projection(),
+                                     configuration().aggregates()));
+  if (configuration().has_limit() && !configuration().aggregates().empty()) {
+    return Status::InvalidArgument("A scan limit cannot be combined with aggregates");
+  }
+  if (configuration().scan_concurrency() > 1) {
+    if (configuration().is_fault_tolerant()) {
+      return Status::InvalidArgument("A parallel scan cannot be fault-tolerant");
+    }
+    if (configuration().has_limit()) {
+      return Status::InvalidArgument("A parallel scan cannot have a limit");
+    }
+    if (!configuration().aggregates().empty()) {
+      return Status::InvalidArgument("A parallel scan cannot compute aggregates");
+    }
+  }
+
+  mutable_configuration()->OptimizeScanSpec();
+  partition_pruner_.Init(*table_->schema().schema_,
+                         table_->partition_schema(),
+                         configuration().spec());
+
+  short_circuit_ = configuration().spec().CanShortCircuit() ||
+      !partition_pruner_.HasMorePartitionKeyRanges() ||
+      (configuration().has_limit() && configuration().limit() == 0);
+  return Status::OK();
+}
+
+Status KuduScanner::Data::StartScan() {
+  MonoTime deadline = MonoTime::Now() + configuration().timeout();
+
+  if (configuration().scan_concurrency() > 1) {
+    parallel_scan_.reset(new internal::ParallelScan(this));
+    Status s = parallel_scan_->Init(deadline);
+    if (!s.ok()) {
+      parallel_scan_.reset();
+      return s;
+    }
+    open_ = true;
+    return Status::OK();
+  }
+
+  set<string> blacklist;
+  RETURN_NOT_OK(OpenNextTablet(deadline, &blacklist));
+
+  open_ = true;
+  return Status::OK();
+}
+
 Status KuduScanner::Data::HandleError(const ScanRpcStatus& err,
                                       const MonoTime& deadline,
                                       set<string>* blacklist) {
@@ -144,19 +376,91 @@ Status KuduScanner::Data::HandleError(const ScanRpcStatus& err,
 
 void KuduScanner::Data::UpdateResourceMetrics() {
   if (last_response_.has_resource_metrics()) {
-    tserver::ResourceMetricsPB resource_metrics = last_response_.resource_metrics();
-    const Reflection* reflection = resource_metrics.GetReflection();
-    vector<const FieldDescriptor*> fields;
-    reflection->ListFields(resource_metrics, &fields);
-    for (const FieldDescriptor* field : fields) {
-      if (reflection->HasField(resource_metrics, field) &&
-          field->cpp_type() == FieldDescriptor::CPPTYPE_INT64) {
-        resource_metrics_.Increment(field->name(), reflection->GetInt64(resource_metrics, field));
-      }
+    ForEachInt64Field(last_response_.resource_metrics(), [this](const string& name, int64_t v) {
+      resource_metrics_.Increment(name, v);
+    });
+  }
+}
+
+void KuduScanner::Data::UpdateProfile() {
+  if (!last_response_.has_profile()) {
+    return;
+  }
+  map<string, int64_t> profile;
+  profile[kScanRequestsProfileMetric] = 1;
+  ForEachInt64Field(last_response_.profile(), [&profile](const string& name, int64_t v) {
+    profile[name] = v;
+  });
+  AddTabletProfile(remote_->tablet_id(), profile);
+}
+
+void KuduScanner::Data::AddTabletProfile(const string& tablet_id,
+                                         const map<string, int64_t>& profile) {
+  for (const auto& metric : profile) {
+    profile_.Increment(metric.first, metric.second);
+  }
+  std::lock_guard<simple_spinlock> l(tablet_profiles_lock_);
+  map<string, int64_t>& tablet_profile = tablet_profiles_[tablet_id];
+  for (const auto& metric : profile) {
+    tablet_profile[metric.first] += metric.second;
+  }
+}
+
+void KuduScanner::Data::GetTabletProfiles(map<string, map<string, int64_t>>* profiles) const {
+  std::lock_guard<simple_spinlock> l(tablet_profiles_lock_);
+  *profiles = tablet_profiles_;
+}
+
+void KuduScanner::Data::MergeAggregateResults() {
+  const auto& aggregates = configuration().aggregates();
+  if (aggregates.empty() || last_response_.aggregate_results_size() == 0) {
+    return;
+  }
+  DCHECK_EQ(aggregates.size(), last_response_.aggregate_results_size());
+  if (aggregate_results_.empty()) {
+    aggregate_results_.CopyFrom(last_response_.aggregate_results());
+    return;
+  }
+  const Schema* projection = configuration().projection();
+  for (int i = 0; i < aggregates.size(); i++) {
+    const AggregatePB& agg = aggregates.Get(i);
+    const TypeInfo* type_info = nullptr;
+    if (agg.has_column()) {
+      type_info = projection->column(projection->find_column(agg.column())).type_info();
     }
+    MergeAggregateResult(agg.type(), type_info, last_response_.aggregate_results(i),
+                         aggregate_results_.Mutable(i));
   }
 }
 
+Status KuduScanner::Data::FindAggregateResult(int idx,
+                                              AggregatePB::Type* type,
+                                              const TypeInfo** type_info,
+                                              const AggregateResultPB** result) const {
+  const auto& aggregates = configuration().aggregates();
+  if (idx < 0 || idx >= aggregates.size()) {
+    return Status::InvalidArgument(Substitute("Bad aggregate index $0", idx));
+  }
+  // Until the first response arrives no row has been aggregated.
+  *result = idx < aggregate_results_.size() ? &aggregate_results_.Get(idx)
+                                            : &AggregateResultPB::default_instance();
+  if (type == nullptr) {
+    return Status::OK();
+  }
+
+  const AggregatePB& agg = aggregates.Get(idx);
+  if (agg.type() == AggregatePB::COUNT) {
+    return Status::InvalidArgument("COUNT results must be read with GetAggregateCount()");
+  }
+  if ((*result)->count() == 0) {
+    return Status::NotFound("No value was aggregated");
+  }
+  const Schema* projection = configuration().projection();
+  *type = agg.type();
+  *type_info = projection->column(projection->find_column(agg.column())).type_info();
+  return Status::OK();
+}
+
 ScanRpcStatus KuduScanner::Data::AnalyzeResponse(const Status& rpc_status,
                                                  const MonoTime& overall_deadline,
                                                  const MonoTime& deadline) {
@@ -221,8 +525,8 @@ Status KuduScanner::Data::ReopenCurrentTablet(const MonoTime& deadline,
                     blacklist);
 }
 
-ScanRpcStatus KuduScanner::Data::SendScanRpc(const MonoTime& overall_deadline,
-                                             bool allow_time_for_failover) {
+MonoTime KuduScanner::Data::ScanRpcDeadline(const MonoTime& overall_deadline,
+                                            bool allow_time_for_failover) const {
   // The user has specified a timeout which should apply to the total time for each call
   // to NextBatch(). However, for fault-tolerant scans, or for when we are first opening
   // a scanner, it's preferable to set a shorter timeout (the "default RPC timeout") for
@@ -235,37 +539,198 @@ ScanRpcStatus KuduScanner::Data::SendScanRpc(const MonoTime& overall_deadline,
   } else {
     rpc_deadline = overall_deadline;
   }
+  return rpc_deadline;
+}
+
+void KuduScanner::Data::RequireServerFeatures(RpcController* controller) const {
+  if (!configuration().spec().predicates().empty()) {
+    controller->RequireServerFeature(TabletServerFeatures::COLUMN_PREDICATES);
+    for (const auto& p : configuration().spec().predicates()) {
+      if (p.second.predicate_type() == PredicateType::InBloomFilter) {
+        controller->RequireServerFeature(TabletServerFeatures::BLOOM_FILTER_PREDICATES);
+        break;
+      }
+    }
+  }
+  if (configuration().row_layout() == KuduScanner::COLUMNAR) {
+    controller->RequireServerFeature(TabletServerFeatures::COLUMNAR_LAYOUT);
+  }
+  if (!configuration().aggregates().empty()) {
+    controller->RequireServerFeature(TabletServerFeatures::AGGREGATES);
+  }
+  if (configuration().has_limit()) {
+    controller->RequireServerFeature(TabletServerFeatures::SCAN_LIMIT);
+  }
+}
 
+MonoTime KuduScanner::Data::PrepareScanRpc(const MonoTime& overall_deadline,
+                                           bool allow_time_for_failover) {
+  MonoTime rpc_deadline = ScanRpcDeadline(overall_deadline, allow_time_for_failover);
   controller_.Reset();
   controller_.set_deadline(rpc_deadline);
-  if (!configuration_.spec().predicates().empty()) {
-    controller_.RequireServerFeature(TabletServerFeatures::COLUMN_PREDICATES);
-  }
-  ScanRpcStatus scan_status = AnalyzeResponse(
-      proxy_->Scan(next_req_,
-                   &last_response_,
-                   &controller_),
-      rpc_deadline, overall_deadline);
+  RequireServerFeatures(&controller_);
+  rpc_sent_time_ = MonoTime::Now();
+  ts_->RpcStarted();
+  return rpc_deadline;
+}
+
+void KuduScanner::Data::RecordScanRpcFinished() {
+  MonoTime now = MonoTime::Now();
+  ts_->RpcFinished(rpc_sent_time_, IsServerFailure(controller_));
+  if (next_req_.has_new_scan_request() && controller_.status().ok() &&
+      !last_response_.has_error()) {
+    table_->client()->data_->RecordScanOpenLatency(now - rpc_sent_time_);
+  }
+}
+
+bool KuduScanner::Data::GetHedgingDelay(MonoDelta* delay) const {
+  return configuration().hedging_percentile() > 0 &&
+      configuration().selection() != KuduClient::LEADER_ONLY &&
+      table_->client()->data_->GetScanHedgingDelay(configuration().hedging_percentile(), delay);
+}
+
+ScanRpcStatus KuduScanner::Data::SendHedgedScanRpc(const MonoTime& overall_deadline,
+                                                   bool allow_time_for_failover,
+                                                   const MonoDelta& hedging_delay,
+                                                   const set<string>& blacklist) {
+  KuduClient::Data* client_data = table_->client()->data_;
+  MonoTime rpc_deadline = ScanRpcDeadline(overall_deadline, allow_time_for_failover);
+  auto prepare = [&](RpcController* controller) {
+    controller->set_deadline(rpc_deadline);
+    RequireServerFeatures(controller);
+  };
+  scoped_refptr<HedgedScan> hedged(new HedgedScan(client_data->meta_cache_,
+                                                  configuration().timeout()));
+  hedged->Send(next_req_, ts_, proxy_, prepare);
+  if (!hedged->WaitFor(hedging_delay)) {
+    // The replica is slower than usual: send the same request to another one,
+    // and use whichever response arrives first.
+    set<string> hedge_blacklist(blacklist);
+    hedge_blacklist.insert(ts_->permanent_uuid());
+    vector<RemoteTabletServer*> candidates;
+    RemoteTabletServer* ts = client_data->SelectTServer(
+        remote_, configuration().selection(), hedge_blacklist, &candidates);
+    shared_ptr<tserver::TabletServerServiceProxy> proxy;
+    if (ts) {
+      proxy = ts->proxy_if_initialized();
+    }
+    if (proxy && hedged->Send(next_req_, ts, std::move(proxy), prepare)) {
+      VLOG(1) << "Tablet " << remote_->tablet_id() << ": " << ts_->ToString()
+              << " didn't respond within " << hedging_delay.ToString()
+              << ", hedging the scan with " << ts->ToString();
+    }
+  }
+
+  HedgedScan::Attempt* winner = hedged->WaitForWinner();
+  controller_.Swap(&winner->controller);
+  last_response_.Swap(&winner->resp);
+  ts_ = winner->ts;
+  proxy_ = winner->proxy;
+  if (controller_.status().ok() && !last_response_.has_error()) {
+    client_data->RecordScanOpenLatency(winner->finish_time - winner->sent_time);
+  }
+  return FinishScanRpc(controller_.status(), overall_deadline, rpc_deadline);
+}
+
+ScanRpcStatus KuduScanner::Data::FinishScanRpc(const Status& rpc_status,
+                                               const MonoTime& overall_deadline,
+                                               const MonoTime& rpc_deadline) {
+  ScanRpcStatus scan_status = AnalyzeResponse(rpc_status, rpc_deadline, overall_deadline);
   if (scan_status.result == ScanRpcStatus::OK) {
     UpdateResourceMetrics();
+    UpdateProfile();
+    MergeAggregateResults();
   }
   return scan_status;
 }
 
-Status KuduScanner::Data::OpenTablet(const string& partition_key,
-                                     const MonoTime& deadline,
-                                     set<string>* blacklist) {
+ScanRpcStatus KuduScanner::Data::SendScanRpc(const MonoTime& overall_deadline,
+                                             bool allow_time_for_failover) {
+  MonoTime rpc_deadline = PrepareScanRpc(overall_deadline, allow_time_for_failover);
+  Status rpc_status = proxy_->Scan(next_req_, &last_response_, &controller_);
+  RecordScanRpcFinished();
+  return FinishScanRpc(rpc_status, overall_deadline, rpc_deadline);
+}
+
+void KuduScanner::Data::SendPrefetchRpc() {
+  PrepareRequest(CONTINUE);
+  SendAsyncScanRpc(MonoTime::Now() + configuration().timeout(),
+                   configuration().is_fault_tolerant());
+}
+
+void KuduScanner::Data::SendAsyncScanRpc(const MonoTime& overall_deadline,
+                                         bool allow_time_for_failover) {
+  DCHECK(!prefetch_in_flight_);
+  prefetch_deadline_ = overall_deadline;
+  prefetch_rpc_deadline_ = PrepareScanRpc(prefetch_deadline_, allow_time_for_failover);
+  prefetch_latch_.Reset(1);
+  prefetch_in_flight_ = true;
+  proxy_->ScanAsync(next_req_, &last_response_, &controller_,
+                    boost::bind(&KuduScanner::Data::PrefetchRpcFinished, this));
+}
+
+void KuduScanner::Data::PrefetchRpcFinished() {
+  RecordScanRpcFinished();
+  // Once the latch is counted down, a waiter may destroy the scanner.
+  KuduClient::Data* client_data = table_->client()->data_;
+  boost::function<void()> continuation;
+  {
+    std::lock_guard<simple_spinlock> l(prefetch_lock_);
+    continuation.swap(prefetch_continuation_);
+    prefetch_latch_.CountDown();
+  }
+  if (continuation) {
+    client_data->RunCallback(continuation);
+  }
+}
 
+void KuduScanner::Data::WhenPrefetchDone(const boost::function<void()>& continuation) {
+  DCHECK(prefetch_in_flight_);
+  {
+    std::lock_guard<simple_spinlock> l(prefetch_lock_);
+    if (prefetch_latch_.count() > 0) {
+      DCHECK(!prefetch_continuation_);
+      prefetch_continuation_ = continuation;
+      return;
+    }
+  }
+  table_->client()->data_->RunCallback(continuation);
+}
+
+bool KuduScanner::Data::TryReservePrefetchMemory() {
+  DCHECK_EQ(0, prefetch_memory_bytes_);
+  // The batches are rarely bigger than requested, so that is what is
+  // reserved, falling back to the default batch size of the servers.
+  int64_t size = configuration().has_batch_size_bytes() ?
+      configuration().batch_size_bytes() : kDefaultBatchSizeBytes;
+  if (!table_->client()->data_->mem_tracker_->TryConsume(size)) {
+    return false;
+  }
+  prefetch_memory_bytes_ = size;
+  return true;
+}
+
+ScanRpcStatus KuduScanner::Data::WaitForPrefetch() {
+  DCHECK(prefetch_in_flight_);
+  prefetch_latch_.Wait();
+  prefetch_in_flight_ = false;
+  // The batch is handed over to the caller, like one which wasn't prefetched.
+  table_->client()->data_->mem_tracker_->Release(prefetch_memory_bytes_);
+  prefetch_memory_bytes_ = 0;
+  return FinishScanRpc(controller_.status(), prefetch_deadline_, prefetch_rpc_deadline_);
+}
+
+Status KuduScanner::Data::PrepareOpenRequest() {
   PrepareRequest(KuduScanner::Data::NEW);
   next_req_.clear_scanner_id();
   NewScanRequestPB* scan = next_req_.mutable_new_scan_request();
-  switch (configuration_.read_mode()) {
+  switch (configuration().read_mode()) {
     case READ_LATEST: scan->set_read_mode(kudu::READ_LATEST); break;
     case READ_AT_SNAPSHOT: scan->set_read_mode(kudu::READ_AT_SNAPSHOT); break;
     default: LOG(FATAL) << "Unexpected read mode.";
   }
 
-  if (configuration_.is_fault_tolerant()) {
+  if (configuration().is_fault_tolerant()) {
     scan->set_order_mode(kudu::ORDERED);
   } else {
     scan->set_order_mode(kudu::UNORDERED);
@@ -277,39 +742,57 @@ Status KuduScanner::Data::OpenTablet(const string& partition_key,
     scan->set_last_primary_key(last_primary_key_);
   }
 
-  scan->set_cache_blocks(configuration_.spec().cache_blocks());
+  scan->set_cache_blocks(configuration().spec().cache_blocks());
 
-  if (configuration_.snapshot_timestamp() != ScanConfiguration::kNoTimestamp) {
-    if (PREDICT_FALSE(configuration_.read_mode() != READ_AT_SNAPSHOT)) {
+  if (configuration().snapshot_timestamp() != ScanConfiguration::kNoTimestamp) {
+    if (PREDICT_FALSE(configuration().read_mode() != READ_AT_SNAPSHOT)) {
       LOG(WARNING) << "Scan snapshot timestamp set but read mode was READ_LATEST."
           " Ignoring timestamp.";
     } else {
-      scan->set_snap_timestamp(configuration_.snapshot_timestamp());
+      scan->set_snap_timestamp(configuration().snapshot_timestamp());
     }
   }
 
+  scan->mutable_aggregates()->CopyFrom(configuration().aggregates());
+
+  // Only ask this tablet for the rows still missing from the limit. Rows
+  // which were already returned from this tablet before a retry are
+  // skipped through 'last_primary_key_'.
+  if (configuration().has_limit()) {
+    scan->set_limit(configuration().limit() - num_rows_returned_);
+  } else {
+    scan->clear_limit();
+  }
+
   // Set up the predicates.
   scan->clear_column_predicates();
-  for (const auto& col_pred : configuration_.spec().predicates()) {
+  for (const auto& col_pred : configuration().spec().predicates()) {
     ColumnPredicateToPB(col_pred.second, scan->add_column_predicates());
   }
 
-  if (configuration_.spec().lower_bound_key()) {
+  if (configuration().spec().lower_bound_key()) {
     scan->mutable_start_primary_key()->assign(
-      reinterpret_cast<const char*>(configuration_.spec().lower_bound_key()->encoded_key().data()),
-      configuration_.spec().lower_bound_key()->encoded_key().size());
+      reinterpret_cast<const char*>(configuration().spec().lower_bound_key()->encoded_key().data()),
+      configuration().spec().lower_bound_key()->encoded_key().size());
   } else {
     scan->clear_start_primary_key();
   }
-  if (configuration_.spec().exclusive_upper_bound_key()) {
+  if (configuration().spec().exclusive_upper_bound_key()) {
     scan->mutable_stop_primary_key()->assign(reinterpret_cast<const char*>(
-          configuration_.spec().exclusive_upper_bound_key()->encoded_key().data()),
-      configuration_.spec().exclusive_upper_bound_key()->encoded_key().size());
+          configuration().spec().exclusive_upper_bound_key()->encoded_key().data()),
+      configuration().spec().exclusive_upper_bound_key()->encoded_key().size());
   } else {
     scan->clear_stop_primary_key();
   }
-  RETURN_NOT_OK(SchemaToColumnPBs(*configuration_.projection(), scan->mutable_projected_columns(),
-                                  SCHEMA_PB_WITHOUT_STORAGE_ATTRIBUTES | SCHEMA_PB_WITHOUT_IDS));
+  return SchemaToColumnPBs(*configuration().projection(), scan->mutable_projected_columns(),
+                           SCHEMA_PB_WITHOUT_STORAGE_ATTRIBUTES | SCHEMA_PB_WITHOUT_IDS);
+}
+
+Status KuduScanner::Data::OpenTablet(const string& partition_key,
+                                     const MonoTime& deadline,
+                                     set<string>* blacklist) {
+  RETURN_NOT_OK(PrepareOpenRequest());
+  NewScanRequestPB* scan = next_req_.mutable_new_scan_request();
 
   for (int attempt = 1;; attempt++) {
     Synchronizer sync;
@@ -343,7 +826,7 @@ Status KuduScanner::Data::OpenTablet(const string& partition_key,
     Status lookup_status = table_->client()->data_->GetTabletServer(
         table_->client(),
         remote_,
-        configuration_.selection(),
+        configuration().selection(),
         *blacklist,
         &candidates,
         &ts);
@@ -370,7 +853,11 @@ Status KuduScanner::Data::OpenTablet(const string& partition_key,
     proxy_ = ts_->proxy();
 
     bool allow_time_for_failover = static_cast<int>(candidates.size()) - blacklist->size() > 1;
-    ScanRpcStatus scan_status = SendScanRpc(deadline, allow_time_for_failover);
+    MonoDelta hedging_delay;
+    ScanRpcStatus scan_status =
+        allow_time_for_failover && GetHedgingDelay(&hedging_delay) ?
+        SendHedgedScanRpc(deadline, allow_time_for_failover, hedging_delay, *blacklist) :
+        SendScanRpc(deadline, allow_time_for_failover);
     if (scan_status.result == ScanRpcStatus::OK) {
       last_error_ = Status::OK();
       scan_attempts_ = 0;
@@ -380,15 +867,21 @@ Status KuduScanner::Data::OpenTablet(const string& partition_key,
     RETURN_NOT_OK(HandleError(scan_status, deadline, blacklist));
   }
 
+  FinishOpenTablet();
+  return Status::OK();
+}
+
+void KuduScanner::Data::FinishOpenTablet() {
   partition_pruner_.RemovePartitionKeyRange(remote_->partition().partition_key_end());
 
   next_req_.clear_new_scan_request();
-  data_in_open_ = last_response_.has_data();
+  bool has_data = last_response_.has_data() || last_response_.has_columnar_data();
+  data_in_open_ = has_data;
   if (last_response_.has_more_results()) {
     next_req_.set_scanner_id(last_response_.scanner_id());
     VLOG(1) << "Opened tablet " << remote_->tablet_id()
             << ", scanner ID " << last_response_.scanner_id();
-  } else if (last_response_.has_data()) {
+  } else if (has_data) {
     VLOG(1) << "Opened tablet " << remote_->tablet_id() << ", no scanner ID assigned";
   } else {
     VLOG(1) << "Opened tablet " << remote_->tablet_id() << " (no rows), no scanner ID assigned";
@@ -399,6 +892,7 @@ Status KuduScanner::Data::OpenTablet(const string& partition_key,
   // primary key is also updated on each scan response.
   if (configuration().is_fault_tolerant()) {
     CHECK(last_response_.has_snap_timestamp());
+    DCHECK(!shared_configuration_);
     configuration_.SetSnapshotRaw(last_response_.snap_timestamp());
     if (last_response_.has_last_primary_key()) {
       last_primary_key_ = last_response_.last_primary_key();
@@ -408,12 +902,70 @@ Status KuduScanner::Data::OpenTablet(const string& partition_key,
   if (last_response_.has_snap_timestamp()) {
     table_->client()->data_->UpdateLatestObservedTimestamp(last_response_.snap_timestamp());
   }
+  if (last_response_.has_schema_version()) {
+    table_->client()->data_->NoteTableSchemaVersion(table_->name(),
+                                                    last_response_.schema_version());
+  }
+}
 
-  return Status::OK();
+bool KuduScanner::Data::OpenNextTabletAsync(const boost::function<void(const Status&)>& done) {
+  // Hedged opens are only sent by the blocking OpenNextTablet().
+  if (configuration().hedging_percentile() > 0) {
+    return false;
+  }
+  KuduClient* client = table_->client();
+  scoped_refptr<internal::RemoteTablet> tablet;
+  if (!client->data_->meta_cache_->LookupCachedTabletByKey(
+          table_.get(), partition_pruner_.NextPartitionKey(), &tablet)) {
+    return false;
+  }
+  vector<RemoteTabletServer*> candidates;
+  RemoteTabletServer* ts = client->data_->SelectTServer(
+      tablet, configuration().selection(), set<string>(), &candidates);
+  if (ts == nullptr) {
+    return false;
+  }
+  // Creating the proxy of a tablet server resolves its address.
+  shared_ptr<tserver::TabletServerServiceProxy> proxy = ts->proxy_if_initialized();
+  if (!proxy || !PrepareOpenRequest().ok()) {
+    return false;
+  }
+  remote_ = tablet;
+  ts_ = ts;
+  proxy_ = std::move(proxy);
+  next_req_.mutable_new_scan_request()->set_tablet_id(remote_->tablet_id());
+
+  // The NEW request is sent like a prefetch, and its response is analyzed
+  // on a callback thread once it arrives.
+  SendAsyncScanRpc(MonoTime::Now() + configuration().timeout(), candidates.size() > 1);
+  WhenPrefetchDone([this, done]() {
+    MonoTime deadline = prefetch_deadline_;
+    ScanRpcStatus result = WaitForPrefetch();
+    if (result.result == ScanRpcStatus::OK) {
+      last_error_ = Status::OK();
+      scan_attempts_ = 0;
+      FinishOpenTablet();
+      done(Status::OK());
+      return;
+    }
+    // Retry the way a blocking open would.
+    scan_attempts_++;
+    set<string> blacklist;
+    Status s = HandleError(result, deadline, &blacklist);
+    if (s.ok()) {
+      s = OpenNextTablet(deadline, &blacklist);
+    }
+    done(s);
+  });
+  return true;
 }
 
 Status KuduScanner::Data::KeepAlive() {
   if (!open_) return Status::IllegalState("Scanner was not open.");
+  // A prefetch in flight keeps the scanner alive by itself.
+  if (prefetch_in_flight_) {
+    return Status::OK();
+  }
   // If there is no scanner to keep alive, we still return Status::OK().
   if (!last_response_.IsInitialized() || !last_response_.has_more_results() ||
       !next_req_.has_scanner_id()) {
@@ -421,7 +973,7 @@ Status KuduScanner::Data::KeepAlive() {
   }
 
   RpcController controller;
-  controller.set_timeout(configuration_.timeout());
+  controller.set_timeout(configuration().timeout());
   tserver::ScannerKeepAliveRequestPB request;
   request.set_scanner_id(next_req_.scanner_id());
   tserver::ScannerKeepAliveResponsePB response;
@@ -432,21 +984,85 @@ Status KuduScanner::Data::KeepAlive() {
   return Status::OK();
 }
 
+Status KuduScanner::Data::ListTabletsToScan(const MonoTime& deadline,
+                                            vector<string>* partition_keys) {
+  // Prune the tablets like the scan would when moving from one tablet to
+  // the next.
+  PartitionPruner pruner;
+  pruner.Init(*table_->schema().schema_, table_->partition_schema(), configuration().spec());
+  while (pruner.HasMorePartitionKeyRanges()) {
+    scoped_refptr<internal::RemoteTablet> tablet;
+    Synchronizer sync;
+    const string& partition_key = pruner.NextPartitionKey();
+    table_->client()->data_->meta_cache_->LookupTabletByKeyOrNext(table_.get(),
+                                                                  partition_key,
+                                                                  deadline,
+                                                                  &tablet,
+                                                                  sync.AsStatusCallback());
+    Status s = sync.Wait();
+    if (s.IsNotFound()) {
+      // No more tablets in the table.
+      pruner.RemovePartitionKeyRange("");
+      continue;
+    }
+    RETURN_NOT_OK(s);
+
+    if (partition_key < tablet->partition().partition_key_start() &&
+        pruner.ShouldPrune(tablet->partition())) {
+      pruner.RemovePartitionKeyRange(tablet->partition().partition_key_end());
+      continue;
+    }
+    partition_keys->push_back(partition_key);
+    pruner.RemovePartitionKeyRange(tablet->partition().partition_key_end());
+  }
+  return Status::OK();
+}
+
+Status KuduScanner::Data::OpenSingleTablet(const ScanConfiguration* configuration,
+                                           const string& partition_key) {
+  DCHECK(!open_);
+  shared_configuration_ = configuration;
+  single_tablet_ = true;
+  partition_pruner_.Init(*table_->schema().schema_,
+                         table_->partition_schema(),
+                         configuration->spec());
+
+  MonoTime deadline = MonoTime::Now() + configuration->timeout();
+  set<string> blacklist;
+  RETURN_NOT_OK(OpenTablet(partition_key, deadline, &blacklist));
+  open_ = true;
+  return Status::OK();
+}
+
 bool KuduScanner::Data::MoreTablets() const {
   CHECK(open_);
+  if (single_tablet_) {
+    return false;
+  }
   // TODO(KUDU-565): add a test which has a scan end on a tablet boundary
+  if (configuration().has_limit() && num_rows_returned_ >= configuration().limit()) {
+    return false;
+  }
   return partition_pruner_.HasMorePartitionKeyRanges();
 }
 
 void KuduScanner::Data::PrepareRequest(RequestType state) {
   if (state == KuduScanner::Data::CLOSE) {
     next_req_.set_batch_size_bytes(0);
-  } else if (configuration_.has_batch_size_bytes()) {
-    next_req_.set_batch_size_bytes(configuration_.batch_size_bytes());
+  } else if (configuration().has_batch_size_bytes()) {
+    next_req_.set_batch_size_bytes(configuration().batch_size_bytes());
   } else {
     next_req_.clear_batch_size_bytes();
   }
 
+  if (configuration().row_layout() == KuduScanner::COLUMNAR) {
+    next_req_.set_row_layout(tserver::COLUMNAR);
+  } else {
+    next_req_.clear_row_layout();
+  }
+
+  next_req_.set_profile(configuration().profile_enabled());
+
   if (state == KuduScanner::Data::NEW) {
     next_req_.set_call_seq_id(0);
   } else {
@@ -460,11 +1076,195 @@ void KuduScanner::Data::UpdateLastError(const Status& error) {
   }
 }
 
+////////////////////////////////////////////////////////////
+// ParallelScan
+////////////////////////////////////////////////////////////
+
+namespace internal {
+
+ParallelScan::ParallelScan(KuduScanner::Data* parent)
+    : parent_(parent),
+      cond_(&lock_),
+      next_tablet_to_start_(0),
+      first_pending_tablet_(0),
+      num_tablets_done_(0),
+      buffered_bytes_(0),
+      closing_(false) {
+}
+
+ParallelScan::~ParallelScan() {
+  {
+    MutexLock l(lock_);
+    closing_ = true;
+    cond_.Broadcast();
+  }
+  if (pool_) {
+    pool_->Wait();
+    pool_->Shutdown();
+  }
+}
+
+Status ParallelScan::Init(const MonoTime& deadline) {
+  const ScanConfiguration& configuration = parent_->configuration();
+  RETURN_NOT_OK(parent_->ListTabletsToScan(deadline, &partition_keys_));
+  tablets_.reset(new TabletScan[partition_keys_.size()]);
+
+  VLOG(1) << "Scanning " << partition_keys_.size() << " tablets of " << parent_->table_->name()
+          << " with a concurrency of " << configuration.scan_concurrency();
+  RETURN_NOT_OK(ThreadPoolBuilder("parallel-scan")
+                .set_min_threads(0)
+                .set_max_threads(configuration.scan_concurrency())
+                .Build(&pool_));
+
+  MutexLock l(lock_);
+  for (int i = 0; i < configuration.scan_concurrency(); i++) {
+    StartNextTabletUnlocked();
+  }
+  return status_;
+}
+
+void ParallelScan::StartNextTabletUnlocked() {
+  lock_.AssertAcquired();
+  if (closing_ || !status_.ok() ||
+      next_tablet_to_start_ == static_cast<int>(partition_keys_.size())) {
+    return;
+  }
+  int idx = next_tablet_to_start_++;
+  Status s = pool_->SubmitFunc(boost::bind(&ParallelScan::ScanTablet, this, idx));
+  if (PREDICT_FALSE(!s.ok())) {
+    status_ = s;
+  }
+}
+
+bool ParallelScan::ShouldWaitUnlocked(int idx) const {
+  lock_.AssertAcquired();
+  if (closing_ || !status_.ok() ||
+      buffered_bytes_ < parent_->configuration().parallel_scan_memory_budget()) {
+    return false;
+  }
+  // When the tablet order is preserved, nothing can be handed out before
+  // the first pending tablet has a batch, so it must not wait for the others.
+  return !(parent_->configuration().preserve_tablet_order() &&
+           idx == first_pending_tablet_ &&
+           tablets_[idx].batches.empty());
+}
+
+void ParallelScan::ScanTablet(int idx) {
+  KuduScanner scanner(parent_->table_.get());
+  Status s = scanner.data_->OpenSingleTablet(&parent_->configuration(), partition_keys_[idx]);
+  while (s.ok() && scanner.HasMoreRows()) {
+    {
+      MutexLock l(lock_);
+      while (ShouldWaitUnlocked(idx)) {
+        cond_.Wait();
+      }
+      if (closing_ || !status_.ok()) {
+        break;
+      }
+    }
+
+    unique_ptr<KuduScanBatch> batch(new KuduScanBatch);
+    s = scanner.NextBatch(batch.get());
+    if (!s.ok() || batch->NumRows() == 0) {
+      continue;
+    }
+    size_t bytes = batch->data_->memory_footprint();
+    MutexLock l(lock_);
+    tablets_[idx].batches.push_back(BufferedBatch{ bytes, std::move(batch) });
+    buffered_bytes_ += bytes;
+    cond_.Broadcast();
+  }
+
+  for (const auto& metric : scanner.GetResourceMetrics().Get()) {
+    parent_->resource_metrics_.Increment(metric.first, metric.second);
+  }
+  map<string, map<string, int64_t>> tablet_profiles;
+  scanner.GetTabletProfiles(&tablet_profiles);
+  for (const auto& p : tablet_profiles) {
+    parent_->AddTabletProfile(p.first, p.second);
+  }
+  // Closes the server-side scanner if the scan was stopped early.
+  scanner.Close();
+
+  MutexLock l(lock_);
+  if (!s.ok()) {
+    LOG(WARNING) << "Scan of tablet at partition key "
+                 << HexDump(partition_keys_[idx]) << " failed: " << s.ToString();
+    if (status_.ok()) {
+      status_ = s;
+    }
+  }
+  tablets_[idx].done = true;
+  num_tablets_done_++;
+  StartNextTabletUnlocked();
+  cond_.Broadcast();
+}
+
+bool ParallelScan::HasMoreRows() const {
+  MutexLock l(lock_);
+  if (!status_.ok()) {
+    // Let NextBatch() return the error.
+    return true;
+  }
+  if (num_tablets_done_ < static_cast<int>(partition_keys_.size())) {
+    return true;
+  }
+  for (int i = first_pending_tablet_; i < next_tablet_to_start_; i++) {
+    if (!tablets_[i].batches.empty()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+Status ParallelScan::NextBatch(KuduScanBatch* batch) {
+  // Destroyed, along with the previous contents of 'batch', once the lock
+  // is released.
+  unique_ptr<KuduScanBatch> handed_out;
+
+  MutexLock l(lock_);
+  const int num_tablets = partition_keys_.size();
+  while (true) {
+    RETURN_NOT_OK(status_);
+    while (first_pending_tablet_ < num_tablets &&
+           tablets_[first_pending_tablet_].done &&
+           tablets_[first_pending_tablet_].batches.empty()) {
+      first_pending_tablet_++;
+      // The new first pending tablet may be allowed to go past the budget.
+      cond_.Broadcast();
+    }
+    if (first_pending_tablet_ == num_tablets) {
+      // No more rows anywhere.
+      batch->data_->Clear();
+      return Status::OK();
+    }
+
+    int last = parent_->configuration().preserve_tablet_order() ?
+        first_pending_tablet_ : next_tablet_to_start_ - 1;
+    for (int i = first_pending_tablet_; i <= last; i++) {
+      std::deque<BufferedBatch>* batches = &tablets_[i].batches;
+      if (batches->empty()) {
+        continue;
+      }
+      handed_out = std::move(batches->front().batch);
+      buffered_bytes_ -= batches->front().bytes;
+      batches->pop_front();
+      std::swap(batch->data_, handed_out->data_);
+      parent_->num_rows_returned_ += batch->NumRows();
+      cond_.Broadcast();
+      return Status::OK();
+    }
+    cond_.Wait();
+  }
+}
+
+} // namespace internal
+
 ////////////////////////////////////////////////////////////
 // KuduScanBatch
 ////////////////////////////////////////////////////////////
 
-KuduScanBatch::Data::Data() : projection_(NULL) {}
+KuduScanBatch::Data::Data() : is_columnar_(false), projection_(NULL) {}
 
 KuduScanBatch::Data::~Data() {}
 
@@ -508,7 +1308,113 @@ Status KuduScanBatch::Data::Reset(RpcController* controller,
   return Status::OK();
 }
 
+namespace {
+
+// Looks up the sidecar with index 'idx' of the columnar data described by
+// 'what', returning a Corruption status if it is missing.
+Status GetColumnarSidecar(const RpcController& controller, int idx,
+                          const ColumnSchema& col, const char* what, Slice* sidecar) {
+  Status s = controller.GetSidecar(idx, sidecar);
+  if (!s.ok()) {
+    return Status::Corruption(Substitute("Server sent invalid response: $0 sidecar "
+                                         "index corrupt for column $1", what, col.name()),
+                              s.ToString());
+  }
+  return Status::OK();
+}
+
+} // anonymous namespace
+
+Status KuduScanBatch::Data::ResetColumnar(RpcController* controller,
+                                          const Schema* projection,
+                                          const KuduSchema* client_projection,
+                                          gscoped_ptr<ColumnarRowBlockPB> data) {
+  CHECK(controller->finished());
+  controller_.Swap(controller);
+  projection_ = projection;
+  client_projection_ = client_projection;
+  is_columnar_ = true;
+  columnar_data_.Swap(data.get());
+
+  int num_cols = projection_->num_columns();
+  if (PREDICT_FALSE(columnar_data_.columns_size() != num_cols)) {
+    return Status::Corruption(Substitute("Server sent invalid response: $0 columns "
+                                         "but expected $1",
+                                         columnar_data_.columns_size(), num_cols));
+  }
+
+  size_t num_rows = columnar_data_.num_rows();
+  column_data_.assign(num_cols, Slice());
+  column_varlen_data_.assign(num_cols, Slice());
+  column_non_null_bitmaps_.assign(num_cols, Slice());
+  for (int i = 0; i < num_cols; i++) {
+    const ColumnSchema& col = projection_->column(i);
+    const ColumnarRowBlockPB::Column& col_pb = columnar_data_.columns(i);
+    bool is_varlen = col.type_info()->physical_type() == BINARY;
+
+    if (PREDICT_FALSE(!col_pb.has_data_sidecar())) {
+      return Status::Corruption("Server sent invalid response: no data for column",
+                                col.name());
+    }
+    RETURN_NOT_OK(GetColumnarSidecar(controller_, col_pb.data_sidecar(), col, "data",
+                                     &column_data_[i]));
+    size_t expected_size = is_varlen ? (num_rows + 1) * sizeof(uint32_t)
+                                     : num_rows * col.type_info()->size();
+    if (PREDICT_FALSE(column_data_[i].size() != expected_size)) {
+      return Status::Corruption(
+          Substitute("Column $0 has $1 bytes of data but expected $2 for $3 rows",
+                     col.name(), column_data_[i].size(), expected_size, num_rows));
+    }
+
+    if (is_varlen) {
+      if (col_pb.has_varlen_data_sidecar()) {
+        RETURN_NOT_OK(GetColumnarSidecar(controller_, col_pb.varlen_data_sidecar(), col,
+                                         "varlen data", &column_varlen_data_[i]));
+      }
+      // Ensure that every value is within the bounds of the varlen data.
+      const uint8_t* offsets = column_data_[i].data();
+      uint32_t prev = 0;
+      for (size_t row = 0; row <= num_rows; row++) {
+        uint32_t offset = UNALIGNED_LOAD32(offsets + row * sizeof(uint32_t));
+        if (PREDICT_FALSE(offset < prev || offset > column_varlen_data_[i].size())) {
+          return Status::Corruption(
+              Substitute("Row #$0 contained bad offset for column $1: $2",
+                         row, col.name(), offset));
+        }
+        prev = offset;
+      }
+    }
+
+    if (col.is_nullable()) {
+      if (PREDICT_FALSE(!col_pb.has_non_null_bitmap_sidecar())) {
+        return Status::Corruption("Server sent invalid response: no non-null bitmap "
+                                  "for column", col.name());
+      }
+      RETURN_NOT_OK(GetColumnarSidecar(controller_, col_pb.non_null_bitmap_sidecar(), col,
+                                       "non-null bitmap", &column_non_null_bitmaps_[i]));
+      if (PREDICT_FALSE(column_non_null_bitmaps_[i].size() != BitmapSize(num_rows))) {
+        return Status::Corruption(
+            Substitute("Column $0 has a non-null bitmap of $1 bytes but expected $2",
+                       col.name(), column_non_null_bitmaps_[i].size(),
+                       BitmapSize(num_rows)));
+      }
+    }
+  }
+  return Status::OK();
+}
+
+Status KuduScanBatch::Data::CheckColumnarColumn(int idx) const {
+  if (PREDICT_FALSE(!is_columnar_)) {
+    return Status::IllegalState("Batch is not in the columnar layout");
+  }
+  if (PREDICT_FALSE(idx < 0 || idx >= projection_->num_columns())) {
+    return Status::InvalidArgument(Substitute("Column index $0 out of range", idx));
+  }
+  return Status::OK();
+}
+
 void KuduScanBatch::Data::ExtractRows(vector<KuduScanBatch::RowPtr>* rows) {
+  DCHECK(!is_columnar_) << "rows of a columnar batch must be accessed by column";
   int n_rows = resp_data_.num_rows();
   rows->resize(n_rows);
 
@@ -533,8 +1439,37 @@ void KuduScanBatch::Data::ExtractRows(vector<KuduScanBatch::RowPtr>* rows) {
   VLOG(1) << "Extracted " << rows->size() << " rows";
 }
 
+size_t KuduScanBatch::Data::memory_footprint() const {
+  if (!is_columnar_) {
+    return direct_data_.size() + indirect_data_.size();
+  }
+  size_t bytes = 0;
+  for (const auto* slices : { &column_data_, &column_varlen_data_, &column_non_null_bitmaps_ }) {
+    for (const Slice& s : *slices) {
+      bytes += s.size();
+    }
+  }
+  return bytes;
+}
+
+void KuduScanBatch::Data::OwnProjection() {
+  if (projection_ == nullptr) {
+    // The batch was never filled in.
+    return;
+  }
+  owned_projection_.reset(new Schema(*projection_));
+  projection_ = owned_projection_.get();
+  owned_client_projection_.reset(new KuduSchema(*client_projection_));
+  client_projection_ = owned_client_projection_.get();
+}
+
 void KuduScanBatch::Data::Clear() {
   resp_data_.Clear();
+  is_columnar_ = false;
+  columnar_data_.Clear();
+  column_data_.clear();
+  column_varlen_data_.clear();
+  column_non_null_bitmaps_.clear();
   controller_.Reset();
 }
 
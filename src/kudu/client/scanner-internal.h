@@ -17,6 +17,10 @@
 #ifndef KUDU_CLIENT_SCANNER_INTERNAL_H
 #define KUDU_CLIENT_SCANNER_INTERNAL_H
 
+#include <boost/function.hpp>
+#include <deque>
+#include <map>
+#include <memory>
 #include <set>
 #include <string>
 #include <vector>
@@ -30,9 +34,15 @@
 #include "kudu/gutil/macros.h"
 #include "kudu/tserver/tserver_service.proxy.h"
 #include "kudu/util/auto_release_pool.h"
+#include "kudu/util/condition_variable.h"
+#include "kudu/util/countdown_latch.h"
+#include "kudu/util/locks.h"
+#include "kudu/util/mutex.h"
 
 namespace kudu {
 
+class ThreadPool;
+
 namespace client {
 
 // The result of KuduScanner::Data::AnalyzeResponse.
@@ -92,6 +102,54 @@ class KuduScanner::Data {
   // The RPC and TS proxy should already have been prepared in next_req_, proxy_, etc.
   ScanRpcStatus SendScanRpc(const MonoTime& overall_deadline, bool allow_time_for_failover);
 
+  // Like SendScanRpc(), but if 'ts_' doesn't respond within 'hedging_delay',
+  // sends the same request to another replica which isn't in 'blacklist',
+  // and uses the first response to arrive. 'ts_' and 'proxy_' are then those
+  // of the replica which responded.
+  ScanRpcStatus SendHedgedScanRpc(const MonoTime& overall_deadline,
+                                  bool allow_time_for_failover,
+                                  const MonoDelta& hedging_delay,
+                                  const std::set<std::string>& blacklist);
+
+  // Returns whether the opens of the scan should be hedged, setting 'delay'
+  // to the latency after which they are. That is the configured percentile
+  // of the open latencies observed by the client so far.
+  bool GetHedgingDelay(MonoDelta* delay) const;
+
+  // Sends the CONTINUE request for the next batch of the current tablet
+  // asynchronously, with a deadline of the scan timeout from now.
+  //
+  // Until WaitForPrefetch() is called, the RPC owns 'last_response_' and
+  // 'controller_', and 'prefetch_in_flight_' is set.
+  void SendPrefetchRpc();
+
+  // Reserves the client memory for a prefetched batch, which is released
+  // by WaitForPrefetch(). Returns false if the memory limit of the client
+  // doesn't allow prefetching.
+  bool TryReservePrefetchMemory();
+
+  // Sends the request prepared in 'next_req_' asynchronously, the way
+  // SendPrefetchRpc() sends a CONTINUE request.
+  void SendAsyncScanRpc(const MonoTime& overall_deadline, bool allow_time_for_failover);
+
+  // Waits for the RPC sent by SendPrefetchRpc() and analyzes its response
+  // like SendScanRpc() does.
+  ScanRpcStatus WaitForPrefetch();
+
+  // Runs 'continuation' on a client callback thread once the RPC sent by
+  // SendPrefetchRpc() completes. 'continuation' may then call
+  // WaitForPrefetch() without blocking.
+  void WhenPrefetchDone(const boost::function<void()>& continuation);
+
+  // Validates the scan options and sets up the partition pruner for
+  // KuduScanner::Open(). Sets 'short_circuit_' if the scan is known to be
+  // empty, in which case there is no tablet to open.
+  Status PrepareOpen();
+
+  // Opens the first tablet of the scan, or starts the parallel scan, after
+  // PrepareOpen(). Sets 'open_' on success.
+  Status StartScan();
+
   // Called when KuduScanner::NextBatch or KuduScanner::Data::OpenTablet result in an RPC or
   // server error.
   //
@@ -121,6 +179,36 @@ class KuduScanner::Data {
                     const MonoTime& deadline,
                     std::set<std::string>* blacklist);
 
+  // Like OpenNextTablet(), but without blocking: if the next tablet and a
+  // replica with a resolved proxy are cached, sends the NEW request
+  // asynchronously and returns true. 'done' is then run on a client
+  // callback thread, with the result the blocking open would have returned.
+  //
+  // Returns false without side effects on the scan if OpenNextTablet() must
+  // be used instead.
+  bool OpenNextTabletAsync(const boost::function<void(const Status&)>& done);
+
+  // Fills in 'next_req_' with a NEW request for the scan, except for the
+  // tablet ID.
+  Status PrepareOpenRequest();
+
+  // Updates the scan with the successful response to a NEW request for
+  // 'remote_'.
+  void FinishOpenTablet();
+
+  // Looks up the tablets to scan, returning a partition key within each of
+  // them, in partition key order.
+  Status ListTabletsToScan(const MonoTime& deadline,
+                           std::vector<std::string>* partition_keys);
+
+  // Opens this scanner on the tablet containing 'partition_key' only, reading
+  // the scan options from 'configuration' rather than from this scanner's own
+  // configuration. 'configuration' must outlive the scanner.
+  //
+  // Used for the tablet scanners of a parallel scan.
+  Status OpenSingleTablet(const ScanConfiguration* configuration,
+                          const std::string& partition_key);
+
   Status KeepAlive();
 
   // Returns whether there may exist more tablets to scan.
@@ -148,20 +236,41 @@ class KuduScanner::Data {
   // Modifies fields in 'next_req_' in preparation for a new request.
   void PrepareRequest(RequestType state);
 
+  // Looks up the result of the aggregate at index 'idx' of the scan.
+  //
+  // If 'type' and 'type_info' are non-NULL, they are set to the type of the
+  // aggregate and of its column, and a bad Status is returned for a COUNT,
+  // or if the aggregate did not see any non-null cell.
+  Status FindAggregateResult(int idx,
+                             AggregatePB::Type* type,
+                             const TypeInfo** type_info,
+                             const AggregateResultPB** result) const;
+
   // Update 'last_error_' if need be. Should be invoked whenever a
   // non-fatal (i.e. retriable) scan error is encountered.
   void UpdateLastError(const Status& error);
 
   const ScanConfiguration& configuration() const {
-    return configuration_;
+    return shared_configuration_ ? *shared_configuration_ : configuration_;
   }
 
   ScanConfiguration* mutable_configuration() {
+    DCHECK(!shared_configuration_);
     return &configuration_;
   }
 
   ScanConfiguration configuration_;
 
+  // If set, the configuration used in place of 'configuration_'. Not owned.
+  const ScanConfiguration* shared_configuration_;
+
+  // Whether the scan ends with the tablet it was opened on.
+  bool single_tablet_;
+
+  // Drives the scan if it is a parallel scan, in which case the per-tablet
+  // state below is unused.
+  gscoped_ptr<internal::ParallelScan> parallel_scan_;
+
   bool open_;
   bool data_in_open_;
 
@@ -189,6 +298,26 @@ class KuduScanner::Data {
   // RPC controller for the last in-flight RPC.
   rpc::RpcController controller_;
 
+  // When the last Scan RPC was sent to 'ts_', to track the server's latency.
+  MonoTime rpc_sent_time_;
+
+  // Whether a prefetch RPC has been sent and not waited for yet, and the
+  // overall and per-RPC deadlines it was sent with.
+  bool prefetch_in_flight_;
+  MonoTime prefetch_deadline_;
+  MonoTime prefetch_rpc_deadline_;
+
+  // The client memory reserved by TryReservePrefetchMemory().
+  int64_t prefetch_memory_bytes_;
+
+  // Counted down when the prefetch RPC completes.
+  CountDownLatch prefetch_latch_;
+
+  // Set by WhenPrefetchDone() while the prefetch RPC is in flight.
+  // Protected by 'prefetch_lock_', which orders it with the latch.
+  boost::function<void()> prefetch_continuation_;
+  simple_spinlock prefetch_lock_;
+
   // The table we're scanning.
   sp::shared_ptr<KuduTable> table_;
 
@@ -212,9 +341,31 @@ class KuduScanner::Data {
   // TODO: This and the overall scan retry logic duplicates much of RpcRetrier.
   Status last_error_;
 
+  // The number of rows handed to the application so far.
+  int64_t num_rows_returned_;
+
   // The scanner's cumulative resource metrics since the scan was started.
   ResourceMetrics resource_metrics_;
 
+  // The profile of the scan since it was started, if enabled, added up over
+  // all tablets and for each tablet. The tablet profiles are keyed by tablet
+  // ID, and protected by 'tablet_profiles_lock_' since the tablet scanners of
+  // a parallel scan add theirs from other threads.
+  ResourceMetrics profile_;
+  mutable simple_spinlock tablet_profiles_lock_;
+  std::map<std::string, std::map<std::string, int64_t>> tablet_profiles_;
+
+  // Adds 'profile', the profile of some requests to the tablet 'tablet_id',
+  // to the profiles of the scan.
+  void AddTabletProfile(const std::string& tablet_id,
+                        const std::map<std::string, int64_t>& profile);
+
+  void GetTabletProfiles(std::map<std::string, std::map<std::string, int64_t>>* profiles) const;
+
+  // The results of the scan's aggregates, merged from every response
+  // received so far. Empty until the first response is received.
+  google::protobuf::RepeatedPtrField<AggregateResultPB> aggregate_results_;
+
  private:
   // Analyze the response of the last Scan RPC made by this scanner.
   //
@@ -232,11 +383,128 @@ class KuduScanner::Data {
                                 const MonoTime& overall_deadline,
                                 const MonoTime& rpc_deadline);
 
+  // Returns the deadline a Scan RPC should use. See SendScanRpc() for the
+  // arguments.
+  MonoTime ScanRpcDeadline(const MonoTime& overall_deadline,
+                           bool allow_time_for_failover) const;
+
+  // Requires the server features the scan relies on from 'controller'.
+  void RequireServerFeatures(rpc::RpcController* controller) const;
+
+  // Resets 'controller_' for a Scan RPC and returns the deadline the RPC
+  // should use. See SendScanRpc() for the arguments.
+  MonoTime PrepareScanRpc(const MonoTime& overall_deadline, bool allow_time_for_failover);
+
+  // Analyzes the response of a Scan RPC which completed with 'rpc_status',
+  // and merges its metrics and aggregates on success.
+  ScanRpcStatus FinishScanRpc(const Status& rpc_status,
+                              const MonoTime& overall_deadline,
+                              const MonoTime& rpc_deadline);
+
+  // Called on a reactor thread when the RPC sent by SendAsyncScanRpc()
+  // completes.
+  void PrefetchRpcFinished();
+
+  // Feeds the latency and outcome of the Scan RPC which just completed in
+  // 'controller_' to the statistics of 'ts_', and to the open latencies of
+  // the client if it opened a scanner.
+  void RecordScanRpcFinished();
+
   void UpdateResourceMetrics();
 
+  // Adds the profile of 'last_response_', if any, to the profiles of the
+  // scan.
+  void UpdateProfile();
+
+  // Merges the partial aggregate results of 'last_response_' into
+  // 'aggregate_results_'.
+  void MergeAggregateResults();
+
   DISALLOW_COPY_AND_ASSIGN(Data);
 };
 
+namespace internal {
+
+// Scans the tablets of a KuduScanner concurrently.
+//
+// Each tablet is scanned by a separate KuduScanner, restricted to that tablet
+// and sharing the parent scanner's configuration, on a pool of threads sized
+// by the scan concurrency. Their batches are buffered until the parent's
+// NextBatch() hands them out: in the order they arrived, or one tablet after
+// the other if the tablet order is preserved. Once the buffered batches use
+// up the memory budget, the tablet scanners wait before fetching more.
+class ParallelScan {
+ public:
+  // 'parent' must outlive this object.
+  explicit ParallelScan(KuduScanner::Data* parent);
+
+  // Stops the tablet scanners and waits for them to finish.
+  ~ParallelScan();
+
+  // Looks up the tablets to scan and starts scanning them.
+  Status Init(const MonoTime& deadline);
+
+  bool HasMoreRows() const;
+
+  // Hands the next buffered batch over to 'batch', waiting for one if none
+  // is buffered yet. Returns the first error met by any tablet scanner.
+  Status NextBatch(KuduScanBatch* batch);
+
+ private:
+  struct BufferedBatch {
+    size_t bytes;
+    std::unique_ptr<KuduScanBatch> batch;
+  };
+
+  struct TabletScan {
+    std::deque<BufferedBatch> batches;
+    bool done = false;
+  };
+
+  // Scans the tablet at 'idx' in 'partition_keys_'. Runs on 'pool_'.
+  void ScanTablet(int idx);
+
+  // Submits the scan of the next tablet, if any is left.
+  //
+  // Requires 'lock_'.
+  void StartNextTabletUnlocked();
+
+  // Returns whether the scanner of the tablet at 'idx' must wait before
+  // fetching more rows.
+  //
+  // Requires 'lock_'.
+  bool ShouldWaitUnlocked(int idx) const;
+
+  KuduScanner::Data* const parent_;
+
+  gscoped_ptr<ThreadPool> pool_;
+
+  // A partition key within each tablet to scan, in partition key order.
+  std::vector<std::string> partition_keys_;
+
+  mutable Mutex lock_;
+
+  // Signaled when a batch is buffered or handed out, and when a tablet is
+  // done.
+  ConditionVariable cond_;
+
+  // Protected by 'lock_'. Indexed like 'partition_keys_'.
+  std::unique_ptr<TabletScan[]> tablets_;
+  // The index of the next tablet to start scanning.
+  int next_tablet_to_start_;
+  // The index of the first tablet which may have batches left to hand out.
+  int first_pending_tablet_;
+  int num_tablets_done_;
+  int64_t buffered_bytes_;
+  // The first error met by a tablet scanner.
+  Status status_;
+  bool closing_;
+
+  DISALLOW_COPY_AND_ASSIGN(ParallelScan);
+};
+
+} // namespace internal
+
 class KuduScanBatch::Data {
  public:
   Data();
@@ -247,11 +515,24 @@ class KuduScanBatch::Data {
                const KuduSchema* client_projection,
                gscoped_ptr<RowwiseRowBlockPB> resp_data);
 
+  // Like Reset(), but for a response in the columnar layout.
+  //
+  // Returns a bad Status if the column buffers do not match 'projection'.
+  Status ResetColumnar(rpc::RpcController* controller,
+                       const Schema* projection,
+                       const KuduSchema* client_projection,
+                       gscoped_ptr<ColumnarRowBlockPB> resp_data);
+
+  // Returns a bad Status unless this is a columnar batch which has a column
+  // with index 'idx'.
+  Status CheckColumnarColumn(int idx) const;
+
   int num_rows() const {
-    return resp_data_.num_rows();
+    return is_columnar_ ? columnar_data_.num_rows() : resp_data_.num_rows();
   }
 
   KuduRowResult row(int idx) {
+    DCHECK(!is_columnar_) << "rows of a columnar batch must be accessed by column";
     DCHECK_GE(idx, 0);
     DCHECK_LT(idx, num_rows());
     int offset = idx * projected_row_size_;
@@ -262,9 +543,16 @@ class KuduScanBatch::Data {
 
   void Clear();
 
+  // Replaces the projections, which are owned by the scanner, with copies
+  // owned by this object, so that it may outlive the scanner.
+  void OwnProjection();
+
   // Returns the size of a row for the given projection 'proj'.
   static size_t CalculateProjectedRowSize(const Schema& proj);
 
+  // Returns the number of bytes of row data held by the batch.
+  size_t memory_footprint() const;
+
   // The RPC controller for the RPC which returned this batch.
   // Holding on to the controller ensures we hold on to the indirect data
   // which contains the rows.
@@ -273,6 +561,19 @@ class KuduScanBatch::Data {
   // The PB which contains the "direct data" slice.
   RowwiseRowBlockPB resp_data_;
 
+  // Whether the batch was returned in the columnar layout, in which case
+  // 'columnar_data_' and the per-column slices below are used instead of
+  // 'resp_data_' and the direct and indirect data.
+  bool is_columnar_;
+  ColumnarRowBlockPB columnar_data_;
+
+  // Per-column slices into the sidecars of a columnar batch, indexed by
+  // the column's position in the projection. Slices which do not apply to
+  // a column (e.g. the non-null bitmap of a non-nullable column) are empty.
+  std::vector<Slice> column_data_;
+  std::vector<Slice> column_varlen_data_;
+  std::vector<Slice> column_non_null_bitmaps_;
+
   // Slices into the direct and indirect row data, whose lifetime is ensured
   // by the members above.
   Slice direct_data_, indirect_data_;
@@ -284,6 +585,10 @@ class KuduScanBatch::Data {
 
   // The number of bytes of direct data for each row.
   size_t projected_row_size_;
+
+  // Copies of the projections, if OwnProjection() was called.
+  gscoped_ptr<Schema> owned_projection_;
+  gscoped_ptr<KuduSchema> owned_client_projection_;
 };
 
 } // namespace client
@@ -51,7 +51,11 @@ class KuduColumnSpec::Data {
         has_encoding(false),
         has_compression(false),
         has_block_size(false),
+        bitmap_index(false),
+        ttl_seconds(0),
         has_nullable(false),
+        has_precision(false),
+        has_scale(false),
         primary_key(false),
         has_default(false),
         default_val(NULL),
@@ -77,9 +81,19 @@ class KuduColumnSpec::Data {
   bool has_block_size;
   int32_t block_size;
 
+  bool bitmap_index;
+
+  int64_t ttl_seconds;
+
   bool has_nullable;
   bool nullable;
 
+  bool has_precision;
+  int8_t precision;
+
+  bool has_scale;
+  int8_t scale;
+
   bool primary_key;
 
   bool has_default;
@@ -33,7 +33,7 @@ MAKE_ENUM_LIMITS(kudu::client::KuduColumnStorageAttributes::EncodingType,
 
 MAKE_ENUM_LIMITS(kudu::client::KuduColumnStorageAttributes::CompressionType,
                  kudu::client::KuduColumnStorageAttributes::DEFAULT_COMPRESSION,
-                 kudu::client::KuduColumnStorageAttributes::ZLIB);
+                 kudu::client::KuduColumnStorageAttributes::ZSTD);
 
 MAKE_ENUM_LIMITS(kudu::client::KuduColumnSchema::DataType,
                  kudu::client::KuduColumnSchema::INT8,
@@ -55,6 +55,8 @@ kudu::EncodingType ToInternalEncodingType(KuduColumnStorageAttributes::EncodingT
     case KuduColumnStorageAttributes::GROUP_VARINT: return kudu::GROUP_VARINT;
     case KuduColumnStorageAttributes::RLE: return kudu::RLE;
     case KuduColumnStorageAttributes::BIT_SHUFFLE: return kudu::BIT_SHUFFLE;
+    case KuduColumnStorageAttributes::FRAME_OF_REFERENCE: return kudu::FRAME_OF_REFERENCE;
+    case KuduColumnStorageAttributes::ADAPTIVE_ENCODING: return kudu::ADAPTIVE_ENCODING;
     default: LOG(FATAL) << "Unexpected encoding type: " << type;
   }
 }
@@ -68,6 +70,8 @@ KuduColumnStorageAttributes::EncodingType FromInternalEncodingType(kudu::Encodin
     case kudu::GROUP_VARINT: return KuduColumnStorageAttributes::GROUP_VARINT;
     case kudu::RLE: return KuduColumnStorageAttributes::RLE;
     case kudu::BIT_SHUFFLE: return KuduColumnStorageAttributes::BIT_SHUFFLE;
+    case kudu::FRAME_OF_REFERENCE: return KuduColumnStorageAttributes::FRAME_OF_REFERENCE;
+    case kudu::ADAPTIVE_ENCODING: return KuduColumnStorageAttributes::ADAPTIVE_ENCODING;
     default: LOG(FATAL) << "Unexpected internal encoding type: " << type;
   }
 }
@@ -79,6 +83,7 @@ kudu::CompressionType ToInternalCompressionType(KuduColumnStorageAttributes::Com
     case KuduColumnStorageAttributes::SNAPPY: return kudu::SNAPPY;
     case KuduColumnStorageAttributes::LZ4: return kudu::LZ4;
     case KuduColumnStorageAttributes::ZLIB: return kudu::ZLIB;
+    case KuduColumnStorageAttributes::ZSTD: return kudu::ZSTD;
     default: LOG(FATAL) << "Unexpected compression type" << type;
   }
 }
@@ -91,6 +96,7 @@ KuduColumnStorageAttributes::CompressionType FromInternalCompressionType(
     case kudu::SNAPPY: return KuduColumnStorageAttributes::SNAPPY;
     case kudu::LZ4: return KuduColumnStorageAttributes::LZ4;
     case kudu::ZLIB: return KuduColumnStorageAttributes::ZLIB;
+    case kudu::ZSTD: return KuduColumnStorageAttributes::ZSTD;
     default: LOG(FATAL) << "Unexpected internal compression type: " << type;
   }
 }
@@ -107,6 +113,9 @@ kudu::DataType ToInternalDataType(KuduColumnSchema::DataType type) {
     case KuduColumnSchema::STRING: return kudu::STRING;
     case KuduColumnSchema::BINARY: return kudu::BINARY;
     case KuduColumnSchema::BOOL: return kudu::BOOL;
+    // The storage of a decimal depends on its precision, so this is only the
+    // widest of the decimal types.
+    case KuduColumnSchema::DECIMAL: return kudu::DECIMAL64;
     default: LOG(FATAL) << "Unexpected data type: " << type;
   }
 }
@@ -123,6 +132,8 @@ KuduColumnSchema::DataType FromInternalDataType(kudu::DataType type) {
     case kudu::STRING: return KuduColumnSchema::STRING;
     case kudu::BINARY: return KuduColumnSchema::BINARY;
     case kudu::BOOL: return KuduColumnSchema::BOOL;
+    case kudu::DECIMAL32: return KuduColumnSchema::DECIMAL;
+    case kudu::DECIMAL64: return KuduColumnSchema::DECIMAL;
     default: LOG(FATAL) << "Unexpected internal data type: " << type;
   }
 }
@@ -145,6 +156,18 @@ KuduColumnSpec* KuduColumnSpec::Type(KuduColumnSchema::DataType type) {
   return this;
 }
 
+KuduColumnSpec* KuduColumnSpec::Precision(int8_t precision) {
+  data_->has_precision = true;
+  data_->precision = precision;
+  return this;
+}
+
+KuduColumnSpec* KuduColumnSpec::Scale(int8_t scale) {
+  data_->has_scale = true;
+  data_->scale = scale;
+  return this;
+}
+
 KuduColumnSpec* KuduColumnSpec::Default(KuduValue* v) {
   data_->has_default = true;
   delete data_->default_val;
@@ -172,6 +195,16 @@ KuduColumnSpec* KuduColumnSpec::BlockSize(int32_t block_size) {
   return this;
 }
 
+KuduColumnSpec* KuduColumnSpec::BitmapIndex() {
+  data_->bitmap_index = true;
+  return this;
+}
+
+KuduColumnSpec* KuduColumnSpec::TimeToLive(int64_t ttl_seconds) {
+  data_->ttl_seconds = ttl_seconds;
+  return this;
+}
+
 KuduColumnSpec* KuduColumnSpec::PrimaryKey() {
   data_->primary_key = true;
   return this;
@@ -219,8 +252,44 @@ Status KuduColumnSpec::ToColumnSchema(KuduColumnSchema* col) const {
   }
   DataType internal_type = ToInternalDataType(data_->type);
 
+  ColumnTypeAttributes type_attributes;
+  if (data_->type == KuduColumnSchema::DECIMAL) {
+    if (!data_->has_precision) {
+      return Status::InvalidArgument("no precision provided for decimal column", data_->name);
+    }
+    internal_type = DecimalTypeForPrecision(data_->precision);
+    if (internal_type == UNKNOWN_DATA) {
+      return Status::InvalidArgument(
+          Substitute("precision of decimal column must be between 1 and $0: $1",
+                     kMaxDecimal64Precision, static_cast<int>(data_->precision)),
+          data_->name);
+    }
+    type_attributes.precision = data_->precision;
+    type_attributes.scale = data_->has_scale ? data_->scale : 0;
+    if (type_attributes.scale < 0 || type_attributes.scale > type_attributes.precision) {
+      return Status::InvalidArgument(
+          Substitute("scale of decimal column must be between 0 and its precision: $0",
+                     static_cast<int>(type_attributes.scale)),
+          data_->name);
+    }
+  } else if (data_->has_precision || data_->has_scale) {
+    return Status::InvalidArgument("precision and scale are only valid for decimal columns",
+                                   data_->name);
+  }
+
   bool nullable = data_->has_nullable ? data_->nullable : true;
 
+  if (data_->ttl_seconds != 0) {
+    if (data_->ttl_seconds < 0) {
+      return Status::InvalidArgument("time to live must be positive", data_->name);
+    }
+    if (data_->type != KuduColumnSchema::UNIXTIME_MICROS || nullable) {
+      return Status::InvalidArgument(
+          "time to live is only valid for non-nullable UNIXTIME_MICROS columns",
+          data_->name);
+    }
+  }
+
   void* default_val = nullptr;
   // TODO: distinguish between DEFAULT NULL and no default?
   if (data_->has_default) {
@@ -247,6 +316,21 @@ Status KuduColumnSpec::ToColumnSchema(KuduColumnSchema* col) const {
     block_size = data_->block_size;
   }
 
+  // The public storage attributes can't describe decimals, bitmap indexes
+  // or row expiry.
+  if (data_->type == KuduColumnSchema::DECIMAL || data_->bitmap_index ||
+      data_->ttl_seconds > 0) {
+    ColumnStorageAttributes attr_private(ToInternalEncodingType(encoding),
+                                         ToInternalCompressionType(compression));
+    attr_private.cfile_block_size = block_size;
+    attr_private.bitmap_index = data_->bitmap_index;
+    attr_private.ttl_seconds = data_->ttl_seconds;
+    *col = KuduColumnSchema(ColumnSchema(data_->name, internal_type, nullable,
+                                         default_val, default_val,
+                                         attr_private, type_attributes));
+    return Status::OK();
+  }
+
   *col = KuduColumnSchema(data_->name, data_->type, nullable,
                           default_val,
                           KuduColumnStorageAttributes(encoding, compression, block_size));
@@ -310,6 +394,20 @@ Status KuduSchemaBuilder::Build(KuduSchema* schema) {
     RETURN_NOT_OK(data_->specs[i]->ToColumnSchema(&cols[i]));
   }
 
+  // Rows can only expire by a single column.
+  int ttl_col_idx = -1;
+  for (int i = 0; i < cols.size(); i++) {
+    if (data_->specs[i]->data_->ttl_seconds > 0) {
+      if (ttl_col_idx != -1) {
+        return Status::InvalidArgument("multiple columns specified with a time to live",
+                                       Substitute("$0, $1",
+                                                  cols[ttl_col_idx].name(),
+                                                  cols[i].name()));
+      }
+      ttl_col_idx = i;
+    }
+  }
+
   int num_key_cols;
 
   if (!data_->has_key_col_names) {
@@ -388,6 +486,9 @@ Status KuduSchemaBuilder::Build(KuduSchema* schema) {
 ////////////////////////////////////////////////////////////
 
 std::string KuduColumnSchema::DataTypeToString(DataType type) {
+  if (type == DECIMAL) {
+    return "DECIMAL";
+  }
   return DataType_Name(ToInternalDataType(type));
 }
 
@@ -411,6 +512,10 @@ KuduColumnSchema::KuduColumnSchema(const KuduColumnSchema& other)
 KuduColumnSchema::KuduColumnSchema() : col_(nullptr) {
 }
 
+KuduColumnSchema::KuduColumnSchema(const ColumnSchema& col)
+  : col_(new ColumnSchema(col)) {
+}
+
 KuduColumnSchema::~KuduColumnSchema() {
   delete col_;
 }
@@ -449,6 +554,14 @@ KuduColumnSchema::DataType KuduColumnSchema::type() const {
   return FromInternalDataType(DCHECK_NOTNULL(col_)->type_info()->type());
 }
 
+int8_t KuduColumnSchema::precision() const {
+  return DCHECK_NOTNULL(col_)->type_attributes().precision;
+}
+
+int8_t KuduColumnSchema::scale() const {
+  return DCHECK_NOTNULL(col_)->type_attributes().scale;
+}
+
 
 ////////////////////////////////////////////////////////////
 // KuduSchema
@@ -503,6 +616,10 @@ bool KuduSchema::Equals(const KuduSchema& other) const {
 
 KuduColumnSchema KuduSchema::Column(size_t idx) const {
   ColumnSchema col(schema_->column(idx));
+  if (IsDecimalType(col.type_info()->type())) {
+    // The client-facing type doesn't determine the storage of a decimal.
+    return KuduColumnSchema(col);
+  }
   KuduColumnStorageAttributes attrs(FromInternalEncodingType(col.attributes().encoding),
                                     FromInternalCompressionType(col.attributes().compression));
   return KuduColumnSchema(col.name(), FromInternalDataType(col.type_info()->type()),
@@ -46,8 +46,10 @@ class WriteRpc;
 } // namespace internal
 
 class KuduClient;
+class KuduColumnarInsertBatch;
 class KuduSchema;
 class KuduSchemaBuilder;
+class KuduSession;
 class KuduWriteOperation;
 
 /// @brief Representation of column storage attributes.
@@ -61,7 +63,9 @@ class KUDU_EXPORT KuduColumnStorageAttributes {
     GROUP_VARINT = 3,
     RLE = 4,
     DICT_ENCODING = 5,
-    BIT_SHUFFLE = 6
+    BIT_SHUFFLE = 6,
+    FRAME_OF_REFERENCE = 7,
+    ADAPTIVE_ENCODING = 8
   };
 
   /// @brief Column compression types.
@@ -71,6 +75,7 @@ class KUDU_EXPORT KuduColumnStorageAttributes {
     SNAPPY = 2,
     LZ4 = 3,
     ZLIB = 4,
+    ZSTD = 5,
   };
 
 
@@ -129,6 +134,7 @@ class KUDU_EXPORT KuduColumnSchema {
     DOUBLE = 7,
     BINARY = 8,
     UNIXTIME_MICROS = 9,
+    DECIMAL = 10,
     TIMESTAMP = UNIXTIME_MICROS //!< deprecated, use UNIXTIME_MICROS
   };
 
@@ -200,6 +206,12 @@ class KUDU_EXPORT KuduColumnSchema {
 
   /// @return @c true iff the column schema has the nullable attribute set.
   bool is_nullable() const;
+
+  /// @return The precision of a DECIMAL column, or 0 for other types.
+  int8_t precision() const;
+
+  /// @return The scale of a DECIMAL column, or 0 for other types.
+  int8_t scale() const;
   ///@}
 
  private:
@@ -212,6 +224,9 @@ class KUDU_EXPORT KuduColumnSchema {
 
   KuduColumnSchema();
 
+  // Makes a copy of 'col'.
+  explicit KuduColumnSchema(const ColumnSchema& col);
+
   // Owned.
   ColumnSchema* col_;
 };
@@ -276,6 +291,32 @@ class KUDU_EXPORT KuduColumnSpec {
   /// @return Pointer to the modified object.
   KuduColumnSpec* BlockSize(int32_t block_size);
 
+  /// Keep a bitmap index of the column's values.
+  ///
+  /// Each rowset of the table then records which of its rows hold each of
+  /// the column's distinct values, and scans look up the rows matching a
+  /// predicate on the column instead of reading its data. This is worthwhile
+  /// for columns with few distinct values, such as status codes. Rowsets in
+  /// which the column has too many distinct values are not indexed.
+  ///
+  /// @return Pointer to the modified object.
+  KuduColumnSpec* BitmapIndex();
+
+  /// Expire the rows of the table a while after the time held by the column.
+  ///
+  /// A row expires once the column's value is more than @c ttl_seconds
+  /// in the past, according to the wall clock of the tablet servers. Expired
+  /// rows are no longer returned by scans, and are dropped from disk by
+  /// compactions; a rowset whose rows have all expired is deleted without
+  /// being rewritten. Updates to a row which has expired may be lost. The
+  /// column must be a non-nullable UNIXTIME_MICROS column, and a table may
+  /// have a single such column.
+  ///
+  /// @param [in] ttl_seconds
+  ///   The time to live of the rows, in seconds. Must be positive.
+  /// @return Pointer to the modified object.
+  KuduColumnSpec* TimeToLive(int64_t ttl_seconds);
+
   /// @name Operations only relevant for Create Table
   ///
   ///@{
@@ -312,6 +353,29 @@ class KUDU_EXPORT KuduColumnSpec {
   ///   The data type to set.
   /// @return Pointer to the modified object.
   KuduColumnSpec* Type(KuduColumnSchema::DataType type);
+
+  /// Set the precision of a DECIMAL column, i.e. the total number of
+  /// decimal digits of its values. This is required for DECIMAL columns,
+  /// and determines how many bytes are used to store each value: 4 up to
+  /// a precision of 9, and 8 up to the maximum precision of 18.
+  ///
+  /// @note Column precision may not be changed once a table is created.
+  ///
+  /// @param [in] precision
+  ///   The precision to set.
+  /// @return Pointer to the modified object.
+  KuduColumnSpec* Precision(int8_t precision);
+
+  /// Set the scale of a DECIMAL column, i.e. the number of decimal digits
+  /// to the right of the decimal point. It may not exceed the precision.
+  /// Defaults to 0.
+  ///
+  /// @note Column scale may not be changed once a table is created.
+  ///
+  /// @param [in] scale
+  ///   The scale to set.
+  /// @return Pointer to the modified object.
+  KuduColumnSpec* Scale(int8_t scale);
   ///@}
 
   /// @name Operations only relevant for Alter Table
@@ -482,10 +546,13 @@ class KUDU_EXPORT KuduSchema {
 
  private:
   friend class KuduClient;
+  friend class KuduColumnarInsertBatch;
+  friend class KuduRowLookup;
   friend class KuduScanner;
   friend class KuduScanToken;
   friend class KuduScanTokenBuilder;
   friend class KuduSchemaBuilder;
+  friend class KuduSession;
   friend class KuduTable;
   friend class KuduTableCreator;
   friend class KuduWriteOperation;
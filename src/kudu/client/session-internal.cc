@@ -19,12 +19,26 @@
 
 #include <mutex>
 
+#include <algorithm>
+#include <utility>
+#include <vector>
+
 #include "kudu/client/batcher.h"
 #include "kudu/client/callbacks.h"
+#include "kudu/client/client-internal.h"
 #include "kudu/client/error_collector.h"
+#include "kudu/client/meta_cache.h"
 #include "kudu/client/shared_ptr.h"
+#include "kudu/client/write_op-internal.h"
+#include "kudu/common/partition.h"
+#include "kudu/common/row.h"
+#include "kudu/common/row_operations.h"
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/gutil/sysinfo.h"
 #include "kudu/rpc/messenger.h"
+#include "kudu/util/async_util.h"
+#include "kudu/util/mem_tracker.h"
+#include "kudu/util/scoped_cleanup.h"
 
 namespace kudu {
 
@@ -33,11 +47,30 @@ using rpc::Messenger;
 namespace client {
 
 using internal::Batcher;
+using internal::ColumnarInsertChunk;
 using internal::ErrorCollector;
+using internal::RemoteTablet;
 
 using sp::shared_ptr;
 using sp::weak_ptr;
+using std::string;
+using std::vector;
+using strings::Substitute;
+
+namespace {
 
+// Assigns threads to apply buffers round-robin in concurrent apply mode.
+std::atomic<int> next_apply_buffer_slot(0);
+__thread int apply_buffer_slot = -1;
+
+int ApplyBufferSlot() {
+  if (PREDICT_FALSE(apply_buffer_slot < 0)) {
+    apply_buffer_slot = next_apply_buffer_slot.fetch_add(1, std::memory_order_relaxed);
+  }
+  return apply_buffer_slot;
+}
+
+} // anonymous namespace
 
 KuduSession::Data::Data(shared_ptr<KuduClient> client,
                         std::weak_ptr<rpc::Messenger> messenger)
@@ -49,6 +82,9 @@ KuduSession::Data::Data(shared_ptr<KuduClient> client,
       flush_task_active_(false),
       flush_mode_(AUTO_FLUSH_SYNC),
       condition_(&mutex_),
+      concurrent_apply_(false),
+      num_apply_buffers_(0),
+      apply_buffers_bytes_(0),
       batchers_num_(0),
       batchers_num_limit_(2),
       buffer_bytes_limit_(7 * 1024 * 1024),
@@ -70,16 +106,36 @@ void KuduSession::Data::FlushFinished(Batcher* batcher) {
     --batchers_num_;
     // The logic of KuduSession::ApplyWriteOp() needs to know
     // if total number of batchers or buffer byte count decreases.
-    // There can be a thread waiting on the corresponding condition
-    // variable: the thread which runs KuduSession::Apply(), and
-    // since KuduSession interface does not advertise thread-safety, it's
-    // the only thread to notify.
-    condition_.Signal();
+    // There can be threads waiting on the corresponding condition
+    // variable: the thread which runs KuduSession::Apply(), or several
+    // of them in concurrent apply mode, and the thread which runs
+    // KuduSession::Flush().
+    condition_.Broadcast();
   }
 }
 
 Status KuduSession::Data::Close(bool force) {
   std::lock_guard<Mutex> l(mutex_);
+  if (apply_buffers_bytes_ > 0) {
+    if (!force) {
+      return Status::IllegalState("Could not close. There are pending operations.");
+    }
+    for (int i = 0; i < num_apply_buffers_; i++) {
+      vector<BufferedOp> ops;
+      {
+        std::lock_guard<simple_spinlock> buf_lock(apply_buffers_[i].lock);
+        ops.swap(apply_buffers_[i].ops);
+      }
+      for (BufferedOp& op : ops) {
+        const int64_t size = Batcher::GetOperationSizeInBuffer(op.write_op);
+        error_collector_->AddError(gscoped_ptr<KuduError>(
+            new KuduError(op.write_op, Status::Aborted("Batch aborted"))));
+        buffer_bytes_used_ -= size;
+        apply_buffers_bytes_ -= size;
+        ReleaseClientMemory(size);
+      }
+    }
+  }
   if (!batcher_) {
       return Status::OK();
   }
@@ -209,6 +265,20 @@ Status KuduSession::Data::SetMaxBatchersNum(unsigned int max_num) {
   return Status::OK();
 }
 
+Status KuduSession::Data::SetConcurrentApply(bool enable) {
+  std::lock_guard<Mutex> l(mutex_);
+  if (HasPendingOperationsUnlocked()) {
+    return Status::IllegalState(
+        "Cannot change concurrent apply mode when writes are buffered.");
+  }
+  if (enable && !apply_buffers_) {
+    num_apply_buffers_ = base::MaxCPUIndex() + 1;
+    apply_buffers_.reset(new ApplyBuffer[num_apply_buffers_]);
+  }
+  concurrent_apply_ = enable;
+  return Status::OK();
+}
+
 void KuduSession::Data::SetTimeoutMillis(int timeout_ms) {
   if (timeout_ms < 0) {
     timeout_ms = 0;
@@ -233,8 +303,17 @@ Status KuduSession::Data::Flush() {
   // all session's batchers.
   FlushCurrentBatcher(kWatermarkNonEmptyBatcher, nullptr);
   {
-    std::lock_guard<Mutex> l(mutex_);
+    std::unique_lock<Mutex> l(mutex_);
     while (buffer_bytes_used_ > 0) {
+      // In concurrent apply mode, operations may have been applied since
+      // the flush, or may not have fit into a batcher yet: flush them too.
+      if (apply_buffers_bytes_ > 0 &&
+          (batcher_ || batchers_num_limit_ == 0 || batchers_num_ < batchers_num_limit_)) {
+        l.unlock();
+        FlushCurrentBatcher(kWatermarkNonEmptyBatcher, nullptr);
+        l.lock();
+        continue;
+      }
       condition_.Wait();
     }
   }
@@ -256,14 +335,19 @@ bool KuduSession::Data::HasPendingOperationsUnlocked() const {
 
 int KuduSession::Data::CountBufferedOperations() const {
   std::lock_guard<Mutex> l(mutex_);
+  int count = 0;
+  for (int i = 0; i < num_apply_buffers_; i++) {
+    std::lock_guard<simple_spinlock> buf_lock(apply_buffers_[i].lock);
+    count += apply_buffers_[i].ops.size();
+  }
   if (batcher_) {
     // Prior batchers (if any) with pending operations are not relevant here:
     // the flushed operations, even if they have not reached the tablet server,
     // are not considered "buffered". Yes, they are "pending",
     // but not "buffered".
-    return batcher_->CountBufferedOperations();
+    count += batcher_->CountBufferedOperations();
   }
-  return 0;
+  return count;
 }
 
 void KuduSession::Data::FlushCurrentBatcher(int64_t watermark,
@@ -271,6 +355,7 @@ void KuduSession::Data::FlushCurrentBatcher(int64_t watermark,
   scoped_refptr<Batcher> batcher_to_flush;
   {
     std::lock_guard<Mutex> l(mutex_);
+    MoveApplyBuffersToBatcherUnlocked();
     if (PREDICT_TRUE(batcher_) && batcher_->buffer_bytes_used() >= watermark) {
       batcher_to_flush.swap(batcher_);
     }
@@ -293,7 +378,14 @@ MonoDelta KuduSession::Data::FlushCurrentBatcher(const MonoDelta& max_age) {
   scoped_refptr<Batcher> batcher_to_flush;
   {
     std::lock_guard<Mutex> l(mutex_);
-    if (batcher_) {
+    // The operations in the apply buffers are as old as the last run of the
+    // time-based flush task at most, so once they're moved into the batcher,
+    // it's flushed without waiting for another interval.
+    bool had_buffered_ops = apply_buffers_bytes_ > 0;
+    MoveApplyBuffersToBatcherUnlocked();
+    if (had_buffered_ops && batcher_) {
+      batcher_to_flush.swap(batcher_);
+    } else if (batcher_) {
       const MonoTime first_op_time = batcher_->first_op_time();
       if (PREDICT_TRUE(first_op_time.Initialized())) {
         const MonoTime now = MonoTime::Now();
@@ -318,6 +410,103 @@ MonoDelta KuduSession::Data::FlushCurrentBatcher(const MonoDelta& max_age) {
 // from this this method, the operation must end up either in the corresponding
 // batcher (success path) or in the error collector (failure path). Otherwise
 // it would be a memory leak.
+Status KuduSession::Data::ApplyColumnarInserts(const shared_ptr<KuduTable>& table,
+                                               const std::shared_ptr<ColumnarInsertsPB>& rows) {
+  const Schema* schema = table->schema().schema_;
+  const int num_rows = rows->num_rows();
+
+  // Like a row operation, every row needs its key, and is accounted in the
+  // buffer as its isset and null bitmaps plus its cells.
+  vector<bool> is_set(schema->num_columns());
+  int64_t fixed_row_size = 1 + BitmapSize(schema->num_columns()) +
+      ContiguousRowHelper::null_bitmap_size(*schema);
+  vector<const uint32_t*> varlen_offsets;
+  for (const ColumnarInsertsPB::Column& col_pb : rows->columns()) {
+    is_set[col_pb.column_idx()] = true;
+    const ColumnSchema& col = schema->column(col_pb.column_idx());
+    fixed_row_size += col.type_info()->size();
+    if (col.type_info()->physical_type() == BINARY) {
+      varlen_offsets.push_back(reinterpret_cast<const uint32_t*>(col_pb.data().data()));
+    }
+  }
+  for (int i = 0; i < schema->num_key_columns(); i++) {
+    if (PREDICT_FALSE(!is_set[i])) {
+      return Status::IllegalState("Key not specified",
+                                  Substitute("column $0 of columnar insert batch",
+                                             schema->column(i).name()));
+    }
+  }
+
+  // Keep the chunks small enough that several of them fit into the buffer,
+  // so that buffering a chunk doesn't have to wait for all of the previous
+  // ones to be flushed.
+  const int64_t max_chunk_size = std::max<int64_t>(buffer_bytes_limit_ / 4, 1);
+  const MonoDelta timeout = timeout_.Initialized() ? timeout_ : MonoDelta::FromSeconds(60);
+
+  Status first_error;
+  auto record_error = [&](const Status& s) {
+    if (first_error.ok()) {
+      first_error = s;
+    }
+  };
+
+  vector<int> chunk_rows;
+  int64_t chunk_size = 0;
+  auto apply_chunk = [&]() {
+    if (chunk_rows.empty()) {
+      return;
+    }
+    // ApplyWriteOp() takes ownership of the chunk even if it fails.
+    record_error(ApplyWriteOp(new ColumnarInsertChunk(table, rows, std::move(chunk_rows),
+                                                      chunk_size)));
+    chunk_rows.clear();
+    chunk_size = 0;
+  };
+
+  KuduPartialRow key_row(schema);
+  scoped_refptr<RemoteTablet> tablet;
+  string partition_key;
+  for (int r = 0; r < num_rows; r++) {
+    RETURN_NOT_OK(RowOperationsPBDecoder::DecodeColumnarInsertRow(*rows, r, true, &key_row));
+    RETURN_NOT_OK(table->partition_schema().EncodeKey(key_row, &partition_key));
+
+    // Consecutive rows usually belong to the same tablet, and then don't
+    // need to be looked up.
+    if (!tablet ||
+        partition_key < tablet->partition().partition_key_start() ||
+        (!tablet->partition().partition_key_end().empty() &&
+         partition_key >= tablet->partition().partition_key_end())) {
+      apply_chunk();
+      Synchronizer sync;
+      client_->data_->meta_cache_->LookupTabletByKey(table.get(), partition_key,
+                                                      MonoTime::Now() + timeout,
+                                                      &tablet, sync.AsStatusCallback());
+      Status s = sync.Wait();
+      if (PREDICT_FALSE(!s.ok())) {
+        tablet.reset();
+        KuduInsert* insert = table->NewInsert();
+        RETURN_NOT_OK(RowOperationsPBDecoder::DecodeColumnarInsertRow(
+            *rows, r, false, insert->mutable_row()));
+        error_collector_->AddError(gscoped_ptr<KuduError>(new KuduError(insert, s)));
+        record_error(s);
+        continue;
+      }
+    }
+
+    int64_t row_size = fixed_row_size;
+    for (const uint32_t* offsets : varlen_offsets) {
+      row_size += offsets[r + 1] - offsets[r];
+    }
+    if (chunk_size + row_size > max_chunk_size) {
+      apply_chunk();
+    }
+    chunk_rows.push_back(r);
+    chunk_size += row_size;
+  }
+  apply_chunk();
+  return first_error;
+}
+
 Status KuduSession::Data::ApplyWriteOp(KuduWriteOperation* write_op) {
   if (PREDICT_FALSE(!write_op)) {
     return Status::InvalidArgument("NULL operation");
@@ -334,15 +523,7 @@ Status KuduSession::Data::ApplyWriteOp(KuduWriteOperation* write_op) {
   const int64_t required_size = Batcher::GetOperationSizeInBuffer(write_op);
 
   const size_t max_size = buffer_bytes_limit_;
-  // Thread-safety note: the flush_mode_ is accessed from the background
-  // time-based flush task for reading. Practically, it would be possible
-  // to get away with not protecting the flush_mode_ since it's read-only
-  // access here as well, but TSAN does not like that.
-  FlushMode flush_mode;
-  {
-    std::lock_guard<Mutex> l(mutex_);
-    flush_mode = flush_mode_;
-  }
+  const FlushMode flush_mode = flush_mode_;
 
   // A sanity check: before trying to validate against any of run-time metrics,
   // verify that the single operation can fit into an empty buffer
@@ -357,6 +538,24 @@ Status KuduSession::Data::ApplyWriteOp(KuduWriteOperation* write_op) {
     return s;
   }
 
+  Status s = ReserveClientMemory(required_size, flush_mode);
+  if (PREDICT_FALSE(!s.ok())) {
+    error_collector_->AddError(gscoped_ptr<KuduError>(new KuduError(write_op, s)));
+    return s;
+  }
+  // Once the operation is buffered, its memory is released when it's flushed.
+  auto release_memory = MakeScopedCleanup([&]() {
+      ReleaseClientMemory(required_size);
+    });
+
+  if (concurrent_apply_) {
+    s = ApplyWriteOpConcurrently(write_op, required_size, flush_mode);
+    if (s.ok()) {
+      release_memory.cancel();
+    }
+    return s;
+  }
+
   if (flush_mode == AUTO_FLUSH_BACKGROUND) {
     if (PREDICT_TRUE(buffer_pre_flush_enabled_)) {
       // NOTE: the buffer_pre_flush_enabled_ is set to false only in tests.
@@ -397,7 +596,7 @@ Status KuduSession::Data::ApplyWriteOp(KuduWriteOperation* write_op) {
       Status s = Status::Incomplete(strings::Substitute(
           "not enough mutation buffer space remaining for operation: "
           "required additional $0 when $1 of $2 already used",
-          required_size, buffer_bytes_used_, max_size));
+          required_size, buffer_bytes_used_.load(), max_size));
       error_collector_->AddError(
           gscoped_ptr<KuduError>(new KuduError(write_op, s)));
       return s;
@@ -412,18 +611,7 @@ Status KuduSession::Data::ApplyWriteOp(KuduWriteOperation* write_op) {
         // on the maximum outstanding batchers per session.
         condition_.Wait();
       }
-      DCHECK(!batcher_);
-      // Thread-safety note: the external_consistecy_mode_ and timeout_ms_
-      // are not supposed to be accessed or modified from any other thread
-      // no thread-safety is advertised for the kudu::KuduSession interface.
-      scoped_refptr<Batcher> batcher(
-          new Batcher(client_.get(), error_collector_, session_,
-                      external_consistency_mode_));
-      if (timeout_.Initialized()) {
-        batcher->SetTimeout(timeout_);
-      }
-      batcher.swap(batcher_);
-      ++batchers_num_;
+      NewBatcherUnlocked();
     }
     Status op_add_status = batcher_->Add(write_op);
     if (PREDICT_FALSE(!op_add_status.ok())) {
@@ -433,6 +621,7 @@ Status KuduSession::Data::ApplyWriteOp(KuduWriteOperation* write_op) {
     }
     // Finally, update the buffer space usage.
     buffer_bytes_used_ += required_size;
+    release_memory.cancel();
   }
 
   if (flush_mode == AUTO_FLUSH_BACKGROUND) {
@@ -449,6 +638,141 @@ Status KuduSession::Data::ApplyWriteOp(KuduWriteOperation* write_op) {
   return Status::OK();
 }
 
+Status KuduSession::Data::ApplyWriteOpConcurrently(KuduWriteOperation* write_op,
+                                                   int64_t required_size,
+                                                   FlushMode flush_mode) {
+  // The partition key is computed here rather than when the operation is
+  // moved into the batcher, to keep that work off the flushing thread.
+  string partition_key;
+  Status s = Batcher::GetPartitionKey(write_op, &partition_key);
+  if (PREDICT_FALSE(!s.ok())) {
+    error_collector_->AddError(gscoped_ptr<KuduError>(new KuduError(write_op, s)));
+    return s;
+  }
+
+  if (PREDICT_FALSE(!TryReserveBufferSpace(required_size))) {
+    if (flush_mode != AUTO_FLUSH_BACKGROUND) {
+      s = Status::Incomplete(Substitute(
+          "not enough mutation buffer space remaining for operation: "
+          "required additional $0 when $1 of $2 already used",
+          required_size, buffer_bytes_used_.load(), buffer_bytes_limit_));
+      error_collector_->AddError(gscoped_ptr<KuduError>(new KuduError(write_op, s)));
+      return s;
+    }
+    // As in ApplyWriteOp(), flush the freshly added operations if they take
+    // most of the buffer, and wait for the space to be freed. Other threads
+    // may buffer operations without signalling, so the wait is bounded.
+    while (true) {
+      FlushCurrentBatcher(buffer_bytes_limit_ - required_size + 1, nullptr);
+      std::lock_guard<Mutex> l(mutex_);
+      if (TryReserveBufferSpace(required_size)) {
+        break;
+      }
+      condition_.TimedWait(MonoDelta::FromMilliseconds(100));
+      if (TryReserveBufferSpace(required_size)) {
+        break;
+      }
+    }
+  }
+
+  apply_buffers_bytes_ += required_size;
+  ApplyBuffer& buf = apply_buffers_[ApplyBufferSlot() % num_apply_buffers_];
+  {
+    std::lock_guard<simple_spinlock> l(buf.lock);
+    buf.ops.push_back({ write_op, std::move(partition_key) });
+  }
+
+  if (flush_mode == AUTO_FLUSH_BACKGROUND) {
+    const int64_t flush_watermark = buffer_bytes_limit_ * buffer_watermark_pct_ / 100;
+    if (apply_buffers_bytes_ >= flush_watermark) {
+      FlushCurrentBatcher(flush_watermark, nullptr);
+    }
+  }
+  return Status::OK();
+}
+
+bool KuduSession::Data::TryReserveBufferSpace(int64_t size) {
+  int64_t used = buffer_bytes_used_.load(std::memory_order_relaxed);
+  do {
+    if (used + size > static_cast<int64_t>(buffer_bytes_limit_)) {
+      return false;
+    }
+  } while (!buffer_bytes_used_.compare_exchange_weak(used, used + size));
+  return true;
+}
+
+Status KuduSession::Data::ReserveClientMemory(int64_t size, FlushMode flush_mode) {
+  MemTracker* tracker = client_->data_->mem_tracker_.get();
+  if (PREDICT_FALSE(tracker->has_limit() && size > tracker->limit())) {
+    return Status::Incomplete(Substitute(
+        "client memory limit is too small to fit operation: "
+        "required $0, limit $1", size, tracker->limit()));
+  }
+  while (!tracker->TryConsume(size)) {
+    if (flush_mode != AUTO_FLUSH_BACKGROUND) {
+      return Status::Incomplete(Substitute(
+          "not enough client memory remaining for operation: "
+          "required additional $0 when $1 of $2 already used",
+          size, tracker->consumption(), tracker->limit()));
+    }
+    // The memory may be held by the freshly added operations of this session,
+    // so flush them. The other sessions don't signal this session when they
+    // free memory, so the wait is bounded.
+    FlushCurrentBatcher(kWatermarkNonEmptyBatcher, nullptr);
+    std::lock_guard<Mutex> l(mutex_);
+    condition_.TimedWait(MonoDelta::FromMilliseconds(100));
+  }
+  return Status::OK();
+}
+
+void KuduSession::Data::ReleaseClientMemory(int64_t size) {
+  client_->data_->mem_tracker_->Release(size);
+}
+
+void KuduSession::Data::NewBatcherUnlocked() {
+  mutex_.AssertAcquired();
+  DCHECK(!batcher_);
+  // Thread-safety note: the external_consistecy_mode_ and timeout_ms_
+  // are not supposed to be accessed or modified from any other thread
+  // no thread-safety is advertised for the kudu::KuduSession interface.
+  scoped_refptr<Batcher> batcher(
+      new Batcher(client_.get(), error_collector_, session_,
+                  external_consistency_mode_));
+  if (timeout_.Initialized()) {
+    batcher->SetTimeout(timeout_);
+  }
+  batcher.swap(batcher_);
+  ++batchers_num_;
+}
+
+void KuduSession::Data::MoveApplyBuffersToBatcherUnlocked() {
+  mutex_.AssertAcquired();
+  if (apply_buffers_bytes_ == 0) {
+    return;
+  }
+  if (!batcher_) {
+    // Don't wait for a batcher here: this may run on a reactor thread. The
+    // operations are moved once one of the pending batchers is done.
+    if (batchers_num_limit_ != 0 && batchers_num_ >= batchers_num_limit_) {
+      return;
+    }
+    NewBatcherUnlocked();
+  }
+  vector<BufferedOp> ops;
+  for (int i = 0; i < num_apply_buffers_; i++) {
+    {
+      std::lock_guard<simple_spinlock> l(apply_buffers_[i].lock);
+      ops.swap(apply_buffers_[i].ops);
+    }
+    for (BufferedOp& op : ops) {
+      const int64_t size = Batcher::GetOperationSizeInBuffer(op.write_op);
+      batcher_->Add(op.write_op, std::move(op.partition_key));
+      apply_buffers_bytes_ -= size;
+    }
+    ops.clear();
+  }
+}
+
 void KuduSession::Data::TimeBasedFlushInit() {
   KuduSession::Data::TimeBasedFlushTask(
       Status::OK(), messenger_, session_, true);
@@ -17,15 +17,22 @@
 #ifndef KUDU_CLIENT_SESSION_INTERNAL_H
 #define KUDU_CLIENT_SESSION_INTERNAL_H
 
+#include <atomic>
 #include <memory>
+#include <string>
+#include <vector>
 
 #include "kudu/client/client.h"
+#include "kudu/gutil/port.h"
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/util/condition_variable.h"
+#include "kudu/util/locks.h"
 #include "kudu/util/mutex.h"
 
 namespace kudu {
 
+class ColumnarInsertsPB;
+
 namespace rpc {
 class Messenger;
 } // namespace rpc
@@ -43,7 +50,8 @@ class ErrorCollector;
 // concurrent actions:
 //
 //  * calls to KuduSession::Apply():
-//    (there is at most one call at any moment, no concurrency is assumed here).
+//    (there is at most one call at any moment, unless concurrent apply
+//    is enabled: see ApplyWriteOpConcurrently()).
 //
 //  * activity of the time-based background flush task
 //    (there is at most one task running at any moment).
@@ -85,6 +93,9 @@ class KuduSession::Data {
   // Set the limit on maximum number of batchers with pending operations.
   Status SetMaxBatchersNum(unsigned int period_ms);
 
+  // Allow or disallow concurrent calls to ApplyWriteOp().
+  Status SetConcurrentApply(bool enable);
+
   // Set timeout for write operations, in milliseconds.
   void SetTimeoutMillis(int timeout_ms);
 
@@ -125,6 +136,42 @@ class KuduSession::Data {
   // Apply a write operation, i.e. push it through the batcher chain.
   Status ApplyWriteOp(KuduWriteOperation* write_op);
 
+  // Apply a write operation in concurrent apply mode: the operation is
+  // buffered in the calling thread's apply buffer, reserving its space in
+  // the shared buffer without holding mutex_, and is moved into the current
+  // batcher when the batcher is flushed.
+  Status ApplyWriteOpConcurrently(KuduWriteOperation* write_op,
+                                  int64_t required_size,
+                                  FlushMode flush_mode);
+
+  // Atomically add 'size' to buffer_bytes_used_ if the result doesn't
+  // exceed buffer_bytes_limit_. Returns whether the space was reserved.
+  bool TryReserveBufferSpace(int64_t size);
+
+  // Reserve 'size' bytes of the memory shared by all the sessions of the
+  // client for a buffered operation. In AUTO_FLUSH_BACKGROUND mode, waits
+  // for the flushes of this or the other sessions to free the memory;
+  // otherwise returns Status::Incomplete() right away.
+  Status ReserveClientMemory(int64_t size, FlushMode flush_mode);
+
+  // Return the memory of operations which never made it into a batcher to
+  // the client. Batchers release the memory of their operations themselves.
+  void ReleaseClientMemory(int64_t size);
+
+  // Create a new current batcher. Must be called with mutex_ held, when
+  // there isn't a current batcher.
+  void NewBatcherUnlocked();
+
+  // Move the operations of all of the apply buffers into the current batcher,
+  // creating the batcher if the limit on the number of batchers allows.
+  // Must be called with mutex_ held.
+  void MoveApplyBuffersToBatcherUnlocked();
+
+  // Split the columnar inserts 'rows' into 'table' by tablet, and apply
+  // the resulting chunks.
+  Status ApplyColumnarInserts(const sp::shared_ptr<KuduTable>& table,
+                              const std::shared_ptr<ColumnarInsertsPB>& rows);
+
   // Check and start the time-based flush task in background, if necessary.
   void TimeBasedFlushInit();
 
@@ -181,8 +228,9 @@ class KuduSession::Data {
   // Whether the flush task is active/scheduled.
   bool flush_task_active_; // protected by mutex_
 
-  // Current flush mode for the session's data.
-  FlushMode flush_mode_;  // protected by mutex_
+  // Current flush mode for the session's data. Modified under mutex_;
+  // atomic so that concurrent calls to Apply() may read it without the lock.
+  std::atomic<FlushMode> flush_mode_;
 
   // Mutex for the condition_ member (the condition variable).
   // This lock protects variables from simultaneous access:
@@ -200,6 +248,35 @@ class KuduSession::Data {
   // The current batcher being prepared.
   scoped_refptr<internal::Batcher> batcher_;// protected by mutex_
 
+  // An operation applied in concurrent apply mode, along with its
+  // partition key, which is computed by the applying thread.
+  struct BufferedOp {
+    KuduWriteOperation* write_op;
+    std::string partition_key;
+  };
+
+  // The operations applied by a group of threads in concurrent apply mode
+  // which are not yet in a batcher. Threads are assigned to apply buffers
+  // round-robin, so each thread always uses the same buffer, and operations
+  // from the same thread stay in order.
+  struct ApplyBuffer {
+    simple_spinlock lock;
+    std::vector<BufferedOp> ops;  // protected by lock
+  } CACHELINE_ALIGNED;
+
+  // Whether ApplyWriteOp() may be called concurrently. Only changed when
+  // there are no pending operations.
+  bool concurrent_apply_;
+
+  // Allocated when concurrent apply is first enabled: one buffer per CPU.
+  std::unique_ptr<ApplyBuffer[]> apply_buffers_;
+  int num_apply_buffers_;
+
+  // The total size of the operations in the apply buffers. This is
+  // an upper bound: the size is added before an operation is buffered
+  // and subtracted after it is moved into a batcher.
+  std::atomic<int64_t> apply_buffers_bytes_;
+
   // Total number of active batchers. Include the current batcher accumulating
   // the newly applied operations, and other batchers with not yet flushed
   // or flushed but not yet finished operations.
@@ -226,8 +303,11 @@ class KuduSession::Data {
   // kudu::KuduSession interface.
   int32_t buffer_watermark_pct_;
 
-  // The total number of bytes used by buffered write operations.
-  int64_t buffer_bytes_used_;  // protected by mutex_
+  // The total number of bytes used by buffered write operations, including
+  // those in the apply buffers. Modified under mutex_, except by
+  // TryReserveBufferSpace() in concurrent apply mode. Since that only ever
+  // increases it, waiting for it to decrease under mutex_ is still safe.
+  std::atomic<int64_t> buffer_bytes_used_;
 
  private:
   FRIEND_TEST(ClientTest, TestAutoFlushBackgroundApplyBlocks);
@@ -17,6 +17,10 @@
 #ifndef KUDU_CLIENT_WRITE_OP_INTERNAL_H
 #define KUDU_CLIENT_WRITE_OP_INTERNAL_H
 
+#include <memory>
+#include <string>
+#include <vector>
+
 #include "kudu/client/write_op.h"
 #include "kudu/common/wire_protocol.pb.h"
 
@@ -26,6 +30,68 @@ namespace client {
 
 RowOperationsPB_Type ToInternalWriteType(KuduWriteOperation::Type type);
 
+class KuduColumnarInsertBatch::Data {
+ public:
+  Data(sp::shared_ptr<KuduTable> table, int num_rows);
+
+  Status SetColumn(int col_idx, const Slice& data, const uint8_t* non_null_bitmap);
+
+  Status SetVarlenColumn(int col_idx, const uint32_t* offsets, const Slice& data,
+                         const uint8_t* non_null_bitmap);
+
+  const sp::shared_ptr<KuduTable> table_;
+
+  // Shared with the chunks which the batch is split into when it is applied.
+  std::shared_ptr<ColumnarInsertsPB> rows_;
+
+ private:
+  // Check that 'col_idx' is a column of the table, and that it may be given
+  // a non-null bitmap if 'non_null_bitmap' is set.
+  Status CheckColumn(int col_idx, const uint8_t* non_null_bitmap) const;
+
+  // Return the column 'col_idx' of rows_, cleared if it was already set.
+  ColumnarInsertsPB::Column* ResetColumn(int col_idx);
+
+  DISALLOW_COPY_AND_ASSIGN(Data);
+};
+
+namespace internal {
+
+// The rows of a columnar insert batch which belong to the same tablet.
+//
+// A chunk is buffered and flushed like a single insert, keyed by its first
+// row, and is encoded into the write request as a columnar run of inserts.
+class ColumnarInsertChunk : public KuduWriteOperation {
+ public:
+  ColumnarInsertChunk(const sp::shared_ptr<KuduTable>& table,
+                      std::shared_ptr<ColumnarInsertsPB> rows,
+                      std::vector<int> row_idxs,
+                      int64_t size_in_buffer);
+  virtual ~ColumnarInsertChunk();
+
+  virtual std::string ToString() const OVERRIDE;
+
+  const ColumnarInsertsPB& rows() const { return *rows_; }
+
+  // The indexes of the rows of the chunk within rows().
+  const std::vector<int>& row_idxs() const { return row_idxs_; }
+
+  // Create a standalone insert of the i-th row of the chunk, e.g. to report
+  // an error on that row.
+  KuduInsert* NewInsertForRow(int i) const;
+
+ protected:
+  virtual Type type() const OVERRIDE {
+    return INSERT;
+  }
+
+ private:
+  const std::shared_ptr<ColumnarInsertsPB> rows_;
+  const std::vector<int> row_idxs_;
+};
+
+} // namespace internal
+
 } // namespace client
 } // namespace kudu
 
@@ -17,15 +17,23 @@
 
 #include "kudu/client/write_op.h"
 
+#include <utility>
+
 #include "kudu/client/client.h"
+#include "kudu/client/write_op-internal.h"
 #include "kudu/common/encoded_key.h"
 #include "kudu/common/row.h"
+#include "kudu/common/row_operations.h"
 #include "kudu/common/wire_protocol.pb.h"
+#include "kudu/gutil/strings/substitute.h"
 
 namespace kudu {
 namespace client {
 
 using sp::shared_ptr;
+using std::string;
+using std::vector;
+using strings::Substitute;
 
 RowOperationsPB_Type ToInternalWriteType(KuduWriteOperation::Type type) {
   switch (type) {
@@ -118,6 +126,155 @@ KuduUpsert::KuduUpsert(const shared_ptr<KuduTable>& table)
 
 KuduUpsert::~KuduUpsert() {}
 
+// ColumnarInsertBatch ----------------------------------------------------------
+
+KuduColumnarInsertBatch::KuduColumnarInsertBatch(const shared_ptr<KuduTable>& table,
+                                                 int num_rows)
+  : data_(new KuduColumnarInsertBatch::Data(table, num_rows)) {
+}
+
+KuduColumnarInsertBatch::~KuduColumnarInsertBatch() {
+  delete data_;
+}
+
+int KuduColumnarInsertBatch::num_rows() const {
+  return data_->rows_->num_rows();
+}
+
+Status KuduColumnarInsertBatch::SetColumn(int col_idx, const Slice& data,
+                                          const uint8_t* non_null_bitmap) {
+  return data_->SetColumn(col_idx, data, non_null_bitmap);
+}
+
+Status KuduColumnarInsertBatch::SetVarlenColumn(int col_idx, const uint32_t* offsets,
+                                                const Slice& data,
+                                                const uint8_t* non_null_bitmap) {
+  return data_->SetVarlenColumn(col_idx, offsets, data, non_null_bitmap);
+}
+
+KuduColumnarInsertBatch::Data::Data(shared_ptr<KuduTable> table, int num_rows)
+  : table_(std::move(table)),
+    rows_(new ColumnarInsertsPB()) {
+  rows_->set_num_rows(num_rows);
+}
+
+Status KuduColumnarInsertBatch::Data::CheckColumn(int col_idx,
+                                                  const uint8_t* non_null_bitmap) const {
+  const Schema* schema = table_->schema().schema_;
+  if (col_idx < 0 || col_idx >= schema->num_columns()) {
+    return Status::InvalidArgument(Substitute("column index $0 out of range", col_idx));
+  }
+  if (non_null_bitmap && !schema->column(col_idx).is_nullable()) {
+    return Status::InvalidArgument("NULL values given for non-nullable column",
+                                   schema->column(col_idx).name());
+  }
+  return Status::OK();
+}
+
+ColumnarInsertsPB::Column* KuduColumnarInsertBatch::Data::ResetColumn(int col_idx) {
+  for (auto& c : *rows_->mutable_columns()) {
+    if (c.column_idx() == col_idx) {
+      c.Clear();
+      c.set_column_idx(col_idx);
+      return &c;
+    }
+  }
+  ColumnarInsertsPB::Column* col_pb = rows_->add_columns();
+  col_pb->set_column_idx(col_idx);
+  return col_pb;
+}
+
+Status KuduColumnarInsertBatch::Data::SetColumn(int col_idx, const Slice& data,
+                                                const uint8_t* non_null_bitmap) {
+  RETURN_NOT_OK(CheckColumn(col_idx, non_null_bitmap));
+  const ColumnSchema& col = table_->schema().schema_->column(col_idx);
+  if (col.type_info()->physical_type() == BINARY) {
+    return Status::InvalidArgument("variable-length column must be set with SetVarlenColumn",
+                                   col.name());
+  }
+  size_t expected_size = rows_->num_rows() * col.type_info()->size();
+  if (data.size() != expected_size) {
+    return Status::InvalidArgument(
+        Substitute("$0 bytes of data given for column $1, expected $2",
+                   data.size(), col.name(), expected_size));
+  }
+
+  ColumnarInsertsPB::Column* col_pb = ResetColumn(col_idx);
+  col_pb->set_data(data.data(), data.size());
+  if (non_null_bitmap) {
+    col_pb->set_non_null_bitmap(non_null_bitmap, BitmapSize(rows_->num_rows()));
+  }
+  return Status::OK();
+}
+
+Status KuduColumnarInsertBatch::Data::SetVarlenColumn(int col_idx, const uint32_t* offsets,
+                                                      const Slice& data,
+                                                      const uint8_t* non_null_bitmap) {
+  RETURN_NOT_OK(CheckColumn(col_idx, non_null_bitmap));
+  const ColumnSchema& col = table_->schema().schema_->column(col_idx);
+  if (col.type_info()->physical_type() != BINARY) {
+    return Status::InvalidArgument("fixed-size column must be set with SetColumn",
+                                   col.name());
+  }
+  const int num_rows = rows_->num_rows();
+  for (int i = 0; i < num_rows; i++) {
+    if (offsets[i] > offsets[i + 1]) {
+      return Status::InvalidArgument(
+          Substitute("offsets of column $0 decrease at row $1", col.name(), i));
+    }
+  }
+  if (offsets[num_rows] > data.size()) {
+    return Status::InvalidArgument(
+        Substitute("offsets of column $0 are past the end of its data", col.name()));
+  }
+
+  // Store the offsets relative to the first value, so that only the data
+  // which is referenced is copied.
+  ColumnarInsertsPB::Column* col_pb = ResetColumn(col_idx);
+  string* dst_offsets = col_pb->mutable_data();
+  dst_offsets->resize((num_rows + 1) * sizeof(uint32_t));
+  uint32_t* dst = reinterpret_cast<uint32_t*>(&(*dst_offsets)[0]);
+  for (int i = 0; i <= num_rows; i++) {
+    dst[i] = offsets[i] - offsets[0];
+  }
+  col_pb->set_varlen_data(data.data() + offsets[0], offsets[num_rows] - offsets[0]);
+  if (non_null_bitmap) {
+    col_pb->set_non_null_bitmap(non_null_bitmap, BitmapSize(num_rows));
+  }
+  return Status::OK();
+}
+
+namespace internal {
+
+ColumnarInsertChunk::ColumnarInsertChunk(const shared_ptr<KuduTable>& table,
+                                         std::shared_ptr<ColumnarInsertsPB> rows,
+                                         vector<int> row_idxs,
+                                         int64_t size_in_buffer)
+  : KuduWriteOperation(table),
+    rows_(std::move(rows)),
+    row_idxs_(std::move(row_idxs)) {
+  DCHECK(!row_idxs_.empty());
+  // The chunk is keyed by its first row.
+  CHECK_OK(RowOperationsPBDecoder::DecodeColumnarInsertRow(*rows_, row_idxs_[0], true, &row_));
+  size_in_buffer_ = size_in_buffer;
+}
+
+ColumnarInsertChunk::~ColumnarInsertChunk() {}
+
+string ColumnarInsertChunk::ToString() const {
+  return Substitute("INSERT $0 columnar rows, starting with $1",
+                    row_idxs_.size(), row_.ToString());
+}
+
+KuduInsert* ColumnarInsertChunk::NewInsertForRow(int i) const {
+  KuduInsert* insert = table_->NewInsert();
+  CHECK_OK(RowOperationsPBDecoder::DecodeColumnarInsertRow(*rows_, row_idxs_[i], false,
+                                                           insert->mutable_row()));
+  return insert;
+}
+
+} // namespace internal
+
 
 } // namespace client
 } // namespace kudu
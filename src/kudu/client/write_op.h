@@ -25,12 +25,14 @@
 
 namespace kudu {
 
+class ColumnarInsertsPB;
 class EncodedKey;
 
 namespace client {
 
 namespace internal {
 class Batcher;
+class ColumnarInsertChunk;
 class WriteRpc;
 } // namespace internal
 
@@ -99,6 +101,7 @@ class KUDU_EXPORT KuduWriteOperation {
 
  private:
   friend class internal::Batcher;
+  friend class internal::ColumnarInsertChunk;
   friend class internal::WriteRpc;
 
   // Create and encode the key for this write (key must be set)
@@ -224,6 +227,70 @@ class KUDU_EXPORT KuduDelete : public KuduWriteOperation {
   explicit KuduDelete(const sp::shared_ptr<KuduTable>& table);
 };
 
+/// @brief A batch of inserts into a table, given one column at a time.
+///
+/// Setting the values of whole columns avoids building and encoding
+/// a KuduPartialRow for every row, and the rows are sent to the tablet
+/// servers in the same columnar layout. Set the values of each column
+/// to insert, then pass the batch to KuduSession::ApplyColumnarInserts().
+/// Columns which are not set get their default values, or NULL, as when
+/// they are not set on a KuduInsert. All of the key columns must be set.
+///
+/// @note Columnar inserts require tablet servers which support them;
+///   writes to older tablet servers fail with a "not supported" error.
+class KUDU_EXPORT KuduColumnarInsertBatch {
+ public:
+  ~KuduColumnarInsertBatch();
+
+  /// @return Number of rows in the batch.
+  int num_rows() const;
+
+  /// Set the values of a fixed-size column.
+  ///
+  /// @param [in] col_idx
+  ///   Index of the column in the table schema.
+  /// @param [in] data
+  ///   The values of the column for each of the rows, one after another,
+  ///   in the in-memory representation of the column type: e.g. int32_t
+  ///   values for an INT32 column, and int64_t microseconds for
+  ///   a UNIXTIME_MICROS column. The data is copied.
+  /// @param [in] non_null_bitmap
+  ///   Optional bitmap of num_rows() bits, in which a cleared bit marks
+  ///   the value of the corresponding row as NULL. Only allowed for
+  ///   nullable columns. If not given, none of the values are NULL.
+  /// @return Operation result status.
+  Status SetColumn(int col_idx, const Slice& data,
+                   const uint8_t* non_null_bitmap = NULL) WARN_UNUSED_RESULT;
+
+  /// Set the values of a STRING or BINARY column.
+  ///
+  /// @param [in] col_idx
+  ///   Index of the column in the table schema.
+  /// @param [in] offsets
+  ///   num_rows() + 1 offsets into 'data': the value of row i is
+  ///   data[offsets[i], offsets[i + 1]).
+  /// @param [in] data
+  ///   The concatenated values of the column. The data is copied.
+  /// @param [in] non_null_bitmap
+  ///   Same as for SetColumn().
+  /// @return Operation result status.
+  Status SetVarlenColumn(int col_idx, const uint32_t* offsets, const Slice& data,
+                         const uint8_t* non_null_bitmap = NULL) WARN_UNUSED_RESULT;
+
+ private:
+  class KUDU_NO_EXPORT Data;
+
+  friend class KuduSession;
+  friend class KuduTable;
+
+  KuduColumnarInsertBatch(const sp::shared_ptr<KuduTable>& table, int num_rows);
+
+  // Owned.
+  Data* data_;
+
+  DISALLOW_COPY_AND_ASSIGN(KuduColumnarInsertBatch);
+};
+
 } // namespace client
 } // namespace kudu
 
@@ -21,6 +21,7 @@
 #include <cctype>
 #include <sstream>
 #include <string>
+#include <vector>
 
 #include <glog/logging.h>
 #include <llvm/ADT/StringRef.h>
@@ -41,6 +42,7 @@
 
 #include "kudu/codegen/jit_wrapper.h"
 #include "kudu/codegen/module_builder.h"
+#include "kudu/codegen/row_predicate.h"
 #include "kudu/codegen/row_projector.h"
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/macros.h"
@@ -81,6 +83,7 @@ using llvm::Target;
 using llvm::TargetMachine;
 using llvm::Triple;
 using std::string;
+using std::vector;
 
 namespace kudu {
 
@@ -229,5 +232,25 @@ Status CodeGenerator::CompileRowProjector(const Schema& base, const Schema& proj
   return Status::OK();
 }
 
+Status CodeGenerator::CompileRowPredicate(const Schema& base,
+                                          const vector<RowPredicateShape>& shapes,
+                                          scoped_refptr<RowPredicateFunctions>* out) {
+  RETURN_NOT_OK(CheckCodegenEnabled());
+
+  TargetMachine* tm;
+  RETURN_NOT_OK(RowPredicateFunctions::Create(base, shapes, out, &tm));
+
+  if (FLAGS_codegen_dump_mc) {
+    static const int kInstrMax = 500;
+    std::ostringstream sstr;
+    sstr << "Printing row predicate function:\n";
+    int instrs = DumpAsm((*out)->evaluate(), *tm, &sstr, kInstrMax);
+    sstr << "Printed " << instrs << " instructions.";
+    LOG(INFO) << sstr.str();
+  }
+
+  return Status::OK();
+}
+
 } // namespace codegen
 } // namespace kudu
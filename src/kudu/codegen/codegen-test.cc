@@ -25,7 +25,9 @@
 
 #include "kudu/codegen/code_generator.h"
 #include "kudu/codegen/compilation_manager.h"
+#include "kudu/codegen/row_predicate.h"
 #include "kudu/codegen/row_projector.h"
+#include "kudu/common/column_predicate.h"
 #include "kudu/common/row.h"
 #include "kudu/common/rowblock.h"
 #include "kudu/common/schema.h"
@@ -126,6 +128,20 @@ class CodegenTest : public KuduTest {
   Status CreatePartialSchema(const vector<size_t>& col_indexes,
                              Schema* out);
 
+  // Compares the code-generated evaluation of the conjunction of 'preds'
+  // with ColumnPredicate::EvaluateCell() on each test row.
+  void TestPredicates(const vector<ColumnPredicate>& preds);
+
+  // Returns the value of the non-null int32 column in the given test row.
+  int32_t TestRowInt32(int row) const {
+    return *reinterpret_cast<const int32_t*>(test_rows_[row]->cell_ptr(kI32Col));
+  }
+
+  // Returns the raw data of the given test row.
+  const uint8_t* TestRowData(int row) const {
+    return test_rows_[row]->row_data();
+  }
+
  private:
   // Projects the test rows into parameter rowblock using projector and
   // member projections_arena_ (should be Reset() manually).
@@ -235,6 +251,31 @@ Status CodegenTest::CreatePartialSchema(const vector<size_t>& col_indexes,
   return defaults_.CreateProjectionByIdsIgnoreMissing(col_ids, out);
 }
 
+void CodegenTest::TestPredicates(const vector<ColumnPredicate>& preds) {
+  SCOPED_TRACE(preds.size() == 1 ? preds[0].ToString() : "conjunction");
+  vector<codegen::RowPredicateShape> shapes;
+  ASSERT_OK(codegen::RowPredicateFunctions::GetShapes(base_, preds, &shapes));
+  scoped_refptr<codegen::RowPredicateFunctions> functions;
+  ASSERT_OK(generator_.CompileRowPredicate(base_, shapes, &functions));
+  codegen::RowPredicateEvaluator evaluator(&base_, preds, functions);
+
+  for (int i = 0; i < kNumTestRows; ++i) {
+    const ConstContiguousRow& row = *test_rows_[i];
+    bool expected = true;
+    for (const ColumnPredicate& pred : preds) {
+      int col_idx = base_.find_column(pred.column().name());
+      if (base_.column(col_idx).is_nullable() && row.is_null(col_idx)) {
+        expected = false;
+      } else if (base_.column(col_idx).type_info()->physical_type() == UINT64) {
+        expected &= pred.EvaluateCell<UINT64>(row.cell_ptr(col_idx));
+      } else {
+        expected &= pred.EvaluateCell<INT32>(row.cell_ptr(col_idx));
+      }
+    }
+    EXPECT_EQ(expected, evaluator.Evaluate(row.row_data())) << "row " << i;
+  }
+}
+
 TEST_F(CodegenTest, ObservablesTest) {
   // Test when not identity
   Schema proj = base_.CreateKeyProjection();
@@ -365,6 +406,63 @@ TEST_F(CodegenTest, TestDumpMC) {
   EXPECT_THAT(msgs[0], testing::ContainsRegex("retq"));
 }
 
+TEST_F(CodegenTest, TestRowPredicates) {
+  const ColumnSchema& key_col = base_.column(kKeyCol);
+  const ColumnSchema& i32_col = base_.column(kI32Col);
+  const ColumnSchema& i32_null_val_col = base_.column(kI32NullValCol);
+  const ColumnSchema& i32_null_col = base_.column(kI32NullCol);
+
+  uint64_t key_lower = 3;
+  uint64_t key_upper = 7;
+  int32_t zero = 0;
+  int32_t first = TestRowInt32(0);
+  int32_t second = TestRowInt32(1);
+  int32_t third = TestRowInt32(2);
+
+  TestPredicates({ ColumnPredicate::Range(key_col, &key_lower, &key_upper) });
+  TestPredicates({ ColumnPredicate::Range(key_col, &key_lower, nullptr) });
+  TestPredicates({ ColumnPredicate::Range(key_col, nullptr, &key_upper) });
+  TestPredicates({ ColumnPredicate::Range(i32_col, &zero, nullptr) });
+  TestPredicates({ ColumnPredicate::Range(i32_col, nullptr, &zero) });
+  TestPredicates({ ColumnPredicate::Equality(i32_col, &first) });
+  vector<const void*> values = { &first, &second, &third };
+  TestPredicates({ ColumnPredicate::InList(i32_col, &values) });
+  TestPredicates({ ColumnPredicate::IsNotNull(i32_null_val_col) });
+  TestPredicates({ ColumnPredicate::IsNotNull(i32_null_col) });
+  TestPredicates({ ColumnPredicate::Range(i32_null_val_col, &zero, nullptr) });
+  TestPredicates({ ColumnPredicate::Range(i32_null_col, nullptr, &zero) });
+  TestPredicates({ ColumnPredicate::Range(key_col, &key_lower, &key_upper),
+                   ColumnPredicate::Range(i32_col, &zero, nullptr),
+                   ColumnPredicate::IsNotNull(i32_null_val_col) });
+
+  // Predicates on columns we can't generate code for are refused.
+  Slice str("a");
+  vector<codegen::RowPredicateShape> shapes;
+  ASSERT_TRUE(codegen::RowPredicateFunctions::GetShapes(
+      base_, { ColumnPredicate::Equality(base_.column(kStrCol), &str) },
+      &shapes).IsNotSupported());
+}
+
+// Tests that the CompilationManager caches row predicates by their shape
+// only, so that predicates with different values share the compiled code.
+TEST_F(CodegenTest, TestRowPredicateCache) {
+  Singleton<CompilationManager>::UnsafeReset();
+  CompilationManager* cm = CompilationManager::GetSingleton();
+  const ColumnSchema& i32_col = base_.column(kI32Col);
+  int32_t zero = 0;
+  int32_t first = TestRowInt32(0);
+
+  gscoped_ptr<codegen::RowPredicateEvaluator> evaluator;
+  ASSERT_FALSE(cm->RequestRowPredicateEvaluator(
+      &base_, { ColumnPredicate::Range(i32_col, &zero, nullptr) }, &evaluator));
+  cm->Wait();
+  ASSERT_TRUE(cm->RequestRowPredicateEvaluator(
+      &base_, { ColumnPredicate::Range(i32_col, &first, nullptr) }, &evaluator));
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_EQ(TestRowInt32(i) >= first, evaluator->Evaluate(TestRowData(i)));
+  }
+}
+
 // Basic test for the CompilationManager code cache.
 // This runs a bunch of compilation tasks and ensures that the cache
 // sometimes hits on the second attempt for the same projection.
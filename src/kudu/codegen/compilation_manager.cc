@@ -27,7 +27,9 @@
 #include "kudu/codegen/code_cache.h"
 #include "kudu/codegen/code_generator.h"
 #include "kudu/codegen/jit_wrapper.h"
+#include "kudu/codegen/row_predicate.h"
 #include "kudu/codegen/row_projector.h"
+#include "kudu/common/column_predicate.h"
 #include "kudu/common/schema.h"
 #include "kudu/gutil/casts.h"
 #include "kudu/gutil/gscoped_ptr.h"
@@ -43,6 +45,7 @@
 #include "kudu/util/threadpool.h"
 
 using std::shared_ptr;
+using std::vector;
 
 DEFINE_bool(codegen_time_compilation, false, "Whether to print time that each code "
             "generation request took.");
@@ -119,6 +122,46 @@ class CompilationTask : public Runnable {
   DISALLOW_COPY_AND_ASSIGN(CompilationTask);
 };
 
+// Like CompilationTask, but generates a row predicate evaluation function
+// for a base schema and a set of predicate shapes.
+class RowPredicateCompilationTask : public Runnable {
+ public:
+  RowPredicateCompilationTask(const Schema& base, vector<RowPredicateShape> shapes,
+                              CodeCache* cache, CodeGenerator* generator)
+    : base_(base),
+      shapes_(std::move(shapes)),
+      cache_(cache),
+      generator_(generator) {}
+
+  void Run() override {
+    WARN_NOT_OK(RunWithStatus(),
+                "Failed compilation of row predicate over base schema " +
+                base_.ToString());
+  }
+
+ private:
+  Status RunWithStatus() {
+    faststring key;
+    RETURN_NOT_OK(RowPredicateFunctions::EncodeKey(base_, shapes_, &key));
+    if (cache_->Lookup(key)) return Status::OK();
+
+    scoped_refptr<RowPredicateFunctions> functions;
+    LOG_TIMING_IF(INFO, FLAGS_codegen_time_compilation, "code-generating row predicate") {
+      RETURN_NOT_OK(generator_->CompileRowPredicate(base_, shapes_, &functions));
+    }
+
+    RETURN_NOT_OK(cache_->AddEntry(functions));
+    return Status::OK();
+  }
+
+  Schema base_;
+  const vector<RowPredicateShape> shapes_;
+  CodeCache* const cache_;
+  CodeGenerator* const generator_;
+
+  DISALLOW_COPY_AND_ASSIGN(RowPredicateCompilationTask);
+};
+
 } // anonymous namespace
 
 CompilationManager::CompilationManager()
@@ -196,5 +239,36 @@ bool CompilationManager::RequestRowProjector(const Schema* base_schema,
   return true;
 }
 
+bool CompilationManager::RequestRowPredicateEvaluator(
+    const Schema* base_schema,
+    const vector<ColumnPredicate>& predicates,
+    gscoped_ptr<RowPredicateEvaluator>* out) {
+  vector<RowPredicateShape> shapes;
+  if (!RowPredicateFunctions::GetShapes(*base_schema, predicates, &shapes).ok()) {
+    return false;
+  }
+  faststring key;
+  Status s = RowPredicateFunctions::EncodeKey(*base_schema, shapes, &key);
+  WARN_NOT_OK(s, "RowPredicateEvaluator compilation request failed");
+  if (!s.ok()) return false;
+  query_counter_.Increment();
+
+  scoped_refptr<RowPredicateFunctions> cached(
+    down_cast<RowPredicateFunctions*>(cache_.Lookup(key).get()));
+
+  if (!cached) {
+    shared_ptr<Runnable> task(new RowPredicateCompilationTask(
+        *base_schema, std::move(shapes), &cache_, &generator_));
+    WARN_NOT_OK(pool_->Submit(task),
+                "RowPredicateEvaluator compilation request failed");
+    return false;
+  }
+
+  hit_counter_.Increment();
+
+  out->reset(new RowPredicateEvaluator(base_schema, predicates, cached));
+  return true;
+}
+
 } // namespace codegen
 } // namespace kudu
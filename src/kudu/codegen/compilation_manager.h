@@ -18,6 +18,8 @@
 #ifndef KUDU_CODEGEN_COMPILATION_MANAGER_H
 #define KUDU_CODEGEN_COMPILATION_MANAGER_H
 
+#include <vector>
+
 #include "kudu/codegen/code_generator.h"
 #include "kudu/codegen/code_cache.h"
 #include "kudu/gutil/gscoped_ptr.h"
@@ -28,6 +30,7 @@
 
 namespace kudu {
 
+class ColumnPredicate;
 class Counter;
 class MetricEntity;
 class MetricRegistry;
@@ -35,6 +38,7 @@ class ThreadPool;
 
 namespace codegen {
 
+class RowPredicateEvaluator;
 class RowProjector;
 
 // The compilation manager is a top-level class which manages the actual
@@ -76,6 +80,14 @@ class CompilationManager {
                            const Schema* projection,
                            gscoped_ptr<RowProjector>* out);
 
+  // Same as RequestRowProjector(), but for an evaluator of the conjunction
+  // of 'predicates' over contiguous rows of 'base_schema'. Requests for
+  // predicates that can't be code-generated return false without enqueuing
+  // anything. The predicates needn't outlive the request or the evaluator.
+  bool RequestRowPredicateEvaluator(const Schema* base_schema,
+                                    const std::vector<ColumnPredicate>& predicates,
+                                    gscoped_ptr<RowPredicateEvaluator>* out);
+
   // Waits for all asynchronous compilation tasks to finish.
   void Wait();
 
@@ -0,0 +1,405 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/codegen/row_predicate.h"
+
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <llvm/ExecutionEngine/ExecutionEngine.h>
+#include <llvm/IR/Argument.h>
+#include <llvm/IR/BasicBlock.h>
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IR/Type.h>
+
+#include "kudu/codegen/jit_wrapper.h"
+#include "kudu/codegen/module_builder.h"
+#include "kudu/common/schema.h"
+#include "kudu/common/types.h"
+#include "kudu/gutil/strings/strcat.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/faststring.h"
+#include "kudu/util/slice.h"
+#include "kudu/util/status.h"
+
+using llvm::Argument;
+using llvm::BasicBlock;
+using llvm::Function;
+using llvm::FunctionType;
+using llvm::LLVMContext;
+using llvm::PointerType;
+using llvm::Type;
+using llvm::Value;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+using strings::Substitute;
+
+DECLARE_bool(codegen_dump_functions);
+
+namespace kudu {
+namespace codegen {
+
+namespace {
+
+// Returns whether values of the given physical type are compared as signed
+// integers, or false for unsigned ones. Requires IsSupportedType().
+bool IsSigned(DataType type) {
+  switch (type) {
+    case INT8:
+    case INT16:
+    case INT32:
+    case INT64:
+      return true;
+    default:
+      return false;
+  }
+}
+
+bool IsSupportedType(DataType type) {
+  switch (type) {
+    case UINT8:
+    case INT8:
+    case UINT16:
+    case INT16:
+    case UINT32:
+    case INT32:
+    case UINT64:
+    case INT64:
+    case BOOL:
+      return true;
+    default:
+      return false;
+  }
+}
+
+// Generates a row predicate evaluation function of the form:
+// bool(const int8_t* row, const void* const* operands)
+// Requires row is a contiguous row of the base schema.
+//
+// Evaluation function in IR (note: values in angle brackets are constants
+// whose values are determined right now, at JIT time).
+//
+// define i1 @name(i8* noalias %row, i8** noalias %operands)
+// entry:
+//   br label %pred0
+// <for each predicate>
+//   pred<i>:
+//     <if the column is nullable>
+//       %null_byte = load i8* getelementptr(i8* %row, i64 <bitmap byte offset>)
+//       %null_bit = and i8 %null_byte, <bitmap mask>
+//       %is_null = icmp ne i8 %null_bit, 0
+//       br i1 %is_null, label %fail, label %pred<i>_notnull
+//     <end implicit if>
+//   pred<i>_notnull:
+//     %cell = load iN* bitcast(getelementptr(i8* %row, i64 <column offset>))
+//     <for each operand j the predicate compares against>
+//       %operand = load iN* bitcast(load i8** getelementptr(%operands, i64 <j>))
+//       %match = icmp <comparison> iN %cell, %operand
+//       br i1 %match, label <next comparison or predicate>, label %fail
+//     <end implicit for each>
+// <end implicit for each>
+//   pass:
+//     ret i1 true
+//   fail:
+//     ret i1 false
+//
+// An InList predicate instead branches to the next predicate on the first
+// operand that matches, and to %fail if none does.
+llvm::Function* MakeEvaluation(const string& name,
+                               ModuleBuilder* mbuilder,
+                               const Schema& base_schema,
+                               const vector<RowPredicateShape>& shapes) {
+  ModuleBuilder::LLVMBuilder* builder = mbuilder->builder();
+  LLVMContext& context = builder->getContext();
+
+  Type* i8_ptr = Type::getInt8PtrTy(context);
+  vector<Type*> argtypes = { i8_ptr, PointerType::getUnqual(i8_ptr) };
+  FunctionType* fty = FunctionType::get(Type::getInt1Ty(context), argtypes, false);
+  Function* f = mbuilder->Create(fty, name);
+
+  Function::arg_iterator it = f->arg_begin();
+  Argument* row = &*it++;
+  Argument* operands = &*it++;
+  DCHECK(it == f->arg_end());
+  row->setName("row");
+  operands->setName("operands");
+  f->setDoesNotAlias(1);
+  f->setDoesNotAlias(2);
+
+  BasicBlock* entry = BasicBlock::Create(context, "entry", f);
+  BasicBlock* fail = BasicBlock::Create(context, "fail", f);
+  builder->SetInsertPoint(fail);
+  builder->CreateRet(builder->getInt1(false));
+
+  builder->SetInsertPoint(entry);
+  int operand_idx = 0;
+  for (int i = 0; i < shapes.size(); i++) {
+    const RowPredicateShape& shape = shapes[i];
+    const ColumnSchema& col = base_schema.column(shape.col_idx);
+
+    // Rows with a null cell never match.
+    if (col.is_nullable()) {
+      size_t bitmap_byte = base_schema.byte_size() + shape.col_idx / 8;
+      Value* null_byte = builder->CreateLoad(builder->CreateConstGEP1_64(row, bitmap_byte));
+      Value* null_bit = builder->CreateAnd(null_byte, builder->getInt8(1 << (shape.col_idx % 8)));
+      Value* is_null = builder->CreateICmpNE(null_bit, builder->getInt8(0));
+      is_null->setName(StrCat("is_null_", shape.col_idx));
+      BasicBlock* not_null = BasicBlock::Create(context, StrCat("pred", i, "_notnull"), f);
+      builder->CreateCondBr(is_null, fail, not_null);
+      builder->SetInsertPoint(not_null);
+    }
+    if (shape.type == PredicateType::IsNotNull) {
+      continue;
+    }
+
+    Type* cell_type = Type::getIntNTy(context, col.type_info()->size() * 8);
+    Type* cell_ptr_type = PointerType::getUnqual(cell_type);
+    Value* cell_ptr = builder->CreateBitCast(
+        builder->CreateConstGEP1_64(row, base_schema.column_offset(shape.col_idx)),
+        cell_ptr_type);
+    Value* cell = builder->CreateLoad(cell_ptr);
+    cell->setName(StrCat("cell_", shape.col_idx));
+    bool is_signed = IsSigned(col.type_info()->physical_type());
+
+    auto load_operand = [&]() {
+      Value* operand_ptr = builder->CreateLoad(
+          builder->CreateConstGEP1_64(operands, operand_idx++));
+      return builder->CreateLoad(builder->CreateBitCast(operand_ptr, cell_ptr_type));
+    };
+    // Branches to a new block if 'match', or to %fail otherwise.
+    auto check = [&](Value* match) {
+      BasicBlock* next = BasicBlock::Create(context, StrCat("pred", i, "_op", operand_idx), f);
+      builder->CreateCondBr(match, next, fail);
+      builder->SetInsertPoint(next);
+    };
+
+    switch (shape.type) {
+      case PredicateType::Equality:
+        check(builder->CreateICmpEQ(cell, load_operand()));
+        break;
+      case PredicateType::Range:
+        if (shape.has_lower) {
+          Value* lower = load_operand();
+          check(is_signed ? builder->CreateICmpSGE(cell, lower)
+                          : builder->CreateICmpUGE(cell, lower));
+        }
+        if (shape.has_upper) {
+          Value* upper = load_operand();
+          check(is_signed ? builder->CreateICmpSLT(cell, upper)
+                          : builder->CreateICmpULT(cell, upper));
+        }
+        break;
+      case PredicateType::InList: {
+        BasicBlock* matched = BasicBlock::Create(context, StrCat("pred", i, "_matched"), f);
+        for (size_t v = 0; v < shape.num_values; v++) {
+          BasicBlock* next = BasicBlock::Create(context, StrCat("pred", i, "_op", operand_idx), f);
+          builder->CreateCondBr(builder->CreateICmpEQ(cell, load_operand()), matched, next);
+          builder->SetInsertPoint(next);
+        }
+        builder->CreateBr(fail);
+        builder->SetInsertPoint(matched);
+        break;
+      }
+      default:
+        LOG(FATAL) << "unsupported predicate type";
+    }
+  }
+  builder->CreateRet(builder->getInt1(true));
+
+  if (FLAGS_codegen_dump_functions) {
+    LOG(INFO) << "Dumping row predicate evaluation:";
+    f->dump();
+  }
+
+  return f;
+}
+
+// Convenience method which appends to a faststring
+template<typename T>
+void AddNext(faststring* fs, const T& val) {
+  fs->append(&val, sizeof(T));
+}
+
+} // anonymous namespace
+
+RowPredicateFunctions::RowPredicateFunctions(const Schema& base_schema,
+                                             vector<RowPredicateShape> shapes,
+                                             EvaluationFunction evaluate_f,
+                                             unique_ptr<JITCodeOwner> owner)
+  : JITWrapper(std::move(owner)),
+    base_schema_(base_schema),
+    shapes_(std::move(shapes)),
+    evaluate_f_(evaluate_f) {
+  CHECK(evaluate_f != nullptr)
+    << "Promise to compile evaluation function not fulfilled by ModuleBuilder";
+}
+
+Status RowPredicateFunctions::Create(const Schema& base_schema,
+                                     const vector<RowPredicateShape>& shapes,
+                                     scoped_refptr<RowPredicateFunctions>* out,
+                                     llvm::TargetMachine** tm) {
+  ModuleBuilder builder;
+  RETURN_NOT_OK(builder.Init());
+
+  Function* evaluate = MakeEvaluation("RowPredicate", &builder, base_schema, shapes);
+  EvaluationFunction evaluate_f;
+  builder.AddJITPromise(evaluate, &evaluate_f);
+
+  unique_ptr<JITCodeOwner> owner;
+  RETURN_NOT_OK(builder.Compile(&owner));
+
+  if (tm) {
+    *tm = builder.GetTargetMachine();
+  }
+  out->reset(new RowPredicateFunctions(base_schema, shapes, evaluate_f, std::move(owner)));
+  return Status::OK();
+}
+
+Status RowPredicateFunctions::GetShapes(const Schema& base,
+                                        const vector<ColumnPredicate>& predicates,
+                                        vector<RowPredicateShape>* shapes) {
+  shapes->clear();
+  for (const ColumnPredicate& pred : predicates) {
+    int col_idx = base.find_column(pred.column().name());
+    if (col_idx == Schema::kColumnNotFound) {
+      return Status::InvalidArgument("No such column", pred.column().name());
+    }
+    const ColumnSchema& col = base.column(col_idx);
+    if (!IsSupportedType(col.type_info()->physical_type())) {
+      return Status::NotSupported(Substitute("cannot generate code for predicate $0 on $1",
+                                             pred.ToString(), col.ToString()));
+    }
+    RowPredicateShape shape;
+    shape.col_idx = col_idx;
+    shape.type = pred.predicate_type();
+    shape.has_lower = false;
+    shape.has_upper = false;
+    shape.num_values = 0;
+    switch (pred.predicate_type()) {
+      case PredicateType::Equality:
+      case PredicateType::IsNotNull:
+        break;
+      case PredicateType::Range:
+        shape.has_lower = pred.raw_lower() != nullptr;
+        shape.has_upper = pred.raw_upper() != nullptr;
+        break;
+      case PredicateType::InList:
+        shape.num_values = pred.raw_values().size();
+        break;
+      default:
+        return Status::NotSupported("cannot generate code for predicate", pred.ToString());
+    }
+    shapes->push_back(shape);
+  }
+  return Status::OK();
+}
+
+// Generates a key for a base schema and a set of predicate shapes. The key
+// is unique according to the criteria defined in the CodeCache class' block
+// comment. It consists of, in sequence:
+//
+// (1 byte) unique type identifier for RowPredicateFunctions
+// (8 bytes) byte size, as unsigned long, of the base schema's rows
+// (8 bytes) number, as unsigned long, of predicates
+// (for each predicate, in order)
+//   8 bytes for the column index, which locates the null bit
+//   8 bytes for the column offset
+//   4 bytes for the column's physical type
+//   1 byte for nullability
+//   4 bytes for the predicate type
+//   1 byte each for the presence of lower and upper bounds
+//   8 bytes for the number of InList values
+//
+// The operand values aren't part of the key, since they're passed in at
+// evaluation time.
+Status RowPredicateFunctions::EncodeKey(const Schema& base,
+                                        const vector<RowPredicateShape>& shapes,
+                                        faststring* out) {
+  AddNext(out, JITWrapper::ROW_PREDICATE);
+  AddNext(out, base.byte_size());
+  AddNext(out, shapes.size());
+  for (const RowPredicateShape& shape : shapes) {
+    if (shape.col_idx >= base.num_columns()) {
+      return Status::InvalidArgument("predicate column index out of range");
+    }
+    const ColumnSchema& col = base.column(shape.col_idx);
+    AddNext(out, shape.col_idx);
+    AddNext(out, base.column_offset(shape.col_idx));
+    AddNext(out, col.type_info()->physical_type());
+    AddNext(out, col.is_nullable());
+    AddNext(out, shape.type);
+    AddNext(out, shape.has_lower);
+    AddNext(out, shape.has_upper);
+    AddNext(out, shape.num_values);
+  }
+  return Status::OK();
+}
+
+RowPredicateEvaluator::RowPredicateEvaluator(
+    const Schema* base_schema,
+    const vector<ColumnPredicate>& predicates,
+    const scoped_refptr<RowPredicateFunctions>& functions)
+  : functions_(functions) {
+#ifndef NDEBUG
+  // The predicates must be evaluable by the code that was generated.
+  vector<RowPredicateShape> shapes;
+  faststring key, functions_key;
+  CHECK_OK(RowPredicateFunctions::GetShapes(*base_schema, predicates, &shapes));
+  CHECK_OK(RowPredicateFunctions::EncodeKey(*base_schema, shapes, &key));
+  CHECK_OK(functions_->EncodeOwnKey(&functions_key));
+  CHECK(Slice(key) == Slice(functions_key))
+      << "Codegenned row predicate's shapes incompatible with the predicates being evaluated";
+#endif
+  vector<std::pair<const void*, size_t>> values;
+  for (const ColumnPredicate& pred : predicates) {
+    size_t size = pred.column().type_info()->size();
+    DCHECK_LE(size, sizeof(uint64_t));
+    switch (pred.predicate_type()) {
+      case PredicateType::Equality:
+        values.emplace_back(pred.raw_lower(), size);
+        break;
+      case PredicateType::Range:
+        if (pred.raw_lower()) values.emplace_back(pred.raw_lower(), size);
+        if (pred.raw_upper()) values.emplace_back(pred.raw_upper(), size);
+        break;
+      case PredicateType::InList:
+        for (const void* value : pred.raw_values()) {
+          values.emplace_back(value, size);
+        }
+        break;
+      default:
+        break;
+    }
+  }
+
+  // Copy the values so that the evaluator doesn't depend on the predicates'
+  // lifetime. The storage mustn't be resized once the pointers are taken.
+  operand_storage_.resize(values.size());
+  for (size_t i = 0; i < values.size(); i++) {
+    memcpy(&operand_storage_[i], values[i].first, values[i].second);
+    operands_.push_back(&operand_storage_[i]);
+  }
+}
+
+} // namespace codegen
+} // namespace kudu
@@ -0,0 +1,132 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#ifndef KUDU_CODEGEN_ROW_PREDICATE_H
+#define KUDU_CODEGEN_ROW_PREDICATE_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "kudu/codegen/jit_wrapper.h"
+#include "kudu/common/column_predicate.h"
+#include "kudu/common/schema.h"
+#include "kudu/gutil/macros.h"
+#include "kudu/gutil/ref_counted.h"
+#include "kudu/util/status.h"
+
+namespace llvm {
+class TargetMachine;
+} // namespace llvm
+
+namespace kudu {
+
+class faststring;
+
+namespace codegen {
+
+// The shape of a predicate as far as the generated code is concerned: which
+// column it applies to and which operands it compares against. The operand
+// values themselves are passed in when the function is called, so that
+// queries which differ only in their constants share the same code.
+struct RowPredicateShape {
+  // Index of the column within the base schema.
+  size_t col_idx;
+  PredicateType type;
+  bool has_lower;
+  bool has_upper;
+  // The number of values for an InList predicate.
+  size_t num_values;
+};
+
+// The JITWrapper for codegen::RowPredicateEvaluator functions. Contains the
+// compiled function, which evaluates the conjunction of a set of predicates
+// against a contiguous row of the base schema.
+class RowPredicateFunctions : public JITWrapper {
+ public:
+  // Compiles the evaluation function for the given predicate shapes.
+  // Writes the llvm::TargetMachine* used to 'tm' (if not NULL)
+  // and the function to 'out' upon success.
+  static Status Create(const Schema& base_schema,
+                       const std::vector<RowPredicateShape>& shapes,
+                       scoped_refptr<RowPredicateFunctions>* out,
+                       llvm::TargetMachine** tm = NULL);
+
+  // Returns true if the row matches every predicate. 'operands' holds a
+  // pointer to each of the predicates' operand values, in order: the value
+  // of an Equality predicate, the lower and upper bounds of a Range predicate
+  // (whichever are present), and the values of an InList predicate.
+  typedef bool(*EvaluationFunction)(const uint8_t* row, const void* const* operands);
+  EvaluationFunction evaluate() const { return evaluate_f_; }
+
+  const Schema& base_schema() const { return base_schema_; }
+  const std::vector<RowPredicateShape>& shapes() const { return shapes_; }
+
+  virtual Status EncodeOwnKey(faststring* out) OVERRIDE {
+    return EncodeKey(base_schema_, shapes_, out);
+  }
+
+  static Status EncodeKey(const Schema& base, const std::vector<RowPredicateShape>& shapes,
+                          faststring* out);
+
+  // Computes the shapes of 'predicates' against 'base'. Returns NotSupported
+  // if any of them can't be code-generated: only predicates on integer and
+  // boolean columns are.
+  static Status GetShapes(const Schema& base, const std::vector<ColumnPredicate>& predicates,
+                          std::vector<RowPredicateShape>* shapes);
+
+ private:
+  RowPredicateFunctions(const Schema& base_schema, std::vector<RowPredicateShape> shapes,
+                        EvaluationFunction evaluate_f, std::unique_ptr<JITCodeOwner> owner);
+
+  const Schema base_schema_;
+  const std::vector<RowPredicateShape> shapes_;
+  const EvaluationFunction evaluate_f_;
+};
+
+// Evaluates a set of predicates against contiguous rows of a base schema
+// using code-generated functions. Equivalent to evaluating each
+// ColumnPredicate against the row's cells, without the per-type dispatch.
+class RowPredicateEvaluator {
+ public:
+  // Requires that 'predicates' have the same shapes against 'base_schema'
+  // as those used to create 'functions'. The predicates' operand values are
+  // copied, so the predicates needn't outlive this object.
+  RowPredicateEvaluator(const Schema* base_schema,
+                        const std::vector<ColumnPredicate>& predicates,
+                        const scoped_refptr<RowPredicateFunctions>& functions);
+
+  // Returns true if the contiguous row at 'row_data' matches all of the predicates.
+  bool Evaluate(const uint8_t* row_data) const {
+    return functions_->evaluate()(row_data, operands_.data());
+  }
+
+ private:
+  scoped_refptr<RowPredicateFunctions> functions_;
+
+  // Copies of the predicates' operand values, all of which are at most
+  // eight bytes wide, and pointers to each of them.
+  std::vector<uint64_t> operand_storage_;
+  std::vector<const void*> operands_;
+
+  DISALLOW_COPY_AND_ASSIGN(RowPredicateEvaluator);
+};
+
+} // namespace codegen
+} // namespace kudu
+
+#endif
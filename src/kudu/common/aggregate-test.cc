@@ -0,0 +1,177 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/common/aggregate.h"
+
+#include <gtest/gtest.h>
+#include <string>
+
+#include "kudu/common/rowblock.h"
+#include "kudu/common/schema.h"
+#include "kudu/common/types.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/memory/arena.h"
+#include "kudu/util/test_macros.h"
+#include "kudu/util/test_util.h"
+
+using google::protobuf::RepeatedPtrField;
+using std::string;
+using strings::Substitute;
+
+namespace kudu {
+
+class AggregateTest : public KuduTest {
+ public:
+  AggregateTest()
+      : schema_({ ColumnSchema("key", INT32),
+                  ColumnSchema("val", INT32, true /* nullable */),
+                  ColumnSchema("str", STRING) },
+                1),
+        arena_(1024, 1024 * 1024) {
+  }
+
+  // Fills 'block' with rows for keys [first_key, first_key + nrows), where
+  // 'val' is NULL for multiples of 5 and rows with odd keys are unselected.
+  void FillBlock(int first_key, RowBlock* block) {
+    block->selection_vector()->SetAllTrue();
+    for (int i = 0; i < block->nrows(); i++) {
+      int key = first_key + i;
+      RowBlockRow row = block->row(i);
+      *reinterpret_cast<int32_t*>(row.mutable_cell_ptr(0)) = key;
+      *reinterpret_cast<int32_t*>(row.mutable_cell_ptr(1)) = key * 2;
+      row.cell(1).set_null(key % 5 == 0);
+      Slice str;
+      CHECK(arena_.RelocateSlice(Substitute("s$0", key), &str));
+      *reinterpret_cast<Slice*>(row.mutable_cell_ptr(2)) = str;
+      if (key % 2 == 1) {
+        block->selection_vector()->SetRowUnselected(i);
+      }
+    }
+  }
+
+  void AddAggregate(AggregatePB::Type type, const string& column) {
+    AggregatePB* agg = aggregates_.Add();
+    agg->set_type(type);
+    if (!column.empty()) {
+      agg->set_column(column);
+    }
+  }
+
+ protected:
+  Schema schema_;
+  Arena arena_;
+  RepeatedPtrField<AggregatePB> aggregates_;
+};
+
+TEST_F(AggregateTest, TestValidate) {
+  AddAggregate(AggregatePB::COUNT, "");
+  AddAggregate(AggregatePB::SUM, "val");
+  AddAggregate(AggregatePB::MAX, "str");
+  ASSERT_OK(Aggregator::Validate(schema_, aggregates_));
+
+  AddAggregate(AggregatePB::SUM, "str");
+  Status s = Aggregator::Validate(schema_, aggregates_);
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+  ASSERT_STR_CONTAINS(s.ToString(), "Cannot compute SUM over column str");
+
+  aggregates_.RemoveLast();
+  AddAggregate(AggregatePB::MIN, "missing");
+  s = Aggregator::Validate(schema_, aggregates_);
+  ASSERT_STR_CONTAINS(s.ToString(), "not part of the projection");
+
+  aggregates_.RemoveLast();
+  AddAggregate(AggregatePB::MIN, "");
+  s = Aggregator::Validate(schema_, aggregates_);
+  ASSERT_STR_CONTAINS(s.ToString(), "Aggregate must include a column");
+}
+
+// Compute the aggregates over two blocks in separate aggregators and check
+// that merging the partial results gives the expected totals.
+TEST_F(AggregateTest, TestAggregateAndMerge) {
+  AddAggregate(AggregatePB::COUNT, "");
+  AddAggregate(AggregatePB::COUNT, "val");
+  AddAggregate(AggregatePB::SUM, "val");
+  AddAggregate(AggregatePB::MIN, "val");
+  AddAggregate(AggregatePB::MAX, "str");
+  ASSERT_OK(Aggregator::Validate(schema_, aggregates_));
+
+  RepeatedPtrField<AggregateResultPB> merged;
+  const int kRowsPerBlock = 100;
+  for (int b = 0; b < 2; b++) {
+    RowBlock block(schema_, kRowsPerBlock, &arena_);
+    FillBlock(b * kRowsPerBlock, &block);
+    Aggregator aggregator(aggregates_);
+    aggregator.AddRowBlock(block);
+    RepeatedPtrField<AggregateResultPB> partial;
+    aggregator.ToPB(&partial);
+    ASSERT_EQ(aggregates_.size(), partial.size());
+    if (b == 0) {
+      merged = partial;
+      continue;
+    }
+    for (int i = 0; i < aggregates_.size(); i++) {
+      const AggregatePB& agg = aggregates_.Get(i);
+      const TypeInfo* type_info = agg.has_column() ?
+          schema_.column(schema_.find_column(agg.column())).type_info() : nullptr;
+      MergeAggregateResult(agg.type(), type_info, partial.Get(i), merged.Mutable(i));
+    }
+  }
+
+  // Compute the expected results over the selected rows directly.
+  int64_t num_selected = 0;
+  int64_t num_vals = 0;
+  int64_t sum = 0;
+  for (int key = 0; key < 2 * kRowsPerBlock; key++) {
+    if (key % 2 == 1) continue;
+    num_selected++;
+    if (key % 5 == 0) continue;
+    num_vals++;
+    sum += key * 2;
+  }
+
+  EXPECT_EQ(num_selected, merged.Get(0).count());
+  EXPECT_EQ(num_vals, merged.Get(1).count());
+  EXPECT_EQ(num_vals, merged.Get(2).count());
+  EXPECT_EQ(sum, merged.Get(2).int_sum());
+
+  // The smallest non-NULL value is for key 2, since key 0 is NULL.
+  int32_t min_val;
+  ASSERT_EQ(sizeof(min_val), merged.Get(3).value().size());
+  memcpy(&min_val, merged.Get(3).value().data(), sizeof(min_val));
+  EXPECT_EQ(4, min_val);
+
+  // Strings compare lexicographically: "s98" is the largest selected value.
+  EXPECT_EQ("s98", merged.Get(4).value());
+}
+
+// Aggregates over no values have a zero count and no MIN or MAX value.
+TEST_F(AggregateTest, TestNoValues) {
+  AddAggregate(AggregatePB::MIN, "val");
+  RowBlock block(schema_, 10, &arena_);
+  FillBlock(0, &block);
+  block.selection_vector()->SetAllFalse();
+
+  Aggregator aggregator(aggregates_);
+  aggregator.AddRowBlock(block);
+  RepeatedPtrField<AggregateResultPB> results;
+  aggregator.ToPB(&results);
+  ASSERT_EQ(1, results.size());
+  EXPECT_EQ(0, results.Get(0).count());
+  EXPECT_FALSE(results.Get(0).has_value());
+}
+
+} // namespace kudu
@@ -0,0 +1,287 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/common/aggregate.h"
+
+#include <glog/logging.h>
+
+#include "kudu/common/columnblock.h"
+#include "kudu/common/rowblock.h"
+#include "kudu/common/schema.h"
+#include "kudu/common/types.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/slice.h"
+
+using google::protobuf::RepeatedPtrField;
+using std::string;
+using strings::Substitute;
+
+namespace kudu {
+
+namespace {
+
+bool IsIntegerType(DataType type) {
+  return type == INT8 || type == INT16 || type == INT32 || type == INT64;
+}
+
+bool IsFloatingPointType(DataType type) {
+  return type == FLOAT || type == DOUBLE;
+}
+
+bool IsSelectedValue(const ColumnBlock& cblock, const SelectionVector& sel, size_t idx) {
+  return sel.IsRowSelected(idx) && (!cblock.is_nullable() || !cblock.is_null(idx));
+}
+
+// Encodes the given cell in the same way as ColumnPredicatePB bounds.
+void EncodeValue(const TypeInfo* type_info, const void* cell, string* value) {
+  if (type_info->physical_type() == BINARY) {
+    const Slice* slice = reinterpret_cast<const Slice*>(cell);
+    value->assign(reinterpret_cast<const char*>(slice->data()), slice->size());
+  } else {
+    value->assign(reinterpret_cast<const char*>(cell), type_info->size());
+  }
+}
+
+// Returns a pointer to a cell holding the encoded 'value'. For BINARY-based
+// types, 'slice' is used as the storage for the cell.
+const void* DecodeValue(const TypeInfo* type_info, const string& value, Slice* slice) {
+  if (type_info->physical_type() == BINARY) {
+    *slice = Slice(value);
+    return slice;
+  }
+  DCHECK_EQ(type_info->size(), value.size());
+  return value.data();
+}
+
+void CountColumn(const ColumnBlock& cblock, const SelectionVector& sel, int64_t* count) {
+  if (!cblock.HasNulls()) {
+    *count += sel.CountSelected();
+    return;
+  }
+  for (size_t i = 0; i < cblock.nrows(); i++) {
+    if (IsSelectedValue(cblock, sel, i)) {
+      (*count)++;
+    }
+  }
+}
+
+template<DataType Type>
+void SumIntegerColumn(const ColumnBlock& cblock, const SelectionVector& sel,
+                      int64_t* count, int64_t* sum) {
+  typedef typename DataTypeTraits<Type>::cpp_type CppType;
+  const CppType* cells = reinterpret_cast<const CppType*>(cblock.data());
+  // Accumulate as unsigned so that overflow wraps around instead of being
+  // undefined behavior.
+  uint64_t total = static_cast<uint64_t>(*sum);
+  for (size_t i = 0; i < cblock.nrows(); i++) {
+    if (IsSelectedValue(cblock, sel, i)) {
+      total += static_cast<uint64_t>(static_cast<int64_t>(cells[i]));
+      (*count)++;
+    }
+  }
+  *sum = static_cast<int64_t>(total);
+}
+
+template<DataType Type>
+void SumFloatingPointColumn(const ColumnBlock& cblock, const SelectionVector& sel,
+                            int64_t* count, double* sum) {
+  typedef typename DataTypeTraits<Type>::cpp_type CppType;
+  const CppType* cells = reinterpret_cast<const CppType*>(cblock.data());
+  for (size_t i = 0; i < cblock.nrows(); i++) {
+    if (IsSelectedValue(cblock, sel, i)) {
+      *sum += cells[i];
+      (*count)++;
+    }
+  }
+}
+
+// Returns true if 'candidate' should replace 'current' as the MIN (or MAX,
+// if 'is_max' is true).
+bool IsBetter(const TypeInfo* type_info, bool is_max, const void* candidate,
+              const void* current) {
+  int cmp = type_info->Compare(candidate, current);
+  return is_max ? cmp > 0 : cmp < 0;
+}
+
+void MinMaxColumn(const ColumnBlock& cblock, const SelectionVector& sel, bool is_max,
+                  int64_t* count, string* value) {
+  const TypeInfo* type_info = cblock.type_info();
+  Slice current_slice;
+  const void* current = *count > 0 ? DecodeValue(type_info, *value, &current_slice) : nullptr;
+  const void* best = nullptr;
+  for (size_t i = 0; i < cblock.nrows(); i++) {
+    if (!IsSelectedValue(cblock, sel, i)) {
+      continue;
+    }
+    const void* cell = cblock.cell_ptr(i);
+    if (best == nullptr || IsBetter(type_info, is_max, cell, best)) {
+      best = cell;
+    }
+    (*count)++;
+  }
+  if (best != nullptr && (current == nullptr || IsBetter(type_info, is_max, best, current))) {
+    EncodeValue(type_info, best, value);
+  }
+}
+
+} // anonymous namespace
+
+Status Aggregator::Validate(const Schema& schema,
+                            const RepeatedPtrField<AggregatePB>& aggregates) {
+  for (const AggregatePB& agg : aggregates) {
+    if (!agg.has_column()) {
+      if (agg.type() != AggregatePB::COUNT) {
+        return Status::InvalidArgument("Aggregate must include a column",
+                                       agg.ShortDebugString());
+      }
+      continue;
+    }
+    int col_idx = schema.find_column(agg.column());
+    if (col_idx == Schema::kColumnNotFound) {
+      return Status::InvalidArgument("Aggregated column is not part of the projection",
+                                     agg.column());
+    }
+    DataType type = schema.column(col_idx).type_info()->physical_type();
+    switch (agg.type()) {
+      case AggregatePB::COUNT:
+      case AggregatePB::MIN:
+      case AggregatePB::MAX:
+        break;
+      case AggregatePB::SUM:
+        if (!IsIntegerType(type) && !IsFloatingPointType(type)) {
+          return Status::InvalidArgument(
+              Substitute("Cannot compute SUM over column $0 of type $1",
+                         agg.column(), schema.column(col_idx).type_info()->name()));
+        }
+        break;
+      default:
+        return Status::InvalidArgument("Unknown aggregate type", agg.ShortDebugString());
+    }
+  }
+  return Status::OK();
+}
+
+Aggregator::Aggregator(const RepeatedPtrField<AggregatePB>& aggregates) {
+  states_.resize(aggregates.size());
+  for (int i = 0; i < aggregates.size(); i++) {
+    State& state = states_[i];
+    state.type = aggregates.Get(i).type();
+    state.column = aggregates.Get(i).column();
+    state.count = 0;
+    state.int_sum = 0;
+    state.double_sum = 0;
+  }
+}
+
+Aggregator::~Aggregator() {
+}
+
+void Aggregator::AddRowBlock(const RowBlock& block) {
+  const SelectionVector& sel = *block.selection_vector();
+  for (State& state : states_) {
+    if (state.column.empty()) {
+      state.count += sel.CountSelected();
+      continue;
+    }
+    int col_idx = block.schema().find_column(state.column);
+    DCHECK_NE(col_idx, Schema::kColumnNotFound) << state.column;
+    ColumnBlock cblock = block.column_block(col_idx);
+
+    switch (state.type) {
+      case AggregatePB::COUNT:
+        CountColumn(cblock, sel, &state.count);
+        break;
+      case AggregatePB::SUM:
+        switch (cblock.type_info()->physical_type()) {
+          case INT8: SumIntegerColumn<INT8>(cblock, sel, &state.count, &state.int_sum); break;
+          case INT16: SumIntegerColumn<INT16>(cblock, sel, &state.count, &state.int_sum); break;
+          case INT32: SumIntegerColumn<INT32>(cblock, sel, &state.count, &state.int_sum); break;
+          case INT64: SumIntegerColumn<INT64>(cblock, sel, &state.count, &state.int_sum); break;
+          case FLOAT:
+            SumFloatingPointColumn<FLOAT>(cblock, sel, &state.count, &state.double_sum);
+            break;
+          case DOUBLE:
+            SumFloatingPointColumn<DOUBLE>(cblock, sel, &state.count, &state.double_sum);
+            break;
+          default:
+            LOG(FATAL) << "Cannot SUM column " << state.column;
+        }
+        break;
+      case AggregatePB::MIN:
+      case AggregatePB::MAX:
+        MinMaxColumn(cblock, sel, state.type == AggregatePB::MAX, &state.count, &state.value);
+        break;
+      default:
+        LOG(FATAL) << "Unknown aggregate type " << state.type;
+    }
+  }
+}
+
+void Aggregator::ToPB(RepeatedPtrField<AggregateResultPB>* results) const {
+  for (const State& state : states_) {
+    AggregateResultPB* result = results->Add();
+    result->set_count(state.count);
+    switch (state.type) {
+      case AggregatePB::SUM:
+        result->set_int_sum(state.int_sum);
+        result->set_double_sum(state.double_sum);
+        break;
+      case AggregatePB::MIN:
+      case AggregatePB::MAX:
+        if (state.count > 0) {
+          result->set_value(state.value);
+        }
+        break;
+      default:
+        break;
+    }
+  }
+}
+
+void MergeAggregateResult(AggregatePB::Type type,
+                          const TypeInfo* type_info,
+                          const AggregateResultPB& src,
+                          AggregateResultPB* dst) {
+  switch (type) {
+    case AggregatePB::COUNT:
+      break;
+    case AggregatePB::SUM:
+      dst->set_int_sum(static_cast<int64_t>(static_cast<uint64_t>(dst->int_sum()) +
+                                            static_cast<uint64_t>(src.int_sum())));
+      dst->set_double_sum(dst->double_sum() + src.double_sum());
+      break;
+    case AggregatePB::MIN:
+    case AggregatePB::MAX: {
+      if (!src.has_value()) {
+        break;
+      }
+      Slice src_slice, dst_slice;
+      if (!dst->has_value() ||
+          IsBetter(DCHECK_NOTNULL(type_info), type == AggregatePB::MAX,
+                   DecodeValue(type_info, src.value(), &src_slice),
+                   DecodeValue(type_info, dst->value(), &dst_slice))) {
+        dst->set_value(src.value());
+      }
+      break;
+    }
+    default:
+      LOG(FATAL) << "Unknown aggregate type " << type;
+  }
+  dst->set_count(dst->count() + src.count());
+}
+
+} // namespace kudu
@@ -0,0 +1,90 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#ifndef KUDU_COMMON_AGGREGATE_H
+#define KUDU_COMMON_AGGREGATE_H
+
+#include <google/protobuf/repeated_field.h>
+#include <string>
+#include <vector>
+
+#include "kudu/common/common.pb.h"
+#include "kudu/gutil/macros.h"
+#include "kudu/util/status.h"
+
+namespace kudu {
+
+class RowBlock;
+class Schema;
+class TypeInfo;
+
+// Computes partial AggregatePB results over the selected rows of a sequence
+// of RowBlocks, such as the blocks produced by a tablet scan.
+//
+// A single Aggregator computes every aggregate of a scan in one pass over
+// each block, and its results can be merged with the partial results of
+// other Aggregators using MergeAggregateResult().
+class Aggregator {
+ public:
+  // Returns a bad Status if 'aggregates' cannot be computed over rows
+  // with the given schema, e.g. because a column is missing or a SUM is
+  // requested over a non-numeric column.
+  static Status Validate(const Schema& schema,
+                         const google::protobuf::RepeatedPtrField<AggregatePB>& aggregates);
+
+  // 'aggregates' must have been validated against the schema of the
+  // blocks which will be passed to AddRowBlock().
+  explicit Aggregator(const google::protobuf::RepeatedPtrField<AggregatePB>& aggregates);
+  ~Aggregator();
+
+  // Folds the selected rows of 'block' into the aggregates.
+  void AddRowBlock(const RowBlock& block);
+
+  // Appends one result per aggregate to 'results', in the order of the
+  // aggregates passed to the constructor.
+  void ToPB(google::protobuf::RepeatedPtrField<AggregateResultPB>* results) const;
+
+ private:
+  struct State {
+    AggregatePB::Type type;
+
+    // The aggregated column, or empty for a COUNT of rows.
+    std::string column;
+
+    int64_t count;
+    int64_t int_sum;
+    double double_sum;
+
+    // The current MIN or MAX value, encoded as in AggregateResultPB.
+    std::string value;
+  };
+
+  std::vector<State> states_;
+
+  DISALLOW_COPY_AND_ASSIGN(Aggregator);
+};
+
+// Merges the partial result 'src' of an aggregate of the given type into
+// 'dst'. 'type_info' is the type of the aggregated column, and may only be
+// NULL for a COUNT of rows.
+void MergeAggregateResult(AggregatePB::Type type,
+                          const TypeInfo* type_info,
+                          const AggregateResultPB& src,
+                          AggregateResultPB* dst);
+
+} // namespace kudu
+
+#endif // KUDU_COMMON_AGGREGATE_H
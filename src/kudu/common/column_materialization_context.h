@@ -38,7 +38,8 @@ class ColumnMaterializationContext {
       pred_(pred),
       block_(block),
       sel_(sel),
-      decoder_eval_status_(kNotSet) {
+      decoder_eval_status_(kNotSet),
+      skip_unselected_rows_(false) {
       if (!pred_ || !sel || !block) {
         decoder_eval_status_ = kDecoderEvalNotSupported;
       }
@@ -73,6 +74,21 @@ class ColumnMaterializationContext {
     return decoder_eval_status_ != kDecoderEvalNotSupported;
   }
 
+  // Checked by CFileIterator::Scan() to determine whether runs of rows whose
+  // bits are already cleared in sel() may be skipped rather than decoded (on
+  // true). The cells of skipped rows are left unset, or set to null if the
+  // block is nullable.
+  bool skip_unselected_rows() const {
+    return skip_unselected_rows_;
+  }
+
+  // Should only be called by callers which initialized sel() and which only
+  // read the cells of the rows which remain selected.
+  void SetSkipUnselectedRows() {
+    DCHECK(sel_ != nullptr);
+    skip_unselected_rows_ = true;
+  }
+
   // A context should not switch from supporting decoder-level eval to not
   // supporting it, or vice versa.
   //
@@ -132,6 +148,8 @@ class ColumnMaterializationContext {
   SelectionVector* const sel_;
 
   DecoderEvalStatus decoder_eval_status_;
+
+  bool skip_unselected_rows_;
 };
 
 } // namespace kudu
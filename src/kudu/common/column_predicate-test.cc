@@ -21,8 +21,12 @@
 #include <gtest/gtest.h>
 #include <vector>
 
+#include "kudu/common/rowblock.h"
 #include "kudu/common/schema.h"
 #include "kudu/common/types.h"
+#include "kudu/util/bloom_filter.h"
+#include "kudu/util/random.h"
+#include "kudu/util/test_macros.h"
 #include "kudu/util/test_util.h"
 
 namespace kudu {
@@ -380,6 +384,165 @@ class TestColumnPredicate : public KuduTest {
               ColumnPredicate::Range(column, &values[2], nullptr),
               PredicateType::Range);
   }
+
+  // Test that IN list predicates are simplified and merged correctly.
+  void TestInListMerge() {
+    ColumnSchema column("c", INT32, true);
+    vector<int32_t> values = { 0, 1, 2, 3, 4, 5, 6 };
+
+    { // Empty and single value lists are simplified.
+      vector<const void*> empty;
+      ASSERT_EQ(PredicateType::None, ColumnPredicate::InList(column, &empty).predicate_type());
+
+      vector<const void*> one = { &values[3] };
+      ColumnPredicate pred = ColumnPredicate::InList(column, &one);
+      ASSERT_EQ(ColumnPredicate::Equality(column, &values[3]), pred);
+
+      // Duplicates are removed.
+      vector<const void*> dups = { &values[3], &values[3] };
+      ASSERT_EQ(ColumnPredicate::Equality(column, &values[3]),
+                ColumnPredicate::InList(column, &dups));
+    }
+
+    vector<const void*> list = { &values[3], &values[1], &values[5] };
+    ColumnPredicate in_list = ColumnPredicate::InList(column, &list);
+    ASSERT_EQ(PredicateType::InList, in_list.predicate_type());
+    ASSERT_EQ("`c` IN (1, 3, 5)", in_list.ToString());
+
+    // IN (1, 3, 5) AND >= 2 = IN (3, 5)
+    vector<const void*> expected = { &values[3], &values[5] };
+    TestMerge(in_list,
+              ColumnPredicate::Range(column, &values[2], nullptr),
+              ColumnPredicate::InList(column, &expected),
+              PredicateType::InList);
+
+    // IN (1, 3, 5) AND [2, 4) = 3
+    TestMerge(in_list,
+              ColumnPredicate::Range(column, &values[2], &values[4]),
+              ColumnPredicate::Equality(column, &values[3]),
+              PredicateType::Equality);
+
+    // IN (1, 3, 5) AND < 1 = None
+    TestMerge(in_list,
+              ColumnPredicate::Range(column, nullptr, &values[1]),
+              ColumnPredicate::None(column),
+              PredicateType::None);
+
+    // IN (1, 3, 5) AND = 5 = 5
+    TestMerge(in_list,
+              ColumnPredicate::Equality(column, &values[5]),
+              ColumnPredicate::Equality(column, &values[5]),
+              PredicateType::Equality);
+
+    // IN (1, 3, 5) AND = 4 = None
+    TestMerge(in_list,
+              ColumnPredicate::Equality(column, &values[4]),
+              ColumnPredicate::None(column),
+              PredicateType::None);
+
+    // IN (1, 3, 5) AND IN (0, 1, 5, 6) = IN (1, 5)
+    vector<const void*> other = { &values[6], &values[0], &values[5], &values[1] };
+    expected = { &values[1], &values[5] };
+    TestMerge(in_list,
+              ColumnPredicate::InList(column, &other),
+              ColumnPredicate::InList(column, &expected),
+              PredicateType::InList);
+
+    // IN (1, 3, 5) AND IN (2, 4) = None
+    other = { &values[2], &values[4] };
+    TestMerge(in_list,
+              ColumnPredicate::InList(column, &other),
+              ColumnPredicate::None(column),
+              PredicateType::None);
+
+    // IN (1, 3, 5) AND IS NOT NULL = IN (1, 3, 5)
+    TestMerge(in_list,
+              ColumnPredicate::IsNotNull(column),
+              in_list,
+              PredicateType::InList);
+
+    // IN (1, 3, 5) AND None = None
+    TestMerge(in_list,
+              ColumnPredicate::None(column),
+              ColumnPredicate::None(column),
+              PredicateType::None);
+  }
+
+  // Test that evaluating predicates over a block of random values produces the
+  // same selection as evaluating each cell individually.
+  template <DataType Type>
+  void TestEvaluateRandomized(bool nullable) {
+    typedef typename DataTypeTraits<Type>::cpp_type cpp_type;
+    // Not a multiple of eight, so that the trailing partial byte of the
+    // selection vector is exercised.
+    const int kNumRows = 1003;
+    Random rng(SeedRandom());
+
+    ScopedColumnBlock<Type> cells(kNumRows);
+    for (int i = 0; i < kNumRows; i++) {
+      cells[i] = static_cast<cpp_type>(static_cast<int>(rng.Uniform(20)) - 10);
+      cells.SetCellIsNull(i, nullable && rng.OneIn(5));
+    }
+    ColumnBlock block(cells.type_info(), nullable ? cells.null_bitmap() : nullptr,
+                      cells.data(), kNumRows, nullptr);
+
+    ColumnSchema column("c", Type, nullable);
+    cpp_type lower = static_cast<cpp_type>(-3);
+    cpp_type upper = static_cast<cpp_type>(4);
+    if (DataTypeTraits<Type>::Compare(&lower, &upper) > 0) std::swap(lower, upper);
+
+    // A short IN list is searched linearly, and a long one by binary search.
+    vector<cpp_type> list_values;
+    for (int i = -10; i < 10; i += 2) {
+      list_values.push_back(static_cast<cpp_type>(i));
+    }
+    vector<const void*> short_list = { &lower, &upper };
+    vector<const void*> long_list;
+    for (const cpp_type& v : list_values) {
+      long_list.push_back(&v);
+    }
+
+    // A Bloom filter of every other value of the list.
+    BloomFilterBuilder bfb(BloomFilterSizing::ByCountAndFPRate(10, 0.01),
+                           BloomFilterFormat::kSplitBlock);
+    for (int i = 0; i < list_values.size(); i += 2) {
+      bfb.AddKey(BloomKeyProbe(Slice(reinterpret_cast<const uint8_t*>(&list_values[i]),
+                                     sizeof(cpp_type))));
+    }
+    BloomFilter bf(bfb.slice(), bfb.n_hashes(), bfb.format());
+
+    vector<ColumnPredicate> predicates = {
+      ColumnPredicate::Equality(column, &lower),
+      ColumnPredicate::Range(column, &lower, &upper),
+      ColumnPredicate::Range(column, &lower, nullptr),
+      ColumnPredicate::Range(column, nullptr, &upper),
+      ColumnPredicate::InList(column, &short_list),
+      ColumnPredicate::InList(column, &long_list),
+      ColumnPredicate::InBloomFilter(column, { bf }, nullptr, nullptr),
+      ColumnPredicate::InBloomFilter(column, { bf }, &lower, &upper),
+    };
+    if (nullable) {
+      predicates.push_back(ColumnPredicate::IsNotNull(column));
+    }
+
+    for (const ColumnPredicate& predicate : predicates) {
+      SCOPED_TRACE(predicate.ToString());
+      SelectionVector sel(kNumRows);
+      sel.SetAllTrue();
+      vector<bool> expected(kNumRows);
+      for (int i = 0; i < kNumRows; i++) {
+        if (rng.OneIn(4)) sel.SetRowUnselected(i);
+        expected[i] = sel.IsRowSelected(i) &&
+                      (!nullable || !block.is_null(i)) &&
+                      predicate.EvaluateCell<Type>(block.cell_ptr(i));
+      }
+
+      predicate.Evaluate(block, &sel);
+      for (int i = 0; i < kNumRows; i++) {
+        ASSERT_EQ(expected[i], sel.IsRowSelected(i)) << "row " << i;
+      }
+    }
+  }
 };
 
 TEST_F(TestColumnPredicate, TestMerge) {
@@ -403,6 +566,24 @@ TEST_F(TestColumnPredicate, TestMerge) {
                                       });
 }
 
+TEST_F(TestColumnPredicate, TestEvaluate) {
+  for (bool nullable : { false, true }) {
+    SCOPED_TRACE(nullable);
+    NO_FATALS(TestEvaluateRandomized<INT8>(nullable));
+    NO_FATALS(TestEvaluateRandomized<INT16>(nullable));
+    NO_FATALS(TestEvaluateRandomized<INT32>(nullable));
+    NO_FATALS(TestEvaluateRandomized<INT64>(nullable));
+    NO_FATALS(TestEvaluateRandomized<UINT32>(nullable));
+    NO_FATALS(TestEvaluateRandomized<UINT64>(nullable));
+    NO_FATALS(TestEvaluateRandomized<DOUBLE>(nullable));
+  }
+}
+
+// Test that IN list predicates are simplified and merged correctly.
+TEST_F(TestColumnPredicate, TestInList) {
+  TestInListMerge();
+}
+
 // Test that the range constructor handles equality and empty ranges.
 TEST_F(TestColumnPredicate, TestRangeConstructor) {
   {
@@ -523,6 +704,7 @@ TEST_F(TestColumnPredicate, TestExclusive) {
 TEST_F(TestColumnPredicate, TestSelectivity) {
   int32_t one_32 = 1;
   int64_t one_64 = 1;
+  int64_t two_64 = 2;
   double_t one_d = 1.0;
   Slice one_s("one", 3);
 
@@ -542,6 +724,22 @@ TEST_F(TestColumnPredicate, TestSelectivity) {
                                   ColumnPredicate::IsNotNull(column_i32)),
             0);
 
+  vector<const void*> list = { &one_64, &two_64 };
+  ColumnPredicate in_list = ColumnPredicate::InList(column_i64, &list);
+  ASSERT_LT(SelectivityComparator(ColumnPredicate::Equality(column_i64, &one_64), in_list), 0);
+  ASSERT_LT(SelectivityComparator(in_list, ColumnPredicate::Range(column_i64, &one_64, nullptr)),
+            0);
+
+  BloomFilterBuilder bfb(BloomFilterSizing::ByCountAndFPRate(10, 0.01));
+  ColumnPredicate in_bloom_filter =
+      ColumnPredicate::InBloomFilter(column_i64,
+                                     { BloomFilter(bfb.slice(), bfb.n_hashes()) },
+                                     nullptr, nullptr);
+  ASSERT_LT(SelectivityComparator(in_list, in_bloom_filter), 0);
+  ASSERT_LT(SelectivityComparator(in_bloom_filter,
+                                  ColumnPredicate::Range(column_i64, &one_64, nullptr)),
+            0);
+
   // Size of column type
   ASSERT_LT(SelectivityComparator(ColumnPredicate::Equality(column_i32, &one_32),
                                   ColumnPredicate::Equality(column_i64, &one_64)),
@@ -560,4 +758,111 @@ TEST_F(TestColumnPredicate, TestSelectivity) {
             0);
 }
 
+// Test that IN Bloom filter predicates never reject the values in their
+// filters, and that they are simplified and merged correctly.
+TEST_F(TestColumnPredicate, TestInBloomFilter) {
+  ColumnSchema column("c", INT32);
+  auto key = [] (const int32_t& v) {
+    return BloomKeyProbe(Slice(reinterpret_cast<const uint8_t*>(&v), sizeof(v)));
+  };
+  int32_t values[] = { 0, 10, 20, 30, 40 };
+
+  BloomFilterBuilder bfb1(BloomFilterSizing::ByCountAndFPRate(100, 0.01),
+                          BloomFilterFormat::kSplitBlock);
+  BloomFilterBuilder bfb2(BloomFilterSizing::ByCountAndFPRate(100, 0.01));
+  for (int32_t v = 0; v < 100; v += 10) {
+    bfb1.AddKey(key(v));
+    if (v != 30) bfb2.AddKey(key(v));
+  }
+  BloomFilter bf1(bfb1.slice(), bfb1.n_hashes(), bfb1.format());
+  BloomFilter bf2(bfb2.slice(), bfb2.n_hashes(), bfb2.format());
+
+  ColumnPredicate bloom = ColumnPredicate::InBloomFilter(column, { bf1 }, nullptr, nullptr);
+  ASSERT_EQ(PredicateType::InBloomFilter, bloom.predicate_type());
+  for (int32_t v = 0; v < 100; v += 10) {
+    ASSERT_TRUE(bloom.EvaluateCell<INT32>(&v)) << v;
+  }
+
+  // Bounds which allow a single value are probed eagerly.
+  int32_t ten_plus_one = 11;
+  ASSERT_EQ(ColumnPredicate::Equality(column, &values[1]),
+            ColumnPredicate::InBloomFilter(column, { bf1 }, &values[1], &ten_plus_one));
+  ASSERT_EQ(PredicateType::None,
+            ColumnPredicate::InBloomFilter(column, { bf1 }, &values[1], &values[1])
+                .predicate_type());
+
+  // Merging with a range intersects the bounds, and keeps the filters.
+  ColumnPredicate merged = bloom;
+  merged.Merge(ColumnPredicate::Range(column, &values[1], &values[4]));
+  ASSERT_EQ(ColumnPredicate::InBloomFilter(column, { bf1 }, &values[1], &values[4]), merged);
+  ASSERT_FALSE(merged.MayMatchRange(&values[4], &values[4]));
+  ASSERT_TRUE(merged.MayMatchRange(&values[0], &values[2]));
+
+  ColumnPredicate range_merged = ColumnPredicate::Range(column, &values[1], &values[4]);
+  range_merged.Merge(bloom);
+  ASSERT_EQ(merged, range_merged);
+
+  // Merging with an equality or IN list probes their values.
+  ColumnPredicate eq_merged = ColumnPredicate::Equality(column, &values[2]);
+  eq_merged.Merge(merged);
+  ASSERT_EQ(ColumnPredicate::Equality(column, &values[2]), eq_merged);
+  eq_merged = ColumnPredicate::Equality(column, &values[0]);
+  eq_merged.Merge(merged);
+  ASSERT_EQ(PredicateType::None, eq_merged.predicate_type());
+
+  vector<const void*> list = { &values[0], &values[2], &values[3] };
+  ColumnPredicate list_merged = merged;
+  list_merged.Merge(ColumnPredicate::InList(column, &list));
+  vector<const void*> expected_list = { &values[2], &values[3] };
+  ASSERT_EQ(ColumnPredicate::InList(column, &expected_list), list_merged);
+
+  // Merging two IN Bloom filter predicates requires values to pass both.
+  ColumnPredicate both = bloom;
+  both.Merge(ColumnPredicate::InBloomFilter(column, { bf2 }, nullptr, nullptr));
+  ASSERT_EQ(ColumnPredicate::InBloomFilter(column, { bf1, bf2 }, nullptr, nullptr), both);
+  ASSERT_TRUE(both.EvaluateCell<INT32>(&values[2]));
+  ColumnPredicate thirty = ColumnPredicate::Equality(column, &values[3]);
+  thirty.Merge(both);
+  ColumnPredicate thirty_bf2 = ColumnPredicate::Equality(column, &values[3]);
+  thirty_bf2.Merge(ColumnPredicate::InBloomFilter(column, { bf2 }, nullptr, nullptr));
+  ASSERT_EQ(thirty_bf2, thirty);
+
+  // IS NOT NULL, and disjoint bounds.
+  ColumnPredicate not_null = ColumnPredicate::IsNotNull(column);
+  not_null.Merge(bloom);
+  ASSERT_EQ(bloom, not_null);
+  ColumnPredicate none = merged;
+  none.Merge(ColumnPredicate::Range(column, &values[4], nullptr));
+  ASSERT_EQ(PredicateType::None, none.predicate_type());
+}
+
+// Test that predicates are only ruled out for value ranges which they cannot
+// match.
+TEST_F(TestColumnPredicate, TestMayMatchRange) {
+  ColumnSchema column("c", INT32);
+  int32_t values[] = { 0, 10, 20, 30, 40 };
+  const void* min = &values[1];
+  const void* max = &values[3];
+
+  // Range predicates, with the upper bound being exclusive.
+  ASSERT_TRUE(ColumnPredicate::Range(column, &values[0], &values[2]).MayMatchRange(min, max));
+  ASSERT_TRUE(ColumnPredicate::Range(column, &values[3], nullptr).MayMatchRange(min, max));
+  ASSERT_FALSE(ColumnPredicate::Range(column, nullptr, &values[1]).MayMatchRange(min, max));
+  ASSERT_FALSE(ColumnPredicate::Range(column, &values[4], nullptr).MayMatchRange(min, max));
+
+  // Equality predicates.
+  ASSERT_TRUE(ColumnPredicate::Equality(column, &values[1]).MayMatchRange(min, max));
+  ASSERT_TRUE(ColumnPredicate::Equality(column, &values[3]).MayMatchRange(min, max));
+  ASSERT_FALSE(ColumnPredicate::Equality(column, &values[0]).MayMatchRange(min, max));
+  ASSERT_FALSE(ColumnPredicate::Equality(column, &values[4]).MayMatchRange(min, max));
+
+  // IN list predicates.
+  vector<const void*> outside = { &values[0], &values[4] };
+  ASSERT_FALSE(ColumnPredicate::InList(column, &outside).MayMatchRange(min, max));
+  vector<const void*> inside = { &values[0], &values[2], &values[4] };
+  ASSERT_TRUE(ColumnPredicate::InList(column, &inside).MayMatchRange(min, max));
+
+  ASSERT_TRUE(ColumnPredicate::IsNotNull(column).MayMatchRange(min, max));
+}
+
 } // namespace kudu
@@ -17,15 +17,25 @@
 
 #include "kudu/common/column_predicate.h"
 
+#include <algorithm>
+#include <iterator>
 #include <utility>
 
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
 #include "kudu/common/key_util.h"
 #include "kudu/common/rowblock.h"
 #include "kudu/common/schema.h"
 #include "kudu/common/types.h"
+#include "kudu/gutil/cpu.h"
+#include "kudu/gutil/mathlimits.h"
+#include "kudu/gutil/strings/substitute.h"
 #include "kudu/util/memory/arena.h"
 
 using std::move;
+using std::vector;
 
 namespace kudu {
 
@@ -112,6 +122,40 @@ ColumnPredicate ColumnPredicate::IsNotNull(ColumnSchema column) {
   return ColumnPredicate(PredicateType::IsNotNull, move(column), nullptr, nullptr);
 }
 
+ColumnPredicate ColumnPredicate::InList(ColumnSchema column,
+                                        vector<const void*>* values) {
+  CHECK(values != nullptr);
+
+  // Sort and deduplicate the values, which allows merging and evaluation to
+  // use binary search.
+  const TypeInfo* type_info = column.type_info();
+  std::sort(values->begin(), values->end(),
+            [type_info] (const void* a, const void* b) {
+              return type_info->Compare(a, b) < 0;
+            });
+  values->erase(std::unique(values->begin(), values->end(),
+                            [type_info] (const void* a, const void* b) {
+                              return type_info->Compare(a, b) == 0;
+                            }),
+                values->end());
+
+  ColumnPredicate pred(PredicateType::InList, move(column), nullptr, nullptr);
+  pred.values_.swap(*values);
+  pred.Simplify();
+  return pred;
+}
+
+ColumnPredicate ColumnPredicate::InBloomFilter(ColumnSchema column,
+                                               vector<BloomFilter> bloom_filters,
+                                               const void* lower,
+                                               const void* upper) {
+  CHECK(!bloom_filters.empty());
+  ColumnPredicate pred(PredicateType::InBloomFilter, move(column), lower, upper);
+  pred.bloom_filters_ = move(bloom_filters);
+  pred.Simplify();
+  return pred;
+}
+
 ColumnPredicate ColumnPredicate::None(ColumnSchema column) {
   return ColumnPredicate(PredicateType::None, move(column), nullptr, nullptr);
 }
@@ -120,6 +164,8 @@ void ColumnPredicate::SetToNone() {
   predicate_type_ = PredicateType::None;
   lower_ = nullptr;
   upper_ = nullptr;
+  values_.clear();
+  bloom_filters_.clear();
 }
 
 void ColumnPredicate::Simplify() {
@@ -140,6 +186,36 @@ void ColumnPredicate::Simplify() {
       }
       return;
     };
+    case PredicateType::InList: {
+      if (values_.empty()) {
+        // If the list is empty, no results can be returned.
+        SetToNone();
+      } else if (values_.size() == 1) {
+        // List has only one value, so convert to an equality predicate.
+        predicate_type_ = PredicateType::Equality;
+        lower_ = values_[0];
+        values_.clear();
+      }
+      return;
+    };
+    case PredicateType::InBloomFilter: {
+      if (lower_ != nullptr && upper_ != nullptr) {
+        if (column_.type_info()->Compare(lower_, upper_) >= 0) {
+          SetToNone();
+        } else if (column_.type_info()->AreConsecutive(lower_, upper_)) {
+          // The bounds only allow a single value, so probe the filters with
+          // it now rather than once per row.
+          if (CheckValueInBloomFilters(lower_)) {
+            predicate_type_ = PredicateType::Equality;
+            upper_ = nullptr;
+            bloom_filters_.clear();
+          } else {
+            SetToNone();
+          }
+        }
+      }
+      return;
+    };
   }
   LOG(FATAL) << "unknown predicate type";
 }
@@ -156,6 +232,14 @@ void ColumnPredicate::Merge(const ColumnPredicate& other) {
       MergeIntoEquality(other);
       return;
     };
+    case PredicateType::InList: {
+      MergeIntoInList(other);
+      return;
+    };
+    case PredicateType::InBloomFilter: {
+      MergeIntoBloomFilter(other);
+      return;
+    };
     case PredicateType::IsNotNull: {
       // NOT NULL is less selective than all other predicate types, so the
       // intersection of NOT NULL with any other predicate is just the other
@@ -166,6 +250,8 @@ void ColumnPredicate::Merge(const ColumnPredicate& other) {
       predicate_type_ = other.predicate_type_;
       lower_ = other.lower_;
       upper_ = other.upper_;
+      values_ = other.values_;
+      bloom_filters_ = other.bloom_filters_;
       return;
     };
   }
@@ -182,18 +268,7 @@ void ColumnPredicate::MergeIntoRange(const ColumnPredicate& other) {
     };
 
     case PredicateType::Range: {
-      // Set the lower bound to the larger of the two.
-      if (other.lower_ != nullptr &&
-          (lower_ == nullptr || column_.type_info()->Compare(lower_, other.lower_) < 0)) {
-        lower_ = other.lower_;
-      }
-
-      // Set the upper bound to the smaller of the two.
-      if (other.upper_ != nullptr &&
-          (upper_ == nullptr || column_.type_info()->Compare(upper_, other.upper_) > 0)) {
-        upper_ = other.upper_;
-      }
-
+      IntersectBounds(other);
       Simplify();
       return;
     };
@@ -211,6 +286,26 @@ void ColumnPredicate::MergeIntoRange(const ColumnPredicate& other) {
       return;
     };
     case PredicateType::IsNotNull: return;
+    case PredicateType::InList: {
+      // Keep only the values of the list which fall within this range.
+      for (const void* value : other.values_) {
+        if (CheckValueInRange(value)) {
+          values_.push_back(value);
+        }
+      }
+      predicate_type_ = PredicateType::InList;
+      lower_ = nullptr;
+      upper_ = nullptr;
+      Simplify();
+      return;
+    };
+    case PredicateType::InBloomFilter: {
+      IntersectBounds(other);
+      predicate_type_ = PredicateType::InBloomFilter;
+      bloom_filters_ = other.bloom_filters_;
+      Simplify();
+      return;
+    };
   }
   LOG(FATAL) << "unknown predicate type";
 }
@@ -238,14 +333,276 @@ void ColumnPredicate::MergeIntoEquality(const ColumnPredicate& other) {
       return;
     };
     case PredicateType::IsNotNull: return;
+    case PredicateType::InList: {
+      if (!std::binary_search(other.values_.begin(), other.values_.end(), lower_,
+                              [this] (const void* a, const void* b) {
+                                return column_.type_info()->Compare(a, b) < 0;
+                              })) {
+        SetToNone();
+      }
+      return;
+    };
+    case PredicateType::InBloomFilter: {
+      if (!other.CheckValueInRange(lower_) || !other.CheckValueInBloomFilters(lower_)) {
+        SetToNone();
+      }
+      return;
+    };
+  }
+  LOG(FATAL) << "unknown predicate type";
+}
+
+void ColumnPredicate::MergeIntoInList(const ColumnPredicate& other) {
+  CHECK(predicate_type_ == PredicateType::InList);
+  DCHECK(values_.size() > 1);
+
+  switch (other.predicate_type()) {
+    case PredicateType::None: {
+      SetToNone();
+      return;
+    };
+    case PredicateType::Range: {
+      // Remove the values which fall outside of the range.
+      values_.erase(std::remove_if(values_.begin(), values_.end(),
+                                   [&other] (const void* v) {
+                                     return !other.CheckValueInRange(v);
+                                   }),
+                    values_.end());
+      Simplify();
+      return;
+    };
+    case PredicateType::Equality: {
+      if (std::binary_search(values_.begin(), values_.end(), other.lower_,
+                             [this] (const void* a, const void* b) {
+                               return column_.type_info()->Compare(a, b) < 0;
+                             })) {
+        predicate_type_ = PredicateType::Equality;
+        lower_ = other.lower_;
+        values_.clear();
+      } else {
+        SetToNone();
+      }
+      return;
+    };
+    case PredicateType::IsNotNull: return;
+    case PredicateType::InList: {
+      // Both lists are sorted, so the intersection can be found in one pass.
+      vector<const void*> intersection;
+      std::set_intersection(values_.begin(), values_.end(),
+                            other.values_.begin(), other.values_.end(),
+                            std::back_inserter(intersection),
+                            [this] (const void* a, const void* b) {
+                              return column_.type_info()->Compare(a, b) < 0;
+                            });
+      values_.swap(intersection);
+      Simplify();
+      return;
+    };
+    case PredicateType::InBloomFilter: {
+      // Remove the values which fall outside of the bounds, or which are
+      // definitely not in the filters.
+      values_.erase(std::remove_if(values_.begin(), values_.end(),
+                                   [&other] (const void* v) {
+                                     return !other.CheckValueInRange(v) ||
+                                            !other.CheckValueInBloomFilters(v);
+                                   }),
+                    values_.end());
+      Simplify();
+      return;
+    };
+  }
+  LOG(FATAL) << "unknown predicate type";
+}
+
+void ColumnPredicate::MergeIntoBloomFilter(const ColumnPredicate& other) {
+  CHECK(predicate_type_ == PredicateType::InBloomFilter);
+
+  switch (other.predicate_type()) {
+    case PredicateType::None: {
+      SetToNone();
+      return;
+    };
+    case PredicateType::Range: {
+      IntersectBounds(other);
+      Simplify();
+      return;
+    };
+    case PredicateType::Equality: {
+      if (CheckValueInRange(other.lower_) && CheckValueInBloomFilters(other.lower_)) {
+        predicate_type_ = PredicateType::Equality;
+        lower_ = other.lower_;
+        upper_ = nullptr;
+        bloom_filters_.clear();
+      } else {
+        SetToNone();
+      }
+      return;
+    };
+    case PredicateType::IsNotNull: return;
+    case PredicateType::InList: {
+      // Keep only the values of the list which may match this predicate.
+      for (const void* value : other.values_) {
+        if (CheckValueInRange(value) && CheckValueInBloomFilters(value)) {
+          values_.push_back(value);
+        }
+      }
+      predicate_type_ = PredicateType::InList;
+      lower_ = nullptr;
+      upper_ = nullptr;
+      bloom_filters_.clear();
+      Simplify();
+      return;
+    };
+    case PredicateType::InBloomFilter: {
+      // A value must pass the filters of both predicates.
+      IntersectBounds(other);
+      bloom_filters_.insert(bloom_filters_.end(),
+                            other.bloom_filters_.begin(), other.bloom_filters_.end());
+      Simplify();
+      return;
+    };
+  }
+  LOG(FATAL) << "unknown predicate type";
+}
+
+void ColumnPredicate::IntersectBounds(const ColumnPredicate& other) {
+  DCHECK(other.predicate_type_ == PredicateType::Range ||
+         other.predicate_type_ == PredicateType::InBloomFilter);
+
+  // Set the lower bound to the larger of the two.
+  if (other.lower_ != nullptr &&
+      (lower_ == nullptr || column_.type_info()->Compare(lower_, other.lower_) < 0)) {
+    lower_ = other.lower_;
+  }
+
+  // Set the upper bound to the smaller of the two.
+  if (other.upper_ != nullptr &&
+      (upper_ == nullptr || column_.type_info()->Compare(upper_, other.upper_) > 0)) {
+    upper_ = other.upper_;
+  }
+}
+
+bool ColumnPredicate::CheckValueInRange(const void* value) const {
+  CHECK(predicate_type_ == PredicateType::Range ||
+        predicate_type_ == PredicateType::InBloomFilter);
+  return (lower_ == nullptr || column_.type_info()->Compare(lower_, value) <= 0) &&
+         (upper_ == nullptr || column_.type_info()->Compare(upper_, value) > 0);
+}
+
+bool ColumnPredicate::CheckValueInBloomFilters(const void* value) const {
+  DCHECK(predicate_type_ == PredicateType::InBloomFilter);
+  Slice key;
+  if (column_.type_info()->physical_type() == BINARY) {
+    key = *static_cast<const Slice*>(value);
+  } else {
+    key = Slice(static_cast<const uint8_t*>(value), column_.type_info()->size());
+  }
+  BloomKeyProbe probe(key);
+  for (const BloomFilter& bf : bloom_filters_) {
+    if (!bf.MayContainKey(probe)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool ColumnPredicate::MayMatchRange(const void* min, const void* max) const {
+  const TypeInfo* type_info = column_.type_info();
+  switch (predicate_type_) {
+    case PredicateType::None: return false;
+    case PredicateType::IsNotNull: return true;
+    case PredicateType::Range:
+    case PredicateType::InBloomFilter: {
+      // The filters can't be checked against a range of values.
+      return (lower_ == nullptr || type_info->Compare(lower_, max) <= 0) &&
+             (upper_ == nullptr || type_info->Compare(upper_, min) > 0);
+    };
+    case PredicateType::Equality: {
+      return type_info->Compare(lower_, min) >= 0 && type_info->Compare(lower_, max) <= 0;
+    };
+    case PredicateType::InList: {
+      // The values are sorted, so find the first one which is not below the
+      // minimum, and check that it is not above the maximum.
+      auto iter = std::lower_bound(values_.begin(), values_.end(), min,
+                                   [type_info] (const void* lhs, const void* rhs) {
+                                     return type_info->Compare(lhs, rhs) < 0;
+                                   });
+      return iter != values_.end() && type_info->Compare(*iter, max) <= 0;
+    };
   }
   LOG(FATAL) << "unknown predicate type";
 }
 
 namespace {
-template <typename P>
-void ApplyPredicate(const ColumnBlock& block, SelectionVector* sel, P p) {
+
+// Clears the selection vector bits of all rows which are null in the block.
+// This ANDs the null bitmap into the selection vector, since a set bit in the
+// null bitmap indicates that the corresponding cell is not null.
+void ClearNullRows(const ColumnBlock& block, SelectionVector* sel) {
+  const uint8_t* non_null = block.null_bitmap();
+  uint8_t* sel_bytes = sel->mutable_bitmap();
+  size_t full_bytes = block.nrows() / 8;
+  BitmapMergeAnd(sel_bytes, non_null, full_bytes * 8);
+  size_t trailing_bits = block.nrows() % 8;
+  if (trailing_bits != 0) {
+    // Leave the bits beyond the end of the block untouched.
+    uint8_t mask = (1 << trailing_bits) - 1;
+    sel_bytes[full_bytes] &= non_null[full_bytes] | ~mask;
+  }
+}
+
+// Evaluates the predicate over a block of fixed-width integer cells eight rows
+// at a time, building up a byte of results which is ANDed into the selection
+// vector. The inner loop is free of branches, which allows the compiler to
+// vectorize it.
+//
+// Null cells are evaluated along with the others (integer comparisons are
+// safe on any bit pattern) and are cleared from the selection afterwards.
+template <DataType PhysicalType, typename P>
+void ApplyPredicateBytewise(const ColumnBlock& block, SelectionVector* sel, P p) {
+  typedef typename DataTypeTraits<PhysicalType>::cpp_type cpp_type;
+  const cpp_type* cells = reinterpret_cast<const cpp_type*>(block.data());
+  uint8_t* sel_bytes = sel->mutable_bitmap();
+  size_t full_bytes = block.nrows() / 8;
+  for (size_t i = 0; i < full_bytes; i++) {
+    if (sel_bytes[i] == 0) continue;
+    const cpp_type* batch = cells + i * 8;
+    uint8_t result = 0;
+    for (int bit = 0; bit < 8; bit++) {
+      result |= static_cast<uint8_t>(p(&batch[bit])) << bit;
+    }
+    sel_bytes[i] &= result;
+  }
+  for (size_t i = full_bytes * 8; i < block.nrows(); i++) {
+    if (sel->IsRowSelected(i) && !p(&cells[i])) {
+      BitmapClear(sel_bytes, i);
+    }
+  }
   if (block.is_nullable()) {
+    ClearNullRows(block, sel);
+  }
+}
+
+// Returns true if predicates on the physical type may be evaluated bytewise.
+//
+// Floating point types are excluded since DataTypeTraits::Compare considers
+// NaN to be equal to every value, which is not preserved by the bytewise
+// kernel's comparisons after vectorization.
+template <DataType PhysicalType>
+struct IsBytewiseEvaluable {
+  static const bool value = PhysicalType == INT8 || PhysicalType == INT16 ||
+                            PhysicalType == INT32 || PhysicalType == INT64 ||
+                            PhysicalType == UINT8 || PhysicalType == UINT16 ||
+                            PhysicalType == UINT32 || PhysicalType == UINT64;
+};
+
+template <DataType PhysicalType, typename P>
+void ApplyPredicate(const ColumnBlock& block, SelectionVector* sel, P p) {
+  if (IsBytewiseEvaluable<PhysicalType>::value) {
+    ApplyPredicateBytewise<PhysicalType>(block, sel, p);
+    return;
+  }
+  if (block.HasNulls()) {
     for (size_t i = 0; i < block.nrows(); i++) {
       if (!sel->IsRowSelected(i)) continue;
       const void *cell = block.nullable_cell_ptr(i);
@@ -263,23 +620,199 @@ void ApplyPredicate(const ColumnBlock& block, SelectionVector* sel, P p) {
     }
   }
 }
+
+// Like ApplyPredicate, but never evaluates the predicate for rows which are
+// already unselected. Used for predicates which are expensive enough that
+// skipping them beats bytewise evaluation of the whole block.
+template <typename P>
+void ApplyPredicateToSelectedRows(const ColumnBlock& block, SelectionVector* sel, P p) {
+  if (block.is_nullable()) {
+    ClearNullRows(block, sel);
+  }
+  for (size_t i = 0; i < block.nrows(); i++) {
+    if (!sel->IsRowSelected(i)) continue;
+    if (!p(block.cell_ptr(i))) {
+      BitmapClear(sel->mutable_bitmap(), i);
+    }
+  }
+}
+
+#if defined(__x86_64__)
+
+bool CpuHasAVX2() {
+  static const bool has_avx2 = base::CPU().has_avx2();
+  return has_avx2;
+}
+
+// AVX2 kernels for range and equality predicates over signed 32 and 64-bit
+// integer columns. Each iteration produces one byte of the selection vector.
+// A missing lower bound is passed as the type's minimum value; a missing upper
+// bound is signaled by 'has_upper' being false, since the exclusive upper
+// bound may not be representable.
+__attribute__((target("avx2")))
+void EvaluateRangeInt32AVX2(const int32_t* cells, size_t n_bytes,
+                            int32_t lower, int32_t upper, bool has_upper,
+                            uint8_t* sel_bytes) {
+  const __m256i lower_v = _mm256_set1_epi32(lower);
+  const __m256i upper_v = _mm256_set1_epi32(upper);
+  const __m256i all_ones = _mm256_set1_epi32(-1);
+  for (size_t i = 0; i < n_bytes; i++) {
+    if (sel_bytes[i] == 0) continue;
+    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(cells + i * 8));
+    // lower <= v  <==>  !(lower > v)
+    __m256i below = _mm256_cmpgt_epi32(lower_v, v);
+    __m256i pass = has_upper ? _mm256_cmpgt_epi32(upper_v, v) : all_ones;
+    pass = _mm256_andnot_si256(below, pass);
+    sel_bytes[i] &= _mm256_movemask_ps(_mm256_castsi256_ps(pass));
+  }
+}
+
+__attribute__((target("avx2")))
+void EvaluateEqualityInt32AVX2(const int32_t* cells, size_t n_bytes,
+                               int32_t value, uint8_t* sel_bytes) {
+  const __m256i value_v = _mm256_set1_epi32(value);
+  for (size_t i = 0; i < n_bytes; i++) {
+    if (sel_bytes[i] == 0) continue;
+    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(cells + i * 8));
+    __m256i pass = _mm256_cmpeq_epi32(v, value_v);
+    sel_bytes[i] &= _mm256_movemask_ps(_mm256_castsi256_ps(pass));
+  }
+}
+
+__attribute__((target("avx2")))
+void EvaluateRangeInt64AVX2(const int64_t* cells, size_t n_bytes,
+                            int64_t lower, int64_t upper, bool has_upper,
+                            uint8_t* sel_bytes) {
+  const __m256i lower_v = _mm256_set1_epi64x(lower);
+  const __m256i upper_v = _mm256_set1_epi64x(upper);
+  const __m256i all_ones = _mm256_set1_epi64x(-1);
+  for (size_t i = 0; i < n_bytes; i++) {
+    if (sel_bytes[i] == 0) continue;
+    const __m256i* batch = reinterpret_cast<const __m256i*>(cells + i * 8);
+    __m256i lo = _mm256_loadu_si256(batch);
+    __m256i hi = _mm256_loadu_si256(batch + 1);
+    __m256i pass_lo = has_upper ? _mm256_cmpgt_epi64(upper_v, lo) : all_ones;
+    __m256i pass_hi = has_upper ? _mm256_cmpgt_epi64(upper_v, hi) : all_ones;
+    pass_lo = _mm256_andnot_si256(_mm256_cmpgt_epi64(lower_v, lo), pass_lo);
+    pass_hi = _mm256_andnot_si256(_mm256_cmpgt_epi64(lower_v, hi), pass_hi);
+    sel_bytes[i] &= _mm256_movemask_pd(_mm256_castsi256_pd(pass_lo)) |
+                    (_mm256_movemask_pd(_mm256_castsi256_pd(pass_hi)) << 4);
+  }
+}
+
+__attribute__((target("avx2")))
+void EvaluateEqualityInt64AVX2(const int64_t* cells, size_t n_bytes,
+                               int64_t value, uint8_t* sel_bytes) {
+  const __m256i value_v = _mm256_set1_epi64x(value);
+  for (size_t i = 0; i < n_bytes; i++) {
+    if (sel_bytes[i] == 0) continue;
+    const __m256i* batch = reinterpret_cast<const __m256i*>(cells + i * 8);
+    __m256i pass_lo = _mm256_cmpeq_epi64(_mm256_loadu_si256(batch), value_v);
+    __m256i pass_hi = _mm256_cmpeq_epi64(_mm256_loadu_si256(batch + 1), value_v);
+    sel_bytes[i] &= _mm256_movemask_pd(_mm256_castsi256_pd(pass_lo)) |
+                    (_mm256_movemask_pd(_mm256_castsi256_pd(pass_hi)) << 4);
+  }
+}
+
+#endif // defined(__x86_64__)
+
+// Attempts to evaluate a range or equality predicate using an explicitly
+// vectorized kernel. Only whole bytes of the selection vector are handled; on
+// success, the number of rows evaluated is written to 'rows_evaluated', and
+// the caller is responsible for the remaining rows. Returns false if no kernel
+// is available for the type on this CPU.
+template <DataType PhysicalType>
+bool TryEvaluateVectorized(PredicateType type, const void* lower, const void* upper,
+                           const ColumnBlock& block, SelectionVector* sel,
+                           size_t* rows_evaluated) {
+  return false;
+}
+
+#if defined(__x86_64__)
+template <>
+bool TryEvaluateVectorized<INT32>(PredicateType type, const void* lower, const void* upper,
+                                  const ColumnBlock& block, SelectionVector* sel,
+                                  size_t* rows_evaluated) {
+  if (!CpuHasAVX2()) return false;
+  const int32_t* cells = reinterpret_cast<const int32_t*>(block.data());
+  size_t n_bytes = block.nrows() / 8;
+  if (type == PredicateType::Equality) {
+    EvaluateEqualityInt32AVX2(cells, n_bytes, *static_cast<const int32_t*>(lower),
+                              sel->mutable_bitmap());
+  } else {
+    DCHECK(type == PredicateType::Range);
+    EvaluateRangeInt32AVX2(cells, n_bytes,
+                           lower == nullptr ? MathLimits<int32_t>::kMin
+                                            : *static_cast<const int32_t*>(lower),
+                           upper == nullptr ? 0 : *static_cast<const int32_t*>(upper),
+                           upper != nullptr,
+                           sel->mutable_bitmap());
+  }
+  *rows_evaluated = n_bytes * 8;
+  return true;
+}
+
+template <>
+bool TryEvaluateVectorized<INT64>(PredicateType type, const void* lower, const void* upper,
+                                  const ColumnBlock& block, SelectionVector* sel,
+                                  size_t* rows_evaluated) {
+  if (!CpuHasAVX2()) return false;
+  const int64_t* cells = reinterpret_cast<const int64_t*>(block.data());
+  size_t n_bytes = block.nrows() / 8;
+  if (type == PredicateType::Equality) {
+    EvaluateEqualityInt64AVX2(cells, n_bytes, *static_cast<const int64_t*>(lower),
+                              sel->mutable_bitmap());
+  } else {
+    DCHECK(type == PredicateType::Range);
+    EvaluateRangeInt64AVX2(cells, n_bytes,
+                           lower == nullptr ? MathLimits<int64_t>::kMin
+                                            : *static_cast<const int64_t*>(lower),
+                           upper == nullptr ? 0 : *static_cast<const int64_t*>(upper),
+                           upper != nullptr,
+                           sel->mutable_bitmap());
+  }
+  *rows_evaluated = n_bytes * 8;
+  return true;
+}
+#endif // defined(__x86_64__)
+
 } // anonymous namespace
 
+template <DataType PhysicalType>
+bool ColumnPredicate::EvaluateVectorized(const ColumnBlock& block,
+                                         SelectionVector* sel) const {
+  size_t rows_evaluated;
+  if (!TryEvaluateVectorized<PhysicalType>(predicate_type(), lower_, upper_,
+                                           block, sel, &rows_evaluated)) {
+    return false;
+  }
+  for (size_t i = rows_evaluated; i < block.nrows(); i++) {
+    if (sel->IsRowSelected(i) && !EvaluateCell<PhysicalType>(block.cell_ptr(i))) {
+      sel->SetRowUnselected(i);
+    }
+  }
+  if (block.is_nullable()) {
+    ClearNullRows(block, sel);
+  }
+  return true;
+}
+
 template <DataType PhysicalType>
 void ColumnPredicate::EvaluateForPhysicalType(const ColumnBlock& block,
                                               SelectionVector* sel) const {
   switch (predicate_type()) {
     case PredicateType::Range: {
+      if (EvaluateVectorized<PhysicalType>(block, sel)) return;
       if (lower_ == nullptr) {
-        ApplyPredicate(block, sel, [this] (const void* cell) {
+        ApplyPredicate<PhysicalType>(block, sel, [this] (const void* cell) {
           return DataTypeTraits<PhysicalType>::Compare(cell, this->upper_) < 0;
         });
       } else if (upper_ == nullptr) {
-        ApplyPredicate(block, sel, [this] (const void* cell) {
+        ApplyPredicate<PhysicalType>(block, sel, [this] (const void* cell) {
           return DataTypeTraits<PhysicalType>::Compare(cell, this->lower_) >= 0;
         });
       } else {
-        ApplyPredicate(block, sel, [this] (const void* cell) {
+        ApplyPredicate<PhysicalType>(block, sel, [this] (const void* cell) {
           return DataTypeTraits<PhysicalType>::Compare(cell, this->upper_) < 0 &&
                  DataTypeTraits<PhysicalType>::Compare(cell, this->lower_) >= 0;
         });
@@ -287,20 +820,29 @@ void ColumnPredicate::EvaluateForPhysicalType(const ColumnBlock& block,
       return;
     };
     case PredicateType::Equality: {
-      ApplyPredicate(block, sel, [this] (const void* cell) {
+      if (EvaluateVectorized<PhysicalType>(block, sel)) return;
+      ApplyPredicate<PhysicalType>(block, sel, [this] (const void* cell) {
         return DataTypeTraits<PhysicalType>::Compare(cell, this->lower_) == 0;
       });
       return;
     };
     case PredicateType::IsNotNull: {
+      // Clears the null rows 16 bytes of the bitmap at a time.
       if (!block.is_nullable()) return;
-      // TODO: make this more efficient by using bitwise operations on the
-      // null and selection vectors.
-      for (size_t i = 0; i < block.nrows(); i++) {
-        if (sel->IsRowSelected(i) && block.is_null(i)) {
-          BitmapClear(sel->mutable_bitmap(), i);
-        }
-      }
+      ClearNullRows(block, sel);
+      return;
+    }
+    case PredicateType::InList: {
+      ApplyPredicate<PhysicalType>(block, sel, [this] (const void* cell) {
+        return this->CheckValueInList<PhysicalType>(cell);
+      });
+      return;
+    }
+    case PredicateType::InBloomFilter: {
+      // Check the cheap bounds before probing the filters.
+      ApplyPredicateToSelectedRows(block, sel, [this] (const void* cell) {
+        return this->CheckValueInRange(cell) && this->CheckValueInBloomFilters(cell);
+      });
       return;
     }
     default:
@@ -348,6 +890,35 @@ string ColumnPredicate::ToString() const {
     case PredicateType::IsNotNull: {
       return strings::Substitute("`$0` IS NOT NULL", column_.name());
     };
+    case PredicateType::InList: {
+      string ss = "`";
+      ss.append(column_.name());
+      ss.append("` IN (");
+      bool is_first = true;
+      for (const void* value : values_) {
+        if (is_first) {
+          is_first = false;
+        } else {
+          ss.append(", ");
+        }
+        ss.append(column_.Stringify(value));
+      }
+      ss.append(")");
+      return ss;
+    };
+    case PredicateType::InBloomFilter: {
+      string ss = strings::Substitute("`$0` IN BLOOM FILTER ($1 filters)",
+                                      column_.name(), bloom_filters_.size());
+      if (lower_ != nullptr) {
+        strings::SubstituteAndAppend(&ss, " AND `$0` >= $1",
+                                     column_.name(), column_.Stringify(lower_));
+      }
+      if (upper_ != nullptr) {
+        strings::SubstituteAndAppend(&ss, " AND `$0` < $1",
+                                     column_.name(), column_.Stringify(upper_));
+      }
+      return ss;
+    };
   }
   LOG(FATAL) << "unknown predicate type";
 }
@@ -358,13 +929,32 @@ bool ColumnPredicate::operator==(const ColumnPredicate& other) const {
     return false;
   } else if (predicate_type_ == PredicateType::Equality) {
     return column_.type_info()->Compare(lower_, other.lower_) == 0;
-  } else if (predicate_type_ == PredicateType::Range) {
+  } else if (predicate_type_ == PredicateType::Range ||
+             predicate_type_ == PredicateType::InBloomFilter) {
+    if (predicate_type_ == PredicateType::InBloomFilter) {
+      if (bloom_filters_.size() != other.bloom_filters_.size()) return false;
+      for (int i = 0; i < bloom_filters_.size(); i++) {
+        const BloomFilter& bf = bloom_filters_[i];
+        const BloomFilter& other_bf = other.bloom_filters_[i];
+        if (bf.format() != other_bf.format() ||
+            bf.n_hashes() != other_bf.n_hashes() ||
+            bf.data() != other_bf.data()) {
+          return false;
+        }
+      }
+    }
     return (lower_ == other.lower_ ||
             (lower_ != nullptr && other.lower_ != nullptr &&
              column_.type_info()->Compare(lower_, other.lower_) == 0)) &&
            (upper_ == other.upper_ ||
             (upper_ != nullptr && other.upper_ != nullptr &&
              column_.type_info()->Compare(upper_, other.upper_) == 0));
+  } else if (predicate_type_ == PredicateType::InList) {
+    if (values_.size() != other.values_.size()) return false;
+    for (int i = 0; i < values_.size(); i++) {
+      if (column_.type_info()->Compare(values_[i], other.values_[i]) != 0) return false;
+    }
+    return true;
   } else {
     return true;
   }
@@ -376,8 +966,10 @@ int SelectivityRank(const ColumnPredicate& predicate) {
   switch (predicate.predicate_type()) {
     case PredicateType::None: rank = 0; break;
     case PredicateType::Equality: rank = 1; break;
-    case PredicateType::Range: rank = 2; break;
-    case PredicateType::IsNotNull: rank = 3; break;
+    case PredicateType::InList: rank = 2; break;
+    case PredicateType::InBloomFilter: rank = 3; break;
+    case PredicateType::Range: rank = 4; break;
+    case PredicateType::IsNotNull: rank = 5; break;
     default: LOG(FATAL) << "unknown predicate type";
   }
   return rank * (kLargestTypeSize + 1) + predicate.column().type_info()->size();
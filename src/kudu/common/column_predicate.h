@@ -17,10 +17,13 @@
 
 #pragma once
 
+#include <algorithm>
 #include <boost/optional.hpp>
 #include <string>
+#include <vector>
 
 #include "kudu/common/schema.h"
+#include "kudu/util/bloom_filter.h"
 
 namespace kudu {
 
@@ -44,6 +47,14 @@ enum class PredicateType {
 
   // A predicate which evaluates to true if the value is not null.
   IsNotNull,
+
+  // A predicate which evaluates to true if the column value is present in
+  // a list of values.
+  InList,
+
+  // A predicate which evaluates to true if the column value may be present
+  // in each of a set of Bloom filters, and falls within an optional range.
+  InBloomFilter,
 };
 
 // A predicate which can be evaluated over a block of column values.
@@ -107,6 +118,32 @@ class ColumnPredicate {
   // Creates a new IS NOT NULL predicate for the column.
   static ColumnPredicate IsNotNull(ColumnSchema column);
 
+  // Creates a new IN list predicate for the column.
+  //
+  // The values are not copied, and must outlive the returned predicate. The
+  // vector of values is sorted and deduplicated in place.
+  //
+  // The predicate will be simplified into an Equality or None predicate type
+  // if possible.
+  static ColumnPredicate InList(ColumnSchema column, std::vector<const void*>* values);
+
+  // Creates a new IN Bloom filter predicate for the column, matching the
+  // values which may be in every one of 'bloom_filters', and which fall
+  // within the inclusive lower bound and exclusive upper bound, if given.
+  //
+  // A value is probed by its encoding in ColumnPredicatePB: the bytes of
+  // BINARY values, and the in-memory representation of the other types.
+  //
+  // Neither the data of the filters nor the bounds are copied, and they must
+  // outlive the returned predicate. There must be at least one filter.
+  //
+  // The predicate will be simplified into an Equality or None predicate type
+  // if the bounds allow.
+  static ColumnPredicate InBloomFilter(ColumnSchema column,
+                                       std::vector<BloomFilter> bloom_filters,
+                                       const void* lower,
+                                       const void* upper);
+
   // Returns the type of this predicate.
   PredicateType predicate_type() const {
     return predicate_type_;
@@ -160,11 +197,22 @@ class ColumnPredicate {
       };
       case PredicateType::IsNotNull: {
         return true;
-      }
+      };
+      case PredicateType::InList: {
+        return CheckValueInList<PhysicalType>(cell);
+      };
+      case PredicateType::InBloomFilter: {
+        return CheckValueInRange(cell) && CheckValueInBloomFilters(cell);
+      };
     }
     LOG(FATAL) << "unknown predicate type";
   }
 
+  // Returns true if any value within the inclusive range ['min', 'max'] may
+  // satisfy the predicate. This allows a set of non-null values, such as a
+  // cfile data block, to be skipped given only its bounds.
+  bool MayMatchRange(const void* min, const void* max) const;
+
   // Print the predicate for debugging.
   std::string ToString() const;
 
@@ -173,17 +221,28 @@ class ColumnPredicate {
   // Predicates over different columns are not equal.
   bool operator==(const ColumnPredicate& other) const;
 
-  // Returns the raw lower bound value if this is a range predicate, or the
-  // equality value if this is an equality predicate.
+  // Returns the raw lower bound value if this is a range or IN Bloom filter
+  // predicate, or the equality value if this is an equality predicate.
   const void* raw_lower() const {
     return lower_;
   }
 
-  // Returns the raw upper bound if this is a range predicate.
+  // Returns the raw upper bound if this is a range or IN Bloom filter
+  // predicate.
   const void* raw_upper() const {
     return upper_;
   }
 
+  // Returns the sorted list of values if this is an IN list predicate.
+  const std::vector<const void*>& raw_values() const {
+    return values_;
+  }
+
+  // Returns the Bloom filters if this is an IN Bloom filter predicate.
+  const std::vector<BloomFilter>& bloom_filters() const {
+    return bloom_filters_;
+  }
+
   // Returns the column schema of the column on which this predicate applies.
   const ColumnSchema& column() const {
     return column_;
@@ -214,24 +273,81 @@ class ColumnPredicate {
   // Merge another predicate into this Equality predicate.
   void MergeIntoEquality(const ColumnPredicate& other);
 
+  // Merge another predicate into this InList predicate.
+  void MergeIntoInList(const ColumnPredicate& other);
+
+  // Merge another predicate into this InBloomFilter predicate.
+  void MergeIntoBloomFilter(const ColumnPredicate& other);
+
+  // Narrows the bounds of this Range or InBloomFilter predicate to their
+  // intersection with the bounds of 'other', which must be one as well.
+  void IntersectBounds(const ColumnPredicate& other);
+
+  // Returns true if the value is contained in this predicate's IN list.
+  // The list is searched linearly if it is short, and by binary search
+  // otherwise.
+  template <DataType PhysicalType>
+  bool CheckValueInList(const void* value) const {
+    if (values_.size() <= kInListLinearSearchMaxValues) {
+      for (const void* v : values_) {
+        if (DataTypeTraits<PhysicalType>::Compare(value, v) == 0) return true;
+      }
+      return false;
+    }
+    // Reject values outside of the list's bounds before searching.
+    if (DataTypeTraits<PhysicalType>::Compare(value, values_.front()) < 0 ||
+        DataTypeTraits<PhysicalType>::Compare(value, values_.back()) > 0) {
+      return false;
+    }
+    return std::binary_search(values_.begin(), values_.end(), value,
+                              [] (const void* lhs, const void* rhs) {
+                                return DataTypeTraits<PhysicalType>::Compare(lhs, rhs) < 0;
+                              });
+  }
+
+  // Returns true if the value falls within this Range or InBloomFilter
+  // predicate's bounds.
+  bool CheckValueInRange(const void* value) const;
+
+  // Returns true if the value may be in all of this predicate's Bloom filters.
+  bool CheckValueInBloomFilters(const void* value) const;
+
+  // The maximum number of IN list values which are searched linearly.
+  static const size_t kInListLinearSearchMaxValues = 8;
+
   // Templated evaluation to inline the dispatch of comparator. Templating this
   // allows dispatch to occur only once per batch.
   template <DataType PhysicalType>
   void EvaluateForPhysicalType(const ColumnBlock& block,
                                SelectionVector* sel) const;
 
+  // Evaluates this range or equality predicate with a SIMD kernel, if one is
+  // available for the physical type and supported by the CPU. Returns false
+  // if the predicate was not evaluated.
+  template <DataType PhysicalType>
+  bool EvaluateVectorized(const ColumnBlock& block,
+                          SelectionVector* sel) const;
+
   // The type of this predicate.
   PredicateType predicate_type_;
 
   // The data type of the column. TypeInfo instances have a static lifetime.
   ColumnSchema column_;
 
-  // The inclusive lower bound value if this is a Range predicate, or the
-  // equality value if this is an Equality predicate.
+  // The inclusive lower bound value if this is a Range or InBloomFilter
+  // predicate, or the equality value if this is an Equality predicate.
   const void* lower_;
 
-  // The exclusive upper bound value if this is a Range predicate.
+  // The exclusive upper bound value if this is a Range or InBloomFilter
+  // predicate.
   const void* upper_;
+
+  // The sorted and deduplicated list of values if this is an InList predicate.
+  std::vector<const void*> values_;
+
+  // The filters, all of which a value must pass, if this is an InBloomFilter
+  // predicate.
+  std::vector<BloomFilter> bloom_filters_;
 };
 
 // Compares predicates according to selectivity. Predicates that match fewer
@@ -93,6 +93,14 @@ class ColumnBlock {
     return !BitmapTest(null_bitmap_, idx);
   }
 
+  // Returns true if any of the cells is null. The null bitmap is scanned
+  // a word at a time, so this is meant to be checked once per block, to
+  // take a non-nullable path through the cells of blocks without nulls.
+  bool HasNulls() const {
+    size_t idx;
+    return is_nullable() && BitmapFindFirstZero(null_bitmap_, 0, nrows_, &idx);
+  }
+
   const size_t stride() const { return type_->size(); }
   const uint8_t * data() const { return data_; }
   uint8_t *data() { return data_; }
@@ -41,12 +41,14 @@ EncodedKey::EncodedKey(faststring* data,
 }
 
 gscoped_ptr<EncodedKey> EncodedKey::FromContiguousRow(const ConstContiguousRow& row) {
-  EncodedKeyBuilder kb(row.schema());
-  for (int i = 0; i < row.schema()->num_key_columns(); i++) {
-    kb.AddColumnKey(row.cell_ptr(i));
+  const Schema* schema = row.schema();
+  faststring encoded_key;
+  schema->EncodeComparableKey(row, &encoded_key);
+  vector<const void*> raw_keys(schema->num_key_columns());
+  for (int i = 0; i < schema->num_key_columns(); i++) {
+    raw_keys[i] = row.cell_ptr(i);
   }
-  return make_gscoped_ptr(kb.BuildEncodedKey());
-
+  return make_gscoped_ptr(new EncodedKey(&encoded_key, &raw_keys, schema->num_key_columns()));
 }
 
 Status EncodedKey::DecodeEncodedString(const Schema& schema,
@@ -228,6 +228,47 @@ TEST(TestMergeIterator, TestMergePredicate2) {
   TestMerge(predicate);
 }
 
+// Test merging inputs whose key ranges are mostly disjoint, so that long runs
+// of rows, and whole blocks, come from a single input. The inputs are passed
+// out of key order, and their number isn't a power of two, to exercise the
+// shape of the merge's tournament tree.
+TEST(TestMergeIterator, TestMergeRuns) {
+  const int kNumLists = 7;
+  const int kRowsPerList = 500;
+  vector<shared_ptr<RowwiseIterator>> to_merge;
+  vector<uint32_t> expected;
+  for (int i = 0; i < kNumLists; i++) {
+    // Each input covers its own range of keys, but overlaps a little with the
+    // inputs for the neighboring ranges.
+    uint32_t base = ((i * 3) % kNumLists) * kRowsPerList;
+    vector<uint32_t> ints;
+    for (int j = 0; j < kRowsPerList; j++) {
+      ints.push_back(base + j + (j % 10 == 0 ? kRowsPerList - 5 : 0));
+    }
+    std::sort(ints.begin(), ints.end());
+    expected.insert(expected.end(), ints.begin(), ints.end());
+
+    shared_ptr<VectorIterator> it(new VectorIterator(ints));
+    it->set_block_size(1 + i * 17);
+    to_merge.emplace_back(new MaterializingIterator(it));
+  }
+  std::sort(expected.begin(), expected.end());
+
+  MergeIterator merger(kIntSchema, to_merge);
+  ASSERT_OK(merger.Init(nullptr));
+
+  RowBlock dst(kIntSchema, 100, nullptr);
+  vector<uint32_t> results;
+  while (merger.HasNext()) {
+    ASSERT_OK(merger.NextBlock(&dst));
+    ASSERT_GT(dst.nrows(), 0);
+    for (int i = 0; i < dst.nrows(); i++) {
+      results.push_back(*kIntSchema.ExtractColumnFromRow<UINT32>(dst.row(i), 0));
+    }
+  }
+  ASSERT_EQ(expected, results);
+}
+
 // Test that the MaterializingIterator properly evaluates predicates when they apply
 // to single columns.
 TEST(TestMaterializingIterator, TestMaterializingPredicatePushdown) {
@@ -259,6 +300,119 @@ TEST(TestMaterializingIterator, TestMaterializingPredicatePushdown) {
   ASSERT_FALSE(dst.selection_vector()->IsRowSelected(30));
 }
 
+// Test iterator which yields rows of two UINT32 columns from the provided
+// vectors.
+class TwoColumnVectorIterator : public ColumnwiseIterator {
+ public:
+  TwoColumnVectorIterator(vector<uint32_t> a, vector<uint32_t> b, int block_size)
+      : schema_({ ColumnSchema("a", UINT32), ColumnSchema("b", UINT32) }, 1),
+        cols_({ std::move(a), std::move(b) }),
+        cur_idx_(0),
+        block_size_(block_size),
+        prepared_(0) {
+    CHECK_EQ(cols_[0].size(), cols_[1].size());
+  }
+
+  Status Init(ScanSpec *spec) OVERRIDE {
+    return Status::OK();
+  }
+
+  virtual Status PrepareBatch(size_t* nrows) OVERRIDE {
+    prepared_ = std::min<size_t>({ cols_[0].size() - cur_idx_,
+                                   static_cast<size_t>(block_size_), *nrows });
+    *nrows = prepared_;
+    return Status::OK();
+  }
+
+  virtual Status InitializeSelectionVector(SelectionVector *sel_vec) OVERRIDE {
+    sel_vec->SetAllTrue();
+    return Status::OK();
+  }
+
+  Status MaterializeColumn(ColumnMaterializationContext* ctx) override {
+    ctx->SetDecoderEvalNotSupported();
+    const vector<uint32_t>& col = cols_[ctx->col_idx()];
+    for (size_t i = 0; i < prepared_; i++) {
+      ctx->block()->SetCellValue(i, &col[cur_idx_ + i]);
+    }
+    return Status::OK();
+  }
+
+  virtual Status FinishBatch() OVERRIDE {
+    cur_idx_ += prepared_;
+    prepared_ = 0;
+    return Status::OK();
+  }
+
+  virtual bool HasNext() const OVERRIDE {
+    return cur_idx_ < cols_[0].size();
+  }
+
+  virtual string ToString() const OVERRIDE {
+    return string("TwoColumnVectorIterator");
+  }
+
+  virtual const Schema &schema() const OVERRIDE {
+    return schema_;
+  }
+
+  virtual void GetIteratorStats(vector<IteratorStats>* stats) const OVERRIDE {
+    stats->resize(schema().num_columns());
+  }
+
+ private:
+  const Schema schema_;
+  const vector<vector<uint32_t>> cols_;
+  size_t cur_idx_;
+  int block_size_;
+  size_t prepared_;
+};
+
+// Test that predicates which filter out more rows are moved ahead of the ones
+// estimated to be more selective, and that their stats are reported.
+TEST(TestMaterializingIterator, TestAdaptivePredicateOrder) {
+  const int kNumRows = 10000;
+  const int kBlockSize = 100;
+  vector<uint32_t> a(kNumRows, 7);
+  vector<uint32_t> b;
+  for (int i = 0; i < kNumRows; i++) {
+    b.push_back(i % kBlockSize);
+  }
+  shared_ptr<TwoColumnVectorIterator> colwise(
+      new TwoColumnVectorIterator(std::move(a), std::move(b), kBlockSize));
+
+  // The equality predicate on 'a' is estimated to be the more selective, but
+  // matches every row, while the range predicate on 'b' matches 10%.
+  uint32_t seven = 7;
+  uint32_t lower = 0;
+  uint32_t upper = 10;
+  ScanSpec spec;
+  spec.AddPredicate(ColumnPredicate::Equality(colwise->schema().column(0), &seven));
+  spec.AddPredicate(ColumnPredicate::Range(colwise->schema().column(1), &lower, &upper));
+
+  MaterializingIterator materializing(colwise);
+  ASSERT_OK(materializing.Init(&spec));
+  ASSERT_EQ(0, materializing.col_idx_predicates_[0].col_idx);
+
+  Arena arena(1024, 1024);
+  RowBlock dst(colwise->schema(), kBlockSize, &arena);
+  int64_t num_selected = 0;
+  while (materializing.HasNext()) {
+    ASSERT_OK(materializing.NextBlock(&dst));
+    num_selected += dst.selection_vector()->CountSelected();
+  }
+  ASSERT_EQ(kNumRows / 10, num_selected);
+  ASSERT_EQ(1, materializing.col_idx_predicates_[0].col_idx);
+
+  vector<IteratorStats> stats;
+  materializing.GetIteratorStats(&stats);
+  ASSERT_EQ(2, stats.size());
+  ASSERT_EQ(0, stats[0].predicate_rows_filtered);
+  ASSERT_EQ(kNumRows, stats[1].predicate_rows_evaluated);
+  ASSERT_EQ(kNumRows - num_selected, stats[1].predicate_rows_filtered);
+  ASSERT_GT(stats[1].predicate_eval_cycles, 0);
+}
+
 // Test that PredicateEvaluatingIterator will properly evaluate predicates on its
 // input.
 TEST(TestPredicateEvaluatingIterator, TestPredicateEvaluation) {
@@ -18,29 +18,29 @@
 #include <algorithm>
 #include <memory>
 #include <string>
-#include <tuple>
 #include <utility>
 
 #include "kudu/common/column_materialization_context.h"
 #include "kudu/common/column_predicate.h"
 #include "kudu/common/generic_iterators.h"
+#include "kudu/common/iterator_stats.h"
 #include "kudu/common/row.h"
 #include "kudu/common/rowblock.h"
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/map-util.h"
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/gutil/walltime.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/memory/arena.h"
 
 using std::all_of;
-using std::get;
 using std::move;
 using std::remove_if;
 using std::shared_ptr;
 using std::sort;
+using std::stable_sort;
 using std::string;
 using std::unique_ptr;
-using std::tuple;
 
 DEFINE_bool(materializing_iterator_do_pushdown, true,
             "Should MaterializingIterator do predicate pushdown");
@@ -49,6 +49,12 @@ DEFINE_bool(materializing_iterator_decoder_eval, true,
             "Should MaterializingIterator do decoder-level evaluation");
 TAG_FLAG(materializing_iterator_decoder_eval, hidden);
 TAG_FLAG(materializing_iterator_decoder_eval, runtime);
+DEFINE_int32(materializing_iterator_predicate_reorder_interval, 16,
+             "Number of blocks after which MaterializingIterator reorders its "
+             "predicates by the rows they've filtered out per CPU cycle. "
+             "0 keeps the initial order, by estimated selectivity.");
+TAG_FLAG(materializing_iterator_predicate_reorder_interval, advanced);
+TAG_FLAG(materializing_iterator_predicate_reorder_interval, runtime);
 
 namespace kudu {
 
@@ -73,11 +79,17 @@ class MergeIterState {
     num_valid_(0)
   {}
 
-  const RowBlockRow& next_row() {
+  const RowBlockRow& next_row() const {
     DCHECK_LT(num_advanced_, num_valid_);
     return next_row_;
   }
 
+  // The last selected row of the current block.
+  const RowBlockRow& last_row() const {
+    DCHECK_LT(num_advanced_, num_valid_);
+    return last_row_;
+  }
+
   Status Advance() {
     num_advanced_++;
     if (IsBlockExhausted()) {
@@ -86,13 +98,11 @@ class MergeIterState {
     } else {
       // Seek to the next selected row.
       SelectionVector *selection = read_block_.selection_vector();
-      for (++next_row_idx_; next_row_idx_ < read_block_.nrows(); next_row_idx_++) {
-        if (selection->IsRowSelected(next_row_idx_)) {
-          next_row_.Reset(&read_block_, next_row_idx_);
-          break;
-        }
-      }
-      DCHECK_NE(next_row_idx_, read_block_.nrows()+1) << "No selected rows found!";
+      size_t idx;
+      bool found = selection->FindFirstSelected(next_row_idx_ + 1, &idx);
+      DCHECK(found) << "No selected rows found!";
+      next_row_idx_ = idx;
+      next_row_.Reset(&read_block_, next_row_idx_);
       return Status::OK();
     }
   }
@@ -118,12 +128,15 @@ class MergeIterState {
       DCHECK_LE(selection->CountSelected(), read_block_.nrows());
       num_valid_ = selection->CountSelected();
       VLOG(2) << selection->CountSelected() << "/" << read_block_.nrows() << " rows selected";
-      // Seek next_row_ to the first selected row.
-      for (next_row_idx_ = 0; next_row_idx_ < read_block_.nrows(); next_row_idx_++) {
-        if (selection->IsRowSelected(next_row_idx_)) {
-          next_row_.Reset(&read_block_, next_row_idx_);
-          return Status::OK();
-        }
+      // Seek next_row_ to the first selected row, and last_row_ to the last.
+      size_t first_idx;
+      size_t last_idx;
+      if (selection->FindFirstSelected(0, &first_idx)) {
+        CHECK(selection->FindLastSelected(&last_idx));
+        next_row_idx_ = first_idx;
+        next_row_.Reset(&read_block_, next_row_idx_);
+        last_row_.Reset(&read_block_, last_idx);
+        return Status::OK();
       }
       // The block may have had no selected rows, in which case we need to continue
       // to the next block.
@@ -148,6 +161,8 @@ class MergeIterState {
   RowBlock read_block_;
   // The row currently pointed to by the iterator.
   RowBlockRow next_row_;
+  // The last selected row in read_block_.
+  RowBlockRow last_row_;
   // Row index of next_row_ in read_block_.
   size_t next_row_idx_;
   // Number of rows we've advanced past in the current RowBlock.
@@ -161,7 +176,8 @@ MergeIterator::MergeIterator(
   const Schema &schema,
   const vector<shared_ptr<RowwiseIterator> > &iters)
   : schema_(schema),
-    initted_(false) {
+    initted_(false),
+    num_live_iters_(0) {
   CHECK_GT(iters.size(), 0);
   CHECK_GT(schema.num_key_columns(), 0);
   orig_iters_.assign(iters.begin(), iters.end());
@@ -187,6 +203,8 @@ Status MergeIterator::Init(ScanSpec *spec) {
         return PREDICT_FALSE(iter->IsFullyExhausted());
       }),
       iters_.end());
+  num_live_iters_ = iters_.size();
+  BuildLoserTree();
 
   initted_ = true;
   return Status::OK();
@@ -194,7 +212,7 @@ Status MergeIterator::Init(ScanSpec *spec) {
 
 bool MergeIterator::HasNext() const {
   CHECK(initted_);
-  return !iters_.empty();
+  return num_live_iters_ > 0;
 }
 
 Status MergeIterator::InitSubIterators(ScanSpec *spec) {
@@ -232,48 +250,115 @@ void MergeIterator::PrepareBatch(RowBlock* dst) {
   // in the currently queued up blocks.
   size_t available = 0;
   for (unique_ptr<MergeIterState> &iter : iters_) {
-    available += iter->remaining_in_block();
+    if (iter) {
+      available += iter->remaining_in_block();
+    }
   }
 
   dst->Resize(std::min(dst->row_capacity(), available));
 }
 
-// TODO: this is an obvious spot to add codegen - there's a ton of branching
-// and such around the comparisons. A simple experiment indicated there's some
-// 2x to be gained.
+bool MergeIterator::IterLess(size_t a, size_t b) const {
+  const MergeIterState* state_a = a < iters_.size() ? iters_[a].get() : nullptr;
+  const MergeIterState* state_b = b < iters_.size() ? iters_[b].get() : nullptr;
+  if (state_a == nullptr) return false;
+  if (state_b == nullptr) return true;
+  int cmp = schema_.Compare(state_a->next_row(), state_b->next_row());
+  return cmp < 0 || (cmp == 0 && a < b);
+}
+
+void MergeIterator::BuildLoserTree() {
+  size_t n = iters_.size();
+  loser_tree_.assign(n, 0);
+  if (n <= 1) return;
+
+  // Play the matches bottom-up, remembering the winner of each internal node
+  // so that it can go on to play at the node's parent.
+  vector<size_t> winners(2 * n);
+  for (size_t i = 0; i < n; i++) {
+    winners[n + i] = i;
+  }
+  for (size_t node = n - 1; node > 0; node--) {
+    size_t left = winners[2 * node];
+    size_t right = winners[2 * node + 1];
+    if (IterLess(right, left)) {
+      winners[node] = right;
+      loser_tree_[node] = left;
+    } else {
+      winners[node] = left;
+      loser_tree_[node] = right;
+    }
+  }
+  loser_tree_[0] = winners[1];
+}
+
+void MergeIterator::ReplayLoserTree(size_t idx) {
+  // Only the matches the previous winner played can have changed outcome.
+  size_t winner = idx;
+  for (size_t node = (iters_.size() + idx) / 2; node > 0; node /= 2) {
+    if (IterLess(loser_tree_[node], winner)) {
+      std::swap(loser_tree_[node], winner);
+    }
+  }
+  loser_tree_[0] = winner;
+}
+
+size_t MergeIterator::RunnerUp() const {
+  // The runner-up lost only to the winner, so it's the smallest of the losers
+  // of the matches on the winner's path to the root.
+  size_t winner = loser_tree_[0];
+  size_t runner_up = iters_.size();
+  for (size_t node = (iters_.size() + winner) / 2; node > 0; node /= 2) {
+    if (runner_up == iters_.size() || IterLess(loser_tree_[node], runner_up)) {
+      runner_up = loser_tree_[node];
+    }
+  }
+  return runner_up;
+}
+
 Status MergeIterator::MaterializeBlock(RowBlock *dst) {
   // Initialize the selection vector.
   // MergeIterState only returns selected rows.
   dst->selection_vector()->SetAllTrue();
-  for (size_t dst_row_idx = 0; dst_row_idx < dst->nrows(); dst_row_idx++) {
-    RowBlockRow dst_row = dst->row(dst_row_idx);
-
-    // Find the sub-iterator which is currently smallest
-    MergeIterState *smallest = nullptr;
-    ssize_t smallest_idx = -1;
-
-    // Typically the number of iters_ is not that large, so using a priority
-    // queue is not worth it
-    for (size_t i = 0; i < iters_.size(); i++) {
-      unique_ptr<MergeIterState> &state = iters_[i];
-
-      if (smallest == nullptr ||
-          schema_.Compare(state->next_row(), smallest->next_row()) < 0) {
-        smallest = state.get();
-        smallest_idx = i;
-      }
-    }
+  size_t dst_row_idx = 0;
+  while (dst_row_idx < dst->nrows()) {
+    size_t winner = loser_tree_[0];
+    MergeIterState* state = iters_[winner].get();
 
     // If no iterators had any row left, then we're done iterating.
-    if (PREDICT_FALSE(smallest == nullptr)) break;
-
-    // Otherwise, copy the row from the smallest one, and advance it
-    RETURN_NOT_OK(CopyRow(smallest->next_row(), &dst_row, dst->arena()));
-    RETURN_NOT_OK(smallest->Advance());
-
-    if (smallest->IsFullyExhausted()) {
-      iters_.erase(iters_.begin() + smallest_idx);
+    if (PREDICT_FALSE(state == nullptr)) break;
+
+    // Copy rows from the winner for as long as they sort before the runner-up's
+    // next row, which can't change while only the winner advances. When even
+    // the last row of the winner's block does, the rest of the block is copied
+    // without comparing each of its rows.
+    size_t runner_up = RunnerUp();
+    const MergeIterState* runner_up_state =
+        runner_up < iters_.size() ? iters_[runner_up].get() : nullptr;
+    while (dst_row_idx < dst->nrows()) {
+      size_t to_copy = 1;
+      if (runner_up_state == nullptr) {
+        to_copy = state->remaining_in_block();
+      } else {
+        int cmp = schema_.Compare(state->last_row(), runner_up_state->next_row());
+        if (cmp < 0 || (cmp == 0 && winner < runner_up)) {
+          to_copy = state->remaining_in_block();
+        }
+      }
+      for (; to_copy > 0 && dst_row_idx < dst->nrows(); to_copy--, dst_row_idx++) {
+        RowBlockRow dst_row = dst->row(dst_row_idx);
+        RETURN_NOT_OK(CopyRow(state->next_row(), &dst_row, dst->arena()));
+        RETURN_NOT_OK(state->Advance());
+      }
+      if (state->IsFullyExhausted()) {
+        iters_[winner].reset();
+        num_live_iters_--;
+        break;
+      }
+      if (!IterLess(winner, runner_up)) break;
     }
+
+    ReplayLoserTree(winner);
   }
 
   return Status::OK();
@@ -442,6 +527,7 @@ void UnionIterator::GetIteratorStats(std::vector<IteratorStats>* stats) const {
 
 MaterializingIterator::MaterializingIterator(shared_ptr<ColumnwiseIterator> iter)
     : iter_(move(iter)),
+      blocks_since_reorder_(0),
       disallow_pushdown_for_tests_(!FLAGS_materializing_iterator_do_pushdown),
       disallow_decoder_eval_(!FLAGS_materializing_iterator_decoder_eval) {
 }
@@ -452,6 +538,7 @@ Status MaterializingIterator::Init(ScanSpec *spec) {
   int32_t num_columns = schema().num_columns();
   col_idx_predicates_.clear();
   non_predicate_column_indexes_.clear();
+  blocks_since_reorder_ = 0;
 
   if (spec != nullptr && !disallow_pushdown_for_tests_) {
     col_idx_predicates_.reserve(spec->predicates().size());
@@ -464,7 +551,7 @@ Status MaterializingIterator::Init(ScanSpec *spec) {
         return Status::InvalidArgument("No such column", col_pred.first);
       }
       VLOG(1) << "Pushing down predicate " << pred.ToString();
-      col_idx_predicates_.emplace_back(col_idx, move(col_pred.second));
+      col_idx_predicates_.emplace_back(col_idx, col_pred.second);
     }
 
     for (int32_t col_idx = 0; col_idx < schema().num_columns(); col_idx++) {
@@ -485,14 +572,42 @@ Status MaterializingIterator::Init(ScanSpec *spec) {
 
   // Sort the predicates by selectivity so that the most selective are evaluated earlier.
   sort(col_idx_predicates_.begin(), col_idx_predicates_.end(),
-       [] (const tuple<int32_t, ColumnPredicate>& left,
-           const tuple<int32_t, ColumnPredicate>& right) {
-         return SelectivityComparator(get<1>(left), get<1>(right));
+       [] (const PredicateState& left, const PredicateState& right) {
+         return SelectivityComparator(left.pred, right.pred) < 0;
        });
 
   return Status::OK();
 }
 
+void MaterializingIterator::GetIteratorStats(vector<IteratorStats>* stats) const {
+  iter_->GetIteratorStats(stats);
+  for (const auto& state : col_idx_predicates_) {
+    DCHECK_LT(state.col_idx, stats->size());
+    IteratorStats& col_stats = (*stats)[state.col_idx];
+    col_stats.predicate_rows_evaluated += state.rows_evaluated;
+    col_stats.predicate_rows_filtered += state.rows_filtered;
+    col_stats.predicate_eval_cycles += state.eval_cycles;
+  }
+}
+
+void MaterializingIterator::ReorderPredicates() {
+  for (const auto& state : col_idx_predicates_) {
+    if (state.rows_evaluated == 0) {
+      return;
+    }
+  }
+  // Rows filtered per cycle is the predicate's selectivity divided by its
+  // per-row cost. Keep ties in their current order so that well-ordered
+  // predicates don't get shuffled around.
+  auto rank = [](const PredicateState& state) {
+    return static_cast<double>(state.rows_filtered) / std::max<int64_t>(state.eval_cycles, 1);
+  };
+  stable_sort(col_idx_predicates_.begin(), col_idx_predicates_.end(),
+              [&](const PredicateState& left, const PredicateState& right) {
+                return rank(left) > rank(right);
+              });
+}
+
 bool MaterializingIterator::HasNext() const {
   return iter_->HasNext();
 }
@@ -516,13 +631,26 @@ Status MaterializingIterator::MaterializeBlock(RowBlock *dst) {
   // been deleted.
   RETURN_NOT_OK(iter_->InitializeSelectionVector(dst->selection_vector()));
 
-  for (const auto& col_pred : col_idx_predicates_) {
+  int reorder_interval = FLAGS_materializing_iterator_predicate_reorder_interval;
+  if (col_idx_predicates_.size() > 1 && reorder_interval > 0 &&
+      ++blocks_since_reorder_ >= reorder_interval) {
+    ReorderPredicates();
+    blocks_since_reorder_ = 0;
+  }
+
+  int64_t rows_selected = col_idx_predicates_.empty() ?
+      0 : dst->selection_vector()->CountSelected();
+  for (auto& state : col_idx_predicates_) {
+    int64_t start_cycles = CycleClock::Now();
+
     // Materialize the column itself into the row block.
-    ColumnBlock dst_col(dst->column_block(get<0>(col_pred)));
-    ColumnMaterializationContext ctx(get<0>(col_pred),
-                                     &get<1>(col_pred),
+    ColumnBlock dst_col(dst->column_block(state.col_idx));
+    ColumnMaterializationContext ctx(state.col_idx,
+                                     &state.pred,
                                      &dst_col,
                                      dst->selection_vector());
+    // Rows filtered out by earlier predicates need not be decoded.
+    ctx.SetSkipUnselectedRows();
     // None predicates should be short-circuited in scan spec.
     DCHECK(ctx.pred()->predicate_type() != PredicateType::None);
     if (disallow_decoder_eval_) {
@@ -530,12 +658,18 @@ Status MaterializingIterator::MaterializeBlock(RowBlock *dst) {
     }
     RETURN_NOT_OK(iter_->MaterializeColumn(&ctx));
     if (ctx.DecoderEvalNotSupported()) {
-      get<1>(col_pred).Evaluate(dst_col, dst->selection_vector());
+      state.pred.Evaluate(dst_col, dst->selection_vector());
     }
 
+    int64_t rows_passed = dst->selection_vector()->CountSelected();
+    state.eval_cycles += CycleClock::Now() - start_cycles;
+    state.rows_evaluated += rows_selected;
+    state.rows_filtered += rows_selected - rows_passed;
+    rows_selected = rows_passed;
+
     // If after evaluating this predicate the entire row block has been filtered
     // out, we don't need to materialize other columns at all.
-    if (!dst->selection_vector()->AnySelected()) {
+    if (rows_selected == 0) {
       DVLOG(1) << "0/" << dst->nrows() << " passed predicate";
       return Status::OK();
     }
@@ -548,6 +682,7 @@ Status MaterializingIterator::MaterializeBlock(RowBlock *dst) {
                                      nullptr,
                                      &dst_col,
                                      dst->selection_vector());
+    ctx.SetSkipUnselectedRows();
     RETURN_NOT_OK(iter_->MaterializeColumn(&ctx));
   }
 
@@ -596,7 +731,10 @@ Status PredicateEvaluatingIterator::Init(ScanSpec *spec) {
   spec->RemovePredicates();
 
   // Sort the predicates by selectivity so that the most selective are evaluated earlier.
-  sort(col_idx_predicates_.begin(), col_idx_predicates_.end(), SelectivityComparator);
+  sort(col_idx_predicates_.begin(), col_idx_predicates_.end(),
+       [] (const ColumnPredicate& left, const ColumnPredicate& right) {
+         return SelectivityComparator(left, right) < 0;
+       });
 
   return Status::OK();
 }
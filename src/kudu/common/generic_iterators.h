@@ -23,6 +23,7 @@
 #include <string>
 #include <tuple>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include "kudu/common/iterator.h"
@@ -63,6 +64,22 @@ class MergeIterator : public RowwiseIterator {
   Status MaterializeBlock(RowBlock* dst);
   Status InitSubIterators(ScanSpec *spec);
 
+  // Returns true if the next row of sub-iterator 'a' sorts before the next
+  // row of sub-iterator 'b'. Exhausted sub-iterators sort after all others,
+  // and ties go to the sub-iterator with the lower index.
+  bool IterLess(size_t a, size_t b) const;
+
+  // Plays the tournament between all sub-iterators, filling 'loser_tree_'.
+  void BuildLoserTree();
+
+  // Replays the matches on the path from sub-iterator 'idx' to the root of
+  // the tree after 'idx', the previous winner, has advanced.
+  void ReplayLoserTree(size_t idx);
+
+  // Returns the index of the sub-iterator whose next row is the smallest
+  // after the current winner's, or iters_.size() if there's only one.
+  size_t RunnerUp() const;
+
   const Schema schema_;
 
   bool initted_;
@@ -70,8 +87,20 @@ class MergeIterator : public RowwiseIterator {
   // Holds the subiterators until Init is called.
   // This is required because we can't create a MergeIterState of an uninitialized iterator.
   std::deque<std::shared_ptr<RowwiseIterator> > orig_iters_;
+
+  // The sub-iterators being merged. Exhausted ones are reset to null rather than
+  // erased, so that their indexes in 'loser_tree_' stay valid.
   std::vector<std::unique_ptr<MergeIterState> > iters_;
 
+  // A tournament tree over 'iters_': element 0 is the index of the sub-iterator
+  // with the smallest next row, and each other element n is the loser of the
+  // match played at internal node n. The leaf of sub-iterator i is node
+  // iters_.size() + i, and the parent of node n is node n / 2.
+  std::vector<size_t> loser_tree_;
+
+  // The number of sub-iterators which aren't yet exhausted.
+  size_t num_live_iters_;
+
   // When the underlying iterators are initialized, each needs its own
   // copy of the scan spec in order to do its own pushdown calculations, etc.
   // The copies are allocated from this pool so they can be automatically freed
@@ -138,6 +167,11 @@ class UnionIterator : public RowwiseIterator {
 // block, columns with associated predicates are materialized first, and the
 // predicates evaluated. If the predicates succeed in filtering out an entire
 // batch, then other columns may avoid doing any IO.
+//
+// Predicates start out ordered by their estimated selectivity. As the scan
+// progresses, they're periodically reordered by the number of rows each one
+// has filtered out per CPU cycle spent on it, so that cheap and selective
+// predicates run first.
 class MaterializingIterator : public RowwiseIterator {
  public:
   explicit MaterializingIterator(std::shared_ptr<ColumnwiseIterator> iter);
@@ -153,22 +187,49 @@ class MaterializingIterator : public RowwiseIterator {
     return iter_->schema();
   }
 
-  virtual void GetIteratorStats(std::vector<IteratorStats>* stats) const OVERRIDE {
-    iter_->GetIteratorStats(stats);
-  }
+  // Returns the wrapped iterator's stats, along with the evaluation stats of
+  // the predicates pushed down into this iterator.
+  virtual void GetIteratorStats(std::vector<IteratorStats>* stats) const OVERRIDE;
 
   virtual Status NextBlock(RowBlock* dst) OVERRIDE;
 
  private:
   FRIEND_TEST(TestMaterializingIterator, TestPredicatePushdown);
+  FRIEND_TEST(TestMaterializingIterator, TestAdaptivePredicateOrder);
   FRIEND_TEST(TestPredicateEvaluatingIterator, TestPredicateEvaluation);
 
+  // A pushed down predicate, along with what it has cost and filtered out so
+  // far in this scan.
+  struct PredicateState {
+    PredicateState(int32_t col_idx, ColumnPredicate pred)
+        : col_idx(col_idx),
+          pred(std::move(pred)),
+          rows_evaluated(0),
+          rows_filtered(0),
+          eval_cycles(0) {
+    }
+
+    int32_t col_idx;
+    ColumnPredicate pred;
+    int64_t rows_evaluated;
+    int64_t rows_filtered;
+    int64_t eval_cycles;
+  };
+
   Status MaterializeBlock(RowBlock *dst);
 
+  // Reorders 'col_idx_predicates_' by the number of rows each predicate has
+  // filtered out per cycle. Does nothing until every predicate has been
+  // evaluated at least once.
+  void ReorderPredicates();
+
   std::shared_ptr<ColumnwiseIterator> iter_;
 
-  // List of (column index, predicate) in order of most to least selective.
-  std::vector<std::tuple<int32_t, ColumnPredicate>> col_idx_predicates_;
+  // The pushed down predicates, in the order in which they're evaluated.
+  std::vector<PredicateState> col_idx_predicates_;
+
+  // The number of blocks materialized since the predicates were last reordered.
+  int blocks_since_reorder_;
 
   // List of column indexes without predicates to materialize.
   std::vector<int32_t> non_predicate_column_indexes_;
@@ -28,22 +28,38 @@ using strings::Substitute;
 IteratorStats::IteratorStats()
     : data_blocks_read_from_disk(0),
       bytes_read_from_disk(0),
-      cells_read_from_disk(0) {
+      cells_read_from_disk(0),
+      cells_skipped(0),
+      predicate_rows_evaluated(0),
+      predicate_rows_filtered(0),
+      predicate_eval_cycles(0) {
 }
 
 string IteratorStats::ToString() const {
   return Substitute("data_blocks_read_from_disk=$0 "
                     "bytes_read_from_disk=$1 "
-                    "cells_read_from_disk=$2",
+                    "cells_read_from_disk=$2 "
+                    "cells_skipped=$3 "
+                    "predicate_rows_evaluated=$4 "
+                    "predicate_rows_filtered=$5 "
+                    "predicate_eval_cycles=$6",
                     data_blocks_read_from_disk,
                     bytes_read_from_disk,
-                    cells_read_from_disk);
+                    cells_read_from_disk,
+                    cells_skipped,
+                    predicate_rows_evaluated,
+                    predicate_rows_filtered,
+                    predicate_eval_cycles);
 }
 
 void IteratorStats::AddStats(const IteratorStats& other) {
   data_blocks_read_from_disk += other.data_blocks_read_from_disk;
   bytes_read_from_disk += other.bytes_read_from_disk;
   cells_read_from_disk += other.cells_read_from_disk;
+  cells_skipped += other.cells_skipped;
+  predicate_rows_evaluated += other.predicate_rows_evaluated;
+  predicate_rows_filtered += other.predicate_rows_filtered;
+  predicate_eval_cycles += other.predicate_eval_cycles;
   DCheckNonNegative();
 }
 
@@ -51,6 +67,10 @@ void IteratorStats::SubtractStats(const IteratorStats& other) {
   data_blocks_read_from_disk -= other.data_blocks_read_from_disk;
   bytes_read_from_disk -= other.bytes_read_from_disk;
   cells_read_from_disk -= other.cells_read_from_disk;
+  cells_skipped -= other.cells_skipped;
+  predicate_rows_evaluated -= other.predicate_rows_evaluated;
+  predicate_rows_filtered -= other.predicate_rows_filtered;
+  predicate_eval_cycles -= other.predicate_eval_cycles;
   DCheckNonNegative();
 }
 
@@ -58,6 +78,10 @@ void IteratorStats::DCheckNonNegative() const {
   DCHECK_GE(data_blocks_read_from_disk, 0);
   DCHECK_GE(bytes_read_from_disk, 0);
   DCHECK_GE(cells_read_from_disk, 0);
+  DCHECK_GE(cells_skipped, 0);
+  DCHECK_GE(predicate_rows_evaluated, 0);
+  DCHECK_GE(predicate_rows_filtered, 0);
+  DCHECK_GE(predicate_eval_cycles, 0);
 }
 
 
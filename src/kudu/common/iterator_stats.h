@@ -37,6 +37,20 @@ struct IteratorStats {
   // they were decoded/materialized.
   int64_t cells_read_from_disk;
 
+  // The number of cells which the iterator skipped without decoding them,
+  // because no row they belong to could match the scan's predicates. These
+  // cells may or may not have been read from disk.
+  int64_t cells_skipped;
+
+  // The number of rows still selected when a predicate on the column was
+  // evaluated, and how many of them it filtered out.
+  int64_t predicate_rows_evaluated;
+  int64_t predicate_rows_filtered;
+
+  // The CPU cycles spent materializing the column and evaluating its
+  // predicate, for as many rows as 'predicate_rows_evaluated' counts.
+  int64_t predicate_eval_cycles;
+
   // Add statistics contained 'other' to this object (for each field
   // in this object, increment it by the value of the equivalent field
   // in 'other').
@@ -91,6 +91,11 @@ struct KeyEncoderTraits<Type,
     Encode(key, dst);
   }
 
+  // Returns an upper bound on the size of EncodeWithSeparators()'s output.
+  static size_t MaxEncodedSize(const void* key, bool is_last) {
+    return sizeof(cpp_type);
+  }
+
   static Status DecodeKeyPortion(Slice* encoded_key,
                                  bool is_last,
                                  Arena* arena,
@@ -128,6 +133,12 @@ struct KeyEncoderTraits<BINARY, Buffer> {
     EncodeWithSeparators(*reinterpret_cast<const Slice*>(key), is_last, dst);
   }
 
+  // Returns an upper bound on the size of EncodeWithSeparators()'s output.
+  static size_t MaxEncodedSize(const void* key, bool is_last) {
+    size_t size = reinterpret_cast<const Slice*>(key)->size();
+    return is_last ? size : size * 2 + 2;
+  }
+
   // slice encoding that uses a separator to retain lexicographic
   // comparability.
   //
@@ -355,6 +366,48 @@ class KeyEncoder {
 template <typename Buffer>
 extern const KeyEncoder<Buffer>& GetKeyEncoder(const TypeInfo* typeinfo);
 
+template<typename Buffer, int Idx, DataType... Types>
+struct CompositeKeyColumns {
+  template<class RowType>
+  static size_t MaxEncodedSize(const RowType& row) { return 0; }
+
+  template<class RowType>
+  static void Encode(const RowType& row, Buffer* dst) {}
+};
+
+template<typename Buffer, int Idx, DataType Type, DataType... Rest>
+struct CompositeKeyColumns<Buffer, Idx, Type, Rest...> {
+  typedef KeyEncoderTraits<Type, Buffer> Traits;
+  typedef CompositeKeyColumns<Buffer, Idx + 1, Rest...> Next;
+  static const bool kIsLast = sizeof...(Rest) == 0;
+
+  template<class RowType>
+  static size_t MaxEncodedSize(const RowType& row) {
+    return Traits::MaxEncodedSize(row.cell_ptr(Idx), kIsLast) + Next::MaxEncodedSize(row);
+  }
+
+  template<class RowType>
+  static void Encode(const RowType& row, Buffer* dst) {
+    Traits::EncodeWithSeparators(row.cell_ptr(Idx), kIsLast, dst);
+    Next::Encode(row, dst);
+  }
+};
+
+// Encodes the key of a row whose key columns have the physical types 'Types',
+// in order. Unlike going through the KeyEncoder of each column, the encoding
+// of every column is inlined, and the buffer is only grown once up front.
+//
+// Used by Schema::EncodeComparableKey() for the most common key shapes.
+template<typename Buffer, DataType... Types>
+struct CompositeKeyEncoder {
+  template<class RowType>
+  static void Encode(const RowType& row, Buffer* dst) {
+    typedef CompositeKeyColumns<Buffer, 0, Types...> Columns;
+    dst->reserve(dst->size() + Columns::MaxEncodedSize(row));
+    Columns::Encode(row, dst);
+  }
+};
+
 extern const bool IsTypeAllowableInKey(const TypeInfo* typeinfo);
 
 } // namespace kudu
@@ -155,7 +155,10 @@ int PushUpperBoundKeyPredicates(ColIdxIter first,
       memcpy(row->mutable_cell_ptr(*col_idx_it), predicate->raw_lower(), size);
       pushed_predicates++;
       final_predicate = predicate;
-    } else if (predicate->predicate_type() == PredicateType::Range) {
+    } else if (predicate->predicate_type() == PredicateType::Range ||
+               predicate->predicate_type() == PredicateType::InBloomFilter) {
+      // The bounds of an IN Bloom filter predicate constrain the key like
+      // those of a range predicate.
       if (predicate->raw_upper() != nullptr) {
         memcpy(row->mutable_cell_ptr(*col_idx_it), predicate->raw_upper(), size);
         pushed_predicates++;
@@ -166,6 +169,14 @@ int PushUpperBoundKeyPredicates(ColIdxIter first,
       // to the remaining columns (below), which is the maximally tight
       // constraint.
       break;
+    } else if (predicate->predicate_type() == PredicateType::InList) {
+      // An IN list is bounded above by its largest value. Like an equality
+      // predicate the bound is inclusive, but no further columns may be
+      // pushed, as with a range predicate.
+      memcpy(row->mutable_cell_ptr(*col_idx_it), predicate->raw_values().back(), size);
+      pushed_predicates++;
+      final_predicate = predicate;
+      break;
     } else {
       LOG(FATAL) << "unexpected predicate type can not be pushed into key";
     }
@@ -174,9 +185,10 @@ int PushUpperBoundKeyPredicates(ColIdxIter first,
   // If no predicates were pushed, no need to do any more work.
   if (pushed_predicates == 0) { return 0; }
 
-  // Step 2: If the final predicate is an equality predicate, increment the
-  // key to convert it to an exclusive upper bound.
-  if (final_predicate->predicate_type() == PredicateType::Equality) {
+  // Step 2: If the final predicate is an equality or IN list predicate,
+  // increment the key to convert it to an exclusive upper bound.
+  if (final_predicate->predicate_type() == PredicateType::Equality ||
+      final_predicate->predicate_type() == PredicateType::InList) {
     if (!IncrementKey(first, std::next(first, pushed_predicates), row, arena)) {
       // If the increment fails then this bound is is not constraining the keyspace.
       return 0;
@@ -208,13 +220,18 @@ int PushLowerBoundKeyPredicates(ColIdxIter first,
     if (predicate->predicate_type() == PredicateType::Equality) {
       memcpy(row->mutable_cell_ptr(*col_idx_it), predicate->raw_lower(), size);
       pushed_predicates++;
-    } else if (predicate->predicate_type() == PredicateType::Range) {
+    } else if (predicate->predicate_type() == PredicateType::Range ||
+               predicate->predicate_type() == PredicateType::InBloomFilter) {
       if (predicate->raw_lower() != nullptr) {
         memcpy(row->mutable_cell_ptr(*col_idx_it), predicate->raw_lower(), size);
         pushed_predicates++;
       } else {
         break;
       }
+    } else if (predicate->predicate_type() == PredicateType::InList) {
+      // An IN list is bounded below by its smallest value.
+      memcpy(row->mutable_cell_ptr(*col_idx_it), predicate->raw_values().front(), size);
+      pushed_predicates++;
     } else {
       LOG(FATAL) << "unexpected predicate type can not be pushed into key";
     }
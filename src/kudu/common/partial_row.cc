@@ -191,6 +191,14 @@ Status KuduPartialRow::Set(int32_t column_idx, const uint8_t* val) {
       RETURN_NOT_OK(SetUnixTimeMicros(column_idx, *reinterpret_cast<const int64_t*>(val)));
       break;
     };
+    case DECIMAL32: {
+      RETURN_NOT_OK(SetUnscaledDecimal(column_idx, *reinterpret_cast<const int32_t*>(val)));
+      break;
+    };
+    case DECIMAL64: {
+      RETURN_NOT_OK(SetUnscaledDecimal(column_idx, *reinterpret_cast<const int64_t*>(val)));
+      break;
+    };
     default: {
       return Status::InvalidArgument("Unknown column type in schema",
                                      column_schema.ToString());
@@ -273,6 +281,33 @@ Status KuduPartialRow::SetDouble(int col_idx, double val) {
   return Set<TypeTraits<DOUBLE> >(col_idx, val);
 }
 
+Status KuduPartialRow::SetUnscaledDecimal(const Slice& col_name, int64_t val) {
+  int col_idx;
+  RETURN_NOT_OK(FindColumn(*schema_, col_name, &col_idx));
+  return SetUnscaledDecimal(col_idx, val);
+}
+
+Status KuduPartialRow::SetUnscaledDecimal(int col_idx, int64_t val) {
+  const ColumnSchema& col = schema_->column(col_idx);
+  DataType type = col.type_info()->type();
+  if (PREDICT_FALSE(!IsDecimalType(type))) {
+    return Status::InvalidArgument(
+        Substitute("invalid type decimal provided for column '$0' (expected $1)",
+                   col.name(), col.type_info()->name()));
+  }
+  int64_t max = MaxUnscaledDecimal(col.type_attributes().precision);
+  if (PREDICT_FALSE(val > max || val < -max)) {
+    return Status::InvalidArgument(
+        Substitute("value $0 out of range for column '$1' of type $2",
+                   DecimalToString(val, col.type_attributes().scale),
+                   col.name(), col.TypeToString()));
+  }
+  if (type == DECIMAL32) {
+    return Set<TypeTraits<DECIMAL32> >(col_idx, static_cast<int32_t>(val));
+  }
+  return Set<TypeTraits<DECIMAL64> >(col_idx, val);
+}
+
 Status KuduPartialRow::SetBinary(const Slice& col_name, const Slice& val) {
   return SetBinaryCopy(col_name, val);
 }
@@ -587,6 +622,22 @@ Status KuduPartialRow::GetBinary(int col_idx, Slice* val) const {
   return Get<TypeTraits<BINARY> >(col_idx, val);
 }
 
+Status KuduPartialRow::GetUnscaledDecimal(const Slice& col_name, int64_t* val) const {
+  int col_idx;
+  RETURN_NOT_OK(FindColumn(*schema_, col_name, &col_idx));
+  return GetUnscaledDecimal(col_idx, val);
+}
+
+Status KuduPartialRow::GetUnscaledDecimal(int col_idx, int64_t* val) const {
+  if (schema_->column(col_idx).type_info()->type() == DECIMAL32) {
+    int32_t val32;
+    RETURN_NOT_OK(Get<TypeTraits<DECIMAL32> >(col_idx, &val32));
+    *val = val32;
+    return Status::OK();
+  }
+  return Get<TypeTraits<DECIMAL64> >(col_idx, val);
+}
+
 template<typename T>
 Status KuduPartialRow::Get(const Slice& col_name,
                            typename T::cpp_type* val) const {
@@ -124,6 +124,25 @@ class KUDU_EXPORT KuduPartialRow {
   Status SetDouble(int col_idx, double val) WARN_UNUSED_RESULT;
   ///@}
 
+  /// @name Setters for decimal columns.
+  ///
+  /// Set the value of a decimal column from its unscaled value, i.e. the
+  /// value multiplied by 10 to the power of the scale of the column. For
+  /// example, 123.45 is set as 12345 in a column with a scale of 2.
+  ///
+  /// @param [in] col_name
+  ///   Name of the target column.
+  /// @param [in] val
+  ///   The unscaled value to set.
+  /// @return Operation result status. Return a bad Status if the column is
+  ///   not a decimal, or if the value has more digits than the precision
+  ///   of the column allows.
+  ///
+  ///@{
+  Status SetUnscaledDecimal(const Slice& col_name, int64_t val) WARN_UNUSED_RESULT;
+  Status SetUnscaledDecimal(int col_idx, int64_t val) WARN_UNUSED_RESULT;
+  ///@}
+
   /// @name Setters for binary/string columns by name (copying).
   ///
   /// Set the binary/string value for a column by name, copying the specified
@@ -375,6 +394,25 @@ class KUDU_EXPORT KuduPartialRow {
   Status GetDouble(int col_idx, double* val) const WARN_UNUSED_RESULT;
   ///@}
 
+  /// @name Getters for decimal columns.
+  ///
+  /// Get the unscaled value of a decimal column. See SetUnscaledDecimal().
+  ///
+  /// @param [in] col_name
+  ///   Name of the column.
+  /// @param [out] val
+  ///   Placeholder for the result value.
+  /// @return Operation result status. Return a bad Status if at least one
+  ///   of the following is @c true:
+  ///     @li The column is not a decimal.
+  ///     @li The value is unset.
+  ///     @li The value is @c NULL.
+  ///
+  ///@{
+  Status GetUnscaledDecimal(const Slice& col_name, int64_t* val) const WARN_UNUSED_RESULT;
+  Status GetUnscaledDecimal(int col_idx, int64_t* val) const WARN_UNUSED_RESULT;
+  ///@}
+
   /// @name Getters for string/binary column by column name.
   ///
   /// Get the string/binary value for a column by its name.
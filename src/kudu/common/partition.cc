@@ -809,6 +809,18 @@ string PartitionSchema::DisplayString(const Schema& schema) const {
   return display_string;
 }
 
+bool PartitionSchema::RangeKeyIsPrimaryKeyPrefix(const Schema& schema) const {
+  if (range_schema_.column_ids.size() > schema.num_key_columns()) {
+    return false;
+  }
+  for (int i = 0; i < range_schema_.column_ids.size(); i++) {
+    if (range_schema_.column_ids[i] != schema.column_id(i)) {
+      return false;
+    }
+  }
+  return true;
+}
+
 bool PartitionSchema::Equals(const PartitionSchema& other) const {
   if (this == &other) return true;
 
@@ -962,6 +974,12 @@ namespace {
       case UNIXTIME_MICROS:
         RETURN_NOT_OK(row->SetInt64(idx, INT64_MIN + 1));
         break;
+      case DECIMAL32:
+      case DECIMAL64: {
+        int precision = row->schema()->column(idx).type_attributes().precision;
+        RETURN_NOT_OK(row->SetUnscaledDecimal(idx, -MaxUnscaledDecimal(precision) + 1));
+        break;
+      }
       case STRING:
         RETURN_NOT_OK(row->SetStringCopy(idx, Slice("\0", 1)));
         break;
@@ -1022,6 +1040,18 @@ namespace {
         }
         break;
       }
+      case DECIMAL32:
+      case DECIMAL64: {
+        int64_t value;
+        RETURN_NOT_OK(row->GetUnscaledDecimal(idx, &value));
+        int precision = row->schema()->column(idx).type_attributes().precision;
+        if (value < MaxUnscaledDecimal(precision)) {
+          RETURN_NOT_OK(row->SetUnscaledDecimal(idx, value + 1));
+        } else {
+          *success = false;
+        }
+        break;
+      }
       case BINARY: {
         Slice value;
         RETURN_NOT_OK(row->GetBinary(idx, &value));
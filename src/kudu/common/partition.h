@@ -205,6 +205,11 @@ class PartitionSchema {
   // Returns true if the other partition schema is equivalent to this one.
   bool Equals(const PartitionSchema& other) const;
 
+  // Returns true if the range partition columns are a prefix of the primary
+  // key columns of 'schema', so that the partition keys of the rows of a
+  // partition are in the same order as their primary keys.
+  bool RangeKeyIsPrimaryKeyPrefix(const Schema& schema) const;
+
   // Transforms an exclusive lower bound range partition key into an inclusive
   // lower bound range partition key.
   Status MakeLowerBoundRangePartitionKeyInclusive(KuduPartialRow* row) const;
@@ -513,6 +513,66 @@ TEST(TestPartitionPruner, TestHashPruning) {
           ColumnPredicate::Equality(schema.column(1), &one),
           ColumnPredicate::Equality(schema.column(2), &two) },
         1);
+
+  // The values 0 through 9 of a hash to both of its buckets.
+  int8_t values[10];
+  vector<const void*> all_values;
+  for (int8_t i = 0; i < 10; i++) {
+    values[i] = i;
+    all_values.push_back(&values[i]);
+  }
+  auto InList = [&] (int col_idx, vector<const void*> in_values) {
+    return ColumnPredicate::InList(schema.column(col_idx), &in_values);
+  };
+
+  // a IN (0, 1, ..., 9);
+  Check({ InList(0, all_values) }, 4);
+
+  // a IN (0, 1, ..., 9);
+  // b = 1;
+  // c = 2;
+  Check({ InList(0, all_values),
+          ColumnPredicate::Equality(schema.column(1), &one),
+          ColumnPredicate::Equality(schema.column(2), &two) },
+        2);
+
+  // a IN (0, 1, ..., 9);
+  // b IN (0, 1, ..., 9);
+  // c IN (0, 1, ..., 9);
+  Check({ InList(0, all_values), InList(1, all_values), InList(2, all_values) }, 4);
+
+  // a IN (0, 1);
+  // b IN (1, 2);
+  // c = 2;
+  // Each combination falls in one of the partitions selected by a single
+  // value of each column, so the remaining partitions are between 1 and 4.
+  {
+    ScanSpec spec;
+    spec.AddPredicate(InList(0, { &values[0], &values[1] }));
+    spec.AddPredicate(InList(1, { &values[1], &values[2] }));
+    spec.AddPredicate(ColumnPredicate::Equality(schema.column(2), &two));
+    PartitionPruner pruner;
+    pruner.Init(schema, partition_schema, spec);
+    size_t remaining = count_if(partitions.begin(), partitions.end(),
+                                [&] (const Partition& p) { return !pruner.ShouldPrune(p); });
+    ASSERT_GE(remaining, 1U);
+    ASSERT_LE(remaining, 4U);
+    for (int8_t a_idx = 0; a_idx < 2; a_idx++) {
+      for (int8_t b_idx = 1; b_idx < 3; b_idx++) {
+        ScanSpec point_spec;
+        point_spec.AddPredicate(ColumnPredicate::Equality(schema.column(0), &values[a_idx]));
+        point_spec.AddPredicate(ColumnPredicate::Equality(schema.column(1), &values[b_idx]));
+        point_spec.AddPredicate(ColumnPredicate::Equality(schema.column(2), &two));
+        PartitionPruner point_pruner;
+        point_pruner.Init(schema, partition_schema, point_spec);
+        for (const auto& partition : partitions) {
+          if (!point_pruner.ShouldPrune(partition)) {
+            ASSERT_FALSE(pruner.ShouldPrune(partition));
+          }
+        }
+      }
+    }
+  }
 }
 
 TEST(TestPartitionPruner, TestPruning) {
@@ -41,6 +41,8 @@ using std::distance;
 using std::find;
 using std::get;
 using std::iota;
+using std::sort;
+using std::unique;
 using std::lower_bound;
 using std::make_tuple;
 using std::memcpy;
@@ -149,6 +151,11 @@ void EncodeRangeKeysFromPredicates(const Schema& schema,
     key_util::EncodeKey(col_idxs, row, range_key_end);
   }
 }
+// The maximum number of combinations of the values of the IN-list and
+// equality predicates on the columns of a hash component which are hashed to
+// find the buckets the scan may touch. Past that, the component is
+// considered unconstrained.
+const size_t kMaxHashValueCombinations = 1024;
 } // anonymous namespace
 
 void PartitionPruner::Init(const Schema& schema,
@@ -221,6 +228,12 @@ void PartitionPruner::Init(const Schema& schema,
   //    of the number of buckets of each unconstrained hash component which come
   //    before a final constrained component. If there are no unconstrained hash
   //    components, then the number of partition key ranges is one.
+  //
+  // A hash component is also constrained, to a set of buckets rather than a
+  // single one, when its columns have IN-list or equality predicates: each
+  // combination of the allowed values is hashed. Such a component multiplies
+  // the number of partition key ranges by the number of its buckets, and
+  // ranges which end up adjacent are merged at the end.
 
   // Step 1: Build the range portion of the partition key.
   string range_lower_bound;
@@ -244,33 +257,57 @@ void PartitionPruner::Init(const Schema& schema,
 
   // Step 2: Create the hash bucket portion of the partition key.
 
-  // The list of hash buckets per hash component, or none if the component is
-  // not constrained.
-  vector<optional<uint32_t>> hash_buckets;
+  // The sorted list of hash buckets per hash component, or none if the
+  // component is not constrained.
+  vector<optional<vector<uint32_t>>> hash_buckets;
   hash_buckets.reserve(partition_schema.hash_bucket_schemas_.size());
   for (int hash_idx = 0; hash_idx < partition_schema.hash_bucket_schemas_.size(); hash_idx++) {
     const auto& hash_bucket_schema = partition_schema.hash_bucket_schemas_[hash_idx];
-    string encoded_columns;
+    // The encoded hash columns of each combination of allowed values.
+    vector<string> encoded_columns(1);
     bool can_prune = true;
     for (int col_offset = 0; col_offset < hash_bucket_schema.column_ids.size(); col_offset++) {
       const ColumnSchema& column = schema.column_by_id(hash_bucket_schema.column_ids[col_offset]);
       const ColumnPredicate* predicate = FindOrNull(scan_spec.predicates(), column.name());
-      if (predicate == nullptr || predicate->predicate_type() != PredicateType::Equality) {
+      vector<const void*> values;
+      if (predicate != nullptr && predicate->predicate_type() == PredicateType::Equality) {
+        values.push_back(predicate->raw_lower());
+      } else if (predicate != nullptr && predicate->predicate_type() == PredicateType::InList) {
+        values = predicate->raw_values();
+      }
+      if (values.empty() ||
+          encoded_columns.size() * values.size() > kMaxHashValueCombinations) {
         can_prune = false;
         break;
       }
 
       const KeyEncoder<string>& encoder = GetKeyEncoder<string>(column.type_info());
-      encoder.Encode(predicate->raw_lower(),
-                     col_offset + 1 == hash_bucket_schema.column_ids.size(),
-                     &encoded_columns);
+      bool is_last = col_offset + 1 == hash_bucket_schema.column_ids.size();
+      vector<string> new_encoded_columns;
+      new_encoded_columns.reserve(encoded_columns.size() * values.size());
+      for (const string& prefix : encoded_columns) {
+        for (const void* value : values) {
+          string encoded = prefix;
+          encoder.Encode(value, is_last, &encoded);
+          new_encoded_columns.push_back(move(encoded));
+        }
+      }
+      encoded_columns.swap(new_encoded_columns);
     }
     if (can_prune) {
-      hash_buckets.push_back(partition_schema.BucketForEncodedColumns(encoded_columns,
-                                                                      hash_bucket_schema));
-    } else {
-      hash_buckets.push_back(boost::none);
+      vector<uint32_t> buckets;
+      buckets.reserve(encoded_columns.size());
+      for (const string& encoded : encoded_columns) {
+        buckets.push_back(partition_schema.BucketForEncodedColumns(encoded, hash_bucket_schema));
+      }
+      sort(buckets.begin(), buckets.end());
+      buckets.erase(unique(buckets.begin(), buckets.end()), buckets.end());
+      if (buckets.size() < hash_bucket_schema.num_buckets) {
+        hash_buckets.emplace_back(move(buckets));
+        continue;
+      }
     }
+    hash_buckets.push_back(boost::none);
   }
 
   // The index of the final constrained component in the partition key.
@@ -285,17 +322,18 @@ void PartitionPruner::Init(const Schema& schema,
                         distance(hash_buckets.rbegin(),
                                  find_if(hash_buckets.rbegin(),
                                          hash_buckets.rend(),
-                                         [] (const optional<uint32_t>& x) { return x; }));
+                                         [] (const optional<vector<uint32_t>>& x) {
+                                           return static_cast<bool>(x);
+                                         }));
   }
 
   // Build up a set of partition key ranges out of the hash components.
   //
-  // Each constrained hash component simply appends its bucket number to the
+  // Each hash component results in creating a new partition key range for each
+  // bucket the scan may touch: the buckets it's constrained to, or all of its
+  // buckets if it's unconstrained. The bucket number is appended to the
   // partition key ranges (possibly incrementing the upper bound by one bucket
   // number if this is the final constraint, see note 2 in the example above).
-  //
-  // Each unconstrained hash component results in creating a new partition key
-  // range for each bucket of the hash component.
   vector<tuple<string, string>> partition_key_ranges(1);
   const KeyEncoder<string>& hash_encoder = GetKeyEncoder<string>(GetTypeInfo(UINT32));
   for (int hash_idx = 0; hash_idx < constrained_index; hash_idx++) {
@@ -305,38 +343,44 @@ void PartitionPruner::Init(const Schema& schema,
     // exclusive.
     bool is_last = hash_idx + 1 == constrained_index && range_upper_bound.empty();
 
+    vector<uint32_t> buckets;
     if (hash_buckets[hash_idx]) {
-      // This hash component is constrained by equality predicates to a single
-      // hash bucket.
-      uint32_t bucket = *hash_buckets[hash_idx];
-      uint32_t bucket_upper = is_last ? bucket + 1 : bucket;
-      for (auto& partition_key_range : partition_key_ranges) {
-        hash_encoder.Encode(&bucket, &get<0>(partition_key_range));
-        hash_encoder.Encode(&bucket_upper, &get<1>(partition_key_range));
-      }
+      buckets = *hash_buckets[hash_idx];
     } else {
-      const auto& hash_bucket_schema = partition_schema.hash_bucket_schemas_[hash_idx];
-      // Add a partition key range for each possible hash bucket.
-      vector<tuple<string, string>> new_partition_key_ranges;
-      for (const auto& partition_key_range : partition_key_ranges) {
-        for (uint32_t bucket = 0; bucket < hash_bucket_schema.num_buckets; bucket++) {
-          uint32_t bucket_upper = is_last ? bucket + 1 : bucket;
-          string lower = get<0>(partition_key_range);
-          string upper = get<1>(partition_key_range);
-          hash_encoder.Encode(&bucket, &lower);
-          hash_encoder.Encode(&bucket_upper, &upper);
-          new_partition_key_ranges.push_back(make_tuple(move(lower), move(upper)));
-        }
+      buckets.resize(partition_schema.hash_bucket_schemas_[hash_idx].num_buckets);
+      iota(buckets.begin(), buckets.end(), 0);
+    }
+    vector<tuple<string, string>> new_partition_key_ranges;
+    new_partition_key_ranges.reserve(partition_key_ranges.size() * buckets.size());
+    for (const auto& partition_key_range : partition_key_ranges) {
+      for (uint32_t bucket : buckets) {
+        uint32_t bucket_upper = is_last ? bucket + 1 : bucket;
+        string lower = get<0>(partition_key_range);
+        string upper = get<1>(partition_key_range);
+        hash_encoder.Encode(&bucket, &lower);
+        hash_encoder.Encode(&bucket_upper, &upper);
+        new_partition_key_ranges.push_back(make_tuple(move(lower), move(upper)));
       }
-      partition_key_ranges.swap(new_partition_key_ranges);
     }
+    partition_key_ranges.swap(new_partition_key_ranges);
   }
 
-  // Step 3: append the (possibly empty) range bounds to the partition key ranges.
+  // Step 3: append the (possibly empty) range bounds to the partition key ranges,
+  // merging the ranges which are adjacent, such as those of consecutive buckets
+  // of the final constrained component.
+  vector<tuple<string, string>> merged_ranges;
+  merged_ranges.reserve(partition_key_ranges.size());
   for (auto& range : partition_key_ranges) {
     get<0>(range).append(range_lower_bound);
     get<1>(range).append(range_upper_bound);
+    if (!merged_ranges.empty() && !get<1>(merged_ranges.back()).empty() &&
+        get<1>(merged_ranges.back()) == get<0>(range)) {
+      get<1>(merged_ranges.back()) = move(get<1>(range));
+    } else {
+      merged_ranges.emplace_back(move(range));
+    }
   }
+  partition_key_ranges.swap(merged_ranges);
 
   // Step 4: remove all partition key ranges past the scan spec's upper bound partition key.
   if (!scan_spec.exclusive_upper_bound_partition_key().empty()) {
@@ -0,0 +1,50 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#ifndef KUDU_COMMON_ROW_CHECKSUM_H
+#define KUDU_COMMON_ROW_CHECKSUM_H
+
+#include <stdint.h>
+
+#include "kudu/gutil/macros.h"
+#include "kudu/util/crc.h"
+#include "kudu/util/faststring.h"
+
+namespace kudu {
+
+class RowBlockRow;
+class Schema;
+
+// Computes the CRC32C of rows the way checksum scans do. The CRC of a row
+// covers the position of each column in the row's schema along with its
+// cell. Checksum scans sum up the CRCs of the rows they read, so that the
+// checksum of a set of rows doesn't depend on the order they're read in.
+class RowChecksummer {
+ public:
+  RowChecksummer();
+
+  uint32_t RowCrc32(const Schema& schema, const RowBlockRow& row);
+
+ private:
+  faststring tmp_buf_;
+  crc::Crc* const crc_;
+
+  DISALLOW_COPY_AND_ASSIGN(RowChecksummer);
+};
+
+} // namespace kudu
+
+#endif // KUDU_COMMON_ROW_CHECKSUM_H
@@ -22,7 +22,9 @@
 #include "kudu/common/partial_row.h"
 #include "kudu/common/row_operations.h"
 #include "kudu/common/schema.h"
+#include "kudu/common/wire_protocol.pb.h"
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/bitmap.h"
 #include "kudu/util/test_util.h"
 
 using std::shared_ptr;
@@ -689,4 +691,136 @@ TEST_F(RowOperationsTest, SplitKeyRoundTrip) {
   CHECK(!row2->IsColumnSet("missing"));
 }
 
+namespace {
+
+// Build a columnar run of 'num_rows' inserts into the RowOperationsTest schema,
+// where the string of every other row is NULL.
+void BuildColumnarInserts(int num_rows, ColumnarInsertsPB* pb) {
+  pb->set_num_rows(num_rows);
+  ColumnarInsertsPB::Column* key = pb->add_columns();
+  ColumnarInsertsPB::Column* int_val = pb->add_columns();
+  ColumnarInsertsPB::Column* string_val = pb->add_columns();
+  key->set_column_idx(0);
+  int_val->set_column_idx(1);
+  string_val->set_column_idx(2);
+
+  vector<uint32_t> offsets = { 0 };
+  string_val->mutable_non_null_bitmap()->assign(BitmapSize(num_rows), '\0');
+  for (int32_t i = 0; i < num_rows; i++) {
+    int32_t v = i * 10;
+    key->mutable_data()->append(reinterpret_cast<const char*>(&i), sizeof(i));
+    int_val->mutable_data()->append(reinterpret_cast<const char*>(&v), sizeof(v));
+    if (i % 2 == 0) {
+      string_val->mutable_varlen_data()->append(Substitute("s$0", i));
+      BitmapSet(reinterpret_cast<uint8_t*>(&(*string_val->mutable_non_null_bitmap())[0]), i);
+    }
+    offsets.push_back(string_val->varlen_data().size());
+  }
+  string_val->set_data(reinterpret_cast<const char*>(offsets.data()),
+                       offsets.size() * sizeof(uint32_t));
+}
+
+} // anonymous namespace
+
+// Test that columnar runs of inserts are decoded in their positions among the
+// row operations, including when only some of the rows of a run are encoded.
+TEST_F(RowOperationsTest, ColumnarInsertsRoundTrip) {
+  ColumnarInsertsPB rows;
+  BuildColumnarInserts(4, &rows);
+
+  KuduPartialRow row(&schema_without_ids_);
+  ASSERT_OK(row.SetInt32("key", 100));
+  ASSERT_OK(row.SetInt32("int_val", 1000));
+
+  RowOperationsPB pb;
+  RowOperationsPBEncoder enc(&pb);
+  enc.AddColumnarInserts(schema_without_ids_, rows, { 0, 1, 2, 3 });
+  enc.Add(RowOperationsPB::UPDATE, row);
+  enc.AddColumnarInserts(schema_without_ids_, rows, { 3, 0 });
+
+  RowOperationsPBDecoder dec(&pb, &schema_without_ids_, &schema_, &arena_);
+  vector<DecodedRowOperation> ops;
+  ASSERT_OK(dec.DecodeOperations(&ops));
+  ASSERT_EQ(7, ops.size());
+  EXPECT_EQ("INSERT (int32 key=0, int32 int_val=0, string string_val=s0)",
+            ops[0].ToString(schema_));
+  EXPECT_EQ("INSERT (int32 key=1, int32 int_val=10, string string_val=NULL)",
+            ops[1].ToString(schema_));
+  EXPECT_EQ("INSERT (int32 key=3, int32 int_val=30, string string_val=NULL)",
+            ops[3].ToString(schema_));
+  EXPECT_EQ("MUTATE (int32 key=100) SET int_val=1000", ops[4].ToString(schema_));
+  EXPECT_EQ("INSERT (int32 key=3, int32 int_val=30, string string_val=NULL)",
+            ops[5].ToString(schema_));
+  EXPECT_EQ("INSERT (int32 key=0, int32 int_val=0, string string_val=s0)",
+            ops[6].ToString(schema_));
+
+  // A single row can also be decoded back into a partial row.
+  KuduPartialRow decoded(&schema_without_ids_);
+  ASSERT_OK(RowOperationsPBDecoder::DecodeColumnarInsertRow(rows, 2, false, &decoded));
+  EXPECT_EQ("int32 key=2, int32 int_val=20, string string_val=s2", decoded.ToString());
+  KuduPartialRow key_only(&schema_without_ids_);
+  ASSERT_OK(RowOperationsPBDecoder::DecodeColumnarInsertRow(rows, 2, true, &key_only));
+  EXPECT_EQ("int32 key=2", key_only.ToString());
+
+  // A run of inserts with a missing required column is rejected.
+  rows.mutable_columns()->RemoveLast();
+  rows.mutable_columns()->RemoveLast();
+  RowOperationsPB bad_pb;
+  RowOperationsPBEncoder(&bad_pb).AddColumnarInserts(schema_without_ids_, rows, { 0 });
+  RowOperationsPBDecoder bad_dec(&bad_pb, &schema_without_ids_, &schema_, &arena_);
+  ops.clear();
+  Status s = bad_dec.DecodeOperations(&ops);
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+  ASSERT_STR_CONTAINS(s.ToString(), "No value provided for required column");
+}
+
+// Test that the operations of several requests can be appended to one
+// another, keeping their indirect data.
+TEST_F(RowOperationsTest, AppendRowOperations) {
+  RowOperationsPB first;
+  RowOperationsPB second;
+  {
+    KuduPartialRow row(&schema_without_ids_);
+    ASSERT_OK(row.SetInt32("key", 1));
+    ASSERT_OK(row.SetInt32("int_val", 10));
+    ASSERT_OK(row.SetStringCopy("string_val", "first"));
+    RowOperationsPBEncoder(&first).Add(RowOperationsPB::INSERT, row);
+  }
+  {
+    RowOperationsPBEncoder enc(&second);
+    KuduPartialRow row(&schema_without_ids_);
+    ASSERT_OK(row.SetInt32("key", 2));
+    ASSERT_OK(row.SetInt32("int_val", 20));
+    ASSERT_OK(row.SetNull("string_val"));
+    enc.Add(RowOperationsPB::INSERT, row);
+    ASSERT_OK(row.SetInt32("key", 1));
+    ASSERT_OK(row.Unset("int_val"));
+    ASSERT_OK(row.SetStringCopy("string_val", "second"));
+    enc.Add(RowOperationsPB::UPDATE, row);
+  }
+
+  RowOperationsPB merged;
+  int num_ops;
+  ASSERT_OK(AppendRowOperations(schema_without_ids_, first, &merged, &num_ops));
+  ASSERT_EQ(1, num_ops);
+  ASSERT_OK(AppendRowOperations(schema_without_ids_, second, &merged, &num_ops));
+  ASSERT_EQ(2, num_ops);
+
+  RowOperationsPBDecoder dec(&merged, &schema_without_ids_, &schema_, &arena_);
+  vector<DecodedRowOperation> ops;
+  ASSERT_OK(dec.DecodeOperations(&ops));
+  ASSERT_EQ(3, ops.size());
+  EXPECT_EQ("INSERT (int32 key=1, int32 int_val=10, string string_val=first)",
+            ops[0].ToString(schema_));
+  EXPECT_EQ("INSERT (int32 key=2, int32 int_val=20, string string_val=NULL)",
+            ops[1].ToString(schema_));
+  EXPECT_EQ("MUTATE (int32 key=1) SET string_val=second", ops[2].ToString(schema_));
+
+  // Truncated operations are rejected.
+  second.mutable_rows()->resize(second.rows().size() - 1);
+  RowOperationsPB bad_merged;
+  Status s = AppendRowOperations(schema_without_ids_, second, &bad_merged, &num_ops);
+  ASSERT_TRUE(s.IsCorruption()) << s.ToString();
+}
+
 } // namespace kudu
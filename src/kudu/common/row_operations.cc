@@ -27,6 +27,7 @@
 #include "kudu/util/slice.h"
 
 using std::string;
+using std::vector;
 using strings::Substitute;
 
 namespace kudu {
@@ -59,7 +60,8 @@ string DecodedRowOperation::ToString(const Schema& schema) const {
 }
 
 RowOperationsPBEncoder::RowOperationsPBEncoder(RowOperationsPB* pb)
-  : pb_(pb) {
+  : pb_(pb),
+    num_ops_(0) {
 }
 
 RowOperationsPBEncoder::~RowOperationsPBEncoder() {
@@ -119,6 +121,70 @@ void RowOperationsPBEncoder::Add(RowOperationsPB::Type op_type, const KuduPartia
   }
 
   dst->resize(reinterpret_cast<char*>(dst_ptr) - &(*dst)[0]);
+  num_ops_++;
+}
+
+void RowOperationsPBEncoder::AddColumnarInserts(const Schema& schema,
+                                                const ColumnarInsertsPB& rows,
+                                                const vector<int>& row_idxs) {
+  const int num_rows = row_idxs.size();
+  ColumnarInsertsPB* dst = pb_->add_columnar_inserts();
+  dst->set_first_op_idx(num_ops_);
+  dst->set_num_rows(num_rows);
+  num_ops_ += num_rows;
+
+  // Commonly, all of the rows go to the same tablet, and can be copied as is.
+  bool all_rows = num_rows == rows.num_rows();
+  for (int i = 0; all_rows && i < num_rows; i++) {
+    all_rows = row_idxs[i] == i;
+  }
+  if (all_rows) {
+    dst->mutable_columns()->CopyFrom(rows.columns());
+    return;
+  }
+
+  // Otherwise, gather the rows of each column.
+  for (const ColumnarInsertsPB::Column& src_col : rows.columns()) {
+    ColumnarInsertsPB::Column* dst_col = dst->add_columns();
+    dst_col->set_column_idx(src_col.column_idx());
+    const ColumnSchema& col = schema.column(src_col.column_idx());
+    const char* src_data = src_col.data().data();
+    string* dst_data = dst_col->mutable_data();
+
+    if (col.type_info()->physical_type() == BINARY) {
+      const uint32_t* src_offsets = reinterpret_cast<const uint32_t*>(src_data);
+      string* dst_varlen = dst_col->mutable_varlen_data();
+      dst_data->resize((num_rows + 1) * sizeof(uint32_t));
+      uint32_t* dst_offsets = reinterpret_cast<uint32_t*>(&(*dst_data)[0]);
+      dst_offsets[0] = 0;
+      for (int i = 0; i < num_rows; i++) {
+        int r = row_idxs[i];
+        dst_varlen->append(&src_col.varlen_data()[src_offsets[r]],
+                           src_offsets[r + 1] - src_offsets[r]);
+        dst_offsets[i + 1] = dst_varlen->size();
+      }
+    } else {
+      int size = col.type_info()->size();
+      dst_data->resize(num_rows * size);
+      char* dst_ptr = &(*dst_data)[0];
+      for (int i = 0; i < num_rows; i++) {
+        memcpy(dst_ptr + i * size, src_data + row_idxs[i] * size, size);
+      }
+    }
+
+    if (src_col.has_non_null_bitmap()) {
+      const uint8_t* src_bitmap = reinterpret_cast<const uint8_t*>(
+          src_col.non_null_bitmap().data());
+      string* dst_bitmap = dst_col->mutable_non_null_bitmap();
+      dst_bitmap->assign(BitmapSize(num_rows), '\0');
+      uint8_t* dst_bitmap_ptr = reinterpret_cast<uint8_t*>(&(*dst_bitmap)[0]);
+      for (int i = 0; i < num_rows; i++) {
+        if (BitmapTest(src_bitmap, row_idxs[i])) {
+          BitmapSet(dst_bitmap_ptr, i);
+        }
+      }
+    }
+  }
 }
 
 // ------------------------------------------------------------
@@ -539,6 +605,143 @@ Status RowOperationsPBDecoder::DecodeSplitRow(const ClientServerMapping& mapping
   return Status::OK();
 }
 
+Status RowOperationsPBDecoder::DecodeColumnarInserts(const ColumnarInsertsPB& rows,
+                                                     const uint8_t* prototype_row_storage,
+                                                     const ClientServerMapping& mapping,
+                                                     vector<DecodedRowOperation>* ops) {
+  const int num_rows = rows.num_rows();
+  if (PREDICT_FALSE(num_rows < 0)) {
+    return Status::Corruption(Substitute("Bad number of columnar rows: $0", num_rows));
+  }
+
+  // Start every row from the prototype row, with none of the columns set.
+  const int tablet_bm_size = BitmapSize(tablet_schema_->num_columns());
+  vector<uint8_t*> row_storage(num_rows);
+  vector<uint8_t*> isset_bitmaps(num_rows);
+  for (int i = 0; i < num_rows; i++) {
+    row_storage[i] = reinterpret_cast<uint8_t*>(
+        dst_arena_->AllocateBytesAligned(tablet_row_size_, 8));
+    isset_bitmaps[i] = reinterpret_cast<uint8_t*>(dst_arena_->AllocateBytes(tablet_bm_size));
+    if (PREDICT_FALSE(!row_storage[i] || !isset_bitmaps[i])) {
+      return Status::RuntimeError("Out of memory");
+    }
+    memcpy(row_storage[i], prototype_row_storage, tablet_row_size_);
+    memset(isset_bitmaps[i], 0, tablet_bm_size);
+  }
+
+  // Fill in one column at a time.
+  vector<bool> provided(client_schema_->num_columns());
+  for (const ColumnarInsertsPB::Column& col_pb : rows.columns()) {
+    int client_col_idx = col_pb.column_idx();
+    if (PREDICT_FALSE(client_col_idx < 0 ||
+                      client_col_idx >= client_schema_->num_columns() ||
+                      provided[client_col_idx])) {
+      return Status::Corruption(Substitute("Bad columnar column index: $0", client_col_idx));
+    }
+    provided[client_col_idx] = true;
+    int tablet_col_idx = mapping.client_to_tablet_idx(client_col_idx);
+    DCHECK_GE(tablet_col_idx, 0);
+    const ColumnSchema& col = tablet_schema_->column(tablet_col_idx);
+
+    bool is_binary = col.type_info()->physical_type() == BINARY;
+    size_t cell_size = is_binary ? sizeof(uint32_t) : col.type_info()->size();
+    if (PREDICT_FALSE(col_pb.data().size() != (num_rows + (is_binary ? 1 : 0)) * cell_size)) {
+      return Status::Corruption("Bad size of columnar data for column", col.ToString());
+    }
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(col_pb.data().data());
+    const uint8_t* non_null_bitmap = nullptr;
+    if (col_pb.has_non_null_bitmap()) {
+      if (PREDICT_FALSE(col_pb.non_null_bitmap().size() < BitmapSize(num_rows))) {
+        return Status::Corruption("Bad columnar non-null bitmap for column", col.ToString());
+      }
+      non_null_bitmap = reinterpret_cast<const uint8_t*>(col_pb.non_null_bitmap().data());
+    }
+
+    for (int i = 0; i < num_rows; i++) {
+      ContiguousRow row(tablet_schema_, row_storage[i]);
+      BitmapSet(isset_bitmaps[i], tablet_col_idx);
+
+      bool is_null = non_null_bitmap && !BitmapTest(non_null_bitmap, i);
+      if (col.is_nullable()) {
+        row.set_null(tablet_col_idx, is_null);
+      } else if (PREDICT_FALSE(is_null)) {
+        return Status::InvalidArgument("NULL value not allowed for non-nullable column",
+                                       col.ToString());
+      }
+      if (is_null) {
+        continue;
+      }
+
+      uint8_t* dst = row.mutable_cell_ptr(tablet_col_idx);
+      if (is_binary) {
+        uint32_t start;
+        uint32_t end;
+        memcpy(&start, data + i * cell_size, cell_size);
+        memcpy(&end, data + (i + 1) * cell_size, cell_size);
+        if (PREDICT_FALSE(start > end || end > col_pb.varlen_data().size())) {
+          return Status::Corruption("Bad columnar offsets for column", col.ToString());
+        }
+        Slice val(&col_pb.varlen_data()[start], end - start);
+        memcpy(dst, &val, sizeof(Slice));
+      } else {
+        memcpy(dst, data + i * cell_size, cell_size);
+      }
+    }
+  }
+
+  // As for row operations, the columns which aren't provided must either be
+  // nullable or have a default, which was set in the prototype row.
+  for (int client_col_idx = 0; client_col_idx < client_schema_->num_columns(); client_col_idx++) {
+    if (provided[client_col_idx]) {
+      continue;
+    }
+    const ColumnSchema& col = tablet_schema_->column(mapping.client_to_tablet_idx(client_col_idx));
+    if (PREDICT_FALSE(!(col.is_nullable() || col.has_write_default()))) {
+      return Status::InvalidArgument("No value provided for required column",
+                                     col.ToString());
+    }
+  }
+
+  for (int i = 0; i < num_rows; i++) {
+    DecodedRowOperation op;
+    op.type = RowOperationsPB::INSERT;
+    op.row_data = row_storage[i];
+    op.isset_bitmap = isset_bitmaps[i];
+    ops->push_back(op);
+  }
+  return Status::OK();
+}
+
+Status RowOperationsPBDecoder::DecodeColumnarInsertRow(const ColumnarInsertsPB& rows,
+                                                       int row_idx,
+                                                       bool key_columns_only,
+                                                       KuduPartialRow* row) {
+  const Schema& schema = *row->schema();
+  DCHECK_LT(row_idx, rows.num_rows());
+  for (const ColumnarInsertsPB::Column& col_pb : rows.columns()) {
+    int col_idx = col_pb.column_idx();
+    if (key_columns_only && col_idx >= schema.num_key_columns()) {
+      continue;
+    }
+    if (col_pb.has_non_null_bitmap() &&
+        !BitmapTest(reinterpret_cast<const uint8_t*>(col_pb.non_null_bitmap().data()), row_idx)) {
+      RETURN_NOT_OK(row->SetNull(col_idx));
+      continue;
+    }
+    const char* data = col_pb.data().data();
+    if (schema.column(col_idx).type_info()->physical_type() == BINARY) {
+      const uint32_t* offsets = reinterpret_cast<const uint32_t*>(data);
+      Slice val(&col_pb.varlen_data()[offsets[row_idx]],
+                offsets[row_idx + 1] - offsets[row_idx]);
+      RETURN_NOT_OK(row->Set(col_idx, reinterpret_cast<const uint8_t*>(&val)));
+    } else {
+      int size = schema.column(col_idx).type_info()->size();
+      RETURN_NOT_OK(row->Set(col_idx, reinterpret_cast<const uint8_t*>(data + row_idx * size)));
+    }
+  }
+  return Status::OK();
+}
+
 Status RowOperationsPBDecoder::DecodeOperations(vector<DecodedRowOperation>* ops) {
   // TODO: there's a bug here, in that if a client passes some column
   // in its schema that has been deleted on the server, it will fail
@@ -562,7 +765,21 @@ Status RowOperationsPBDecoder::DecodeOperations(vector<DecodedRowOperation>* ops
   ContiguousRow prototype_row(tablet_schema_, prototype_row_storage);
   SetupPrototypeRow(*tablet_schema_, &prototype_row);
 
-  while (HasNext()) {
+  // The columnar runs of inserts are spliced in at their positions among the
+  // row operations.
+  const size_t first_op = ops->size();
+  int next_run = 0;
+  while (true) {
+    while (next_run < pb_->columnar_inserts_size() &&
+           pb_->columnar_inserts(next_run).first_op_idx() == ops->size() - first_op) {
+      RETURN_NOT_OK(DecodeColumnarInserts(pb_->columnar_inserts(next_run),
+                                          prototype_row_storage, mapping, ops));
+      next_run++;
+    }
+    if (!HasNext()) {
+      break;
+    }
+
     RowOperationsPB::Type type;
     RETURN_NOT_OK(ReadOpType(&type));
     DecodedRowOperation op;
@@ -590,6 +807,68 @@ Status RowOperationsPBDecoder::DecodeOperations(vector<DecodedRowOperation>* ops
 
     ops->push_back(op);
   }
+  if (PREDICT_FALSE(next_run < pb_->columnar_inserts_size())) {
+    return Status::Corruption(Substitute("Bad position of columnar inserts: $0",
+                                         pb_->columnar_inserts(next_run).first_op_idx()));
+  }
+  return Status::OK();
+}
+
+Status AppendRowOperations(const Schema& client_schema,
+                           const RowOperationsPB& src,
+                           RowOperationsPB* dst,
+                           int* num_ops) {
+  if (PREDICT_FALSE(src.columnar_inserts_size() > 0)) {
+    return Status::NotSupported("Cannot append columnar inserts");
+  }
+  const int bm_size = BitmapSize(client_schema.num_columns());
+  const bool has_nullables = client_schema.has_nullables();
+  const uintptr_t indirect_base = dst->indirect_data().size();
+
+  string* rows = dst->mutable_rows();
+  const size_t rows_base = rows->size();
+  rows->append(src.rows());
+  dst->mutable_indirect_data()->append(src.indirect_data());
+
+  // Walk the appended operations as RowOperationsPBDecoder does, moving the
+  // indirect slices past the indirect data which was already there.
+  uint8_t* p = reinterpret_cast<uint8_t*>(&(*rows)[0]) + rows_base;
+  const uint8_t* end = reinterpret_cast<uint8_t*>(&(*rows)[0]) + rows->size();
+  int n = 0;
+  while (p < end) {
+    p++;  // The operation type.
+    if (PREDICT_FALSE(end - p < (has_nullables ? 2 : 1) * bm_size)) {
+      return Status::Corruption("Cannot find isset or null bitmap");
+    }
+    const uint8_t* isset_bm = p;
+    p += bm_size;
+    const uint8_t* null_bm = nullptr;
+    if (has_nullables) {
+      null_bm = p;
+      p += bm_size;
+    }
+    for (int i = 0; i < client_schema.num_columns(); i++) {
+      if (!BitmapTest(isset_bm, i) || (has_nullables && BitmapTest(null_bm, i))) {
+        continue;
+      }
+      const ColumnSchema& col = client_schema.column(i);
+      int size = col.type_info()->size();
+      if (PREDICT_FALSE(end - p < size)) {
+        return Status::Corruption("Not enough data for column", col.ToString());
+      }
+      if (col.type_info()->physical_type() == BINARY) {
+        // The slices may be unaligned.
+        Slice slice;
+        memcpy(&slice, p, sizeof(Slice));
+        uintptr_t offset = reinterpret_cast<uintptr_t>(slice.data()) + indirect_base;
+        slice = Slice(reinterpret_cast<const uint8_t*>(offset), slice.size());
+        memcpy(p, &slice, sizeof(Slice));
+      }
+      p += size;
+    }
+    n++;
+  }
+  *num_ops = n;
   return Status::OK();
 }
 
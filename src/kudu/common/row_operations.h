@@ -42,9 +42,18 @@ class RowOperationsPBEncoder {
   // Append this partial row to the protobuf.
   void Add(RowOperationsPB::Type type, const KuduPartialRow& row);
 
+  // Append INSERTs of the rows at 'row_idxs' of 'rows', a run of inserts
+  // whose column indexes refer to 'schema', as a single columnar run.
+  void AddColumnarInserts(const Schema& schema,
+                          const ColumnarInsertsPB& rows,
+                          const std::vector<int>& row_idxs);
+
  private:
   RowOperationsPB* pb_;
 
+  // The number of operations appended so far.
+  int num_ops_;
+
   DISALLOW_COPY_AND_ASSIGN(RowOperationsPBEncoder);
 };
 
@@ -79,6 +88,14 @@ class RowOperationsPBDecoder {
 
   Status DecodeOperations(std::vector<DecodedRowOperation>* ops);
 
+  // Sets the columns of 'row' to the values of the row at 'row_idx' of
+  // 'rows', whose column indexes must refer to row->schema(). If
+  // 'key_columns_only' is true, only the key columns are set.
+  static Status DecodeColumnarInsertRow(const ColumnarInsertsPB& rows,
+                                        int row_idx,
+                                        bool key_columns_only,
+                                        KuduPartialRow* row);
+
  private:
   Status ReadOpType(RowOperationsPB::Type* type);
   Status ReadIssetBitmap(const uint8_t** bitmap);
@@ -102,6 +119,12 @@ class RowOperationsPBDecoder {
   Status DecodeSplitRow(const ClientServerMapping& mapping,
                         DecodedRowOperation* op);
 
+  // Decode the INSERTs of 'rows', appending them to 'ops'.
+  Status DecodeColumnarInserts(const ColumnarInsertsPB& rows,
+                               const uint8_t* prototype_row_storage,
+                               const ClientServerMapping& mapping,
+                               std::vector<DecodedRowOperation>* ops);
+
   const RowOperationsPB* const pb_;
   const Schema* const client_schema_;
   const Schema* const tablet_schema_;
@@ -114,5 +137,14 @@ class RowOperationsPBDecoder {
 
   DISALLOW_COPY_AND_ASSIGN(RowOperationsPBDecoder);
 };
+
+// Appends the row operations of 'src' to those of 'dst', both encoded against
+// 'client_schema', rebasing the offsets of the indirect data of 'src'. Sets
+// 'num_ops' to the number of operations appended. Columnar inserts are not
+// supported. On error, 'dst' is left in an unspecified state.
+Status AppendRowOperations(const Schema& client_schema,
+                           const RowOperationsPB& src,
+                           RowOperationsPB* dst,
+                           int* num_ops);
 } // namespace kudu
 #endif /* KUDU_COMMON_ROW_OPERATIONS_H */
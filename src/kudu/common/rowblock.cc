@@ -43,7 +43,7 @@ void SelectionVector::Resize(size_t n_rows) {
 }
 
 size_t SelectionVector::CountSelected() const {
-  return Bits::Count(&bitmap_[0], n_bytes_);
+  return BitmapCountSet(&bitmap_[0], n_rows_);
 }
 
 bool SelectionVector::AnySelected() const {
@@ -70,6 +70,33 @@ bool SelectionVector::AnySelected() const {
   return false;
 }
 
+void SelectionVector::ClearToSelectAtMost(size_t max_rows) {
+  if (max_rows >= n_rows_) {
+    return;
+  }
+  size_t selected = 0;
+  for (size_t i = 0; i < n_bytes_; i++) {
+    size_t in_byte = Bits::Count(&bitmap_[i], 1);
+    if (selected + in_byte <= max_rows) {
+      selected += in_byte;
+      continue;
+    }
+    // Keep only the lowest selected bits of this byte, and clear everything
+    // after it.
+    for (int bit = 0; bit < 8; bit++) {
+      if (bitmap_[i] & (1 << bit)) {
+        if (selected < max_rows) {
+          selected++;
+        } else {
+          bitmap_[i] &= ~(1 << bit);
+        }
+      }
+    }
+    memset(&bitmap_[i + 1], 0, n_bytes_ - i - 1);
+    return;
+  }
+}
+
 //////////////////////////////
 // RowBlock
 //////////////////////////////
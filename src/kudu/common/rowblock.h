@@ -63,6 +63,22 @@ class SelectionVector {
   // This is equivalent to (CountSelected() > 0), but faster.
   bool AnySelected() const;
 
+  // Unselects rows so that at most the first 'max_rows' selected rows
+  // remain selected.
+  void ClearToSelectAtMost(size_t max_rows);
+
+  // Find the first selected row at or after 'row'. Returns false if there
+  // is none. Skips over 64 unselected rows at a time.
+  bool FindFirstSelected(size_t row, size_t* idx) const {
+    DCHECK_LE(row, n_rows_);
+    return BitmapFindFirstSet(&bitmap_[0], row, n_rows_, idx);
+  }
+
+  // Find the last selected row. Returns false if there is none.
+  bool FindLastSelected(size_t* idx) const {
+    return BitmapFindLastSet(&bitmap_[0], n_rows_, idx);
+  }
+
   bool IsRowSelected(size_t row) const {
     DCHECK_LT(row, n_rows_);
     return BitmapTest(&bitmap_[0], row);
@@ -147,6 +163,20 @@ class SelectionVectorView {
     DCHECK_LE(nrows, sel_vec_->nrows() - row_offset_);
     BitmapChangeBits(sel_vec_->mutable_bitmap(), row_offset_, nrows, false);
   }
+  // Returns true if any of the next 'nrows' bits is set.
+  bool AnySelected(size_t nrows) const {
+    DCHECK_LE(nrows, sel_vec_->nrows() - row_offset_);
+    if (nrows == 0) {
+      return false;
+    }
+    return !BitmapIsAllZero(sel_vec_->bitmap(), row_offset_, row_offset_ + nrows);
+  }
+  // Clears 'nrows' bits beginning at 'row_idx', relative to the current
+  // position of the view.
+  void ClearBits(size_t row_idx, size_t nrows) {
+    DCHECK_LE(row_idx + nrows, sel_vec_->nrows() - row_offset_);
+    BitmapChangeBits(sel_vec_->mutable_bitmap(), row_offset_ + row_idx, nrows, false);
+  }
  private:
   SelectionVector* sel_vec_;
   size_t row_offset_;
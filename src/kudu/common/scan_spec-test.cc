@@ -31,6 +31,8 @@
 #include "kudu/util/test_macros.h"
 #include "kudu/util/test_util.h"
 
+using std::vector;
+
 namespace kudu {
 
 class TestScanSpec : public KuduTest {
@@ -70,6 +72,20 @@ class TestScanSpec : public KuduTest {
     }
   }
 
+  template<class T>
+  void AddInPredicate(ScanSpec* spec, StringPiece col, const vector<T>& values) {
+    int idx = schema_.find_column(col);
+    CHECK(idx != Schema::kColumnNotFound);
+
+    vector<const void*> copied_values;
+    for (const T& val : values) {
+      void* val_void = arena_.AllocateBytes(sizeof(val));
+      memcpy(val_void, &val, sizeof(val));
+      copied_values.push_back(val_void);
+    }
+    spec->AddPredicate(ColumnPredicate::InList(schema_.column(idx), &copied_values));
+  }
+
   // Set the lower bound of the spec to the provided row. The row must outlive
   // the spec.
   void SetLowerBound(ScanSpec* spec, const KuduPartialRow& row) {
@@ -155,6 +171,22 @@ TEST_F(CompositeIntKeysTest, TestPrefixLowerBound) {
   EXPECT_EQ("PK >= (int8 a=126, int8 b=-128, int8 c=-128)", spec.ToString(schema_));
 }
 
+// Predicates: a IN (100, 1, 10) AND b = 3
+TEST_F(CompositeIntKeysTest, TestInListPrefix) {
+  ScanSpec spec;
+  AddInPredicate<int8_t>(&spec, "a", { 100, 1, 10 });
+  AddPredicate<int8_t>(&spec, "b", EQ, 3);
+  SCOPED_TRACE(spec.ToString(schema_));
+  spec.OptimizeScan(schema_, &arena_, &pool_, true);
+
+  // The IN list bounds the key range, but must still be evaluated, along with
+  // the predicates after it.
+  EXPECT_EQ("PK >= (int8 a=1, int8 b=3, int8 c=-128) AND "
+            "PK < (int8 a=101, int8 b=-128, int8 c=-128) AND "
+            "`a` IN (1, 10, 100) AND `b` = 3",
+            spec.ToString(schema_));
+}
+
 // Predicates: a >= 3 AND b >= 4 AND c >= 5
 TEST_F(CompositeIntKeysTest, TestConsecutiveLowerRangePredicates) {
   ScanSpec spec;
@@ -656,6 +688,14 @@ TEST_F(SingleIntKeyTest, TestRedundantUpperBound) {
             spec.ToString(schema_));
 }
 
+TEST_F(SingleIntKeyTest, TestInList) {
+  ScanSpec spec;
+  AddInPredicate<int8_t>(&spec, "a", { 127, 64, 100 });
+  SCOPED_TRACE(spec.ToString(schema_));
+  spec.OptimizeScan(schema_, &arena_, &pool_, true);
+  EXPECT_EQ("PK >= (int8 a=64) AND `a` IN (64, 100, 127)", spec.ToString(schema_));
+}
+
 TEST_F(SingleIntKeyTest, TestNoPredicates) {
   ScanSpec spec;
   SCOPED_TRACE(spec.ToString(schema_));
@@ -156,6 +156,13 @@ void ScanSpec::PushPredicatesIntoPrimaryKeyBounds(const Schema& schema,
       } else if (type == PredicateType::Range) {
         RemovePredicate(column);
         break;
+      } else if (type == PredicateType::InList) {
+        // The primary key bounds only cover the range of the IN list's
+        // values, so the predicate must still be evaluated.
+        break;
+      } else if (type == PredicateType::InBloomFilter) {
+        // Likewise the bounds don't capture the Bloom filters.
+        break;
       } else {
         LOG(FATAL) << "Can not remove unknown predicate type";
       }
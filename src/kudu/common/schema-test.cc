@@ -116,6 +116,40 @@ TEST(TestSchema, TestReset) {
   ASSERT_TRUE(schema2.initialized());
 }
 
+TEST(TestSchema, TestDecimalColumns) {
+  ColumnSchema price("price", DECIMAL64, false, nullptr, nullptr,
+                     ColumnStorageAttributes(), ColumnTypeAttributes(12, 2));
+  ASSERT_EQ("price[decimal64(12, 2) NOT NULL]", price.ToString());
+  int64_t val = -123456;
+  ASSERT_EQ("-1234.56", price.Stringify(&val));
+
+  // The type attributes are part of the type of the column.
+  ColumnSchema price2("price", DECIMAL64, false, nullptr, nullptr,
+                      ColumnStorageAttributes(), ColumnTypeAttributes(12, 3));
+  ASSERT_FALSE(price.EqualsType(price2));
+  ASSERT_TRUE(price.EqualsPhysicalType(price2));
+
+  Schema schema;
+  ASSERT_OK(schema.Reset({ ColumnSchema("key", INT32), price }, 1));
+
+  // The precision must fit the storage of the type, and the scale must fit
+  // the precision.
+  Status s = schema.Reset({ ColumnSchema("key", INT32),
+                            ColumnSchema("d", DECIMAL32, false, nullptr, nullptr,
+                                         ColumnStorageAttributes(),
+                                         ColumnTypeAttributes(10, 2)) }, 1);
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+  ASSERT_STR_CONTAINS(s.ToString(), "Precision of d must be between 1 and 9");
+  s = schema.Reset({ ColumnSchema("key", INT32),
+                     ColumnSchema("d", DECIMAL64, false, nullptr, nullptr,
+                                  ColumnStorageAttributes(),
+                                  ColumnTypeAttributes(4, 5)) }, 1);
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+  ASSERT_STR_CONTAINS(s.ToString(), "Scale of d must be between 0 and its precision");
+  s = schema.Reset({ ColumnSchema("key", INT32), ColumnSchema("d", DECIMAL64) }, 1);
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+}
+
 // Test for KUDU-943, a bug where we suspected that Variant didn't behave
 // correctly with empty strings.
 TEST(TestSchema, TestEmptyVariant) {
@@ -396,6 +430,73 @@ TEST(TestSchema, TestCreateProjection) {
             partial_schema.ToString());
 }
 
+// Encode the key of 'row' through the KeyEncoder of each column.
+static string EncodeKeyGenerically(const ConstContiguousRow& row) {
+  const Schema& schema = *row.schema();
+  faststring fs;
+  for (int i = 0; i < schema.num_key_columns(); i++) {
+    bool is_last = i == schema.num_key_columns() - 1;
+    GetKeyEncoder<faststring>(schema.column(i).type_info()).Encode(row.cell_ptr(i), is_last, &fs);
+  }
+  return fs.ToString();
+}
+
+// Test that the specialized encoders of the common key shapes encode keys the
+// same way as the per-column encoders.
+TEST(TestKeyEncoder, TestSpecializedKeyShapes) {
+  const Slice kStr("a\0b", 3);
+  faststring fs;
+  {
+    Schema schema({ ColumnSchema("k", INT32), ColumnSchema("v", INT32) }, 1);
+    RowBuilder rb(schema);
+    rb.AddInt32(-12345);
+    rb.AddInt32(0);
+    ConstContiguousRow row(&rb.schema(), rb.data());
+    ASSERT_EQ(EncodeKeyGenerically(row), schema.EncodeComparableKey(row, &fs).ToString());
+  }
+  {
+    Schema schema({ ColumnSchema("k", UNIXTIME_MICROS) }, 1);
+    RowBuilder rb(schema);
+    rb.AddInt64(1234567890123L);
+    ConstContiguousRow row(&rb.schema(), rb.data());
+    ASSERT_EQ(EncodeKeyGenerically(row), schema.EncodeComparableKey(row, &fs).ToString());
+  }
+  {
+    Schema schema({ ColumnSchema("k", STRING) }, 1);
+    RowBuilder rb(schema);
+    rb.AddString(kStr);
+    ConstContiguousRow row(&rb.schema(), rb.data());
+    ASSERT_EQ(EncodeKeyGenerically(row), schema.EncodeComparableKey(row, &fs).ToString());
+  }
+  {
+    Schema schema({ ColumnSchema("k1", STRING), ColumnSchema("k2", INT64) }, 2);
+    RowBuilder rb(schema);
+    rb.AddString(kStr);
+    rb.AddInt64(-1);
+    ConstContiguousRow row(&rb.schema(), rb.data());
+    ASSERT_EQ(EncodeKeyGenerically(row), schema.EncodeComparableKey(row, &fs).ToString());
+  }
+  {
+    Schema schema({ ColumnSchema("k1", INT32), ColumnSchema("k2", INT64),
+                    ColumnSchema("k3", BINARY) }, 3);
+    RowBuilder rb(schema);
+    rb.AddInt32(7);
+    rb.AddInt64(8);
+    rb.AddBinary(kStr);
+    ConstContiguousRow row(&rb.schema(), rb.data());
+    ASSERT_EQ(EncodeKeyGenerically(row), schema.EncodeComparableKey(row, &fs).ToString());
+  }
+  {
+    // Not one of the specialized shapes.
+    Schema schema({ ColumnSchema("k1", INT64), ColumnSchema("k2", STRING) }, 2);
+    RowBuilder rb(schema);
+    rb.AddInt64(8);
+    rb.AddString(kStr);
+    ConstContiguousRow row(&rb.schema(), rb.data());
+    ASSERT_EQ(EncodeKeyGenerically(row), schema.EncodeComparableKey(row, &fs).ToString());
+  }
+}
+
 #ifdef NDEBUG
 TEST(TestKeyEncoder, BenchmarkSimpleKey) {
   faststring fs;
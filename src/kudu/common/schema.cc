@@ -46,10 +46,21 @@ static const ColumnId  kFirstColumnId(10);
 #endif
 
 string ColumnStorageAttributes::ToString() const {
-  return strings::Substitute("encoding=$0, compression=$1, cfile_block_size=$2",
+  return strings::Substitute("encoding=$0, compression=$1, cfile_block_size=$2$3$4",
                              EncodingType_Name(encoding),
                              CompressionType_Name(compression),
-                             cfile_block_size);
+                             cfile_block_size,
+                             bitmap_index ? ", bitmap_index" : "",
+                             ttl_seconds > 0 ?
+                                 strings::Substitute(", ttl_seconds=$0", ttl_seconds) : "");
+}
+
+string ColumnTypeAttributes::ToStringForType(DataType type) const {
+  if (IsDecimalType(type)) {
+    return strings::Substitute("($0, $1)", static_cast<int>(precision),
+                               static_cast<int>(scale));
+  }
+  return "";
 }
 
 // TODO: include attributes_.ToString() -- need to fix unit tests
@@ -61,11 +72,28 @@ string ColumnSchema::ToString() const {
 }
 
 string ColumnSchema::TypeToString() const {
-  return strings::Substitute("$0 $1",
+  return strings::Substitute("$0$1 $2",
                              type_info_->name(),
+                             type_attributes_.ToStringForType(type_info_->type()),
                              is_nullable_ ? "NULLABLE" : "NOT NULL");
 }
 
+void ColumnSchema::AppendDebugStringForValue(const void* cell, string* ret) const {
+  switch (type_info_->type()) {
+    case DECIMAL32:
+      ret->append(DecimalToString(*reinterpret_cast<const int32_t*>(cell),
+                                  type_attributes_.scale));
+      break;
+    case DECIMAL64:
+      ret->append(DecimalToString(*reinterpret_cast<const int64_t*>(cell),
+                                  type_attributes_.scale));
+      break;
+    default:
+      type_info_->AppendDebugStringForValue(cell, ret);
+      break;
+  }
+}
+
 size_t ColumnSchema::memory_footprint_excluding_this() const {
   // Rough approximation.
   return name_.capacity();
@@ -109,6 +137,7 @@ void Schema::CopyFrom(const Schema& other) {
   }
 
   has_nullables_ = other.has_nullables_;
+  key_shape_ = other.key_shape_;
 }
 
 void Schema::swap(Schema& other) {
@@ -119,13 +148,41 @@ void Schema::swap(Schema& other) {
   name_to_index_.swap(other.name_to_index_);
   id_to_index_.swap(other.id_to_index_);
   std::swap(has_nullables_, other.has_nullables_);
+  std::swap(key_shape_, other.key_shape_);
+}
+
+namespace {
+
+// Verifies that the precision and scale of a decimal column fit its type.
+Status ValidateTypeAttributes(const ColumnSchema& col) {
+  DataType type = col.type_info()->type();
+  if (!IsDecimalType(type)) {
+    return Status::OK();
+  }
+  int precision = col.type_attributes().precision;
+  int scale = col.type_attributes().scale;
+  int max_precision = type == DECIMAL32 ? kMaxDecimal32Precision : kMaxDecimal64Precision;
+  if (PREDICT_FALSE(precision < 1 || precision > max_precision)) {
+    return Status::InvalidArgument(
+        "Bad schema", strings::Substitute("Precision of $0 must be between 1 and $1: $2",
+                                          col.name(), max_precision, precision));
+  }
+  if (PREDICT_FALSE(scale < 0 || scale > precision)) {
+    return Status::InvalidArgument(
+        "Bad schema", strings::Substitute("Scale of $0 must be between 0 and its precision: $1",
+                                          col.name(), scale));
+  }
+  return Status::OK();
 }
 
+} // anonymous namespace
+
 Status Schema::Reset(const vector<ColumnSchema>& cols,
                      const vector<ColumnId>& ids,
                      int key_columns) {
   cols_ = cols;
   num_key_columns_ = key_columns;
+  key_shape_ = kGenericKey;
 
   if (PREDICT_FALSE(key_columns > cols_.size())) {
     return Status::InvalidArgument(
@@ -161,6 +218,7 @@ Status Schema::Reset(const vector<ColumnSchema>& cols,
     if (!InsertIfNotPresent(&name_to_index_, col.name(), i++)) {
       return Status::InvalidArgument("Duplicate column name", col.name());
     }
+    RETURN_NOT_OK(ValidateTypeAttributes(col));
 
     col_offsets_.push_back(off);
     off += col.type_info()->size();
@@ -190,9 +248,25 @@ Status Schema::Reset(const vector<ColumnSchema>& cols,
     }
   }
 
+  key_shape_ = GetKeyShape(cols_, num_key_columns_);
+
   return Status::OK();
 }
 
+Schema::KeyShape Schema::GetKeyShape(const vector<ColumnSchema>& cols,
+                                     size_t num_key_columns) {
+  vector<DataType> types;
+  for (size_t i = 0; i < num_key_columns; i++) {
+    types.push_back(cols[i].type_info()->physical_type());
+  }
+  if (types == vector<DataType>{ INT32 }) return kInt32Key;
+  if (types == vector<DataType>{ INT64 }) return kInt64Key;
+  if (types == vector<DataType>{ BINARY }) return kBinaryKey;
+  if (types == vector<DataType>{ BINARY, INT64 }) return kBinaryInt64Key;
+  if (types == vector<DataType>{ INT32, INT64, BINARY }) return kInt32Int64BinaryKey;
+  return kGenericKey;
+}
+
 Status Schema::CreateProjectionByNames(const std::vector<StringPiece>& col_names,
                                        Schema* out) const {
   vector<ColumnId> ids;
@@ -225,6 +299,15 @@ Status Schema::CreateProjectionByIdsIgnoreMissing(const std::vector<ColumnId>& c
   return out->Reset(cols, filtered_col_ids, 0);
 }
 
+int Schema::find_ttl_column() const {
+  for (int i = 0; i < cols_.size(); i++) {
+    if (cols_[i].attributes().ttl_seconds > 0) {
+      return i;
+    }
+  }
+  return kColumnNotFound;
+}
+
 Schema Schema::CopyWithColumnIds() const {
   CHECK(!has_column_ids());
   vector<ColumnId> ids;
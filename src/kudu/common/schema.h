@@ -85,13 +85,17 @@ struct ColumnStorageAttributes {
   ColumnStorageAttributes()
     : encoding(AUTO_ENCODING),
       compression(DEFAULT_COMPRESSION),
-      cfile_block_size(0) {
+      cfile_block_size(0),
+      bitmap_index(false),
+      ttl_seconds(0) {
   }
 
   ColumnStorageAttributes(EncodingType enc, CompressionType cmp)
     : encoding(enc),
       compression(cmp),
-      cfile_block_size(0) {
+      cfile_block_size(0),
+      bitmap_index(false),
+      ttl_seconds(0) {
   }
 
   string ToString() const;
@@ -102,6 +106,47 @@ struct ColumnStorageAttributes {
   // The preferred block size for cfile blocks. If 0, uses the
   // server-wide default.
   int32_t cfile_block_size;
+
+  // Whether each rowset keeps a bitmap index of the column's values, which
+  // is worthwhile for columns with few distinct values.
+  bool bitmap_index;
+
+  // If positive, rows expire this many seconds after the time held by the
+  // column, which must then be a non-nullable UNIXTIME_MICROS column. Scans
+  // don't return expired rows, and compactions drop them.
+  int64_t ttl_seconds;
+};
+
+// Attributes which further qualify the type of a column, such as the
+// precision and scale of a decimal. Unlike the storage attributes, these
+// change the meaning of the stored values, so they are part of the type.
+struct ColumnTypeAttributes {
+ public:
+  ColumnTypeAttributes()
+    : precision(0),
+      scale(0) {
+  }
+
+  ColumnTypeAttributes(int8_t precision, int8_t scale)
+    : precision(precision),
+      scale(scale) {
+  }
+
+  bool operator==(const ColumnTypeAttributes& other) const {
+    return precision == other.precision && scale == other.scale;
+  }
+
+  bool operator!=(const ColumnTypeAttributes& other) const {
+    return !(*this == other);
+  }
+
+  // Formats the attributes for a column of type 'type', e.g. "(10, 2)" for
+  // a decimal. Returns an empty string for types without attributes.
+  string ToStringForType(DataType type) const;
+
+  // Only set for decimal columns.
+  int8_t precision;
+  int8_t scale;
 };
 
 // The schema for a given column.
@@ -126,15 +171,19 @@ class ColumnSchema {
   //   ColumnSchema col_c("c", INT32, false, &default_i32);
   //   Slice default_str("Hello");
   //   ColumnSchema col_d("d", STRING, false, &default_str);
+  //   ColumnSchema col_e("e", DECIMAL64, false, NULL, NULL,
+  //                      ColumnStorageAttributes(), ColumnTypeAttributes(12, 2));
   ColumnSchema(string name, DataType type, bool is_nullable = false,
                const void* read_default = NULL,
                const void* write_default = NULL,
-               ColumnStorageAttributes attributes = ColumnStorageAttributes())
+               ColumnStorageAttributes attributes = ColumnStorageAttributes(),
+               ColumnTypeAttributes type_attributes = ColumnTypeAttributes())
       : name_(std::move(name)),
         type_info_(GetTypeInfo(type)),
         is_nullable_(is_nullable),
         read_default_(read_default ? new Variant(type, read_default) : NULL),
-        attributes_(std::move(attributes)) {
+        attributes_(std::move(attributes)),
+        type_attributes_(type_attributes) {
     if (write_default == read_default) {
       write_default_ = read_default_;
     } else if (write_default != NULL) {
@@ -208,7 +257,8 @@ class ColumnSchema {
 
   bool EqualsType(const ColumnSchema &other) const {
     return is_nullable_ == other.is_nullable_ &&
-           type_info()->type() == other.type_info()->type();
+           type_info()->type() == other.type_info()->type() &&
+           type_attributes_ == other.type_attributes_;
   }
 
   bool Equals(const ColumnSchema &other, bool check_defaults) const {
@@ -242,6 +292,12 @@ class ColumnSchema {
     return attributes_;
   }
 
+  // Returns the attributes qualifying the type of the column, such as the
+  // precision and scale of a decimal.
+  const ColumnTypeAttributes& type_attributes() const {
+    return type_attributes_;
+  }
+
   int Compare(const void *lhs, const void *rhs) const {
     return type_info_->Compare(lhs, rhs);
   }
@@ -250,7 +306,7 @@ class ColumnSchema {
   // and doesn't include the column name or type.
   string Stringify(const void *cell) const {
     string ret;
-    type_info_->AppendDebugStringForValue(cell, &ret);
+    AppendDebugStringForValue(cell, &ret);
     return ret;
   }
 
@@ -265,7 +321,7 @@ class ColumnSchema {
     if (is_nullable_ && cell.is_null()) {
       ret->append("NULL");
     } else {
-      type_info_->AppendDebugStringForValue(cell.ptr(), ret);
+      AppendDebugStringForValue(cell.ptr(), ret);
     }
   }
 
@@ -284,6 +340,10 @@ class ColumnSchema {
     name_ = name;
   }
 
+  // Like TypeInfo::AppendDebugStringForValue(), but also applies the type
+  // attributes, e.g. the scale of a decimal.
+  void AppendDebugStringForValue(const void* cell, string* ret) const;
+
   string name_;
   const TypeInfo *type_info_;
   bool is_nullable_;
@@ -291,6 +351,7 @@ class ColumnSchema {
   std::shared_ptr<Variant> read_default_;
   std::shared_ptr<Variant> write_default_;
   ColumnStorageAttributes attributes_;
+  ColumnTypeAttributes type_attributes_;
 };
 
 class ContiguousRow;
@@ -318,7 +379,8 @@ class Schema {
                      NameToIndexMap::hasher(),
                      NameToIndexMap::key_equal(),
                      NameToIndexMapAllocator(&name_to_index_bytes_)),
-      has_nullables_(false) {
+      has_nullables_(false),
+      key_shape_(kGenericKey) {
   }
 
   Schema(const Schema& other);
@@ -449,6 +511,11 @@ class Schema {
     }
   }
 
+  // Return the index of the column whose values rows expire by, i.e. the
+  // first one with a positive 'ttl_seconds' storage attribute, or
+  // kColumnNotFound if rows of this schema never expire.
+  int find_ttl_column() const;
+
   // Returns true if the schema contains nullable columns
   bool has_nullables() const {
     return has_nullables_;
@@ -607,6 +674,25 @@ class Schema {
     DCHECK_KEY_PROJECTION_SCHEMA_EQ(*this, *row.schema());
 
     dst->clear();
+    switch (key_shape_) {
+      case kInt32Key:
+        CompositeKeyEncoder<faststring, INT32>::Encode(row, dst);
+        return Slice(*dst);
+      case kInt64Key:
+        CompositeKeyEncoder<faststring, INT64>::Encode(row, dst);
+        return Slice(*dst);
+      case kBinaryKey:
+        CompositeKeyEncoder<faststring, BINARY>::Encode(row, dst);
+        return Slice(*dst);
+      case kBinaryInt64Key:
+        CompositeKeyEncoder<faststring, BINARY, INT64>::Encode(row, dst);
+        return Slice(*dst);
+      case kInt32Int64BinaryKey:
+        CompositeKeyEncoder<faststring, INT32, INT64, BINARY>::Encode(row, dst);
+        return Slice(*dst);
+      case kGenericKey:
+        break;
+    }
     for (size_t i = 0; i < num_key_columns_; i++) {
       DCHECK(!cols_[i].is_nullable());
       const TypeInfo* ti = cols_[i].type_info();
@@ -762,6 +848,20 @@ class Schema {
 
   friend class SchemaBuilder;
 
+  // The key shapes, by physical type, which EncodeComparableKey() has a
+  // specialized encoder for.
+  enum KeyShape {
+    kGenericKey,
+    kInt32Key,
+    kInt64Key,
+    kBinaryKey,
+    kBinaryInt64Key,
+    kInt32Int64BinaryKey
+  };
+
+  // Returns the shape of the key made of the first 'num_key_columns' of 'cols'.
+  static KeyShape GetKeyShape(const vector<ColumnSchema>& cols, size_t num_key_columns);
+
   vector<ColumnSchema> cols_;
   size_t num_key_columns_;
   ColumnId max_col_id_;
@@ -790,6 +890,9 @@ class Schema {
   // Cached indicator whether any columns are nullable.
   bool has_nullables_;
 
+  // Cached shape of the key, used to pick its encoder.
+  KeyShape key_shape_;
+
   // NOTE: if you add more members, make sure to add the appropriate
   // code to swap() and CopyFrom() as well to prevent subtle bugs.
 };
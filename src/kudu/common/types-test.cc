@@ -129,4 +129,27 @@ TEST(TestTypes, TestAreConsecutiveString) {
   TestAreConsecutive(STRING, test_cases);
 }
 
+TEST(TestTypes, TestDecimals) {
+  ASSERT_EQ(DECIMAL32, DecimalTypeForPrecision(1));
+  ASSERT_EQ(DECIMAL32, DecimalTypeForPrecision(kMaxDecimal32Precision));
+  ASSERT_EQ(DECIMAL64, DecimalTypeForPrecision(kMaxDecimal32Precision + 1));
+  ASSERT_EQ(DECIMAL64, DecimalTypeForPrecision(kMaxDecimal64Precision));
+  ASSERT_EQ(UNKNOWN_DATA, DecimalTypeForPrecision(0));
+  ASSERT_EQ(UNKNOWN_DATA, DecimalTypeForPrecision(kMaxDecimal64Precision + 1));
+
+  ASSERT_EQ(INT32, GetTypeInfo(DECIMAL32)->physical_type());
+  ASSERT_EQ(INT64, GetTypeInfo(DECIMAL64)->physical_type());
+  ASSERT_EQ(999999999, MaxUnscaledDecimal(kMaxDecimal32Precision));
+  ASSERT_EQ(999999999999999999L, MaxUnscaledDecimal(kMaxDecimal64Precision));
+
+  ASSERT_EQ("0", DecimalToString(0, 0));
+  ASSERT_EQ("0.00", DecimalToString(0, 2));
+  ASSERT_EQ("123.45", DecimalToString(12345, 2));
+  ASSERT_EQ("-123.45", DecimalToString(-12345, 2));
+  ASSERT_EQ("0.05", DecimalToString(5, 2));
+  ASSERT_EQ("-0.5", DecimalToString(-5, 1));
+  ASSERT_EQ("12345", DecimalToString(12345, 0));
+  ASSERT_EQ("-9.223372036854775808", DecimalToString(INT64_MIN, 18));
+}
+
 } // namespace kudu
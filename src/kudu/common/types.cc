@@ -71,6 +71,8 @@ class TypeInfoResolver {
     AddMapping<UINT64>();
     AddMapping<INT64>();
     AddMapping<UNIXTIME_MICROS>();
+    AddMapping<DECIMAL32>();
+    AddMapping<DECIMAL64>();
     AddMapping<STRING>();
     AddMapping<BOOL>();
     AddMapping<FLOAT>();
@@ -95,4 +97,46 @@ const TypeInfo* GetTypeInfo(DataType type) {
   return Singleton<TypeInfoResolver>::get()->GetTypeInfo(type);
 }
 
+DataType DecimalTypeForPrecision(int precision) {
+  if (precision < 1) {
+    return UNKNOWN_DATA;
+  }
+  if (precision <= kMaxDecimal32Precision) {
+    return DECIMAL32;
+  }
+  if (precision <= kMaxDecimal64Precision) {
+    return DECIMAL64;
+  }
+  return UNKNOWN_DATA;
+}
+
+int64_t MaxUnscaledDecimal(int precision) {
+  DCHECK_GE(precision, 1);
+  DCHECK_LE(precision, kMaxDecimal64Precision);
+  int64_t max = 1;
+  for (int i = 0; i < precision; i++) {
+    max *= 10;
+  }
+  return max - 1;
+}
+
+string DecimalToString(int64_t unscaled_value, int scale) {
+  DCHECK_GE(scale, 0);
+  DCHECK_LE(scale, kMaxDecimal64Precision);
+  // Work with the magnitude as unsigned, so that INT64_MIN doesn't overflow.
+  bool negative = unscaled_value < 0;
+  uint64_t magnitude = negative ? -static_cast<uint64_t>(unscaled_value) : unscaled_value;
+  string digits = std::to_string(magnitude);
+  if (static_cast<int>(digits.size()) <= scale) {
+    digits.insert(0, scale - digits.size() + 1, '0');
+  }
+  if (scale > 0) {
+    digits.insert(digits.size() - scale, 1, '.');
+  }
+  if (negative) {
+    digits.insert(0, 1, '-');
+  }
+  return digits;
+}
+
 } // namespace kudu
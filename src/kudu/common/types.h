@@ -43,6 +43,28 @@ class TypeInfo;
 // given a type enum, get the TypeInfo about it.
 extern const TypeInfo* GetTypeInfo(DataType type);
 
+// The largest precision of the decimals stored in each of the decimal types.
+// A decimal column uses the narrowest type that fits its precision.
+const int kMaxDecimal32Precision = 9;
+const int kMaxDecimal64Precision = 18;
+
+// Returns true if 'type' is one of the fixed-point decimal types.
+inline bool IsDecimalType(DataType type) {
+  return type == DECIMAL32 || type == DECIMAL64;
+}
+
+// Returns the narrowest decimal type which can store values of the given
+// precision, or UNKNOWN_DATA if the precision is not supported.
+DataType DecimalTypeForPrecision(int precision);
+
+// Returns the largest unscaled value of a decimal with the given precision,
+// i.e. 10^precision - 1. The smallest one is its negation.
+int64_t MaxUnscaledDecimal(int precision);
+
+// Formats the decimal with the given unscaled value and scale, e.g.
+// (-12345, 2) as "-123.45".
+string DecimalToString(int64_t unscaled_value, int scale);
+
 // Information about a given type.
 // This is a runtime equivalent of the TypeTraits template below.
 class TypeInfo {
@@ -447,6 +469,24 @@ struct DataTypeTraits<UNIXTIME_MICROS> : public DerivedTypeTraits<INT64>{
   }
 };
 
+// Decimals are stored as their unscaled value, so that they sort, encode and
+// compress like integers. The scale is an attribute of the column rather than
+// the type, so the values are printed unscaled here; see
+// ColumnSchema::Stringify().
+template<>
+struct DataTypeTraits<DECIMAL32> : public DerivedTypeTraits<INT32>{
+  static const char* name() {
+    return "decimal32";
+  }
+};
+
+template<>
+struct DataTypeTraits<DECIMAL64> : public DerivedTypeTraits<INT64>{
+  static const char* name() {
+    return "decimal64";
+  }
+};
+
 // Instantiate this template to get static access to the type traits.
 template<DataType datatype>
 struct TypeTraits : public DataTypeTraits<datatype> {
@@ -503,6 +543,7 @@ class Variant {
       case UINT16:
         numeric_.u16 = *static_cast<const uint16_t *>(value);
         break;
+      case DECIMAL32:
       case INT32:
         numeric_.i32 = *static_cast<const int32_t *>(value);
         break;
@@ -510,6 +551,7 @@ class Variant {
         numeric_.u32 = *static_cast<const uint32_t *>(value);
         break;
       case UNIXTIME_MICROS:
+      case DECIMAL64:
       case INT64:
         numeric_.i64 = *static_cast<const int64_t *>(value);
         break;
@@ -577,9 +619,11 @@ class Variant {
       case INT16:        return &(numeric_.i16);
       case UINT16:       return &(numeric_.u16);
       case INT32:        return &(numeric_.i32);
+      case DECIMAL32:    return &(numeric_.i32);
       case UINT32:       return &(numeric_.u32);
       case INT64:        return &(numeric_.i64);
       case UNIXTIME_MICROS:    return &(numeric_.i64);
+      case DECIMAL64:    return &(numeric_.i64);
       case UINT64:       return &(numeric_.u64);
       case FLOAT:        return (&numeric_.float_val);
       case DOUBLE:       return (&numeric_.double_val);
@@ -220,6 +220,95 @@ TEST_F(WireProtocolTest, TestColumnarRowBlockToPB) {
   }
 }
 
+// Serialize two blocks with some unselected and NULL cells into the columnar
+// layout and verify the resulting per-column buffers.
+TEST_F(WireProtocolTest, TestSerializeRowBlockColumnar) {
+  Arena arena(1024, 1024 * 1024);
+  RowBlock block(schema_, 10, &arena);
+  FillRowBlockWithTestRows(&block);
+  for (int i = 0; i < block.nrows(); i += 3) {
+    block.row(i).cell(2).set_null(true);
+  }
+  block.selection_vector()->SetRowUnselected(1);
+  ASSERT_EQ(9, block.selection_vector()->CountSelected());
+
+  ColumnarSerializedBatch batch;
+  SerializeRowBlockColumnar(block, nullptr, &batch);
+  SerializeRowBlockColumnar(block, nullptr, &batch);
+  ASSERT_EQ(18, batch.num_rows);
+  ASSERT_EQ(schema_.num_columns(), batch.columns.size());
+
+  // The string columns consist of offsets and the concatenated values.
+  const std::string kCol1 = "hello world col1";
+  const ColumnarSerializedBatch::Column& col1 = batch.columns[0];
+  ASSERT_EQ((batch.num_rows + 1) * sizeof(uint32_t), col1.data->size());
+  ASSERT_EQ(batch.num_rows * kCol1.size(), col1.varlen_data->size());
+  ASSERT_TRUE(col1.non_null_bitmap == nullptr);
+  const uint32_t* offsets = reinterpret_cast<const uint32_t*>(col1.data->data());
+  for (int i = 0; i <= batch.num_rows; i++) {
+    ASSERT_EQ(i * kCol1.size(), offsets[i]);
+  }
+  ASSERT_EQ(kCol1, col1.varlen_data->ToString().substr(0, kCol1.size()));
+
+  // The nullable integer column skips the unselected row and keeps track of
+  // the NULL cells in its non-null bitmap.
+  const ColumnarSerializedBatch::Column& col3 = batch.columns[2];
+  ASSERT_EQ(batch.num_rows * sizeof(uint32_t), col3.data->size());
+  ASSERT_TRUE(col3.varlen_data == nullptr);
+  ASSERT_EQ(BitmapSize(batch.num_rows), col3.non_null_bitmap->size());
+  const uint32_t* vals = reinterpret_cast<const uint32_t*>(col3.data->data());
+  int dst_idx = 0;
+  for (int copy = 0; copy < 2; copy++) {
+    for (int i = 0; i < block.nrows(); i++) {
+      if (i == 1) continue;
+      bool is_null = i % 3 == 0;
+      SCOPED_TRACE(dst_idx);
+      ASSERT_EQ(!is_null, BitmapTest(col3.non_null_bitmap->data(), dst_idx));
+      ASSERT_EQ(is_null ? 0 : i, vals[dst_idx]);
+      dst_idx++;
+    }
+  }
+  ASSERT_EQ(batch.num_rows, dst_idx);
+}
+
+// Blocks of a nullable column without any nulls take a separate path, which
+// must still fill in the non-null bitmap, including after a block with nulls.
+TEST_F(WireProtocolTest, TestSerializeRowBlockColumnarWithoutNulls) {
+  Arena arena(1024, 1024 * 1024);
+  RowBlock no_nulls(schema_, 10, &arena);
+  FillRowBlockWithTestRows(&no_nulls);
+  no_nulls.selection_vector()->SetRowUnselected(1);
+  ASSERT_FALSE(no_nulls.column_block(2).HasNulls());
+
+  RowBlock with_nulls(schema_, 10, &arena);
+  FillRowBlockWithTestRows(&with_nulls);
+  with_nulls.row(4).cell(2).set_null(true);
+  ASSERT_TRUE(with_nulls.column_block(2).HasNulls());
+
+  ColumnarSerializedBatch batch;
+  SerializeRowBlockColumnar(with_nulls, nullptr, &batch);
+  SerializeRowBlockColumnar(no_nulls, nullptr, &batch);
+  ASSERT_EQ(19, batch.num_rows);
+
+  const ColumnarSerializedBatch::Column& col3 = batch.columns[2];
+  ASSERT_EQ(batch.num_rows * sizeof(uint32_t), col3.data->size());
+  ASSERT_EQ(BitmapSize(batch.num_rows), col3.non_null_bitmap->size());
+  const uint32_t* vals = reinterpret_cast<const uint32_t*>(col3.data->data());
+  for (int i = 0; i < 10; i++) {
+    SCOPED_TRACE(i);
+    ASSERT_EQ(i != 4, BitmapTest(col3.non_null_bitmap->data(), i));
+    ASSERT_EQ(i == 4 ? 0 : i, vals[i]);
+  }
+  int dst_idx = 10;
+  for (int i = 0; i < 10; i++) {
+    if (i == 1) continue;
+    SCOPED_TRACE(dst_idx);
+    ASSERT_TRUE(BitmapTest(col3.non_null_bitmap->data(), dst_idx));
+    ASSERT_EQ(i, vals[dst_idx]);
+    dst_idx++;
+  }
+}
+
 #ifdef NDEBUG
 TEST_F(WireProtocolTest, TestColumnarRowBlockToPBBenchmark) {
   Arena arena(1024, 1024 * 1024);
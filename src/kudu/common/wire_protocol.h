@@ -20,6 +20,7 @@
 #define KUDU_COMMON_WIRE_PROTOCOL_H
 
 #include <boost/optional.hpp>
+#include <memory>
 #include <vector>
 
 #include "kudu/common/wire_protocol.pb.h"
@@ -126,6 +127,44 @@ void SerializeRowBlock(const RowBlock& block, RowwiseRowBlockPB* rowblock_pb,
                        const Schema* client_projection_schema,
                        faststring* data_buf, faststring* indirect_data);
 
+// The per-column buffers of a scan response in the columnar layout, as
+// described by ColumnarRowBlockPB.
+struct ColumnarSerializedBatch {
+  struct Column {
+    // Fixed-length cells, or uint32 offsets into 'varlen_data' for
+    // BINARY-based columns.
+    std::unique_ptr<faststring> data;
+
+    // Concatenated values of a BINARY-based column; NULL otherwise.
+    std::unique_ptr<faststring> varlen_data;
+
+    // Non-null bitmap of a nullable column; NULL otherwise.
+    std::unique_ptr<faststring> non_null_bitmap;
+  };
+
+  // Returns the total number of bytes held in the buffers.
+  size_t TotalSize() const;
+
+  // The number of rows serialized so far.
+  int num_rows = 0;
+
+  // One entry per column of the projection. Empty until the first call to
+  // SerializeRowBlockColumnar().
+  std::vector<Column> columns;
+};
+
+// Encode the selected rows of the given row block into 'batch' in the
+// columnar layout, appending to any rows already serialized there.
+//
+// As with SerializeRowBlock(), all data is copied, and if
+// 'client_projection_schema' is not NULL only its columns are serialized.
+// Every call for the same 'batch' must use the same projection.
+//
+// Requires that block.nrows() > 0
+void SerializeRowBlockColumnar(const RowBlock& block,
+                               const Schema* client_projection_schema,
+                               ColumnarSerializedBatch* batch);
+
 // Rewrites the data pointed-to by row data slice 'row_data_slice' by replacing
 // relative indirect data pointers with absolute ones in 'indirect_data_slice'.
 // At the time of this writing, this rewriting is only done for STRING types.
@@ -23,6 +23,7 @@
 #include <string>
 #include <vector>
 
+#include "kudu/common/timestamp.h"
 #include "kudu/consensus/consensus.pb.h"
 #include "kudu/consensus/ref_counted_replicate.h"
 #include "kudu/gutil/callback.h"
@@ -140,6 +141,24 @@ class Consensus : public RefCountedThreadSafe<Consensus> {
     return Status::NotSupported("Not implemented.");
   }
 
+  // Implement a LeaderStepDown() request which names a successor: like
+  // StepDown(), but the voter 'new_leader_uuid' is then asked to run an
+  // election immediately. If 'new_leader_uuid' is empty, the voter which
+  // has received the most operations is chosen, if any.
+  virtual Status TransferLeadership(const std::string& new_leader_uuid,
+                                    LeaderStepDownResponsePB* resp) {
+    return Status::NotSupported("Not implemented.");
+  }
+
+  // Returns OK if this replica is the leader and holds a leader lease: a
+  // majority of the voters accepted its requests recently enough that no
+  // other leader can have been elected since. Every write acknowledged so
+  // far is then visible to reads on this replica, and they are linearizable
+  // without contacting other replicas.
+  virtual Status CheckLeaderLease() {
+    return Status::NotSupported("Not implemented.");
+  }
+
   // Creates a new ConsensusRound, the entity that owns all the data
   // structures required for a consensus round, such as the ReplicateMsg
   // (and later on the CommitMsg). ConsensusRound will also point to and
@@ -333,6 +352,17 @@ class ReplicaTransactionFactory {
  public:
   virtual Status StartReplicaTransaction(const scoped_refptr<ConsensusRound>& context) = 0;
 
+  // Called on leaders before each request to a follower. Returns a timestamp
+  // such that every transaction at or before it has committed and no new one
+  // may be started at or before it, or Timestamp::kInvalidTimestamp if there
+  // is no such timestamp.
+  virtual Timestamp GetSafeTimeForReplicas() { return Timestamp::kInvalidTimestamp; }
+
+  // Called on followers once they received every operation which the leader
+  // had committed when it computed 'safe_time'. Must take effect only after
+  // all the transactions started before this call.
+  virtual void AdvanceSafeTime(Timestamp safe_time) {}
+
   virtual ~ReplicaTransactionFactory() {}
 };
 
@@ -21,6 +21,7 @@
 #include <boost/bind.hpp>
 #include <gflags/gflags.h>
 #include <glog/logging.h>
+#include <google/protobuf/wire_format_lite.h>
 #include <mutex>
 #include <string>
 #include <utility>
@@ -30,9 +31,11 @@
 #include "kudu/consensus/consensus_peers.h"
 #include "kudu/consensus/consensus_queue.h"
 #include "kudu/consensus/log.h"
+#include "kudu/consensus/multi_raft_batcher.h"
 #include "kudu/gutil/map-util.h"
 #include "kudu/gutil/stl_util.h"
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/coding.h"
 #include "kudu/util/fault_injection.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/logging.h"
@@ -69,10 +72,19 @@ DEFINE_bool(enable_tablet_copy, true,
             "replica. For testing purposes only.");
 TAG_FLAG(enable_tablet_copy, unsafe);
 
+DEFINE_int32(consensus_max_inflight_requests_per_peer, 1,
+             "Maximum number of UpdateConsensus RPCs the leader keeps outstanding "
+             "to each follower. Values above 1 pipeline replication, so that the "
+             "leader sends further batches of operations before the follower has "
+             "acknowledged the earlier ones, which helps followers with a long "
+             "round trip time.");
+TAG_FLAG(consensus_max_inflight_requests_per_peer, experimental);
+
 namespace kudu {
 namespace consensus {
 
 using std::shared_ptr;
+using std::vector;
 using rpc::Messenger;
 using rpc::RpcController;
 using strings::Substitute;
@@ -106,16 +118,20 @@ Peer::Peer(const RaftPeerPB& peer_pb, string tablet_id, string leader_uuid,
       proxy_(std::move(proxy)),
       queue_(queue),
       failed_attempts_(0),
-      sem_(1),
+      max_inflight_requests_(std::max(1, FLAGS_consensus_max_inflight_requests_per_peer)),
+      last_committed_index_(kMinimumOpIdIndex),
+      tc_in_flight_(false),
+      sem_(max_inflight_requests_),
       heartbeater_(
           peer_pb.permanent_uuid(),
           MonoDelta::FromMilliseconds(FLAGS_raft_heartbeat_interval_ms),
-          boost::bind(&Peer::SignalRequest, this, true)),
+          boost::bind(&Peer::SignalHeartbeat, this)),
       thread_pool_(thread_pool),
       state_(kPeerCreated) {}
 
-void Peer::SetTermForTest(int term) {
-  response_.set_responder_term(term);
+Peer::InFlightRequest::~InFlightRequest() {
+  // We don't own the ops (the queue does).
+  request.mutable_ops()->ExtractSubrange(0, request.ops_size(), nullptr);
 }
 
 Status Peer::Init() {
@@ -127,8 +143,17 @@ Status Peer::Init() {
 }
 
 Status Peer::SignalRequest(bool even_if_queue_empty) {
-  // If the peer is currently sending, return Status::OK().
-  // If there are new requests in the queue we'll get them on ProcessResponse().
+  return DoSignalRequest(even_if_queue_empty, false);
+}
+
+Status Peer::SignalHeartbeat() {
+  return DoSignalRequest(true, true);
+}
+
+Status Peer::DoSignalRequest(bool even_if_queue_empty, bool is_heartbeat) {
+  // If the peer already has its maximum number of requests outstanding,
+  // return Status::OK(). If there are new requests in the queue we'll get
+  // them on ProcessResponse().
   if (!sem_.TryAcquire()) {
     return Status::OK();
   }
@@ -167,19 +192,19 @@ Status Peer::SignalRequest(bool even_if_queue_empty) {
 
 
   RETURN_NOT_OK(thread_pool_->SubmitClosure(
-                  Bind(&Peer::SendNextRequest, Unretained(this), even_if_queue_empty)));
+                  Bind(&Peer::SendNextRequest, Unretained(this), even_if_queue_empty,
+                       is_heartbeat)));
   return Status::OK();
 }
 
-void Peer::SendNextRequest(bool even_if_queue_empty) {
-  // The peer has no pending request nor is sending: send the request.
+void Peer::SendNextRequest(bool even_if_queue_empty, bool is_heartbeat) {
+  // A window slot is free: build the request and send it.
+  gscoped_ptr<InFlightRequest> req(new InFlightRequest);
+  MutexLock send_lock(send_lock_);
   bool needs_tablet_copy = false;
-  int64_t commit_index_before = request_.has_committed_index() ?
-      request_.committed_index() : kMinimumOpIdIndex;
-  Status s = queue_->RequestForPeer(peer_pb_.permanent_uuid(), &request_,
-                                    &replicate_msg_refs_, &needs_tablet_copy);
-  int64_t commit_index_after = request_.has_committed_index() ?
-      request_.committed_index() : kMinimumOpIdIndex;
+  int64_t commit_index_before = last_committed_index_;
+  Status s = queue_->RequestForPeer(peer_pb_.permanent_uuid(), &req->request,
+                                    &req->replicate_msg_refs, &needs_tablet_copy);
 
   if (PREDICT_FALSE(!s.ok())) {
     LOG_WITH_PREFIX_UNLOCKED(INFO) << "Could not obtain request from queue for peer: "
@@ -188,9 +213,15 @@ void Peer::SendNextRequest(bool even_if_queue_empty) {
     return;
   }
 
+  int64_t commit_index_after = req->request.has_committed_index() ?
+      req->request.committed_index() : kMinimumOpIdIndex;
+  last_committed_index_ = commit_index_after;
+
   if (PREDICT_FALSE(needs_tablet_copy)) {
     Status s = SendTabletCopyRequest();
-    if (!s.ok()) {
+    if (s.IsAlreadyPresent()) {
+      sem_.Release();
+    } else if (!s.ok()) {
       LOG_WITH_PREFIX_UNLOCKED(WARNING) << "Unable to generate Tablet Copy request for peer: "
                                         << s.ToString();
       sem_.Release();
@@ -198,11 +229,12 @@ void Peer::SendNextRequest(bool even_if_queue_empty) {
     return;
   }
 
-  request_.set_tablet_id(tablet_id_);
-  request_.set_caller_uuid(leader_uuid_);
-  request_.set_dest_uuid(peer_pb_.permanent_uuid());
+  ConsensusRequestPB* request = &req->request;
+  request->set_tablet_id(tablet_id_);
+  request->set_caller_uuid(leader_uuid_);
+  request->set_dest_uuid(peer_pb_.permanent_uuid());
 
-  bool req_has_ops = request_.ops_size() > 0 || (commit_index_after > commit_index_before);
+  bool req_has_ops = request->ops_size() > 0 || (commit_index_after > commit_index_before);
   // If the queue is empty, check if we were told to send a status-only
   // message, if not just return.
   if (PREDICT_FALSE(!req_has_ops && !even_if_queue_empty)) {
@@ -220,23 +252,35 @@ void Peer::SendNextRequest(bool even_if_queue_empty) {
 
 
   VLOG_WITH_PREFIX_UNLOCKED(2) << "Sending to peer " << peer_pb().permanent_uuid() << ": "
-      << request_.ShortDebugString();
-  controller_.Reset();
+      << request->ShortDebugString();
 
-  proxy_->UpdateAsync(&request_, &response_, &controller_,
-                      boost::bind(&Peer::ProcessResponse, this));
+  InFlightRequest* raw_req = req.release();
+  raw_req->send_time = MonoTime::Now();
+  if (!req_has_ops && is_heartbeat) {
+    proxy_->HeartbeatAsync(&raw_req->request, &raw_req->response, &raw_req->controller,
+                           Bind(&Peer::ProcessResponse, Unretained(this), Unretained(raw_req)));
+    return;
+  }
+  proxy_->UpdateWithReplicatesAsync(&raw_req->request, raw_req->replicate_msg_refs,
+                                    &raw_req->response, &raw_req->controller,
+                                    boost::bind(&Peer::ProcessUpdateResponse, this, raw_req));
+}
+
+void Peer::ProcessUpdateResponse(InFlightRequest* req) {
+  ProcessResponse(req, req->controller.status());
 }
 
-void Peer::ProcessResponse() {
+void Peer::ProcessResponse(InFlightRequest* req, const Status& rpc_status) {
   // Note: This method runs on the reactor thread.
 
-  DCHECK_EQ(0, sem_.GetValue())
+  DCHECK_LT(sem_.GetValue(), max_inflight_requests_)
     << "Got a response when nothing was pending";
 
   MAYBE_FAULT(FLAGS_fault_crash_after_leader_request_fraction);
 
-  if (!controller_.status().ok()) {
-    if (controller_.status().IsRemoteError()) {
+  const ConsensusResponsePB& response = req->response;
+  if (!rpc_status.ok()) {
+    if (rpc_status.IsRemoteError()) {
       // Most controller errors are caused by network issues or corner cases
       // like shutdown and failure to serialize a protobuf. Therefore, we
       // generally consider these errors to indicate an unreachable peer.
@@ -245,20 +289,20 @@ void Peer::ProcessResponse() {
       // the queue know that the remote is responsive.
       queue_->NotifyPeerIsResponsiveDespiteError(peer_pb_.permanent_uuid());
     }
-    ProcessResponseError(controller_.status());
+    ProcessResponseError(req, rpc_status);
     return;
   }
 
   // Pass through errors we can respond to, like not found, since in that case
   // we will need to start a Tablet Copy. TODO: Handle DELETED response once implemented.
-  if ((response_.has_error() &&
-      response_.error().code() != TabletServerErrorPB::TABLET_NOT_FOUND) ||
-      (response_.status().has_error() &&
-          response_.status().error().code() == consensus::ConsensusErrorPB::CANNOT_PREPARE)) {
+  if ((response.has_error() &&
+      response.error().code() != TabletServerErrorPB::TABLET_NOT_FOUND) ||
+      (response.status().has_error() &&
+          response.status().error().code() == consensus::ConsensusErrorPB::CANNOT_PREPARE)) {
     // Again, let the queue know that the remote is still responsive, since we
     // will not be sending this error response through to the queue.
     queue_->NotifyPeerIsResponsiveDespiteError(peer_pb_.permanent_uuid());
-    ProcessResponseError(StatusFromPB(response_.error().status()));
+    ProcessResponseError(req, StatusFromPB(response.error().status()));
     return;
   }
 
@@ -266,48 +310,77 @@ void Peer::ProcessResponse() {
   // the WAL) and SendNextRequest() may do the same thing. So we run the rest
   // of the response handling logic on our thread pool and not on the reactor
   // thread.
-  Status s = thread_pool_->SubmitClosure(Bind(&Peer::DoProcessResponse, Unretained(this)));
+  Status s = thread_pool_->SubmitClosure(Bind(&Peer::DoProcessResponse, Unretained(this),
+                                              Unretained(req)));
   if (PREDICT_FALSE(!s.ok())) {
     LOG_WITH_PREFIX_UNLOCKED(WARNING) << "Unable to process peer response: " << s.ToString()
-        << ": " << response_.ShortDebugString();
+        << ": " << response.ShortDebugString();
+    delete req;
     sem_.Release();
   }
 }
 
-void Peer::DoProcessResponse() {
-  failed_attempts_ = 0;
+void Peer::DoProcessResponse(InFlightRequest* req) {
+  gscoped_ptr<InFlightRequest> owned_req(req);
+  {
+    std::lock_guard<simple_spinlock> l(peer_lock_);
+    failed_attempts_ = 0;
+  }
 
   VLOG_WITH_PREFIX_UNLOCKED(2) << "Response from peer " << peer_pb().permanent_uuid() << ": "
-      << response_.ShortDebugString();
+      << req->response.ShortDebugString();
+
+  // A follower which accepts a request from the current leader won't vote for
+  // another candidate for a while, which extends the leader's lease.
+  const ConsensusResponsePB& resp = req->response;
+  if (!resp.has_error() && !resp.status().has_error() &&
+      resp.responder_term() == req->request.caller_term()) {
+    queue_->NotifyPeerAcceptedRequest(peer_pb_.permanent_uuid(), req->send_time);
+  }
 
   bool more_pending;
-  queue_->ResponseFromPeer(peer_pb_.permanent_uuid(), response_, &more_pending);
+  queue_->ResponseFromPeer(peer_pb_.permanent_uuid(), req->response, &more_pending);
+  owned_req.reset();
 
   // We're OK to read the state_ without a lock here -- if we get a race,
   // the worst thing that could happen is that we'll make one more request before
   // noticing a close.
   if (more_pending && ANNOTATE_UNPROTECTED_READ(state_) != kPeerClosed) {
-    SendNextRequest(true);
+    SendNextRequest(true, false);
   } else {
     sem_.Release();
   }
 }
 
 Status Peer::SendTabletCopyRequest() {
-  if (!FLAGS_enable_tablet_copy) {
-    failed_attempts_++;
-    return Status::NotSupported("Tablet Copy is disabled");
+  {
+    std::lock_guard<simple_spinlock> l(peer_lock_);
+    if (!FLAGS_enable_tablet_copy) {
+      failed_attempts_++;
+      return Status::NotSupported("Tablet Copy is disabled");
+    }
+    // With several requests outstanding, more than one response may ask for
+    // a tablet copy. One request to start it is enough.
+    if (tc_in_flight_) {
+      return Status::AlreadyPresent("Tablet Copy request already outstanding");
+    }
+    tc_in_flight_ = true;
   }
 
-  RETURN_NOT_OK(queue_->GetTabletCopyRequestForPeer(peer_pb_.permanent_uuid(), &tc_request_));
-  controller_.Reset();
-  proxy_->StartTabletCopy(&tc_request_, &tc_response_, &controller_,
+  Status s = queue_->GetTabletCopyRequestForPeer(peer_pb_.permanent_uuid(), &tc_request_);
+  if (!s.ok()) {
+    std::lock_guard<simple_spinlock> l(peer_lock_);
+    tc_in_flight_ = false;
+    return s;
+  }
+  tc_controller_.Reset();
+  proxy_->StartTabletCopy(&tc_request_, &tc_response_, &tc_controller_,
                           boost::bind(&Peer::ProcessTabletCopyResponse, this));
   return Status::OK();
 }
 
 void Peer::ProcessTabletCopyResponse() {
-  if (controller_.status().ok() && tc_response_.has_error()) {
+  if (tc_controller_.status().ok() && tc_response_.has_error()) {
     // ALREADY_INPROGRESS is expected, so we do not log this error.
     if (tc_response_.error().code() ==
         TabletServerErrorPB::TabletServerErrorPB::ALREADY_INPROGRESS) {
@@ -317,23 +390,33 @@ void Peer::ProcessTabletCopyResponse() {
                                         << tc_response_.ShortDebugString();
     }
   }
+  {
+    std::lock_guard<simple_spinlock> l(peer_lock_);
+    tc_in_flight_ = false;
+  }
   sem_.Release();
 }
 
-void Peer::ProcessResponseError(const Status& status) {
-  failed_attempts_++;
+void Peer::ProcessResponseError(InFlightRequest* req, const Status& status) {
+  gscoped_ptr<InFlightRequest> owned_req(req);
+  uint64_t failed_attempts;
+  {
+    std::lock_guard<simple_spinlock> l(peer_lock_);
+    failed_attempts = ++failed_attempts_;
+  }
   string resp_err_info;
-  if (response_.has_error()) {
+  if (req->response.has_error()) {
     resp_err_info = Substitute(" Error code: $0 ($1).",
-                               TabletServerErrorPB::Code_Name(response_.error().code()),
-                               response_.error().code());
+                               TabletServerErrorPB::Code_Name(req->response.error().code()),
+                               req->response.error().code());
   }
   LOG_WITH_PREFIX_UNLOCKED(WARNING) << "Couldn't send request to peer " << peer_pb_.permanent_uuid()
       << " for tablet " << tablet_id_ << "."
       << resp_err_info
       << " Status: " << status.ToString() << "."
       << " Retrying in the next heartbeat period."
-      << " Already tried " << failed_attempts_ << " times.";
+      << " Already tried " << failed_attempts << " times.";
+  owned_req.reset();
   sem_.Release();
 }
 
@@ -355,13 +438,16 @@ void Peer::Close() {
   }
   LOG_WITH_PREFIX_UNLOCKED(INFO) << "Closing peer: " << peer_pb_.permanent_uuid();
 
-  // Acquire the semaphore to wait for any concurrent request to finish.
+  // Acquire the whole semaphore to wait for any concurrent requests to finish.
   // They will see the state_ == kPeerClosed and not start any new requests,
   // but we can't currently cancel the already-sent ones. (see KUDU-699)
-  std::lock_guard<Semaphore> l(sem_);
+  for (int i = 0; i < max_inflight_requests_; i++) {
+    sem_.Acquire();
+  }
   queue_->UntrackPeer(peer_pb_.permanent_uuid());
-  // We don't own the ops (the queue does).
-  request_.mutable_ops()->ExtractSubrange(0, request_.ops_size(), nullptr);
+  for (int i = 0; i < max_inflight_requests_; i++) {
+    sem_.Release();
+  }
 }
 
 Peer::~Peer() {
@@ -369,10 +455,28 @@ Peer::~Peer() {
 }
 
 
+namespace {
+
+void RunWithControllerStatus(const RpcController* controller, const StatusCallback& callback) {
+  callback.Run(controller->status());
+}
+
+} // anonymous namespace
+
+void PeerProxy::HeartbeatAsync(const ConsensusRequestPB* request,
+                               ConsensusResponsePB* response,
+                               rpc::RpcController* controller,
+                               const StatusCallback& callback) {
+  UpdateAsync(request, response, controller,
+              boost::bind(&RunWithControllerStatus, controller, callback));
+}
+
 RpcPeerProxy::RpcPeerProxy(gscoped_ptr<HostPort> hostport,
-                           gscoped_ptr<ConsensusServiceProxy> consensus_proxy)
+                           gscoped_ptr<ConsensusServiceProxy> consensus_proxy,
+                           MultiRaftHeartbeatBatcher* heartbeat_batcher)
     : hostport_(std::move(hostport)),
-      consensus_proxy_(std::move(consensus_proxy)) {
+      consensus_proxy_(std::move(consensus_proxy)),
+      heartbeat_batcher_(heartbeat_batcher) {
 }
 
 void RpcPeerProxy::UpdateAsync(const ConsensusRequestPB* request,
@@ -383,6 +487,59 @@ void RpcPeerProxy::UpdateAsync(const ConsensusRequestPB* request,
   consensus_proxy_->UpdateConsensusAsync(*request, response, controller, callback);
 }
 
+void RpcPeerProxy::UpdateWithReplicatesAsync(ConsensusRequestPB* request,
+                                             const vector<ReplicateRefPtr>& replicates,
+                                             ConsensusResponsePB* response,
+                                             rpc::RpcController* controller,
+                                             const rpc::ResponseCallback& callback) {
+  using google::protobuf::internal::WireFormatLite;
+  int num_ops = request->ops_size();
+  if (num_ops == 0 || static_cast<int>(replicates.size()) != num_ops) {
+    UpdateAsync(request, response, controller, callback);
+    return;
+  }
+
+  // Collect the replicates' encodings, each preceded by the tag and length
+  // that make it an element of the request's 'ops' field.
+  const uint32_t kOpsTag = WireFormatLite::MakeTag(ConsensusRequestPB::kOpsFieldNumber,
+                                                   WireFormatLite::WIRETYPE_LENGTH_DELIMITED);
+  vector<Slice> encoded_ops(num_ops);
+  faststring prefixes;
+  vector<size_t> prefix_ends;
+  prefix_ends.reserve(num_ops);
+  for (int i = 0; i < num_ops; i++) {
+    if (PREDICT_FALSE(replicates[i]->get() != &request->ops(i) ||
+                      !replicates[i]->GetSerialized(&encoded_ops[i]).ok())) {
+      UpdateAsync(request, response, controller, callback);
+      return;
+    }
+    PutVarint32(&prefixes, kOpsTag);
+    PutVarint32(&prefixes, encoded_ops[i].size());
+    prefix_ends.push_back(prefixes.size());
+  }
+
+  // Copy the rest of the request without the ops, which we don't own, and
+  // have the controller append the ops after it. Fields may come in any
+  // order on the wire, so the result parses as the whole request.
+  ConsensusRequestPB request_without_ops;
+  google::protobuf::RepeatedPtrField<ReplicateMsg> ops;
+  ops.Swap(request->mutable_ops());
+  request_without_ops.CopyFrom(*request);
+  ops.Swap(request->mutable_ops());
+
+  size_t prefix_start = 0;
+  for (int i = 0; i < num_ops; i++) {
+    controller->AppendSerializedRequestFields(
+        Slice(prefixes.data() + prefix_start, prefix_ends[i] - prefix_start));
+    controller->AppendSerializedRequestFields(encoded_ops[i]);
+    prefix_start = prefix_ends[i];
+  }
+
+  // The request is serialized before this returns, so it's fine for it and
+  // the prefixes to go out of scope afterwards.
+  UpdateAsync(&request_without_ops, response, controller, callback);
+}
+
 void RpcPeerProxy::RequestConsensusVoteAsync(const VoteRequestPB* request,
                                              VoteResponsePB* response,
                                              rpc::RpcController* controller,
@@ -397,6 +554,24 @@ void RpcPeerProxy::StartTabletCopy(const StartTabletCopyRequestPB* request,
   consensus_proxy_->StartTabletCopyAsync(*request, response, controller, callback);
 }
 
+void RpcPeerProxy::StartElectionAsync(const RunLeaderElectionRequestPB* request,
+                                      RunLeaderElectionResponsePB* response,
+                                      rpc::RpcController* controller,
+                                      const rpc::ResponseCallback& callback) {
+  consensus_proxy_->RunLeaderElectionAsync(*request, response, controller, callback);
+}
+
+void RpcPeerProxy::HeartbeatAsync(const ConsensusRequestPB* request,
+                                  ConsensusResponsePB* response,
+                                  rpc::RpcController* controller,
+                                  const StatusCallback& callback) {
+  if (heartbeat_batcher_ == nullptr) {
+    PeerProxy::HeartbeatAsync(request, response, controller, callback);
+    return;
+  }
+  heartbeat_batcher_->AddHeartbeat(*hostport_, request, response, callback);
+}
+
 RpcPeerProxy::~RpcPeerProxy() {}
 
 namespace {
@@ -417,8 +592,10 @@ Status CreateConsensusServiceProxyForHost(const shared_ptr<Messenger>& messenger
 
 } // anonymous namespace
 
-RpcPeerProxyFactory::RpcPeerProxyFactory(shared_ptr<Messenger> messenger)
-    : messenger_(std::move(messenger)) {}
+RpcPeerProxyFactory::RpcPeerProxyFactory(shared_ptr<Messenger> messenger,
+                                         MultiRaftHeartbeatBatcher* heartbeat_batcher)
+    : messenger_(std::move(messenger)),
+      heartbeat_batcher_(heartbeat_batcher) {}
 
 Status RpcPeerProxyFactory::NewProxy(const RaftPeerPB& peer_pb,
                                      gscoped_ptr<PeerProxy>* proxy) {
@@ -426,7 +603,7 @@ Status RpcPeerProxyFactory::NewProxy(const RaftPeerPB& peer_pb,
   RETURN_NOT_OK(HostPortFromPB(peer_pb.last_known_addr(), hostport.get()));
   gscoped_ptr<ConsensusServiceProxy> new_proxy;
   RETURN_NOT_OK(CreateConsensusServiceProxyForHost(messenger_, *hostport, &new_proxy));
-  proxy->reset(new RpcPeerProxy(std::move(hostport), std::move(new_proxy)));
+  proxy->reset(new RpcPeerProxy(std::move(hostport), std::move(new_proxy), heartbeat_batcher_));
   return Status::OK();
 }
 
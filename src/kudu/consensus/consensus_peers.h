@@ -29,9 +29,12 @@
 #include "kudu/rpc/rpc_controller.h"
 #include "kudu/util/countdown_latch.h"
 #include "kudu/util/locks.h"
+#include "kudu/util/monotime.h"
+#include "kudu/util/mutex.h"
 #include "kudu/util/resettable_heartbeater.h"
 #include "kudu/util/semaphore.h"
 #include "kudu/util/status.h"
+#include "kudu/util/status_callback.h"
 
 namespace kudu {
 class HostPort;
@@ -48,6 +51,7 @@ class RpcController;
 
 namespace consensus {
 class ConsensusServiceProxy;
+class MultiRaftHeartbeatBatcher;
 class OpId;
 class PeerProxy;
 class PeerProxyFactory;
@@ -63,6 +67,13 @@ class VoteResponsePB;
 // state aside from whether there are requests pending or if requests
 // are being processed.
 //
+// Up to --consensus_max_inflight_requests_per_peer requests may be
+// outstanding to the peer at once. While the peer is in sync with the
+// leader, each new request picks up where the previous one left off,
+// so that replication to a distant peer is not limited to one batch of
+// operations per round trip. "processing" below means that the window
+// of outstanding requests is full.
+//
 // There are two external actions that trigger a state change:
 //
 // SignalRequest(): Called by the consensus implementation, notifies
@@ -126,8 +137,6 @@ class Peer {
 
   void Close();
 
-  void SetTermForTest(int term);
-
   ~Peer();
 
   // Creates a new remote peer and makes the queue track it.'
@@ -149,16 +158,50 @@ class Peer {
        gscoped_ptr<PeerProxy> proxy, PeerMessageQueue* queue,
        ThreadPool* thread_pool);
 
-  void SendNextRequest(bool even_if_queue_empty);
+  // A consensus update sent to the peer, along with the state that must
+  // live until its response has been handled.
+  struct InFlightRequest {
+    ~InFlightRequest();
+
+    ConsensusRequestPB request;
+    ConsensusResponsePB response;
+
+    // Reference-counted pointers to the ReplicateMsgs in 'request'. We may have
+    // loaded these messages from the LogCache, in which case we are potentially
+    // sharing the same object as other peers. Since the PB request itself
+    // can't hold reference counts, this holds them.
+    std::vector<ReplicateRefPtr> replicate_msg_refs;
+
+    rpc::RpcController controller;
+
+    // When the request was sent, used to extend the leader's lease.
+    MonoTime send_time;
+  };
+
+  // Like SignalRequest(), where 'is_heartbeat' indicates whether it was
+  // called by the heartbeater.
+  Status DoSignalRequest(bool even_if_queue_empty, bool is_heartbeat);
+
+  // Called by the heartbeater.
+  Status SignalHeartbeat();
 
-  // Signals that a response was received from the peer.
+  // If the request has nothing to send and 'is_heartbeat' is true, it is sent
+  // as a heartbeat, which the proxy may batch with those of other tablets.
+  void SendNextRequest(bool even_if_queue_empty, bool is_heartbeat);
+
+  // Signals that a response to 'req' was received from the peer, where
+  // 'rpc_status' is the outcome of the RPC which carried it.
   // This method is called from the reactor thread and calls
   // DoProcessResponse() on thread_pool_ to do any work that requires IO or
   // lock-taking.
-  void ProcessResponse();
+  void ProcessResponse(InFlightRequest* req, const Status& rpc_status);
+
+  // Callback for requests sent through UpdateWithReplicatesAsync().
+  void ProcessUpdateResponse(InFlightRequest* req);
 
   // Run on 'thread_pool'. Does response handling that requires IO or may block.
-  void DoProcessResponse();
+  // Takes ownership of 'req'.
+  void DoProcessResponse(InFlightRequest* req);
 
   // Fetch the desired tablet copy request from the queue and send it
   // to the peer. The callback goes to ProcessTabletCopyResponse().
@@ -170,8 +213,9 @@ class Peer {
   // Handle RPC callback from initiating tablet copy.
   void ProcessTabletCopyResponse();
 
-  // Signals there was an error sending the request to the peer.
-  void ProcessResponseError(const Status& status);
+  // Signals there was an error sending 'req' to the peer. Takes ownership
+  // of 'req'.
+  void ProcessResponseError(InFlightRequest* req, const Status& status);
 
   std::string LogPrefixUnlocked() const;
 
@@ -185,31 +229,35 @@ class Peer {
   gscoped_ptr<PeerProxy> proxy_;
 
   PeerMessageQueue* queue_;
+
+  // Protected by peer_lock_.
   uint64_t failed_attempts_;
 
-  // The latest consensus update request and response.
-  ConsensusRequestPB request_;
-  ConsensusResponsePB response_;
+  // The maximum number of consensus updates outstanding to the peer at once.
+  const int max_inflight_requests_;
+
+  // Serializes building and sending requests, so that pipelined requests
+  // leave in the order in which the queue handed out their operations.
+  Mutex send_lock_;
+
+  // The committed index sent in the latest request built from the queue.
+  // Protected by send_lock_.
+  int64_t last_committed_index_;
 
   // The latest tablet copy request and response.
   StartTabletCopyRequestPB tc_request_;
   StartTabletCopyResponsePB tc_response_;
+  rpc::RpcController tc_controller_;
 
-  // Reference-counted pointers to any ReplicateMsgs which are in-flight to the peer. We
-  // may have loaded these messages from the LogCache, in which case we are potentially
-  // sharing the same object as other peers. Since the PB request_ itself can't hold
-  // reference counts, this holds them.
-  std::vector<ReplicateRefPtr> replicate_msg_refs_;
+  // Whether a tablet copy request is outstanding. Protected by peer_lock_.
+  bool tc_in_flight_;
 
-  rpc::RpcController controller_;
-
-  // Held if there is an outstanding request.
-  // This is used in order to ensure that we only have a single request
-  // oustanding at a time, and to wait for the outstanding requests
-  // at Close().
+  // One unit is held for each outstanding request.
+  // This is used in order to bound the number of requests outstanding
+  // at a time to 'max_inflight_requests_', and to wait for the
+  // outstanding requests at Close().
   Semaphore sem_;
 
-
   // Heartbeater for remote peer implementations.
   // This will send status only requests to the remote peers
   // whenever we go more than 'FLAGS_raft_heartbeat_interval_ms'
@@ -243,6 +291,27 @@ class PeerProxy {
                            rpc::RpcController* controller,
                            const rpc::ResponseCallback& callback) = 0;
 
+  // Sends the same request as UpdateAsync(), where 'replicates' hold the
+  // messages in request->ops(). Proxies which serialize the request may send
+  // the replicates' cached encodings rather than encode the ops again. The
+  // request is the same as it was when this returns.
+  virtual void UpdateWithReplicatesAsync(ConsensusRequestPB* request,
+                                         const std::vector<ReplicateRefPtr>& replicates,
+                                         ConsensusResponsePB* response,
+                                         rpc::RpcController* controller,
+                                         const rpc::ResponseCallback& callback) {
+    UpdateAsync(request, response, controller, callback);
+  }
+
+  // Sends a status-only request, one without ops, to a remote peer. Proxies
+  // may batch it with the heartbeats of other tablets to the same server, in
+  // which case 'controller' is unused. The outcome of the RPC which carried
+  // the request is passed to 'callback'.
+  virtual void HeartbeatAsync(const ConsensusRequestPB* request,
+                              ConsensusResponsePB* response,
+                              rpc::RpcController* controller,
+                              const StatusCallback& callback);
+
   // Sends a RequestConsensusVote to a remote peer.
   virtual void RequestConsensusVoteAsync(const VoteRequestPB* request,
                                          VoteResponsePB* response,
@@ -257,6 +326,15 @@ class PeerProxy {
     LOG(DFATAL) << "Not implemented";
   }
 
+  // Instructs a peer to run a leader election, even if it believes that a
+  // leader is alive.
+  virtual void StartElectionAsync(const RunLeaderElectionRequestPB* request,
+                                  RunLeaderElectionResponsePB* response,
+                                  rpc::RpcController* controller,
+                                  const rpc::ResponseCallback& callback) {
+    LOG(DFATAL) << "Not implemented";
+  }
+
   virtual ~PeerProxy() {}
 };
 
@@ -274,14 +352,27 @@ class PeerProxyFactory {
 // PeerProxy implementation that does RPC calls
 class RpcPeerProxy : public PeerProxy {
  public:
+  // If 'heartbeat_batcher' is not null, heartbeats are sent through it.
   RpcPeerProxy(gscoped_ptr<HostPort> hostport,
-               gscoped_ptr<ConsensusServiceProxy> consensus_proxy);
+               gscoped_ptr<ConsensusServiceProxy> consensus_proxy,
+               MultiRaftHeartbeatBatcher* heartbeat_batcher);
 
   virtual void UpdateAsync(const ConsensusRequestPB* request,
                            ConsensusResponsePB* response,
                            rpc::RpcController* controller,
                            const rpc::ResponseCallback& callback) OVERRIDE;
 
+  virtual void UpdateWithReplicatesAsync(ConsensusRequestPB* request,
+                                         const std::vector<ReplicateRefPtr>& replicates,
+                                         ConsensusResponsePB* response,
+                                         rpc::RpcController* controller,
+                                         const rpc::ResponseCallback& callback) OVERRIDE;
+
+  virtual void HeartbeatAsync(const ConsensusRequestPB* request,
+                              ConsensusResponsePB* response,
+                              rpc::RpcController* controller,
+                              const StatusCallback& callback) OVERRIDE;
+
   virtual void RequestConsensusVoteAsync(const VoteRequestPB* request,
                                          VoteResponsePB* response,
                                          rpc::RpcController* controller,
@@ -292,17 +383,26 @@ class RpcPeerProxy : public PeerProxy {
                                     rpc::RpcController* controller,
                                     const rpc::ResponseCallback& callback) OVERRIDE;
 
+  virtual void StartElectionAsync(const RunLeaderElectionRequestPB* request,
+                                  RunLeaderElectionResponsePB* response,
+                                  rpc::RpcController* controller,
+                                  const rpc::ResponseCallback& callback) OVERRIDE;
+
   virtual ~RpcPeerProxy();
 
  private:
   gscoped_ptr<HostPort> hostport_;
   gscoped_ptr<ConsensusServiceProxy> consensus_proxy_;
+  MultiRaftHeartbeatBatcher* const heartbeat_batcher_;
 };
 
 // PeerProxyFactory implementation that generates RPCPeerProxies
 class RpcPeerProxyFactory : public PeerProxyFactory {
  public:
-  explicit RpcPeerProxyFactory(std::shared_ptr<rpc::Messenger> messenger);
+  // 'heartbeat_batcher' may be null, in which case each heartbeat is sent
+  // on its own. Otherwise, it must outlive the factory's proxies.
+  RpcPeerProxyFactory(std::shared_ptr<rpc::Messenger> messenger,
+                      MultiRaftHeartbeatBatcher* heartbeat_batcher);
 
   virtual Status NewProxy(const RaftPeerPB& peer_pb,
                           gscoped_ptr<PeerProxy>* proxy) OVERRIDE;
@@ -310,6 +410,7 @@ class RpcPeerProxyFactory : public PeerProxyFactory {
   virtual ~RpcPeerProxyFactory();
  private:
   std::shared_ptr<rpc::Messenger> messenger_;
+  MultiRaftHeartbeatBatcher* const heartbeat_batcher_;
 };
 
 // Query the consensus service at last known host/port that is
@@ -35,6 +35,7 @@
 
 DECLARE_bool(enable_data_block_fsync);
 DECLARE_int32(consensus_max_batch_size_bytes);
+DECLARE_int32(consensus_max_inflight_requests_per_peer);
 
 METRIC_DECLARE_entity(tablet);
 
@@ -299,6 +300,85 @@ TEST_F(ConsensusQueueTest, TestGetPagedMessages) {
   request.mutable_ops()->ExtractSubrange(0, request.ops_size(), nullptr);
 }
 
+// Tests that, with several requests outstanding to a peer, each request picks
+// up after the previous one, that responses handled out of order don't move
+// the peer backwards, and that an LMP mismatch resends from the peer's point.
+TEST_F(ConsensusQueueTest, TestPipelinedRequests) {
+  queue_->Init(MinimumOpId());
+  queue_->SetLeaderMode(kMinimumOpIdIndex, kMinimumTerm, BuildRaftConfigPBForTests(2));
+
+  ConsensusRequestPB page_size_estimator;
+  page_size_estimator.set_caller_term(14);
+  page_size_estimator.set_committed_index(0);
+  page_size_estimator.set_all_replicated_index(0);
+  page_size_estimator.mutable_preceding_id()->CopyFrom(MinimumOpId());
+  const int kOpsPerRequest = 9;
+  for (int i = 0; i < kOpsPerRequest; i++) {
+    page_size_estimator.mutable_ops()->AddAllocated(
+        CreateDummyReplicate(0, 0, clock_->Now(), 0).release());
+  }
+
+  google::FlagSaver saver;
+  FLAGS_consensus_max_batch_size_bytes = page_size_estimator.ByteSize();
+  FLAGS_consensus_max_inflight_requests_per_peer = 2;
+
+  ConsensusRequestPB requests[4];
+  ConsensusResponsePB response;
+  response.set_responder_uuid(kPeerUuid);
+  bool more_pending = false;
+  UpdatePeerWatermarkToOp(&requests[0], &response, MinimumOpId(), MinimumOpId(), &more_pending);
+  ASSERT_TRUE(more_pending);
+  AppendReplicateMessagesToQueue(queue_.get(), clock_, 1, 100);
+
+  vector<ReplicateRefPtr> refs[4];
+  bool needs_tablet_copy;
+
+  // The last exchange failed, so the first request isn't followed by others
+  // until the peer accepts it.
+  ASSERT_OK(queue_->RequestForPeer(kPeerUuid, &requests[0], &refs[0], &needs_tablet_copy));
+  ASSERT_EQ(1, requests[0].ops(0).id().index());
+  ASSERT_OK(queue_->RequestForPeer(kPeerUuid, &requests[0], &refs[0], &needs_tablet_copy));
+  ASSERT_EQ(1, requests[0].ops(0).id().index());
+  response.Clear();
+  response.set_responder_uuid(kPeerUuid);
+  SetLastReceivedAndLastCommitted(&response, requests[0].ops(kOpsPerRequest - 1).id());
+  queue_->ResponseFromPeer(kPeerUuid, response, &more_pending);
+  ASSERT_TRUE(more_pending);
+
+  // Now the peer is in sync, so the following requests cover consecutive ranges.
+  ASSERT_OK(queue_->RequestForPeer(kPeerUuid, &requests[1], &refs[1], &needs_tablet_copy));
+  ASSERT_OK(queue_->RequestForPeer(kPeerUuid, &requests[2], &refs[2], &needs_tablet_copy));
+  ASSERT_EQ(kOpsPerRequest + 1, requests[1].ops(0).id().index());
+  ASSERT_EQ(2 * kOpsPerRequest + 1, requests[2].ops(0).id().index());
+  OpId last_of_second = requests[1].ops(kOpsPerRequest - 1).id();
+  OpId last_of_third = requests[2].ops(kOpsPerRequest - 1).id();
+
+  // The responses are handled in the opposite order. The stale one doesn't make
+  // the queue resend what the peer already has.
+  SetLastReceivedAndLastCommitted(&response, last_of_third);
+  queue_->ResponseFromPeer(kPeerUuid, response, &more_pending);
+  SetLastReceivedAndLastCommitted(&response, last_of_second);
+  queue_->ResponseFromPeer(kPeerUuid, response, &more_pending);
+  ASSERT_TRUE(more_pending);
+  ASSERT_OK(queue_->RequestForPeer(kPeerUuid, &requests[3], &refs[3], &needs_tablet_copy));
+  ASSERT_EQ(last_of_third.index() + 1, requests[3].ops(0).id().index());
+
+  // The peer rejects the request, having only received the second one. The
+  // queue resends from there, and stops pipelining until the peer accepts.
+  RefuseWithLogPropertyMismatch(&response, last_of_second, last_of_second);
+  queue_->ResponseFromPeer(kPeerUuid, response, &more_pending);
+  ASSERT_TRUE(more_pending);
+  ASSERT_OK(queue_->RequestForPeer(kPeerUuid, &requests[2], &refs[2], &needs_tablet_copy));
+  ASSERT_OK(queue_->RequestForPeer(kPeerUuid, &requests[3], &refs[3], &needs_tablet_copy));
+  ASSERT_EQ(last_of_second.index() + 1, requests[2].ops(0).id().index());
+  ASSERT_EQ(last_of_second.index() + 1, requests[3].ops(0).id().index());
+
+  // Extract the ops from the requests to avoid double free.
+  for (ConsensusRequestPB& request : requests) {
+    request.mutable_ops()->ExtractSubrange(0, request.ops_size(), nullptr);
+  }
+}
+
 TEST_F(ConsensusQueueTest, TestPeersDontAckBeyondWatermarks) {
   queue_->Init(MinimumOpId());
   queue_->SetLeaderMode(kMinimumOpIdIndex, kMinimumTerm, BuildRaftConfigPBForTests(3));
@@ -443,6 +523,128 @@ TEST_F(ConsensusQueueTest, TestQueueAdvancesCommittedIndex) {
   ASSERT_EQ(queue_->GetAllReplicatedIndex(), 5);
 }
 
+// Tests that non-voters receive operations, and hold back the all-replicated
+// index, but don't count towards the majority which commits them.
+TEST_F(ConsensusQueueTest, TestNonVotersDontCountTowardsMajority) {
+  RaftConfigPB config = BuildRaftConfigPBForTests(5);
+  config.mutable_peers(3)->set_member_type(RaftPeerPB::NON_VOTER);
+  config.mutable_peers(4)->set_member_type(RaftPeerPB::NON_VOTER);
+  queue_->Init(MinimumOpId());
+  queue_->SetLeaderMode(kMinimumOpIdIndex, kMinimumTerm, config);
+  queue_->TrackPeer("peer-1");
+  queue_->TrackPeer("peer-2");
+  queue_->TrackPeer("peer-3");
+  queue_->TrackPeer("peer-4");
+
+  AppendReplicateMessagesToQueue(queue_.get(), clock_, 1, 5);
+  WaitForLocalPeerToAckIndex(5);
+
+  ConsensusResponsePB response;
+  response.set_responder_term(0);
+  SetLastReceivedAndLastCommitted(&response, MakeOpId(0, 5), MinimumOpId().index());
+  bool more_pending;
+
+  // Both non-voters have all of the operations, but along with the leader
+  // they are not a majority of the three voters.
+  for (const char* uuid : { "peer-3", "peer-4" }) {
+    response.set_responder_uuid(uuid);
+    queue_->ResponseFromPeer(response.responder_uuid(), response, &more_pending);
+  }
+  ASSERT_EQ(0, queue_->GetMajorityReplicatedIndexForTests());
+  ASSERT_EQ(0, queue_->GetCommittedIndex());
+
+  // A single voter is enough.
+  response.set_responder_uuid("peer-1");
+  queue_->ResponseFromPeer(response.responder_uuid(), response, &more_pending);
+  ASSERT_EQ(5, queue_->GetMajorityReplicatedIndexForTests());
+  ASSERT_EQ(5, queue_->GetCommittedIndex());
+  ASSERT_EQ(0, queue_->GetAllReplicatedIndex());
+
+  response.set_responder_uuid("peer-2");
+  queue_->ResponseFromPeer(response.responder_uuid(), response, &more_pending);
+  ASSERT_EQ(5, queue_->GetAllReplicatedIndex());
+}
+
+// Tests that the watermarks, which are only recomputed when a peer makes
+// progress, are still recomputed after a lagging peer is untracked.
+TEST_F(ConsensusQueueTest, TestWatermarksRecomputedAfterUntrackingPeer) {
+  queue_->Init(MinimumOpId());
+  queue_->SetLeaderMode(kMinimumOpIdIndex, kMinimumTerm, BuildRaftConfigPBForTests(3));
+  queue_->TrackPeer("peer-1");
+  queue_->TrackPeer("peer-2");
+
+  AppendReplicateMessagesToQueue(queue_.get(), clock_, 1, 10);
+  WaitForLocalPeerToAckIndex(10);
+
+  ConsensusResponsePB response;
+  response.set_responder_term(1);
+  bool more_pending;
+
+  response.set_responder_uuid("peer-2");
+  SetLastReceivedAndLastCommitted(&response, MakeOpId(0, 5), MinimumOpId().index());
+  queue_->ResponseFromPeer(response.responder_uuid(), response, &more_pending);
+
+  response.set_responder_uuid("peer-1");
+  SetLastReceivedAndLastCommitted(&response, MakeOpId(1, 10), MinimumOpId().index());
+  queue_->ResponseFromPeer(response.responder_uuid(), response, &more_pending);
+  ASSERT_EQ(10, queue_->GetCommittedIndex());
+  ASSERT_EQ(5, queue_->GetAllReplicatedIndex());
+
+  // A heartbeat which reports no progress doesn't change the watermarks...
+  queue_->ResponseFromPeer(response.responder_uuid(), response, &more_pending);
+  ASSERT_EQ(5, queue_->GetAllReplicatedIndex());
+
+  // ...unless the set of peers changed since they were last computed.
+  queue_->UntrackPeer("peer-2");
+  queue_->ResponseFromPeer(response.responder_uuid(), response, &more_pending);
+  ASSERT_EQ(10, queue_->GetAllReplicatedIndex());
+}
+
+// Tests that the leader lease starts when a majority of voters, counting the
+// leader itself, accepted requests, and only once the leader has committed an
+// operation in its own term.
+TEST_F(ConsensusQueueTest, TestLeaderLeaseStartTime) {
+  queue_->Init(MinimumOpId());
+  queue_->SetLeaderMode(kMinimumOpIdIndex, kMinimumTerm, BuildRaftConfigPBForTests(3));
+  queue_->TrackPeer("peer-1");
+  queue_->TrackPeer("peer-2");
+
+  AppendReplicateMessagesToQueue(queue_.get(), clock_, 1, 5);
+  WaitForLocalPeerToAckIndex(5);
+
+  // A peer accepting a request isn't enough while nothing in this term has
+  // been committed.
+  MonoTime first_send_time = MonoTime::Now();
+  queue_->NotifyPeerAcceptedRequest("peer-1", first_send_time);
+  ASSERT_TRUE(queue_->GetLeaderLeaseStartTime().Equals(MonoTime::Min()));
+
+  ConsensusResponsePB response;
+  response.set_responder_term(0);
+  response.set_responder_uuid("peer-1");
+  SetLastReceivedAndLastCommitted(&response, MakeOpId(0, 5), MinimumOpId().index());
+  bool more_pending;
+  queue_->ResponseFromPeer(response.responder_uuid(), response, &more_pending);
+  ASSERT_EQ(5, queue_->GetCommittedIndex());
+
+  // 'peer-1' and the leader form a majority.
+  ASSERT_TRUE(queue_->GetLeaderLeaseStartTime().Equals(first_send_time));
+
+  // A late notification for an older request doesn't shorten the lease, while
+  // a newer one from the other peer extends it.
+  MonoTime second_send_time = MonoTime::Now();
+  second_send_time.AddDelta(MonoDelta::FromMilliseconds(1));
+  MonoTime stale_send_time = first_send_time;
+  stale_send_time.AddDelta(MonoDelta::FromMilliseconds(-1));
+  queue_->NotifyPeerAcceptedRequest("peer-1", stale_send_time);
+  ASSERT_TRUE(queue_->GetLeaderLeaseStartTime().Equals(first_send_time));
+  queue_->NotifyPeerAcceptedRequest("peer-2", second_send_time);
+  ASSERT_TRUE(queue_->GetLeaderLeaseStartTime().Equals(second_send_time));
+
+  // Followers hold no lease.
+  queue_->SetNonLeaderMode();
+  ASSERT_TRUE(queue_->GetLeaderLeaseStartTime().Equals(MonoTime::Min()));
+}
+
 // In this test we append a sequence of operations to a log
 // and then start tracking a peer whose first required operation
 // is before the first operation in the queue.
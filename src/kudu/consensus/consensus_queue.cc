@@ -34,6 +34,7 @@
 #include "kudu/consensus/raft_consensus.h"
 #include "kudu/gutil/dynamic_annotations.h"
 #include "kudu/gutil/map-util.h"
+#include "kudu/gutil/mathlimits.h"
 #include "kudu/gutil/stl_util.h"
 #include "kudu/gutil/strings/human_readable.h"
 #include "kudu/gutil/strings/join.h"
@@ -58,6 +59,21 @@ DEFINE_int32(follower_unavailable_considered_failed_sec, 300,
              "evicted from the config.");
 TAG_FLAG(follower_unavailable_considered_failed_sec, advanced);
 
+DEFINE_int32(log_cache_retention_peer_lag_ops, 1000,
+             "The log cache keeps the operations needed by peers which lag behind the "
+             "leader by no more than this many operations, evicting older ones first when "
+             "it is full. 0 disables this, so that the oldest are always evicted first.");
+TAG_FLAG(log_cache_retention_peer_lag_ops, advanced);
+
+DEFINE_bool(propagate_safe_time_to_followers, true,
+            "Whether leaders send a safe time with each request to their followers, "
+            "so that snapshot scans on followers of idle tablets don't have to wait "
+            "for new writes.");
+TAG_FLAG(propagate_safe_time_to_followers, advanced);
+TAG_FLAG(propagate_safe_time_to_followers, runtime);
+
+DECLARE_int32(consensus_max_inflight_requests_per_peer);
+
 DEFINE_int32(consensus_inject_latency_ms_in_notifications, 0,
              "Injects a random sleep between 0 and this many milliseconds into "
              "asynchronous notifications from the consensus queue back to the "
@@ -101,8 +117,10 @@ PeerMessageQueue::Metrics::Metrics(const scoped_refptr<MetricEntity>& metric_ent
 PeerMessageQueue::PeerMessageQueue(const scoped_refptr<MetricEntity>& metric_entity,
                                    const scoped_refptr<log::Log>& log,
                                    const RaftPeerPB& local_peer_pb,
-                                   const string& tablet_id)
+                                   const string& tablet_id,
+                                   ThreadPool* observers_pool)
     : local_peer_pb_(local_peer_pb),
+      txn_factory_(nullptr),
       tablet_id_(tablet_id),
       log_cache_(metric_entity, log, local_peer_pb.permanent_uuid(), tablet_id),
       metrics_(metric_entity) {
@@ -116,7 +134,13 @@ PeerMessageQueue::PeerMessageQueue(const scoped_refptr<MetricEntity>& metric_ent
   queue_state_.state = kQueueConstructed;
   queue_state_.mode = NON_LEADER;
   queue_state_.majority_size_ = -1;
-  CHECK_OK(ThreadPoolBuilder("queue-observers-pool").set_max_threads(1).Build(&observers_pool_));
+  queue_state_.watermarks_stale = true;
+  if (!observers_pool) {
+    CHECK_OK(ThreadPoolBuilder("queue-observers-pool").set_max_threads(1)
+             .Build(&observers_pool_));
+    observers_pool = observers_pool_.get();
+  }
+  observers_token_ = observers_pool->NewToken(ThreadPool::ExecutionMode::SERIAL);
 }
 
 void PeerMessageQueue::Init(const OpId& last_locally_replicated) {
@@ -146,6 +170,7 @@ void PeerMessageQueue::SetLeaderMode(int64_t committed_index,
       << queue_state_.active_config->ShortDebugString();
   queue_state_.majority_size_ = MajoritySize(CountVoters(*queue_state_.active_config));
   queue_state_.mode = LEADER;
+  UpdatePeerVoterStatusUnlocked();
 
   LOG_WITH_PREFIX_UNLOCKED(INFO) << "Queue going to LEADER mode. State: "
       << queue_state_.ToString();
@@ -187,9 +212,13 @@ void PeerMessageQueue::TrackPeerUnlocked(const string& uuid) {
   // does not have a log that matches ours, the normal queue negotiation
   // process will eventually find the right point to resume from.
   tracked_peer->next_index = queue_state_.last_appended.index() + 1;
+  if (queue_state_.mode == LEADER) {
+    tracked_peer->is_voter = IsRaftConfigVoter(uuid, *queue_state_.active_config);
+  }
   InsertOrDie(&peers_map_, uuid, tracked_peer);
 
   CheckPeersInActiveConfigIfLeaderUnlocked();
+  queue_state_.watermarks_stale = true;
 
   // We don't know how far back this peer is, so set the all replicated watermark to
   // 0. We'll advance it when we know how far along the peer is.
@@ -201,7 +230,17 @@ void PeerMessageQueue::UntrackPeer(const string& uuid) {
   TrackedPeer* peer = EraseKeyReturnValuePtr(&peers_map_, uuid);
   if (peer != nullptr) {
     delete peer;
+    queue_state_.watermarks_stale = true;
+  }
+}
+
+void PeerMessageQueue::UpdatePeerVoterStatusUnlocked() {
+  DCHECK(queue_lock_.is_locked());
+  DCHECK_EQ(queue_state_.mode, LEADER);
+  for (const PeersMap::value_type& entry : peers_map_) {
+    entry.second->is_voter = IsRaftConfigVoter(entry.first, *queue_state_.active_config);
   }
+  queue_state_.watermarks_stale = true;
 }
 
 void PeerMessageQueue::CheckPeersInActiveConfigIfLeaderUnlocked() const {
@@ -307,6 +346,21 @@ Status PeerMessageQueue::RequestForPeer(const string& uuid,
                                         bool* needs_tablet_copy) {
   TrackedPeer* peer = nullptr;
   OpId preceding_id;
+  int64_t next_index;
+
+  // Obtain the safe time before the committed index below: everything at or
+  // before it has committed by now, so the peer has it all once it has
+  // received up to that committed index.
+  Timestamp safe_time = Timestamp::kInvalidTimestamp;
+  if (FLAGS_propagate_safe_time_to_followers && txn_factory_ != nullptr) {
+    safe_time = txn_factory_->GetSafeTimeForReplicas();
+  }
+  if (safe_time != Timestamp::kInvalidTimestamp) {
+    request->set_safe_timestamp(safe_time.ToUint64());
+  } else {
+    request->clear_safe_timestamp();
+  }
+
   {
     std::lock_guard<simple_spinlock> lock(queue_lock_);
     DCHECK_EQ(queue_state_.state, kQueueOpen);
@@ -316,6 +370,7 @@ Status PeerMessageQueue::RequestForPeer(const string& uuid,
     if (PREDICT_FALSE(peer == nullptr || queue_state_.mode == NON_LEADER)) {
       return Status::NotFound("Peer not tracked or queue not in leader mode.");
     }
+    next_index = peer->next_index;
 
     // Clear the requests without deleting the entries, as they may be in use by other peers.
     request->mutable_ops()->ExtractSubrange(0, request->ops_size(), nullptr);
@@ -361,7 +416,7 @@ Status PeerMessageQueue::RequestForPeer(const string& uuid,
     int max_batch_size = FLAGS_consensus_max_batch_size_bytes - request->ByteSize();
 
     // We try to get the follower's next_index from our log.
-    Status s = log_cache_.ReadOps(peer->next_index - 1,
+    Status s = log_cache_.ReadOps(next_index - 1,
                                   max_batch_size,
                                   &messages,
                                   &preceding_id);
@@ -408,6 +463,18 @@ Status PeerMessageQueue::RequestForPeer(const string& uuid,
   // logging this fact periodically.
   if (request->ops_size() > 0) {
     int64_t last_op_sent = request->ops(request->ops_size() - 1).id().index();
+
+    // If the peer may have more than one request outstanding and is in sync
+    // with us, the next request picks up after this one rather than waiting
+    // for the peer to acknowledge it. Once the peer rejects a request, we
+    // stop doing so and resend from the point the peer reports.
+    if (FLAGS_consensus_max_inflight_requests_per_peer > 1) {
+      std::lock_guard<simple_spinlock> lock(queue_lock_);
+      if (peer->is_last_exchange_successful && peer->next_index == next_index) {
+        peer->next_index = last_op_sent + 1;
+      }
+    }
+
     if (last_op_sent < request->committed_index()) {
       KLOG_EVERY_N_SECS_THROTTLER(INFO, 3, peer->status_log_throttler, "lagging")
           << LogPrefixUnlocked() << "Peer " << uuid << " is lagging by at least "
@@ -462,6 +529,7 @@ void PeerMessageQueue::AdvanceQueueWatermark(const char* type,
                                              const OpId& replicated_before,
                                              const OpId& replicated_after,
                                              int num_peers_required,
+                                             ReplicaTypes replica_types,
                                              const TrackedPeer* who_caused) {
 
   if (VLOG_IS_ON(2)) {
@@ -479,6 +547,7 @@ void PeerMessageQueue::AdvanceQueueWatermark(const char* type,
   // - Find the vector.size() - 'num_peers_required' position, this
   //   will be the new 'watermark'.
   vector<int64_t> watermarks;
+  watermarks.reserve(peers_map_.size());
   for (const PeersMap::value_type& peer : peers_map_) {
     // TODO: The fact that we only consider peers whose last exchange was
     // successful can cause the "all_replicated" watermark to lag behind
@@ -500,6 +569,12 @@ void PeerMessageQueue::AdvanceQueueWatermark(const char* type,
     // was an error (LMP mismatch, for example), the 'last_received' is _not_ usable
     // for watermark calculation. This could be fixed by separately storing the
     // 'match_index' on a per-peer basis and using that for watermark calculation.
+    //
+    // Non-voters receive the same operations, but must not count towards the
+    // majority which commits them.
+    if (replica_types == VOTER_REPLICAS && !peer.second->is_voter) {
+      continue;
+    }
     if (peer.second->is_last_exchange_successful) {
       watermarks.push_back(peer.second->last_received.index());
     }
@@ -510,9 +585,12 @@ void PeerMessageQueue::AdvanceQueueWatermark(const char* type,
     return;
   }
 
-  std::sort(watermarks.begin(), watermarks.end());
+  // Only the position of the new watermark matters, so there is no need to
+  // sort all of them.
+  auto new_watermark_it = watermarks.end() - num_peers_required;
+  std::nth_element(watermarks.begin(), new_watermark_it, watermarks.end());
 
-  int64_t new_watermark = watermarks[watermarks.size() - num_peers_required];
+  int64_t new_watermark = *new_watermark_it;
   int64_t old_watermark = *watermark;
   *watermark = new_watermark;
 
@@ -523,6 +601,7 @@ void PeerMessageQueue::AdvanceQueueWatermark(const char* type,
     for (const PeersMap::value_type& peer : peers_map_) {
       VLOG_WITH_PREFIX_UNLOCKED(3) << "Peer: " << peer.second->ToString();
     }
+    std::sort(watermarks.begin(), watermarks.end());
     VLOG_WITH_PREFIX_UNLOCKED(3) << "Sorted watermarks:";
     for (int64_t watermark : watermarks) {
       VLOG_WITH_PREFIX_UNLOCKED(3) << "Watermark: " << watermark;
@@ -546,14 +625,83 @@ void PeerMessageQueue::NotifyPeerIsResponsiveDespiteError(const std::string& pee
   peer->last_successful_communication_time = MonoTime::Now();
 }
 
+void PeerMessageQueue::NotifyPeerAcceptedRequest(const std::string& peer_uuid,
+                                                 MonoTime send_time) {
+  std::lock_guard<simple_spinlock> l(queue_lock_);
+  TrackedPeer* peer = FindPtrOrNull(peers_map_, peer_uuid);
+  if (!peer) return;
+  // With several requests in flight, responses may be handled out of order.
+  if (send_time > peer->lease_grant_time) {
+    peer->lease_grant_time = send_time;
+  }
+}
+
+MonoTime PeerMessageQueue::GetLeaderLeaseStartTime() const {
+  std::lock_guard<simple_spinlock> l(queue_lock_);
+  if (queue_state_.mode != LEADER ||
+      queue_state_.first_index_in_current_term == boost::none ||
+      queue_state_.committed_index < queue_state_.first_index_in_current_term) {
+    return MonoTime::Min();
+  }
+
+  // As in AdvanceQueueWatermark(), sort the voters' grant times and pick the
+  // one which a majority has reached. This leader always counts.
+  vector<MonoTime> grant_times;
+  for (const PeersMap::value_type& peer : peers_map_) {
+    if (!peer.second->is_voter) {
+      continue;
+    }
+    if (peer.first == local_peer_pb_.permanent_uuid()) {
+      grant_times.push_back(MonoTime::Max());
+    } else {
+      grant_times.push_back(peer.second->lease_grant_time);
+    }
+  }
+  int majority_size = queue_state_.majority_size_;
+  if (majority_size <= 0 || static_cast<int>(grant_times.size()) < majority_size) {
+    return MonoTime::Min();
+  }
+  std::sort(grant_times.begin(), grant_times.end());
+  return grant_times[grant_times.size() - majority_size];
+}
+
+string PeerMessageQueue::GetMostUpToDateVoter() const {
+  std::lock_guard<simple_spinlock> l(queue_lock_);
+  if (queue_state_.mode != LEADER) {
+    return "";
+  }
+  const TrackedPeer* best = nullptr;
+  for (const PeersMap::value_type& entry : peers_map_) {
+    const TrackedPeer* peer = entry.second;
+    if (peer->uuid == local_peer_pb_.permanent_uuid() ||
+        !peer->is_last_exchange_successful ||
+        !peer->is_voter) {
+      continue;
+    }
+    if (best == nullptr || OpIdLessThan(best->last_received, peer->last_received)) {
+      best = peer;
+    }
+  }
+  return best == nullptr ? "" : best->uuid;
+}
+
 void PeerMessageQueue::ResponseFromPeer(const std::string& peer_uuid,
                                         const ConsensusResponsePB& response,
                                         bool* more_pending) {
   DCHECK(response.IsInitialized()) << "Error: Uninitialized: "
       << response.InitializationErrorString() << ". Response: " << response.ShortDebugString();
 
+  // Look the peer's last op up in the log cache before taking the queue lock:
+  // the cache has its own lock, and the answer depends only on the response.
+  bool peer_has_prefix_of_log = !response.has_error() && response.has_status() &&
+      IsOpInLog(response.status().last_received());
+
   boost::optional<int64_t> updated_commit_index;
   Mode mode_copy;
+  int64_t next_index;
+  int64_t peer_committed_index;
+  int64_t committed_index;
+  int64_t all_replicated_index;
   {
     std::lock_guard<simple_spinlock> scoped_lock(queue_lock_);
     DCHECK_NE(kQueueConstructed, queue_state_.state);
@@ -612,7 +760,6 @@ void PeerMessageQueue::ResponseFromPeer(const std::string& peer_uuid,
     // sent them anything, start after the last-committed op in their log, which
     // is guaranteed by the Raft protocol to be a valid op.
 
-    bool peer_has_prefix_of_log = IsOpInLog(status.last_received());
     if (peer_has_prefix_of_log) {
       // If the latest thing in their log is in our log, we are in sync.
       peer->last_received = status.last_received();
@@ -643,6 +790,8 @@ void PeerMessageQueue::ResponseFromPeer(const std::string& peer_uuid,
 
     if (PREDICT_FALSE(status.has_error())) {
       peer->is_last_exchange_successful = false;
+      // The peer no longer counts towards the watermarks.
+      queue_state_.watermarks_stale |= previous.is_last_exchange_successful;
       switch (status.error().code()) {
         case ConsensusErrorPB::PRECEDING_ENTRY_DIDNT_MATCH: {
           DCHECK(status.has_last_received());
@@ -673,6 +822,19 @@ void PeerMessageQueue::ResponseFromPeer(const std::string& peer_uuid,
 
     peer->is_last_exchange_successful = true;
 
+    // With several requests outstanding, the response to an earlier request may
+    // be handled after the response to a later one, and we may have already sent
+    // ops beyond what this response acknowledges. As long as the peer keeps
+    // accepting our requests, neither its progress nor the point we send from
+    // moves backwards.
+    if (FLAGS_consensus_max_inflight_requests_per_peer > 1 &&
+        previous.is_last_exchange_successful) {
+      if (peer->last_received.index() < previous.last_received.index()) {
+        peer->last_received = previous.last_received;
+      }
+      peer->next_index = std::max(peer->next_index, previous.next_index);
+    }
+
     if (response.has_responder_term()) {
       // The peer must have responded with a term that is greater than or equal to
       // the last known term for that peer.
@@ -695,13 +857,21 @@ void PeerMessageQueue::ResponseFromPeer(const std::string& peer_uuid,
     // NOTE: it's possible this node might have lost its leadership (and the notification
     // is just pending behind the lock we're holding), but any future leader will observe
     // the same watermarks and make the same advancement, so this is safe.
-    if (mode_copy == LEADER) {
+    //
+    // The watermarks are computed incrementally: only a peer whose progress
+    // changed can move them, so most heartbeats skip the computation.
+    bool peer_progressed = !previous.is_last_exchange_successful ||
+        previous.last_received.index() != peer->last_received.index();
+    if (mode_copy == LEADER && (peer_progressed || queue_state_.watermarks_stale)) {
+      queue_state_.watermarks_stale = false;
+
       // Advance the majority replicated index.
       AdvanceQueueWatermark("majority_replicated",
                             &queue_state_.majority_replicated_index,
                             previous.last_received,
                             peer->last_received,
                             queue_state_.majority_size_,
+                            VOTER_REPLICAS,
                             peer);
 
       // Advance the all replicated index.
@@ -710,8 +880,11 @@ void PeerMessageQueue::ResponseFromPeer(const std::string& peer_uuid,
                             previous.last_received,
                             peer->last_received,
                             peers_map_.size(),
+                            ALL_REPLICAS,
                             peer);
+    }
 
+    if (mode_copy == LEADER) {
       // If the majority-replicated index is in our current term,
       // and it is above our current committed index, then
       // we can advance the committed index.
@@ -742,16 +915,25 @@ void PeerMessageQueue::ResponseFromPeer(const std::string& peer_uuid,
       }
     }
 
-    // If our log has the next request for the peer or if the peer's committed index is
-    // lower than our own, set 'more_pending' to true.
-    *more_pending = log_cache_.HasOpBeenWritten(peer->next_index) ||
-        (peer->last_known_committed_index < queue_state_.committed_index);
-
-    log_cache_.EvictThroughOp(queue_state_.all_replicated_index);
+    next_index = peer->next_index;
+    peer_committed_index = peer->last_known_committed_index;
+    committed_index = queue_state_.committed_index;
+    all_replicated_index = queue_state_.all_replicated_index;
 
+    UpdateLogCacheRetentionUnlocked();
     UpdateMetrics();
   }
 
+  // If our log has the next request for the peer or if the peer's committed index is
+  // lower than our own, set 'more_pending' to true.
+  *more_pending = log_cache_.HasOpBeenWritten(next_index) ||
+      (peer_committed_index < committed_index);
+
+  // This is done outside of the queue lock: if a racing response already
+  // evicted further, evicting through the older index is a no-op. Evicted ops
+  // are still read from the log if a peer turns out to need them.
+  log_cache_.EvictThroughOp(all_replicated_index);
+
   if (mode_copy == LEADER && updated_commit_index != boost::none) {
     NotifyObserversOfCommitIndexChange(*updated_commit_index);
   }
@@ -791,6 +973,23 @@ void PeerMessageQueue::UpdateMetrics() {
     queue_state_.last_appended.index() - queue_state_.committed_index);
 }
 
+void PeerMessageQueue::UpdateLogCacheRetentionUnlocked() {
+  DCHECK(queue_lock_.is_locked());
+  int64_t retained_index = MathLimits<int64_t>::kMax;
+  const int64_t last_index = queue_state_.last_appended.index();
+  for (const PeersMap::value_type& entry : peers_map_) {
+    const TrackedPeer* peer = entry.second;
+    if (peer->uuid == local_peer_pb_.permanent_uuid()) {
+      continue;
+    }
+    int64_t lag = last_index - peer->last_received.index();
+    if (lag > 0 && lag <= FLAGS_log_cache_retention_peer_lag_ops) {
+      retained_index = std::min(retained_index, peer->last_received.index() + 1);
+    }
+  }
+  log_cache_.SetRetainedOpIndex(retained_index);
+}
+
 void PeerMessageQueue::DumpToStrings(vector<string>* lines) const {
   std::lock_guard<simple_spinlock> lock(queue_lock_);
   DumpToStringsUnlocked(lines);
@@ -829,7 +1028,7 @@ void PeerMessageQueue::ClearUnlocked() {
 }
 
 void PeerMessageQueue::Close() {
-  observers_pool_->Shutdown();
+  observers_token_->Shutdown();
   std::lock_guard<simple_spinlock> lock(queue_lock_);
   ClearUnlocked();
 }
@@ -853,15 +1052,19 @@ string PeerMessageQueue::ToStringUnlocked() const {
 }
 
 void PeerMessageQueue::RegisterObserver(PeerMessageQueueObserver* observer) {
-  std::lock_guard<simple_spinlock> lock(queue_lock_);
+  std::lock_guard<simple_spinlock> lock(observers_lock_);
   auto iter = std::find(observers_.begin(), observers_.end(), observer);
   if (iter == observers_.end()) {
     observers_.push_back(observer);
   }
 }
 
+void PeerMessageQueue::SetReplicaTransactionFactory(ReplicaTransactionFactory* txn_factory) {
+  txn_factory_ = txn_factory;
+}
+
 Status PeerMessageQueue::UnRegisterObserver(PeerMessageQueueObserver* observer) {
-  std::lock_guard<simple_spinlock> lock(queue_lock_);
+  std::lock_guard<simple_spinlock> lock(observers_lock_);
   auto iter = std::find(observers_.begin(), observers_.end(), observer);
   if (iter == observers_.end()) {
     return Status::NotFound("Can't find observer.");
@@ -884,7 +1087,7 @@ bool PeerMessageQueue::IsOpInLog(const OpId& desired_op) const {
 }
 
 void PeerMessageQueue::NotifyObserversOfCommitIndexChange(int64_t new_commit_index) {
-  WARN_NOT_OK(observers_pool_->SubmitClosure(
+  WARN_NOT_OK(observers_token_->SubmitClosure(
       Bind(&PeerMessageQueue::NotifyObserversOfCommitIndexChangeTask,
            Unretained(this), new_commit_index)),
               LogPrefixUnlocked() + "Unable to notify RaftConsensus of "
@@ -892,7 +1095,7 @@ void PeerMessageQueue::NotifyObserversOfCommitIndexChange(int64_t new_commit_ind
 }
 
 void PeerMessageQueue::NotifyObserversOfTermChange(int64_t term) {
-  WARN_NOT_OK(observers_pool_->SubmitClosure(
+  WARN_NOT_OK(observers_token_->SubmitClosure(
       Bind(&PeerMessageQueue::NotifyObserversOfTermChangeTask,
            Unretained(this), term)),
               LogPrefixUnlocked() + "Unable to notify RaftConsensus of term change.");
@@ -901,7 +1104,7 @@ void PeerMessageQueue::NotifyObserversOfTermChange(int64_t term) {
 void PeerMessageQueue::NotifyObserversOfCommitIndexChangeTask(int64_t new_commit_index) {
   std::vector<PeerMessageQueueObserver*> copy;
   {
-    std::lock_guard<simple_spinlock> lock(queue_lock_);
+    std::lock_guard<simple_spinlock> lock(observers_lock_);
     copy = observers_;
   }
   for (PeerMessageQueueObserver* observer : copy) {
@@ -913,7 +1116,7 @@ void PeerMessageQueue::NotifyObserversOfTermChangeTask(int64_t term) {
   MAYBE_INJECT_RANDOM_LATENCY(FLAGS_consensus_inject_latency_ms_in_notifications);
   std::vector<PeerMessageQueueObserver*> copy;
   {
-    std::lock_guard<simple_spinlock> lock(queue_lock_);
+    std::lock_guard<simple_spinlock> lock(observers_lock_);
     copy = observers_;
   }
   for (PeerMessageQueueObserver* observer : copy) {
@@ -924,7 +1127,7 @@ void PeerMessageQueue::NotifyObserversOfTermChangeTask(int64_t term) {
 void PeerMessageQueue::NotifyObserversOfFailedFollower(const string& uuid,
                                                        int64_t term,
                                                        const string& reason) {
-  WARN_NOT_OK(observers_pool_->SubmitClosure(
+  WARN_NOT_OK(observers_token_->SubmitClosure(
       Bind(&PeerMessageQueue::NotifyObserversOfFailedFollowerTask,
            Unretained(this), uuid, term, reason)),
               LogPrefixUnlocked() + "Unable to notify RaftConsensus of abandoned follower.");
@@ -936,7 +1139,7 @@ void PeerMessageQueue::NotifyObserversOfFailedFollowerTask(const string& uuid,
   MAYBE_INJECT_RANDOM_LATENCY(FLAGS_consensus_inject_latency_ms_in_notifications);
   std::vector<PeerMessageQueueObserver*> observers_copy;
   {
-    std::lock_guard<simple_spinlock> lock(queue_lock_);
+    std::lock_guard<simple_spinlock> lock(observers_lock_);
     observers_copy = observers_;
   }
   for (PeerMessageQueueObserver* observer : observers_copy) {
@@ -21,6 +21,7 @@
 #include <boost/optional.hpp>
 #include <iosfwd>
 #include <map>
+#include <memory>
 #include <string>
 #include <unordered_map>
 #include <utility>
@@ -42,6 +43,7 @@ class AtomicGauge;
 class MemTracker;
 class MetricEntity;
 class ThreadPool;
+class ThreadPoolToken;
 
 namespace log {
 class Log;
@@ -49,6 +51,7 @@ class Log;
 
 namespace consensus {
 class PeerMessageQueueObserver;
+class ReplicaTransactionFactory;
 
 // The id for the server-wide consensus queue MemTracker.
 extern const char kConsensusQueueParentTrackerId[];
@@ -62,9 +65,11 @@ extern const char kConsensusQueueParentTrackerId[];
 //
 // This class is used only on the LEADER side.
 //
-// TODO Right now this class is able to track one outstanding operation
-// per peer. If we want to have more than one outstanding RPC we need to
-// modify it.
+// Peers may have several requests outstanding (see
+// --consensus_max_inflight_requests_per_peer). While a peer is in sync,
+// each request picks up after the previous one, and responses which arrive
+// out of order never move the peer's progress backwards. An LMP mismatch
+// sends replication back to the point the peer reports.
 class PeerMessageQueue {
  public:
   struct TrackedPeer {
@@ -77,6 +82,8 @@ class PeerMessageQueue {
           is_last_exchange_successful(false),
           last_successful_communication_time(MonoTime::Now()),
           needs_tablet_copy(false),
+          lease_grant_time(MonoTime::Min()),
+          is_voter(false),
           last_seen_term_(0) {}
 
     // Check that the terms seen from a given peer only increase
@@ -116,6 +123,15 @@ class PeerMessageQueue {
     // Whether the follower was detected to need tablet copy.
     bool needs_tablet_copy;
 
+    // The time at which this leader sent the latest request the peer accepted.
+    // Having accepted it, the peer withholds its vote from other candidates
+    // for the minimum election timeout, counted from when it received it.
+    MonoTime lease_grant_time;
+
+    // Whether the peer is a voter in the active config. Only meaningful in
+    // LEADER mode.
+    bool is_voter;
+
     // Throttler for how often we will log status messages pertaining to this
     // peer (eg when it is lagging, etc).
     logging::LogThrottler status_log_throttler;
@@ -130,7 +146,8 @@ class PeerMessageQueue {
   PeerMessageQueue(const scoped_refptr<MetricEntity>& metric_entity,
                    const scoped_refptr<log::Log>& log,
                    const RaftPeerPB& local_peer_pb,
-                   const std::string& tablet_id);
+                   const std::string& tablet_id,
+                   ThreadPool* observers_pool = nullptr);
 
   // Initialize the queue.
   virtual void Init(const OpId& last_locally_replicated);
@@ -217,6 +234,22 @@ class PeerMessageQueue {
   // may not be fully up and running or able to accept updates.
   void NotifyPeerIsResponsiveDespiteError(const std::string& peer_uuid);
 
+  // Records that the peer accepted a request which this leader sent at
+  // 'send_time'.
+  void NotifyPeerAcceptedRequest(const std::string& peer_uuid, MonoTime send_time);
+
+  // Returns the latest time T such that a majority of the voters, counting
+  // this leader, accepted requests which it sent at or after T. Returns
+  // MonoTime::Min() if there is no such time, if the queue is not in
+  // leader mode, or if no operation from the current term is committed yet,
+  // as the leader may then not know of all committed operations.
+  MonoTime GetLeaderLeaseStartTime() const;
+
+  // Returns the uuid of the voter, other than the local peer, which has
+  // received the latest operation from this leader, or an empty string if
+  // the queue is not in leader mode or knows of no such voter.
+  std::string GetMostUpToDateVoter() const;
+
   // Updates the request queue with the latest response of a peer, returns
   // whether this peer has more requests pending.
   virtual void ResponseFromPeer(const std::string& peer_uuid,
@@ -259,6 +292,10 @@ class PeerMessageQueue {
 
   virtual void RegisterObserver(PeerMessageQueueObserver* observer);
 
+  // Sets the source of the safe time sent along with each request to a peer.
+  // 'txn_factory' must outlive the queue. If unset, no safe time is sent.
+  void SetReplicaTransactionFactory(ReplicaTransactionFactory* txn_factory);
+
   virtual Status UnRegisterObserver(PeerMessageQueueObserver* observer);
 
   struct Metrics {
@@ -324,6 +361,11 @@ class PeerMessageQueue {
     // The size of the majority for the queue.
     int majority_size_;
 
+    // Whether the watermarks must be recomputed on the next response even if
+    // the responding peer made no progress, because the set of peers or their
+    // voting status changed since they were last computed.
+    bool watermarks_stale;
+
     State state;
 
     // The current mode of the queue.
@@ -365,6 +407,12 @@ class PeerMessageQueue {
   // Updates the metrics based on index math.
   void UpdateMetrics();
 
+  // Tells the log cache to retain the operations still needed by peers which
+  // lag behind the last appended operation by no more than
+  // --log_cache_retention_peer_lag_ops, so that they keep being served from
+  // memory rather than disk.
+  void UpdateLogCacheRetentionUnlocked();
+
   void ClearUnlocked();
 
   // Returns the last operation in the message queue, or
@@ -373,6 +421,9 @@ class PeerMessageQueue {
 
   void TrackPeerUnlocked(const std::string& uuid);
 
+  // Caches in each tracked peer whether it is a voter in the active config.
+  void UpdatePeerVoterStatusUnlocked();
+
   // Checks that if the queue is in LEADER mode then all registered peers are
   // in the active config. Crashes with a FATAL log message if this invariant
   // does not hold. If the queue is in NON_LEADER mode, does nothing.
@@ -383,23 +434,40 @@ class PeerMessageQueue {
                                const StatusCallback& callback,
                                const Status& status);
 
-  // Advances 'watermark' to the smallest op that 'num_peers_required' have.
+  // The peers whose progress is considered when advancing a watermark.
+  enum ReplicaTypes {
+    ALL_REPLICAS,
+    VOTER_REPLICAS
+  };
+
+  // Advances 'watermark' to the smallest op that 'num_peers_required' of the
+  // peers of type 'replica_types' have.
   void AdvanceQueueWatermark(const char* type,
                              int64_t* watermark,
                              const OpId& replicated_before,
                              const OpId& replicated_after,
                              int num_peers_required,
+                             ReplicaTypes replica_types,
                              const TrackedPeer* who_caused);
 
+  // Protected by 'observers_lock_' rather than 'queue_lock_', so that
+  // notifying the observers doesn't contend with the peers' responses.
   std::vector<PeerMessageQueueObserver*> observers_;
+  mutable simple_spinlock observers_lock_;
 
-  // The pool which executes observer notifications.
-  // TODO consider reusing a another pool.
+  // The pool which executes observer notifications, unless one shared with
+  // other queues was provided at construction.
   gscoped_ptr<ThreadPool> observers_pool_;
 
+  // The serial token through which observer notifications are submitted, so
+  // that they run in order.
+  std::unique_ptr<ThreadPoolToken> observers_token_;
+
   // PB containing identifying information about the local peer.
   const RaftPeerPB local_peer_pb_;
 
+  ReplicaTransactionFactory* txn_factory_;
+
   // The id of the tablet.
   const std::string tablet_id_;
 
@@ -407,6 +475,9 @@ class PeerMessageQueue {
 
   // The currently tracked peers.
   PeersMap peers_map_;
+
+  // Protects 'queue_state_' and 'peers_map_'. The log cache has its own
+  // lock, so calls to it are made without holding this one where possible.
   mutable simple_spinlock queue_lock_; // TODO: rename
 
   // We assume that we never have multiple threads racing to append to the queue.
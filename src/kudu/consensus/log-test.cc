@@ -26,19 +26,26 @@
 #include "kudu/consensus/log-test-base.h"
 #include "kudu/consensus/log_index.h"
 #include "kudu/consensus/opid_util.h"
+#include "kudu/consensus/shared_log_syncer.h"
 #include "kudu/gutil/stl_util.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/tablet/mvcc.h"
 #include "kudu/util/random.h"
+#include "kudu/util/thread.h"
 
 DEFINE_int32(num_batches, 10000,
              "Number of batches to write to/read from the Log in TestWriteManyBatches");
 
 DECLARE_int32(log_min_segments_to_retain);
 DECLARE_int32(log_max_segments_to_retain);
+DECLARE_int32(log_max_recycled_segments);
 DECLARE_double(log_inject_io_error_on_preallocate_fraction);
 DECLARE_int64(fs_wal_dir_reserved_bytes);
+DECLARE_string(log_compression_codec);
+DECLARE_int32(log_min_compression_size_bytes);
 DECLARE_int64(disk_reserved_bytes_free_for_testing);
+DECLARE_bool(log_shared_sync);
+DECLARE_int32(log_max_coalesced_read_bytes);
 
 namespace kudu {
 namespace log {
@@ -203,6 +210,62 @@ TEST_F(LogTest, TestFsync) {
   ASSERT_OK(log_->Close());
 }
 
+// Tests that a log with shared sync enabled syncs through the shared syncer
+// of its WAL root.
+TEST_F(LogTest, TestSharedSync) {
+  if (!SharedLogSyncer::FilesystemSyncReportsErrors()) {
+    LOG(WARNING) << "Skipping test: shared sync is not supported on this platform";
+    return;
+  }
+  FLAGS_log_shared_sync = true;
+  options_.force_fsync_all = true;
+  ASSERT_OK(BuildLog());
+  SharedLogSyncer* syncer = SharedLogSyncer::GetOrCreate(env_.get(), fs_manager_->GetWalsRootDir());
+  uint64_t syncs_before = syncer->num_group_syncs();
+
+  OpId opid;
+  opid.set_term(0);
+  opid.set_index(1);
+  AppendNoOp(&opid);
+#if defined(__linux__)
+  ASSERT_GT(syncer->num_group_syncs(), syncs_before);
+#endif
+
+  ASSERT_OK(log_->Close());
+}
+
+// Tests that concurrent callers of the shared syncer are all synced, with
+// some of them sharing group syncs.
+TEST_F(LogTest, TestSharedSyncerGroupCommit) {
+  SharedLogSyncer syncer(env_.get(), GetTestDataDirectory());
+  const int kNumThreads = 8;
+  const int kSyncsPerThread = 100;
+  vector<Status> statuses(kNumThreads);
+  vector<scoped_refptr<Thread>> threads;
+  for (int i = 0; i < kNumThreads; i++) {
+    scoped_refptr<Thread> t;
+    ASSERT_OK(Thread::Create("test", "syncer", [&syncer, &statuses, i]() {
+      for (int j = 0; j < kSyncsPerThread; j++) {
+        Status s = syncer.Sync();
+        if (!s.ok()) {
+          statuses[i] = s;
+          return;
+        }
+      }
+    }, &t));
+    threads.push_back(t);
+  }
+  for (const auto& t : threads) {
+    t->Join();
+  }
+  for (const Status& s : statuses) {
+    if (s.IsNotSupported()) return;
+    ASSERT_OK(s);
+  }
+  ASSERT_GT(syncer.num_group_syncs(), 0);
+  ASSERT_LE(syncer.num_group_syncs(), kNumThreads * kSyncsPerThread);
+}
+
 // Regression test for part of KUDU-735:
 // if a log is not preallocated, we should properly track its on-disk size as we append to
 // it.
@@ -677,6 +740,60 @@ TEST_F(LogTest, TestLogReopenAndGC) {
   ASSERT_OK(log_anchor_registry_->Unregister(anchors[3]));
 }
 
+// GCed segment files are kept for the next segments to reuse, and none of
+// their previous entries show up in the segments which reuse them.
+TEST_F(LogTest, TestGCRecyclesSegments) {
+  FLAGS_log_max_recycled_segments = 1;
+  ASSERT_OK(BuildLog());
+
+  auto count_recycled_files = [&]() {
+    vector<string> files;
+    CHECK_OK(env_->GetChildren(JoinPathSegments(fs_manager_->GetWalsRootDir(), kTestTablet),
+                               &files));
+    return std::count_if(files.begin(), files.end(), [](const string& f) {
+      return HasPrefixString(f, ".tmp.recycledsegment-");
+    });
+  };
+
+  vector<LogAnchor*> anchors;
+  ElementDeleter deleter(&anchors);
+  const int kNumOpsPerSegment = 5;
+  OpId op_id = MakeOpId(1, 1);
+  ASSERT_OK(AppendMultiSegmentSequence(4, kNumOpsPerSegment, &op_id, &anchors));
+
+  // GC the first two segments. Only one of their files is kept.
+  ASSERT_OK(log_anchor_registry_->Unregister(anchors[0]));
+  ASSERT_OK(log_anchor_registry_->Unregister(anchors[1]));
+  RetentionIndexes retention;
+  ASSERT_OK(log_anchor_registry_->GetEarliestRegisteredLogIndex(&retention.for_durability));
+  int num_gced_segments;
+  ASSERT_OK(log_->GC(retention, &num_gced_segments));
+  ASSERT_EQ(2, num_gced_segments);
+  ASSERT_EQ(1, count_recycled_files());
+
+  // The next segment reuses it.
+  ASSERT_OK(RollLog());
+  ASSERT_EQ(0, count_recycled_files());
+  ASSERT_OK(AppendNoOps(&op_id, kNumOpsPerSegment));
+  ASSERT_OK(log_->Close());
+  CheckRightNumberOfSegmentFiles(3);
+
+  // Only the entries written since the GC are read back, after reopening.
+  ASSERT_OK(BuildLog());
+  int64_t first_index = retention.for_durability;
+  vector<ReplicateMsg*> repls;
+  ElementDeleter d(&repls);
+  ASSERT_OK(log_->reader()->ReadReplicatesInRange(
+      first_index, op_id.index() - 1, LogReader::kNoSizeLimit, &repls));
+  ASSERT_EQ(op_id.index() - first_index, repls.size());
+  for (int i = 0; i < repls.size(); i++) {
+    ASSERT_EQ(first_index + i, repls[i]->id().index());
+  }
+  SegmentSequence segments;
+  ASSERT_OK(log_->reader()->GetSegmentsSnapshot(&segments));
+  ASSERT_EQ(4, segments.size()) << DumpSegmentsToString(segments);
+}
+
 // Helper to measure the performance of the log.
 TEST_F(LogTest, TestWriteManyBatches) {
   uint64_t num_batches = 10;
@@ -712,6 +829,62 @@ TEST_F(LogTest, TestWriteManyBatches) {
   }
 }
 
+// Entries in segments written with a compression codec read back intact.
+TEST_F(LogTest, TestCompressedSegments) {
+  FLAGS_log_compression_codec = "zstd";
+  const int kNumBatches = 10;
+  ASSERT_OK(BuildLog());
+  AppendReplicateBatchAndCommitEntryPairsToLog(kNumBatches);
+  ASSERT_OK(log_->Close());
+
+  shared_ptr<LogReader> reader;
+  ASSERT_OK(LogReader::Open(fs_manager_.get(), NULL, kTestTablet, NULL, &reader));
+  SegmentSequence segments;
+  ASSERT_OK(reader->GetSegmentsSnapshot(&segments));
+  int num_entries = 0;
+  for (const scoped_refptr<ReadableLogSegment>& segment : segments) {
+    ASSERT_EQ(ZSTD, segment->header().compression_codec());
+    STLDeleteElements(&entries_);
+    ASSERT_OK(segment->ReadEntries(&entries_));
+    num_entries += entries_.size();
+  }
+  ASSERT_EQ(kNumBatches * 2, num_entries);
+}
+
+// Batches which aren't compressed in a compressed segment read back intact,
+// whether or not they're mixed with compressed batches.
+TEST_F(LogTest, TestCompressedSegmentsWithUncompressedBatches) {
+  FLAGS_log_compression_codec = "lz4";
+  ASSERT_OK(BuildLog());
+  OpId op_id = MakeOpId(1, 1);
+  // The size the batches would take up uncompressed.
+  int uncompressed_size = 0;
+  // Too small to be compressed.
+  FLAGS_log_min_compression_size_bytes = std::numeric_limits<int32_t>::max();
+  ASSERT_OK(AppendNoOp(&op_id, &uncompressed_size));
+  // Compressed, but doesn't shrink.
+  FLAGS_log_min_compression_size_bytes = 0;
+  ASSERT_OK(AppendNoOp(&op_id, &uncompressed_size));
+  // Compresses well.
+  const int kNumOps = 1000;
+  ASSERT_OK(AppendNoOpsToLogSync(clock_, log_.get(), &op_id, kNumOps, &uncompressed_size));
+  ASSERT_OK(log_->Close());
+
+  shared_ptr<LogReader> reader;
+  ASSERT_OK(LogReader::Open(fs_manager_.get(), NULL, kTestTablet, NULL, &reader));
+  SegmentSequence segments;
+  ASSERT_OK(reader->GetSegmentsSnapshot(&segments));
+  ASSERT_EQ(1, segments.size());
+  ASSERT_EQ(LZ4, segments[0]->header().compression_codec());
+  ASSERT_OK(segments[0]->ReadEntries(&entries_));
+  ASSERT_EQ(kNumOps + 2, entries_.size());
+  for (int i = 0; i < entries_.size(); i++) {
+    ASSERT_EQ(i + 1, entries_[i]->replicate().id().index());
+  }
+  ASSERT_LT(segments[0]->file_size(),
+            segments[0]->first_entry_offset() + uncompressed_size);
+}
+
 // This tests that querying LogReader works.
 // This sets up a reader with some segments to query which amount to the
 // following:
@@ -972,6 +1145,46 @@ TEST_F(LogTest, TestReadLogWithReplacedReplicates) {
 
 // Test various situations where we expect different segments depending on what the
 // min log index is.
+// Test that reading a range of operations plans one read per segment for
+// nearby batches, and that the coalesced reads return the same operations.
+TEST_F(LogTest, TestReadReplicatesCoalescesReads) {
+  ASSERT_OK(BuildLog());
+  const int kNumOpsPerSegment = 10;
+  OpId op_id = MakeOpId(1, 1);
+  ASSERT_OK(AppendMultiSegmentSequence(2, kNumOpsPerSegment, &op_id, nullptr));
+  const int64_t last_index = op_id.index() - 1;
+
+  shared_ptr<LogReader> reader = log_->reader();
+  vector<LogReadRange> plan;
+  ASSERT_OK(reader->PlanReadsInRange(1, last_index, LogReader::kNoSizeLimit, &plan));
+  ASSERT_EQ(2, plan.size());
+  for (const LogReadRange& range : plan) {
+    EXPECT_EQ(kNumOpsPerSegment, range.entries.size());
+    EXPECT_EQ(kNumOpsPerSegment, range.batch_offsets.size());
+  }
+
+  int64_t read_batch_count = reader->read_batch_latency_->TotalCount();
+  vector<ReplicateMsg*> coalesced;
+  ElementDeleter d1(&coalesced);
+  ASSERT_OK(reader->ReadReplicatesInRange(1, last_index, LogReader::kNoSizeLimit, &coalesced));
+  EXPECT_EQ(read_batch_count + 2, reader->read_batch_latency_->TotalCount());
+
+  // Without coalescing, every batch is read on its own.
+  FLAGS_log_max_coalesced_read_bytes = 1;
+  ASSERT_OK(reader->PlanReadsInRange(1, last_index, LogReader::kNoSizeLimit, &plan));
+  ASSERT_EQ(last_index, plan.size());
+  vector<ReplicateMsg*> separate;
+  ElementDeleter d2(&separate);
+  ASSERT_OK(reader->ReadReplicatesInRange(1, last_index, LogReader::kNoSizeLimit, &separate));
+
+  ASSERT_EQ(last_index, coalesced.size());
+  ASSERT_EQ(coalesced.size(), separate.size());
+  for (int i = 0; i < coalesced.size(); i++) {
+    EXPECT_EQ(i + 1, coalesced[i]->id().index());
+    EXPECT_EQ(coalesced[i]->SerializeAsString(), separate[i]->SerializeAsString());
+  }
+}
+
 TEST_F(LogTest, TestGetMaxIndexesToSegmentSizeMap) {
   FLAGS_log_min_segments_to_retain = 2;
   ASSERT_OK(BuildLog());
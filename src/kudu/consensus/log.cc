@@ -18,6 +18,7 @@
 #include "kudu/consensus/log.h"
 
 #include <algorithm>
+#include <google/protobuf/wire_format_lite.h>
 #include <limits>
 #include <mutex>
 
@@ -26,14 +27,19 @@
 #include "kudu/consensus/log_metrics.h"
 #include "kudu/consensus/log_reader.h"
 #include "kudu/consensus/log_util.h"
+#include "kudu/consensus/shared_log_syncer.h"
 #include "kudu/fs/fs_manager.h"
 #include "kudu/gutil/map-util.h"
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/gutil/stl_util.h"
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/gutil/strings/util.h"
 #include "kudu/gutil/walltime.h"
+#include "kudu/rpc/call_breakdown.h"
 #include "kudu/util/coding.h"
 #include "kudu/util/countdown_latch.h"
+#include "kudu/util/debug/binary_trace.h"
+#include "kudu/util/crc.h"
 #include "kudu/util/debug/trace_event.h"
 #include "kudu/util/env_util.h"
 #include "kudu/util/fault_injection.h"
@@ -73,6 +79,44 @@ DEFINE_int32(group_commit_queue_size_bytes, 4 * 1024 * 1024,
              "Maximum size of the group commit queue in bytes");
 TAG_FLAG(group_commit_queue_size_bytes, advanced);
 
+DEFINE_bool(log_adaptive_group_commit, false,
+            "Whether a log which fsyncs its appends should briefly wait for "
+            "more entry batches before syncing a group, when the recently "
+            "observed arrival rate of batches and fsync latency indicate that "
+            "coalescing them would save fsyncs.");
+TAG_FLAG(log_adaptive_group_commit, experimental);
+
+DEFINE_int32(log_group_commit_max_delay_us, 1000,
+             "The longest that adaptive group commit may delay syncing a "
+             "group in order to coalesce more entry batches into it, in "
+             "microseconds. See --log_adaptive_group_commit.");
+TAG_FLAG(log_group_commit_max_delay_us, experimental);
+
+DEFINE_int32(log_group_commit_target_batches, 32,
+             "The number of entry batches at which adaptive group commit stops "
+             "waiting for more to arrive. See --log_adaptive_group_commit.");
+TAG_FLAG(log_group_commit_target_batches, experimental);
+
+DEFINE_bool(log_shared_sync, false,
+            "Whether the logs of all tablets should group-commit their fsyncs "
+            "together, with one sync of the whole WAL filesystem on behalf of "
+            "every log waiting for one, rather than each log fsyncing its own "
+            "segment. Reduces the number of fsyncs on servers with many "
+            "lightly loaded tablets, at the cost of also syncing any other "
+            "data written to the same filesystem. Only supported on Linux 5.8 "
+            "or later, since syncfs() on earlier kernels doesn't report "
+            "writeback errors; elsewhere each log fsyncs its own segment.");
+TAG_FLAG(log_shared_sync, experimental);
+
+DEFINE_int32(log_max_recycled_segments, 1,
+             "The maximum number of GCed segment files each log keeps around "
+             "to reuse for its next segments, rather than deleting them and "
+             "allocating fresh files. Reusing a file whose blocks are already "
+             "allocated and written avoids the filesystem metadata updates that "
+             "make the first writes to a fresh segment slow. 0 disables reuse.");
+TAG_FLAG(log_max_recycled_segments, advanced);
+TAG_FLAG(log_max_recycled_segments, runtime);
+
 // Fault/latency injection flags.
 // -----------------------------
 DEFINE_bool(log_inject_latency, false,
@@ -105,6 +149,12 @@ DEFINE_double(log_inject_io_error_on_preallocate_fraction, 0.0,
 TAG_FLAG(log_inject_io_error_on_preallocate_fraction, unsafe);
 TAG_FLAG(log_inject_io_error_on_preallocate_fraction, runtime);
 
+DEFINE_string(log_compression_codec, "none",
+              "Codec with which to compress the entries of new WAL segments: one of "
+              "'none', 'snappy', 'lz4', 'zlib' or 'zstd'. Segments written with a codec "
+              "can't be read by versions of Kudu without WAL compression.");
+TAG_FLAG(log_compression_codec, experimental);
+
 DEFINE_int64(fs_wal_dir_reserved_bytes, 0,
              "Number of bytes to reserve on the log directory filesystem for non-Kudu usage");
 TAG_FLAG(fs_wal_dir_reserved_bytes, runtime);
@@ -124,6 +174,10 @@ static bool dummy = google::RegisterFlagValidator(
 
 static const char kSegmentPlaceholderFileTemplate[] = ".tmp.newsegmentXXXXXX";
 
+// The prefix of the name of the GCed segment files kept for reuse. Like the
+// placeholder segments, they are ignored by the log reader.
+static const char kRecycledSegmentFilePrefix[] = ".tmp.recycledsegment-";
+
 namespace kudu {
 namespace log {
 
@@ -152,8 +206,27 @@ class Log::AppendThread {
  private:
   void RunThread();
 
+  // If adaptive group commit calls for it, waits a little for more entry
+  // batches to add to the group in 'entry_batches'. Returns false if the
+  // queue was shut down while waiting.
+  bool MaybeWaitForMoreBatches(std::vector<LogEntryBatch*>* entry_batches);
+
+  // Folds the group that was just committed into the observed arrival rate
+  // of entry batches and, if the group was synced, the fsync latency.
+  void UpdateGroupCommitStats(size_t num_batches, const MonoTime& drained,
+                              const MonoDelta* sync_time);
+
   Log* const log_;
 
+  // Exponentially weighted moving averages of the arrival rate of entry
+  // batches, in batches per microsecond, and of the time to sync a group.
+  // Only accessed by the append thread.
+  double batch_arrival_rate_;
+  double sync_time_us_;
+
+  // When the previous group was drained from the queue.
+  MonoTime last_drained_;
+
   // Lock to protect access to thread_ during shutdown.
   mutable std::mutex lock_;
   scoped_refptr<Thread> thread_;
@@ -161,7 +234,10 @@ class Log::AppendThread {
 
 
 Log::AppendThread::AppendThread(Log *log)
-  : log_(log) {
+  : log_(log),
+    batch_arrival_rate_(0),
+    sync_time_us_(0),
+    last_drained_(MonoTime::Now()) {
 }
 
 Status Log::AppendThread::Init() {
@@ -186,6 +262,10 @@ void Log::AppendThread::RunThread() {
     if (PREDICT_FALSE(!log_->entry_queue()->BlockingDrainTo(&entry_batches))) {
       shutting_down = true;
     }
+    if (!shutting_down && PREDICT_FALSE(!MaybeWaitForMoreBatches(&entry_batches))) {
+      shutting_down = true;
+    }
+    MonoTime drained = MonoTime::Now();
 
     if (log_->metrics_) {
       log_->metrics_->entry_batches_per_group->Increment(entry_batches.size());
@@ -217,7 +297,12 @@ void Log::AppendThread::RunThread() {
 
     Status s;
     if (!is_all_commits) {
+      MonoTime sync_start = MonoTime::Now();
       s = log_->Sync();
+      MonoDelta sync_time = MonoTime::Now() - sync_start;
+      UpdateGroupCommitStats(entry_batches.size(), drained, &sync_time);
+    } else {
+      UpdateGroupCommitStats(entry_batches.size(), drained, nullptr);
     }
     if (PREDICT_FALSE(!s.ok())) {
       LOG(ERROR) << "Error syncing log" << s.ToString();
@@ -230,7 +315,13 @@ void Log::AppendThread::RunThread() {
       TRACE_EVENT0("log", "Callbacks");
       VLOG(2) << "Synchronized " << entry_batches.size() << " entry batches";
       SCOPED_WATCH_STACK(100);
+      MonoTime synced = MonoTime::Now();
       for (LogEntryBatch* entry_batch : entry_batches) {
+        if (entry_batch->trace_) {
+          entry_batch->trace_->metrics()->Increment(
+              rpc::kWalSyncWaitTraceCounter,
+              (synced - entry_batch->append_time_).ToMicroseconds());
+        }
         if (PREDICT_TRUE(!entry_batch->failed_to_append()
                          && !entry_batch->callback().is_null())) {
           entry_batch->callback().Run(Status::OK());
@@ -246,6 +337,55 @@ void Log::AppendThread::RunThread() {
   VLOG(1) << "Exiting AppendThread for tablet " << log_->tablet_id();
 }
 
+bool Log::AppendThread::MaybeWaitForMoreBatches(vector<LogEntryBatch*>* entry_batches) {
+  if (!FLAGS_log_adaptive_group_commit ||
+      !log_->force_sync_all_ || log_->sync_disabled_) {
+    return true;
+  }
+  size_t target = FLAGS_log_group_commit_target_batches;
+  if (entry_batches->size() >= target || batch_arrival_rate_ <= 0) {
+    return true;
+  }
+
+  // Waiting for longer than a sync takes doesn't pay off, since the batches
+  // arriving meanwhile could instead go in the next group. Nor does waiting
+  // for less time than it takes for a batch to arrive.
+  double delay_us = std::min<double>({
+      static_cast<double>(FLAGS_log_group_commit_max_delay_us),
+      sync_time_us_,
+      (target - entry_batches->size()) / batch_arrival_rate_ });
+  if (delay_us * batch_arrival_rate_ < 1) {
+    return true;
+  }
+
+  MonoTime start = MonoTime::Now();
+  MonoTime deadline = start + MonoDelta::FromMicroseconds(static_cast<int64_t>(delay_us));
+  bool open = true;
+  while (entry_batches->size() < target && MonoTime::Now() < deadline) {
+    if (!log_->entry_queue()->BlockingDrainTo(entry_batches, deadline)) {
+      open = false;
+      break;
+    }
+  }
+  if (log_->metrics_) {
+    log_->metrics_->group_commit_delay->Increment(
+        (MonoTime::Now() - start).ToMicroseconds());
+  }
+  return open;
+}
+
+void Log::AppendThread::UpdateGroupCommitStats(size_t num_batches, const MonoTime& drained,
+                                               const MonoDelta* sync_time) {
+  const double kWeight = 0.2;
+  double interval_us = std::max<double>((drained - last_drained_).ToMicroseconds(), 1);
+  last_drained_ = drained;
+  batch_arrival_rate_ = kWeight * (num_batches / interval_us) +
+      (1 - kWeight) * batch_arrival_rate_;
+  if (sync_time) {
+    sync_time_us_ = kWeight * sync_time->ToMicroseconds() + (1 - kWeight) * sync_time_us_;
+  }
+}
+
 void Log::AppendThread::Shutdown() {
   log_->entry_queue()->Shutdown();
   std::lock_guard<std::mutex> lock_guard(lock_);
@@ -301,12 +441,14 @@ Log::Log(LogOptions options, FsManager* fs_manager, string log_path,
       schema_(schema),
       schema_version_(schema_version),
       active_segment_sequence_number_(0),
+      recycled_segments_reserved_(0),
       log_state_(kLogInitialized),
       max_segment_size_(options_.segment_size_mb * 1024 * 1024),
       entry_batch_queue_(FLAGS_group_commit_queue_size_bytes),
       append_thread_(new AppendThread(this)),
       force_sync_all_(options_.force_fsync_all),
       sync_disabled_(false),
+      shared_syncer_(nullptr),
       allocation_state_(kAllocationNotStarted),
       metric_entity_(metric_entity) {
   CHECK_OK(ThreadPoolBuilder("log-alloc").set_max_threads(1).Build(&allocation_pool_));
@@ -346,6 +488,18 @@ Status Log::Init() {
   } else {
     KLOG_FIRST_N(INFO, 1) << "Log is configured to *not* fsync() on all Append() calls";
   }
+  if (force_sync_all_ && FLAGS_log_shared_sync) {
+    if (SharedLogSyncer::FilesystemSyncReportsErrors()) {
+      shared_syncer_ = SharedLogSyncer::GetOrCreate(fs_manager_->env(),
+                                                    fs_manager_->GetWalsRootDir());
+    } else {
+      KLOG_FIRST_N(WARNING, 1) << "--log_shared_sync is not supported on this platform, "
+                               << "since syncing a whole filesystem may not report "
+                               << "writeback errors; syncing each log separately";
+    }
+  }
+
+  RETURN_NOT_OK(LoadRecycledSegments());
 
   // We always create a new segment when the log starts.
   RETURN_NOT_OK(AsyncAllocateSegment());
@@ -443,6 +597,10 @@ Status Log::AsyncAppend(LogEntryBatch* entry_batch, const StatusCallback& callba
 
   RETURN_NOT_OK(entry_batch->Serialize());
   entry_batch->set_callback(callback);
+  entry_batch->trace_ = Trace::CurrentTrace();
+  if (entry_batch->trace_) {
+    entry_batch->append_time_ = MonoTime::Now();
+  }
   TRACE("Serialized $0 byte log entry", entry_batch->total_size_bytes());
   TRACE_EVENT_FLOW_BEGIN0("log", "Batch", entry_batch);
   entry_batch->MarkReady();
@@ -531,9 +689,12 @@ Status Log::DoAppend(LogEntryBatch* entry_batch) {
 
   LOG_SLOW_EXECUTION(WARNING, 50, "Append to log took a long time") {
     SCOPED_LATENCY_METRIC(metrics_, append_latency);
+    BINARY_TRACE_SCOPE_ARG(debug::kBinaryTraceWal, "wal_append", entry_batch_bytes);
     SCOPED_WATCH_STACK(500);
 
-    RETURN_NOT_OK(active_segment_->WriteEntryBatch(entry_batch_data));
+    MonoTime write_start = MonoTime::Now();
+    RETURN_NOT_OK(active_segment_->WriteEntryBatch(entry_batch_data, entry_batch->data_crc()));
+    RecordDiskLatency(fs::DiskHiccupMonitor::kWrite, MonoTime::Now() - write_start);
 
     // Update the reader on how far it can read the active segment.
     reader_->UpdateLastSegmentOffset(active_segment_->written_offset());
@@ -545,6 +706,7 @@ Status Log::DoAppend(LogEntryBatch* entry_batch) {
 
   if (metrics_) {
     metrics_->bytes_logged->IncrementBy(entry_batch_bytes);
+    metrics_->bytes_written->IncrementBy(active_segment_->written_offset() - start_offset);
   }
 
   CHECK_OK(UpdateIndexForBatch(*entry_batch, start_offset));
@@ -595,8 +757,16 @@ FsManager* Log::GetFsManager() {
   return fs_manager_;
 }
 
+void Log::RecordDiskLatency(fs::DiskHiccupMonitor::OpType type, const MonoDelta& latency) {
+  fs::DiskHiccupMonitor* monitor = fs_manager_->disk_hiccup_monitor();
+  if (monitor) {
+    monitor->RecordLatency(monitor->wal_device(), type, latency);
+  }
+}
+
 Status Log::Sync() {
   TRACE_EVENT0("log", "Sync");
+  BINARY_TRACE_SCOPE(debug::kBinaryTraceWal, "wal_sync");
   SCOPED_LATENCY_METRIC(metrics_, sync_latency);
 
   if (PREDICT_FALSE(FLAGS_log_inject_latency && !sync_disabled_)) {
@@ -612,7 +782,22 @@ Status Log::Sync() {
 
   if (force_sync_all_ && !sync_disabled_) {
     LOG_SLOW_EXECUTION(WARNING, 50, "Fsync log took a long time") {
-      RETURN_NOT_OK(active_segment_->Sync());
+      MonoTime sync_start = MonoTime::Now();
+      bool synced = false;
+      if (shared_syncer_) {
+        Status s = shared_syncer_->Sync();
+        if (PREDICT_FALSE(s.IsNotSupported())) {
+          KLOG_FIRST_N(WARNING, 1) << "Shared log sync unavailable, syncing logs "
+                                   << "individually: " << s.ToString();
+        } else {
+          RETURN_NOT_OK(s);
+          synced = true;
+        }
+      }
+      if (!synced) {
+        RETURN_NOT_OK(active_segment_->Sync());
+      }
+      RecordDiskLatency(fs::DiskHiccupMonitor::kSync, MonoTime::Now() - sync_start);
 
       if (log_hooks_) {
         RETURN_NOT_OK_PREPEND(log_hooks_->PostSyncIfFsyncEnabled(),
@@ -738,7 +923,7 @@ Status Log::GC(RetentionIndexes retention_indexes, int32_t* num_gced) {
                              segment->footer().max_replicate_index());
       }
       LOG(INFO) << "Deleting log segment in path: " << segment->path() << ops_str;
-      RETURN_NOT_OK(fs_manager_->env()->DeleteFile(segment->path()));
+      RETURN_NOT_OK(RecycleOrDeleteSegment(segment));
       (*num_gced)++;
     }
 
@@ -856,6 +1041,27 @@ Status Log::PreAllocateNewSegment() {
 
   WritableFileOptions opts;
   opts.sync_on_close = force_sync_all_;
+
+  string recycled_path;
+  {
+    std::lock_guard<simple_spinlock> l(recycled_segments_lock_);
+    if (!recycled_segment_paths_.empty()) {
+      recycled_path = recycled_segment_paths_.back();
+      recycled_segment_paths_.pop_back();
+    }
+  }
+  if (!recycled_path.empty()) {
+    Status s = ReuseRecycledSegment(opts, recycled_path);
+    if (s.ok()) {
+      return Status::OK();
+    }
+    // Fall back to a fresh file.
+    LOG(WARNING) << "Unable to reuse recycled log segment " << recycled_path << ": "
+                 << s.ToString();
+    WARN_NOT_OK(fs_manager_->env()->DeleteFile(recycled_path),
+                "Unable to delete recycled log segment");
+  }
+
   RETURN_NOT_OK(CreatePlaceholderSegment(opts, &next_segment_path_, &next_segment_file_));
 
   MAYBE_RETURN_FAILURE(FLAGS_log_inject_io_error_on_preallocate_fraction,
@@ -875,6 +1081,116 @@ Status Log::PreAllocateNewSegment() {
   return Status::OK();
 }
 
+Status Log::ReuseRecycledSegment(const WritableFileOptions& opts,
+                                 const string& recycled_path) {
+  TRACE_EVENT1("log", "ReuseRecycledSegment", "file", recycled_path);
+  Env* env = fs_manager_->env();
+
+  // Overwrite the previous contents with zeros, which is what a preallocated
+  // fresh file reads as, so that the reader can't mistake the entries left
+  // past the end of the new segment for its own. The zeros must be durable
+  // before the segment is written to, or they might not survive a crash while
+  // the new entries do.
+  uint64_t size;
+  {
+    RWFileOptions rw_opts;
+    rw_opts.mode = Env::OPEN_EXISTING;
+    gscoped_ptr<RWFile> file;
+    RETURN_NOT_OK(env->NewRWFile(rw_opts, recycled_path, &file));
+    RETURN_NOT_OK(file->Size(&size));
+    TRACE("Zeroing $0 byte recycled segment $1", size, recycled_path);
+    static const uint64_t kZeroChunkSize = 1024 * 1024;
+    faststring zeros;
+    zeros.resize(std::min(size, kZeroChunkSize));
+    memset(zeros.data(), 0, zeros.size());
+    for (uint64_t offset = 0; offset < size; offset += zeros.size()) {
+      RETURN_NOT_OK(file->Write(offset, Slice(zeros.data(),
+                                              std::min<uint64_t>(zeros.size(), size - offset))));
+    }
+    RETURN_NOT_OK(file->Sync());
+    RETURN_NOT_OK(file->Close());
+  }
+
+  WritableFileOptions reuse_opts = opts;
+  reuse_opts.mode = Env::OPEN_EXISTING_REUSE;
+  gscoped_ptr<WritableFile> segment_file;
+  RETURN_NOT_OK(env->NewWritableFile(reuse_opts, recycled_path, &segment_file));
+
+  if (options_.preallocate_segments && size < max_segment_size_) {
+    RETURN_NOT_OK(env_util::VerifySufficientDiskSpace(env,
+                                                      recycled_path,
+                                                      max_segment_size_ - size,
+                                                      FLAGS_fs_wal_dir_reserved_bytes));
+    RETURN_NOT_OK(segment_file->PreAllocate(max_segment_size_ - size));
+  }
+
+  VLOG(1) << "Reusing recycled WAL segment " << recycled_path << " for the next segment";
+  next_segment_path_ = recycled_path;
+  next_segment_file_.reset(segment_file.release());
+  return Status::OK();
+}
+
+Status Log::RecycleOrDeleteSegment(const scoped_refptr<ReadableLogSegment>& segment) {
+  Env* env = fs_manager_->env();
+  // The segment may only be reused if no reader still has it open: one
+  // would otherwise read the entries of the next segment in its place.
+  if (segment->HasOneRef()) {
+    // Reserve a slot in the pool, so that the rename happens without holding
+    // the lock.
+    bool reserved = false;
+    {
+      std::lock_guard<simple_spinlock> l(recycled_segments_lock_);
+      if (static_cast<int>(recycled_segment_paths_.size()) + recycled_segments_reserved_ <
+          FLAGS_log_max_recycled_segments) {
+        recycled_segments_reserved_++;
+        reserved = true;
+      }
+    }
+    if (reserved) {
+      string recycled_path = JoinPathSegments(
+          log_dir_, Substitute("$0$1", kRecycledSegmentFilePrefix,
+                               segment->header().sequence_number()));
+      Status s = env->RenameFile(segment->path(), recycled_path);
+      std::lock_guard<simple_spinlock> l(recycled_segments_lock_);
+      recycled_segments_reserved_--;
+      if (s.ok()) {
+        VLOG(1) << "Keeping log segment " << segment->path() << " for reuse as "
+                << recycled_path;
+        recycled_segment_paths_.push_back(recycled_path);
+        return Status::OK();
+      }
+      LOG(WARNING) << "Unable to recycle log segment " << segment->path() << ": "
+                   << s.ToString();
+    }
+  }
+  return env->DeleteFile(segment->path());
+}
+
+Status Log::LoadRecycledSegments() {
+  Env* env = fs_manager_->env();
+  vector<string> children;
+  RETURN_NOT_OK(env->GetChildren(log_dir_, &children));
+  vector<string> excess_paths;
+  {
+    std::lock_guard<simple_spinlock> l(recycled_segments_lock_);
+    for (const string& child : children) {
+      if (!HasPrefixString(child, kRecycledSegmentFilePrefix)) {
+        continue;
+      }
+      string path = JoinPathSegments(log_dir_, child);
+      if (static_cast<int>(recycled_segment_paths_.size()) < FLAGS_log_max_recycled_segments) {
+        recycled_segment_paths_.push_back(path);
+      } else {
+        excess_paths.push_back(path);
+      }
+    }
+  }
+  for (const string& path : excess_paths) {
+    RETURN_NOT_OK(env->DeleteFile(path));
+  }
+  return Status::OK();
+}
+
 Status Log::SwitchToAllocatedSegment() {
   CHECK_EQ(allocation_state(), kAllocationFinished);
 
@@ -899,6 +1215,10 @@ Status Log::SwitchToAllocatedSegment() {
   header.set_minor_version(kLogMinorVersion);
   header.set_sequence_number(active_segment_sequence_number_);
   header.set_tablet_id(tablet_id_);
+  CompressionType codec = cfile::GetCompressionCodecType(FLAGS_log_compression_codec);
+  if (codec != NO_COMPRESSION) {
+    header.set_compression_codec(codec);
+  }
 
   // Set up the new footer. This will be maintained as the segment is written.
   footer_builder_.Clear();
@@ -986,6 +1306,7 @@ LogEntryBatch::LogEntryBatch(LogEntryTypePB type,
           PREDICT_FALSE(count == 1 && entry_batch_pb_->entry(0).type() == FLUSH_MARKER) ?
           0 : entry_batch_pb_->ByteSize()),
       count_(count),
+      crc_(0),
       state_(kEntryInitialized) {
 }
 
@@ -1015,15 +1336,64 @@ Status LogEntryBatch::Serialize() {
   }
   buffer_.reserve(total_size_bytes_);
 
+  if (type_ == REPLICATE && replicates_.size() == count_) {
+    RETURN_NOT_OK(SerializeReplicates());
+    state_ = kEntrySerialized;
+    return Status::OK();
+  }
+
   if (!pb_util::AppendToString(*entry_batch_pb_, &buffer_)) {
     return Status::IOError(Substitute("unable to serialize the entry batch, contents: $1",
                                       entry_batch_pb_->DebugString()));
   }
+  // Checksum the batch while it's still in cache, rather than on the append thread.
+  crc_ = crc::Crc32c(buffer_.data(), buffer_.size());
 
   state_ = kEntrySerialized;
   return Status::OK();
 }
 
+Status LogEntryBatch::SerializeReplicates() {
+  using google::protobuf::internal::WireFormatLite;
+  const uint8_t kEntryTag = WireFormatLite::MakeTag(LogEntryBatchPB::kEntryFieldNumber,
+                                                    WireFormatLite::WIRETYPE_LENGTH_DELIMITED);
+  const uint8_t kTypeTag = WireFormatLite::MakeTag(LogEntryPB::kTypeFieldNumber,
+                                                   WireFormatLite::WIRETYPE_VARINT);
+  const uint8_t kReplicateTag = WireFormatLite::MakeTag(LogEntryPB::kReplicateFieldNumber,
+                                                        WireFormatLite::WIRETYPE_LENGTH_DELIMITED);
+
+  // This produces the same bytes as serializing 'entry_batch_pb_', whose
+  // entries only have a type and a replicate, in that order. The messages are
+  // checksummed as they are copied in.
+  uint32_t crc = 0;
+  for (int i = 0; i < entry_batch_pb_->entry_size(); i++) {
+    const LogEntryPB& entry = entry_batch_pb_->entry(i);
+    DCHECK_EQ(&entry.replicate(), replicates_[i]->get());
+    DCHECK(!entry.has_commit());
+    Slice replicate;
+    RETURN_NOT_OK(replicates_[i]->GetSerialized(&replicate));
+
+    uint32_t entry_size = sizeof(kTypeTag) + VarintLength(entry.type()) +
+        sizeof(kReplicateTag) + VarintLength(replicate.size()) + replicate.size();
+    size_t entry_start = buffer_.size();
+    buffer_.push_back(kEntryTag);
+    PutVarint32(&buffer_, entry_size);
+    buffer_.push_back(kTypeTag);
+    PutVarint32(&buffer_, entry.type());
+    buffer_.push_back(kReplicateTag);
+    PutVarint32(&buffer_, replicate.size());
+    crc = crc::Crc32cExtend(crc, buffer_.data() + entry_start, buffer_.size() - entry_start);
+
+    size_t replicate_start = buffer_.size();
+    buffer_.resize(replicate_start + replicate.size());
+    crc = crc::Crc32cCopy(crc, buffer_.data() + replicate_start, replicate.data(),
+                          replicate.size());
+  }
+  DCHECK_EQ(buffer_.size(), total_size_bytes_);
+  crc_ = crc;
+  return Status::OK();
+}
+
 void LogEntryBatch::MarkReady() {
   DCHECK_EQ(state_, kEntrySerialized);
   state_ = kEntryReady;
@@ -28,11 +28,13 @@
 #include "kudu/consensus/log_util.h"
 #include "kudu/consensus/opid_util.h"
 #include "kudu/consensus/ref_counted_replicate.h"
+#include "kudu/fs/disk_hiccup_monitor.h"
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/gutil/spinlock.h"
 #include "kudu/util/async_util.h"
 #include "kudu/util/blocking_queue.h"
 #include "kudu/util/locks.h"
+#include "kudu/util/monotime.h"
 #include "kudu/util/rw_mutex.h"
 #include "kudu/util/promise.h"
 #include "kudu/util/status.h"
@@ -42,6 +44,7 @@ namespace kudu {
 class FsManager;
 class MetricEntity;
 class ThreadPool;
+class Trace;
 
 namespace log {
 
@@ -51,6 +54,7 @@ struct RetentionIndexes;
 class LogEntryBatch;
 class LogIndex;
 class LogReader;
+class SharedLogSyncer;
 
 typedef BlockingQueue<LogEntryBatch*, LogEntryBatchLogicalSize> LogEntryBatchQueue;
 
@@ -187,6 +191,12 @@ class Log : public RefCountedThreadSafe<Log> {
   // If no entry has ever been written to the log, returns (0, 0)
   void GetLatestEntryOpId(consensus::OpId* op_id) const;
 
+  // Returns how full the queue of entries waiting to be appended is, from 0
+  // (empty) to 1 (appends block until there's room).
+  double GetAppendQueueFillRatio() const {
+    return static_cast<double>(entry_batch_queue_.size()) / entry_batch_queue_.max_size();
+  }
+
   // Runs the garbage collector on the set of previous segments. Segments that
   // only refer to in-mem state that has been flushed are candidates for
   // garbage collection.
@@ -280,6 +290,21 @@ class Log : public RefCountedThreadSafe<Log> {
   // Preallocates the space for a new segment.
   Status PreAllocateNewSegment();
 
+  // Sets up 'recycled_path', a segment file given up by GC, as the next
+  // segment, once it's been zeroed so that none of its previous entries can
+  // be mistaken for entries of the new segment.
+  Status ReuseRecycledSegment(const WritableFileOptions& opts,
+                              const std::string& recycled_path);
+
+  // Keeps the file of the GCed 'segment' around for a later segment to reuse,
+  // if there's room in the pool of recycled segments. Otherwise, or if the
+  // file is still in use, deletes it.
+  Status RecycleOrDeleteSegment(const scoped_refptr<ReadableLogSegment>& segment);
+
+  // Adopts the recycled segment files left in the log directory by a previous
+  // instance of the log.
+  Status LoadRecycledSegments();
+
   // Writes serialized contents of 'entry' to the log. Called inside
   // AppenderThread. If 'caller_owns_operation' is true, then the
   // 'operation' field of the entry will be released after the entry
@@ -301,6 +326,10 @@ class Log : public RefCountedThreadSafe<Log> {
 
   Status Sync();
 
+  // Reports the latency of a write or fsync of the WAL to the disk hiccup
+  // monitor.
+  void RecordDiskLatency(fs::DiskHiccupMonitor::OpType type, const MonoDelta& latency);
+
   // Helper method to get the segment sequence to GC based on the provided 'retention' struct.
   Status GetSegmentsToGCUnlocked(RetentionIndexes retention_indexes,
                                  SegmentSequence* segments_to_gc) const;
@@ -341,6 +370,14 @@ class Log : public RefCountedThreadSafe<Log> {
   // The path for the next allocated segment.
   std::string next_segment_path_;
 
+  // The files of GCed segments, which new segments reuse by renaming them
+  // rather than allocating fresh files (see --log_max_recycled_segments).
+  simple_spinlock recycled_segments_lock_;
+  std::vector<std::string> recycled_segment_paths_;
+  // The number of segments being renamed for reuse. They count against
+  // --log_max_recycled_segments, but aren't in recycled_segment_paths_ yet.
+  int recycled_segments_reserved_;
+
   // Lock to protect mutations to log_state_ and other shared state variables.
   mutable percpu_rwlock state_lock_;
 
@@ -386,6 +423,10 @@ class Log : public RefCountedThreadSafe<Log> {
   // This is used to disable fsync during bootstrap.
   bool sync_disabled_;
 
+  // If non-null, syncs are group-committed with those of the other tablets'
+  // logs under the same WAL root, rather than done just for this log.
+  SharedLogSyncer* shared_syncer_;
+
   // The status of the most recent log-allocation action.
   Promise<Status> allocation_status_;
 
@@ -449,6 +490,11 @@ class LogEntryBatch {
   // Serializes contents of the entry to an internal buffer.
   Status Serialize();
 
+  // Serializes a batch of REPLICATE entries like Serialize(), but writes out
+  // the cached encodings of the messages in 'replicates_' rather than encode
+  // them again.
+  Status SerializeReplicates();
+
   // Sets the callback that will be invoked after the entry is
   // appended and synced to disk
   void set_callback(const StatusCallback& cb) {
@@ -487,6 +533,12 @@ class LogEntryBatch {
 
   size_t count() const { return count_; }
 
+  // Returns the CRC32C of data(), which is computed by Serialize().
+  uint32_t data_crc() const {
+    DCHECK_EQ(state_, kEntryReady);
+    return crc_;
+  }
+
   // Returns the total size in bytes of the object.
   size_t total_size_bytes() const {
     return total_size_bytes_;
@@ -527,6 +579,12 @@ class LogEntryBatch {
   // synced to disk.
   StatusCallback callback_;
 
+  // The trace of the operation which appended this batch, if any, and when
+  // it did so. Used to attribute the time spent waiting for the WAL to be
+  // synced to that operation.
+  scoped_refptr<Trace> trace_;
+  MonoTime append_time_;
+
   // Used to coordinate the synchronizer thread and the caller
   // thread: this lock starts out locked, and is unlocked by the
   // caller thread (i.e., inside AppendThread()) once the entry is
@@ -538,6 +596,9 @@ class LogEntryBatch {
   // 'Serialize()'
   faststring buffer_;
 
+  // The CRC32C of 'buffer_'.
+  uint32_t crc_;
+
   enum LogEntryState {
     kEntryInitialized,
     kEntryReserved,
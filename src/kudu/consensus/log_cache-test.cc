@@ -17,6 +17,7 @@
 
 #include <gtest/gtest.h>
 #include <memory>
+#include <mutex>
 #include <string>
 
 #include "kudu/common/wire_protocol-test-util.h"
@@ -25,6 +26,7 @@
 #include "kudu/consensus/log_cache.h"
 #include "kudu/fs/fs_manager.h"
 #include "kudu/gutil/bind_helpers.h"
+#include "kudu/gutil/map-util.h"
 #include "kudu/gutil/stl_util.h"
 #include "kudu/server/hybrid_clock.h"
 #include "kudu/util/mem_tracker.h"
@@ -35,6 +37,7 @@ using std::shared_ptr;
 
 DECLARE_int32(log_cache_size_limit_mb);
 DECLARE_int32(global_log_cache_size_limit_mb);
+DECLARE_bool(log_cache_compact_entries);
 
 METRIC_DECLARE_entity(tablet);
 
@@ -267,12 +270,112 @@ TEST_F(LogCacheTest, TestMemoryLimit) {
   ASSERT_EQ(cache_->BytesUsed(), 0);
 }
 
+// Test that operations retained for peers which are close to caught up
+// aren't evicted to make room for new ones.
+TEST_F(LogCacheTest, TestRetainedOpsAreNotEvicted) {
+  FLAGS_log_cache_compact_entries = false;
+  FLAGS_log_cache_size_limit_mb = 1;
+  CloseAndReopenCache(MinimumOpId());
+
+  const int kPayloadSize = 400 * 1024;
+  ASSERT_OK(AppendReplicateMessagesToCache(1, 2, kPayloadSize));
+  log_->WaitUntilAllFlushed();
+  ASSERT_EQ(2, cache_->num_cached_ops());
+
+  // A peer still needs op 1, so appending past the limit keeps all three.
+  cache_->SetRetainedOpIndex(1);
+  ASSERT_OK(AppendReplicateMessagesToCache(3, 1, kPayloadSize));
+  log_->WaitUntilAllFlushed();
+  ASSERT_EQ(3, cache_->num_cached_ops());
+
+  // Once it has moved on, the op it no longer needs is evicted.
+  cache_->SetRetainedOpIndex(2);
+  ASSERT_OK(AppendReplicateMessagesToCache(4, 1, kPayloadSize));
+  log_->WaitUntilAllFlushed();
+  ASSERT_EQ(3, cache_->num_cached_ops());
+  ASSERT_FALSE(ContainsKey(cache_->cache_, 1));
+
+  // Retained ops are still evicted once they're replicated everywhere.
+  cache_->EvictThroughOp(4);
+  ASSERT_EQ(0, cache_->num_cached_ops());
+}
+
+// Test that the cache makes room by compacting its oldest ops before evicting
+// any, and that compacted ops are read back intact.
+TEST_F(LogCacheTest, TestCompactsBeforeEvicting) {
+  FLAGS_log_cache_size_limit_mb = 1;
+  CloseAndReopenCache(MinimumOpId());
+
+  const int kPayloadSize = 400 * 1024;
+  ASSERT_OK(AppendReplicateMessagesToCache(1, 2, kPayloadSize));
+  log_->WaitUntilAllFlushed();
+  ASSERT_EQ(2, cache_->num_cached_ops());
+
+  // The (all-zero) payloads compress well, so appending past the limit keeps
+  // every op, with the oldest one compacted.
+  ASSERT_OK(AppendReplicateMessagesToCache(3, 2, kPayloadSize));
+  log_->WaitUntilAllFlushed();
+  ASSERT_EQ(4, cache_->num_cached_ops());
+  ASSERT_LE(cache_->BytesUsed(), 1024 * 1024);
+  {
+    std::lock_guard<simple_spinlock> l(cache_->lock_);
+    ASSERT_FALSE(FindOrDie(cache_->cache_, 1).msg);
+    ASSERT_TRUE(FindOrDie(cache_->cache_, 4).msg);
+  }
+
+  vector<ReplicateRefPtr> messages;
+  OpId preceding;
+  ASSERT_OK(cache_->ReadOps(0, 8 * 1024 * 1024, &messages, &preceding));
+  ASSERT_EQ(4, messages.size());
+  for (int i = 0; i < messages.size(); i++) {
+    const ReplicateMsg* msg = messages[i]->get();
+    EXPECT_EQ(i + 1, msg->id().index());
+    EXPECT_EQ(kPayloadSize, msg->noop_request().payload_for_tests().size());
+  }
+
+  // Compacted ops are evicted like any other.
+  messages.clear();
+  cache_->EvictThroughOp(4);
+  ASSERT_EQ(0, cache_->num_cached_ops());
+  ASSERT_EQ(0, cache_->BytesUsed());
+}
+
+// Test that reading ops from disk reads the following ones into the cache.
+TEST_F(LogCacheTest, TestReadAheadAfterDiskRead) {
+  const int kPayloadSize = 1024;
+  ASSERT_OK(AppendReplicateMessagesToCache(1, 100, kPayloadSize));
+  log_->WaitUntilAllFlushed();
+  cache_->EvictThroughOp(100);
+  ASSERT_EQ(0, cache_->num_cached_ops());
+
+  vector<ReplicateRefPtr> messages;
+  OpId preceding;
+  ASSERT_OK(cache_->ReadOps(0, 10 * kPayloadSize, &messages, &preceding));
+  ASSERT_GT(messages.size(), 0);
+  ASSERT_LT(messages.size(), 100);
+  const int64_t next_index = messages.back()->get()->id().index() + 1;
+
+  AssertEventually([&]() {
+    std::lock_guard<simple_spinlock> l(cache_->lock_);
+    ASSERT_FALSE(cache_->read_ahead_in_progress_);
+    ASSERT_TRUE(ContainsKey(cache_->cache_, next_index));
+  });
+  ASSERT_GT(cache_->num_cached_ops(), 0);
+
+  // The next read is served from what was read ahead.
+  messages.clear();
+  ASSERT_OK(cache_->ReadOps(next_index - 1, 10 * kPayloadSize, &messages, &preceding));
+  ASSERT_GT(messages.size(), 0);
+  EXPECT_EQ(next_index, messages[0]->get()->id().index());
+}
+
 TEST_F(LogCacheTest, TestGlobalMemoryLimit) {
   // Need to force the global cache memtracker to be destroyed before calling
   // CloseAndreopenCache(), otherwise it'll just be reused instead of recreated
   // with a new limit.
   cache_.reset();
 
+  FLAGS_log_cache_compact_entries = false;
   FLAGS_global_log_cache_size_limit_mb = 4;
   CloseAndReopenCache(MinimumOpId());
 
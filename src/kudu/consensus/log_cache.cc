@@ -18,13 +18,18 @@
 #include "kudu/consensus/log_cache.h"
 
 #include <algorithm>
+#include <boost/bind.hpp>
 #include <gflags/gflags.h>
 #include <google/protobuf/wire_format_lite.h>
 #include <google/protobuf/wire_format_lite_inl.h>
 #include <map>
+#include <memory>
 #include <mutex>
+#include <string>
+#include <utility>
 #include <vector>
 
+#include "kudu/cfile/compression_codec.h"
 #include "kudu/consensus/log.h"
 #include "kudu/consensus/log_reader.h"
 #include "kudu/consensus/ref_counted_replicate.h"
@@ -39,6 +44,7 @@
 #include "kudu/util/logging.h"
 #include "kudu/util/mem_tracker.h"
 #include "kudu/util/metrics.h"
+#include "kudu/util/threadpool.h"
 
 DEFINE_int32(log_cache_size_limit_mb, 128,
              "The total per-tablet size of consensus entries which may be kept in memory. "
@@ -52,6 +58,25 @@ DEFINE_int32(global_log_cache_size_limit_mb, 1024,
              "caching log entries across all tablets is kept under this threshold.");
 TAG_FLAG(global_log_cache_size_limit_mb, advanced);
 
+DEFINE_bool(log_cache_read_ahead, true,
+            "Whether to read the next batch of operations from disk into the log cache "
+            "in the background whenever a peer's request has to be served from disk, so "
+            "that its next request is served from memory.");
+TAG_FLAG(log_cache_read_ahead, advanced);
+
+DEFINE_bool(log_cache_compact_entries, true,
+            "Whether the log cache makes room for new operations by first keeping "
+            "the oldest ones in their wire encoding, compressed with "
+            "--log_cache_compression_codec, rather than evicting them right away. "
+            "The same memory then covers more of the log, so that lagging peers "
+            "are served from memory for longer.");
+TAG_FLAG(log_cache_compact_entries, advanced);
+
+DEFINE_string(log_cache_compression_codec, "lz4",
+              "Codec with which the log cache compresses the operations it compacts: "
+              "one of 'none', 'snappy', 'lz4', 'zlib' or 'zstd'.");
+TAG_FLAG(log_cache_compression_codec, advanced);
+
 using strings::Substitute;
 
 namespace kudu {
@@ -76,8 +101,14 @@ LogCache::LogCache(const scoped_refptr<MetricEntity>& metric_entity,
     local_uuid_(local_uuid),
     tablet_id_(tablet_id),
     next_sequential_op_index_(0),
+    compact_from_index_(0),
     min_pinned_op_index_(0),
+    retained_op_index_(MathLimits<int64_t>::kMax),
+    truncation_count_(0),
+    read_ahead_in_progress_(false),
     metrics_(metric_entity) {
+  CHECK_OK(ThreadPoolBuilder("log-cache-read-ahead").set_max_threads(1).Build(
+      &read_ahead_pool_));
 
 
   const int64_t max_ops_size_bytes = FLAGS_log_cache_size_limit_mb * 1024L * 1024L;
@@ -98,10 +129,12 @@ LogCache::LogCache(const scoped_refptr<MetricEntity>& metric_entity,
   // code paths elsewhere.
   auto zero_op = new ReplicateMsg();
   *zero_op->mutable_id() = MinimumOpId();
-  InsertOrDie(&cache_, 0, make_scoped_refptr_replicate(zero_op));
+  ReplicateRefPtr zero_msg = make_scoped_refptr_replicate(zero_op);
+  InsertOrDie(&cache_, 0, MakeEntry(zero_msg));
 }
 
 LogCache::~LogCache() {
+  read_ahead_pool_->Shutdown();
   tracker_->Release(tracker_->consumption());
   cache_.clear();
 }
@@ -127,16 +160,38 @@ void LogCache::TruncateOpsAfterUnlocked(int64_t index) {
 
   // Now remove the overwritten operations.
   for (int64_t i = first_to_truncate; i < next_sequential_op_index_; ++i) {
-    ReplicateRefPtr msg = EraseKeyReturnValuePtr(&cache_, i);
-    if (msg != nullptr) {
-      AccountForMessageRemovalUnlocked(msg);
+    auto iter = cache_.find(i);
+    if (iter != cache_.end()) {
+      AccountForEntryRemovalUnlocked(iter->second);
+      cache_.erase(iter);
     }
   }
   next_sequential_op_index_ = index + 1;
+  compact_from_index_ = std::min(compact_from_index_, first_to_truncate);
+  truncation_count_++;
 }
 
 Status LogCache::AppendOperations(const vector<ReplicateRefPtr>& msgs,
                                   const StatusCallback& callback) {
+  // Serialize the messages up front, so that the memory of their encodings
+  // is accounted for along with them. The encodings are reused when writing
+  // the messages to the log and sending them to peers.
+  int64_t mem_required = 0;
+  for (const auto& msg : msgs) {
+    Slice serialized;
+    RETURN_NOT_OK(msg->GetSerialized(&serialized));
+    mem_required += msg->SpaceUsed();
+  }
+
+  // Make room by compacting older operations first, which is too slow to do
+  // under the lock.
+  if (FLAGS_log_cache_compact_entries) {
+    int64_t spare = tracker_->SpareCapacity();
+    if (spare < mem_required) {
+      CompactSome(mem_required - spare);
+    }
+  }
+
   std::unique_lock<simple_spinlock> l(lock_);
 
   int size = msgs.size();
@@ -152,11 +207,6 @@ Status LogCache::AppendOperations(const vector<ReplicateRefPtr>& msgs,
   }
 
 
-  int64_t mem_required = 0;
-  for (const auto& msg : msgs) {
-    mem_required += msg->get()->SpaceUsed();
-  }
-
   // Try to consume the memory. If it can't be consumed, we may need to evict.
   bool borrowed_memory = false;
   if (!tracker_->TryConsume(mem_required)) {
@@ -170,7 +220,7 @@ Status LogCache::AppendOperations(const vector<ReplicateRefPtr>& msgs,
 
     // TODO: we should also try to evict from other tablets - probably better to
     // evict really old ops from another tablet than evict recent ops from this one.
-    EvictSomeUnlocked(min_pinned_op_index_, need_to_free);
+    EvictSomeUnlocked(retained_op_index_ - 1, need_to_free);
 
     // Force consuming, so that we don't refuse appending data. We might
     // blow past our limit a little bit (as much as the number of tablets times
@@ -182,7 +232,7 @@ Status LogCache::AppendOperations(const vector<ReplicateRefPtr>& msgs,
   }
 
   for (const auto& msg : msgs) {
-    InsertOrDie(&cache_,  msg->get()->id().index(), msg);
+    InsertOrDie(&cache_,  msg->get()->id().index(), MakeEntry(msg));
   }
 
   // We drop the lock during the AsyncAppendReplicates call, since it may block
@@ -216,18 +266,25 @@ void LogCache::LogCallback(int64_t last_idx_in_batch,
                            const StatusCallback& user_callback,
                            const Status& log_status) {
   if (log_status.ok()) {
-    std::lock_guard<simple_spinlock> l(lock_);
-    if (min_pinned_op_index_ <= last_idx_in_batch) {
-      VLOG_WITH_PREFIX_UNLOCKED(1) << "Updating pinned index to " << (last_idx_in_batch + 1);
-      min_pinned_op_index_ = last_idx_in_batch + 1;
+    {
+      std::lock_guard<simple_spinlock> l(lock_);
+      if (min_pinned_op_index_ <= last_idx_in_batch) {
+        VLOG_WITH_PREFIX_UNLOCKED(1) << "Updating pinned index to " << (last_idx_in_batch + 1);
+        min_pinned_op_index_ = last_idx_in_batch + 1;
+      }
     }
 
-    // If we went over the global limit in order to log this batch, evict some to
-    // get back down under the limit.
+    // If we went over the global limit in order to log this batch, compact or
+    // evict some to get back down under the limit.
     if (borrowed_memory) {
       int64_t spare_capacity = parent_tracker_->SpareCapacity();
+      if (spare_capacity < 0 && FLAGS_log_cache_compact_entries) {
+        CompactSome(-spare_capacity);
+        spare_capacity = parent_tracker_->SpareCapacity();
+      }
       if (spare_capacity < 0) {
-        EvictSomeUnlocked(min_pinned_op_index_, -spare_capacity);
+        std::lock_guard<simple_spinlock> l(lock_);
+        EvictSomeUnlocked(retained_op_index_ - 1, -spare_capacity);
       }
     }
   }
@@ -255,7 +312,7 @@ Status LogCache::LookupOpId(int64_t op_index, OpId* op_id) const {
     }
     auto iter = cache_.find(op_index);
     if (iter != cache_.end()) {
-      *op_id = iter->second->get()->id();
+      *op_id = iter->second.id;
       return Status::OK();
     }
   }
@@ -268,12 +325,16 @@ namespace {
 // Calculate the total byte size that will be used on the wire to replicate
 // this message as part of a consensus update request. This accounts for the
 // length delimiting and tagging of the message.
-int64_t TotalByteSizeForMessage(const ReplicateMsg& msg) {
+int64_t TotalByteSizeForMessage(int64_t serialized_size) {
   int msg_size = google::protobuf::internal::WireFormatLite::LengthDelimitedSize(
-    msg.ByteSize());
+    serialized_size);
   msg_size += 1; // for the type tag
   return msg_size;
 }
+
+int64_t TotalByteSizeForMessage(const ReplicateMsg& msg) {
+  return TotalByteSizeForMessage(msg.ByteSize());
+}
 } // anonymous namespace
 
 Status LogCache::ReadOps(int64_t after_op_index,
@@ -328,35 +389,121 @@ Status LogCache::ReadOps(int64_t after_op_index,
         }
       }
 
+      // The peer is likely to need the following operations next, so get
+      // them into the cache while this batch is on its way.
+      if (FLAGS_log_cache_read_ahead && next_index <= up_to) {
+        ScheduleReadAheadUnlocked(next_index, up_to, max_size_bytes);
+      }
+
     } else {
       // Pull contiguous messages from the cache until the size limit is achieved.
+      // The compacted ones are decoded once the lock is dropped.
+      vector<std::pair<size_t, CacheEntry>> to_decode;
       for (; iter != cache_.end(); ++iter) {
-        const ReplicateRefPtr& msg = iter->second;
-        int64_t index = msg->get()->id().index();
+        const CacheEntry& entry = iter->second;
+        int64_t index = entry.id.index();
         if (index != next_index) {
           continue;
         }
 
-        remaining_space -= TotalByteSizeForMessage(*msg->get());
+        remaining_space -= TotalByteSizeForMessage(entry.serialized_size);
         if (remaining_space < 0 && !messages->empty()) {
           break;
         }
 
-        messages->push_back(msg);
+        if (entry.msg) {
+          messages->push_back(entry.msg);
+        } else {
+          to_decode.emplace_back(messages->size(), entry);
+          messages->emplace_back();
+        }
         next_index++;
       }
+
+      if (!to_decode.empty()) {
+        l.unlock();
+        for (const auto& e : to_decode) {
+          RETURN_NOT_OK_PREPEND(DecodeCompactedEntry(e.second, &(*messages)[e.first]),
+                                Substitute("Failed to decode cached op $0",
+                                           e.second.id.index()));
+        }
+        l.lock();
+      }
     }
   }
   return Status::OK();
 }
 
 
+void LogCache::ScheduleReadAheadUnlocked(int64_t from_index, int64_t up_to,
+                                         int max_size_bytes) {
+  DCHECK(lock_.is_locked());
+  if (read_ahead_in_progress_) {
+    return;
+  }
+  Status s = read_ahead_pool_->SubmitFunc(
+      boost::bind(&LogCache::ReadAheadTask, this, from_index, up_to, max_size_bytes,
+                  truncation_count_));
+  if (!s.ok()) {
+    LOG_WITH_PREFIX_UNLOCKED(WARNING) << "Unable to read ahead ops " << from_index << ".."
+                                      << up_to << ": " << s.ToString();
+    return;
+  }
+  read_ahead_in_progress_ = true;
+}
+
+void LogCache::ReadAheadTask(int64_t from_index, int64_t up_to, int max_size_bytes,
+                             int64_t truncation_count) {
+  vector<ReplicateMsg*> raw_replicate_ptrs;
+  ElementDeleter d(&raw_replicate_ptrs);
+  Status s = log_->reader()->ReadReplicatesInRange(from_index, up_to, max_size_bytes,
+                                                   &raw_replicate_ptrs);
+
+  std::lock_guard<simple_spinlock> l(lock_);
+  read_ahead_in_progress_ = false;
+  if (!s.ok()) {
+    VLOG_WITH_PREFIX_UNLOCKED(1) << "Failed to read ahead ops " << from_index << ".."
+                                 << up_to << ": " << s.ToString();
+    return;
+  }
+  if (truncation_count != truncation_count_) {
+    return;
+  }
+
+  int num_cached = 0;
+  for (ReplicateMsg*& raw_msg : raw_replicate_ptrs) {
+    int64_t index = raw_msg->id().index();
+    if (index >= next_sequential_op_index_ || ContainsKey(cache_, index)) {
+      continue;
+    }
+    ReplicateRefPtr msg = make_scoped_refptr_replicate(raw_msg);
+    raw_msg = nullptr;
+    Slice serialized;
+    if (!msg->GetSerialized(&serialized).ok() ||
+        !tracker_->TryConsume(msg->SpaceUsed())) {
+      // Read-ahead is best-effort, and mustn't evict anything.
+      break;
+    }
+    metrics_.log_cache_size->IncrementBy(msg->SpaceUsed());
+    metrics_.log_cache_num_ops->Increment();
+    InsertOrDie(&cache_, index, MakeEntry(msg));
+    num_cached++;
+  }
+  VLOG_WITH_PREFIX_UNLOCKED(2) << "Read ahead " << num_cached << " ops from disk, starting at "
+                               << from_index;
+}
+
 void LogCache::EvictThroughOp(int64_t index) {
   std::lock_guard<simple_spinlock> lock(lock_);
 
   EvictSomeUnlocked(index, MathLimits<int64_t>::kMax);
 }
 
+void LogCache::SetRetainedOpIndex(int64_t index) {
+  std::lock_guard<simple_spinlock> lock(lock_);
+  retained_op_index_ = index;
+}
+
 void LogCache::EvictSomeUnlocked(int64_t stop_after_index, int64_t bytes_to_evict) {
   DCHECK(lock_.is_locked());
   VLOG_WITH_PREFIX_UNLOCKED(2) << "Evicting log cache index <= "
@@ -366,9 +513,9 @@ void LogCache::EvictSomeUnlocked(int64_t stop_after_index, int64_t bytes_to_evic
 
   int64_t bytes_evicted = 0;
   for (auto iter = cache_.begin(); iter != cache_.end();) {
-    const ReplicateRefPtr& msg = (*iter).second;
-    VLOG_WITH_PREFIX_UNLOCKED(2) << "considering for eviction: " << msg->get()->id();
-    int64_t msg_index = msg->get()->id().index();
+    const CacheEntry& entry = (*iter).second;
+    VLOG_WITH_PREFIX_UNLOCKED(2) << "considering for eviction: " << entry.id;
+    int64_t msg_index = entry.id.index();
     if (msg_index == 0) {
       // Always keep our special '0' op.
       ++iter;
@@ -379,16 +526,16 @@ void LogCache::EvictSomeUnlocked(int64_t stop_after_index, int64_t bytes_to_evic
       break;
     }
 
-    if (!msg->HasOneRef()) {
-      VLOG_WITH_PREFIX_UNLOCKED(2) << "Evicting cache: cannot remove " << msg->get()->id()
+    if (entry.msg && !entry.msg->HasOneRef()) {
+      VLOG_WITH_PREFIX_UNLOCKED(2) << "Evicting cache: cannot remove " << entry.id
                                    << " because it is in-use by a peer.";
       ++iter;
       continue;
     }
 
-    VLOG_WITH_PREFIX_UNLOCKED(2) << "Evicting cache. Removing: " << msg->get()->id();
-    AccountForMessageRemovalUnlocked(msg);
-    bytes_evicted += msg->get()->SpaceUsed();
+    VLOG_WITH_PREFIX_UNLOCKED(2) << "Evicting cache. Removing: " << entry.id;
+    AccountForEntryRemovalUnlocked(entry);
+    bytes_evicted += entry.mem_usage;
     cache_.erase(iter++);
 
     if (bytes_evicted >= bytes_to_evict) {
@@ -398,9 +545,151 @@ void LogCache::EvictSomeUnlocked(int64_t stop_after_index, int64_t bytes_to_evic
   VLOG_WITH_PREFIX_UNLOCKED(1) << "Evicting log cache: after state: " << ToStringUnlocked();
 }
 
-void LogCache::AccountForMessageRemovalUnlocked(const ReplicateRefPtr& msg) {
-  tracker_->Release(msg->get()->SpaceUsed());
-  metrics_.log_cache_size->DecrementBy(msg->get()->SpaceUsed());
+int64_t LogCache::CompactSome(int64_t bytes_to_free) {
+  CompressionType codec = cfile::GetCompressionCodecType(FLAGS_log_cache_compression_codec);
+  const cfile::CompressionCodec* compressor = nullptr;
+  if (codec != NO_COMPRESSION) {
+    Status s = cfile::GetCompressionCodec(codec, &compressor);
+    if (!s.ok()) {
+      KLOG_EVERY_N_SECS(WARNING, 60) << LogPrefixUnlocked()
+                                     << "Unable to compact log cache entries: " << s.ToString();
+      return 0;
+    }
+  }
+
+  // An operation picked for compaction, which holds a reference to it so
+  // that it can be serialized and compressed without holding the lock.
+  struct Candidate {
+    int64_t index;
+    ReplicateRefPtr msg;
+    std::shared_ptr<string> compacted;
+    CompressionType codec;
+  };
+
+  // Pick the oldest operations which aren't in use, until they use about as
+  // much memory as needs to be freed.
+  vector<Candidate> candidates;
+  {
+    std::lock_guard<simple_spinlock> l(lock_);
+    int64_t bytes_picked = 0;
+    for (auto iter = cache_.lower_bound(compact_from_index_);
+         iter != cache_.end() && bytes_picked < bytes_to_free;
+         ++iter) {
+      const CacheEntry& entry = iter->second;
+      int64_t index = entry.id.index();
+      if (index == 0) {
+        // Our special '0' op is never compacted.
+        continue;
+      }
+      if (index >= min_pinned_op_index_) {
+        break;
+      }
+      if (!entry.msg || !entry.msg->HasOneRef()) {
+        // Already compacted, or in use by a peer: it is neither worth nor
+        // safe to drop the message.
+        continue;
+      }
+      candidates.push_back({ index, entry.msg, nullptr, NO_COMPRESSION });
+      bytes_picked += entry.mem_usage;
+    }
+  }
+  if (candidates.empty()) {
+    return 0;
+  }
+
+  for (Candidate& c : candidates) {
+    Slice serialized;
+    Status s = c.msg->GetSerialized(&serialized);
+    if (!s.ok()) {
+      KLOG_EVERY_N_SECS(WARNING, 60) << LogPrefixUnlocked() << "Unable to compact op "
+                                     << c.msg->get()->id() << ": " << s.ToString();
+      continue;
+    }
+    auto compacted = std::make_shared<string>();
+    if (compressor) {
+      compacted->resize(compressor->MaxCompressedLength(serialized.size()));
+      size_t compressed_size;
+      if (compressor->Compress(serialized, reinterpret_cast<uint8_t*>(&(*compacted)[0]),
+                               &compressed_size).ok() &&
+          compressed_size < serialized.size()) {
+        compacted->resize(compressed_size);
+        c.codec = codec;
+      }
+    }
+    if (c.codec == NO_COMPRESSION) {
+      compacted->assign(serialized.ToString());
+    }
+    compacted->shrink_to_fit();
+    c.compacted = std::move(compacted);
+  }
+
+  // Swap in the compacted operations, unless they have been replaced or
+  // picked up by a peer in the meantime.
+  int64_t bytes_freed = 0;
+  std::lock_guard<simple_spinlock> l(lock_);
+  for (Candidate& c : candidates) {
+    CacheEntry* entry = FindOrNull(cache_, c.index);
+    bool unchanged = entry != nullptr && c.compacted && entry->msg == c.msg;
+    c.msg.reset();
+    if (!unchanged || !entry->msg->HasOneRef()) {
+      continue;
+    }
+    int64_t new_mem_usage = c.compacted->capacity();
+    int64_t freed = entry->mem_usage - new_mem_usage;
+    entry->msg.reset();
+    entry->compacted = std::move(c.compacted);
+    entry->codec = c.codec;
+    entry->mem_usage = new_mem_usage;
+    tracker_->Release(freed);
+    metrics_.log_cache_size->DecrementBy(freed);
+    bytes_freed += freed;
+  }
+
+  // Skip past the compacted operations the next time.
+  for (auto iter = cache_.lower_bound(compact_from_index_); iter != cache_.end(); ++iter) {
+    int64_t index = iter->second.id.index();
+    if (index != 0 && (index >= min_pinned_op_index_ || iter->second.msg)) {
+      break;
+    }
+    compact_from_index_ = index + 1;
+  }
+  return bytes_freed;
+}
+
+Status LogCache::DecodeCompactedEntry(const CacheEntry& entry, ReplicateRefPtr* msg) {
+  DCHECK(entry.compacted);
+  Slice serialized(*entry.compacted);
+  faststring uncompressed;
+  if (entry.codec != NO_COMPRESSION) {
+    const cfile::CompressionCodec* codec;
+    RETURN_NOT_OK(cfile::GetCompressionCodec(entry.codec, &codec));
+    uncompressed.resize(entry.serialized_size);
+    RETURN_NOT_OK(codec->Uncompress(serialized, uncompressed.data(), uncompressed.size()));
+    serialized = Slice(uncompressed);
+  }
+  gscoped_ptr<ReplicateMsg> replicate(new ReplicateMsg());
+  if (!replicate->ParseFromArray(serialized.data(), serialized.size())) {
+    return Status::Corruption("unable to parse compacted replicate message",
+                              replicate->InitializationErrorString());
+  }
+  *msg = make_scoped_refptr(new RefCountedReplicate(replicate.release(), serialized));
+  return Status::OK();
+}
+
+LogCache::CacheEntry LogCache::MakeEntry(const ReplicateRefPtr& msg) {
+  CacheEntry entry;
+  entry.msg = msg;
+  entry.id = msg->get()->id();
+  entry.op_type = msg->get()->op_type();
+  entry.serialized_size = msg->get()->ByteSize();
+  entry.codec = NO_COMPRESSION;
+  entry.mem_usage = msg->SpaceUsed();
+  return entry;
+}
+
+void LogCache::AccountForEntryRemovalUnlocked(const CacheEntry& entry) {
+  tracker_->Release(entry.mem_usage);
+  metrics_.log_cache_size->DecrementBy(entry.mem_usage);
   metrics_.log_cache_num_ops->Decrement();
 }
 
@@ -449,13 +738,13 @@ void LogCache::DumpToStrings(vector<string>* lines) const {
   int counter = 0;
   lines->push_back(ToStringUnlocked());
   lines->push_back("Messages:");
-  for (const MessageCache::value_type& entry : cache_) {
-    const ReplicateMsg* msg = entry.second->get();
+  for (const MessageCache::value_type& e : cache_) {
+    const CacheEntry& entry = e.second;
     lines->push_back(
-      Substitute("Message[$0] $1.$2 : REPLICATE. Type: $3, Size: $4",
-                 counter++, msg->id().term(), msg->id().index(),
-                 OperationType_Name(msg->op_type()),
-                 msg->ByteSize()));
+      Substitute("Message[$0] $1.$2 : REPLICATE. Type: $3, Size: $4$5",
+                 counter++, entry.id.term(), entry.id.index(),
+                 OperationType_Name(entry.op_type),
+                 entry.serialized_size, entry.msg ? "" : " (compacted)"));
   }
 }
 
@@ -468,13 +757,14 @@ void LogCache::DumpToHtml(std::ostream& out) const {
   out << "<tr><th>Entry</th><th>OpId</th><th>Type</th><th>Size</th><th>Status</th></tr>" << endl;
 
   int counter = 0;
-  for (const MessageCache::value_type& entry : cache_) {
-    const ReplicateMsg* msg = entry.second->get();
+  for (const MessageCache::value_type& e : cache_) {
+    const CacheEntry& entry = e.second;
     out << Substitute("<tr><th>$0</th><th>$1.$2</th><td>REPLICATE $3</td>"
                       "<td>$4</td><td>$5</td></tr>",
-                      counter++, msg->id().term(), msg->id().index(),
-                      OperationType_Name(msg->op_type()),
-                      msg->ByteSize(), msg->id().ShortDebugString()) << endl;
+                      counter++, entry.id.term(), entry.id.index(),
+                      OperationType_Name(entry.op_type),
+                      entry.serialized_size,
+                      entry.msg ? entry.id.ShortDebugString() : "compacted") << endl;
   }
   out << "</table>";
 }
@@ -22,6 +22,7 @@
 #include <string>
 #include <vector>
 
+#include "kudu/common/common.pb.h"
 #include "kudu/consensus/consensus.pb.h"
 #include "kudu/consensus/opid_util.h"
 #include "kudu/consensus/ref_counted_replicate.h"
@@ -36,6 +37,7 @@ namespace kudu {
 
 class MetricEntity;
 class MemTracker;
+class ThreadPool;
 
 namespace log {
 class Log;
@@ -114,6 +116,12 @@ class LogCache {
   // Evict any operations with op index <= 'index'.
   void EvictThroughOp(int64_t index);
 
+  // Keep operations with op index >= 'index' when evicting to make room for
+  // new ones, so long as they aren't evicted through EvictThroughOp(). The
+  // queue sets this to the first operation still needed by peers which are
+  // close to caught up, which would otherwise have to read it from disk.
+  void SetRetainedOpIndex(int64_t index);
+
   // Return the number of bytes of memory currently in use by the cache.
   int64_t BytesUsed() const;
 
@@ -147,19 +155,70 @@ class LogCache {
   FRIEND_TEST(LogCacheTest, TestGlobalMemoryLimit);
   FRIEND_TEST(LogCacheTest, TestReplaceMessages);
   FRIEND_TEST(LogCacheTest, TestTruncation);
+  FRIEND_TEST(LogCacheTest, TestRetainedOpsAreNotEvicted);
+  FRIEND_TEST(LogCacheTest, TestReadAheadAfterDiskRead);
+  FRIEND_TEST(LogCacheTest, TestCompactsBeforeEvicting);
   friend class LogCacheTest;
 
+  // An operation in the cache. To make room for new operations, the oldest
+  // ones are first compacted into their wire encoding, compressed with
+  // --log_cache_compression_codec, and only evicted if that isn't enough.
+  struct CacheEntry {
+    // The operation, unless the entry has been compacted.
+    ReplicateRefPtr msg;
+
+    // The id and type of the operation, which stay known once compacted.
+    OpId id;
+    OperationType op_type;
+
+    // The size of the wire encoding of the operation.
+    int64_t serialized_size;
+
+    // Once compacted, the wire encoding of the operation, compressed with
+    // 'codec'. Shared so that it can be decoded without holding 'lock_'.
+    std::shared_ptr<const std::string> compacted;
+    CompressionType codec;
+
+    // The memory charged to the cache for the entry.
+    int64_t mem_usage;
+  };
+
+  // Returns a new, uncompacted entry for 'msg', accounting for the memory it
+  // uses at this point.
+  static CacheEntry MakeEntry(const ReplicateRefPtr& msg);
+
+  // Sets 'msg' to the operation parsed back from the compacted 'entry'.
+  static Status DecodeCompactedEntry(const CacheEntry& entry, ReplicateRefPtr* msg);
+
   // Try to evict the oldest operations from the queue, stopping either when
   // 'bytes_to_evict' bytes have been evicted, or the op with index
   // 'stop_after_index' has been evicted, whichever comes first.
   void EvictSomeUnlocked(int64_t stop_after_index, int64_t bytes_to_evict);
 
+  // Compact the oldest operations which aren't in use until about
+  // 'bytes_to_free' bytes have been freed. Returns the number of bytes freed.
+  //
+  // Must be called without 'lock_' held: the operations are compressed
+  // outside of it, and only swapped in for those which haven't changed since.
+  int64_t CompactSome(int64_t bytes_to_free);
+
   // Update metrics and MemTracker to account for the removal of the
-  // given message.
-  void AccountForMessageRemovalUnlocked(const ReplicateRefPtr& msg);
+  // given entry.
+  void AccountForEntryRemovalUnlocked(const CacheEntry& entry);
 
   void TruncateOpsAfterUnlocked(int64_t index);
 
+  // Asynchronously read operations from 'from_index' to 'up_to', both
+  // inclusive, from disk into the cache, up to 'max_size_bytes' of them.
+  // Does nothing if a read-ahead is already in progress.
+  void ScheduleReadAheadUnlocked(int64_t from_index, int64_t up_to, int max_size_bytes);
+
+  // The body of the read-ahead scheduled above. The operations are only
+  // cached if the cache hasn't been truncated since 'truncation_count', and
+  // there is room for them.
+  void ReadAheadTask(int64_t from_index, int64_t up_to, int max_size_bytes,
+                     int64_t truncation_count);
+
   // Return a string with stats
   std::string StatsStringUnlocked() const;
 
@@ -183,10 +242,15 @@ class LogCache {
   mutable simple_spinlock lock_;
 
   // An ordered map that serves as the buffer for the cached messages.
-  // Maps from log index -> ReplicateMsg
-  typedef std::map<uint64_t, ReplicateRefPtr> MessageCache;
+  // Maps from log index -> CacheEntry
+  typedef std::map<uint64_t, CacheEntry> MessageCache;
   MessageCache cache_;
 
+  // All the operations with an index below this one which are still in the
+  // cache are compacted, so compaction may start at this index.
+  // Protected by lock_.
+  int64_t compact_from_index_;
+
   // The next log index to append. Each append operation must either
   // start with this log index, or go backward (but never skip forward).
   int64_t next_sequential_op_index_;
@@ -197,6 +261,23 @@ class LogCache {
   // Protected by lock_.
   int64_t min_pinned_op_index_;
 
+  // Operations with an index >= retained_op_index_ are not evicted to make
+  // room for new ones. See SetRetainedOpIndex().
+  // Protected by lock_.
+  int64_t retained_op_index_;
+
+  // The number of times the cache has been truncated, so that a read-ahead
+  // doesn't cache operations which have since been replaced.
+  // Protected by lock_.
+  int64_t truncation_count_;
+
+  // Whether a read-ahead is in progress on 'read_ahead_pool_'.
+  // Protected by lock_.
+  bool read_ahead_in_progress_;
+
+  // Pool on which operations are read ahead from disk.
+  gscoped_ptr<ThreadPool> read_ahead_pool_;
+
   // Pointer to a parent memtracker for all log caches. This
   // exists to compute server-wide cache size and enforce a
   // server-wide memory limit.  When the first instance of a log
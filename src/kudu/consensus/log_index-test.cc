@@ -26,6 +26,7 @@ namespace log {
 
 using consensus::MakeOpId;
 using consensus::OpId;
+using std::vector;
 
 class LogIndexTest : public KuduTest {
  public:
@@ -78,6 +79,26 @@ TEST_F(LogIndexTest, TestBasic) {
   VerifyEntry(MakeOpId(5, 1), 1, 50000);
 }
 
+TEST_F(LogIndexTest, TestGetEntries) {
+  // Straddle the boundary between two index chunks.
+  for (int64_t index = 999998; index <= 1000002; index++) {
+    ASSERT_OK(AddEntry(MakeOpId(1, index), 1, index * 10));
+  }
+
+  vector<LogIndexEntry> entries;
+  ASSERT_OK(index_->GetEntries(999998, 1000002, &entries));
+  ASSERT_EQ(5, entries.size());
+  for (int i = 0; i < entries.size(); i++) {
+    EXPECT_EQ(999998 + i, entries[i].op_id.index());
+    EXPECT_EQ(1, entries[i].segment_sequence_number);
+    EXPECT_EQ((999998 + i) * 10, entries[i].offset_in_segment);
+  }
+
+  // A range with any entry missing isn't found.
+  Status s = index_->GetEntries(999998, 1000003, &entries);
+  EXPECT_TRUE(s.IsNotFound()) << s.ToString();
+}
+
 TEST_F(LogIndexTest, TestMultiSegmentWithGC) {
   ASSERT_OK(AddEntry(MakeOpId(1, 1), 1, 12345));
   ASSERT_OK(AddEntry(MakeOpId(1, 1000000), 1, 54321));
@@ -45,6 +45,7 @@
 #include "kudu/util/locks.h"
 
 using std::string;
+using std::vector;
 using strings::Substitute;
 
 #define RETRY_ON_EINTR(ret, expr) do {          \
@@ -217,13 +218,8 @@ Status LogIndex::AddEntry(const LogIndexEntry& entry) {
   return Status::OK();
 }
 
-Status LogIndex::GetEntry(int64_t index, LogIndexEntry* entry) {
-  scoped_refptr<IndexChunk> chunk;
-  RETURN_NOT_OK(GetChunkForIndex(index, false /* do not create */, &chunk));
-  int index_in_chunk = index % kEntriesPerIndexChunk;
-  PhysicalEntry phys;
-  chunk->GetEntry(index_in_chunk, &phys);
-
+namespace {
+Status EntryFromPhysical(int64_t index, const PhysicalEntry& phys, LogIndexEntry* entry) {
   // We never write any real entries to offset 0, because there's a header
   // in each log segment. So, this indicates an entry that was never written.
   if (phys.offset_in_segment == 0) {
@@ -233,7 +229,38 @@ Status LogIndex::GetEntry(int64_t index, LogIndexEntry* entry) {
   entry->op_id = consensus::MakeOpId(phys.term, index);
   entry->segment_sequence_number = phys.segment_sequence_number;
   entry->offset_in_segment = phys.offset_in_segment;
+  return Status::OK();
+}
+} // anonymous namespace
+
+Status LogIndex::GetEntry(int64_t index, LogIndexEntry* entry) {
+  scoped_refptr<IndexChunk> chunk;
+  RETURN_NOT_OK(GetChunkForIndex(index, false /* do not create */, &chunk));
+  int index_in_chunk = index % kEntriesPerIndexChunk;
+  PhysicalEntry phys;
+  chunk->GetEntry(index_in_chunk, &phys);
+  return EntryFromPhysical(index, phys, entry);
+}
+
+Status LogIndex::GetEntries(int64_t start_index, int64_t end_index,
+                            vector<LogIndexEntry>* entries) {
+  DCHECK_LE(start_index, end_index);
+  entries->clear();
+  entries->reserve(end_index - start_index + 1);
 
+  scoped_refptr<IndexChunk> chunk;
+  int64_t chunk_idx = -1;
+  for (int64_t index = start_index; index <= end_index; index++) {
+    if (index / kEntriesPerIndexChunk != chunk_idx) {
+      RETURN_NOT_OK(GetChunkForIndex(index, false /* do not create */, &chunk));
+      chunk_idx = index / kEntriesPerIndexChunk;
+    }
+    PhysicalEntry phys;
+    chunk->GetEntry(index % kEntriesPerIndexChunk, &phys);
+    entries->emplace_back();
+    RETURN_NOT_OK_PREPEND(EntryFromPhysical(index, phys, &entries->back()),
+                          Substitute("index $0", index));
+  }
   return Status::OK();
 }
 
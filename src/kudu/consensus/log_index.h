@@ -19,6 +19,7 @@
 
 #include <string>
 #include <map>
+#include <vector>
 
 #include "kudu/consensus/consensus.pb.h"
 #include "kudu/gutil/macros.h"
@@ -67,6 +68,14 @@ class LogIndex : public RefCountedThreadSafe<LogIndex> {
   // Returns NotFound() if the given log entry was never written.
   Status GetEntry(int64_t index, LogIndexEntry* entry);
 
+  // Retrieve the existing entries for indexes 'start_index' through
+  // 'end_index', inclusive, into 'entries', in index order. This is cheaper
+  // than calling GetEntry() for each of them, as each index chunk is looked
+  // up only once.
+  // Returns NotFound() if any of the log entries was never written.
+  Status GetEntries(int64_t start_index, int64_t end_index,
+                    std::vector<LogIndexEntry>* entries);
+
   // Indicate that we no longer need to retain information about indexes lower than the
   // given index. Note that the implementation is conservative and _may_ choose to retain
   // earlier entries.
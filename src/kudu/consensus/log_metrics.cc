@@ -23,6 +23,11 @@ METRIC_DEFINE_counter(tablet, log_bytes_logged, "Bytes Written to WAL",
                       kudu::MetricUnit::kBytes,
                       "Number of bytes logged since service start");
 
+METRIC_DEFINE_counter(tablet, log_bytes_written, "Bytes Written to WAL Segments",
+                      kudu::MetricUnit::kBytes,
+                      "Number of bytes written to WAL segment files since service "
+                      "start, including entry headers and after compression");
+
 METRIC_DEFINE_histogram(tablet, log_sync_latency, "Log Sync Latency",
                         kudu::MetricUnit::kMicroseconds,
                         "Microseconds spent on synchronizing the log segment file",
@@ -48,17 +53,25 @@ METRIC_DEFINE_histogram(tablet, log_entry_batches_per_group, "Log Group Commit B
                         "Number of log entry batches in a group commit group",
                         1024, 2);
 
+METRIC_DEFINE_histogram(tablet, log_group_commit_delay, "Log Group Commit Delay",
+                        kudu::MetricUnit::kMicroseconds,
+                        "Microseconds spent by adaptive group commit waiting for "
+                        "more entry batches to add to a group",
+                        60000000LU, 2);
+
 namespace kudu {
 namespace log {
 
 #define MINIT(x) x(METRIC_log_##x.Instantiate(metric_entity))
 LogMetrics::LogMetrics(const scoped_refptr<MetricEntity>& metric_entity)
     : MINIT(bytes_logged),
+      MINIT(bytes_written),
       MINIT(sync_latency),
       MINIT(append_latency),
       MINIT(group_commit_latency),
       MINIT(roll_latency),
-      MINIT(entry_batches_per_group) {
+      MINIT(entry_batches_per_group),
+      MINIT(group_commit_delay) {
 }
 #undef MINIT
 
@@ -34,6 +34,7 @@ struct LogMetrics {
 
   // Global stats
   scoped_refptr<Counter> bytes_logged;
+  scoped_refptr<Counter> bytes_written;
 
   // Per-group group commit stats
   scoped_refptr<Histogram> sync_latency;
@@ -41,6 +42,7 @@ struct LogMetrics {
   scoped_refptr<Histogram> group_commit_latency;
   scoped_refptr<Histogram> roll_latency;
   scoped_refptr<Histogram> entry_batches_per_group;
+  scoped_refptr<Histogram> group_commit_delay;
 };
 
 } // namespace log
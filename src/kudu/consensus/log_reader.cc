@@ -18,6 +18,7 @@
 #include "kudu/consensus/log_reader.h"
 
 #include <algorithm>
+#include <gflags/gflags.h>
 #include <mutex>
 
 #include "kudu/consensus/log_index.h"
@@ -28,11 +29,19 @@
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/util/coding.h"
 #include "kudu/util/env_util.h"
+#include "kudu/util/flag_tags.h"
 #include "kudu/util/hexdump.h"
 #include "kudu/util/metrics.h"
 #include "kudu/util/path_util.h"
 #include "kudu/util/pb_util.h"
 
+DEFINE_int32(log_max_coalesced_read_bytes, 4 * 1024 * 1024,
+             "Maximum number of bytes of a log segment to read at once when reading "
+             "a range of operations, e.g. to catch up a lagging follower. The batches "
+             "of consecutive operations within this distance of each other are read "
+             "together, along with whatever lies between them.");
+TAG_FLAG(log_max_coalesced_read_bytes, advanced);
+
 METRIC_DEFINE_counter(tablet, log_reader_bytes_read, "Bytes Read From Log",
                       kudu::MetricUnit::kBytes,
                       "Data read from the WAL since tablet start");
@@ -226,32 +235,85 @@ scoped_refptr<ReadableLogSegment> LogReader::GetSegmentBySequenceNumber(int64_t
   return segments_[relative];
 }
 
-Status LogReader::ReadBatchUsingIndexEntry(const LogIndexEntry& index_entry,
-                                           faststring* tmp_buf,
-                                           gscoped_ptr<LogEntryBatchPB>* batch) const {
-  const int index = index_entry.op_id.index();
+Status LogReader::PlanReadsInRange(int64_t starting_at,
+                                   int64_t up_to,
+                                   int64_t max_bytes_to_read,
+                                   vector<LogReadRange>* plan) const {
+  DCHECK_GT(starting_at, 0);
+  DCHECK_GE(up_to, starting_at);
+  DCHECK(log_index_) << "Require an index to random-read logs";
+
+  vector<LogIndexEntry> index_entries;
+  RETURN_NOT_OK_PREPEND(log_index_->GetEntries(starting_at, up_to, &index_entries),
+                        Substitute("Failed to read log index for ops $0 to $1",
+                                   starting_at, up_to));
+
+  int64_t max_range_bytes = FLAGS_log_max_coalesced_read_bytes;
+  if (max_bytes_to_read > 0) {
+    max_range_bytes = std::min(max_range_bytes, max_bytes_to_read);
+  }
+
+  plan->clear();
+  int64_t planned_bytes = 0;
+  for (const LogIndexEntry& index_entry : index_entries) {
+    LogReadRange* range = plan->empty() ? nullptr : &plan->back();
+    // Since a given LogEntryBatchPB may contain multiple REPLICATE messages,
+    // it's likely that this index entry points to the same batch as the
+    // previous one. Otherwise, a later batch of the same segment that isn't
+    // too far off can be read along with the range's others.
+    if (range != nullptr &&
+        index_entry.segment_sequence_number == range->segment_sequence_number &&
+        index_entry.offset_in_segment >= range->batch_offsets.back() &&
+        index_entry.offset_in_segment - range->batch_offsets.front() <= max_range_bytes) {
+      if (index_entry.offset_in_segment != range->batch_offsets.back()) {
+        planned_bytes += index_entry.offset_in_segment - range->batch_offsets.back();
+        range->batch_offsets.push_back(index_entry.offset_in_segment);
+      }
+      range->entries.push_back(index_entry);
+    } else {
+      // The ReplicateMsgs planned so far take up about as many bytes as their
+      // batches, if not more, so reading further would likely exceed the limit.
+      if (max_bytes_to_read > 0 && planned_bytes >= max_bytes_to_read) {
+        break;
+      }
+      plan->emplace_back();
+      range = &plan->back();
+      range->segment_sequence_number = index_entry.segment_sequence_number;
+      range->batch_offsets.push_back(index_entry.offset_in_segment);
+      range->entries.push_back(index_entry);
+    }
+  }
+  return Status::OK();
+}
 
+Status LogReader::ReadBatchesInRange(const LogReadRange& range,
+                                     faststring* tmp_buf,
+                                     vector<LogEntryBatchPB*>* batches) const {
   scoped_refptr<ReadableLogSegment> segment = GetSegmentBySequenceNumber(
-    index_entry.segment_sequence_number);
+    range.segment_sequence_number);
   if (PREDICT_FALSE(!segment)) {
     return Status::NotFound(Substitute("Segment $0 which contained index $1 has been GCed",
-                                       index_entry.segment_sequence_number,
-                                       index));
+                                       range.segment_sequence_number,
+                                       range.entries.front().op_id.index()));
   }
 
-  CHECK_GT(index_entry.offset_in_segment, 0);
-  int64_t offset = index_entry.offset_in_segment;
+  CHECK_GT(range.batch_offsets.front(), 0);
   ScopedLatencyMetric scoped(read_batch_latency_.get());
-  RETURN_NOT_OK_PREPEND(segment->ReadEntryHeaderAndBatch(&offset, tmp_buf, batch),
-                        Substitute("Failed to read LogEntry for index $0 from log segment "
-                                   "$1 offset $2",
-                                   index,
-                                   index_entry.segment_sequence_number,
-                                   index_entry.offset_in_segment));
+  int num_batches_before = batches->size();
+  RETURN_NOT_OK_PREPEND(segment->ReadEntryBatches(range.batch_offsets, tmp_buf, batches),
+                        Substitute("Failed to read LogEntries for indexes $0 to $1 from log "
+                                   "segment $2 offsets $3 to $4",
+                                   range.entries.front().op_id.index(),
+                                   range.entries.back().op_id.index(),
+                                   range.segment_sequence_number,
+                                   range.batch_offsets.front(),
+                                   range.batch_offsets.back()));
 
   if (bytes_read_) {
-    bytes_read_->IncrementBy(kEntryHeaderSize + tmp_buf->length());
-    entries_read_->IncrementBy((**batch).entry_size());
+    bytes_read_->IncrementBy(tmp_buf->length());
+    for (int i = num_batches_before; i < batches->size(); i++) {
+      entries_read_->IncrementBy((*batches)[i]->entry_size());
+    }
   }
 
   return Status::OK();
@@ -261,73 +323,77 @@ Status LogReader::ReadReplicatesInRange(int64_t starting_at,
                                         int64_t up_to,
                                         int64_t max_bytes_to_read,
                                         vector<ReplicateMsg*>* replicates) const {
-  DCHECK_GT(starting_at, 0);
-  DCHECK_GE(up_to, starting_at);
-  DCHECK(log_index_) << "Require an index to random-read logs";
+  vector<LogReadRange> plan;
+  RETURN_NOT_OK(PlanReadsInRange(starting_at, up_to, max_bytes_to_read, &plan));
 
   vector<ReplicateMsg*> replicates_tmp;
   ElementDeleter d(&replicates_tmp);
-  LogIndexEntry prev_index_entry;
 
   int64_t total_size = 0;
   bool limit_exceeded = false;
   faststring tmp_buf;
-  gscoped_ptr<LogEntryBatchPB> batch;
-  for (int index = starting_at; index <= up_to && !limit_exceeded; index++) {
-    LogIndexEntry index_entry;
-    RETURN_NOT_OK_PREPEND(log_index_->GetEntry(index, &index_entry),
-                          Substitute("Failed to read log index for op $0", index));
+  for (const LogReadRange& range : plan) {
+    if (limit_exceeded) {
+      break;
+    }
+    vector<LogEntryBatchPB*> batches;
+    ElementDeleter batches_deleter(&batches);
+    RETURN_NOT_OK(ReadBatchesInRange(range, &tmp_buf, &batches));
+    DCHECK_EQ(batches.size(), range.batch_offsets.size());
 
-    // Since a given LogEntryBatchPB may contain multiple REPLICATE messages,
-    // it's likely that this index entry points to the same batch as the previous
-    // one. If that's the case, we've already read this REPLICATE and we can
-    // skip reading the batch again.
-    if (index == starting_at ||
-        index_entry.segment_sequence_number != prev_index_entry.segment_sequence_number ||
-        index_entry.offset_in_segment != prev_index_entry.offset_in_segment) {
-      RETURN_NOT_OK(ReadBatchUsingIndexEntry(index_entry, &tmp_buf, &batch));
-
-      // Sanity-check the property that a batch should only have increasing indexes.
+    // Sanity-check the property that a batch should only have increasing indexes.
+    for (int b = 0; b < batches.size(); b++) {
       int64_t prev_index = 0;
-      for (int i = 0; i < batch->entry_size(); ++i) {
-        LogEntryPB* entry = batch->mutable_entry(i);
-        if (!entry->has_replicate()) continue;
-        int64_t this_index = entry->replicate().id().index();
+      for (int i = 0; i < batches[b]->entry_size(); ++i) {
+        const LogEntryPB& entry = batches[b]->entry(i);
+        if (!entry.has_replicate()) continue;
+        int64_t this_index = entry.replicate().id().index();
         CHECK_GT(this_index, prev_index)
           << "Expected that an entry batch should only include increasing log indexes: "
-          << index_entry.ToString()
-          << "\nBatch: " << batch->DebugString();
+          << "segment " << range.segment_sequence_number
+          << " offset " << range.batch_offsets[b]
+          << "\nBatch: " << batches[b]->DebugString();
         prev_index = this_index;
       }
     }
 
-    bool found = false;
-    for (int i = 0; i < batch->entry_size(); ++i) {
-      LogEntryPB* entry = batch->mutable_entry(i);
-      if (!entry->has_replicate()) {
-        continue;
+    int b = 0;
+    for (const LogIndexEntry& index_entry : range.entries) {
+      while (range.batch_offsets[b] != index_entry.offset_in_segment) {
+        b++;
       }
+      LogEntryBatchPB* batch = batches[b];
+      const int64_t index = index_entry.op_id.index();
 
-      if (entry->replicate().id().index() != index) {
-        continue;
+      bool found = false;
+      for (int i = 0; i < batch->entry_size(); ++i) {
+        LogEntryPB* entry = batch->mutable_entry(i);
+        if (!entry->has_replicate()) {
+          continue;
+        }
+
+        if (entry->replicate().id().index() != index) {
+          continue;
+        }
+
+        int64_t space_required = entry->replicate().SpaceUsed();
+        if (replicates_tmp.empty() ||
+            max_bytes_to_read <= 0 ||
+            total_size + space_required < max_bytes_to_read) {
+          total_size += space_required;
+          replicates_tmp.push_back(entry->release_replicate());
+        } else {
+          limit_exceeded = true;
+        }
+        found = true;
+        break;
       }
-
-      int64_t space_required = entry->replicate().SpaceUsed();
-      if (replicates_tmp.empty() ||
-          max_bytes_to_read <= 0 ||
-          total_size + space_required < max_bytes_to_read) {
-        total_size += space_required;
-        replicates_tmp.push_back(entry->release_replicate());
-      } else {
-        limit_exceeded = true;
+      CHECK(found) << "Incorrect index entry didn't yield expected log entry: "
+                   << index_entry.ToString();
+      if (limit_exceeded) {
+        break;
       }
-      found = true;
-      break;
     }
-    CHECK(found) << "Incorrect index entry didn't yield expected log entry: "
-                 << index_entry.ToString();
-
-    prev_index_entry = index_entry;
   }
 
   replicates->swap(replicates_tmp);
@@ -24,6 +24,7 @@
 #include <utility>
 #include <vector>
 
+#include "kudu/consensus/log_index.h"
 #include "kudu/consensus/log_metrics.h"
 #include "kudu/consensus/log_util.h"
 #include "kudu/consensus/opid_util.h"
@@ -36,8 +37,21 @@
 namespace kudu {
 namespace log {
 class Log;
-class LogIndex;
-struct LogIndexEntry;
+
+// A part of a plan for reading a range of operations from the log: the
+// operations whose batches lie close together in one segment, so that they
+// can be read with a single sequential read. See LogReader::PlanReadsInRange().
+struct LogReadRange {
+  int64_t segment_sequence_number;
+
+  // The index entries of the operations, in index order. Consecutive
+  // operations may share a batch.
+  std::vector<LogIndexEntry> entries;
+
+  // The distinct offsets of the batches holding the operations, in
+  // increasing order.
+  std::vector<int64_t> batch_offsets;
+};
 
 // Reads a set of segments from a given path. Segment headers and footers
 // are read and parsed, but entries are not.
@@ -91,6 +105,19 @@ class LogReader {
       std::vector<consensus::ReplicateMsg*>* replicates) const;
   static const int kNoSizeLimit;
 
+  // Plans the reads of the ReplicateMsgs from 'starting_at' to 'up_to', both
+  // inclusive, into 'plan': runs of operations in index order, each to be read
+  // with one sequential read of a segment that spans no more than
+  // --log_max_coalesced_read_bytes, nor 'max_bytes_to_read' unless it is
+  // kNoSizeLimit. Planning stops early once it has covered 'max_bytes_to_read'
+  // of the log, as reading more would exceed it anyway.
+  //
+  // Requires that a LogIndex was passed into LogReader::Open().
+  Status PlanReadsInRange(int64_t starting_at,
+                          int64_t up_to,
+                          int64_t max_bytes_to_read,
+                          std::vector<LogReadRange>* plan) const;
+
   // Look up the OpId for the given operation index.
   // Returns a bad Status if the log index fails to load (eg. due to an IO error).
   Status LookupOpId(int64_t op_index, consensus::OpId* op_id) const;
@@ -103,6 +130,7 @@ class LogReader {
  private:
   FRIEND_TEST(LogTest, TestLogReader);
   FRIEND_TEST(LogTest, TestReadLogWithReplacedReplicates);
+  FRIEND_TEST(LogTest, TestReadReplicatesCoalescesReads);
   friend class Log;
   friend class LogTest;
 
@@ -147,11 +175,13 @@ class LogReader {
   // written to.
   void UpdateLastSegmentOffset(int64_t readable_to_offset);
 
-  // Read the LogEntryBatchPB pointed to by the provided index entry.
+  // Read the LogEntryBatchPBs of the operations in 'range', appending them to
+  // 'batches' in the order of 'range.batch_offsets'. The caller takes
+  // ownership of the batches.
   // 'tmp_buf' is used as scratch space to avoid extra allocation.
-  Status ReadBatchUsingIndexEntry(const LogIndexEntry& index_entry,
-                                  faststring* tmp_buf,
-                                  gscoped_ptr<LogEntryBatchPB>* batch) const;
+  Status ReadBatchesInRange(const LogReadRange& range,
+                            faststring* tmp_buf,
+                            std::vector<LogEntryBatchPB*>* batches) const;
 
   LogReader(FsManager* fs_manager, const scoped_refptr<LogIndex>& index,
             std::string tablet_id,
@@ -58,6 +58,11 @@ DEFINE_bool(log_async_preallocate_segments, true,
             "Whether the WAL segments preallocation should happen asynchronously");
 TAG_FLAG(log_async_preallocate_segments, advanced);
 
+DEFINE_int32(log_min_compression_size_bytes, 256,
+             "Entry batches smaller than this are written uncompressed to WAL "
+             "segments which have a compression codec.");
+TAG_FLAG(log_min_compression_size_bytes, advanced);
+
 namespace kudu {
 namespace log {
 
@@ -86,6 +91,10 @@ const size_t kLogSegmentFooterMagicAndFooterLength  = 12;
 
 const size_t kEntryHeaderSize = 12;
 
+// In compressed segments, set in the uncompressed length which prefixes a
+// batch if the batch was stored without compression.
+const uint32_t kUncompressedBatchFlag = 1U << 31;
+
 const int kLogMajorVersion = 1;
 const int kLogMinorVersion = 0;
 
@@ -624,6 +633,87 @@ Status ReadableLogSegment::ReadEntryHeaderAndBatch(int64_t* offset, faststring*
 }
 
 
+Status ReadableLogSegment::ReadEntryBatches(const vector<int64_t>& batch_offsets,
+                                            faststring* tmp_buf,
+                                            vector<LogEntryBatchPB*>* batches) {
+  DCHECK(!batch_offsets.empty());
+  const int64_t start = batch_offsets.front();
+  const int64_t limit = readable_up_to();
+  // Read up to and including the last batch's header; its length tells how
+  // much more there is to read.
+  int64_t end = batch_offsets.back() + kEntryHeaderSize;
+  if (PREDICT_FALSE(end > limit)) {
+    return Status::Corruption(
+        Substitute("Could not read log entry header at offset $0 in $1: "
+                   "log only readable up to offset $2",
+                   batch_offsets.back(), path_, limit));
+  }
+
+  tmp_buf->clear();
+  tmp_buf->resize(end - start);
+  Slice data;
+  RETURN_NOT_OK_PREPEND(ReadFully(readable_file().get(), start, end - start,
+                                  &data, tmp_buf->data()),
+                        Substitute("Could not read log entries at offset $0", start));
+  if (data.data() != tmp_buf->data()) {
+    data.relocate(tmp_buf->data());
+  }
+
+  int64_t pos = start;
+  for (int64_t batch_offset : batch_offsets) {
+    EntryHeader header;
+    while (true) {
+      if (PREDICT_FALSE(pos > batch_offset)) {
+        return Status::Corruption(Substitute("Log entry before offset $0 in $1 overruns it",
+                                             batch_offset, path_));
+      }
+      if (PREDICT_FALSE(!DecodeEntryHeader(Slice(tmp_buf->data() + (pos - start),
+                                                 kEntryHeaderSize),
+                                           &header))) {
+        return Status::Corruption(Substitute("CRC mismatch in log entry header at offset $0",
+                                             pos));
+      }
+      if (pos == batch_offset) {
+        break;
+      }
+      pos += kEntryHeaderSize + header.msg_length;
+    }
+
+    if (PREDICT_FALSE(header.msg_length == 0)) {
+      return Status::Corruption("Invalid 0 entry length");
+    }
+    const int64_t batch_start = pos + kEntryHeaderSize;
+    const int64_t batch_end = batch_start + header.msg_length;
+    if (PREDICT_FALSE(batch_end > limit)) {
+      // The log was likely truncated during writing.
+      return Status::Corruption(
+          Substitute("Could not read $0-byte log entry from offset $1 in $2: "
+                     "log only readable up to offset $3",
+                     header.msg_length, batch_start, path_, limit));
+    }
+    if (batch_end > end) {
+      // Only the last batch should extend past what was read so far.
+      tmp_buf->resize(batch_end - start);
+      uint8_t* dst = tmp_buf->data() + (end - start);
+      RETURN_NOT_OK_PREPEND(ReadFully(readable_file().get(), end, batch_end - end, &data, dst),
+                            Substitute("Could not read log entry at offset $0", batch_start));
+      if (data.data() != dst) {
+        data.relocate(dst);
+      }
+      end = batch_end;
+    }
+
+    gscoped_ptr<LogEntryBatchPB> batch;
+    RETURN_NOT_OK(DecodeEntryBatch(batch_start, header,
+                                   Slice(tmp_buf->data() + (batch_start - start),
+                                         header.msg_length),
+                                   &batch));
+    batches->push_back(batch.release());
+    pos = batch_end;
+  }
+  return Status::OK();
+}
+
 Status ReadableLogSegment::ReadEntryHeader(int64_t *offset, EntryHeader* header) {
   uint8_t scratch[kEntryHeaderSize];
   Slice slice;
@@ -683,25 +773,61 @@ Status ReadableLogSegment::ReadEntryBatch(int64_t *offset,
   if (!s.ok()) return Status::IOError(Substitute("Could not read entry. Cause: $0",
                                                  s.ToString()));
 
+  RETURN_NOT_OK(DecodeEntryBatch(*offset, header, entry_batch_slice, entry_batch));
+  *offset += entry_batch_slice.size();
+  return Status::OK();
+}
+
+Status ReadableLogSegment::DecodeEntryBatch(int64_t offset,
+                                            const EntryHeader& header,
+                                            const Slice& entry_batch_slice,
+                                            gscoped_ptr<LogEntryBatchPB>* entry_batch) {
+  DCHECK_EQ(header.msg_length, entry_batch_slice.size());
+
   // Verify the CRC.
   uint32_t read_crc = crc::Crc32c(entry_batch_slice.data(), entry_batch_slice.size());
   if (PREDICT_FALSE(read_crc != header.msg_crc)) {
     return Status::Corruption(Substitute("Entry CRC mismatch in byte range $0-$1: "
                                          "expected CRC=$2, computed=$3",
-                                         *offset, *offset + header.msg_length,
+                                         offset, offset + header.msg_length,
                                          header.msg_crc, read_crc));
   }
 
 
+  // Uncompress the batch if the segment is compressed.
+  Slice batch_data = entry_batch_slice;
+  faststring uncompressed_buf;
+  if (header_.has_compression_codec() && header_.compression_codec() != NO_COMPRESSION) {
+    const cfile::CompressionCodec* codec;
+    RETURN_NOT_OK(cfile::GetCompressionCodec(header_.compression_codec(), &codec));
+    if (PREDICT_FALSE(entry_batch_slice.size() < sizeof(uint32_t))) {
+      return Status::Corruption(Substitute("Compressed entry at offset $0 too short", offset));
+    }
+    uint32_t uncompressed_len = DecodeFixed32(entry_batch_slice.data());
+    Slice stored(entry_batch_slice.data() + sizeof(uint32_t),
+                 entry_batch_slice.size() - sizeof(uint32_t));
+    if (uncompressed_len & kUncompressedBatchFlag) {
+      if (PREDICT_FALSE((uncompressed_len & ~kUncompressedBatchFlag) != stored.size())) {
+        return Status::Corruption(Substitute("Bad length of uncompressed entry at offset $0",
+                                             offset));
+      }
+      batch_data = stored;
+    } else {
+      uncompressed_buf.resize(uncompressed_len);
+      RETURN_NOT_OK_PREPEND(codec->Uncompress(stored, uncompressed_buf.data(), uncompressed_len),
+                            Substitute("Could not uncompress entry at offset $0", offset));
+      batch_data = Slice(uncompressed_buf);
+    }
+  }
+
   gscoped_ptr<LogEntryBatchPB> read_entry_batch(new LogEntryBatchPB());
-  s = pb_util::ParseFromArray(read_entry_batch.get(),
-                              entry_batch_slice.data(),
-                              header.msg_length);
+  Status s = pb_util::ParseFromArray(read_entry_batch.get(),
+                                     batch_data.data(),
+                                     batch_data.size());
 
   if (!s.ok()) return Status::Corruption(Substitute("Could parse PB. Cause: $0",
                                                     s.ToString()));
 
-  *offset += entry_batch_slice.size();
   entry_batch->reset(read_entry_batch.release());
   return Status::OK();
 }
@@ -712,12 +838,17 @@ WritableLogSegment::WritableLogSegment(string path,
       writable_file_(std::move(writable_file)),
       is_header_written_(false),
       is_footer_written_(false),
+      codec_(nullptr),
       written_offset_(0) {}
 
 Status WritableLogSegment::WriteHeaderAndOpen(const LogSegmentHeaderPB& new_header) {
   DCHECK(!IsHeaderWritten()) << "Can only call WriteHeader() once";
   DCHECK(new_header.IsInitialized())
       << "Log segment header must be initialized" << new_header.InitializationErrorString();
+  if (new_header.has_compression_codec()) {
+    RETURN_NOT_OK(cfile::GetCompressionCodec(new_header.compression_codec(), &codec_));
+  }
+
   faststring buf;
 
   // First the magic.
@@ -766,17 +897,44 @@ Status WritableLogSegment::WriteFooterAndClose(const LogSegmentFooterPB& footer)
   return Status::OK();
 }
 
-Status WritableLogSegment::WriteEntryBatch(const Slice& data) {
+Status WritableLogSegment::WriteEntryBatch(const Slice& batch_data, uint32_t batch_crc) {
   DCHECK(is_header_written_);
   DCHECK(!is_footer_written_);
   uint8_t header_buf[kEntryHeaderSize];
 
+  Slice data = batch_data;
+  uint32_t msg_crc = batch_crc;
+  if (codec_ != nullptr) {
+    DCHECK_LT(batch_data.size(), kUncompressedBatchFlag);
+    size_t compressed_len = batch_data.size();
+    if (batch_data.size() >= static_cast<size_t>(FLAGS_log_min_compression_size_bytes)) {
+      compress_buf_.resize(sizeof(uint32_t) + codec_->MaxCompressedLength(batch_data.size()));
+      RETURN_NOT_OK_PREPEND(codec_->Compress(batch_data,
+                                             compress_buf_.data() + sizeof(uint32_t),
+                                             &compressed_len),
+                            "Could not compress log entry batch");
+    }
+    if (compressed_len < batch_data.size()) {
+      InlineEncodeFixed32(compress_buf_.data(), batch_data.size());
+      msg_crc = crc::Crc32c(compress_buf_.data(), sizeof(uint32_t) + compressed_len);
+    } else {
+      // Compressing didn't pay for itself: store the batch as it is.
+      compressed_len = batch_data.size();
+      compress_buf_.resize(sizeof(uint32_t) + compressed_len);
+      InlineEncodeFixed32(compress_buf_.data(), batch_data.size() | kUncompressedBatchFlag);
+      msg_crc = crc::Crc32cCopy(crc::Crc32c(compress_buf_.data(), sizeof(uint32_t)),
+                                compress_buf_.data() + sizeof(uint32_t),
+                                batch_data.data(), compressed_len);
+    }
+    data = Slice(compress_buf_.data(), sizeof(uint32_t) + compressed_len);
+  }
+
   // First encode the length of the message.
   uint32_t len = data.size();
   InlineEncodeFixed32(&header_buf[0], len);
 
   // Then the CRC of the message.
-  uint32_t msg_crc = crc::Crc32c(&data[0], data.size());
+  DCHECK_EQ(crc::Crc32c(data.data(), data.size()), msg_crc);
   InlineEncodeFixed32(&header_buf[4], msg_crc);
 
   // Then the CRC of the header
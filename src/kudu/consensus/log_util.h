@@ -27,6 +27,7 @@
 #include <utility>
 #include <vector>
 
+#include "kudu/cfile/compression_codec.h"
 #include "kudu/consensus/log.pb.h"
 #include "kudu/consensus/ref_counted_replicate.h"
 #include "kudu/gutil/macros.h"
@@ -293,6 +294,16 @@ class ReadableLogSegment : public RefCountedThreadSafe<ReadableLogSegment> {
   Status ReadEntryHeaderAndBatch(int64_t* offset, faststring* tmp_buf,
                                  gscoped_ptr<LogEntryBatchPB>* batch);
 
+  // Read the entry batches which begin at each of 'batch_offsets', which
+  // must be in increasing order, appending them to 'batches' in the same
+  // order. The bytes from the first batch to the last are read at once, and
+  // any batches in between them, e.g. of COMMIT messages, are skipped; so
+  // this issues at most two reads however many batches there are.
+  // 'tmp_buf' is used as scratch space, and holds the bytes read on return.
+  Status ReadEntryBatches(const std::vector<int64_t>& batch_offsets,
+                          faststring* tmp_buf,
+                          std::vector<LogEntryBatchPB*>* batches);
+
   // Reads a log entry header from the segment.
   // Also increments the passed offset* by the length of the entry.
   Status ReadEntryHeader(int64_t *offset, EntryHeader* header);
@@ -312,6 +323,13 @@ class ReadableLogSegment : public RefCountedThreadSafe<ReadableLogSegment> {
                         faststring* tmp_buf,
                         gscoped_ptr<LogEntryBatchPB>* entry_batch);
 
+  // Verify and decode the log entry batch described by 'header' from
+  // 'entry_batch_slice', which was read from 'offset' in the segment.
+  Status DecodeEntryBatch(int64_t offset,
+                          const EntryHeader& header,
+                          const Slice& entry_batch_slice,
+                          gscoped_ptr<LogEntryBatchPB>* entry_batch);
+
   void UpdateReadableToOffset(int64_t readable_to_offset);
 
   const std::string path_;
@@ -370,9 +388,13 @@ class WritableLogSegment {
   }
 
   // Appends the provided batch of data, including a header
-  // and checksum.
+  // and checksum. The data is compressed first if the segment header
+  // names a compression codec, unless it is smaller than
+  // --log_min_compression_size_bytes or doesn't shrink.
+  // 'data_crc' must be the CRC32C of 'data', which callers compute while
+  // serializing it, so that it needn't be read again just to checksum it.
   // Makes sure that the log segment has not been closed.
-  Status WriteEntryBatch(const Slice& data);
+  Status WriteEntryBatch(const Slice& data, uint32_t data_crc);
 
   // Makes sure the I/O buffers in the underlying writable file are flushed.
   Status Sync() {
@@ -431,6 +453,12 @@ class WritableLogSegment {
 
   LogSegmentFooterPB footer_;
 
+  // The codec entry batches are compressed with, or NULL.
+  const cfile::CompressionCodec* codec_;
+
+  // Scratch space for compressed entry batches.
+  faststring compress_buf_;
+
   // the offset of the first entry in the log
   int64_t first_entry_offset_;
 
@@ -32,6 +32,7 @@
 DEFINE_int32(num_writer_threads, 4, "Number of threads writing to the log");
 DEFINE_int32(num_batches_per_thread, 2000, "Number of batches per thread");
 DEFINE_int32(num_ops_per_batch_avg, 5, "Target average number of ops per batch");
+DECLARE_bool(log_adaptive_group_commit);
 
 namespace kudu {
 namespace log {
@@ -170,5 +171,29 @@ TEST_F(MultiThreadedLogTest, TestAppends) {
   ASSERT_TRUE(std::is_sorted(ids.begin(), ids.end()));
 }
 
+// Tests that appends with adaptive group commit enabled are all written, in
+// order.
+TEST_F(MultiThreadedLogTest, TestAppendsWithAdaptiveGroupCommit) {
+  FLAGS_log_adaptive_group_commit = true;
+  FLAGS_num_batches_per_thread = std::min(FLAGS_num_batches_per_thread, 200);
+  options_.force_fsync_all = true;
+  ASSERT_OK(BuildLog());
+  int start_current_id = current_index_;
+  ASSERT_NO_FATAL_FAILURE(Run());
+  ASSERT_OK(log_->Close());
+
+  shared_ptr<LogReader> reader;
+  ASSERT_OK(LogReader::Open(fs_manager_.get(), nullptr, kTestTablet, nullptr, &reader));
+  SegmentSequence segments;
+  ASSERT_OK(reader->GetSegmentsSnapshot(&segments));
+  for (const SegmentSequence::value_type& entry : segments) {
+    ASSERT_OK(entry->ReadEntries(&entries_));
+  }
+  vector<uint32_t> ids;
+  EntriesToIdList(&ids);
+  ASSERT_EQ(current_index_ - start_current_id, ids.size());
+  ASSERT_TRUE(std::is_sorted(ids.begin(), ids.end()));
+}
+
 } // namespace log
 } // namespace kudu
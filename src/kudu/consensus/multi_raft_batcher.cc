@@ -0,0 +1,194 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/consensus/multi_raft_batcher.h"
+
+#include <boost/bind.hpp>
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <mutex>
+#include <utility>
+
+#include "kudu/common/wire_protocol.h"
+#include "kudu/consensus/consensus.proxy.h"
+#include "kudu/gutil/map-util.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/rpc/messenger.h"
+#include "kudu/util/flag_tags.h"
+#include "kudu/util/monotime.h"
+#include "kudu/util/net/net_util.h"
+#include "kudu/util/net/sockaddr.h"
+
+DEFINE_int32(multi_raft_heartbeat_window_ms, 10,
+             "How long heartbeats to a server wait for the heartbeats of other "
+             "tablets to the same server, so that they can be sent together, "
+             "when --enable_multi_raft_heartbeat_batching is set.");
+TAG_FLAG(multi_raft_heartbeat_window_ms, experimental);
+
+DEFINE_int32(multi_raft_heartbeat_batch_size, 1000,
+             "Maximum number of tablets' heartbeats sent to a server in one RPC "
+             "when --enable_multi_raft_heartbeat_batching is set.");
+TAG_FLAG(multi_raft_heartbeat_batch_size, experimental);
+
+DECLARE_int32(consensus_rpc_timeout_ms);
+
+namespace kudu {
+namespace consensus {
+
+using std::shared_ptr;
+using std::string;
+using std::vector;
+using strings::Substitute;
+
+MultiRaftHeartbeatBatcher::MultiRaftHeartbeatBatcher(shared_ptr<rpc::Messenger> messenger)
+    : messenger_(std::move(messenger)) {
+}
+
+MultiRaftHeartbeatBatcher::~MultiRaftHeartbeatBatcher() {
+}
+
+void MultiRaftHeartbeatBatcher::AddHeartbeat(const HostPort& hostport,
+                                             const ConsensusRequestPB* request,
+                                             ConsensusResponsePB* response,
+                                             const StatusCallback& callback) {
+  DCHECK_EQ(0, request->ops_size());
+  string key = Substitute("$0/$1", hostport.ToString(), request->dest_uuid());
+
+  // Resolving the address may block, so create the proxy for a destination
+  // we haven't seen before outside of the lock.
+  gscoped_ptr<ConsensusServiceProxy> new_proxy;
+  bool known;
+  {
+    std::lock_guard<simple_spinlock> l(lock_);
+    known = ContainsKey(destinations_, key);
+  }
+  if (!known) {
+    vector<Sockaddr> addrs;
+    Status s = hostport.ResolveAddresses(&addrs);
+    if (PREDICT_FALSE(!s.ok())) {
+      callback.Run(s);
+      return;
+    }
+    new_proxy.reset(new ConsensusServiceProxy(messenger_, addrs[0]));
+  }
+
+  vector<Heartbeat> to_send;
+  ConsensusServiceProxy* proxy;
+  {
+    std::lock_guard<simple_spinlock> l(lock_);
+    std::unique_ptr<Destination>& dest = destinations_[key];
+    if (!dest) {
+      dest.reset(new Destination);
+      dest->proxy.reset(new_proxy.release());
+      dest->flush_scheduled = false;
+    }
+    dest->pending.push_back({ request, response, callback });
+    proxy = dest->proxy.get();
+
+    if (static_cast<int>(dest->pending.size()) >= FLAGS_multi_raft_heartbeat_batch_size) {
+      // The batch is full: send it now. A flush that is already scheduled
+      // will pick up whatever is queued after this.
+      to_send.swap(dest->pending);
+    } else if (!dest->flush_scheduled) {
+      dest->flush_scheduled = true;
+      messenger_->ScheduleOnReactor(
+          boost::bind(&MultiRaftHeartbeatBatcher::FlushDestination, this, key, _1),
+          MonoDelta::FromMilliseconds(FLAGS_multi_raft_heartbeat_window_ms));
+    }
+  }
+  if (!to_send.empty()) {
+    SendBatch(proxy, std::move(to_send));
+  }
+}
+
+void MultiRaftHeartbeatBatcher::FlushDestination(const string& key, const Status& status) {
+  vector<Heartbeat> to_send;
+  ConsensusServiceProxy* proxy;
+  {
+    std::lock_guard<simple_spinlock> l(lock_);
+    Destination* dest = FindOrDie(destinations_, key).get();
+    dest->flush_scheduled = false;
+    to_send.swap(dest->pending);
+    proxy = dest->proxy.get();
+  }
+  if (to_send.empty()) {
+    return;
+  }
+  if (PREDICT_FALSE(!status.ok())) {
+    AbortHeartbeats(to_send, status);
+    return;
+  }
+  SendBatch(proxy, std::move(to_send));
+}
+
+void MultiRaftHeartbeatBatcher::SendBatch(ConsensusServiceProxy* proxy,
+                                          vector<Heartbeat> heartbeats) {
+  gscoped_ptr<Batch> batch(new Batch);
+  batch->request.set_dest_uuid(heartbeats[0].request->dest_uuid());
+  for (const Heartbeat& hb : heartbeats) {
+    batch->request.add_requests()->CopyFrom(*hb.request);
+  }
+  batch->heartbeats = std::move(heartbeats);
+  batch->controller.set_timeout(MonoDelta::FromMilliseconds(FLAGS_consensus_rpc_timeout_ms));
+
+  Batch* raw_batch = batch.release();
+  proxy->MultiRaftUpdateConsensusAsync(
+      raw_batch->request, &raw_batch->response, &raw_batch->controller,
+      boost::bind(&MultiRaftHeartbeatBatcher::BatchFinished, this, raw_batch));
+}
+
+void MultiRaftHeartbeatBatcher::BatchFinished(Batch* raw_batch) {
+  gscoped_ptr<Batch> batch(raw_batch);
+  const Status& s = batch->controller.status();
+  if (!s.ok()) {
+    AbortHeartbeats(batch->heartbeats, s);
+    return;
+  }
+
+  MultiRaftConsensusResponsePB* resp = &batch->response;
+  if (resp->has_error()) {
+    // The server rejected the whole batch, but it did respond. Give each
+    // heartbeat the error, as if it had been sent on its own.
+    for (const Heartbeat& hb : batch->heartbeats) {
+      hb.response->Clear();
+      hb.response->mutable_error()->CopyFrom(resp->error());
+      hb.callback.Run(Status::OK());
+    }
+    return;
+  }
+  if (PREDICT_FALSE(resp->responses_size() != static_cast<int>(batch->heartbeats.size()))) {
+    AbortHeartbeats(batch->heartbeats, Status::Corruption(
+        Substitute("Got $0 responses to a batch of $1 heartbeats",
+                   resp->responses_size(), batch->heartbeats.size())));
+    return;
+  }
+  for (int i = 0; i < resp->responses_size(); i++) {
+    const Heartbeat& hb = batch->heartbeats[i];
+    hb.response->Swap(resp->mutable_responses(i));
+    hb.callback.Run(Status::OK());
+  }
+}
+
+void MultiRaftHeartbeatBatcher::AbortHeartbeats(const vector<Heartbeat>& heartbeats,
+                                                const Status& status) {
+  for (const Heartbeat& hb : heartbeats) {
+    hb.callback.Run(status);
+  }
+}
+
+}  // namespace consensus
+}  // namespace kudu
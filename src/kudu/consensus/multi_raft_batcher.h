@@ -0,0 +1,120 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#ifndef KUDU_CONSENSUS_MULTI_RAFT_BATCHER_H_
+#define KUDU_CONSENSUS_MULTI_RAFT_BATCHER_H_
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "kudu/consensus/consensus.pb.h"
+#include "kudu/gutil/gscoped_ptr.h"
+#include "kudu/gutil/macros.h"
+#include "kudu/rpc/rpc_controller.h"
+#include "kudu/util/locks.h"
+#include "kudu/util/status.h"
+#include "kudu/util/status_callback.h"
+
+namespace kudu {
+class HostPort;
+
+namespace rpc {
+class Messenger;
+}
+
+namespace consensus {
+class ConsensusServiceProxy;
+
+// Batches the heartbeats that the leaders on this server send to remote
+// followers, so that idle tablets hosted on the same pair of servers share
+// a single MultiRaftUpdateConsensus RPC per batching window instead of
+// each sending its own UpdateConsensus RPC.
+//
+// One instance is shared by all the tablets on the server. This class is
+// thread-safe.
+class MultiRaftHeartbeatBatcher {
+ public:
+  explicit MultiRaftHeartbeatBatcher(std::shared_ptr<rpc::Messenger> messenger);
+  ~MultiRaftHeartbeatBatcher();
+
+  // Queues the status-only 'request' for the server at 'hostport'. It is
+  // sent with the other heartbeats queued for that server within
+  // --multi_raft_heartbeat_window_ms, or sooner if the batch is full.
+  //
+  // 'request' and 'response' must remain valid until 'callback' is called
+  // with the outcome of the RPC which carried them. If that RPC succeeded,
+  // 'response' holds the peer's response to 'request'.
+  void AddHeartbeat(const HostPort& hostport,
+                    const ConsensusRequestPB* request,
+                    ConsensusResponsePB* response,
+                    const StatusCallback& callback);
+
+ private:
+  struct Heartbeat {
+    const ConsensusRequestPB* request;
+    ConsensusResponsePB* response;
+    StatusCallback callback;
+  };
+
+  // The heartbeats queued for one remote server.
+  struct Destination {
+    gscoped_ptr<ConsensusServiceProxy> proxy;
+    std::vector<Heartbeat> pending;
+    bool flush_scheduled;
+  };
+
+  // A MultiRaftUpdateConsensus RPC in flight.
+  struct Batch {
+    MultiRaftConsensusRequestPB request;
+    MultiRaftConsensusResponsePB response;
+    rpc::RpcController controller;
+    std::vector<Heartbeat> heartbeats;
+  };
+
+  // Sends the heartbeats queued for the destination with key 'key'. Runs on
+  // a reactor thread once the batching window has elapsed; if 'status' is
+  // not OK the window was aborted, and so are the heartbeats.
+  void FlushDestination(const std::string& key, const Status& status);
+
+  // Sends 'heartbeats' to the server behind 'proxy' in a single RPC.
+  void SendBatch(ConsensusServiceProxy* proxy, std::vector<Heartbeat> heartbeats);
+
+  // Hands the responses in 'batch' back to its heartbeats. Takes ownership
+  // of 'batch'.
+  void BatchFinished(Batch* batch);
+
+  // Calls the callbacks of 'heartbeats' with the error 'status'.
+  static void AbortHeartbeats(const std::vector<Heartbeat>& heartbeats, const Status& status);
+
+  std::shared_ptr<rpc::Messenger> messenger_;
+
+  // Protects 'destinations_' and the Destinations in it.
+  simple_spinlock lock_;
+
+  // Keyed by the server's address and UUID. Entries are never removed, so
+  // the proxies can be used without holding 'lock_'.
+  std::unordered_map<std::string, std::unique_ptr<Destination>> destinations_;
+
+  DISALLOW_COPY_AND_ASSIGN(MultiRaftHeartbeatBatcher);
+};
+
+}  // namespace consensus
+}  // namespace kudu
+
+#endif /* KUDU_CONSENSUS_MULTI_RAFT_BATCHER_H_ */
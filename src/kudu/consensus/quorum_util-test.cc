@@ -57,6 +57,30 @@ TEST(QuorumUtilTest, TestMemberExtraction) {
   ASSERT_EQ("B", peer_pb.permanent_uuid());
 }
 
+TEST(QuorumUtilTest, TestVerifyConfigWithNonVoters) {
+  RaftConfigPB config;
+  SetPeerInfo("A", RaftPeerPB::VOTER, config.add_peers());
+  SetPeerInfo("B", RaftPeerPB::NON_VOTER, config.add_peers());
+  ASSERT_OK(VerifyRaftConfig(config, UNCOMMITTED_QUORUM));
+  ASSERT_EQ(1, CountVoters(config));
+
+  ConsensusStatePB cstate;
+  cstate.set_current_term(1);
+  *cstate.mutable_config() = config;
+  ASSERT_EQ(RaftPeerPB::FOLLOWER, GetConsensusRole("A", cstate));
+  ASSERT_EQ(RaftPeerPB::LEARNER, GetConsensusRole("B", cstate));
+
+  // A non-voter can't lead.
+  cstate.set_leader_uuid("B");
+  ASSERT_TRUE(VerifyConsensusState(cstate, UNCOMMITTED_QUORUM).IsIllegalState());
+
+  // Nor can a config be made of non-voters only.
+  config.mutable_peers(0)->set_member_type(RaftPeerPB::NON_VOTER);
+  Status s = VerifyRaftConfig(config, UNCOMMITTED_QUORUM);
+  ASSERT_TRUE(s.IsIllegalState()) << s.ToString();
+  ASSERT_STR_CONTAINS(s.ToString(), "at least one VOTER");
+}
+
 TEST(QuorumUtilTest, TestDiffConsensusStates) {
   ConsensusStatePB old_cs;
   SetPeerInfo("A", RaftPeerPB::VOTER, old_cs.mutable_config()->add_peers());
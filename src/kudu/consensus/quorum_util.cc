@@ -171,12 +171,14 @@ Status VerifyRaftConfig(const RaftConfigPB& config, RaftConfigState type) {
           Substitute("Peer: $0 has no member type set. RaftConfig: $1", peer.permanent_uuid(),
                      config.ShortDebugString()));
     }
-    if (peer.member_type() == RaftPeerPB::NON_VOTER) {
-      return Status::IllegalState(
-          Substitute(
-              "Peer: $0 is a NON_VOTER, but this isn't supported yet. RaftConfig: $1",
-              peer.permanent_uuid(), config.ShortDebugString()));
-    }
+  }
+
+  // Non-voters only learn of committed operations, so a config needs voters
+  // to make progress.
+  if (CountVoters(config) == 0) {
+    return Status::IllegalState(
+        Substitute("RaftConfig must have at least one VOTER. RaftConfig: $0",
+                   config.ShortDebugString()));
   }
 
   return Status::OK();
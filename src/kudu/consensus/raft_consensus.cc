@@ -18,6 +18,7 @@
 #include "kudu/consensus/raft_consensus.h"
 
 #include <algorithm>
+#include <boost/bind.hpp>
 #include <boost/optional.hpp>
 #include <gflags/gflags.h>
 #include <iostream>
@@ -85,6 +86,13 @@ DEFINE_bool(enable_leader_failure_detection, true,
             "made to elect a follower as a new leader when the leader is detected to have failed.");
 TAG_FLAG(enable_leader_failure_detection, unsafe);
 
+DEFINE_bool(raft_enable_pre_election, true,
+            "When enabled, a replica which detects the failure of its leader first runs a "
+            "pre-election, and only increments its term to run a real election if a majority "
+            "of the voters would vote for it. This keeps replicas which can't be elected from "
+            "disrupting the configuration.");
+TAG_FLAG(raft_enable_pre_election, advanced);
+
 DEFINE_bool(evict_failed_followers, true,
             "Whether to evict followers from the Raft config that have fallen "
             "too far behind the leader's log to catch up normally or have been "
@@ -158,17 +166,21 @@ scoped_refptr<RaftConsensus> RaftConsensus::Create(
     const scoped_refptr<server::Clock>& clock,
     ReplicaTransactionFactory* txn_factory,
     const shared_ptr<rpc::Messenger>& messenger,
+    MultiRaftHeartbeatBatcher* heartbeat_batcher,
+    ThreadPool* raft_pool,
     const scoped_refptr<log::Log>& log,
     const shared_ptr<MemTracker>& parent_mem_tracker,
     const Callback<void(const std::string& reason)>& mark_dirty_clbk) {
-  gscoped_ptr<PeerProxyFactory> rpc_factory(new RpcPeerProxyFactory(messenger));
+  gscoped_ptr<PeerProxyFactory> rpc_factory(new RpcPeerProxyFactory(messenger,
+                                                                    heartbeat_batcher));
 
   // The message queue that keeps track of which operations need to be replicated
   // where.
   gscoped_ptr<PeerMessageQueue> queue(new PeerMessageQueue(metric_entity,
                                                            log,
                                                            local_peer_pb,
-                                                           options.tablet_id));
+                                                           options.tablet_id,
+                                                           raft_pool));
 
   gscoped_ptr<ThreadPool> thread_pool;
   CHECK_OK(ThreadPoolBuilder(Substitute("$0-raft", options.tablet_id.substr(0, 6)))
@@ -243,6 +255,7 @@ RaftConsensus::RaftConsensus(
                                 peer_uuid,
                                 std::move(cmeta),
                                 DCHECK_NOTNULL(txn_factory)));
+  queue_->SetReplicaTransactionFactory(txn_factory);
 }
 
 RaftConsensus::~RaftConsensus() {
@@ -348,6 +361,12 @@ Status RaftConsensus::EmulateElection() {
 }
 
 Status RaftConsensus::StartElection(ElectionMode mode) {
+  // Forced elections are meant to depose a live leader, which voters would
+  // refuse in a pre-election.
+  return DoStartElection(mode, FLAGS_raft_enable_pre_election && mode == NORMAL_ELECTION);
+}
+
+Status RaftConsensus::DoStartElection(ElectionMode mode, bool is_pre_election) {
   TRACE_EVENT2("consensus", "RaftConsensus::StartElection",
                "peer", peer_uuid(),
                "tablet", tablet_id());
@@ -367,6 +386,13 @@ Status RaftConsensus::StartElection(ElectionMode mode) {
                                   "a non-participant in the raft config",
                                   state_->GetActiveConfigUnlocked().ShortDebugString());
     }
+    if (PREDICT_FALSE(active_role == RaftPeerPB::LEARNER)) {
+      // Non-voters follow the leader but never replace it.
+      SnoozeFailureDetectorUnlocked();
+      return Status::IllegalState("Not starting election: Node is currently "
+                                  "a non-voter in the raft config",
+                                  state_->GetActiveConfigUnlocked().ShortDebugString());
+    }
 
     if (state_->HasLeaderUnlocked()) {
       LOG_WITH_PREFIX_UNLOCKED(INFO)
@@ -378,10 +404,14 @@ Status RaftConsensus::StartElection(ElectionMode mode) {
           << "Triggering leader election";
     }
 
-    // Increment the term.
-    // TODO: this causes an extra flush of the consensus metadata which
-    // will be flushed again for our vote below. Consolidate these.
-    RETURN_NOT_OK(IncrementTermUnlocked());
+    // A pre-election is run for the next term without moving to it.
+    ConsensusTerm election_term = state_->GetCurrentTermUnlocked() + 1;
+    if (!is_pre_election) {
+      // Increment the term.
+      // TODO: this causes an extra flush of the consensus metadata which
+      // will be flushed again for our vote below. Consolidate these.
+      RETURN_NOT_OK(IncrementTermUnlocked());
+    }
 
     // Snooze to avoid the election timer firing again as much as possible.
     // We do not disable the election timer while running an election.
@@ -391,26 +421,30 @@ Status RaftConsensus::StartElection(ElectionMode mode) {
     RETURN_NOT_OK(SnoozeFailureDetectorUnlocked(timeout, ALLOW_LOGGING));
 
     const RaftConfigPB& active_config = state_->GetActiveConfigUnlocked();
-    LOG_WITH_PREFIX_UNLOCKED(INFO) << "Starting election with config: "
+    LOG_WITH_PREFIX_UNLOCKED(INFO) << "Starting " << (is_pre_election ? "pre-" : "")
+                                   << "election with config: "
                                    << active_config.ShortDebugString();
 
     // Initialize the VoteCounter.
     int num_voters = CountVoters(active_config);
     int majority_size = MajoritySize(num_voters);
     gscoped_ptr<VoteCounter> counter(new VoteCounter(num_voters, majority_size));
-    // Vote for ourselves.
+    // Vote for ourselves. There's nothing to record for a pre-election.
     // TODO: Consider using a separate Mutex for voting, which must sync to disk.
-    RETURN_NOT_OK(state_->SetVotedForCurrentTermUnlocked(state_->GetPeerUuid()));
+    if (!is_pre_election) {
+      RETURN_NOT_OK(state_->SetVotedForCurrentTermUnlocked(state_->GetPeerUuid()));
+    }
     bool duplicate;
     RETURN_NOT_OK(counter->RegisterVote(state_->GetPeerUuid(), VOTE_GRANTED, &duplicate));
     CHECK(!duplicate) << state_->LogPrefixUnlocked()
                       << "Inexplicable duplicate self-vote for term "
-                      << state_->GetCurrentTermUnlocked();
+                      << election_term;
 
     VoteRequestPB request;
     request.set_ignore_live_leader(mode == ELECT_EVEN_IF_LEADER_IS_ALIVE);
+    request.set_is_pre_election(is_pre_election);
     request.set_candidate_uuid(state_->GetPeerUuid());
-    request.set_candidate_term(state_->GetCurrentTermUnlocked());
+    request.set_candidate_term(election_term);
     request.set_tablet_id(state_->GetOptions().tablet_id);
     *request.mutable_candidate_status()->mutable_last_received() =
         state_->GetLastReceivedOpIdUnlocked();
@@ -418,7 +452,8 @@ Status RaftConsensus::StartElection(ElectionMode mode) {
     election.reset(new LeaderElection(active_config,
                                       peer_proxy_factory_.get(),
                                       request, std::move(counter), timeout,
-                                      Bind(&RaftConsensus::ElectionCallback, this)));
+                                      Bind(&RaftConsensus::ElectionCallback, this,
+                                           is_pre_election)));
   }
 
   // Start the election outside the lock.
@@ -454,6 +489,99 @@ Status RaftConsensus::StepDown(LeaderStepDownResponsePB* resp) {
   return Status::OK();
 }
 
+namespace {
+
+// A RunLeaderElection RPC to the successor of a leader which stepped down.
+// Deletes itself once the RPC completes.
+struct SuccessorElectionRpc {
+  void Finished() {
+    Status s = controller.status();
+    if (s.ok() && resp.has_error()) {
+      s = StatusFromPB(resp.error().status());
+    }
+    if (!s.ok()) {
+      LOG(WARNING) << log_prefix << "Unable to start an election on successor "
+                   << req.dest_uuid() << ": " << s.ToString();
+    }
+    delete this;
+  }
+
+  gscoped_ptr<PeerProxy> proxy;
+  RunLeaderElectionRequestPB req;
+  RunLeaderElectionResponsePB resp;
+  rpc::RpcController controller;
+  string log_prefix;
+};
+
+} // anonymous namespace
+
+Status RaftConsensus::TransferLeadership(const string& new_leader_uuid,
+                                         LeaderStepDownResponsePB* resp) {
+  TRACE_EVENT0("consensus", "RaftConsensus::TransferLeadership");
+  RaftPeerPB successor;
+  {
+    ReplicaState::UniqueLock lock;
+    RETURN_NOT_OK(state_->LockForConfigChange(&lock));
+    if (state_->GetActiveRoleUnlocked() != RaftPeerPB::LEADER) {
+      resp->mutable_error()->set_code(TabletServerErrorPB::NOT_THE_LEADER);
+      StatusToPB(Status::IllegalState("Not currently leader"),
+                 resp->mutable_error()->mutable_status());
+      // We return OK so that the tablet service won't overwrite the error code.
+      return Status::OK();
+    }
+
+    string successor_uuid = new_leader_uuid;
+    if (successor_uuid.empty()) {
+      successor_uuid = queue_->GetMostUpToDateVoter();
+    } else if (successor_uuid == state_->GetPeerUuid() ||
+               !IsRaftConfigVoter(successor_uuid, state_->GetActiveConfigUnlocked())) {
+      return Status::InvalidArgument("New leader must be another voter in the config",
+                                     successor_uuid);
+    }
+    if (!successor_uuid.empty()) {
+      RETURN_NOT_OK(GetRaftConfigMember(state_->GetActiveConfigUnlocked(), successor_uuid,
+                                        &successor));
+    }
+    RETURN_NOT_OK(BecomeReplicaUnlocked());
+  }
+
+  if (!successor.has_permanent_uuid()) {
+    LOG_WITH_PREFIX(INFO) << "Stepped down without a successor: no voter is known to be "
+                          << "caught up";
+    return Status::OK();
+  }
+
+  // The other voters withhold their votes for a while after hearing from this
+  // leader, so the successor's election has to ignore that.
+  LOG_WITH_PREFIX(INFO) << "Stepped down, transferring leadership to "
+                        << successor.permanent_uuid();
+  gscoped_ptr<SuccessorElectionRpc> rpc(new SuccessorElectionRpc);
+  RETURN_NOT_OK(peer_proxy_factory_->NewProxy(successor, &rpc->proxy));
+  rpc->req.set_dest_uuid(successor.permanent_uuid());
+  rpc->req.set_tablet_id(tablet_id());
+  rpc->controller.set_timeout(MinimumElectionTimeout());
+  rpc->log_prefix = state_->LogPrefixThreadSafe();
+  SuccessorElectionRpc* raw_rpc = rpc.release();
+  raw_rpc->proxy->StartElectionAsync(&raw_rpc->req, &raw_rpc->resp, &raw_rpc->controller,
+                                     boost::bind(&SuccessorElectionRpc::Finished, raw_rpc));
+  return Status::OK();
+}
+
+Status RaftConsensus::CheckLeaderLease() {
+  {
+    ReplicaState::UniqueLock lock;
+    RETURN_NOT_OK(state_->LockForRead(&lock));
+    if (state_->GetActiveRoleUnlocked() != RaftPeerPB::LEADER) {
+      return Status::IllegalState("Not currently leader");
+    }
+  }
+  MonoTime lease_expiration = queue_->GetLeaderLeaseStartTime() + LeaderLeaseDuration();
+  if (MonoTime::Now() >= lease_expiration) {
+    return Status::ServiceUnavailable("Leader does not hold a lease");
+  }
+  return Status::OK();
+}
+
 void RaftConsensus::ReportFailureDetected(const std::string& name, const Status& msg) {
   DCHECK_EQ(name, kTimerId);
   // Start an election.
@@ -1215,6 +1343,14 @@ Status RaftConsensus::UpdateReplica(const ConsensusRequestPB* request,
     CHECK_OK(state_->AdvanceCommittedIndexUnlocked(apply_up_to));
     queue_->UpdateFollowerWatermarks(apply_up_to, request->all_replicated_index());
 
+    // If the leader sent a safe time and we now have everything it had committed
+    // when computing it, all the transactions at or before it were started above
+    // or in earlier requests, so the safe time may advance past them.
+    if (request->has_safe_timestamp() && apply_up_to == request->committed_index()) {
+      state_->GetReplicaTransactionFactoryUnlocked()->AdvanceSafeTime(
+          Timestamp(request->safe_timestamp()));
+    }
+
     // We can now update the last received watermark.
     //
     // We do it here (and before we actually hear back from the wal whether things
@@ -1346,6 +1482,9 @@ Status RaftConsensus::RequestVote(const VoteRequestPB* request, VoteResponsePB*
     return RequestVoteRespondLeaderIsAlive(request, response);
   }
 
+  // The checks below leave the replica's state alone until a real vote is granted
+  // or the term advanced, neither of which happens for a pre-election.
+
   // Candidate is running behind.
   if (request->candidate_term() < state_->GetCurrentTermUnlocked()) {
     return RequestVoteRespondInvalidTerm(request, response);
@@ -1371,7 +1510,8 @@ Status RaftConsensus::RequestVote(const VoteRequestPB* request, VoteResponsePB*
                                 local_last_logged_opid);
 
   // Record the term advancement if necessary.
-  if (request->candidate_term() > state_->GetCurrentTermUnlocked()) {
+  if (!request->is_pre_election() &&
+      request->candidate_term() > state_->GetCurrentTermUnlocked()) {
     // If we are going to vote for this peer, then we will flush the consensus metadata
     // to disk below when we record the vote, and we can skip flushing the term advancement
     // to disk here.
@@ -1385,6 +1525,15 @@ Status RaftConsensus::RequestVote(const VoteRequestPB* request, VoteResponsePB*
     return RequestVoteRespondLastOpIdTooOld(local_last_logged_opid, request, response);
   }
 
+  if (request->is_pre_election()) {
+    FillVoteResponseVoteGranted(response);
+    LOG(INFO) << Substitute("$0: Granting yes pre-election vote for candidate $1 in term $2.",
+                            GetRequestVoteLogPrefixUnlocked(),
+                            request->candidate_uuid(),
+                            request->candidate_term());
+    return Status::OK();
+  }
+
   // Passed all our checks. Vote granted.
   return RequestVoteRespondVoteGranted(request, response);
 }
@@ -1801,15 +1950,16 @@ ReplicaState* RaftConsensus::GetReplicaStateForTests() {
   return state_.get();
 }
 
-void RaftConsensus::ElectionCallback(const ElectionResult& result) {
+void RaftConsensus::ElectionCallback(bool is_pre_election, const ElectionResult& result) {
   // The election callback runs on a reactor thread, so we need to defer to our
   // threadpool. If the threadpool is already shut down for some reason, it's OK --
   // we're OK with the callback never running.
-  WARN_NOT_OK(thread_pool_->SubmitClosure(Bind(&RaftConsensus::DoElectionCallback, this, result)),
+  WARN_NOT_OK(thread_pool_->SubmitClosure(Bind(&RaftConsensus::DoElectionCallback, this,
+                                               is_pre_election, result)),
               state_->LogPrefixThreadSafe() + "Unable to run election callback");
 }
 
-void RaftConsensus::DoElectionCallback(const ElectionResult& result) {
+void RaftConsensus::DoElectionCallback(bool is_pre_election, const ElectionResult& result) {
   // Snooze to avoid the election timer firing again as much as possible.
   {
     ReplicaState::UniqueLock lock;
@@ -1825,10 +1975,34 @@ void RaftConsensus::DoElectionCallback(const ElectionResult& result) {
                                                 ALLOW_LOGGING));
   }
 
+  const char* election_type = is_pre_election ? "pre-election" : "election";
   if (result.decision == VOTE_DENIED) {
-    LOG_WITH_PREFIX(INFO) << "Leader election lost for term " << result.election_term
-                             << ". Reason: "
-                             << (!result.message.empty() ? result.message : "None given");
+    LOG_WITH_PREFIX(INFO) << "Leader " << election_type << " lost for term "
+                          << result.election_term << ". Reason: "
+                          << (!result.message.empty() ? result.message : "None given");
+    return;
+  }
+
+  if (is_pre_election) {
+    {
+      ReplicaState::UniqueLock lock;
+      Status s = state_->LockForRead(&lock);
+      if (PREDICT_FALSE(!s.ok())) {
+        LOG_WITH_PREFIX(INFO) << "Received pre-election callback for term "
+                              << result.election_term << " while not running: "
+                              << s.ToString();
+        return;
+      }
+      // Someone else may have moved the configuration to a new term meanwhile.
+      if (result.election_term != state_->GetCurrentTermUnlocked() + 1) {
+        LOG_WITH_PREFIX_UNLOCKED(INFO) << "Leader pre-election decision for defunct term "
+                                       << result.election_term << ": won";
+        return;
+      }
+    }
+    LOG_WITH_PREFIX(INFO) << "Leader pre-election won for term " << result.election_term;
+    WARN_NOT_OK(DoStartElection(NORMAL_ELECTION, false),
+                state_->LogPrefixThreadSafe() + "Unable to start election after pre-election");
     return;
   }
 
@@ -1997,6 +2171,15 @@ MonoDelta RaftConsensus::MinimumElectionTimeout() const {
   return MonoDelta::FromMilliseconds(failure_timeout);
 }
 
+MonoDelta RaftConsensus::LeaderLeaseDuration() const {
+  // The followers count the withholding period from when they receive a
+  // request, which is no earlier than when we sent it, but their clocks and
+  // ours may drift apart in the meantime.
+  double drift = 2 * clock_->MaxDriftRate();
+  return MonoDelta::FromNanoseconds(
+      static_cast<int64_t>(MinimumElectionTimeout().ToNanoseconds() * (1 - drift)));
+}
+
 MonoDelta RaftConsensus::LeaderElectionExpBackoffDeltaUnlocked() {
   // Compute a backoff factor based on how many leader elections have
   // taken place since a leader was successfully elected.
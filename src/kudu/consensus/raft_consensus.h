@@ -53,6 +53,7 @@ class Messenger;
 
 namespace consensus {
 class ConsensusMetadata;
+class MultiRaftHeartbeatBatcher;
 class Peer;
 class PeerProxyFactory;
 class PeerManager;
@@ -63,6 +64,11 @@ class RaftConsensus : public Consensus,
  public:
   class ConsensusFaultHooks;
 
+  // If 'heartbeat_batcher' is not null, heartbeats to remote peers are
+  // batched with those of the other tablets using it.
+  //
+  // If 'raft_pool' is not null, the notifications of the consensus queue run
+  // on it, in order, rather than on a thread of the queue's own.
   static scoped_refptr<RaftConsensus> Create(
     const ConsensusOptions& options,
     std::unique_ptr<ConsensusMetadata> cmeta,
@@ -71,6 +77,8 @@ class RaftConsensus : public Consensus,
     const scoped_refptr<server::Clock>& clock,
     ReplicaTransactionFactory* txn_factory,
     const std::shared_ptr<rpc::Messenger>& messenger,
+    MultiRaftHeartbeatBatcher* heartbeat_batcher,
+    ThreadPool* raft_pool,
     const scoped_refptr<log::Log>& log,
     const std::shared_ptr<MemTracker>& parent_mem_tracker,
     const Callback<void(const std::string& reason)>& mark_dirty_clbk);
@@ -107,6 +115,11 @@ class RaftConsensus : public Consensus,
 
   virtual Status StepDown(LeaderStepDownResponsePB* resp) OVERRIDE;
 
+  virtual Status TransferLeadership(const std::string& new_leader_uuid,
+                                    LeaderStepDownResponsePB* resp) OVERRIDE;
+
+  virtual Status CheckLeaderLease() OVERRIDE;
+
   // Call StartElection(), log a warning if the call fails (usually due to
   // being shut down).
   void ReportFailureDetected(const std::string& name, const Status& msg);
@@ -357,10 +370,14 @@ class RaftConsensus : public Consensus,
   Status RequestVoteRespondVoteGranted(const VoteRequestPB* request,
                                        VoteResponsePB* response);
 
+  // Runs a leader election, or a pre-election if 'is_pre_election' is true.
+  // A pre-election which is won is followed by a real election.
+  Status DoStartElection(ElectionMode mode, bool is_pre_election);
+
   // Callback for leader election driver. ElectionCallback is run on the
   // reactor thread, so it simply defers its work to DoElectionCallback.
-  void ElectionCallback(const ElectionResult& result);
-  void DoElectionCallback(const ElectionResult& result);
+  void ElectionCallback(bool is_pre_election, const ElectionResult& result);
+  void DoElectionCallback(bool is_pre_election, const ElectionResult& result);
 
   // Start tracking the leader for failures. This typically occurs at startup
   // and when the local peer steps down as leader.
@@ -394,6 +411,12 @@ class RaftConsensus : public Consensus,
   // jitter, election timeouts may be longer than this.
   MonoDelta MinimumElectionTimeout() const;
 
+  // How long a majority's acceptance of a request lets this replica act as
+  // the only leader: the minimum election timeout, for which followers
+  // withhold their votes, shortened by the worst-case clock drift between
+  // this server and the followers.
+  MonoDelta LeaderLeaseDuration() const;
+
   // Calculates an additional snooze delta for leader election.
   // The additional delta increases exponentially with the difference
   // between the current term and the term of the last committed
@@ -21,21 +21,65 @@
 #include "kudu/consensus/consensus.pb.h"
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/gutil/gscoped_ptr.h"
+#include "kudu/util/faststring.h"
+#include "kudu/util/once.h"
+#include "kudu/util/pb_util.h"
+#include "kudu/util/slice.h"
+#include "kudu/util/status.h"
 
 namespace kudu {
 namespace consensus {
 
 // A simple ref-counted wrapper around ReplicateMsg.
+//
+// The wrapper also caches the message's wire encoding, so that the WAL and the
+// requests to every peer can all write out the same bytes rather than each
+// serialize the message anew.
 class RefCountedReplicate : public RefCountedThreadSafe<RefCountedReplicate> {
  public:
   explicit RefCountedReplicate(ReplicateMsg* msg) : msg_(msg) {}
 
+  // Wraps 'msg', which was parsed from 'serialized', keeping a copy of that
+  // encoding rather than serializing the message again.
+  RefCountedReplicate(ReplicateMsg* msg, const Slice& serialized) : msg_(msg) {
+    serialized_.assign_copy(serialized.data(), serialized.size());
+  }
+
   ReplicateMsg* get() {
     return msg_.get();
   }
 
+  // Sets 'data' to the wire encoding of the message, serializing it on the
+  // first call. The message must not be modified after the first call.
+  Status GetSerialized(Slice* data) {
+    RETURN_NOT_OK(serialize_once_.Init(&RefCountedReplicate::Serialize, this));
+    *data = Slice(serialized_);
+    return Status::OK();
+  }
+
+  // Returns the memory used by the message, including its cached wire
+  // encoding once it has been serialized.
+  size_t SpaceUsed() const {
+    return msg_->SpaceUsed() + (serialize_once_.initted() ? serialized_.capacity() : 0);
+  }
+
  private:
+  Status Serialize() {
+    if (serialized_.size() > 0) {
+      // The encoding was handed over at construction.
+      return Status::OK();
+    }
+    if (!pb_util::AppendToString(*msg_, &serialized_)) {
+      return Status::InvalidArgument("unable to serialize replicate message",
+                                     msg_->InitializationErrorString());
+    }
+    return Status::OK();
+  }
+
   gscoped_ptr<ReplicateMsg> msg_;
+
+  KuduOnceDynamic serialize_once_;
+  faststring serialized_;
 };
 
 typedef scoped_refptr<RefCountedReplicate> ReplicateRefPtr;
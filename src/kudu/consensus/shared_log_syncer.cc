@@ -0,0 +1,114 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/consensus/shared_log_syncer.h"
+
+#if defined(__linux__)
+#include <sys/utsname.h>
+#endif
+
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+#include "kudu/gutil/map-util.h"
+#include "kudu/util/debug/trace_event.h"
+#include "kudu/util/env.h"
+#include "kudu/util/locks.h"
+
+using std::string;
+using std::unique_ptr;
+using std::unordered_map;
+
+namespace kudu {
+namespace log {
+
+SharedLogSyncer* SharedLogSyncer::GetOrCreate(Env* env, const string& wal_root) {
+  // Syncers are never destroyed, since logs may sync until process exit.
+  static simple_spinlock registry_lock;
+  static auto* registry = new unordered_map<string, unique_ptr<SharedLogSyncer>>();
+
+  std::lock_guard<simple_spinlock> l(registry_lock);
+  unique_ptr<SharedLogSyncer>* syncer = FindOrNull(*registry, wal_root);
+  if (syncer) {
+    return syncer->get();
+  }
+  SharedLogSyncer* new_syncer = new SharedLogSyncer(env, wal_root);
+  registry->emplace(wal_root, unique_ptr<SharedLogSyncer>(new_syncer));
+  return new_syncer;
+}
+
+bool SharedLogSyncer::FilesystemSyncReportsErrors() {
+#if defined(__linux__)
+  struct utsname u;
+  if (uname(&u) != 0) {
+    return false;
+  }
+  int major = 0;
+  int minor = 0;
+  if (sscanf(u.release, "%d.%d", &major, &minor) != 2) {
+    return false;
+  }
+  return major > 5 || (major == 5 && minor >= 8);
+#else
+  return false;
+#endif
+}
+
+SharedLogSyncer::SharedLogSyncer(Env* env, string wal_root)
+    : env_(env),
+      wal_root_(std::move(wal_root)),
+      sync_done_(&lock_),
+      syncs_started_(0),
+      syncs_finished_(0) {
+}
+
+Status SharedLogSyncer::Sync() {
+  TRACE_EVENT0("log", "SharedLogSyncer::Sync");
+  MutexLock l(lock_);
+
+  // A group sync which is already in progress may have started before the
+  // caller's writes, so only one which starts after this point will do.
+  uint64_t needed = syncs_started_ + 1;
+  while (syncs_finished_ < needed) {
+    if (syncs_started_ == syncs_finished_) {
+      // No group sync is in progress: lead one.
+      uint64_t this_sync = ++syncs_started_;
+      l.Unlock();
+      Status s = env_->SyncFilesystem(wal_root_);
+      l.Lock();
+      syncs_finished_ = this_sync;
+      last_status_ = s;
+      sync_done_.Broadcast();
+      return s;
+    }
+    sync_done_.Wait();
+  }
+  // A later group sync than the one needed has its status in 'last_status_'
+  // by now, but since it started later still, it covers the caller too.
+  return last_status_;
+}
+
+uint64_t SharedLogSyncer::num_group_syncs() const {
+  MutexLock l(lock_);
+  return syncs_finished_;
+}
+
+} // namespace log
+} // namespace kudu
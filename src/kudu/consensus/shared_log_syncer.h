@@ -0,0 +1,95 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#ifndef KUDU_CONSENSUS_SHARED_LOG_SYNCER_H
+#define KUDU_CONSENSUS_SHARED_LOG_SYNCER_H
+
+#include <string>
+
+#include "kudu/gutil/macros.h"
+#include "kudu/util/condition_variable.h"
+#include "kudu/util/mutex.h"
+#include "kudu/util/status.h"
+
+namespace kudu {
+
+class Env;
+
+namespace log {
+
+// Group-commits the fsyncs of the write-ahead logs of all tablets whose WALs
+// live under the same directory.
+//
+// Each tablet's Log already group-commits its own appends, but with many
+// lightly loaded tablets each of them still issues its own fsync for every
+// batch. With the shared syncer, a Log which has written a batch instead
+// joins the next group sync: one of the waiting callers syncs the whole
+// filesystem on behalf of all of them, and the others wait for it.
+//
+// The logs keep their own segment files, so reading, indexing and GC of
+// each tablet's log are unaffected.
+//
+// This class is thread-safe.
+class SharedLogSyncer {
+ public:
+  // Returns the syncer for the WALs under 'wal_root', creating it if needed.
+  // The returned syncer lives for the duration of the process.
+  static SharedLogSyncer* GetOrCreate(Env* env, const std::string& wal_root);
+
+  // Returns whether syncing a whole filesystem reports the writeback errors
+  // of the files on it. Linux only does so since 5.8: before that, syncfs()
+  // returns success even when writing back dirty pages failed, so a lost
+  // write would go unnoticed. On such platforms the logs must not use the
+  // shared syncer.
+  static bool FilesystemSyncReportsErrors();
+
+  SharedLogSyncer(Env* env, std::string wal_root);
+
+  // Returns once everything written to files on the filesystem of the WAL
+  // root before the call is durable, or with the error of the group sync
+  // that was meant to make it so.
+  //
+  // Returns NotSupported if the platform can't sync a whole filesystem at
+  // once, in which case the caller should sync its own files instead.
+  Status Sync();
+
+  // Returns the number of group syncs that have completed.
+  uint64_t num_group_syncs() const;
+
+ private:
+  Env* const env_;
+  const std::string wal_root_;
+
+  mutable Mutex lock_;
+
+  // Signaled whenever a group sync completes.
+  ConditionVariable sync_done_;
+
+  // The number of group syncs that have started and completed, respectively.
+  // At most one is in progress at a time, so these differ by at most one.
+  uint64_t syncs_started_;
+  uint64_t syncs_finished_;
+
+  // The result of the most recently completed group sync.
+  Status last_status_;
+
+  DISALLOW_COPY_AND_ASSIGN(SharedLogSyncer);
+};
+
+} // namespace log
+} // namespace kudu
+
+#endif // KUDU_CONSENSUS_SHARED_LOG_SYNCER_H
@@ -32,6 +32,9 @@
 #include "kudu/util/rw_mutex.h"
 
 DEFINE_int32(num_threads, 8, "Number of threads to test");
+DEFINE_int32(write_interval, 10000,
+             "In the read-mostly tests, the number of read-locked iterations "
+             "each thread does between taking the lock in exclusive mode");
 
 using std::thread;
 using std::vector;
@@ -161,6 +164,55 @@ void percpu_rwlock_entry(shared_data *shared) {
   depend_on(result);
 }
 
+// Like the read-only tests, except that every thread takes the lock in
+// exclusive mode once every --write_interval iterations, the way flushes and
+// tablet creations do with the locks on the tablet read paths.
+void mostly_read_rwlock_entry(shared_data *shared) {
+  float result = 1;
+  for (int i = 0; i < 1000000; i++) {
+    if (i % FLAGS_write_interval == 0) {
+      std::lock_guard<kudu::RWMutex> l(shared->rwlock);
+      result += workload(result);
+      continue;
+    }
+    shared->rwlock.lock_shared();
+    result += workload(result);
+    shared->rwlock.unlock_shared();
+  }
+  depend_on(result);
+}
+
+void mostly_read_rw_spinlock_entry(shared_data *shared) {
+  float result = 1;
+  for (int i = 0; i < 1000000; i++) {
+    if (i % FLAGS_write_interval == 0) {
+      std::lock_guard<kudu::rw_spinlock> l(shared->rw_spinlock);
+      result += workload(result);
+      continue;
+    }
+    shared->rw_spinlock.lock_shared();
+    result += workload(result);
+    shared->rw_spinlock.unlock_shared();
+  }
+  depend_on(result);
+}
+
+void mostly_read_percpu_rwlock_entry(shared_data *shared) {
+  float result = 1;
+  for (int i = 0; i < 1000000; i++) {
+    if (i % FLAGS_write_interval == 0) {
+      std::lock_guard<kudu::percpu_rwlock> l(shared->per_cpu);
+      result += workload(result);
+      continue;
+    }
+    kudu::rw_spinlock &l = shared->per_cpu.get_lock();
+    l.lock_shared();
+    result += workload(result);
+    l.unlock_shared();
+  }
+  depend_on(result);
+}
+
 
 enum TestMethod {
   SHARED_RWLOCK,
@@ -169,7 +221,10 @@ enum TestMethod {
   OWN_SPINLOCK,
   PERCPU_RWLOCK,
   NO_LOCK,
-  RW_SPINLOCK
+  RW_SPINLOCK,
+  MOSTLY_READ_RWLOCK,
+  MOSTLY_READ_RW_SPINLOCK,
+  MOSTLY_READ_PERCPU_RWLOCK
 };
 
 void test_shared_lock(int num_threads, TestMethod method, const char *name) {
@@ -199,6 +254,15 @@ void test_shared_lock(int num_threads, TestMethod method, const char *name) {
       case RW_SPINLOCK:
         threads.emplace_back(shared_rw_spinlock_entry, &shared);
         break;
+      case MOSTLY_READ_RWLOCK:
+        threads.emplace_back(mostly_read_rwlock_entry, &shared);
+        break;
+      case MOSTLY_READ_RW_SPINLOCK:
+        threads.emplace_back(mostly_read_rw_spinlock_entry, &shared);
+        break;
+      case MOSTLY_READ_PERCPU_RWLOCK:
+        threads.emplace_back(mostly_read_percpu_rwlock_entry, &shared);
+        break;
       default:
         CHECK(0) << "bad method: " << method;
     }
@@ -210,7 +274,7 @@ void test_shared_lock(int num_threads, TestMethod method, const char *name) {
   }
   int64_t end = CycleClock::Now();
 
-  printf("%13s  % 7d  %" PRId64 "M\n", name, num_threads, (end-start)/1000000);
+  printf("%23s  % 7d  %" PRId64 "M\n", name, num_threads, (end-start)/1000000);
 }
 
 int main(int argc, char **argv) {
@@ -221,8 +285,8 @@ int main(int argc, char **argv) {
   }
   kudu::InitGoogleLoggingSafe(argv[0]);
 
-  printf("        Test   Threads  Cycles\n");
-  printf("------------------------------\n");
+  printf("                   Test   Threads  Cycles\n");
+  printf("-----------------------------------------\n");
 
   for (int num_threads = 1; num_threads <= FLAGS_num_threads; num_threads++) {
     test_shared_lock(num_threads, SHARED_RWLOCK, "shared_rwlock");
@@ -232,6 +296,9 @@ int main(int argc, char **argv) {
     test_shared_lock(num_threads, NO_LOCK, "no_lock");
     test_shared_lock(num_threads, PERCPU_RWLOCK, "percpu_rwlock");
     test_shared_lock(num_threads, RW_SPINLOCK, "rw_spinlock");
+    test_shared_lock(num_threads, MOSTLY_READ_RWLOCK, "mostly_read_rwlock");
+    test_shared_lock(num_threads, MOSTLY_READ_RW_SPINLOCK, "mostly_read_rw_spinlock");
+    test_shared_lock(num_threads, MOSTLY_READ_PERCPU_RWLOCK, "mostly_read_percpu");
   }
 
 }
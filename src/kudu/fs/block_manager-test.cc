@@ -54,6 +54,10 @@ DECLARE_int64(fs_data_dirs_reserved_bytes);
 DECLARE_int64(disk_reserved_bytes_free_for_testing);
 
 DECLARE_int32(log_block_manager_full_disk_cache_seconds);
+DECLARE_int32(log_container_metadata_compact_min_records);
+DECLARE_int32(fs_target_data_dirs_per_tablet);
+DECLARE_int64(log_block_manager_eviction_chunk_bytes);
+DECLARE_bool(log_block_manager_mmap_reads);
 DECLARE_string(block_manager);
 
 // Generic block manager metrics.
@@ -427,6 +431,52 @@ TYPED_TEST(BlockManagerTest, ReadAfterDeleteTest) {
   ASSERT_EQ(test_data, data);
 }
 
+// Test that a batch of blocks can be deleted at once, including blocks that
+// are open for reading and blocks that don't exist.
+TYPED_TEST(BlockManagerTest, DeleteBlocksTest) {
+  string test_data = "test data";
+  vector<BlockId> ids;
+  for (int i = 0; i < 10; i++) {
+    gscoped_ptr<WritableBlock> written_block;
+    ASSERT_OK(this->bm_->CreateBlock(&written_block));
+    ASSERT_OK(written_block->Append(test_data));
+    ASSERT_OK(written_block->Close());
+    ids.push_back(written_block->id());
+  }
+  gscoped_ptr<ReadableBlock> read_block;
+  ASSERT_OK(this->bm_->OpenBlock(ids[3], &read_block));
+
+  // Delete every block but the last, plus one that was never created.
+  vector<BlockId> to_delete(ids.begin(), ids.end() - 1);
+  to_delete.emplace_back(ids.back().id() + 1000);
+  vector<BlockId> deleted;
+  ASSERT_OK(this->bm_->DeleteBlocks(to_delete, &deleted));
+  ASSERT_EQ(to_delete.size(), deleted.size());
+  for (const BlockId& id : to_delete) {
+    ASSERT_TRUE(this->bm_->OpenBlock(id, nullptr).IsNotFound());
+  }
+
+  // The opened block is still readable, and so is the one that was kept.
+  Slice data;
+  gscoped_ptr<uint8_t[]> scratch(new uint8_t[test_data.length()]);
+  ASSERT_OK(read_block->Read(0, test_data.length(), &data, scratch.get()));
+  ASSERT_EQ(test_data, data);
+  ASSERT_OK(read_block->Close());
+  read_block.reset();
+
+  // The deletions persist across a restart.
+  ASSERT_OK(this->ReopenBlockManager(scoped_refptr<MetricEntity>(),
+                                     shared_ptr<MemTracker>(),
+                                     { GetTestDataDirectory() },
+                                     false));
+  for (const BlockId& id : to_delete) {
+    ASSERT_TRUE(this->bm_->OpenBlock(id, nullptr).IsNotFound());
+  }
+  ASSERT_OK(this->bm_->OpenBlock(ids.back(), &read_block));
+  ASSERT_OK(read_block->Read(0, test_data.length(), &data, scratch.get()));
+  ASSERT_EQ(test_data, data);
+}
+
 TYPED_TEST(BlockManagerTest, CloseTwiceTest) {
   // Create a new block and close it repeatedly.
   gscoped_ptr<WritableBlock> written_block;
@@ -976,6 +1026,298 @@ TEST_F(LogBlockManagerTest, TestMetadataTruncation) {
                                      false));
 }
 
+// Test that a container whose metadata is dominated by records for deleted
+// blocks has its metadata rewritten at startup, and that the rewritten
+// container remains fully usable.
+TEST_F(LogBlockManagerTest, TestMetadataCompaction) {
+  RETURN_NOT_LOG_BLOCK_MANAGER();
+  FLAGS_log_container_metadata_compact_min_records = 0;
+
+  // Reads all of the records in the metadata file at 'metadata_path'.
+  auto read_records = [&](const string& metadata_path, vector<BlockRecordPB>* records) {
+    gscoped_ptr<RandomAccessFile> meta_file;
+    RETURN_NOT_OK(env_->NewRandomAccessFile(metadata_path, &meta_file));
+    ReadablePBContainerFile pb_reader(std::move(meta_file));
+    RETURN_NOT_OK(pb_reader.Open());
+    records->clear();
+    while (true) {
+      BlockRecordPB record;
+      Status s = pb_reader.ReadNextPB(&record);
+      if (s.IsEndOfFile()) {
+        return Status::OK();
+      }
+      RETURN_NOT_OK(s);
+      records->push_back(record);
+    }
+  };
+
+  // Create several blocks in a single container, then delete most of them,
+  // including the last one.
+  vector<BlockId> created_blocks;
+  for (int i = 0; i < 10; i++) {
+    gscoped_ptr<WritableBlock> writer;
+    ASSERT_OK(bm_->CreateBlock(&writer));
+    ASSERT_OK(writer->Append(Substitute("block $0", i)));
+    created_blocks.push_back(writer->id());
+    ASSERT_OK(writer->Close());
+  }
+  ASSERT_EQ(1, bm_->all_containers_.size());
+  for (int i = 0; i < 7; i++) {
+    ASSERT_OK(bm_->DeleteBlock(created_blocks[i]));
+  }
+  ASSERT_OK(bm_->DeleteBlock(created_blocks[9]));
+
+  string path = LogBlockManager::ContainerPathForTests(bm_->available_containers_.front());
+  string metadata_path = path + LogBlockManager::kContainerMetadataFileSuffix;
+  uint64_t uncompacted_size;
+  ASSERT_OK(env_->GetFileSize(metadata_path, &uncompacted_size));
+  vector<BlockRecordPB> records;
+  ASSERT_OK(read_records(metadata_path, &records));
+  int64_t container_end = 0;
+  for (const BlockRecordPB& r : records) {
+    if (r.op_type() == CREATE) {
+      container_end = std::max(container_end, r.offset() + r.length());
+    }
+  }
+
+  // Leave behind a temporary file from an interrupted compaction; it should be
+  // cleaned up without affecting the container.
+  string tmp_path = metadata_path + LogBlockManager::kContainerTmpFileSuffix;
+  {
+    gscoped_ptr<WritableFile> tmp_file;
+    ASSERT_OK(env_->NewWritableFile(tmp_path, &tmp_file));
+    ASSERT_OK(tmp_file->Append("garbage"));
+    ASSERT_OK(tmp_file->Close());
+  }
+
+  ASSERT_OK(ReopenBlockManager(scoped_refptr<MetricEntity>(),
+                               shared_ptr<MemTracker>(),
+                               { GetTestDataDirectory() },
+                               false));
+  ASSERT_FALSE(env_->FileExists(tmp_path));
+  uint64_t compacted_size;
+  ASSERT_OK(env_->GetFileSize(metadata_path, &compacted_size));
+  ASSERT_LT(compacted_size, uncompacted_size);
+  ASSERT_EQ(2, bm_->CountBlocksForTests());
+  for (int i = 7; i < 9; i++) {
+    gscoped_ptr<ReadableBlock> block;
+    ASSERT_OK(bm_->OpenBlock(created_blocks[i], &block));
+    Slice data;
+    uint8_t scratch[64];
+    uint64_t size;
+    ASSERT_OK(block->Size(&size));
+    ASSERT_OK(block->Read(0, size, &data, scratch));
+    ASSERT_EQ(Substitute("block $0", i), data.ToString());
+    ASSERT_OK(block->Close());
+  }
+
+  // The compacted container should accept new blocks, placed beyond the space
+  // used by every block ever written to it, and a second reopen should see
+  // them alongside the survivors.
+  {
+    gscoped_ptr<WritableBlock> writer;
+    ASSERT_OK(bm_->CreateBlock(&writer));
+    ASSERT_OK(writer->Close());
+  }
+  ASSERT_OK(read_records(metadata_path, &records));
+  ASSERT_EQ(CREATE, records.back().op_type());
+  ASSERT_GE(records.back().offset(), container_end);
+  ASSERT_OK(bm_->DeleteBlock(created_blocks[8]));
+  ASSERT_OK(ReopenBlockManager(scoped_refptr<MetricEntity>(),
+                               shared_ptr<MemTracker>(),
+                               { GetTestDataDirectory() },
+                               false));
+  ASSERT_EQ(2, bm_->CountBlocksForTests());
+  ASSERT_EQ(1, bm_->all_containers_.size());
+}
+
+// Test that full containers without live blocks are removed at startup,
+// except for the one holding the largest block ID.
+TEST_F(LogBlockManagerTest, TestDeadContainerDeletion) {
+  RETURN_NOT_LOG_BLOCK_MANAGER();
+
+  // Make every container full after a single block.
+  FLAGS_log_container_max_size = 1;
+
+  auto count_containers = [&](int* count) {
+    vector<string> children;
+    RETURN_NOT_OK(env_->GetChildren(GetTestDataDirectory(), &children));
+    *count = 0;
+    for (const string& child : children) {
+      if (HasSuffixString(child, LogBlockManager::kContainerMetadataFileSuffix)) {
+        (*count)++;
+      }
+    }
+    return Status::OK();
+  };
+
+  vector<BlockId> created_blocks;
+  for (int i = 0; i < 4; i++) {
+    gscoped_ptr<WritableBlock> writer;
+    ASSERT_OK(bm_->CreateBlock(&writer));
+    ASSERT_OK(writer->Append("data"));
+    created_blocks.push_back(writer->id());
+    ASSERT_OK(writer->Close());
+  }
+  ASSERT_EQ(4, bm_->all_containers_.size());
+
+  // Delete all but the second block.
+  for (int i = 0; i < 4; i++) {
+    if (i != 1) {
+      ASSERT_OK(bm_->DeleteBlock(created_blocks[i]));
+    }
+  }
+
+  // After a reopen, the containers of the first and third blocks are gone.
+  // The fourth block's container survives because it was the last to
+  // allocate a block ID.
+  ASSERT_OK(ReopenBlockManager(scoped_refptr<MetricEntity>(),
+                               shared_ptr<MemTracker>(),
+                               { GetTestDataDirectory() },
+                               false));
+  int num_containers;
+  ASSERT_OK(count_containers(&num_containers));
+  ASSERT_EQ(2, num_containers);
+  ASSERT_EQ(2, bm_->all_containers_.size());
+  ASSERT_EQ(1, bm_->CountBlocksForTests());
+  gscoped_ptr<ReadableBlock> block;
+  ASSERT_OK(bm_->OpenBlock(created_blocks[1], &block));
+  ASSERT_OK(block->Close());
+
+  // Block IDs must not go backwards.
+  gscoped_ptr<WritableBlock> writer;
+  ASSERT_OK(bm_->CreateBlock(&writer));
+  ASSERT_GT(writer->id().id(), created_blocks[3].id());
+  ASSERT_OK(writer->Close());
+}
+
+// Test that the blocks of a tablet are confined to its placement group.
+TEST_F(LogBlockManagerTest, TestPlacementGroups) {
+  RETURN_NOT_LOG_BLOCK_MANAGER();
+  FLAGS_fs_target_data_dirs_per_tablet = 2;
+
+  vector<string> paths;
+  for (int i = 0; i < 4; i++) {
+    paths.push_back(GetTestPath(Substitute("path$0", i)));
+  }
+  ASSERT_OK(ReopenBlockManager(scoped_refptr<MetricEntity>(),
+                               shared_ptr<MemTracker>(),
+                               paths,
+                               true));
+
+  // Writes 'num_blocks' blocks concurrently, forcing the creation of as many
+  // containers, and returns the number of paths that hold containers.
+  auto write_blocks = [&](const CreateBlockOptions& opts, int num_blocks, int* used_paths) {
+    ScopedWritableBlockCloser closer;
+    for (int i = 0; i < num_blocks; i++) {
+      gscoped_ptr<WritableBlock> block;
+      RETURN_NOT_OK(bm_->CreateBlock(opts, &block));
+      RETURN_NOT_OK(block->Append("test data"));
+      closer.AddBlock(std::move(block));
+    }
+    RETURN_NOT_OK(closer.CloseBlocks());
+    *used_paths = 0;
+    for (const string& path : paths) {
+      vector<string> children;
+      RETURN_NOT_OK(env_->GetChildren(path, &children));
+      for (const string& child : children) {
+        if (HasSuffixString(child, LogBlockManager::kContainerMetadataFileSuffix)) {
+          (*used_paths)++;
+          break;
+        }
+      }
+    }
+    return Status::OK();
+  };
+
+  CreateBlockOptions opts;
+  opts.tablet_id = "tablet-a";
+  int used_paths;
+  ASSERT_OK(write_blocks(opts, 8, &used_paths));
+  ASSERT_EQ(2, used_paths);
+
+  // Reusing the existing containers must not escape the group either.
+  ASSERT_OK(write_blocks(opts, 8, &used_paths));
+  ASSERT_EQ(2, used_paths);
+
+  // Blocks without a tablet are spread across every path.
+  ASSERT_OK(write_blocks(CreateBlockOptions(), 16, &used_paths));
+  ASSERT_EQ(4, used_paths);
+}
+
+// Test that blocks written with page cache eviction read back intact, and
+// don't disturb the blocks around them in the same container.
+TEST_F(LogBlockManagerTest, TestPageCacheEviction) {
+  RETURN_NOT_LOG_BLOCK_MANAGER();
+  FLAGS_log_block_manager_eviction_chunk_bytes = 64;
+
+  CreateBlockOptions evict_opts;
+  evict_opts.evict_from_page_cache = true;
+
+  vector<BlockId> ids;
+  vector<string> contents;
+  for (int i = 0; i < 3; i++) {
+    gscoped_ptr<WritableBlock> block;
+    ASSERT_OK(bm_->CreateBlock(i == 1 ? evict_opts : CreateBlockOptions(), &block));
+    string data;
+    for (int j = 0; j < 100; j++) {
+      string chunk = Substitute("block $0 chunk $1;", i, j);
+      ASSERT_OK(block->Append(chunk));
+      data += chunk;
+    }
+    ASSERT_OK(block->Close());
+    ids.push_back(block->id());
+    contents.push_back(data);
+  }
+
+  for (int i = 0; i < ids.size(); i++) {
+    gscoped_ptr<ReadableBlock> block;
+    ASSERT_OK(bm_->OpenBlock(ids[i], &block));
+    uint64_t size;
+    ASSERT_OK(block->Size(&size));
+    ASSERT_EQ(contents[i].size(), size);
+    Slice data;
+    gscoped_ptr<uint8_t[]> scratch(new uint8_t[size]);
+    ASSERT_OK(block->Read(0, size, &data, scratch.get()));
+    ASSERT_EQ(contents[i], data.ToString());
+  }
+}
+
+// Test that zero-copy reads return the block's data, and that it stays
+// readable for as long as it's pinned.
+TEST_F(LogBlockManagerTest, TestZeroCopyRead) {
+  RETURN_NOT_LOG_BLOCK_MANAGER();
+
+  // Put the block at a non-zero offset in its container.
+  BlockId id;
+  for (int i = 0; i < 2; i++) {
+    gscoped_ptr<WritableBlock> written_block;
+    ASSERT_OK(bm_->CreateBlock(&written_block));
+    ASSERT_OK(written_block->Append(Substitute("test data $0", i)));
+    ASSERT_OK(written_block->Close());
+    id = written_block->id();
+  }
+
+  gscoped_ptr<ReadableBlock> read_block;
+  ASSERT_OK(bm_->OpenBlock(id, &read_block));
+  Slice data;
+  std::shared_ptr<const void> pin;
+  FLAGS_log_block_manager_mmap_reads = false;
+  ASSERT_TRUE(read_block->ReadZeroCopy(0, 4, &data, &pin).IsNotSupported());
+
+  FLAGS_log_block_manager_mmap_reads = true;
+  ASSERT_TRUE(read_block->ReadZeroCopy(0, 100, &data, &pin).IsIOError());
+  ASSERT_OK(read_block->ReadZeroCopy(5, 6, &data, &pin));
+  ASSERT_EQ("data 1", data.ToString());
+
+  // Neither closing nor deleting the block invalidates the pinned data.
+  ASSERT_OK(read_block->Close());
+  read_block.reset();
+  ASSERT_OK(bm_->DeleteBlock(id));
+  ASSERT_EQ("data 1", data.ToString());
+  pin.reset();
+}
+
 TEST_F(LogBlockManagerTest, TestDiskSpaceCheck) {
   RETURN_NOT_LOG_BLOCK_MANAGER();
 
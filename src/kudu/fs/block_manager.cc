@@ -34,7 +34,8 @@ namespace fs {
 const char* BlockManager::kInstanceMetadataFileName = "block_manager_instance";
 
 BlockManagerOptions::BlockManagerOptions()
-  : read_only(false) {
+  : read_only(false),
+    disk_hiccup_monitor(nullptr) {
 }
 
 BlockManagerOptions::~BlockManagerOptions() {
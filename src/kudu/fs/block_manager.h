@@ -42,6 +42,7 @@ class Slice;
 namespace fs {
 
 class BlockManager;
+class DiskHiccupMonitor;
 
 // The smallest unit of Kudu data that is backed by the local filesystem.
 //
@@ -152,12 +153,36 @@ class ReadableBlock : public Block {
   virtual Status Read(uint64_t offset, size_t length,
                       Slice* result, uint8_t* scratch) const = 0;
 
+  // Hints that 'length' bytes beginning from 'offset' in the block will be
+  // read soon, so that the underlying storage can start fetching them
+  // without blocking the caller. Ranges beyond the end of the block are
+  // ignored.
+  virtual Status Prefetch(uint64_t offset, size_t length) const = 0;
+
+  // Like Read(), but without copying the data, e.g. by mapping it into
+  // memory. 'result' remains valid for as long as 'pin' is held, even after
+  // the block is closed or deleted.
+  //
+  // Returns NotSupported if the block can't be read this way, in which case
+  // the caller should fall back to Read().
+  virtual Status ReadZeroCopy(uint64_t offset, size_t length, Slice* result,
+                              std::shared_ptr<const void>* pin) const = 0;
+
   // Returns the memory usage of this object including the object itself.
   virtual size_t memory_footprint() const = 0;
 };
 
 // Provides options and hints for block placement.
 struct CreateBlockOptions {
+  // The tablet that the block belongs to, if any. Block managers may use it
+  // to keep the blocks of a tablet on a subset of their data directories.
+  std::string tablet_id;
+
+  // Whether the block's data should be dropped from the OS page cache as it
+  // is written out. Meant for large sequential writes, such as compaction
+  // output, which would otherwise evict data that readers depend on. Block
+  // managers may ignore it.
+  bool evict_from_page_cache = false;
 };
 
 // Block manager creation options.
@@ -180,6 +205,12 @@ struct BlockManagerOptions {
 
   // Whether the block manager should only allow reading. Defaults to false.
   bool read_only;
+
+  // The monitor to which the latency of block writes and syncs is reported,
+  // and which may throttle the writes. Not owned; may be NULL.
+  //
+  // Defaults to NULL.
+  DiskHiccupMonitor* disk_hiccup_monitor;
 };
 
 // Utilities for Kudu block lifecycle management. All methods are
@@ -226,6 +257,15 @@ class BlockManager {
   // writer is closed.
   virtual Status DeleteBlock(const BlockId& block_id) = 0;
 
+  // Deletes the given blocks. Effectively like DeleteBlock() for each block
+  // but may be optimized for groups of blocks.
+  //
+  // The IDs of the blocks that were deleted, or that didn't exist to begin
+  // with, are appended to 'deleted'. Deletion continues past failures; the
+  // first one is returned.
+  virtual Status DeleteBlocks(const std::vector<BlockId>& block_ids,
+                              std::vector<BlockId>* deleted) = 0;
+
   // Closes (and fully synchronizes) the given blocks. Effectively like
   // Close() for each block but may be optimized for groups of blocks.
   //
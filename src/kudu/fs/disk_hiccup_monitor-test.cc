@@ -0,0 +1,145 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#include "kudu/fs/disk_hiccup_monitor.h"
+
+#include <string>
+#include <vector>
+
+#include <gflags/gflags.h>
+#include <gtest/gtest.h>
+
+#include "kudu/gutil/casts.h"
+#include "kudu/util/metrics.h"
+#include "kudu/util/monotime.h"
+#include "kudu/util/path_util.h"
+#include "kudu/util/test_macros.h"
+#include "kudu/util/test_util.h"
+
+DECLARE_bool(disk_hiccup_throttle_background_writes);
+DECLARE_int32(disk_hiccup_persistent_count);
+DECLARE_int32(disk_hiccup_threshold_ms);
+DECLARE_int32(disk_hiccup_throttled_write_mb_per_sec);
+
+METRIC_DECLARE_entity(server);
+METRIC_DECLARE_counter(disk_hiccups);
+METRIC_DECLARE_counter(disk_hiccup_throttle_time);
+METRIC_DECLARE_gauge_uint32(disks_hiccuping_persistently);
+
+using std::string;
+using std::vector;
+
+namespace kudu {
+namespace fs {
+
+class DiskHiccupMonitorTest : public KuduTest {
+ public:
+  DiskHiccupMonitorTest()
+      : entity_(METRIC_ENTITY_server.Instantiate(&registry_, "test")),
+        monitor_(entity_) {
+  }
+
+  void SetUp() override {
+    KuduTest::SetUp();
+    wal_root_ = JoinPathSegments(GetTestDataDirectory(), "wal");
+    data_root_ = JoinPathSegments(GetTestDataDirectory(), "data");
+    ASSERT_OK(env_->CreateDir(wal_root_));
+    ASSERT_OK(env_->CreateDir(data_root_));
+    ASSERT_OK(monitor_.Init(wal_root_, { data_root_ }));
+  }
+
+ protected:
+  int64_t CounterValue(const CounterPrototype& prototype) {
+    return down_cast<Counter*>(entity_->FindOrNull(prototype).get())->value();
+  }
+
+  uint32_t NumDevicesHiccupingPersistently() {
+    return down_cast<FunctionGauge<uint32_t>*>(
+        entity_->FindOrNull(METRIC_disks_hiccuping_persistently).get())->value();
+  }
+
+  MetricRegistry registry_;
+  scoped_refptr<MetricEntity> entity_;
+  DiskHiccupMonitor monitor_;
+  string wal_root_;
+  string data_root_;
+};
+
+TEST_F(DiskHiccupMonitorTest, TestFindDevice) {
+  // Both roots are in the test directory, so they are on the same device.
+  DiskHiccupMonitor::Device* device = monitor_.wal_device();
+  ASSERT_TRUE(device != nullptr);
+  ASSERT_EQ(device, monitor_.FindDevice(wal_root_));
+  ASSERT_EQ(device, monitor_.FindDevice(JoinPathSegments(data_root_, "data/block")));
+
+  // Paths outside of the roots have no known device, even if their name
+  // starts with the name of a root.
+  ASSERT_TRUE(monitor_.FindDevice(data_root_ + "2") == nullptr);
+  ASSERT_TRUE(monitor_.FindDevice(GetTestDataDirectory()) == nullptr);
+}
+
+TEST_F(DiskHiccupMonitorTest, TestHiccups) {
+  FLAGS_disk_hiccup_threshold_ms = 10;
+  FLAGS_disk_hiccup_persistent_count = 3;
+  DiskHiccupMonitor::Device* device = monitor_.wal_device();
+
+  // Fast operations, and operations on unknown devices, aren't hiccups.
+  monitor_.RecordLatency(device, DiskHiccupMonitor::kSync, MonoDelta::FromMilliseconds(1));
+  monitor_.RecordLatency(nullptr, DiskHiccupMonitor::kSync, MonoDelta::FromSeconds(1));
+  ASSERT_EQ(0, CounterValue(METRIC_disk_hiccups));
+
+  monitor_.RecordLatency(device, DiskHiccupMonitor::kSync, MonoDelta::FromMilliseconds(50));
+  monitor_.RecordLatency(device, DiskHiccupMonitor::kWrite, MonoDelta::FromMilliseconds(50));
+  ASSERT_EQ(2, CounterValue(METRIC_disk_hiccups));
+  ASSERT_EQ(0, NumDevicesHiccupingPersistently());
+
+  monitor_.RecordLatency(device, DiskHiccupMonitor::kSync, MonoDelta::FromMilliseconds(50));
+  ASSERT_EQ(3, CounterValue(METRIC_disk_hiccups));
+  ASSERT_EQ(1, NumDevicesHiccupingPersistently());
+
+  // Requiring more hiccups makes the device recover.
+  FLAGS_disk_hiccup_persistent_count = 4;
+  ASSERT_EQ(0, NumDevicesHiccupingPersistently());
+}
+
+TEST_F(DiskHiccupMonitorTest, TestThrottling) {
+  FLAGS_disk_hiccup_threshold_ms = 10;
+  FLAGS_disk_hiccup_persistent_count = 1;
+  FLAGS_disk_hiccup_throttled_write_mb_per_sec = 1;
+  DiskHiccupMonitor::Device* device = monitor_.wal_device();
+  const int64_t kWriteBytes = 100 * 1024;
+
+  // Writes are not throttled unless enabled, even while hiccuping.
+  monitor_.RecordLatency(device, DiskHiccupMonitor::kSync, MonoDelta::FromMilliseconds(50));
+  ASSERT_EQ(1, NumDevicesHiccupingPersistently());
+  for (int i = 0; i < 3; i++) {
+    monitor_.ThrottleBackgroundWrite(device, kWriteBytes);
+  }
+  ASSERT_EQ(0, CounterValue(METRIC_disk_hiccup_throttle_time));
+
+  // Once enabled, writes after the first are delayed to keep to the rate.
+  FLAGS_disk_hiccup_throttle_background_writes = true;
+  MonoTime start = MonoTime::Now();
+  for (int i = 0; i < 3; i++) {
+    monitor_.ThrottleBackgroundWrite(device, kWriteBytes);
+  }
+  MonoDelta elapsed = MonoTime::Now() - start;
+  ASSERT_GE(elapsed.ToMilliseconds(), 150);
+  ASSERT_GT(CounterValue(METRIC_disk_hiccup_throttle_time), 0);
+}
+
+} // namespace fs
+} // namespace kudu
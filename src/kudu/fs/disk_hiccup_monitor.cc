@@ -0,0 +1,357 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#include "kudu/fs/disk_hiccup_monitor.h"
+
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+
+#include <algorithm>
+#include <deque>
+#include <mutex>
+#include <sstream>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include "kudu/gutil/bind.h"
+#include "kudu/gutil/strings/join.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/atomic.h"
+#include "kudu/util/errno.h"
+#include "kudu/util/flag_tags.h"
+#include "kudu/util/hdr_histogram.h"
+#include "kudu/util/locks.h"
+#include "kudu/util/logging.h"
+#include "kudu/util/url-coding.h"
+#include "kudu/util/web_callback_registry.h"
+
+DEFINE_int32(disk_hiccup_threshold_ms, 100,
+             "An fsync or write to a disk taking at least this many milliseconds "
+             "is counted as a hiccup of the disk.");
+TAG_FLAG(disk_hiccup_threshold_ms, advanced);
+TAG_FLAG(disk_hiccup_threshold_ms, runtime);
+
+DEFINE_int32(disk_hiccup_window_secs, 60,
+             "The window over which the hiccups of a disk are counted to tell "
+             "whether it hiccups persistently.");
+TAG_FLAG(disk_hiccup_window_secs, advanced);
+TAG_FLAG(disk_hiccup_window_secs, runtime);
+
+DEFINE_int32(disk_hiccup_persistent_count, 5,
+             "The number of hiccups within --disk_hiccup_window_secs from which "
+             "a disk is considered to hiccup persistently.");
+TAG_FLAG(disk_hiccup_persistent_count, advanced);
+TAG_FLAG(disk_hiccup_persistent_count, runtime);
+
+DEFINE_bool(disk_hiccup_throttle_background_writes, false,
+            "Whether to throttle the writes of data blocks by flushes and "
+            "compactions to the disk of the WAL while that disk hiccups "
+            "persistently, so that WAL fsyncs are not stuck behind their "
+            "writeback.");
+TAG_FLAG(disk_hiccup_throttle_background_writes, experimental);
+TAG_FLAG(disk_hiccup_throttle_background_writes, runtime);
+
+DEFINE_int32(disk_hiccup_throttled_write_mb_per_sec, 32,
+             "The rate to which the writes of data blocks are throttled "
+             "when --disk_hiccup_throttle_background_writes applies.");
+TAG_FLAG(disk_hiccup_throttled_write_mb_per_sec, experimental);
+TAG_FLAG(disk_hiccup_throttled_write_mb_per_sec, runtime);
+
+METRIC_DEFINE_counter(server, disk_hiccups,
+                      "Disk Hiccups",
+                      kudu::MetricUnit::kOperations,
+                      "Number of fsyncs and writes to the WAL and data disks "
+                      "which took at least --disk_hiccup_threshold_ms");
+
+METRIC_DEFINE_counter(server, disk_hiccup_throttle_time,
+                      "Disk Hiccup Throttle Time",
+                      kudu::MetricUnit::kMicroseconds,
+                      "Time that writes of data blocks were delayed because the "
+                      "disk of the WAL hiccuped persistently");
+
+METRIC_DEFINE_gauge_uint32(server, disks_hiccuping_persistently,
+                           "Disks Hiccuping Persistently",
+                           kudu::MetricUnit::kUnits,
+                           "Number of WAL and data disks which currently hiccup "
+                           "persistently");
+
+using std::string;
+using std::unique_ptr;
+using std::vector;
+using strings::Substitute;
+
+namespace kudu {
+namespace fs {
+
+// The latencies are tracked up to a minute, with two significant digits.
+static const int64_t kMaxTrackedLatencyUs = 60 * 1000 * 1000;
+static const int kNumSignificantDigits = 2;
+
+// The statistics of one block device.
+class DiskHiccupMonitor::Device {
+ public:
+  explicit Device(dev_t dev)
+      : dev(dev),
+        name(Substitute("$0:$1", major(dev), minor(dev))),
+        has_wal(false),
+        sync_latency(kMaxTrackedLatencyUs, kNumSignificantDigits),
+        write_latency(kMaxTrackedLatencyUs, kNumSignificantDigits),
+        num_hiccups(0),
+        throttle_time_us(0),
+        hiccuping_persistently(false) {
+  }
+
+  const dev_t dev;
+  const string name;
+
+  // The roots on the device, and whether the WAL root is one of them. Set
+  // by Init().
+  vector<string> roots;
+  bool has_wal;
+
+  HdrHistogram sync_latency;
+  HdrHistogram write_latency;
+  AtomicInt<int64_t> num_hiccups;
+  AtomicInt<int64_t> throttle_time_us;
+
+  simple_spinlock lock;
+  // Protected by 'lock'. The times of the hiccups within the window.
+  std::deque<MonoTime> recent_hiccups;
+  // Protected by 'lock'. Whether the device was found to hiccup
+  // persistently the last time it was checked.
+  bool hiccuping_persistently;
+  // Protected by 'lock'. The time from which the next throttled write may
+  // start.
+  MonoTime next_write_time;
+};
+
+DiskHiccupMonitor::DiskHiccupMonitor(const scoped_refptr<MetricEntity>& metric_entity)
+    : wal_device_(nullptr),
+      metric_entity_(metric_entity) {
+  if (metric_entity_) {
+    hiccups_ = METRIC_disk_hiccups.Instantiate(metric_entity_);
+    throttle_time_ = METRIC_disk_hiccup_throttle_time.Instantiate(metric_entity_);
+  }
+}
+
+DiskHiccupMonitor::~DiskHiccupMonitor() {
+}
+
+Status DiskHiccupMonitor::Init(const string& wal_root, const vector<string>& data_roots) {
+  CHECK(devices_.empty()) << "Already initialized";
+  vector<string> roots = data_roots;
+  roots.push_back(wal_root);
+  for (const string& root : roots) {
+    struct stat st;
+    if (stat(root.c_str(), &st) != 0) {
+      int err = errno;
+      return Status::IOError(Substitute("Could not stat $0", root), ErrnoToString(err), err);
+    }
+    auto it = std::find_if(devices_.begin(), devices_.end(),
+                           [&](const unique_ptr<Device>& d) { return d->dev == st.st_dev; });
+    Device* device;
+    if (it == devices_.end()) {
+      devices_.emplace_back(new Device(st.st_dev));
+      device = devices_.back().get();
+    } else {
+      device = it->get();
+    }
+    if (std::find(device->roots.begin(), device->roots.end(), root) == device->roots.end()) {
+      device->roots.push_back(root);
+    }
+    if (root == wal_root) {
+      device->has_wal = true;
+      wal_device_ = device;
+    }
+  }
+  for (const auto& device : devices_) {
+    VLOG(1) << "Disk " << device->name << ": " << JoinStrings(device->roots, ", ");
+  }
+  if (metric_entity_) {
+    METRIC_disks_hiccuping_persistently.InstantiateFunctionGauge(
+        metric_entity_, Bind(&DiskHiccupMonitor::NumDevicesHiccupingPersistently,
+                             Unretained(this)))
+        ->AutoDetach(&metric_detacher_);
+  }
+  return Status::OK();
+}
+
+DiskHiccupMonitor::Device* DiskHiccupMonitor::FindDevice(const string& path) const {
+  for (const auto& device : devices_) {
+    for (const string& root : device->roots) {
+      if (path.compare(0, root.size(), root) == 0 &&
+          (path.size() == root.size() || path[root.size()] == '/')) {
+        return device.get();
+      }
+    }
+  }
+  return nullptr;
+}
+
+void DiskHiccupMonitor::RecordLatency(Device* device, OpType type, const MonoDelta& latency) {
+  if (device == nullptr) {
+    return;
+  }
+  int64_t us = std::min(std::max<int64_t>(latency.ToMicroseconds(), 0), kMaxTrackedLatencyUs);
+  (type == kSync ? device->sync_latency : device->write_latency).Increment(us);
+  if (us < FLAGS_disk_hiccup_threshold_ms * 1000L) {
+    return;
+  }
+
+  device->num_hiccups.Increment();
+  if (hiccups_) {
+    hiccups_->Increment();
+  }
+  KLOG_EVERY_N_SECS(WARNING, 10) << Substitute(
+      "$0 on disk $1 ($2) took $3", type == kSync ? "Fsync" : "Write", device->name,
+      JoinStrings(device->roots, ", "), latency.ToString());
+
+  MonoTime now = MonoTime::Now();
+  {
+    std::lock_guard<simple_spinlock> l(device->lock);
+    device->recent_hiccups.push_back(now);
+  }
+  UpdateHiccupState(device, now);
+}
+
+bool DiskHiccupMonitor::UpdateHiccupState(Device* device, const MonoTime& now) {
+  MonoTime window_start = now - MonoDelta::FromSeconds(FLAGS_disk_hiccup_window_secs);
+  std::lock_guard<simple_spinlock> l(device->lock);
+  while (!device->recent_hiccups.empty() && device->recent_hiccups.front() < window_start) {
+    device->recent_hiccups.pop_front();
+  }
+  bool persistent = FLAGS_disk_hiccup_persistent_count > 0 &&
+      device->recent_hiccups.size() >= static_cast<size_t>(FLAGS_disk_hiccup_persistent_count);
+  if (persistent != device->hiccuping_persistently) {
+    device->hiccuping_persistently = persistent;
+    if (persistent) {
+      LOG(WARNING) << Substitute(
+          "Disk $0 ($1) is hiccuping persistently: $2 fsyncs or writes took at least $3ms "
+          "in the last $4s$5", device->name, JoinStrings(device->roots, ", "),
+          device->recent_hiccups.size(), FLAGS_disk_hiccup_threshold_ms,
+          FLAGS_disk_hiccup_window_secs,
+          device->has_wal && device->roots.size() > 1 &&
+          FLAGS_disk_hiccup_throttle_background_writes ?
+          "; throttling the writes of data blocks to it" : "");
+    } else {
+      LOG(INFO) << Substitute("Disk $0 ($1) is no longer hiccuping persistently",
+                              device->name, JoinStrings(device->roots, ", "));
+    }
+  }
+  return persistent;
+}
+
+void DiskHiccupMonitor::ThrottleBackgroundWrite(Device* device, int64_t bytes) {
+  if (!FLAGS_disk_hiccup_throttle_background_writes ||
+      FLAGS_disk_hiccup_throttled_write_mb_per_sec <= 0 ||
+      device == nullptr || !device->has_wal) {
+    return;
+  }
+  MonoTime now = MonoTime::Now();
+  if (!UpdateHiccupState(device, now)) {
+    return;
+  }
+
+  // Space the writes out so that they proceed at the throttled rate.
+  int64_t bytes_per_sec = FLAGS_disk_hiccup_throttled_write_mb_per_sec * 1024L * 1024L;
+  MonoTime start;
+  {
+    std::lock_guard<simple_spinlock> l(device->lock);
+    if (!device->next_write_time.Initialized() || device->next_write_time < now) {
+      device->next_write_time = now;
+    }
+    start = device->next_write_time;
+    device->next_write_time += MonoDelta::FromMicroseconds(bytes * 1000000 / bytes_per_sec);
+  }
+  if (start > now) {
+    MonoDelta delay = start - now;
+    SleepFor(delay);
+    device->throttle_time_us.IncrementBy(delay.ToMicroseconds());
+    if (throttle_time_) {
+      throttle_time_->IncrementBy(delay.ToMicroseconds());
+    }
+  }
+}
+
+uint32_t DiskHiccupMonitor::NumDevicesHiccupingPersistently() {
+  MonoTime now = MonoTime::Now();
+  uint32_t n = 0;
+  for (const auto& device : devices_) {
+    if (UpdateHiccupState(device.get(), now)) {
+      n++;
+    }
+  }
+  return n;
+}
+
+void DiskHiccupMonitor::RegisterPathHandler(WebCallbackRegistry* web) {
+  auto handler = [this](const WebCallbackRegistry::WebRequest& req,
+                        std::ostringstream* output) {
+    MonoTime now = MonoTime::Now();
+    *output << "<h1>Disk hiccups</h1>\n";
+    *output << Substitute("<p>A hiccup is an fsync or write taking at least $0ms. A disk "
+                          "hiccups persistently after $1 hiccups within $2s.</p>\n",
+                          FLAGS_disk_hiccup_threshold_ms, FLAGS_disk_hiccup_persistent_count,
+                          FLAGS_disk_hiccup_window_secs);
+    *output << "<table class='table table-striped'>\n";
+    *output << "  <tr><th>Disk</th><th>Roots</th><th>Hiccups</th><th>Recent hiccups</th>"
+               "<th>Hiccuping persistently</th><th>Operation</th><th>Count</th>"
+               "<th>p50 (us)</th><th>p99 (us)</th><th>p99.9 (us)</th><th>Max (us)</th>"
+               "<th>Throttle time (us)</th></tr>\n";
+    for (const auto& device : devices_) {
+      bool persistent = UpdateHiccupState(device.get(), now);
+      size_t recent;
+      {
+        std::lock_guard<simple_spinlock> l(device->lock);
+        recent = device->recent_hiccups.size();
+      }
+      vector<string> roots;
+      for (const string& root : device->roots) {
+        roots.push_back(EscapeForHtmlToString(root) +
+                        (device->has_wal && root == device->roots.back() ? " (WAL)" : ""));
+      }
+      const HdrHistogram* hists[] = { &device->sync_latency, &device->write_latency };
+      for (int i = 0; i < 2; i++) {
+        // Copy the histogram so that the percentiles are consistent.
+        HdrHistogram h(*hists[i]);
+        *output << "  <tr>";
+        if (i == 0) {
+          *output << Substitute("<td rowspan='2'>$0</td><td rowspan='2'>$1</td>"
+                                "<td rowspan='2'>$2</td><td rowspan='2'>$3</td>"
+                                "<td rowspan='2'>$4</td>",
+                                device->name, JoinStrings(roots, "<br>"),
+                                device->num_hiccups.Load(), recent,
+                                persistent ? "yes" : "no");
+        }
+        *output << Substitute("<td>$0</td><td>$1</td><td>$2</td><td>$3</td><td>$4</td>"
+                              "<td>$5</td>",
+                              i == 0 ? "fsync" : "write", h.TotalCount(),
+                              h.ValueAtPercentile(50), h.ValueAtPercentile(99),
+                              h.ValueAtPercentile(99.9), h.MaxValue());
+        if (i == 0) {
+          *output << Substitute("<td rowspan='2'>$0</td>", device->throttle_time_us.Load());
+        }
+        *output << "</tr>\n";
+      }
+    }
+    *output << "</table>\n";
+  };
+  web->RegisterPathHandler("/disk-hiccups", "Disk Hiccups", handler, true, false);
+}
+
+} // namespace fs
+} // namespace kudu
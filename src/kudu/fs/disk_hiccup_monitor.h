@@ -0,0 +1,105 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "kudu/gutil/macros.h"
+#include "kudu/gutil/ref_counted.h"
+#include "kudu/util/metrics.h"
+#include "kudu/util/monotime.h"
+#include "kudu/util/status.h"
+
+namespace kudu {
+
+class WebCallbackRegistry;
+
+namespace fs {
+
+// Watches the latency of the fsyncs and writes made to the block devices of
+// the filesystem roots, looking for hiccups: single operations which take
+// at least --disk_hiccup_threshold_ms, typically because the device is busy
+// writing back a burst of dirty pages. A device hiccups persistently while
+// it had at least --disk_hiccup_persistent_count hiccups within the last
+// --disk_hiccup_window_secs.
+//
+// WAL fsyncs are on the write path, so when the device of the WAL hiccups
+// persistently and is shared with data roots, the writes of data blocks to
+// it, which flushes and compactions make, may be throttled to let the
+// fsyncs through (see --disk_hiccup_throttle_background_writes).
+//
+// The roots on the same device share its statistics. All methods are
+// thread-safe, but no device is found until Init() returns.
+class DiskHiccupMonitor {
+ public:
+  // The operations whose latency is recorded.
+  enum OpType {
+    kSync,
+    kWrite
+  };
+
+  class Device;
+
+  // 'metric_entity' may be NULL, in which case no metrics are produced.
+  explicit DiskHiccupMonitor(const scoped_refptr<MetricEntity>& metric_entity);
+  ~DiskHiccupMonitor();
+
+  // Finds the devices of 'wal_root' and 'data_roots', which must exist.
+  Status Init(const std::string& wal_root, const std::vector<std::string>& data_roots);
+
+  // Returns the device of the root which 'path' is in, or NULL if there is
+  // none.
+  Device* FindDevice(const std::string& path) const;
+
+  // Returns the device of the WAL root, or NULL before Init().
+  Device* wal_device() const { return wal_device_; }
+
+  // Records that an operation on 'device' took 'latency'. Does nothing if
+  // 'device' is NULL.
+  void RecordLatency(Device* device, OpType type, const MonoDelta& latency);
+
+  // Called before writing 'bytes' of data blocks to 'device', which may be
+  // NULL. If the writes may be throttled, sleeps as needed to keep them
+  // under --disk_hiccup_throttled_write_mb_per_sec.
+  void ThrottleBackgroundWrite(Device* device, int64_t bytes);
+
+  // Registers a page describing each device with 'web'.
+  void RegisterPathHandler(WebCallbackRegistry* web);
+
+ private:
+  // Returns whether 'device' currently hiccups persistently, and logs when
+  // it starts or stops doing so.
+  bool UpdateHiccupState(Device* device, const MonoTime& now);
+
+  uint32_t NumDevicesHiccupingPersistently();
+
+  // Set by Init(). The devices are never modified after that.
+  std::vector<std::unique_ptr<Device>> devices_;
+  Device* wal_device_;
+
+  scoped_refptr<Counter> hiccups_;
+  scoped_refptr<Counter> throttle_time_;
+  FunctionGaugeDetacher metric_detacher_;
+  scoped_refptr<MetricEntity> metric_entity_;
+
+  DISALLOW_COPY_AND_ASSIGN(DiskHiccupMonitor);
+};
+
+} // namespace fs
+} // namespace kudu
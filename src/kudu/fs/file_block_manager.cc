@@ -24,6 +24,7 @@
 
 #include "kudu/fs/block_manager_metrics.h"
 #include "kudu/fs/block_manager_util.h"
+#include "kudu/fs/disk_hiccup_monitor.h"
 #include "kudu/fs/fs.pb.h"
 #include "kudu/gutil/map-util.h"
 #include "kudu/gutil/strings/join.h"
@@ -258,6 +259,9 @@ class FileWritableBlock : public WritableBlock {
   // The number of bytes successfully appended to the block.
   size_t bytes_appended_;
 
+  // The device of the block's root path, or NULL if unknown.
+  DiskHiccupMonitor::Device* device_;
+
   DISALLOW_COPY_AND_ASSIGN(FileWritableBlock);
 };
 
@@ -268,7 +272,11 @@ FileWritableBlock::FileWritableBlock(FileBlockManager* block_manager,
       location_(std::move(location)),
       writer_(std::move(writer)),
       state_(CLEAN),
-      bytes_appended_(0) {
+      bytes_appended_(0),
+      device_(nullptr) {
+  if (block_manager_->disk_hiccup_monitor_) {
+    device_ = block_manager_->disk_hiccup_monitor_->FindDevice(location_.root_path());
+  }
   if (block_manager_->metrics_) {
     block_manager_->metrics_->blocks_open_writing->Increment();
     block_manager_->metrics_->total_writable_blocks->Increment();
@@ -303,7 +311,15 @@ Status FileWritableBlock::Append(const Slice& data) {
   DCHECK(state_ == CLEAN || state_ == DIRTY)
       << "Invalid state: " << state_;
 
+  DiskHiccupMonitor* monitor = block_manager_->disk_hiccup_monitor_;
+  if (monitor) {
+    monitor->ThrottleBackgroundWrite(device_, data.size());
+  }
+  MonoTime start = MonoTime::Now();
   RETURN_NOT_OK(writer_->Append(data));
+  if (monitor) {
+    monitor->RecordLatency(device_, DiskHiccupMonitor::kWrite, MonoTime::Now() - start);
+  }
   state_ = DIRTY;
   bytes_appended_ += data.size();
   return Status::OK();
@@ -340,7 +356,12 @@ Status FileWritableBlock::Close(SyncMode mode) {
     // Safer to synchronize data first, then metadata.
     VLOG(3) << "Syncing block " << id();
     if (FLAGS_enable_data_block_fsync) {
+      MonoTime start = MonoTime::Now();
       sync = writer_->Sync();
+      if (sync.ok() && block_manager_->disk_hiccup_monitor_) {
+        block_manager_->disk_hiccup_monitor_->RecordLatency(
+            device_, DiskHiccupMonitor::kSync, MonoTime::Now() - start);
+      }
     }
     if (sync.ok()) {
       sync = block_manager_->SyncMetadata(location_);
@@ -386,6 +407,11 @@ class FileReadableBlock : public ReadableBlock {
   virtual Status Read(uint64_t offset, size_t length,
                       Slice* result, uint8_t* scratch) const OVERRIDE;
 
+  virtual Status Prefetch(uint64_t offset, size_t length) const OVERRIDE;
+
+  virtual Status ReadZeroCopy(uint64_t offset, size_t length, Slice* result,
+                              std::shared_ptr<const void>* pin) const OVERRIDE;
+
   virtual size_t memory_footprint() const OVERRIDE;
 
  private:
@@ -456,6 +482,17 @@ Status FileReadableBlock::Read(uint64_t offset, size_t length,
   return Status::OK();
 }
 
+Status FileReadableBlock::Prefetch(uint64_t offset, size_t length) const {
+  DCHECK(!closed_.Load());
+
+  return reader_->Prefetch(offset, length);
+}
+
+Status FileReadableBlock::ReadZeroCopy(uint64_t offset, size_t length, Slice* result,
+                                       std::shared_ptr<const void>* pin) const {
+  return Status::NotSupported("Zero-copy reads not supported by the file block manager");
+}
+
 size_t FileReadableBlock::memory_footprint() const {
   DCHECK(reader_);
   return kudu_malloc_usable_size(this) + reader_->memory_footprint();
@@ -513,7 +550,8 @@ FileBlockManager::FileBlockManager(Env* env, const BlockManagerOptions& opts)
     next_block_id_(rand_.Next64()),
     mem_tracker_(MemTracker::CreateTracker(-1,
                                            "file_block_manager",
-                                           opts.parent_mem_tracker)) {
+                                           opts.parent_mem_tracker)),
+    disk_hiccup_monitor_(opts.disk_hiccup_monitor) {
   DCHECK_GT(root_paths_.size(), 0);
   if (opts.metric_entity) {
     metrics_.reset(new internal::BlockManagerMetrics(opts.metric_entity));
@@ -749,6 +787,21 @@ Status FileBlockManager::DeleteBlock(const BlockId& block_id) {
   return Status::OK();
 }
 
+Status FileBlockManager::DeleteBlocks(const vector<BlockId>& block_ids,
+                                      vector<BlockId>* deleted) {
+  // Each block is its own file, so there's nothing to batch.
+  Status first_error;
+  for (const BlockId& block_id : block_ids) {
+    Status s = DeleteBlock(block_id);
+    if (s.ok() || s.IsNotFound()) {
+      deleted->push_back(block_id);
+    } else if (first_error.ok()) {
+      first_error = s;
+    }
+  }
+  return first_error;
+}
+
 Status FileBlockManager::CloseBlocks(const vector<WritableBlock*>& blocks) {
   VLOG(3) << "Closing " << blocks.size() << " blocks";
   if (FLAGS_block_coalesce_close) {
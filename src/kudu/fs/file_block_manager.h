@@ -90,6 +90,9 @@ class FileBlockManager : public BlockManager {
 
   virtual Status DeleteBlock(const BlockId& block_id) OVERRIDE;
 
+  virtual Status DeleteBlocks(const std::vector<BlockId>& block_ids,
+                              std::vector<BlockId>* deleted) OVERRIDE;
+
   virtual Status CloseBlocks(const std::vector<WritableBlock*>& blocks) OVERRIDE;
 
  private:
@@ -146,6 +149,9 @@ class FileBlockManager : public BlockManager {
   // interesting.
   std::shared_ptr<MemTracker> mem_tracker_;
 
+  // Not owned. May be null.
+  DiskHiccupMonitor* const disk_hiccup_monitor_;
+
   DISALLOW_COPY_AND_ASSIGN(FileBlockManager);
 };
 
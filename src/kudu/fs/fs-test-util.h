@@ -66,6 +66,17 @@ class CountingReadableBlock : public ReadableBlock {
     return Status::OK();
   }
 
+  virtual Status Prefetch(uint64_t offset, size_t length) const OVERRIDE {
+    return block_->Prefetch(offset, length);
+  }
+
+  virtual Status ReadZeroCopy(uint64_t offset, size_t length, Slice* result,
+                              std::shared_ptr<const void>* pin) const OVERRIDE {
+    RETURN_NOT_OK(block_->ReadZeroCopy(offset, length, result, pin));
+    *bytes_read_ += length;
+    return Status::OK();
+  }
+
   virtual size_t memory_footprint() const OVERRIDE {
     return block_->memory_footprint();
   }
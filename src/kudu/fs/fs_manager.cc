@@ -28,6 +28,7 @@
 #include <google/protobuf/message.h>
 
 #include "kudu/fs/block_id.h"
+#include "kudu/fs/disk_hiccup_monitor.h"
 #include "kudu/fs/file_block_manager.h"
 #include "kudu/fs/fs.pb.h"
 #include "kudu/fs/log_block_manager.h"
@@ -76,6 +77,7 @@ using google::protobuf::Message;
 using kudu::env_util::ScopedFileDeleter;
 using kudu::fs::BlockManagerOptions;
 using kudu::fs::CreateBlockOptions;
+using kudu::fs::DiskHiccupMonitor;
 using kudu::fs::FileBlockManager;
 using kudu::fs::LogBlockManager;
 using kudu::fs::ReadableBlock;
@@ -92,6 +94,7 @@ namespace kudu {
 const char *FsManager::kWalDirName = "wals";
 const char *FsManager::kWalFileNamePrefix = "wal";
 const char *FsManager::kWalsRecoveryDirSuffix = ".recovery";
+const char *FsManager::kMrsCheckpointSuffix = ".mrs-checkpoint";
 const char *FsManager::kTabletMetadataDirName = "tablet-meta";
 const char *FsManager::kDataDirName = "data";
 const char *FsManager::kCorruptedSuffix = ".corrupted";
@@ -210,8 +213,11 @@ Status FsManager::Init() {
 }
 
 void FsManager::InitBlockManager() {
+  disk_hiccup_monitor_.reset(new DiskHiccupMonitor(metric_entity_));
+
   BlockManagerOptions opts;
   opts.metric_entity = metric_entity_;
+  opts.disk_hiccup_monitor = disk_hiccup_monitor_.get();
   opts.parent_mem_tracker = parent_mem_tracker_;
   opts.root_paths = GetDataRootDirs();
   opts.read_only = read_only_;
@@ -239,6 +245,12 @@ Status FsManager::Open() {
     }
   }
 
+  // Not being able to tell the disks apart only costs their monitoring.
+  vector<string> data_roots(canonicalized_data_fs_roots_.begin(),
+                            canonicalized_data_fs_roots_.end());
+  WARN_NOT_OK(disk_hiccup_monitor_->Init(canonicalized_wal_fs_root_, data_roots),
+              "Could not find the disks of the filesystem roots");
+
   RETURN_NOT_OK(block_manager_->Open());
   LOG(INFO) << "Opened local filesystem: " << JoinStrings(canonicalized_all_fs_roots_, ",")
             << std::endl << metadata_->DebugString();
@@ -441,6 +453,12 @@ string FsManager::GetTabletWalRecoveryDir(const string& tablet_id) const {
   return path;
 }
 
+string FsManager::GetTabletMrsCheckpointPath(const string& tablet_id) const {
+  string path = JoinPathSegments(GetWalsRootDir(), tablet_id);
+  StrAppend(&path, kMrsCheckpointSuffix);
+  return path;
+}
+
 string FsManager::GetWalSegmentFileName(const string& tablet_id,
                                         uint64_t sequence_number) const {
   return JoinPathSegments(GetTabletWalDir(tablet_id),
@@ -498,6 +516,13 @@ Status FsManager::CreateNewBlock(gscoped_ptr<WritableBlock>* block) {
   return block_manager_->CreateBlock(block);
 }
 
+Status FsManager::CreateNewBlock(const CreateBlockOptions& opts,
+                                 gscoped_ptr<WritableBlock>* block) {
+  CHECK(!read_only_);
+
+  return block_manager_->CreateBlock(opts, block);
+}
+
 Status FsManager::OpenBlock(const BlockId& block_id, gscoped_ptr<ReadableBlock>* block) {
   return block_manager_->OpenBlock(block_id, block);
 }
@@ -508,6 +533,13 @@ Status FsManager::DeleteBlock(const BlockId& block_id) {
   return block_manager_->DeleteBlock(block_id);
 }
 
+Status FsManager::DeleteBlocks(const vector<BlockId>& block_ids,
+                               vector<BlockId>* deleted) {
+  CHECK(!read_only_);
+
+  return block_manager_->DeleteBlocks(block_ids, deleted);
+}
+
 bool FsManager::BlockExists(const BlockId& block_id) const {
   gscoped_ptr<ReadableBlock> block;
   return block_manager_->OpenBlock(block_id, &block).ok();
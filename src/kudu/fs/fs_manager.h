@@ -47,8 +47,10 @@ class MetricEntity;
 
 namespace fs {
 class BlockManager;
+class DiskHiccupMonitor;
 class ReadableBlock;
 class WritableBlock;
+struct CreateBlockOptions;
 } // namespace fs
 
 namespace itest {
@@ -96,6 +98,7 @@ class FsManager {
  public:
   static const char *kWalFileNamePrefix;
   static const char *kWalsRecoveryDirSuffix;
+  static const char *kMrsCheckpointSuffix;
 
   // Only for unit tests.
   FsManager(Env* env, const std::string& root_path);
@@ -131,11 +134,19 @@ class FsManager {
   // Block will be synced on close.
   Status CreateNewBlock(gscoped_ptr<fs::WritableBlock>* block);
 
+  // Like CreateNewBlock() above, but with placement hints in 'opts'.
+  Status CreateNewBlock(const fs::CreateBlockOptions& opts,
+                        gscoped_ptr<fs::WritableBlock>* block);
+
   Status OpenBlock(const BlockId& block_id,
                    gscoped_ptr<fs::ReadableBlock>* block);
 
   Status DeleteBlock(const BlockId& block_id);
 
+  // See BlockManager::DeleteBlocks().
+  Status DeleteBlocks(const std::vector<BlockId>& block_ids,
+                      std::vector<BlockId>* deleted);
+
   bool BlockExists(const BlockId& block_id) const;
 
   // ==========================================================================
@@ -154,6 +165,10 @@ class FsManager {
 
   std::string GetTabletWalRecoveryDir(const std::string& tablet_id) const;
 
+  // Return the path of the MemRowSet checkpoint of the given tablet. See
+  // Tablet::CheckpointMemRowSet().
+  std::string GetTabletMrsCheckpointPath(const std::string& tablet_id) const;
+
   std::string GetWalSegmentFileName(const std::string& tablet_id,
                                     uint64_t sequence_number) const;
 
@@ -203,6 +218,12 @@ class FsManager {
     return block_manager_.get();
   }
 
+  // Returns the monitor of the latency of the WAL and data disks. Never NULL
+  // after Init(), though it only knows the disks once Open() succeeds.
+  fs::DiskHiccupMonitor* disk_hiccup_monitor() {
+    return disk_hiccup_monitor_.get();
+  }
+
  private:
   FRIEND_TEST(FsManagerTestBase, TestDuplicatePaths);
   friend class itest::ExternalMiniClusterFsInspector; // for access to directory names
@@ -273,6 +294,8 @@ class FsManager {
 
   gscoped_ptr<InstanceMetadataPB> metadata_;
 
+  gscoped_ptr<fs::DiskHiccupMonitor> disk_hiccup_monitor_;
+
   gscoped_ptr<fs::BlockManager> block_manager_;
 
   bool initted_;
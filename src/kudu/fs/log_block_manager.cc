@@ -22,11 +22,14 @@
 
 #include "kudu/fs/block_manager_metrics.h"
 #include "kudu/fs/block_manager_util.h"
+#include "kudu/fs/disk_hiccup_monitor.h"
 #include "kudu/gutil/callback.h"
+#include "kudu/gutil/hash/city.h"
 #include "kudu/gutil/map-util.h"
 #include "kudu/gutil/strings/strcat.h"
 #include "kudu/gutil/strings/strip.h"
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/gutil/strings/util.h"
 #include "kudu/gutil/walltime.h"
 #include "kudu/util/alignment.h"
 #include "kudu/util/atomic.h"
@@ -77,6 +80,50 @@ DEFINE_int64(fs_data_dirs_reserved_bytes, 0,
 TAG_FLAG(fs_data_dirs_reserved_bytes, runtime);
 TAG_FLAG(fs_data_dirs_reserved_bytes, evolving);
 
+DEFINE_int32(fs_target_data_dirs_per_tablet, 0,
+             "Number of data directories across which the blocks of each tablet are "
+             "spread. Confining a tablet to a subset of the directories limits the "
+             "number of disks a busy tablet competes for. Set to 0 to spread every "
+             "tablet across all data directories. Only honored by the log block "
+             "manager.");
+TAG_FLAG(fs_target_data_dirs_per_tablet, advanced);
+TAG_FLAG(fs_target_data_dirs_per_tablet, evolving);
+
+DEFINE_int64(log_block_manager_eviction_chunk_bytes, 8 * 1024 * 1024,
+             "For blocks written with page cache eviction, the number of bytes "
+             "appended between starting writeback of the new data and dropping "
+             "the previously written back data from the page cache");
+TAG_FLAG(log_block_manager_eviction_chunk_bytes, advanced);
+TAG_FLAG(log_block_manager_eviction_chunk_bytes, experimental);
+
+DEFINE_bool(log_block_manager_mmap_reads, false,
+            "Whether readers that don't need their own copy of a block's data, "
+            "such as CFile reads that bypass the block cache, may map it into "
+            "memory instead of copying it. Most useful on fast local storage, "
+            "where the copy is a significant part of the cost of a read.");
+TAG_FLAG(log_block_manager_mmap_reads, advanced);
+TAG_FLAG(log_block_manager_mmap_reads, experimental);
+
+DEFINE_double(log_container_metadata_compact_dead_ratio, 0.5,
+              "When opening a log block container, rewrite its metadata file to "
+              "contain only the records of live blocks if at least this fraction of "
+              "its records describe deleted blocks. Set to a value above 1 to "
+              "disable metadata compaction");
+TAG_FLAG(log_container_metadata_compact_dead_ratio, advanced);
+TAG_FLAG(log_container_metadata_compact_dead_ratio, evolving);
+
+DEFINE_int32(log_container_metadata_compact_min_records, 1000,
+             "Minimum number of records in a log block container's metadata file "
+             "before it is considered for compaction at startup");
+TAG_FLAG(log_container_metadata_compact_min_records, advanced);
+TAG_FLAG(log_container_metadata_compact_min_records, evolving);
+
+DEFINE_bool(log_block_manager_delete_dead_containers, true,
+            "Whether to delete full log block containers that no longer contain "
+            "any live blocks when the block manager is opened");
+TAG_FLAG(log_block_manager_delete_dead_containers, advanced);
+TAG_FLAG(log_block_manager_delete_dead_containers, evolving);
+
 METRIC_DEFINE_gauge_uint64(server, log_block_manager_bytes_under_management,
                            "Bytes Under Management",
                            kudu::MetricUnit::kBytes,
@@ -108,6 +155,7 @@ using kudu::fs::internal::LogBlock;
 using kudu::fs::internal::LogBlockContainer;
 using kudu::pb_util::ReadablePBContainerFile;
 using kudu::pb_util::WritablePBContainerFile;
+using std::pair;
 using std::unordered_map;
 using std::unordered_set;
 using strings::Substitute;
@@ -214,11 +262,24 @@ class LogBlockContainer {
   Status ReadData(int64_t offset, size_t length,
                   Slice* result, uint8_t* scratch) const;
 
+  // See RWFile::Prefetch().
+  Status PrefetchData(int64_t offset, size_t length) const;
+
+  // See RWFile::DropCache().
+  Status DropCachedData(int64_t offset, size_t length) const;
+
+  // See RWFile::Map().
+  Status MapData(int64_t offset, size_t length, gscoped_ptr<MappedRegion>* region) const;
+
   // Appends 'pb' to this container's metadata file.
   //
   // The on-disk effects of this call are made durable only after SyncMetadata().
   Status AppendMetadata(const BlockRecordPB& pb);
 
+  // Like AppendMetadata() for each record in 'records', but with a single
+  // write to the metadata file.
+  Status AppendMetadata(const vector<BlockRecordPB>& records);
+
   // Asynchronously flush this container's data file from 'offset' through
   // to 'length'.
   //
@@ -258,6 +319,14 @@ class LogBlockContainer {
   // returning the records.
   Status ReadContainerRecords(deque<BlockRecordPB>* records) const;
 
+  // Rewrites the container's metadata file so that it only contains 'records'.
+  //
+  // The new file is written and synchronized alongside the old one and then
+  // atomically renamed over it, so a crash at any point leaves behind either
+  // the old metadata or the compacted metadata. Must only be called while the
+  // container is not yet visible to other threads.
+  Status CompactMetadata(const deque<BlockRecordPB>& records);
+
   // Updates 'total_bytes_written_', marking this container as full if
   // needed. Should only be called when a block is fully written, as it
   // will round up the container data file's position.
@@ -326,6 +395,9 @@ class LogBlockContainer {
 
   const PathInstanceMetadataPB* instance_;
 
+  // The device of the container's root path, or NULL if unknown.
+  DiskHiccupMonitor::Device* const device_;
+
   DISALLOW_COPY_AND_ASSIGN(LogBlockContainer);
 };
 
@@ -339,7 +411,9 @@ LogBlockContainer::LogBlockContainer(
       metadata_pb_writer_(std::move(metadata_writer)),
       data_file_(std::move(data_file)),
       metrics_(block_manager->metrics()),
-      instance_(instance) {}
+      instance_(instance),
+      device_(block_manager->disk_hiccup_monitor() ?
+              block_manager->disk_hiccup_monitor()->FindDevice(root_path_) : nullptr) {}
 
 Status LogBlockContainer::Create(LogBlockManager* block_manager,
                                  PathInstanceMetadataPB* instance,
@@ -524,6 +598,44 @@ Status LogBlockContainer::ReadContainerRecords(deque<BlockRecordPB>* records) co
   return read_status;
 }
 
+Status LogBlockContainer::CompactMetadata(const deque<BlockRecordPB>& records) {
+  Env* env = block_manager()->env();
+  string metadata_path = MetadataFilePath();
+  string tmp_path = StrCat(metadata_path, LogBlockManager::kContainerTmpFileSuffix);
+
+  gscoped_ptr<RWFile> tmp_file;
+  RWFileOptions opts;
+  opts.mode = Env::CREATE_IF_NON_EXISTING_TRUNCATE;
+  RETURN_NOT_OK(env->NewRWFile(opts, tmp_path, &tmp_file));
+  ScopedFileDeleter tmp_deleter(env, tmp_path);
+
+  WritablePBContainerFile tmp_writer(std::move(tmp_file));
+  RETURN_NOT_OK(tmp_writer.Init(BlockRecordPB()));
+  for (const BlockRecordPB& r : records) {
+    RETURN_NOT_OK(tmp_writer.Append(r));
+  }
+  RETURN_NOT_OK(tmp_writer.Sync());
+  RETURN_NOT_OK(tmp_writer.Close());
+
+  {
+    MutexLock l(metadata_pb_writer_lock_);
+    RETURN_NOT_OK(env->RenameFile(tmp_path, metadata_path));
+    tmp_deleter.Cancel();
+    RETURN_NOT_OK(env->SyncDir(dir()));
+
+    // The old writer still refers to the replaced file; point it at the
+    // compacted one so that future appends land in the right place.
+    RETURN_NOT_OK(metadata_pb_writer_->Close());
+    gscoped_ptr<RWFile> metadata_file;
+    opts.mode = Env::OPEN_EXISTING;
+    RETURN_NOT_OK(env->NewRWFile(opts, metadata_path, &metadata_file));
+    metadata_pb_writer_.reset(new WritablePBContainerFile(std::move(metadata_file)));
+    RETURN_NOT_OK(metadata_pb_writer_->Reopen());
+  }
+  VLOG(1) << "Compacted metadata of log block container " << ToString();
+  return Status::OK();
+}
+
 void LogBlockContainer::CheckBlockRecord(const BlockRecordPB& record,
                                          uint64_t data_file_size) const {
   if (record.op_type() == CREATE &&
@@ -588,8 +700,17 @@ Status LogBlockContainer::DeleteBlock(int64_t offset, int64_t length) {
 Status LogBlockContainer::WriteData(int64_t offset, const Slice& data) {
   DCHECK_GE(offset, 0);
 
+  DiskHiccupMonitor* monitor = block_manager_->disk_hiccup_monitor();
+  if (monitor) {
+    monitor->ThrottleBackgroundWrite(device_, data.size());
+  }
   std::lock_guard<Mutex> l(data_writer_lock_);
-  return data_file_->Write(offset, data);
+  MonoTime start = MonoTime::Now();
+  RETURN_NOT_OK(data_file_->Write(offset, data));
+  if (monitor) {
+    monitor->RecordLatency(device_, DiskHiccupMonitor::kWrite, MonoTime::Now() - start);
+  }
+  return Status::OK();
 }
 
 Status LogBlockContainer::ReadData(int64_t offset, size_t length,
@@ -599,6 +720,25 @@ Status LogBlockContainer::ReadData(int64_t offset, size_t length,
   return data_file_->Read(offset, length, result, scratch);
 }
 
+Status LogBlockContainer::PrefetchData(int64_t offset, size_t length) const {
+  DCHECK_GE(offset, 0);
+
+  return data_file_->Prefetch(offset, length);
+}
+
+Status LogBlockContainer::DropCachedData(int64_t offset, size_t length) const {
+  DCHECK_GE(offset, 0);
+
+  return data_file_->DropCache(offset, length);
+}
+
+Status LogBlockContainer::MapData(int64_t offset, size_t length,
+                                  gscoped_ptr<MappedRegion>* region) const {
+  DCHECK_GE(offset, 0);
+
+  return data_file_->Map(offset, length, region);
+}
+
 Status LogBlockContainer::AppendMetadata(const BlockRecordPB& pb) {
   // Note: We don't check for sufficient disk space for metadata writes in
   // order to allow for block deletion on full disks.
@@ -606,6 +746,16 @@ Status LogBlockContainer::AppendMetadata(const BlockRecordPB& pb) {
   return metadata_pb_writer_->Append(pb);
 }
 
+Status LogBlockContainer::AppendMetadata(const vector<BlockRecordPB>& records) {
+  vector<const google::protobuf::Message*> msgs;
+  msgs.reserve(records.size());
+  for (const BlockRecordPB& record : records) {
+    msgs.push_back(&record);
+  }
+  std::lock_guard<Mutex> l(metadata_pb_writer_lock_);
+  return metadata_pb_writer_->AppendBatch(msgs);
+}
+
 Status LogBlockContainer::FlushData(int64_t offset, int64_t length) {
   DCHECK_GE(offset, 0);
   DCHECK_GE(length, 0);
@@ -622,7 +772,12 @@ Status LogBlockContainer::FlushMetadata() {
 Status LogBlockContainer::SyncData() {
   if (FLAGS_enable_data_block_fsync) {
     std::lock_guard<Mutex> l(data_writer_lock_);
-    return data_file_->Sync();
+    MonoTime start = MonoTime::Now();
+    RETURN_NOT_OK(data_file_->Sync());
+    DiskHiccupMonitor* monitor = block_manager_->disk_hiccup_monitor();
+    if (monitor) {
+      monitor->RecordLatency(device_, DiskHiccupMonitor::kSync, MonoTime::Now() - start);
+    }
   }
   return Status::OK();
 }
@@ -768,8 +923,10 @@ class LogWritableBlock : public WritableBlock {
     NO_SYNC
   };
 
+  // If 'evict_from_page_cache' is true, the block's data is written back and
+  // dropped from the page cache in chunks as it is appended.
   LogWritableBlock(LogBlockContainer* container, BlockId block_id,
-                   int64_t block_offset);
+                   int64_t block_offset, bool evict_from_page_cache);
 
   virtual ~LogWritableBlock();
 
@@ -799,6 +956,10 @@ class LogWritableBlock : public WritableBlock {
   Status AppendMetadata();
 
  private:
+  // Starts writeback of the data appended since the last call, and drops
+  // from the page cache the data whose writeback the last call started.
+  Status StreamOutAppendedData();
+
   // The owning container. Must outlive the block.
   LogBlockContainer* container_;
 
@@ -812,6 +973,15 @@ class LogWritableBlock : public WritableBlock {
   // The block's length. Changes with each Append().
   int64_t block_length_;
 
+  // Whether appended data is dropped from the page cache once written back.
+  const bool evict_from_page_cache_;
+
+  // With 'evict_from_page_cache_', the length of the block prefix whose
+  // writeback has been started, and of the prefix which has been dropped
+  // from the page cache.
+  int64_t flushed_length_;
+  int64_t evicted_length_;
+
   // The state of the block describing where it is in the write lifecycle,
   // for example, has it been synchronized to disk?
   WritableBlock::State state_;
@@ -820,11 +990,15 @@ class LogWritableBlock : public WritableBlock {
 };
 
 LogWritableBlock::LogWritableBlock(LogBlockContainer* container,
-                                   BlockId block_id, int64_t block_offset)
+                                   BlockId block_id, int64_t block_offset,
+                                   bool evict_from_page_cache)
     : container_(container),
       block_id_(std::move(block_id)),
       block_offset_(block_offset),
       block_length_(0),
+      evict_from_page_cache_(evict_from_page_cache),
+      flushed_length_(0),
+      evicted_length_(0),
       state_(CLEAN) {
   DCHECK_GE(block_offset, 0);
   DCHECK_EQ(0, block_offset % container->instance()->filesystem_block_size_bytes());
@@ -880,6 +1054,26 @@ Status LogWritableBlock::Append(const Slice& data) {
 
   block_length_ += data.size();
   state_ = DIRTY;
+
+  if (evict_from_page_cache_ &&
+      block_length_ - flushed_length_ >= FLAGS_log_block_manager_eviction_chunk_bytes) {
+    RETURN_NOT_OK(StreamOutAppendedData());
+  }
+  return Status::OK();
+}
+
+Status LogWritableBlock::StreamOutAppendedData() {
+  // The previous chunk's writeback was started a full chunk ago and has most
+  // likely finished, so its pages are clean and can be dropped. Pages still
+  // under writeback are skipped by the kernel and will be dropped on close.
+  RETURN_NOT_OK(container_->FlushData(block_offset_ + flushed_length_,
+                                      block_length_ - flushed_length_));
+  if (flushed_length_ > evicted_length_) {
+    RETURN_NOT_OK(container_->DropCachedData(block_offset_ + evicted_length_,
+                                             flushed_length_ - evicted_length_));
+    evicted_length_ = flushed_length_;
+  }
+  flushed_length_ = block_length_;
   return Status::OK();
 }
 
@@ -950,6 +1144,15 @@ Status LogWritableBlock::DoClose(SyncMode mode) {
       // TODO: Sync just this block's dirty metadata.
       s = container_->SyncMetadata();
       RETURN_NOT_OK(s);
+
+      // Everything is written back now, so the rest of the block can go.
+      if (evict_from_page_cache_ && block_length_ > evicted_length_) {
+        WARN_NOT_OK(container_->DropCachedData(block_offset_ + evicted_length_,
+                                               block_length_ - evicted_length_),
+                    Substitute("Could not drop block $0 from the page cache",
+                               id().ToString()));
+        evicted_length_ = block_length_;
+      }
     }
   }
 
@@ -989,9 +1192,17 @@ class LogReadableBlock : public ReadableBlock {
   virtual Status Read(uint64_t offset, size_t length,
                       Slice* result, uint8_t* scratch) const OVERRIDE;
 
+  virtual Status Prefetch(uint64_t offset, size_t length) const OVERRIDE;
+
+  virtual Status ReadZeroCopy(uint64_t offset, size_t length, Slice* result,
+                              std::shared_ptr<const void>* pin) const OVERRIDE;
+
   virtual size_t memory_footprint() const OVERRIDE;
 
  private:
+  // Returns an error if [offset, offset + length) isn't within the block.
+  Status CheckReadBounds(uint64_t offset, size_t length) const;
+
   // The owning container. Must outlive this block.
   LogBlockContainer* container_;
 
@@ -1047,15 +1258,8 @@ Status LogReadableBlock::Read(uint64_t offset, size_t length,
                               Slice* result, uint8_t* scratch) const {
   DCHECK(!closed_.Load());
 
+  RETURN_NOT_OK(CheckReadBounds(offset, length));
   uint64_t read_offset = log_block_->offset() + offset;
-  if (log_block_->length() < offset + length) {
-    return Status::IOError("Out-of-bounds read",
-                           Substitute("read of [$0-$1) in block [$2-$3)",
-                                      read_offset,
-                                      read_offset + length,
-                                      log_block_->offset(),
-                                      log_block_->offset() + log_block_->length()));
-  }
 
   MicrosecondsInt64 start_time = GetMonoTimeMicros();
   RETURN_NOT_OK(container_->ReadData(read_offset, length, result, scratch));
@@ -1073,6 +1277,57 @@ Status LogReadableBlock::Read(uint64_t offset, size_t length,
   return Status::OK();
 }
 
+Status LogReadableBlock::ReadZeroCopy(uint64_t offset, size_t length, Slice* result,
+                                      std::shared_ptr<const void>* pin) const {
+  DCHECK(!closed_.Load());
+
+  if (!FLAGS_log_block_manager_mmap_reads) {
+    return Status::NotSupported("Zero-copy reads are disabled");
+  }
+  RETURN_NOT_OK(CheckReadBounds(offset, length));
+
+  // The mapping holds a reference to the block so that its space isn't
+  // punched out from under the mapping if the block is deleted.
+  struct Pin {
+    gscoped_ptr<MappedRegion> region;
+    scoped_refptr<internal::LogBlock> log_block;
+  };
+  std::shared_ptr<Pin> new_pin(new Pin());
+  new_pin->log_block = log_block_;
+  RETURN_NOT_OK(container_->MapData(log_block_->offset() + offset, length, &new_pin->region));
+  TRACE_COUNTER_INCREMENT("lbm_mapped_reads", 1);
+
+  if (container_->metrics()) {
+    container_->metrics()->generic_metrics.total_bytes_read->IncrementBy(length);
+  }
+  *result = new_pin->region->data();
+  *pin = std::move(new_pin);
+  return Status::OK();
+}
+
+Status LogReadableBlock::CheckReadBounds(uint64_t offset, size_t length) const {
+  if (log_block_->length() < offset + length) {
+    uint64_t read_offset = log_block_->offset() + offset;
+    return Status::IOError("Out-of-bounds read",
+                           Substitute("read of [$0-$1) in block [$2-$3)",
+                                      read_offset,
+                                      read_offset + length,
+                                      log_block_->offset(),
+                                      log_block_->offset() + log_block_->length()));
+  }
+  return Status::OK();
+}
+
+Status LogReadableBlock::Prefetch(uint64_t offset, size_t length) const {
+  DCHECK(!closed_.Load());
+
+  if (offset >= static_cast<uint64_t>(log_block_->length())) {
+    return Status::OK();
+  }
+  length = std::min<uint64_t>(length, log_block_->length() - offset);
+  return container_->PrefetchData(log_block_->offset() + offset, length);
+}
+
 size_t LogReadableBlock::memory_footprint() const {
   return kudu_malloc_usable_size(this);
 }
@@ -1085,6 +1340,7 @@ size_t LogReadableBlock::memory_footprint() const {
 
 const char* LogBlockManager::kContainerMetadataFileSuffix = ".metadata";
 const char* LogBlockManager::kContainerDataFileSuffix = ".data";
+const char* LogBlockManager::kContainerTmpFileSuffix = ".tmp";
 
 static const char* kBlockManagerType = "log";
 
@@ -1101,7 +1357,8 @@ LogBlockManager::LogBlockManager(Env* env, const BlockManagerOptions& opts)
     read_only_(opts.read_only),
     root_paths_(opts.root_paths),
     root_paths_idx_(0),
-    next_block_id_(1) {
+    next_block_id_(1),
+    disk_hiccup_monitor_(opts.disk_hiccup_monitor) {
 
   // HACK: when running in a test environment, we often instantiate many
   // LogBlockManagers in the same process, eg corresponding to different
@@ -1217,11 +1474,19 @@ Status LogBlockManager::Open() {
   RETURN_NOT_OK(Init());
 
   vector<Status> statuses(root_paths_.size());
+  vector<vector<pair<LogBlockContainer*, uint64_t>>> dead_containers(root_paths_.size());
   unordered_map<string, PathInstanceMetadataFile*> metadata_files;
   ValueDeleter deleter(&metadata_files);
   for (const string& root_path : root_paths_) {
     InsertOrDie(&metadata_files, root_path, nullptr);
   }
+  auto dead_container_deleter = MakeScopedCleanup([&]() {
+      for (auto& dead : dead_containers) {
+        for (const auto& e : dead) {
+          delete e.first;
+        }
+      }
+    });
 
   // Submit each open to its own thread pool and wait for them to complete.
   int i = 0;
@@ -1232,7 +1497,8 @@ Status LogBlockManager::Open() {
              Unretained(this),
              root_path,
              &statuses[i],
-             &FindOrDie(metadata_files, root_path))),
+             &FindOrDie(metadata_files, root_path),
+             &dead_containers[i])),
                           Substitute("Could not open root path $0", root_path));
     i++;
   }
@@ -1248,6 +1514,27 @@ Status LogBlockManager::Open() {
     }
   }
 
+  // Reclaim containers whose blocks have all been deleted. The next block ID
+  // is only derived from on-disk records, so the container holding the
+  // largest ID ever allocated is kept; deleting it would allow that ID to be
+  // handed out again while stale references to it may still exist.
+  int64_t next_block_id = next_block_id_.Load();
+  for (auto& dead : dead_containers) {
+    for (auto& e : dead) {
+      LogBlockContainer* container = e.first;
+      e.first = nullptr;
+      if (e.second + 1 < next_block_id) {
+        RETURN_NOT_OK_PREPEND(DeleteDeadContainer(container),
+                              Substitute("Could not delete dead container $0",
+                                         container->ToString()));
+        continue;
+      }
+      std::lock_guard<simple_spinlock> l(lock_);
+      AddNewContainerUnlocked(container);
+      MakeContainerAvailableUnlocked(container);
+    }
+  }
+
   instances_by_root_path_.swap(metadata_files);
   return Status::OK();
 }
@@ -1266,6 +1553,10 @@ Status LogBlockManager::CreateBlock(const CreateBlockOptions& opts,
     }
   }
 
+  // Root paths outside of the block's placement group, if it has one.
+  unordered_set<string> excluded_root_paths;
+  GetRootPathsOutsideGroup(opts, &excluded_root_paths);
+
   // Find a free container. If one cannot be found, create a new one.
   // In case one or more root paths have hit their reserved space limit, we
   // retry until we have exhausted all root paths.
@@ -1274,7 +1565,7 @@ Status LogBlockManager::CreateBlock(const CreateBlockOptions& opts,
   // callers to block if we've reached it?
   LogBlockContainer* container = nullptr;
   while (!container) {
-    container = GetAvailableContainer(full_root_paths);
+    container = GetAvailableContainer(full_root_paths, excluded_root_paths);
     if (!container) {
       // If all root paths are full, we cannot allocate a block.
       if (full_root_paths.size() == root_paths_.size()) {
@@ -1283,6 +1574,17 @@ Status LogBlockManager::CreateBlock(const CreateBlockOptions& opts,
                                "fs_data_dirs_reserved_bytes configuration parameter",
                                "", ENOSPC);
       }
+      // If the placement group is full, fall back to the remaining root paths
+      // rather than failing the write.
+      if (!excluded_root_paths.empty() &&
+          std::all_of(root_paths_.begin(), root_paths_.end(), [&](const string& r) {
+              return ContainsKey(full_root_paths, r) || ContainsKey(excluded_root_paths, r);
+            })) {
+        VLOG(1) << "All data directories in the placement group of tablet "
+                << opts.tablet_id << " are full; using the remaining directories";
+        excluded_root_paths.clear();
+        continue;
+      }
       // Round robin through the root paths to select where the next
       // container should live.
       // TODO: Consider a more random scheme for block placement.
@@ -1292,7 +1594,8 @@ Status LogBlockManager::CreateBlock(const CreateBlockOptions& opts,
         cur_idx = root_paths_idx_.Load();
         next_idx = (cur_idx + 1) % root_paths_.size();
       } while (!root_paths_idx_.CompareAndSet(cur_idx, next_idx) ||
-               ContainsKey(full_root_paths, root_paths_[cur_idx]));
+               ContainsKey(full_root_paths, root_paths_[cur_idx]) ||
+               ContainsKey(excluded_root_paths, root_paths_[cur_idx]));
       string root_path = root_paths_[cur_idx];
       if (full_disk_cache_.IsRootFull(root_path)) {
         InsertOrDie(&full_root_paths, root_path);
@@ -1355,7 +1658,8 @@ Status LogBlockManager::CreateBlock(const CreateBlockOptions& opts,
 
   block->reset(new internal::LogWritableBlock(container,
                                               new_block_id,
-                                              container->total_bytes_written()));
+                                              container->total_bytes_written(),
+                                              opts.evict_from_page_cache));
   VLOG(3) << "Created block " << (*block)->id() << " in container "
           << container->ToString();
   return Status::OK();
@@ -1411,6 +1715,92 @@ Status LogBlockManager::DeleteBlock(const BlockId& block_id) {
   return Status::OK();
 }
 
+// Punches out each of the (offset, length) ranges in 'ranges' from the data
+// file of 'container'.
+static void PunchHolesAsync(LogBlockContainer* container,
+                            const vector<pair<int64_t, int64_t>>& ranges) {
+  for (const auto& range : ranges) {
+    WARN_NOT_OK(container->DeleteBlock(range.first, range.second),
+                Substitute("Could not free $0 bytes at offset $1 in container $2",
+                           range.second, range.first, container->ToString()));
+  }
+}
+
+Status LogBlockManager::DeleteBlocks(const vector<BlockId>& block_ids,
+                                     vector<BlockId>* deleted) {
+  CHECK(!read_only_);
+
+  // Group the blocks by container so that each container's deletion records
+  // can be written out together.
+  unordered_map<LogBlockContainer*, vector<scoped_refptr<LogBlock>>> blocks_by_container;
+  for (const BlockId& block_id : block_ids) {
+    scoped_refptr<LogBlock> lb(RemoveLogBlock(block_id));
+    if (!lb) {
+      deleted->push_back(block_id);
+      continue;
+    }
+    VLOG(3) << "Deleting block " << block_id;
+    blocks_by_container[lb->container()].push_back(std::move(lb));
+  }
+
+  Status first_error;
+  for (auto& e : blocks_by_container) {
+    LogBlockContainer* container = e.first;
+    vector<scoped_refptr<LogBlock>>& blocks = e.second;
+
+    // Record the on-disk deletions. As in DeleteBlock(), the append isn't
+    // synchronized.
+    vector<BlockRecordPB> records(blocks.size());
+    int64_t now = GetCurrentTimeMicros();
+    for (int i = 0; i < blocks.size(); i++) {
+      blocks[i]->block_id().CopyToPB(records[i].mutable_block_id());
+      records[i].set_op_type(DELETE);
+      records[i].set_timestamp_us(now);
+    }
+    Status s = container->AppendMetadata(records);
+    if (!s.ok()) {
+      // The blocks' data is left in place: without the deletion records,
+      // they'll be loaded again at startup.
+      if (first_error.ok()) {
+        first_error = s.CloneAndPrepend(Substitute(
+            "Unable to append deletion records to container $0", container->ToString()));
+      }
+      continue;
+    }
+
+    // Blocks that are still open are freed when they're closed, exactly as
+    // in DeleteBlock(). The space of the others is freed here, punching
+    // each run of adjacent blocks out as a single hole.
+    int64_t fs_block_size = container->instance()->filesystem_block_size_bytes();
+    vector<pair<int64_t, int64_t>> ranges;
+    for (const auto& lb : blocks) {
+      deleted->push_back(lb->block_id());
+      if (lb->HasOneRef()) {
+        ranges.emplace_back(lb->offset(), lb->length());
+      } else {
+        lb->Delete();
+      }
+    }
+    std::sort(ranges.begin(), ranges.end());
+    vector<pair<int64_t, int64_t>> holes;
+    for (const auto& range : ranges) {
+      if (!holes.empty()) {
+        pair<int64_t, int64_t>* last = &holes.back();
+        int64_t last_end = last->first + last->second;
+        if (range.first <= KUDU_ALIGN_UP(last_end, fs_block_size)) {
+          last->second = std::max(last_end, range.first + range.second) - last->first;
+          continue;
+        }
+      }
+      holes.push_back(range);
+    }
+    if (!holes.empty()) {
+      container->ExecClosure(Bind(&PunchHolesAsync, container, holes));
+    }
+  }
+  return first_error;
+}
+
 Status LogBlockManager::CloseBlocks(const std::vector<WritableBlock*>& blocks) {
   VLOG(3) << "Closing " << blocks.size() << " blocks";
   if (FLAGS_block_coalesce_close) {
@@ -1446,7 +1836,8 @@ void LogBlockManager::AddNewContainerUnlocked(LogBlockContainer* container) {
 }
 
 LogBlockContainer* LogBlockManager::GetAvailableContainer(
-    const unordered_set<string>& full_root_paths) {
+    const unordered_set<string>& full_root_paths,
+    const unordered_set<string>& excluded_root_paths) {
   LogBlockContainer* container = nullptr;
   int64_t disk_full_containers_delta = 0;
   MonoTime now = MonoTime::Now();
@@ -1462,9 +1853,16 @@ LogBlockContainer* LogBlockManager::GetAvailableContainer(
 
     // Return the first currently-available non-full-disk container (according to
     // our full-disk cache).
-    while (!container && !available_containers_.empty()) {
-      container = available_containers_.front();
-      available_containers_.pop_front();
+    auto iter = available_containers_.begin();
+    while (!container && iter != available_containers_.end()) {
+      // Containers outside of the requested placement group stay available
+      // for other writers.
+      if (ContainsKey(excluded_root_paths, (*iter)->root_path())) {
+        ++iter;
+        continue;
+      }
+      container = *iter;
+      iter = available_containers_.erase(iter);
       MonoTime expires;
       // Note: We must check 'full_disk_cache_' before 'full_root_paths' in
       // order to correctly use the expiry time provided by 'full_disk_cache_'.
@@ -1491,6 +1889,24 @@ LogBlockContainer* LogBlockManager::GetAvailableContainer(
   return container;
 }
 
+void LogBlockManager::GetRootPathsOutsideGroup(const CreateBlockOptions& opts,
+                                               unordered_set<string>* excluded_root_paths) const {
+  int group_size = FLAGS_fs_target_data_dirs_per_tablet;
+  if (opts.tablet_id.empty() || group_size <= 0 || group_size >= root_paths_.size()) {
+    return;
+  }
+  // The group is a run of consecutive root paths starting at a position
+  // derived from the tablet ID. It is a pure function of the tablet ID and
+  // the configured root paths, so it needs no persistent state and survives
+  // restarts; consecutive runs keep groups of different tablets overlapping
+  // evenly.
+  int start = util_hash::CityHash64(opts.tablet_id.data(), opts.tablet_id.size()) %
+      root_paths_.size();
+  for (int i = group_size; i < root_paths_.size(); i++) {
+    InsertOrDie(excluded_root_paths, root_paths_[(start + i) % root_paths_.size()]);
+  }
+}
+
 void LogBlockManager::MakeContainerAvailable(LogBlockContainer* container) {
   std::lock_guard<simple_spinlock> l(lock_);
   MakeContainerAvailableUnlocked(container);
@@ -1588,7 +2004,8 @@ scoped_refptr<LogBlock> LogBlockManager::RemoveLogBlock(const BlockId& block_id)
 
 void LogBlockManager::OpenRootPath(const string& root_path,
                                    Status* result_status,
-                                   PathInstanceMetadataFile** result_metadata) {
+                                   PathInstanceMetadataFile** result_metadata,
+                                   vector<pair<LogBlockContainer*, uint64_t>>* dead_containers) {
   if (!env_->FileExists(root_path)) {
     *result_status = Status::NotFound(Substitute(
         "LogBlockManager at $0 not found", root_path));
@@ -1633,6 +2050,17 @@ void LogBlockManager::OpenRootPath(const string& root_path,
   }
   for (const string& child : children) {
     string id;
+    if (HasSuffixString(child, LogBlockManager::kContainerTmpFileSuffix)) {
+      // Left behind by a metadata compaction that didn't finish; the original
+      // metadata file is still intact.
+      if (!read_only_) {
+        string tmp_path = JoinPathSegments(root_path, child);
+        LOG(WARNING) << "Deleting stale temporary file " << tmp_path;
+        WARN_NOT_OK(env_->DeleteFile(tmp_path),
+                    Substitute("Could not delete $0", tmp_path));
+      }
+      continue;
+    }
     if (!TryStripSuffixString(child, LogBlockManager::kContainerMetadataFileSuffix, &id)) {
       continue;
     }
@@ -1679,6 +2107,68 @@ void LogBlockManager::OpenRootPath(const string& root_path,
     }
     next_block_id_.StoreMax(max_block_id + 1);
 
+    // A long-lived container accumulates CREATE/DELETE pairs for blocks that
+    // are long gone, all of which must be replayed on every startup. Once they
+    // dominate the metadata file, rewrite it with just the live records.
+    int64_t num_records = records.size();
+    int64_t dead_records = num_records - blocks_in_container.size();
+    if (!read_only_ &&
+        num_records >= FLAGS_log_container_metadata_compact_min_records &&
+        dead_records >= FLAGS_log_container_metadata_compact_dead_ratio * num_records) {
+      // Old data may contain a block ID that was created, deleted, and created
+      // again; only the record matching the surviving block is kept, and only once.
+      //
+      // The container's logical size is derived from the furthest CREATE
+      // record, so if that block is dead its CREATE/DELETE pair is retained
+      // too. Otherwise the space it occupied could be handed out again.
+      deque<BlockRecordPB> live_records;
+      unordered_set<BlockId, BlockIdHash> kept;
+      const BlockRecordPB* furthest_dead = nullptr;
+      int64_t live_end = 0;
+      for (const BlockRecordPB& r : records) {
+        if (r.op_type() != CREATE) {
+          continue;
+        }
+        BlockId block_id(BlockId::FromPB(r.block_id()));
+        const scoped_refptr<LogBlock>* lb = FindOrNull(blocks_in_container, block_id);
+        if (lb != nullptr && (*lb)->offset() == r.offset() &&
+            InsertIfNotPresent(&kept, block_id)) {
+          live_records.push_back(r);
+          live_end = std::max(live_end, r.offset() + r.length());
+        } else if (furthest_dead == nullptr ||
+                   r.offset() + r.length() >
+                   furthest_dead->offset() + furthest_dead->length()) {
+          furthest_dead = &r;
+        }
+      }
+      if (furthest_dead != nullptr &&
+          furthest_dead->offset() + furthest_dead->length() > live_end) {
+        BlockRecordPB del;
+        del.mutable_block_id()->CopyFrom(furthest_dead->block_id());
+        del.set_op_type(DELETE);
+        del.set_timestamp_us(furthest_dead->timestamp_us());
+        live_records.push_front(del);
+        live_records.push_front(*furthest_dead);
+      }
+      LOG(INFO) << "Compacting metadata of log block container " << container->ToString()
+                << ": keeping " << live_records.size() << " of " << records.size()
+                << " records";
+      s = container->CompactMetadata(live_records);
+      if (!s.ok()) {
+        *result_status = s.CloneAndPrepend(Substitute(
+            "Could not compact metadata of container $0", container->ToString()));
+        return;
+      }
+    }
+
+    // A full container that has no live blocks will never be written to
+    // again; leave it to Open() to decide whether it can be deleted.
+    if (!read_only_ && FLAGS_log_block_manager_delete_dead_containers &&
+        blocks_in_container.empty() && container->full()) {
+      dead_containers->emplace_back(container.release(), max_block_id);
+      continue;
+    }
+
     // Under the lock, merge this map into the main block map and add
     // the container.
     {
@@ -1706,6 +2196,22 @@ void LogBlockManager::OpenRootPath(const string& root_path,
   *result_metadata = metadata.release();
 }
 
+Status LogBlockManager::DeleteDeadContainer(LogBlockContainer* container) {
+  gscoped_ptr<LogBlockContainer> to_delete(container);
+  string name = container->ToString();
+  string metadata_path = container->MetadataFilePath();
+  string data_path = container->DataFilePath();
+  string dir = container->dir();
+  to_delete.reset();
+
+  LOG(INFO) << "Deleting dead log block container " << name;
+  // Remove the metadata file first: a stray data file is ignored at startup,
+  // whereas a metadata file with a missing data file is an error.
+  RETURN_NOT_OK(env_->DeleteFile(metadata_path));
+  RETURN_NOT_OK(env_->DeleteFile(data_path));
+  return env_->SyncDir(dir);
+}
+
 void LogBlockManager::ProcessBlockRecord(const BlockRecordPB& record,
                                          LogBlockContainer* container,
                                          UntrackedBlockMap* block_map) {
@@ -1732,7 +2238,14 @@ void LogBlockManager::ProcessBlockRecord(const BlockRecordPB& record,
       //
       // If we ignored deleted blocks, we would end up reusing the space
       // belonging to the last deleted block in the container.
-      container->UpdateBytesWritten(record.length());
+      //
+      // Blocks are allocated sequentially, so the logical size is the end of
+      // the furthest block rather than the sum of all block lengths; this
+      // stays correct for metadata that was compacted (see CompactMetadata()).
+      int64_t block_end = record.offset() + record.length();
+      if (block_end > container->total_bytes_written()) {
+        container->UpdateBytesWritten(block_end - container->total_bytes_written());
+      }
       break;
     }
     case DELETE:
@@ -170,6 +170,7 @@ class LogBlockManager : public BlockManager {
  public:
   static const char* kContainerMetadataFileSuffix;
   static const char* kContainerDataFileSuffix;
+  static const char* kContainerTmpFileSuffix;
 
   LogBlockManager(Env* env, const BlockManagerOptions& opts);
 
@@ -189,6 +190,9 @@ class LogBlockManager : public BlockManager {
 
   virtual Status DeleteBlock(const BlockId& block_id) OVERRIDE;
 
+  virtual Status DeleteBlocks(const std::vector<BlockId>& block_ids,
+                              std::vector<BlockId>* deleted) OVERRIDE;
+
   virtual Status CloseBlocks(const std::vector<WritableBlock*>& blocks) OVERRIDE;
 
   // Return the number of blocks stored in the block manager.
@@ -197,6 +201,8 @@ class LogBlockManager : public BlockManager {
  private:
   FRIEND_TEST(LogBlockManagerTest, TestReuseBlockIds);
   FRIEND_TEST(LogBlockManagerTest, TestMetadataTruncation);
+  FRIEND_TEST(LogBlockManagerTest, TestMetadataCompaction);
+  FRIEND_TEST(LogBlockManagerTest, TestDeadContainerDeletion);
   friend class internal::LogBlockContainer;
 
   // Simpler typedef for a block map which isn't tracked in the memory tracker.
@@ -237,8 +243,18 @@ class LogBlockManager : public BlockManager {
   //
   // 'full_root_paths' is a blacklist containing root paths that are full.
   // Containers with root paths in this list will not be returned.
+  //
+  // Containers with root paths in 'excluded_root_paths' are not returned
+  // either, but unlike those on full root paths, they remain available.
   internal::LogBlockContainer* GetAvailableContainer(
-      const std::unordered_set<std::string>& full_root_paths);
+      const std::unordered_set<std::string>& full_root_paths,
+      const std::unordered_set<std::string>& excluded_root_paths);
+
+  // Adds to 'excluded_root_paths' the root paths outside of the placement
+  // group of the block described by 'opts'. Leaves it untouched if the block
+  // may be placed in any root path.
+  void GetRootPathsOutsideGroup(const CreateBlockOptions& opts,
+                                std::unordered_set<std::string>* excluded_root_paths) const;
 
   // Indicate that this container is no longer in use and can be handed out
   // to other writers.
@@ -284,9 +300,19 @@ class LogBlockManager : public BlockManager {
   //
   // Success or failure is set in 'result_status'. On success, also sets
   // 'result_metadata' with an allocated metadata file.
-  void OpenRootPath(const std::string& root_path,
-                    Status* result_status,
-                    PathInstanceMetadataFile** result_metadata);
+  //
+  // Full containers without any live blocks are not added to the block
+  // manager; instead they are returned in 'dead_containers' alongside the
+  // largest block ID they ever held, and ownership passes to the caller.
+  void OpenRootPath(
+      const std::string& root_path,
+      Status* result_status,
+      PathInstanceMetadataFile** result_metadata,
+      std::vector<std::pair<internal::LogBlockContainer*, uint64_t>>* dead_containers);
+
+  // Deletes the files belonging to 'container', which must be full and
+  // contain no live blocks, and frees it.
+  Status DeleteDeadContainer(internal::LogBlockContainer* container);
 
   // Test for hole punching support at 'path'.
   Status CheckHolePunch(const std::string& path);
@@ -303,6 +329,8 @@ class LogBlockManager : public BlockManager {
 
   const internal::LogBlockManagerMetrics* metrics() const { return metrics_.get(); }
 
+  DiskHiccupMonitor* disk_hiccup_monitor() const { return disk_hiccup_monitor_; }
+
   // Tracks memory consumption of any allocations numerous enough to be
   // interesting (e.g. LogBlocks).
   std::shared_ptr<MemTracker> mem_tracker_;
@@ -380,6 +408,9 @@ class LogBlockManager : public BlockManager {
   // May be null if instantiated without metrics.
   gscoped_ptr<internal::LogBlockManagerMetrics> metrics_;
 
+  // Not owned. May be null.
+  DiskHiccupMonitor* const disk_hiccup_monitor_;
+
   DISALLOW_COPY_AND_ASSIGN(LogBlockManager);
 };
 
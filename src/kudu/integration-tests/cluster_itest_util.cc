@@ -485,6 +485,25 @@ Status LeaderStepDown(const TServerDetails* replica,
   return Status::OK();
 }
 
+Status TransferLeadership(const TServerDetails* replica,
+                          const string& tablet_id,
+                          const string& new_leader_uuid,
+                          const MonoDelta& timeout) {
+  LeaderStepDownRequestPB req;
+  req.set_dest_uuid(replica->uuid());
+  req.set_tablet_id(tablet_id);
+  req.set_new_leader_uuid(new_leader_uuid);
+  LeaderStepDownResponsePB resp;
+  RpcController rpc;
+  rpc.set_timeout(timeout);
+  RETURN_NOT_OK(replica->consensus_proxy->LeaderStepDown(req, &resp, &rpc));
+  if (resp.has_error()) {
+    return StatusFromPB(resp.error().status())
+      .CloneAndPrepend(Substitute("Code $0", TabletServerErrorPB::Code_Name(resp.error().code())));
+  }
+  return Status::OK();
+}
+
 Status WriteSimpleTestRow(const TServerDetails* replica,
                           const std::string& tablet_id,
                           RowOperationsPB::Type write_type,
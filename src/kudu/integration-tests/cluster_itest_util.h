@@ -199,6 +199,14 @@ Status LeaderStepDown(const TServerDetails* replica,
                       const MonoDelta& timeout,
                       tserver::TabletServerErrorPB* error = NULL);
 
+// Cause a leader to step down on the specified server and hand its leadership
+// to the replica with uuid 'new_leader_uuid', which is asked to run an
+// election right away. Returns once the leader stepped down.
+Status TransferLeadership(const TServerDetails* replica,
+                          const std::string& tablet_id,
+                          const std::string& new_leader_uuid,
+                          const MonoDelta& timeout);
+
 // Write a "simple test schema" row to the specified tablet on the given
 // replica. This schema is commonly used by tests and is defined in
 // wire_protocol-test-util.h
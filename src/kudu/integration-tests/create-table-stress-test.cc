@@ -52,6 +52,8 @@ using kudu::rpc::RpcController;
 DECLARE_int32(heartbeat_interval_ms);
 DECLARE_bool(log_preallocate_segments);
 DEFINE_int32(num_test_tablets, 60, "Number of tablets for stress test");
+DEFINE_int32(num_test_ddl_tables, 16, "Number of tables for the concurrent DDL stress test");
+DEFINE_int32(num_test_ddl_threads, 8, "Number of threads for the concurrent DDL stress test");
 
 using std::thread;
 using std::unique_ptr;
@@ -323,6 +325,48 @@ TEST_F(CreateTableStressTest, TestGetTableLocationsOptions) {
 
 // Creates tables and reloads on-disk metadata concurrently to test for races
 // between the two operations.
+// Creates and alters the same number of tables first from one thread, then
+// from several concurrently. DDL operations on different tables don't
+// contend in the master beyond their sys catalog writes, so the concurrent
+// run should take a fraction of the time of the serial one.
+TEST_F(CreateTableStressTest, TestConcurrentDdlOnDifferentTables) {
+  const int kTabletsPerTable = 4;
+  auto run_ddl = [&](const string& prefix, int num_threads) {
+    MonoTime start = MonoTime::Now();
+    vector<thread> threads;
+    for (int t = 0; t < num_threads; t++) {
+      threads.emplace_back([&, t]() {
+        for (int i = t; i < FLAGS_num_test_ddl_tables; i += num_threads) {
+          string table_name = Substitute("$0-$1", prefix, i);
+          unique_ptr<KuduTableCreator> table_creator(client_->NewTableCreator());
+          CHECK_OK(table_creator->table_name(table_name)
+                   .schema(&schema_)
+                   .add_hash_partitions({ "key" }, kTabletsPerTable)
+                   .num_replicas(3)
+                   .Create());
+          unique_ptr<client::KuduTableAlterer> alterer(client_->NewTableAlterer(table_name));
+          alterer->AddColumn("v3")->Type(KuduColumnSchema::INT32);
+          CHECK_OK(alterer->Alter());
+        }
+      });
+    }
+    for (auto& t : threads) {
+      t.join();
+    }
+    MonoDelta elapsed = MonoTime::Now() - start;
+    LOG(INFO) << Substitute("Created and altered $0 tables with $1 threads in $2: "
+                            "$3 tables/sec", FLAGS_num_test_ddl_tables, num_threads,
+                            elapsed.ToString(),
+                            FLAGS_num_test_ddl_tables / elapsed.ToSeconds());
+  };
+  run_ddl("serial", 1);
+  run_ddl("concurrent", FLAGS_num_test_ddl_threads);
+
+  vector<string> tables;
+  ASSERT_OK(client_->ListTables(&tables));
+  ASSERT_EQ(FLAGS_num_test_ddl_tables * 2, tables.size());
+}
+
 TEST_F(CreateTableStressTest, TestConcurrentCreateTableAndReloadMetadata) {
   AtomicBool stop(false);
 
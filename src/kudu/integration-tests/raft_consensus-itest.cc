@@ -52,9 +52,11 @@ DEFINE_int64(client_num_batches_per_thread, 5,
 DECLARE_int32(consensus_rpc_timeout_ms);
 DECLARE_int64(rpc_negotiation_timeout_ms);
 
+METRIC_DECLARE_entity(server);
 METRIC_DECLARE_entity(tablet);
 METRIC_DECLARE_counter(transaction_memory_pressure_rejections);
 METRIC_DECLARE_gauge_int64(raft_term);
+METRIC_DECLARE_histogram(handler_latency_kudu_consensus_ConsensusService_MultiRaftUpdateConsensus);
 
 namespace kudu {
 namespace tserver {
@@ -75,6 +77,7 @@ using itest::GetReplicaStatusAndCheckIfLeader;
 using itest::LeaderStepDown;
 using itest::RemoveServer;
 using itest::StartElection;
+using itest::TransferLeadership;
 using itest::WaitUntilLeader;
 using itest::WriteSimpleTestRow;
 using master::GetTabletLocationsRequestPB;
@@ -411,6 +414,34 @@ TEST_F(RaftConsensusITest, TestGetPermanentUuid) {
   ASSERT_EQ(expected_uuid, peer.permanent_uuid());
 }
 
+// Tests that with heartbeat batching enabled, leaders heartbeat their
+// followers through MultiRaftUpdateConsensus and replication still works.
+TEST_F(RaftConsensusITest, TestMultiRaftHeartbeatBatching) {
+  vector<string> ts_flags;
+  ts_flags.push_back("--enable_multi_raft_heartbeat_batching");
+  ts_flags.push_back("--raft_heartbeat_interval_ms=100");
+  BuildAndStart(ts_flags);
+
+  InsertTestRowsRemoteThread(0,
+                             FLAGS_client_inserts_per_thread,
+                             FLAGS_client_num_batches_per_thread,
+                             vector<CountDownLatch*>());
+  ASSERT_ALL_REPLICAS_AGREE(FLAGS_client_inserts_per_thread);
+
+  int64_t num_batches = 0;
+  for (int i = 0; i < cluster_->num_tablet_servers(); i++) {
+    int64_t count;
+    ASSERT_OK(cluster_->tablet_server(i)->GetInt64Metric(
+        &METRIC_ENTITY_server,
+        "kudu.tabletserver",
+        &METRIC_handler_latency_kudu_consensus_ConsensusService_MultiRaftUpdateConsensus,
+        "total_count",
+        &count));
+    num_batches += count;
+  }
+  ASSERT_GT(num_batches, 0);
+}
+
 // TODO allow the scan to define an operation id, fetch the last id
 // from the leader and then use that id to make the replica wait
 // until it is done. This will avoid the sleeps below.
@@ -1405,6 +1436,80 @@ TEST_F(RaftConsensusITest, TestLeaderStepDown) {
                                   << s.ToString();
 }
 
+// Tests that a leader which steps down naming a successor hands it the
+// leadership, without relying on failure detection.
+TEST_F(RaftConsensusITest, TestLeaderTransfer) {
+  FLAGS_num_replicas = 3;
+  FLAGS_num_tablet_servers = 3;
+
+  vector<string> ts_flags, master_flags;
+  ts_flags.push_back("--enable_leader_failure_detection=false");
+  master_flags.push_back("--catalog_manager_wait_for_new_tablets_to_elect_leader=false");
+  BuildAndStart(ts_flags, master_flags);
+
+  vector<TServerDetails*> tservers;
+  AppendValuesFromMap(tablet_servers_, &tservers);
+
+  ASSERT_OK(StartElection(tservers[0], tablet_id_, MonoDelta::FromSeconds(10)));
+  ASSERT_OK(WaitUntilLeader(tservers[0], tablet_id_, MonoDelta::FromSeconds(10)));
+  ASSERT_OK(WriteSimpleTestRow(tservers[0], tablet_id_, RowOperationsPB::INSERT,
+                               kTestRowKey, kTestRowIntVal, "foo", MonoDelta::FromSeconds(10)));
+  ASSERT_OK(WaitForServersToAgree(MonoDelta::FromSeconds(10), tablet_servers_, tablet_id_, 2));
+
+  ASSERT_OK(TransferLeadership(tservers[0], tablet_id_, tservers[1]->uuid(),
+                               MonoDelta::FromSeconds(10)));
+  ASSERT_OK(WaitUntilLeader(tservers[1], tablet_id_, MonoDelta::FromSeconds(10)));
+  ASSERT_OK(WriteSimpleTestRow(tservers[1], tablet_id_, RowOperationsPB::UPDATE,
+                               kTestRowKey, kTestRowIntVal, "bar", MonoDelta::FromSeconds(10)));
+
+  // Only other voters may be named.
+  Status s = TransferLeadership(tservers[1], tablet_id_, tservers[1]->uuid(),
+                                MonoDelta::FromSeconds(10));
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+}
+
+// Tests that voters grant pre-election votes without advancing their term.
+TEST_F(RaftConsensusITest, TestPreElectionVoteKeepsTerm) {
+  FLAGS_num_replicas = 3;
+  FLAGS_num_tablet_servers = 3;
+
+  vector<string> ts_flags, master_flags;
+  ts_flags.push_back("--enable_leader_failure_detection=false");
+  master_flags.push_back("--catalog_manager_wait_for_new_tablets_to_elect_leader=false");
+  BuildAndStart(ts_flags, master_flags);
+
+  vector<TServerDetails*> tservers;
+  AppendValuesFromMap(tablet_servers_, &tservers);
+
+  ASSERT_OK(StartElection(tservers[0], tablet_id_, MonoDelta::FromSeconds(10)));
+  ASSERT_OK(WaitUntilLeader(tservers[0], tablet_id_, MonoDelta::FromSeconds(10)));
+  ASSERT_OK(WaitForServersToAgree(MonoDelta::FromSeconds(10), tablet_servers_, tablet_id_, 1));
+
+  consensus::ConsensusStatePB cstate;
+  ASSERT_OK(itest::GetConsensusState(tservers[1], tablet_id_, consensus::CONSENSUS_CONFIG_ACTIVE,
+                                     MonoDelta::FromSeconds(10), &cstate));
+  int64_t term = cstate.current_term();
+
+  consensus::VoteRequestPB req;
+  req.set_dest_uuid(tservers[1]->uuid());
+  req.set_tablet_id(tablet_id_);
+  req.set_candidate_uuid(tservers[2]->uuid());
+  req.set_candidate_term(term + 1);
+  req.set_ignore_live_leader(true);
+  req.set_is_pre_election(true);
+  *req.mutable_candidate_status()->mutable_last_received() = MakeOpId(term, 1000);
+  consensus::VoteResponsePB resp;
+  RpcController rpc;
+  rpc.set_timeout(MonoDelta::FromSeconds(10));
+  ASSERT_OK(tservers[1]->consensus_proxy->RequestConsensusVote(req, &resp, &rpc));
+  ASSERT_TRUE(resp.vote_granted()) << resp.ShortDebugString();
+
+  ASSERT_OK(itest::GetConsensusState(tservers[1], tablet_id_, consensus::CONSENSUS_CONFIG_ACTIVE,
+                                     MonoDelta::FromSeconds(10), &cstate));
+  ASSERT_EQ(term, cstate.current_term());
+  ASSERT_FALSE(cstate.has_leader_uuid() && cstate.leader_uuid() != tservers[0]->uuid());
+}
+
 void RaftConsensusITest::AssertMajorityRequiredForElectionsAndWrites(
     const TabletServerMap& tablet_servers, const string& leader_uuid) {
 
@@ -0,0 +1,71 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+#include "kudu/client/client-test-util.h"
+#include "kudu/common/wire_protocol-test-util.h"
+#include "kudu/integration-tests/external_mini_cluster-itest-base.h"
+#include "kudu/util/test_util.h"
+
+using std::string;
+using std::vector;
+
+namespace kudu {
+
+const char* const kTableName = "test-table";
+
+class RebalancerITest : public ExternalMiniClusterITestBase {
+};
+
+// Test that the replicas of a table are moved onto a tablet server which
+// joins the cluster after the table was created.
+TEST_F(RebalancerITest, TestMoveReplicasOntoNewServer) {
+  const int kNumServers = 3;
+  const int kNumTablets = 8;
+  vector<string> master_flags = {
+    "--master_auto_rebalancing_enabled",
+    "--master_rebalance_interval_ms=500",
+  };
+  NO_FATALS(StartCluster({}, master_flags, kNumServers));
+
+  gscoped_ptr<client::KuduTableCreator> table_creator(client_->NewTableCreator());
+  client::KuduSchema client_schema(client::KuduSchemaFromSchema(GetSimpleTestSchema()));
+  ASSERT_OK(table_creator->table_name(kTableName)
+            .schema(&client_schema)
+            .set_range_partition_columns({ "key" })
+            .num_replicas(3)
+            .add_hash_partitions({ "key" }, kNumTablets)
+            .Create());
+
+  ASSERT_OK(cluster_->AddTabletServer());
+  ASSERT_OK(cluster_->WaitForTabletServerCount(kNumServers + 1, MonoDelta::FromSeconds(30)));
+
+  // The 24 replicas end up with 6 on each server, once the replicas moved
+  // away have been tombstoned.
+  AssertEventually([&]() {
+    for (int ts_idx = 0; ts_idx <= kNumServers; ts_idx++) {
+      ASSERT_EQ(kNumTablets * 3 / (kNumServers + 1),
+                inspect_->ListTabletsWithDataOnTS(ts_idx).size()) << "TS " << ts_idx;
+    }
+  }, MonoDelta::FromSeconds(120));
+  NO_FATALS();
+}
+
+} // namespace kudu
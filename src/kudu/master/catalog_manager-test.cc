@@ -77,12 +77,69 @@ TEST(TableInfoTest, TestAssignmentRanges) {
     LOG(INFO) << "Key " << start_key << " found in tablet " << tablet_id;
   }
 
+  // Page through the tablets two at a time.
+  {
+    GetTableLocationsRequestPB req;
+    req.set_max_returned_locations(2);
+    req.mutable_table()->mutable_table_name()->assign(table_id);
+    vector<scoped_refptr<TabletInfo> > tablets_in_range;
+    string next_partition_key;
+    table->GetTabletsInRange(&req, &tablets_in_range, &next_partition_key);
+    ASSERT_EQ(2, tablets_in_range.size());
+    ASSERT_EQ("b", next_partition_key);
+
+    req.set_partition_key_start(next_partition_key);
+    tablets_in_range.clear();
+    table->GetTabletsInRange(&req, &tablets_in_range, &next_partition_key);
+    ASSERT_EQ(2, tablets_in_range.size());
+    ASSERT_EQ("tablet-b-c", tablets_in_range[0]->tablet_id());
+    ASSERT_EQ("", next_partition_key);
+  }
+
   for (const scoped_refptr<TabletInfo>& tablet : tablets) {
     ASSERT_TRUE(table->RemoveTablet(
         tablet->metadata().state().pb.partition().partition_key_start()));
   }
 }
 
+TEST(TabletInfoTest, TestCachedLocations) {
+  scoped_refptr<TableInfo> table(new TableInfo(CURRENT_TEST_NAME()));
+  scoped_refptr<TabletInfo> tablet(new TabletInfo(table, "tablet"));
+  {
+    TabletMetadataLock l(tablet.get(), TabletMetadataLock::WRITE);
+    l.mutable_data()->pb.set_state(SysTabletsEntryPB::RUNNING);
+    l.Commit();
+  }
+  TabletLocationsPB locs;
+  ASSERT_FALSE(tablet->GetCachedLocations(0, &locs));
+
+  TabletLocationsPB built;
+  built.set_tablet_id("tablet");
+  built.add_replicas()->mutable_ts_info()->set_permanent_uuid("ts");
+  tablet->SetCachedLocations(tablet->metadata().version(), 1, built);
+  ASSERT_TRUE(tablet->GetCachedLocations(1, &locs));
+  ASSERT_EQ(built.ShortDebugString(), locs.ShortDebugString());
+
+  // The cached locations are stale once a tablet server registers...
+  ASSERT_FALSE(tablet->GetCachedLocations(2, &locs));
+
+  // ...or once the tablet metadata changes.
+  {
+    TabletMetadataLock l(tablet.get(), TabletMetadataLock::WRITE);
+    l.mutable_data()->pb.set_state(SysTabletsEntryPB::REPLACED);
+    l.Commit();
+  }
+  ASSERT_FALSE(tablet->GetCachedLocations(1, &locs));
+
+  // Aborted mutations don't change the metadata.
+  tablet->SetCachedLocations(tablet->metadata().version(), 1, built);
+  {
+    TabletMetadataLock l(tablet.get(), TabletMetadataLock::WRITE);
+    l.mutable_data()->pb.set_state(SysTabletsEntryPB::RUNNING);
+  }
+  ASSERT_TRUE(tablet->GetCachedLocations(1, &locs));
+}
+
 TEST(TestTSDescriptor, TestReplicaCreationsDecay) {
   TSDescriptor ts("test");
   ASSERT_EQ(0, ts.RecentReplicaCreations());
@@ -45,6 +45,7 @@
 #include <boost/optional.hpp>
 #include <condition_variable>
 #include <glog/logging.h>
+#include <map>
 #include <memory>
 #include <mutex>
 #include <set>
@@ -78,6 +79,7 @@
 #include "kudu/master/ts_manager.h"
 #include "kudu/rpc/messenger.h"
 #include "kudu/rpc/rpc_context.h"
+#include "kudu/rpc/rpc_controller.h"
 #include "kudu/tserver/tserver_admin.proxy.h"
 #include "kudu/util/debug/trace_event.h"
 #include "kudu/util/flag_tags.h"
@@ -100,6 +102,12 @@ DEFINE_int32(tablet_creation_timeout_ms, 30 * 1000, // 30 sec
              "replicas during table creation.");
 TAG_FLAG(tablet_creation_timeout_ms, advanced);
 
+DEFINE_int32(master_create_tablets_batch_size, 100,
+             "Maximum number of new tablet replicas which the master creates on "
+             "a tablet server with a single CreateTablets RPC. If set to 1, "
+             "one CreateTablet RPC is sent per replica.");
+TAG_FLAG(master_create_tablets_batch_size, advanced);
+
 DEFINE_bool(catalog_manager_wait_for_new_tablets_to_elect_leader, true,
             "Whether the catalog manager should wait for a newly created tablet to "
             "elect a leader before considering it successfully created. "
@@ -154,6 +162,12 @@ DEFINE_int32(table_locations_ttl_ms, 60 * 60 * 1000, // 1 hour
              "until after waiting for the ttl period.");
 TAG_FLAG(table_locations_ttl_ms, advanced);
 
+DEFINE_int32(max_table_locations_per_response, 1000,
+             "Maximum number of tablet locations returned by a single GetTableLocations "
+             "RPC. Clients which ask for more get the next partition key to continue from "
+             "in the response.");
+TAG_FLAG(max_table_locations_per_response, advanced);
+
 DEFINE_bool(catalog_manager_fail_ts_rpcs, false,
             "Whether all master->TS async calls should fail. Only for testing!");
 TAG_FLAG(catalog_manager_fail_ts_rpcs, hidden);
@@ -167,6 +181,46 @@ DEFINE_bool(catalog_manager_delete_orphaned_tablets, false,
             "master failures!");
 TAG_FLAG(catalog_manager_delete_orphaned_tablets, advanced);
 
+DEFINE_int64(master_replica_placement_min_free_bytes, 5L * 1024 * 1024 * 1024,
+             "When choosing between two tablet servers for a new tablet replica, "
+             "a server with less free space than this on one of its data "
+             "directories is only chosen if the other one is too.");
+TAG_FLAG(master_replica_placement_min_free_bytes, advanced);
+
+DEFINE_double(master_replica_placement_activity_weight, 1.0,
+              "How much the rates of rows written and scanned by tablet servers "
+              "count when choosing between two of them for a new tablet replica. "
+              "With a weight of 1, a server doing all of the writes and scans of "
+              "the two counts as hosting twice as many replicas. 0 disables it.");
+TAG_FLAG(master_replica_placement_activity_weight, advanced);
+
+DEFINE_bool(master_auto_rebalancing_enabled, false,
+            "Whether the leader master should move tablet replicas and leadership "
+            "between tablet servers to even out the number of replicas and the "
+            "number of leaders hosted by each live tablet server.");
+TAG_FLAG(master_auto_rebalancing_enabled, experimental);
+TAG_FLAG(master_auto_rebalancing_enabled, runtime);
+
+DEFINE_int32(master_rebalance_interval_ms, 10 * 1000,
+             "How often the leader master looks for replicas and leaders to move "
+             "when --master_auto_rebalancing_enabled is set.");
+TAG_FLAG(master_rebalance_interval_ms, advanced);
+TAG_FLAG(master_rebalance_interval_ms, runtime);
+
+DEFINE_int32(master_rebalance_max_moves_in_flight, 2,
+             "The maximum number of replica moves that the rebalancer has in flight "
+             "at a time, which is also the maximum number of leadership transfers it "
+             "starts per pass. Each replica move copies a tablet.");
+TAG_FLAG(master_rebalance_max_moves_in_flight, advanced);
+TAG_FLAG(master_rebalance_max_moves_in_flight, runtime);
+
+DEFINE_int32(master_rebalance_move_timeout_ms, 30 * 60 * 1000,
+             "How long the rebalancer waits for a replica move to complete before "
+             "giving up on it, allowing other moves to start.");
+TAG_FLAG(master_rebalance_move_timeout_ms, advanced);
+TAG_FLAG(master_rebalance_move_timeout_ms, runtime);
+
+using std::map;
 using std::pair;
 using std::shared_ptr;
 using std::string;
@@ -239,6 +293,8 @@ class TableLoader : public TableVisitor {
 // Tablet Loader
 ////////////////////////////////////////////////////////////
 
+// Visits the tablets concurrently. The tables have all been loaded by then,
+// so only the tablet map needs locking.
 class TabletLoader : public TabletVisitor {
  public:
   explicit TabletLoader(CatalogManager *catalog_manager)
@@ -265,7 +321,10 @@ class TabletLoader : public TabletVisitor {
     l.mutable_data()->pb.CopyFrom(metadata);
 
     // Add the tablet to the tablet manager.
-    catalog_manager_->tablet_map_[tablet->tablet_id()] = tablet;
+    {
+      std::lock_guard<simple_spinlock> map_lock(tablet_map_lock_);
+      catalog_manager_->tablet_map_[tablet->tablet_id()] = tablet;
+    }
 
     // Add the tablet to the Tablet.
     bool is_deleted = l.mutable_data()->is_deleted();
@@ -274,14 +333,15 @@ class TabletLoader : public TabletVisitor {
       table->AddTablet(tablet);
     }
 
-    LOG(INFO) << "Loaded metadata for tablet " << tablet_id
-              << " (table " << table->ToString() << ")";
+    VLOG(1) << "Loaded metadata for tablet " << tablet_id
+            << " (table " << table->ToString() << ")";
     VLOG(2) << "Metadata for tablet " << tablet_id << ": " << metadata.ShortDebugString();
     return Status::OK();
   }
 
  private:
   CatalogManager *catalog_manager_;
+  simple_spinlock tablet_map_lock_;
 
   DISALLOW_COPY_AND_ASSIGN(TabletLoader);
 };
@@ -365,25 +425,29 @@ void CatalogManagerBgTasks::Run() {
         LOG(WARNING) << "Catalog manager background task thread going to sleep: "
                      << l.catalog_status().ToString();
       } else if (l.leader_status().ok()) {
-        std::vector<scoped_refptr<TabletInfo>> to_process;
+        std::vector<std::vector<scoped_refptr<TabletInfo>>> to_process;
 
-        // Get list of tablets not yet running.
+        // Get list of tablets not yet running, by table.
         catalog_manager_->ExtractTabletsToProcess(&to_process);
 
-        if (!to_process.empty()) {
+        for (const auto& table_tablets : to_process) {
           // Transition tablet assignment state from preparing to creating, send
           // and schedule creation / deletion RPC messages, etc.
-          Status s = catalog_manager_->ProcessPendingAssignments(to_process);
+          Status s = catalog_manager_->ProcessPendingAssignments(table_tablets);
           if (!s.ok()) {
-            // If there is an error (e.g., we are not the leader) abort this task
-            // and wait until we're woken up again.
+            // If there is an error (e.g., not enough tablet servers for this
+            // table) abort this table's task and move on to the next table;
+            // it will be retried when we're woken up again.
             //
             // TODO Add tests for this in the revision that makes
             // create/alter fault tolerant.
-            LOG(ERROR) << "Error processing pending assignments, aborting the current task: "
-                       << s.ToString();
+            LOG(ERROR) << "Error processing pending assignments of table "
+                       << table_tablets[0]->table()->ToString()
+                       << ", aborting the current task: " << s.ToString();
           }
         }
+
+        catalog_manager_->RebalanceIfDue();
       }
     }
 
@@ -684,14 +748,22 @@ Status CatalogManager::VisitTablesAndTablets() {
   table_names_map_.clear();
   table_ids_map_.clear();
   tablet_map_.clear();
+  {
+    std::lock_guard<simple_spinlock> l(replica_moves_lock_);
+    replica_moves_.clear();
+  }
 
   // Visit tables and tablets, load them into memory.
   TableLoader table_loader(this);
   RETURN_NOT_OK_PREPEND(sys_catalog_->VisitTables(&table_loader),
                         "Failed while visiting tables in sys catalog");
   TabletLoader tablet_loader(this);
-  RETURN_NOT_OK_PREPEND(sys_catalog_->VisitTablets(&tablet_loader),
-                        "Failed while visiting tablets in sys catalog");
+  LOG_TIMING(INFO, "loading tablet metadata from the sys catalog") {
+    RETURN_NOT_OK_PREPEND(sys_catalog_->VisitTabletsConcurrently(&tablet_loader),
+                          "Failed while visiting tablets in sys catalog");
+  }
+  LOG(INFO) << "Loaded metadata for " << table_ids_map_.size() << " tables and "
+            << tablet_map_.size() << " tablets";
   return Status::OK();
 }
 
@@ -1657,6 +1729,174 @@ Status CatalogManager::AlterTable(const AlterTableRequestPB* req,
   return Status::OK();
 }
 
+Status CatalogManager::SplitTablet(const SplitTabletRequestPB* req,
+                                   SplitTabletResponsePB* resp,
+                                   rpc::RpcContext* rpc) {
+  leader_lock_.AssertAcquiredForReading();
+  RETURN_NOT_OK(CheckOnline());
+
+  LOG(INFO) << "Servicing SplitTablet request from " << RequestorString(rpc)
+            << ": " << req->ShortDebugString();
+
+  // 1. Look up the table and the tablet. The table is write-locked for the
+  //    whole split, so that it can't race with the alteration of its
+  //    partitions.
+  scoped_refptr<TableInfo> table;
+  RETURN_NOT_OK(FindTable(req->table(), &table));
+  if (table == nullptr) {
+    Status s = Status::NotFound("The table does not exist", req->table().ShortDebugString());
+    SetupError(resp->mutable_error(), MasterErrorPB::TABLE_NOT_FOUND, s);
+    return s;
+  }
+  TableMetadataLock l(table.get(), TableMetadataLock::WRITE);
+  if (l.data().is_deleted()) {
+    Status s = Status::NotFound("The table was deleted", l.data().pb.state_msg());
+    SetupError(resp->mutable_error(), MasterErrorPB::TABLE_NOT_FOUND, s);
+    return s;
+  }
+
+  scoped_refptr<TabletInfo> tablet;
+  {
+    shared_lock<LockType> l_map(lock_);
+    tablet = FindPtrOrNull(tablet_map_, req->tablet_id());
+  }
+  if (tablet == nullptr || tablet->table().get() != table.get()) {
+    Status s = Status::NotFound("The tablet does not exist in the table", req->tablet_id());
+    SetupError(resp->mutable_error(), MasterErrorPB::UNKNOWN_ERROR, s);
+    return s;
+  }
+  ConsensusStatePB cstate;
+  {
+    TabletMetadataLock tablet_lock(tablet.get(), TabletMetadataLock::READ);
+    if (!tablet_lock.data().is_running() ||
+        !tablet_lock.data().pb.committed_consensus_state().has_leader_uuid()) {
+      Status s = Status::ServiceUnavailable("The tablet is not running or has no leader",
+                                            tablet->ToString());
+      SetupError(resp->mutable_error(), MasterErrorPB::TABLET_NOT_RUNNING, s);
+      return s;
+    }
+    cstate = tablet_lock.data().pb.committed_consensus_state();
+  }
+
+  // 2. Have the leader split its replica. If a previous attempt got that far,
+  //    the leader reports the tablets of that attempt instead.
+  TRACE("Splitting the leader replica");
+  shared_ptr<TSDescriptor> leader_desc;
+  if (!master_->ts_manager()->LookupTSByUUID(cstate.leader_uuid(), &leader_desc)) {
+    Status s = Status::ServiceUnavailable("The leader of the tablet is not registered",
+                                          cstate.leader_uuid());
+    SetupError(resp->mutable_error(), MasterErrorPB::TABLET_NOT_RUNNING, s);
+    return s;
+  }
+  shared_ptr<tserver::TabletServerAdminServiceProxy> ts_proxy;
+  RETURN_NOT_OK(leader_desc->GetTSAdminProxy(master_->messenger(), &ts_proxy));
+  tserver::SplitTabletRequestPB ts_req;
+  tserver::SplitTabletResponsePB ts_resp;
+  ts_req.set_dest_uuid(cstate.leader_uuid());
+  ts_req.set_tablet_id(tablet->tablet_id());
+  ts_req.set_left_tablet_id(GenerateId());
+  ts_req.set_right_tablet_id(GenerateId());
+  rpc::RpcController controller;
+  controller.set_timeout(MonoDelta::FromMilliseconds(FLAGS_master_ts_rpc_timeout_ms));
+  Status s = ts_proxy->SplitTablet(ts_req, &ts_resp, &controller);
+  if (s.ok() && ts_resp.has_error()) {
+    s = StatusFromPB(ts_resp.error().status());
+  }
+  if (!s.ok()) {
+    s = s.CloneAndPrepend(Substitute("Unable to split tablet $0 on $1",
+                                     tablet->tablet_id(), leader_desc->ToString()));
+    LOG(WARNING) << s.ToString();
+    SetupError(resp->mutable_error(), MasterErrorPB::UNKNOWN_ERROR, s);
+    return s;
+  }
+
+  // 3. Replace the tablet with the new ones in sys-catalog. The new tablets
+  //    are running already, with the leader of the split tablet as their
+  //    only replica.
+  vector<scoped_refptr<TabletInfo>> new_tablets;
+  for (const auto& id_and_partition :
+       { std::make_pair(&ts_resp.left_tablet_id(), &ts_resp.left_partition()),
+         std::make_pair(&ts_resp.right_tablet_id(), &ts_resp.right_partition()) }) {
+    scoped_refptr<TabletInfo> new_tablet(new TabletInfo(table, *id_and_partition.first));
+    new_tablet->mutable_metadata()->StartMutation();
+    SysTabletsEntryPB* metadata = &new_tablet->mutable_metadata()->mutable_dirty()->pb;
+    metadata->set_state(SysTabletsEntryPB::RUNNING);
+    metadata->set_state_msg("Split from tablet " + tablet->tablet_id());
+    metadata->mutable_partition()->CopyFrom(*id_and_partition.second);
+    metadata->set_table_id(table->id());
+    ConsensusStatePB* new_cstate = metadata->mutable_committed_consensus_state();
+    new_cstate->set_current_term(kMinimumTerm);
+    consensus::RaftConfigPB* config = new_cstate->mutable_config();
+    config->set_obsolete_local(false);
+    config->set_opid_index(consensus::kInvalidOpIdIndex);
+    for (const RaftPeerPB& peer : cstate.config().peers()) {
+      if (peer.permanent_uuid() == cstate.leader_uuid()) {
+        *config->add_peers() = peer;
+      }
+    }
+    new_tablets.push_back(std::move(new_tablet));
+  }
+  const string deletion_msg = Substitute("Split into $0 and $1 at $2",
+                                         ts_resp.left_tablet_id(), ts_resp.right_tablet_id(),
+                                         LocalTimeAsString());
+
+  ScopedTabletInfoCommitter new_tablets_committer(ScopedTabletInfoCommitter::LOCKED);
+  ScopedTabletInfoCommitter split_tablet_committer(ScopedTabletInfoCommitter::UNLOCKED);
+  new_tablets_committer.AddTablets(new_tablets);
+  split_tablet_committer.AddTablets({ tablet });
+  split_tablet_committer.LockTabletsForWriting();
+  tablet->mutable_metadata()->mutable_dirty()->set_state(SysTabletsEntryPB::DELETED,
+                                                         deletion_msg);
+
+  TRACE("Updating metadata on disk");
+  SysCatalogTable::Actions actions;
+  for (const auto& new_tablet : new_tablets) {
+    actions.tablets_to_add.push_back(new_tablet.get());
+  }
+  actions.tablets_to_update.push_back(tablet.get());
+  s = sys_catalog_->Write(actions);
+  if (!s.ok()) {
+    s = s.CloneAndPrepend(
+        Substitute("An error occurred while updating sys-catalog tables entry: $0",
+                   s.ToString()));
+    LOG(WARNING) << s.ToString();
+    CheckIfNoLongerLeaderAndSetupError(s, resp);
+    new_tablets_committer.Abort();
+    split_tablet_committer.Abort();
+    return s;
+  }
+
+  // 4. Commit the in-memory state, in the same order as AlterTable() does
+  //    for added and dropped range partitions.
+  TRACE("Committing the split to in-memory state");
+  new_tablets_committer.Commit();
+  {
+    std::lock_guard<LockType> lock(lock_);
+    for (const auto& new_tablet : new_tablets) {
+      InsertOrDie(&tablet_map_, new_tablet->tablet_id(), new_tablet);
+    }
+  }
+  table->AddRemoveTablets(new_tablets, { tablet });
+  split_tablet_committer.Commit();
+  l.Unlock();
+
+  // 5. Delete the replicas of the split tablet. The new tablets don't share
+  //    any data blocks with the followers' replicas, which are copied anew.
+  {
+    TabletMetadataLock tablet_lock(tablet.get(), TabletMetadataLock::READ);
+    SendDeleteTabletRequest(tablet, tablet_lock, deletion_msg);
+  }
+
+  for (const auto& new_tablet : new_tablets) {
+    resp->add_new_tablet_ids(new_tablet->tablet_id());
+  }
+  LOG(INFO) << "Split tablet " << tablet->ToString() << " into "
+            << ts_resp.left_tablet_id() << " and " << ts_resp.right_tablet_id()
+            << " per request from " << RequestorString(rpc);
+  background_tasks_->Wake();
+  return Status::OK();
+}
+
 Status CatalogManager::IsAlterTableDone(const IsAlterTableDoneRequestPB* req,
                                         IsAlterTableDoneResponsePB* resp,
                                         rpc::RpcContext* rpc) {
@@ -1714,6 +1954,7 @@ Status CatalogManager::GetTableSchema(const GetTableSchemaRequestPB* req,
   } else {
     // There's no AlterTable, the regular schema is "fully applied".
     resp->mutable_schema()->CopyFrom(l.data().pb.schema());
+    resp->set_schema_version(l.data().pb.version());
   }
   resp->set_num_replicas(l.data().pb.num_replicas());
   resp->set_table_id(table->id());
@@ -1788,6 +2029,20 @@ void CatalogManager::NotifyTabletDeleteSuccess(const string& permanent_uuid,
   // tablet.
 }
 
+struct CatalogManager::ReportedTablet {
+  const ReportedTabletPB* report;
+  ReportedTabletUpdatesPB* report_updates;
+  scoped_refptr<TabletInfo> tablet;
+  unique_ptr<TabletMetadataLock> tablet_lock;
+
+  // Set by HandleReportedTablet(): whether the tablet metadata was changed,
+  // whether the report was handled to the end, and whether the tablet must
+  // be sent the latest schema.
+  bool modified = false;
+  bool handled = false;
+  bool needs_alter = false;
+};
+
 Status CatalogManager::ProcessTabletReport(TSDescriptor* ts_desc,
                                            const TabletReportPB& report,
                                            TabletReportUpdatesPB *report_update,
@@ -1807,11 +2062,83 @@ Status CatalogManager::ProcessTabletReport(TSDescriptor* ts_desc,
   // the server should have, compare vs the ones being reported, and somehow mark
   // any that have been "lost" (eg somehow the tablet metadata got corrupted or something).
 
+  // Look up the reported tablets. Unknown tablets are handled right away.
+  vector<ReportedTablet> reported_tablets;
+  reported_tablets.reserve(report.updated_tablets_size());
   for (const ReportedTabletPB& reported : report.updated_tablets()) {
     ReportedTabletUpdatesPB *tablet_report = report_update->add_tablets();
     tablet_report->set_tablet_id(reported.tablet_id());
-    RETURN_NOT_OK_PREPEND(HandleReportedTablet(ts_desc, reported, tablet_report),
-                          Substitute("Error handling $0", reported.ShortDebugString()));
+    scoped_refptr<TabletInfo> tablet;
+    {
+      shared_lock<LockType> l(lock_);
+      tablet = FindPtrOrNull(tablet_map_, reported.tablet_id());
+    }
+    if (!tablet) {
+      HandleUnknownReportedTablet(ts_desc, reported);
+      continue;
+    }
+    reported_tablets.emplace_back();
+    reported_tablets.back().report = &reported;
+    reported_tablets.back().report_updates = tablet_report;
+    reported_tablets.back().tablet = std::move(tablet);
+  }
+
+  // The metadata of all of the tablets stays locked until the changes to it
+  // are written to the sys catalog in a single batch. The locks are
+  // acquired in tablet ID order, as required by the locking rules.
+  std::stable_sort(reported_tablets.begin(), reported_tablets.end(),
+                   [](const ReportedTablet& a, const ReportedTablet& b) {
+                     return a.tablet->tablet_id() < b.tablet->tablet_id();
+                   });
+  // If a tablet is reported more than once, only its last report is handled.
+  reported_tablets.erase(
+      reported_tablets.begin(),
+      std::unique(reported_tablets.rbegin(), reported_tablets.rend(),
+                  [](const ReportedTablet& a, const ReportedTablet& b) {
+                    return a.tablet == b.tablet;
+                  }).base());
+  for (ReportedTablet& reported : reported_tablets) {
+    reported.tablet_lock.reset(new TabletMetadataLock(reported.tablet.get(),
+                                                      TabletMetadataLock::WRITE));
+  }
+
+  SysCatalogTable::Actions actions;
+  for (ReportedTablet& reported : reported_tablets) {
+    RETURN_NOT_OK_PREPEND(HandleReportedTablet(ts_desc, &reported),
+                          Substitute("Error handling $0", reported.report->ShortDebugString()));
+    if (reported.modified) {
+      actions.tablets_to_update.push_back(reported.tablet.get());
+    }
+  }
+
+  // Tablets whose metadata didn't change aren't written: that's the case for
+  // most tablets in a full report following a master restart.
+  if (!actions.tablets_to_update.empty()) {
+    Status s = sys_catalog_->Write(actions);
+    if (!s.ok()) {
+      LOG(WARNING) << "Error updating " << actions.tablets_to_update.size()
+                   << " tablets: " << s.ToString() << ". Tablet report was: "
+                   << report.ShortDebugString();
+      return s;
+    }
+  }
+  for (ReportedTablet& reported : reported_tablets) {
+    if (reported.modified) {
+      reported.tablet_lock->Commit();
+    } else {
+      reported.tablet_lock->Unlock();
+    }
+  }
+
+  // Need to defer the AlterTable command to after we've committed the new tablet data,
+  // since the tablet report may also be updating the raft config, and the Alter Table
+  // request needs to know who the most recent leader is.
+  for (const ReportedTablet& reported : reported_tablets) {
+    if (reported.needs_alter) {
+      SendAlterTabletRequest(reported.tablet);
+    } else if (reported.handled && reported.report->has_schema_version()) {
+      HandleTabletSchemaVersionReport(reported.tablet.get(), reported.report->schema_version());
+    }
   }
 
   if (report.updated_tablets_size() > 0) {
@@ -1839,36 +2166,33 @@ bool ShouldTransitionTabletToRunning(const ReportedTabletPB& report) {
 }
 } // anonymous namespace
 
-Status CatalogManager::HandleReportedTablet(TSDescriptor* ts_desc,
-                                            const ReportedTabletPB& report,
-                                            ReportedTabletUpdatesPB *report_updates) {
+void CatalogManager::HandleUnknownReportedTablet(TSDescriptor* ts_desc,
+                                                 const ReportedTabletPB& report) {
+  // It'd be unsafe to ask the tserver to delete this tablet without first
+  // replicating something to our followers (i.e. to guarantee that we're the
+  // leader). For example, if we were a rogue master, we might be deleting a
+  // tablet created by a new master accidentally. But masters retain metadata
+  // for deleted tablets forever, so a tablet can only be truly unknown in
+  // the event of a serious misconfiguration, such as a tserver heartbeating
+  // to the wrong cluster. Therefore, it should be reasonable to ignore it
+  // and wait for an operator fix the situation.
+  if (FLAGS_catalog_manager_delete_orphaned_tablets) {
+    LOG(INFO) << "Deleting unknown tablet " << report.tablet_id();
+    SendDeleteReplicaRequest(report.tablet_id(), TABLET_DATA_DELETED,
+                             boost::none, nullptr, ts_desc->permanent_uuid(),
+                             "Report from unknown tablet");
+  } else {
+    LOG(WARNING) << "Ignoring report from unknown tablet: "
+                 << report.tablet_id();
+  }
+}
+
+Status CatalogManager::HandleReportedTablet(TSDescriptor* ts_desc, ReportedTablet* reported) {
+  const ReportedTabletPB& report = *reported->report;
+  ReportedTabletUpdatesPB* report_updates = reported->report_updates;
+  const scoped_refptr<TabletInfo>& tablet = reported->tablet;
   TRACE_EVENT1("master", "HandleReportedTablet",
                "tablet_id", report.tablet_id());
-  scoped_refptr<TabletInfo> tablet;
-  {
-    shared_lock<LockType> l(lock_);
-    tablet = FindPtrOrNull(tablet_map_, report.tablet_id());
-  }
-  if (!tablet) {
-    // It'd be unsafe to ask the tserver to delete this tablet without first
-    // replicating something to our followers (i.e. to guarantee that we're the
-    // leader). For example, if we were a rogue master, we might be deleting a
-    // tablet created by a new master accidentally. But masters retain metadata
-    // for deleted tablets forever, so a tablet can only be truly unknown in
-    // the event of a serious misconfiguration, such as a tserver heartbeating
-    // to the wrong cluster. Therefore, it should be reasonable to ignore it
-    // and wait for an operator fix the situation.
-    if (FLAGS_catalog_manager_delete_orphaned_tablets) {
-      LOG(INFO) << "Deleting unknown tablet " << report.tablet_id();
-      SendDeleteReplicaRequest(report.tablet_id(), TABLET_DATA_DELETED,
-                               boost::none, nullptr, ts_desc->permanent_uuid(),
-                               "Report from unknown tablet");
-    } else {
-      LOG(WARNING) << "Ignoring report from unknown tablet: "
-                   << report.tablet_id();
-    }
-    return Status::OK();
-  }
   DCHECK(tablet->table()); // guaranteed by TabletLoader
 
   VLOG(3) << "tablet report: " << report.ShortDebugString();
@@ -1876,7 +2200,8 @@ Status CatalogManager::HandleReportedTablet(TSDescriptor* ts_desc,
   // TODO: we don't actually need to do the COW here until we see we're going
   // to change the state. Can we change CowedObject to lazily do the copy?
   TableMetadataLock table_lock(tablet->table().get(), TableMetadataLock::READ);
-  TabletMetadataLock tablet_lock(tablet.get(), TabletMetadataLock::WRITE);
+  TabletMetadataLock& tablet_lock = *reported->tablet_lock;
+  DCHECK(tablet_lock.is_write_locked());
 
   // If the TS is reporting a tablet which has been deleted, or a tablet from
   // a table which has been deleted, send it an RPC to delete it.
@@ -1902,8 +2227,16 @@ Status CatalogManager::HandleReportedTablet(TSDescriptor* ts_desc,
     return Status::OK();
   }
 
+  // A replica being moved over by the rebalancer may have finished copying.
+  if (report.state() == tablet::RUNNING) {
+    std::lock_guard<simple_spinlock> l(replica_moves_lock_);
+    ReplicaMove* move = FindOrNull(replica_moves_, tablet->tablet_id());
+    if (move && move->to_uuid == ts_desc->permanent_uuid()) {
+      move->to_running = true;
+    }
+  }
+
   // Check if the tablet requires an "alter table" call
-  bool tablet_needs_alter = false;
   if (report.has_schema_version() &&
       table_lock.data().pb.version() != report.schema_version()) {
     if (report.schema_version() > table_lock.data().pb.version()) {
@@ -1922,7 +2255,7 @@ Status CatalogManager::HandleReportedTablet(TSDescriptor* ts_desc,
     // It's possible that the tablet being reported is a laggy replica, and in fact
     // the leader has already received an AlterTable RPC. That's OK, though --
     // it'll safely ignore it if we send another.
-    tablet_needs_alter = true;
+    reported->needs_alter = true;
   }
 
 
@@ -1976,6 +2309,7 @@ Status CatalogManager::HandleReportedTablet(TSDescriptor* ts_desc,
       VLOG(1) << "Tablet " << tablet->ToString() << " is now online";
       tablet_lock.mutable_data()->set_state(SysTabletsEntryPB::RUNNING,
                                             "Tablet reported with an active leader");
+      reported->modified = true;
     }
 
     // The Master only accepts committed consensus configurations since it needs the committed index
@@ -2039,32 +2373,11 @@ Status CatalogManager::HandleReportedTablet(TSDescriptor* ts_desc,
 
       RETURN_NOT_OK(HandleRaftConfigChanged(*final_report, tablet,
                                             &tablet_lock, &table_lock));
-
+      reported->modified = true;
     }
   }
 
-  table_lock.Unlock();
-  // We update the tablets each time that someone reports it.
-  // This shouldn't be very frequent and should only happen when something in fact changed.
-  SysCatalogTable::Actions actions;
-  actions.tablets_to_update.push_back(tablet.get());
-  Status s = sys_catalog_->Write(actions);
-  if (!s.ok()) {
-    LOG(WARNING) << "Error updating tablets: " << s.ToString() << ". Tablet report was: "
-                 << report.ShortDebugString();
-    return s;
-  }
-  tablet_lock.Commit();
-
-  // Need to defer the AlterTable command to after we've committed the new tablet data,
-  // since the tablet report may also be updating the raft config, and the Alter Table
-  // request needs to know who the most recent leader is.
-  if (tablet_needs_alter) {
-    SendAlterTabletRequest(tablet);
-  } else if (report.has_schema_version()) {
-    HandleTabletSchemaVersionReport(tablet.get(), report.schema_version());
-  }
-
+  reported->handled = true;
   return Status::OK();
 }
 
@@ -2273,6 +2586,12 @@ class RetryingTSRpcTask : public MonitoredTask {
   // Return the id of the tablet that is the subject of the async request.
   virtual string tablet_id() const = 0;
 
+  // Handle the failure of the RPC request itself, as opposed to an error in
+  // its response. The RPC is retried unless this changes the state.
+  //
+  // Runs on the reactor thread, so must not block or perform any IO.
+  virtual void HandleRpcError(int attempt) {}
+
   // Overridable log prefix with reasonable default.
   virtual string LogPrefix() const {
     return Substitute("$0: ", description());
@@ -2301,6 +2620,9 @@ class RetryingTSRpcTask : public MonitoredTask {
       LOG(WARNING) << "TS " << target_ts_desc_->ToString() << ": "
                    << type_name() << " RPC failed for tablet "
                    << tablet_id() << ": " << rpc_.status().ToString();
+      if (state() != kStateAborted) {
+        HandleRpcError(attempt_); // May modify state_.
+      }
     } else if (state() != kStateAborted) {
       HandleResponse(attempt_); // Modifies state_.
     }
@@ -2453,17 +2775,37 @@ class AsyncCreateReplica : public RetrySpecificTSRpcTask {
     : RetrySpecificTSRpcTask(master, permanent_uuid, tablet->table()),
       tablet_id_(tablet->tablet_id()) {
     deadline_ = start_ts_ + MonoDelta::FromMilliseconds(FLAGS_tablet_creation_timeout_ms);
+    PrepareRequest(permanent_uuid, tablet, tablet_lock, &req_);
+  }
 
+  // Sends the request 'req', prepared by PrepareRequest().
+  AsyncCreateReplica(Master *master,
+                     const string& permanent_uuid,
+                     const scoped_refptr<TableInfo>& table,
+                     tserver::CreateTabletRequestPB req,
+                     const MonoTime& deadline)
+    : RetrySpecificTSRpcTask(master, permanent_uuid, table),
+      tablet_id_(req.tablet_id()),
+      req_(std::move(req)) {
+    deadline_ = deadline;
+  }
+
+  // Fills in 'req' with the request to create the replica of 'tablet' on
+  // 'permanent_uuid'. The tablet lock must be acquired for reading.
+  static void PrepareRequest(const string& permanent_uuid,
+                             const scoped_refptr<TabletInfo>& tablet,
+                             const TabletMetadataLock& tablet_lock,
+                             tserver::CreateTabletRequestPB* req) {
     TableMetadataLock table_lock(tablet->table().get(), TableMetadataLock::READ);
-    req_.set_dest_uuid(permanent_uuid);
-    req_.set_table_id(tablet->table()->id());
-    req_.set_tablet_id(tablet->tablet_id());
-    req_.mutable_partition()->CopyFrom(tablet_lock.data().pb.partition());
-    req_.set_table_name(table_lock.data().pb.name());
-    req_.mutable_schema()->CopyFrom(table_lock.data().pb.schema());
-    req_.mutable_partition_schema()->CopyFrom(
+    req->set_dest_uuid(permanent_uuid);
+    req->set_table_id(tablet->table()->id());
+    req->set_tablet_id(tablet->tablet_id());
+    req->mutable_partition()->CopyFrom(tablet_lock.data().pb.partition());
+    req->set_table_name(table_lock.data().pb.name());
+    req->mutable_schema()->CopyFrom(table_lock.data().pb.schema());
+    req->mutable_partition_schema()->CopyFrom(
         table_lock.data().pb.partition_schema());
-    req_.mutable_config()->CopyFrom(
+    req->mutable_config()->CopyFrom(
         tablet_lock.data().pb.committed_consensus_state().config());
   }
 
@@ -2509,6 +2851,109 @@ class AsyncCreateReplica : public RetrySpecificTSRpcTask {
   tserver::CreateTabletResponsePB resp_;
 };
 
+// Fire off the async creation of several tablet replicas on the same tablet
+// server, with a single CreateTablets() RPC. Each retry only includes the
+// replicas which haven't been created yet.
+//
+// Tablet servers which don't support CreateTablets() get one AsyncCreateReplica
+// task per replica instead.
+class AsyncCreateReplicas : public RetrySpecificTSRpcTask {
+ public:
+  // 'reqs' must have been prepared by AsyncCreateReplica::PrepareRequest().
+  AsyncCreateReplicas(Master *master,
+                      const string& permanent_uuid,
+                      const scoped_refptr<TableInfo>& table,
+                      vector<tserver::CreateTabletRequestPB> reqs)
+    : RetrySpecificTSRpcTask(master, permanent_uuid, table) {
+    deadline_ = start_ts_ + MonoDelta::FromMilliseconds(FLAGS_tablet_creation_timeout_ms);
+    req_.set_dest_uuid(permanent_uuid);
+    for (auto& r : reqs) {
+      req_.add_tablets()->Swap(&r);
+    }
+  }
+
+  virtual string type_name() const OVERRIDE { return "Create Tablets"; }
+
+  virtual string description() const OVERRIDE {
+    return Substitute("CreateTablets RPC for $0 tablets on TS $1",
+                      req_.tablets_size(), permanent_uuid_);
+  }
+
+ protected:
+  virtual string tablet_id() const OVERRIDE {
+    return req_.tablets_size() == 0 ? "" : req_.tablets(0).tablet_id();
+  }
+
+  virtual void HandleResponse(int attempt) OVERRIDE {
+    if (resp_.has_error()) {
+      LOG(WARNING) << "CreateTablets RPC on TS " << target_ts_desc_->ToString() << " failed: "
+                   << StatusFromPB(resp_.error().status()).ToString();
+      return;
+    }
+    if (resp_.tablets_size() != req_.tablets_size()) {
+      LOG(WARNING) << "CreateTablets RPC on TS " << target_ts_desc_->ToString()
+                   << " returned " << resp_.tablets_size() << " results for "
+                   << req_.tablets_size() << " tablets";
+      return;
+    }
+
+    // Keep the tablets which failed for the next attempt.
+    tserver::CreateTabletsRequestPB retry_req;
+    retry_req.set_dest_uuid(req_.dest_uuid());
+    for (int i = 0; i < req_.tablets_size(); i++) {
+      const tserver::CreateTabletResponsePB& tablet_resp = resp_.tablets(i);
+      if (tablet_resp.has_error()) {
+        Status s = StatusFromPB(tablet_resp.error().status());
+        if (s.IsAlreadyPresent()) {
+          LOG(INFO) << "CreateTablet RPC for tablet " << req_.tablets(i).tablet_id()
+                    << " on TS " << target_ts_desc_->ToString()
+                    << " returned already present: " << s.ToString();
+        } else {
+          LOG(WARNING) << "CreateTablet RPC for tablet " << req_.tablets(i).tablet_id()
+                       << " on TS " << target_ts_desc_->ToString() << " failed: "
+                       << s.ToString();
+          retry_req.add_tablets()->Swap(req_.mutable_tablets(i));
+        }
+      }
+    }
+    req_.Swap(&retry_req);
+    if (req_.tablets_size() == 0) {
+      MarkComplete();
+    }
+  }
+
+  virtual void HandleRpcError(int attempt) OVERRIDE {
+    const rpc::ErrorStatusPB* err = rpc_.error_response();
+    if (!err || err->code() != rpc::ErrorStatusPB::ERROR_NO_SUCH_METHOD) {
+      return;
+    }
+    LOG(INFO) << "TS " << target_ts_desc_->ToString() << " doesn't support CreateTablets(), "
+              << "creating its " << req_.tablets_size() << " replicas one by one";
+    for (int i = 0; i < req_.tablets_size(); i++) {
+      auto task = new AsyncCreateReplica(master_, permanent_uuid_, table_,
+                                         std::move(*req_.mutable_tablets(i)), deadline_);
+      table_->AddTask(task);
+      WARN_NOT_OK(task->Run(), "Failed to send new tablet request");
+    }
+    MarkComplete();
+  }
+
+  virtual bool SendRequest(int attempt) OVERRIDE {
+    VLOG(1) << "Send create tablets request to "
+            << target_ts_desc_->ToString() << ":\n"
+            << " (attempt " << attempt << "):\n"
+            << req_.DebugString();
+    resp_.Clear();
+    ts_proxy_->CreateTabletsAsync(req_, &resp_, &rpc_,
+                                  boost::bind(&AsyncCreateReplicas::RpcCallback, this));
+    return true;
+  }
+
+ private:
+  tserver::CreateTabletsRequestPB req_;
+  tserver::CreateTabletsResponsePB resp_;
+};
+
 // Send a DeleteTablet() RPC request.
 class AsyncDeleteReplica : public RetrySpecificTSRpcTask {
  public:
@@ -2823,6 +3268,131 @@ void AsyncAddServerTask::HandleResponse(int attempt) {
   }
 }
 
+// Changes the config of a tablet on behalf of the rebalancer, by adding or
+// removing one peer. Unlike AsyncAddServerTask, the task gives up on any
+// error from the leader: the next rebalancing pass decides what to do based
+// on the config at that time.
+class AsyncRebalanceChangeConfig : public RetryingTSRpcTask {
+ public:
+  AsyncRebalanceChangeConfig(Master* master,
+                             const scoped_refptr<TabletInfo>& tablet,
+                             int64_t cas_config_opid_index,
+                             consensus::ChangeConfigType type,
+                             RaftPeerPB peer)
+    : RetryingTSRpcTask(master,
+                        gscoped_ptr<TSPicker>(new PickLeaderReplica(tablet)),
+                        tablet->table()),
+      tablet_(tablet),
+      cas_config_opid_index_(cas_config_opid_index),
+      type_(type),
+      peer_(std::move(peer)) {
+  }
+
+  virtual string type_name() const OVERRIDE { return "Rebalance ChangeConfig"; }
+
+  virtual string description() const OVERRIDE {
+    return Substitute("Rebalance $0 ChangeConfig RPC of peer $1 for tablet $2 on TS $3 "
+                      "with cas_config_opid_index $4",
+                      consensus::ChangeConfigType_Name(type_),
+                      peer_.permanent_uuid(),
+                      tablet_->tablet_id(),
+                      target_ts_desc_->ToString(),
+                      cas_config_opid_index_);
+  }
+
+ protected:
+  virtual bool SendRequest(int attempt) OVERRIDE {
+    req_.set_dest_uuid(target_ts_desc_->permanent_uuid());
+    req_.set_tablet_id(tablet_->tablet_id());
+    req_.set_type(type_);
+    req_.set_cas_config_opid_index(cas_config_opid_index_);
+    *req_.mutable_server() = peer_;
+    VLOG(1) << "Sending " << type_name() << " request to "
+            << target_ts_desc_->ToString() << ":\n"
+            << req_.DebugString();
+    consensus_proxy_->ChangeConfigAsync(
+        req_, &resp_, &rpc_,
+        boost::bind(&AsyncRebalanceChangeConfig::RpcCallback, this));
+    return true;
+  }
+
+  virtual void HandleResponse(int attempt) OVERRIDE {
+    if (!resp_.has_error()) {
+      MarkComplete();
+      LOG_WITH_PREFIX(INFO) << "Change config succeeded";
+      return;
+    }
+    LOG_WITH_PREFIX(WARNING) << "ChangeConfig() failed with leader "
+                             << target_ts_desc_->ToString() << " due to error "
+                             << TabletServerErrorPB::Code_Name(resp_.error().code())
+                             << ": " << StatusFromPB(resp_.error().status()).ToString();
+    MarkFailed();
+  }
+
+ private:
+  virtual string tablet_id() const OVERRIDE { return tablet_->tablet_id(); }
+
+  const scoped_refptr<TabletInfo> tablet_;
+  const int64_t cas_config_opid_index_;
+  const consensus::ChangeConfigType type_;
+  const RaftPeerPB peer_;
+
+  consensus::ChangeConfigRequestPB req_;
+  consensus::ChangeConfigResponsePB resp_;
+};
+
+// Asks the leader of a tablet to hand its leadership over to another voter.
+class AsyncLeaderTransfer : public RetrySpecificTSRpcTask {
+ public:
+  AsyncLeaderTransfer(Master* master,
+                      const scoped_refptr<TabletInfo>& tablet,
+                      const string& leader_uuid,
+                      string new_leader_uuid)
+    : RetrySpecificTSRpcTask(master, leader_uuid, tablet->table()),
+      tablet_(tablet),
+      new_leader_uuid_(std::move(new_leader_uuid)) {
+  }
+
+  virtual string type_name() const OVERRIDE { return "LeaderStepDown"; }
+
+  virtual string description() const OVERRIDE {
+    return Substitute("LeaderStepDown RPC for tablet $0 on TS $1 to new leader $2",
+                      tablet_->tablet_id(), permanent_uuid_, new_leader_uuid_);
+  }
+
+ protected:
+  virtual bool SendRequest(int attempt) OVERRIDE {
+    req_.set_dest_uuid(permanent_uuid_);
+    req_.set_tablet_id(tablet_->tablet_id());
+    req_.set_new_leader_uuid(new_leader_uuid_);
+    consensus_proxy_->LeaderStepDownAsync(
+        req_, &resp_, &rpc_,
+        boost::bind(&AsyncLeaderTransfer::RpcCallback, this));
+    return true;
+  }
+
+  virtual void HandleResponse(int attempt) OVERRIDE {
+    if (!resp_.has_error()) {
+      MarkComplete();
+      LOG_WITH_PREFIX(INFO) << "Leader transfer succeeded";
+      return;
+    }
+    LOG_WITH_PREFIX(WARNING) << "LeaderStepDown() failed due to error "
+                             << TabletServerErrorPB::Code_Name(resp_.error().code())
+                             << ": " << StatusFromPB(resp_.error().status()).ToString();
+    MarkFailed();
+  }
+
+ private:
+  virtual string tablet_id() const OVERRIDE { return tablet_->tablet_id(); }
+
+  const scoped_refptr<TabletInfo> tablet_;
+  const string new_leader_uuid_;
+
+  consensus::LeaderStepDownRequestPB req_;
+  consensus::LeaderStepDownResponsePB resp_;
+};
+
 void CatalogManager::SendAlterTableRequest(const scoped_refptr<TableInfo>& table) {
   vector<scoped_refptr<TabletInfo> > tablets;
   table->GetAllTablets(&tablets);
@@ -2902,20 +3472,276 @@ void CatalogManager::SendAddServerRequest(const scoped_refptr<TabletInfo>& table
   LOG(INFO) << "Started AddServer task for tablet " << tablet->tablet_id();
 }
 
+void CatalogManager::SendRebalanceChangeConfigRequest(const scoped_refptr<TabletInfo>& tablet,
+                                                      int64_t cas_config_opid_index,
+                                                      consensus::ChangeConfigType type,
+                                                      const RaftPeerPB& peer) {
+  auto task = new AsyncRebalanceChangeConfig(master_, tablet, cas_config_opid_index,
+                                             type, peer);
+  tablet->table()->AddTask(task);
+  WARN_NOT_OK(task->Run(), "Failed to send rebalance ChangeConfig request");
+}
+
+void CatalogManager::SendLeaderTransferRequest(const scoped_refptr<TabletInfo>& tablet,
+                                               const string& leader_uuid,
+                                               const string& new_leader_uuid) {
+  auto task = new AsyncLeaderTransfer(master_, tablet, leader_uuid, new_leader_uuid);
+  tablet->table()->AddTask(task);
+  WARN_NOT_OK(task->Run(), "Failed to send LeaderStepDown request");
+}
+
+namespace {
+
+// The committed config of a running tablet, as seen by a rebalancing pass.
+struct RebalanceTablet {
+  scoped_refptr<TabletInfo> tablet;
+  ConsensusStatePB cstate;
+  int num_replicas;
+};
+
+// Returns the UUID of the element of 'counts' with the highest count if
+// 'highest' is true, or the lowest one otherwise, among those which pass
+// 'filter'. Returns the empty string if none does.
+template<class Filter>
+string PickExtreme(const unordered_map<string, int>& counts, bool highest,
+                   const Filter& filter) {
+  string ret;
+  int ret_count = 0;
+  for (const auto& e : counts) {
+    if (!filter(e.first)) continue;
+    if (ret.empty() || (highest ? e.second > ret_count : e.second < ret_count)) {
+      ret = e.first;
+      ret_count = e.second;
+    }
+  }
+  return ret;
+}
+
+} // anonymous namespace
+
+void CatalogManager::RebalanceIfDue() {
+  if (!FLAGS_master_auto_rebalancing_enabled) {
+    return;
+  }
+  MonoTime now = MonoTime::Now();
+  if (last_rebalance_time_.Initialized() &&
+      now - last_rebalance_time_ <
+      MonoDelta::FromMilliseconds(FLAGS_master_rebalance_interval_ms)) {
+    return;
+  }
+  last_rebalance_time_ = now;
+
+  // Count the replicas and leaders of each live tablet server. Replicas on
+  // other servers are left to re-replication, so tablets which have any, or
+  // which aren't fully replicated, are not touched.
+  TSDescriptorVector live_descs;
+  master_->ts_manager()->GetAllLiveDescriptors(&live_descs);
+  unordered_map<string, shared_ptr<TSDescriptor>> live_by_uuid;
+  unordered_map<string, int> replica_counts;
+  unordered_map<string, int> leader_counts;
+  for (const auto& desc : live_descs) {
+    live_by_uuid[desc->permanent_uuid()] = desc;
+    replica_counts[desc->permanent_uuid()] = 0;
+    leader_counts[desc->permanent_uuid()] = 0;
+  }
+
+  vector<scoped_refptr<TabletInfo>> all_tablets;
+  {
+    shared_lock<LockType> l(lock_);
+    AppendValuesFromMap(tablet_map_, &all_tablets);
+  }
+  vector<RebalanceTablet> tablets;
+  unordered_map<string, const RebalanceTablet*> tablets_by_id;
+  tablets.reserve(all_tablets.size());
+  for (const auto& tablet : all_tablets) {
+    TableMetadataLock table_lock(tablet->table().get(), TableMetadataLock::READ);
+    TabletMetadataLock tablet_lock(tablet.get(), TabletMetadataLock::READ);
+    if (!table_lock.data().is_running() || !tablet_lock.data().is_running() ||
+        !tablet_lock.data().pb.has_committed_consensus_state()) {
+      continue;
+    }
+    tablets.push_back({ tablet, tablet_lock.data().pb.committed_consensus_state(),
+                        table_lock.data().pb.num_replicas() });
+  }
+  for (const auto& t : tablets) {
+    tablets_by_id[t.tablet->tablet_id()] = &t;
+    for (const RaftPeerPB& peer : t.cstate.config().peers()) {
+      int* count = FindOrNull(replica_counts, peer.permanent_uuid());
+      if (count) (*count)++;
+    }
+    int* count = FindOrNull(leader_counts, t.cstate.leader_uuid());
+    if (count) (*count)++;
+  }
+  auto is_movable = [&](const RebalanceTablet& t) {
+    if (!t.cstate.has_leader_uuid() ||
+        CountVoters(t.cstate.config()) != t.num_replicas) {
+      return false;
+    }
+    for (const RaftPeerPB& peer : t.cstate.config().peers()) {
+      if (!ContainsKey(live_by_uuid, peer.permanent_uuid())) return false;
+    }
+    return true;
+  };
+
+  // Advance the moves in flight. Moves which are done or timed out are
+  // dropped; the others count as done for the purpose of planning new ones.
+  struct MoveStep {
+    const RebalanceTablet* t;
+    string from_uuid;
+    string to_uuid;
+  };
+  vector<MoveStep> steps;
+  unordered_set<string> moving_tablets;
+  {
+    std::lock_guard<simple_spinlock> l(replica_moves_lock_);
+    for (auto it = replica_moves_.begin(); it != replica_moves_.end();) {
+      const ReplicaMove& move = it->second;
+      const RebalanceTablet* t = FindPtrOrNull(tablets_by_id, it->first);
+      const consensus::RaftConfigPB* config = t ? &t->cstate.config() : nullptr;
+      if (!config || !IsRaftConfigMember(move.from_uuid, *config)) {
+        LOG(INFO) << "Finished moving the replica of tablet " << it->first
+                  << " from " << move.from_uuid << " to " << move.to_uuid;
+        it = replica_moves_.erase(it);
+        continue;
+      }
+      if (now - move.start_time > MonoDelta::FromMilliseconds(
+              FLAGS_master_rebalance_move_timeout_ms)) {
+        LOG(WARNING) << "Timed out moving the replica of tablet " << it->first
+                     << " from " << move.from_uuid << " to " << move.to_uuid;
+        it = replica_moves_.erase(it);
+        continue;
+      }
+      if (!IsRaftConfigMember(move.to_uuid, *config)) {
+        int* count = FindOrNull(replica_counts, move.to_uuid);
+        if (count) (*count)++;
+      } else if (move.to_running && t->cstate.has_leader_uuid()) {
+        steps.push_back({ t, move.from_uuid, move.to_uuid });
+      }
+      int* count = FindOrNull(replica_counts, move.from_uuid);
+      if (count) (*count)--;
+      moving_tablets.insert(it->first);
+      ++it;
+    }
+  }
+  for (const auto& step : steps) {
+    if (step.t->cstate.leader_uuid() == step.from_uuid) {
+      SendLeaderTransferRequest(step.t->tablet, step.from_uuid, step.to_uuid);
+    } else {
+      RaftPeerPB peer;
+      peer.set_permanent_uuid(step.from_uuid);
+      SendRebalanceChangeConfigRequest(step.t->tablet,
+                                       step.t->cstate.config().opid_index(),
+                                       consensus::REMOVE_SERVER, peer);
+    }
+  }
+
+  // Start new replica moves, from the server with the most replicas to the
+  // one with the fewest, as long as that narrows the gap between them.
+  const int max_moves = FLAGS_master_rebalance_max_moves_in_flight;
+  int num_moves = moving_tablets.size();
+  auto can_receive = [&](const string& uuid) {
+    int64_t bytes_free = live_by_uuid[uuid]->min_data_dir_bytes_free();
+    return bytes_free < 0 || bytes_free >= FLAGS_master_replica_placement_min_free_bytes;
+  };
+  auto any = [](const string&) { return true; };
+  while (num_moves < max_moves) {
+    string from = PickExtreme(replica_counts, true, any);
+    string to = PickExtreme(replica_counts, false, can_receive);
+    if (from.empty() || to.empty() || replica_counts[from] - replica_counts[to] < 2) {
+      break;
+    }
+    const RebalanceTablet* chosen = nullptr;
+    for (const auto& t : tablets) {
+      if (!ContainsKey(moving_tablets, t.tablet->tablet_id()) && is_movable(t) &&
+          IsRaftConfigMember(from, t.cstate.config()) &&
+          !IsRaftConfigMember(to, t.cstate.config())) {
+        chosen = &t;
+        break;
+      }
+    }
+    if (!chosen) {
+      break;
+    }
+    LOG(INFO) << "Moving the replica of tablet " << chosen->tablet->tablet_id()
+              << " from " << from << " (" << replica_counts[from] << " replicas) to "
+              << to << " (" << replica_counts[to] << " replicas)";
+    {
+      std::lock_guard<simple_spinlock> l(replica_moves_lock_);
+      replica_moves_[chosen->tablet->tablet_id()] = { from, to, now, false };
+    }
+    RaftPeerPB peer;
+    peer.set_permanent_uuid(to);
+    peer.set_member_type(RaftPeerPB::VOTER);
+    ServerRegistrationPB reg;
+    live_by_uuid[to]->GetRegistration(&reg);
+    CHECK_GT(reg.rpc_addresses_size(), 0);
+    *peer.mutable_last_known_addr() = reg.rpc_addresses(0);
+    SendRebalanceChangeConfigRequest(chosen->tablet, chosen->cstate.config().opid_index(),
+                                     consensus::ADD_SERVER, peer);
+    moving_tablets.insert(chosen->tablet->tablet_id());
+    replica_counts[from]--;
+    replica_counts[to]++;
+    num_moves++;
+  }
+  if (num_moves > 0) {
+    // The leaders are only balanced once the replicas are, since moves
+    // change the leaders of the tablets they touch.
+    return;
+  }
+
+  // Transfer the leadership of tablets led by the server with the most
+  // leaders to the follower with the fewest, as long as that narrows the gap.
+  for (int i = 0; i < max_moves; i++) {
+    string from = PickExtreme(leader_counts, true, any);
+    if (from.empty()) {
+      break;
+    }
+    RebalanceTablet* chosen = nullptr;
+    string to;
+    for (auto& t : tablets) {
+      if (t.cstate.leader_uuid() != from || !is_movable(t)) continue;
+      for (const RaftPeerPB& peer : t.cstate.config().peers()) {
+        const string& uuid = peer.permanent_uuid();
+        if (uuid != from && peer.member_type() == RaftPeerPB::VOTER &&
+            (to.empty() || leader_counts[uuid] < leader_counts[to])) {
+          chosen = &t;
+          to = uuid;
+        }
+      }
+    }
+    if (!chosen || leader_counts[from] - leader_counts[to] < 2) {
+      break;
+    }
+    LOG(INFO) << "Transferring the leadership of tablet " << chosen->tablet->tablet_id()
+              << " from " << from << " (" << leader_counts[from] << " leaders) to "
+              << to << " (" << leader_counts[to] << " leaders)";
+    SendLeaderTransferRequest(chosen->tablet, from, to);
+    // Don't pick the same tablet again in this pass.
+    chosen->cstate.clear_leader_uuid();
+    leader_counts[from]--;
+    leader_counts[to]++;
+  }
+}
+
 void CatalogManager::ExtractTabletsToProcess(
-    vector<scoped_refptr<TabletInfo>>* tablets_to_process) {
+    vector<vector<scoped_refptr<TabletInfo>>>* tablets_to_process) {
 
-  shared_lock<LockType> l(lock_);
+  // Loop through the tablets without holding 'lock_', which would otherwise
+  // hold up DDL operations for as long as it takes to go through all of them.
+  vector<scoped_refptr<TableInfo>> tables;
+  {
+    shared_lock<LockType> l(lock_);
+    AppendValuesFromMap(table_ids_map_, &tables);
+  }
 
   // TODO: At the moment we loop through all the tablets
   //       we can keep a set of tablets waiting for "assignment"
   //       or just a counter to avoid to take the lock and loop through the tablets
   //       if everything is "stable".
 
-  // 'tablets_to_process' elements must be partially ordered in the same way as
+  // The tablets of each table must be partially ordered in the same way as
   // table->GetAllTablets(); see the locking rules at the top of the file.
-  for (const auto& table_entry : table_ids_map_) {
-    scoped_refptr<TableInfo> table = table_entry.second;
+  for (const auto& table : tables) {
     TableMetadataLock table_lock(table.get(), TableMetadataLock::READ);
     if (table_lock.data().is_deleted()) {
       continue;
@@ -2923,13 +3749,17 @@ void CatalogManager::ExtractTabletsToProcess(
 
     vector<scoped_refptr<TabletInfo>> tablets;
     table->GetAllTablets(&tablets);
+    vector<scoped_refptr<TabletInfo>> table_tablets;
     for (const auto& tablet : tablets) {
       TabletMetadataLock tablet_lock(tablet.get(), TabletMetadataLock::READ);
       if (tablet_lock.data().is_deleted() ||
           tablet_lock.data().is_running()) {
         continue;
       }
-      tablets_to_process->push_back(tablet);
+      table_tablets.push_back(tablet);
+    }
+    if (!table_tablets.empty()) {
+      tablets_to_process->emplace_back(std::move(table_tablets));
     }
   }
 }
@@ -3141,10 +3971,7 @@ Status CatalogManager::ProcessPendingAssignments(
     }
   }
   // Send the CreateTablet() requests to the servers. This is asynchronous / non-blocking.
-  for (TabletInfo* tablet : deferred.needs_create_rpc) {
-    TabletMetadataLock l(tablet, TabletMetadataLock::READ);
-    SendCreateTabletRequest(tablet, l);
-  }
+  SendCreateTabletRequests(deferred.needs_create_rpc);
   return Status::OK();
 }
 
@@ -3185,17 +4012,45 @@ Status CatalogManager::SelectReplicasForTablet(const TSDescriptorVector& ts_desc
   return Status::OK();
 }
 
-void CatalogManager::SendCreateTabletRequest(const scoped_refptr<TabletInfo>& tablet,
-                                             const TabletMetadataLock& tablet_lock) {
-  const consensus::RaftConfigPB& config =
-      tablet_lock.data().pb.committed_consensus_state().config();
-  tablet->set_last_create_tablet_time(MonoTime::Now());
-  for (const RaftPeerPB& peer : config.peers()) {
-    AsyncCreateReplica* task = new AsyncCreateReplica(master_,
-                                                      peer.permanent_uuid(),
-                                                      tablet, tablet_lock);
-    tablet->table()->AddTask(task);
-    WARN_NOT_OK(task->Run(), "Failed to send new tablet request");
+void CatalogManager::SendCreateTabletRequests(const vector<TabletInfo*>& tablets) {
+  const int batch_size = std::max(FLAGS_master_create_tablets_batch_size, 1);
+  // The replicas to create, by table and tablet server. Tasks are tracked by
+  // table, so a batch only holds the replicas of a single table.
+  map<pair<TableInfo*, string>, vector<tserver::CreateTabletRequestPB>> reqs;
+  for (TabletInfo* tablet : tablets) {
+    TabletMetadataLock l(tablet, TabletMetadataLock::READ);
+    const consensus::RaftConfigPB& config = l.data().pb.committed_consensus_state().config();
+    tablet->set_last_create_tablet_time(MonoTime::Now());
+    for (const RaftPeerPB& peer : config.peers()) {
+      if (batch_size == 1) {
+        AsyncCreateReplica* task = new AsyncCreateReplica(master_,
+                                                          peer.permanent_uuid(),
+                                                          tablet, l);
+        tablet->table()->AddTask(task);
+        WARN_NOT_OK(task->Run(), "Failed to send new tablet request");
+        continue;
+      }
+      auto& ts_reqs = reqs[std::make_pair(tablet->table().get(), peer.permanent_uuid())];
+      ts_reqs.emplace_back();
+      AsyncCreateReplica::PrepareRequest(peer.permanent_uuid(), tablet, l, &ts_reqs.back());
+    }
+  }
+
+  for (auto& e : reqs) {
+    const scoped_refptr<TableInfo> table(e.first.first);
+    const string& ts_uuid = e.first.second;
+    vector<tserver::CreateTabletRequestPB>& ts_reqs = e.second;
+    for (int i = 0; i < ts_reqs.size(); i += batch_size) {
+      vector<tserver::CreateTabletRequestPB> batch;
+      int end = std::min<int>(i + batch_size, ts_reqs.size());
+      for (int j = i; j < end; j++) {
+        batch.emplace_back();
+        batch.back().Swap(&ts_reqs[j]);
+      }
+      auto task = new AsyncCreateReplicas(master_, ts_uuid, table, std::move(batch));
+      table->AddTask(task);
+      WARN_NOT_OK(task->Run(), "Failed to send new tablets request");
+    }
   }
 }
 
@@ -3220,10 +4075,29 @@ shared_ptr<TSDescriptor> CatalogManager::PickBetterReplicaLocation(
   // we batch the selection process before sending any creation commands to the
   // servers themselves.
   //
-  // TODO: in the future we may want to factor in other items such as available disk space,
-  // actual request load, etc.
+  // Two further aspects come from the heartbeats of the servers: a server
+  // which is short of disk space is avoided altogether, and the replica load
+  // is scaled up by the share of the written and scanned rows of the two
+  // servers, to keep new tablets off of the servers which are already busy.
+  const int64_t min_free = FLAGS_master_replica_placement_min_free_bytes;
+  const int64_t free_a = a->min_data_dir_bytes_free();
+  const int64_t free_b = b->min_data_dir_bytes_free();
+  const bool low_space_a = free_a >= 0 && free_a < min_free;
+  const bool low_space_b = free_b >= 0 && free_b < min_free;
+  if (low_space_a != low_space_b) {
+    return low_space_a ? b : a;
+  }
+
   double load_a = a->RecentReplicaCreations() + a->num_live_replicas();
   double load_b = b->RecentReplicaCreations() + b->num_live_replicas();
+  const double weight = FLAGS_master_replica_placement_activity_weight;
+  if (weight > 0) {
+    auto share = [](double x, double y) { return x + y > 0 ? x / (x + y) : 0.5; };
+    double activity_a = (share(a->rows_written_per_sec(), b->rows_written_per_sec()) +
+                         share(a->rows_scanned_per_sec(), b->rows_scanned_per_sec())) / 2;
+    load_a *= 1 + weight * activity_a;
+    load_b *= 1 + weight * (1 - activity_a);
+  }
   if (load_a < load_b) {
     return a;
   } else if (load_b < load_a) {
@@ -3312,6 +4186,13 @@ void CatalogManager::SelectReplicas(const TSDescriptorVector& ts_descs,
 
 Status CatalogManager::BuildLocationsForTablet(const scoped_refptr<TabletInfo>& tablet,
                                                TabletLocationsPB* locs_pb) {
+  // The registrations must be read before the metadata, so that locations
+  // built while a tablet server registers are not cached as up to date.
+  const uint64_t ts_registrations_version = master_->ts_manager()->registrations_version();
+  if (tablet->GetCachedLocations(ts_registrations_version, locs_pb)) {
+    return Status::OK();
+  }
+
   TabletMetadataLock l_tablet(tablet.get(), TabletMetadataLock::READ);
   if (PREDICT_FALSE(l_tablet.data().is_deleted())) {
     return Status::NotFound("Tablet deleted", l_tablet.data().pb.state_msg());
@@ -3354,6 +4235,8 @@ Status CatalogManager::BuildLocationsForTablet(const scoped_refptr<TabletInfo>&
   // No longer used; always set to false.
   locs_pb->set_deprecated_stale(false);
 
+  // The metadata can't change while it's locked for reading.
+  tablet->SetCachedLocations(tablet->metadata().version(), ts_registrations_version, *locs_pb);
   return Status::OK();
 }
 
@@ -3402,7 +4285,8 @@ Status CatalogManager::GetTableLocations(const GetTableLocationsRequestPB* req,
   RETURN_NOT_OK(CheckIfTableDeletedOrNotRunning(&l, resp));
 
   vector<scoped_refptr<TabletInfo> > tablets_in_range;
-  table->GetTabletsInRange(req, &tablets_in_range);
+  string next_partition_key;
+  table->GetTabletsInRange(req, &tablets_in_range, &next_partition_key);
 
   ServerRegistrationPB reg;
   for (const scoped_refptr<TabletInfo>& tablet : tablets_in_range) {
@@ -3427,6 +4311,10 @@ Status CatalogManager::GetTableLocations(const GetTableLocationsRequestPB* req,
       LOG(FATAL) << "Unexpected error while building tablet locations: " << s.ToString();
     }
   }
+  // No tablet starts at the empty partition key other than the first.
+  if (!resp->has_error() && !next_partition_key.empty()) {
+    resp->set_next_partition_key(next_partition_key);
+  }
   resp->set_ttl_millis(FLAGS_table_locations_ttl_ms);
   return Status::OK();
 }
@@ -3595,6 +4483,7 @@ INITTED_AND_LEADER_OR_RESPOND(ListTabletServersResponsePB);
 INITTED_AND_LEADER_OR_RESPOND(GetTableLocationsResponsePB);
 INITTED_AND_LEADER_OR_RESPOND(GetTableSchemaResponsePB);
 INITTED_AND_LEADER_OR_RESPOND(GetTabletLocationsResponsePB);
+INITTED_AND_LEADER_OR_RESPOND(SplitTabletResponsePB);
 
 #undef INITTED_OR_RESPOND
 #undef INITTED_AND_LEADER_OR_RESPOND
@@ -3608,7 +4497,9 @@ TabletInfo::TabletInfo(const scoped_refptr<TableInfo>& table,
     : tablet_id_(std::move(tablet_id)),
       table_(table),
       last_create_tablet_time_(MonoTime::Now()),
-      reported_schema_version_(0) {}
+      reported_schema_version_(0),
+      cached_locations_metadata_version_(0),
+      cached_locations_ts_version_(0) {}
 
 TabletInfo::~TabletInfo() {
 }
@@ -3637,6 +4528,37 @@ uint32_t TabletInfo::reported_schema_version() const {
   return reported_schema_version_;
 }
 
+bool TabletInfo::GetCachedLocations(uint64_t ts_registrations_version,
+                                    TabletLocationsPB* locs_pb) const {
+  uint64_t metadata_version = metadata_.version();
+  std::lock_guard<simple_spinlock> l(lock_);
+  if (!cached_locations_ ||
+      cached_locations_metadata_version_ != metadata_version ||
+      cached_locations_ts_version_ != ts_registrations_version) {
+    return false;
+  }
+  locs_pb->CopyFrom(*cached_locations_);
+  return true;
+}
+
+void TabletInfo::SetCachedLocations(uint64_t metadata_version,
+                                    uint64_t ts_registrations_version,
+                                    const TabletLocationsPB& locs_pb) {
+  std::lock_guard<simple_spinlock> l(lock_);
+  // Don't replace locations built by a concurrent call from newer state.
+  if (cached_locations_ &&
+      (cached_locations_metadata_version_ > metadata_version ||
+       cached_locations_ts_version_ > ts_registrations_version)) {
+    return;
+  }
+  if (!cached_locations_) {
+    cached_locations_.reset(new TabletLocationsPB);
+  }
+  cached_locations_->CopyFrom(locs_pb);
+  cached_locations_metadata_version_ = metadata_version;
+  cached_locations_ts_version_ = ts_registrations_version;
+}
+
 std::string TabletInfo::ToString() const {
   return Substitute("$0 (table $1)", tablet_id_,
                     (table_ != nullptr ? table_->ToString() : "MISSING"));
@@ -3703,9 +4625,11 @@ void TableInfo::AddTabletUnlocked(TabletInfo* tablet) {
 }
 
 void TableInfo::GetTabletsInRange(const GetTableLocationsRequestPB* req,
-                                  vector<scoped_refptr<TabletInfo> > *ret) const {
+                                  vector<scoped_refptr<TabletInfo> > *ret,
+                                  string* next_partition_key) const {
   std::lock_guard<simple_spinlock> l(lock_);
-  int max_returned_locations = req->max_returned_locations();
+  int max_returned_locations = std::min<int64_t>(
+      req->max_returned_locations(), std::max(FLAGS_max_table_locations_per_response, 1));
 
   TableInfo::TabletInfoMap::const_iterator it, it_end;
   if (req->has_partition_key_start()) {
@@ -3728,6 +4652,14 @@ void TableInfo::GetTabletsInRange(const GetTableLocationsRequestPB* req,
     ret->push_back(make_scoped_refptr(it->second));
     count++;
   }
+
+  if (next_partition_key) {
+    if (it != it_end) {
+      *next_partition_key = it->first;
+    } else {
+      next_partition_key->clear();
+    }
+  }
 }
 
 bool TableInfo::IsAlterInProgress(uint32_t version) const {
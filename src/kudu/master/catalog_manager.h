@@ -26,6 +26,7 @@
 #include <vector>
 
 #include "kudu/common/partition.h"
+#include "kudu/consensus/consensus.pb.h"
 #include "kudu/gutil/macros.h"
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/master/master.pb.h"
@@ -120,6 +121,20 @@ class TabletInfo : public RefCountedThreadSafe<TabletInfo> {
   bool set_reported_schema_version(uint32_t version);
   uint32_t reported_schema_version() const;
 
+  // Copy the locations of the tablet cached by SetCachedLocations() into
+  // 'locs_pb', if they were built from the current metadata of the tablet
+  // and from the tablet server registrations of 'ts_registrations_version'.
+  // Returns false if there are no such locations.
+  bool GetCachedLocations(uint64_t ts_registrations_version,
+                          TabletLocationsPB* locs_pb) const;
+
+  // Cache 'locs_pb', which was built from the metadata of the tablet
+  // at 'metadata_version' and from the tablet server registrations of
+  // 'ts_registrations_version'.
+  void SetCachedLocations(uint64_t metadata_version,
+                          uint64_t ts_registrations_version,
+                          const TabletLocationsPB& locs_pb);
+
   // No synchronization needed.
   std::string ToString() const;
 
@@ -142,6 +157,14 @@ class TabletInfo : public RefCountedThreadSafe<TabletInfo> {
   // Reported schema version (in-memory only).
   uint32_t reported_schema_version_;
 
+  // The locations last returned to clients, and the versions of the tablet
+  // metadata and of the tablet server registrations they were built from.
+  // Rebuilding the locations of every tablet for each GetTableLocations()
+  // call is expensive for tables with many tablets.
+  gscoped_ptr<TabletLocationsPB> cached_locations_;
+  uint64_t cached_locations_metadata_version_;
+  uint64_t cached_locations_ts_version_;
+
   DISALLOW_COPY_AND_ASSIGN(TabletInfo);
 };
 
@@ -202,8 +225,14 @@ class TableInfo : public RefCountedThreadSafe<TableInfo> {
   bool RemoveTablet(const std::string& partition_key_start);
 
   // This only returns tablets which are in RUNNING state.
+  //
+  // At most 'max_returned_locations' of the request are returned, or
+  // --max_table_locations_per_response if lower. If tablets in the range were
+  // left out, 'next_partition_key' (if not NULL) is set to the start partition
+  // key of the first one; otherwise it is cleared.
   void GetTabletsInRange(const GetTableLocationsRequestPB* req,
-                         std::vector<scoped_refptr<TabletInfo> > *ret) const;
+                         std::vector<scoped_refptr<TabletInfo> > *ret,
+                         std::string* next_partition_key = nullptr) const;
 
   // Adds all tablets to the vector in partition key sorted order.
   void GetAllTablets(std::vector<scoped_refptr<TabletInfo> > *ret) const;
@@ -430,6 +459,17 @@ class CatalogManager : public tserver::TabletPeerLookupIf {
                           IsAlterTableDoneResponsePB* resp,
                           rpc::RpcContext* rpc);
 
+  // Split a tablet of the specified table in two, at a boundary between the
+  // rowsets of its leader replica. The new tablets start out with a single
+  // replica on the leader of the split tablet, and are brought up to the
+  // replication factor of the table like any under-replicated tablet.
+  //
+  // The RPC context is provided for logging/tracing purposes,
+  // but this function does not itself respond to the RPC.
+  Status SplitTablet(const SplitTabletRequestPB* req,
+                     SplitTabletResponsePB* resp,
+                     rpc::RpcContext* rpc);
+
   // Get the information about the specified table
   Status GetTableSchema(const GetTableSchemaRequestPB* req,
                         GetTableSchemaResponsePB* resp);
@@ -578,19 +618,27 @@ class CatalogManager : public tserver::TabletPeerLookupIf {
   Status FindTable(const TableIdentifierPB& table_identifier,
                    scoped_refptr<TableInfo>* table_info);
 
-  // Handle one of the tablets in a tablet reported.
-  // Requires that the lock is already held.
-  Status HandleReportedTablet(TSDescriptor* ts_desc,
-                              const ReportedTabletPB& report,
-                              ReportedTabletUpdatesPB *report_updates);
+  // One of the tablets in a tablet report.
+  struct ReportedTablet;
+
+  // Handle one of the tablets in a tablet report, whose metadata must be
+  // locked for writing. Changes to the metadata are left uncommitted, for
+  // the caller to write them to the sys catalog along with those of the
+  // other tablets in the report.
+  Status HandleReportedTablet(TSDescriptor* ts_desc, ReportedTablet* reported);
+
+  // Handle a tablet in a tablet report which is not in the catalog.
+  void HandleUnknownReportedTablet(TSDescriptor* ts_desc, const ReportedTabletPB& report);
 
   Status HandleRaftConfigChanged(const ReportedTabletPB& report,
                                  const scoped_refptr<TabletInfo>& tablet,
                                  TabletMetadataLock* tablet_lock,
                                  TableMetadataLock* table_lock);
 
-  // Extract the set of tablets that must be processed because not running yet.
-  void ExtractTabletsToProcess(std::vector<scoped_refptr<TabletInfo>>* tablets_to_process);
+  // Extract the set of tablets that must be processed because not running yet,
+  // grouped by table.
+  void ExtractTabletsToProcess(
+      std::vector<std::vector<scoped_refptr<TabletInfo>>>* tablets_to_process);
 
   Status ApplyAlterSchemaSteps(const SysTablesEntryPB& current_pb,
                                std::vector<AlterTableRequestPB::Step> steps,
@@ -606,6 +654,11 @@ class CatalogManager : public tserver::TabletPeerLookupIf {
 
   // Task that takes care of the tablet assignments/creations.
   // Loops through the "not created" tablets and sends a CreateTablet() request.
+  //
+  // All of 'tablets' must belong to the same table: each table is processed
+  // separately, so that the tablets of one table are not kept locked while
+  // those of another are written to the sys catalog, and so that a failure
+  // to assign the tablets of one table doesn't hold back the others.
   Status ProcessPendingAssignments(const std::vector<scoped_refptr<TabletInfo> >& tablets);
 
   // Given 'two_choices', which should be a vector of exactly two elements, select which
@@ -648,7 +701,7 @@ class CatalogManager : public tserver::TabletPeerLookupIf {
   Status HandleTabletSchemaVersionReport(TabletInfo *tablet,
                                          uint32_t version);
 
-  // Send the "create tablet request" to all peers of a particular tablet.
+  // Send the "create tablet request" to all peers of the given tablets.
   //.
   // The creation is async, and at the moment there is no error checking on the
   // caller side. We rely on the assignment timeout. If we don't see the tablet
@@ -660,9 +713,9 @@ class CatalogManager : public tserver::TabletPeerLookupIf {
   // This must be called after persisting the tablet state as
   // CREATING to ensure coherent state after Master failover.
   //
-  // The tablet lock must be acquired for reading before making this call.
-  void SendCreateTabletRequest(const scoped_refptr<TabletInfo>& tablet,
-                               const TabletMetadataLock& tablet_lock);
+  // The replicas of 'tablets' are grouped by tablet server, so that each
+  // server gets up to --master_create_tablets_batch_size of them per RPC.
+  void SendCreateTabletRequests(const std::vector<TabletInfo*>& tablets);
 
   // Send the "alter table request" to all tablets of the specified table.
   void SendAlterTableRequest(const scoped_refptr<TableInfo>& table);
@@ -697,6 +750,27 @@ class CatalogManager : public tserver::TabletPeerLookupIf {
   void SendAddServerRequest(const scoped_refptr<TabletInfo>& tablet,
                             const consensus::ConsensusStatePB& cstate);
 
+  // Runs a pass of the rebalancer if it's enabled and the previous pass was
+  // long enough ago: advances the replica moves in flight, then starts new
+  // moves, or leader transfers once no move is left, to even out the
+  // replicas and the leaders hosted by the live tablet servers.
+  //
+  // Called by the background tasks thread while this master is the leader.
+  void RebalanceIfDue();
+
+  // Start a task to change the config of 'tablet', whose committed config
+  // has the opid index 'cas_config_opid_index', by adding or removing 'peer'.
+  void SendRebalanceChangeConfigRequest(const scoped_refptr<TabletInfo>& tablet,
+                                        int64_t cas_config_opid_index,
+                                        consensus::ChangeConfigType type,
+                                        const consensus::RaftPeerPB& peer);
+
+  // Start a task to have 'leader_uuid', the leader of 'tablet', hand its
+  // leadership over to the voter 'new_leader_uuid'.
+  void SendLeaderTransferRequest(const scoped_refptr<TabletInfo>& tablet,
+                                 const std::string& leader_uuid,
+                                 const std::string& new_leader_uuid);
+
   std::string GenerateId() { return oid_generator_.Next(); }
 
   // Conventional "T xxx P yyy: " prefix for logging.
@@ -747,6 +821,26 @@ class CatalogManager : public tserver::TabletPeerLookupIf {
   friend class CatalogManagerBgTasks;
   gscoped_ptr<CatalogManagerBgTasks> background_tasks_;
 
+  // A replica which the rebalancer is moving from one tablet server to
+  // another. A voter is first added on 'to_uuid'; once it has reported the
+  // tablet as running, 'from_uuid' hands its leadership over if it is the
+  // leader, and is then removed from the config.
+  struct ReplicaMove {
+    std::string from_uuid;
+    std::string to_uuid;
+    MonoTime start_time;
+    bool to_running;
+  };
+
+  // The replica moves in flight, by tablet ID. Protected by
+  // 'replica_moves_lock_'.
+  simple_spinlock replica_moves_lock_;
+  std::unordered_map<std::string, ReplicaMove> replica_moves_;
+
+  // When the last rebalancing pass ran. Only used by the background tasks
+  // thread.
+  MonoTime last_rebalance_time_;
+
   enum State {
     kConstructed,
     kStarting,
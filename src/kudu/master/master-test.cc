@@ -27,6 +27,7 @@
 #include "kudu/common/row_operations.h"
 #include "kudu/generated/version_defines.h"
 #include "kudu/gutil/strings/join.h"
+#include "kudu/master/catalog_manager.h"
 #include "kudu/master/master.h"
 #include "kudu/master/master.proxy.h"
 #include "kudu/master/master-test-util.h"
@@ -189,6 +190,24 @@ TEST_F(MasterTest, TestRegisterAndHeartbeat) {
     ASSERT_FALSE(resp.has_tablet_report());
   }
 
+  // The load sent with a heartbeat is kept in the descriptor, for use by
+  // replica placement.
+  ASSERT_EQ(-1, ts_desc->min_data_dir_bytes_free());
+  {
+    TSHeartbeatRequestPB req;
+    TSHeartbeatResponsePB resp;
+    RpcController rpc;
+    req.mutable_common()->CopyFrom(common);
+    req.mutable_load()->set_min_data_dir_bytes_free(12345);
+    req.mutable_load()->set_rows_written_per_sec(10);
+    req.mutable_load()->set_rows_scanned_per_sec(20);
+    ASSERT_OK(proxy_->TSHeartbeat(req, &resp, &rpc));
+    ASSERT_FALSE(resp.needs_reregister());
+  }
+  ASSERT_EQ(12345, ts_desc->min_data_dir_bytes_free());
+  ASSERT_EQ(10, ts_desc->rows_written_per_sec());
+  ASSERT_EQ(20, ts_desc->rows_scanned_per_sec());
+
   // If we send the registration RPC while the master isn't the leader, it
   // shouldn't ask for a full tablet report.
   {
@@ -692,6 +711,92 @@ TEST_F(MasterTest, TestGetTableLocationsDuringRepeatedTableVisit) {
   t.join();
 }
 
+// Test that the tablets of a tablet report are all updated, and that tablets
+// whose state didn't change aren't rewritten.
+TEST_F(MasterTest, TestTabletReportUpdatesChangedTablets) {
+  const char* kTsUUID = "my-ts-uuid";
+  const char* kTableName = "testtb";
+  const Schema kTableSchema({ ColumnSchema("key", INT32), ColumnSchema("val", INT32) }, 1);
+
+  TSToMasterCommonPB common;
+  common.mutable_ts_instance()->set_permanent_uuid(kTsUUID);
+  common.mutable_ts_instance()->set_instance_seqno(1);
+  {
+    TSHeartbeatRequestPB req;
+    TSHeartbeatResponsePB resp;
+    RpcController rpc;
+    req.mutable_common()->CopyFrom(common);
+    MakeHostPortPB("localhost", 1000, req.mutable_registration()->add_rpc_addresses());
+    MakeHostPortPB("localhost", 2000, req.mutable_registration()->add_http_addresses());
+    ASSERT_OK(proxy_->TSHeartbeat(req, &resp, &rpc));
+    ASSERT_FALSE(resp.has_error());
+  }
+
+  KuduPartialRow split1(&kTableSchema);
+  ASSERT_OK(split1.SetInt32("key", 10));
+  KuduPartialRow split2(&kTableSchema);
+  ASSERT_OK(split2.SetInt32("key", 20));
+  ASSERT_OK(CreateTable(kTableName, kTableSchema, { split1, split2 }, {}));
+
+  vector<scoped_refptr<TabletInfo>> tablets;
+  {
+    CatalogManager::ScopedLeaderSharedLock l(master_->catalog_manager());
+    ASSERT_OK(l.first_failed_status());
+    vector<scoped_refptr<TableInfo>> tables;
+    ASSERT_OK(master_->catalog_manager()->GetAllTables(&tables));
+    ASSERT_EQ(1, tables.size());
+    tables[0]->GetAllTablets(&tablets);
+  }
+  ASSERT_EQ(3, tablets.size());
+
+  // Report each tablet as running with the fake TS as its leader. The first
+  // tablet is reported twice, as if it had changed while the report was built.
+  TabletReportPB report;
+  report.set_is_incremental(false);
+  report.set_sequence_number(0);
+  for (const auto& tablet : tablets) {
+    ReportedTabletPB* reported = report.add_updated_tablets();
+    reported->set_tablet_id(tablet->tablet_id());
+    reported->set_state(tablet::RUNNING);
+    consensus::ConsensusStatePB* cstate = reported->mutable_committed_consensus_state();
+    cstate->set_current_term(1);
+    cstate->set_leader_uuid(kTsUUID);
+    cstate->mutable_config()->set_opid_index(1);
+    consensus::RaftPeerPB* peer = cstate->mutable_config()->add_peers();
+    peer->set_permanent_uuid(kTsUUID);
+    peer->set_member_type(consensus::RaftPeerPB::VOTER);
+  }
+  report.add_updated_tablets()->CopyFrom(report.updated_tablets(0));
+
+  auto send_report = [&]() {
+    TSHeartbeatRequestPB req;
+    TSHeartbeatResponsePB resp;
+    RpcController rpc;
+    req.mutable_common()->CopyFrom(common);
+    req.mutable_tablet_report()->CopyFrom(report);
+    ASSERT_OK(proxy_->TSHeartbeat(req, &resp, &rpc));
+    ASSERT_FALSE(resp.has_error()) << resp.error().ShortDebugString();
+    ASSERT_EQ(report.updated_tablets_size(), resp.tablet_report().tablets_size());
+  };
+  NO_FATALS(send_report());
+
+  vector<uint64_t> versions;
+  for (const auto& tablet : tablets) {
+    TabletMetadataLock l(tablet.get(), TabletMetadataLock::READ);
+    ASSERT_TRUE(l.data().is_running()) << tablet->ToString();
+    ASSERT_EQ(kTsUUID, l.data().pb.committed_consensus_state().leader_uuid());
+    versions.push_back(tablet->metadata().version());
+  }
+
+  // Reporting the same state again doesn't change the tablets.
+  report.set_is_incremental(true);
+  report.set_sequence_number(1);
+  NO_FATALS(send_report());
+  for (int i = 0; i < tablets.size(); i++) {
+    ASSERT_EQ(versions[i], tablets[i]->metadata().version()) << tablets[i]->ToString();
+  }
+}
+
 // The catalog manager had a bug wherein GetTableSchema() interleaved with
 // CreateTable() could expose intermediate uncommitted state to clients. This
 // test ensures that bug does not regress.
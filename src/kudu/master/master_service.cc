@@ -128,6 +128,9 @@ void MasterServiceImpl::TSHeartbeat(const TSHeartbeatRequestPB* req,
   // 4. Update tserver soft state based on the heartbeat contents.
   ts_desc->UpdateHeartbeatTime();
   ts_desc->set_num_live_replicas(req->num_live_tablets());
+  if (req->has_load()) {
+    ts_desc->UpdateLoad(req->load());
+  }
 
   // 5. Only leaders handle tablet reports.
   if (is_leader_master && req->has_tablet_report()) {
@@ -279,6 +282,19 @@ void MasterServiceImpl::GetTableSchema(const GetTableSchemaRequestPB* req,
   rpc->RespondSuccess();
 }
 
+void MasterServiceImpl::SplitTablet(const SplitTabletRequestPB* req,
+                                    SplitTabletResponsePB* resp,
+                                    rpc::RpcContext* rpc) {
+  CatalogManager::ScopedLeaderSharedLock l(server_->catalog_manager());
+  if (!l.CheckIsInitializedAndIsLeaderOrRespond(resp, rpc)) {
+    return;
+  }
+
+  Status s = server_->catalog_manager()->SplitTablet(req, resp, rpc);
+  CheckRespErrorOrSetUnknown(s, resp);
+  rpc->RespondSuccess();
+}
+
 void MasterServiceImpl::ListTabletServers(const ListTabletServersRequestPB* req,
                                           ListTabletServersResponsePB* resp,
                                           rpc::RpcContext* rpc) {
@@ -72,6 +72,9 @@ class MasterServiceImpl : public MasterServiceIf {
   virtual void GetTableSchema(const GetTableSchemaRequestPB* req,
                               GetTableSchemaResponsePB* resp,
                               rpc::RpcContext* rpc) OVERRIDE;
+  virtual void SplitTablet(const SplitTabletRequestPB* req,
+                           SplitTabletResponsePB* resp,
+                           rpc::RpcContext* rpc) OVERRIDE;
   virtual void ListTabletServers(const ListTabletServersRequestPB* req,
                                  ListTabletServersResponsePB* resp,
                                  rpc::RpcContext* rpc) OVERRIDE;
@@ -19,23 +19,29 @@
 
 #include <algorithm>
 #include <memory>
+#include <mutex>
+#include <set>
 #include <vector>
 
 #include "kudu/common/wire_protocol.h"
 #include "kudu/gutil/stl_util.h"
+#include "kudu/gutil/strings/substitute.h"
 #include "kudu/master/catalog_manager.h"
 #include "kudu/master/master.h"
 #include "kudu/master/master.proxy.h"
 #include "kudu/master/mini_master.h"
 #include "kudu/master/sys_catalog.h"
 #include "kudu/server/rpc_server.h"
+#include "kudu/util/locks.h"
 #include "kudu/util/net/sockaddr.h"
 #include "kudu/util/status.h"
 #include "kudu/util/test_util.h"
 #include "kudu/rpc/messenger.h"
 
+using std::set;
 using std::string;
 using std::shared_ptr;
+using strings::Substitute;
 using kudu::rpc::Messenger;
 using kudu::rpc::MessengerBuilder;
 using kudu::rpc::RpcController;
@@ -346,6 +352,61 @@ TEST_F(SysCatalogTest, TestSysCatalogTabletsOperations) {
   }
 }
 
+// A thread-safe visitor which collects the IDs of the tablets, and fails on
+// the tablet 'fail_tablet_id'.
+class ConcurrentTabletIdCollector : public TabletVisitor {
+ public:
+  explicit ConcurrentTabletIdCollector(string fail_tablet_id = "")
+      : fail_tablet_id_(std::move(fail_tablet_id)) {
+  }
+
+  virtual Status VisitTablet(const std::string& table_id,
+                             const std::string& tablet_id,
+                             const SysTabletsEntryPB& metadata) OVERRIDE {
+    if (tablet_id == fail_tablet_id_) {
+      return Status::Corruption("injected failure", tablet_id);
+    }
+    std::lock_guard<simple_spinlock> l(lock_);
+    CHECK(tablet_ids.insert(tablet_id).second) << "visited twice: " << tablet_id;
+    return Status::OK();
+  }
+
+  set<string> tablet_ids;
+
+ private:
+  const string fail_tablet_id_;
+  simple_spinlock lock_;
+};
+
+// Test that visiting the tablets from several threads visits each of them
+// once, and returns the errors of the visitor.
+TEST_F(SysCatalogTest, TestVisitTabletsConcurrently) {
+  const int kNumTablets = 5000;
+  scoped_refptr<TableInfo> table(new TableInfo("abc"));
+  vector<scoped_refptr<TabletInfo>> tablets;
+  SysCatalogTable::Actions actions;
+  for (int i = 0; i < kNumTablets; i++) {
+    tablets.emplace_back(CreateTablet(table.get(), Substitute("$0", i), "", ""));
+    actions.tablets_to_add.push_back(tablets.back().get());
+  }
+  for (const auto& tablet : tablets) {
+    tablet->mutable_metadata()->StartMutation();
+  }
+  SysCatalogTable* sys_catalog = master_->catalog_manager()->sys_catalog();
+  ASSERT_OK(sys_catalog->Write(actions));
+  for (const auto& tablet : tablets) {
+    tablet->mutable_metadata()->CommitMutation();
+  }
+
+  ConcurrentTabletIdCollector collector;
+  ASSERT_OK(sys_catalog->VisitTabletsConcurrently(&collector));
+  ASSERT_EQ(kNumTablets, collector.tablet_ids.size());
+
+  ConcurrentTabletIdCollector failing_collector("1234");
+  Status s = sys_catalog->VisitTabletsConcurrently(&failing_collector);
+  ASSERT_TRUE(s.IsCorruption()) << s.ToString();
+}
+
 // Verify that data mutations are not available from metadata() until commit.
 TEST_F(SysCatalogTest, TestTabletInfoCommit) {
   scoped_refptr<TabletInfo> tablet(new TabletInfo(nullptr, "123"));
@@ -51,12 +51,19 @@
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/logging.h"
 #include "kudu/util/pb_util.h"
+#include "kudu/util/semaphore.h"
 #include "kudu/util/threadpool.h"
 
 DEFINE_double(sys_catalog_fail_during_write, 0.0,
               "Fraction of the time when system table writes will fail");
 TAG_FLAG(sys_catalog_fail_during_write, unsafe);
 
+DEFINE_int32(sys_catalog_load_threads, 8,
+             "Number of threads used to parse and load the tablet entries of the "
+             "system catalog when a master becomes the leader. With many tablets, "
+             "this dominates the time it takes before the master can serve requests.");
+TAG_FLAG(sys_catalog_load_threads, advanced);
+
 using kudu::consensus::CONSENSUS_CONFIG_COMMITTED;
 using kudu::consensus::ConsensusMetadata;
 using kudu::consensus::ConsensusStatePB;
@@ -91,6 +98,7 @@ SysCatalogTable::SysCatalogTable(Master* master, MetricRegistry* metrics,
     : metric_registry_(metrics),
       master_(master),
       leader_cb_(std::move(leader_cb)) {
+  CHECK_OK(ThreadPoolBuilder("prepare").set_max_threads(1).Build(&prepare_pool_));
   CHECK_OK(ThreadPoolBuilder("apply").Build(&apply_pool_));
 }
 
@@ -101,6 +109,7 @@ void SysCatalogTable::Shutdown() {
   if (tablet_peer_) {
     tablet_peer_->Shutdown();
   }
+  prepare_pool_->Shutdown();
   apply_pool_->Shutdown();
 }
 
@@ -280,6 +289,7 @@ Status SysCatalogTable::SetupTablet(const scoped_refptr<tablet::TabletMetadata>&
   tablet_peer_.reset(new TabletPeer(
       metadata,
       local_peer_pb_,
+      prepare_pool_.get(),
       apply_pool_.get(),
       Bind(&SysCatalogTable::SysCatalogStateChanged, Unretained(this), metadata->tablet_id())));
 
@@ -302,6 +312,8 @@ Status SysCatalogTable::SetupTablet(const scoped_refptr<tablet::TabletMetadata>&
   RETURN_NOT_OK_PREPEND(tablet_peer_->Init(tablet,
                                            scoped_refptr<server::Clock>(master_->clock()),
                                            master_->messenger(),
+                                           nullptr,
+                                           nullptr,
                                            scoped_refptr<rpc::ResultTracker>(),
                                            log,
                                            tablet->GetMetricEntity()),
@@ -581,10 +593,14 @@ Status SysCatalogTable::VisitTabletFromRow(const RowBlockRow& row, TabletVisitor
     schema_.ExtractColumnFromRow<STRING>(row, schema_.find_column(kSysCatalogTableColId));
   const Slice *data =
     schema_.ExtractColumnFromRow<STRING>(row, schema_.find_column(kSysCatalogTableColMetadata));
+  return VisitTabletEntry(tablet_id->ToString(), *data, visitor);
+}
 
+Status SysCatalogTable::VisitTabletEntry(const string& tablet_id, const Slice& data,
+                                         TabletVisitor* visitor) {
   SysTabletsEntryPB metadata;
-  RETURN_NOT_OK_PREPEND(pb_util::ParseFromArray(&metadata, data->data(), data->size()),
-                        "Unable to parse metadata field for tablet " + tablet_id->ToString());
+  RETURN_NOT_OK_PREPEND(pb_util::ParseFromArray(&metadata, data.data(), data.size()),
+                        "Unable to parse metadata field for tablet " + tablet_id);
 
   // Upgrade from the deprecated start/end-key fields to the 'partition' field.
   if (!metadata.has_partition()) {
@@ -596,7 +612,7 @@ Status SysCatalogTable::VisitTabletFromRow(const RowBlockRow& row, TabletVisitor
     metadata.clear_deprecated_end_key();
   }
 
-  RETURN_NOT_OK(visitor->VisitTablet(metadata.table_id(), tablet_id->ToString(), metadata));
+  RETURN_NOT_OK(visitor->VisitTablet(metadata.table_id(), tablet_id, metadata));
   return Status::OK();
 }
 
@@ -627,6 +643,87 @@ Status SysCatalogTable::VisitTablets(TabletVisitor* visitor) {
   return Status::OK();
 }
 
+Status SysCatalogTable::VisitTabletsConcurrently(TabletVisitor* visitor) {
+  TRACE_EVENT0("master", "SysCatalogTable::VisitTabletsConcurrently");
+  const int num_threads = FLAGS_sys_catalog_load_threads;
+  if (num_threads <= 1) {
+    return VisitTablets(visitor);
+  }
+  const int8_t tablets_entry = TABLETS_ENTRY;
+  const int type_col_idx = schema_.find_column(kSysCatalogTableColType);
+  const int id_col_idx = schema_.find_column(kSysCatalogTableColId);
+  const int metadata_col_idx = schema_.find_column(kSysCatalogTableColMetadata);
+  CHECK(type_col_idx != Schema::kColumnNotFound);
+
+  auto pred_tablets = ColumnPredicate::Equality(schema_.column(type_col_idx), &tablets_entry);
+  ScanSpec spec;
+  spec.AddPredicate(pred_tablets);
+
+  gscoped_ptr<RowwiseIterator> iter;
+  RETURN_NOT_OK(tablet_peer_->tablet()->NewRowIterator(schema_, &iter));
+  RETURN_NOT_OK(iter->Init(&spec));
+
+  // The first error returned by the visitor, after which no more blocks are
+  // handed out. The number of blocks queued up for the pool is bounded, so
+  // that the entries don't pile up in memory if scanning outpaces parsing.
+  simple_spinlock error_lock;
+  Status first_error;
+  Semaphore blocks_in_flight(num_threads * 2);
+
+  gscoped_ptr<ThreadPool> pool;
+  RETURN_NOT_OK(ThreadPoolBuilder("sys-catalog-load")
+                .set_max_threads(num_threads)
+                .Build(&pool));
+
+  Arena arena(32 * 1024, 256 * 1024);
+  RowBlock block(iter->schema(), 512, &arena);
+  Status s;
+  while (s.ok() && iter->HasNext()) {
+    s = iter->NextBlock(&block);
+    if (!s.ok()) break;
+
+    // The block is reused for the next rows, so the pool gets its own copy
+    // of the entries.
+    auto entries = std::make_shared<vector<std::pair<string, string>>>();
+    entries->reserve(block.nrows());
+    for (size_t i = 0; i < block.nrows(); i++) {
+      if (!block.selection_vector()->IsRowSelected(i)) continue;
+      RowBlockRow row = block.row(i);
+      entries->emplace_back(
+          schema_.ExtractColumnFromRow<STRING>(row, id_col_idx)->ToString(),
+          schema_.ExtractColumnFromRow<STRING>(row, metadata_col_idx)->ToString());
+    }
+
+    blocks_in_flight.Acquire();
+    {
+      std::lock_guard<simple_spinlock> l(error_lock);
+      s = first_error;
+    }
+    if (!s.ok()) {
+      blocks_in_flight.Release();
+      break;
+    }
+    s = pool->SubmitFunc([entries, visitor, &error_lock, &first_error, &blocks_in_flight]() {
+      for (const auto& e : *entries) {
+        Status s = VisitTabletEntry(e.first, e.second, visitor);
+        if (PREDICT_FALSE(!s.ok())) {
+          std::lock_guard<simple_spinlock> l(error_lock);
+          if (first_error.ok()) first_error = s;
+          break;
+        }
+      }
+      blocks_in_flight.Release();
+    });
+    if (!s.ok()) {
+      blocks_in_flight.Release();
+    }
+  }
+  pool->Wait();
+  pool->Shutdown();
+  RETURN_NOT_OK(s);
+  return first_error;
+}
+
 void SysCatalogTable::InitLocalRaftPeerPB() {
   local_peer_pb_.set_permanent_uuid(master_->fs_manager()->uuid());
   Sockaddr addr = master_->first_rpc_address();
@@ -115,6 +115,11 @@ class SysCatalogTable {
   // Scan of the tablet-related entries.
   Status VisitTablets(TabletVisitor* visitor);
 
+  // Like VisitTablets(), but the entries are parsed and visited by a pool of
+  // --sys_catalog_load_threads threads, so 'visitor' must be thread-safe.
+  // The entries are visited in no particular order.
+  Status VisitTabletsConcurrently(TabletVisitor* visitor);
+
  private:
   FRIEND_TEST(MasterTest, TestMasterMetadataConsistentDespiteFailures);
   DISALLOW_COPY_AND_ASSIGN(SysCatalogTable);
@@ -170,6 +175,8 @@ class SysCatalogTable {
                         RowOperationsPB::Type op_type,
                         RowOperationsPB* ops) const;
   Status VisitTabletFromRow(const RowBlockRow& row, TabletVisitor* visitor);
+  static Status VisitTabletEntry(const std::string& tablet_id, const Slice& data,
+                                 TabletVisitor* visitor);
 
   // Initializes the RaftPeerPB for the local peer.
   // Crashes due to an invariant check if the rpc server is not running.
@@ -197,6 +204,7 @@ class SysCatalogTable {
 
   MetricRegistry* metric_registry_;
 
+  gscoped_ptr<ThreadPool> prepare_pool_;
   gscoped_ptr<ThreadPool> apply_pool_;
 
   scoped_refptr<tablet::TabletPeer> tablet_peer_;
@@ -57,7 +57,10 @@ TSDescriptor::TSDescriptor(std::string perm_id)
       last_heartbeat_(MonoTime::Now()),
       recent_replica_creations_(0),
       last_replica_creations_decay_(MonoTime::Now()),
-      num_live_replicas_(0) {
+      num_live_replicas_(0),
+      min_data_dir_bytes_free_(-1),
+      rows_written_per_sec_(0),
+      rows_scanned_per_sec_(0) {
 }
 
 TSDescriptor::~TSDescriptor() {
@@ -181,6 +184,14 @@ double TSDescriptor::RecentReplicaCreations() {
   return recent_replica_creations_;
 }
 
+void TSDescriptor::UpdateLoad(const TabletServerLoadPB& load) {
+  std::lock_guard<simple_spinlock> l(lock_);
+  min_data_dir_bytes_free_ = load.has_min_data_dir_bytes_free() ?
+      load.min_data_dir_bytes_free() : -1;
+  rows_written_per_sec_ = load.rows_written_per_sec();
+  rows_scanned_per_sec_ = load.rows_scanned_per_sec();
+}
+
 void TSDescriptor::GetRegistration(ServerRegistrationPB* reg) const {
   std::lock_guard<simple_spinlock> l(lock_);
   CHECK(registration_) << "No registration";
@@ -47,6 +47,8 @@ class TabletServerAdminServiceProxy;
 
 namespace master {
 
+class TabletServerLoadPB;
+
 // Master-side view of a single tablet server.
 //
 // Tracks the last heartbeat, status, instance identifier, etc.
@@ -114,6 +116,27 @@ class TSDescriptor {
     return num_live_replicas_;
   }
 
+  // Update the load of the TS from its last heartbeat.
+  void UpdateLoad(const TabletServerLoadPB& load);
+
+  // Return the free space of the fullest data directory of the TS, or -1
+  // if it hasn't been reported.
+  int64_t min_data_dir_bytes_free() const {
+    std::lock_guard<simple_spinlock> l(lock_);
+    return min_data_dir_bytes_free_;
+  }
+
+  // Return the rates of rows written to and scanned from the TS, as of its
+  // last heartbeat.
+  double rows_written_per_sec() const {
+    std::lock_guard<simple_spinlock> l(lock_);
+    return rows_written_per_sec_;
+  }
+  double rows_scanned_per_sec() const {
+    std::lock_guard<simple_spinlock> l(lock_);
+    return rows_scanned_per_sec_;
+  }
+
   // Return a string form of this TS, suitable for printing.
   // Includes the UUID as well as last known host/port.
   std::string ToString() const;
@@ -144,6 +167,11 @@ class TSDescriptor {
   // The number of live replicas on this host, from the last heartbeat.
   int num_live_replicas_;
 
+  // The rest of the load of this host, from the last heartbeat.
+  int64_t min_data_dir_bytes_free_;
+  double rows_written_per_sec_;
+  double rows_scanned_per_sec_;
+
   gscoped_ptr<ServerRegistrationPB> registration_;
 
   std::shared_ptr<tserver::TabletServerAdminServiceProxy> ts_admin_proxy_;
@@ -33,7 +33,8 @@ using strings::Substitute;
 namespace kudu {
 namespace master {
 
-TSManager::TSManager() {
+TSManager::TSManager()
+    : registrations_version_(0) {
 }
 
 TSManager::~TSManager() {
@@ -84,6 +85,7 @@ Status TSManager::RegisterTS(const NodeInstancePB& instance,
     desc->swap(found);
   }
 
+  registrations_version_.fetch_add(1, std::memory_order_release);
   return Status::OK();
 }
 
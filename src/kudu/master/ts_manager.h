@@ -17,6 +17,7 @@
 #ifndef KUDU_MASTER_TS_MANAGER_H
 #define KUDU_MASTER_TS_MANAGER_H
 
+#include <atomic>
 #include <memory>
 #include <string>
 #include <unordered_map>
@@ -84,6 +85,12 @@ class TSManager {
   // Get the TS count.
   int GetCount() const;
 
+  // Return the number of calls to RegisterTS(). Information derived from
+  // the registrations may be cached for as long as this doesn't change.
+  uint64_t registrations_version() const {
+    return registrations_version_.load(std::memory_order_acquire);
+  }
+
  private:
   mutable rw_spinlock lock_;
 
@@ -91,6 +98,8 @@ class TSManager {
     std::string, std::shared_ptr<TSDescriptor> > TSDescriptorMap;
   TSDescriptorMap servers_by_id_;
 
+  std::atomic<uint64_t> registrations_version_;
+
   DISALLOW_COPY_AND_ASSIGN(TSManager);
 };
 
@@ -17,6 +17,8 @@
 
 #include "kudu/rpc/acceptor_pool.h"
 
+#include <boost/bind.hpp>
+#include <ev++.h>
 #include <gflags/gflags.h>
 #include <glog/logging.h>
 #include <inttypes.h>
@@ -29,6 +31,7 @@
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/rpc/messenger.h"
+#include "kudu/rpc/reactor.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/logging.h"
 #include "kudu/util/metrics.h"
@@ -39,6 +42,7 @@
 
 using google::protobuf::Message;
 using std::string;
+using std::unique_ptr;
 
 METRIC_DEFINE_counter(server, rpc_connections_accepted,
                       "RPC Connections Accepted",
@@ -54,9 +58,90 @@ DEFINE_int32(rpc_acceptor_listen_backlog, 128,
              "new inbound connection requests.");
 TAG_FLAG(rpc_acceptor_listen_backlog, advanced);
 
+DEFINE_bool(rpc_reuseport_acceptors, false,
+            "Whether each reactor thread listens on its own SO_REUSEPORT socket "
+            "for RPC connections and accepts them in its event loop, instead of "
+            "acceptor threads handing connections accepted from a shared socket "
+            "to the reactors. This spreads the cost of connection setup across "
+            "the reactors when many clients connect at once. Only supported on "
+            "Linux; --rpc_num_acceptors_per_address has no effect if set.");
+TAG_FLAG(rpc_reuseport_acceptors, experimental);
+
+DEFINE_bool(rpc_listen_on_local_socket, false,
+            "Whether RPC servers also accept connections on a Unix domain socket, "
+            "in the abstract namespace, named after their bound address. Clients "
+            "running on the same host then connect to it rather than over TCP, "
+            "which bypasses the loopback network stack. Only supported on Linux.");
+TAG_FLAG(rpc_listen_on_local_socket, experimental);
+
 namespace kudu {
 namespace rpc {
 
+string LocalSocketName(const Sockaddr& addr) {
+  return "kudu-rpc-" + addr.ToString();
+}
+
+// The most connections accepted by a reactor per wakeup, so that a burst of
+// new connections doesn't starve the existing ones. The listening socket is
+// watched level-triggered, so the rest are accepted in the next iterations.
+static const int kMaxAcceptsPerWakeup = 64;
+
+// Accepts the connections of one listening socket in the event loop of a
+// reactor. Start() and Stop() must be called from the reactor thread.
+class AcceptorPool::ReactorAcceptor {
+ public:
+  // 'socket' must be listening and non-blocking, and must outlive this object.
+  ReactorAcceptor(AcceptorPool* pool, Reactor* reactor, Socket* socket)
+      : pool_(pool),
+        reactor_(reactor),
+        socket_(socket) {
+  }
+
+  Reactor* reactor() const { return reactor_; }
+
+  Status Start() {
+    reactor_->RegisterIoWatcher(&io_);
+    io_.set<ReactorAcceptor, &ReactorAcceptor::IoHandler>(this);
+    io_.start(socket_->GetFd(), ev::READ);
+    return Status::OK();
+  }
+
+  Status Stop() {
+    io_.stop();
+    return Status::OK();
+  }
+
+ private:
+  void IoHandler(ev::io& watcher, int revents) {
+    DCHECK(reactor_->IsCurrentThread());
+    if (PREDICT_FALSE(EV_ERROR & revents)) {
+      LOG(WARNING) << reactor_->name() << ": got an error in the accept handler";
+      return;
+    }
+    for (int i = 0; i < kMaxAcceptsPerWakeup; i++) {
+      Socket new_sock;
+      Sockaddr remote;
+      Status s = socket_->Accept(&new_sock, &remote, Socket::FLAG_NONBLOCKING);
+      if (!s.ok()) {
+        int err = s.posix_code();
+        if (!Socket::IsTemporarySocketError(err) && err != ECONNABORTED) {
+          KLOG_EVERY_N_SECS(WARNING, 1) << reactor_->name() << ": accept failed: "
+                                        << s.ToString() << THROTTLE_MSG;
+        }
+        return;
+      }
+      pool_->RegisterAcceptedSocket(&new_sock, remote, reactor_, false);
+    }
+  }
+
+  AcceptorPool* const pool_;
+  Reactor* const reactor_;
+  Socket* const socket_;
+  ev::io io_;
+
+  DISALLOW_COPY_AND_ASSIGN(ReactorAcceptor);
+};
+
 AcceptorPool::AcceptorPool(Messenger* messenger, Socket* socket,
                            Sockaddr bind_address)
     : messenger_(messenger),
@@ -70,18 +155,79 @@ AcceptorPool::~AcceptorPool() {
   Shutdown();
 }
 
+bool AcceptorPool::PerReactorAcceptEnabled() {
+#if defined(__linux__)
+  return FLAGS_rpc_reuseport_acceptors;
+#else
+  return false;
+#endif
+}
+
 Status AcceptorPool::Start(int num_threads) {
+  Status s;
+  if (PerReactorAcceptEnabled()) {
+    s = StartReactorAcceptors();
+  } else {
+    s = socket_.Listen(FLAGS_rpc_acceptor_listen_backlog);
+    for (int i = 0; s.ok() && i < num_threads; i++) {
+      scoped_refptr<kudu::Thread> new_thread;
+      s = kudu::Thread::Create("acceptor pool", "acceptor",
+          &AcceptorPool::RunThread, this, &socket_, &new_thread);
+      if (s.ok()) {
+        threads_.push_back(new_thread);
+      }
+    }
+  }
+  if (s.ok() && FLAGS_rpc_listen_on_local_socket) {
+    s = StartLocalAcceptor();
+  }
+  if (!s.ok()) {
+    Shutdown();
+  }
+  return s;
+}
+
+Status AcceptorPool::StartLocalAcceptor() {
+  // Name the socket after the actual port, in case the pool was bound to
+  // port 0.
+  Sockaddr addr;
+  RETURN_NOT_OK(socket_.GetSocketAddress(&addr));
+  local_socket_.reset(new Socket());
+  RETURN_NOT_OK(local_socket_->InitUnixDomain(0));
+  RETURN_NOT_OK(local_socket_->BindAbstract(LocalSocketName(addr)));
+  RETURN_NOT_OK(local_socket_->Listen(FLAGS_rpc_acceptor_listen_backlog));
+
+  scoped_refptr<kudu::Thread> new_thread;
+  RETURN_NOT_OK(kudu::Thread::Create("acceptor pool", "local-acceptor",
+      &AcceptorPool::RunThread, this, local_socket_.get(), &new_thread));
+  threads_.push_back(new_thread);
+  return Status::OK();
+}
+
+Status AcceptorPool::StartReactorAcceptors() {
+  // Bind the sockets of the other reactors to the actual port, in case the
+  // pool was bound to port 0.
+  Sockaddr addr;
+  RETURN_NOT_OK(socket_.GetSocketAddress(&addr));
+  RETURN_NOT_OK(socket_.SetNonBlocking(true));
   RETURN_NOT_OK(socket_.Listen(FLAGS_rpc_acceptor_listen_backlog));
 
-  for (int i = 0; i < num_threads; i++) {
-    scoped_refptr<kudu::Thread> new_thread;
-    Status s = kudu::Thread::Create("acceptor pool", "acceptor",
-        &AcceptorPool::RunThread, this, &new_thread);
-    if (!s.ok()) {
-      Shutdown();
-      return s;
+  for (Reactor* reactor : messenger_->reactors_) {
+    Socket* sock = &socket_;
+    if (!reactor_acceptors_.empty()) {
+      unique_ptr<Socket> new_sock(new Socket());
+      RETURN_NOT_OK(new_sock->Init(Socket::FLAG_NONBLOCKING));
+      RETURN_NOT_OK(new_sock->SetReuseAddr(true));
+      RETURN_NOT_OK(new_sock->SetReusePort(true));
+      RETURN_NOT_OK(new_sock->Bind(addr));
+      RETURN_NOT_OK(new_sock->Listen(FLAGS_rpc_acceptor_listen_backlog));
+      sock = new_sock.get();
+      reuseport_sockets_.emplace_back(std::move(new_sock));
     }
-    threads_.push_back(new_thread);
+    unique_ptr<ReactorAcceptor> acceptor(new ReactorAcceptor(this, reactor, sock));
+    RETURN_NOT_OK(reactor->RunOnReactorThread(
+        boost::bind(&ReactorAcceptor::Start, acceptor.get())));
+    reactor_acceptors_.emplace_back(std::move(acceptor));
   }
   return Status::OK();
 }
@@ -93,12 +239,27 @@ void AcceptorPool::Shutdown() {
     return;
   }
 
+  // The messenger shuts down its pools before its reactors, so the reactors
+  // are still running and can stop watching their sockets.
+  for (const auto& acceptor : reactor_acceptors_) {
+    WARN_NOT_OK(acceptor->reactor()->RunOnReactorThread(
+                    boost::bind(&ReactorAcceptor::Stop, acceptor.get())),
+                "Could not stop accepting connections on " + acceptor->reactor()->name());
+  }
+  reactor_acceptors_.clear();
+  reuseport_sockets_.clear();
+
 #if defined(__linux__)
   // Closing the socket will break us out of accept() if we're in it, and
   // prevent future accepts.
   WARN_NOT_OK(socket_.Shutdown(true, true),
               strings::Substitute("Could not shut down acceptor socket on $0",
                                   bind_address_.ToString()));
+  if (local_socket_ && local_socket_->GetFd() >= 0) {
+    WARN_NOT_OK(local_socket_->Shutdown(true, true),
+                strings::Substitute("Could not shut down local acceptor socket of $0",
+                                    bind_address_.ToString()));
+  }
 #else
   // Calling shutdown on an accepting (non-connected) socket is illegal on most
   // platforms (but not Linux). Instead, the accepting threads are interrupted
@@ -122,13 +283,14 @@ Status AcceptorPool::GetBoundAddress(Sockaddr* addr) const {
   return socket_.GetSocketAddress(addr);
 }
 
-void AcceptorPool::RunThread() {
+void AcceptorPool::RunThread(Socket* socket) {
+  bool local = socket != &socket_;
   while (true) {
     Socket new_sock;
     Sockaddr remote;
-    VLOG(2) << "calling accept() on socket " << socket_.GetFd()
+    VLOG(2) << "calling accept() on socket " << socket->GetFd()
             << " listening on " << bind_address_.ToString();
-    Status s = socket_.Accept(&new_sock, &remote, Socket::FLAG_NONBLOCKING);
+    Status s = socket->Accept(&new_sock, &remote, Socket::FLAG_NONBLOCKING);
     if (!s.ok()) {
       if (Release_Load(&closing_)) {
         break;
@@ -137,18 +299,28 @@ void AcceptorPool::RunThread() {
                                     << THROTTLE_MSG;
       continue;
     }
-    s = new_sock.SetNoDelay(true);
-    if (!s.ok()) {
-      KLOG_EVERY_N_SECS(WARNING, 1) << "Acceptor with remote = " << remote.ToString()
-          << " failed to set TCP_NODELAY on a newly accepted socket: "
-          << s.ToString() << THROTTLE_MSG;
-      continue;
-    }
-    rpc_connections_accepted_->Increment();
-    messenger_->RegisterInboundSocket(&new_sock, remote);
+    RegisterAcceptedSocket(&new_sock, remote, nullptr, local);
   }
   VLOG(1) << "AcceptorPool shutting down.";
 }
 
+void AcceptorPool::RegisterAcceptedSocket(Socket* new_sock, const Sockaddr& remote,
+                                          Reactor* reactor, bool local) {
+  // Unix domain sockets don't buffer small writes like TCP does.
+  Status s = local ? Status::OK() : new_sock->SetNoDelay(true);
+  if (!s.ok()) {
+    KLOG_EVERY_N_SECS(WARNING, 1) << "Acceptor with remote = " << remote.ToString()
+        << " failed to set TCP_NODELAY on a newly accepted socket: "
+        << s.ToString() << THROTTLE_MSG;
+    return;
+  }
+  rpc_connections_accepted_->Increment();
+  if (reactor) {
+    reactor->RegisterInboundSocket(new_sock, remote);
+  } else {
+    messenger_->RegisterInboundSocket(new_sock, remote);
+  }
+}
+
 } // namespace rpc
 } // namespace kudu
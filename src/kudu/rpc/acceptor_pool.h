@@ -18,6 +18,8 @@
 #ifndef KUDU_RPC_ACCEPTOR_POOL_H
 #define KUDU_RPC_ACCEPTOR_POOL_H
 
+#include <memory>
+#include <string>
 #include <vector>
 
 #include "kudu/gutil/atomicops.h"
@@ -34,19 +36,42 @@ class Socket;
 namespace rpc {
 
 class Messenger;
+class Reactor;
+
+// Returns the abstract name of the Unix domain socket on which an RPC server
+// bound to 'addr' accepts the connections of its own host.
+std::string LocalSocketName(const Sockaddr& addr);
 
 // A pool of threads calling accept() to create new connections.
 // Acceptor pool threads terminate when they notice that the messenger has been
 // shut down, if Shutdown() is called, or if the pool object is destructed.
+//
+// If --rpc_reuseport_acceptors is set, there are no acceptor threads: each
+// reactor of the messenger instead listens on its own SO_REUSEPORT socket
+// bound to the same address, and accepts from its event loop. The kernel
+// spreads incoming connections across the sockets, and accepted connections
+// are registered with the reactor which accepted them, without a handoff.
+// This keeps a burst of reconnecting clients from queueing behind a single
+// socket and thread.
+//
+// If --rpc_listen_on_local_socket is set, the pool also accepts connections
+// on a Unix domain socket named after its bound address, in an additional
+// thread. Clients of the same host connect to it rather than over TCP.
 class AcceptorPool {
  public:
   // Create a new acceptor pool.  Calls socket::Release to take ownership of the
   // socket.
-  // 'socket' must be already bound, but should not yet be listening.
+  // 'socket' must be already bound, but should not yet be listening. In the
+  // per-reactor mode, it must have been bound with SO_REUSEPORT.
   AcceptorPool(Messenger *messenger, Socket *socket, Sockaddr bind_address);
   ~AcceptorPool();
 
-  // Start listening and accepting connections.
+  // Whether pools accept in the event loops of the reactors rather than in
+  // acceptor threads. This is only supported on Linux.
+  static bool PerReactorAcceptEnabled();
+
+  // Start listening and accepting connections. 'num_threads' is ignored if
+  // the pool accepts in the reactors.
   Status Start(int num_threads);
   void Shutdown();
 
@@ -60,13 +85,37 @@ class AcceptorPool {
   Status GetBoundAddress(Sockaddr* addr) const;
 
  private:
-  void RunThread();
+  class ReactorAcceptor;
+
+  // Accepts the connections of 'socket' until the pool shuts down.
+  void RunThread(Socket* socket);
+
+  // Starts listening on 'local_socket_', and accepting its connections.
+  Status StartLocalAcceptor();
+
+  // Starts accepting connections in each reactor of the messenger.
+  Status StartReactorAcceptors();
+
+  // Sets up the newly accepted 'new_sock' and passes it on to 'reactor', or
+  // to the reactor picked by the messenger if 'reactor' is null. 'local' is
+  // set if the socket was accepted on 'local_socket_'.
+  void RegisterAcceptedSocket(Socket* new_sock, const Sockaddr& remote, Reactor* reactor,
+                              bool local);
 
   Messenger *messenger_;
   Socket socket_;
   Sockaddr bind_address_;
   std::vector<scoped_refptr<kudu::Thread> > threads_;
 
+  // The acceptors of each reactor, in the per-reactor mode. The first one
+  // listens on 'socket_', and the others on 'reuseport_sockets_'.
+  std::vector<std::unique_ptr<ReactorAcceptor>> reactor_acceptors_;
+  std::vector<std::unique_ptr<Socket>> reuseport_sockets_;
+
+  // The Unix domain socket accepting the connections of the local host, if
+  // --rpc_listen_on_local_socket is set.
+  std::unique_ptr<Socket> local_socket_;
+
   scoped_refptr<Counter> rpc_connections_accepted_;
 
   Atomic32 closing_;
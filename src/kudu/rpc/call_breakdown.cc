@@ -0,0 +1,278 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/rpc/call_breakdown.h"
+
+#include <algorithm>
+#include <mutex>
+#include <utility>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include "kudu/rpc/inbound_call.h"
+#include "kudu/rpc/rpc_introspection.pb.h"
+#include "kudu/rpc/service_if.h"
+#include "kudu/util/flag_tags.h"
+#include "kudu/util/hdr_histogram.h"
+#include "kudu/util/monotime.h"
+#include "kudu/util/trace.h"
+
+DEFINE_int32(rpc_call_breakdown_ring_size, 1024,
+             "Number of recently completed calls whose per-stage timing is kept "
+             "by each reactor thread for /rpcz. The aggregated per-method "
+             "breakdown is kept regardless. 0 disables the per-call records.");
+TAG_FLAG(rpc_call_breakdown_ring_size, advanced);
+
+using std::unique_ptr;
+using std::vector;
+
+namespace kudu {
+namespace rpc {
+
+const char* const kReplicationTimeTraceCounter = "replication_time_us";
+const char* const kWalSyncWaitTraceCounter = "wal_sync_wait_us";
+
+// Stage latencies are tracked up to a minute, like the handler latency
+// histograms, with two significant digits of precision.
+static const int64_t kMaxTrackedLatencyUs = 60 * 1000 * 1000;
+static const int kNumSignificantDigits = 2;
+
+// The number of the slowest recent calls of each method included in a dump.
+static const int kNumSlowestCallsToDump = 10;
+
+const char* CallStageName(CallStage stage) {
+  switch (stage) {
+    case kQueueStage: return "queue";
+    case kHandlerStage: return "handler";
+    case kConsensusStage: return "consensus_wait";
+    case kWalSyncStage: return "wal_sync_wait";
+    case kResponseSendStage: return "response_send";
+    case kNumCallStages: break;
+  }
+  LOG(FATAL) << "Unknown call stage: " << stage;
+  return nullptr;
+}
+
+namespace {
+
+// Sum the values of the trace counter 'name' in 't' and all of its children.
+int64_t SumTraceCounter(const Trace& t, const char* name) {
+  int64_t sum = t.metrics().GetMetric(name);
+  for (const auto& child : t.ChildTraces()) {
+    sum += SumTraceCounter(*child.second.get(), name);
+  }
+  return sum;
+}
+
+int64_t TotalUs(const CallBreakdown& b) {
+  // The consensus and WAL stages overlap the handler stage.
+  return b.stage_us[kQueueStage] + b.stage_us[kHandlerStage] +
+      b.stage_us[kResponseSendStage];
+}
+
+void BreakdownToPB(const CallBreakdown& b, RpcCallBreakdownPB* pb) {
+  pb->set_queue_us(b.stage_us[kQueueStage]);
+  pb->set_handler_us(b.stage_us[kHandlerStage]);
+  pb->set_consensus_us(b.stage_us[kConsensusStage]);
+  pb->set_wal_sync_us(b.stage_us[kWalSyncStage]);
+  pb->set_response_send_us(b.stage_us[kResponseSendStage]);
+}
+
+} // anonymous namespace
+
+MethodBreakdown::MethodBreakdown(std::string method_name)
+    : method_name_(std::move(method_name)) {
+  for (auto& h : histograms_) {
+    h.reset(new HdrHistogram(kMaxTrackedLatencyUs, kNumSignificantDigits));
+  }
+}
+
+MethodBreakdown::~MethodBreakdown() {}
+
+void MethodBreakdown::Record(const CallBreakdown& breakdown) {
+  for (int i = 0; i < kNumCallStages; i++) {
+    int64_t us = std::min(std::max<int64_t>(breakdown.stage_us[i], 0), kMaxTrackedLatencyUs);
+    histograms_[i]->Increment(us);
+  }
+}
+
+void MethodBreakdown::GetStagesPB(RpcMethodBreakdownPB* pb) const {
+  pb->set_method_name(method_name_);
+  for (int i = 0; i < kNumCallStages; i++) {
+    // Copy the histogram so that the percentiles are consistent.
+    HdrHistogram h(*histograms_[i]);
+    RpcStageLatencyPB* stage_pb = pb->add_stages();
+    stage_pb->set_stage(CallStageName(static_cast<CallStage>(i)));
+    stage_pb->set_count(h.TotalCount());
+    if (h.TotalCount() == 0) {
+      continue;
+    }
+    stage_pb->set_mean_us(h.MeanValue());
+    stage_pb->set_percentile_50_us(h.ValueAtPercentile(50));
+    stage_pb->set_percentile_99_us(h.ValueAtPercentile(99));
+    stage_pb->set_percentile_99_9_us(h.ValueAtPercentile(99.9));
+    stage_pb->set_max_us(h.MaxValue());
+  }
+}
+
+CallBreakdownRing::CallBreakdownRing(int capacity)
+    : capacity_(capacity),
+      slots_(new Slot[capacity]),
+      num_added_(0) {
+  for (int i = 0; i < capacity_; i++) {
+    slots_[i].seq.store(0, std::memory_order_relaxed);
+    slots_[i].method.store(nullptr, std::memory_order_relaxed);
+    for (auto& us : slots_[i].stage_us) {
+      us.store(0, std::memory_order_relaxed);
+    }
+  }
+}
+
+void CallBreakdownRing::Add(const MethodBreakdown* method, const CallBreakdown& breakdown) {
+  if (capacity_ == 0) {
+    return;
+  }
+  uint64_t n = num_added_.load(std::memory_order_relaxed);
+  Slot& slot = slots_[n % capacity_];
+
+  uint64_t seq = slot.seq.load(std::memory_order_relaxed);
+  slot.seq.store(seq + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  slot.method.store(method, std::memory_order_relaxed);
+  for (int i = 0; i < kNumCallStages; i++) {
+    slot.stage_us[i].store(breakdown.stage_us[i], std::memory_order_relaxed);
+  }
+  slot.seq.store(seq + 2, std::memory_order_release);
+  num_added_.store(n + 1, std::memory_order_release);
+}
+
+void CallBreakdownRing::Snapshot(vector<Entry>* entries) const {
+  uint64_t num_slots = std::min<uint64_t>(num_added_.load(std::memory_order_acquire),
+                                          capacity_);
+  for (uint64_t i = 0; i < num_slots; i++) {
+    const Slot& slot = slots_[i];
+    uint64_t seq = slot.seq.load(std::memory_order_acquire);
+    if (seq & 1) {
+      continue;
+    }
+    Entry e;
+    e.method = slot.method.load(std::memory_order_relaxed);
+    for (int j = 0; j < kNumCallStages; j++) {
+      e.breakdown.stage_us[j] = slot.stage_us[j].load(std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot.seq.load(std::memory_order_relaxed) != seq) {
+      continue;
+    }
+    entries->push_back(e);
+  }
+}
+
+CallBreakdownStore::CallBreakdownStore(int num_reactors) {
+  for (int i = 0; i < num_reactors; i++) {
+    rings_.emplace_back(new CallBreakdownRing(
+        std::max(FLAGS_rpc_call_breakdown_ring_size, 0)));
+  }
+}
+
+CallBreakdownStore::~CallBreakdownStore() {}
+
+void CallBreakdownStore::AddCall(InboundCall* call, const MonoTime& response_sent,
+                                 int reactor_idx) {
+  const InboundCallTiming& timing = call->timing();
+  // Calls which were rejected before reaching a handler, e.g. because the
+  // service queue was full, don't have a meaningful breakdown.
+  if (!timing.time_handled.Initialized() || !timing.time_completed.Initialized()) {
+    return;
+  }
+  MethodBreakdown* method = BreakdownForCall(call);
+  if (PREDICT_FALSE(!method)) {
+    return;
+  }
+
+  CallBreakdown b;
+  b.stage_us[kQueueStage] = (timing.time_handled - timing.time_received).ToMicroseconds();
+  b.stage_us[kHandlerStage] = (timing.time_completed - timing.time_handled).ToMicroseconds();
+  b.stage_us[kConsensusStage] = SumTraceCounter(*call->trace(), kReplicationTimeTraceCounter);
+  b.stage_us[kWalSyncStage] = SumTraceCounter(*call->trace(), kWalSyncWaitTraceCounter);
+  b.stage_us[kResponseSendStage] = (response_sent - timing.time_completed).ToMicroseconds();
+
+  method->Record(b);
+  DCHECK_LT(reactor_idx, rings_.size());
+  rings_[reactor_idx]->Add(method, b);
+}
+
+MethodBreakdown* CallBreakdownStore::BreakdownForCall(InboundCall* call) {
+  RpcMethodInfo* info = call->method_info();
+  if (PREDICT_FALSE(!info)) {
+    return nullptr;
+  }
+
+  // Most likely, we already have a breakdown for the method.
+  {
+    shared_lock<rw_spinlock> l(methods_lock_.get_lock());
+    auto it = methods_.find(info);
+    if (PREDICT_TRUE(it != methods_.end())) {
+      return it->second.breakdown.get();
+    }
+  }
+
+  unique_ptr<MethodBreakdown> mb(new MethodBreakdown(call->remote_method().ToString()));
+  std::lock_guard<percpu_rwlock> lock(methods_lock_);
+  MethodEntry& entry = methods_[info];
+  if (!entry.breakdown) {
+    entry.method_info = info;
+    entry.breakdown = std::move(mb);
+  }
+  return entry.breakdown.get();
+}
+
+void CallBreakdownStore::DumpPB(DumpRpczStoreResponsePB* resp) {
+  vector<const MethodBreakdown*> methods;
+  {
+    shared_lock<rw_spinlock> l(methods_lock_.get_lock());
+    for (const auto& p : methods_) {
+      methods.push_back(p.second.breakdown.get());
+    }
+  }
+
+  vector<CallBreakdownRing::Entry> entries;
+  for (const auto& ring : rings_) {
+    ring->Snapshot(&entries);
+  }
+  std::sort(entries.begin(), entries.end(),
+            [](const CallBreakdownRing::Entry& a, const CallBreakdownRing::Entry& b) {
+              return TotalUs(a.breakdown) > TotalUs(b.breakdown);
+            });
+
+  for (const MethodBreakdown* method : methods) {
+    RpcMethodBreakdownPB* pb = resp->add_breakdowns();
+    method->GetStagesPB(pb);
+    for (const auto& e : entries) {
+      if (pb->slowest_recent_calls_size() == kNumSlowestCallsToDump) {
+        break;
+      }
+      if (e.method == method) {
+        BreakdownToPB(e.breakdown, pb->add_slowest_recent_calls());
+      }
+    }
+  }
+}
+
+} // namespace rpc
+} // namespace kudu
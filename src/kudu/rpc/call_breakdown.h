@@ -0,0 +1,162 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "kudu/gutil/macros.h"
+#include "kudu/gutil/ref_counted.h"
+#include "kudu/util/locks.h"
+
+namespace kudu {
+
+class HdrHistogram;
+class MonoTime;
+
+namespace rpc {
+
+class DumpRpczStoreResponsePB;
+class InboundCall;
+class RpcMethodBreakdownPB;
+struct RpcMethodInfo;
+
+// Names of the trace counters from which the consensus and WAL stages of a
+// call are read. TraceMetrics compares counter names by address, so code
+// which waits on these stages must increment the counters using these
+// pointers rather than equal string literals.
+extern const char* const kReplicationTimeTraceCounter;
+extern const char* const kWalSyncWaitTraceCounter;
+
+// The stages of an inbound call that are timed for every call.
+//
+// The consensus and WAL stages overlap the handler stage: they are waits
+// which happened on behalf of the call (possibly on other threads) before
+// its response was queued.
+enum CallStage {
+  kQueueStage = 0,
+  kHandlerStage,
+  kConsensusStage,
+  kWalSyncStage,
+  kResponseSendStage,
+  kNumCallStages
+};
+
+const char* CallStageName(CallStage stage);
+
+// Microseconds spent in each stage of one call.
+struct CallBreakdown {
+  int64_t stage_us[kNumCallStages];
+};
+
+// Aggregated per-stage latency histograms for a single RPC method.
+class MethodBreakdown {
+ public:
+  explicit MethodBreakdown(std::string method_name);
+  ~MethodBreakdown();
+
+  // Thread-safe.
+  void Record(const CallBreakdown& breakdown);
+
+  const std::string& method_name() const { return method_name_; }
+
+  // Fills in the aggregated per-stage latencies, leaving the recent calls
+  // unset.
+  void GetStagesPB(RpcMethodBreakdownPB* pb) const;
+
+ private:
+  const std::string method_name_;
+  std::unique_ptr<HdrHistogram> histograms_[kNumCallStages];
+
+  DISALLOW_COPY_AND_ASSIGN(MethodBreakdown);
+};
+
+// A fixed-size ring of the most recently completed calls.
+//
+// Add() may only be called by a single thread, the owning reactor thread,
+// and takes no locks. Snapshot() may be called from any thread; each slot
+// carries a sequence number which the writer makes odd while it rewrites
+// the slot, so readers can skip slots that are being overwritten.
+class CallBreakdownRing {
+ public:
+  explicit CallBreakdownRing(int capacity);
+
+  void Add(const MethodBreakdown* method, const CallBreakdown& breakdown);
+
+  struct Entry {
+    const MethodBreakdown* method;
+    CallBreakdown breakdown;
+  };
+  void Snapshot(std::vector<Entry>* entries) const;
+
+ private:
+  struct Slot {
+    std::atomic<uint64_t> seq;
+    std::atomic<const MethodBreakdown*> method;
+    std::atomic<int64_t> stage_us[kNumCallStages];
+  };
+
+  const int capacity_;
+  std::unique_ptr<Slot[]> slots_;
+
+  // The number of calls ever added. Only written by the owning thread.
+  std::atomic<uint64_t> num_added_;
+
+  DISALLOW_COPY_AND_ASSIGN(CallBreakdownRing);
+};
+
+// Keeps a compact, binary timing breakdown of every inbound call handled by
+// a messenger: a ring of recent calls per reactor thread, and an aggregated
+// histogram of each stage per method. Unlike RpczStore, which samples a few
+// calls and keeps their full traces, this is cheap enough to do for every
+// call, so it can be used to find which stage tail latencies come from.
+class CallBreakdownStore {
+ public:
+  explicit CallBreakdownStore(int num_reactors);
+  ~CallBreakdownStore();
+
+  // Record 'call', whose response has just been sent at 'response_sent'.
+  // Must be called on the thread of reactor 'reactor_idx'.
+  void AddCall(InboundCall* call, const MonoTime& response_sent, int reactor_idx);
+
+  // Dump the per-method breakdowns, along with the slowest calls still in
+  // the rings, into 'resp'.
+  void DumpPB(DumpRpczStoreResponsePB* resp);
+
+ private:
+  MethodBreakdown* BreakdownForCall(InboundCall* call);
+
+  std::vector<std::unique_ptr<CallBreakdownRing>> rings_;
+
+  percpu_rwlock methods_lock_;
+
+  // Protected by methods_lock_. Holds a reference to each method so that its
+  // address is not reused while it is a key.
+  struct MethodEntry {
+    scoped_refptr<RpcMethodInfo> method_info;
+    std::unique_ptr<MethodBreakdown> breakdown;
+  };
+  std::unordered_map<const RpcMethodInfo*, MethodEntry> methods_;
+
+  DISALLOW_COPY_AND_ASSIGN(CallBreakdownStore);
+};
+
+} // namespace rpc
+} // namespace kudu
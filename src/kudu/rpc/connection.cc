@@ -31,6 +31,7 @@
 #include "kudu/gutil/strings/human_readable.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/rpc/auth_store.h"
+#include "kudu/rpc/call_breakdown.h"
 #include "kudu/rpc/rpc_introspection.pb.h"
 #include "kudu/rpc/constants.h"
 #include "kudu/rpc/messenger.h"
@@ -41,6 +42,7 @@
 #include "kudu/rpc/sasl_server.h"
 #include "kudu/rpc/transfer.h"
 #include "kudu/util/debug-util.h"
+#include "kudu/util/logging.h"
 #include "kudu/util/net/sockaddr.h"
 #include "kudu/util/status.h"
 #include "kudu/util/trace.h"
@@ -63,6 +65,7 @@ Connection::Connection(ReactorThread *reactor_thread, Sockaddr remote,
     : reactor_thread_(reactor_thread),
       socket_(socket),
       remote_(std::move(remote)),
+      conn_idx_(0),
       direction_(direction),
       last_activity_time_(MonoTime::Now()),
       is_epoll_registered_(false),
@@ -196,11 +199,12 @@ Connection::CallAwaitingResponse::~CallAwaitingResponse() {
 void Connection::CallAwaitingResponse::HandleTimeout(ev::timer &watcher, int revents) {
   if (remaining_timeout > 0) {
     if (watcher.remaining() < -1.0) {
-      LOG(WARNING) << "RPC call timeout handler was delayed by "
-                   << -watcher.remaining() << "s! This may be due to a process-wide "
-                   << "pause such as swapping, logging-related delays, or allocator lock "
-                   << "contention. Will allow an additional "
-                   << remaining_timeout << "s for a response.";
+      KLOG_EVERY_N_SECS(WARNING, 1)
+          << "RPC call timeout handler was delayed by "
+          << -watcher.remaining() << "s! This may be due to a process-wide "
+          << "pause such as swapping, logging-related delays, or allocator lock "
+          << "contention. Will allow an additional "
+          << remaining_timeout << "s for a response." << THROTTLE_MSG;
     }
 
     watcher.set(remaining_timeout, 0);
@@ -282,9 +286,13 @@ void Connection::QueueOutboundCall(const shared_ptr<OutboundCall> &call) {
   int32_t call_id = GetNextCallId();
   call->set_call_id(call_id);
 
-  // Serialize the actual bytes to be put on the wire.
+  // Serialize the actual bytes to be put on the wire. The server's features
+  // are only known once negotiation has finished, so calls queued before then
+  // are sent uncompressed.
+  bool peer_accepts_compression = negotiation_complete_ &&
+      ContainsKey(sasl_client_.server_features(), COMPRESSED_BODIES);
   slices_tmp_.clear();
-  Status s = call->SerializeTo(&slices_tmp_);
+  Status s = call->SerializeTo(&slices_tmp_, peer_accepts_compression);
   if (PREDICT_FALSE(!s.ok())) {
     call->SetFailed(s);
     return;
@@ -365,6 +373,9 @@ struct ResponseTransferCallbacks : public TransferCallbacks {
   }
 
   virtual void NotifyTransferFinished() OVERRIDE {
+    Reactor* reactor = conn_->reactor_thread_->reactor();
+    reactor->messenger()->call_breakdown_store()->AddCall(
+        call_.get(), MonoTime::Now(), reactor->index());
     delete this;
   }
 
@@ -128,6 +128,11 @@ class Connection : public RefCountedThreadSafe<Connection> {
   // Get the user credentials which will be used to log in.
   const UserCredentials &user_credentials() const { return user_credentials_; }
 
+  // For client connections, the index of this connection among those to the
+  // same remote. See ConnectionId::conn_idx().
+  void set_conn_idx(int conn_idx) { conn_idx_ = conn_idx; }
+  int conn_idx() const { return conn_idx_; }
+
   RpczStore* rpcz_store();
 
   // libev callback when data is available to read.
@@ -234,6 +239,9 @@ class Connection : public RefCountedThreadSafe<Connection> {
   // The credentials of the user operating on this connection (if a client user).
   UserCredentials user_credentials_;
 
+  // See conn_idx().
+  int conn_idx_;
+
   // whether we are client or server
   Direction direction_;
 
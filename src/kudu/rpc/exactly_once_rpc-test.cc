@@ -15,6 +15,7 @@
 // specific language governing permissions and limitations
 // under the License.
 
+#include "kudu/gutil/strings/substitute.h"
 #include "kudu/rpc/retriable_rpc.h"
 #include "kudu/rpc/rpc.h"
 #include "kudu/rpc/rpc-test-base.h"
@@ -22,6 +23,7 @@
 DECLARE_int64(remember_clients_ttl_ms);
 DECLARE_int64(remember_responses_ttl_ms);
 DECLARE_int64(result_tracker_gc_interval_ms);
+DECLARE_int64(result_tracker_memory_limit_mb);
 
 using std::atomic_int;
 using std::shared_ptr;
@@ -352,9 +354,9 @@ TEST_F(ExactlyOnceRpcTest, TestExactlyOnceSemanticsAfterRpcCompleted) {
     // Send the request the first time.
     ASSERT_OK(proxy_->AddExactlyOnce(req, &original_resp, &controller));
 
-    // The incremental usage of a new client is the size of the response itself
+    // The incremental usage of a new client is the size of the serialized response
     // plus some fixed overhead for the client-tracking structure.
-    int expected_incremental_usage = original_resp.SpaceUsed() + 200;
+    int expected_incremental_usage = original_resp.ByteSize() + 200;
 
     // The consumption isn't immediately updated, since the MemTracker update
     // happens after we call 'Respond' on the RPC.
@@ -528,6 +530,39 @@ TEST_F(ExactlyOnceRpcTest, TestExactlyOnceSemanticsGarbageCollection) {
   ASSERT_NE(resp.ShortDebugString(), original.ShortDebugString());
 }
 
+// Tests that the oldest responses are evicted before their TTL elapses when the result
+// tracker uses more memory than it's allowed to.
+TEST_F(ExactlyOnceRpcTest, TestExactlyOnceSemanticsEvictionUnderMemoryPressure) {
+  FLAGS_result_tracker_memory_limit_mb = 1;
+  const int64_t kLimitBytes = 1024 * 1024;
+
+  StartServer();
+
+  // Make requests from enough clients to use more than the allowed memory.
+  int num_clients = 0;
+  while (mem_tracker_->consumption() <= kLimitBytes) {
+    RpcController controller;
+    ExactlyOnceRequestPB req;
+    ExactlyOnceResponsePB resp;
+    req.set_value_to_add(1);
+    AddRequestId(&controller, strings::Substitute("client-$0", num_clients++), 0, 0);
+    ASSERT_OK(proxy_->AddExactlyOnce(req, &resp, &controller));
+  }
+
+  result_tracker_->GCResults();
+  ASSERT_LE(mem_tracker_->consumption(), kLimitBytes);
+
+  // The responses of the first clients were forgotten, so their retries are stale.
+  RpcController controller;
+  ExactlyOnceRequestPB req;
+  ExactlyOnceResponsePB resp;
+  req.set_value_to_add(1);
+  AddRequestId(&controller, "client-0", 0, 1);
+  Status s = proxy_->AddExactlyOnce(req, &resp, &controller);
+  ASSERT_TRUE(s.IsRemoteError());
+  ASSERT_STR_CONTAINS(s.ToString(), "is stale");
+}
+
 // This test creates a thread continuously making requests to the server, some lasting longer
 // than the GC period, at the same time it runs GC, making sure that the corresponding
 // CompletionRecords/ClientStates are not deleted from underneath the ongoing requests.
@@ -17,6 +17,7 @@
 
 #include "kudu/rpc/inbound_call.h"
 
+#include <algorithm>
 #include <glog/stl_logging.h>
 #include <memory>
 
@@ -44,6 +45,7 @@ namespace rpc {
 
 InboundCall::InboundCall(Connection* conn)
   : conn_(conn),
+    response_compressed_(false),
     sidecars_deleter_(&sidecars_),
     trace_(new Trace),
     method_info_(nullptr) {
@@ -56,6 +58,12 @@ Status InboundCall::ParseFrom(gscoped_ptr<InboundTransfer> transfer) {
   TRACE_EVENT_FLOW_BEGIN0("rpc", "InboundCall", this);
   TRACE_EVENT0("rpc", "InboundCall::ParseFrom");
   RETURN_NOT_OK(serialization::ParseMessage(transfer->data(), &header_, &serialized_request_));
+  if (header_.has_uncompressed_body_size()) {
+    RETURN_NOT_OK(serialization::DecompressBody(serialized_request_,
+                                                header_.uncompressed_body_size(),
+                                                &decompressed_request_));
+    serialized_request_ = Slice(decompressed_request_.data(), decompressed_request_.size());
+  }
 
   // Adopt the service/method info from the header as soon as it's available.
   if (PREDICT_FALSE(!header_.has_remote_method())) {
@@ -90,11 +98,15 @@ void InboundCall::RespondUnsupportedFeature(const vector<uint32_t>& unsupported_
 }
 
 void InboundCall::RespondFailure(ErrorStatusPB::RpcErrorCodePB error_code,
-                                 const Status& status) {
+                                 const Status& status,
+                                 const MonoDelta& retry_after) {
   TRACE_EVENT0("rpc", "InboundCall::RespondFailure");
   ErrorStatusPB err;
   err.set_message(status.ToString());
   err.set_code(error_code);
+  if (retry_after.Initialized()) {
+    err.set_retry_after_ms(std::max<int64_t>(retry_after.ToMilliseconds(), 0));
+  }
 
   Respond(err, false);
 }
@@ -160,6 +172,28 @@ void InboundCall::SerializeResponseBuffer(const MessageLite& response,
   serialization::SerializeMessage(response, &response_msg_buf_,
                                   additional_size, true);
   int main_msg_size = additional_size + response_msg_buf_.size();
+
+  response_compressed_ = false;
+  if (header_.compress_response() &&
+      serialization::ShouldCompressBody(absolute_sidecar_offset)) {
+    // Compress the protobuf, without its length prefix, along with the
+    // sidecars. The client finds the sidecars in the decompressed body using
+    // the offsets computed above.
+    int delim_len = response_msg_buf_.size() - protobuf_msg_size;
+    vector<Slice> body;
+    body.reserve(1 + sidecars_.size());
+    body.emplace_back(response_msg_buf_.data() + delim_len, protobuf_msg_size);
+    for (RpcSidecar* car : sidecars_) {
+      body.push_back(car->AsSlice());
+    }
+    faststring compressed;
+    if (serialization::CompressBody(body, &compressed)) {
+      resp_hdr.set_uncompressed_body_size(absolute_sidecar_offset);
+      response_msg_buf_.assign_copy(compressed.data(), compressed.size());
+      main_msg_size = response_msg_buf_.size();
+      response_compressed_ = true;
+    }
+  }
   serialization::SerializeHeader(resp_hdr, main_msg_size,
                                  &response_hdr_buf_);
 }
@@ -171,6 +205,9 @@ void InboundCall::SerializeResponseTo(vector<Slice>* slices) const {
   slices->reserve(slices->size() + 2 + sidecars_.size());
   slices->push_back(Slice(response_hdr_buf_));
   slices->push_back(Slice(response_msg_buf_));
+  if (response_compressed_) {
+    return;
+  }
   for (RpcSidecar* car : sidecars_) {
     slices->push_back(car->AsSlice());
   }
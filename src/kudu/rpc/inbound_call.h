@@ -105,8 +105,12 @@ class InboundCall {
   //
   // This method deletes the InboundCall object, so no further calls may be
   // made after this one.
+  //
+  // If initialized, 'retry_after' is sent back as the delay the client should
+  // wait for before retrying.
   void RespondFailure(ErrorStatusPB::RpcErrorCodePB error_code,
-                      const Status &status);
+                      const Status &status,
+                      const MonoDelta& retry_after = MonoDelta());
 
   void RespondUnsupportedFeature(const std::vector<uint32_t>& unsupported_features);
 
@@ -158,6 +162,9 @@ class InboundCall {
   RpcMethodInfo* method_info() {
     return method_info_.get();
   }
+  const RpcMethodInfo* method_info() const {
+    return method_info_.get();
+  }
 
   // When this InboundCall was received (instantiated).
   // Should only be called once on a given instance.
@@ -221,10 +228,18 @@ class InboundCall {
   // by 'serialized_request_' above.
   gscoped_ptr<InboundTransfer> transfer_;
 
+  // If the request body was compressed, the decompressed body, which
+  // 'serialized_request_' refers into instead.
+  faststring decompressed_request_;
+
   // The buffers for serialized response. Set by SerializeResponseBuffer().
   faststring response_hdr_buf_;
   faststring response_msg_buf_;
 
+  // Whether 'response_msg_buf_' holds the compressed protobuf and sidecars,
+  // in which case the sidecars are not sent separately.
+  bool response_compressed_;
+
   // Vector of additional sidecars that are tacked on to the call's response
   // after serialization of the protobuf. See rpc/rpc_sidecar.h for more info.
   std::vector<RpcSidecar*> sidecars_;
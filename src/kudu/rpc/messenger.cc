@@ -22,6 +22,7 @@
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <gflags/gflags.h>
 #include <glog/logging.h>
 #include <list>
@@ -34,6 +35,7 @@
 #include "kudu/gutil/stl_util.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/rpc/acceptor_pool.h"
+#include "kudu/rpc/call_breakdown.h"
 #include "kudu/rpc/connection.h"
 #include "kudu/rpc/constants.h"
 #include "kudu/rpc/reactor.h"
@@ -46,6 +48,7 @@
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/metrics.h"
 #include "kudu/util/monotime.h"
+#include "kudu/util/net/net_util.h"
 #include "kudu/util/net/socket.h"
 #include "kudu/util/status.h"
 #include "kudu/util/threadpool.h"
@@ -53,6 +56,7 @@
 
 using std::string;
 using std::shared_ptr;
+using std::vector;
 using strings::Substitute;
 
 DEFINE_int32(rpc_default_keepalive_time_ms, 65000,
@@ -60,6 +64,20 @@ DEFINE_int32(rpc_default_keepalive_time_ms, 65000,
              "will disconnect the client.");
 TAG_FLAG(rpc_default_keepalive_time_ms, advanced);
 
+DEFINE_int32(rpc_num_connections_per_peer, 1,
+             "The number of connections that a messenger opens to each remote, spread "
+             "across its reactor threads. Raising it lets traffic to a single busy peer, "
+             "such as a follower being replicated to, use more than one reactor thread.");
+TAG_FLAG(rpc_num_connections_per_peer, advanced);
+TAG_FLAG(rpc_num_connections_per_peer, experimental);
+
+DEFINE_bool(rpc_compression_enabled, false,
+            "Whether proxies created on a messenger compress large request bodies and "
+            "ask servers to compress large responses, when the remote supports it. "
+            "Trades CPU for network bandwidth; useful across slow links.");
+TAG_FLAG(rpc_compression_enabled, advanced);
+TAG_FLAG(rpc_compression_enabled, experimental);
+
 namespace kudu {
 namespace rpc {
 
@@ -72,6 +90,8 @@ MessengerBuilder::MessengerBuilder(std::string name)
           MonoDelta::FromMilliseconds(FLAGS_rpc_default_keepalive_time_ms)),
       num_reactors_(4),
       num_negotiation_threads_(4),
+      num_connections_per_peer_(FLAGS_rpc_num_connections_per_peer),
+      compression_enabled_(FLAGS_rpc_compression_enabled),
       coarse_timer_granularity_(MonoDelta::FromMilliseconds(100)) {}
 
 MessengerBuilder& MessengerBuilder::set_connection_keepalive_time(const MonoDelta &keepalive) {
@@ -89,6 +109,16 @@ MessengerBuilder& MessengerBuilder::set_negotiation_threads(int num_negotiation_
   return *this;
 }
 
+MessengerBuilder& MessengerBuilder::set_num_connections_per_peer(int num_connections_per_peer) {
+  num_connections_per_peer_ = num_connections_per_peer;
+  return *this;
+}
+
+MessengerBuilder& MessengerBuilder::set_compression_enabled(bool enabled) {
+  compression_enabled_ = enabled;
+  return *this;
+}
+
 MessengerBuilder& MessengerBuilder::set_coarse_timer_granularity(const MonoDelta &granularity) {
   coarse_timer_granularity_ = granularity;
   return *this;
@@ -163,6 +193,9 @@ Status Messenger::AddAcceptorPool(const Sockaddr &accept_addr,
   Socket sock;
   RETURN_NOT_OK(sock.Init(0));
   RETURN_NOT_OK(sock.SetReuseAddr(true));
+  if (AcceptorPool::PerReactorAcceptEnabled()) {
+    RETURN_NOT_OK(sock.SetReusePort(true));
+  }
   RETURN_NOT_OK(sock.Bind(accept_addr));
   Sockaddr remote;
   RETURN_NOT_OK(sock.GetSocketAddress(&remote));
@@ -204,10 +237,21 @@ Status Messenger::UnregisterService(const string& service_name) {
 }
 
 void Messenger::QueueOutboundCall(const shared_ptr<OutboundCall> &call) {
-  Reactor *reactor = RemoteToReactor(call->conn_id().remote());
+  Reactor *reactor = RemoteToReactor(call->conn_id().remote(), call->conn_id().conn_idx());
   reactor->QueueOutboundCall(call);
 }
 
+void Messenger::WarmUpConnections(const vector<Sockaddr>& remotes,
+                                  const UserCredentials& user_credentials) {
+  for (const Sockaddr& remote : remotes) {
+    ConnectionId conn_id(remote, user_credentials);
+    for (int idx = 0; idx < num_connections_per_peer_; idx++) {
+      conn_id.set_conn_idx(idx);
+      RemoteToReactor(remote, idx)->WarmUpConnection(conn_id);
+    }
+  }
+}
+
 void Messenger::QueueInboundCall(gscoped_ptr<InboundCall> call) {
   shared_lock<rw_spinlock> guard(lock_.get_lock());
   scoped_refptr<RpcService>* service = FindOrNull(rpc_services_,
@@ -227,14 +271,18 @@ void Messenger::QueueInboundCall(gscoped_ptr<InboundCall> call) {
 }
 
 void Messenger::RegisterInboundSocket(Socket *new_socket, const Sockaddr &remote) {
-  Reactor *reactor = RemoteToReactor(remote);
+  Reactor *reactor = RemoteToReactor(remote, 0);
   reactor->RegisterInboundSocket(new_socket, remote);
 }
 
 Messenger::Messenger(const MessengerBuilder &bld)
   : name_(bld.name_),
     closing_(false),
+    num_connections_per_peer_(std::max(bld.num_connections_per_peer_, 1)),
+    compression_enabled_(bld.compression_enabled_),
+    next_conn_idx_(0),
     rpcz_store_(new RpczStore()),
+    call_breakdown_store_(new CallBreakdownStore(bld.num_reactors_)),
     metric_entity_(bld.metric_entity_),
     retain_self_(this) {
   for (int i = 0; i < bld.num_reactors_; i++) {
@@ -251,17 +299,30 @@ Messenger::~Messenger() {
   STLDeleteElements(&reactors_);
 }
 
-Reactor* Messenger::RemoteToReactor(const Sockaddr &remote) {
+Reactor* Messenger::RemoteToReactor(const Sockaddr &remote, int conn_idx) {
   uint32_t hashCode = remote.HashCode();
-  int reactor_idx = hashCode % reactors_.size();
+  // Consecutive connections to the same remote go to consecutive reactors.
+  int reactor_idx = (hashCode + conn_idx) % reactors_.size();
   // This is just a static partitioning; we could get a lot
   // fancier with assigning Sockaddrs to Reactors.
   return reactors_[reactor_idx];
 }
 
 
+int Messenger::NextConnectionIdx() {
+  if (num_connections_per_peer_ == 1) {
+    return 0;
+  }
+  return next_conn_idx_.Increment() % num_connections_per_peer_;
+}
+
 Status Messenger::Init() {
   Status status;
+  vector<Sockaddr> local_addresses;
+  WARN_NOT_OK(GetLocalAddresses(&local_addresses),
+              "Unable to determine the local addresses, only connections to the "
+              "loopback address may use the local transport");
+  local_addresses_.insert(local_addresses.begin(), local_addresses.end());
   for (Reactor* r : reactors_) {
     RETURN_NOT_OK(r->Init());
   }
@@ -269,6 +330,11 @@ Status Messenger::Init() {
   return Status::OK();
 }
 
+bool Messenger::IsLocalAddress(const Sockaddr& addr) const {
+  return addr.IsWildcard() || addr.IsAnyLocalAddress() ||
+      ContainsKey(local_addresses_, addr);
+}
+
 Status Messenger::DumpRunningRpcs(const DumpRunningRpcsRequestPB& req,
                                   DumpRunningRpcsResponsePB* resp) {
   shared_lock<rw_spinlock> guard(lock_.get_lock());
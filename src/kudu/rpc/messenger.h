@@ -22,6 +22,7 @@
 #include <unordered_map>
 
 #include <list>
+#include <set>
 #include <string>
 #include <vector>
 
@@ -30,6 +31,7 @@
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/rpc/response_callback.h"
+#include "kudu/util/atomic.h"
 #include "kudu/util/locks.h"
 #include "kudu/util/metrics.h"
 #include "kudu/util/monotime.h"
@@ -44,6 +46,7 @@ class ThreadPool;
 namespace rpc {
 
 class AcceptorPool;
+class CallBreakdownStore;
 class DumpRunningRpcsRequestPB;
 class DumpRunningRpcsResponsePB;
 class InboundCall;
@@ -53,6 +56,7 @@ class Reactor;
 class ReactorThread;
 class RpcService;
 class RpczStore;
+class UserCredentials;
 
 struct AcceptorPoolInfo {
  public:
@@ -92,6 +96,16 @@ class MessengerBuilder {
   // Set metric entity for use by RPC systems.
   MessengerBuilder &set_metric_entity(const scoped_refptr<MetricEntity>& metric_entity);
 
+  // Set the number of connections to open to each remote. Outbound calls
+  // are spread across them round-robin, and the connections across the
+  // reactor threads, so that traffic to a single busy peer isn't limited
+  // to one reactor thread.
+  MessengerBuilder &set_num_connections_per_peer(int num_connections_per_peer);
+
+  // Set whether proxies using this messenger compress calls by default.
+  // See Proxy::set_compression_enabled().
+  MessengerBuilder &set_compression_enabled(bool enabled);
+
   Status Build(std::shared_ptr<Messenger> *msgr);
 
  private:
@@ -100,6 +114,8 @@ class MessengerBuilder {
   MonoDelta connection_keepalive_time_;
   int num_reactors_;
   int num_negotiation_threads_;
+  int num_connections_per_peer_;
+  bool compression_enabled_;
   MonoDelta coarse_timer_granularity_;
   scoped_refptr<MetricEntity> metric_entity_;
 };
@@ -116,6 +132,7 @@ class MessengerBuilder {
 // See rpc-test.cc and rpc-bench.cc for example usages.
 class Messenger {
  public:
+  friend class AcceptorPool;
   friend class MessengerBuilder;
   friend class Proxy;
   friend class Reactor;
@@ -156,6 +173,18 @@ class Messenger {
   // and enqueue a task on that reactor to assign and send the call.
   void QueueOutboundCall(const std::shared_ptr<OutboundCall> &call);
 
+  // Start connecting and negotiating with each of 'remotes' as 'user_credentials',
+  // so that the first calls to them don't wait on connection setup. Useful when
+  // a caller knows in advance which servers it will talk to, for example the
+  // replicas of the tablets it is about to write to. Remotes which already
+  // have connections are skipped. Connection failures are logged but not
+  // returned; calls made later will retry the connection as usual.
+  //
+  // Connections are keyed by credentials, so 'user_credentials' must match
+  // those of the proxies which will use them (see Proxy::WarmUpConnection()).
+  void WarmUpConnections(const std::vector<Sockaddr>& remotes,
+                         const UserCredentials& user_credentials);
+
   // Enqueue a call for processing on the server.
   void QueueInboundCall(gscoped_ptr<InboundCall> call);
 
@@ -177,8 +206,16 @@ class Messenger {
 
   RpczStore* rpcz_store() { return rpcz_store_.get(); }
 
+  CallBreakdownStore* call_breakdown_store() { return call_breakdown_store_.get(); }
+
   int num_reactors() const { return reactors_.size(); }
 
+  // Whether proxies using this messenger compress calls by default.
+  bool compression_enabled() const { return compression_enabled_; }
+
+  // Whether 'addr' is an address of the local host, ignoring its port.
+  bool IsLocalAddress(const Sockaddr& addr) const;
+
   std::string name() const {
     return name_;
   }
@@ -193,11 +230,20 @@ class Messenger {
   const scoped_refptr<RpcService> rpc_service(const std::string& service_name) const;
 
  private:
+  FRIEND_TEST(TestRpc, TestCallFromReactorThread);
+  FRIEND_TEST(TestRpc, TestConnectionFanOut);
   FRIEND_TEST(TestRpc, TestConnectionKeepalive);
+  FRIEND_TEST(TestRpc, TestConnectionWarmUp);
+  FRIEND_TEST(TestRpc, TestReusePortAcceptors);
 
   explicit Messenger(const MessengerBuilder &bld);
 
-  Reactor* RemoteToReactor(const Sockaddr &remote);
+  // Returns the reactor that handles the connection to 'remote' with the
+  // given index. See ConnectionId::conn_idx().
+  Reactor* RemoteToReactor(const Sockaddr &remote, int conn_idx);
+
+  // Returns the connection index to use for the next outbound call.
+  int NextConnectionIdx();
   Status Init();
   void RunTimeoutThread();
   void UpdateCurTime();
@@ -224,10 +270,25 @@ class Messenger {
 
   std::vector<Reactor*> reactors_;
 
+  // See MessengerBuilder::set_num_connections_per_peer().
+  const int num_connections_per_peer_;
+
+  // Used to spread outbound calls across connections.
+  AtomicInt<uint32_t> next_conn_idx_;
+
+  // See MessengerBuilder::set_compression_enabled().
+  const bool compression_enabled_;
+
+  // The addresses of the network interfaces of the host, set by Init().
+  // Sockaddr ordering ignores ports.
+  std::set<Sockaddr> local_addresses_;
+
   gscoped_ptr<ThreadPool> negotiation_pool_;
 
   std::unique_ptr<RpczStore> rpcz_store_;
 
+  std::unique_ptr<CallBreakdownStore> call_breakdown_store_;
+
   scoped_refptr<MetricEntity> metric_entity_;
 
   // The ownership of the Messenger object is somewhat subtle. The pointer graph
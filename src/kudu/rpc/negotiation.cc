@@ -50,6 +50,14 @@ DEFINE_int32(rpc_negotiation_inject_delay_ms, 0,
              "the RPC negotiation process on the server side.");
 TAG_FLAG(rpc_negotiation_inject_delay_ms, unsafe);
 
+DEFINE_bool(rpc_negotiation_optimistic_plain, true,
+            "If enabled, clients send their PLAIN authentication request together "
+            "with the initial SASL NEGOTIATE request rather than waiting for the "
+            "server's list of mechanisms, saving a round trip on each new connection. "
+            "Should be disabled when connecting to servers which do not offer PLAIN.");
+TAG_FLAG(rpc_negotiation_optimistic_plain, advanced);
+TAG_FLAG(rpc_negotiation_optimistic_plain, runtime);
+
 namespace kudu {
 namespace rpc {
 
@@ -190,6 +198,7 @@ static Status DoClientNegotiation(Connection* conn,
   RETURN_NOT_OK(conn->SetNonBlocking(false));
   RETURN_NOT_OK(conn->InitSaslClient());
   conn->sasl_client().set_deadline(deadline);
+  conn->sasl_client().set_optimistic_plain(FLAGS_rpc_negotiation_optimistic_plain);
   RETURN_NOT_OK(conn->sasl_client().Negotiate());
   RETURN_NOT_OK(SendConnectionContext(conn, deadline));
   RETURN_NOT_OK(DisableSocketTimeouts(conn));
@@ -18,6 +18,7 @@
 #include <algorithm>
 #include <boost/functional/hash.hpp>
 #include <gflags/gflags.h>
+#include <google/protobuf/io/coded_stream.h>
 #include <mutex>
 #include <set>
 #include <string>
@@ -34,10 +35,12 @@
 #include "kudu/rpc/transfer.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/kernel_stack_watchdog.h"
+#include "kudu/util/logging.h"
 
 namespace kudu {
 namespace rpc {
 
+using google::protobuf::io::CodedInputStream;
 using google::protobuf::io::CodedOutputStream;
 using google::protobuf::Message;
 using std::set;
@@ -68,7 +71,8 @@ OutboundCall::OutboundCall(const ConnectionId& conn_id,
       conn_id_(conn_id),
       callback_(std::move(callback)),
       controller_(DCHECK_NOTNULL(controller)),
-      response_(DCHECK_NOTNULL(response_storage)) {
+      response_(DCHECK_NOTNULL(response_storage)),
+      compression_enabled_(false) {
   DVLOG(4) << "OutboundCall " << this << " constructed with state_: " << StateName(state_)
            << " and RPC timeout: "
            << (controller->timeout().Initialized() ? controller->timeout().ToString() : "none");
@@ -90,12 +94,19 @@ OutboundCall::~OutboundCall() {
   DVLOG(4) << "OutboundCall " << this << " destroyed with state_: " << StateName(state_);
 }
 
-Status OutboundCall::SerializeTo(vector<Slice>* slices) {
-  size_t param_len = request_buf_.size();
-  if (PREDICT_FALSE(param_len == 0)) {
+Status OutboundCall::SerializeTo(vector<Slice>* slices, bool peer_accepts_compression) {
+  if (PREDICT_FALSE(request_buf_.size() == 0)) {
     return Status::InvalidArgument("Must call SetRequestParam() before SerializeTo()");
   }
 
+  if (compression_enabled_) {
+    header_.set_compress_response(true);
+    if (peer_accepts_compression && !header_.has_uncompressed_body_size()) {
+      CompressRequestBody();
+    }
+  }
+  size_t param_len = request_buf_.size();
+
   const MonoDelta &timeout = controller_->timeout();
   if (timeout.Initialized()) {
     header_.set_timeout_millis(timeout.ToMilliseconds());
@@ -113,8 +124,38 @@ Status OutboundCall::SerializeTo(vector<Slice>* slices) {
   return Status::OK();
 }
 
+void OutboundCall::CompressRequestBody() {
+  // Strip the length prefix written by SerializeMessage(); CompressBody()
+  // writes a new one for the compressed data.
+  CodedInputStream in(request_buf_.data(), request_buf_.size());
+  uint32_t body_len;
+  CHECK(in.ReadVarint32(&body_len));
+  DCHECK_EQ(body_len + in.CurrentPosition(), request_buf_.size());
+  if (!serialization::ShouldCompressBody(body_len)) {
+    return;
+  }
+  faststring compressed;
+  Slice body(request_buf_.data() + in.CurrentPosition(), body_len);
+  if (serialization::CompressBody({ body }, &compressed)) {
+    header_.set_uncompressed_body_size(body_len);
+    request_buf_.assign_copy(compressed.data(), compressed.size());
+  }
+}
+
 void OutboundCall::SetRequestParam(const Message& message) {
-  serialization::SerializeMessage(message, &request_buf_);
+  std::vector<Slice>& extra_fields = controller_->serialized_request_fields_;
+  size_t extra_size = 0;
+  for (const Slice& field : extra_fields) {
+    extra_size += field.size();
+  }
+  serialization::SerializeMessage(message, &request_buf_, extra_size);
+  if (extra_size > 0) {
+    request_buf_.reserve(request_buf_.size() + extra_size);
+    for (const Slice& field : extra_fields) {
+      request_buf_.append(field.data(), field.size());
+    }
+  }
+  extra_fields.clear();
 }
 
 Status OutboundCall::status() const {
@@ -199,8 +240,9 @@ void OutboundCall::CallCallback() {
     double micros = static_cast<double>(wait_cycles) / base::CyclesPerSecond()
       * kMicrosPerSecond;
 
-    LOG(WARNING) << "RPC callback for " << ToString() << " blocked reactor thread for "
-                 << micros << "us";
+    KLOG_EVERY_N_SECS(WARNING, 1) << "RPC callback for " << ToString()
+                                  << " blocked reactor thread for " << micros << "us"
+                                  << THROTTLE_MSG;
   }
 }
 
@@ -382,13 +424,16 @@ bool UserCredentials::Equals(const UserCredentials& other) const {
 /// ConnectionId
 ///
 
-ConnectionId::ConnectionId() {}
+ConnectionId::ConnectionId()
+    : conn_idx_(0) {
+}
 
 ConnectionId::ConnectionId(const ConnectionId& other) {
   DoCopyFrom(other);
 }
 
-ConnectionId::ConnectionId(const Sockaddr& remote, const UserCredentials& user_credentials) {
+ConnectionId::ConnectionId(const Sockaddr& remote, const UserCredentials& user_credentials)
+    : conn_idx_(0) {
   remote_ = remote;
   user_credentials_.CopyFrom(user_credentials);
 }
@@ -407,26 +452,34 @@ void ConnectionId::CopyFrom(const ConnectionId& other) {
 
 string ConnectionId::ToString() const {
   // Does not print the password.
-  return StringPrintf("{remote=%s, user_credentials=%s}",
+  string ret = StringPrintf("{remote=%s, user_credentials=%s",
       remote_.ToString().c_str(),
       user_credentials_.ToString().c_str());
+  if (conn_idx_ != 0) {
+    StringAppendF(&ret, ", conn_idx=%d", conn_idx_);
+  }
+  ret += "}";
+  return ret;
 }
 
 void ConnectionId::DoCopyFrom(const ConnectionId& other) {
   remote_ = other.remote_;
   user_credentials_.CopyFrom(other.user_credentials_);
+  conn_idx_ = other.conn_idx_;
 }
 
 size_t ConnectionId::HashCode() const {
   size_t seed = 0;
   boost::hash_combine(seed, remote_.HashCode());
   boost::hash_combine(seed, user_credentials_.HashCode());
+  boost::hash_combine(seed, conn_idx_);
   return seed;
 }
 
 bool ConnectionId::Equals(const ConnectionId& other) const {
   return (remote() == other.remote()
-       && user_credentials().Equals(other.user_credentials()));
+       && user_credentials().Equals(other.user_credentials())
+       && conn_idx() == other.conn_idx());
 }
 
 size_t ConnectionIdHash::operator() (const ConnectionId& conn_id) const {
@@ -460,6 +513,12 @@ Status CallResponse::ParseFrom(gscoped_ptr<InboundTransfer> transfer) {
   Slice entire_message;
   RETURN_NOT_OK(serialization::ParseMessage(transfer->data(), &header_,
                                             &entire_message));
+  if (header_.has_uncompressed_body_size()) {
+    RETURN_NOT_OK(serialization::DecompressBody(entire_message,
+                                                header_.uncompressed_body_size(),
+                                                &decompressed_body_));
+    entire_message = Slice(decompressed_body_.data(), decompressed_body_.size());
+  }
 
   // Use information from header to extract the payload slices.
   int last = header_.sidecar_offsets_size() - 1;
@@ -30,6 +30,7 @@
 #include "kudu/rpc/remote_method.h"
 #include "kudu/rpc/response_callback.h"
 #include "kudu/rpc/transfer.h"
+#include "kudu/util/faststring.h"
 #include "kudu/util/locks.h"
 #include "kudu/util/monotime.h"
 #include "kudu/util/net/sockaddr.h"
@@ -117,6 +118,11 @@ class ConnectionId {
   const UserCredentials& user_credentials() const { return user_credentials_; }
   UserCredentials* mutable_user_credentials() { return &user_credentials_; }
 
+  // Which of the connections to the remote to use, when the messenger keeps
+  // several of them. See MessengerBuilder::set_num_connections_per_peer().
+  void set_conn_idx(int conn_idx) { conn_idx_ = conn_idx; }
+  int conn_idx() const { return conn_idx_; }
+
   // Copy state from another object to this one.
   void CopyFrom(const ConnectionId& other);
 
@@ -130,6 +136,7 @@ class ConnectionId {
   // Remember to update HashCode() and Equals() when new fields are added.
   Sockaddr remote_;
   UserCredentials user_credentials_;
+  int conn_idx_;
 
   // Implementation of CopyFrom that can be shared with copy constructor.
   void DoCopyFrom(const ConnectionId& other);
@@ -178,9 +185,20 @@ class OutboundCall {
     header_.set_call_id(call_id);
   }
 
+  // Whether to compress this call's request and ask for its response to be
+  // compressed. See Proxy::set_compression_enabled(). Must be called before
+  // SerializeTo().
+  void set_compression_enabled(bool enabled) {
+    compression_enabled_ = enabled;
+  }
+
   // Serialize the call for the wire. Requires that SetRequestParam()
   // is called first. This is called from the Reactor thread.
-  Status SerializeTo(std::vector<Slice>* slices);
+  //
+  // If 'peer_accepts_compression' is true, the remote has advertised the
+  // COMPRESSED_BODIES feature, and the request body is compressed if
+  // compression is enabled for the call and the body is large enough.
+  Status SerializeTo(std::vector<Slice>* slices, bool peer_accepts_compression);
 
   // Callback after the call has been put on the outbound connection queue.
   void SetQueued();
@@ -261,6 +279,10 @@ class OutboundCall {
   // return current status
   Status status() const;
 
+  // Replace 'request_buf_' with a compressed copy of the request body, and
+  // record that in 'header_', if the body is large enough and compresses.
+  void CompressRequestBody();
+
   // Time when the call was first initiatied.
   MonoTime start_time_;
 
@@ -297,6 +319,9 @@ class OutboundCall {
   // Pointer for the protobuf where the response should be written.
   google::protobuf::Message* response_;
 
+  // See set_compression_enabled().
+  bool compression_enabled_;
+
   // Buffers for storing segments of the wire-format request.
   faststring header_buf_;
   faststring request_buf_;
@@ -364,6 +389,10 @@ class CallResponse {
   // and sidecar_slices_ refer into its data.
   gscoped_ptr<InboundTransfer> transfer_;
 
+  // If the response body was compressed, the decompressed body, which
+  // serialized_response_ and sidecar_slices_ refer into instead.
+  faststring decompressed_body_;
+
   DISALLOW_COPY_AND_ASSIGN(CallResponse);
 };
 
@@ -51,8 +51,10 @@ Proxy::Proxy(const std::shared_ptr<Messenger>& messenger,
              const Sockaddr& remote, string service_name)
     : service_name_(std::move(service_name)),
       messenger_(messenger),
+      compression_enabled_(false),
       is_started_(false) {
   CHECK(messenger != nullptr);
+  compression_enabled_ = messenger->compression_enabled();
   DCHECK(!service_name_.empty()) << "Proxy service name must not be blank";
 
   // By default, we set the real user to the currently logged-in user.
@@ -79,8 +81,11 @@ void Proxy::AsyncRequest(const string& method,
   CHECK(controller->call_.get() == nullptr) << "Controller should be reset";
   base::subtle::NoBarrier_Store(&is_started_, true);
   RemoteMethod remote_method(service_name_, method);
-  OutboundCall* call = new OutboundCall(conn_id_, remote_method, response, controller, callback);
+  ConnectionId conn_id(conn_id_);
+  conn_id.set_conn_idx(messenger_->NextConnectionIdx());
+  OutboundCall* call = new OutboundCall(conn_id, remote_method, response, controller, callback);
   controller->call_.reset(call);
+  call->set_compression_enabled(compression_enabled_);
   call->SetRequestParam(req);
 
   // If this fails to queue, the callback will get called immediately
@@ -89,6 +94,11 @@ void Proxy::AsyncRequest(const string& method,
 }
 
 
+void Proxy::WarmUpConnection() const {
+  base::subtle::NoBarrier_Store(&is_started_, true);
+  messenger_->WarmUpConnections({ conn_id_.remote() }, conn_id_.user_credentials());
+}
+
 Status Proxy::SyncRequest(const string& method,
                           const google::protobuf::Message& req,
                           google::protobuf::Message* resp,
@@ -101,6 +111,12 @@ Status Proxy::SyncRequest(const string& method,
   return controller->status();
 }
 
+void Proxy::set_compression_enabled(bool enabled) {
+  CHECK(base::subtle::NoBarrier_Load(&is_started_) == false)
+    << "It is illegal to call set_compression_enabled() after request processing has started";
+  compression_enabled_ = enabled;
+}
+
 void Proxy::set_user_credentials(const UserCredentials& user_credentials) {
   CHECK(base::subtle::NoBarrier_Load(&is_started_) == false)
     << "It is illegal to call set_user_credentials() after request processing has started";
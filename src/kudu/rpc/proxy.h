@@ -98,6 +98,19 @@ class Proxy {
                      google::protobuf::Message* resp,
                      RpcController* controller) const;
 
+  // Start establishing the connection to the remote ahead of the first call.
+  // See Messenger::WarmUpConnections(). Like a call, this fixes the
+  // proxy's user credentials.
+  void WarmUpConnection() const;
+
+  // Set whether calls made through this proxy compress their request bodies
+  // and ask for their responses to be compressed. Only bodies of at least
+  // --rpc_compression_min_bytes are compressed, and only when the remote
+  // supports it. Defaults to the messenger's setting.
+  //
+  // It is illegal to call this after request processing has started.
+  void set_compression_enabled(bool enabled);
+
   // Set the user credentials which should be used to log in.
   void set_user_credentials(const UserCredentials& user_credentials);
 
@@ -110,6 +123,7 @@ class Proxy {
   const std::string service_name_;
   std::shared_ptr<Messenger> messenger_;
   ConnectionId conn_id_;
+  bool compression_enabled_;
   mutable Atomic32 is_started_;
 
   DISALLOW_COPY_AND_ASSIGN(Proxy);
@@ -28,9 +28,11 @@
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <unistd.h>
+#include <vector>
 
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/gutil/stringprintf.h"
+#include "kudu/rpc/acceptor_pool.h"
 #include "kudu/rpc/connection.h"
 #include "kudu/rpc/messenger.h"
 #include "kudu/rpc/negotiation.h"
@@ -43,6 +45,7 @@
 #include "kudu/util/errno.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/monotime.h"
+#include "kudu/util/numa.h"
 #include "kudu/util/thread.h"
 #include "kudu/util/threadpool.h"
 #include "kudu/util/thread_restrictions.h"
@@ -61,12 +64,19 @@ static const int kDefaultLibEvFlags = ev::AUTO;
 
 using std::string;
 using std::shared_ptr;
+using std::vector;
 
 DEFINE_int64(rpc_negotiation_timeout_ms, 3000,
              "Timeout for negotiating an RPC connection.");
 TAG_FLAG(rpc_negotiation_timeout_ms, advanced);
 TAG_FLAG(rpc_negotiation_timeout_ms, runtime);
 
+DEFINE_bool(rpc_connect_to_local_socket, true,
+            "Whether connections to RPC servers running on the same host are made "
+            "over the Unix domain socket they listen on with "
+            "--rpc_listen_on_local_socket, if any, rather than over TCP.");
+TAG_FLAG(rpc_connect_to_local_socket, advanced);
+
 namespace kudu {
 namespace rpc {
 
@@ -303,6 +313,7 @@ void ReactorThread::RunThread() {
   ThreadRestrictions::SetWaitAllowed(false);
   ThreadRestrictions::SetIOAllowed(false);
   DVLOG(6) << "Calling ReactorThread::RunThread()...";
+  MaybeBindThreadToNumaNode("reactor", reactor_->index());
   loop_.run(0);
   VLOG(1) << name() << " thread exiting.";
 
@@ -326,13 +337,16 @@ Status ReactorThread::FindOrStartConnection(const ConnectionId &conn_id,
 
   // Create a new socket and start connecting to the remote.
   Socket sock;
-  RETURN_NOT_OK(CreateClientSocket(&sock));
-  bool connect_in_progress;
-  RETURN_NOT_OK(StartConnect(&sock, conn_id.remote(), &connect_in_progress));
+  if (!ConnectLocalSocket(&sock, conn_id.remote())) {
+    RETURN_NOT_OK(CreateClientSocket(&sock));
+    bool connect_in_progress;
+    RETURN_NOT_OK(StartConnect(&sock, conn_id.remote(), &connect_in_progress));
+  }
 
   // Register the new connection in our map.
   *conn = new Connection(this, conn_id.remote(), sock.Release(), Connection::CLIENT);
   (*conn)->set_user_credentials(conn_id.user_credentials());
+  (*conn)->set_conn_idx(conn_id.conn_idx());
 
   // Kick off blocking client connection negotiation.
   Status s = StartConnectionNegotiation(*conn);
@@ -394,6 +408,32 @@ Status ReactorThread::CreateClientSocket(Socket *sock) {
   return ret;
 }
 
+bool ReactorThread::ConnectLocalSocket(Socket* sock, const Sockaddr& remote) {
+  if (!FLAGS_rpc_connect_to_local_socket || !reactor_->messenger()->IsLocalAddress(remote)) {
+    return false;
+  }
+  // A server bound to the wildcard address names its socket after it.
+  Sockaddr wildcard;
+  wildcard.set_port(remote.port());
+  vector<Sockaddr> names = { remote };
+  if (!remote.IsWildcard()) {
+    names.push_back(wildcard);
+  }
+  for (const Sockaddr& addr : names) {
+    // Connecting to a Unix domain socket doesn't block: it either succeeds
+    // right away, or fails if nothing listens on it or its backlog is full.
+    Socket local_sock;
+    if (local_sock.InitUnixDomain(Socket::FLAG_NONBLOCKING).ok() &&
+        local_sock.ConnectAbstract(LocalSocketName(addr)).ok()) {
+      VLOG(2) << name() << ": connected to " << remote.ToString()
+              << " over its local socket";
+      sock->Reset(local_sock.Release());
+      return true;
+    }
+  }
+  return false;
+}
+
 Status ReactorThread::StartConnect(Socket *sock, const Sockaddr &remote, bool *in_progress) {
   Status ret = sock->Connect(remote);
   if (ret.ok()) {
@@ -419,11 +459,13 @@ void ReactorThread::DestroyConnection(Connection *conn,
                                       const Status &conn_status) {
   DCHECK(IsCurrentThread());
 
-  conn->Shutdown(conn_status);
-
-  // Unlink connection from lists.
+  // Unlink the connection from the lists before shutting it down: failing its
+  // calls runs their callbacks, which may queue new calls to the same remote
+  // inline, and those should get a new connection.
+  scoped_refptr<Connection> conn_ref(conn);
   if (conn->direction() == Connection::CLIENT) {
     ConnectionId conn_id(conn->remote(), conn->user_credentials());
+    conn_id.set_conn_idx(conn->conn_idx());
     auto it = client_conns_.find(conn_id);
     CHECK(it != client_conns_.end()) << "Couldn't find connection " << conn->ToString();
     client_conns_.erase(it);
@@ -437,6 +479,8 @@ void ReactorThread::DestroyConnection(Connection *conn,
       ++it;
     }
   }
+
+  conn->Shutdown(conn_status);
 }
 
 DelayedTask::DelayedTask(boost::function<void(const Status &)> func,
@@ -479,6 +523,7 @@ Reactor::Reactor(const shared_ptr<Messenger>& messenger,
                  int index, const MessengerBuilder &bld)
   : messenger_(messenger),
     name_(StringPrintf("%s_R%03d", messenger->name().c_str(), index)),
+    index_(index),
     closing_(false),
     thread_(this, bld) {
 }
@@ -555,6 +600,10 @@ Status Reactor::GetMetrics(ReactorMetrics *metrics) {
 }
 
 Status Reactor::RunOnReactorThread(const boost::function<Status()>& f) {
+  // Waiting on a task queued from the reactor thread itself would deadlock.
+  if (IsCurrentThread()) {
+    return f();
+  }
   RunFunctionTask task(f);
   ScheduleReactorTask(&task);
   return task.Wait();
@@ -592,10 +641,19 @@ void Reactor::RegisterInboundSocket(Socket *socket, const Sockaddr &remote) {
   VLOG(3) << name_ << ": new inbound connection to " << remote.ToString();
   scoped_refptr<Connection> conn(
     new Connection(&thread_, remote, socket->Release(), Connection::SERVER));
+  if (IsCurrentThread() && !closing()) {
+    thread_.RegisterConnection(conn);
+    return;
+  }
   auto task = new RegisterConnectionTask(conn);
   ScheduleReactorTask(task);
 }
 
+void Reactor::RegisterIoWatcher(ev::io *watcher) {
+  DCHECK(IsCurrentThread());
+  watcher->set(thread_.loop_);
+}
+
 // Task which runs in the reactor thread to assign an outbound call
 // to a connection.
 class AssignOutboundCallTask : public ReactorTask {
@@ -617,14 +675,52 @@ class AssignOutboundCallTask : public ReactorTask {
   shared_ptr<OutboundCall> call_;
 };
 
+// Task which runs in the reactor thread to establish a connection ahead of
+// any calls being sent on it.
+class WarmUpConnectionTask : public ReactorTask {
+ public:
+  explicit WarmUpConnectionTask(const ConnectionId& conn_id)
+      : conn_id_(conn_id) {}
+
+  virtual void Run(ReactorThread *reactor) OVERRIDE {
+    scoped_refptr<Connection> conn;
+    Status s = reactor->FindOrStartConnection(conn_id_, &conn);
+    if (PREDICT_FALSE(!s.ok())) {
+      LOG(WARNING) << "Unable to pre-establish connection to "
+                   << conn_id_.remote().ToString() << ": " << s.ToString();
+    }
+    delete this;
+  }
+
+  virtual void Abort(const Status &status) OVERRIDE {
+    delete this;
+  }
+
+ private:
+  const ConnectionId conn_id_;
+};
+
+void Reactor::WarmUpConnection(const ConnectionId& conn_id) {
+  DVLOG(3) << name_ << ": warming up connection to " << conn_id.remote().ToString();
+  ScheduleReactorTask(new WarmUpConnectionTask(conn_id));
+}
+
 void Reactor::QueueOutboundCall(const shared_ptr<OutboundCall> &call) {
   DVLOG(3) << name_ << ": queueing outbound call "
            << call->ToString() << " to remote " << call->conn_id().remote().ToString();
+  // Calls made from the reactor thread, e.g. from the callback of a previous
+  // call, can be assigned right away without a round trip through the task
+  // queue.
+  if (IsCurrentThread() && !closing()) {
+    thread_.AssignOutboundCall(call);
+    return;
+  }
   AssignOutboundCallTask *task = new AssignOutboundCallTask(call);
   ScheduleReactorTask(task);
 }
 
 void Reactor::ScheduleReactorTask(ReactorTask *task) {
+  bool was_empty;
   {
     std::unique_lock<LockType> l(lock_);
     if (closing_) {
@@ -633,9 +729,15 @@ void Reactor::ScheduleReactorTask(ReactorTask *task) {
       task->Abort(ShutdownError(false));
       return;
     }
+    was_empty = pending_tasks_.empty();
     pending_tasks_.push_back(*task);
   }
-  thread_.WakeThread();
+  // The reactor thread drains the whole queue on each wakeup, so only the
+  // task which makes the queue non-empty needs to wake it. A burst of tasks
+  // scheduled before the reactor gets to them costs a single wakeup.
+  if (was_empty) {
+    thread_.WakeThread();
+  }
 }
 
 bool Reactor::DrainTaskQueue(boost::intrusive::list<ReactorTask> *tasks) { // NOLINT(*)
@@ -180,7 +180,9 @@ class ReactorThread {
 
  private:
   friend class AssignOutboundCallTask;
+  friend class Reactor;
   friend class RegisterConnectionTask;
+  friend class WarmUpConnectionTask;
   friend class DelayedTask;
 
   // Run the main event loop of the reactor.
@@ -212,6 +214,11 @@ class ReactorThread {
   // to true if the connection is still pending upon return.
   static Status StartConnect(Socket *sock, const Sockaddr &remote, bool *in_progress);
 
+  // Connects 'sock' to the Unix domain socket of the server at 'remote', if
+  // the server runs on this host and listens on one. Returns false if the
+  // connection should be made over TCP instead.
+  bool ConnectLocalSocket(Socket* sock, const Sockaddr& remote);
+
   // Assign a new outbound call to the appropriate connection object.
   // If this fails, the call is marked failed and completed.
   void AssignOutboundCall(const std::shared_ptr<OutboundCall> &call);
@@ -276,6 +283,9 @@ class Reactor {
 
   const std::string &name() const;
 
+  // The index of this reactor within its messenger.
+  int index() const { return index_; }
+
   // Collect metrics about the reactor.
   Status GetMetrics(ReactorMetrics *metrics);
 
@@ -286,12 +296,22 @@ class Reactor {
   // Queue a new incoming connection. Takes ownership of the underlying fd from
   // 'socket', but not the Socket object itself.
   // If the reactor is already shut down, takes care of closing the socket.
+  // Connections accepted on the reactor thread itself are registered inline.
   void RegisterInboundSocket(Socket *socket, const Sockaddr &remote);
 
+  // Attach 'watcher' to the event loop of the reactor thread. Does not start
+  // it. Must be called from the reactor thread.
+  void RegisterIoWatcher(ev::io *watcher);
+
   // Queue a new call to be sent. If the reactor is already shut down, marks
   // the call as failed.
   void QueueOutboundCall(const std::shared_ptr<OutboundCall> &call);
 
+  // Start connecting and negotiating with the remote of 'conn_id', unless a
+  // connection to it already exists. Failures are logged and otherwise
+  // ignored; a later call to the same remote retries the connection.
+  void WarmUpConnection(const ConnectionId& conn_id);
+
   // Schedule the given task's Run() method to be called on the
   // reactor thread.
   // If the reactor shuts down before it is run, the Abort method will be
@@ -330,6 +350,8 @@ class Reactor {
 
   const std::string name_;
 
+  const int index_;
+
   // Whether the reactor is shutting down.
   // Guarded by lock_.
   bool closing_;
@@ -49,6 +49,15 @@ DEFINE_int64(result_tracker_gc_interval_ms, 1000,
     "Interval at which the result tracker will look for entries to GC.");
 TAG_FLAG(result_tracker_gc_interval_ms, hidden);
 
+DEFINE_int64(result_tracker_memory_limit_mb, 256,
+    "Maximum amount of memory, in megabytes, used to remember clients and their "
+    "responses. Beyond it, the oldest responses of each client are forgotten before "
+    "'remember_responses_ttl_ms' elapses, and retries of the corresponding requests are "
+    "reported as STALE. Responses are also forgotten early if the memory limit of the "
+    "process is exceeded. A value of 0 or less means no limit.");
+TAG_FLAG(result_tracker_memory_limit_mb, advanced);
+TAG_FLAG(result_tracker_memory_limit_mb, runtime);
+
 namespace kudu {
 namespace rpc {
 
@@ -185,7 +194,7 @@ ResultTracker::RpcState ResultTracker::TrackRpcUnlocked(const RequestIdPB& reque
       // non-null) copy the response and reply immediately. If there is no context/response
       // do nothing.
       if (context != nullptr) {
-        DCHECK_NOTNULL(response)->CopyFrom(*completion_record->response);
+        CHECK(DCHECK_NOTNULL(response)->ParseFromString(completion_record->response));
         context->call_->RespondSuccess(*response);
         delete context;
       }
@@ -307,8 +316,8 @@ void ResultTracker::RecordCompletionAndRespond(const RequestIdPB& request_id,
     << " was not marked as the driver for the RPC. RequestId: " << request_id.ShortDebugString()
     << "\nTracker state:\n " << ToStringUnlocked();
   DCHECK_EQ(completion_record->state, RpcState::IN_PROGRESS);
-  completion_record->response.reset(DCHECK_NOTNULL(response)->New());
-  completion_record->response->CopyFrom(*response);
+  CHECK(DCHECK_NOTNULL(response)->SerializeToString(&completion_record->response));
+  completion_record->response.shrink_to_fit();
   completion_record->state = RpcState::COMPLETED;
   completion_record->last_updated = MonoTime::Now();
 
@@ -324,7 +333,7 @@ void ResultTracker::RecordCompletionAndRespond(const RequestIdPB& request_id,
     if (MustHandleRpc(handler_attempt_no, completion_record, ongoing_rpc)) {
       if (ongoing_rpc.context != nullptr) {
         if (PREDICT_FALSE(ongoing_rpc.response != response)) {
-          ongoing_rpc.response->CopyFrom(*completion_record->response);
+          ongoing_rpc.response->CopyFrom(*response);
         }
         LogAndTraceAndRespondSuccess(ongoing_rpc.context, *ongoing_rpc.response);
       }
@@ -403,10 +412,11 @@ void ResultTracker::FailAndRespond(const RequestIdPB& request_id, Message* respo
 }
 
 void ResultTracker::FailAndRespond(const RequestIdPB& request_id,
-                                   ErrorStatusPB_RpcErrorCodePB err, const Status& status) {
+                                   ErrorStatusPB_RpcErrorCodePB err, const Status& status,
+                                   const MonoDelta& retry_after) {
   auto func = [&](const OnGoingRpcInfo& ongoing_rpc) {
     LogAndTraceFailure(ongoing_rpc.context, err, status);
-    ongoing_rpc.context->call_->RespondFailure(err, status);
+    ongoing_rpc.context->call_->RespondFailure(err, status, retry_after);
   };
   FailAndRespondInternal(request_id, func);
 }
@@ -480,6 +490,40 @@ void ResultTracker::GCResults() {
       ++iter;
     }
   }
+
+  if (!MustEvictUnlocked()) {
+    return;
+  }
+  // Evict the responses which are older than half of their TTL, then half of that, and so on,
+  // until enough memory is freed. As with the TTL-based GC, only the oldest completed responses
+  // of each client are evicted, so that its 'stale_before_seq_no' watermark still tells apart
+  // the forgotten requests.
+  int64_t consumption_before = mem_tracker_->consumption();
+  for (int64_t keep_ms = FLAGS_remember_responses_ttl_ms / 2;; keep_ms /= 2) {
+    MonoTime time_to_evict_from = now;
+    time_to_evict_from.AddDelta(MonoDelta::FromMilliseconds(-keep_ms));
+    for (auto& client_state : clients_) {
+      client_state.second->GCCompletionRecords(
+          mem_tracker_,
+          [&] (SequenceNumber, CompletionRecord* completion_record) {
+            return completion_record->state != RpcState::IN_PROGRESS &&
+                !time_to_evict_from.ComesBefore(completion_record->last_updated);
+          });
+    }
+    if (keep_ms == 0 || !MustEvictUnlocked()) {
+      break;
+    }
+  }
+  LOG(INFO) << "Evicted responses using " << (consumption_before - mem_tracker_->consumption())
+            << " bytes from the result tracker due to memory pressure";
+}
+
+bool ResultTracker::MustEvictUnlocked() const {
+  if (FLAGS_result_tracker_memory_limit_mb > 0 &&
+      mem_tracker_->consumption() > FLAGS_result_tracker_memory_limit_mb * 1024 * 1024) {
+    return true;
+  }
+  return mem_tracker_->AnyLimitExceeded();
 }
 
 string ResultTracker::ToString() {
@@ -540,7 +584,8 @@ string ResultTracker::CompletionRecord::ToString() const {
                              "Cached response: $2, $3 OngoingRpcs:",
                              state,
                              driver_attempt_no,
-                             response ? response->ShortDebugString() : "None",
+                             state == RpcState::COMPLETED ?
+                                 Substitute("$0 bytes", response.size()) : "None",
                              ongoing_rpcs.size());
   for (auto& orpc : ongoing_rpcs) {
     SubstituteAndAppend(&result, Substitute("\n\t$0", orpc.ToString()));
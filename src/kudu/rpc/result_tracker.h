@@ -215,7 +215,8 @@ class ResultTracker : public RefCountedThreadSafe<ResultTracker> {
 
   // Overload to match other types of RpcContext::Respond*Failure()
   void FailAndRespond(const RequestIdPB& request_id,
-                      ErrorStatusPB_RpcErrorCodePB err, const Status& status);
+                      ErrorStatusPB_RpcErrorCodePB err, const Status& status,
+                      const MonoDelta& retry_after = MonoDelta());
 
   // Overload to match other types of RpcContext::Respond*Failure()
   void FailAndRespond(const RequestIdPB& request_id,
@@ -237,6 +238,10 @@ class ResultTracker : public RefCountedThreadSafe<ResultTracker> {
   //   - If the CompletionRecord is older than the 'remember_responses_ttl_secs' flag,
   //     GCs the CompletionRecord and advances the 'stale_before_seq_no' watermark.
   //
+  // Afterwards, if the result tracker uses more memory than the 'result_tracker_memory_limit_mb'
+  // flag allows, or if the memory limit of the process is exceeded, evicts the oldest completed
+  // responses of each client early, until it no longer does.
+  //
   // Typically this is invoked from an internal thread started by 'StartGCThread()'.
   void GCResults();
 
@@ -269,8 +274,12 @@ class ResultTracker : public RefCountedThreadSafe<ResultTracker> {
     // The timestamp of the last CompletionRecord update.
     MonoTime last_updated;
 
-    // The cached response, if this RPC is in COMPLETED state.
-    std::unique_ptr<google::protobuf::Message> response;
+    // The serialized cached response, if this RPC is in COMPLETED state.
+    //
+    // Keeping the encoded bytes rather than a copy of the message avoids the
+    // per-field allocations and reflection overhead of a parsed protobuf, which
+    // dominates the memory used by small responses such as writes'.
+    std::string response;
 
     // The set of ongoing RPCs that correspond to this record.
     std::vector<OnGoingRpcInfo> ongoing_rpcs;
@@ -281,7 +290,7 @@ class ResultTracker : public RefCountedThreadSafe<ResultTracker> {
     int64_t memory_footprint() const {
       return kudu_malloc_usable_size(this)
           + (ongoing_rpcs.capacity() > 0 ? kudu_malloc_usable_size(ongoing_rpcs.data()) : 0)
-          + (response.get() != nullptr ? response->SpaceUsed() : 0);
+          + response.capacity();
     }
   };
 
@@ -369,6 +378,10 @@ class ResultTracker : public RefCountedThreadSafe<ResultTracker> {
 
   std::string ToStringUnlocked() const;
 
+  // Returns true if the cached responses should be evicted before their time due to
+  // memory pressure.
+  bool MustEvictUnlocked() const;
+
   void RunGCThread();
 
   // The memory tracker that tracks this ResultTracker's memory consumption.
@@ -23,9 +23,12 @@
 #include <thread>
 
 #include "kudu/gutil/atomicops.h"
+#include "kudu/gutil/strings/numbers.h"
+#include "kudu/gutil/strings/split.h"
 #include "kudu/rpc/rpc-test-base.h"
 #include "kudu/rpc/rtest.proxy.h"
 #include "kudu/util/countdown_latch.h"
+#include "kudu/util/hdr_histogram.h"
 #include "kudu/util/test_util.h"
 
 using std::bind;
@@ -38,12 +41,16 @@ using std::vector;
 DEFINE_int32(client_threads, 16,
              "Number of client threads. For the synchronous benchmark, each thread has "
              "a single outstanding synchronous request at a time. For the async "
-             "benchmark, this determines the number of client reactors.");
+             "benchmark, this determines the number of client messengers. Each client "
+             "messenger opens --rpc_num_connections_per_peer connections to the server.");
+
+DEFINE_int32(client_reactors, 1,
+             "Number of reactor threads in each client messenger.");
 
 DEFINE_int32(async_call_concurrency, 60,
              "Number of concurrent requests that will be outstanding at a time for the "
              "async benchmark. The requests are multiplexed across the number of "
-             "reactors specified by the 'client_threads' flag.");
+             "messengers specified by the 'client_threads' flag.");
 
 DEFINE_int32(worker_threads, 1,
              "Number of server worker threads");
@@ -51,11 +58,23 @@ DEFINE_int32(worker_threads, 1,
 DEFINE_int32(server_reactors, 4,
              "Number of server reactor threads");
 
-DEFINE_int32(run_seconds, 1, "Seconds to run the test");
+DEFINE_int32(run_seconds, 1, "Seconds to run each benchmark configuration");
+
+DEFINE_string(payload_sizes, "0",
+              "Comma-separated list of payload sizes, in bytes, to run the benchmarks "
+              "with, one after another. A size of 0 benchmarks the Add() call; other "
+              "sizes benchmark Echo() calls carrying that many bytes each way.");
+
+DEFINE_bool(echo_in_sidecar, false,
+            "Whether Echo() calls return their payload in a sidecar rather than in "
+            "the response protobuf.");
 
 namespace kudu {
 namespace rpc {
 
+// Latencies are tracked up to a minute with three significant digits.
+static const uint64_t kMaxLatencyUs = 60 * 1000 * 1000;
+
 class RpcBench : public RpcTestBase {
  public:
   RpcBench()
@@ -71,6 +90,22 @@ class RpcBench : public RpcTestBase {
 
     // Set up server.
     StartTestServerWithGeneratedCode(&server_addr_);
+
+    vector<string> size_strs = strings::Split(FLAGS_payload_sizes, ",", strings::SkipEmpty());
+    for (const string& size_str : size_strs) {
+      int32_t size;
+      CHECK(safe_strto32(size_str, &size) && size >= 0)
+          << "Invalid payload size: " << size_str;
+      payload_sizes_.push_back(size);
+    }
+    CHECK(!payload_sizes_.empty()) << "--payload_sizes must not be empty";
+  }
+
+  // Prepare to run a configuration with the given payload size.
+  void Reset(int payload_size) {
+    payload_.assign(payload_size, 'x');
+    latency_hist_.reset(new HdrHistogram(kMaxLatencyUs, 3));
+    Release_Store(&should_run_, true);
   }
 
   void SummarizePerf(CpuTimes elapsed, int total_reqs, bool sync) {
@@ -83,18 +118,40 @@ class RpcBench : public RpcTestBase {
     if (sync) {
       LOG(INFO) << "Client threads:   " << FLAGS_client_threads;
     } else {
-      LOG(INFO) << "Client reactors:  " << FLAGS_client_threads;
+      LOG(INFO) << "Client messengers: " << FLAGS_client_threads;
       LOG(INFO) << "Call concurrency: " << FLAGS_async_call_concurrency;
     }
-
+    LOG(INFO) << "Client reactors:  " << FLAGS_client_reactors;
     LOG(INFO) << "Worker threads:   " << FLAGS_worker_threads;
     LOG(INFO) << "Server reactors:  " << FLAGS_server_reactors;
+    if (payload_.empty()) {
+      LOG(INFO) << "Call:             Add";
+    } else {
+      LOG(INFO) << "Call:             Echo, " << payload_.size() << " byte payload in "
+                << (FLAGS_echo_in_sidecar ? "sidecar" : "protobuf");
+    }
     LOG(INFO) << "----------------------------------";
     LOG(INFO) << "Reqs/sec:         " << reqs_per_second;
+    if (!payload_.empty()) {
+      LOG(INFO) << "MB/sec each way:  " << reqs_per_second * payload_.size() / (1024 * 1024);
+    }
     LOG(INFO) << "User CPU per req: " << user_cpu_micros_per_req << "us";
     LOG(INFO) << "Sys CPU per req:  " << sys_cpu_micros_per_req << "us";
     LOG(INFO) << "Ctx Sw. per req:  " << csw_per_req;
+    LOG(INFO) << "Latency p50:      " << latency_hist_->ValueAtPercentile(50) << "us";
+    LOG(INFO) << "Latency p95:      " << latency_hist_->ValueAtPercentile(95) << "us";
+    LOG(INFO) << "Latency p99:      " << latency_hist_->ValueAtPercentile(99) << "us";
+    LOG(INFO) << "Latency p99.9:    " << latency_hist_->ValueAtPercentile(99.9) << "us";
+    LOG(INFO) << "Latency max:      " << latency_hist_->MaxValue() << "us";
+  }
 
+  void RecordLatency(const MonoTime& start) {
+    latency_hist_->Increment(std::min<uint64_t>((MonoTime::Now() - start).ToMicroseconds(),
+                                                kMaxLatencyUs));
+  }
+
+  shared_ptr<Messenger> CreateClientMessenger() {
+    return CreateMessenger("Client", FLAGS_client_reactors);
   }
 
  protected:
@@ -104,6 +161,69 @@ class RpcBench : public RpcTestBase {
   Sockaddr server_addr_;
   Atomic32 should_run_;
   CountDownLatch stop_;
+
+  vector<int> payload_sizes_;
+
+  // The payload of each Echo() call in the current configuration, or empty
+  // if Add() is being benchmarked.
+  string payload_;
+
+  unique_ptr<HdrHistogram> latency_hist_;
+};
+
+// Fills in Add() and Echo() requests and checks their responses.
+class CallHelper {
+ public:
+  explicit CallHelper(const string& payload)
+      : payload_(payload) {
+    echo_req_.set_data(payload_);
+    echo_req_.set_echo_in_sidecar(FLAGS_echo_in_sidecar);
+  }
+
+  void Call(CalculatorServiceProxy* p, RpcController* controller, int seq) {
+    if (payload_.empty()) {
+      SetAddRequest(seq);
+      CHECK_OK(p->Add(add_req_, &add_resp_, controller));
+    } else {
+      CHECK_OK(p->Echo(echo_req_, &echo_resp_, controller));
+    }
+    CheckResponse(*controller);
+  }
+
+  void CallAsync(CalculatorServiceProxy* p, RpcController* controller, int seq,
+                 const ResponseCallback& cb) {
+    if (payload_.empty()) {
+      SetAddRequest(seq);
+      p->AddAsync(add_req_, &add_resp_, controller, cb);
+    } else {
+      p->EchoAsync(echo_req_, &echo_resp_, controller, cb);
+    }
+  }
+
+  void CheckResponse(const RpcController& controller) {
+    CHECK_OK(controller.status());
+    if (payload_.empty()) {
+      CHECK_EQ(add_req_.x() + add_req_.y(), add_resp_.result());
+    } else if (FLAGS_echo_in_sidecar) {
+      Slice sidecar;
+      CHECK_OK(controller.GetSidecar(echo_resp_.sidecar_idx(), &sidecar));
+      CHECK_EQ(payload_.size(), sidecar.size());
+    } else {
+      CHECK_EQ(payload_.size(), echo_resp_.data().size());
+    }
+  }
+
+ private:
+  void SetAddRequest(int seq) {
+    add_req_.set_x(seq);
+    add_req_.set_y(seq);
+  }
+
+  const string& payload_;
+  AddRequestPB add_req_;
+  AddResponsePB add_resp_;
+  EchoRequestPB echo_req_;
+  EchoResponsePB echo_resp_;
 };
 
 class ClientThread {
@@ -122,19 +242,17 @@ class ClientThread {
   }
 
   void Run() {
-    shared_ptr<Messenger> client_messenger = bench_->CreateMessenger("Client");
+    shared_ptr<Messenger> client_messenger = bench_->CreateClientMessenger();
 
     CalculatorServiceProxy p(client_messenger, bench_->server_addr_);
 
-    AddRequestPB req;
-    AddResponsePB resp;
+    CallHelper helper(bench_->payload_);
     while (Acquire_Load(&bench_->should_run_)) {
-      req.set_x(request_count_);
-      req.set_y(request_count_);
       RpcController controller;
       controller.set_timeout(MonoDelta::FromSeconds(10));
-      CHECK_OK(p.Add(req, &resp, &controller));
-      CHECK_EQ(req.x() + req.y(), resp.result());
+      MonoTime start = MonoTime::Now();
+      helper.Call(&p, &controller, request_count_);
+      bench_->RecordLatency(start);
       request_count_++;
     }
   }
@@ -147,27 +265,31 @@ class ClientThread {
 
 // Test making successful RPC calls.
 TEST_F(RpcBench, BenchmarkCalls) {
-  Stopwatch sw(Stopwatch::ALL_THREADS);
-  sw.start();
+  for (int payload_size : payload_sizes_) {
+    Reset(payload_size);
 
-  vector<unique_ptr<ClientThread>> threads;
-  for (int i = 0; i < FLAGS_client_threads; i++) {
-    threads.emplace_back(new ClientThread(this));
-    threads.back()->Start();
-  }
+    Stopwatch sw(Stopwatch::ALL_THREADS);
+    sw.start();
 
-  SleepFor(MonoDelta::FromSeconds(FLAGS_run_seconds));
-  Release_Store(&should_run_, false);
+    vector<unique_ptr<ClientThread>> threads;
+    for (int i = 0; i < FLAGS_client_threads; i++) {
+      threads.emplace_back(new ClientThread(this));
+      threads.back()->Start();
+    }
 
-  int total_reqs = 0;
+    SleepFor(MonoDelta::FromSeconds(FLAGS_run_seconds));
+    Release_Store(&should_run_, false);
 
-  for (auto& thr : threads) {
-    thr->Join();
-    total_reqs += thr->request_count_;
-  }
-  sw.stop();
+    int total_reqs = 0;
 
-  SummarizePerf(sw.elapsed(), total_reqs, true);
+    for (auto& thr : threads) {
+      thr->Join();
+      total_reqs += thr->request_count_;
+    }
+    sw.stop();
+
+    SummarizePerf(sw.elapsed(), total_reqs, true);
+  }
 }
 
 class ClientAsyncWorkload {
@@ -175,28 +297,26 @@ class ClientAsyncWorkload {
   ClientAsyncWorkload(RpcBench *bench, shared_ptr<Messenger> messenger)
     : bench_(bench),
       messenger_(messenger),
-      request_count_(0) {
+      request_count_(0),
+      helper_(bench->payload_) {
     controller_.set_timeout(MonoDelta::FromSeconds(10));
     proxy_.reset(new CalculatorServiceProxy(messenger_, bench_->server_addr_));
   }
 
   void CallOneRpc() {
     if (request_count_ > 0) {
-      CHECK_OK(controller_.status());
-      CHECK_EQ(req_.x() + req_.y(), resp_.result());
+      bench_->RecordLatency(start_);
+      helper_.CheckResponse(controller_);
     }
     if (!Acquire_Load(&bench_->should_run_)) {
       bench_->stop_.CountDown();
       return;
     }
     controller_.Reset();
-    req_.set_x(request_count_);
-    req_.set_y(request_count_);
-    request_count_++;
-    proxy_->AddAsync(req_,
-                     &resp_,
-                     &controller_,
-                     bind(&ClientAsyncWorkload::CallOneRpc, this));
+    start_ = MonoTime::Now();
+    int seq = request_count_++;
+    helper_.CallAsync(proxy_.get(), &controller_, seq,
+                      bind(&ClientAsyncWorkload::CallOneRpc, this));
   }
 
   void Start() {
@@ -208,8 +328,8 @@ class ClientAsyncWorkload {
   unique_ptr<CalculatorServiceProxy> proxy_;
   uint32_t request_count_;
   RpcController controller_;
-  AddRequestPB req_;
-  AddResponsePB resp_;
+  MonoTime start_;
+  CallHelper helper_;
 };
 
 TEST_F(RpcBench, BenchmarkCallsAsync) {
@@ -218,38 +338,41 @@ TEST_F(RpcBench, BenchmarkCallsAsync) {
 
   vector<shared_ptr<Messenger>> messengers;
   for (int i = 0; i < threads; i++) {
-    messengers.push_back(CreateMessenger("Client"));
+    messengers.push_back(CreateClientMessenger());
   }
 
-  vector<unique_ptr<ClientAsyncWorkload>> workloads;
-  for (int i = 0; i < concurrency; i++) {
-    workloads.emplace_back(
-        new ClientAsyncWorkload(this, messengers[i % threads]));
-  }
+  for (int payload_size : payload_sizes_) {
+    Reset(payload_size);
 
-  stop_.Reset(concurrency);
+    vector<unique_ptr<ClientAsyncWorkload>> workloads;
+    for (int i = 0; i < concurrency; i++) {
+      workloads.emplace_back(
+          new ClientAsyncWorkload(this, messengers[i % threads]));
+    }
 
-  Stopwatch sw(Stopwatch::ALL_THREADS);
-  sw.start();
+    stop_.Reset(concurrency);
 
-  for (int i = 0; i < concurrency; i++) {
-    workloads[i]->Start();
-  }
+    Stopwatch sw(Stopwatch::ALL_THREADS);
+    sw.start();
 
-  SleepFor(MonoDelta::FromSeconds(FLAGS_run_seconds));
-  Release_Store(&should_run_, false);
+    for (int i = 0; i < concurrency; i++) {
+      workloads[i]->Start();
+    }
 
-  sw.stop();
+    SleepFor(MonoDelta::FromSeconds(FLAGS_run_seconds));
+    Release_Store(&should_run_, false);
 
-  stop_.Wait();
-  int total_reqs = 0;
-  for (int i = 0; i < concurrency; i++) {
-    total_reqs += workloads[i]->request_count_;
-  }
+    sw.stop();
+
+    stop_.Wait();
+    int total_reqs = 0;
+    for (int i = 0; i < concurrency; i++) {
+      total_reqs += workloads[i]->request_count_;
+    }
 
-  SummarizePerf(sw.elapsed(), total_reqs, false);
+    SummarizePerf(sw.elapsed(), total_reqs, false);
+  }
 }
 
 } // namespace rpc
 } // namespace kudu
-
@@ -130,8 +130,10 @@ class GenericCalculatorService : public ServiceIf {
       LOG(FATAL) << "couldn't parse: " << param.ToDebugString();
     }
 
+    // The first sidecar owns its data; the second references a buffer
+    // owned by the test.
     gscoped_ptr<faststring> first(new faststring);
-    gscoped_ptr<faststring> second(new faststring);
+    std::shared_ptr<faststring> second(new faststring);
 
     Random r(req.random_seed());
     first->resize(req.size1());
@@ -144,8 +146,9 @@ class GenericCalculatorService : public ServiceIf {
     int idx1, idx2;
     CHECK_OK(incoming->AddRpcSidecar(
         make_gscoped_ptr(new RpcSidecar(std::move(first))), &idx1));
+    Slice second_data(*second);
     CHECK_OK(incoming->AddRpcSidecar(
-        make_gscoped_ptr(new RpcSidecar(std::move(second))), &idx2));
+        make_gscoped_ptr(new RpcSidecar(second_data, std::move(second))), &idx2));
     resp.set_sidecar1(idx1);
     resp.set_sidecar2(idx2);
 
@@ -216,7 +219,16 @@ class CalculatorService : public CalculatorServiceIf {
   }
 
   void Echo(const EchoRequestPB *req, EchoResponsePB *resp, RpcContext *context) override {
-    resp->set_data(req->data());
+    if (req->echo_in_sidecar()) {
+      gscoped_ptr<faststring> data(new faststring());
+      data->append(req->data());
+      int idx;
+      CHECK_OK(context->AddRpcSidecar(make_gscoped_ptr(new RpcSidecar(std::move(data))), &idx));
+      resp->set_data("");
+      resp->set_sidecar_idx(idx);
+    } else {
+      resp->set_data(req->data());
+    }
     context->RespondSuccess();
   }
 
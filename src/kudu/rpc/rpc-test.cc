@@ -17,6 +17,7 @@
 
 #include "kudu/rpc/rpc-test-base.h"
 
+#include <functional>
 #include <memory>
 #include <string>
 #include <unordered_map>
@@ -30,6 +31,7 @@
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/rpc/constants.h"
 #include "kudu/rpc/serialization.h"
+#include "kudu/util/coding.h"
 #include "kudu/util/countdown_latch.h"
 #include "kudu/util/env.h"
 #include "kudu/util/scoped_cleanup.h"
@@ -38,7 +40,12 @@
 METRIC_DECLARE_histogram(handler_latency_kudu_rpc_test_CalculatorService_Sleep);
 METRIC_DECLARE_histogram(rpc_incoming_queue_time);
 
+DECLARE_int32(rpc_compression_min_bytes);
 DECLARE_int32(rpc_negotiation_inject_delay_ms);
+DECLARE_int32(rpc_num_connections_per_peer);
+DECLARE_bool(rpc_connect_to_local_socket);
+DECLARE_bool(rpc_listen_on_local_socket);
+DECLARE_bool(rpc_reuseport_acceptors);
 
 using std::shared_ptr;
 using std::string;
@@ -91,6 +98,61 @@ TEST_F(TestRpc, TestAcceptorPoolStartStop) {
   }
 }
 
+#if defined(__linux__)
+// Test that connections accepted by the reactors themselves, each listening
+// on its own SO_REUSEPORT socket, serve calls like the ones handed over by
+// acceptor threads.
+TEST_F(TestRpc, TestReusePortAcceptors) {
+  FLAGS_rpc_reuseport_acceptors = true;
+  Sockaddr server_addr;
+  StartTestServer(&server_addr);
+  ASSERT_NE(0, server_addr.port());
+
+  // Each client messenger makes its own connection, from its own port.
+  const int kNumClients = 10;
+  vector<shared_ptr<Messenger>> client_messengers;
+  for (int i = 0; i < kNumClients; i++) {
+    client_messengers.emplace_back(CreateMessenger("Client", 1));
+    Proxy p(client_messengers.back(), server_addr,
+            GenericCalculatorService::static_service_name());
+    ASSERT_OK(DoTestSyncCall(p, GenericCalculatorService::kAddMethodName));
+  }
+
+  int num_server_conns = 0;
+  for (int i = 0; i < server_messenger_->num_reactors(); i++) {
+    ReactorMetrics metrics;
+    ASSERT_OK(server_messenger_->reactors_[i]->GetMetrics(&metrics));
+    num_server_conns += metrics.num_server_connections_;
+  }
+  ASSERT_EQ(kNumClients, num_server_conns);
+}
+
+// Test that calls to a server of the same host go over its Unix domain
+// socket, on which the server sees the client at the loopback address with
+// port 0, unless the client doesn't connect to local sockets.
+TEST_F(TestRpc, TestLocalTransport) {
+  FLAGS_rpc_listen_on_local_socket = true;
+  Sockaddr server_addr;
+  StartTestServerWithGeneratedCode(&server_addr);
+
+  for (bool connect_to_local_socket : { true, false }) {
+    SCOPED_TRACE(connect_to_local_socket);
+    FLAGS_rpc_connect_to_local_socket = connect_to_local_socket;
+    shared_ptr<Messenger> client_messenger(CreateMessenger("Client"));
+    CalculatorServiceProxy p(client_messenger, server_addr);
+    RpcController controller;
+    WhoAmIRequestPB req;
+    WhoAmIResponsePB resp;
+    ASSERT_OK(p.WhoAmI(req, &resp, &controller));
+    if (connect_to_local_socket) {
+      ASSERT_EQ("127.0.0.1:0", resp.address());
+    } else {
+      ASSERT_NE("127.0.0.1:0", resp.address());
+    }
+  }
+}
+#endif
+
 TEST_F(TestRpc, TestConnHeaderValidation) {
   MessengerBuilder mb("TestRpc.TestConnHeaderValidation");
   const int conn_hdr_len = kMagicNumberLength + kHeaderFlagsLength;
@@ -206,6 +268,98 @@ TEST_F(TestRpc, TestHighFDs) {
   ASSERT_OK(DoTestSyncCall(p, GenericCalculatorService::kAddMethodName));
 }
 
+// Test that calls to a single remote are spread across several connections,
+// each on its own reactor, when configured to.
+TEST_F(TestRpc, TestConnectionFanOut) {
+  Sockaddr server_addr;
+  StartTestServer(&server_addr);
+
+  const int kNumConnections = 3;
+  FLAGS_rpc_num_connections_per_peer = kNumConnections;
+  shared_ptr<Messenger> client_messenger(CreateMessenger("Client", kNumConnections));
+  Proxy p(client_messenger, server_addr, GenericCalculatorService::static_service_name());
+  for (int i = 0; i < 2 * kNumConnections; i++) {
+    ASSERT_OK(DoTestSyncCall(p, GenericCalculatorService::kAddMethodName));
+  }
+
+  for (int i = 0; i < kNumConnections; i++) {
+    ReactorMetrics metrics;
+    ASSERT_OK(client_messenger->reactors_[i]->GetMetrics(&metrics));
+    ASSERT_EQ(1, metrics.num_client_connections_) << "Reactor " << i;
+  }
+}
+
+// Test that a connection established ahead of time is used by later calls.
+TEST_F(TestRpc, TestConnectionWarmUp) {
+  n_server_reactor_threads_ = 1;
+  Sockaddr server_addr;
+  StartTestServer(&server_addr);
+
+  shared_ptr<Messenger> client_messenger(CreateMessenger("Client"));
+  Proxy p(client_messenger, server_addr, GenericCalculatorService::static_service_name());
+  p.WarmUpConnection();
+  AssertEventually([&]() {
+      ReactorMetrics metrics;
+      ASSERT_OK(server_messenger_->reactors_[0]->GetMetrics(&metrics));
+      ASSERT_EQ(1, metrics.num_server_connections_);
+    });
+
+  ASSERT_OK(DoTestSyncCall(p, GenericCalculatorService::kAddMethodName));
+  ReactorMetrics metrics;
+  ASSERT_OK(server_messenger_->reactors_[0]->GetMetrics(&metrics));
+  ASSERT_EQ(1, metrics.num_server_connections_);
+  ASSERT_OK(client_messenger->reactors_[0]->GetMetrics(&metrics));
+  ASSERT_EQ(1, metrics.num_client_connections_);
+}
+
+// Test that message bodies survive a compression round trip, and that
+// incompressible bodies are left alone.
+TEST_F(TestRpc, TestCompressBodyRoundTrip) {
+  string first(10000, 'a');
+  string second(10000, 'b');
+  vector<Slice> body = { Slice(first), Slice(second) };
+  faststring compressed;
+  ASSERT_TRUE(serialization::CompressBody(body, &compressed));
+  ASSERT_LT(compressed.size(), first.size() + second.size());
+
+  // Strip the varint length prefix, as ParseMessage() would.
+  Slice delimited(compressed);
+  uint32_t len;
+  ASSERT_TRUE(GetVarint32(&delimited, &len));
+  ASSERT_EQ(len, delimited.size());
+
+  faststring uncompressed;
+  ASSERT_OK(serialization::DecompressBody(delimited, first.size() + second.size(),
+                                          &uncompressed));
+  ASSERT_EQ(first + second, uncompressed.ToString());
+
+  // A body claiming the wrong uncompressed size is rejected.
+  ASSERT_TRUE(serialization::DecompressBody(delimited, 100, &uncompressed).IsCorruption());
+
+  // Random data doesn't compress.
+  Random rng(SeedRandom());
+  faststring random;
+  random.resize(1000);
+  RandomString(random.data(), random.size(), &rng);
+  body = { Slice(random) };
+  ASSERT_FALSE(serialization::CompressBody(body, &compressed));
+}
+
+// Test calls over a connection which compresses request and response bodies.
+TEST_F(TestRpc, TestCompressedCalls) {
+  FLAGS_rpc_compression_min_bytes = 0;
+  Sockaddr server_addr;
+  StartTestServer(&server_addr);
+
+  shared_ptr<Messenger> client_messenger(CreateMessenger("Client"));
+  Proxy p(client_messenger, server_addr, GenericCalculatorService::static_service_name());
+  p.set_compression_enabled(true);
+  ASSERT_OK(DoTestSyncCall(p, GenericCalculatorService::kAddMethodName));
+  DoTestSidecar(p, 0, 0);
+  DoTestSidecar(p, 123, 456);
+  DoTestSidecar(p, 3000 * 1024, 2000 * 1024);
+}
+
 // Test that connections are kept alive between calls.
 TEST_F(TestRpc, TestConnectionKeepalive) {
   // Only run one reactor per messenger, so we can grab the metrics from that
@@ -522,6 +676,46 @@ TEST_F(TestRpc, TestRpcCallbackDestroysMessenger) {
   latch.Wait();
 }
 
+// Test a chain of calls, each made from the callback of the previous one.
+// The callbacks run on the reactor thread, so each call after the first is
+// assigned to its connection inline rather than through the task queue.
+TEST_F(TestRpc, TestCallFromReactorThread) {
+  Sockaddr server_addr;
+  StartTestServer(&server_addr);
+  shared_ptr<Messenger> client_messenger(CreateMessenger("Client"));
+  Proxy p(client_messenger, server_addr, GenericCalculatorService::static_service_name());
+
+  const int kNumCalls = 10;
+  AddRequestPB req;
+  req.set_x(1);
+  req.set_y(2);
+  AddResponsePB resp;
+  RpcController controller;
+  CountDownLatch latch(1);
+  int num_done = 0;
+  std::function<void()> cb = [&]() {
+    CHECK_OK(controller.status());
+    CHECK_EQ(3, resp.result());
+    if (++num_done == kNumCalls) {
+      latch.CountDown();
+      return;
+    }
+    controller.Reset();
+    p.AsyncRequest(GenericCalculatorService::kAddMethodName, req, &resp, &controller, cb);
+  };
+  p.AsyncRequest(GenericCalculatorService::kAddMethodName, req, &resp, &controller, cb);
+  latch.Wait();
+  ASSERT_EQ(kNumCalls, num_done);
+
+  // Running a function on the reactor thread from the reactor thread itself
+  // doesn't deadlock.
+  ASSERT_OK(client_messenger->reactors_[0]->RunOnReactorThread([&]() {
+        return client_messenger->reactors_[0]->RunOnReactorThread([]() {
+            return Status::OK();
+          });
+      }));
+}
+
 // Test that setting the client timeout / deadline gets propagated to RPC
 // services.
 TEST_F(TestRpc, TestRpcContextClientDeadline) {
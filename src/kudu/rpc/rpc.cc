@@ -61,6 +61,15 @@ void RpcRetrier::DelayedRetry(Rpc* rpc, const Status& why_status) {
   // If the delay causes us to miss our deadline, RetryCb will fail the
   // RPC on our behalf.
   int num_ms = ++attempt_num_ + ((rand() % 5));
+  const ErrorStatusPB* err = controller_.error_response();
+  if (err && err->code() == ErrorStatusPB::ERROR_SERVER_TOO_BUSY && err->has_retry_after_ms()) {
+    int retry_after_ms = err->retry_after_ms();
+    if (retry_after_ms > num_ms) {
+      // Spread out the retries of the clients which were all told to wait
+      // for the same time.
+      num_ms = retry_after_ms + rand() % (retry_after_ms / 4 + 1);
+    }
+  }
   messenger_->ScheduleOnReactor(boost::bind(&RpcRetrier::DelayedRetryCb,
                                             this,
                                             rpc, _1),
@@ -124,6 +124,9 @@ class RpcRetrier {
   // error when the RPC comes up for retrying. This is true even if the
   // deadline has already expired at the time that Retry() was called.
   //
+  // If the last response was an ERROR_SERVER_TOO_BUSY error which asked for
+  // a longer delay than the retrier's own backoff, that delay is used.
+  //
   // Callers should ensure that 'rpc' remains alive.
   void DelayedRetry(Rpc* rpc, const Status& why_status);
 
@@ -40,6 +40,7 @@ RpcContext::RpcContext(InboundCall *call,
                        google::protobuf::Message *response_pb,
                        const scoped_refptr<ResultTracker>& result_tracker)
   : call_(CHECK_NOTNULL(call)),
+    method_info_(call->method_info()),
     request_pb_(request_pb),
     response_pb_(response_pb),
     result_tracker_(result_tracker) {
@@ -51,6 +52,10 @@ RpcContext::RpcContext(InboundCall *call,
 }
 
 RpcContext::~RpcContext() {
+  if (method_info_) {
+    method_info_->req_pool.Release(const_cast<Message*>(request_pb_.release()));
+    method_info_->resp_pool.Release(response_pb_.release());
+  }
 }
 
 void RpcContext::RespondSuccess() {
@@ -100,17 +105,18 @@ void RpcContext::RespondFailure(const Status &status) {
   }
 }
 
-void RpcContext::RespondRpcFailure(ErrorStatusPB_RpcErrorCodePB err, const Status& status) {
+void RpcContext::RespondRpcFailure(ErrorStatusPB_RpcErrorCodePB err, const Status& status,
+                                   const MonoDelta& retry_after) {
   if (AreResultsTracked()) {
     result_tracker_->FailAndRespond(call_->header().request_id(),
-                                    err, status);
+                                    err, status, retry_after);
   } else {
     VLOG(4) << call_->remote_method().service_name() << ": Sending RPC failure response for "
         << call_->ToString() << ": " << status.ToString();
     TRACE_EVENT_ASYNC_END2("rpc_call", "RPC", this,
                            "status", status.ToString(),
                            "trace", trace()->DumpToString());
-    call_->RespondFailure(err, status);
+    call_->RespondFailure(err, status, retry_after);
     delete this;
   }
 }
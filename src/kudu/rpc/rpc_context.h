@@ -22,6 +22,7 @@
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/rpc/rpc_header.pb.h"
 #include "kudu/rpc/service_if.h"
+#include "kudu/util/monotime.h"
 #include "kudu/util/status.h"
 
 namespace google {
@@ -62,6 +63,10 @@ class RpcContext {
  public:
   // Create an RpcContext. This is called only from generated code
   // and is not a public API.
+  //
+  // If 'call' has been associated with a method, 'request_pb' and
+  // 'response_pb' must have been acquired from that method's message pools,
+  // and are returned to them when the context is destroyed.
   RpcContext(InboundCall *call,
              const google::protobuf::Message *request_pb,
              google::protobuf::Message *response_pb,
@@ -103,11 +108,12 @@ class RpcContext {
   // Respond with an RPC-level error. This typically manifests to the client as
   // a remote error, one whose handling is agnostic to the particulars of the
   // sent RPC. For example, ERROR_SERVER_TOO_BUSY usually causes the client to
-  // retry the RPC at a later time.
+  // retry the RPC at a later time, after 'retry_after' if it's initialized.
   //
   // After this method returns, this RpcContext object is destroyed. The request
   // and response protobufs are also destroyed.
-  void RespondRpcFailure(ErrorStatusPB_RpcErrorCodePB err, const Status& status);
+  void RespondRpcFailure(ErrorStatusPB_RpcErrorCodePB err, const Status& status,
+                         const MonoDelta& retry_after = MonoDelta());
 
   // Respond with an application-level error. This causes the caller to get a
   // RemoteError status with the provided string message. Additionally, a
@@ -197,8 +203,11 @@ class RpcContext {
  private:
   friend class ResultTracker;
   InboundCall* const call_;
-  const gscoped_ptr<const google::protobuf::Message> request_pb_;
-  const gscoped_ptr<google::protobuf::Message> response_pb_;
+  // The method being invoked, kept alive so that the request and response
+  // can be returned to its message pools. May be null.
+  const scoped_refptr<RpcMethodInfo> method_info_;
+  gscoped_ptr<const google::protobuf::Message> request_pb_;
+  gscoped_ptr<google::protobuf::Message> response_pb_;
   scoped_refptr<ResultTracker> result_tracker_;
 };
 
@@ -21,10 +21,12 @@
 #include <glog/logging.h>
 #include <memory>
 #include <unordered_set>
+#include <vector>
 
 #include "kudu/gutil/macros.h"
 #include "kudu/util/locks.h"
 #include "kudu/util/monotime.h"
+#include "kudu/util/slice.h"
 #include "kudu/util/status.h"
 namespace kudu {
 
@@ -169,6 +171,15 @@ class RpcController {
   // Return the configured timeout.
   MonoDelta timeout() const;
 
+  // Appends 'data' to the serialized request of the next call made with this
+  // controller. 'data' must be the wire encoding of zero or more fields of the
+  // request message, so that fields which were already serialized elsewhere
+  // can be sent without being encoded again. It's copied when the call is
+  // made, and isn't sent with any later calls.
+  void AppendSerializedRequestFields(const Slice& data) {
+    serialized_request_fields_.push_back(data);
+  }
+
   // Fills the 'sidecar' parameter with the slice pointing to the i-th
   // sidecar upon success.
   //
@@ -185,6 +196,9 @@ class RpcController {
   MonoDelta timeout_;
   std::unordered_set<uint32_t> required_server_features_;
 
+  // Serialized fields to append to the request of the next call.
+  std::vector<Slice> serialized_request_fields_;
+
   mutable simple_spinlock lock_;
 
   // The id of this request.
@@ -17,6 +17,9 @@
 #ifndef KUDU_RPC_RPC_SIDECAR_H
 #define KUDU_RPC_RPC_SIDECAR_H
 
+#include <memory>
+#include <utility>
+
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/util/faststring.h"
 #include "kudu/util/slice.h"
@@ -49,16 +52,34 @@ namespace rpc {
 // RpcController's interface) is able to offer retrieval of the sidecar data
 // through the same indices that were returned by InboundCall (or indirectly
 // through the RpcContext wrapper) on the client side.
+//
+// A sidecar may either own its data, or reference memory owned elsewhere
+// (e.g. a block cache entry or an arena) which is kept alive by a pin. In
+// the latter case, the data is written to the socket straight from where it
+// lives.
 class RpcSidecar {
  public:
   // Generates a sidecar with the parameter faststring as its data.
-  explicit RpcSidecar(gscoped_ptr<faststring> data) : data_(std::move(data)) {}
+  explicit RpcSidecar(gscoped_ptr<faststring> data)
+      : owned_data_(std::move(data)),
+        data_(owned_data_->data(), owned_data_->size()) {
+  }
+
+  // Generates a sidecar referencing 'data', which must remain valid and
+  // unchanged for as long as 'pin' is held. The sidecar holds 'pin' until
+  // the response has been sent.
+  RpcSidecar(const Slice& data, std::shared_ptr<const void> pin)
+      : pin_(std::move(pin)),
+        data_(data) {
+  }
 
   // Returns a Slice representation of the sidecar's data.
-  Slice AsSlice() const { return *data_; }
+  Slice AsSlice() const { return data_; }
 
  private:
-  const gscoped_ptr<faststring> data_;
+  const gscoped_ptr<faststring> owned_data_;
+  const std::shared_ptr<const void> pin_;
+  const Slice data_;
 
   DISALLOW_COPY_AND_ASSIGN(RpcSidecar);
 };
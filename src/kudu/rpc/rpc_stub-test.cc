@@ -26,6 +26,7 @@
 #include <boost/bind.hpp>
 
 #include "kudu/gutil/stl_util.h"
+#include "kudu/rpc/call_breakdown.h"
 #include "kudu/rpc/rpc_introspection.pb.h"
 #include "kudu/rpc/rpcz_store.h"
 #include "kudu/rpc/rtest.proxy.h"
@@ -39,6 +40,8 @@
 
 DEFINE_bool(is_panic_test_child, false, "Used by TestRpcPanic");
 DECLARE_bool(socket_inject_short_recvs);
+DECLARE_int32(rpc_queue_delay_interval_ms);
+DECLARE_int32(rpc_queue_delay_target_ms);
 
 using std::shared_ptr;
 using std::unique_ptr;
@@ -81,6 +84,21 @@ TEST_F(RpcStubTest, TestSimpleCall) {
 // Regression test for a bug in which we would not properly parse a call
 // response when recv() returned a 'short read'. This injects such short
 // reads and then makes a number of calls.
+// Test that messages released to a MessagePool are cleared and handed back
+// out again.
+TEST_F(RpcStubTest, TestMessagePool) {
+  MessagePool pool;
+  AddRequestPB prototype;
+  auto* req = static_cast<AddRequestPB*>(pool.Acquire(prototype));
+  req->set_x(10);
+  pool.Release(req);
+
+  auto* reused = static_cast<AddRequestPB*>(pool.Acquire(prototype));
+  ASSERT_EQ(req, reused);
+  ASSERT_FALSE(reused->has_x());
+  pool.Release(reused);
+}
+
 TEST_F(RpcStubTest, TestShortRecvs) {
   FLAGS_socket_inject_short_recvs = true;
   CalculatorServiceProxy p(client_messenger_, server_addr_);
@@ -201,6 +219,30 @@ TEST_F(RpcStubTest, TestCallWithInvalidParam) {
                       "missing fields: y");
 }
 
+// Test that fields serialized ahead of time and appended to the request by
+// the controller are parsed by the server as part of the request.
+TEST_F(RpcStubTest, TestCallWithSerializedRequestFields) {
+  Proxy p(client_messenger_, server_addr_, CalculatorService::static_service_name());
+
+  AddRequestPartialPB req;
+  req.set_x(10);
+  // The wire encoding of just the 'y' field.
+  AddRequestPB y_only;
+  y_only.set_y(32);
+  string y_field = y_only.SerializePartialAsString();
+
+  AddResponsePB resp;
+  RpcController controller;
+  controller.AppendSerializedRequestFields(Slice(y_field));
+  ASSERT_OK(p.SyncRequest("Add", req, &resp, &controller));
+  ASSERT_EQ(42, resp.result());
+
+  // The fields aren't sent with later calls.
+  controller.Reset();
+  Status s = p.SyncRequest("Add", req, &resp, &controller);
+  ASSERT_TRUE(s.IsRemoteError()) << "Bad status: " << s.ToString();
+}
+
 // Wrapper around AtomicIncrement, since AtomicIncrement returns the 'old'
 // value, and our callback needs to be a void function.
 static void DoIncrement(Atomic32* count) {
@@ -391,6 +433,49 @@ TEST_F(RpcStubTest, TestDontHandleTimedOutCalls) {
   ASSERT_EQ(1, timed_out_in_queue->value());
 }
 
+// Test that once a standing queue has built up, calls whose timeout is shorter
+// than the queue delay are rejected on arrival instead of being queued.
+TEST_F(RpcStubTest, TestRejectCallsExpectedToTimeOutInQueue) {
+  FLAGS_rpc_queue_delay_interval_ms = 1;
+  FLAGS_rpc_queue_delay_target_ms = 1;
+
+  CalculatorServiceProxy p(client_messenger_, server_addr_);
+  vector<AsyncSleep*> sleeps;
+  ElementDeleter d(&sleeps);
+
+  // Send three rounds of sleeps for the worker threads, plus one more so that
+  // the queue is still non-empty while the third round runs. The third round
+  // waits in the queue for the length of two sleeps, which establishes the
+  // standing delay.
+  for (int i = 0; i < n_worker_threads_ * 3 + 1; i++) {
+    gscoped_ptr<AsyncSleep> sleep(new AsyncSleep);
+    sleep->rpc.set_timeout(MonoDelta::FromSeconds(30));
+    sleep->req.set_sleep_micros(500 * 1000); // 500ms
+    p.SleepAsync(sleep->req, &sleep->resp, &sleep->rpc,
+                 boost::bind(&CountDownLatch::CountDown, &sleep->latch));
+    sleeps.push_back(sleep.release());
+  }
+  while (service_pool_->StandingQueueDelay() < MonoDelta::FromMilliseconds(100)) {
+    SleepFor(MonoDelta::FromMilliseconds(1));
+  }
+
+  // A call which would exceed its timeout waiting for a worker is rejected.
+  RpcController rpc;
+  SleepRequestPB req;
+  SleepResponsePB resp;
+  req.set_sleep_micros(1000);
+  rpc.set_timeout(MonoDelta::FromMilliseconds(50));
+  Status s = p.Sleep(req, &resp, &rpc);
+  ASSERT_TRUE(s.IsRemoteError()) << s.ToString();
+  ASSERT_EQ(ErrorStatusPB::ERROR_SERVER_TOO_BUSY, rpc.error_response()->code());
+  ASSERT_EQ(1, service_pool_->RpcsRejectedForQueueDelayMetricForTests()->value());
+
+  for (AsyncSleep* s : sleeps) {
+    s->latch.Wait();
+  }
+  ASSERT_EQ(0, service_pool_->RpcsTimedOutInQueueMetricForTests()->value());
+}
+
 // Test which ensures that the RPC queue accepts requests with the earliest
 // deadline first (EDF), and upon overflow rejects requests with the latest deadlines.
 //
@@ -555,6 +640,41 @@ TEST_F(RpcStubTest, TestDumpSampledCalls) {
   ASSERT_STR_CONTAINS(sampled_rpcs.DebugString(), "duration_ms");
 }
 
+// Test that every call's per-stage timing is recorded and dumped.
+TEST_F(RpcStubTest, TestDumpCallBreakdowns) {
+  CalculatorServiceProxy p(client_messenger_, server_addr_);
+
+  const int kNumCalls = 5;
+  for (int i = 0; i < kNumCalls; i++) {
+    RpcController controller;
+    SleepRequestPB req;
+    req.set_sleep_micros(10 * 1000);
+    SleepResponsePB resp;
+    ASSERT_OK(p.Sleep(req, &resp, &controller));
+  }
+
+  // The breakdown is recorded once the response has been sent, which may be
+  // after the client has seen it.
+  AssertEventually([&]() {
+      DumpRpczStoreResponsePB dump;
+      server_messenger_->call_breakdown_store()->DumpPB(&dump);
+      ASSERT_EQ(1, dump.breakdowns_size());
+      const RpcMethodBreakdownPB& method = dump.breakdowns(0);
+      ASSERT_EQ("kudu.rpc_test.CalculatorService.Sleep", method.method_name());
+      ASSERT_EQ(kNumCallStages, method.stages_size());
+      for (const auto& stage : method.stages()) {
+        ASSERT_EQ(kNumCalls, stage.count()) << stage.stage();
+      }
+      ASSERT_EQ("handler", method.stages(kHandlerStage).stage());
+      ASSERT_GE(method.stages(kHandlerStage).percentile_50_us(), 10 * 1000);
+      ASSERT_EQ(kNumCalls, method.slowest_recent_calls_size());
+      for (const auto& call : method.slowest_recent_calls()) {
+        ASSERT_GE(call.handler_us(), 10 * 1000);
+        ASSERT_EQ(0, call.consensus_us());
+      }
+    });
+}
+
 namespace {
 struct RefCountedTest : public RefCountedThreadSafe<RefCountedTest> {
 };
@@ -31,6 +31,7 @@
 #include "kudu/rpc/service_if.h"
 #include "kudu/util/atomic.h"
 #include "kudu/util/flag_tags.h"
+#include "kudu/util/logging.h"
 #include "kudu/util/monotime.h"
 #include "kudu/util/trace.h"
 
@@ -231,12 +232,14 @@ void RpczStore::LogTrace(InboundCall* call) {
     if (duration_ms > log_threshold) {
       // TODO: consider pushing this onto another thread since it may be slow.
       // The traces may also be too large to fit in a log message.
-      LOG(WARNING) << call->ToString() << " took " << duration_ms << "ms (client timeout "
-                   << call->header_.timeout_millis() << ").";
+      // The trace is logged with the call, so that a burst of slow calls
+      // is throttled as a whole.
       std::string s = call->trace()->DumpToString();
-      if (!s.empty()) {
-        LOG(WARNING) << "Trace:\n" << s;
-      }
+      KLOG_EVERY_N_SECS(WARNING, 1) << call->ToString() << " took " << duration_ms
+                                    << "ms (client timeout "
+                                    << call->header_.timeout_millis() << ")."
+                                    << THROTTLE_MSG
+                                    << (s.empty() ? "" : "\nTrace:\n") << s;
       return;
     }
   }
@@ -86,6 +86,10 @@ SaslClient::SaslClient(string app_name, int fd)
       helper_(SaslHelper::CLIENT),
       client_state_(SaslNegotiationState::NEW),
       negotiated_mech_(SaslMechanism::INVALID),
+      optimistic_plain_(false),
+      nego_ok_(false),
+      nego_response_expected_(false),
+      initiate_sent_(false),
       deadline_(MonoTime::Max()) {
   callbacks_.push_back(SaslBuildCallback(SASL_CB_GETOPT,
       reinterpret_cast<int (*)()>(&SaslClientGetoptCb), this));
@@ -183,11 +187,15 @@ Status SaslClient::Negotiate() {
   // Ensure we can use blocking calls on the socket during negotiation.
   RETURN_NOT_OK(EnsureBlockingMode(&sock_));
 
+  nego_ok_ = false;
+
   // Start by asking the server for a list of available auth mechanisms.
   RETURN_NOT_OK(SendNegotiateMessage());
+  if (optimistic_plain_ && helper_.IsPlainEnabled()) {
+    RETURN_NOT_OK(SendOptimisticPlainInitiate());
+  }
 
   faststring recv_buf;
-  nego_ok_ = false;
 
   // We set nego_ok_ = true when the SASL library returns SASL_OK to us.
   // We set nego_response_expected_ = true each time we send a request to the server.
@@ -280,6 +288,29 @@ Status SaslClient::SendInitiateMessage(const SaslMessagePB_SaslAuth& auth,
   return Status::OK();
 }
 
+Status SaslClient::SendOptimisticPlainInitiate() {
+  const char* init_msg = nullptr;
+  unsigned init_msg_len = 0;
+  const char* negotiated_mech = nullptr;
+
+  TRACE("SASL Client: Calling sasl_client_start() for optimistic PLAIN");
+  int result = sasl_client_start(sasl_conn_.get(), kSaslMechPlain, nullptr,
+                                 &init_msg, &init_msg_len, &negotiated_mech);
+  if (result == SASL_OK) {
+    nego_ok_ = true;
+  } else if (PREDICT_FALSE(result != SASL_CONTINUE)) {
+    return Status::NotAuthorized("Unable to negotiate SASL connection",
+        SaslErrDesc(result, sasl_conn_.get()));
+  }
+  negotiated_mech_ = SaslMechanism::PLAIN;
+
+  SaslMessagePB::SaslAuth auth;
+  auth.set_mechanism(kSaslMechPlain);
+  RETURN_NOT_OK(SendInitiateMessage(auth, init_msg, init_msg_len));
+  initiate_sent_ = true;
+  return Status::OK();
+}
+
 Status SaslClient::SendResponseMessage(const char* resp_msg, unsigned resp_msg_len) {
   SaslMessagePB reply;
   reply.set_state(SaslMessagePB::RESPONSE);
@@ -330,6 +361,17 @@ Status SaslClient::HandleNegotiateResponse(const SaslMessagePB& response) {
   }
   TRACE("SASL Client: Server mech list: $0", mech_list);
 
+  if (initiate_sent_) {
+    // We already started PLAIN authentication; the server's reply to our
+    // INITIATE message follows this one.
+    if (PREDICT_FALSE(!ContainsKey(mech_auth_map, kSaslMechPlain))) {
+      return Status::NotSupported("Server does not support optimistic PLAIN authentication",
+                                  mech_list);
+    }
+    nego_response_expected_ = true;
+    return Status::OK();
+  }
+
   const char* init_msg = nullptr;
   unsigned init_msg_len = 0;
   const char* negotiated_mech = nullptr;
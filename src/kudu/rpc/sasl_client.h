@@ -85,6 +85,15 @@ class SaslClient {
   // Get deadline for connection negotiation.
   const MonoTime& deadline() const { return deadline_; }
 
+  // If enabled, and PLAIN authentication is enabled, Negotiate() sends the
+  // PLAIN INITIATE request right behind the NEGOTIATE request instead of
+  // waiting for the server's list of mechanisms. This saves a round trip, but
+  // fails negotiation against servers which do not offer PLAIN.
+  // Must be called before Negotiate().
+  void set_optimistic_plain(bool optimistic_plain) {
+    optimistic_plain_ = optimistic_plain;
+  }
+
   // Initialize a new SASL client. Must be called before Negotiate().
   // Returns OK on success, otherwise RuntimeError.
   Status Init(const string& service_type);
@@ -121,6 +130,10 @@ class SaslClient {
   Status SendInitiateMessage(const SaslMessagePB_SaslAuth& auth,
                              const char* init_msg, unsigned init_msg_len);
 
+  // Start PLAIN authentication and send the INITIATE message to the server
+  // without waiting for the response to our NEGOTIATE message.
+  Status SendOptimisticPlainInitiate();
+
   // Send a RESPONSE message to the server.
   Status SendResponseMessage(const char* resp_msg, unsigned resp_msg_len);
 
@@ -161,9 +174,13 @@ class SaslClient {
   // The mechanism we negotiated with the server.
   SaslMechanism::Type negotiated_mech_;
 
+  // Whether to send the PLAIN INITIATE message without waiting for the server.
+  bool optimistic_plain_;
+
   // Intra-negotiation state.
   bool nego_ok_;  // During negotiation: did we get a SASL_OK response from the SASL library?
   bool nego_response_expected_;  // During negotiation: Are we waiting for a server response?
+  bool initiate_sent_;  // During negotiation: Did we send INITIATE before the NEGOTIATE response?
 
   // Negotiation timeout deadline.
   MonoTime deadline_;
@@ -135,6 +135,22 @@ TEST_F(TestSaslRpc, TestPlainNegotiation) {
   RunNegotiationTest(RunPlainNegotiationServer, RunPlainNegotiationClient);
 }
 
+static void RunOptimisticPlainNegotiationClient(Socket* conn) {
+  SaslClient sasl_client(kSaslAppName, conn->GetFd());
+  CHECK_OK(sasl_client.Init(kSaslAppName));
+  CHECK_OK(sasl_client.EnablePlain("danger", "burrito"));
+  sasl_client.set_optimistic_plain(true);
+  CHECK_OK(sasl_client.Negotiate());
+  CHECK_EQ(SaslMechanism::PLAIN, sasl_client.negotiated_mechanism());
+  CHECK(ContainsKey(sasl_client.server_features(), APPLICATION_FEATURE_FLAGS));
+}
+
+// Test PLAIN negotiation where the client sends INITIATE without waiting for
+// the server's NEGOTIATE response.
+TEST_F(TestSaslRpc, TestOptimisticPlainNegotiation) {
+  RunNegotiationTest(RunPlainNegotiationServer, RunOptimisticPlainNegotiationClient);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 
 static void RunPlainFailingNegotiationServer(Socket* conn) {
@@ -17,20 +17,29 @@
 
 #include "kudu/rpc/serialization.h"
 
+#include <gflags/gflags.h>
 #include <glog/logging.h>
 #include <google/protobuf/message_lite.h>
 #include <google/protobuf/io/coded_stream.h>
+#include <lz4.h>
 
 #include "kudu/gutil/endian.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/gutil/stringprintf.h"
 #include "kudu/rpc/constants.h"
+#include "kudu/util/flag_tags.h"
 #include "kudu/util/faststring.h"
 #include "kudu/util/slice.h"
 #include "kudu/util/status.h"
 
 DECLARE_int32(rpc_max_message_size);
 
+DEFINE_int32(rpc_compression_min_bytes, 4096,
+             "Minimum size of an RPC message body, including sidecars, for it to be "
+             "compressed when compression is enabled for the call.");
+TAG_FLAG(rpc_compression_min_bytes, advanced);
+TAG_FLAG(rpc_compression_min_bytes, runtime);
+
 using google::protobuf::MessageLite;
 using google::protobuf::io::CodedInputStream;
 using google::protobuf::io::CodedOutputStream;
@@ -152,6 +161,69 @@ Status ParseMessage(const Slice& buf,
   return Status::OK();
 }
 
+bool ShouldCompressBody(size_t body_size) {
+  return body_size >= FLAGS_rpc_compression_min_bytes;
+}
+
+bool CompressBody(const std::vector<Slice>& body, faststring* compressed) {
+  // LZ4 compresses a single contiguous buffer, so flatten the body first.
+  faststring flat;
+  size_t body_size = 0;
+  for (const Slice& s : body) {
+    body_size += s.size();
+  }
+  if (PREDICT_FALSE(body_size > LZ4_MAX_INPUT_SIZE)) {
+    return false;
+  }
+  flat.reserve(body_size);
+  for (const Slice& s : body) {
+    flat.append(s.data(), s.size());
+  }
+
+  const int max_len = LZ4_compressBound(body_size);
+  const int max_delim_len = CodedOutputStream::VarintSize32(max_len);
+  compressed->resize(max_delim_len + max_len);
+  int n = LZ4_compress(reinterpret_cast<const char*>(flat.data()),
+                       reinterpret_cast<char*>(compressed->data() + max_delim_len),
+                       body_size);
+  if (n <= 0) {
+    return false;
+  }
+  const int delim_len = CodedOutputStream::VarintSize32(n);
+  if (static_cast<size_t>(delim_len + n) >= body_size) {
+    return false;
+  }
+
+  // Slide the compressed data back if its length turned out to need a
+  // shorter varint than the bound did.
+  if (delim_len != max_delim_len) {
+    memmove(compressed->data() + delim_len, compressed->data() + max_delim_len, n);
+  }
+  CodedOutputStream::WriteVarint32ToArray(n, compressed->data());
+  compressed->resize(delim_len + n);
+  return true;
+}
+
+Status DecompressBody(const Slice& compressed, uint32_t uncompressed_size,
+                      faststring* uncompressed) {
+  if (PREDICT_FALSE(uncompressed_size > static_cast<uint32_t>(FLAGS_rpc_max_message_size))) {
+    return Status::Corruption(
+        Substitute("Compressed message body claims to decompress to $0 bytes, which is larger "
+                   "than the maximum configured RPC message size ($1 bytes)",
+                   uncompressed_size, FLAGS_rpc_max_message_size));
+  }
+  uncompressed->resize(uncompressed_size);
+  int n = LZ4_decompress_safe(reinterpret_cast<const char*>(compressed.data()),
+                              reinterpret_cast<char*>(uncompressed->data()),
+                              compressed.size(), uncompressed_size);
+  if (PREDICT_FALSE(n < 0 || static_cast<uint32_t>(n) != uncompressed_size)) {
+    return Status::Corruption(
+        Substitute("Unable to decompress $0-byte message body to the expected $1 bytes",
+                   compressed.size(), uncompressed_size));
+  }
+  return Status::OK();
+}
+
 void SerializeConnHeader(uint8_t* buf) {
   memcpy(reinterpret_cast<char *>(buf), kMagicNumber, kMagicNumberLength);
   buf += kMagicNumberLength;
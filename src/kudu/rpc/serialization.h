@@ -21,6 +21,8 @@
 #include <inttypes.h>
 #include <string.h>
 
+#include <vector>
+
 namespace google {
 namespace protobuf {
 class MessageLite;
@@ -74,6 +76,24 @@ Status ParseMessage(const Slice& buf,
                     google::protobuf::MessageLite* parsed_header,
                     Slice* parsed_main_message);
 
+// Return true if a message body of 'body_size' bytes is large enough to be
+// worth compressing. See --rpc_compression_min_bytes.
+bool ShouldCompressBody(size_t body_size);
+
+// Compress the concatenation of 'body' with LZ4, storing the result in
+// 'compressed' in the same varint-delimited form that SerializeMessage()
+// produces, so that it can be framed by SerializeHeader() and ParseMessage().
+//
+// Returns false if compression would not shrink the body, in which case the
+// caller should send it uncompressed and the contents of 'compressed' are
+// unspecified.
+bool CompressBody(const std::vector<Slice>& body, faststring* compressed);
+
+// Decompress a body, as returned by ParseMessage(), which was produced by
+// CompressBody() from 'uncompressed_size' bytes of input.
+Status DecompressBody(const Slice& compressed, uint32_t uncompressed_size,
+                      faststring* uncompressed);
+
 // Serialize the RPC connection header (magic number + flags).
 // buf must have 7 bytes available (kMagicNumberLength + kHeaderFlagsLength).
 void SerializeConnHeader(uint8_t* buf);
@@ -18,6 +18,7 @@
 #include "kudu/rpc/service_if.h"
 
 #include <memory>
+#include <mutex>
 #include <string>
 #include <google/protobuf/descriptor.pb.h>
 
@@ -27,6 +28,7 @@
 #include "kudu/rpc/inbound_call.h"
 #include "kudu/rpc/rpc_context.h"
 #include "kudu/rpc/rpc_header.pb.h"
+#include "kudu/gutil/stl_util.h"
 #include "kudu/util/flag_tags.h"
 
 // TODO remove this once we have fully cluster-tested this.
@@ -35,14 +37,61 @@
 DEFINE_bool(enable_exactly_once, true, "Whether to enable exactly once semantics.");
 TAG_FLAG(enable_exactly_once, hidden);
 
+DEFINE_int32(rpc_max_pooled_messages_per_method, 16,
+             "Maximum number of request and of response protobufs to keep for "
+             "reuse by each RPC method. Set to 0 to disable message recycling.");
+TAG_FLAG(rpc_max_pooled_messages_per_method, advanced);
+TAG_FLAG(rpc_max_pooled_messages_per_method, runtime);
+
+DEFINE_int32(rpc_max_pooled_message_bytes, 1024 * 1024,
+             "Protobufs using more than this many bytes of memory are freed "
+             "rather than kept for reuse, so that an occasional large call "
+             "does not pin its memory indefinitely.");
+TAG_FLAG(rpc_max_pooled_message_bytes, advanced);
+TAG_FLAG(rpc_max_pooled_message_bytes, runtime);
+
 using google::protobuf::Message;
 using std::string;
-using std::unique_ptr;
 using strings::Substitute;
 
 namespace kudu {
 namespace rpc {
 
+MessagePool::MessagePool() {
+}
+
+MessagePool::~MessagePool() {
+  STLDeleteElements(&free_);
+}
+
+Message* MessagePool::Acquire(const Message& prototype) {
+  {
+    std::lock_guard<simple_spinlock> l(lock_);
+    if (!free_.empty()) {
+      Message* msg = free_.back();
+      free_.pop_back();
+      return msg;
+    }
+  }
+  return prototype.New();
+}
+
+void MessagePool::Release(Message* msg) {
+  if (msg->SpaceUsed() > FLAGS_rpc_max_pooled_message_bytes) {
+    delete msg;
+    return;
+  }
+  msg->Clear();
+  {
+    std::lock_guard<simple_spinlock> l(lock_);
+    if (free_.size() < static_cast<size_t>(FLAGS_rpc_max_pooled_messages_per_method)) {
+      free_.push_back(msg);
+      return;
+    }
+  }
+  delete msg;
+}
+
 ServiceIf::~ServiceIf() {
 }
 
@@ -88,22 +137,23 @@ GeneratedServiceIf::~GeneratedServiceIf() {
 
 
 void GeneratedServiceIf::Handle(InboundCall *call) {
-  const RpcMethodInfo* method_info = call->method_info();
+  RpcMethodInfo* method_info = call->method_info();
   if (!method_info) {
     RespondBadMethod(call);
     return;
   }
-  unique_ptr<Message> req(method_info->req_prototype->New());
-  if (PREDICT_FALSE(!ParseParam(call, req.get()))) {
+  Message* req = method_info->req_pool.Acquire(*method_info->req_prototype);
+  if (PREDICT_FALSE(!ParseParam(call, req))) {
+    method_info->req_pool.Release(req);
     return;
   }
-  Message* resp = method_info->resp_prototype->New();
+  Message* resp = method_info->resp_pool.Acquire(*method_info->resp_prototype);
 
   bool track_result = call->header().has_request_id()
                       && method_info->track_result
                       && FLAGS_enable_exactly_once;
   RpcContext* ctx = new RpcContext(call,
-                                   req.release(),
+                                   req,
                                    resp,
                                    track_result ? result_tracker_ : nullptr);
   if (track_result) {
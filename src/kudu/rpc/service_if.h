@@ -19,12 +19,15 @@
 
 #include <unordered_map>
 #include <string>
+#include <vector>
 
 #include "kudu/gutil/macros.h"
 #include "kudu/gutil/ref_counted.h"
+#include "kudu/util/locks.h"
 #include "kudu/util/metrics.h"
 #include "kudu/util/net/sockaddr.h"
 #include "kudu/rpc/result_tracker.h"
+#include "kudu/rpc/rpc_header.pb.h"
 
 namespace google {
 namespace protobuf {
@@ -42,6 +45,33 @@ class InboundCall;
 class RemoteMethod;
 class RpcContext;
 
+// A bounded free list of cleared protobuf messages of a single type.
+//
+// Clearing a protobuf message keeps the storage behind its strings and
+// repeated fields, so a message taken from the pool can usually be parsed
+// into without allocating. This matters for requests such as writes, whose
+// nested row operations otherwise cost several allocations per call.
+class MessagePool {
+ public:
+  MessagePool();
+  ~MessagePool();
+
+  // Return an empty message of the same type as 'prototype', reusing a
+  // pooled one if available. The caller owns the result, and should hand it
+  // back with Release() once done with it.
+  google::protobuf::Message* Acquire(const google::protobuf::Message& prototype);
+
+  // Clear 'msg' and keep it for reuse, or delete it if the pool is full or
+  // 'msg' holds on to too much memory. 'msg' must have come from Acquire().
+  void Release(google::protobuf::Message* msg);
+
+ private:
+  simple_spinlock lock_;
+  std::vector<google::protobuf::Message*> free_;
+
+  DISALLOW_COPY_AND_ASSIGN(MessagePool);
+};
+
 // Generated services define an instance of this class for each
 // method that they implement. The generic server code implemented
 // by GeneratedServiceIf look up the RpcMethodInfo in order to handle
@@ -58,6 +88,13 @@ struct RpcMethodInfo : public RefCountedThreadSafe<RpcMethodInfo> {
   // Whether we should track this method's result, using ResultTracker.
   bool track_result;
 
+  // The scheduling class of this method's calls in the service queue.
+  RpcMethodPriorityPB priority = NORMAL_PRIORITY;
+
+  // Recycled request and response messages for this method.
+  MessagePool req_pool;
+  MessagePool resp_pool;
+
   // The actual function to be called.
   std::function<void(const google::protobuf::Message* req,
                      google::protobuf::Message* resp,
@@ -17,8 +17,12 @@
 
 #include "kudu/rpc/service_pool.h"
 
+#include <algorithm>
+#include <gflags/gflags.h>
 #include <glog/logging.h>
+#include <limits>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -29,8 +33,10 @@
 #include "kudu/rpc/service_if.h"
 #include "kudu/rpc/service_queue.h"
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/flag_tags.h"
 #include "kudu/util/logging.h"
 #include "kudu/util/metrics.h"
+#include "kudu/util/numa.h"
 #include "kudu/util/status.h"
 #include "kudu/util/thread.h"
 #include "kudu/util/trace.h"
@@ -38,11 +44,31 @@
 using std::shared_ptr;
 using strings::Substitute;
 
+DEFINE_bool(rpc_queue_admission_control, true,
+            "Whether to reject incoming RPCs whose remaining deadline is shorter "
+            "than the current standing delay of the service queue, rather than "
+            "queueing calls which are expected to time out before being handled.");
+TAG_FLAG(rpc_queue_admission_control, advanced);
+TAG_FLAG(rpc_queue_admission_control, runtime);
+
+DEFINE_int32(rpc_queue_delay_target_ms, 20,
+             "Queue delay that calls may experience for a full measurement "
+             "interval before the service queue is considered overloaded. "
+             "Standing delays shorter than this are ignored by admission control.");
+TAG_FLAG(rpc_queue_delay_target_ms, advanced);
+TAG_FLAG(rpc_queue_delay_target_ms, runtime);
+
+DEFINE_int32(rpc_queue_delay_interval_ms, 100,
+             "Length of the interval over which the minimum queue delay is "
+             "measured to estimate the standing delay of the service queue.");
+TAG_FLAG(rpc_queue_delay_interval_ms, advanced);
+TAG_FLAG(rpc_queue_delay_interval_ms, runtime);
+
 METRIC_DEFINE_histogram(server, rpc_incoming_queue_time,
                         "RPC Queue Time",
                         kudu::MetricUnit::kMicroseconds,
                         "Number of microseconds incoming RPC requests spend in the worker queue",
-                        60000000LU, 3);
+                        60000000LU, 3, kudu::STRIPED_HISTOGRAM);
 
 METRIC_DEFINE_counter(server, rpcs_timed_out_in_queue,
                       "RPC Queue Timeouts",
@@ -56,6 +82,12 @@ METRIC_DEFINE_counter(server, rpcs_queue_overflow,
                       "Number of RPCs dropped because the service queue "
                       "was full.");
 
+METRIC_DEFINE_counter(server, rpcs_rejected_for_queue_delay,
+                      "RPC Queue Delay Rejections",
+                      kudu::MetricUnit::kRequests,
+                      "Number of RPCs rejected on arrival because the standing "
+                      "delay of the service queue exceeded their remaining timeout.");
+
 namespace kudu {
 namespace rpc {
 
@@ -67,6 +99,9 @@ ServicePool::ServicePool(gscoped_ptr<ServiceIf> service,
     incoming_queue_time_(METRIC_rpc_incoming_queue_time.Instantiate(entity)),
     rpcs_timed_out_in_queue_(METRIC_rpcs_timed_out_in_queue.Instantiate(entity)),
     rpcs_queue_overflow_(METRIC_rpcs_queue_overflow.Instantiate(entity)),
+    rpcs_rejected_for_queue_delay_(METRIC_rpcs_rejected_for_queue_delay.Instantiate(entity)),
+    queue_delay_interval_min_us_(std::numeric_limits<int64_t>::max()),
+    standing_queue_delay_us_(0),
     closing_(false) {
 }
 
@@ -78,7 +113,7 @@ Status ServicePool::Init(int num_threads) {
   for (int i = 0; i < num_threads; i++) {
     scoped_refptr<kudu::Thread> new_thread;
     CHECK_OK(kudu::Thread::Create("service pool", "rpc worker",
-        &ServicePool::RunThread, this, &new_thread));
+        &ServicePool::RunThread, this, i, &new_thread));
     threads_.push_back(new_thread);
   }
   return Status::OK();
@@ -121,6 +156,65 @@ void ServicePool::RejectTooBusy(InboundCall* c) {
              << service_queue_.ToString();
 }
 
+void ServicePool::RecordQueueDelay(const InboundCall& c) {
+  const MonoTime& now = c.timing().time_handled;
+  const int64_t delay_us = (now - c.timing().time_received).ToMicroseconds();
+
+  std::lock_guard<simple_spinlock> l(queue_delay_lock_);
+  if (!queue_delay_interval_start_.Initialized()) {
+    queue_delay_interval_start_ = now;
+  }
+  queue_delay_interval_min_us_ = std::min(queue_delay_interval_min_us_, delay_us);
+  if (now - queue_delay_interval_start_ <
+      MonoDelta::FromMilliseconds(FLAGS_rpc_queue_delay_interval_ms)) {
+    return;
+  }
+
+  // Close out the interval. If even the luckiest call waited longer than the
+  // target, a standing queue has built up and every new call can expect to
+  // wait about that long.
+  const int64_t target_us = FLAGS_rpc_queue_delay_target_ms * 1000L;
+  standing_queue_delay_us_.Store(
+      queue_delay_interval_min_us_ > target_us ? queue_delay_interval_min_us_ : 0);
+  queue_delay_interval_start_ = now;
+  queue_delay_interval_min_us_ = std::numeric_limits<int64_t>::max();
+}
+
+bool ServicePool::ExpectedToTimeOutInQueue(const InboundCall& c) const {
+  if (!FLAGS_rpc_queue_admission_control) {
+    return false;
+  }
+  const int64_t delay_us = standing_queue_delay_us_.Load();
+  if (PREDICT_TRUE(delay_us == 0)) {
+    return false;
+  }
+  // The estimate is only refreshed as calls are dequeued, so don't trust it
+  // once the queue has drained.
+  if (service_queue_.estimated_queue_length() == 0) {
+    return false;
+  }
+  const MonoTime deadline = c.GetClientDeadline();
+  if (deadline == MonoTime::Max()) {
+    return false;
+  }
+  return deadline < MonoTime::Now() + MonoDelta::FromMicroseconds(delay_us);
+}
+
+void ServicePool::RejectForQueueDelay(InboundCall* c) {
+  string err_msg =
+      Substitute("$0 request on $1 from $2 dropped due to backpressure. "
+                 "The service queue delay is $3, which exceeds the call's "
+                 "remaining timeout.",
+                 c->remote_method().method_name(),
+                 service_->service_name(),
+                 c->remote_address().ToString(),
+                 StandingQueueDelay().ToString());
+  rpcs_rejected_for_queue_delay_->Increment();
+  KLOG_EVERY_N_SECS(WARNING, 1) << err_msg;
+  c->RespondFailure(ErrorStatusPB::ERROR_SERVER_TOO_BUSY,
+                    Status::ServiceUnavailable(err_msg));
+}
+
 RpcMethodInfo* ServicePool::LookupMethod(const RemoteMethod& method) {
   return service_->LookupMethod(method);
 }
@@ -140,6 +234,11 @@ Status ServicePool::QueueInboundCall(gscoped_ptr<InboundCall> call) {
     return Status::NotSupported("call requires unsupported application feature flags");
   }
 
+  if (PREDICT_FALSE(ExpectedToTimeOutInQueue(*c))) {
+    RejectForQueueDelay(c);
+    return Status::OK();
+  }
+
   TRACE_TO(c->trace(), "Inserting onto call queue");
 
   // Queue message on service queue
@@ -172,7 +271,8 @@ Status ServicePool::QueueInboundCall(gscoped_ptr<InboundCall> call) {
   return status;
 }
 
-void ServicePool::RunThread() {
+void ServicePool::RunThread(int index) {
+  MaybeBindThreadToNumaNode("service pool", index);
   while (true) {
     std::unique_ptr<InboundCall> incoming;
     if (!service_queue_.BlockingGet(&incoming)) {
@@ -181,6 +281,7 @@ void ServicePool::RunThread() {
     }
 
     incoming->RecordHandlingStarted(incoming_queue_time_);
+    RecordQueueDelay(*incoming);
     ADOPT_TRACE(incoming->trace());
 
     if (PREDICT_FALSE(incoming->ClientTimedOut())) {
@@ -26,6 +26,9 @@
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/rpc/rpc_service.h"
 #include "kudu/rpc/service_queue.h"
+#include "kudu/util/atomic.h"
+#include "kudu/util/locks.h"
+#include "kudu/util/monotime.h"
 #include "kudu/util/mutex.h"
 #include "kudu/util/thread.h"
 #include "kudu/util/status.h"
@@ -73,18 +76,53 @@ class ServicePool : public RpcService {
     return rpcs_queue_overflow_.get();
   }
 
+  const Counter* RpcsRejectedForQueueDelayMetricForTests() const {
+    return rpcs_rejected_for_queue_delay_.get();
+  }
+
+  // Return the current estimate of the standing queue delay: the shortest
+  // time any call spent in the queue during the last measurement interval,
+  // or zero if that stayed under --rpc_queue_delay_target_ms.
+  MonoDelta StandingQueueDelay() const {
+    return MonoDelta::FromMicroseconds(standing_queue_delay_us_.Load());
+  }
+
   const std::string service_name() const;
 
  private:
-  void RunThread();
+  // Runs the loop of worker thread 'index' of the pool.
+  void RunThread(int index);
   void RejectTooBusy(InboundCall* c);
 
+  // Feed the time a call just spent in the queue into the standing queue
+  // delay estimate.
+  void RecordQueueDelay(const InboundCall& c);
+
+  // Return true if 'c' would likely pass its deadline before a service thread
+  // got to it, given the standing queue delay.
+  bool ExpectedToTimeOutInQueue(const InboundCall& c) const;
+
+  // Reject 'c' because ExpectedToTimeOutInQueue() returned true.
+  void RejectForQueueDelay(InboundCall* c);
+
   gscoped_ptr<ServiceIf> service_;
   std::vector<scoped_refptr<kudu::Thread> > threads_;
   LifoServiceQueue service_queue_;
   scoped_refptr<Histogram> incoming_queue_time_;
   scoped_refptr<Counter> rpcs_timed_out_in_queue_;
   scoped_refptr<Counter> rpcs_queue_overflow_;
+  scoped_refptr<Counter> rpcs_rejected_for_queue_delay_;
+
+  // State for estimating the standing queue delay, in the manner of CoDel:
+  // the minimum queue time seen over an interval is the delay that every
+  // call is paying, as opposed to a burst which drains within the interval.
+  simple_spinlock queue_delay_lock_;
+  MonoTime queue_delay_interval_start_;
+  int64_t queue_delay_interval_min_us_;
+
+  // The estimate computed at the end of the last interval. Read without
+  // locking on the enqueue path.
+  AtomicInt<int64_t> standing_queue_delay_us_;
 
   mutable Mutex shutdown_lock_;
   bool closing_;
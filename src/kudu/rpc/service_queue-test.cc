@@ -140,5 +140,43 @@ TEST(TestServiceQueue, LifoServiceQueuePerf) {
   LOG(INFO) << "Avg idle workers:     " << total_idle_workers / static_cast<double>(total_sample);
 }
 
+// Calls from more important methods are dequeued first, and the least
+// important calls are the first to be shed when the queue is full.
+TEST(TestServiceQueue, TestPriorityClasses) {
+  LifoServiceQueue queue(2);
+  auto make_call = [](RpcMethodPriorityPB priority) {
+    scoped_refptr<RpcMethodInfo> info(new RpcMethodInfo());
+    info->priority = priority;
+    InboundCall* call = new InboundCall(nullptr);
+    call->set_method_info(std::move(info));
+    return call;
+  };
+
+  boost::optional<InboundCall*> evicted;
+  ASSERT_EQ(QUEUE_SUCCESS, queue.Put(make_call(LOW_PRIORITY), &evicted));
+  ASSERT_EQ(QUEUE_SUCCESS, queue.Put(make_call(NORMAL_PRIORITY), &evicted));
+  ASSERT_TRUE(evicted == boost::none);
+
+  // A high priority call bumps the low priority one out of the full queue.
+  ASSERT_EQ(QUEUE_SUCCESS, queue.Put(make_call(HIGH_PRIORITY), &evicted));
+  ASSERT_TRUE(evicted != boost::none);
+  ASSERT_EQ(LOW_PRIORITY, evicted.get()->method_info()->priority);
+  delete evicted.get();
+  evicted = boost::none;
+
+  // A low priority call is rejected outright.
+  unique_ptr<InboundCall> rejected(make_call(LOW_PRIORITY));
+  ASSERT_EQ(QUEUE_FULL, queue.Put(rejected.get(), &evicted));
+  ASSERT_TRUE(evicted == boost::none);
+
+  unique_ptr<InboundCall> call;
+  ASSERT_TRUE(queue.BlockingGet(&call));
+  ASSERT_EQ(HIGH_PRIORITY, call->method_info()->priority);
+  ASSERT_TRUE(queue.BlockingGet(&call));
+  ASSERT_EQ(NORMAL_PRIORITY, call->method_info()->priority);
+  ASSERT_TRUE(queue.empty());
+  queue.Shutdown();
+}
+
 } // namespace rpc
 } // namespace kudu
@@ -17,6 +17,7 @@
 
 #include "kudu/rpc/service_queue.h"
 
+#include <iterator>
 #include <mutex>
 
 #include "kudu/util/logging.h"
@@ -49,9 +50,7 @@ bool LifoServiceQueue::BlockingGet(std::unique_ptr<InboundCall>* out) {
     {
       std::lock_guard<simple_spinlock> l(lock_);
       if (!queue_.empty()) {
-        auto it = queue_.begin();
-        out->reset(*it);
-        queue_.erase(it);
+        out->reset(EraseUnlocked(queue_.begin()));
         return true;
       }
       if (PREDICT_FALSE(shutdown_)) {
@@ -93,20 +92,70 @@ QueueStatus LifoServiceQueue::Put(InboundCall* call,
   if (PREDICT_FALSE(queue_.size() >= max_queue_size_)) {
     // eviction
     DCHECK_EQ(queue_.size(), max_queue_size_);
-    auto it = queue_.end();
-    --it;
-    if (DeadlineLess(*it, call)) {
+    auto it = PickEvictionVictimUnlocked(call);
+    if (it == queue_.end()) {
       return QUEUE_FULL;
     }
-
-    *evicted = *it;
-    queue_.erase(it);
+    *evicted = EraseUnlocked(it);
   }
 
   queue_.insert(call);
+  queued_per_client_[ClientKey(call)]++;
   return QUEUE_SUCCESS;
 }
 
+InboundCall* LifoServiceQueue::EraseUnlocked(CallQueue::iterator it) {
+  InboundCall* call = *it;
+  queue_.erase(it);
+  auto count = queued_per_client_.find(ClientKey(call));
+  DCHECK(count != queued_per_client_.end());
+  if (--count->second == 0) {
+    queued_per_client_.erase(count);
+  }
+  return call;
+}
+
+LifoServiceQueue::CallQueue::iterator LifoServiceQueue::PickEvictionVictimUnlocked(
+    const InboundCall* call) {
+  DCHECK(!queue_.empty());
+  const auto new_priority = Priority(call);
+  const auto lowest = Priority(*queue_.rbegin());
+  if (new_priority < lowest) {
+    // The new call is less important than everything already queued.
+    return queue_.end();
+  }
+
+  // A client's load is the number of its calls queued, counting 'call' as
+  // though it had been queued too.
+  const uint32_t new_client = ClientKey(call);
+  auto load_of = [&](uint32_t client) {
+    auto it = queued_per_client_.find(client);
+    int load = it == queued_per_client_.end() ? 0 : it->second;
+    return client == new_client ? load + 1 : load;
+  };
+
+  // Start with the new call as the candidate if it competes with the lowest
+  // class, then walk that class from the latest deadline backwards looking for
+  // a call from a more heavily loaded client.
+  bool victim_is_new = new_priority == lowest;
+  int victim_load = victim_is_new ? load_of(new_client) : -1;
+  auto victim = queue_.rend();
+  for (auto it = queue_.rbegin(); it != queue_.rend() && Priority(*it) == lowest; ++it) {
+    int load = load_of(ClientKey(*it));
+    if (load > victim_load ||
+        (load == victim_load && victim_is_new && DeadlineLess(call, *it))) {
+      victim = it;
+      victim_load = load;
+      victim_is_new = false;
+    }
+  }
+  if (victim_is_new) {
+    return queue_.end();
+  }
+  DCHECK(victim != queue_.rend());
+  return std::prev(victim.base());
+}
+
 void LifoServiceQueue::Shutdown() {
   std::lock_guard<simple_spinlock> l(lock_);
   shutdown_ = true;
@@ -21,9 +21,11 @@
 #include <memory>
 #include <string>
 #include <set>
+#include <unordered_map>
 #include <vector>
 
 #include "kudu/rpc/inbound_call.h"
+#include "kudu/rpc/service_if.h"
 #include "kudu/util/condition_variable.h"
 #include "kudu/util/mutex.h"
 
@@ -76,10 +78,19 @@ class LifoServiceQueue {
   bool BlockingGet(std::unique_ptr<InboundCall>* out);
 
   // Add a new call to the queue.
+  //
+  // Queued calls are dequeued in order of their method's priority class
+  // (see RpcMethodInfo::priority), and by deadline within a class.
+  //
+  // When the queue is full, the call to shed is picked from the lowest
+  // priority class present. Within that class, calls from the client with
+  // the most calls queued are shed first, so that a single busy client
+  // cannot crowd out everyone else; ties are broken by latest deadline.
+  //
   // Returns:
   // - QUEUE_SHUTDOWN if Shutdown() has already been called.
-  // - QUEUE_FULL if the queue is full and 'call' has a later deadline than any
-  //   RPC already in the queue.
+  // - QUEUE_FULL if the queue is full and 'call' itself is the one that
+  //   would be shed.
   // - QUEUE_SUCCESS if 'call' was enqueued.
   //
   // In the case of a 'QUEUE_SUCCESS' response, the new element may have bumped
@@ -122,9 +133,32 @@ class LifoServiceQueue {
   }
 
  private:
-  // Comparison function which orders calls by their deadlines.
+  // Return the scheduling class of 'call'. Calls which have not been
+  // associated with a method are treated as normal priority.
+  static RpcMethodPriorityPB Priority(const InboundCall* call) {
+    const RpcMethodInfo* info = call->method_info();
+    return info ? info->priority : NORMAL_PRIORITY;
+  }
+
+  // Return a key identifying the client host which sent 'call'. The port is
+  // ignored, so that all connections from one host are treated as a single
+  // client.
+  static uint32_t ClientKey(const InboundCall* call) {
+    if (!call->connection()) {
+      return 0;
+    }
+    return call->remote_address().addr().sin_addr.s_addr;
+  }
+
+  // Comparison function which orders calls by their priority class, highest
+  // first, and then by their deadlines.
   static bool DeadlineLess(const InboundCall* a,
                            const InboundCall* b) {
+    auto prio_a = Priority(a);
+    auto prio_b = Priority(b);
+    if (prio_a != prio_b) {
+      return prio_a > prio_b;
+    }
     auto time_a = a->GetClientDeadline();
     auto time_b = b->GetClientDeadline();
     if (time_a == time_b) {
@@ -143,6 +177,17 @@ class LifoServiceQueue {
     }
   };
 
+  typedef std::multiset<InboundCall*, DeadlineLessStruct> CallQueue;
+
+  // Remove the call at 'it' from the queue, updating the per-client counts.
+  // Returns the removed call.
+  InboundCall* EraseUnlocked(CallQueue::iterator it);
+
+  // Return the queued call which should be shed to make room for 'call', or
+  // queue_.end() if 'call' itself should be rejected.
+  CallQueue::iterator PickEvictionVictimUnlocked(
+      const InboundCall* call);
+
   // The thread-local record corresponding to a single consumer thread.
   // Threads push this record onto the waiting_consumers_ stack when
   // they are awaiting work. Producers pop the top waiting consumer and
@@ -201,7 +246,10 @@ class LifoServiceQueue {
 
   // The actual queue. Work is only added to the queue when there were no
   // consumers available for a "direct hand-off".
-  std::multiset<InboundCall*, DeadlineLessStruct> queue_;
+  CallQueue queue_;
+
+  // The number of calls in 'queue_' from each client, keyed by ClientKey().
+  std::unordered_map<uint32_t, int> queued_per_client_;
 
   // The total set of consumers who have ever accessed this queue.
   std::vector<std::unique_ptr<ConsumerState>> consumers_;
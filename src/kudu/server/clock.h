@@ -62,6 +62,14 @@ class Clock : public RefCountedThreadSafe<Clock> {
     return Status::NotSupported("clock does not support global properties");
   }
 
+  // Obtain a timestamp which is guaranteed to be earlier than any time that
+  // any machine in the cluster may assign from now on.
+  //
+  // NOTE: like GetGlobalLatest(), this is not a very tight bound.
+  virtual Status GetGlobalEarliest(Timestamp* t) {
+    return Status::NotSupported("clock does not support global properties");
+  }
+
   // Indicates whether this clock supports the required external consistency mode.
   virtual bool SupportsExternalConsistencyMode(ExternalConsistencyMode mode) = 0;
 
@@ -99,6 +107,14 @@ class Clock : public RefCountedThreadSafe<Clock> {
   // Strigifies the provided timestamp according to this clock's internal format.
   virtual std::string Stringify(Timestamp timestamp) = 0;
 
+  // Returns an upper bound on the rate at which this machine's clock may run
+  // fast or slow, e.g. 0.0005 for 500 ppm. Intervals measured on different
+  // machines may differ by up to twice this fraction. Defaults to 500 ppm,
+  // the frequency tolerance of the Linux kernel clock.
+  virtual double MaxDriftRate() {
+    return 0.0005;
+  }
+
   virtual ~Clock() {}
 };
 
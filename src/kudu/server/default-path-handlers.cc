@@ -31,6 +31,7 @@
 
 #include "kudu/gutil/map-util.h"
 #include "kudu/gutil/strings/human_readable.h"
+#include "kudu/gutil/strings/numbers.h"
 #include "kudu/gutil/strings/split.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/server/pprof-path-handlers.h"
@@ -204,6 +205,44 @@ static void WriteMetricsAsJson(const MetricRegistry* const metrics,
               "Couldn't write JSON metrics over HTTP");
 }
 
+// Writes the metrics in the Prometheus text format.
+//
+// Besides the 'metrics' filter of the JSON handler, this accepts 'types', a
+// comma-separated list of entity types to include, and 'modified_since_epoch'.
+// The first line of the output is a comment with the epoch to pass as
+// 'modified_since_epoch' to the next scrape in order to only get the metrics
+// which changed in the meantime.
+static void WriteMetricsAsPrometheus(const MetricRegistry* const metrics,
+                                     const Webserver::WebRequest& req,
+                                     std::ostringstream* output) {
+  const string* requested_metrics_param = FindOrNull(req.parsed_args, "metrics");
+  vector<string> requested_metrics;
+  MetricPrometheusOptions opts;
+
+  const string* types_param = FindOrNull(req.parsed_args, "types");
+  if (types_param != nullptr) {
+    SplitStringUsing(*types_param, ",", &opts.entity_types);
+  }
+  const string* epoch_param = FindOrNull(req.parsed_args, "modified_since_epoch");
+  if (epoch_param != nullptr &&
+      !safe_strto64(*epoch_param, &opts.only_modified_in_or_after_epoch)) {
+    *output << "# Invalid modified_since_epoch: " << *epoch_param << "\n";
+    return;
+  }
+
+  if (requested_metrics_param != nullptr) {
+    SplitStringUsing(*requested_metrics_param, ",", &requested_metrics);
+  } else {
+    requested_metrics.push_back("*");
+  }
+
+  // Advance the epoch before reading any metric, so that the ones modified
+  // while they're being written are included again by the next scrape.
+  *output << "# kudu_metrics_epoch " << Metric::IncrementEpoch() << "\n";
+  WARN_NOT_OK(metrics->WriteAsPrometheus(output, requested_metrics, opts),
+              "Couldn't write Prometheus metrics over HTTP");
+}
+
 void RegisterMetricsJsonHandler(Webserver* webserver, const MetricRegistry* const metrics) {
   Webserver::PathHandlerCallback callback = boost::bind(WriteMetricsAsJson, metrics, _1, _2);
   bool not_styled = false;
@@ -214,6 +253,10 @@ void RegisterMetricsJsonHandler(Webserver* webserver, const MetricRegistry* cons
   // The old name -- this is preserved for compatibility with older releases of
   // monitoring software which expects the old name.
   webserver->RegisterPathHandler("/jsonmetricz", "Metrics", callback, not_styled, not_on_nav_bar);
+
+  webserver->RegisterPathHandler("/metrics_prometheus", "Prometheus Metrics",
+                                 boost::bind(WriteMetricsAsPrometheus, metrics, _1, _2),
+                                 not_styled, not_on_nav_bar);
 }
 
 } // namespace kudu
@@ -25,6 +25,9 @@
 #include "kudu/util/random_util.h"
 #include "kudu/util/test_util.h"
 
+DECLARE_bool(hybrid_clock_fast_path);
+DECLARE_int32(hybrid_clock_error_refresh_ms);
+DECLARE_int32(max_clock_sync_error_usec);
 DECLARE_bool(use_mock_wall_clock);
 
 namespace kudu {
@@ -129,6 +132,35 @@ TEST_F(HybridClockTest, TestNow_ValuesIncreaseMonotonically) {
   ASSERT_LT(now1.value(), now2.value());
 }
 
+// Test that the fast path, which only samples the clock error periodically,
+// returns increasing timestamps close to those of the regular path, with an
+// error that grows with the age of the sample.
+TEST_F(HybridClockTest, TestFastPath) {
+  google::FlagSaver saver;
+  FLAGS_hybrid_clock_fast_path = true;
+  FLAGS_hybrid_clock_error_refresh_ms = 10;
+  scoped_refptr<HybridClock> fast_clock(new HybridClock());
+  ASSERT_OK(fast_clock->Init());
+
+  Timestamp prev;
+  uint64_t error;
+  fast_clock->NowWithError(&prev, &error);
+  for (int i = 0; i < 1000; i++) {
+    Timestamp now;
+    fast_clock->NowWithError(&now, &error);
+    ASSERT_LT(prev.value(), now.value());
+    ASSERT_GT(error, 0);
+    ASSERT_LE(error, FLAGS_max_clock_sync_error_usec);
+    prev = now;
+    if (i % 100 == 0) {
+      SleepFor(MonoDelta::FromMilliseconds(1));
+    }
+  }
+  int64_t delta_us = HybridClock::GetPhysicalValueMicros(clock_->Now()) -
+      HybridClock::GetPhysicalValueMicros(fast_clock->Now());
+  ASSERT_LT(std::abs(delta_us), 1000 * 1000);
+}
+
 // Tests the clock updates with the incoming value if it is higher.
 TEST_F(HybridClockTest, TestUpdate_LogicalValueIncreasesByAmount) {
   Timestamp now = clock_->Now();
@@ -18,6 +18,7 @@
 #include "kudu/server/hybrid_clock.h"
 
 #include <algorithm>
+#include <cmath>
 #include <glog/logging.h>
 #include <mutex>
 
@@ -31,9 +32,11 @@
 #include "kudu/util/logging.h"
 #include "kudu/util/metrics.h"
 #include "kudu/util/status.h"
+#include "kudu/util/thread.h"
 
 #if !defined(__APPLE__)
 #include <sys/timex.h>
+#include <time.h>
 #endif // !defined(__APPLE__)
 
 DEFINE_int32(max_clock_sync_error_usec, 10 * 1000 * 1000, // 10 secs
@@ -52,6 +55,19 @@ DEFINE_bool(use_mock_wall_clock, false,
             "instead of reading time from the system clock, for tests.");
 TAG_FLAG(use_mock_wall_clock, hidden);
 
+DEFINE_bool(hybrid_clock_fast_path, false,
+            "Whether HybridClock should read the wall clock with clock_gettime(), "
+            "which is serviced without a syscall, and derive its maximum error "
+            "from a periodic sample of ntp_gettime() instead of calling "
+            "ntp_gettime() on every read. Ignored on OS X.");
+TAG_FLAG(hybrid_clock_fast_path, experimental);
+
+DEFINE_int32(hybrid_clock_error_refresh_ms, 100,
+             "With --hybrid_clock_fast_path, how often the maximum clock error is "
+             "sampled from the kernel. The derived error grows by the kernel's "
+             "clock frequency tolerance for as long as a sample is in use.");
+TAG_FLAG(hybrid_clock_error_refresh_ms, experimental);
+
 METRIC_DEFINE_gauge_uint64(server, hybrid_clock_timestamp,
                            "Hybrid Clock Timestamp",
                            kudu::MetricUnit::kMicroseconds,
@@ -133,7 +149,11 @@ const uint64_t HybridClock::kNanosPerSec = 1000000;
 const double HybridClock::kAdjtimexScalingFactor = 65536;
 
 HybridClock::HybridClock()
-    : mock_clock_time_usec_(0),
+    :
+#if !defined(__APPLE__)
+      stop_error_refresher_(1),
+#endif
+      mock_clock_time_usec_(0),
       mock_clock_max_error_usec_(0),
 #if !defined(__APPLE__)
       divisor_(1),
@@ -143,6 +163,15 @@ HybridClock::HybridClock()
       state_(kNotInitialized) {
 }
 
+HybridClock::~HybridClock() {
+#if !defined(__APPLE__)
+  if (error_refresher_) {
+    stop_error_refresher_.CountDown();
+    CHECK_OK(ThreadJoiner(error_refresher_.get()).Join());
+  }
+#endif
+}
+
 Status HybridClock::Init() {
   if (PREDICT_FALSE(FLAGS_use_mock_wall_clock)) {
     LOG(WARNING) << "HybridClock set to mock the wall clock.";
@@ -174,9 +203,18 @@ Status HybridClock::Init() {
   // Tolerance comes in parts per million but needs to be applied a scaling factor.
   tolerance_adjustment_ = (1 + ((timex.tolerance / kAdjtimexScalingFactor) / 1000000.0));
 
+  if (FLAGS_hybrid_clock_fast_path) {
+    RefreshErrorSample();
+    RETURN_NOT_OK(error_sample_.status);
+    RETURN_NOT_OK(Thread::Create("server", "clock-error-refresher",
+                                 &HybridClock::ErrorRefresherThread, this,
+                                 &error_refresher_));
+  }
+
   LOG(INFO) << "HybridClock initialized. Resolution in nanos?: " << (divisor_ == 1000)
             << " Wait times tolerance adjustment: " << tolerance_adjustment_
-            << " Current error: " << error_usec;
+            << " Current error: " << error_usec
+            << " Fast path: " << (error_refresher_ != nullptr);
 #endif // defined(__APPLE__)
 
   state_ = kInitialized;
@@ -216,6 +254,22 @@ Status HybridClock::GetGlobalLatest(Timestamp* t) {
   return Status::OK();
 }
 
+Status HybridClock::GetGlobalEarliest(Timestamp* t) {
+  Timestamp now;
+  uint64_t error;
+  NowWithError(&now, &error);
+  // The true time is at least 'now - error', and no other machine's clock may
+  // be more than 'max_clock_sync_error_usec' behind it.
+  uint64_t margin = error + FLAGS_max_clock_sync_error_usec;
+  uint64_t now_physical = GetPhysicalValueMicros(now);
+  if (now_physical <= margin) {
+    *t = Timestamp::kMin;
+    return Status::OK();
+  }
+  *t = TimestampFromMicroseconds(now_physical - margin);
+  return Status::OK();
+}
+
 void HybridClock::NowWithError(Timestamp* timestamp, uint64_t* max_error_usec) {
 
   DCHECK_EQ(state_, kInitialized) << "Clock not initialized. Must call Init() first.";
@@ -394,11 +448,15 @@ kudu::Status HybridClock::WalltimeWithError(uint64_t* now_usec, uint64_t* error_
     *error_usec = 0;
   }
 #else
-    // Read the time. This will return an error if the clock is not synchronized.
-    ntptimeval timeval;
-    RETURN_NOT_OK(GetClockTime(&timeval));
-    *now_usec = timeval.time.tv_sec * kNanosPerSec + timeval.time.tv_usec / divisor_;
-    *error_usec = timeval.maxerror;
+    if (error_refresher_) {
+      RETURN_NOT_OK(FastWalltimeWithError(now_usec, error_usec));
+    } else {
+      // Read the time. This will return an error if the clock is not synchronized.
+      ntptimeval timeval;
+      RETURN_NOT_OK(GetClockTime(&timeval));
+      *now_usec = timeval.time.tv_sec * kNanosPerSec + timeval.time.tv_usec / divisor_;
+      *error_usec = timeval.maxerror;
+    }
   }
 
   // If the clock is synchronized but has max_error beyond max_clock_sync_error_usec
@@ -411,6 +469,58 @@ kudu::Status HybridClock::WalltimeWithError(uint64_t* now_usec, uint64_t* error_
   return kudu::Status::OK();
 }
 
+#if !defined(__APPLE__)
+Status HybridClock::FastWalltimeWithError(uint64_t* now_usec, uint64_t* error_usec) {
+  ErrorSample sample;
+  {
+    std::lock_guard<simple_spinlock> l(error_sample_lock_);
+    sample = error_sample_;
+  }
+  // Don't let the error rest on a sample that the refresher thread failed to
+  // replace in time, e.g. because it wasn't scheduled.
+  int64_t age_us = (MonoTime::Now() - sample.taken).ToMicroseconds();
+  if (PREDICT_FALSE(age_us > 10 * 1000LL * FLAGS_hybrid_clock_error_refresh_ms)) {
+    RefreshErrorSample();
+    std::lock_guard<simple_spinlock> l(error_sample_lock_);
+    sample = error_sample_;
+    age_us = 0;
+  }
+  RETURN_NOT_OK(sample.status);
+
+  timespec ts;
+  if (PREDICT_FALSE(clock_gettime(CLOCK_REALTIME, &ts) != 0)) {
+    return Status::ServiceUnavailable("Error reading clock. clock_gettime() failed",
+                                      ErrnoToString(errno));
+  }
+  *now_usec = ts.tv_sec * kNanosPerSec + ts.tv_nsec / 1000;
+  // Round the growth up, and add a microsecond for the truncation of the
+  // clock reads.
+  *error_usec = sample.max_error_usec +
+      static_cast<uint64_t>(std::ceil(std::max<int64_t>(age_us, 0) * MaxDriftRate())) + 1;
+  return Status::OK();
+}
+
+void HybridClock::RefreshErrorSample() {
+  ErrorSample sample;
+  // Take the time of the sample first, so that its age is never underestimated.
+  sample.taken = MonoTime::Now();
+  ntptimeval timeval;
+  sample.status = GetClockTime(&timeval);
+  if (sample.status.ok()) {
+    sample.max_error_usec = timeval.maxerror;
+  }
+  std::lock_guard<simple_spinlock> l(error_sample_lock_);
+  error_sample_ = std::move(sample);
+}
+
+void HybridClock::ErrorRefresherThread() {
+  while (!stop_error_refresher_.WaitFor(
+      MonoDelta::FromMilliseconds(FLAGS_hybrid_clock_error_refresh_ms))) {
+    RefreshErrorSample();
+  }
+}
+#endif // !defined(__APPLE__)
+
 void HybridClock::SetMockClockWallTimeForTests(uint64_t now_usec) {
   CHECK(FLAGS_use_mock_wall_clock);
   std::lock_guard<simple_spinlock> lock(lock_);
@@ -418,6 +528,15 @@ void HybridClock::SetMockClockWallTimeForTests(uint64_t now_usec) {
   mock_clock_time_usec_ = now_usec;
 }
 
+double HybridClock::MaxDriftRate() {
+  // Before Init(), or where the kernel doesn't report a tolerance, fall back
+  // to the default bound.
+  if (tolerance_adjustment_ <= 1) {
+    return Clock::MaxDriftRate();
+  }
+  return tolerance_adjustment_ - 1;
+}
+
 void HybridClock::SetMockMaxClockErrorForTests(uint64_t max_error_usec) {
   CHECK(FLAGS_use_mock_wall_clock);
   std::lock_guard<simple_spinlock> lock(lock_);
@@ -22,11 +22,16 @@
 
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/server/clock.h"
+#include "kudu/util/countdown_latch.h"
 #include "kudu/util/locks.h"
 #include "kudu/util/metrics.h"
+#include "kudu/util/monotime.h"
 #include "kudu/util/status.h"
 
 namespace kudu {
+
+class Thread;
+
 namespace server {
 
 // The HybridTime clock.
@@ -36,6 +41,7 @@ namespace server {
 class HybridClock : public Clock {
  public:
   HybridClock();
+  virtual ~HybridClock();
 
   virtual Status Init() OVERRIDE;
 
@@ -52,6 +58,12 @@ class HybridClock : public Clock {
   // NOTE: this is not a very tight bound.
   virtual Status GetGlobalLatest(Timestamp* t) OVERRIDE;
 
+  // Obtain a timestamp which is guaranteed to be earlier than any time that
+  // any machine in the cluster may assign from now on.
+  //
+  // NOTE: this is not a very tight bound either.
+  virtual Status GetGlobalEarliest(Timestamp* t) OVERRIDE;
+
   // Updates the clock with a timestamp originating on another machine.
   virtual Status Update(const Timestamp& to_update) OVERRIDE;
 
@@ -121,6 +133,9 @@ class HybridClock : public Clock {
 
   virtual std::string Stringify(Timestamp timestamp) OVERRIDE;
 
+  // Returns the frequency tolerance the kernel reports for the clock.
+  virtual double MaxDriftRate() OVERRIDE;
+
   // Static encoding/decoding methods for timestamps. Public mostly
   // for testing/debugging purposes.
 
@@ -168,6 +183,35 @@ class HybridClock : public Clock {
   // On OS X, the error will always be 0.
   kudu::Status WalltimeWithError(uint64_t* now_usec, uint64_t* error_usec);
 
+#if !defined(__APPLE__)
+  // With --hybrid_clock_fast_path, the wall clock is read with clock_gettime(),
+  // which doesn't need a syscall, and the maximum error is derived from the
+  // last sample of ntp_gettime(), taken periodically by 'error_refresher_'.
+  // Since the kernel grows its error estimate by at most the maximum
+  // frequency error of the clock, adding that growth since the sample was
+  // taken yields a bound no tighter than ntp_gettime() itself would report.
+  struct ErrorSample {
+    Status status;
+    MonoTime taken;
+    uint64_t max_error_usec = 0;
+  };
+
+  // Reads the wall clock as above, using the last error sample.
+  Status FastWalltimeWithError(uint64_t* now_usec, uint64_t* error_usec);
+
+  // Takes a new error sample.
+  void RefreshErrorSample();
+
+  // Body of 'error_refresher_'.
+  void ErrorRefresherThread();
+
+  simple_spinlock error_sample_lock_;
+  ErrorSample error_sample_;
+
+  CountDownLatch stop_error_refresher_;
+  scoped_refptr<Thread> error_refresher_;
+#endif
+
   // Used to get the timestamp for metrics.
   uint64_t NowForMetrics();
 
@@ -25,6 +25,7 @@
 
 #include "kudu/gutil/map-util.h"
 #include "kudu/gutil/strings/numbers.h"
+#include "kudu/rpc/call_breakdown.h"
 #include "kudu/rpc/messenger.h"
 #include "kudu/rpc/rpc_introspection.pb.h"
 #include "kudu/rpc/rpcz_store.h"
@@ -57,6 +58,7 @@ void RpczPathHandler(const shared_ptr<Messenger>& messenger,
   {
     DumpRpczStoreRequestPB dump_req;
     messenger->rpcz_store()->DumpPB(dump_req, &sampled_rpcs);
+    messenger->call_breakdown_store()->DumpPB(&sampled_rpcs);
   }
 
   JsonWriter writer(output, JsonWriter::PRETTY);
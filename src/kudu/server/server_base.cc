@@ -25,6 +25,7 @@
 
 #include "kudu/codegen/compilation_manager.h"
 #include "kudu/common/wire_protocol.pb.h"
+#include "kudu/fs/disk_hiccup_monitor.h"
 #include "kudu/fs/fs_manager.h"
 #include "kudu/gutil/strings/strcat.h"
 #include "kudu/gutil/strings/substitute.h"
@@ -52,6 +53,7 @@
 #include "kudu/util/net/sockaddr.h"
 #include "kudu/util/pb_util.h"
 #include "kudu/util/rolling_log.h"
+#include "kudu/util/sampling_profiler.h"
 #include "kudu/util/spinlock_profiling.h"
 #include "kudu/util/thread.h"
 #include "kudu/util/version_info.h"
@@ -314,8 +316,12 @@ Status ServerBase::Start() {
   AddRpczPathHandlers(messenger_, web_server_.get());
   RegisterMetricsJsonHandler(web_server_.get(), metric_registry_.get());
   TracingPathHandlers::RegisterHandlers(web_server_.get());
+  fs_manager_->disk_hiccup_monitor()->RegisterPathHandler(web_server_.get());
+  sampling_profiler_.reset(new SamplingProfiler());
+  sampling_profiler_->RegisterPathHandler(web_server_.get());
   web_server_->set_footer_html(FooterHtml());
   RETURN_NOT_OK(web_server_->Start());
+  RETURN_NOT_OK(sampling_profiler_->Start());
 
   if (!options_.dump_info_path.empty()) {
     RETURN_NOT_OK_PREPEND(DumpServerInfo(options_.dump_info_path, options_.dump_info_format),
@@ -331,6 +337,9 @@ void ServerBase::Shutdown() {
     metrics_logging_thread_->Join();
   }
   web_server_->Stop();
+  if (sampling_profiler_) {
+    sampling_profiler_->Shutdown();
+  }
   rpc_server_->Shutdown();
 }
 
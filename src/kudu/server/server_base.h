@@ -36,6 +36,7 @@ class MetricEntity;
 class MetricRegistry;
 class NodeInstancePB;
 class RpcServer;
+class SamplingProfiler;
 class ScopedGLogMetrics;
 class Sockaddr;
 class Thread;
@@ -131,6 +132,8 @@ class ServerBase {
 
   gscoped_ptr<ScopedGLogMetrics> glog_metrics_;
 
+  gscoped_ptr<SamplingProfiler> sampling_profiler_;
+
   DISALLOW_COPY_AND_ASSIGN(ServerBase);
 };
 
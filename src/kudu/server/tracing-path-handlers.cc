@@ -29,7 +29,10 @@
 #include <rapidjson/rapidjson.h>
 #include <rapidjson/stringbuffer.h>
 
+#include "kudu/gutil/map-util.h"
 #include "kudu/gutil/strings/escaping.h"
+#include "kudu/gutil/strings/numbers.h"
+#include "kudu/util/debug/binary_trace.h"
 #include "kudu/util/debug/trace_event_impl.h"
 #include "kudu/util/jsonwriter.h"
 #include "kudu/util/zlib.h"
@@ -40,6 +43,7 @@ using std::string;
 using std::unique_ptr;
 using std::vector;
 
+using kudu::debug::BinaryTracer;
 using kudu::debug::CategoryFilter;
 using kudu::debug::TraceLog;
 using kudu::debug::TraceResultBuffer;
@@ -57,7 +61,8 @@ enum Handler {
   kGetBufferPercentFull,
   kEndRecording,
   kEndRecordingCompressed,
-  kSimpleDump
+  kSimpleDump,
+  kBinaryDump
 };
 
 namespace {
@@ -200,6 +205,19 @@ void HandleTraceJsonPage(const Webserver::ArgumentMap &args,
   *output << TraceResultBuffer::FlushTraceLogToString();
 }
 
+// Dumps the binary trace events of the last 'window_ms' milliseconds, by
+// default 5000.
+Status HandleBinaryTraceJsonPage(const Webserver::ArgumentMap& args,
+                                 std::ostringstream* output) {
+  int64 window_ms = 5000;
+  const string* window_ms_str = FindOrNull(args, "window_ms");
+  if (window_ms_str && (!safe_strto64(*window_ms_str, &window_ms) || window_ms <= 0)) {
+    return Status::InvalidArgument("Invalid window_ms", *window_ms_str);
+  }
+  BinaryTracer::DumpChromeJson(MonoDelta::FromMilliseconds(window_ms), output);
+  return Status::OK();
+}
+
 Status DoHandleRequest(Handler handler,
                        const Webserver::WebRequest& req,
                        std::ostringstream* output) {
@@ -234,6 +252,9 @@ Status DoHandleRequest(Handler handler,
     case kSimpleDump:
       HandleTraceJsonPage(req.parsed_args, output);
       break;
+    case kBinaryDump:
+      RETURN_NOT_OK(HandleBinaryTraceJsonPage(req.parsed_args, output));
+      break;
   }
 
   return Status::OK();
@@ -268,7 +289,8 @@ void TracingPathHandlers::RegisterHandlers(Webserver* server) {
     { "/tracing/json/get_buffer_percent_full", kGetBufferPercentFull },
     { "/tracing/json/end_recording", kEndRecording },
     { "/tracing/json/end_recording_compressed", kEndRecordingCompressed },
-    { "/tracing/json/simple_dump", kSimpleDump } };
+    { "/tracing/json/simple_dump", kSimpleDump },
+    { "/tracing/binary", kBinaryDump } };
 
   typedef pair<string, Handler> HandlerPair;
   for (const HandlerPair& e : handlers) {
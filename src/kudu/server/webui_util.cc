@@ -108,6 +108,10 @@ void HtmlOutputImpalaSchema(const std::string& table_name,
       case UNIXTIME_MICROS:
         *output << "INT64";
         break;
+      case DECIMAL32:
+      case DECIMAL64:
+        *output << "DECIMAL" << col.type_attributes().ToStringForType(col.type_info()->type());
+        break;
       case FLOAT:
         *output << "FLOAT";
         break;
@@ -0,0 +1,137 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <set>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "kudu/common/columnblock.h"
+#include "kudu/common/types.h"
+#include "kudu/tablet/bitmap_index.h"
+#include "kudu/util/bitmap.h"
+#include "kudu/util/test_util.h"
+
+using std::set;
+using std::string;
+using std::vector;
+
+namespace kudu {
+namespace tablet {
+
+class TestBitmapIndex : public KuduTest {
+ protected:
+  // Check that iterating over [start, start + n) of 'bitmap' yields exactly
+  // the rows of 'expected' in that range, in order.
+  static void CheckRange(const RowIdBitmap& bitmap, const set<rowid_t>& expected,
+                         rowid_t start, size_t n) {
+    vector<rowid_t> rows;
+    bitmap.ForEachInRange(start, n, [&](size_t i) { rows.push_back(start + i); });
+    vector<rowid_t> expected_rows(expected.lower_bound(start),
+                                  expected.lower_bound(start + n));
+    ASSERT_EQ(expected_rows, rows) << "range [" << start << ", " << start + n << ")";
+  }
+};
+
+// Builds a bitmap with both sparse containers, stored as arrays, and dense
+// ones, stored as bitmaps, and checks that its ranges are iterated correctly,
+// including after a round trip through its protobuf.
+TEST_F(TestBitmapIndex, TestRowIdBitmap) {
+  RowIdBitmap bitmap;
+  set<rowid_t> expected;
+  // Every third row of the first two containers, which switch to bitmaps.
+  for (rowid_t row = 0; row < 2 * 65536; row += 3) {
+    bitmap.Add(row);
+    expected.insert(row);
+  }
+  // A few rows of a later container, which remains an array.
+  for (rowid_t row = 5 * 65536 + 10; row < 5 * 65536 + 1000; row += 97) {
+    bitmap.Add(row);
+    expected.insert(row);
+  }
+
+  BitmapIndexPB::EntryPB pb;
+  bitmap.ToPB(&pb);
+  ASSERT_EQ(3, pb.containers_size());
+  EXPECT_TRUE(pb.containers(0).has_bitmap());
+  EXPECT_TRUE(pb.containers(1).has_bitmap());
+  EXPECT_TRUE(pb.containers(2).has_array());
+
+  RowIdBitmap copy;
+  for (const auto& c : pb.containers()) {
+    ASSERT_OK(copy.AppendFromPB(c));
+  }
+
+  for (const RowIdBitmap* b : { &bitmap, &copy }) {
+    NO_FATALS(CheckRange(*b, expected, 0, 100));
+    NO_FATALS(CheckRange(*b, expected, 61, 3));
+    NO_FATALS(CheckRange(*b, expected, 65530, 20));
+    NO_FATALS(CheckRange(*b, expected, 100000, 2 * 65536));
+    NO_FATALS(CheckRange(*b, expected, 3 * 65536, 65536));
+    NO_FATALS(CheckRange(*b, expected, 5 * 65536, 500));
+    NO_FATALS(CheckRange(*b, expected, 0, 6 * 65536));
+  }
+
+  // Containers must be appended in order.
+  ASSERT_TRUE(copy.AppendFromPB(pb.containers(0)).IsCorruption());
+}
+
+// Ensures that the builder groups the rows by value, skipping nulls, and
+// gives up on columns with too many distinct values.
+TEST_F(TestBitmapIndex, TestBuilder) {
+  const TypeInfo* type = GetTypeInfo(UINT32);
+  const int kNumRows = 1000;
+  vector<uint32_t> cells(kNumRows);
+  vector<uint8_t> null_bitmap(BitmapSize(kNumRows), 0xff);
+  for (int i = 0; i < kNumRows; i++) {
+    cells[i] = i % 10;
+    if (i % 100 == 0) {
+      BitmapClear(null_bitmap.data(), i);
+    }
+  }
+  ColumnBlock block(type, null_bitmap.data(), cells.data(), kNumRows, nullptr);
+
+  BitmapIndexBuilder builder(type, 10);
+  builder.AddCells(block);
+  builder.AddCells(block);
+  ASSERT_FALSE(builder.overflowed());
+  BitmapIndexPB pb;
+  builder.ToPB(&pb);
+  EXPECT_EQ(2 * kNumRows, pb.num_rows());
+  ASSERT_EQ(10, pb.entries_size());
+
+  // Value 0 is in the rows which are multiples of 10, but not of 100.
+  RowIdBitmap zeros;
+  for (const auto& c : pb.entries(0).containers()) {
+    ASSERT_OK(zeros.AppendFromPB(c));
+  }
+  vector<rowid_t> rows;
+  zeros.ForEachInRange(0, 2 * kNumRows, [&](size_t i) { rows.push_back(i); });
+  ASSERT_EQ(2 * (kNumRows / 10 - kNumRows / 100), rows.size());
+  for (rowid_t row : rows) {
+    EXPECT_EQ(0, row % 10);
+    EXPECT_NE(0, row % 100);
+  }
+
+  BitmapIndexBuilder small_builder(type, 9);
+  small_builder.AddCells(block);
+  ASSERT_TRUE(small_builder.overflowed());
+}
+
+} // namespace tablet
+} // namespace kudu
@@ -0,0 +1,295 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/tablet/bitmap_index.h"
+
+#include <cstring>
+#include <utility>
+
+#include <glog/logging.h>
+
+#include "kudu/common/column_predicate.h"
+#include "kudu/common/columnblock.h"
+#include "kudu/common/rowblock.h"
+#include "kudu/common/types.h"
+#include "kudu/fs/block_manager.h"
+#include "kudu/fs/fs_manager.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/pb_util.h"
+
+using std::pair;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+using strings::Substitute;
+
+namespace kudu {
+namespace tablet {
+
+////////////////////////////////////////////////////////////
+// RowIdBitmap
+////////////////////////////////////////////////////////////
+
+void RowIdBitmap::Add(rowid_t row) {
+  const uint16_t key = row >> 16;
+  const uint16_t low = row & 0xffff;
+  if (containers_.empty() || containers_.back().key != key) {
+    DCHECK(containers_.empty() || containers_.back().key < key);
+    containers_.emplace_back();
+    containers_.back().key = key;
+  }
+  Container* c = &containers_.back();
+  if (c->bitmap.empty()) {
+    DCHECK(c->array.empty() || c->array.back() < low);
+    if (c->array.size() < kMaxArrayEntries) {
+      c->array.push_back(low);
+      return;
+    }
+    // The array is now larger than a bitmap would be: switch to a bitmap.
+    c->bitmap.assign(kBitmapWords, 0);
+    for (uint16_t v : c->array) {
+      c->bitmap[v / 64] |= 1ULL << (v % 64);
+    }
+    vector<uint16_t>().swap(c->array);
+  }
+  c->bitmap[low / 64] |= 1ULL << (low % 64);
+}
+
+void RowIdBitmap::ToPB(BitmapIndexPB::EntryPB* pb) const {
+  for (const Container& c : containers_) {
+    BitmapIndexPB::ContainerPB* c_pb = pb->add_containers();
+    c_pb->set_key(c.key);
+    if (c.bitmap.empty()) {
+      string* array = c_pb->mutable_array();
+      array->resize(c.array.size() * sizeof(uint16_t));
+      memcpy(&(*array)[0], c.array.data(), array->size());
+    } else {
+      string* bitmap = c_pb->mutable_bitmap();
+      bitmap->resize(c.bitmap.size() * sizeof(uint64_t));
+      memcpy(&(*bitmap)[0], c.bitmap.data(), bitmap->size());
+    }
+  }
+}
+
+Status RowIdBitmap::AppendFromPB(const BitmapIndexPB::ContainerPB& pb) {
+  if (PREDICT_FALSE(pb.key() > 0xffff ||
+                    (!containers_.empty() && containers_.back().key >= pb.key()))) {
+    return Status::Corruption(Substitute("unexpected bitmap container key $0", pb.key()));
+  }
+  if (PREDICT_FALSE(pb.has_array() == pb.has_bitmap())) {
+    return Status::Corruption("bitmap container must have either an array or a bitmap");
+  }
+  Container c;
+  c.key = pb.key();
+  if (pb.has_array()) {
+    const string& array = pb.array();
+    if (PREDICT_FALSE(array.empty() || array.size() % sizeof(uint16_t) != 0 ||
+                      array.size() > kMaxArrayEntries * sizeof(uint16_t))) {
+      return Status::Corruption(Substitute("bad bitmap container array size $0",
+                                           array.size()));
+    }
+    c.array.resize(array.size() / sizeof(uint16_t));
+    memcpy(c.array.data(), array.data(), array.size());
+    if (PREDICT_FALSE(!std::is_sorted(c.array.begin(), c.array.end()) ||
+                      std::adjacent_find(c.array.begin(), c.array.end()) != c.array.end())) {
+      return Status::Corruption("bitmap container array is not strictly increasing");
+    }
+  } else {
+    const string& bitmap = pb.bitmap();
+    if (PREDICT_FALSE(bitmap.size() != kBitmapWords * sizeof(uint64_t))) {
+      return Status::Corruption(Substitute("bad bitmap container bitmap size $0",
+                                           bitmap.size()));
+    }
+    c.bitmap.resize(kBitmapWords);
+    memcpy(c.bitmap.data(), bitmap.data(), bitmap.size());
+  }
+  containers_.emplace_back(std::move(c));
+  return Status::OK();
+}
+
+size_t RowIdBitmap::memory_footprint() const {
+  size_t size = sizeof(*this) + containers_.capacity() * sizeof(Container);
+  for (const Container& c : containers_) {
+    size += c.array.capacity() * sizeof(uint16_t) + c.bitmap.capacity() * sizeof(uint64_t);
+  }
+  return size;
+}
+
+////////////////////////////////////////////////////////////
+// BitmapIndexBuilder
+////////////////////////////////////////////////////////////
+
+BitmapIndexBuilder::BitmapIndexBuilder(const TypeInfo* type_info, int max_cardinality)
+    : type_info_(type_info),
+      max_cardinality_(max_cardinality),
+      num_rows_(0),
+      overflowed_(false),
+      last_bitmap_(nullptr) {
+}
+
+BitmapIndexBuilder::~BitmapIndexBuilder() {}
+
+void BitmapIndexBuilder::AddCells(const ColumnBlock& block) {
+  DCHECK_EQ(type_info_, block.type_info());
+  const bool is_binary = type_info_->physical_type() == BINARY;
+  for (size_t i = 0; i < block.nrows() && !overflowed_; i++) {
+    if (block.is_nullable() && block.is_null(i)) {
+      continue;
+    }
+    const void* cell = block.cell_ptr(i);
+    Slice value = is_binary ? *reinterpret_cast<const Slice*>(cell)
+                            : Slice(reinterpret_cast<const uint8_t*>(cell), type_info_->size());
+    if (last_bitmap_ == nullptr || value != Slice(last_value_)) {
+      unique_ptr<RowIdBitmap>& bitmap = bitmaps_[value.ToString()];
+      if (!bitmap) {
+        if (bitmaps_.size() > static_cast<size_t>(max_cardinality_)) {
+          // Too many distinct values for the index to pay off.
+          overflowed_ = true;
+          bitmaps_.clear();
+          last_bitmap_ = nullptr;
+          break;
+        }
+        bitmap.reset(new RowIdBitmap);
+      }
+      last_value_.assign(reinterpret_cast<const char*>(value.data()), value.size());
+      last_bitmap_ = bitmap.get();
+    }
+    last_bitmap_->Add(num_rows_ + i);
+  }
+  num_rows_ += block.nrows();
+}
+
+void BitmapIndexBuilder::ToPB(BitmapIndexPB* pb) const {
+  DCHECK(!overflowed_);
+  pb->Clear();
+  pb->set_num_rows(num_rows_);
+
+  // Sort the values, so that the index is deterministic.
+  vector<const pair<const string, unique_ptr<RowIdBitmap>>*> entries;
+  entries.reserve(bitmaps_.size());
+  for (const auto& e : bitmaps_) {
+    entries.push_back(&e);
+  }
+  std::sort(entries.begin(), entries.end(),
+            [](const pair<const string, unique_ptr<RowIdBitmap>>* a,
+               const pair<const string, unique_ptr<RowIdBitmap>>* b) {
+              return a->first < b->first;
+            });
+  for (const auto* e : entries) {
+    BitmapIndexPB::EntryPB* entry = pb->add_entries();
+    entry->set_value(e->first);
+    e->second->ToPB(entry);
+  }
+}
+
+////////////////////////////////////////////////////////////
+// BitmapIndexReader
+////////////////////////////////////////////////////////////
+
+BitmapIndexReader::BitmapIndexReader(FsManager* fs, BlockId block_id,
+                                     const TypeInfo* type_info)
+    : fs_(fs),
+      block_id_(std::move(block_id)),
+      type_info_(type_info),
+      cell_size_(type_info->size()) {
+}
+
+BitmapIndexReader::~BitmapIndexReader() {}
+
+Status BitmapIndexReader::Init() {
+  return init_once_.Init(&BitmapIndexReader::InitOnce, this);
+}
+
+Status BitmapIndexReader::InitOnce() {
+  gscoped_ptr<fs::ReadableBlock> block;
+  RETURN_NOT_OK(fs_->OpenBlock(block_id_, &block));
+  uint64_t size;
+  RETURN_NOT_OK(block->Size(&size));
+  unique_ptr<uint8_t[]> scratch(new uint8_t[size]);
+  Slice data;
+  RETURN_NOT_OK(block->Read(0, size, &data, scratch.get()));
+  BitmapIndexPB pb;
+  RETURN_NOT_OK_PREPEND(pb_util::ParseFromArray(&pb, data.data(), data.size()),
+                        Substitute("could not parse bitmap index block $0",
+                                   block_id_.ToString()));
+
+  const bool is_binary = type_info_->physical_type() == BINARY;
+  const int num_values = pb.entries_size();
+  cells_.resize(num_values * cell_size_);
+  if (is_binary) {
+    // Fill in all of the strings before pointing the cells at them, since
+    // growing the vector may move them.
+    binary_values_.reserve(num_values);
+    for (const auto& entry : pb.entries()) {
+      binary_values_.push_back(entry.value());
+    }
+  }
+  for (int i = 0; i < num_values; i++) {
+    const BitmapIndexPB::EntryPB& entry = pb.entries(i);
+    uint8_t* cell = &cells_[i * cell_size_];
+    if (is_binary) {
+      Slice s(binary_values_[i]);
+      memcpy(cell, &s, sizeof(s));
+    } else {
+      if (PREDICT_FALSE(entry.value().size() != cell_size_)) {
+        return Status::Corruption(Substitute("bad value size $0 in bitmap index block $1",
+                                             entry.value().size(), block_id_.ToString()));
+      }
+      memcpy(cell, entry.value().data(), cell_size_);
+    }
+    unique_ptr<RowIdBitmap> bitmap(new RowIdBitmap);
+    for (const auto& c : entry.containers()) {
+      RETURN_NOT_OK_PREPEND(bitmap->AppendFromPB(c),
+                            Substitute("bad bitmap index block $0", block_id_.ToString()));
+    }
+    bitmaps_.emplace_back(std::move(bitmap));
+  }
+  return Status::OK();
+}
+
+void BitmapIndexReader::FindMatchingValues(const ColumnPredicate& pred,
+                                           vector<int>* matches) const {
+  DCHECK(init_once_.initted());
+  matches->clear();
+  if (bitmaps_.empty()) {
+    return;
+  }
+  ColumnBlock block(type_info_, nullptr, const_cast<uint8_t*>(cells_.data()),
+                    bitmaps_.size(), nullptr);
+  SelectionVector sel(bitmaps_.size());
+  sel.SetAllTrue();
+  pred.Evaluate(block, &sel);
+  for (int i = 0; i < bitmaps_.size(); i++) {
+    if (sel.IsRowSelected(i)) {
+      matches->push_back(i);
+    }
+  }
+}
+
+size_t BitmapIndexReader::memory_footprint() const {
+  size_t size = sizeof(*this) + cells_.capacity();
+  for (const string& s : binary_values_) {
+    size += sizeof(s) + s.capacity();
+  }
+  for (const auto& bitmap : bitmaps_) {
+    size += bitmap->memory_footprint();
+  }
+  return size;
+}
+
+} // namespace tablet
+} // namespace kudu
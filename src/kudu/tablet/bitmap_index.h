@@ -0,0 +1,215 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#ifndef KUDU_TABLET_BITMAP_INDEX_H
+#define KUDU_TABLET_BITMAP_INDEX_H
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "kudu/common/rowid.h"
+#include "kudu/fs/block_id.h"
+#include "kudu/gutil/macros.h"
+#include "kudu/gutil/port.h"
+#include "kudu/tablet/metadata.pb.h"
+#include "kudu/util/once.h"
+#include "kudu/util/status.h"
+
+namespace kudu {
+
+class ColumnBlock;
+class ColumnPredicate;
+class FsManager;
+class TypeInfo;
+
+namespace tablet {
+
+// A set of row ordinals, laid out like a roaring bitmap: the ordinals are
+// partitioned by their upper 16 bits into containers, each of which holds
+// either the sorted lower 16 bits of its ordinals, or a bitmap of all 65536
+// of them once that is smaller.
+class RowIdBitmap {
+ public:
+  RowIdBitmap() {}
+
+  // Add 'row', which must be larger than all of the rows added before.
+  void Add(rowid_t row);
+
+  // Call 'f(row - start)' for each row in [start, start + n), in order.
+  template<class F>
+  void ForEachInRange(rowid_t start, size_t n, const F& f) const;
+
+  // Add the containers of this bitmap to 'pb'.
+  void ToPB(BitmapIndexPB::EntryPB* pb) const;
+
+  // Append the container 'pb', whose key must be larger than those of the
+  // containers already added.
+  Status AppendFromPB(const BitmapIndexPB::ContainerPB& pb);
+
+  size_t memory_footprint() const;
+
+ private:
+  // The number of ordinals beyond which a container switches to a bitmap,
+  // where the array would grow past the 8KB of the bitmap.
+  static const int kMaxArrayEntries = 4096;
+  static const int kBitmapWords = 65536 / 64;
+
+  struct Container {
+    uint16_t key;
+    // Empty if the container is a bitmap.
+    std::vector<uint16_t> array;
+    // Either empty, or kBitmapWords words.
+    std::vector<uint64_t> bitmap;
+  };
+
+  std::vector<Container> containers_;
+
+  DISALLOW_COPY_AND_ASSIGN(RowIdBitmap);
+};
+
+// Builds the bitmap index of a column as the rows of a rowset are written.
+//
+// The index has a bitmap for each distinct non-null value of the column, so
+// it is only kept for columns with at most 'max_cardinality' of them.
+class BitmapIndexBuilder {
+ public:
+  BitmapIndexBuilder(const TypeInfo* type_info, int max_cardinality);
+  ~BitmapIndexBuilder();
+
+  // Add the cells of 'block' as the next rows of the column.
+  void AddCells(const ColumnBlock& block);
+
+  // Whether the column has more distinct values than allowed, in which case
+  // there is no index to write.
+  bool overflowed() const { return overflowed_; }
+
+  // Serialize the index. REQUIRES: !overflowed().
+  void ToPB(BitmapIndexPB* pb) const;
+
+ private:
+  const TypeInfo* const type_info_;
+  const int max_cardinality_;
+
+  rowid_t num_rows_;
+  bool overflowed_;
+
+  // The rows of each value, keyed by the value's encoding.
+  std::unordered_map<std::string, std::unique_ptr<RowIdBitmap>> bitmaps_;
+
+  // The bitmap of the last value added, since consecutive rows often share
+  // their value.
+  std::string last_value_;
+  RowIdBitmap* last_bitmap_;
+
+  DISALLOW_COPY_AND_ASSIGN(BitmapIndexBuilder);
+};
+
+// Reads the bitmap index of a column of a rowset. The index is read from its
+// block on the first call to Init().
+class BitmapIndexReader {
+ public:
+  BitmapIndexReader(FsManager* fs, BlockId block_id, const TypeInfo* type_info);
+  ~BitmapIndexReader();
+
+  // Read the index if it hasn't been already. Safe for concurrent use.
+  Status Init();
+
+  // The number of distinct values of the column.
+  int num_values() const {
+    DCHECK(init_once_.initted());
+    return bitmaps_.size();
+  }
+
+  // The in-memory cell of the i-th value: a Slice for BINARY columns.
+  const void* value(int i) const {
+    DCHECK(init_once_.initted());
+    return &cells_[i * cell_size_];
+  }
+
+  const RowIdBitmap& bitmap(int i) const {
+    DCHECK(init_once_.initted());
+    return *bitmaps_[i];
+  }
+
+  // Set 'matches' to the indexes of the values which satisfy 'pred'.
+  void FindMatchingValues(const ColumnPredicate& pred, std::vector<int>* matches) const;
+
+  size_t memory_footprint() const;
+
+ private:
+  Status InitOnce();
+
+  FsManager* const fs_;
+  const BlockId block_id_;
+  const TypeInfo* const type_info_;
+  const size_t cell_size_;
+
+  KuduOnceDynamic init_once_;
+
+  // The cells of the values, back to back, so that they can be evaluated
+  // as a ColumnBlock, and the storage of the BINARY values they point to.
+  std::vector<uint8_t> cells_;
+  std::vector<std::string> binary_values_;
+
+  std::vector<std::unique_ptr<RowIdBitmap>> bitmaps_;
+
+  DISALLOW_COPY_AND_ASSIGN(BitmapIndexReader);
+};
+
+////////////////////////////////////////////////////////////
+// Inline implementations
+////////////////////////////////////////////////////////////
+
+template<class F>
+inline void RowIdBitmap::ForEachInRange(rowid_t start, size_t n, const F& f) const {
+  if (n == 0) return;
+  const uint64_t end = static_cast<uint64_t>(start) + n;
+  auto it = std::lower_bound(containers_.begin(), containers_.end(), start >> 16,
+                             [](const Container& c, uint32_t key) { return c.key < key; });
+  for (; it != containers_.end(); ++it) {
+    const uint64_t base = static_cast<uint64_t>(it->key) << 16;
+    if (base >= end) break;
+    // The range of lower bits of this container which fall in [start, end).
+    const uint32_t lo = start > base ? start - base : 0;
+    const uint32_t hi = std::min<uint64_t>(end - base, 65536);
+    if (it->bitmap.empty()) {
+      auto v = std::lower_bound(it->array.begin(), it->array.end(), lo);
+      for (; v != it->array.end() && *v < hi; ++v) {
+        f(base + *v - start);
+      }
+    } else {
+      for (uint32_t w = lo / 64; w * 64 < hi; w++) {
+        uint64_t bits = it->bitmap[w];
+        // Mask out the bits before 'lo' and from 'hi' in the first and last
+        // words.
+        if (w * 64 < lo) bits &= ~0ULL << (lo % 64);
+        if (w * 64 + 64 > hi) bits &= (1ULL << (hi % 64)) - 1;
+        while (bits != 0) {
+          int b = __builtin_ctzll(bits);
+          f(base + w * 64 + b - start);
+          bits &= bits - 1;
+        }
+      }
+    }
+  }
+}
+
+} // namespace tablet
+} // namespace kudu
+#endif /* KUDU_TABLET_BITMAP_INDEX_H */
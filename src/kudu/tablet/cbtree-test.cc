@@ -15,6 +15,7 @@
 // specific language governing permissions and limitations
 // under the License.
 
+#include <algorithm>
 #include <glog/logging.h>
 #include <gtest/gtest.h>
 #include <thread>
@@ -337,6 +338,60 @@ TEST_F(TestCBTree, TestInsertAndVerifyRandom) {
   }
 }
 
+TEST_F(TestCBTree, TestShortestSeparatorLength) {
+  ASSERT_EQ(1, ShortestSeparatorLength(Slice("abc"), Slice("b")));
+  ASSERT_EQ(3, ShortestSeparatorLength(Slice("abc"), Slice("abd")));
+  ASSERT_EQ(3, ShortestSeparatorLength(Slice("ab"), Slice("abc")));
+  ASSERT_EQ(4, ShortestSeparatorLength(Slice("abcd"), Slice("abcexyz")));
+  ASSERT_EQ(1, ShortestSeparatorLength(Slice(""), Slice("a")));
+}
+
+// Insert keys which share a long common prefix, in random order, so that
+// splits produce truncated separators, and make sure every key can still be
+// found and iterated in order.
+TEST_F(TestCBTree, TestInsertAndVerifyLongCommonPrefix) {
+  CBTree<SmallFanoutTraits> t;
+  char kbuf[64];
+  char vbuf[64];
+
+  int n_keys = 1000;
+  if (AllowSlowTests()) {
+    n_keys = 100000;
+  }
+
+  vector<int> keys;
+  for (int i = 0; i < n_keys; i++) {
+    keys.push_back(i);
+  }
+  std::random_shuffle(keys.begin(), keys.end());
+  for (int key : keys) {
+    snprintf(kbuf, sizeof(kbuf), "a-long-composite-key-prefix-%08d", key);
+    snprintf(vbuf, sizeof(vbuf), "val_%d", key);
+    ASSERT_TRUE(t.Insert(Slice(kbuf), Slice(vbuf)));
+  }
+
+  for (int key = 0; key < n_keys; key++) {
+    snprintf(kbuf, sizeof(kbuf), "a-long-composite-key-prefix-%08d", key);
+    snprintf(vbuf, sizeof(vbuf), "val_%d", key);
+    VerifyGet(t, Slice(kbuf), Slice(vbuf));
+  }
+
+  gscoped_ptr<CBTreeIterator<SmallFanoutTraits> > iter(t.NewIterator());
+  bool exact;
+  ASSERT_TRUE(iter->SeekAtOrAfter(Slice("a-long-composite-key-prefix-"), &exact));
+  ASSERT_FALSE(exact);
+  int count = 0;
+  while (iter->IsValid()) {
+    Slice k, v;
+    iter->GetCurrentEntry(&k, &v);
+    snprintf(kbuf, sizeof(kbuf), "a-long-composite-key-prefix-%08d", count);
+    ASSERT_EQ(Slice(kbuf), k);
+    count++;
+    iter->Next();
+  }
+  ASSERT_EQ(n_keys, count);
+}
+
 // Thread which cycles through doing the following:
 // - lock the node
 // - either mark it splitting or inserting (alternatingly)
@@ -20,14 +20,18 @@
 #include <glog/logging.h>
 
 #include "kudu/common/generic_iterators.h"
+#include "kudu/gutil/strings/substitute.h"
 #include "kudu/tablet/cfile_set.h"
 #include "kudu/tablet/diskrowset-test-base.h"
 #include "kudu/tablet/tablet-test-base.h"
 #include "kudu/util/test_util.h"
 
 DECLARE_int32(cfile_default_block_size);
+DECLARE_bool(cfile_set_use_zone_maps);
+DECLARE_bool(cfile_set_use_bitmap_indexes);
 
 using std::shared_ptr;
+using strings::Substitute;
 
 namespace kudu {
 namespace tablet {
@@ -290,6 +294,49 @@ TEST_F(TestCFileSet, TestRangeScan) {
   EXPECT_EQ(stats[2].data_blocks_read_from_disk, 1);
 }
 
+// Add a range predicate on a non-key column whose values correlate with the
+// row order, and ensure that the zone maps let the scan skip the data blocks
+// which cannot match, in all of the columns.
+TEST_F(TestCFileSet, TestZoneMapPruning) {
+  const int kNumRows = 10000;
+  WriteTestRowSet(kNumRows);
+
+  shared_ptr<CFileSet> fileset(new CFileSet(rowset_meta_));
+  ASSERT_OK(fileset->Open());
+
+  for (bool use_zone_maps : { false, true }) {
+    SCOPED_TRACE(use_zone_maps);
+    FLAGS_cfile_set_use_zone_maps = use_zone_maps;
+
+    shared_ptr<CFileSet::Iterator> cfile_iter(fileset->NewIterator(&schema_));
+    gscoped_ptr<RowwiseIterator> iter(new MaterializingIterator(cfile_iter));
+
+    // The second column contains the row index * 10.
+    ScanSpec spec;
+    uint32_t lower = 20000;
+    uint32_t upper = 20100;
+    spec.AddPredicate(ColumnPredicate::Range(schema_.column(1), &lower, &upper));
+    ASSERT_OK(iter->Init(&spec));
+
+    vector<string> results;
+    ASSERT_OK(IterateToStringList(iter.get(), &results));
+    ASSERT_EQ(10, results.size());
+    EXPECT_EQ("(uint32 c0=4000, uint32 c1=20000, uint32 c2=200000)", results[0]);
+    EXPECT_EQ("(uint32 c0=4018, uint32 c1=20090, uint32 c2=200900)", results[9]);
+
+    vector<IteratorStats> stats;
+    iter->GetIteratorStats(&stats);
+    if (use_zone_maps) {
+      // The matching rows span at most two blocks of each column.
+      EXPECT_LE(stats[0].data_blocks_read_from_disk, 2);
+      EXPECT_LE(stats[1].data_blocks_read_from_disk, 2);
+      EXPECT_LE(stats[2].data_blocks_read_from_disk, 2);
+    } else {
+      EXPECT_GT(stats[1].data_blocks_read_from_disk, 10);
+    }
+  }
+}
+
 // Several other black-box tests for range scans. These are similar to
 // TestRangeScan above, except don't inspect internal state.
 TEST_F(TestCFileSet, TestRangePredicates2) {
@@ -318,5 +365,106 @@ TEST_F(TestCFileSet, TestRangePredicates2) {
 }
 
 
+class TestCFileSetBitmapIndex : public KuduRowSetTest {
+ public:
+  TestCFileSetBitmapIndex()
+      : KuduRowSetTest(Schema({ ColumnSchema("key", UINT32),
+                                ColumnSchema("c1", UINT32, false, nullptr, nullptr,
+                                             GetIndexedStorage()),
+                                ColumnSchema("c2", STRING, true, nullptr, nullptr,
+                                             GetIndexedStorage()) }, 1)) {
+  }
+
+  virtual void SetUp() OVERRIDE {
+    KuduRowSetTest::SetUp();
+    FLAGS_cfile_default_block_size = 512;
+  }
+
+  // Write out a test rowset where 'c1' is the row index mod 7, and 'c2' is
+  // "s" followed by the row index mod 5, or null for every 11th row.
+  void WriteTestRowSet(int nrows) {
+    DiskRowSetWriter rsw(rowset_meta_.get(), &schema_,
+                         BloomFilterSizing::BySizeAndFPRate(32*1024, 0.01f));
+    ASSERT_OK(rsw.Open());
+
+    RowBuilder rb(schema_);
+    for (int i = 0; i < nrows; i++) {
+      rb.Reset();
+      rb.AddUint32(i);
+      rb.AddUint32(i % 7);
+      if (i % 11 == 0) {
+        rb.AddNull();
+      } else {
+        rb.AddString(Substitute("s$0", i % 5));
+      }
+      ASSERT_OK_FAST(WriteRow(rb.data(), &rsw));
+    }
+    ASSERT_OK(rsw.Finish());
+  }
+
+ private:
+  static ColumnStorageAttributes GetIndexedStorage() {
+    ColumnStorageAttributes attr;
+    attr.bitmap_index = true;
+    return attr;
+  }
+};
+
+// Scan with predicates on the indexed columns, and ensure that the indexes
+// yield the same results as the data without reading the columns' blocks.
+TEST_F(TestCFileSetBitmapIndex, TestPredicates) {
+  const int kNumRows = 10000;
+  WriteTestRowSet(kNumRows);
+
+  BlockId block_id;
+  ASSERT_FALSE(rowset_meta_->GetColumnBitmapIndexBlock(schema_.column_id(0), &block_id));
+  ASSERT_TRUE(rowset_meta_->GetColumnBitmapIndexBlock(schema_.column_id(1), &block_id));
+  ASSERT_TRUE(rowset_meta_->GetColumnBitmapIndexBlock(schema_.column_id(2), &block_id));
+
+  shared_ptr<CFileSet> fileset(new CFileSet(rowset_meta_));
+  ASSERT_OK(fileset->Open());
+
+  uint32_t three = 3;
+  uint32_t four = 4;
+  Slice s1("s1");
+  vector<const void*> c1_values = { &three, &four };
+  int expected = 0;
+  for (int i = 0; i < kNumRows; i++) {
+    if ((i % 7 == 3 || i % 7 == 4) && i % 11 != 0 && i % 5 == 1) {
+      expected++;
+    }
+  }
+
+  vector<string> results_without_index;
+  for (bool use_indexes : { false, true }) {
+    SCOPED_TRACE(use_indexes);
+    FLAGS_cfile_set_use_bitmap_indexes = use_indexes;
+
+    shared_ptr<CFileSet::Iterator> cfile_iter(fileset->NewIterator(&schema_));
+    gscoped_ptr<RowwiseIterator> iter(new MaterializingIterator(cfile_iter));
+
+    ScanSpec spec;
+    spec.AddPredicate(ColumnPredicate::InList(schema_.column(1), &c1_values));
+    spec.AddPredicate(ColumnPredicate::Equality(schema_.column(2), &s1));
+    ASSERT_OK(iter->Init(&spec));
+
+    vector<string> results;
+    ASSERT_OK(IterateToStringList(iter.get(), &results));
+    ASSERT_EQ(expected, results.size());
+    EXPECT_EQ("(uint32 key=31, uint32 c1=3, string c2=\"s1\")", results[0]);
+
+    vector<IteratorStats> stats;
+    iter->GetIteratorStats(&stats);
+    if (use_indexes) {
+      EXPECT_EQ(results_without_index, results);
+      EXPECT_EQ(0, stats[1].data_blocks_read_from_disk);
+      EXPECT_EQ(0, stats[2].data_blocks_read_from_disk);
+    } else {
+      EXPECT_GT(stats[1].data_blocks_read_from_disk, 0);
+      results_without_index.swap(results);
+    }
+  }
+}
+
 } // namespace tablet
 } // namespace kudu
@@ -24,18 +24,31 @@
 #include "kudu/cfile/cfile_writer.h"
 #include "kudu/common/scan_spec.h"
 #include "kudu/common/column_materialization_context.h"
+#include "kudu/common/rowblock.h"
 #include "kudu/gutil/dynamic_annotations.h"
 #include "kudu/gutil/map-util.h"
 #include "kudu/gutil/stl_util.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/tablet/diskrowset.h"
 #include "kudu/tablet/cfile_set.h"
+#include "kudu/util/bitmap.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/logging.h"
 
 DEFINE_bool(consult_bloom_filters, true, "Whether to consult bloom filters on row presence checks");
 TAG_FLAG(consult_bloom_filters, hidden);
 
+DEFINE_bool(cfile_set_use_zone_maps, true,
+            "Whether to consult the per-block zone maps of columns with predicates "
+            "in order to skip reading blocks which cannot match");
+TAG_FLAG(cfile_set_use_zone_maps, hidden);
+
+DEFINE_bool(cfile_set_use_bitmap_indexes, true,
+            "Whether to evaluate the predicates of columns with bitmap indexes "
+            "using the indexes, rather than reading the columns' blocks, when "
+            "the rows being scanned have no updates");
+TAG_FLAG(cfile_set_use_bitmap_indexes, hidden);
+
 namespace kudu {
 namespace tablet {
 
@@ -88,6 +101,17 @@ Status CFileSet::Open() {
     readers_by_col_id_[col_id] = shared_ptr<CFileReader>(reader.release());
     VLOG(1) << "Successfully opened cfile for column id " << col_id
             << " in " << rowset_metadata_->ToString();
+
+    // The column may have been dropped from the tablet since the rowset was
+    // written, in which case its index is never used.
+    BlockId index_block;
+    int col_idx = tablet_schema().find_column_by_id(col_id);
+    if (col_idx != Schema::kColumnNotFound &&
+        rowset_metadata_->GetColumnBitmapIndexBlock(col_id, &index_block)) {
+      bitmap_index_readers_by_col_id_[col_id] = std::make_shared<BitmapIndexReader>(
+          rowset_metadata_->fs_manager(), index_block,
+          tablet_schema().column(col_idx).type_info());
+    }
   }
 
   // However, the key reader should always be fully opened, so that we
@@ -264,6 +288,8 @@ Status CFileSet::Iterator::CreateColumnIterators(const ScanSpec* spec) {
   vector<ColumnIterator*> ret_iters;
   ElementDeleter del(&ret_iters);
   ret_iters.reserve(projection_->num_columns());
+  vector<CFileReader*> ret_readers(projection_->num_columns(), nullptr);
+  vector<BitmapIndexReader*> ret_indexes(projection_->num_columns(), nullptr);
 
   CFileReader::CacheControl cache_blocks = CFileReader::CACHE_BLOCK;
   if (spec && !spec->cache_blocks()) {
@@ -293,9 +319,20 @@ Status CFileSet::Iterator::CreateColumnIterators(const ScanSpec* spec) {
                           Substitute("could not create iterator for column $0",
                                      projection_->column(proj_col_idx).ToString()));
     ret_iters.push_back(iter);
+    ret_readers[proj_col_idx] = FindOrDie(base_data_->readers_by_col_id_, col_id).get();
+    const shared_ptr<BitmapIndexReader>* index =
+        FindOrNull(base_data_->bitmap_index_readers_by_col_id_, col_id);
+    if (index != nullptr) {
+      ret_indexes[proj_col_idx] = index->get();
+    }
   }
 
   col_iters_.swap(ret_iters);
+  col_readers_.swap(ret_readers);
+  col_bitmap_indexes_.swap(ret_indexes);
+  bitmap_index_matches_.clear();
+  bitmap_index_matches_.resize(col_iters_.size());
+  cells_skipped_by_zone_maps_.assign(col_iters_.size(), 0);
   return Status::OK();
 }
 
@@ -444,10 +481,112 @@ Status CFileSet::Iterator::InitializeSelectionVector(SelectionVector *sel_vec) {
   return Status::OK();
 }
 
+Status CFileSet::Iterator::CanSkipBatch(ColumnMaterializationContext *ctx, bool *skip) {
+  *skip = false;
+  CFileReader* reader = col_readers_[ctx->col_idx()];
+
+  // The zone maps describe the base data only, so they may only be consulted
+  // when the predicate is evaluated against the base data. This is the case
+  // exactly when decoder-level evaluation is allowed, i.e. when there is a
+  // predicate and the column has no deltas to apply in this batch.
+  if (!FLAGS_cfile_set_use_zone_maps || reader == nullptr || !ctx->DecoderEvalNotDisabled()) {
+    return Status::OK();
+  }
+
+  // The reader may have been opened lazily. This incurs no extra IO since the
+  // column would otherwise be initialized when it is first seeked.
+  RETURN_NOT_OK(reader->Init());
+  *skip = !reader->MayMatchPredicate(*ctx->pred(), cur_idx_, prepared_count_);
+  return Status::OK();
+}
+
+Status CFileSet::Iterator::MaterializeFromBitmapIndex(ColumnMaterializationContext *ctx,
+                                                      bool *used) {
+  *used = false;
+  const size_t col_idx = ctx->col_idx();
+  BitmapIndexReader* index = col_bitmap_indexes_[col_idx];
+
+  // Like the zone maps, the index describes the base data only. Since only
+  // the cells of the matching rows are filled in, the caller must not read
+  // the others.
+  if (!FLAGS_cfile_set_use_bitmap_indexes || index == nullptr ||
+      !ctx->DecoderEvalNotDisabled() || !ctx->skip_unselected_rows()) {
+    return Status::OK();
+  }
+  RETURN_NOT_OK(index->Init());
+
+  // The predicate of a column doesn't change for the lifetime of the
+  // iterator, so the matching values are only looked up once.
+  std::unique_ptr<vector<int>>& matches = bitmap_index_matches_[col_idx];
+  if (!matches) {
+    matches.reset(new vector<int>());
+    index->FindMatchingValues(*ctx->pred(), matches.get());
+  }
+
+  ColumnBlock* block = ctx->block();
+  SelectionVector* sel = ctx->sel();
+  const bool is_binary = block->type_info()->physical_type() == BINARY;
+  if (block->is_nullable()) {
+    BitmapChangeBits(block->null_bitmap(), 0, prepared_count_, false);
+  }
+  SelectionVector matched(prepared_count_);
+  matched.SetAllFalse();
+  for (int v : *matches) {
+    const void* value = index->value(v);
+    // BINARY values are copied into the block's arena at most once per batch.
+    Slice relocated;
+    bool is_relocated = false;
+    index->bitmap(v).ForEachInRange(cur_idx_, prepared_count_, [&](size_t i) {
+        if (!sel->IsRowSelected(i)) {
+          return;
+        }
+        if (is_binary && !is_relocated) {
+          CHECK(block->arena()->RelocateSlice(*reinterpret_cast<const Slice*>(value),
+                                              &relocated));
+          is_relocated = true;
+        }
+        block->SetCellValue(i, is_binary ? &relocated : value);
+        if (block->is_nullable()) {
+          block->SetCellIsNull(i, false);
+        }
+        matched.SetRowSelected(i);
+      });
+  }
+
+  uint8_t* sel_bitmap = sel->mutable_bitmap();
+  const uint8_t* matched_bitmap = matched.bitmap();
+  for (size_t i = 0; i < BitmapSize(prepared_count_); i++) {
+    sel_bitmap[i] &= matched_bitmap[i];
+  }
+  ctx->SetDecoderEvalSupported();
+  *used = true;
+  return Status::OK();
+}
+
 Status CFileSet::Iterator::MaterializeColumn(ColumnMaterializationContext *ctx) {
   CHECK_EQ(prepared_count_, ctx->block()->nrows());
   DCHECK_LT(ctx->col_idx(), col_iters_.size());
 
+  // If no row of the batch can match the predicate, deselect all of the rows
+  // without preparing the column, avoiding reading its blocks altogether.
+  // The column will be re-seeked when it is next prepared.
+  if (!cols_prepared_[ctx->col_idx()]) {
+    bool skip;
+    RETURN_NOT_OK(CanSkipBatch(ctx, &skip));
+    if (skip) {
+      cells_skipped_by_zone_maps_[ctx->col_idx()] += prepared_count_;
+      ctx->sel()->SetAllFalse();
+      return Status::OK();
+    }
+
+    bool used_index;
+    RETURN_NOT_OK(MaterializeFromBitmapIndex(ctx, &used_index));
+    if (used_index) {
+      cells_skipped_by_zone_maps_[ctx->col_idx()] += prepared_count_;
+      return Status::OK();
+    }
+  }
+
   RETURN_NOT_OK(PrepareColumn(ctx));
   ColumnIterator* iter = col_iters_[ctx->col_idx()];
 
@@ -479,9 +618,10 @@ Status CFileSet::Iterator::FinishBatch() {
 void CFileSet::Iterator::GetIteratorStats(vector<IteratorStats>* stats) const {
   stats->clear();
   stats->reserve(col_iters_.size());
-  for (const ColumnIterator* iter : col_iters_) {
+  for (size_t i = 0; i < col_iters_.size(); i++) {
     ANNOTATE_IGNORE_READS_BEGIN();
-    stats->push_back(iter->io_statistics());
+    stats->push_back(col_iters_[i]->io_statistics());
+    stats->back().cells_skipped += cells_skipped_by_zone_maps_[i];
     ANNOTATE_IGNORE_READS_END();
   }
 }
@@ -30,6 +30,7 @@
 #include "kudu/common/schema.h"
 #include "kudu/gutil/macros.h"
 #include "kudu/gutil/map-util.h"
+#include "kudu/tablet/bitmap_index.h"
 #include "kudu/tablet/memrowset.h"
 #include "kudu/tablet/rowset_metadata.h"
 #include "kudu/util/env.h"
@@ -121,6 +122,11 @@ class CFileSet : public std::enable_shared_from_this<CFileSet> {
   typedef std::unordered_map<int, std::shared_ptr<CFileReader> > ReaderMap;
   ReaderMap readers_by_col_id_;
 
+  // Map of column ID to the reader of the column's bitmap index, for those
+  // columns which have one. These are also lazily initialized.
+  typedef std::unordered_map<int, std::shared_ptr<BitmapIndexReader> > BitmapIndexReaderMap;
+  BitmapIndexReaderMap bitmap_index_readers_by_col_id_;
+
   // A file reader for an ad-hoc index, i.e. an index that sits in its own file
   // and is not embedded with the column's data blocks. This is used when the
   // index pertains to more than one column, as in the case of composite keys.
@@ -199,6 +205,16 @@ class CFileSet::Iterator : public ColumnwiseIterator {
   // Prepare the given column if not already prepared.
   Status PrepareColumn(ColumnMaterializationContext *ctx);
 
+  // Sets *skip to true if the zone maps of the column being materialized by
+  // 'ctx' show that no row of the current batch can satisfy its predicate.
+  Status CanSkipBatch(ColumnMaterializationContext *ctx, bool *skip);
+
+  // Evaluates the predicate of the column being materialized by 'ctx' using
+  // the column's bitmap index, filling in the cells of the matching rows
+  // without preparing the column. Sets *used to false if the index can't be
+  // used for the current batch.
+  Status MaterializeFromBitmapIndex(ColumnMaterializationContext *ctx, bool *used);
+
   const std::shared_ptr<CFileSet const> base_data_;
   const Schema* projection_;
 
@@ -206,6 +222,21 @@ class CFileSet::Iterator : public ColumnwiseIterator {
   gscoped_ptr<CFileIterator> key_iter_;
   std::vector<ColumnIterator*> col_iters_;
 
+  // The reader for each of the projected columns, or NULL if the column has
+  // no data in this CFileSet. Used to consult the columns' zone maps.
+  std::vector<CFileReader*> col_readers_;
+
+  // The bitmap index of each of the projected columns, or NULL if the column
+  // has none in this CFileSet, and the values of the index which match the
+  // column's predicate, computed when the index is first used.
+  std::vector<BitmapIndexReader*> col_bitmap_indexes_;
+  std::vector<std::unique_ptr<std::vector<int>>> bitmap_index_matches_;
+
+  // The number of cells of each of the projected columns which were skipped
+  // because of the column's zone maps, or served by its bitmap index rather
+  // than read from its CFile. Added to the column's IteratorStats.
+  std::vector<int64_t> cells_skipped_by_zone_maps_;
+
   bool initted_;
 
   size_t cur_idx_;
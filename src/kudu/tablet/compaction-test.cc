@@ -21,16 +21,19 @@
 #include <gtest/gtest.h>
 #include <memory>
 
+#include "kudu/common/encoded_key.h"
 #include "kudu/common/partial_row.h"
 #include "kudu/consensus/log_anchor_registry.h"
 #include "kudu/consensus/opid_util.h"
 #include "kudu/fs/fs_manager.h"
 #include "kudu/fs/log_block_manager.h"
+#include "kudu/gutil/stringprintf.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/gutil/strings/util.h"
 #include "kudu/server/logical_clock.h"
 #include "kudu/tablet/compaction.h"
 #include "kudu/tablet/local_tablet_writer.h"
+#include "kudu/tablet/mock-rowsets.h"
 #include "kudu/tablet/tablet-test-util.h"
 #include "kudu/util/stopwatch.h"
 #include "kudu/util/test_util.h"
@@ -48,6 +51,7 @@ DEFINE_int32(merge_benchmark_num_rows_per_rowset, 500000,
 
 DECLARE_string(block_manager);
 DECLARE_bool(enable_data_block_fsync);
+DECLARE_int32(tablet_compaction_parallelism);
 
 using std::shared_ptr;
 
@@ -487,6 +491,74 @@ TEST_F(TestCompaction, TestRowSetInput) {
             out[9]);
 }
 
+TEST_F(TestCompaction, TestRowSetInputWithKeyRange) {
+  shared_ptr<DiskRowSet> rs;
+  {
+    shared_ptr<MemRowSet> mrs(new MemRowSet(0, schema_, log_anchor_registry_.get()));
+    InsertRows(mrs.get(), 10, 0);
+    FlushMRSAndReopenNoRoll(*mrs, schema_, &rs);
+    ASSERT_NO_FATAL_FAILURE();
+  }
+  UpdateRows(rs.get(), 10, 0, 1);
+  UpdateRows(rs.get(), 10, 0, 2);
+  ASSERT_OK(rs->FlushDeltas());
+  UpdateRows(rs.get(), 10, 0, 3);
+  UpdateRows(rs.get(), 10, 0, 4);
+
+  // Only the rows in [hello 00000030, hello 00000070) should be yielded, along
+  // with their own mutations.
+  EncodedKeyBuilder lower_builder(&schema_);
+  Slice lower("hello 00000030");
+  lower_builder.AddColumnKey(&lower);
+  gscoped_ptr<EncodedKey> lower_key(lower_builder.BuildEncodedKey());
+  EncodedKeyBuilder upper_builder(&schema_);
+  Slice upper("hello 00000070");
+  upper_builder.AddColumnKey(&upper);
+  gscoped_ptr<EncodedKey> upper_key(upper_builder.BuildEncodedKey());
+
+  vector<string> out;
+  gscoped_ptr<CompactionInput> input;
+  ASSERT_OK(CompactionInput::Create(*rs, &schema_, MvccSnapshot(mvcc_),
+                                    lower_key.get(), upper_key.get(), &input));
+  IterateInput(input.get(), &out);
+  ASSERT_EQ(4, out.size());
+  EXPECT_EQ("(string key=hello 00000030, int32 val=3, int32 nullable_val=NULL) "
+            "Undos: [@4(DELETE)] "
+            "Redos: ["
+            "@14(SET val=1, nullable_val=1), "
+            "@24(SET val=2, nullable_val=NULL), "
+            "@34(SET val=3, nullable_val=3), "
+            "@44(SET val=4, nullable_val=NULL)]",
+            out[0]);
+  EXPECT_TRUE(HasPrefixString(out[3], "(string key=hello 00000060,")) << out[3];
+}
+
+TEST_F(TestCompaction, TestChooseCompactionSplitKeys) {
+  RowSetVector rowsets;
+  rowsets.push_back(shared_ptr<RowSet>(new MockDiskRowSet("A", "B")));
+  rowsets.push_back(shared_ptr<RowSet>(new MockDiskRowSet("C", "D")));
+  rowsets.push_back(shared_ptr<RowSet>(new MockDiskRowSet("E", "F")));
+  rowsets.push_back(shared_ptr<RowSet>(new MockDiskRowSet("G", "H")));
+
+  // Disjoint rowsets of equal size are split at the start of each rowset.
+  vector<string> split_keys;
+  ChooseCompactionSplitKeys(rowsets, 4, &split_keys);
+  EXPECT_EQ((vector<string>{ "C", "E", "G" }), split_keys);
+
+  ChooseCompactionSplitKeys(rowsets, 2, &split_keys);
+  EXPECT_EQ(vector<string>{ "E" }, split_keys);
+
+  ChooseCompactionSplitKeys(rowsets, 1, &split_keys);
+  EXPECT_TRUE(split_keys.empty());
+
+  // Rowsets which all cover the same key range can't be split.
+  RowSetVector overlapping;
+  overlapping.push_back(shared_ptr<RowSet>(new MockDiskRowSet("A", "Z")));
+  overlapping.push_back(shared_ptr<RowSet>(new MockDiskRowSet("A", "Z")));
+  ChooseCompactionSplitKeys(overlapping, 4, &split_keys);
+  EXPECT_TRUE(split_keys.empty());
+}
+
 // Tests that the same rows, duplicated in three DRSs, ghost in two of them
 // appears only once on the compaction output
 TEST_F(TestCompaction, TestDuplicatedGhostRowsDontSurviveCompaction) {
@@ -549,6 +621,41 @@ TEST_F(TestCompaction, TestDuplicatedGhostRowsDontSurviveCompaction) {
       "Redos: []", out[9]);
 }
 
+// Test that rows with no REDO deltas, which are copied into the output a column
+// at a time, interleave correctly with rows that do have mutations applied.
+TEST_F(TestCompaction, TestCompactDeltaFreeRows) {
+  shared_ptr<MemRowSet> mrs(new MemRowSet(0, schema_, log_anchor_registry_.get()));
+  InsertRows(mrs.get(), 1000, 0);
+  shared_ptr<DiskRowSet> rs;
+  FlushMRSAndReopenNoRoll(*mrs, schema_, &rs);
+  ASSERT_NO_FATAL_FAILURE();
+
+  // Only the first 150 rows get REDOs; the rest are delta-free.
+  UpdateRows(rs.get(), 150, 0, 1);
+
+  shared_ptr<DiskRowSet> result;
+  CompactAndReopenNoRoll({ rs }, schema_, &result);
+  ASSERT_NO_FATAL_FAILURE();
+
+  gscoped_ptr<CompactionInput> input;
+  ASSERT_OK(CompactionInput::Create(*result,
+                                    &schema_,
+                                    MvccSnapshot::CreateSnapshotIncludingAllTransactions(),
+                                    &input));
+  vector<string> out;
+  IterateInput(input.get(), &out);
+  ASSERT_EQ(1000, out.size());
+  EXPECT_EQ("(string key=hello 00000000, int32 val=1, int32 nullable_val=1) "
+      "Undos: [@1001(SET val=0, nullable_val=0), @1(DELETE)] "
+      "Redos: []", out[0]);
+  EXPECT_EQ("(string key=hello 00001500, int32 val=150, int32 nullable_val=150) "
+      "Undos: [@151(DELETE)] "
+      "Redos: []", out[150]);
+  EXPECT_EQ("(string key=hello 00005010, int32 val=501, int32 nullable_val=NULL) "
+      "Undos: [@502(DELETE)] "
+      "Redos: []", out[501]);
+}
+
 // Test case which doesn't do any merging -- just compacts
 // a single input rowset (which may be the memrowset) into a single
 // output rowset (on disk).
@@ -768,6 +875,45 @@ TEST_F(TestCompaction, TestCompactionFreesDiskSpace) {
   }
 }
 
+// Test that a compaction of rowsets with disjoint key ranges is split into
+// ranges compacted in parallel, and that the inputs' updates carry over.
+TEST_F(TestCompaction, TestParallelCompaction) {
+  FLAGS_tablet_compaction_parallelism = 4;
+  LocalTabletWriter writer(tablet().get(), &client_schema());
+  KuduPartialRow row(&client_schema());
+  for (int i = 0; i < 4; i++) {
+    for (int j = 0; j < 10; j++) {
+      int val = (i * 10) + j;
+      ASSERT_OK(row.SetStringCopy("key", StringPrintf(kRowKeyFormat, val)));
+      ASSERT_OK(row.SetInt32("val", val));
+      ASSERT_OK(writer.Insert(row));
+    }
+    ASSERT_OK(tablet()->Flush());
+  }
+  for (int val = 0; val < 40; val++) {
+    ASSERT_OK(row.SetStringCopy("key", StringPrintf(kRowKeyFormat, val)));
+    ASSERT_OK(row.SetInt32("val", val + 100));
+    ASSERT_OK(writer.Update(row));
+  }
+  ASSERT_EQ(4, tablet()->num_rowsets());
+
+  ASSERT_OK(tablet()->Compact(Tablet::FORCE_COMPACT_ALL));
+
+  // Each key range is written out to its own rowsets.
+  ASSERT_GT(tablet()->num_rowsets(), 1);
+  gscoped_ptr<RowwiseIterator> iter;
+  ASSERT_OK(tablet()->NewRowIterator(client_schema(), &iter));
+  ASSERT_OK(iter->Init(nullptr));
+  vector<string> rows;
+  ASSERT_OK(IterateToStringList(iter.get(), &rows));
+  ASSERT_EQ(40, rows.size());
+  for (int val = 0; val < 40; val++) {
+    EXPECT_EQ(Substitute("(string key=$0, int32 val=$1, int32 nullable_val=NULL)",
+                         StringPrintf(kRowKeyFormat, val), val + 100),
+              rows[val]);
+  }
+}
+
 // Regression test for KUDU-1237, a bug in which empty flushes or compactions
 // would result in orphaning near-empty cfile blocks on the disk.
 TEST_F(TestCompaction, TestEmptyFlushDoesntLeakBlocks) {
@@ -17,6 +17,7 @@
 
 #include "kudu/tablet/compaction.h"
 
+#include <algorithm>
 #include <deque>
 #include <glog/logging.h>
 #include <memory>
@@ -24,6 +25,8 @@
 #include <unordered_set>
 #include <vector>
 
+#include "kudu/common/encoded_key.h"
+#include "kudu/common/scan_spec.h"
 #include "kudu/common/wire_protocol.h"
 #include "kudu/consensus/opid_util.h"
 #include "kudu/gutil/macros.h"
@@ -37,6 +40,7 @@
 #include "kudu/tablet/diskrowset.h"
 #include "kudu/tablet/tablet.pb.h"
 #include "kudu/tablet/transactions/write_transaction.h"
+#include "kudu/util/bitmap.h"
 #include "kudu/util/debug/trace_event.h"
 
 using kudu::server::HybridClock;
@@ -137,9 +141,15 @@ class MemRowSetCompactionInput : public CompactionInput {
 class DiskRowSetCompactionInput : public CompactionInput {
  public:
   DiskRowSetCompactionInput(gscoped_ptr<RowwiseIterator> base_iter,
+                            CFileSet::Iterator* base_cfile_iter,
                             unique_ptr<DeltaIterator> redo_delta_iter,
-                            unique_ptr<DeltaIterator> undo_delta_iter)
+                            unique_ptr<DeltaIterator> undo_delta_iter,
+                            const EncodedKey* lower_bound,
+                            const EncodedKey* exclusive_upper_bound)
       : base_iter_(std::move(base_iter)),
+        base_cfile_iter_(base_cfile_iter),
+        lower_bound_(lower_bound),
+        exclusive_upper_bound_(exclusive_upper_bound),
         redo_delta_iter_(std::move(redo_delta_iter)),
         undo_delta_iter_(std::move(undo_delta_iter)),
         arena_(32 * 1024, 128 * 1024),
@@ -151,11 +161,22 @@ class DiskRowSetCompactionInput : public CompactionInput {
   virtual Status Init() OVERRIDE {
     ScanSpec spec;
     spec.set_cache_blocks(false);
+    if (lower_bound_) {
+      spec.SetLowerBoundKey(lower_bound_);
+    }
+    if (exclusive_upper_bound_) {
+      spec.SetExclusiveUpperBoundKey(exclusive_upper_bound_);
+    }
     RETURN_NOT_OK(base_iter_->Init(&spec));
+
+    // The base data iterator turns the key bounds into a range of ordinals;
+    // start the deltas at the first row it will yield.
+    rowid_t first_rowid = base_cfile_iter_->cur_ordinal_idx();
     RETURN_NOT_OK(redo_delta_iter_->Init(&spec));
-    RETURN_NOT_OK(redo_delta_iter_->SeekToOrdinal(0));
+    RETURN_NOT_OK(redo_delta_iter_->SeekToOrdinal(first_rowid));
     RETURN_NOT_OK(undo_delta_iter_->Init(&spec));
-    RETURN_NOT_OK(undo_delta_iter_->SeekToOrdinal(0));
+    RETURN_NOT_OK(undo_delta_iter_->SeekToOrdinal(first_rowid));
+    first_rowid_in_block_ = first_rowid;
     return Status::OK();
   }
 
@@ -203,6 +224,13 @@ class DiskRowSetCompactionInput : public CompactionInput {
  private:
   DISALLOW_COPY_AND_ASSIGN(DiskRowSetCompactionInput);
   gscoped_ptr<RowwiseIterator> base_iter_;
+
+  // The CFileSet iterator underneath 'base_iter_'.
+  CFileSet::Iterator* base_cfile_iter_;
+
+  // Key bounds of the rows to yield, or NULL if unbounded.
+  const EncodedKey* lower_bound_;
+  const EncodedKey* exclusive_upper_bound_;
   unique_ptr<DeltaIterator> redo_delta_iter_;
   unique_ptr<DeltaIterator> undo_delta_iter_;
 
@@ -527,9 +555,19 @@ Status CompactionInput::Create(const DiskRowSet &rowset,
                                const Schema* projection,
                                const MvccSnapshot &snap,
                                gscoped_ptr<CompactionInput>* out) {
+  return Create(rowset, projection, snap, nullptr, nullptr, out);
+}
+
+Status CompactionInput::Create(const DiskRowSet &rowset,
+                               const Schema* projection,
+                               const MvccSnapshot &snap,
+                               const EncodedKey* lower_bound,
+                               const EncodedKey* exclusive_upper_bound,
+                               gscoped_ptr<CompactionInput>* out) {
   CHECK(projection->has_column_ids());
 
-  shared_ptr<ColumnwiseIterator> base_cwise(rowset.base_data_->NewIterator(projection));
+  CFileSet::Iterator* base_cfile_iter = rowset.base_data_->NewIterator(projection);
+  shared_ptr<ColumnwiseIterator> base_cwise(base_cfile_iter);
   gscoped_ptr<RowwiseIterator> base_iter(new MaterializingIterator(base_cwise));
 
   // Creates a DeltaIteratorMerger that will only include the relevant REDO deltas.
@@ -544,8 +582,11 @@ Status CompactionInput::Create(const DiskRowSet &rowset,
       DeltaTracker::UNDOS_ONLY, &undo_deltas), "Could not open UNDOs");
 
   out->reset(new DiskRowSetCompactionInput(std::move(base_iter),
+                                           base_cfile_iter,
                                            std::move(redo_deltas),
-                                           std::move(undo_deltas)));
+                                           std::move(undo_deltas),
+                                           lower_bound,
+                                           exclusive_upper_bound));
   return Status::OK();
 }
 
@@ -566,14 +607,29 @@ CompactionInput *CompactionInput::Merge(const vector<shared_ptr<CompactionInput>
 Status RowSetsInCompaction::CreateCompactionInput(const MvccSnapshot &snap,
                                                   const Schema* schema,
                                                   shared_ptr<CompactionInput> *out) const {
+  return CreateCompactionInput(snap, schema, nullptr, nullptr, out);
+}
+
+Status RowSetsInCompaction::CreateCompactionInput(const MvccSnapshot &snap,
+                                                  const Schema* schema,
+                                                  const EncodedKey* lower_bound,
+                                                  const EncodedKey* exclusive_upper_bound,
+                                                  shared_ptr<CompactionInput> *out) const {
   CHECK(schema->has_column_ids());
+  bool bounded = lower_bound != nullptr || exclusive_upper_bound != nullptr;
 
   vector<shared_ptr<CompactionInput> > inputs;
   for (const shared_ptr<RowSet> &rs : rowsets_) {
     gscoped_ptr<CompactionInput> input;
-    RETURN_NOT_OK_PREPEND(rs->NewCompactionInput(schema, snap, &input),
-                          Substitute("Could not create compaction input for rowset $0",
-                                     rs->ToString()));
+    Status s;
+    if (bounded) {
+      s = CompactionInput::Create(*down_cast<DiskRowSet*>(rs.get()), schema, snap,
+                                  lower_bound, exclusive_upper_bound, &input);
+    } else {
+      s = rs->NewCompactionInput(schema, snap, &input);
+    }
+    RETURN_NOT_OK_PREPEND(s, Substitute("Could not create compaction input for rowset $0",
+                                        rs->ToString()));
     inputs.push_back(shared_ptr<CompactionInput>(input.release()));
   }
 
@@ -586,6 +642,81 @@ Status RowSetsInCompaction::CreateCompactionInput(const MvccSnapshot &snap,
   return Status::OK();
 }
 
+void ChooseCompactionSplitKeys(const RowSetVector& rowsets,
+                               int max_ranges,
+                               vector<string>* split_keys) {
+  split_keys->clear();
+  if (max_ranges <= 1) {
+    return;
+  }
+
+  struct Bounds {
+    string min_key;
+    string max_key;
+    double size;
+  };
+  vector<Bounds> bounds;
+  vector<string> points;
+  for (const shared_ptr<RowSet>& rs : rowsets) {
+    Bounds b;
+    if (!rs->GetBounds(&b.min_key, &b.max_key).ok()) {
+      continue;
+    }
+    b.size = std::max<uint64_t>(rs->EstimateOnDiskSize(), 1);
+    points.push_back(b.min_key);
+    points.push_back(b.max_key);
+    bounds.emplace_back(std::move(b));
+  }
+  std::sort(points.begin(), points.end());
+  points.erase(std::unique(points.begin(), points.end()), points.end());
+  if (points.size() < 3) {
+    // There is no bound strictly inside the key space to split at.
+    return;
+  }
+
+  // weights[i] is the estimated amount of data between points[i] and
+  // points[i + 1].
+  vector<double> weights(points.size() - 1, 0);
+  double total_weight = 0;
+  for (const Bounds& b : bounds) {
+    size_t first = std::lower_bound(points.begin(), points.end(), b.min_key) - points.begin();
+    size_t last = std::lower_bound(points.begin(), points.end(), b.max_key) - points.begin();
+    if (first == last) {
+      // A rowset with a single key; charge it to the interval starting there.
+      last = std::min(first + 1, weights.size());
+      first = last - 1;
+    }
+    for (size_t i = first; i < last; i++) {
+      weights[i] += b.size / (last - first);
+    }
+    total_weight += b.size;
+  }
+
+  // Split at the first bound past each multiple of the per-range share,
+  // skipping the outermost bounds, which wouldn't split anything off.
+  double cumulative_weight = 0;
+  int next_range = 1;
+  for (size_t i = 0; i + 2 < points.size() && next_range < max_ranges; i++) {
+    cumulative_weight += weights[i];
+    if (cumulative_weight < total_weight * next_range / max_ranges) {
+      continue;
+    }
+    // Move the split across any gap between rowsets, so that it lands on the
+    // minimum key of the next rowset rather than the maximum of the last one.
+    while (i + 2 < points.size() && weights[i + 1] == 0) {
+      i++;
+    }
+    if (i + 2 >= points.size()) {
+      break;
+    }
+    split_keys->push_back(points[i + 1]);
+    while (next_range < max_ranges &&
+           cumulative_weight >= total_weight * next_range / max_ranges) {
+      next_range++;
+    }
+  }
+}
+
 void RowSetsInCompaction::DumpToLog() const {
   LOG(INFO) << "Selected " << rowsets_.size() << " rowsets to compact:";
   // Dump the selected rowsets to the log, and collect corresponding iterators.
@@ -784,6 +915,86 @@ Status ApplyMutationsAndGenerateUndos(const MvccSnapshot& snap,
   #undef ERROR_LOG_CONTEXT
 }
 
+namespace {
+
+// Returns the index in 'schema' of the column rows expire by according to
+// 'history_gc_opts', or Schema::kColumnNotFound if rows don't expire.
+int FindTtlColumn(const HistoryGcOpts& history_gc_opts, const Schema& schema) {
+  if (!history_gc_opts.expires_rows()) {
+    return Schema::kColumnNotFound;
+  }
+  return schema.find_column_by_id(history_gc_opts.ttl_col_id());
+}
+
+// Returns true if 'row' has expired, i.e. if its value of the column at
+// 'ttl_col_idx' has expired according to 'history_gc_opts' and no mutation
+// committed in 'snap' could have changed it. Such rows are removed along
+// with all of their history. 'ttl_col_idx' may be Schema::kColumnNotFound.
+bool IsExpiredRow(const HistoryGcOpts& history_gc_opts,
+                  const MvccSnapshot& snap,
+                  int ttl_col_idx,
+                  const CompactionInputRow& row) {
+  if (ttl_col_idx == Schema::kColumnNotFound) {
+    return false;
+  }
+  for (const Mutation* mut = row.redo_head; mut != nullptr; mut = mut->acquire_next()) {
+    if (snap.IsCommitted(mut->timestamp())) {
+      return false;
+    }
+  }
+  if (row.row.schema()->column(ttl_col_idx).is_nullable() && row.row.is_null(ttl_col_idx)) {
+    return false;
+  }
+  int64_t micros;
+  memcpy(&micros, row.row.cell_ptr(ttl_col_idx), sizeof(micros));
+  return history_gc_opts.IsExpired(micros);
+}
+
+// Returns the number of rows, starting at rows[start] and no more than
+// 'max_rows', which have no REDO mutations, haven't expired, and are
+// consecutive rows of the same source RowBlock. Such rows come out of the
+// compaction unchanged.
+int DeltaFreeRunLength(const vector<CompactionInputRow>& rows, int start, int max_rows,
+                       const HistoryGcOpts& history_gc_opts, const MvccSnapshot& snap,
+                       int ttl_col_idx) {
+  const RowBlock* src_block = rows[start].row.row_block();
+  const size_t src_idx = rows[start].row.row_index();
+  int len = 0;
+  while (len < max_rows && start + len < rows.size()) {
+    const CompactionInputRow& row = rows[start + len];
+    if (row.redo_head != nullptr ||
+        row.row.row_block() != src_block ||
+        row.row.row_index() != src_idx + len ||
+        IsExpiredRow(history_gc_opts, snap, ttl_col_idx, row)) {
+      break;
+    }
+    len++;
+  }
+  return len;
+}
+
+// Copies 'n' consecutive rows of 'src' starting at 'src_idx' into 'dst'
+// starting at 'dst_idx', a column at a time. As with CopyRow() and a NULL
+// arena, indirect data is referenced rather than copied.
+void CopyRowsColumnwise(const RowBlock& src, size_t src_idx,
+                        RowBlock* dst, size_t dst_idx, size_t n) {
+  for (size_t col = 0; col < src.schema().num_columns(); col++) {
+    ColumnBlock src_col = src.column_block(col);
+    ColumnBlock dst_col = dst->column_block(col);
+    const size_t stride = src_col.stride();
+    DCHECK_EQ(stride, dst_col.stride());
+    memcpy(dst_col.data() + dst_idx * stride, src_col.data() + src_idx * stride, n * stride);
+    if (src_col.is_nullable()) {
+      for (size_t i = 0; i < n; i++) {
+        BitmapChange(dst_col.null_bitmap(), dst_idx + i,
+                     BitmapTest(src_col.null_bitmap(), src_idx + i));
+      }
+    }
+  }
+}
+
+} // anonymous namespace
+
 Status FlushCompactionInput(CompactionInput* input,
                             const MvccSnapshot& snap,
                             const HistoryGcOpts& history_gc_opts,
@@ -796,6 +1007,8 @@ Status FlushCompactionInput(CompactionInput* input,
   RowBlock block(out->schema(), 100, nullptr);
 
   uint64_t num_rows_history_truncated = 0;
+  const int ttl_col_idx = FindTtlColumn(history_gc_opts, input->schema());
+  uint64_t num_rows_expired = 0;
 
   while (input->HasMoreBlocks()) {
     RETURN_NOT_OK(input->PrepareBlock(&rows));
@@ -805,6 +1018,39 @@ Status FlushCompactionInput(CompactionInput* input,
       CompactionInputRow* input_row = &rows[i];
       RETURN_NOT_OK(out->RollIfNecessary());
 
+      // Expired rows are dropped without writing any of their history.
+      if (IsExpiredRow(history_gc_opts, snap, ttl_col_idx, *input_row)) {
+        num_rows_expired++;
+        continue;
+      }
+
+      // Rows without REDO mutations can't be updated or garbage collected, so
+      // they're copied to the output a column at a time, keeping only their
+      // (non-ancient) UNDOs. This is the common case for cold rowsets.
+      int run = DeltaFreeRunLength(rows, i, block.nrows() - n, history_gc_opts, snap,
+                                   ttl_col_idx);
+      if (run > 0) {
+        DCHECK_SCHEMA_EQ(*input_row->row.schema(), out->schema());
+        CopyRowsColumnwise(*input_row->row.row_block(), input_row->row.row_index(),
+                           &block, n, run);
+        for (int j = 0; j < run; j++) {
+          CompactionInputRow* run_row = &rows[i + j];
+          RemoveAncientUndos(history_gc_opts, run_row);
+          if (run_row->undo_head != nullptr) {
+            rowid_t index_in_current_drs;
+            RETURN_NOT_OK(out->AppendUndoDeltas(n + j, run_row->undo_head,
+                                                &index_in_current_drs));
+          }
+        }
+        i += run - 1;
+        n += run;
+        if (n == block.nrows()) {
+          RETURN_NOT_OK(out->AppendBlock(block));
+          n = 0;
+        }
+        continue;
+      }
+
       const Schema* schema = input_row->row.schema();
       DCHECK_SCHEMA_EQ(*schema, out->schema());
       DCHECK(schema->has_column_ids());
@@ -881,6 +1127,9 @@ Status FlushCompactionInput(CompactionInput* input,
     LOG(WARNING) << "Total " << num_rows_history_truncated
                  << " rows lost some history due to REINSERT after DELETE";
   }
+  if (num_rows_expired > 0) {
+    LOG(INFO) << "Removed " << num_rows_expired << " expired rows";
+  }
   return Status::OK();
 }
 
@@ -924,6 +1173,8 @@ Status ReupdateMissedDeltas(const string &tablet_name,
   RETURN_NOT_OK(key_projector.Init());
   faststring buf;
 
+  const int ttl_col_idx = FindTtlColumn(history_gc_opts, *schema);
+
   rowid_t output_row_offset = 0;
   while (input->HasMoreBlocks()) {
     RETURN_NOT_OK(input->PrepareBlock(&rows));
@@ -933,6 +1184,14 @@ Status ReupdateMissedDeltas(const string &tablet_name,
           " Redo Mutations: " << Mutation::StringifyMutationList(*schema, row.redo_head) <<
           " Undo Mutations: " << Mutation::StringifyMutationList(*schema, row.undo_head);
 
+      // The first phase dropped the row if it had expired, so whatever
+      // updates it missed are dropped with it, and it has no output row.
+      if (IsExpiredRow(history_gc_opts, snap_to_exclude, ttl_col_idx, row)) {
+        DVLOG(4) << "Skipping expired input row: " << schema->DebugRow(row.row)
+                 << " while reupdating missed deltas";
+        continue;
+      }
+
       bool is_garbage_collected = false;
       for (const Mutation *mut = row.redo_head;
            mut != nullptr;
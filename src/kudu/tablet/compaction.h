@@ -28,6 +28,8 @@
 #include "kudu/tablet/memrowset.h"
 
 namespace kudu {
+class EncodedKey;
+
 namespace tablet {
 struct CompactionInputRow;
 class WriteTransactionState;
@@ -60,19 +62,55 @@ class HistoryGcOpts {
     return ancient_history_mark_;
   }
 
+  // Returns a copy of these options which also removes the rows that have
+  // expired: those whose value of the UNIXTIME_MICROS column 'ttl_col_id'
+  // is before 'expiry_cutoff_micros'. The cutoff must be that as of the
+  // ancient history mark, so that the rows are hidden from every scan which
+  // may still run. Unlike deleted rows, these are removed without regard to
+  // the timestamps of their mutations.
+  HistoryGcOpts WithRowExpiry(ColumnId ttl_col_id, int64_t expiry_cutoff_micros) const {
+    HistoryGcOpts ret(*this);
+    ret.ttl_col_id_ = ttl_col_id;
+    ret.expiry_cutoff_micros_ = expiry_cutoff_micros;
+    return ret;
+  }
+
+  // Returns true if expired rows are removed.
+  bool expires_rows() const {
+    return ttl_col_id_ >= 0;
+  }
+
+  // Returns the id of the column rows expire by. Only valid if expires_rows().
+  ColumnId ttl_col_id() const {
+    return ttl_col_id_;
+  }
+
+  // Returns true if a row whose value of the column rows expire by is
+  // 'micros' has expired.
+  bool IsExpired(int64_t micros) const {
+    return micros < expiry_cutoff_micros_;
+  }
+
  private:
   HistoryGcOpts(bool gc_enabled, Timestamp ahm)
       : gc_enabled_(gc_enabled),
-        ancient_history_mark_(ahm) {
+        ancient_history_mark_(ahm),
+        ttl_col_id_(-1),
+        expiry_cutoff_micros_(0) {
   }
 
   // Whether historical records prior to the ancient history mark should be
   // garbage-collected (deleted).
-  const bool gc_enabled_;
+  bool gc_enabled_;
 
   // A timestamp prior to which no history will be preserved.
   // Ignored if 'enabled' != GC_ENABLED.
-  const Timestamp ancient_history_mark_;
+  Timestamp ancient_history_mark_;
+
+  // The column rows expire by, or -1 if rows don't expire, and the time
+  // prior to which they're expired.
+  ColumnId ttl_col_id_;
+  int64_t expiry_cutoff_micros_;
 };
 
 // Interface for an input feeding into a compaction or flush.
@@ -92,6 +130,17 @@ class CompactionInput {
                        const MvccSnapshot &snap,
                        gscoped_ptr<CompactionInput>* out);
 
+  // Like the above, but only yields the rows whose keys fall within
+  // [lower_bound, exclusive_upper_bound). Either bound may be NULL, leaving
+  // that side of the range unbounded. The bounds must remain valid until
+  // Init() has been called on the returned input.
+  static Status Create(const DiskRowSet &rowset,
+                       const Schema* projection,
+                       const MvccSnapshot &snap,
+                       const EncodedKey* lower_bound,
+                       const EncodedKey* exclusive_upper_bound,
+                       gscoped_ptr<CompactionInput>* out);
+
   // Create an input which reads from the given memrowset, yielding base rows and updates
   // prior to the given snapshot.
   static CompactionInput *Create(const MemRowSet &memrowset,
@@ -138,6 +187,15 @@ class RowSetsInCompaction {
                                const Schema* schema,
                                std::shared_ptr<CompactionInput> *out) const;
 
+  // Like the above, but only yields the rows whose keys fall within
+  // [lower_bound, exclusive_upper_bound), either of which may be NULL.
+  // All of the rowsets in this compaction must be DiskRowSets.
+  Status CreateCompactionInput(const MvccSnapshot &snap,
+                               const Schema* schema,
+                               const EncodedKey* lower_bound,
+                               const EncodedKey* exclusive_upper_bound,
+                               std::shared_ptr<CompactionInput> *out) const;
+
   // Dump a log message indicating the chosen rowsets.
   void DumpToLog() const;
 
@@ -200,6 +258,19 @@ Status ApplyMutationsAndGenerateUndos(const MvccSnapshot& snap,
                                       bool* is_garbage_collected,
                                       uint64_t* num_rows_history_truncated);
 
+// Choose encoded keys which split the key space spanned by 'rowsets' into at
+// most 'max_ranges' contiguous ranges holding roughly equal amounts of data,
+// so that the ranges can be compacted independently. The split keys are
+// returned in ascending order; each is the inclusive lower bound of a range.
+//
+// The keys are chosen among the rowsets' bounds, assuming that each rowset's
+// data is spread evenly across the intervals between consecutive bounds that
+// it spans. If the rowsets' bounds do not allow a split (e.g. they all cover
+// the same key range), no split keys are returned.
+void ChooseCompactionSplitKeys(const RowSetVector& rowsets,
+                               int max_ranges,
+                               vector<string>* split_keys);
+
 // Iterate through this compaction input, flushing all rows to the given RollingDiskRowSetWriter.
 // The 'snap' argument should match the MvccSnapshot used to create the compaction input.
 //
@@ -21,6 +21,8 @@
 #include <unordered_set>
 #include <string>
 
+#include "kudu/gutil/map-util.h"
+#include "kudu/gutil/stringprintf.h"
 #include "kudu/gutil/strings/numbers.h"
 #include "kudu/gutil/strings/split.h"
 #include "kudu/gutil/strings/substitute.h"
@@ -60,6 +62,95 @@ TEST(TestCompactionPolicy, TestBudgetedSelection) {
   ASSERT_GE(quality, 1.0);
 }
 
+// Selection over many small, slightly overlapping rowsets should stop
+// scanning key ranges too wide to be worthwhile, rather than considering
+// every pair of rowsets.
+TEST(TestCompactionPolicy, TestBudgetedSelectionManyRowSets) {
+  RowSetVector vec;
+  for (int i = 0; i < 10000; i++) {
+    vec.emplace_back(new MockDiskRowSet(StringPrintf("%08d", i * 10),
+                                        StringPrintf("%08d", i * 10 + 15)));
+  }
+  RowSetTree tree;
+  ASSERT_OK(tree.Reset(vec));
+
+  const int kBudgetMb = 128;
+  BudgetedCompactionPolicy policy(kBudgetMb);
+  unordered_set<RowSet*> picked;
+  double quality = 0;
+  LOG_TIMING(INFO, "Computing compaction with 10000 rowsets") {
+    ASSERT_OK(policy.PickRowSets(tree, &picked, &quality, nullptr));
+  }
+  ASSERT_GT(quality, 0);
+  ASSERT_GE(picked.size(), 2);
+  ASSERT_LE(picked.size(), kBudgetMb);
+}
+
+// With keys inserted in increasing order, flushed rowsets don't overlap. Once
+// they have reached the target size, none should be rewritten.
+TEST(TestCompactionPolicy, TestTimeSeriesLeavesNonOverlappingRowSets) {
+  const int kSize = 64 * 1024 * 1024;
+  RowSetVector vec;
+  vec.push_back(shared_ptr<RowSet>(new MockDiskRowSet("a", "b", kSize)));
+  vec.push_back(shared_ptr<RowSet>(new MockDiskRowSet("c", "d", kSize)));
+  vec.push_back(shared_ptr<RowSet>(new MockDiskRowSet("e", "f", kSize)));
+
+  RowSetTree tree;
+  ASSERT_OK(tree.Reset(vec));
+  TimeSeriesCompactionPolicy policy(1000);
+
+  unordered_set<RowSet*> picked;
+  double quality = 0;
+  ASSERT_OK(policy.PickRowSets(tree, &picked, &quality, nullptr));
+  ASSERT_TRUE(picked.empty());
+  ASSERT_EQ(0, quality);
+}
+
+// When both an old key range and the tail have overlapping rowsets, the tail
+// is compacted first.
+TEST(TestCompactionPolicy, TestTimeSeriesPrefersTail) {
+  const int kSize = 64 * 1024 * 1024;
+  RowSetVector vec;
+  vec.push_back(shared_ptr<RowSet>(new MockDiskRowSet("a", "c", kSize)));
+  vec.push_back(shared_ptr<RowSet>(new MockDiskRowSet("b", "c", kSize)));
+  vec.push_back(shared_ptr<RowSet>(new MockDiskRowSet("d", "e", kSize)));
+  vec.push_back(shared_ptr<RowSet>(new MockDiskRowSet("f", "h", kSize)));
+  vec.push_back(shared_ptr<RowSet>(new MockDiskRowSet("g", "h", kSize)));
+
+  RowSetTree tree;
+  ASSERT_OK(tree.Reset(vec));
+  TimeSeriesCompactionPolicy policy(1000);
+
+  unordered_set<RowSet*> picked;
+  double quality = 0;
+  ASSERT_OK(policy.PickRowSets(tree, &picked, &quality, nullptr));
+  ASSERT_EQ(2, picked.size());
+  ASSERT_GT(quality, 0);
+  ASSERT_TRUE(ContainsKey(picked, vec[3].get()));
+  ASSERT_TRUE(ContainsKey(picked, vec[4].get()));
+}
+
+// Small, non-overlapping rowsets at the tail are merged, but a large rowset
+// before them is left alone.
+TEST(TestCompactionPolicy, TestTimeSeriesMergesSmallTail) {
+  RowSetVector vec;
+  vec.push_back(shared_ptr<RowSet>(new MockDiskRowSet("a", "b", 64 * 1024 * 1024)));
+  vec.push_back(shared_ptr<RowSet>(new MockDiskRowSet("c", "d")));
+  vec.push_back(shared_ptr<RowSet>(new MockDiskRowSet("e", "f")));
+  vec.push_back(shared_ptr<RowSet>(new MockDiskRowSet("g", "h")));
+
+  RowSetTree tree;
+  ASSERT_OK(tree.Reset(vec));
+  TimeSeriesCompactionPolicy policy(1000);
+
+  unordered_set<RowSet*> picked;
+  double quality = 0;
+  ASSERT_OK(policy.PickRowSets(tree, &picked, &quality, nullptr));
+  ASSERT_EQ(3, picked.size());
+  ASSERT_GT(quality, 0);
+  ASSERT_FALSE(ContainsKey(picked, vec[0].get()));
+}
+
 // Return the directory of the currently-running executable.
 static string GetExecutableDir() {
   string exec;
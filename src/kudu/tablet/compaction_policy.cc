@@ -35,6 +35,7 @@
 #include "kudu/util/slice.h"
 #include "kudu/util/status.h"
 
+using std::string;
 using std::vector;
 
 DEFINE_int32(budgeted_compaction_target_rowset_size, 32*1024*1024,
@@ -49,6 +50,13 @@ DEFINE_double(compaction_approximation_ratio, 1.05f,
               "if it is known to be within 5% of the optimal solution.");
 TAG_FLAG(compaction_approximation_ratio, experimental);
 
+DEFINE_int32(time_series_compaction_target_rowset_size, 32*1024*1024,
+             "The target size for DiskRowSets during flush/compact when the "
+             "time-series compaction policy is used. Rowsets at the tail of the "
+             "key space smaller than half of this are merged together.");
+TAG_FLAG(time_series_compaction_target_rowset_size, experimental);
+TAG_FLAG(time_series_compaction_target_rowset_size, advanced);
+
 namespace kudu {
 namespace tablet {
 
@@ -101,6 +109,23 @@ void BudgetedCompactionPolicy::SetupKnapsackInput(const RowSetTree &tree,
 
 namespace {
 
+// Return an upper bound on the value of any solution: no set of rowsets which
+// fits in the budget can have a total width greater than if every megabyte of
+// the budget were filled with the densest rowset available.
+//
+// Once the key range spanned by a candidate solution is so wide that even this
+// bound cannot beat the best solution found, widening the range further can
+// only make things worse, so the selection stops scanning there. This keeps
+// selection cheap on tablets with thousands of small rowsets, where nearly
+// all of the key-ordered pairs are far too wide to be worth considering.
+double MaxSolutionValue(const vector<RowSetInfo>& candidates, int budget_mb) {
+  double max_density = 0;
+  for (const RowSetInfo& rsi : candidates) {
+    max_density = std::max(max_density, rsi.density());
+  }
+  return max_density * budget_mb;
+}
+
 struct CompareByDescendingDensity {
   bool operator()(const RowSetInfo& a, const RowSetInfo& b) const {
     return a.density() > b.density();
@@ -250,6 +275,7 @@ void BudgetedCompactionPolicy::RunApproximation(
   best_upper_bounds->clear();
   best_upper_bounds->reserve(asc_min_key.size());
   BoundCalculator bound_calc(size_budget_mb_);
+  const double max_value = MaxSolutionValue(asc_min_key, size_budget_mb_);
   for (const RowSetInfo& cc_a : asc_min_key) {
     bound_calc.clear();
     double ab_min = cc_a.cdf_min_key();
@@ -261,6 +287,12 @@ void BudgetedCompactionPolicy::RunApproximation(
       }
       ab_max = std::max(cc_b.cdf_max_key(), ab_max);
       double union_width = ab_max - ab_min;
+      if (max_value - union_width * kSupportAdjust <= best_solution->value) {
+        // Any wider solution is no better than the one we already have.
+        // Solutions cut off here are bounded by the best value, so skipping
+        // them from 'best_upper' doesn't affect the exact pass below.
+        break;
+      }
       bound_calc.Add(cc_b);
       auto bounds = bound_calc.ComputeLowerAndUpperBound();
       double lower = bounds.first - union_width * kSupportAdjust;
@@ -289,6 +321,7 @@ void BudgetedCompactionPolicy::RunExact(
   KnapsackSolver<KnapsackTraits> solver;
   vector<const RowSetInfo*> inrange_candidates;
   inrange_candidates.reserve(asc_min_key.size());
+  const double max_value = MaxSolutionValue(asc_min_key, size_budget_mb_);
   for (int i = 0; i < asc_min_key.size(); i++) {
     const RowSetInfo& cc_a = asc_min_key[i];
     const double upper_bound = best_upper_bounds[i];
@@ -314,6 +347,10 @@ void BudgetedCompactionPolicy::RunExact(
         // cc_b with cdf_max_key() > cc_a.cdf_min_key()
         continue;
       }
+      if (max_value - (cc_b.cdf_max_key() - ab_min) * kSupportAdjust <= best_solution->value) {
+        // See RunApproximation().
+        break;
+      }
       inrange_candidates.push_back(&cc_b);
     }
     if (inrange_candidates.empty()) continue;
@@ -447,5 +484,146 @@ Status BudgetedCompactionPolicy::PickRowSets(const RowSetTree &tree,
   return Status::OK();
 }
 
+////////////////////////////////////////////////////////////
+// TimeSeriesCompactionPolicy
+////////////////////////////////////////////////////////////
+
+// The quality reported for each rowset merged away when compacting small,
+// non-overlapping rowsets at the tail. Such a compaction does not reduce the
+// tablet's height, so it is scored low enough to lose to any compaction which
+// does.
+static const double kSmallRowSetMergeQuality = 0.001;
+
+TimeSeriesCompactionPolicy::TimeSeriesCompactionPolicy(int budget)
+  : size_budget_mb_(budget) {
+  CHECK_GT(budget, 0);
+}
+
+uint64_t TimeSeriesCompactionPolicy::target_rowset_size() const {
+  CHECK_GT(FLAGS_time_series_compaction_target_rowset_size, 0);
+  return FLAGS_time_series_compaction_target_rowset_size;
+}
+
+double TimeSeriesCompactionPolicy::PickFromRun(const vector<const RowSetInfo*>& run,
+                                               unordered_set<RowSet*>* picked) const {
+  vector<const RowSetInfo*> by_size(run);
+  std::stable_sort(by_size.begin(), by_size.end(),
+                   [](const RowSetInfo* a, const RowSetInfo* b) {
+                     return a->size_mb() < b->size_mb();
+                   });
+
+  vector<const RowSetInfo*> chosen;
+  int total_mb = 0;
+  for (const RowSetInfo* rsi : by_size) {
+    if (total_mb + rsi->size_mb() > size_budget_mb_) break;
+    total_mb += rsi->size_mb();
+    chosen.push_back(rsi);
+  }
+  if (chosen.size() < 2) {
+    return 0;
+  }
+
+  double total_width = 0;
+  double union_min = MathLimits<double>::kPosInf;
+  double union_max = MathLimits<double>::kNegInf;
+  for (const RowSetInfo* rsi : chosen) {
+    total_width += rsi->width();
+    union_min = std::min(union_min, rsi->cdf_min_key());
+    union_max = std::max(union_max, rsi->cdf_max_key());
+  }
+  double value = total_width - (union_max - union_min) * kSupportAdjust;
+  if (value > 0) {
+    for (const RowSetInfo* rsi : chosen) {
+      picked->insert(rsi->rowset());
+    }
+  }
+  return value;
+}
+
+int TimeSeriesCompactionPolicy::PickSmallTail(const vector<RowSetInfo>& asc_min_key,
+                                              unordered_set<RowSet*>* picked) const {
+  const uint64_t small_size = target_rowset_size() / 2;
+  vector<RowSet*> chosen;
+  int total_mb = 0;
+  for (auto it = asc_min_key.rbegin(); it != asc_min_key.rend(); ++it) {
+    if (static_cast<uint64_t>(it->size_bytes()) >= small_size ||
+        total_mb + it->size_mb() > size_budget_mb_) {
+      break;
+    }
+    total_mb += it->size_mb();
+    chosen.push_back(it->rowset());
+  }
+  if (chosen.size() < 2) {
+    return 0;
+  }
+  picked->insert(chosen.begin(), chosen.end());
+  return chosen.size();
+}
+
+Status TimeSeriesCompactionPolicy::PickRowSets(const RowSetTree &tree,
+                                               unordered_set<RowSet*>* picked,
+                                               double* quality,
+                                               std::vector<std::string>* log) {
+  vector<RowSetInfo> asc_min_key, asc_max_key;
+  RowSetInfo::CollectOrdered(tree, &asc_min_key, &asc_max_key);
+  if (asc_min_key.size() < 2) {
+    if (log) {
+      LOG_STRING(INFO, log) << "No rowsets to compact";
+    }
+    return Status::OK();
+  }
+
+  // Split the rowsets into runs whose key ranges overlap one another. Runs
+  // are in ascending key order, so the hot tail is the last one.
+  vector<vector<const RowSetInfo*>> runs;
+  string run_max_key;
+  for (const RowSetInfo& rsi : asc_min_key) {
+    if (!rsi.has_bounds()) continue;
+    if (runs.empty() || Slice(rsi.min_key()).compare(Slice(run_max_key)) > 0) {
+      runs.emplace_back();
+      run_max_key = rsi.max_key();
+    } else if (Slice(rsi.max_key()).compare(Slice(run_max_key)) > 0) {
+      run_max_key = rsi.max_key();
+    }
+    runs.back().push_back(&rsi);
+  }
+
+  unordered_set<RowSet*> solution;
+  double value = 0;
+  for (auto it = runs.rbegin(); it != runs.rend(); ++it) {
+    // A run of one rowset is already as compact as it can get.
+    if (it->size() < 2) continue;
+    value = PickFromRun(*it, &solution);
+    if (value > 0) break;
+  }
+  if (solution.empty()) {
+    int merged = PickSmallTail(asc_min_key, &solution);
+    value = merged > 0 ? (merged - 1) * kSmallRowSetMergeQuality : 0;
+  }
+
+  if (VLOG_IS_ON(1) || log != nullptr) {
+    LOG_STRING(INFO, log) << "Time-series compaction selection (" << runs.size()
+                          << " overlapping runs):";
+    for (RowSetInfo &cand : asc_min_key) {
+      const char *checkbox = "[ ]";
+      if (ContainsKey(solution, cand.rowset())) {
+        checkbox = "[x]";
+      }
+      LOG_STRING(INFO, log) << "  " << checkbox << " " << cand.ToString();
+    }
+    LOG_STRING(INFO, log) << "Solution value: " << value;
+  }
+
+  *quality = value;
+  if (solution.empty()) {
+    VLOG(1) << "No overlapping or small tail rowsets. Not compacting.";
+    return Status::OK();
+  }
+
+  picked->swap(solution);
+  DumpCompactionSVG(asc_min_key, *picked);
+  return Status::OK();
+}
+
 } // namespace tablet
 } // namespace kudu
@@ -126,6 +126,44 @@ class BudgetedCompactionPolicy : public CompactionPolicy {
   size_t size_budget_mb_;
 };
 
+// Compaction policy for append-mostly tablets, such as time-series tables
+// whose keys are inserted in roughly increasing order.
+//
+// With such a workload, flushes produce rowsets which do not overlap any
+// others, and rewriting them gains nothing. This policy groups the rowsets
+// into runs of mutually overlapping key ranges and leaves runs of a single
+// rowset alone. Of the runs which do overlap, the one with the highest keys
+// (the "hot tail" receiving inserts) is compacted first, so that late-arriving
+// writes into old key ranges do not cause cold data to be rewritten over and
+// over. When nothing overlaps, small rowsets at the tail are merged together
+// to keep the number of rowsets in check.
+class TimeSeriesCompactionPolicy : public CompactionPolicy {
+ public:
+  explicit TimeSeriesCompactionPolicy(int size_budget_mb);
+
+  virtual Status PickRowSets(const RowSetTree &tree,
+                             std::unordered_set<RowSet*>* picked,
+                             double* quality,
+                             std::vector<std::string>* log) OVERRIDE;
+
+  virtual uint64_t target_rowset_size() const OVERRIDE;
+
+ private:
+  // Picks rowsets from the overlapping run 'run', smallest first, up to the
+  // size budget. Returns the resulting reduction in average rowset height,
+  // or a non-positive value if fewer than two rowsets fit.
+  double PickFromRun(const std::vector<const RowSetInfo*>& run,
+                     std::unordered_set<RowSet*>* picked) const;
+
+  // Picks the consecutive rowsets at the end of 'asc_min_key' which are
+  // smaller than half the target rowset size, up to the size budget.
+  // Returns the number of rowsets picked.
+  int PickSmallTail(const std::vector<RowSetInfo>& asc_min_key,
+                    std::unordered_set<RowSet*>* picked) const;
+
+  size_t size_budget_mb_;
+};
+
 } // namespace tablet
 } // namespace kudu
 #endif
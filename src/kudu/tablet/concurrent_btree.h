@@ -44,6 +44,7 @@
 #include <memory>
 #include <string>
 
+#include "kudu/util/alignment.h"
 #include "kudu/util/inline_slice.h"
 #include "kudu/util/memory/arena.h"
 #include "kudu/util/status.h"
@@ -336,6 +337,30 @@ size_t FindInSliceArray(const InlineSlice<N, true> *array, ssize_t num_entries,
 }
 
 
+// Return the length of the shortest prefix of 'right' which still sorts
+// after 'left'. Requires that 'left' < 'right'.
+//
+// When a leaf splits, this prefix is enough to separate the two halves in the
+// parent: every key in the left node is less than it, and every key in the
+// right node is at least it. Long composite keys often share a prefix and
+// differ within a few bytes, so separators truncated this way are usually
+// short enough to be stored inline in the internal nodes, which saves an
+// arena allocation per separator and a pointer dereference per comparison
+// during traversal.
+inline size_t ShortestSeparatorLength(const Slice& left, const Slice& right) {
+  DCHECK_LT(left.compare(right), 0);
+  size_t min_len = std::min(left.size(), right.size());
+  size_t i = 0;
+  while (i < min_len && left[i] == right[i]) {
+    i++;
+  }
+  // Either 'left' is a prefix of 'right', or they first differ at 'i' with
+  // left[i] < right[i]. Either way, right[0..i] is the shortest prefix of
+  // 'right' greater than 'left'.
+  DCHECK_LT(i, right.size());
+  return i + 1;
+}
+
 template<class ISlice, class ArenaType>
 static void InsertInSliceArray(ISlice *array, size_t num_entries,
                                const Slice &src, size_t idx,
@@ -1481,8 +1506,12 @@ class CBTree {
       << " did not result in enough space for key " << key.ToDebugString()
       << " in left node";
 
-    // Insert the new node into the parents.
-    PropagateSplitUpward(node, new_leaf, split_key);
+    // Insert the new node into the parents, separated from the left node by
+    // the shortest prefix of its first key that is enough to tell them apart.
+    Slice right_min = new_leaf->GetKey(0);
+    Slice left_max = node->GetKey(node->num_entries() - 1);
+    Slice separator(right_min.data(), ShortestSeparatorLength(left_max, right_min));
+    PropagateSplitUpward(node, new_leaf, separator);
 
     // NB: No ned to unlock nodes here, since it is done by the upward
     // propagation path ('ascend' label in Figure 5 in the masstree paper)
@@ -1561,17 +1590,25 @@ class CBTree {
     }
   }
 
+  // Allocate 'size' bytes for a node, starting at a cache line boundary so
+  // that a node sized to N cache lines spans exactly N of them. The arena only
+  // guarantees smaller alignments, so this pads the allocation to align it.
+  void *AllocateNode(size_t size) {
+    uintptr_t mem = reinterpret_cast<uintptr_t>(CHECK_NOTNULL(
+        arena_->AllocateBytesAligned(size + CACHELINE_SIZE - sizeof(AtomicVersion),
+                                     sizeof(AtomicVersion))));
+    return reinterpret_cast<void *>(KUDU_ALIGN_UP(mem, CACHELINE_SIZE));
+  }
+
   LeafNode<Traits> *NewLeaf(bool locked) {
-    void *mem = CHECK_NOTNULL(arena_->AllocateBytesAligned(sizeof(LeafNode<Traits>),
-                                                           sizeof(AtomicVersion)));
+    void *mem = AllocateNode(sizeof(LeafNode<Traits>));
     return new (mem) LeafNode<Traits>(locked);
   }
 
   InternalNode<Traits> *NewInternalNode(const Slice &split_key,
                                         NodePtr<Traits> lchild,
                                         NodePtr<Traits> rchild) {
-    void *mem = CHECK_NOTNULL(arena_->AllocateBytesAligned(sizeof(InternalNode<Traits>),
-                                                           sizeof(AtomicVersion)));
+    void *mem = AllocateNode(sizeof(InternalNode<Traits>));
     return new (mem) InternalNode<Traits>(split_key, lchild, rchild, arena_.get());
   }
 
@@ -100,7 +100,10 @@ Status DeltaApplier::MaterializeColumn(ColumnMaterializationContext *ctx) {
   if (delta_iter_->MayHaveDeltas()) {
     ctx->SetDecoderEvalNotSupported();
     RETURN_NOT_OK(base_iter_->MaterializeColumn(ctx));
-    RETURN_NOT_OK(delta_iter_->ApplyUpdates(ctx->col_idx(), ctx->block()));
+    // If the caller only reads the selected rows, there's no need to update
+    // the others, e.g. rows deleted or filtered out by an earlier predicate.
+    const SelectionVector* filter = ctx->skip_unselected_rows() ? ctx->sel() : nullptr;
+    RETURN_NOT_OK(delta_iter_->ApplyUpdates(ctx->col_idx(), ctx->block(), filter));
   } else {
     RETURN_NOT_OK(base_iter_->MaterializeColumn(ctx));
   }
@@ -36,12 +36,14 @@
 #include "kudu/tablet/mvcc.h"
 
 using std::shared_ptr;
+using std::string;
 
 namespace kudu {
 
 using cfile::CFileIterator;
 using cfile::CFileReader;
 using cfile::IndexTreeIterator;
+using fs::CreateBlockOptions;
 using fs::WritableBlock;
 using std::unique_ptr;
 using std::vector;
@@ -58,12 +60,14 @@ const size_t kRowsPerBlock = 100; // Number of rows per block of columns
 // TODO: can you major-delta-compact a new column after an alter table in order
 // to materialize it? should write a test for this.
 MajorDeltaCompaction::MajorDeltaCompaction(
-    FsManager* fs_manager, const Schema& base_schema, CFileSet* base_data,
+    FsManager* fs_manager, CreateBlockOptions block_opts,
+    const Schema& base_schema, CFileSet* base_data,
     unique_ptr<DeltaIterator> delta_iter,
     vector<shared_ptr<DeltaStore> > included_stores,
     vector<ColumnId> col_ids,
     HistoryGcOpts history_gc_opts)
     : fs_manager_(fs_manager),
+      block_opts_(std::move(block_opts)),
       base_schema_(base_schema),
       column_ids_(std::move(col_ids)),
       history_gc_opts_(std::move(history_gc_opts)),
@@ -242,7 +246,8 @@ Status MajorDeltaCompaction::FlushRowSetAndDeltas() {
 Status MajorDeltaCompaction::OpenBaseDataWriter() {
   CHECK(!base_data_writer_);
 
-  gscoped_ptr<MultiColumnWriter> w(new MultiColumnWriter(fs_manager_, &partial_schema_));
+  gscoped_ptr<MultiColumnWriter> w(new MultiColumnWriter(fs_manager_, &partial_schema_,
+                                                         block_opts_));
   RETURN_NOT_OK(w->Open());
   base_data_writer_.swap(w);
   return Status::OK();
@@ -250,7 +255,7 @@ Status MajorDeltaCompaction::OpenBaseDataWriter() {
 
 Status MajorDeltaCompaction::OpenRedoDeltaFileWriter() {
   gscoped_ptr<WritableBlock> block;
-  RETURN_NOT_OK_PREPEND(fs_manager_->CreateNewBlock(&block),
+  RETURN_NOT_OK_PREPEND(fs_manager_->CreateNewBlock(block_opts_, &block),
                         "Unable to create REDO delta output block");
   new_redo_delta_block_ = block->id();
   new_redo_delta_writer_.reset(new DeltaFileWriter(std::move(block)));
@@ -259,7 +264,7 @@ Status MajorDeltaCompaction::OpenRedoDeltaFileWriter() {
 
 Status MajorDeltaCompaction::OpenUndoDeltaFileWriter() {
   gscoped_ptr<WritableBlock> block;
-  RETURN_NOT_OK_PREPEND(fs_manager_->CreateNewBlock(&block),
+  RETURN_NOT_OK_PREPEND(fs_manager_->CreateNewBlock(block_opts_, &block),
                         "Unable to create UNDO delta output block");
   new_undo_delta_block_ = block->id();
   new_undo_delta_writer_.reset(new DeltaFileWriter(std::move(block)));
@@ -311,6 +316,13 @@ Status MajorDeltaCompaction::CreateMetadataUpdate(
   RowSetMetadata::ColumnIdToBlockIdMap new_column_blocks;
   base_data_writer_->GetFlushedBlocksByColumnId(&new_column_blocks);
 
+  // The indexes of the compacted columns were rebuilt along with their data.
+  RowSetMetadata::ColumnIdToBlockIdMap new_index_blocks;
+  base_data_writer_->GetBitmapIndexBlocksByColumnId(&new_index_blocks);
+  for (const auto& e : new_index_blocks) {
+    update->SetColumnBitmapIndexBlock(e.first, e.second);
+  }
+
   // NOTE: in the case that one of the columns being compacted is deleted,
   // we may have fewer elements in new_column_blocks compared to 'column_ids'.
   // For those deleted columns, we just remove the old column data.
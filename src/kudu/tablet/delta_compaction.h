@@ -24,6 +24,7 @@
 #include <vector>
 
 #include "kudu/cfile/cfile_writer.h"
+#include "kudu/fs/block_manager.h"
 #include "kudu/tablet/compaction.h"
 #include "kudu/tablet/deltafile.h"
 
@@ -50,11 +51,13 @@ class MajorDeltaCompaction {
   // be open and must remain valid for the lifetime of this object.
   // 'delta_iter' must not be initialized.
   // 'col_ids' determines which columns of 'base_schema' should be compacted.
+  // The output blocks are created with 'block_opts'.
   //
   // TODO: is base_schema supposed to be the same as base_data->schema()? how about
   // in an ALTER scenario?
   MajorDeltaCompaction(
-      FsManager* fs_manager, const Schema& base_schema, CFileSet* base_data,
+      FsManager* fs_manager, fs::CreateBlockOptions block_opts,
+      const Schema& base_schema, CFileSet* base_data,
       std::unique_ptr<DeltaIterator> delta_iter,
       std::vector<std::shared_ptr<DeltaStore> > included_stores,
       std::vector<ColumnId> col_ids,
@@ -95,6 +98,9 @@ class MajorDeltaCompaction {
 
   FsManager* const fs_manager_;
 
+  // Options for the blocks written by the compaction.
+  const fs::CreateBlockOptions block_opts_;
+
   // TODO: doc me
   const Schema base_schema_;
 
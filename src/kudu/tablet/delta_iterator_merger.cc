@@ -23,6 +23,7 @@
 #include "kudu/gutil/strings/strcat.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/tablet/deltafile.h"
+#include "kudu/util/trace.h"
 
 namespace kudu {
 namespace tablet {
@@ -33,6 +34,8 @@ using std::unique_ptr;
 using std::vector;
 using strings::Substitute;
 
+const char* const kDeltaStoresAppliedTraceCounter = "delta_stores_applied";
+
 DeltaIteratorMerger::DeltaIteratorMerger(
     vector<unique_ptr<DeltaIterator> > iters)
     : iters_(std::move(iters)) {}
@@ -58,9 +61,10 @@ Status DeltaIteratorMerger::PrepareBatch(size_t nrows, PrepareFlag flag) {
   return Status::OK();
 }
 
-Status DeltaIteratorMerger::ApplyUpdates(size_t col_to_apply, ColumnBlock *dst) {
+Status DeltaIteratorMerger::ApplyUpdates(size_t col_to_apply, ColumnBlock *dst,
+                                         const SelectionVector* filter) {
   for (const unique_ptr<DeltaIterator> &iter : iters_) {
-    RETURN_NOT_OK(iter->ApplyUpdates(col_to_apply, dst));
+    RETURN_NOT_OK(iter->ApplyUpdates(col_to_apply, dst, filter));
   }
   return Status::OK();
 }
@@ -156,6 +160,7 @@ Status DeltaIteratorMerger::Create(
 
     delta_iters.push_back(unique_ptr<DeltaIterator>(raw_iter));
   }
+  TRACE_COUNTER_INCREMENT(kDeltaStoresAppliedTraceCounter, delta_iters.size());
 
   if (delta_iters.size() == 1) {
     // If we only have one input to the "merge", we can just directly
@@ -29,6 +29,11 @@ class ScanSpec;
 
 namespace tablet {
 
+// The name of the trace counter incremented by the number of delta stores
+// whose deltas are applied by each iterator created by
+// DeltaIteratorMerger::Create().
+extern const char* const kDeltaStoresAppliedTraceCounter;
+
 // DeltaIterator that simply combines together other DeltaIterators,
 // applying deltas from each in order.
 class DeltaIteratorMerger : public DeltaIterator {
@@ -50,7 +55,8 @@ class DeltaIteratorMerger : public DeltaIterator {
   virtual Status Init(ScanSpec *spec) OVERRIDE;
   virtual Status SeekToOrdinal(rowid_t idx) OVERRIDE;
   virtual Status PrepareBatch(size_t nrows, PrepareFlag flag) OVERRIDE;
-  virtual Status ApplyUpdates(size_t col_to_apply, ColumnBlock *dst) OVERRIDE;
+  virtual Status ApplyUpdates(size_t col_to_apply, ColumnBlock *dst,
+                              const SelectionVector* filter) OVERRIDE;
   virtual Status ApplyDeletes(SelectionVector *sel_vec) OVERRIDE;
   virtual Status CollectMutations(vector<Mutation *> *dst, Arena *arena) OVERRIDE;
   virtual Status FilterColumnIdsAndCollectDeltas(const std::vector<ColumnId>& col_ids,
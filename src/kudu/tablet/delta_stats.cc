@@ -119,6 +119,15 @@ void DeltaStats::AddColumnIdsWithUpdates(std::set<ColumnId>* col_ids) const {
   }
 }
 
+void DeltaStats::AddUpdateCounts(std::map<ColumnId, int64_t>* counts) const {
+  typedef std::pair<ColumnId, int64_t> entry;
+  for (const entry& e : update_counts_by_col_id_) {
+    if (e.second > 0) {
+      (*counts)[e.first] += e.second;
+    }
+  }
+}
+
 
 } // namespace tablet
 } // namespace kudu
@@ -20,6 +20,7 @@
 #include <glog/logging.h>
 #include <boost/function.hpp>
 
+#include <map>
 #include <set>
 #include <stdint.h>
 #include <string>
@@ -92,6 +93,10 @@ class DeltaStats {
   // set 'col_ids'.
   void AddColumnIdsWithUpdates(std::set<ColumnId>* col_ids) const;
 
+  // For each column which has at least one update, add that column's update
+  // count to its entry in 'counts'.
+  void AddUpdateCounts(std::map<ColumnId, int64_t>* counts) const;
+
  private:
   std::unordered_map<ColumnId, int64_t> update_counts_by_col_id_;
   uint64_t delete_count_;
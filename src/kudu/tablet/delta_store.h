@@ -79,6 +79,11 @@ class DeltaStore {
   // can't without RTTI.
   virtual const DeltaStats& delta_stats() const = 0;
 
+  // Returns true if delta_stats() describes the mutations held by this store.
+  // This is false for the DeltaMemStore, which does not track statistics, and
+  // for delta files which have not been initialized yet.
+  virtual bool HasDeltaStats() const = 0;
+
   virtual ~DeltaStore() {}
 };
 
@@ -141,7 +146,12 @@ class DeltaIterator {
   // Apply the snapshotted updates to one of the columns.
   // 'dst' must be the same length as was previously passed to PrepareBatch()
   // Must have called PrepareBatch() with flag = PREPARE_FOR_APPLY.
-  virtual Status ApplyUpdates(size_t col_to_apply, ColumnBlock *dst) = 0;
+  //
+  // If 'filter' is non-NULL, updates to the rows which aren't selected in it
+  // may be skipped, so the caller must not read those cells. It must be at
+  // least as long as 'dst'.
+  virtual Status ApplyUpdates(size_t col_to_apply, ColumnBlock *dst,
+                              const SelectionVector* filter) = 0;
 
   // Apply any deletes to the given selection vector.
   // Rows which have been deleted in the associated MVCC snapshot are set to
@@ -17,6 +17,8 @@
 
 #include "kudu/tablet/delta_tracker.h"
 
+#include <algorithm>
+#include <gflags/gflags.h>
 #include <mutex>
 #include <set>
 
@@ -32,9 +34,12 @@
 #include "kudu/tablet/tablet.pb.h"
 #include "kudu/util/status.h"
 
+DECLARE_bool(tablet_compaction_evict_output_from_page_cache);
+
 namespace kudu {
 namespace tablet {
 
+using fs::CreateBlockOptions;
 using fs::ReadableBlock;
 using fs::WritableBlock;
 using std::shared_ptr;
@@ -217,7 +222,10 @@ Status DeltaTracker::CompactStores(int start_idx, int end_idx) {
   // Open a writer for the new destination delta block
   FsManager* fs = rowset_metadata_->fs_manager();
   gscoped_ptr<WritableBlock> block;
-  RETURN_NOT_OK_PREPEND(fs->CreateNewBlock(&block),
+  CreateBlockOptions block_opts;
+  block_opts.tablet_id = rowset_metadata_->tablet_metadata()->tablet_id();
+  block_opts.evict_from_page_cache = FLAGS_tablet_compaction_evict_output_from_page_cache;
+  RETURN_NOT_OK_PREPEND(fs->CreateNewBlock(block_opts, &block),
                         "Could not allocate delta block");
   BlockId new_block_id(block->id());
 
@@ -387,7 +395,9 @@ Status DeltaTracker::FlushDMS(DeltaMemStore* dms,
   // Open file for write.
   FsManager* fs = rowset_metadata_->fs_manager();
   gscoped_ptr<WritableBlock> writable_block;
-  RETURN_NOT_OK_PREPEND(fs->CreateNewBlock(&writable_block),
+  CreateBlockOptions block_opts;
+  block_opts.tablet_id = rowset_metadata_->tablet_metadata()->tablet_id();
+  RETURN_NOT_OK_PREPEND(fs->CreateNewBlock(block_opts, &writable_block),
                         "Unable to allocate new delta data writable_block");
   BlockId block_id(writable_block->id());
 
@@ -502,6 +512,80 @@ uint64_t DeltaTracker::EstimateOnDiskSize() const {
   return size;
 }
 
+int64_t DeltaTracker::EstimateBytesInPotentiallyAncientUndoDeltas(
+    Timestamp ancient_history_mark) const {
+  shared_lock<rw_spinlock> lock(component_lock_);
+  int64_t bytes = 0;
+  for (const shared_ptr<DeltaStore>& ds : undo_delta_stores_) {
+    if (!ds->HasDeltaStats() ||
+        ds->delta_stats().max_timestamp().ComesBefore(ancient_history_mark)) {
+      bytes += ds->EstimateSize();
+    }
+  }
+  return bytes;
+}
+
+Status DeltaTracker::DeleteAncientUndoDeltas(Timestamp ancient_history_mark,
+                                             int64_t* blocks_deleted,
+                                             int64_t* bytes_deleted) {
+  // Prevent a concurrent flush or compaction from swapping the stores.
+  std::lock_guard<Mutex> l(compact_flush_lock_);
+  CHECK(open_);
+
+  SharedDeltaStoreVector undos;
+  {
+    shared_lock<rw_spinlock> lock(component_lock_);
+    undos = undo_delta_stores_;
+  }
+
+  SharedDeltaStoreVector to_remove;
+  vector<BlockId> blocks_to_remove;
+  int64_t bytes_to_remove = 0;
+  for (const shared_ptr<DeltaStore>& ds : undos) {
+    // Opening the file reads its stats, so do it without holding the lock.
+    RETURN_NOT_OK(ds->Init());
+    if (!ds->delta_stats().max_timestamp().ComesBefore(ancient_history_mark)) {
+      continue;
+    }
+    to_remove.push_back(ds);
+    blocks_to_remove.push_back(down_cast<DeltaFileReader*>(ds.get())->block_id());
+    bytes_to_remove += ds->EstimateSize();
+  }
+  if (to_remove.empty()) {
+    return Status::OK();
+  }
+
+  VLOG(1) << "Deleting " << to_remove.size() << " ancient UNDO delta blocks ("
+          << bytes_to_remove << " bytes) of rowset " << rowset_metadata_->id()
+          << ": " << BlockId::JoinStrings(blocks_to_remove);
+
+  // Persist the removal before dropping the stores, so that a failure leaves
+  // the rowset as it was.
+  RowSetMetadataUpdate update;
+  update.RemoveUndoDeltaBlocks(blocks_to_remove);
+  RETURN_NOT_OK_PREPEND(rowset_metadata_->CommitUpdate(update),
+                        "Unable to remove ancient UNDO delta blocks from the metadata");
+  RETURN_NOT_OK_PREPEND(rowset_metadata_->Flush(),
+                        "Unable to flush the metadata after removing ancient UNDO delta blocks");
+
+  {
+    std::lock_guard<rw_spinlock> lock(component_lock_);
+    for (const shared_ptr<DeltaStore>& ds : to_remove) {
+      auto it = std::find(undo_delta_stores_.begin(), undo_delta_stores_.end(), ds);
+      DCHECK(it != undo_delta_stores_.end());
+      undo_delta_stores_.erase(it);
+    }
+  }
+
+  if (blocks_deleted) {
+    *blocks_deleted += to_remove.size();
+  }
+  if (bytes_deleted) {
+    *bytes_deleted += bytes_to_remove;
+  }
+  return Status::OK();
+}
+
 void DeltaTracker::GetColumnIdsWithUpdates(std::vector<ColumnId>* col_ids) const {
   shared_lock<rw_spinlock> lock(component_lock_);
 
@@ -517,5 +601,36 @@ void DeltaTracker::GetColumnIdsWithUpdates(std::vector<ColumnId>* col_ids) const
   col_ids->assign(column_ids_with_updates.begin(), column_ids_with_updates.end());
 }
 
+void DeltaTracker::GetColumnUpdateCounts(std::map<ColumnId, int64_t>* counts) const {
+  shared_lock<rw_spinlock> lock(component_lock_);
+
+  counts->clear();
+  for (const shared_ptr<DeltaStore>& ds : redo_delta_stores_) {
+    // We won't force open files just to read their stats.
+    if (!ds->Initted()) {
+      continue;
+    }
+
+    ds->delta_stats().AddUpdateCounts(counts);
+  }
+}
+
+bool DeltaTracker::MayHaveUpdatesForColumnId(ColumnId col_id) const {
+  shared_lock<rw_spinlock> lock(component_lock_);
+  if (!dms_empty_.Load()) {
+    return true;
+  }
+  for (const SharedDeltaStoreVector* stores : { &undo_delta_stores_, &redo_delta_stores_ }) {
+    for (const shared_ptr<DeltaStore>& ds : *stores) {
+      // Stores without statistics include a DeltaMemStore which is in the
+      // middle of being flushed.
+      if (!ds->HasDeltaStats() || ds->delta_stats().update_count_for_col_id(col_id) > 0) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
 } // namespace tablet
 } // namespace kudu
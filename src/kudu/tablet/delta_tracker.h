@@ -18,6 +18,7 @@
 #define KUDU_TABLET_DELTATRACKER_H
 
 #include <gtest/gtest_prod.h>
+#include <map>
 #include <memory>
 #include <string>
 #include <vector>
@@ -179,11 +180,38 @@ class DeltaTracker {
   // Return the number of redo delta stores, not including the DeltaMemStore.
   size_t CountRedoDeltaStores() const;
 
+  // Returns the estimated on-disk size of the UNDO delta stores which
+  // DeleteAncientUndoDeltas() might delete: those whose stats show that all
+  // their mutations are older than 'ancient_history_mark', as well as those
+  // whose stats haven't been read yet.
+  int64_t EstimateBytesInPotentiallyAncientUndoDeltas(Timestamp ancient_history_mark) const;
+
+  // Deletes the UNDO delta stores whose mutations are all older than
+  // 'ancient_history_mark', without rewriting any other data. Such deltas
+  // are never applied by a scan at or after the ancient history mark. Delta
+  // files which haven't been opened yet are opened to read their stats.
+  //
+  // The number of deleted blocks and their estimated size are added to
+  // 'blocks_deleted' and 'bytes_deleted', if not null.
+  Status DeleteAncientUndoDeltas(Timestamp ancient_history_mark,
+                                 int64_t* blocks_deleted,
+                                 int64_t* bytes_deleted);
+
   uint64_t EstimateOnDiskSize() const;
 
   // Retrieves the list of column indexes that currently have updates.
   void GetColumnIdsWithUpdates(std::vector<ColumnId>* col_ids) const;
 
+  // Retrieves the number of updates to each column which currently has
+  // updates in the REDO delta files, keyed by column ID.
+  void GetColumnUpdateCounts(std::map<ColumnId, int64_t>* counts) const;
+
+  // Returns true if any of the delta stores, including the UNDO stores, may
+  // hold updates to the given column, in which case the base data alone does
+  // not determine the column's values. Delta stores without statistics, such
+  // as delta files which have not yet been opened, are assumed to hold updates.
+  bool MayHaveUpdatesForColumnId(ColumnId col_id) const;
+
   Mutex* compact_flush_lock() {
     return &compact_flush_lock_;
   }
@@ -157,7 +157,7 @@ class TestDeltaFile : public KuduTest {
 
       ASSERT_OK_FAST(it->PrepareBatch(block.nrows(), DeltaIterator::PREPARE_FOR_APPLY));
       ColumnBlock dst_col = block.column_block(0);
-      ASSERT_OK_FAST(it->ApplyUpdates(0, &dst_col));
+      ASSERT_OK_FAST(it->ApplyUpdates(0, &dst_col, nullptr));
 
       for (int i = 0; i < block.nrows(); i++) {
         uint32_t row = start_row + i;
@@ -27,6 +27,8 @@
 #include "kudu/cfile/block_handle.h"
 #include "kudu/cfile/cfile_reader.h"
 #include "kudu/cfile/cfile_writer.h"
+#include "kudu/cfile/compression_codec.h"
+#include "kudu/common/row.h"
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/mathlimits.h"
 #include "kudu/tablet/mutation.h"
@@ -43,6 +45,12 @@ DEFINE_int32(deltafile_default_block_size, 32*1024,
              "on a per-table basis.");
 TAG_FLAG(deltafile_default_block_size, experimental);
 
+DEFINE_string(deltafile_default_compression_codec, "lz4",
+              "Codec with which to compress the blocks of new delta files: one of "
+              "'none', 'snappy', 'lz4', 'zlib' or 'zstd'. Deltas which update the same "
+              "columns of many rows repeat their column IDs, which compress well.");
+TAG_FLAG(deltafile_default_compression_codec, experimental);
+
 using std::shared_ptr;
 using std::unique_ptr;
 
@@ -74,6 +82,8 @@ DeltaFileWriter::DeltaFileWriter(gscoped_ptr<WritableBlock> block)
   opts.write_validx = true;
   opts.storage_attributes.cfile_block_size = FLAGS_deltafile_default_block_size;
   opts.storage_attributes.encoding = PLAIN_ENCODING;
+  opts.storage_attributes.compression =
+      cfile::GetCompressionCodecType(FLAGS_deltafile_default_compression_codec);
   // No optimization for deltafiles because a deltafile index key must decode into a DeltaKey
   opts.optimize_index_keys = false;
   writer_.reset(new cfile::CFileWriter(opts, GetTypeInfo(BINARY), false, std::move(block)));
@@ -358,6 +368,7 @@ DeltaFileIterator::DeltaFileIterator(shared_ptr<DeltaFileReader> dfr,
       prepared_(false),
       exhausted_(false),
       initted_(false),
+      updates_by_col_prepared_(false),
       delta_type_(delta_type),
       cache_blocks_(CFileReader::CACHE_BLOCK) {}
 
@@ -413,6 +424,7 @@ Status DeltaFileIterator::SeekToOrdinal(rowid_t idx) {
   prepared_idx_ = idx;
   prepared_count_ = 0;
   prepared_ = false;
+  updates_by_col_prepared_ = false;
   delta_blocks_.clear();
   exhausted_ = false;
   return Status::OK();
@@ -530,6 +542,7 @@ Status DeltaFileIterator::PrepareBatch(size_t nrows, PrepareFlag flag) {
   prepared_idx_ = start_row;
   prepared_count_ = nrows;
   prepared_ = true;
+  updates_by_col_prepared_ = false;
   return Status::OK();
 }
 
@@ -626,23 +639,37 @@ inline bool IsUndoRelevant(const MvccSnapshot& snap,
   return true;
 }
 
+// Visitor which decodes the updates of each relevant delta, appending them to
+// the list of updates of the projected column they update.
 template<DeltaType Type>
-struct ApplyingVisitor {
+struct GroupingVisitor {
 
   Status Visit(const DeltaKey &key, const Slice &deltas, bool* continue_visit);
 
-  inline Status ApplyMutation(const DeltaKey &key, const Slice &deltas) {
+  inline Status GroupMutation(const DeltaKey &key, const Slice &deltas) {
     int64_t rel_idx = key.row_idx() - dfi->prepared_idx_;
     DCHECK_GE(rel_idx, 0);
 
-    // TODO: this code looks eerily similar to DMSIterator::ApplyUpdates!
-    // I bet it can be combined.
-
     const Schema* schema = dfi->projection_;
     RowChangeListDecoder decoder((RowChangeList(deltas)));
     RETURN_NOT_OK(decoder.Init());
     if (decoder.is_update()) {
-      return decoder.ApplyToOneColumn(rel_idx, dst, *schema, col_to_apply, dst->arena());
+      while (decoder.HasNext()) {
+        RowChangeListDecoder::DecodedUpdate dec;
+        RETURN_NOT_OK(decoder.DecodeNext(&dec));
+        int col_idx;
+        const void* value;
+        RETURN_NOT_OK(dec.Validate(*schema, &col_idx, &value));
+        if (col_idx == Schema::kColumnNotFound) {
+          continue;
+        }
+        DeltaFileIterator::PreparedUpdate upd;
+        upd.rel_idx = rel_idx;
+        upd.null = dec.null;
+        upd.raw_value = dec.raw_value;
+        dfi->updates_by_col_[col_idx].push_back(upd);
+      }
+      return Status::OK();
     } else if (decoder.is_delete()) {
       // If it's a DELETE, then it will be processed by DeletingVisitor.
       return Status::OK();
@@ -653,46 +680,71 @@ struct ApplyingVisitor {
   }
 
   DeltaFileIterator *dfi;
-  size_t col_to_apply;
-  ColumnBlock *dst;
 };
 
 template<>
-inline Status ApplyingVisitor<REDO>::Visit(const DeltaKey& key,
+inline Status GroupingVisitor<REDO>::Visit(const DeltaKey& key,
                                            const Slice& deltas,
                                            bool* continue_visit) {
   if (IsRedoRelevant(dfi->mvcc_snap_, key.timestamp(), continue_visit)) {
-    DVLOG(3) << "Applied redo delta";
-    return ApplyMutation(key, deltas);
+    return GroupMutation(key, deltas);
   }
   DVLOG(3) << "Redo delta uncommitted, skipped applying.";
   return Status::OK();
 }
 
 template<>
-inline Status ApplyingVisitor<UNDO>::Visit(const DeltaKey& key,
+inline Status GroupingVisitor<UNDO>::Visit(const DeltaKey& key,
                                            const Slice& deltas,
                                            bool* continue_visit) {
   if (IsUndoRelevant(dfi->mvcc_snap_, key.timestamp(), continue_visit)) {
-    DVLOG(3) << "Applied undo delta";
-    return ApplyMutation(key, deltas);
+    return GroupMutation(key, deltas);
   }
   DVLOG(3) << "Undo delta committed, skipped applying.";
   return Status::OK();
 }
 
-Status DeltaFileIterator::ApplyUpdates(size_t col_to_apply, ColumnBlock *dst) {
-  DCHECK_LE(prepared_count_, dst->nrows());
-
+Status DeltaFileIterator::PrepareUpdatesByColumn() {
+  updates_by_col_.resize(projection_->num_columns());
+  for (auto& updates : updates_by_col_) {
+    updates.clear();
+  }
   if (delta_type_ == REDO) {
-    DVLOG(3) << "Applying REDO mutations to " << col_to_apply;
-    ApplyingVisitor<REDO> visitor = {this, col_to_apply, dst};
-    return VisitMutations(&visitor);
+    GroupingVisitor<REDO> visitor = {this};
+    RETURN_NOT_OK(VisitMutations(&visitor));
   } else {
-    DVLOG(3) << "Applying UNDO mutations to " << col_to_apply;
-    ApplyingVisitor<UNDO> visitor = {this, col_to_apply, dst};
-    return VisitMutations(&visitor);
+    GroupingVisitor<UNDO> visitor = {this};
+    RETURN_NOT_OK(VisitMutations(&visitor));
   }
+  updates_by_col_prepared_ = true;
+  return Status::OK();
+}
+
+Status DeltaFileIterator::ApplyUpdates(size_t col_to_apply, ColumnBlock *dst,
+                                       const SelectionVector* filter) {
+  DCHECK_LE(prepared_count_, dst->nrows());
+
+  if (!updates_by_col_prepared_) {
+    RETURN_NOT_OK(PrepareUpdatesByColumn());
+  }
+
+  DVLOG(3) << "Applying " << (delta_type_ == REDO ? "REDO" : "UNDO")
+           << " mutations to " << col_to_apply;
+  const ColumnSchema& col_schema = projection_->column(col_to_apply);
+  const bool is_binary = col_schema.type_info()->physical_type() == BINARY;
+  for (const PreparedUpdate& upd : updates_by_col_[col_to_apply]) {
+    if (filter && !filter->IsRowSelected(upd.rel_idx)) {
+      continue;
+    }
+    const void* value = nullptr;
+    if (!upd.null) {
+      value = is_binary ? static_cast<const void*>(&upd.raw_value) : upd.raw_value.data();
+    }
+    SimpleConstCell src(&col_schema, value);
+    ColumnBlock::Cell dst_cell = dst->cell(upd.rel_idx);
+    RETURN_NOT_OK(CopyCell(src, &dst_cell, dst->arena()));
+  }
+  return Status::OK();
 }
 
 // Visitor which applies deletes to the selection vector.
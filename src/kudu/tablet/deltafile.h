@@ -49,10 +49,10 @@ namespace tablet {
 class DeltaFileIterator;
 class DeltaKey;
 template<DeltaType Type>
-struct ApplyingVisitor;
-template<DeltaType Type>
 struct CollectingVisitor;
 template<DeltaType Type>
+struct GroupingVisitor;
+template<DeltaType Type>
 struct DeletingVisitor;
 
 class DeltaFileWriter {
@@ -148,6 +148,10 @@ class DeltaFileReader : public DeltaStore,
     return *delta_stats_;
   }
 
+  virtual bool HasDeltaStats() const OVERRIDE {
+    return init_once_.initted();
+  }
+
   virtual std::string ToString() const OVERRIDE {
     return reader_->ToString();
   }
@@ -194,7 +198,8 @@ class DeltaFileIterator : public DeltaIterator {
 
   Status SeekToOrdinal(rowid_t idx) OVERRIDE;
   Status PrepareBatch(size_t nrows, PrepareFlag flag) OVERRIDE;
-  Status ApplyUpdates(size_t col_to_apply, ColumnBlock *dst) OVERRIDE;
+  Status ApplyUpdates(size_t col_to_apply, ColumnBlock *dst,
+                      const SelectionVector* filter) OVERRIDE;
   Status ApplyDeletes(SelectionVector *sel_vec) OVERRIDE;
   Status CollectMutations(vector<Mutation *> *dst, Arena *arena) OVERRIDE;
   Status FilterColumnIdsAndCollectDeltas(const std::vector<ColumnId>& col_ids,
@@ -206,8 +211,8 @@ class DeltaFileIterator : public DeltaIterator {
 
  private:
   friend class DeltaFileReader;
-  friend struct ApplyingVisitor<REDO>;
-  friend struct ApplyingVisitor<UNDO>;
+  friend struct GroupingVisitor<REDO>;
+  friend struct GroupingVisitor<UNDO>;
   friend struct CollectingVisitor<REDO>;
   friend struct CollectingVisitor<UNDO>;
   friend struct DeletingVisitor<REDO>;
@@ -252,6 +257,17 @@ class DeltaFileIterator : public DeltaIterator {
     string ToString() const;
   };
 
+  // An update to one cell of the prepared row range, decoded from a delta.
+  struct PreparedUpdate {
+    // The updated row, relative to prepared_idx_.
+    rowid_t rel_idx;
+
+    // Whether the cell is set to NULL. Otherwise, 'raw_value' is the new value,
+    // as in RowChangeListDecoder::DecodedUpdate, pointing into a delta block.
+    bool null;
+    Slice raw_value;
+  };
+
 
   // The passed 'projection' and 'dfr' must remain valid for the lifetime
   // of the iterator.
@@ -276,6 +292,11 @@ class DeltaFileIterator : public DeltaIterator {
   template<class Visitor>
   Status VisitMutations(Visitor *visitor);
 
+  // Decode the deltas of the prepared row range which are relevant to the
+  // snapshot once, grouping their updates by projected column into
+  // 'updates_by_col_'.
+  Status PrepareUpdatesByColumn();
+
   // Log a FATAL error message about a bad delta.
   void FatalUnexpectedDelta(const DeltaKey &key, const Slice &deltas, const string &msg);
 
@@ -306,6 +327,13 @@ class DeltaFileIterator : public DeltaIterator {
   // Temporary buffer used for RowChangeList projection.
   faststring delta_buf_;
 
+  // The updates to each column of the projection in the prepared row range,
+  // in the order they must be applied. Filled in by the first ApplyUpdates()
+  // after PrepareBatch(), so that applying several columns doesn't decode
+  // every delta once per column.
+  std::vector<std::vector<PreparedUpdate>> updates_by_col_;
+  bool updates_by_col_prepared_;
+
   // The type of this delta iterator, i.e. UNDO or REDO.
   const DeltaType delta_type_;
 
@@ -20,6 +20,7 @@
 #include <stdlib.h>
 #include <unordered_set>
 
+#include "kudu/common/rowblock.h"
 #include "kudu/common/schema.h"
 #include "kudu/consensus/consensus.pb.h"
 #include "kudu/consensus/opid_util.h"
@@ -106,7 +107,7 @@ class TestDeltaMemStore : public KuduTest {
     ASSERT_OK(iter->Init(nullptr));
     ASSERT_OK(iter->SeekToOrdinal(row_idx));
     ASSERT_OK(iter->PrepareBatch(cb->nrows(), DeltaIterator::PREPARE_FOR_APPLY));
-    ASSERT_OK(iter->ApplyUpdates(0, cb));
+    ASSERT_OK(iter->ApplyUpdates(0, cb, nullptr));
   }
 
 
@@ -423,7 +424,7 @@ TEST_F(TestDeltaMemStore, TestIteratorDoesUpdates) {
   int block_start_row = 50;
   ASSERT_OK(iter->SeekToOrdinal(block_start_row));
   ASSERT_OK(iter->PrepareBatch(block.nrows(), DeltaIterator::PREPARE_FOR_APPLY));
-  ASSERT_OK(iter->ApplyUpdates(kIntColumn, &block));
+  ASSERT_OK(iter->ApplyUpdates(kIntColumn, &block, nullptr));
 
   for (int i = 0; i < 100; i++) {
     int actual_row = block_start_row + i;
@@ -433,13 +434,96 @@ TEST_F(TestDeltaMemStore, TestIteratorDoesUpdates) {
   // Apply the next block
   block_start_row += block.nrows();
   ASSERT_OK(iter->PrepareBatch(block.nrows(), DeltaIterator::PREPARE_FOR_APPLY));
-  ASSERT_OK(iter->ApplyUpdates(kIntColumn, &block));
+  ASSERT_OK(iter->ApplyUpdates(kIntColumn, &block, nullptr));
   for (int i = 0; i < 100; i++) {
     int actual_row = block_start_row + i;
     ASSERT_EQ(actual_row * 10, block[i]) << "at row " << actual_row;
   }
 }
 
+// Test that updates to the rows which aren't selected in the filter passed to
+// ApplyUpdates() are skipped.
+TEST_F(TestDeltaMemStore, TestApplyUpdatesWithFilter) {
+  unordered_set<uint32_t> to_update;
+  for (uint32_t i = 0; i < 100; i++) {
+    to_update.insert(i);
+  }
+  UpdateIntsAtIndexes(to_update);
+
+  MvccSnapshot snap(mvcc_);
+  ScopedColumnBlock<UINT32> block(100);
+  SelectionVector filter(100);
+  filter.SetAllFalse();
+  for (int i = 0; i < 100; i += 7) {
+    filter.SetRowSelected(i);
+  }
+  for (int i = 0; i < 100; i++) {
+    block[i] = 1;
+  }
+
+  DeltaIterator* raw_iter;
+  ASSERT_OK(dms_->NewDeltaIterator(&schema_, snap, &raw_iter));
+  gscoped_ptr<DMSIterator> iter(down_cast<DMSIterator *>(raw_iter));
+  ASSERT_OK(iter->Init(nullptr));
+  ASSERT_OK(iter->SeekToOrdinal(0));
+  ASSERT_OK(iter->PrepareBatch(block.nrows(), DeltaIterator::PREPARE_FOR_APPLY));
+  ASSERT_OK(iter->ApplyUpdates(kIntColumn, &block, &filter));
+
+  for (int i = 0; i < 100; i++) {
+    ASSERT_EQ(i % 7 == 0 ? i * 10 : 1, block[i]) << "at row " << i;
+  }
+}
+
+// Test that updates setting a nullable column to NULL or to a value are
+// applied correctly across consecutive batches of the same iterator.
+TEST_F(TestDeltaMemStore, TestIteratorAppliesNullableUpdates) {
+  SchemaBuilder builder;
+  ASSERT_OK(builder.AddNullableColumn("val", INT32));
+  Schema schema = builder.Build();
+  shared_ptr<DeltaMemStore> dms(new DeltaMemStore(0, 0, new log::LogAnchorRegistry()));
+
+  faststring buf;
+  RowChangeListEncoder update(&buf);
+  for (int32_t i = 0; i < 200; i += 2) {
+    ScopedTransaction tx(&mvcc_);
+    tx.StartApplying();
+    update.Reset();
+    if (i % 4 == 0) {
+      update.AddColumnUpdate(schema.column(0), schema.column_id(0), nullptr);
+    } else {
+      update.AddColumnUpdate(schema.column(0), schema.column_id(0), &i);
+    }
+    ASSERT_OK(dms->Update(tx.timestamp(), i, RowChangeList(buf), op_id_));
+    tx.Commit();
+  }
+
+  DeltaIterator* raw_iter;
+  ASSERT_OK(dms->NewDeltaIterator(&schema, MvccSnapshot(mvcc_), &raw_iter));
+  gscoped_ptr<DeltaIterator> iter(raw_iter);
+  ASSERT_OK(iter->Init(nullptr));
+  ASSERT_OK(iter->SeekToOrdinal(0));
+
+  ScopedColumnBlock<INT32> block(100);
+  for (int start_row = 0; start_row < 200; start_row += block.nrows()) {
+    for (int i = 0; i < block.nrows(); i++) {
+      block.SetCellIsNull(i, false);
+      block[i] = -1;
+    }
+    ASSERT_OK(iter->PrepareBatch(block.nrows(), DeltaIterator::PREPARE_FOR_APPLY));
+    ASSERT_OK(iter->ApplyUpdates(0, &block, nullptr));
+    for (int i = 0; i < block.nrows(); i++) {
+      int row = start_row + i;
+      SCOPED_TRACE(row);
+      if (row % 4 == 0) {
+        ASSERT_TRUE(block.is_null(i));
+      } else {
+        ASSERT_FALSE(block.is_null(i));
+        ASSERT_EQ(row % 2 == 0 ? row : -1, block[i]);
+      }
+    }
+  }
+}
+
 TEST_F(TestDeltaMemStore, TestCollectMutations) {
   Arena arena(1024, 1024);
 
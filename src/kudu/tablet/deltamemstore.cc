@@ -58,7 +58,7 @@ DeltaMemStore::DeltaMemStore(int64_t id,
     mem_tracker_ = MemTracker::GetRootTracker();
   }
   allocator_.reset(new MemoryTrackingBufferAllocator(
-      HeapBufferAllocator::Get(), mem_tracker_));
+      ChunkPoolBufferAllocator::Get(), mem_tracker_));
   arena_.reset(new ThreadSafeMemoryTrackingArena(
       kInitialArenaSize, kMaxArenaBufferSize, allocator_));
   tree_.reset(new DMSTree(arena_));
@@ -278,13 +278,9 @@ Status DMSIterator::PrepareBatch(size_t nrows, PrepareFlag flag) {
 
           ColumnUpdate& cu = updates_by_col_[col_idx].back();
           cu.row_id = key.row_idx();
-          if (col_val == nullptr) {
-            cu.new_val_ptr = nullptr;
-          } else {
+          cu.is_null = col_val == nullptr;
+          if (!cu.is_null) {
             memcpy(cu.new_val_buf, col_val, col_size);
-            // NOTE: we're constructing a pointer here to an element inside the deque.
-            // This is safe because deques never invalidate pointers to their elements.
-            cu.new_val_ptr = cu.new_val_buf;
           }
         }
       }
@@ -304,17 +300,42 @@ Status DMSIterator::PrepareBatch(size_t nrows, PrepareFlag flag) {
   return Status::OK();
 }
 
-Status DMSIterator::ApplyUpdates(size_t col_to_apply, ColumnBlock *dst) {
+Status DMSIterator::ApplyUpdates(size_t col_to_apply, ColumnBlock *dst,
+                                 const SelectionVector* filter) {
   DCHECK_EQ(prepared_for_, PREPARED_FOR_APPLY);
   DCHECK_EQ(prepared_count_, dst->nrows());
 
   const ColumnSchema* col_schema = &projection_->column(col_to_apply);
-  for (const ColumnUpdate& cu : updates_by_col_[col_to_apply]) {
+  const UpdatesForColumn& updates = updates_by_col_[col_to_apply];
+  if (col_schema->type_info()->physical_type() == BINARY) {
+    for (const ColumnUpdate& cu : updates) {
+      int32_t idx_in_block = cu.row_id - prepared_idx_;
+      DCHECK_GE(idx_in_block, 0);
+      if (filter && !filter->IsRowSelected(idx_in_block)) {
+        continue;
+      }
+      SimpleConstCell src(col_schema, cu.is_null ? nullptr : cu.new_val_buf);
+      ColumnBlock::Cell dst_cell = dst->cell(idx_in_block);
+      RETURN_NOT_OK(CopyCell(src, &dst_cell, dst->arena()));
+    }
+    return Status::OK();
+  }
+
+  // Fixed-size values need no relocation, so copy them straight into the block.
+  const bool nullable = col_schema->is_nullable();
+  for (const ColumnUpdate& cu : updates) {
     int32_t idx_in_block = cu.row_id - prepared_idx_;
     DCHECK_GE(idx_in_block, 0);
-    SimpleConstCell src(col_schema, cu.new_val_ptr);
-    ColumnBlock::Cell dst_cell = dst->cell(idx_in_block);
-    RETURN_NOT_OK(CopyCell(src, &dst_cell, dst->arena()));
+    if (filter && !filter->IsRowSelected(idx_in_block)) {
+      continue;
+    }
+    if (nullable) {
+      dst->SetCellIsNull(idx_in_block, cu.is_null);
+      if (cu.is_null) {
+        continue;
+      }
+    }
+    dst->SetCellValue(idx_in_block, cu.new_val_buf);
   }
 
   return Status::OK();
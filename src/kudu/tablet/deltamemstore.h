@@ -17,7 +17,6 @@
 #ifndef KUDU_TABLET_DELTAMEMSTORE_H
 #define KUDU_TABLET_DELTAMEMSTORE_H
 
-#include <deque>
 #include <gtest/gtest_prod.h>
 #include <memory>
 #include <string>
@@ -139,6 +138,10 @@ class DeltaMemStore : public DeltaStore,
     return delta_stats_;
   }
 
+  virtual bool HasDeltaStats() const OVERRIDE {
+    return false;
+  }
+
  private:
   friend class DMSIterator;
 
@@ -189,7 +192,8 @@ class DMSIterator : public DeltaIterator {
 
   Status PrepareBatch(size_t nrows, PrepareFlag flag) OVERRIDE;
 
-  Status ApplyUpdates(size_t col_to_apply, ColumnBlock *dst) OVERRIDE;
+  Status ApplyUpdates(size_t col_to_apply, ColumnBlock *dst,
+                      const SelectionVector* filter) OVERRIDE;
 
   Status ApplyDeletes(SelectionVector *sel_vec) OVERRIDE;
 
@@ -249,18 +253,22 @@ class DMSIterator : public DeltaIterator {
 
   // State when prepared_for_ == PREPARED_FOR_APPLY
   // ------------------------------------------------------------
+  // The updates of a batch are kept in contiguous per-column buffers which
+  // are cleared, but not freed, between batches, so that preparing a batch
+  // doesn't allocate once the buffers have grown and ApplyUpdates() walks
+  // a flat array for each column.
   struct ColumnUpdate {
     rowid_t row_id;
-    void* new_val_ptr;
+    bool is_null;
     uint8_t new_val_buf[16];
   };
-  typedef std::deque<ColumnUpdate> UpdatesForColumn;
+  typedef std::vector<ColumnUpdate> UpdatesForColumn;
   std::vector<UpdatesForColumn> updates_by_col_;
   struct DeleteOrReinsert {
     rowid_t row_id;
     bool exists;
   };
-  std::deque<DeleteOrReinsert> deletes_and_reinserts_;
+  std::vector<DeleteOrReinsert> deletes_and_reinserts_;
 
   // State when prepared_for_ == PREPARED_FOR_COLLECT
   // ------------------------------------------------------------
@@ -268,7 +276,7 @@ class DMSIterator : public DeltaIterator {
     DeltaKey key;
     Slice val;
   };
-  std::deque<PreparedDelta> prepared_deltas_;
+  std::vector<PreparedDelta> prepared_deltas_;
 
   // Temporary buffer used for RowChangeList projection.
   faststring delta_buf_;
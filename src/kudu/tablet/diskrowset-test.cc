@@ -21,12 +21,16 @@
 #include <memory>
 #include <time.h>
 
+#include "kudu/common/partial_row.h"
 #include "kudu/common/row.h"
+#include "kudu/common/scan_spec.h"
 #include "kudu/common/schema.h"
 #include "kudu/gutil/stringprintf.h"
+#include "kudu/gutil/strings/substitute.h"
 #include "kudu/tablet/delta_compaction.h"
 #include "kudu/tablet/diskrowset.h"
 #include "kudu/tablet/diskrowset-test-base.h"
+#include "kudu/tablet/local_tablet_writer.h"
 #include "kudu/tablet/tablet-test-util.h"
 #include "kudu/util/env.h"
 #include "kudu/util/status.h"
@@ -36,6 +40,8 @@
 DEFINE_double(update_fraction, 0.1f, "fraction of rows to update");
 DECLARE_bool(cfile_lazy_open);
 DECLARE_int32(cfile_default_block_size);
+DECLARE_int32(multi_column_writer_parallelism);
+DECLARE_double(tablet_delta_store_major_compact_min_column_ratio);
 DECLARE_double(tablet_delta_store_major_compact_min_ratio);
 DECLARE_int32(tablet_delta_store_minor_compact_max);
 
@@ -43,6 +49,7 @@ using std::is_sorted;
 using std::shared_ptr;
 using std::unique_ptr;
 using std::unordered_set;
+using strings::Substitute;
 
 namespace kudu {
 namespace tablet {
@@ -165,6 +172,44 @@ TEST_F(TestRowSet, TestRowSetUpdate) {
   VerifyUpdates(*rs, updated);
 }
 
+// Test that the column statistics recorded at flush time allow pruning the
+// rowset, and that pruning stops once the column has been updated.
+TEST_F(TestRowSet, TestColumnStatsPruning) {
+  WriteTestRowSet();
+
+  shared_ptr<DiskRowSet> rs;
+  ASSERT_OK(OpenTestRowSet(&rs));
+
+  ColumnStatsPB stats;
+  ASSERT_TRUE(rs->metadata()->GetColumnStats(schema_.column_id(1), &stats));
+  ASSERT_FALSE(stats.all_null());
+
+  // The values in the rowset are [0, n_rows_).
+  uint32_t lower = n_rows_;
+  uint32_t upper = n_rows_ + 10;
+  ScanSpec outside;
+  outside.AddPredicate(ColumnPredicate::Range(schema_.column(1), &lower, &upper));
+  ASSERT_FALSE(rs->MayMatchPredicates(outside));
+
+  uint32_t inside_lower = 0;
+  uint32_t inside_upper = 10;
+  ScanSpec inside;
+  inside.AddPredicate(ColumnPredicate::Range(schema_.column(1), &inside_lower, &inside_upper));
+  ASSERT_TRUE(rs->MayMatchPredicates(inside));
+
+  // The statistics survive reopening the rowset from its metadata.
+  ASSERT_OK(OpenTestRowSet(&rs));
+  ASSERT_FALSE(rs->MayMatchPredicates(outside));
+
+  // Once the column has been updated, its statistics may be stale and the
+  // rowset must not be pruned, neither before nor after flushing the deltas.
+  OperationResultPB result;
+  ASSERT_OK(UpdateRow(rs.get(), 0, n_rows_ + 5, &result));
+  ASSERT_TRUE(rs->MayMatchPredicates(outside));
+  ASSERT_OK(rs->FlushDeltas());
+  ASSERT_TRUE(rs->MayMatchPredicates(outside));
+}
+
 TEST_F(TestRowSet, TestRandomRead) {
   // Write 100 rows.
   WriteTestRowSet(100);
@@ -536,5 +581,97 @@ TEST_F(TestRowSet, TestCompactStores) {
   ASSERT_TRUE(is_sorted(results.begin(), results.end()));
 }
 
+// Test that a heavily-updated column is major compacted on its own even when
+// the rowset's deltas are small compared to its base data.
+TEST_F(TestRowSet, TestMajorCompactHeavilyUpdatedColumn) {
+  // Never major compact on the size of the deltas alone.
+  FLAGS_tablet_delta_store_major_compact_min_ratio = 1000;
+  FLAGS_tablet_delta_store_major_compact_min_column_ratio = 0.5;
+  FLAGS_cfile_lazy_open = false;
+
+  WriteTestRowSet();
+  shared_ptr<DiskRowSet> rs;
+  ASSERT_OK(OpenTestRowSet(&rs));
+
+  // A few updates aren't worth rewriting the column.
+  unordered_set<uint32_t> updated;
+  UpdateExistingRows(rs.get(), 0.1, &updated);
+  ASSERT_OK(rs->FlushDeltas());
+  ASSERT_EQ(0, rs->DeltaStoresCompactionPerfImprovementScore(RowSet::MAJOR_DELTA_COMPACTION));
+
+  // Once the column has about as many updates as rows, it is.
+  UpdateExistingRows(rs.get(), 0.6, &updated);
+  ASSERT_OK(rs->FlushDeltas());
+  double score = rs->DeltaStoresCompactionPerfImprovementScore(RowSet::MAJOR_DELTA_COMPACTION);
+  BetweenZeroAndOne(score);
+
+  vector<ColumnId> col_ids;
+  ASSERT_DOUBLE_EQ(score, rs->PickColumnsToMajorCompact(&col_ids));
+  ASSERT_EQ(1, col_ids.size());
+  ASSERT_EQ(schema_.column_id(1), col_ids[0]);
+
+  ASSERT_OK(rs->MajorCompactDeltaStores(HistoryGcOpts::Disabled()));
+  ASSERT_EQ(0, rs->DeltaStoresCompactionPerfImprovementScore(RowSet::MAJOR_DELTA_COMPACTION));
+  VerifyUpdates(*rs, updated);
+}
+
+// A tablet with enough columns that flushes append to groups of columns on
+// the column writer pool.
+class TestWideRowSet : public KuduTabletTest {
+ public:
+  static const int kNumValueColumns = 63;
+
+  TestWideRowSet() : KuduTabletTest(CreateSchema()) {}
+
+  static Schema CreateSchema() {
+    SchemaBuilder builder;
+    CHECK_OK(builder.AddKeyColumn("key", INT32));
+    for (int i = 0; i < kNumValueColumns; i++) {
+      CHECK_OK(builder.AddNullableColumn(Substitute("c$0", i), INT32));
+    }
+    return builder.Build();
+  }
+};
+
+TEST_F(TestWideRowSet, TestFlushWritesColumnsInParallel) {
+  google::FlagSaver saver;
+  FLAGS_multi_column_writer_parallelism = 4;
+  const int kNumRows = 1000;
+  LocalTabletWriter writer(tablet().get(), &client_schema());
+  KuduPartialRow row(&client_schema());
+  for (int i = 0; i < kNumRows; i++) {
+    ASSERT_OK(row.SetInt32("key", i));
+    for (int c = 0; c < kNumValueColumns; c++) {
+      if ((i + c) % 7 == 0) {
+        ASSERT_OK(row.SetNull(c + 1));
+      } else {
+        ASSERT_OK(row.SetInt32(c + 1, i * c));
+      }
+    }
+    ASSERT_OK(writer.Insert(row));
+  }
+  ASSERT_OK(tablet()->Flush());
+  ASSERT_EQ(1, tablet()->num_rowsets());
+
+  gscoped_ptr<RowwiseIterator> iter;
+  ASSERT_OK(tablet()->NewRowIterator(client_schema(), &iter));
+  ASSERT_OK(iter->Init(nullptr));
+  vector<string> rows;
+  ASSERT_OK(IterateToStringList(iter.get(), &rows));
+  ASSERT_EQ(kNumRows, rows.size());
+  for (int i = 0; i < kNumRows; i++) {
+    string expected = Substitute("(int32 key=$0", i);
+    for (int c = 0; c < kNumValueColumns; c++) {
+      if ((i + c) % 7 == 0) {
+        expected += Substitute(", int32 c$0=NULL", c);
+      } else {
+        expected += Substitute(", int32 c$0=$1", c, i * c);
+      }
+    }
+    expected += ")";
+    ASSERT_EQ(expected, rows[i]);
+  }
+}
+
 } // namespace tablet
 } // namespace kudu
@@ -17,14 +17,17 @@
 
 #include <algorithm>
 #include <glog/logging.h>
+#include <map>
 #include <mutex>
 #include <vector>
 
 #include "kudu/common/generic_iterators.h"
 #include "kudu/common/iterator.h"
+#include "kudu/common/scan_spec.h"
 #include "kudu/common/schema.h"
 #include "kudu/consensus/log_anchor_registry.h"
 #include "kudu/cfile/bloomfile.h"
+#include "kudu/cfile/cfile_util.h"
 #include "kudu/cfile/cfile_writer.h"
 #include "kudu/cfile/type_encodings.h"
 #include "kudu/gutil/gscoped_ptr.h"
@@ -50,14 +53,30 @@ DEFINE_double(tablet_delta_store_major_compact_min_ratio, 0.1f,
              "can run (Advanced option)");
 TAG_FLAG(tablet_delta_store_major_compact_min_ratio, experimental);
 
+DEFINE_double(tablet_delta_store_major_compact_min_column_ratio, 0.5,
+              "Minimum ratio of the number of updates to a column to the number of rows "
+              "in a rowset before a major compaction can rewrite that column on its own, "
+              "even if the rowset's deltas as a whole are too small to trigger one "
+              "(Advanced option)");
+TAG_FLAG(tablet_delta_store_major_compact_min_column_ratio, experimental);
+
 DEFINE_int32(default_composite_key_index_block_size_bytes, 4096,
              "Block size used for composite key indexes.");
 TAG_FLAG(default_composite_key_index_block_size_bytes, experimental);
 
+DEFINE_bool(tablet_compaction_evict_output_from_page_cache, false,
+            "Whether the data written by rowset and delta compactions should be "
+            "dropped from the OS page cache as it is written, so that large "
+            "compactions don't push out data that scans depend on. Flushes are "
+            "unaffected, as freshly flushed data is likely to be read soon.");
+TAG_FLAG(tablet_compaction_evict_output_from_page_cache, advanced);
+TAG_FLAG(tablet_compaction_evict_output_from_page_cache, experimental);
+
 namespace kudu {
 namespace tablet {
 
 using cfile::BloomFileWriter;
+using fs::CreateBlockOptions;
 using fs::ScopedWritableBlockCloser;
 using fs::WritableBlock;
 using log::LogAnchorRegistry;
@@ -74,8 +93,10 @@ DiskRowSetWriter::DiskRowSetWriter(RowSetMetadata* rowset_metadata,
     : rowset_metadata_(rowset_metadata),
       schema_(schema),
       bloom_sizing_(std::move(bloom_sizing)),
+      evict_from_page_cache_(false),
       finished_(false),
-      written_count_(0) {
+      written_count_(0),
+      written_checksum_(0) {
   CHECK(schema->has_column_ids());
 }
 
@@ -83,7 +104,7 @@ Status DiskRowSetWriter::Open() {
   TRACE_EVENT0("tablet", "DiskRowSetWriter::Open");
 
   FsManager* fs = rowset_metadata_->fs_manager();
-  col_writer_.reset(new MultiColumnWriter(fs, schema_));
+  col_writer_.reset(new MultiColumnWriter(fs, schema_, BlockOptions()));
   RETURN_NOT_OK(col_writer_->Open());
 
   // Open bloom filter.
@@ -97,11 +118,18 @@ Status DiskRowSetWriter::Open() {
   return Status::OK();
 }
 
+CreateBlockOptions DiskRowSetWriter::BlockOptions() const {
+  CreateBlockOptions block_opts;
+  block_opts.tablet_id = rowset_metadata_->tablet_metadata()->tablet_id();
+  block_opts.evict_from_page_cache = evict_from_page_cache_;
+  return block_opts;
+}
+
 Status DiskRowSetWriter::InitBloomFileWriter() {
   TRACE_EVENT0("tablet", "DiskRowSetWriter::InitBloomFileWriter");
   gscoped_ptr<WritableBlock> block;
   FsManager* fs = rowset_metadata_->fs_manager();
-  RETURN_NOT_OK_PREPEND(fs->CreateNewBlock(&block),
+  RETURN_NOT_OK_PREPEND(fs->CreateNewBlock(BlockOptions(), &block),
                         "Couldn't allocate a block for bloom filter");
   rowset_metadata_->set_bloom_block(block->id());
 
@@ -114,7 +142,7 @@ Status DiskRowSetWriter::InitAdHocIndexWriter() {
   TRACE_EVENT0("tablet", "DiskRowSetWriter::InitAdHocIndexWriter");
   gscoped_ptr<WritableBlock> block;
   FsManager* fs = rowset_metadata_->fs_manager();
-  RETURN_NOT_OK_PREPEND(fs->CreateNewBlock(&block),
+  RETURN_NOT_OK_PREPEND(fs->CreateNewBlock(BlockOptions(), &block),
                         "Couldn't allocate a block for compoound index");
 
   rowset_metadata_->set_adhoc_index_block(block->id());
@@ -174,6 +202,8 @@ Status DiskRowSetWriter::AppendBlock(const RowBlock &block) {
     // TODO: performance might be better if we actually batch this -
     // encode a bunch of key slices, then pass them all in one go.
     RowBlockRow row = block.row(i);
+    written_checksum_ += checksummer_.RowCrc32(*schema_, row);
+
     // Insert the encoded key into the bloom.
     Slice enc_key = schema_->EncodeComparableKey(row, &last_encoded_key_);
     RETURN_NOT_OK(bloom_writer_->AppendKeys(&enc_key, 1));
@@ -231,6 +261,14 @@ Status DiskRowSetWriter::FinishAndReleaseBlocks(ScopedWritableBlockCloser* close
   col_writer_->GetFlushedBlocksByColumnId(&flushed_blocks);
   rowset_metadata_->SetColumnDataBlocks(flushed_blocks);
 
+  RowSetMetadata::ColumnIdToStatsMap column_stats;
+  col_writer_->GetColumnStatsByColumnId(&column_stats);
+  rowset_metadata_->SetColumnStats(column_stats);
+
+  RowSetMetadata::ColumnIdToBlockIdMap bitmap_index_blocks;
+  col_writer_->GetBitmapIndexBlocksByColumnId(&bitmap_index_blocks);
+  rowset_metadata_->SetColumnBitmapIndexBlocks(bitmap_index_blocks);
+
   if (ad_hoc_index_writer_ != nullptr) {
     Status s = ad_hoc_index_writer_->FinishAndReleaseBlock(closer);
     if (!s.ok()) {
@@ -283,6 +321,7 @@ RollingDiskRowSetWriter::RollingDiskRowSetWriter(
       schema_(schema),
       bloom_sizing_(std::move(bloom_sizing)),
       target_rowset_size_(target_rowset_size),
+      evict_from_page_cache_(false),
       row_idx_in_cur_drs_(0),
       can_roll_(false),
       written_count_(0),
@@ -307,13 +346,17 @@ Status RollingDiskRowSetWriter::RollWriter() {
   RETURN_NOT_OK(tablet_metadata_->CreateRowSet(&cur_drs_metadata_, schema_));
 
   cur_writer_.reset(new DiskRowSetWriter(cur_drs_metadata_.get(), &schema_, bloom_sizing_));
+  cur_writer_->set_evict_from_page_cache(evict_from_page_cache_);
   RETURN_NOT_OK(cur_writer_->Open());
 
   FsManager* fs = tablet_metadata_->fs_manager();
   gscoped_ptr<WritableBlock> undo_data_block;
   gscoped_ptr<WritableBlock> redo_data_block;
-  RETURN_NOT_OK(fs->CreateNewBlock(&undo_data_block));
-  RETURN_NOT_OK(fs->CreateNewBlock(&redo_data_block));
+  CreateBlockOptions block_opts;
+  block_opts.tablet_id = tablet_metadata_->tablet_id();
+  block_opts.evict_from_page_cache = evict_from_page_cache_;
+  RETURN_NOT_OK(fs->CreateNewBlock(block_opts, &undo_data_block));
+  RETURN_NOT_OK(fs->CreateNewBlock(block_opts, &redo_data_block));
   cur_undo_ds_block_id_ = undo_data_block->id();
   cur_redo_ds_block_id_ = redo_data_block->id();
   cur_undo_writer_.reset(new DeltaFileWriter(std::move(undo_data_block)));
@@ -422,6 +465,17 @@ Status RollingDiskRowSetWriter::FinishCurrentWriter() {
       DCHECK_EQ(cur_redo_delta_stats->min_timestamp(), Timestamp::kMax);
     }
 
+    // The base data reflects the mutations of all of the UNDOs, and of none
+    // of the REDOs.
+    BaseDataChecksumPB checksum;
+    checksum.set_checksum(cur_writer_->written_checksum());
+    checksum.set_num_rows(cur_writer_->written_count());
+    for (int i = 0; i < schema_.num_columns(); i++) {
+      checksum.add_column_ids(schema_.column_id(i));
+    }
+    checksum.set_timestamp(cur_undo_delta_stats->max_timestamp().ToUint64());
+    cur_drs_metadata_->SetBaseDataChecksum(checksum);
+
     written_size_ += cur_writer_->written_size();
 
     written_drs_metas_.push_back(cur_drs_metadata_);
@@ -509,7 +563,7 @@ Status DiskRowSet::MinorCompactDeltaStores() {
 
 Status DiskRowSet::MajorCompactDeltaStores(HistoryGcOpts history_gc_opts) {
   vector<ColumnId> col_ids;
-  delta_tracker_->GetColumnIdsWithUpdates(&col_ids);
+  PickColumnsToMajorCompact(&col_ids);
 
   if (col_ids.empty()) {
     return Status::OK();
@@ -564,7 +618,11 @@ Status DiskRowSet::NewMajorDeltaCompaction(const vector<ColumnId>& col_ids,
     &included_stores,
     &delta_iter));
 
+  CreateBlockOptions block_opts;
+  block_opts.tablet_id = rowset_metadata_->tablet_metadata()->tablet_id();
+  block_opts.evict_from_page_cache = FLAGS_tablet_compaction_evict_output_from_page_cache;
   out->reset(new MajorDeltaCompaction(rowset_metadata_->fs_manager(),
+                                      block_opts,
                                       *schema,
                                       base_data_.get(),
                                       std::move(delta_iter),
@@ -589,6 +647,79 @@ Status DiskRowSet::NewRowIterator(const Schema *projection,
   return Status::OK();
 }
 
+bool DiskRowSet::MayMatchPredicates(const ScanSpec& spec) const {
+  DCHECK(open_);
+  shared_lock<rw_spinlock> l(component_lock_.get_lock());
+
+  const Schema& schema = rowset_metadata_->tablet_schema();
+  for (const auto& col_pred : spec.predicates()) {
+    const ColumnPredicate& pred = col_pred.second;
+    int col_idx = schema.find_column(pred.column().name());
+    if (col_idx == Schema::kColumnNotFound) {
+      continue;
+    }
+    const ColumnSchema& col_schema = schema.column(col_idx);
+    if (col_schema.type_info()->physical_type() !=
+        pred.column().type_info()->physical_type()) {
+      continue;
+    }
+
+    // The statistics only describe the base data, so they can't be used if
+    // an update, or the undo of one, could change the column's values.
+    ColumnId col_id = schema.column_id(col_idx);
+    ColumnStatsPB stats;
+    if (!rowset_metadata_->GetColumnStats(col_id, &stats) ||
+        delta_tracker_->MayHaveUpdatesForColumnId(col_id)) {
+      continue;
+    }
+
+    // No predicate matches null cells.
+    if (stats.all_null()) {
+      return false;
+    }
+    if (stats.has_min_value() && stats.has_max_value() &&
+        !cfile::ValueBoundsMayMatch(col_schema.type_info(), pred,
+                                    stats.min_value(), stats.max_value())) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool DiskRowSet::AddStoredChecksum(const Schema& projection,
+                                   const MvccSnapshot& snap,
+                                   StoredChecksums* checksums) const {
+  DCHECK(open_);
+  shared_lock<rw_spinlock> l(component_lock_.get_lock());
+
+  BaseDataChecksumPB stored;
+  if (!rowset_metadata_->GetBaseDataChecksum(&stored)) {
+    return false;
+  }
+  // A DeltaMemStore which is being flushed counts as a REDO delta store.
+  if (!delta_tracker_->DeltaMemStoreEmpty() ||
+      delta_tracker_->CountRedoDeltaStores() > 0) {
+    return false;
+  }
+  if (snap.MayHaveUncommittedTransactionsAtOrBefore(Timestamp(stored.timestamp()))) {
+    return false;
+  }
+  // The CRC of a row covers the position of each column, so the projection
+  // must hold the same columns in the same order.
+  if (!projection.has_column_ids() ||
+      projection.num_columns() != stored.column_ids_size()) {
+    return false;
+  }
+  for (int i = 0; i < stored.column_ids_size(); i++) {
+    if (projection.column_id(i) != ColumnId(stored.column_ids(i))) {
+      return false;
+    }
+  }
+  checksums->checksum += stored.checksum();
+  checksums->num_rows += stored.num_rows();
+  return true;
+}
+
 Status DiskRowSet::NewCompactionInput(const Schema* projection,
                                       const MvccSnapshot &snap,
                                       gscoped_ptr<CompactionInput>* out) const  {
@@ -694,12 +825,48 @@ size_t DiskRowSet::CountDeltaStores() const {
 
 
 
+double DiskRowSet::PickColumnsToMajorCompact(vector<ColumnId>* col_ids) const {
+  col_ids->clear();
+  std::map<ColumnId, int64_t> update_counts;
+  delta_tracker_->GetColumnUpdateCounts(&update_counts);
+  // If we have files but no updates, we don't want to major compact.
+  if (update_counts.empty()) {
+    return 0;
+  }
+
+  // If the deltas are large compared to the base data, rewrite every updated column.
+  double ratio = static_cast<double>(EstimateDeltaDiskSize()) / EstimateBaseDataDiskSize();
+  if (ratio >= FLAGS_tablet_delta_store_major_compact_min_ratio) {
+    for (const auto& e : update_counts) {
+      col_ids->push_back(e.first);
+    }
+    return ratio;
+  }
+
+  // Otherwise, rewrite only the heavily-updated columns. A scan of a column
+  // applies about update_count/num_rows deltas per row, all of which the
+  // rewrite saves, so the sum of those ratios is the expected improvement.
+  double savings = 0;
+  double num_rows = std::max<int64_t>(1, delta_tracker_->num_rows());
+  for (const auto& e : update_counts) {
+    double column_ratio = e.second / num_rows;
+    if (column_ratio >= FLAGS_tablet_delta_store_major_compact_min_column_ratio) {
+      col_ids->push_back(e.first);
+      savings += column_ratio;
+    }
+  }
+  return savings;
+}
+
 // In this implementation, the returned improvement score is 0 if there aren't any redo files to
 // compact or if the base data is empty. After this, with a max score of 1:
 //  - Major compactions: the score will be the result of sizeof(deltas)/sizeof(base data), unless
 //                       it is smaller than tablet_delta_store_major_compact_min_ratio or if the
 //                       delta files are only composed of deletes, in which case the score is
-//                       brought down to zero.
+//                       brought down to zero. Below that ratio, columns whose update count is
+//                       at least tablet_delta_store_major_compact_min_column_ratio times the
+//                       row count are still worth rewriting on their own, and the score is the
+//                       sum of those columns' ratios.
 //  - Minor compactions: the score will be zero if there's only 1 redo file, else it will be the
 //                       result of redo_files_count/tablet_delta_store_minor_compact_max. The
 //                       latter is meant to be high since minor compactions don't give us much, so
@@ -708,22 +875,14 @@ double DiskRowSet::DeltaStoresCompactionPerfImprovementScore(DeltaCompactionType
   DCHECK(open_);
   double perf_improv = 0;
   size_t store_count = CountDeltaStores();
-  uint64_t base_data_size = EstimateBaseDataDiskSize();
 
   if (store_count == 0) {
     return perf_improv;
   }
 
   if (type == RowSet::MAJOR_DELTA_COMPACTION) {
-    vector<ColumnId> col_ids_with_updates;
-    delta_tracker_->GetColumnIdsWithUpdates(&col_ids_with_updates);
-    // If we have files but no updates, we don't want to major compact.
-    if (!col_ids_with_updates.empty()) {
-      double ratio = static_cast<double>(EstimateDeltaDiskSize()) / base_data_size;
-      if (ratio >= FLAGS_tablet_delta_store_major_compact_min_ratio) {
-        perf_improv = ratio;
-      }
-    }
+    vector<ColumnId> col_ids_to_compact;
+    perf_improv = PickColumnsToMajorCompact(&col_ids_to_compact);
   } else if (type == RowSet::MINOR_DELTA_COMPACTION) {
     if (store_count > 1) {
       perf_improv = static_cast<double>(store_count) / FLAGS_tablet_delta_store_minor_compact_max;
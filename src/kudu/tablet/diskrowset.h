@@ -29,6 +29,7 @@
 #include <vector>
 
 #include "kudu/common/row.h"
+#include "kudu/common/row_checksum.h"
 #include "kudu/common/schema.h"
 #include "kudu/fs/block_manager.h"
 #include "kudu/gutil/macros.h"
@@ -74,6 +75,10 @@ class DiskRowSetWriter {
 
   ~DiskRowSetWriter();
 
+  // Whether the rowset's blocks should be dropped from the page cache as
+  // they're written. Must be called before Open().
+  void set_evict_from_page_cache(bool evict) { evict_from_page_cache_ = evict; }
+
   Status Open();
 
   // The block is written to all column writers as well as the bloom filter,
@@ -98,6 +103,13 @@ class DiskRowSetWriter {
     return written_count_;
   }
 
+  // Returns the sum of the CRC32Cs of the rows written, as a checksum scan
+  // of all of the columns of 'schema()' computes it.
+  uint64_t written_checksum() const {
+    CHECK(finished_);
+    return written_checksum_;
+  }
+
   // Return the total number of bytes written so far to this DiskRowSet.
   // Additional bytes may be written by "Finish()", but this should provide
   // a reasonable estimate for the total data size.
@@ -118,13 +130,20 @@ class DiskRowSetWriter {
   // (the ad-hoc writer for composite keys, otherwise the key column writer)
   cfile::CFileWriter *key_index_writer();
 
+  // Returns the options with which to create the rowset's blocks.
+  fs::CreateBlockOptions BlockOptions() const;
+
   RowSetMetadata *rowset_metadata_;
   const Schema* const schema_;
 
   BloomFilterSizing bloom_sizing_;
 
+  bool evict_from_page_cache_;
+
   bool finished_;
   rowid_t written_count_;
+  RowChecksummer checksummer_;
+  uint64_t written_checksum_;
   gscoped_ptr<MultiColumnWriter> col_writer_;
   gscoped_ptr<cfile::BloomFileWriter> bloom_writer_;
   gscoped_ptr<cfile::CFileWriter> ad_hoc_index_writer_;
@@ -149,6 +168,9 @@ class RollingDiskRowSetWriter {
                           size_t target_rowset_size);
   ~RollingDiskRowSetWriter();
 
+  // See DiskRowSetWriter::set_evict_from_page_cache().
+  void set_evict_from_page_cache(bool evict) { evict_from_page_cache_ = evict; }
+
   Status Open();
 
   // The block is written to all column writers as well as the bloom filter,
@@ -222,6 +244,7 @@ class RollingDiskRowSetWriter {
   std::shared_ptr<RowSetMetadata> cur_drs_metadata_;
   const BloomFilterSizing bloom_sizing_;
   const size_t target_rowset_size_;
+  bool evict_from_page_cache_;
 
   gscoped_ptr<DiskRowSetWriter> cur_writer_;
 
@@ -315,6 +338,17 @@ class DiskRowSet : public RowSet {
                                 const MvccSnapshot &snap,
                                 gscoped_ptr<RowwiseIterator>* out) const OVERRIDE;
 
+  // Consults the statistics of the base data of the columns with predicates.
+  // Columns which may have updates in the delta stores are not considered.
+  bool MayMatchPredicates(const ScanSpec& spec) const OVERRIDE;
+
+  // Uses the checksum of the base data written with the rowset, which is
+  // only valid while the rowset has no REDOs and the snapshot needs none of
+  // its UNDOs.
+  bool AddStoredChecksum(const Schema& projection,
+                         const MvccSnapshot& snap,
+                         StoredChecksums* checksums) const OVERRIDE;
+
   virtual Status NewCompactionInput(const Schema* projection,
                                     const MvccSnapshot &snap,
                                     gscoped_ptr<CompactionInput>* out) const OVERRIDE;
@@ -346,7 +380,8 @@ class DiskRowSet : public RowSet {
 
   double DeltaStoresCompactionPerfImprovementScore(DeltaCompactionType type) const OVERRIDE;
 
-  // Major compacts all the delta files for all the columns.
+  // Major compacts all the delta files for the columns picked by
+  // PickColumnsToMajorCompact().
   Status MajorCompactDeltaStores(HistoryGcOpts history_gc_opts);
 
   std::mutex *compact_flush_lock() OVERRIDE {
@@ -370,6 +405,7 @@ class DiskRowSet : public RowSet {
  private:
   FRIEND_TEST(TestRowSet, TestRowSetUpdate);
   FRIEND_TEST(TestRowSet, TestDMSFlush);
+  FRIEND_TEST(TestRowSet, TestMajorCompactHeavilyUpdatedColumn);
   FRIEND_TEST(TestCompaction, TestOneToOne);
   FRIEND_TEST(TabletHistoryGcTest, TestMajorDeltaCompactionOnSubsetOfColumns);
 
@@ -382,6 +418,12 @@ class DiskRowSet : public RowSet {
 
   Status Open();
 
+  // Fills 'col_ids' with the columns which a major delta compaction should
+  // rewrite, and returns the expected performance improvement of doing so.
+  // If the deltas are large relative to the base data, all updated columns
+  // are picked; otherwise only the columns with enough updates per row.
+  double PickColumnsToMajorCompact(std::vector<ColumnId>* col_ids) const;
+
   // Create a new major delta compaction object to compact the specified columns.
   Status NewMajorDeltaCompaction(const std::vector<ColumnId>& col_ids,
                                  HistoryGcOpts history_gc_opts,
@@ -25,6 +25,7 @@
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/tablet/lock_manager.h"
 #include "kudu/util/env.h"
+#include "kudu/util/metrics.h"
 #include "kudu/util/stopwatch.h"
 #include "kudu/util/test_util.h"
 #include "kudu/util/thread.h"
@@ -36,10 +37,18 @@ DEFINE_int32(num_test_threads, 10, "number of stress test client threads");
 DEFINE_int32(num_iterations, 1000, "number of iterations per client thread");
 
 namespace kudu {
+
+METRIC_DEFINE_entity(lock_manager_test);
+METRIC_DEFINE_histogram(lock_manager_test, test_row_lock_wait_duration,
+                        "Test Row Lock Wait Duration", MetricUnit::kMicroseconds,
+                        "Row lock wait histogram for tests", 60000000LU, 2);
+
 namespace tablet {
 
 static const TransactionState* kFakeTransaction =
   reinterpret_cast<TransactionState*>(0xdeadbeef);
+static const TransactionState* kOtherFakeTransaction =
+  reinterpret_cast<TransactionState*>(0xcafebabe);
 
 class LockManagerTest : public KuduTest {
  public:
@@ -92,6 +101,38 @@ TEST_F(LockManagerTest, TestRelockSameRow) {
   VerifyAlreadyLocked(key_a);
 }
 
+static void LockAndRelease(LockManager* manager, const Slice* key) {
+  ScopedRowLock l(manager, kOtherFakeTransaction, *key, LockManager::LOCK_EXCLUSIVE);
+  CHECK(l.acquired());
+}
+
+// Test that only contended lock acquisitions are recorded in the wait
+// duration histogram.
+TEST_F(LockManagerTest, TestWaitDurationHistogram) {
+  MetricRegistry registry;
+  scoped_refptr<MetricEntity> entity =
+      METRIC_ENTITY_lock_manager_test.Instantiate(&registry, "test");
+  scoped_refptr<Histogram> hist = METRIC_test_row_lock_wait_duration.Instantiate(entity);
+  lock_manager_.set_wait_duration_histogram(hist);
+
+  Slice key_a("a");
+  {
+    ScopedRowLock l(&lock_manager_, kFakeTransaction, key_a, LockManager::LOCK_EXCLUSIVE);
+  }
+  ASSERT_EQ(0, hist->TotalCount());
+
+  scoped_refptr<kudu::Thread> thread;
+  {
+    ScopedRowLock l(&lock_manager_, kFakeTransaction, key_a, LockManager::LOCK_EXCLUSIVE);
+    ASSERT_OK(kudu::Thread::Create("test", "lock", &LockAndRelease,
+                                   &lock_manager_, &key_a, &thread));
+    SleepFor(MonoDelta::FromMilliseconds(100));
+  }
+  thread->Join();
+  ASSERT_EQ(1, hist->TotalCount());
+  ASSERT_GT(hist->MaxValueForTests(), 0);
+}
+
 TEST_F(LockManagerTest, TestMoveLock) {
   // Acquire a lock.
   Slice key_a("a");
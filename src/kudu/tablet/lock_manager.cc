@@ -27,6 +27,8 @@
 #include "kudu/gutil/hash/city.h"
 #include "kudu/gutil/walltime.h"
 #include "kudu/util/locks.h"
+#include "kudu/util/logging.h"
+#include "kudu/util/metrics.h"
 #include "kudu/util/semaphore.h"
 #include "kudu/util/trace.h"
 
@@ -202,7 +204,7 @@ LockEntry *LockTable::GetLockEntry(const Slice& key) {
 void LockTable::ReleaseLockEntry(LockEntry *entry) {
   bool removed = false;
   {
-    std::lock_guard<rw_spinlock> table_rdlock(lock_.get_lock());
+    shared_lock<rw_spinlock> table_rdlock(lock_.get_lock());
     Bucket *bucket = FindBucket(entry->key_hash_);
     {
       std::lock_guard<simple_spinlock> bucket_lock(bucket->lock);
@@ -349,21 +351,25 @@ LockManager::LockStatus LockManager::Lock(const Slice& key,
 
     // If we couldn't immediately acquire the lock, do a timed lock so we can
     // warn if it takes a long time.
-    // TODO: would be nice to hook in some histogram metric about lock acquisition
-    // time. For now we just associate with per-request metrics.
     TRACE_COUNTER_INCREMENT("row_lock_wait_count", 1);
     MicrosecondsInt64 start_wait_us = GetMonoTimeMicros();
     int waited_seconds = 0;
     while (!(*entry)->sem.TimedAcquire(MonoDelta::FromSeconds(1))) {
       const TransactionState* cur_holder = ANNOTATE_UNPROTECTED_READ((*entry)->holder_);
-      LOG(WARNING) << "Waited " << (++waited_seconds) << " seconds to obtain row lock on key "
-                   << key.ToDebugString() << " cur holder: " << cur_holder;
+      ++waited_seconds;
+      KLOG_EVERY_N_SECS(WARNING, 1) << "Waited " << waited_seconds
+                                    << " seconds to obtain row lock on key "
+                                    << key.ToDebugString() << " cur holder: " << cur_holder
+                                    << THROTTLE_MSG;
       // TODO: would be nice to also include some info about the blocking transaction,
       // but it's a bit tricky to do in a non-racy fashion (the other transaction may
       // complete at any point)
     }
     MicrosecondsInt64 wait_us = GetMonoTimeMicros() - start_wait_us;
     TRACE_COUNTER_INCREMENT("row_lock_wait_us", wait_us);
+    if (wait_duration_histogram_) {
+      wait_duration_histogram_->Increment(wait_us);
+    }
     if (wait_us > 100 * 1000) {
       TRACE("Waited $0us for lock on $1", wait_us, key.ToDebugString());
     }
@@ -19,9 +19,14 @@
 
 #include "kudu/gutil/macros.h"
 #include "kudu/gutil/move.h"
+#include "kudu/gutil/ref_counted.h"
 #include "kudu/util/slice.h"
 
-namespace kudu { namespace tablet {
+namespace kudu {
+
+class Histogram;
+
+namespace tablet {
 
 class LockManager;
 class LockTable;
@@ -49,6 +54,13 @@ class LockManager {
     LOCK_EXCLUSIVE
   };
 
+  // Record the time, in microseconds, that each contended Lock() call spends
+  // waiting for the row lock into 'hist'. Must be called before any locks
+  // are taken.
+  void set_wait_duration_histogram(scoped_refptr<Histogram> hist) {
+    wait_duration_histogram_ = std::move(hist);
+  }
+
  private:
   friend class ScopedRowLock;
   friend class LockManagerTest;
@@ -61,6 +73,8 @@ class LockManager {
 
   LockTable *locks_;
 
+  scoped_refptr<Histogram> wait_duration_histogram_;
+
   DISALLOW_COPY_AND_ASSIGN(LockManager);
 };
 
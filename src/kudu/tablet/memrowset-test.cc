@@ -15,21 +15,31 @@
 // specific language governing permissions and limitations
 // under the License.
 
+#include <algorithm>
 #include <gflags/gflags.h>
 #include <glog/logging.h>
 #include <gtest/gtest.h>
+#include <thread>
 
 #include "kudu/common/row.h"
 #include "kudu/common/scan_spec.h"
 #include "kudu/consensus/log_anchor_registry.h"
 #include "kudu/consensus/opid_util.h"
+#include "kudu/gutil/stringprintf.h"
 #include "kudu/server/logical_clock.h"
 #include "kudu/tablet/memrowset.h"
 #include "kudu/tablet/tablet-test-util.h"
+#include "kudu/util/pb_util.h"
 #include "kudu/util/stopwatch.h"
 #include "kudu/util/test_macros.h"
+#include "kudu/util/test_util.h"
 
 DECLARE_bool(enable_data_block_fsync);
+DECLARE_bool(mrs_arena_per_cpu);
+DECLARE_bool(mrs_columnar_projection);
+DECLARE_bool(mrs_precompiled_projection);
+DECLARE_bool(mrs_use_codegen);
+DECLARE_int32(mrs_num_shards);
 DEFINE_int32(roundtrip_num_rows, 10000,
              "Number of rows to use for the round-trip test");
 DEFINE_int32(num_scan_passes, 1,
@@ -42,7 +52,7 @@ using consensus::OpId;
 using log::LogAnchorRegistry;
 using std::shared_ptr;
 
-class TestMemRowSet : public ::testing::Test {
+class TestMemRowSet : public KuduTest {
  public:
   TestMemRowSet()
     : op_id_(consensus::MaximumOpId()),
@@ -215,6 +225,211 @@ TEST_F(TestMemRowSet, TestInsertAndIterate) {
   ASSERT_FALSE(iter->HasNext());
 }
 
+// With the rows split across several shard trees, inserts, lookups and
+// mutations should behave as with one tree, and iteration should still
+// return the rows in key order.
+TEST_F(TestMemRowSet, TestShardedInsertAndIterate) {
+  google::FlagSaver saver;
+  FLAGS_mrs_num_shards = 4;
+  shared_ptr<MemRowSet> mrs(new MemRowSet(0, schema_, log_anchor_registry_.get()));
+
+  const int kNumRows = 1000;
+  vector<int> order;
+  for (int i = 0; i < kNumRows; i++) {
+    order.push_back(i);
+  }
+  std::random_shuffle(order.begin(), order.end());
+  for (int i : order) {
+    ASSERT_OK(InsertRow(mrs.get(), StringPrintf("hello %04d", i), i));
+  }
+  ASSERT_EQ(kNumRows, mrs->entry_count());
+  ASSERT_TRUE(InsertRow(mrs.get(), "hello 0042", 0).IsAlreadyPresent());
+
+  OperationResultPB result;
+  ASSERT_OK(UpdateRow(mrs.get(), "hello 0042", 12345, &result));
+  ASSERT_OK(DeleteRow(mrs.get(), "hello 0043", &result));
+  bool present;
+  ASSERT_OK(CheckRowPresent(*mrs, "hello 0043", &present));
+  ASSERT_FALSE(present);
+  ASSERT_OK(CheckRowPresent(*mrs, "hello 0044", &present));
+  ASSERT_TRUE(present);
+
+  gscoped_ptr<MemRowSet::Iterator> iter(mrs->NewIterator());
+  ASSERT_OK(iter->Init(nullptr));
+  vector<string> out;
+  ASSERT_OK(IterateToStringList(iter.get(), &out));
+  ASSERT_EQ(kNumRows - 1, out.size());
+  EXPECT_EQ("(string key=hello 0000, uint32 val=0)", out[0]);
+  EXPECT_EQ("(string key=hello 0042, uint32 val=12345)", out[42]);
+  EXPECT_EQ("(string key=hello 0044, uint32 val=44)", out[43]);
+  EXPECT_EQ("(string key=hello 0999, uint32 val=999)", out.back());
+
+  CheckValue(mrs, "hello 0500", "(string key=hello 0500, uint32 val=500)");
+}
+
+// Concurrent writers copy their rows into the arenas of different CPUs, all
+// of which are accounted for in the MemRowSet's footprint.
+TEST_F(TestMemRowSet, TestConcurrentInsertsIntoPerCpuArenas) {
+  google::FlagSaver saver;
+  FLAGS_mrs_arena_per_cpu = true;
+  shared_ptr<MemRowSet> mrs(new MemRowSet(0, schema_, log_anchor_registry_.get()));
+
+  const int kNumThreads = 8;
+  const int kRowsPerThread = 1000;
+  vector<std::thread> threads;
+  for (int t = 0; t < kNumThreads; t++) {
+    threads.emplace_back([&, t]() {
+      for (int i = 0; i < kRowsPerThread; i++) {
+        int val = t * kRowsPerThread + i;
+        CHECK_OK(InsertRow(mrs.get(), StringPrintf("hello %05d", val), val));
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+
+  const int kNumRows = kNumThreads * kRowsPerThread;
+  ASSERT_EQ(kNumRows, mrs->entry_count());
+  ASSERT_GT(mrs->memory_footprint(), kNumRows * strlen("hello 00000"));
+
+  gscoped_ptr<MemRowSet::Iterator> iter(mrs->NewIterator());
+  ASSERT_OK(iter->Init(nullptr));
+  vector<string> out;
+  ASSERT_OK(IterateToStringList(iter.get(), &out));
+  ASSERT_EQ(kNumRows, out.size());
+  EXPECT_EQ("(string key=hello 00000, uint32 val=0)", out[0]);
+  EXPECT_EQ("(string key=hello 07999, uint32 val=7999)", out.back());
+}
+
+// Test that projecting rows column by column returns the same results as the
+// row-by-row projection, for a projection which drops and reorders columns
+// and includes nullable and updated cells.
+TEST_F(TestMemRowSet, TestColumnarProjection) {
+  google::FlagSaver saver;
+  SchemaBuilder builder;
+  ASSERT_OK(builder.AddKeyColumn("key", STRING));
+  ASSERT_OK(builder.AddColumn("val", UINT32));
+  ASSERT_OK(builder.AddNullableColumn("note", STRING));
+  Schema schema = builder.Build();
+  shared_ptr<MemRowSet> mrs(new MemRowSet(0, schema, log_anchor_registry_.get()));
+
+  const int kNumRows = 1000;
+  RowBuilder rb(schema);
+  for (int i = 0; i < kNumRows; i++) {
+    ScopedTransaction tx(&mvcc_);
+    tx.StartApplying();
+    rb.Reset();
+    rb.AddString(StringPrintf("hello %04d", i));
+    rb.AddUint32(i);
+    if (i % 3 == 0) {
+      rb.AddNull();
+    } else {
+      rb.AddString(StringPrintf("note %d", i));
+    }
+    ASSERT_OK(mrs->Insert(tx.timestamp(), rb.row(), op_id_));
+    tx.Commit();
+  }
+
+  // Update every tenth row so that the batches mix mutated and unmutated rows.
+  RowBuilder key_rb(schema.CreateKeyProjection());
+  for (int i = 0; i < kNumRows; i += 10) {
+    ScopedTransaction tx(&mvcc_);
+    tx.StartApplying();
+    uint32_t new_val = i * 100;
+    mutation_buf_.clear();
+    RowChangeListEncoder update(&mutation_buf_);
+    update.AddColumnUpdate(schema.column(1), schema.column_id(1), &new_val);
+    key_rb.Reset();
+    key_rb.AddString(StringPrintf("hello %04d", i));
+    RowSetKeyProbe probe(key_rb.row());
+    ProbeStats stats;
+    OperationResultPB result;
+    ASSERT_OK(mrs->MutateRow(tx.timestamp(), probe, RowChangeList(mutation_buf_),
+                             op_id_, &stats, &result));
+    tx.Commit();
+  }
+
+  Schema projection({ schema.column(2), schema.column(1) },
+                    { schema.column_id(2), schema.column_id(1) }, 0);
+  vector<string> results[2];
+  for (int columnar = 0; columnar < 2; columnar++) {
+    FLAGS_mrs_columnar_projection = columnar;
+    gscoped_ptr<MemRowSet::Iterator> iter(mrs->NewIterator(&projection,
+                                                           MvccSnapshot(mvcc_)));
+    ASSERT_OK(iter->Init(nullptr));
+    ASSERT_OK(IterateToStringList(iter.get(), &results[columnar]));
+  }
+  ASSERT_EQ(kNumRows, results[1].size());
+  ASSERT_EQ(results[0], results[1]);
+  EXPECT_EQ("(string note=NULL, uint32 val=0)", results[1][0]);
+  EXPECT_EQ("(string note=note 1, uint32 val=1)", results[1][1]);
+  EXPECT_EQ("(string note=note 10, uint32 val=1000)", results[1][10]);
+  EXPECT_EQ("(string note=NULL, uint32 val=999)", results[1][999]);
+}
+
+// The precompiled projectors, used until the code-generated ones are compiled,
+// must produce the same rows as the generic one, including for nullable and
+// defaulted columns.
+TEST_F(TestMemRowSet, TestPrecompiledProjection) {
+  google::FlagSaver saver;
+  FLAGS_mrs_use_codegen = false;
+  FLAGS_mrs_columnar_projection = false;
+  SchemaBuilder builder;
+  ASSERT_OK(builder.AddKeyColumn("key", STRING));
+  ASSERT_OK(builder.AddColumn("val", UINT32));
+  ASSERT_OK(builder.AddNullableColumn("note", STRING));
+  ASSERT_OK(builder.AddNullableColumn("num", INT64));
+  Schema schema = builder.Build();
+  shared_ptr<MemRowSet> mrs(new MemRowSet(0, schema, log_anchor_registry_.get()));
+
+  const int kNumRows = 100;
+  RowBuilder rb(schema);
+  for (int i = 0; i < kNumRows; i++) {
+    ScopedTransaction tx(&mvcc_);
+    tx.StartApplying();
+    rb.Reset();
+    rb.AddString(StringPrintf("hello %04d", i));
+    rb.AddUint32(i);
+    if (i % 3 == 0) {
+      rb.AddNull();
+      rb.AddInt64(i);
+    } else {
+      rb.AddString(StringPrintf("note %d", i));
+      rb.AddNull();
+    }
+    ASSERT_OK(mrs->Insert(tx.timestamp(), rb.row(), op_id_));
+    tx.Commit();
+  }
+
+  // Projections with and without strings, each with columns missing from
+  // the base schema which are filled in from their defaults.
+  SchemaBuilder with_strings(schema);
+  Slice default_str("dflt");
+  ASSERT_OK(with_strings.AddColumn("added_str", STRING, false, &default_str, &default_str));
+  ASSERT_OK(with_strings.AddNullableColumn("added_null", INT32));
+  SchemaBuilder fixed_width;
+  int32_t default_int = 7;
+  ASSERT_OK(fixed_width.AddColumn(schema.column(1), false));
+  ASSERT_OK(fixed_width.AddColumn(schema.column(3), false));
+  ASSERT_OK(fixed_width.AddColumn("added_int", INT32, false, &default_int, &default_int));
+  vector<Schema> projections = { with_strings.Build(), fixed_width.BuildWithoutIds() };
+
+  for (const Schema& projection : projections) {
+    SCOPED_TRACE(projection.ToString());
+    vector<string> results[2];
+    for (int precompiled = 0; precompiled < 2; precompiled++) {
+      FLAGS_mrs_precompiled_projection = precompiled;
+      gscoped_ptr<MemRowSet::Iterator> iter(mrs->NewIterator(&projection,
+                                                             MvccSnapshot(mvcc_)));
+      ASSERT_OK(iter->Init(nullptr));
+      ASSERT_OK(IterateToStringList(iter.get(), &results[precompiled]));
+    }
+    ASSERT_EQ(kNumRows, results[1].size());
+    ASSERT_EQ(results[0], results[1]);
+  }
+}
+
 TEST_F(TestMemRowSet, TestInsertAndIterateCompoundKey) {
 
   SchemaBuilder builder;
@@ -519,5 +734,57 @@ TEST_F(TestMemRowSet, TestUpdateMVCC) {
   }
 }
 
+// Test that a checkpoint of a MemRowSet holds the rows and mutations up to
+// its timestamp, and that loading it rebuilds them.
+TEST_F(TestMemRowSet, TestCheckpointRoundTrip) {
+  shared_ptr<MemRowSet> mrs(new MemRowSet(0, schema_, log_anchor_registry_.get()));
+  OperationResultPB result;
+  ASSERT_OK(InsertRow(mrs.get(), "a row with a long enough key", 1));
+  ASSERT_OK(UpdateRow(mrs.get(), "a row with a long enough key", 2, &result));
+  ASSERT_OK(DeleteRow(mrs.get(), "a row with a long enough key", &result));
+  ASSERT_OK(InsertRow(mrs.get(), "a row with a long enough key", 3));
+  ASSERT_OK(InsertRow(mrs.get(), "another row", 4));
+
+  vector<string> expected_rows;
+  ASSERT_OK(mrs->DebugDump(&expected_rows));
+  Timestamp checkpoint_timestamp = mvcc_.GetCleanTimestamp();
+
+  // Neither of these is covered by the checkpoint.
+  ASSERT_OK(UpdateRow(mrs.get(), "another row", 5, &result));
+  ASSERT_OK(InsertRow(mrs.get(), "a row inserted too late", 6));
+
+  string path = GetTestPath("checkpoint");
+  {
+    gscoped_ptr<RWFile> file;
+    ASSERT_OK(env_->NewRWFile(path, &file));
+    pb_util::WritablePBContainerFile writer(std::move(file));
+    ASSERT_OK(writer.Init(MemRowSetCheckpointPB()));
+    ASSERT_OK(mrs->WriteCheckpointRows(checkpoint_timestamp, &writer));
+    ASSERT_OK(writer.Close());
+  }
+
+  shared_ptr<MemRowSet> loaded(new MemRowSet(0, schema_, log_anchor_registry_.get()));
+  {
+    gscoped_ptr<RandomAccessFile> file;
+    ASSERT_OK(env_->NewRandomAccessFile(path, &file));
+    pb_util::ReadablePBContainerFile reader(std::move(file));
+    ASSERT_OK(reader.Open());
+    MemRowSetCheckpointPB record;
+    while (true) {
+      Status s = reader.ReadNextPB(&record);
+      if (s.IsEndOfFile()) {
+        break;
+      }
+      ASSERT_OK(s);
+      ASSERT_OK(loaded->LoadCheckpointRows(record, consensus::MinimumOpId()));
+    }
+    ASSERT_OK(reader.Close());
+  }
+
+  vector<string> rows;
+  ASSERT_OK(loaded->DebugDump(&rows));
+  ASSERT_EQ(expected_rows, rows);
+}
+
 } // namespace tablet
 } // namespace kudu
@@ -17,12 +17,14 @@
 
 #include "kudu/tablet/memrowset.h"
 
+#include <algorithm>
 #include <gflags/gflags.h>
 #include <glog/logging.h>
 #include <string>
 #include <vector>
 
 #include "kudu/codegen/compilation_manager.h"
+#include "kudu/codegen/row_predicate.h"
 #include "kudu/codegen/row_projector.h"
 #include "kudu/common/common.pb.h"
 #include "kudu/common/generic_iterators.h"
@@ -30,17 +32,54 @@
 #include "kudu/consensus/consensus.pb.h"
 #include "kudu/consensus/log_anchor_registry.h"
 #include "kudu/gutil/dynamic_annotations.h"
+#include "kudu/gutil/hash/city.h"
+#include "kudu/gutil/sysinfo.h"
 #include "kudu/tablet/compaction.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/mem_tracker.h"
 #include "kudu/util/memory/overwrite.h"
+#include "kudu/util/pb_util.h"
 
 DEFINE_bool(mrs_use_codegen, true, "whether the memrowset should use code "
             "generation for iteration");
 TAG_FLAG(mrs_use_codegen, hidden);
 
+DEFINE_int32(mrs_num_shards, 1,
+             "Number of independent trees that each MemRowSet splits its rows "
+             "into, by a hash of their primary key. More shards reduce "
+             "contention between concurrent inserts into the same tablet, at "
+             "the cost of merging the shards in key order on every scan and "
+             "flush.");
+TAG_FLAG(mrs_num_shards, experimental);
+TAG_FLAG(mrs_num_shards, advanced);
+
+DEFINE_bool(mrs_arena_per_cpu, true,
+            "Whether each MemRowSet copies the rows and mutations written to it "
+            "into a separate arena per CPU, rather than into one arena shared "
+            "by all the writers of the tablet.");
+TAG_FLAG(mrs_arena_per_cpu, advanced);
+
+DEFINE_bool(mrs_columnar_projection, true,
+            "Whether MemRowSet scans should project unmutated rows into the "
+            "destination block one column at a time, rather than row by row.");
+TAG_FLAG(mrs_columnar_projection, hidden);
+
+DEFINE_bool(mrs_codegen_predicates, true,
+            "Whether MemRowSet scans should use a code-generated evaluator of "
+            "the scan predicates to avoid projecting unmutated rows that can't "
+            "pass them. Has no effect unless --mrs_use_codegen is set.");
+TAG_FLAG(mrs_codegen_predicates, hidden);
+
+DEFINE_bool(mrs_precompiled_projection, true,
+            "Whether MemRowSet scans whose code-generated projector isn't "
+            "compiled yet should use a projector specialized for the layout of "
+            "the projection, rather than the generic one.");
+TAG_FLAG(mrs_precompiled_projection, hidden);
+
 using std::pair;
 using std::shared_ptr;
+using std::unique_ptr;
+using std::vector;
 
 namespace kudu { namespace tablet {
 
@@ -91,10 +130,7 @@ MemRowSet::MemRowSet(int64_t id,
     schema_(schema),
     parent_tracker_(parent_tracker),
     mem_tracker_(CreateMemTrackerForMemRowSet(id, parent_tracker)),
-    allocator_(new MemoryTrackingBufferAllocator(HeapBufferAllocator::Get(), mem_tracker_)),
-    arena_(new ThreadSafeMemoryTrackingArena(kInitialArenaSize, kMaxArenaBufferSize,
-                                             allocator_)),
-    tree_(arena_),
+    allocator_(new MemoryTrackingBufferAllocator(ChunkPoolBufferAllocator::Get(), mem_tracker_)),
     debug_insert_count_(0),
     debug_update_count_(0),
     has_logged_throttling_(false),
@@ -102,11 +138,77 @@ MemRowSet::MemRowSet(int64_t id,
   CHECK(schema.has_column_ids());
   ANNOTATE_BENIGN_RACE(&debug_insert_count_, "insert count isnt accurate");
   ANNOTATE_BENIGN_RACE(&debug_update_count_, "update count isnt accurate");
+  // The arenas start out tiny, so an arena per CPU costs little for the
+  // MemRowSets which are barely written to.
+  int num_arenas = FLAGS_mrs_arena_per_cpu ? base::MaxCPUIndex() + 1 : 1;
+  for (int i = 0; i < num_arenas; i++) {
+    arenas_.emplace_back(new ThreadSafeMemoryTrackingArena(kInitialArenaSize,
+                                                           kMaxArenaBufferSize,
+                                                           allocator_));
+  }
+  int num_shards = std::max(1, FLAGS_mrs_num_shards);
+  for (int i = 0; i < num_shards; i++) {
+    trees_.emplace_back(new MSBTree(arenas_[i % num_arenas]));
+  }
 }
 
 MemRowSet::~MemRowSet() {
 }
 
+MemRowSet::MSBTree* MemRowSet::TreeForKey(const Slice& encoded_key) const {
+  if (PREDICT_TRUE(trees_.size() == 1)) {
+    return trees_[0].get();
+  }
+  uint64_t hash = util_hash::CityHash64(reinterpret_cast<const char*>(encoded_key.data()),
+                                        encoded_key.size());
+  return trees_[hash % trees_.size()].get();
+}
+
+ThreadSafeMemoryTrackingArena* MemRowSet::CurrentArena() const {
+  if (PREDICT_TRUE(arenas_.size() == 1)) {
+    return arenas_[0].get();
+  }
+#if defined(__linux__)
+  int cpu = sched_getcpu();
+#else
+  // There's no cheap way to get the CPU, so use just one arena.
+  int cpu = 0;
+#endif
+  if (PREDICT_FALSE(cpu < 0)) {
+    cpu = 0;
+  }
+  return arenas_[cpu % arenas_.size()].get();
+}
+
+size_t MemRowSet::memory_footprint() const {
+  size_t footprint = 0;
+  for (const auto& arena : arenas_) {
+    footprint += arena->memory_footprint();
+  }
+  return footprint;
+}
+
+uint64_t MemRowSet::entry_count() const {
+  uint64_t count = 0;
+  for (const auto& tree : trees_) {
+    count += tree->count();
+  }
+  return count;
+}
+
+bool MemRowSet::empty() const {
+  for (const auto& tree : trees_) {
+    if (!tree->empty()) return false;
+  }
+  return true;
+}
+
+void MemRowSet::Freeze() {
+  for (const auto& tree : trees_) {
+    tree->Freeze();
+  }
+}
+
 Status MemRowSet::DebugDump(vector<string> *lines) {
   gscoped_ptr<Iterator> iter(NewIterator());
   RETURN_NOT_OK(iter->Init(NULL));
@@ -124,6 +226,146 @@ Status MemRowSet::DebugDump(vector<string> *lines) {
 }
 
 
+// Checkpoint records are written once their rows take up about this much.
+static const size_t kCheckpointRecordBytes = 1024 * 1024;
+
+// Encode a row in 'schema''s in-memory format for a MemRowSet checkpoint.
+static void EncodeCheckpointRow(const Schema& schema, const Slice& row_slice,
+                                MemRowSetCheckpointPB::EncodedRowPB* pb) {
+  string* data = pb->mutable_data();
+  string* indirect_data = pb->mutable_indirect_data();
+  data->assign(row_slice.ToString());
+  ContiguousRow row(&schema, reinterpret_cast<uint8_t*>(&(*data)[0]));
+  for (int i = 0; i < schema.num_columns(); i++) {
+    ContiguousRow::Cell cell = row.cell(i);
+    if (cell.typeinfo()->physical_type() != BINARY ||
+        (cell.is_nullable() && cell.is_null())) {
+      continue;
+    }
+    Slice* slice = reinterpret_cast<Slice*>(cell.mutable_ptr());
+    uintptr_t offset = indirect_data->size();
+    indirect_data->append(reinterpret_cast<const char*>(slice->data()), slice->size());
+    *slice = Slice(reinterpret_cast<const uint8_t*>(offset), slice->size());
+  }
+}
+
+// Decode a row encoded by EncodeCheckpointRow() into 'buf'. The row's
+// indirect data is left in 'pb', which must outlive any use of the row.
+static Status DecodeCheckpointRow(const Schema& schema,
+                                  const MemRowSetCheckpointPB::EncodedRowPB& pb,
+                                  faststring* buf) {
+  if (PREDICT_FALSE(pb.data().size() != ContiguousRowHelper::row_size(schema))) {
+    return Status::Corruption(Substitute("checkpointed row has size $0, expected $1",
+                                         pb.data().size(),
+                                         ContiguousRowHelper::row_size(schema)));
+  }
+  buf->assign_copy(pb.data());
+  ContiguousRow row(&schema, buf->data());
+  const uint8_t* indirect_data = reinterpret_cast<const uint8_t*>(pb.indirect_data().data());
+  for (int i = 0; i < schema.num_columns(); i++) {
+    ContiguousRow::Cell cell = row.cell(i);
+    if (cell.typeinfo()->physical_type() != BINARY ||
+        (cell.is_nullable() && cell.is_null())) {
+      continue;
+    }
+    Slice* slice = reinterpret_cast<Slice*>(cell.mutable_ptr());
+    uintptr_t offset = reinterpret_cast<uintptr_t>(slice->data());
+    if (PREDICT_FALSE(offset + slice->size() > pb.indirect_data().size())) {
+      return Status::Corruption("checkpointed row has bad indirect data");
+    }
+    *slice = Slice(indirect_data + offset, slice->size());
+  }
+  return Status::OK();
+}
+
+Status MemRowSet::WriteCheckpointRows(Timestamp timestamp,
+                                      pb_util::WritablePBContainerFile* writer) const {
+  gscoped_ptr<Iterator> iter(NewIterator());
+  RETURN_NOT_OK(iter->Init(nullptr));
+
+  MemRowSetCheckpointPB record;
+  size_t record_bytes = 0;
+  for (; iter->HasNext(); iter->Next()) {
+    MRSRow row = iter->GetCurrentRow();
+    if (row.insertion_timestamp().CompareTo(timestamp) >= 0) {
+      continue;
+    }
+    MemRowSetCheckpointPB::RowPB* row_pb = record.add_rows();
+    row_pb->set_insertion_timestamp(row.insertion_timestamp().ToUint64());
+    EncodeCheckpointRow(schema_, row.row_slice(), row_pb->mutable_row());
+    record_bytes += row_pb->row().data().size() + row_pb->row().indirect_data().size();
+
+    // Row locks order the mutations of a row by timestamp, so the ones to
+    // include are a prefix of the list.
+    for (const Mutation* mut = row.acquire_redo_head();
+         mut != nullptr && mut->timestamp().CompareTo(timestamp) < 0;
+         mut = mut->acquire_next()) {
+      MemRowSetCheckpointPB::MutationPB* mut_pb = row_pb->add_mutations();
+      mut_pb->set_timestamp(mut->timestamp().ToUint64());
+      RowChangeList changelist = mut->changelist();
+      if (changelist.is_reinsert()) {
+        RowChangeListDecoder decoder(changelist);
+        RETURN_NOT_OK(decoder.Init());
+        Slice reinserted;
+        RETURN_NOT_OK(decoder.GetReinsertedRowSlice(schema_, &reinserted));
+        EncodeCheckpointRow(schema_, reinserted, mut_pb->mutable_reinserted_row());
+        record_bytes += reinserted.size() + mut_pb->reinserted_row().indirect_data().size();
+      } else {
+        mut_pb->set_changelist(changelist.slice().ToString());
+        record_bytes += changelist.slice().size();
+      }
+    }
+
+    if (record_bytes >= kCheckpointRecordBytes) {
+      RETURN_NOT_OK(writer->Append(record));
+      record.Clear();
+      record_bytes = 0;
+    }
+  }
+  if (record.rows_size() > 0) {
+    RETURN_NOT_OK(writer->Append(record));
+  }
+  return Status::OK();
+}
+
+Status MemRowSet::LoadCheckpointRows(const MemRowSetCheckpointPB& record,
+                                     const OpId& op_id) {
+  faststring row_buf;
+  for (const MemRowSetCheckpointPB::RowPB& row_pb : record.rows()) {
+    RETURN_NOT_OK(DecodeCheckpointRow(schema_, row_pb.row(), &row_buf));
+    ConstContiguousRow row(&schema_, row_buf.data());
+    RETURN_NOT_OK(Insert(Timestamp(row_pb.insertion_timestamp()), row, op_id));
+    if (row_pb.mutations_size() == 0) {
+      continue;
+    }
+
+    faststring enc_key_buf;
+    schema_.EncodeComparableKey(row, &enc_key_buf);
+    Slice enc_key(enc_key_buf);
+    btree::PreparedMutation<MSBTreeTraits> mutation(enc_key);
+    mutation.Prepare(TreeForKey(enc_key));
+    CHECK(mutation.exists());
+    MRSRow ms_row(this, mutation.current_mutable_value());
+
+    faststring reinserted_buf;
+    for (const MemRowSetCheckpointPB::MutationPB& mut_pb : row_pb.mutations()) {
+      Timestamp mut_timestamp(mut_pb.timestamp());
+      if (mut_pb.has_reinserted_row()) {
+        RETURN_NOT_OK(DecodeCheckpointRow(schema_, mut_pb.reinserted_row(), &reinserted_buf));
+        RETURN_NOT_OK(Reinsert(mut_timestamp,
+                               ConstContiguousRow(&schema_, reinserted_buf.data()),
+                               &ms_row));
+      } else {
+        Mutation* mut = Mutation::CreateInArena(CurrentArena(), mut_timestamp,
+                                                RowChangeList(mut_pb.changelist()));
+        mut->AppendToListAtomic(&ms_row.header_->redo_head);
+        debug_update_count_++;
+      }
+    }
+  }
+  return Status::OK();
+}
+
 Status MemRowSet::Insert(Timestamp timestamp,
                          const ConstContiguousRow& row,
                          const OpId& op_id) {
@@ -136,7 +378,7 @@ Status MemRowSet::Insert(Timestamp timestamp,
     Slice enc_key(enc_key_buf);
 
     btree::PreparedMutation<MSBTreeTraits> mutation(enc_key);
-    mutation.Prepare(&tree_);
+    mutation.Prepare(TreeForKey(enc_key));
 
     // TODO: for now, the key ends up stored doubly --
     // once encoded in the btree key, and again in the value
@@ -160,7 +402,7 @@ Status MemRowSet::Insert(Timestamp timestamp,
     DEFINE_MRSROW_ON_STACK(this, mrsrow, mrsrow_slice);
     mrsrow.header_->insertion_timestamp = timestamp;
     mrsrow.header_->redo_head = nullptr;
-    RETURN_NOT_OK(mrsrow.CopyRow(row, arena_.get()));
+    RETURN_NOT_OK(mrsrow.CopyRow(row, CurrentArena()));
 
     CHECK(mutation.Insert(mrsrow_slice))
     << "Expected to be able to insert, since the prepared mutation "
@@ -183,7 +425,7 @@ Status MemRowSet::Reinsert(Timestamp timestamp, const ConstContiguousRow& row, M
   // Make a copy of the row, and relocate any of its indirected data into
   // our Arena.
   DEFINE_MRSROW_ON_STACK(this, row_copy, row_copy_slice);
-  RETURN_NOT_OK(row_copy.CopyRow(row, arena_.get()));
+  RETURN_NOT_OK(row_copy.CopyRow(row, CurrentArena()));
 
   // Encode the REINSERT mutation from the relocated row copy.
   faststring buf;
@@ -191,7 +433,7 @@ Status MemRowSet::Reinsert(Timestamp timestamp, const ConstContiguousRow& row, M
   encoder.SetToReinsert(row_copy.row_slice());
 
   // Move the REINSERT mutation itself into our Arena.
-  Mutation *mut = Mutation::CreateInArena(arena_.get(), timestamp, encoder.as_changelist());
+  Mutation *mut = Mutation::CreateInArena(CurrentArena(), timestamp, encoder.as_changelist());
 
   // Append the mutation into the row's mutation list.
   // This function has "release" semantics which ensures that the memory writes
@@ -209,7 +451,7 @@ Status MemRowSet::MutateRow(Timestamp timestamp,
                             OperationResultPB *result) {
   {
     btree::PreparedMutation<MSBTreeTraits> mutation(probe.encoded_key_slice());
-    mutation.Prepare(&tree_);
+    mutation.Prepare(TreeForKey(probe.encoded_key_slice()));
 
     if (!mutation.exists()) {
       return Status::NotFound("not in memrowset");
@@ -225,7 +467,7 @@ Status MemRowSet::MutateRow(Timestamp timestamp,
     }
 
     // Append to the linked list of mutations for this row.
-    Mutation *mut = Mutation::CreateInArena(arena_.get(), timestamp, delta);
+    Mutation *mut = Mutation::CreateInArena(CurrentArena(), timestamp, delta);
 
     // This function has "release" semantics which ensures that the memory writes
     // for the mutation are fully published before any concurrent reader sees
@@ -252,7 +494,7 @@ Status MemRowSet::CheckRowPresent(const RowSetKeyProbe &probe, bool *present,
   stats->mrs_consulted++;
 
   btree::PreparedMutation<MSBTreeTraits> mutation(probe.encoded_key_slice());
-  mutation.Prepare(const_cast<MSBTree *>(&tree_));
+  mutation.Prepare(TreeForKey(probe.encoded_key_slice()));
 
   if (!mutation.exists()) {
     *present = false;
@@ -274,7 +516,12 @@ Status MemRowSet::CheckRowPresent(const RowSetKeyProbe &probe, bool *present,
 
 MemRowSet::Iterator *MemRowSet::NewIterator(const Schema *projection,
                                             const MvccSnapshot &snap) const {
-  return new MemRowSet::Iterator(shared_from_this(), tree_.NewIterator(),
+  vector<unique_ptr<MSBTIter::ShardIterator>> shard_iters;
+  for (const auto& tree : trees_) {
+    shard_iters.emplace_back(tree->NewIterator());
+  }
+  return new MemRowSet::Iterator(shared_from_this(),
+                                 new MSBTIter(std::move(shard_iters)),
                                  projection, snap);
 }
 
@@ -302,6 +549,66 @@ Status MemRowSet::GetBounds(string *min_encoded_key,
   return Status::NotSupported("");
 }
 
+////////////////////////////////////////////////////////////
+// MSBTreeMergingIterator
+////////////////////////////////////////////////////////////
+
+MSBTreeMergingIterator::MSBTreeMergingIterator(vector<unique_ptr<ShardIterator>> iters)
+  : iters_(std::move(iters)),
+    cur_(nullptr) {
+  DCHECK(!iters_.empty());
+}
+
+bool MSBTreeMergingIterator::SeekToStart() {
+  for (const auto& iter : iters_) {
+    iter->SeekToStart();
+  }
+  PickCurrent();
+  return IsValid();
+}
+
+bool MSBTreeMergingIterator::SeekAtOrAfter(const Slice &key, bool *exact) {
+  for (const auto& iter : iters_) {
+    bool shard_exact;
+    iter->SeekAtOrAfter(key, &shard_exact);
+  }
+  PickCurrent();
+  *exact = IsValid() && cur_->GetCurrentKey() == key;
+  return IsValid();
+}
+
+bool MSBTreeMergingIterator::Next() {
+  DCHECK(IsValid());
+  cur_->Next();
+  PickCurrent();
+  return IsValid();
+}
+
+size_t MSBTreeMergingIterator::remaining_in_leaf() const {
+  size_t remaining = 0;
+  for (const auto& iter : iters_) {
+    if (iter->IsValid()) {
+      remaining += iter->remaining_in_leaf();
+    }
+  }
+  return remaining;
+}
+
+void MSBTreeMergingIterator::PickCurrent() {
+  // The number of shards is small, so a linear scan for the smallest key
+  // is cheaper than maintaining a heap.
+  cur_ = nullptr;
+  Slice cur_key;
+  for (const auto& iter : iters_) {
+    if (!iter->IsValid()) continue;
+    Slice key = iter->GetCurrentKey();
+    if (cur_ == nullptr || key.compare(cur_key) < 0) {
+      cur_ = iter.get();
+      cur_key = key;
+    }
+  }
+}
+
 // Virtual interface allows two possible row projector implementations
 class MemRowSet::Iterator::MRSRowProjector {
  public:
@@ -347,8 +654,145 @@ class MRSRowProjectorImpl : public MRSRowProjector {
   gscoped_ptr<ActualProjector> actual_;
 };
 
-// If codegen is enabled, then generates a codegen::RowProjector;
-// otherwise makes a regular one.
+// The projector used while no code-generated one is ready, e.g. for the
+// first scans of each projection after a restart, when the compilation is
+// still queued.
+//
+// Does the same as RowProjector, but resolves the offset, size and
+// nullability of every projected cell once in Init() rather than for every
+// row, and writes the destination cells directly, like the code-generated
+// projectors do. Projections without strings are handled by a separate
+// instantiation, whose copies don't need to check for indirect data.
+template<bool HAS_STRINGS>
+class PrecompiledRowProjector {
+ public:
+  typedef RowProjector::ProjectionIdxMapping ProjectionIdxMapping;
+
+  // Both schemas must remain valid for the lifetime of this object.
+  PrecompiledRowProjector(const Schema* base_schema, const Schema* projection)
+    : projector_(base_schema, projection),
+      src_bitmap_offset_(base_schema->byte_size()) {
+  }
+
+  Status Init() {
+    RETURN_NOT_OK(projector_.Init());
+    const Schema& base_schema = *projector_.base_schema();
+    const Schema& projection = *projector_.projection();
+    for (const ProjectionIdxMapping& mapping : projector_.base_cols_mapping()) {
+      const ColumnSchema& col = base_schema.column(mapping.second);
+      CellCopy copy;
+      copy.dst_col = mapping.first;
+      copy.size = col.type_info()->size();
+      copy.is_string = col.type_info()->physical_type() == BINARY;
+      copy.is_nullable = col.is_nullable();
+      copy.src_col = mapping.second;
+      copy.src_offset = base_schema.column_offset(mapping.second);
+      DCHECK(HAS_STRINGS || !copy.is_string);
+      base_copies_.push_back(copy);
+    }
+    for (size_t proj_idx : projector_.projection_defaults()) {
+      const ColumnSchema& col = projection.column(proj_idx);
+      CellCopy copy;
+      copy.dst_col = proj_idx;
+      copy.size = col.type_info()->size();
+      copy.is_string = col.type_info()->physical_type() == BINARY;
+      copy.is_nullable = col.is_nullable();
+      copy.default_value = static_cast<const uint8_t*>(col.read_default_value());
+      DCHECK(HAS_STRINGS || !copy.is_string);
+      default_copies_.push_back(copy);
+    }
+    return Status::OK();
+  }
+
+  template<class ContiguousRowType>
+  Status ProjectRowForRead(const ContiguousRowType& src_row,
+                           RowBlockRow* dst_row,
+                           Arena* dst_arena) const {
+    DCHECK_SCHEMA_EQ(*projector_.base_schema(), *src_row.schema());
+    DCHECK_SCHEMA_EQ(*projector_.projection(), *dst_row->schema());
+    const uint8_t* src_data = src_row.row_data();
+    const uint8_t* src_bitmap = src_data + src_bitmap_offset_;
+    for (const CellCopy& copy : base_copies_) {
+      if (copy.is_nullable) {
+        bool is_null = BitmapTest(src_bitmap, copy.src_col);
+        dst_row->cell(copy.dst_col).set_null(is_null);
+        if (is_null) {
+          continue;
+        }
+      }
+      RETURN_NOT_OK(CopyCellData(copy, src_data + copy.src_offset, dst_row, dst_arena));
+    }
+    for (const CellCopy& copy : default_copies_) {
+      if (copy.is_nullable) {
+        bool is_null = copy.default_value == nullptr;
+        dst_row->cell(copy.dst_col).set_null(is_null);
+        if (is_null) {
+          continue;
+        }
+      }
+      RETURN_NOT_OK(CopyCellData(copy, copy.default_value, dst_row, dst_arena));
+    }
+    return Status::OK();
+  }
+
+  const vector<ProjectionIdxMapping>& base_cols_mapping() const {
+    return projector_.base_cols_mapping();
+  }
+
+ private:
+  // How to copy one cell of the projection, either from the base row or
+  // from the projection's read default.
+  struct CellCopy {
+    size_t dst_col;
+    size_t size;
+    bool is_string;
+    bool is_nullable;
+
+    // Set for base columns.
+    size_t src_col = 0;
+    size_t src_offset = 0;
+
+    // Set for default columns; NULL if the default is NULL.
+    const uint8_t* default_value = nullptr;
+  };
+
+  static Status CopyCellData(const CellCopy& copy, const uint8_t* src,
+                             RowBlockRow* dst_row, Arena* dst_arena) {
+    // Like _PrecompiledCopyCellToRowBlock(), computes the destination from
+    // the known cell size rather than going through the column's type info.
+    uint8_t* dst = dst_row->row_block()->column_data_base_ptr(copy.dst_col) +
+        dst_row->row_index() * copy.size;
+    if (HAS_STRINGS && copy.is_string && dst_arena != nullptr) {
+      const Slice* src_slice = reinterpret_cast<const Slice*>(src);
+      if (PREDICT_FALSE(!dst_arena->RelocateSlice(*src_slice, reinterpret_cast<Slice*>(dst)))) {
+        return Status::IOError("out of memory copying slice", src_slice->ToString());
+      }
+    } else {
+      memcpy(dst, src, copy.size);
+    }
+    return Status::OK();
+  }
+
+  RowProjector projector_;
+  const size_t src_bitmap_offset_;
+  vector<CellCopy> base_copies_;
+  vector<CellCopy> default_copies_;
+
+  DISALLOW_COPY_AND_ASSIGN(PrecompiledRowProjector);
+};
+
+bool HasStringColumns(const Schema& schema) {
+  for (const ColumnSchema& col : schema.columns()) {
+    if (col.type_info()->physical_type() == BINARY) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// If codegen is enabled and the projector for the schemas is compiled,
+// returns the codegen::RowProjector; otherwise makes a precompiled or regular
+// one.
 gscoped_ptr<MRSRowProjector> GenerateAppropriateProjector(
   const Schema* base, const Schema* projection) {
   // Attempt code-generated implementation
@@ -361,6 +805,19 @@ gscoped_ptr<MRSRowProjector> GenerateAppropriateProjector(
     }
   }
 
+  if (FLAGS_mrs_precompiled_projection) {
+    if (HasStringColumns(*projection)) {
+      gscoped_ptr<PrecompiledRowProjector<true>> actual(
+          new PrecompiledRowProjector<true>(base, projection));
+      return gscoped_ptr<MRSRowProjector>(
+        new MRSRowProjectorImpl<PrecompiledRowProjector<true>>(std::move(actual)));
+    }
+    gscoped_ptr<PrecompiledRowProjector<false>> actual(
+        new PrecompiledRowProjector<false>(base, projection));
+    return gscoped_ptr<MRSRowProjector>(
+      new MRSRowProjectorImpl<PrecompiledRowProjector<false>>(std::move(actual)));
+  }
+
   // Proceed with default implementation
   gscoped_ptr<RowProjector> actual(new RowProjector(base, projection));
   return gscoped_ptr<MRSRowProjector>(
@@ -379,6 +836,7 @@ MemRowSet::Iterator::Iterator(const std::shared_ptr<const MemRowSet>& mrs,
       projector_(
           GenerateAppropriateProjector(&mrs->schema_nonvirtual(), projection)),
       delta_projector_(&mrs->schema_nonvirtual(), projection),
+      project_columnwise_(false),
       state_(kUninitialized) {
   // TODO: various code assumes that a newly constructed iterator
   // is pointed at the beginning of the dataset. This causes a redundant
@@ -395,6 +853,24 @@ Status MemRowSet::Iterator::Init(ScanSpec *spec) {
   RETURN_NOT_OK(projector_->Init());
   RETURN_NOT_OK(delta_projector_.Init());
 
+  // Column-at-a-time projection only knows how to copy base columns, so
+  // projections which need default values fall back to the row projector.
+  project_columnwise_ = FLAGS_mrs_columnar_projection &&
+      projector_->base_cols_mapping().size() == projection_->num_columns();
+
+  // If the predicates' evaluator isn't compiled yet, this scan goes without it
+  // and a later one will pick it up from the code cache.
+  if (FLAGS_mrs_use_codegen && FLAGS_mrs_codegen_predicates &&
+      spec && !spec->predicates().empty()) {
+    vector<ColumnPredicate> predicates;
+    predicates.reserve(spec->predicates().size());
+    for (const auto& entry : spec->predicates()) {
+      predicates.push_back(entry.second);
+    }
+    codegen::CompilationManager::GetSingleton()->RequestRowPredicateEvaluator(
+        &memrowset_->schema_nonvirtual(), predicates, &predicate_evaluator_);
+  }
+
   if (spec && spec->lower_bound_key()) {
     bool exact;
     const Slice &lower_bound = spec->lower_bound_key()->encoded_key();
@@ -473,6 +949,7 @@ Status MemRowSet::Iterator::NextBlock(RowBlock *dst) {
 
 Status MemRowSet::Iterator::FetchRows(RowBlock* dst, size_t* fetched) {
   *fetched = 0;
+  columnwise_rows_.clear();
   do {
     Slice k, v;
     RowBlockRow dst_row = dst->row(*fetched);
@@ -489,13 +966,30 @@ Status MemRowSet::Iterator::FetchRows(RowBlock* dst, size_t* fetched) {
         state_ = kFinished;
         break;
       } else {
-        RETURN_NOT_OK(projector_->ProjectRowForRead(row, &dst_row, dst->arena()));
-
         Mutation* redo_head = reinterpret_cast<Mutation*>(
             base::subtle::Acquire_Load(reinterpret_cast<AtomicWord*>(&row.header_->redo_head)));
-        // Roll-forward MVCC for committed updates.
-        RETURN_NOT_OK(ApplyMutationsToProjectedRow(
-            redo_head, &dst_row, dst->arena()));
+        if (redo_head == nullptr && predicate_evaluator_ &&
+            !predicate_evaluator_->Evaluate(row.row_data())) {
+          // The row's base data is all there is to it in our snapshot, and it
+          // fails the predicates: don't bother projecting it.
+          dst->selection_vector()->SetRowUnselected(*fetched);
+          #ifndef NDEBUG
+          dst_row.OverwriteWithPattern("PREDPREDPREDPREDPREDPRED"
+                                       "PREDPREDPREDPREDPREDPRED"
+                                       "PREDPREDPREDPREDPREDPRED");
+          #endif
+        } else if (project_columnwise_ && redo_head == nullptr) {
+          // The row was never mutated: defer it so that the whole batch can be
+          // copied one column at a time below. Any mutation racing with us
+          // is too new to be visible in our snapshot.
+          columnwise_rows_.emplace_back(*fetched, row.row_data());
+        } else {
+          RETURN_NOT_OK(projector_->ProjectRowForRead(row, &dst_row, dst->arena()));
+
+          // Roll-forward MVCC for committed updates.
+          RETURN_NOT_OK(ApplyMutationsToProjectedRow(
+              redo_head, &dst_row, dst->arena()));
+        }
       }
     } else {
       // This row was not yet committed in the current MVCC snapshot
@@ -514,6 +1008,47 @@ Status MemRowSet::Iterator::FetchRows(RowBlock* dst, size_t* fetched) {
     ++*fetched;
   } while (iter_->Next() && *fetched < dst->nrows());
 
+  return ProjectRowsColumnwise(dst);
+}
+
+Status MemRowSet::Iterator::ProjectRowsColumnwise(RowBlock* dst) {
+  if (columnwise_rows_.empty()) {
+    return Status::OK();
+  }
+
+  const Schema& base_schema = memrowset_->schema_nonvirtual();
+  Arena* arena = dst->arena();
+  for (const RowProjector::ProjectionIdxMapping& mapping : projector_->base_cols_mapping()) {
+    const ColumnSchema& col = base_schema.column(mapping.second);
+    const size_t offset = base_schema.column_offset(mapping.second);
+    const size_t size = col.type_info()->size();
+    const bool is_binary = col.type_info()->physical_type() == BINARY;
+    ColumnBlock dst_col = dst->column_block(mapping.first);
+
+    for (const auto& entry : columnwise_rows_) {
+      const size_t dst_idx = entry.first;
+      const uint8_t* row_data = entry.second;
+      if (col.is_nullable()) {
+        bool is_null = ContiguousRowHelper::is_null(base_schema, row_data, mapping.second);
+        dst_col.SetCellIsNull(dst_idx, is_null);
+        if (is_null) {
+          continue;
+        }
+      }
+
+      const uint8_t* src = row_data + offset;
+      uint8_t* dst_cell = dst_col.data() + size * dst_idx;
+      if (is_binary && arena != nullptr) {
+        const Slice* src_slice = reinterpret_cast<const Slice*>(src);
+        if (PREDICT_FALSE(!arena->RelocateSlice(*src_slice,
+                                                reinterpret_cast<Slice*>(dst_cell)))) {
+          return Status::IOError("out of memory copying slice", src_slice->ToString());
+        }
+      } else {
+        memcpy(dst_cell, src, size);
+      }
+    }
+  }
   return Status::OK();
 }
 
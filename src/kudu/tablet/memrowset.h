@@ -39,6 +39,14 @@ namespace kudu {
 
 class MemTracker;
 
+namespace codegen {
+class RowPredicateEvaluator;
+} // namespace codegen
+
+namespace pb_util {
+class WritablePBContainerFile;
+} // namespace pb_util
+
 namespace tablet {
 
 //
@@ -158,6 +166,47 @@ struct MSBTreeTraits : public btree::BTreeTraits {
   typedef ThreadSafeMemoryTrackingArena ArenaType;
 };
 
+// Iterator over the entries of all of a MemRowSet's shard trees, in key order.
+// Each key lives in exactly one shard, so this merges one CBTreeIterator per
+// shard. With a single shard, it just forwards to that shard's iterator.
+//
+// The API mirrors the subset of CBTreeIterator used by MemRowSet::Iterator.
+class MSBTreeMergingIterator {
+ public:
+  typedef btree::CBTreeIterator<MSBTreeTraits> ShardIterator;
+
+  explicit MSBTreeMergingIterator(std::vector<std::unique_ptr<ShardIterator>> iters);
+
+  bool SeekToStart();
+
+  bool SeekAtOrAfter(const Slice &key, bool *exact);
+
+  bool IsValid() const {
+    return cur_ != nullptr;
+  }
+
+  bool Next();
+
+  void GetCurrentEntry(Slice *key, Slice *val) const {
+    DCHECK(IsValid());
+    cur_->GetCurrentEntry(key, val);
+  }
+
+  // Return a number of entries, including the current one, which are
+  // guaranteed to remain: the rest of the current leaf of every shard.
+  size_t remaining_in_leaf() const;
+
+ private:
+  // Point 'cur_' at the shard iterator with the smallest current key,
+  // or at NULL if all of them are exhausted.
+  void PickCurrent();
+
+  std::vector<std::unique_ptr<ShardIterator>> iters_;
+  ShardIterator* cur_;
+
+  DISALLOW_COPY_AND_ASSIGN(MSBTreeMergingIterator);
+};
+
 // Define an MRSRow instance using on-stack storage.
 // This defines an array on the stack which is sized correctly for an MRSRow::Header
 // plus a single row of the given schema, then constructs an MRSRow object which
@@ -214,12 +263,25 @@ class MemRowSet : public RowSet,
                            ProbeStats* stats,
                            OperationResultPB *result) OVERRIDE;
 
+  // Write the contents of this memrowset to 'writer' as MemRowSetCheckpointPB
+  // records with rows, including only the inserts and mutations made by
+  // transactions with timestamps before 'timestamp'. All of those
+  // transactions must have committed.
+  //
+  // This may be called concurrently with inserts and mutations.
+  Status WriteCheckpointRows(Timestamp timestamp,
+                             pb_util::WritablePBContainerFile* writer) const;
+
+  // Insert the rows of a MemRowSetCheckpointPB record written by
+  // WriteCheckpointRows(), along with their mutations. The log is anchored
+  // as if the rows had been written by 'op_id'.
+  Status LoadCheckpointRows(const MemRowSetCheckpointPB& record,
+                            const consensus::OpId& op_id);
+
   // Return the number of entries in the memrowset.
   // NOTE: this requires iterating all data, and is thus
   // not very fast.
-  uint64_t entry_count() const {
-    return tree_.count();
-  }
+  uint64_t entry_count() const;
 
   // Conform entry_count to RowSet
   Status CountRows(rowid_t *count) const OVERRIDE {
@@ -244,9 +306,7 @@ class MemRowSet : public RowSet,
   }
 
   // Return true if there are no entries in the memrowset.
-  bool empty() const {
-    return tree_.empty();
-  }
+  bool empty() const;
 
   // TODO: unit test me
   Status CheckRowPresent(const RowSetKeyProbe &probe, bool *present,
@@ -256,9 +316,7 @@ class MemRowSet : public RowSet,
   // Note that this may be larger than the sum of the data
   // inserted into the memrowset, due to arena and data structure
   // overhead.
-  size_t memory_footprint() const {
-    return arena_->memory_footprint();
-  }
+  size_t memory_footprint() const;
 
   // Return an iterator over the items in this memrowset.
   //
@@ -276,6 +334,16 @@ class MemRowSet : public RowSet,
                                 const MvccSnapshot& snap,
                                 gscoped_ptr<RowwiseIterator>* out) const OVERRIDE;
 
+  // The MemRowSet keeps no statistics about its rows.
+  bool MayMatchPredicates(const ScanSpec& spec) const OVERRIDE { return true; }
+
+  // Nor does it keep checksums of them.
+  bool AddStoredChecksum(const Schema& projection,
+                         const MvccSnapshot& snap,
+                         StoredChecksums* checksums) const OVERRIDE {
+    return false;
+  }
+
   // Create compaction input.
   virtual Status NewCompactionInput(const Schema* projection,
                                     const MvccSnapshot& snap,
@@ -311,9 +379,7 @@ class MemRowSet : public RowSet,
   }
 
   // Mark the memrowset as frozen. See CBTree::Freeze()
-  void Freeze() {
-    tree_.Freeze();
-  }
+  void Freeze();
 
   uint64_t debug_insert_count() const {
     return debug_insert_count_;
@@ -349,17 +415,33 @@ class MemRowSet : public RowSet,
 
   typedef btree::CBTree<MSBTreeTraits> MSBTree;
 
+  // Return the shard tree which holds the given encoded key.
+  MSBTree* TreeForKey(const Slice& encoded_key) const;
+
+  // Return the arena which the current thread should copy rows and
+  // mutations into.
+  ThreadSafeMemoryTrackingArena* CurrentArena() const;
+
   int64_t id_;
 
   const Schema schema_;
   std::shared_ptr<MemTracker> parent_tracker_;
   std::shared_ptr<MemTracker> mem_tracker_;
   std::shared_ptr<MemoryTrackingBufferAllocator> allocator_;
-  std::shared_ptr<ThreadSafeMemoryTrackingArena> arena_;
 
-  typedef btree::CBTreeIterator<MSBTreeTraits> MSBTIter;
+  // The arenas which the rows, their indirect data and their mutations are
+  // copied into. Unless --mrs_arena_per_cpu is disabled, each CPU allocates
+  // from its own arena, so that concurrent writers don't contend on the same
+  // bump pointer and chunk lock. All of them allocate through 'allocator_',
+  // so 'mem_tracker_' tracks them as a whole.
+  std::vector<std::shared_ptr<ThreadSafeMemoryTrackingArena>> arenas_;
+
+  typedef MSBTreeMergingIterator MSBTIter;
 
-  MSBTree tree_;
+  // The rows, split by a hash of their encoded key into independent trees
+  // (see --mrs_num_shards) so that concurrent inserts contend less on the
+  // same nodes. Each tree allocates its nodes from one of 'arenas_'.
+  std::vector<std::unique_ptr<MSBTree>> trees_;
 
   // Approximate counts of mutations. This variable is updated non-atomically,
   // so it cannot be relied upon to be in any way accurate. It's only used
@@ -475,6 +557,10 @@ class MemRowSet::Iterator : public RowwiseIterator {
 
   // Various helper functions called while getting the next RowBlock
   Status FetchRows(RowBlock* dst, size_t* fetched);
+
+  // Copy the rows collected in 'columnwise_rows_' into 'dst', one projected
+  // column at a time.
+  Status ProjectRowsColumnwise(RowBlock* dst);
   Status ApplyMutationsToProjectedRow(const Mutation *mutation_head,
                                       RowBlockRow *dst_row,
                                       Arena *dst_arena);
@@ -487,9 +573,10 @@ class MemRowSet::Iterator : public RowwiseIterator {
   const MvccSnapshot mvcc_snap_;
 
   // Mapping from projected column index back to memrowset column index.
-  // Relies on the MRSRowProjector interface to abstract from the two
-  // different implementations of the RowProjector, which may change
-  // at runtime (using vs. not using code generation).
+  // Relies on the MRSRowProjector interface to abstract from the different
+  // implementations of the RowProjector, which may change at runtime (using
+  // code generation once it has compiled the projection, and a precompiled
+  // or generic projector until then).
   const Schema* const projection_;
   gscoped_ptr<MRSRowProjector> projector_;
   DeltaProjector delta_projector_;
@@ -503,6 +590,18 @@ class MemRowSet::Iterator : public RowwiseIterator {
   // seek target.
   faststring tmp_buf;
 
+  // If non-null, a code-generated evaluator of the scan's predicates, used
+  // to skip projecting unmutated rows which can't pass them. Rows which do
+  // pass are still checked by the iterator layered above us.
+  gscoped_ptr<codegen::RowPredicateEvaluator> predicate_evaluator_;
+
+  // Whether unmutated rows are projected column by column. Set in Init().
+  bool project_columnwise_;
+
+  // The unmutated rows of the batch being fetched, as pairs of
+  // (destination row index, MemRowSet row data), waiting to be projected.
+  std::vector<std::pair<size_t, const uint8_t*>> columnwise_rows_;
+
   // State of the scanner: indicates whether we should keep scanning/fetching,
   // whether we've scanned the last batch, or whether we've reached the upper bounds
   // or will never reach the lower bounds (no more rows can be returned)
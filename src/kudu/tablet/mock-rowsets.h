@@ -52,6 +52,16 @@ class MockRowSet : public RowSet {
     LOG(FATAL) << "Unimplemented";
     return Status::OK();
   }
+  virtual bool MayMatchPredicates(const ScanSpec& spec) const OVERRIDE {
+    LOG(FATAL) << "Unimplemented";
+    return true;
+  }
+  virtual bool AddStoredChecksum(const Schema& projection,
+                                 const MvccSnapshot& snap,
+                                 StoredChecksums* checksums) const OVERRIDE {
+    LOG(FATAL) << "Unimplemented";
+    return false;
+  }
   virtual Status NewCompactionInput(const Schema* projection,
                                     const MvccSnapshot &snap,
                                     gscoped_ptr<CompactionInput>* out) const OVERRIDE {
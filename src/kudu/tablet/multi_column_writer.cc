@@ -17,24 +17,82 @@
 
 #include "kudu/tablet/multi_column_writer.h"
 
+#include <algorithm>
+#include <gflags/gflags.h>
+
 #include "kudu/cfile/cfile_writer.h"
 #include "kudu/common/rowblock.h"
 #include "kudu/common/schema.h"
 #include "kudu/fs/block_id.h"
 #include "kudu/gutil/stl_util.h"
+#include "kudu/gutil/sysinfo.h"
+#include "kudu/tablet/bitmap_index.h"
+#include "kudu/tablet/metadata.pb.h"
+#include "kudu/util/countdown_latch.h"
+#include "kudu/util/flag_tags.h"
+#include "kudu/util/threadpool.h"
+
+DEFINE_int32(multi_column_writer_parallelism, 4,
+             "Maximum number of threads which encode, compress and write the "
+             "columns of a DiskRowSet being flushed or compacted. The columns "
+             "are split into groups of at least 16, which are appended to "
+             "concurrently on a thread pool shared by all tablets. Set to 1 to "
+             "write all of the columns on the flushing thread.");
+TAG_FLAG(multi_column_writer_parallelism, advanced);
+
+DEFINE_int32(bitmap_index_max_cardinality, 1024,
+             "Maximum number of distinct values of a column with a bitmap index "
+             "in a DiskRowSet. The index of a column with more values in a "
+             "rowset is not written, and scans of the rowset evaluate the "
+             "column's predicates on its data instead.");
+TAG_FLAG(bitmap_index_max_cardinality, advanced);
 
 namespace kudu {
 namespace tablet {
 
 using cfile::CFileWriter;
+using fs::CreateBlockOptions;
 using fs::ScopedWritableBlockCloser;
 using fs::WritableBlock;
+using std::string;
+using std::unique_ptr;
+
+namespace {
+
+// The fewest columns worth handing to another thread. Appending a block to a
+// column is usually a few microseconds of work, so smaller groups would spend
+// more time on handoff than they save.
+const int kMinColumnsPerGroup = 16;
+
+// Returns the pool, shared by all writers, which appends to column groups.
+// This is separate from the compaction pool because compaction tasks wait
+// on the column groups they submit.
+ThreadPool* ColumnWriterPool() {
+  static ThreadPool* pool = [] {
+    gscoped_ptr<ThreadPool> p;
+    CHECK_OK(ThreadPoolBuilder("column-writer")
+             .set_max_threads(base::NumCPUs())
+             .Build(&p));
+    return p.release();
+  }();
+  return pool;
+}
+
+} // anonymous namespace
 
 MultiColumnWriter::MultiColumnWriter(FsManager* fs,
-                                     const Schema* schema)
+                                     const Schema* schema,
+                                     CreateBlockOptions block_opts)
   : fs_(fs),
     schema_(schema),
+    block_opts_(std::move(block_opts)),
     finished_(false) {
+  int num_cols = schema_->num_columns();
+  num_groups_ = std::max(1, std::min(FLAGS_multi_column_writer_parallelism,
+                                     num_cols / kMinColumnsPerGroup));
+  for (int i = 0; i <= num_groups_; i++) {
+    group_bounds_.push_back(i * num_cols / num_groups_);
+  }
 }
 
 MultiColumnWriter::~MultiColumnWriter() {
@@ -59,6 +117,10 @@ Status MultiColumnWriter::Open() {
     // the corresponding rows.
     opts.write_posidx = true;
 
+    // Record per-block value statistics so that scans can skip blocks which
+    // cannot match their predicates.
+    opts.write_zone_maps = true;
+
     /// Set the column storage attributes.
     opts.storage_attributes = col.attributes();
 
@@ -69,7 +131,7 @@ Status MultiColumnWriter::Open() {
 
     // Open file for write.
     gscoped_ptr<WritableBlock> block;
-    RETURN_NOT_OK_PREPEND(fs_->CreateNewBlock(&block),
+    RETURN_NOT_OK_PREPEND(fs_->CreateNewBlock(block_opts_, &block),
                           "Unable to open output file for column " + col.ToString());
     BlockId block_id(block->id());
 
@@ -85,13 +147,50 @@ Status MultiColumnWriter::Open() {
     LOG(INFO) << "Opened CFile writer for column " << col.ToString();
     cfile_writers_.push_back(writer.release());
     block_ids_.push_back(block_id);
+
+    unique_ptr<BitmapIndexBuilder> index_builder;
+    if (col.attributes().bitmap_index && i >= schema_->num_key_columns()) {
+      index_builder.reset(new BitmapIndexBuilder(col.type_info(),
+                                                 FLAGS_bitmap_index_max_cardinality));
+    }
+    bitmap_index_builders_.emplace_back(std::move(index_builder));
   }
 
   return Status::OK();
 }
 
 Status MultiColumnWriter::AppendBlock(const RowBlock& block) {
-  for (int i = 0; i < schema_->num_columns(); i++) {
+  if (num_groups_ == 1) {
+    return AppendColumns(block, 0, schema_->num_columns());
+  }
+
+  // Each column has its own CFileWriter and block, so the groups share no
+  // state. Hand all but the first group to the pool and append the first one
+  // on this thread. The caller may reuse 'block' once this returns, so wait
+  // for all of the groups.
+  vector<Status> statuses(num_groups_);
+  CountDownLatch latch(num_groups_ - 1);
+  for (int g = 1; g < num_groups_; g++) {
+    Status s = ColumnWriterPool()->SubmitFunc([this, &block, &statuses, &latch, g]() {
+        statuses[g] = AppendColumns(block, group_bounds_[g], group_bounds_[g + 1]);
+        latch.CountDown();
+      });
+    if (!s.ok()) {
+      statuses[g] = s;
+      latch.CountDown();
+    }
+  }
+  statuses[0] = AppendColumns(block, group_bounds_[0], group_bounds_[1]);
+  latch.Wait();
+
+  for (const Status& s : statuses) {
+    RETURN_NOT_OK(s);
+  }
+  return Status::OK();
+}
+
+Status MultiColumnWriter::AppendColumns(const RowBlock& block, int start_col, int end_col) {
+  for (int i = start_col; i < end_col; i++) {
     ColumnBlock column = block.column_block(i);
     if (column.is_nullable()) {
       RETURN_NOT_OK(cfile_writers_[i]->AppendNullableEntries(column.null_bitmap(),
@@ -99,6 +198,9 @@ Status MultiColumnWriter::AppendBlock(const RowBlock& block) {
     } else {
       RETURN_NOT_OK(cfile_writers_[i]->AppendEntries(column.data(), column.nrows()));
     }
+    if (bitmap_index_builders_[i]) {
+      bitmap_index_builders_[i]->AddCells(column);
+    }
   }
   return Status::OK();
 }
@@ -120,6 +222,29 @@ Status MultiColumnWriter::FinishAndReleaseBlocks(ScopedWritableBlockCloser* clos
       return s;
     }
   }
+
+  // Write the indexes which didn't overflow, each into a block of its own.
+  bitmap_index_block_ids_.resize(schema_->num_columns());
+  for (int i = 0; i < schema_->num_columns(); i++) {
+    const BitmapIndexBuilder* builder = bitmap_index_builders_[i].get();
+    if (builder == nullptr || builder->overflowed()) {
+      continue;
+    }
+    BitmapIndexPB pb;
+    builder->ToPB(&pb);
+    string data;
+    if (!pb.SerializeToString(&data)) {
+      return Status::Corruption("unable to serialize bitmap index for column " +
+                                schema_->column(i).ToString());
+    }
+    gscoped_ptr<WritableBlock> block;
+    RETURN_NOT_OK_PREPEND(fs_->CreateNewBlock(block_opts_, &block),
+                          "Unable to open bitmap index block for column " +
+                          schema_->column(i).ToString());
+    RETURN_NOT_OK(block->Append(data));
+    bitmap_index_block_ids_[i] = block->id();
+    closer->AddBlock(std::move(block));
+  }
   finished_ = true;
   return Status::OK();
 }
@@ -132,6 +257,32 @@ void MultiColumnWriter::GetFlushedBlocksByColumnId(std::map<ColumnId, BlockId>*
   }
 }
 
+void MultiColumnWriter::GetColumnStatsByColumnId(
+    std::map<ColumnId, ColumnStatsPB>* ret) const {
+  CHECK(finished_);
+  ret->clear();
+  for (int i = 0; i < schema_->num_columns(); i++) {
+    const cfile::ZoneMapPB& zone_map = cfile_writers_[i]->file_zone_map();
+    ColumnStatsPB* stats = &(*ret)[schema_->column_id(i)];
+    stats->set_all_null(zone_map.null_count() >= zone_map.num_rows());
+    if (zone_map.has_min_value() && zone_map.has_max_value()) {
+      stats->set_min_value(zone_map.min_value());
+      stats->set_max_value(zone_map.max_value());
+    }
+  }
+}
+
+void MultiColumnWriter::GetBitmapIndexBlocksByColumnId(
+    std::map<ColumnId, BlockId>* ret) const {
+  CHECK(finished_);
+  ret->clear();
+  for (int i = 0; i < schema_->num_columns(); i++) {
+    if (!bitmap_index_block_ids_[i].IsNull()) {
+      (*ret)[schema_->column_id(i)] = bitmap_index_block_ids_[i];
+    }
+  }
+}
+
 size_t MultiColumnWriter::written_size() const {
   size_t size = 0;
   for (const CFileWriter *writer : cfile_writers_) {
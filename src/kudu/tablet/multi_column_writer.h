@@ -19,9 +19,11 @@
 
 #include <glog/logging.h>
 #include <map>
+#include <memory>
 #include <vector>
 
 #include "kudu/common/schema.h"
+#include "kudu/fs/block_manager.h"
 #include "kudu/fs/fs_manager.h"
 #include "kudu/gutil/macros.h"
 
@@ -40,12 +42,17 @@ class ScopedWritableBlockCloser;
 
 namespace tablet {
 
+class BitmapIndexBuilder;
+class ColumnStatsPB;
+
 // Wrapper which writes several columns in parallel corresponding to some
 // Schema.
 class MultiColumnWriter {
  public:
+  // New blocks are created with 'block_opts'.
   MultiColumnWriter(FsManager* fs,
-                    const Schema* schema);
+                    const Schema* schema,
+                    fs::CreateBlockOptions block_opts);
 
   virtual ~MultiColumnWriter();
 
@@ -79,15 +86,43 @@ class MultiColumnWriter {
   // REQUIRES: Finish() already called.
   void GetFlushedBlocksByColumnId(std::map<ColumnId, BlockId>* ret) const;
 
+  // Return the statistics of the values of the written columns, keyed by
+  // column ID.
+  //
+  // REQUIRES: Finish() already called.
+  void GetColumnStatsByColumnId(std::map<ColumnId, ColumnStatsPB>* ret) const;
+
+  // Return the block IDs of the bitmap indexes of the written columns, keyed
+  // by column ID, for those non-key columns which are designated as indexed
+  // and have few enough distinct values.
+  //
+  // REQUIRES: Finish() already called.
+  void GetBitmapIndexBlocksByColumnId(std::map<ColumnId, BlockId>* ret) const;
+
  private:
   FsManager* const fs_;
   const Schema* const schema_;
+  const fs::CreateBlockOptions block_opts_;
+
+  // Append the columns in [start_col, end_col) of 'block'.
+  Status AppendColumns(const RowBlock& block, int start_col, int end_col);
 
   bool finished_;
 
+  // The number of groups of columns which AppendBlock() appends to
+  // concurrently. Group i holds the columns in
+  // [group_bounds_[i], group_bounds_[i + 1]).
+  int num_groups_;
+  std::vector<int> group_bounds_;
+
   std::vector<cfile::CFileWriter *> cfile_writers_;
   std::vector<BlockId> block_ids_;
 
+  // The builders of the bitmap indexes, null for the columns without one,
+  // and the blocks they were written to, null for those without an index.
+  std::vector<std::unique_ptr<BitmapIndexBuilder>> bitmap_index_builders_;
+  std::vector<BlockId> bitmap_index_block_ids_;
+
   DISALLOW_COPY_AND_ASSIGN(MultiColumnWriter);
 };
 
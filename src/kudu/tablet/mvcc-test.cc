@@ -15,6 +15,7 @@
 // specific language governing permissions and limitations
 // under the License.
 
+#include <gflags/gflags.h>
 #include <glog/logging.h>
 #include <gtest/gtest.h>
 #include <mutex>
@@ -26,6 +27,9 @@
 #include "kudu/util/monotime.h"
 #include "kudu/util/test_util.h"
 
+DECLARE_int32(max_clock_sync_error_usec);
+DECLARE_bool(use_mock_wall_clock);
+
 using std::thread;
 
 namespace kudu {
@@ -164,6 +168,43 @@ TEST_F(MvccTest, TestMvccMultipleInFlight) {
   ASSERT_TRUE(snap.IsCommitted(t3));
 }
 
+// Test that snapshots which share their committed set with the manager's
+// current state aren't affected by later commits.
+TEST_F(MvccTest, TestSnapshotsUnaffectedByLaterCommits) {
+  MvccManager mgr(clock_.get());
+  Timestamp t1 = mgr.StartTransaction();
+  Timestamp t2 = mgr.StartTransaction();
+  Timestamp t3 = mgr.StartTransaction();
+  mgr.StartApplyingTransaction(t2);
+  mgr.CommitTransaction(t2);
+
+  MvccSnapshot snap_before;
+  mgr.TakeSnapshot(&snap_before);
+  MvccSnapshot snap_copy = snap_before;
+
+  mgr.StartApplyingTransaction(t3);
+  mgr.CommitTransaction(t3);
+  mgr.StartApplyingTransaction(t1);
+  mgr.CommitTransaction(t1);
+
+  for (const MvccSnapshot* snap : { &snap_before, &snap_copy }) {
+    ASSERT_EQ("MvccSnapshot[committed={T|T < 1 or (T in {2})}]", snap->ToString());
+    ASSERT_FALSE(snap->IsCommitted(t1));
+    ASSERT_TRUE(snap->IsCommitted(t2));
+    ASSERT_FALSE(snap->IsCommitted(t3));
+  }
+
+  MvccSnapshot snap_after(mgr);
+  ASSERT_TRUE(snap_after.IsCommitted(t1));
+  ASSERT_TRUE(snap_after.IsCommitted(t2));
+  ASSERT_TRUE(snap_after.IsCommitted(t3));
+
+  // Adding to a copy doesn't change the snapshot it was copied from.
+  snap_copy.AddCommittedTimestamps({ t3 });
+  ASSERT_TRUE(snap_copy.IsCommitted(t3));
+  ASSERT_FALSE(snap_before.IsCommitted(t3));
+}
+
 TEST_F(MvccTest, TestOutOfOrderTxns) {
   scoped_refptr<Clock> hybrid_clock(new HybridClock());
   ASSERT_OK(hybrid_clock->Init());
@@ -243,6 +284,43 @@ TEST_F(MvccTest, TestOfflineTransactions) {
   ASSERT_TRUE(snap2.IsCommitted(Timestamp(40)));
 }
 
+// Tests that the safe time handed out to replicas stays below the in-flight
+// transactions and below whatever any clock in the cluster may still assign.
+TEST_F(MvccTest, TestSafeTimeForReplicas) {
+  // The logical clock has no bound on other servers' clocks.
+  {
+    MvccManager mgr(clock_.get());
+    Timestamp safe_time;
+    ASSERT_TRUE(mgr.GetSafeTimeForReplicas(&safe_time).IsNotSupported());
+  }
+
+  FLAGS_use_mock_wall_clock = true;
+  FLAGS_max_clock_sync_error_usec = 1000000;
+  scoped_refptr<HybridClock> hybrid_clock(new HybridClock());
+  ASSERT_OK(hybrid_clock->Init());
+  hybrid_clock->SetMockClockWallTimeForTests(100000000);
+  MvccManager mgr(hybrid_clock.get());
+
+  Timestamp tx_ts = mgr.StartTransaction();
+  hybrid_clock->SetMockClockWallTimeForTests(200000000);
+
+  // The in-flight transaction bounds the safe time.
+  Timestamp safe_time;
+  ASSERT_OK(mgr.GetSafeTimeForReplicas(&safe_time));
+  ASSERT_EQ(tx_ts.value() - 1, safe_time.value());
+
+  mgr.StartApplyingTransaction(tx_ts);
+  mgr.CommitTransaction(tx_ts);
+
+  // Now only the clock bounds it: 200 seconds minus the max. error.
+  ASSERT_OK(mgr.GetSafeTimeForReplicas(&safe_time));
+  ASSERT_EQ(199000000, HybridClock::GetPhysicalValueMicros(safe_time));
+  ASSERT_GE(mgr.GetCleanTimestamp().CompareTo(safe_time), 0);
+
+  // No transaction may start at or before the safe time anymore.
+  ASSERT_FALSE(mgr.StartTransactionAtTimestamp(safe_time).ok());
+}
+
 TEST_F(MvccTest, TestScopedTransaction) {
   MvccManager mgr(clock_.get());
   MvccSnapshot snap;
@@ -280,8 +358,8 @@ TEST_F(MvccTest, TestPointInTimeSnapshot) {
 TEST_F(MvccTest, TestMayHaveCommittedTransactionsAtOrAfter) {
   MvccSnapshot snap;
   snap.all_committed_before_ = Timestamp(10);
-  snap.committed_timestamps_.push_back(11);
-  snap.committed_timestamps_.push_back(13);
+  snap.AddCommittedTimestamp(Timestamp(11));
+  snap.AddCommittedTimestamp(Timestamp(13));
   snap.none_committed_at_or_after_ = Timestamp(14);
 
   ASSERT_TRUE(snap.MayHaveCommittedTransactionsAtOrAfter(Timestamp(9)));
@@ -316,8 +394,8 @@ TEST_F(MvccTest, TestMayHaveCommittedTransactionsAtOrAfter) {
 TEST_F(MvccTest, TestMayHaveUncommittedTransactionsBefore) {
   MvccSnapshot snap;
   snap.all_committed_before_ = Timestamp(10);
-  snap.committed_timestamps_.push_back(11);
-  snap.committed_timestamps_.push_back(13);
+  snap.AddCommittedTimestamp(Timestamp(11));
+  snap.AddCommittedTimestamp(Timestamp(13));
   snap.none_committed_at_or_after_ = Timestamp(14);
 
   ASSERT_FALSE(snap.MayHaveUncommittedTransactionsAtOrBefore(Timestamp(9)));
@@ -356,7 +434,7 @@ TEST_F(MvccTest, TestMayHaveUncommittedTransactionsBefore) {
   // still report that there can't be any uncommitted transactions before.
   MvccSnapshot snap2;
   snap2.all_committed_before_ = Timestamp(10);
-  snap2.committed_timestamps_.push_back(10);
+  snap2.AddCommittedTimestamp(Timestamp(10));
 
   ASSERT_FALSE(snap2.MayHaveUncommittedTransactionsAtOrBefore(Timestamp(10)));
 }
@@ -237,16 +237,25 @@ void MvccManager::OfflineAdjustSafeTime(Timestamp safe_time) {
   AdjustCleanTime();
 }
 
-// Remove any elements from 'v' which are < the given watermark.
-static void FilterTimestamps(std::vector<Timestamp::val_type>* v,
-                             Timestamp::val_type watermark) {
-  int j = 0;
-  for (const auto& ts : *v) {
-    if (ts >= watermark) {
-      (*v)[j++] = ts;
-    }
+Status MvccManager::GetSafeTimeForReplicas(Timestamp* safe_time) {
+  std::lock_guard<LockType> l(lock_);
+  Timestamp bound;
+  RETURN_NOT_OK(clock_->GetGlobalEarliest(&bound));
+
+  // Transactions which have a timestamp but aren't committed yet may still be
+  // appended to the log, so the safe time must stay below them.
+  if (earliest_in_flight_.CompareTo(bound) <= 0) {
+    bound = Timestamp(earliest_in_flight_.value() - 1);
+  }
+
+  // Transactions may acquire a timestamp before taking the lock, so make sure
+  // those which would start at or before 'bound' retry with a later one.
+  if (no_new_transactions_at_or_before_.CompareTo(bound) < 0) {
+    no_new_transactions_at_or_before_ = bound;
+    AdjustCleanTime();
   }
-  v->resize(j);
+  *safe_time = bound;
+  return Status::OK();
 }
 
 void MvccManager::AdjustCleanTime() {
@@ -271,7 +280,7 @@ void MvccManager::AdjustCleanTime() {
   }
 
   // Filter out any committed timestamps that now fall below the watermark
-  FilterTimestamps(&cur_snap_.committed_timestamps_, cur_snap_.all_committed_before_.value());
+  cur_snap_.RemoveCommittedTimestampsBefore(cur_snap_.all_committed_before_);
 
   // it may also have unblocked some waiters.
   // Check if someone is waiting for transactions to be committed.
@@ -454,7 +463,10 @@ MvccSnapshot MvccSnapshot::CreateSnapshotIncludingNoTransactions() {
 }
 
 bool MvccSnapshot::IsCommittedFallback(const Timestamp& timestamp) const {
-  for (const Timestamp::val_type& v : committed_timestamps_) {
+  if (!committed_timestamps_) {
+    return false;
+  }
+  for (const Timestamp::val_type& v : *committed_timestamps_) {
     if (v == timestamp.value()) return true;
   }
 
@@ -477,7 +489,7 @@ bool MvccSnapshot::MayHaveUncommittedTransactionsAtOrBefore(const Timestamp& tim
 std::string MvccSnapshot::ToString() const {
   string ret("MvccSnapshot[committed={T|");
 
-  if (committed_timestamps_.size() == 0) {
+  if (is_clean()) {
     StrAppend(&ret, "T < ", all_committed_before_.ToString(),"}]");
     return ret;
   }
@@ -485,7 +497,7 @@ std::string MvccSnapshot::ToString() const {
             " or (T in {");
 
   bool first = true;
-  for (Timestamp::val_type t : committed_timestamps_) {
+  for (Timestamp::val_type t : *committed_timestamps_) {
     if (!first) {
       ret.push_back(',');
     }
@@ -505,7 +517,7 @@ void MvccSnapshot::AddCommittedTimestamps(const std::vector<Timestamp>& timestam
 void MvccSnapshot::AddCommittedTimestamp(Timestamp timestamp) {
   if (IsCommitted(timestamp)) return;
 
-  committed_timestamps_.push_back(timestamp.value());
+  mutable_committed_timestamps()->push_back(timestamp.value());
 
   // If this is a new upper bound commit mark, update it.
   if (none_committed_at_or_after_.CompareTo(timestamp) <= 0) {
@@ -513,6 +525,33 @@ void MvccSnapshot::AddCommittedTimestamp(Timestamp timestamp) {
   }
 }
 
+void MvccSnapshot::RemoveCommittedTimestampsBefore(Timestamp watermark) {
+  DCHECK_LE(watermark.CompareTo(all_committed_before_), 0);
+  if (is_clean()) {
+    return;
+  }
+  // Avoid copying a shared vector when there is nothing to remove.
+  const Timestamp::val_type w = watermark.value();
+  if (std::none_of(committed_timestamps_->begin(), committed_timestamps_->end(),
+                   [w](Timestamp::val_type ts) { return ts < w; })) {
+    return;
+  }
+
+  TimestampVector* v = mutable_committed_timestamps();
+  v->erase(std::remove_if(v->begin(), v->end(),
+                          [w](Timestamp::val_type ts) { return ts < w; }),
+           v->end());
+}
+
+MvccSnapshot::TimestampVector* MvccSnapshot::mutable_committed_timestamps() {
+  if (!committed_timestamps_) {
+    committed_timestamps_ = std::make_shared<TimestampVector>();
+  } else if (!committed_timestamps_.unique()) {
+    committed_timestamps_ = std::make_shared<TimestampVector>(*committed_timestamps_);
+  }
+  return committed_timestamps_.get();
+}
+
 ////////////////////////////////////////////////////////////
 // ScopedTransaction
 ////////////////////////////////////////////////////////////
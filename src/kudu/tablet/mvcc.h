@@ -18,6 +18,7 @@
 #define KUDU_TABLET_MVCC_H
 
 #include <gtest/gtest_prod.h>
+#include <memory>
 #include <mutex>
 #include <string>
 #include <unordered_map>
@@ -97,7 +98,7 @@ class MvccSnapshot {
   // transactions with timestamps less than some timestamp to be committed,
   // and all other transactions to be uncommitted.
   bool is_clean() const {
-    return committed_timestamps_.empty();
+    return !committed_timestamps_ || committed_timestamps_->empty();
   }
 
   // Consider the given list of timestamps to be committed in this snapshot,
@@ -117,6 +118,16 @@ class MvccSnapshot {
 
   void AddCommittedTimestamp(Timestamp timestamp);
 
+  // Remove the committed timestamps lower than 'watermark', which must be
+  // at most 'all_committed_before_'.
+  void RemoveCommittedTimestampsBefore(Timestamp watermark);
+
+  typedef std::vector<Timestamp::val_type> TimestampVector;
+
+  // Return 'committed_timestamps_' for modification, first copying it if it
+  // is shared with another snapshot.
+  TimestampVector* mutable_committed_timestamps();
+
   // Summary rule:
   //   A transaction T is committed if and only if:
   //      T < all_committed_before_ or
@@ -148,7 +159,11 @@ class MvccSnapshot {
   // rarely consulted (most data will be culled by 'all_committed_before_'
   // or none_committed_at_or_after_. So, using the compact vector structure fits
   // the whole thing on one or two cache lines, and it ends up going faster.
-  std::vector<Timestamp::val_type> committed_timestamps_;
+  //
+  // Copies of a snapshot share the vector, and it is copied on write, so that
+  // taking a snapshot from the MvccManager doesn't copy it. May be null if
+  // there are no such transactions.
+  std::shared_ptr<TimestampVector> committed_timestamps_;
 
 };
 
@@ -244,6 +259,15 @@ class MvccManager {
   // manager can trim state.
   void OfflineAdjustSafeTime(Timestamp safe_time);
 
+  // Used by leaders to obtain a safe time for their followers: a timestamp
+  // such that every transaction at or before it has committed, and such that
+  // no new transaction can start at or before it, on this or any other
+  // server. It's the earlier of the clock's global lower bound and the
+  // earliest in-flight transaction. Also advances the local safe time to it.
+  //
+  // Returns Status::NotSupported() if the clock does not provide such a bound.
+  Status GetSafeTimeForReplicas(Timestamp* safe_time);
+
   // Take a snapshot of the current MVCC state, which indicates which
   // transactions have been committed at the time of this call.
   void TakeSnapshot(MvccSnapshot *snapshot) const;
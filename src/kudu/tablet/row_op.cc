@@ -24,7 +24,9 @@ namespace tablet {
 
 RowOp::RowOp(DecodedRowOperation decoded_op)
     : decoded_op(std::move(decoded_op)),
-      orig_result_from_log_(nullptr) {
+      orig_result_from_log_(nullptr),
+      checked_present(false),
+      present_in_rowset(nullptr) {
 }
 
 RowOp::~RowOp() {
@@ -57,5 +59,10 @@ void RowOp::SetAlreadyFlushed() {
   result->set_flushed(true);
 }
 
+void RowOp::SetLoadedFromCheckpoint(const OperationResultPB& orig_result) {
+  DCHECK(!result) << result->DebugString();
+  result.reset(new OperationResultPB(orig_result));
+}
+
 } // namespace tablet
 } // namespace kudu
@@ -37,12 +37,15 @@ struct RowOp {
   ~RowOp();
 
   // Functions to set the result of the mutation.
-  // Only one of the following three functions must be called,
+  // Only one of the following functions must be called,
   // at most once.
   void SetFailed(const Status& s);
   void SetInsertSucceeded(int mrs_id);
   void SetMutateSucceeded(gscoped_ptr<OperationResultPB> result);
   void SetAlreadyFlushed();
+  // Sets the result of an operation replayed during bootstrap whose effects
+  // were loaded from a MemRowSet checkpoint to its original result.
+  void SetLoadedFromCheckpoint(const OperationResultPB& orig_result);
 
   // In the case that this operation is being replayed from the WAL
   // during tablet bootstrap, we may need to look at the original result
@@ -81,6 +84,16 @@ struct RowOp {
   // If this operation is being replayed from the log, set to the original
   // result. Otherwise nullptr.
   const OperationResultPB* orig_result_from_log_;
+
+  // True if Tablet::BulkCheckPresence() already probed the rowsets for this
+  // operation's key, in which case 'present_in_rowset' holds the result.
+  bool checked_present;
+
+  // The rowset which holds a live row with this operation's key, or nullptr
+  // if no rowset does. Only valid if 'checked_present' is true. When the
+  // check ran while the transaction was being replicated, the rowset may
+  // have since been flushed or compacted away.
+  RowSet* present_in_rowset;
 };
 
 
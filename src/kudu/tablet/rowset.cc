@@ -34,9 +34,11 @@ using strings::Substitute;
 namespace kudu { namespace tablet {
 
 DuplicatingRowSet::DuplicatingRowSet(RowSetVector old_rowsets,
-                                     RowSetVector new_rowsets)
+                                     RowSetVector new_rowsets,
+                                     bool output_may_drop_rows)
     : old_rowsets_(std::move(old_rowsets)),
-      new_rowsets_(std::move(new_rowsets)) {
+      new_rowsets_(std::move(new_rowsets)),
+      output_may_drop_rows_(output_may_drop_rows) {
   CHECK_GT(old_rowsets_.size(), 0);
   CHECK_GT(new_rowsets_.size(), 0);
 }
@@ -153,6 +155,10 @@ Status DuplicatingRowSet::MutateRow(Timestamp timestamp,
     }
     // IsNotFound is OK - it might be in a different one.
   }
+  if (mirrored_count == 0 && output_may_drop_rows_) {
+    // The row expired, so the compaction dropped it.
+    return Status::OK();
+  }
   CHECK_EQ(mirrored_count, 1)
     << "Updated row in compaction input, but didn't mirror in exactly 1 new rowset: "
     << probe.schema()->CreateKeyProjection().DebugRow(probe.row_key());
@@ -36,6 +36,7 @@
 namespace kudu {
 
 class RowChangeList;
+class ScanSpec;
 
 namespace consensus {
 class OpId;
@@ -50,6 +51,13 @@ class RowSetKeyProbe;
 class RowSetMetadata;
 struct ProbeStats;
 
+// The checksums which a checksum scan of whole rows would compute for a set
+// of rowsets, added up, and the number of rows they cover.
+struct StoredChecksums {
+  uint64_t checksum = 0;
+  int64_t num_rows = 0;
+};
+
 class RowSet {
  public:
   enum DeltaCompactionType {
@@ -88,6 +96,19 @@ class RowSet {
                                 const MvccSnapshot &snap,
                                 gscoped_ptr<RowwiseIterator>* out) const = 0;
 
+  // Returns false if this rowset is known to hold no rows which satisfy all
+  // of the predicates in 'spec', in which case it need not be scanned.
+  // This does not incur any IO.
+  virtual bool MayMatchPredicates(const ScanSpec& spec) const = 0;
+
+  // If the checksum of this rowset's rows, as a scan of 'projection' at
+  // 'snap' without predicates would compute it, is known without reading
+  // them, adds it to 'checksums' and returns true. Otherwise returns false,
+  // in which case the rowset must be scanned. This does not incur any IO.
+  virtual bool AddStoredChecksum(const Schema& projection,
+                                 const MvccSnapshot& snap,
+                                 StoredChecksums* checksums) const = 0;
+
   // Create the input to be used for a compaction.
   // The provided 'projection' is for the compaction output. Each row
   // will be projected into this Schema.
@@ -249,7 +270,11 @@ struct ProbeStats {
 // See compaction.txt for a little more detail on how this is used.
 class DuplicatingRowSet : public RowSet {
  public:
-  DuplicatingRowSet(RowSetVector old_rowsets, RowSetVector new_rowsets);
+  // If 'output_may_drop_rows' is true, the output may lack rows which remain
+  // in the input (i.e. rows which expired), and mutations of those are only
+  // applied to the input.
+  DuplicatingRowSet(RowSetVector old_rowsets, RowSetVector new_rowsets,
+                    bool output_may_drop_rows = false);
 
   virtual Status MutateRow(Timestamp timestamp,
                            const RowSetKeyProbe &probe,
@@ -265,6 +290,14 @@ class DuplicatingRowSet : public RowSet {
                                 const MvccSnapshot &snap,
                                 gscoped_ptr<RowwiseIterator>* out) const OVERRIDE;
 
+  bool MayMatchPredicates(const ScanSpec& spec) const OVERRIDE { return true; }
+
+  bool AddStoredChecksum(const Schema& projection,
+                         const MvccSnapshot& snap,
+                         StoredChecksums* checksums) const OVERRIDE {
+    return false;
+  }
+
   virtual Status NewCompactionInput(const Schema* projection,
                                     const MvccSnapshot &snap,
                                     gscoped_ptr<CompactionInput>* out) const OVERRIDE;
@@ -320,6 +353,7 @@ class DuplicatingRowSet : public RowSet {
 
   RowSetVector old_rowsets_;
   RowSetVector new_rowsets_;
+  const bool output_may_drop_rows_;
 };
 
 
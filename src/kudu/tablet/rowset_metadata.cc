@@ -73,6 +73,16 @@ Status RowSetMetadata::InitFromPB(const RowSetDataPB& pb) {
   for (const ColumnDataPB& col_pb : pb.columns()) {
     ColumnId col_id = ColumnId(col_pb.column_id());
     blocks_by_col_id_[col_id] = BlockId::FromPB(col_pb.block());
+    if (col_pb.has_stats()) {
+      stats_by_col_id_[col_id] = col_pb.stats();
+    }
+    if (col_pb.has_bitmap_index_block()) {
+      bitmap_index_blocks_by_col_id_[col_id] = BlockId::FromPB(col_pb.bitmap_index_block());
+    }
+  }
+
+  if (pb.has_base_data_checksum()) {
+    base_data_checksum_ = pb.base_data_checksum();
   }
 
   // Load redo delta files
@@ -104,6 +114,20 @@ void RowSetMetadata::ToProtobuf(RowSetDataPB *pb) {
     ColumnDataPB *col_data = pb->add_columns();
     block_id.CopyToPB(col_data->mutable_block());
     col_data->set_column_id(col_id);
+
+    const ColumnStatsPB* stats = FindOrNull(stats_by_col_id_, col_id);
+    if (stats != nullptr) {
+      col_data->mutable_stats()->CopyFrom(*stats);
+    }
+
+    const BlockId* index_block = FindOrNull(bitmap_index_blocks_by_col_id_, col_id);
+    if (index_block != nullptr) {
+      index_block->CopyToPB(col_data->mutable_bitmap_index_block());
+    }
+  }
+
+  if (base_data_checksum_.IsInitialized()) {
+    pb->mutable_base_data_checksum()->CopyFrom(base_data_checksum_);
   }
 
   // Write Delta Files
@@ -139,6 +163,21 @@ void RowSetMetadata::SetColumnDataBlocks(const ColumnIdToBlockIdMap& blocks) {
   blocks_by_col_id_ = blocks;
 }
 
+void RowSetMetadata::SetColumnStats(const ColumnIdToStatsMap& stats) {
+  std::lock_guard<LockType> l(lock_);
+  stats_by_col_id_ = stats;
+}
+
+void RowSetMetadata::SetColumnBitmapIndexBlocks(const ColumnIdToBlockIdMap& blocks) {
+  std::lock_guard<LockType> l(lock_);
+  bitmap_index_blocks_by_col_id_ = blocks;
+}
+
+void RowSetMetadata::SetBaseDataChecksum(const BaseDataChecksumPB& checksum) {
+  std::lock_guard<LockType> l(lock_);
+  base_data_checksum_ = checksum;
+}
+
 Status RowSetMetadata::CommitRedoDeltaDataBlock(int64_t dms_id,
                                                 const BlockId& block_id) {
   std::lock_guard<LockType> l(lock_);
@@ -191,20 +230,48 @@ Status RowSetMetadata::CommitUpdate(const RowSetMetadataUpdate& update) {
       undo_delta_blocks_.insert(undo_delta_blocks_.begin(), update.new_undo_block_);
     }
 
+    for (const BlockId& b : update.undo_blocks_to_remove_) {
+      auto it = std::find(undo_delta_blocks_.begin(), undo_delta_blocks_.end(), b);
+      if (it == undo_delta_blocks_.end()) {
+        return Status::InvalidArgument(
+            Substitute("Cannot find UNDO delta block $0 in <$1>",
+                       b.ToString(), BlockId::JoinStrings(undo_delta_blocks_)));
+      }
+      removed.push_back(b);
+      undo_delta_blocks_.erase(it);
+    }
+
     for (const ColumnIdToBlockIdMap::value_type& e : update.cols_to_replace_) {
       // If we are major-compacting deltas into a column which previously had no
       // base-data (e.g. because it was newly added), then there will be no original
       // block there to replace.
       BlockId old_block_id;
+      stats_by_col_id_.erase(e.first);
+      base_data_checksum_.Clear();
       if (UpdateReturnCopy(&blocks_by_col_id_, e.first, e.second, &old_block_id)) {
         removed.push_back(old_block_id);
       }
+      if (FindCopy(bitmap_index_blocks_by_col_id_, e.first, &old_block_id)) {
+        bitmap_index_blocks_by_col_id_.erase(e.first);
+        removed.push_back(old_block_id);
+      }
     }
 
     for (ColumnId col_id : update.col_ids_to_remove_) {
       BlockId old = FindOrDie(blocks_by_col_id_, col_id);
       CHECK_EQ(1, blocks_by_col_id_.erase(col_id));
+      stats_by_col_id_.erase(col_id);
+      base_data_checksum_.Clear();
       removed.push_back(old);
+      if (FindCopy(bitmap_index_blocks_by_col_id_, col_id, &old)) {
+        bitmap_index_blocks_by_col_id_.erase(col_id);
+        removed.push_back(old);
+      }
+    }
+
+    for (const ColumnIdToBlockIdMap::value_type& e : update.bitmap_indexes_to_set_) {
+      DCHECK(ContainsKey(update.cols_to_replace_, e.first));
+      InsertOrDie(&bitmap_index_blocks_by_col_id_, e.first, e.second);
     }
   }
 
@@ -225,6 +292,7 @@ vector<BlockId> RowSetMetadata::GetAllBlocks() {
     blocks.push_back(bloom_block_);
   }
   AppendValuesFromMap(blocks_by_col_id_, &blocks);
+  AppendValuesFromMap(bitmap_index_blocks_by_col_id_, &blocks);
 
   blocks.insert(blocks.end(),
                 undo_delta_blocks_.begin(), undo_delta_blocks_.end());
@@ -250,6 +318,12 @@ RowSetMetadataUpdate& RowSetMetadataUpdate::RemoveColumnId(ColumnId col_id) {
   return *this;
 }
 
+RowSetMetadataUpdate& RowSetMetadataUpdate::SetColumnBitmapIndexBlock(ColumnId col_id,
+                                                                      const BlockId& block_id) {
+  InsertOrDie(&bitmap_indexes_to_set_, col_id, block_id);
+  return *this;
+}
+
 RowSetMetadataUpdate& RowSetMetadataUpdate::ReplaceRedoDeltaBlocks(
     const std::vector<BlockId>& to_remove,
     const std::vector<BlockId>& to_add) {
@@ -264,5 +338,11 @@ RowSetMetadataUpdate& RowSetMetadataUpdate::SetNewUndoBlock(const BlockId& undo_
   return *this;
 }
 
+RowSetMetadataUpdate& RowSetMetadataUpdate::RemoveUndoDeltaBlocks(
+    const std::vector<BlockId>& to_remove) {
+  undo_blocks_to_remove_.insert(undo_blocks_to_remove_.end(), to_remove.begin(), to_remove.end());
+  return *this;
+}
+
 } // namespace tablet
 } // namespace kudu
@@ -64,6 +64,7 @@ class TabletMetadata;
 class RowSetMetadata {
  public:
   typedef std::map<ColumnId, BlockId> ColumnIdToBlockIdMap;
+  typedef std::map<ColumnId, ColumnStatsPB> ColumnIdToStatsMap;
 
   // Create a new RowSetMetadata
   static Status CreateNew(TabletMetadata* tablet_metadata,
@@ -99,6 +100,44 @@ class RowSetMetadata {
 
   void SetColumnDataBlocks(const ColumnIdToBlockIdMap& blocks_by_col_id);
 
+  // Set the statistics of the columns' base data. The statistics of a column
+  // are dropped whenever its data block is replaced or removed.
+  void SetColumnStats(const ColumnIdToStatsMap& stats_by_col_id);
+
+  // Copy the statistics of the given column's base data into 'stats'.
+  // Returns false if there are no statistics for the column.
+  bool GetColumnStats(ColumnId col_id, ColumnStatsPB* stats) const {
+    std::lock_guard<LockType> l(lock_);
+    return FindCopy(stats_by_col_id_, col_id, stats);
+  }
+
+  // Set the bitmap index blocks of the columns' base data, for those columns
+  // which have indexes. The index of a column is dropped whenever its data
+  // block is replaced or removed, unless the update brings a new one.
+  void SetColumnBitmapIndexBlocks(const ColumnIdToBlockIdMap& blocks_by_col_id);
+
+  // Set 'block_id' to the bitmap index block of the given column's base data.
+  // Returns false if the column has no index.
+  bool GetColumnBitmapIndexBlock(ColumnId col_id, BlockId* block_id) const {
+    std::lock_guard<LockType> l(lock_);
+    return FindCopy(bitmap_index_blocks_by_col_id_, col_id, block_id);
+  }
+
+  // Set the checksum of the base data. It is dropped whenever a column's
+  // data block is replaced or removed.
+  void SetBaseDataChecksum(const BaseDataChecksumPB& checksum);
+
+  // Copy the checksum of the base data into 'checksum'. Returns false if
+  // there is none.
+  bool GetBaseDataChecksum(BaseDataChecksumPB* checksum) const {
+    std::lock_guard<LockType> l(lock_);
+    if (!base_data_checksum_.IsInitialized()) {
+      return false;
+    }
+    checksum->CopyFrom(base_data_checksum_);
+    return true;
+  }
+
   Status CommitRedoDeltaDataBlock(int64_t dms_id, const BlockId& block_id);
 
   Status CommitUndoDeltaDataBlock(const BlockId& block_id);
@@ -206,6 +245,18 @@ class RowSetMetadata {
 
   // Map of column ID to block ID.
   ColumnIdToBlockIdMap blocks_by_col_id_;
+
+  // Map of column ID to the statistics of the column's block, for those
+  // columns which have them.
+  ColumnIdToStatsMap stats_by_col_id_;
+
+  // Map of column ID to the bitmap index block of the column's block, for
+  // those columns which have them.
+  ColumnIdToBlockIdMap bitmap_index_blocks_by_col_id_;
+
+  // Uninitialized if there's no checksum of the base data.
+  BaseDataChecksumPB base_data_checksum_;
+
   std::vector<BlockId> redo_delta_blocks_;
   std::vector<BlockId> undo_delta_blocks_;
 
@@ -236,14 +287,22 @@ class RowSetMetadataUpdate {
   // Remove the CFile for the given column ID.
   RowSetMetadataUpdate& RemoveColumnId(ColumnId col_id);
 
+  // Set the bitmap index of the replacement CFile of the given column ID.
+  RowSetMetadataUpdate& SetColumnBitmapIndexBlock(ColumnId col_id, const BlockId& block_id);
+
   // Add a new UNDO delta block to the list of UNDO files.
   // We'll need to replace them instead when we start GCing.
   RowSetMetadataUpdate& SetNewUndoBlock(const BlockId& undo_block);
 
+  // Remove the given UNDO delta blocks, which need not be contiguous, from
+  // the list of UNDO files.
+  RowSetMetadataUpdate& RemoveUndoDeltaBlocks(const std::vector<BlockId>& to_remove);
+
  private:
   friend class RowSetMetadata;
   RowSetMetadata::ColumnIdToBlockIdMap cols_to_replace_;
   std::vector<ColumnId> col_ids_to_remove_;
+  RowSetMetadata::ColumnIdToBlockIdMap bitmap_indexes_to_set_;
   std::vector<BlockId> new_redo_blocks_;
 
   struct ReplaceDeltaBlocks {
@@ -252,6 +311,7 @@ class RowSetMetadataUpdate {
   };
   std::vector<ReplaceDeltaBlocks> replace_redo_blocks_;
   BlockId new_undo_block_;
+  std::vector<BlockId> undo_blocks_to_remove_;
 
   DISALLOW_COPY_AND_ASSIGN(RowSetMetadataUpdate);
 };
@@ -104,6 +104,48 @@ TEST_F(TestRowSetTree, TestTree) {
   ASSERT_EQ(vec[2].get(), out[3]);
 }
 
+// Keys past the end of every DiskRowSet only ever need to be checked against
+// the MemRowSet.
+TEST_F(TestRowSetTree, TestKeysAboveMaxBoundedKey) {
+  RowSetTree empty_tree;
+  ASSERT_OK(empty_tree.Reset(RowSetVector()));
+  ASSERT_TRUE(empty_tree.IsAboveMaxBoundedKey(""));
+
+  RowSetVector vec;
+  vec.push_back(shared_ptr<RowSet>(new MockDiskRowSet("0", "5")));
+  vec.push_back(shared_ptr<RowSet>(new MockDiskRowSet("3", "7")));
+  vec.push_back(shared_ptr<RowSet>(new MockMemRowSet()));
+
+  RowSetTree tree;
+  ASSERT_OK(tree.Reset(vec));
+  ASSERT_FALSE(tree.IsAboveMaxBoundedKey("6"));
+  ASSERT_FALSE(tree.IsAboveMaxBoundedKey("7"));
+  ASSERT_TRUE(tree.IsAboveMaxBoundedKey("8"));
+
+  // "7" is still the max key of 3-7.
+  vector<RowSet *> out;
+  tree.FindRowSetsWithKeyInRange("7", &out);
+  ASSERT_EQ(2, out.size());
+  ASSERT_EQ(vec[2].get(), out[0]); // MemRowSet
+  ASSERT_EQ(vec[1].get(), out[1]);
+
+  // "8" is only checked against the MemRowSet.
+  out.clear();
+  tree.FindRowSetsWithKeyInRange("8", &out);
+  ASSERT_EQ(1, out.size());
+  ASSERT_EQ(vec[2].get(), out[0]);
+
+  vector<std::pair<RowSet*, int>> found;
+  tree.ForEachRowSetContainingKeys({ Slice("4"), Slice("8") }, [&](RowSet* rs, int i) {
+      found.emplace_back(rs, i);
+    });
+  ASSERT_EQ(4, found.size());
+  ASSERT_EQ(std::make_pair(vec[2].get(), 0), found[0]);
+  ASSERT_EQ(std::make_pair(vec[0].get(), 0), found[1]);
+  ASSERT_EQ(std::make_pair(vec[1].get(), 0), found[2]);
+  ASSERT_EQ(std::make_pair(vec[2].get(), 1), found[3]);
+}
+
 TEST_F(TestRowSetTree, TestPerformance) {
   const int kNumRowSets = 200;
   const int kNumQueries = AllowSlowTests() ? 1000000 : 10000;
@@ -77,7 +77,8 @@ struct RowSetIntervalTraits {
 };
 
 RowSetTree::RowSetTree()
-  : initted_(false) {
+  : has_bounded_rowsets_(false),
+    initted_(false) {
 }
 
 Status RowSetTree::Reset(const RowSetVector &rowsets) {
@@ -126,6 +127,10 @@ Status RowSetTree::Reset(const RowSetVector &rowsets) {
   // Sort endpoints
   std::sort(endpoints.begin(), endpoints.end(), RSEndpointBySliceCompare);
 
+  // The last endpoint is the greatest of the max keys.
+  has_bounded_rowsets_ = !endpoints.empty();
+  max_bounded_key_ = has_bounded_rowsets_ ? endpoints.back().slice_.ToString() : "";
+
   // Install the vectors into the object.
   entries_.swap(entries);
   unbounded_rowsets_.swap(unbounded);
@@ -180,6 +185,12 @@ void RowSetTree::FindRowSetsWithKeyInRange(const Slice &encoded_key,
     rowsets->push_back(rs.get());
   }
 
+  // Keys past every rowset with known bounds, as when appending to the end
+  // of the key space, don't need to query the interval tree.
+  if (IsAboveMaxBoundedKey(encoded_key)) {
+    return;
+  }
+
   // Query the interval tree to efficiently find rowsets with known bounds
   // whose ranges overlap the probe key.
   vector<RowSetWithBounds *> from_tree;
@@ -191,6 +202,28 @@ void RowSetTree::FindRowSetsWithKeyInRange(const Slice &encoded_key,
   }
 }
 
+void RowSetTree::ForEachRowSetContainingKeys(
+    const vector<Slice>& encoded_keys,
+    const std::function<void(RowSet*, int)>& cb) const {
+  DCHECK(initted_);
+
+  vector<RowSetWithBounds *> from_tree;
+  from_tree.reserve(all_rowsets_.size());
+  for (int i = 0; i < encoded_keys.size(); i++) {
+    for (const shared_ptr<RowSet> &rs : unbounded_rowsets_) {
+      cb(rs.get(), i);
+    }
+    if (IsAboveMaxBoundedKey(encoded_keys[i])) {
+      continue;
+    }
+    from_tree.clear();
+    tree_->FindContainingPoint(encoded_keys[i], &from_tree);
+    for (RowSetWithBounds *rs : from_tree) {
+      cb(rs->rowset, i);
+    }
+  }
+}
+
 RowSetTree::~RowSetTree() {
   STLDeleteElements(&entries_);
 }
@@ -17,6 +17,8 @@
 #ifndef KUDU_TABLET_ROWSET_MANAGER_H
 #define KUDU_TABLET_ROWSET_MANAGER_H
 
+#include <functional>
+#include <string>
 #include <unordered_map>
 #include <vector>
 #include <utility>
@@ -73,10 +75,23 @@ class RowSetTree {
   void FindRowSetsWithKeyInRange(const Slice &encoded_key,
                                  std::vector<RowSet *> *rowsets) const;
 
+  // Call 'cb(rowset, i)' for every RowSet whose range may contain
+  // 'encoded_keys[i]', for each of the keys in turn.
+  void ForEachRowSetContainingKeys(const std::vector<Slice>& encoded_keys,
+                                   const std::function<void(RowSet*, int)>& cb) const;
+
   void FindRowSetsIntersectingInterval(const Slice &lower_bound,
                                        const Slice &upper_bound,
                                        std::vector<RowSet *> *rowsets) const;
 
+  // Return true if 'encoded_key' is above the max key of every rowset with
+  // known bounds, so that only the unbounded rowsets (i.e. the MemRowSets)
+  // may contain it. This is the common case when appending monotonically
+  // increasing keys.
+  bool IsAboveMaxBoundedKey(const Slice& encoded_key) const {
+    return !has_bounded_rowsets_ || encoded_key.compare(max_bounded_key_) > 0;
+  }
+
   const RowSetVector &all_rowsets() const { return all_rowsets_; }
 
   RowSet* drs_by_id(int64_t drs_id) const {
@@ -116,6 +131,11 @@ class RowSetTree {
   // stored in the interval tree.
   RowSetVector unbounded_rowsets_;
 
+  // The greatest max key of the rowsets in tree_, if there are any. Keys
+  // above it skip the interval tree entirely.
+  bool has_bounded_rowsets_;
+  std::string max_bounded_key_;
+
   bool initted_;
 };
 
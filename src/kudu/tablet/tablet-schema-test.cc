@@ -121,6 +121,38 @@ TEST_F(TestTabletSchema, TestRead) {
                       "Some columns are not present in the current schema: c2, c3");
 }
 
+// Verify that scans with the same projection share its mapping to the tablet
+// schema, and that the mapping is redone once the schema changes.
+TEST_F(TestTabletSchema, TestProjectionCache) {
+  InsertRows(client_schema_, 0, 10);
+
+  gscoped_ptr<RowwiseIterator> iter1;
+  gscoped_ptr<RowwiseIterator> iter2;
+  ASSERT_OK(tablet()->NewRowIterator(client_schema_, &iter1));
+  ASSERT_OK(tablet()->NewRowIterator(client_schema_, &iter2));
+  ASSERT_OK(iter1->Init(nullptr));
+  ASSERT_OK(iter2->Init(nullptr));
+  ASSERT_EQ(&iter1->schema(), &iter2->schema());
+  ASSERT_TRUE(iter1->schema().has_column_ids());
+
+  // After renaming a column, the old projection must not be resolved from
+  // the cache anymore.
+  SchemaBuilder builder(tablet()->metadata()->schema());
+  ASSERT_OK(builder.RenameColumn("c1", "c1_renamed"));
+  AlterSchema(builder.Build());
+
+  gscoped_ptr<RowwiseIterator> iter3;
+  ASSERT_OK(tablet()->NewRowIterator(client_schema_, &iter3));
+  Status s = iter3->Init(nullptr);
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+  ASSERT_STR_CONTAINS(s.ToString(), "Some columns are not present in the current schema: c1");
+
+  Schema renamed = builder.BuildWithoutIds();
+  ASSERT_OK(tablet()->NewRowIterator(renamed, &iter3));
+  ASSERT_OK(iter3->Init(nullptr));
+  ASSERT_NE(&iter1->schema(), &iter3->schema());
+}
+
 // Write to the tablet using different schemas,
 // and verifies that the read and write defauls are respected.
 TEST_F(TestTabletSchema, TestWrite) {
@@ -32,6 +32,7 @@
 #include "kudu/util/test_macros.h"
 
 using std::shared_ptr;
+using std::unique_ptr;
 using std::unordered_set;
 
 namespace kudu {
@@ -352,6 +353,121 @@ TYPED_TEST(TestTablet, TestReinsertDuringFlush) {
 // Test iterating over a tablet which contains data
 // in the memrowset as well as two rowsets. This simple test
 // only puts one row in each with no updates.
+TYPED_TEST(TestTablet, TestSplitKeyRange) {
+  // Flush three rowsets with disjoint key ranges. The keys have the same
+  // number of digits so that they sort the same way for string keys.
+  for (int first_row : { 10, 30, 50 }) {
+    this->InsertTestRows(first_row, 10, 0);
+    ASSERT_OK(this->tablet()->Flush());
+  }
+
+  // A small enough chunk size splits the tablet at each of the rowsets.
+  vector<string> split_keys;
+  this->tablet()->SplitKeyRange(nullptr, nullptr, 1, &split_keys);
+  ASSERT_EQ(2, split_keys.size());
+  ASSERT_LT(split_keys[0], split_keys[1]);
+
+  // A chunk size larger than the tablet doesn't split it.
+  vector<string> no_split_keys;
+  this->tablet()->SplitKeyRange(nullptr, nullptr, 1L << 40, &no_split_keys);
+  ASSERT_TRUE(no_split_keys.empty());
+
+  // The split keys are strictly inside the requested range.
+  Slice start_key(split_keys[0]);
+  vector<string> keys_after_start;
+  this->tablet()->SplitKeyRange(&start_key, nullptr, 1, &keys_after_start);
+  ASSERT_EQ(vector<string>({ split_keys[1] }), keys_after_start);
+
+  Slice stop_key(split_keys[1]);
+  vector<string> keys_before_stop;
+  this->tablet()->SplitKeyRange(nullptr, &stop_key, 1, &keys_before_stop);
+  ASSERT_EQ(vector<string>({ split_keys[0] }), keys_before_stop);
+}
+
+TYPED_TEST(TestTablet, TestSplit) {
+  // Flush three rowsets with disjoint key ranges, and leave some rows in
+  // the MemRowSet, which the split flushes as a fourth rowset.
+  for (int first_row : { 10, 30, 50 }) {
+    this->InsertTestRows(first_row, 10, 0);
+    ASSERT_OK(this->tablet()->Flush());
+  }
+  this->InsertTestRows(70, 10, 0);
+
+  string split_key;
+  vector<RowSetDataPB> left_rowsets;
+  vector<RowSetDataPB> right_rowsets;
+  ASSERT_OK(this->tablet()->Split("left", "right", &split_key,
+                                  &left_rowsets, &right_rowsets));
+  ASSERT_FALSE(split_key.empty());
+  ASSERT_FALSE(left_rowsets.empty());
+  ASSERT_FALSE(right_rowsets.empty());
+  ASSERT_EQ(4, left_rowsets.size() + right_rowsets.size());
+  ASSERT_TRUE(this->tablet()->metadata()->has_been_split());
+
+  // Writes are rejected once the tablet is split.
+  LocalTabletWriter writer(this->tablet().get(), &this->client_schema_);
+  Status s = this->InsertTestRow(&writer, 100, 0);
+  ASSERT_TRUE(s.IsIllegalState()) << s.ToString();
+
+  // Retrying the split returns the same result, but splitting into other
+  // tablets fails.
+  string retry_split_key;
+  vector<RowSetDataPB> retry_left_rowsets;
+  vector<RowSetDataPB> retry_right_rowsets;
+  ASSERT_OK(this->tablet()->Split("left", "right", &retry_split_key,
+                                  &retry_left_rowsets, &retry_right_rowsets));
+  ASSERT_EQ(split_key, retry_split_key);
+  ASSERT_EQ(left_rowsets.size(), retry_left_rowsets.size());
+  ASSERT_EQ(right_rowsets.size(), retry_right_rowsets.size());
+  s = this->tablet()->Split("other_left", "other_right", &retry_split_key,
+                            &retry_left_rowsets, &retry_right_rowsets);
+  ASSERT_TRUE(s.IsIllegalState()) << s.ToString();
+}
+
+TYPED_TEST(TestTablet, TestLookupRows) {
+  // Put rows 0-9 and 10-19 in two disk rowsets, and rows 20-24 in the
+  // MemRowSet. Then delete row 5, update row 12, and delete and reinsert
+  // row 7, so that its live version is in the MemRowSet.
+  this->InsertTestRows(0, 10, 0);
+  ASSERT_OK(this->tablet()->Flush());
+  this->InsertTestRows(10, 10, 0);
+  ASSERT_OK(this->tablet()->Flush());
+  this->InsertTestRows(20, 5, 0);
+  LocalTabletWriter writer(this->tablet().get(), &this->client_schema_);
+  ASSERT_OK(this->DeleteTestRow(&writer, 5));
+  ASSERT_OK(this->UpdateTestRow(&writer, 12, 1));
+  ASSERT_OK(this->DeleteTestRow(&writer, 7));
+  ASSERT_OK(this->InsertTestRow(&writer, 7, 2));
+
+  vector<string> encoded_keys;
+  for (int64_t key_idx : { 3, 5, 7, 12, 22, 100 }) {
+    KuduPartialRow row(&this->client_schema_);
+    this->setup_.BuildRowKey(&row, key_idx);
+    string encoded_key;
+    ASSERT_OK(row.EncodeRowKey(&encoded_key));
+    encoded_keys.push_back(encoded_key);
+  }
+  vector<Slice> keys(encoded_keys.begin(), encoded_keys.end());
+
+  vector<string> rows;
+  ASSERT_OK(this->tablet()->LookupRows(this->client_schema_, keys, [&](const RowBlock& block) {
+        for (size_t i = 0; i < block.nrows(); i++) {
+          if (block.selection_vector()->IsRowSelected(i)) {
+            rows.push_back(block.schema().DebugRow(block.row(i)));
+          }
+        }
+      }));
+  std::sort(rows.begin(), rows.end());
+
+  // Rows 5 and 100 don't exist.
+  vector<string> expected = { this->setup_.FormatDebugRow(3, 0, false),
+                              this->setup_.FormatDebugRow(7, 2, false),
+                              this->setup_.FormatDebugRow(12, 1, true),
+                              this->setup_.FormatDebugRow(22, 0, false) };
+  std::sort(expected.begin(), expected.end());
+  ASSERT_EQ(expected, rows);
+}
+
 TYPED_TEST(TestTablet, TestRowIteratorSimple) {
   const int kInRowSet1 = 1;
   const int kInRowSet2 = 2;
@@ -595,6 +711,51 @@ TYPED_TEST(TestTablet, TestUpsert) {
 }
 
 
+// Test a batch which mixes INSERTs and UPSERTs of new keys, of keys present
+// in a flushed rowset, and of a key which the same batch deletes first.
+TYPED_TEST(TestTablet, TestInsertBatchAgainstFlushedRowSet) {
+  LocalTabletWriter writer(this->tablet().get(), &this->client_schema_);
+  for (int i = 0; i < 10; i++) {
+    ASSERT_OK(this->InsertTestRow(&writer, i, 0));
+  }
+  ASSERT_OK(this->tablet()->Flush());
+
+  vector<unique_ptr<KuduPartialRow>> rows;
+  vector<LocalTabletWriter::Op> ops;
+  auto add_op = [&](RowOperationsPB::Type type, int key_idx, int32_t val) {
+    rows.emplace_back(new KuduPartialRow(&this->client_schema_));
+    if (type == RowOperationsPB::DELETE) {
+      this->setup_.BuildRowKey(rows.back().get(), key_idx);
+    } else {
+      this->setup_.BuildRow(rows.back().get(), key_idx, val);
+    }
+    ops.emplace_back(type, rows.back().get());
+  };
+  add_op(RowOperationsPB::INSERT, 20, 0);
+  add_op(RowOperationsPB::INSERT, 5, 55);
+  add_op(RowOperationsPB::DELETE, 3, 0);
+  add_op(RowOperationsPB::INSERT, 3, 33);
+  add_op(RowOperationsPB::UPSERT, 7, 77);
+  add_op(RowOperationsPB::UPSERT, 21, 0);
+
+  // Only the INSERT of the already-present key 5 fails.
+  Status s = writer.WriteBatch(ops);
+  ASSERT_STR_CONTAINS(s.ToString(), "key already present");
+  ASSERT_STR_CONTAINS(s.ToString(), rows[1]->ToString());
+
+  vector<string> results;
+  ASSERT_OK(this->IterateToStringList(&results));
+  ASSERT_EQ(12, results.size());
+  for (const auto& expected : { this->setup_.FormatDebugRow(20, 0, false),
+                                this->setup_.FormatDebugRow(5, 0, false),
+                                this->setup_.FormatDebugRow(3, 33, false),
+                                this->setup_.FormatDebugRow(7, 77, false),
+                                this->setup_.FormatDebugRow(21, 0, false) }) {
+    ASSERT_TRUE(std::find(results.begin(), results.end(), expected) != results.end())
+        << expected << " not in " << JoinStrings(results, "\n");
+  }
+}
+
 // Test that when a row has been updated many times, it always yields
 // the most recent value.
 TYPED_TEST(TestTablet, TestMultipleUpdates) {
@@ -23,12 +23,15 @@
 #include <memory>
 #include <mutex>
 #include <ostream>
+#include <unordered_map>
 #include <unordered_set>
 #include <utility>
 #include <vector>
 
 #include "kudu/cfile/cfile_writer.h"
+#include "kudu/common/encoded_key.h"
 #include "kudu/common/iterator.h"
+#include "kudu/common/row.h"
 #include "kudu/common/row_changelist.h"
 #include "kudu/common/row_operations.h"
 #include "kudu/common/scan_spec.h"
@@ -39,8 +42,11 @@
 #include "kudu/gutil/atomicops.h"
 #include "kudu/gutil/map-util.h"
 #include "kudu/gutil/stl_util.h"
+#include "kudu/gutil/strings/join.h"
 #include "kudu/gutil/strings/numbers.h"
+#include "kudu/gutil/strings/split.h"
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/gutil/sysinfo.h"
 #include "kudu/server/hybrid_clock.h"
 #include "kudu/tablet/compaction.h"
 #include "kudu/tablet/compaction_policy.h"
@@ -55,16 +61,23 @@
 #include "kudu/tablet/transactions/alter_schema_transaction.h"
 #include "kudu/tablet/transactions/write_transaction.h"
 #include "kudu/util/bloom_filter.h"
+#include "kudu/util/countdown_latch.h"
 #include "kudu/util/debug/trace_event.h"
 #include "kudu/util/env.h"
+#include "kudu/util/env_util.h"
 #include "kudu/util/fault_injection.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/locks.h"
 #include "kudu/util/logging.h"
 #include "kudu/util/maintenance_manager.h"
+#include "kudu/util/memory/arena.h"
 #include "kudu/util/mem_tracker.h"
 #include "kudu/util/metrics.h"
+#include "kudu/util/path_util.h"
+#include "kudu/util/pb_util.h"
+#include "kudu/util/random_util.h"
 #include "kudu/util/stopwatch.h"
+#include "kudu/util/threadpool.h"
 #include "kudu/util/trace.h"
 #include "kudu/util/url-coding.h"
 
@@ -108,12 +121,56 @@ DEFINE_double(tablet_throttler_burst_factor, 1.0f,
              "base rate.");
 TAG_FLAG(tablet_throttler_burst_factor, experimental);
 
+DEFINE_bool(tablet_write_admission_control, true,
+            "Whether tablets reject a growing fraction of writes, asking clients to back "
+            "off, while they take in data faster than their flushes or their WAL can keep "
+            "up with.");
+TAG_FLAG(tablet_write_admission_control, advanced);
+TAG_FLAG(tablet_write_admission_control, runtime);
+
+DEFINE_int32(tablet_write_admission_max_flush_backlog_sec, 30,
+             "The number of seconds which flushes would need to write out a tablet's "
+             "MemRowSet, while it grows faster than they write it, beyond which the tablet "
+             "starts rejecting writes. All writes are rejected at twice this backlog.");
+TAG_FLAG(tablet_write_admission_max_flush_backlog_sec, advanced);
+TAG_FLAG(tablet_write_admission_max_flush_backlog_sec, runtime);
+
 DEFINE_int32(tablet_history_max_age_sec, 15 * 60,
              "Number of seconds to retain tablet history. Reads initiated at a "
              "snapshot that is older than this age will be rejected. "
              "To disable history removal, set to -1.");
 TAG_FLAG(tablet_history_max_age_sec, advanced);
 
+DEFINE_bool(tablet_prune_rowsets_by_column_stats, true,
+            "Whether scans skip DiskRowSets whose column statistics show that they "
+            "cannot contain any rows matching the scan's predicates");
+TAG_FLAG(tablet_prune_rowsets_by_column_stats, advanced);
+
+DEFINE_int32(tablet_compaction_parallelism, 4,
+             "Maximum number of key ranges that a rowset compaction is split into. "
+             "The ranges are merged and written out to separate DiskRowSets "
+             "concurrently, on a thread pool shared by all tablets. Set to 1 to "
+             "compact each set of rowsets on a single thread.");
+TAG_FLAG(tablet_compaction_parallelism, advanced);
+
+DEFINE_string(time_series_compaction_tables, "",
+              "Comma-separated list of table names whose tablets are compacted "
+              "with the time-series compaction policy instead of the budgeted "
+              "one. Suited to tables whose keys are inserted in mostly "
+              "increasing order, where the policy avoids rewriting old, "
+              "non-overlapping rowsets.");
+TAG_FLAG(time_series_compaction_tables, experimental);
+
+DEFINE_int32(tablet_compaction_stats_cache_ms, 5000,
+             "How long the compaction quality computed for the maintenance "
+             "manager is reused, as long as the tablet's set of rowsets hasn't "
+             "changed. Sizes of existing rowsets may change in the meantime as "
+             "deltas are flushed and compacted. Set to 0 to rerun the "
+             "compaction policy on every poll.");
+TAG_FLAG(tablet_compaction_stats_cache_ms, advanced);
+
+DECLARE_bool(tablet_compaction_evict_output_from_page_cache);
+
 METRIC_DEFINE_entity(tablet);
 METRIC_DEFINE_gauge_size(tablet, memrowset_size, "MemRowSet Memory Usage",
                          kudu::MetricUnit::kBytes,
@@ -128,9 +185,11 @@ using kudu::consensus::OpId;
 using kudu::consensus::MaximumOpId;
 using kudu::log::LogAnchorRegistry;
 using kudu::server::HybridClock;
+using std::pair;
 using std::shared_ptr;
 using std::string;
 using std::unique_ptr;
+using std::unordered_map;
 using std::unordered_set;
 using std::vector;
 using strings::Substitute;
@@ -138,10 +197,32 @@ using strings::Substitute;
 namespace kudu {
 namespace tablet {
 
-static CompactionPolicy *CreateCompactionPolicy() {
+const char* const kRowSetsScannedTraceCounter = "rowsets_scanned";
+const char* const kRowSetsPrunedByKeyRangeTraceCounter = "rowsets_pruned_by_key_range";
+const char* const kRowSetsPrunedByColumnStatsTraceCounter = "rowsets_pruned_by_column_stats";
+
+static CompactionPolicy *CreateCompactionPolicy(const string& table_name) {
+  vector<string> tables = strings::Split(FLAGS_time_series_compaction_tables, ",",
+                                         strings::SkipEmpty());
+  if (std::find(tables.begin(), tables.end(), table_name) != tables.end()) {
+    return new TimeSeriesCompactionPolicy(FLAGS_tablet_compaction_budget_mb);
+  }
   return new BudgetedCompactionPolicy(FLAGS_tablet_compaction_budget_mb);
 }
 
+// Returns the pool, shared by all tablets, which merges and writes out the
+// key ranges of parallel compactions.
+static ThreadPool* CompactionPool() {
+  static ThreadPool* pool = [] {
+    gscoped_ptr<ThreadPool> p;
+    CHECK_OK(ThreadPoolBuilder("compaction")
+             .set_max_threads(base::NumCPUs())
+             .Build(&p));
+    return p.release();
+  }();
+  return pool;
+}
+
 ////////////////////////////////////////////////////////////
 // TabletComponents
 ////////////////////////////////////////////////////////////
@@ -150,6 +231,75 @@ TabletComponents::TabletComponents(shared_ptr<MemRowSet> mrs,
                                    shared_ptr<RowSetTree> rs_tree)
     : memrowset(std::move(mrs)), rowsets(std::move(rs_tree)) {}
 
+////////////////////////////////////////////////////////////
+// UndoDeltaBlockGCOp
+////////////////////////////////////////////////////////////
+
+UndoDeltaBlockGCOp::UndoDeltaBlockGCOp(Tablet* tablet)
+  : MaintenanceOp(Substitute("UndoDeltaBlockGCOp($0)", tablet->tablet_id()),
+                  MaintenanceOp::LOW_IO_USAGE),
+    tablet_(tablet) {
+}
+
+void UndoDeltaBlockGCOp::UpdateStats(MaintenanceOpStats* stats) {
+  int64_t bytes = tablet_->EstimateBytesInPotentiallyAncientUndoDeltas();
+  // Reclaiming disk space doesn't speed up reads or writes much, so score it
+  // low enough that real compactions take precedence: one point per GB.
+  stats->set_perf_improvement(static_cast<double>(bytes) / (1024 * 1024 * 1024));
+  stats->set_runnable(bytes > 0);
+}
+
+bool UndoDeltaBlockGCOp::Prepare() {
+  return true;
+}
+
+void UndoDeltaBlockGCOp::Perform() {
+  WARN_NOT_OK(tablet_->DeleteAncientUndoDeltas(),
+              Substitute("Ancient UNDO delta GC failed on $0", tablet_->tablet_id()));
+}
+
+scoped_refptr<Histogram> UndoDeltaBlockGCOp::DurationHistogram() const {
+  return tablet_->metrics()->undo_delta_block_gc_perform_duration;
+}
+
+scoped_refptr<AtomicGauge<uint32_t> > UndoDeltaBlockGCOp::RunningGauge() const {
+  return tablet_->metrics()->undo_delta_block_gc_running;
+}
+
+////////////////////////////////////////////////////////////
+// ExpiredRowSetGCOp
+////////////////////////////////////////////////////////////
+
+ExpiredRowSetGCOp::ExpiredRowSetGCOp(Tablet* tablet)
+  : MaintenanceOp(Substitute("ExpiredRowSetGCOp($0)", tablet->tablet_id()),
+                  MaintenanceOp::LOW_IO_USAGE),
+    tablet_(tablet) {
+}
+
+void ExpiredRowSetGCOp::UpdateStats(MaintenanceOpStats* stats) {
+  int64_t bytes = tablet_->EstimateBytesInExpiredRowSets();
+  // Scored like UndoDeltaBlockGCOp: one point per GB reclaimed.
+  stats->set_perf_improvement(static_cast<double>(bytes) / (1024 * 1024 * 1024));
+  stats->set_runnable(bytes > 0);
+}
+
+bool ExpiredRowSetGCOp::Prepare() {
+  return true;
+}
+
+void ExpiredRowSetGCOp::Perform() {
+  WARN_NOT_OK(tablet_->DeleteExpiredRowSets(),
+              Substitute("Expired rowset GC failed on $0", tablet_->tablet_id()));
+}
+
+scoped_refptr<Histogram> ExpiredRowSetGCOp::DurationHistogram() const {
+  return tablet_->metrics()->expired_rowset_gc_perform_duration;
+}
+
+scoped_refptr<AtomicGauge<uint32_t> > ExpiredRowSetGCOp::RunningGauge() const {
+  return tablet_->metrics()->expired_rowset_gc_running;
+}
+
 ////////////////////////////////////////////////////////////
 // Tablet
 ////////////////////////////////////////////////////////////
@@ -172,10 +322,18 @@ Tablet::Tablet(const scoped_refptr<TabletMetadata>& metadata,
     next_mrs_id_(0),
     clock_(clock),
     mvcc_(clock),
+    last_compaction_stats_quality_(0),
     rowsets_flush_sem_(1),
+    projection_cache_schema_(nullptr),
+    mrs_growth_bytes_per_sec_(0),
+    flush_bytes_per_sec_(0),
+    last_mrs_sample_id_(-1),
+    last_mrs_sample_size_(0),
+    flush_backlog_pressure_(0),
+    admission_rng_(GetRandomSeed32()),
     state_(kInitialized) {
       CHECK(schema()->has_column_ids());
-  compaction_policy_.reset(CreateCompactionPolicy());
+  compaction_policy_.reset(CreateCompactionPolicy(metadata_->table_name()));
 
   if (metric_registry) {
     MetricEntity::AttributeMap attrs;
@@ -186,6 +344,7 @@ Tablet::Tablet(const scoped_refptr<TabletMetadata>& metadata,
                                                                             *schema());
     metric_entity_ = METRIC_ENTITY_tablet.Instantiate(metric_registry, tablet_id(), attrs);
     metrics_.reset(new TabletMetrics(metric_entity_));
+    lock_manager_.set_wait_duration_histogram(metrics_->row_lock_wait_duration);
     METRIC_memrowset_size.InstantiateFunctionGauge(
       metric_entity_, Bind(&Tablet::MemRowSetSize, Unretained(this)))
       ->AutoDetach(&metric_detacher_);
@@ -208,7 +367,7 @@ Tablet::~Tablet() {
 
 Status Tablet::Open() {
   TRACE_EVENT0("tablet", "Tablet::Open");
-  std::lock_guard<rw_spinlock> lock(component_lock_);
+  std::lock_guard<percpu_rwlock> lock(component_lock_);
   CHECK_EQ(state_, kInitialized) << "already open";
   CHECK(schema()->has_column_ids());
 
@@ -249,7 +408,7 @@ void Tablet::MarkFinishedBootstrapping() {
 void Tablet::Shutdown() {
   UnregisterMaintenanceOps();
 
-  std::lock_guard<rw_spinlock> lock(component_lock_);
+  std::lock_guard<percpu_rwlock> lock(component_lock_);
   components_ = nullptr;
   state_ = kShutdown;
 
@@ -260,10 +419,64 @@ void Tablet::Shutdown() {
   metadata_->SetPreFlushCallback(Bind(DoNothingStatusClosure));
 }
 
+namespace {
+
+// The maximum number of distinct projections whose mapping is cached by each
+// tablet. The cache is simply cleared when it fills up.
+const size_t kMaxCachedProjections = 64;
+
+// Returns a string identifying the columns of the client projection
+// 'projection', and everything about them that is verified against the
+// tablet schema when mapping them.
+string ProjectionCacheKey(const Schema& projection) {
+  string key;
+  for (const ColumnSchema& col : projection.columns()) {
+    uint32_t name_len = col.name().size();
+    key.append(reinterpret_cast<const char*>(&name_len), sizeof(name_len));
+    key.append(col.name());
+    key.push_back(static_cast<char>(col.type_info()->type()));
+    key.push_back(col.is_nullable());
+    key.push_back(col.type_attributes().precision);
+    key.push_back(col.type_attributes().scale);
+  }
+  int32_t num_key_columns = projection.num_key_columns();
+  key.append(reinterpret_cast<const char*>(&num_key_columns), sizeof(num_key_columns));
+  return key;
+}
+
+} // anonymous namespace
+
 Status Tablet::GetMappedReadProjection(const Schema& projection,
-                                       Schema *mapped_projection) const {
+                                       shared_ptr<const Schema>* mapped_projection) const {
   const Schema* cur_schema = schema();
-  return cur_schema->GetMappedReadProjection(projection, mapped_projection);
+  // Projections with IDs are rejected by the mapping, so they can't be cached.
+  bool cacheable = !projection.has_column_ids();
+  string key;
+  if (cacheable) {
+    key = ProjectionCacheKey(projection);
+    std::lock_guard<simple_spinlock> l(projection_cache_lock_);
+    if (projection_cache_schema_ == cur_schema) {
+      const shared_ptr<const Schema>* cached = FindOrNull(projection_cache_, key);
+      if (cached) {
+        *mapped_projection = *cached;
+        return Status::OK();
+      }
+    }
+  }
+
+  shared_ptr<Schema> mapped(new Schema());
+  RETURN_NOT_OK(cur_schema->GetMappedReadProjection(projection, mapped.get()));
+  if (cacheable) {
+    std::lock_guard<simple_spinlock> l(projection_cache_lock_);
+    if (projection_cache_schema_ != cur_schema ||
+        projection_cache_.size() >= kMaxCachedProjections) {
+      projection_cache_.clear();
+      projection_cache_schema_ = cur_schema;
+    }
+    projection_cache_.emplace(std::move(key), mapped);
+  }
+  *mapped_projection = std::move(mapped);
+  return Status::OK();
 }
 
 BloomFilterSizing Tablet::bloom_sizing() const {
@@ -302,6 +515,11 @@ Status Tablet::DecodeWriteOperations(const Schema* client_schema,
   // change while this transaction is in-flight.
   tx_state->AcquireSchemaLock(&schema_lock_);
 
+  // The rows of a split tablet belong to the tablets it was split into.
+  if (PREDICT_FALSE(metadata_->has_been_split())) {
+    return Status::IllegalState("Tablet has been split");
+  }
+
   // The Schema needs to be held constant while any transactions are between
   // PREPARE and APPLY stages
   TRACE("PREPARE: Decoding operations");
@@ -330,12 +548,38 @@ Status Tablet::DecodeWriteOperations(const Schema* client_schema,
   return Status::OK();
 }
 
+Status Tablet::CheckWriteOperations(const Schema& client_schema,
+                                    const RowOperationsPB& ops) const {
+  shared_lock<rw_semaphore> l(schema_lock_);
+  Arena arena(1024, 1024 * 1024);
+  RowOperationsPBDecoder dec(&ops, &client_schema, schema(), &arena);
+  vector<DecodedRowOperation> decoded;
+  RETURN_NOT_OK(dec.DecodeOperations(&decoded));
+  for (const DecodedRowOperation& op : decoded) {
+    ConstContiguousRow row_key(&key_schema_, op.row_data);
+    RETURN_NOT_OK(CheckRowInTablet(row_key));
+  }
+  return Status::OK();
+}
+
 Status Tablet::AcquireRowLocks(WriteTransactionState* tx_state) {
   TRACE_EVENT1("tablet", "Tablet::AcquireRowLocks",
                "num_locks", tx_state->row_ops().size());
   TRACE("PREPARE: Acquiring locks for $0 operations", tx_state->row_ops().size());
+  vector<RowOp*> sorted_ops;
+  sorted_ops.reserve(tx_state->row_ops().size());
   for (RowOp* op : tx_state->row_ops()) {
-    RETURN_NOT_OK(AcquireLockForOp(tx_state, op));
+    RETURN_NOT_OK(PrepareKeyForOp(op));
+    sorted_ops.push_back(op);
+  }
+
+  // Take the locks in key order, so that two transactions which lock an
+  // overlapping set of rows can't each end up waiting on the other.
+  std::sort(sorted_ops.begin(), sorted_ops.end(), [](const RowOp* a, const RowOp* b) {
+      return a->key_probe->encoded_key_slice().compare(b->key_probe->encoded_key_slice()) < 0;
+    });
+  for (RowOp* op : sorted_ops) {
+    LockRowForOp(tx_state, op);
   }
   TRACE("PREPARE: locks acquired");
   return Status::OK();
@@ -358,15 +602,22 @@ Status Tablet::CheckRowInTablet(const ConstContiguousRow& row) const {
 }
 
 Status Tablet::AcquireLockForOp(WriteTransactionState* tx_state, RowOp* op) {
+  RETURN_NOT_OK(PrepareKeyForOp(op));
+  LockRowForOp(tx_state, op);
+  return Status::OK();
+}
+
+Status Tablet::PrepareKeyForOp(RowOp* op) {
   ConstContiguousRow row_key(&key_schema_, op->decoded_op.row_data);
   op->key_probe.reset(new tablet::RowSetKeyProbe(row_key));
-  RETURN_NOT_OK(CheckRowInTablet(row_key));
+  return CheckRowInTablet(row_key);
+}
 
+void Tablet::LockRowForOp(WriteTransactionState* tx_state, RowOp* op) {
   op->row_lock = ScopedRowLock(&lock_manager_,
                                tx_state,
                                op->key_probe->encoded_key_slice(),
                                LockManager::LOCK_EXCLUSIVE);
-  return Status::OK();
 }
 
 void Tablet::StartTransaction(WriteTransactionState* tx_state) {
@@ -394,23 +645,33 @@ Status Tablet::InsertOrUpsertUnlocked(WriteTransactionState *tx_state,
   const bool is_upsert = op->decoded_op.type == RowOperationsPB::UPSERT;
   const TabletComponents* comps = DCHECK_NOTNULL(tx_state->tablet_components());
 
-  // First, ensure that it is a unique key by checking all the open RowSets.
-  vector<RowSet *> to_check = FindRowSetsToCheck(op, comps);
-  for (RowSet *rowset : to_check) {
-    bool present = false;
-    RETURN_NOT_OK(rowset->CheckRowPresent(*op->key_probe, &present, stats));
-    if (present) {
-      if (is_upsert) {
-        return ApplyUpsertAsUpdate(tx_state, op, rowset, stats);
-      }
-      Status s = Status::AlreadyPresent("key already present");
-      if (metrics_) {
-        metrics_->insertions_failed_dup_key->Increment();
+  // First, ensure that it is a unique key by checking all the open RowSets,
+  // unless BulkCheckPresence() already did.
+  RowSet* present_in_rowset = nullptr;
+  if (op->checked_present) {
+    present_in_rowset = op->present_in_rowset;
+  } else {
+    vector<RowSet *> to_check = FindRowSetsToCheck(op, comps);
+    for (RowSet *rowset : to_check) {
+      bool present = false;
+      RETURN_NOT_OK(rowset->CheckRowPresent(*op->key_probe, &present, stats));
+      if (present) {
+        present_in_rowset = rowset;
+        break;
       }
-      op->SetFailed(s);
-      return s;
     }
   }
+  if (present_in_rowset) {
+    if (is_upsert) {
+      return ApplyUpsertAsUpdate(tx_state, op, present_in_rowset, stats);
+    }
+    Status s = Status::AlreadyPresent("key already present");
+    if (metrics_) {
+      metrics_->insertions_failed_dup_key->Increment();
+    }
+    op->SetFailed(s);
+    return s;
+  }
 
   Timestamp ts = tx_state->timestamp();
   ConstContiguousRow row(schema(), op->decoded_op.row_data);
@@ -524,6 +785,72 @@ vector<RowSet*> Tablet::FindRowSetsToCheck(RowOp* op,
   return to_check;
 }
 
+Status Tablet::BulkCheckPresence(const TabletComponents* comps,
+                                 WriteTransactionState* tx_state,
+                                 ProbeStats* stats_array) {
+  const vector<RowOp*>& row_ops = tx_state->row_ops();
+
+  // Sort the operations by key, so that duplicate keys end up next to each other.
+  vector<pair<Slice, int>> keys_and_indexes;
+  keys_and_indexes.reserve(row_ops.size());
+  for (int i = 0; i < row_ops.size(); i++) {
+    keys_and_indexes.emplace_back(row_ops[i]->key_probe->encoded_key_slice(), i);
+  }
+  std::sort(keys_and_indexes.begin(), keys_and_indexes.end(),
+            [](const pair<Slice, int>& a, const pair<Slice, int>& b) {
+              return a.first.compare(b.first) < 0;
+            });
+
+  // An operation whose key is also used by another operation in the batch
+  // may observe the effect of that other operation (eg a DELETE followed by
+  // an INSERT of the same row), so only probe up front for unique keys.
+  vector<Slice> keys;
+  vector<int> op_indexes;
+  for (int i = 0; i < keys_and_indexes.size(); i++) {
+    const Slice& key = keys_and_indexes[i].first;
+    if ((i > 0 && keys_and_indexes[i - 1].first == key) ||
+        (i + 1 < keys_and_indexes.size() && keys_and_indexes[i + 1].first == key)) {
+      continue;
+    }
+    const RowOp* op = row_ops[keys_and_indexes[i].second];
+    if ((op->decoded_op.type != RowOperationsPB::INSERT &&
+         op->decoded_op.type != RowOperationsPB::UPSERT) ||
+        op->orig_result_from_log_ != nullptr ||
+        op->checked_present) {
+      continue;
+    }
+    keys.push_back(key);
+    op_indexes.push_back(keys_and_indexes[i].second);
+  }
+  if (keys.empty()) {
+    return Status::OK();
+  }
+
+  // Probe the rowsets one at a time, each with its keys in sorted order.
+  vector<pair<RowSet*, int>> to_check;
+  comps->rowsets->ForEachRowSetContainingKeys(keys, [&](RowSet* rs, int key_idx) {
+      to_check.emplace_back(rs, key_idx);
+    });
+  std::sort(to_check.begin(), to_check.end());
+  for (const auto& e : to_check) {
+    int op_idx = op_indexes[e.second];
+    RowOp* op = row_ops[op_idx];
+    if (op->present_in_rowset) {
+      continue;
+    }
+    bool present = false;
+    RETURN_NOT_OK(e.first->CheckRowPresent(*op->key_probe, &present, &stats_array[op_idx]));
+    if (present) {
+      op->present_in_rowset = e.first;
+    }
+  }
+
+  for (int op_idx : op_indexes) {
+    row_ops[op_idx]->checked_present = true;
+  }
+  return Status::OK();
+}
+
 Status Tablet::MutateRowUnlocked(WriteTransactionState *tx_state,
                                  RowOp* mutate,
                                  ProbeStats* stats) {
@@ -587,8 +914,35 @@ Status Tablet::MutateRowUnlocked(WriteTransactionState *tx_state,
   return s;
 }
 
+Status Tablet::CheckPresenceDuringReplication(WriteTransactionState* tx_state) {
+  for (const RowOp* op : tx_state->row_ops()) {
+    // UPSERTs need the rowset holding the row on Apply, and that may change
+    // if a flush or compaction runs between now and then.
+    if (op->decoded_op.type != RowOperationsPB::INSERT) {
+      return Status::OK();
+    }
+  }
+
+  scoped_refptr<TabletComponents> comps;
+  GetComponents(&comps);
+  tx_state->set_presence_check_components(comps);
+
+  int num_ops = tx_state->row_ops().size();
+  ProbeStats* stats_array = static_cast<ProbeStats*>(
+      tx_state->arena()->AllocateBytesAligned(sizeof(ProbeStats) * num_ops,
+                                              alignof(ProbeStats)));
+  for (int i = 0; i < num_ops; i++) {
+    new (&stats_array[i]) ProbeStats();
+  }
+  Status s = BulkCheckPresence(comps.get(), tx_state, stats_array);
+  if (metrics_) {
+    metrics_->AddProbeStats(stats_array, num_ops, tx_state->arena());
+  }
+  return s;
+}
+
 void Tablet::StartApplying(WriteTransactionState* tx_state) {
-  shared_lock<rw_spinlock> l(component_lock_);
+  shared_lock<rw_spinlock> l(component_lock_.get_lock());
   tx_state->StartApplying();
   tx_state->set_tablet_components(components_);
 }
@@ -601,14 +955,22 @@ void Tablet::ApplyRowOperations(WriteTransactionState* tx_state) {
       tx_state->arena()->AllocateBytesAligned(sizeof(ProbeStats) * num_ops,
                                               alignof(ProbeStats)));
 
+  // Manually run the constructors to clear the stats to 0 before collecting
+  // them.
+  for (int i = 0; i < num_ops; i++) {
+    new (&stats_array[i]) ProbeStats();
+  }
+
   StartApplying(tx_state);
+  Status s = BulkCheckPresence(tx_state->tablet_components(), tx_state, stats_array);
+  if (PREDICT_FALSE(!s.ok())) {
+    // The operations which weren't marked as checked will probe the rowsets
+    // themselves, and report any error on their own.
+    LOG_WITH_PREFIX(WARNING) << "Unable to check presence of keys in bulk: " << s.ToString();
+  }
   int i = 0;
   for (RowOp* row_op : tx_state->row_ops()) {
-    ProbeStats* stats = &stats_array[i++];
-    // Manually run the constructor to clear the stats to 0 before collecting
-    // them.
-    new (stats) ProbeStats();
-    ApplyRowOperation(tx_state, row_op, stats);
+    ApplyRowOperation(tx_state, row_op, &stats_array[i++]);
   }
 
   if (metrics_) {
@@ -676,21 +1038,50 @@ void Tablet::ModifyRowSetTree(const RowSetTree& old_tree,
   CHECK_OK(new_tree->Reset(post_swap));
 }
 
-void Tablet::AtomicSwapRowSets(const RowSetVector &old_rowsets,
-                               const RowSetVector &new_rowsets) {
-  std::lock_guard<rw_spinlock> lock(component_lock_);
-  AtomicSwapRowSetsUnlocked(old_rowsets, new_rowsets);
+void Tablet::PrepareRowSetSwap(const RowSetVector& to_remove,
+                               const RowSetVector& to_add,
+                               shared_ptr<MemRowSet> new_mrs,
+                               PreparedRowSetSwap* swap) const {
+  swap->to_remove = to_remove;
+  swap->to_add = to_add;
+  GetComponents(&swap->base);
+
+  shared_ptr<RowSetTree> new_tree(new RowSetTree());
+  ModifyRowSetTree(*swap->base->rowsets, to_remove, to_add, new_tree.get());
+  if (!new_mrs) {
+    new_mrs = swap->base->memrowset;
+  }
+  swap->swapped = new TabletComponents(std::move(new_mrs), std::move(new_tree));
 }
 
-void Tablet::AtomicSwapRowSetsUnlocked(const RowSetVector &to_remove,
-                                       const RowSetVector &to_add) {
+void Tablet::CommitRowSetSwapUnlocked(const PreparedRowSetSwap& swap) {
   DCHECK(component_lock_.is_locked());
 
+  if (PREDICT_TRUE(components_ == swap.base)) {
+    components_ = swap.swapped;
+    return;
+  }
+
+  // A concurrent flush or compaction swapped its own rowsets in since this
+  // swap was prepared. They are disjoint from ours, so the swap can be redone
+  // on top of the current components. Only flushes replace the MemRowSet, and
+  // they are serialized by rowsets_flush_sem_.
+  shared_ptr<MemRowSet> mrs = components_->memrowset;
+  if (swap.swapped->memrowset != swap.base->memrowset) {
+    DCHECK(mrs == swap.base->memrowset);
+    mrs = swap.swapped->memrowset;
+  }
   shared_ptr<RowSetTree> new_tree(new RowSetTree());
-  ModifyRowSetTree(*components_->rowsets,
-                   to_remove, to_add, new_tree.get());
+  ModifyRowSetTree(*components_->rowsets, swap.to_remove, swap.to_add, new_tree.get());
+  components_ = new TabletComponents(std::move(mrs), std::move(new_tree));
+}
 
-  components_ = new TabletComponents(components_->memrowset, new_tree);
+void Tablet::AtomicSwapRowSets(const RowSetVector &old_rowsets,
+                               const RowSetVector &new_rowsets) {
+  PreparedRowSetSwap swap;
+  PrepareRowSetSwap(old_rowsets, new_rowsets, nullptr, &swap);
+  std::lock_guard<percpu_rwlock> lock(component_lock_);
+  CommitRowSetSwapUnlocked(swap);
 }
 
 Status Tablet::DoMajorDeltaCompaction(const vector<ColumnId>& col_ids,
@@ -725,10 +1116,23 @@ bool Tablet::GetTabletAncientHistoryMark(Timestamp* ancient_history_mark) const
 
 HistoryGcOpts Tablet::GetHistoryGcOpts() const {
   Timestamp ancient_history_mark;
-  if (GetTabletAncientHistoryMark(&ancient_history_mark)) {
-    return HistoryGcOpts::Enabled(ancient_history_mark);
+  if (!GetTabletAncientHistoryMark(&ancient_history_mark)) {
+    return HistoryGcOpts::Disabled();
   }
-  return HistoryGcOpts::Disabled();
+  HistoryGcOpts opts = HistoryGcOpts::Enabled(ancient_history_mark);
+  const Schema* s = schema();
+  int ttl_col_idx;
+  int64_t expiry_cutoff_micros;
+  if (GetRowExpiry(*s, ancient_history_mark, &ttl_col_idx, &expiry_cutoff_micros)) {
+    return opts.WithRowExpiry(s->column_id(ttl_col_idx), expiry_cutoff_micros);
+  }
+  return opts;
+}
+
+bool Tablet::GetAncientRowExpiry(int* ttl_col_idx, int64_t* expiry_cutoff_micros) const {
+  Timestamp ancient_history_mark;
+  return GetTabletAncientHistoryMark(&ancient_history_mark) &&
+      GetRowExpiry(*schema(), ancient_history_mark, ttl_col_idx, expiry_cutoff_micros);
 }
 
 Status Tablet::Flush() {
@@ -743,8 +1147,10 @@ Status Tablet::FlushUnlocked() {
   shared_ptr<MemRowSet> old_mrs;
   {
     // Create a new MRS with the latest schema.
-    std::lock_guard<rw_spinlock> lock(component_lock_);
-    RETURN_NOT_OK(ReplaceMemRowSetUnlocked(&input, &old_mrs));
+    PreparedRowSetSwap swap;
+    RETURN_NOT_OK(PrepareMemRowSetReplacement(&input, &old_mrs, &swap));
+    std::lock_guard<percpu_rwlock> lock(component_lock_);
+    CommitRowSetSwapUnlocked(swap);
   }
 
   // Wait for any in-flight transactions to finish against the old MRS
@@ -755,9 +1161,13 @@ Status Tablet::FlushUnlocked() {
   return FlushInternal(input, old_mrs);
 }
 
-Status Tablet::ReplaceMemRowSetUnlocked(RowSetsInCompaction *compaction,
-                                        shared_ptr<MemRowSet> *old_ms) {
-  *old_ms = components_->memrowset;
+Status Tablet::PrepareMemRowSetReplacement(RowSetsInCompaction *compaction,
+                                           shared_ptr<MemRowSet> *old_ms,
+                                           PreparedRowSetSwap* swap) {
+  {
+    shared_lock<rw_spinlock> l(component_lock_.get_lock());
+    *old_ms = components_->memrowset;
+  }
   // Mark the memrowset rowset as locked, so compactions won't consider it
   // for inclusion in any concurrent compactions.
   std::unique_lock<std::mutex> ms_lock(*(*old_ms)->compact_flush_lock(), std::try_to_lock);
@@ -768,14 +1178,11 @@ Status Tablet::ReplaceMemRowSetUnlocked(RowSetsInCompaction *compaction,
 
   shared_ptr<MemRowSet> new_mrs(new MemRowSet(next_mrs_id_++, *schema(), log_anchor_registry_.get(),
                                 mem_tracker_));
-  shared_ptr<RowSetTree> new_rst(new RowSetTree());
-  ModifyRowSetTree(*components_->rowsets,
-                   RowSetVector(), // remove nothing
-                   { *old_ms }, // add the old MRS
-                   new_rst.get());
-
-  // Swap it in
-  components_ = new TabletComponents(new_mrs, new_rst);
+  PrepareRowSetSwap(RowSetVector(), // remove nothing
+                    { *old_ms }, // add the old MRS
+                    std::move(new_mrs),
+                    swap);
+  DCHECK(swap->base->memrowset == *old_ms);
   return Status::OK();
 }
 
@@ -815,9 +1222,12 @@ Status Tablet::FlushInternal(const RowSetsInCompaction& input,
 
   LOG_WITH_PREFIX(INFO) << "Flush: entering stage 1 (old memrowset already frozen for inserts)";
   input.DumpToLog();
-  LOG_WITH_PREFIX(INFO) << "Memstore in-memory size: " << old_ms->memory_footprint() << " bytes";
+  size_t flushed_bytes = old_ms->memory_footprint();
+  LOG_WITH_PREFIX(INFO) << "Memstore in-memory size: " << flushed_bytes << " bytes";
 
+  MonoTime start = MonoTime::Now();
   RETURN_NOT_OK(DoMergeCompactionOrFlush(input, mrs_being_flushed));
+  RecordFlushThroughput(flushed_bytes, MonoTime::Now() - start);
 
   // Sanity check that no insertions happened during our flush.
   CHECK_EQ(start_insert_count, old_ms->debug_insert_count())
@@ -898,7 +1308,7 @@ Status Tablet::RewindSchemaForBootstrap(const Schema& new_schema,
 
   metadata_->SetSchema(new_schema, schema_version);
   {
-    std::lock_guard<rw_spinlock> lock(component_lock_);
+    std::lock_guard<percpu_rwlock> lock(component_lock_);
 
     shared_ptr<MemRowSet> old_mrs = components_->memrowset;
     shared_ptr<RowSetTree> old_rowsets = components_->rowsets;
@@ -910,6 +1320,118 @@ Status Tablet::RewindSchemaForBootstrap(const Schema& new_schema,
   return Status::OK();
 }
 
+Status Tablet::CheckpointMemRowSet(const string& path, Timestamp timestamp) {
+  TRACE_EVENT1("tablet", "Tablet::CheckpointMemRowSet", "tablet_id", tablet_id());
+
+  // Alter schema swaps in a new MemRowSet while holding the schema lock
+  // exclusively, so this gets a MemRowSet consistent with the schema version.
+  scoped_refptr<TabletComponents> comps;
+  MemRowSetCheckpointPB header;
+  {
+    shared_lock<rw_semaphore> l(schema_lock_);
+    GetComponents(&comps);
+    header.set_schema_version(metadata_->schema_version());
+  }
+  const shared_ptr<MemRowSet>& mrs = comps->memrowset;
+  header.set_mrs_id(mrs->mrs_id());
+  header.set_timestamp(timestamp.ToUint64());
+  header.set_min_log_index(mrs->MinUnflushedLogIndex());
+
+  Env* env = metadata_->fs_manager()->env();
+  string tmp_path;
+  gscoped_ptr<RWFile> file;
+  RETURN_NOT_OK(env->NewTempRWFile(RWFileOptions(), path + ".tmp.XXXXXX", &tmp_path, &file));
+  env_util::ScopedFileDeleter tmp_deleter(env, tmp_path);
+
+  pb_util::WritablePBContainerFile writer(std::move(file));
+  RETURN_NOT_OK(writer.Init(header));
+  RETURN_NOT_OK(writer.Append(header));
+  RETURN_NOT_OK(mrs->WriteCheckpointRows(timestamp, &writer));
+  RETURN_NOT_OK(writer.Sync());
+  RETURN_NOT_OK(writer.Close());
+  RETURN_NOT_OK_PREPEND(env->RenameFile(tmp_path, path),
+                        "Failed to rename MemRowSet checkpoint to " + path);
+  tmp_deleter.Cancel();
+  RETURN_NOT_OK_PREPEND(env->SyncDir(DirName(path)),
+                        "Failed to SyncDir() parent of " + path);
+  VLOG_WITH_PREFIX(1) << "Checkpointed MemRowSet " << mrs->mrs_id()
+                      << " as of timestamp " << timestamp.ToString();
+  return Status::OK();
+}
+
+Status Tablet::LoadMemRowSetCheckpoint(const string& path, int64_t* mrs_id,
+                                       Timestamp* timestamp) {
+  CHECK_EQ(state_, kBootstrapping);
+  *mrs_id = -1;
+
+  Env* env = metadata_->fs_manager()->env();
+  if (!env->FileExists(path)) {
+    return Status::OK();
+  }
+  shared_ptr<MemRowSet> mrs = components_->memrowset;
+  CHECK(mrs->empty());
+
+  MemRowSetCheckpointPB header;
+  Status s = [&]() {
+    gscoped_ptr<RandomAccessFile> file;
+    RETURN_NOT_OK(env->NewRandomAccessFile(path, &file));
+    pb_util::ReadablePBContainerFile reader(std::move(file));
+    RETURN_NOT_OK(reader.Open());
+    RETURN_NOT_OK(reader.ReadNextPB(&header));
+    if (header.mrs_id() != mrs->mrs_id() ||
+        header.schema_version() != metadata_->schema_version()) {
+      // The checkpointed MemRowSet has since been flushed, or the log to
+      // replay begins with an older schema.
+      LOG_WITH_PREFIX(INFO) << "Ignoring checkpoint of MemRowSet " << header.mrs_id()
+                            << " with schema version " << header.schema_version();
+      header.Clear();
+      return Status::OK();
+    }
+    OpId op_id = consensus::MinimumOpId();
+    op_id.set_index(header.min_log_index());
+    MemRowSetCheckpointPB record;
+    while (true) {
+      Status read_status = reader.ReadNextPB(&record);
+      if (read_status.IsEndOfFile()) {
+        break;
+      }
+      RETURN_NOT_OK(read_status);
+      RETURN_NOT_OK(mrs->LoadCheckpointRows(record, op_id));
+    }
+    return reader.Close();
+  }();
+
+  if (!s.ok()) {
+    // Replay everything into a fresh MemRowSet instead.
+    LOG_WITH_PREFIX(WARNING) << "Unable to load MemRowSet checkpoint " << path << ": "
+                             << s.ToString();
+    std::lock_guard<percpu_rwlock> lock(component_lock_);
+    shared_ptr<MemRowSet> new_mrs(new MemRowSet(mrs->mrs_id(), mrs->schema(),
+                                                log_anchor_registry_.get(), mem_tracker_));
+    components_ = new TabletComponents(new_mrs, components_->rowsets);
+    return Status::OK();
+  }
+  if (header.has_timestamp()) {
+    *mrs_id = header.mrs_id();
+    *timestamp = Timestamp(header.timestamp());
+    LOG_WITH_PREFIX(INFO) << "Loaded " << mrs->entry_count() << " rows from checkpoint of "
+                          << "MemRowSet " << header.mrs_id() << " as of timestamp "
+                          << timestamp->ToString();
+  }
+  return Status::OK();
+}
+
+Status Tablet::DeleteMemRowSetCheckpoint(FsManager* fs_manager, const string& tablet_id) {
+  string path = fs_manager->GetTabletMrsCheckpointPath(tablet_id);
+  Env* env = fs_manager->env();
+  if (!env->FileExists(path)) {
+    return Status::OK();
+  }
+  RETURN_NOT_OK_PREPEND(env->DeleteFile(path),
+                        "Unable to delete MemRowSet checkpoint of tablet " + tablet_id);
+  return env->SyncDir(DirName(path));
+}
+
 void Tablet::SetCompactionHooksForTests(
   const shared_ptr<Tablet::CompactionFaultHooks> &hooks) {
   compaction_hooks_ = hooks;
@@ -926,7 +1448,7 @@ void Tablet::SetFlushCompactCommonHooksForTests(
 }
 
 int32_t Tablet::CurrentMrsIdForTests() const {
-  shared_lock<rw_spinlock> l(component_lock_);
+  shared_lock<rw_spinlock> l(component_lock_.get_lock());
   return components_->memrowset->mrs_id();
 }
 
@@ -937,6 +1459,96 @@ bool Tablet::ShouldThrottleAllow(int64_t bytes) {
   return throttler_->Take(MonoTime::Now(), 1, bytes);
 }
 
+// The backoff hints given to the clients of the writes rejected by admission
+// control, which grow with the pressure.
+static const int kMinWriteBackoffMs = 10;
+static const int kMaxWriteBackoffMs = 1000;
+
+// The growth of the MemRowSet is sampled at most this often.
+static const int kMrsGrowthSamplePeriodMs = 100;
+
+// Flushes smaller than this are dominated by fixed costs, so they don't tell
+// the flush throughput; nor are smaller MemRowSets worth rejecting writes for.
+static const size_t kMinFlushBacklogBytes = 64 * 1024 * 1024;
+
+// The weight of a new sample in the moving averages of rates.
+static const double kRateSampleWeight = 0.2;
+
+// Writes start being rejected once the WAL's append queue is this full.
+static const double kWalQueueMinRejectRatio = 0.5;
+
+static double UpdateMovingAverage(double avg, double sample) {
+  return avg == 0 ? sample : avg + kRateSampleWeight * (sample - avg);
+}
+
+bool Tablet::ShouldAdmitWrite(double wal_queue_fill_ratio, MonoDelta* retry_after) {
+  if (!FLAGS_tablet_write_admission_control) {
+    return true;
+  }
+  MonoTime now = MonoTime::Now();
+  std::lock_guard<simple_spinlock> l(admission_lock_);
+  if (!last_mrs_sample_time_.Initialized() ||
+      now - last_mrs_sample_time_ >= MonoDelta::FromMilliseconds(kMrsGrowthSamplePeriodMs)) {
+    SampleMrsGrowthUnlocked(now);
+  }
+
+  double wal_pressure = wal_queue_fill_ratio / kWalQueueMinRejectRatio;
+  double pressure = std::max(flush_backlog_pressure_, wal_pressure);
+  if (pressure <= 1) {
+    return true;
+  }
+  double reject_fraction = std::min(pressure - 1, 1.0);
+  if (admission_rng_.NextDoubleFraction() >= reject_fraction) {
+    return true;
+  }
+  *retry_after = MonoDelta::FromMilliseconds(
+      kMinWriteBackoffMs + (kMaxWriteBackoffMs - kMinWriteBackoffMs) * reject_fraction);
+  return false;
+}
+
+void Tablet::SampleMrsGrowthUnlocked(const MonoTime& now) {
+  DCHECK(admission_lock_.is_locked());
+  scoped_refptr<TabletComponents> comps;
+  GetComponents(&comps);
+  if (!comps) {
+    return;
+  }
+  int64_t mrs_id = comps->memrowset->mrs_id();
+  size_t mrs_size = comps->memrowset->memory_footprint();
+
+  // A flush swaps in a new MemRowSet, whose growth is measured afresh.
+  if (last_mrs_sample_time_.Initialized() && mrs_id == last_mrs_sample_id_ &&
+      mrs_size >= last_mrs_sample_size_) {
+    double secs = (now - last_mrs_sample_time_).ToSeconds();
+    if (secs > 0) {
+      mrs_growth_bytes_per_sec_ = UpdateMovingAverage(
+          mrs_growth_bytes_per_sec_, (mrs_size - last_mrs_sample_size_) / secs);
+    }
+  }
+  last_mrs_sample_time_ = now;
+  last_mrs_sample_id_ = mrs_id;
+  last_mrs_sample_size_ = mrs_size;
+
+  // The backlog only builds up while the MemRowSet grows faster than flushes
+  // write it out.
+  flush_backlog_pressure_ = 0;
+  if (mrs_size >= kMinFlushBacklogBytes && flush_bytes_per_sec_ > 0 &&
+      mrs_growth_bytes_per_sec_ > flush_bytes_per_sec_ &&
+      FLAGS_tablet_write_admission_max_flush_backlog_sec > 0) {
+    double backlog_secs = mrs_size / flush_bytes_per_sec_;
+    flush_backlog_pressure_ = backlog_secs / FLAGS_tablet_write_admission_max_flush_backlog_sec;
+  }
+}
+
+void Tablet::RecordFlushThroughput(size_t bytes, const MonoDelta& elapsed) {
+  if (bytes < kMinFlushBacklogBytes) {
+    return;
+  }
+  double secs = std::max(elapsed.ToSeconds(), 0.001);
+  std::lock_guard<simple_spinlock> l(admission_lock_);
+  flush_bytes_per_sec_ = UpdateMovingAverage(flush_bytes_per_sec_, bytes / secs);
+}
+
 ////////////////////////////////////////////////////////////
 // CompactRowSetsOp
 ////////////////////////////////////////////////////////////
@@ -1158,7 +1770,7 @@ Status Tablet::PickRowSetsToCompact(RowSetsInCompaction *picked,
   // in tablet.h for details on why that would be bad.
   shared_ptr<RowSetTree> rowsets_copy;
   {
-    shared_lock<rw_spinlock> l(component_lock_);
+    shared_lock<rw_spinlock> l(component_lock_.get_lock());
     rowsets_copy = components_->rowsets;
   }
 
@@ -1181,7 +1793,11 @@ Status Tablet::PickRowSetsToCompact(RowSetsInCompaction *picked,
     VLOG_WITH_PREFIX(2) << "Compaction quality: " << quality;
   }
 
-  shared_lock<rw_spinlock> l(component_lock_);
+  // The picked rowsets are about to become unavailable to other compactions,
+  // so the cached compaction quality no longer holds.
+  last_compaction_stats_tree_.reset();
+
+  shared_lock<rw_spinlock> l(component_lock_.get_lock());
   for (const shared_ptr<RowSet>& rs : components_->rowsets->all_rowsets()) {
     if (picked_set.erase(rs.get()) == 0) {
       // Not picked.
@@ -1218,7 +1834,7 @@ Status Tablet::PickRowSetsToCompact(RowSetsInCompaction *picked,
 void Tablet::GetRowSetsForTests(RowSetVector* out) {
   shared_ptr<RowSetTree> rowsets_copy;
   {
-    shared_lock<rw_spinlock> l(component_lock_);
+    shared_lock<rw_spinlock> l(component_lock_.get_lock());
     rowsets_copy = components_->rowsets;
   }
   for (const shared_ptr<RowSet>& rs : rowsets_copy->all_rowsets()) {
@@ -1230,6 +1846,13 @@ void Tablet::RegisterMaintenanceOps(MaintenanceManager* maint_mgr) {
   CHECK_EQ(state_, kOpen);
   DCHECK(maintenance_ops_.empty());
 
+  // The rowsets of a split tablet must not be compacted, since their blocks
+  // belong to the tablets it was split into.
+  if (metadata_->has_been_split()) {
+    LOG_WITH_PREFIX(INFO) << "Not registering maintenance ops of split tablet";
+    return;
+  }
+
   gscoped_ptr<MaintenanceOp> rs_compact_op(new CompactRowSetsOp(this));
   maint_mgr->RegisterOp(rs_compact_op.get());
   maintenance_ops_.push_back(rs_compact_op.release());
@@ -1241,6 +1864,14 @@ void Tablet::RegisterMaintenanceOps(MaintenanceManager* maint_mgr) {
   gscoped_ptr<MaintenanceOp> major_delta_compact_op(new MajorDeltaCompactionOp(this));
   maint_mgr->RegisterOp(major_delta_compact_op.get());
   maintenance_ops_.push_back(major_delta_compact_op.release());
+
+  gscoped_ptr<MaintenanceOp> undo_delta_block_gc_op(new UndoDeltaBlockGCOp(this));
+  maint_mgr->RegisterOp(undo_delta_block_gc_op.get());
+  maintenance_ops_.push_back(undo_delta_block_gc_op.release());
+
+  gscoped_ptr<MaintenanceOp> expired_rowset_gc_op(new ExpiredRowSetGCOp(this));
+  maint_mgr->RegisterOp(expired_rowset_gc_op.get());
+  maintenance_ops_.push_back(expired_rowset_gc_op.release());
 }
 
 void Tablet::UnregisterMaintenanceOps() {
@@ -1288,17 +1919,24 @@ Status Tablet::DoMergeCompactionOrFlush(const RowSetsInCompaction &input,
                           "PostTakeMvccSnapshot hook failed");
   }
 
-  shared_ptr<CompactionInput> merge;
-  RETURN_NOT_OK(input.CreateCompactionInput(flush_snap, schema(), &merge));
-
-  RollingDiskRowSetWriter drsw(metadata_.get(), merge->schema(), bloom_sizing(),
-                               compaction_policy_->target_rowset_size());
-  RETURN_NOT_OK_PREPEND(drsw.Open(), "Failed to open DiskRowSet for flush");
+  // Compactions of rowsets spanning a wide enough key range are split into
+  // key ranges which are merged and written out in parallel. Flushes have a
+  // single MemRowSet input, whose key range isn't known up front.
+  vector<string> split_keys;
+  if (mrs_being_flushed == TabletMetadata::kNoMrsFlushed) {
+    ChooseCompactionSplitKeys(input.rowsets(), FLAGS_tablet_compaction_parallelism,
+                              &split_keys);
+  }
 
   HistoryGcOpts history_gc_opts = GetHistoryGcOpts();
-  RETURN_NOT_OK_PREPEND(FlushCompactionInput(merge.get(), flush_snap, history_gc_opts, &drsw),
-                        "Flush to disk failed");
-  RETURN_NOT_OK_PREPEND(drsw.Finish(), "Failed to finish DRS writer");
+  RowSetMetadataVector new_drs_metas;
+  int64_t written_count = 0;
+  uint64_t written_size = 0;
+  bool evict_output = mrs_being_flushed == TabletMetadata::kNoMrsFlushed &&
+      FLAGS_tablet_compaction_evict_output_from_page_cache;
+  RETURN_NOT_OK(FlushCompactionInputRanges(input, flush_snap, history_gc_opts, evict_output,
+                                           split_keys, &new_drs_metas, &written_count,
+                                           &written_size));
 
   if (common_hooks_) {
     RETURN_NOT_OK_PREPEND(common_hooks_->PostWriteSnapshot(),
@@ -1307,7 +1945,7 @@ Status Tablet::DoMergeCompactionOrFlush(const RowSetsInCompaction &input,
 
   // Though unlikely, it's possible that all of the input rows were actually
   // GCed in this compaction. In that case, we don't actually want to reopen.
-  bool gced_all_input = drsw.written_count() == 0;
+  bool gced_all_input = written_count == 0;
   if (gced_all_input) {
     LOG_WITH_PREFIX(INFO) << op_name << " resulted in no output rows (all input rows "
                           << "were GCed!)  Removing all input rowsets.";
@@ -1317,10 +1955,16 @@ Status Tablet::DoMergeCompactionOrFlush(const RowSetsInCompaction &input,
   // The RollingDiskRowSet writer wrote out one or more RowSets as the
   // output. Open these into 'new_rowsets'.
   vector<shared_ptr<RowSet> > new_disk_rowsets;
-  RowSetMetadataVector new_drs_metas;
-  drsw.GetWrittenRowSetMetadata(&new_drs_metas);
-
-  if (metrics_.get()) metrics_->bytes_flushed->IncrementBy(drsw.written_size());
+  if (metrics_.get()) {
+    metrics_->bytes_flushed->IncrementBy(written_size);
+    if (mrs_being_flushed == TabletMetadata::kNoMrsFlushed) {
+      uint64_t read_size = 0;
+      for (const shared_ptr<RowSet>& rs : input.rowsets()) {
+        read_size += rs->EstimateOnDiskSize();
+      }
+      metrics_->compact_rs_bytes_read->IncrementBy(read_size);
+    }
+  }
   CHECK(!new_drs_metas.empty());
   {
     TRACE_EVENT0("tablet", "Opening compaction results");
@@ -1365,7 +2009,7 @@ Status Tablet::DoMergeCompactionOrFlush(const RowSetsInCompaction &input,
   LOG_WITH_PREFIX(INFO) << op_name << ": entering phase 2 (starting to duplicate updates "
                         << "in new rowsets)";
   shared_ptr<DuplicatingRowSet> inprogress_rowset(
-    new DuplicatingRowSet(input.rowsets(), new_disk_rowsets));
+    new DuplicatingRowSet(input.rowsets(), new_disk_rowsets, history_gc_opts.expires_rows()));
 
   // The next step is to swap in the DuplicatingRowSet, and at the same time, determine an
   // MVCC snapshot which includes all of the transactions that saw a pre-DuplicatingRowSet
@@ -1374,10 +2018,12 @@ Status Tablet::DoMergeCompactionOrFlush(const RowSetsInCompaction &input,
   vector<Timestamp> applying_during_swap;
   {
     TRACE_EVENT0("tablet", "Swapping DuplicatingRowSet");
+    PreparedRowSetSwap swap;
+    PrepareRowSetSwap(input.rowsets(), { inprogress_rowset }, nullptr, &swap);
     // Taking component_lock_ in write mode ensures that no new transactions
     // can StartApplying() (or snapshot components_) during this block.
-    std::lock_guard<rw_spinlock> lock(component_lock_);
-    AtomicSwapRowSetsUnlocked(input.rowsets(), { inprogress_rowset });
+    std::lock_guard<percpu_rwlock> lock(component_lock_);
+    CommitRowSetSwapUnlocked(swap);
 
     // NOTE: transactions may *commit* in between these two lines.
     // We need to make sure all such transactions end up in the
@@ -1420,6 +2066,7 @@ Status Tablet::DoMergeCompactionOrFlush(const RowSetsInCompaction &input,
   LOG_WITH_PREFIX(INFO) << op_name
                         << " Phase 2: carrying over any updates which arrived during Phase 1";
   LOG_WITH_PREFIX(INFO) << "Phase 2 snapshot: " << non_duplicated_txns_snap.ToString();
+  shared_ptr<CompactionInput> merge;
   RETURN_NOT_OK_PREPEND(
       input.CreateCompactionInput(non_duplicated_txns_snap, schema(), &merge),
           Substitute("Failed to create $0 inputs", op_name).c_str());
@@ -1461,8 +2108,8 @@ Status Tablet::DoMergeCompactionOrFlush(const RowSetsInCompaction &input,
   // their metadata was written to disk.
   AtomicSwapRowSets({ inprogress_rowset }, new_disk_rowsets);
 
-  LOG_WITH_PREFIX(INFO) << op_name << " successful on " << drsw.written_count()
-                        << " rows " << "(" << drsw.written_size() << " bytes)";
+  LOG_WITH_PREFIX(INFO) << op_name << " successful on " << written_count
+                        << " rows " << "(" << written_size << " bytes)";
 
   if (common_hooks_) {
     RETURN_NOT_OK_PREPEND(common_hooks_->PostSwapNewRowSet(),
@@ -1472,6 +2119,106 @@ Status Tablet::DoMergeCompactionOrFlush(const RowSetsInCompaction &input,
   return Status::OK();
 }
 
+Status Tablet::FlushCompactionInputRange(const RowSetsInCompaction& input,
+                                         const MvccSnapshot& snap,
+                                         const HistoryGcOpts& history_gc_opts,
+                                         bool evict_output,
+                                         const EncodedKey* lower_bound,
+                                         const EncodedKey* exclusive_upper_bound,
+                                         RowSetMetadataVector* new_drs_metas,
+                                         int64_t* written_count,
+                                         uint64_t* written_size) {
+  shared_ptr<CompactionInput> merge;
+  RETURN_NOT_OK(input.CreateCompactionInput(snap, schema(), lower_bound,
+                                            exclusive_upper_bound, &merge));
+
+  RollingDiskRowSetWriter drsw(metadata_.get(), merge->schema(), bloom_sizing(),
+                               compaction_policy_->target_rowset_size());
+  drsw.set_evict_from_page_cache(evict_output);
+  RETURN_NOT_OK_PREPEND(drsw.Open(), "Failed to open DiskRowSet for flush");
+
+  RETURN_NOT_OK_PREPEND(FlushCompactionInput(merge.get(), snap, history_gc_opts, &drsw),
+                        "Flush to disk failed");
+  RETURN_NOT_OK_PREPEND(drsw.Finish(), "Failed to finish DRS writer");
+
+  drsw.GetWrittenRowSetMetadata(new_drs_metas);
+  *written_count = drsw.written_count();
+  *written_size = drsw.written_size();
+  return Status::OK();
+}
+
+Status Tablet::FlushCompactionInputRanges(const RowSetsInCompaction& input,
+                                          const MvccSnapshot& snap,
+                                          const HistoryGcOpts& history_gc_opts,
+                                          bool evict_output,
+                                          const vector<string>& split_keys,
+                                          RowSetMetadataVector* new_drs_metas,
+                                          int64_t* written_count,
+                                          uint64_t* written_size) {
+  if (split_keys.empty()) {
+    return FlushCompactionInputRange(input, snap, history_gc_opts, evict_output,
+                                     nullptr, nullptr, new_drs_metas, written_count,
+                                     written_size);
+  }
+
+  // Range i covers the keys in [bounds[i - 1], bounds[i]), where the outermost
+  // ranges are unbounded on their outer side.
+  Arena arena(1024, 1024 * 1024);
+  vector<unique_ptr<EncodedKey>> bounds;
+  for (const string& split_key : split_keys) {
+    gscoped_ptr<EncodedKey> key;
+    RETURN_NOT_OK(EncodedKey::DecodeEncodedString(*schema(), &arena, split_key, &key));
+    bounds.emplace_back(key.release());
+  }
+  const int num_ranges = bounds.size() + 1;
+  LOG_WITH_PREFIX(INFO) << "Compaction: splitting into " << num_ranges << " key ranges";
+
+  struct RangeOutput {
+    Status status;
+    RowSetMetadataVector metas;
+    int64_t written_count = 0;
+    uint64_t written_size = 0;
+  };
+  vector<RangeOutput> outputs(num_ranges);
+  auto flush_range = [&](int i) {
+    RangeOutput* out = &outputs[i];
+    out->status = FlushCompactionInputRange(
+        input, snap, history_gc_opts, evict_output,
+        i == 0 ? nullptr : bounds[i - 1].get(),
+        i == num_ranges - 1 ? nullptr : bounds[i].get(),
+        &out->metas, &out->written_count, &out->written_size);
+  };
+
+  // Hand all but the first range to the shared pool, and do the first one on
+  // this thread while waiting for the others.
+  CountDownLatch latch(num_ranges - 1);
+  for (int i = 1; i < num_ranges; i++) {
+    Status s = CompactionPool()->SubmitFunc([&flush_range, &latch, i]() {
+        flush_range(i);
+        latch.CountDown();
+      });
+    if (!s.ok()) {
+      outputs[i].status = s;
+      latch.CountDown();
+    }
+  }
+  flush_range(0);
+  latch.Wait();
+
+  // The ranges are in key order, so concatenating their outputs yields
+  // non-overlapping rowsets in ascending key order, as if a single writer had
+  // written them.
+  *written_count = 0;
+  *written_size = 0;
+  for (RangeOutput& out : outputs) {
+    RETURN_NOT_OK(out.status);
+    new_drs_metas->insert(new_drs_metas->end(), out.metas.begin(), out.metas.end());
+    *written_count += out.written_count;
+    *written_size += out.written_size;
+  }
+  return Status::OK();
+}
+
 Status Tablet::HandleEmptyCompactionOrFlush(const RowSetVector& rowsets,
                                             int mrs_being_flushed) {
   // Write out the new Tablet Metadata and remove old rowsets.
@@ -1514,14 +2261,25 @@ void Tablet::UpdateCompactionStats(MaintenanceOpStats* stats) {
 
   shared_ptr<RowSetTree> rowsets_copy;
   {
-    shared_lock<rw_spinlock> l(component_lock_);
+    shared_lock<rw_spinlock> l(component_lock_.get_lock());
     rowsets_copy = components_->rowsets;
   }
 
   {
     std::lock_guard<std::mutex> compact_lock(compact_select_lock_);
-    WARN_NOT_OK(compaction_policy_->PickRowSets(*rowsets_copy, &picked_set_ignored, &quality, NULL),
-                Substitute("Couldn't determine compaction quality for $0", tablet_id()));
+    MonoTime now = MonoTime::Now();
+    if (last_compaction_stats_tree_.lock() == rowsets_copy &&
+        now < last_compaction_stats_time_ +
+              MonoDelta::FromMilliseconds(FLAGS_tablet_compaction_stats_cache_ms)) {
+      quality = last_compaction_stats_quality_;
+    } else {
+      WARN_NOT_OK(compaction_policy_->PickRowSets(*rowsets_copy, &picked_set_ignored,
+                                                  &quality, NULL),
+                  Substitute("Couldn't determine compaction quality for $0", tablet_id()));
+      last_compaction_stats_tree_ = rowsets_copy;
+      last_compaction_stats_time_ = now;
+      last_compaction_stats_quality_ = quality;
+    }
   }
 
   VLOG_WITH_PREFIX(1) << "Best compaction for " << tablet_id() << ": " << quality;
@@ -1532,15 +2290,16 @@ void Tablet::UpdateCompactionStats(MaintenanceOpStats* stats) {
 
 
 Status Tablet::DebugDump(vector<string> *lines) {
-  shared_lock<rw_spinlock> l(component_lock_);
+  scoped_refptr<TabletComponents> comps;
+  GetComponents(&comps);
 
   LOG_STRING(INFO, lines) << "Dumping tablet:";
   LOG_STRING(INFO, lines) << "---------------------------";
 
-  LOG_STRING(INFO, lines) << "MRS " << components_->memrowset->ToString() << ":";
-  RETURN_NOT_OK(components_->memrowset->DebugDump(lines));
+  LOG_STRING(INFO, lines) << "MRS " << comps->memrowset->ToString() << ":";
+  RETURN_NOT_OK(comps->memrowset->DebugDump(lines));
 
-  for (const shared_ptr<RowSet> &rs : components_->rowsets->all_rowsets()) {
+  for (const shared_ptr<RowSet> &rs : comps->rowsets->all_rowsets()) {
     LOG_STRING(INFO, lines) << "RowSet " << rs->ToString() << ":";
     RETURN_NOT_OK(rs->DebugDump(lines));
   }
@@ -1548,12 +2307,26 @@ Status Tablet::DebugDump(vector<string> *lines) {
   return Status::OK();
 }
 
+// Returns false if the scan described by 'spec' can skip the rowset 'rs'.
+static bool MayMatchPredicates(const RowSet& rs, const ScanSpec& spec) {
+  if (!FLAGS_tablet_prune_rowsets_by_column_stats || rs.MayMatchPredicates(spec)) {
+    return true;
+  }
+  VLOG(2) << "Pruned rowset " << rs.ToString() << " by its column statistics";
+  TRACE_COUNTER_INCREMENT(kRowSetsPrunedByColumnStatsTraceCounter, 1);
+  return false;
+}
+
 Status Tablet::CaptureConsistentIterators(
   const Schema *projection,
   const MvccSnapshot &snap,
   const ScanSpec *spec,
-  vector<shared_ptr<RowwiseIterator> > *iters) const {
-  shared_lock<rw_spinlock> l(component_lock_);
+  vector<shared_ptr<RowwiseIterator> > *iters,
+  StoredChecksums* checksums) const {
+  // Capture the iterators from a snapshot of the components, so that
+  // concurrent flushes and compactions aren't blocked while they are created.
+  scoped_refptr<TabletComponents> comps;
+  GetComponents(&comps);
 
   // Construct all the iterators locally first, so that if we fail
   // in the middle, we don't modify the output arguments.
@@ -1561,40 +2334,55 @@ Status Tablet::CaptureConsistentIterators(
 
   // Grab the memrowset iterator.
   gscoped_ptr<RowwiseIterator> ms_iter;
-  RETURN_NOT_OK(components_->memrowset->NewRowIterator(projection, snap, &ms_iter));
+  RETURN_NOT_OK(comps->memrowset->NewRowIterator(projection, snap, &ms_iter));
   ret.push_back(shared_ptr<RowwiseIterator>(ms_iter.release()));
 
   // Cull row-sets in the case of key-range queries.
   if (spec != nullptr && spec->lower_bound_key() && spec->exclusive_upper_bound_key()) {
+    DCHECK(checksums == nullptr);
     // TODO : support open-ended intervals
     // TODO: the upper bound key is exclusive, but the RowSetTree function takes
     // an inclusive interval. So, we might end up fetching one more rowset than
     // necessary.
     vector<RowSet *> interval_sets;
-    components_->rowsets->FindRowSetsIntersectingInterval(
+    comps->rowsets->FindRowSetsIntersectingInterval(
         spec->lower_bound_key()->encoded_key(),
         spec->exclusive_upper_bound_key()->encoded_key(),
         &interval_sets);
+    TRACE_COUNTER_INCREMENT(kRowSetsPrunedByKeyRangeTraceCounter,
+                            comps->rowsets->all_rowsets().size() - interval_sets.size());
     for (const RowSet *rs : interval_sets) {
+      if (!MayMatchPredicates(*rs, *spec)) {
+        continue;
+      }
       gscoped_ptr<RowwiseIterator> row_it;
       RETURN_NOT_OK_PREPEND(rs->NewRowIterator(projection, snap, &row_it),
                             Substitute("Could not create iterator for rowset $0",
                                        rs->ToString()));
       ret.push_back(shared_ptr<RowwiseIterator>(row_it.release()));
     }
+    TRACE_COUNTER_INCREMENT(kRowSetsScannedTraceCounter, ret.size() - 1);
     ret.swap(*iters);
     return Status::OK();
   }
 
   // If there are no encoded predicates or they represent an open-ended range, then
   // fall back to grabbing all rowset iterators
-  for (const shared_ptr<RowSet> &rs : components_->rowsets->all_rowsets()) {
+  for (const shared_ptr<RowSet> &rs : comps->rowsets->all_rowsets()) {
+    if (spec != nullptr && !MayMatchPredicates(*rs, *spec)) {
+      continue;
+    }
+    if (checksums != nullptr && rs->AddStoredChecksum(*projection, snap, checksums)) {
+      TRACE_COUNTER_INCREMENT("rowsets_with_stored_checksums", 1);
+      continue;
+    }
     gscoped_ptr<RowwiseIterator> row_it;
     RETURN_NOT_OK_PREPEND(rs->NewRowIterator(projection, snap, &row_it),
                           Substitute("Could not create iterator for rowset $0",
                                      rs->ToString()));
     ret.push_back(shared_ptr<RowwiseIterator>(row_it.release()));
   }
+  TRACE_COUNTER_INCREMENT(kRowSetsScannedTraceCounter, ret.size() - 1);
 
   // Swap results into the parameters.
   ret.swap(*iters);
@@ -1656,6 +2444,253 @@ size_t Tablet::EstimateOnDiskSize() const {
   return ret;
 }
 
+void Tablet::SplitKeyRange(const Slice* start_key,
+                           const Slice* stop_key,
+                           uint64_t target_chunk_size,
+                           vector<string>* split_keys) const {
+  scoped_refptr<TabletComponents> comps;
+  GetComponents(&comps);
+  if (!comps) return;
+
+  // The distinct rowset bounds, in order, and the rowsets' spans over the
+  // intervals between them. Only the lower bounds of rowsets are used as
+  // split keys, so that the rows of a rowset aren't split off its upper bound.
+  vector<Slice> bounds;
+  vector<bool> is_lower_bound;
+  unordered_map<RowSet*, pair<int, int>> spans;
+  for (const RowSetTree::RSEndpoint& ep : comps->rowsets->key_endpoints()) {
+    if (bounds.empty() || bounds.back() != ep.slice_) {
+      bounds.push_back(ep.slice_);
+      is_lower_bound.push_back(false);
+    }
+    int idx = bounds.size() - 1;
+    if (ep.endpoint_ == RowSetTree::START) {
+      spans[ep.rowset_].first = idx;
+      is_lower_bound[idx] = true;
+    } else {
+      spans[ep.rowset_].second = idx;
+    }
+  }
+  if (bounds.size() < 2) return;
+
+  // interval_bytes[i] is the estimated size of [bounds[i], bounds[i + 1]),
+  // computed from per-interval density deltas.
+  vector<double> interval_bytes(bounds.size(), 0);
+  for (const auto& e : spans) {
+    int begin = e.second.first;
+    int num_intervals = std::max(1, e.second.second - begin);
+    double density = static_cast<double>(e.first->EstimateOnDiskSize()) / num_intervals;
+    interval_bytes[begin] += density;
+    if (begin + num_intervals < interval_bytes.size()) {
+      interval_bytes[begin + num_intervals] -= density;
+    }
+  }
+  for (int i = 1; i < interval_bytes.size(); i++) {
+    interval_bytes[i] += interval_bytes[i - 1];
+  }
+
+  double chunk_bytes = 0;
+  for (int i = 0; i < bounds.size() - 1; i++) {
+    const Slice& lower = bounds[i];
+    const Slice& upper = bounds[i + 1];
+    if (stop_key && lower.compare(*stop_key) >= 0) {
+      break;
+    }
+    if (start_key && upper.compare(*start_key) <= 0) {
+      continue;
+    }
+    if (chunk_bytes >= target_chunk_size && is_lower_bound[i] &&
+        (!start_key || lower.compare(*start_key) > 0)) {
+      split_keys->push_back(lower.ToString());
+      chunk_bytes = 0;
+    }
+    chunk_bytes += interval_bytes[i];
+  }
+}
+
+Status Tablet::Split(const string& left_tablet_id,
+                     const string& right_tablet_id,
+                     string* split_partition_key,
+                     vector<RowSetDataPB>* left_rowsets,
+                     vector<RowSetDataPB>* right_rowsets) {
+  TRACE_EVENT1("tablet", "Tablet::Split", "tablet_id", tablet_id());
+  DCHECK(maintenance_ops_.empty());
+  const PartitionSchema& partition_schema = metadata_->partition_schema();
+  if (!partition_schema.RangeKeyIsPrimaryKeyPrefix(*schema())) {
+    return Status::NotSupported("The range partition columns are not a prefix of the "
+                                "primary key");
+  }
+
+  // Taking the schema lock exclusively waits for the writes in flight to be
+  // applied, and blocks new ones until the split is recorded.
+  std::lock_guard<rw_semaphore> l(schema_lock_);
+  scoped_refptr<TabletComponents> comps;
+  vector<string> child_ids;
+  bool already_split = metadata_->GetSplit(split_partition_key, &child_ids);
+  if (already_split) {
+    // Writes have been failing since the split, so there's nothing to flush.
+    if (child_ids != vector<string>({ left_tablet_id, right_tablet_id })) {
+      return Status::IllegalState("Tablet has already been split into other tablets",
+                                  JoinStrings(child_ids, ", "));
+    }
+    GetComponents(&comps);
+  } else {
+    RETURN_NOT_OK(Flush());
+    GetComponents(&comps);
+    for (const shared_ptr<RowSet>& rs : comps->rowsets->all_rowsets()) {
+      RETURN_NOT_OK(rs->FlushDeltas());
+    }
+    DCHECK(comps->memrowset->empty());
+    RETURN_NOT_OK(PickSplitPartitionKey(*comps.get(), split_partition_key));
+  }
+
+  for (const shared_ptr<RowSet>& rs : comps->rowsets->all_rowsets()) {
+    string min_key;
+    string max_key;
+    RETURN_NOT_OK(rs->GetBounds(&min_key, &max_key));
+    string min_partition_key;
+    RETURN_NOT_OK(PartitionKeyForEncodedKey(min_key, &min_partition_key));
+    vector<RowSetDataPB>* rowsets = min_partition_key >= *split_partition_key ? right_rowsets
+                                                                              : left_rowsets;
+    rowsets->emplace_back();
+    rs->metadata()->ToProtobuf(&rowsets->back());
+  }
+  if (!already_split) {
+    RETURN_NOT_OK(metadata_->SetSplitAndFlush(*split_partition_key,
+                                              { left_tablet_id, right_tablet_id }));
+  }
+  LOG_WITH_PREFIX(INFO) << "Split into " << left_tablet_id << " (" << left_rowsets->size()
+                        << " rowsets) and " << right_tablet_id << " ("
+                        << right_rowsets->size() << " rowsets) at "
+                        << partition_schema.PartitionKeyDebugString(*split_partition_key,
+                                                                    *schema());
+  return Status::OK();
+}
+
+Status Tablet::PartitionKeyForEncodedKey(const Slice& encoded_key, string* partition_key) const {
+  Arena arena(256, 4096);
+  gscoped_ptr<uint8_t[]> row_buf(new uint8_t[key_schema_.key_byte_size()]);
+  RETURN_NOT_OK(key_schema_.DecodeRowKey(encoded_key, row_buf.get(), &arena));
+  partition_key->clear();
+  return metadata_->partition_schema().EncodeKey(ConstContiguousRow(&key_schema_, row_buf.get()),
+                                                 partition_key);
+}
+
+Status Tablet::PickSplitPartitionKey(const TabletComponents& comps,
+                                     string* split_partition_key) const {
+  uint64_t total_bytes = 0;
+  for (const shared_ptr<RowSet>& rs : comps.rowsets->all_rowsets()) {
+    total_bytes += rs->EstimateOnDiskSize();
+  }
+
+  // Sweep the rowset bounds in key order. A lower bound at which no rowset
+  // is open splits the rowsets in two, provided its partition key is above
+  // that of the upper bound before it.
+  int num_open = 0;
+  uint64_t closed_bytes = 0;
+  bool has_upper = false;
+  Slice last_upper;
+  uint64_t best_distance = std::numeric_limits<uint64_t>::max();
+  for (const RowSetTree::RSEndpoint& ep : comps.rowsets->key_endpoints()) {
+    if (ep.endpoint_ == RowSetTree::STOP) {
+      num_open--;
+      closed_bytes += ep.rowset_->EstimateOnDiskSize();
+      last_upper = ep.slice_;
+      has_upper = true;
+      continue;
+    }
+    if (num_open++ > 0 || !has_upper) {
+      continue;
+    }
+    string lower_key;
+    string upper_key;
+    RETURN_NOT_OK(PartitionKeyForEncodedKey(ep.slice_, &lower_key));
+    RETURN_NOT_OK(PartitionKeyForEncodedKey(last_upper, &upper_key));
+    if (upper_key >= lower_key) {
+      continue;
+    }
+    uint64_t left_bytes = closed_bytes * 2;
+    uint64_t distance = left_bytes > total_bytes ? left_bytes - total_bytes
+                                                 : total_bytes - left_bytes;
+    if (distance < best_distance) {
+      best_distance = distance;
+      *split_partition_key = lower_key;
+    }
+  }
+  if (best_distance == std::numeric_limits<uint64_t>::max()) {
+    return Status::IllegalState(
+        Substitute("None of the boundaries between the $0 rowsets falls on a change of the "
+                   "range partition key", comps.rowsets->all_rowsets().size()));
+  }
+  return Status::OK();
+}
+
+Status Tablet::LookupRows(const Schema& projection,
+                          const vector<Slice>& encoded_keys,
+                          const std::function<void(const RowBlock&)>& visitor) const {
+  shared_ptr<const Schema> mapped_projection_ptr;
+  RETURN_NOT_OK(GetMappedReadProjection(projection, &mapped_projection_ptr));
+  const Schema& mapped_projection = *mapped_projection_ptr;
+
+  MvccSnapshot snap(mvcc_);
+  scoped_refptr<TabletComponents> comps;
+  GetComponents(&comps);
+
+  Arena key_arena(256, 4 * 1024);
+  Arena block_arena(1024, 1024 * 1024);
+  // A key matches at most a single row.
+  RowBlock block(mapped_projection, 1, &block_arena);
+  ProbeStats stats;
+  for (const Slice& encoded_key : encoded_keys) {
+    key_arena.Reset();
+    block_arena.Reset();
+
+    uint8_t* key_buf = static_cast<uint8_t*>(key_arena.AllocateBytes(key_schema_.key_byte_size()));
+    RETURN_NOT_OK(key_schema_.DecodeRowKey(encoded_key, key_buf, &key_arena));
+    ConstContiguousRow row_key(&key_schema_, key_buf);
+    RowSetKeyProbe probe(row_key);
+
+    // A live row is in a single rowset, which is either the MemRowSet or
+    // one of the rowsets whose bounds contain the key.
+    vector<RowSet*> to_check;
+    to_check.push_back(comps->memrowset.get());
+    comps->rowsets->FindRowSetsWithKeyInRange(probe.encoded_key_slice(), &to_check);
+    RowSet* found = nullptr;
+    for (RowSet* rs : to_check) {
+      bool present = false;
+      RETURN_NOT_OK(rs->CheckRowPresent(probe, &present, &stats));
+      if (present) {
+        found = rs;
+        break;
+      }
+    }
+    if (!found) {
+      continue;
+    }
+
+    gscoped_ptr<EncodedKey> lower_bound = EncodedKey::FromContiguousRow(row_key);
+    gscoped_ptr<EncodedKey> upper_bound = EncodedKey::FromContiguousRow(row_key);
+    ScanSpec spec;
+    spec.SetLowerBoundKey(lower_bound.get());
+    // Only the greatest possible key can't be incremented, and then the
+    // scan needs no upper bound.
+    if (EncodedKey::IncrementEncodedKey(key_schema_, &upper_bound, &key_arena).ok()) {
+      spec.SetExclusiveUpperBoundKey(upper_bound.get());
+    }
+
+    gscoped_ptr<RowwiseIterator> iter;
+    RETURN_NOT_OK(found->NewRowIterator(&mapped_projection, snap, &iter));
+    RETURN_NOT_OK(iter->Init(&spec));
+    while (iter->HasNext()) {
+      RETURN_NOT_OK(iter->NextBlock(&block));
+      if (block.selection_vector()->AnySelected()) {
+        visitor(block);
+      }
+    }
+  }
+  return Status::OK();
+}
+
 size_t Tablet::DeltaMemStoresSize() const {
   scoped_refptr<TabletComponents> comps;
   GetComponents(&comps);
@@ -1823,15 +2858,171 @@ double Tablet::GetPerfImprovementForBestDeltaCompactUnlocked(RowSet::DeltaCompac
   return worst_delta_perf;
 }
 
+int64_t Tablet::EstimateBytesInPotentiallyAncientUndoDeltas() {
+  Timestamp ancient_history_mark;
+  if (!GetTabletAncientHistoryMark(&ancient_history_mark)) {
+    return 0;
+  }
+  scoped_refptr<TabletComponents> comps;
+  GetComponents(&comps);
+  int64_t bytes = 0;
+  for (const shared_ptr<RowSet>& rowset : comps->rowsets->all_rowsets()) {
+    if (!rowset->IsAvailableForCompaction()) {
+      continue;
+    }
+    bytes += down_cast<DiskRowSet*>(rowset.get())->delta_tracker()
+        ->EstimateBytesInPotentiallyAncientUndoDeltas(ancient_history_mark);
+  }
+  return bytes;
+}
+
+Status Tablet::DeleteAncientUndoDeltas() {
+  CHECK_EQ(state_, kOpen);
+  Timestamp ancient_history_mark;
+  if (!GetTabletAncientHistoryMark(&ancient_history_mark)) {
+    return Status::OK();
+  }
+  MonoTime start = MonoTime::Now();
+  scoped_refptr<TabletComponents> comps;
+  GetComponents(&comps);
+  int64_t blocks_deleted = 0;
+  int64_t bytes_deleted = 0;
+  for (const shared_ptr<RowSet>& rowset : comps->rowsets->all_rowsets()) {
+    // We're required to grab the rowset's compact_flush_lock under the
+    // compact_select_lock_, but only need the latter while selecting.
+    std::unique_lock<std::mutex> lock;
+    {
+      std::lock_guard<std::mutex> compact_lock(compact_select_lock_);
+      if (!rowset->IsAvailableForCompaction()) {
+        continue;
+      }
+      lock = std::unique_lock<std::mutex>(*rowset->compact_flush_lock(), std::try_to_lock);
+      if (!lock.owns_lock()) {
+        continue;
+      }
+    }
+    RETURN_NOT_OK_PREPEND(down_cast<DiskRowSet*>(rowset.get())->delta_tracker()
+                              ->DeleteAncientUndoDeltas(ancient_history_mark,
+                                                        &blocks_deleted, &bytes_deleted),
+                          "Unable to delete ancient UNDO deltas of " + rowset->ToString());
+  }
+  if (metrics_) {
+    metrics_->undo_delta_block_gc_bytes_deleted->IncrementBy(bytes_deleted);
+  }
+  if (blocks_deleted > 0) {
+    LOG_WITH_PREFIX(INFO) << "Deleted " << blocks_deleted << " ancient UNDO delta blocks ("
+                          << bytes_deleted << " bytes) in "
+                          << (MonoTime::Now() - start).ToString();
+  }
+  return Status::OK();
+}
+
+bool Tablet::GetRowExpiry(const Schema& schema, Timestamp as_of, int* ttl_col_idx,
+                          int64_t* expiry_cutoff_micros) {
+  int idx = schema.find_ttl_column();
+  if (idx == Schema::kColumnNotFound) {
+    return false;
+  }
+  const int64_t ttl_seconds = schema.column(idx).attributes().ttl_seconds;
+  const int64_t as_of_micros = HybridClock::GetPhysicalValueMicros(as_of);
+  *ttl_col_idx = idx;
+  // Nothing expires under a TTL longer than the epoch is old, and computing
+  // the cutoff for one could overflow.
+  if (ttl_seconds > as_of_micros / 1000000) {
+    *expiry_cutoff_micros = std::numeric_limits<int64_t>::min();
+  } else {
+    *expiry_cutoff_micros = as_of_micros - ttl_seconds * 1000000;
+  }
+  return true;
+}
+
+// Returns true if all of the rows of 'rs' have expired, i.e. if its column
+// statistics show that none of its rows matches 'unexpired', the spec which
+// selects the rows which haven't.
+static bool IsExpiredRowSet(const shared_ptr<RowSet>& rs, const ScanSpec& unexpired) {
+  return rs->metadata() != nullptr && !rs->MayMatchPredicates(unexpired);
+}
+
+int64_t Tablet::EstimateBytesInExpiredRowSets() {
+  int ttl_col_idx;
+  int64_t expiry_cutoff_micros;
+  if (!GetAncientRowExpiry(&ttl_col_idx, &expiry_cutoff_micros)) {
+    return 0;
+  }
+  ScanSpec unexpired;
+  unexpired.AddPredicate(ColumnPredicate::Range(schema()->column(ttl_col_idx),
+                                                &expiry_cutoff_micros, nullptr));
+  scoped_refptr<TabletComponents> comps;
+  GetComponents(&comps);
+  int64_t bytes = 0;
+  for (const shared_ptr<RowSet>& rowset : comps->rowsets->all_rowsets()) {
+    if (rowset->IsAvailableForCompaction() && IsExpiredRowSet(rowset, unexpired)) {
+      bytes += rowset->EstimateOnDiskSize();
+    }
+  }
+  return bytes;
+}
+
+Status Tablet::DeleteExpiredRowSets() {
+  CHECK_EQ(state_, kOpen);
+  int ttl_col_idx;
+  int64_t expiry_cutoff_micros;
+  if (!GetAncientRowExpiry(&ttl_col_idx, &expiry_cutoff_micros)) {
+    return Status::OK();
+  }
+  ScanSpec unexpired;
+  unexpired.AddPredicate(ColumnPredicate::Range(schema()->column(ttl_col_idx),
+                                                &expiry_cutoff_micros, nullptr));
+
+  MonoTime start = MonoTime::Now();
+  scoped_refptr<TabletComponents> comps;
+  GetComponents(&comps);
+  RowSetVector expired;
+  vector<std::unique_lock<std::mutex>> locks;
+  int64_t bytes_deleted = 0;
+  {
+    // As for a compaction, the rowsets' compact_flush_locks are taken under
+    // the compact_select_lock_ and held until they're swapped out.
+    std::lock_guard<std::mutex> compact_lock(compact_select_lock_);
+    for (const shared_ptr<RowSet>& rowset : comps->rowsets->all_rowsets()) {
+      if (!rowset->IsAvailableForCompaction() || !IsExpiredRowSet(rowset, unexpired)) {
+        continue;
+      }
+      std::unique_lock<std::mutex> lock(*rowset->compact_flush_lock(), std::try_to_lock);
+      if (!lock.owns_lock()) {
+        continue;
+      }
+      bytes_deleted += rowset->EstimateOnDiskSize();
+      expired.push_back(rowset);
+      locks.push_back(std::move(lock));
+    }
+  }
+  if (expired.empty()) {
+    return Status::OK();
+  }
+
+  // Updates to the rows of these rowsets may still be racing with their
+  // removal, but they're updates to expired rows, which may be lost.
+  RETURN_NOT_OK_PREPEND(HandleEmptyCompactionOrFlush(expired, TabletMetadata::kNoMrsFlushed),
+                        "Unable to delete expired rowsets");
+  if (metrics_) {
+    metrics_->expired_rowset_gc_bytes_deleted->IncrementBy(bytes_deleted);
+  }
+  LOG_WITH_PREFIX(INFO) << "Deleted " << expired.size() << " rowsets whose rows had all "
+                        << "expired (" << bytes_deleted << " bytes) in "
+                        << (MonoTime::Now() - start).ToString();
+  return Status::OK();
+}
+
 size_t Tablet::num_rowsets() const {
-  shared_lock<rw_spinlock> l(component_lock_);
+  shared_lock<rw_spinlock> l(component_lock_.get_lock());
   return components_->rowsets->all_rowsets().size();
 }
 
 void Tablet::PrintRSLayout(ostream* o) {
   shared_ptr<RowSetTree> rowsets_copy;
   {
-    shared_lock<rw_spinlock> l(component_lock_);
+    shared_lock<rw_spinlock> l(component_lock_.get_lock());
     rowsets_copy = components_->rowsets;
   }
   std::lock_guard<std::mutex> compact_lock(compact_select_lock_);
@@ -1879,22 +3070,24 @@ Tablet::Iterator::Iterator(const Tablet* tablet, const Schema& projection,
     : tablet_(tablet),
       projection_(projection),
       snap_(std::move(snap)),
-      order_(order) {}
+      order_(order),
+      stored_checksums_(nullptr) {}
 
 Tablet::Iterator::~Iterator() {}
 
 Status Tablet::Iterator::Init(ScanSpec *spec) {
   DCHECK(iter_.get() == nullptr);
 
-  RETURN_NOT_OK(tablet_->GetMappedReadProjection(projection_, &projection_));
+  RETURN_NOT_OK(tablet_->GetMappedReadProjection(projection_, &mapped_projection_));
 
   vector<shared_ptr<RowwiseIterator>> iters;
 
-  RETURN_NOT_OK(tablet_->CaptureConsistentIterators(&projection_, snap_, spec, &iters));
+  RETURN_NOT_OK(tablet_->CaptureConsistentIterators(mapped_projection_.get(), snap_, spec,
+                                                    &iters, stored_checksums_));
 
   switch (order_) {
     case ORDERED:
-      iter_.reset(new MergeIterator(projection_, iters));
+      iter_.reset(new MergeIterator(*mapped_projection_, iters));
       break;
     case UNORDERED:
     default:
@@ -17,11 +17,13 @@
 #ifndef KUDU_TABLET_TABLET_H
 #define KUDU_TABLET_TABLET_H
 
+#include <functional>
 #include <iosfwd>
 #include <map>
 #include <memory>
 #include <mutex>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "kudu/common/iterator.h"
@@ -36,6 +38,8 @@
 #include "kudu/tablet/rowset.h"
 #include "kudu/util/locks.h"
 #include "kudu/util/metrics.h"
+#include "kudu/util/monotime.h"
+#include "kudu/util/random.h"
 #include "kudu/util/semaphore.h"
 #include "kudu/util/slice.h"
 #include "kudu/util/status.h"
@@ -43,9 +47,11 @@
 
 namespace kudu {
 
+class EncodedKey;
 class MemTracker;
 class MetricEntity;
 class RowChangeList;
+class RowOperationsPB;
 class UnionIterator;
 
 namespace log {
@@ -74,6 +80,14 @@ struct TabletComponents;
 struct TabletMetrics;
 class WriteTransactionState;
 
+// Names of the trace counters incremented as the iterators of a scan are
+// created: the number of rowsets the scan will read, and the number of
+// rowsets it skips because they are outside of its key range or, according
+// to their column statistics, have no row matching its predicates.
+extern const char* const kRowSetsScannedTraceCounter;
+extern const char* const kRowSetsPrunedByKeyRangeTraceCounter;
+extern const char* const kRowSetsPrunedByColumnStatsTraceCounter;
+
 class Tablet {
  public:
   typedef std::map<int64_t, int64_t> MaxIdxToSegmentMap;
@@ -112,6 +126,11 @@ class Tablet {
   Status DecodeWriteOperations(const Schema* client_schema,
                                WriteTransactionState* tx_state);
 
+  // Checks that the row operations 'ops', written with 'client_schema',
+  // decode against the current schema and only touch rows of this tablet,
+  // as a write transaction carrying them would when it's prepared.
+  Status CheckWriteOperations(const Schema& client_schema, const RowOperationsPB& ops) const;
+
   // Acquire locks for each of the operations in the given txn.
   //
   // Note that, if this fails, it's still possible that the transaction
@@ -173,6 +192,26 @@ class Tablet {
   Status AcquireLockForOp(WriteTransactionState* tx_state,
                           RowOp* op);
 
+  // Sets the row op's RowSetKeyProbe and checks that the row belongs to this
+  // tablet. The first half of AcquireLockForOp().
+  Status PrepareKeyForOp(RowOp* op);
+
+  // Acquires the row lock for the given operation, whose RowSetKeyProbe must
+  // already be set. The second half of AcquireLockForOp().
+  void LockRowForOp(WriteTransactionState* tx_state, RowOp* op);
+
+  // Checks, ahead of Apply, whether the rows inserted by the given
+  // transaction are already present in the tablet. Meant to be called while
+  // the transaction is being replicated, so that the rowset probes overlap
+  // with the network round trip. Only INSERT operations are checked: since
+  // the transaction holds its row locks, whether their keys are present
+  // can't change before Apply, even if the rowsets get flushed or compacted
+  // in the meantime. The components which were probed are kept alive in
+  // 'tx_state' until the transaction is reset.
+  //
+  // Operations which couldn't be checked are left to be checked on Apply.
+  Status CheckPresenceDuringReplication(WriteTransactionState* tx_state);
+
   // Signal that the given transaction is about to Apply.
   void StartApplying(WriteTransactionState* tx_state);
 
@@ -229,6 +268,28 @@ class Tablet {
   Status RewindSchemaForBootstrap(const Schema& schema,
                                   int64_t schema_version);
 
+  // Write a checkpoint of the MemRowSet to 'path', replacing any previous
+  // checkpoint. The checkpoint holds the inserts and mutations made to the
+  // MemRowSet by transactions with timestamps before 'timestamp'. All of
+  // those transactions must have committed, with their COMMIT messages
+  // durable in the log, so that bootstrap never replays them past the
+  // checkpoint.
+  Status CheckpointMemRowSet(const std::string& path, Timestamp timestamp);
+
+  // Load the MemRowSet checkpoint at 'path', if there is one and it was
+  // taken of the MemRowSet the tablet was opened with, under the current
+  // schema. If it was loaded, sets '*mrs_id' to the ID of the MemRowSet and
+  // '*timestamp' to the checkpoint's timestamp; otherwise sets '*mrs_id' to
+  // -1. A checkpoint which can't be read is ignored.
+  //
+  // REQUIRES: state_ == kBootstrapping, and the MemRowSet is empty.
+  Status LoadMemRowSetCheckpoint(const std::string& path, int64_t* mrs_id,
+                                 Timestamp* timestamp);
+
+  // Delete the MemRowSet checkpoint of the given tablet, if there is one.
+  static Status DeleteMemRowSetCheckpoint(FsManager* fs_manager,
+                                          const std::string& tablet_id);
+
   // Prints current RowSet layout, taking a snapshot of the current RowSet interval
   // tree. Also prints the log of the compaction algorithm as evaluated
   // on the current layout.
@@ -299,6 +360,39 @@ class Tablet {
   double GetPerfImprovementForBestDeltaCompactUnlocked(RowSet::DeltaCompactionType type,
                                                        std::shared_ptr<RowSet>* rs) const;
 
+  // Returns the estimated number of bytes in UNDO delta files which may be
+  // entirely older than the ancient history mark, and so may be deleted by
+  // DeleteAncientUndoDeltas(). Returns 0 if tablet history GC is disabled.
+  int64_t EstimateBytesInPotentiallyAncientUndoDeltas();
+
+  // Deletes the UNDO delta files, across all rowsets, whose mutations are all
+  // older than the ancient history mark. Rowsets which are busy being flushed
+  // or compacted are skipped. Does nothing if tablet history GC is disabled.
+  Status DeleteAncientUndoDeltas();
+
+  // Returns true if the rows of 'schema' expire, setting 'ttl_col_idx' to
+  // the index of the column they expire by and 'expiry_cutoff_micros' to the
+  // time before which values of that column are expired as of the hybrid
+  // timestamp 'as_of'.
+  //
+  // Expiry is decided against a timestamp rather than the local wall clock
+  // so that a snapshot scan sees the same rows on every replica and every
+  // time it's repeated.
+  static bool GetRowExpiry(const Schema& schema, Timestamp as_of, int* ttl_col_idx,
+                           int64_t* expiry_cutoff_micros);
+
+  // Returns the estimated number of bytes in the DiskRowSets whose rows have
+  // all expired as of the ancient history mark, which DeleteExpiredRowSets()
+  // would delete. Returns 0 if history GC is disabled or if
+  // the rows of this tablet never expire.
+  int64_t EstimateBytesInExpiredRowSets();
+
+  // Deletes the DiskRowSets whose rows have all expired as of the ancient
+  // history mark, without rewriting them. Rowsets which are busy being
+  // flushed or compacted are skipped. Does nothing if history GC is disabled
+  // or if the rows of this tablet never expire.
+  Status DeleteExpiredRowSets();
+
   // Return the current number of rowsets in the tablet.
   size_t num_rowsets() const;
 
@@ -307,6 +401,55 @@ class Tablet {
   // memrowset in the current implementation.
   Status CountRows(uint64_t *count) const;
 
+  // Suggest encoded primary keys at which the range ['start_key', 'stop_key')
+  // can be split into chunks of about 'target_chunk_size' bytes of on-disk
+  // data each. A NULL key leaves the range unbounded on that side.
+  //
+  // The split keys are chosen among the key bounds of the tablet's rowsets,
+  // and each rowset's size is assumed to be spread evenly over the implicit
+  // intervals of the rowset tree which it spans. Data in the MemRowSet isn't
+  // accounted for.
+  void SplitKeyRange(const Slice* start_key,
+                     const Slice* stop_key,
+                     uint64_t target_chunk_size,
+                     std::vector<std::string>* split_keys) const;
+
+  // Prepares the split of the tablet into the new tablets 'left_tablet_id'
+  // and 'right_tablet_id' (see TSTabletManager::SplitTablet()).
+  //
+  // Waits for the writes in flight and blocks new ones, flushes the
+  // MemRowSet and the DeltaMemStores, and picks the boundary between rowsets
+  // which is closest to the middle of the on-disk data, among those at
+  // which the range partition key changes. On success, 'left_rowsets' and
+  // 'right_rowsets' hold the rowsets on either side of
+  // 'split_partition_key', the superblock records the split, and writes to
+  // the tablet fail from then on.
+  //
+  // The tablet's maintenance ops must be unregistered beforehand, so that
+  // no compaction changes the rowsets while they're being handed over.
+  //
+  // A retry of the split into the same tablets returns the same rowsets.
+  //
+  // Returns IllegalState if there's no such boundary, e.g. because all the
+  // rowsets overlap, and NotSupported if the range partition columns aren't
+  // a prefix of the primary key.
+  Status Split(const std::string& left_tablet_id,
+               const std::string& right_tablet_id,
+               std::string* split_partition_key,
+               std::vector<RowSetDataPB>* left_rowsets,
+               std::vector<RowSetDataPB>* right_rowsets);
+
+  // Looks up the rows with the given encoded primary keys as of the current
+  // MVCC state, projected onto 'projection', and passes each block of found
+  // rows to 'visitor'. Keys which are not found are skipped.
+  //
+  // Unlike a scan, this creates no tablet-wide iterator: each key is probed
+  // (through the bloom filters and key index) only in the rowsets whose
+  // bounds contain it, and a rowset is only read once it is known to hold
+  // the key.
+  Status LookupRows(const Schema& projection,
+                    const std::vector<Slice>& encoded_keys,
+                    const std::function<void(const RowBlock&)>& visitor) const;
 
   // Verbosely dump this entire tablet to the logs. This is only
   // really useful when debugging unit tests failures where the tablet
@@ -352,6 +495,13 @@ class Tablet {
   // Otherwise, returns false.
   bool GetTabletAncientHistoryMark(Timestamp* ancient_history_mark) const WARN_UNUSED_RESULT;
 
+  // Returns true if the rows of this tablet expire and tablet history GC is
+  // enabled, setting the arguments as GetRowExpiry() does as of the ancient
+  // history mark. No scan may read at a snapshot before the mark, so rows
+  // which have expired by then are hidden from every scan and may be removed.
+  bool GetAncientRowExpiry(int* ttl_col_idx, int64_t* expiry_cutoff_micros) const
+      WARN_UNUSED_RESULT;
+
   // Calculates history GC options based on properties of the Clock implementation.
   HistoryGcOpts GetHistoryGcOpts() const;
 
@@ -383,6 +533,18 @@ class Tablet {
   // Return true if this RPC is allowed.
   bool ShouldThrottleAllow(int64_t bytes);
 
+  // Dynamic admission control of writes, applied on top of the static
+  // throttler. Returns false if a write should be rejected because the
+  // tablet takes in data faster than it can absorb it. In that case,
+  // 'retry_after' is set to how long the client should back off for.
+  //
+  // The pressure comes from the MemRowSet growing faster than flushes write
+  // it out, and from the WAL's append queue filling up ('wal_queue_fill_ratio'
+  // is how full it is, from 0 to 1). Past a threshold, a fraction of writes
+  // which grows with the pressure is rejected, so that clients slow down
+  // smoothly rather than all at once.
+  bool ShouldAdmitWrite(double wal_queue_fill_ratio, MonoDelta* retry_after);
+
   scoped_refptr<server::Clock> clock() const { return clock_; }
 
   static const char* kDMSMemTrackerId;
@@ -393,6 +555,14 @@ class Tablet {
 
   Status FlushUnlocked();
 
+  // Updates the growth rate of the MemRowSet, and the flush backlog pressure
+  // derived from it. Requires 'admission_lock_'.
+  void SampleMrsGrowthUnlocked(const MonoTime& now);
+
+  // Records the write out of 'bytes' of MemRowSet by a flush which took
+  // 'elapsed'.
+  void RecordFlushThroughput(size_t bytes, const MonoDelta& elapsed);
+
 
   // Perform an INSERT or UPSERT operation, assuming that the transaction is already in
   // prepared state. This state ensures that:
@@ -403,6 +573,20 @@ class Tablet {
                                 RowOp* insert,
                                 ProbeStats* stats);
 
+  // Probe the rowsets for the keys of all the INSERT and UPSERT operations in
+  // the transaction at once, setting each probed operation's 'checked_present'
+  // and 'present_in_rowset'. The keys are sorted and each rowset is probed
+  // with its keys in order, so consecutive probes of a rowset tend to hit the
+  // same bloom filter and key index blocks. Keys which appear more than once
+  // in the batch are left to be checked as their operations are applied.
+  //
+  // Operations which were already checked are skipped.
+  //
+  // 'stats_array' holds the ProbeStats of each operation, in order.
+  Status BulkCheckPresence(const TabletComponents* comps,
+                           WriteTransactionState* tx_state,
+                           ProbeStats* stats_array);
+
   // Same as above, but for UPDATE.
   Status MutateRowUnlocked(WriteTransactionState *tx_state,
                            RowOp* mutate,
@@ -429,10 +613,15 @@ class Tablet {
   //
   // The returned iterators are not Init()ed.
   // 'projection' must remain valid and unchanged for the lifetime of the returned iterators.
+  //
+  // If 'checksums' is non-NULL, the rowsets whose checksum is known (see
+  // RowSet::AddStoredChecksum()) are left out, and their checksums added to
+  // 'checksums' instead. 'spec' must then have no predicates or key bounds.
   Status CaptureConsistentIterators(const Schema *projection,
                                     const MvccSnapshot &snap,
                                     const ScanSpec *spec,
-                                    vector<std::shared_ptr<RowwiseIterator> > *iters) const;
+                                    vector<std::shared_ptr<RowwiseIterator> > *iters,
+                                    StoredChecksums* checksums = nullptr) const;
 
   Status PickRowSetsToCompact(RowSetsInCompaction *picked,
                               CompactFlags flags) const;
@@ -441,6 +630,33 @@ class Tablet {
   Status DoMergeCompactionOrFlush(const RowSetsInCompaction &input,
                                   int64_t mrs_being_flushed);
 
+  // Merges the rows of 'input' whose keys fall in [lower_bound,
+  // exclusive_upper_bound) as of 'snap', writing them out to new DiskRowSets.
+  // Either bound may be NULL. The new rowsets' metadata is appended to
+  // 'new_drs_metas'. If 'evict_output' is true, the new rowsets' data is
+  // dropped from the page cache as it is written.
+  Status FlushCompactionInputRange(const RowSetsInCompaction& input,
+                                   const MvccSnapshot& snap,
+                                   const HistoryGcOpts& history_gc_opts,
+                                   bool evict_output,
+                                   const EncodedKey* lower_bound,
+                                   const EncodedKey* exclusive_upper_bound,
+                                   RowSetMetadataVector* new_drs_metas,
+                                   int64_t* written_count,
+                                   uint64_t* written_size);
+
+  // Like FlushCompactionInputRange(), but merges each of the key ranges
+  // delimited by 'split_keys' in parallel. The new rowsets' metadata is
+  // appended to 'new_drs_metas' in key order.
+  Status FlushCompactionInputRanges(const RowSetsInCompaction& input,
+                                    const MvccSnapshot& snap,
+                                    const HistoryGcOpts& history_gc_opts,
+                                    bool evict_output,
+                                    const std::vector<std::string>& split_keys,
+                                    RowSetMetadataVector* new_drs_metas,
+                                    int64_t* written_count,
+                                    uint64_t* written_size);
+
   // Handle the case in which a compaction or flush yielded no output rows.
   // In this case, we just need to remove the rowsets in 'rowsets' from the
   // metadata and flush it.
@@ -456,28 +672,48 @@ class Tablet {
                                const RowSetVector& rowsets_to_add,
                                RowSetTree* new_tree);
 
-  // Swap out a set of rowsets, atomically replacing them with the new rowset
-  // under the lock.
+  // A swap of the tablet's rowsets which was built off to the side, without
+  // holding component_lock_, against the components in 'base'.
+  struct PreparedRowSetSwap {
+    RowSetVector to_remove;
+    RowSetVector to_add;
+    scoped_refptr<TabletComponents> base;
+    scoped_refptr<TabletComponents> swapped;
+  };
+
+  // Build the components which result from swapping out 'to_remove' for 'to_add'
+  // in the current components. If 'new_mrs' is set, it also replaces the MemRowSet.
+  void PrepareRowSetSwap(const RowSetVector& to_remove,
+                         const RowSetVector& to_add,
+                         std::shared_ptr<MemRowSet> new_mrs,
+                         PreparedRowSetSwap* swap) const;
+
+  // Publish the components prepared in 'swap'. If a concurrent swap was
+  // published after it was prepared, the RowSetTree is rebuilt from the current
+  // components instead. component_lock_ must be held in exclusive mode.
+  void CommitRowSetSwapUnlocked(const PreparedRowSetSwap& swap);
+
+  // Swap out a set of rowsets, atomically replacing them with the new rowset.
+  // The new RowSetTree is built before taking the lock, so that concurrent
+  // writers are only blocked for the pointer swap.
   void AtomicSwapRowSets(const RowSetVector &to_remove,
                          const RowSetVector &to_add);
 
-  // Same as the above, but without taking the lock. This should only be used
-  // in cases where the lock is already held.
-  void AtomicSwapRowSetsUnlocked(const RowSetVector &to_remove,
-                                 const RowSetVector &to_add);
-
   void GetComponents(scoped_refptr<TabletComponents>* comps) const {
-    shared_lock<rw_spinlock> l(component_lock_);
+    shared_lock<rw_spinlock> l(component_lock_.get_lock());
     *comps = components_;
   }
 
-  // Create a new MemRowSet, replacing the current one.
+  // Create a new MemRowSet, and prepare the swap which replaces the current one
+  // with it into 'swap'. rowsets_flush_sem_ must be held, so that the current
+  // MemRowSet can't be replaced concurrently.
   // The 'old_ms' pointer will be set to the current MemRowSet set before the replacement.
   // If the MemRowSet is not empty it will be added to the 'compaction' input
   // and the MemRowSet compaction lock will be taken to prevent the inclusion
   // in any concurrent compactions.
-  Status ReplaceMemRowSetUnlocked(RowSetsInCompaction *compaction,
-                                  std::shared_ptr<MemRowSet> *old_ms);
+  Status PrepareMemRowSetReplacement(RowSetsInCompaction *compaction,
+                                     std::shared_ptr<MemRowSet> *old_ms,
+                                     PreparedRowSetSwap* swap);
 
   // TODO: Document me.
   Status FlushInternal(const RowSetsInCompaction& input,
@@ -486,12 +722,22 @@ class Tablet {
   BloomFilterSizing bloom_sizing() const;
 
   // Convert the specified read client schema (without IDs) to a server schema (with IDs)
-  // This method is used by NewRowIterator().
+  // This method is used by NewRowIterator() and LookupRows(). The mapped
+  // projections are cached, so that repeated scans with the same projection,
+  // e.g. point lookups, share them instead of resolving the columns again.
   Status GetMappedReadProjection(const Schema& projection,
-                                 Schema *mapped_projection) const;
+                                 std::shared_ptr<const Schema>* mapped_projection) const;
 
   Status CheckRowInTablet(const ConstContiguousRow& probe) const;
 
+  // Sets 'partition_key' to the partition key of the row with the given
+  // encoded primary key.
+  Status PartitionKeyForEncodedKey(const Slice& encoded_key, std::string* partition_key) const;
+
+  // Picks the partition key to split the rowsets of 'comps' at, for Split().
+  Status PickSplitPartitionKey(const TabletComponents& comps,
+                               std::string* split_partition_key) const;
+
   // Helper method to find the rowset that has the DMS with the highest retention.
   std::shared_ptr<RowSet> FindBestDMSToFlush(
       const MaxIdxToSegmentMap& max_idx_to_segment_size) const;
@@ -525,18 +771,23 @@ class Tablet {
   // - Writers take this in shared mode at the same time as they obtain an MVCC timestamp
   //   and capture a reference to components_. This ensures that we can use the MVCC timestamp
   //   to determine which writers are writing to which components during compaction.
-  // - Readers take this in shared mode while capturing their iterators. This ensures that
-  //   they see a consistent view when racing against flush/compact.
+  // - Readers take this in shared mode only to grab a reference to components_, which is
+  //   an immutable snapshot: the iterators are then captured from that snapshot without
+  //   holding the lock, and still see a consistent view when racing against flush/compact.
   //
   // Exclusive mode:
   // - Flushes/compactions take this lock in order to lock out concurrent updates when
-  //   swapping in a new memrowset.
+  //   swapping in a new memrowset. The new components are built before taking it (see
+  //   PrepareRowSetSwap()), so it is only held for the pointer swap.
   //
   // NOTE: callers should avoid taking this lock for a long time, even in shared mode.
   // This is because the lock has some concept of fairness -- if, while a long reader
   // is active, a writer comes along, then all future short readers will be blocked.
-  // TODO: now that this is single-threaded again, we should change it to rw_spinlock
-  mutable rw_spinlock component_lock_;
+  //
+  // Every write and scan takes this lock in shared mode, while exclusive mode is only
+  // needed for the rare rowset swaps, so it is a per-CPU lock: readers only touch the
+  // cache line of their own CPU, and writers pay for locking every CPU's lock.
+  mutable percpu_rwlock component_lock_;
 
   // The current components of the tablet. These should always be read
   // or swapped under the component_lock.
@@ -552,6 +803,26 @@ class Tablet {
 
   std::unique_ptr<Throttler> throttler_;
 
+  // Protects the state of the admission control of writes below.
+  simple_spinlock admission_lock_;
+
+  // Moving averages of the rate at which the MemRowSet grows, and of the
+  // rate at which flushes write it out, in bytes per second. 0 until first
+  // measured.
+  double mrs_growth_bytes_per_sec_;
+  double flush_bytes_per_sec_;
+
+  // The MemRowSet's id and size when its growth was last sampled.
+  MonoTime last_mrs_sample_time_;
+  int64_t last_mrs_sample_id_;
+  size_t last_mrs_sample_size_;
+
+  // As of the last sample, how far the flush backlog is into the range in
+  // which writes are rejected: 1 at its start, 2 at its end.
+  double flush_backlog_pressure_;
+
+  Random admission_rng_;
+
   int64_t next_mrs_id_;
 
   // A pointer to the server's clock.
@@ -568,11 +839,29 @@ class Tablet {
   // so that they don't both try to select the same rowset.
   mutable std::mutex compact_select_lock_;
 
+  // The result of the last run of the compaction policy by
+  // UpdateCompactionStats(): the rowset tree it ran against, when it ran
+  // and the quality it computed. Reused while the tree is unchanged and the
+  // result is recent, so that the maintenance manager's frequent polling
+  // doesn't keep rerunning the selection. Protected by compact_select_lock_.
+  mutable std::weak_ptr<RowSetTree> last_compaction_stats_tree_;
+  MonoTime last_compaction_stats_time_;
+  double last_compaction_stats_quality_;
+
   // We take this lock when flushing the tablet's rowsets in Tablet::Flush.  We
   // don't want to have two flushes in progress at once, in case the one which
   // started earlier completes after the one started later.
   mutable Semaphore rowsets_flush_sem_;
 
+  // The mapped read projections of recent scans, keyed by the columns of the
+  // client projection. They were all mapped from 'projection_cache_schema_'.
+  // The cache is cleared when the tablet schema changes: the metadata keeps
+  // every schema of the tablet alive, so comparing their addresses is as good
+  // as comparing the schema versions.
+  mutable simple_spinlock projection_cache_lock_;
+  mutable const Schema* projection_cache_schema_;
+  mutable std::unordered_map<std::string, std::shared_ptr<const Schema>> projection_cache_;
+
   enum State {
     kInitialized,
     kBootstrapping,
@@ -631,11 +920,19 @@ class Tablet::Iterator : public RowwiseIterator {
   std::string ToString() const OVERRIDE;
 
   const Schema &schema() const OVERRIDE {
-    return projection_;
+    return mapped_projection_ ? *mapped_projection_ : projection_;
   }
 
   virtual void GetIteratorStats(std::vector<IteratorStats>* stats) const OVERRIDE;
 
+  // Makes Init() skip the rowsets whose checksum is known, adding up their
+  // checksums in 'checksums' instead, which must outlive the call to Init().
+  // Only for checksum scans of whole rows, whose spec has no predicates.
+  void SkipRowSetsWithStoredChecksums(StoredChecksums* checksums) {
+    DCHECK(iter_.get() == nullptr);
+    stored_checksums_ = checksums;
+  }
+
  private:
   friend class Tablet;
 
@@ -645,9 +942,12 @@ class Tablet::Iterator : public RowwiseIterator {
            const OrderMode order);
 
   const Tablet *tablet_;
-  Schema projection_;
+  const Schema projection_;
+  // The projection mapped to the tablet schema, set by Init().
+  std::shared_ptr<const Schema> mapped_projection_;
   const MvccSnapshot snap_;
   const OrderMode order_;
+  StoredChecksums* stored_checksums_;
   gscoped_ptr<RowwiseIterator> iter_;
 };
 
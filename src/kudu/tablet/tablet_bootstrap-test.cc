@@ -32,6 +32,8 @@
 #include "kudu/tablet/tablet-test-util.h"
 #include "kudu/tablet/tablet_metadata.h"
 
+DECLARE_int32(tablet_bootstrap_prefetch_entries);
+
 using std::shared_ptr;
 using std::string;
 using std::unique_ptr;
@@ -171,6 +173,29 @@ TEST_F(BootstrapTest, TestBootstrap) {
   ASSERT_EQ(1, results.size());
 }
 
+// Tests bootstrapping from several segments when the log entries are
+// prefetched only just ahead of the entry being replayed.
+TEST_F(BootstrapTest, TestBootstrapWithPrefetching) {
+  FLAGS_tablet_bootstrap_prefetch_entries = 1;
+  ASSERT_OK(BuildLog());
+
+  const int kNumSegments = 3;
+  const int kOpsPerSegment = 10;
+  for (int i = 0; i < kNumSegments; i++) {
+    NO_FATALS(AppendReplicateBatchAndCommitEntryPairsToLog(kOpsPerSegment));
+    ASSERT_OK(RollLog());
+  }
+
+  shared_ptr<Tablet> tablet;
+  ConsensusBootstrapInfo boot_info;
+  ASSERT_OK(BootstrapTestTablet(-1, -1, &tablet, &boot_info));
+  ASSERT_EQ(kNumSegments * kOpsPerSegment, boot_info.last_committed_id.index());
+
+  vector<string> results;
+  IterateTabletRows(tablet.get(), &results);
+  ASSERT_EQ(kNumSegments * kOpsPerSegment, results.size());
+}
+
 // Tests attempting a local bootstrap of a tablet that was in the middle of a
 // tablet copy before "crashing".
 TEST_F(BootstrapTest, TestIncompleteTabletCopy) {
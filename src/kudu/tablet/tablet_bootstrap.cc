@@ -17,6 +17,7 @@
 
 #include "kudu/tablet/tablet_bootstrap.h"
 
+#include <algorithm>
 #include <gflags/gflags.h>
 #include <map>
 #include <memory>
@@ -50,6 +51,7 @@
 #include "kudu/tablet/tablet_peer.h"
 #include "kudu/tablet/transactions/alter_schema_transaction.h"
 #include "kudu/tablet/transactions/write_transaction.h"
+#include "kudu/util/blocking_queue.h"
 #include "kudu/util/debug/trace_event.h"
 #include "kudu/util/fault_injection.h"
 #include "kudu/util/flag_tags.h"
@@ -57,6 +59,7 @@
 #include "kudu/util/logging.h"
 #include "kudu/util/path_util.h"
 #include "kudu/util/stopwatch.h"
+#include "kudu/util/thread.h"
 
 DEFINE_bool(skip_remove_old_recovery_dir, false,
             "Skip removing WAL recovery dir after startup. (useful for debugging)");
@@ -68,6 +71,12 @@ DEFINE_double(fault_crash_during_log_replay, 0.0,
               "(For testing only!)");
 TAG_FLAG(fault_crash_during_log_replay, unsafe);
 
+DEFINE_int32(tablet_bootstrap_prefetch_entries, 1024,
+             "Maximum number of log entries read and decoded ahead of the entry "
+             "being replayed by tablet bootstrap, on a separate thread. If 0, "
+             "entries are read by the replaying thread as they are needed.");
+TAG_FLAG(tablet_bootstrap_prefetch_entries, advanced);
+
 DECLARE_int32(max_clock_sync_error_usec);
 
 namespace kudu {
@@ -146,6 +155,51 @@ class FlushedStoresSnapshot {
   DISALLOW_COPY_AND_ASSIGN(FlushedStoresSnapshot);
 };
 
+// Reads the entries of a sequence of log segments in order, optionally on a
+// separate thread which reads and decodes up to a fixed number of entries
+// ahead of the caller. This overlaps the I/O and protobuf parsing of replay
+// with the application of the entries.
+class LogEntryPrefetcher {
+ public:
+  // If 'max_prefetched_entries' is 0, entries are read by the caller of
+  // ReadNextEntry().
+  LogEntryPrefetcher(log::SegmentSequence segments, int max_prefetched_entries);
+  ~LogEntryPrefetcher();
+
+  // Starts the prefetching thread, if there is one.
+  Status Start();
+
+  // Reads the next entry, returning Status::EndOfFile() (and no entry) at the
+  // end of each segment. After an error, no more entries may be read.
+  Status ReadNextEntry(unique_ptr<LogEntryPB>* entry);
+
+ private:
+  // An entry read from the segments, or the status which ended a segment.
+  struct Item {
+    unique_ptr<LogEntryPB> entry;
+    Status status;
+  };
+
+  // Reads the next entry directly from the segments.
+  Status ReadFromSegments(unique_ptr<LogEntryPB>* entry);
+
+  // Body of the prefetching thread.
+  void PrefetchThread();
+
+  const log::SegmentSequence segments_;
+  const int max_prefetched_entries_;
+
+  // The reader of the segment currently being read, if any, and the index of
+  // the next segment to read.
+  unique_ptr<log::LogEntryReader> reader_;
+  size_t next_segment_idx_;
+
+  BlockingQueue<Item*> queue_;
+  scoped_refptr<Thread> thread_;
+
+  DISALLOW_COPY_AND_ASSIGN(LogEntryPrefetcher);
+};
+
 // Bootstraps an existing tablet by opening the metadata from disk, and rebuilding soft
 // state by playing log segments. A bootstrapped tablet can then be added to an existing
 // consensus configuration as a LEARNER, which will bring its state up to date with the
@@ -238,11 +292,15 @@ class TabletBootstrap {
 
   // Plays operations, skipping those that have already been flushed,
   // as indicated in the 'already_flushed' vector.
+  //
+  // Operations marked in 'in_checkpoint' are also skipped, but keep their
+  // original results.
   Status PlayRowOperations(WriteTransactionState* tx_state,
                            const SchemaPB& schema_pb,
                            const RowOperationsPB& ops_pb,
                            const TxResultPB& result,
-                           const vector<bool>& already_flushed);
+                           const vector<bool>& already_flushed,
+                           const vector<bool>& in_checkpoint);
 
   // Determine which of the operations from 'result' correspond to already-flushed stores.
   // At the same time this builds the WriteResponsePB that we'll store on the ResultTracker.
@@ -263,6 +321,12 @@ class TabletBootstrap {
   Status FilterOperation(const OperationResultPB& op_result,
                          bool* already_flushed);
 
+  // Determine which of the operations from 'result', of a transaction with
+  // the given timestamp, were loaded into the MemRowSet from its checkpoint.
+  void DetermineCheckpointedOps(const TxResultPB& result,
+                                Timestamp timestamp,
+                                vector<bool>* in_checkpoint) const;
+
   enum ActiveStores {
     // The OperationResultPBs in the commit message do not reference any stores.
     // This can happen in the case that the operations did not result in any mutations
@@ -373,6 +437,11 @@ class TabletBootstrap {
   // Snapshot of which stores were flushed prior to restart.
   FlushedStoresSnapshot flushed_stores_;
 
+  // The MemRowSet loaded from a checkpoint, or -1 if none was, and the
+  // timestamp of the checkpoint. See Tablet::LoadMemRowSetCheckpoint().
+  int64_t checkpointed_mrs_id_;
+  Timestamp mrs_checkpoint_timestamp_;
+
   DISALLOW_COPY_AND_ASSIGN(TabletBootstrap);
 };
 
@@ -432,7 +501,8 @@ TabletBootstrap::TabletBootstrap(
       result_tracker_(result_tracker),
       metric_registry_(metric_registry),
       listener_(listener),
-      log_anchor_registry_(log_anchor_registry) {}
+      log_anchor_registry_(log_anchor_registry),
+      checkpointed_mrs_id_(-1) {}
 
 Status TabletBootstrap::Bootstrap(shared_ptr<Tablet>* rebuilt_tablet,
                                   scoped_refptr<Log>* rebuilt_log,
@@ -1020,6 +1090,74 @@ void TabletBootstrap::DumpReplayStateToLog(const ReplayState& state) {
   }
 }
 
+LogEntryPrefetcher::LogEntryPrefetcher(log::SegmentSequence segments,
+                                       int max_prefetched_entries)
+    : segments_(std::move(segments)),
+      max_prefetched_entries_(max_prefetched_entries),
+      next_segment_idx_(0),
+      queue_(std::max(max_prefetched_entries, 1)) {
+}
+
+LogEntryPrefetcher::~LogEntryPrefetcher() {
+  queue_.Shutdown();
+  if (thread_) {
+    CHECK_OK(ThreadJoiner(thread_.get()).Join());
+  }
+  Item* item;
+  while (queue_.BlockingGet(&item)) {
+    delete item;
+  }
+}
+
+Status LogEntryPrefetcher::Start() {
+  if (max_prefetched_entries_ == 0 || segments_.empty()) {
+    return Status::OK();
+  }
+  return Thread::Create("tablet", "bootstrap-prefetch",
+                        &LogEntryPrefetcher::PrefetchThread, this, &thread_);
+}
+
+Status LogEntryPrefetcher::ReadNextEntry(unique_ptr<LogEntryPB>* entry) {
+  if (!thread_) {
+    return ReadFromSegments(entry);
+  }
+  Item* item;
+  CHECK(queue_.BlockingGet(&item)) << "read past the last log segment";
+  unique_ptr<Item> owned_item(item);
+  *entry = std::move(item->entry);
+  return item->status;
+}
+
+Status LogEntryPrefetcher::ReadFromSegments(unique_ptr<LogEntryPB>* entry) {
+  if (!reader_) {
+    CHECK_LT(next_segment_idx_, segments_.size());
+    reader_.reset(new log::LogEntryReader(segments_[next_segment_idx_++].get()));
+  }
+  entry->reset(new LogEntryPB);
+  Status s = reader_->ReadNextEntry(entry->get());
+  if (!s.ok()) {
+    entry->reset();
+    reader_.reset();
+  }
+  return s;
+}
+
+void LogEntryPrefetcher::PrefetchThread() {
+  while (reader_ || next_segment_idx_ < segments_.size()) {
+    unique_ptr<Item> item(new Item);
+    item->status = ReadFromSegments(&item->entry);
+    bool failed = !item->status.ok() && !item->status.IsEndOfFile();
+    if (!queue_.BlockingPut(item.get())) {
+      // The reader went away.
+      return;
+    }
+    item.release();
+    if (failed) {
+      return;
+    }
+  }
+}
+
 Status TabletBootstrap::PlaySegments(ConsensusBootstrapInfo* consensus_info) {
   ReplayState state;
   log::SegmentSequence segments;
@@ -1044,15 +1182,23 @@ Status TabletBootstrap::PlaySegments(ConsensusBootstrapInfo* consensus_info) {
   // writing.
   RETURN_NOT_OK_PREPEND(OpenNewLog(), "Failed to open new log");
 
+  // Operations on the MemRowSet which are covered by its checkpoint needn't
+  // be replayed, once the checkpoint is loaded.
+  RETURN_NOT_OK_PREPEND(tablet_->LoadMemRowSetCheckpoint(
+                            meta_->fs_manager()->GetTabletMrsCheckpointPath(tablet_->tablet_id()),
+                            &checkpointed_mrs_id_, &mrs_checkpoint_timestamp_),
+                        "Failed to load MemRowSet checkpoint");
+
+  LogEntryPrefetcher prefetcher(segments, FLAGS_tablet_bootstrap_prefetch_entries);
+  RETURN_NOT_OK_PREPEND(prefetcher.Start(), "Couldn't start reading log segments");
+
   int segment_count = 0;
   for (const scoped_refptr<ReadableLogSegment>& segment : segments) {
-    log::LogEntryReader reader(segment.get());
-
     int entry_count = 0;
     while (true) {
-      unique_ptr<LogEntryPB> entry(new LogEntryPB);
+      unique_ptr<LogEntryPB> entry;
 
-      Status s = reader.ReadNextEntry(entry.get());
+      Status s = prefetcher.ReadNextEntry(&entry);
       if (PREDICT_FALSE(!s.ok())) {
         if (s.IsEndOfFile()) {
           break;
@@ -1238,6 +1384,29 @@ Status TabletBootstrap::PlayWriteRequest(ReplicateMsg* replicate_msg,
     response->set_timestamp(replicate_msg->timestamp());
   }
 
+  // The tracked requests which the leader coalesced into this write, if any,
+  // are registered one by one, in the same way.
+  vector<int> new_coalesced_requests;
+  if (result_tracker_.get() != nullptr) {
+    for (int i = 0; i < write->coalesced_requests_size(); i++) {
+      const WriteRequestPB::CoalescedRequestPB& request = write->coalesced_requests(i);
+      if (!request.has_request_id()) continue;
+      ResultTracker::RpcState request_state =
+          result_tracker_->TrackRpcOrChangeDriver(request.request_id());
+      CHECK(request_state == ResultTracker::RpcState::NEW ||
+            request_state == ResultTracker::RpcState::COMPLETED ||
+            request_state == ResultTracker::RpcState::STALE)
+          << "Wrong state: " << request_state;
+      if (request_state == ResultTracker::RpcState::NEW) {
+        new_coalesced_requests.push_back(i);
+      }
+    }
+    if (!new_coalesced_requests.empty() && !response) {
+      response.reset(new WriteResponsePB());
+      response->set_timestamp(replicate_msg->timestamp());
+    }
+  }
+
   // Determine which of the operations are already flushed to persistent
   // storage and don't need to be re-applied. We can do this even before
   // we decode any row operations, so we can short-circuit that decoding
@@ -1246,19 +1415,37 @@ Status TabletBootstrap::PlayWriteRequest(ReplicateMsg* replicate_msg,
   RETURN_NOT_OK(DetermineFlushedOpsAndBuildResponse(commit_msg.result(),
                                                     &already_flushed,
                                                     response.get()));
+  vector<bool> in_checkpoint;
+  DetermineCheckpointedOps(commit_msg.result(), tx_state.timestamp(), &in_checkpoint);
+  for (int i = 0; i < in_checkpoint.size(); i++) {
+    if (in_checkpoint[i]) {
+      already_flushed[i] = true;
+    }
+  }
 
   if (tracking_results && state == ResultTracker::NEW) {
     result_tracker_->RecordCompletionAndRespond(replicate_msg->request_id(), response.get());
   }
+  for (int i : new_coalesced_requests) {
+    WriteResponsePB coalesced_response;
+    GetCoalescedWriteResponse(*write, *response, i, &coalesced_response);
+    result_tracker_->RecordCompletionAndRespond(write->coalesced_requests(i).request_id(),
+                                                &coalesced_response);
+  }
 
   bool all_already_flushed = std::all_of(already_flushed.begin(),
                                          already_flushed.end(),
                                          [](bool f) { return f; });
   if (all_already_flushed) {
     stats_.ops_ignored++;
-    for (auto& op : *commit->mutable_result()->mutable_ops()) {
-      op.Clear();
-      op.set_flushed(true);
+    for (int i = 0; i < commit->result().ops_size(); i++) {
+      if (in_checkpoint[i]) {
+        // The operation is still only in the MemRowSet.
+        continue;
+      }
+      OperationResultPB* op = commit->mutable_result()->mutable_ops(i);
+      op->Clear();
+      op->set_flushed(true);
     }
   } else {
     if (write->has_row_operations()) {
@@ -1267,7 +1454,8 @@ Status TabletBootstrap::PlayWriteRequest(ReplicateMsg* replicate_msg,
                                       write->schema(),
                                       write->row_operations(),
                                       commit_msg.result(),
-                                      already_flushed));
+                                      already_flushed,
+                                      in_checkpoint));
     }
     // Replace the original commit message's result with the new one from
     // the replayed operation.
@@ -1340,7 +1528,8 @@ Status TabletBootstrap::PlayRowOperations(WriteTransactionState* tx_state,
                                           const SchemaPB& schema_pb,
                                           const RowOperationsPB& ops_pb,
                                           const TxResultPB& result,
-                                          const vector<bool>& already_flushed) {
+                                          const vector<bool>& already_flushed,
+                                          const vector<bool>& in_checkpoint) {
   Schema inserts_schema;
   RETURN_NOT_OK_PREPEND(SchemaFromPB(schema_pb, &inserts_schema),
                         "Couldn't decode client schema");
@@ -1354,7 +1543,9 @@ Status TabletBootstrap::PlayRowOperations(WriteTransactionState* tx_state,
   // This signals to ApplyOperations() below that it doesn't need to actually
   // apply these ops again.
   for (int i = 0; i < already_flushed.size(); i++) {
-    if (already_flushed[i]) {
+    if (in_checkpoint[i]) {
+      tx_state->row_ops()[i]->SetLoadedFromCheckpoint(result.ops(i));
+    } else if (already_flushed[i]) {
       tx_state->row_ops()[i]->SetAlreadyFlushed();
     }
   }
@@ -1398,9 +1589,9 @@ Status TabletBootstrap::ApplyOperations(WriteTransactionState* tx_state,
         break;
     }
 
-    // If the op is already flushed, no need to replay it.
+    // If the op is already flushed, or was loaded from the MemRowSet
+    // checkpoint, no need to replay it.
     if (op->has_result()) {
-      DCHECK(op->result->flushed());
       continue;
     }
 
@@ -1485,6 +1676,24 @@ Status TabletBootstrap::FilterOperation(const OperationResultPB& op_result,
   return Status::OK();
 }
 
+void TabletBootstrap::DetermineCheckpointedOps(const TxResultPB& result,
+                                               Timestamp timestamp,
+                                               vector<bool>* in_checkpoint) const {
+  in_checkpoint->assign(result.ops_size(), false);
+  if (checkpointed_mrs_id_ == -1 || timestamp.CompareTo(mrs_checkpoint_timestamp_) >= 0) {
+    return;
+  }
+  for (int i = 0; i < result.ops_size(); i++) {
+    const OperationResultPB& op_result = result.ops(i);
+    // Operations on the MemRowSet only ever mutate that one store.
+    (*in_checkpoint)[i] = !op_result.has_failed_status() &&
+        !op_result.flushed() &&
+        op_result.mutated_stores_size() == 1 &&
+        op_result.mutated_stores(0).has_mrs_id() &&
+        op_result.mutated_stores(0).mrs_id() == checkpointed_mrs_id_;
+  }
+}
+
 Status TabletBootstrap::UpdateClock(uint64_t timestamp) {
   Timestamp ts(timestamp);
   RETURN_NOT_OK(clock_->Update(ts));
@@ -334,6 +334,45 @@ TEST_F(TabletHistoryGcTest, TestNoUndoGCUntilAncientHistoryMark) {
                                R"(@[[:digit:]]+\(DELETE\)\] Redos: \[\]$)");
 }
 
+// Test that UNDO delta files older than the AHM are deleted outright, while
+// the ones holding recent history are kept.
+TEST_F(TabletHistoryGcTest, TestUndoDeltaBlockGc) {
+  FLAGS_tablet_history_max_age_sec = 100;
+
+  NO_FATALS(InsertOriginalRows(num_rowsets_, rows_per_rowset_));
+  for (const auto& rsmd : tablet()->metadata()->rowsets()) {
+    ASSERT_EQ(1, rsmd->undo_delta_blocks().size());
+  }
+  // Nothing is old enough to be GCed yet.
+  ASSERT_EQ(0, tablet()->EstimateBytesInPotentiallyAncientUndoDeltas());
+
+  // Move the original inserts prior to the AHM, then write one more rowset
+  // whose history must be retained.
+  NO_FATALS(AddTimeToHybridClock(MonoDelta::FromSeconds(200)));
+  Timestamp time_before_new_insert = clock()->Now();
+  InsertTestRows(TotalNumRows(), rows_per_rowset_, 0);
+  ASSERT_OK(tablet()->Flush());
+  ASSERT_EQ(num_rowsets_ + 1, tablet()->num_rowsets());
+
+  ASSERT_GT(tablet()->EstimateBytesInPotentiallyAncientUndoDeltas(), 0);
+  ASSERT_OK(tablet()->DeleteAncientUndoDeltas());
+  ASSERT_EQ(0, tablet()->EstimateBytesInPotentiallyAncientUndoDeltas());
+  ASSERT_GT(tablet()->metrics()->undo_delta_block_gc_bytes_deleted->value(), 0);
+
+  int num_undo_blocks = 0;
+  for (const auto& rsmd : tablet()->metadata()->rowsets()) {
+    num_undo_blocks += rsmd->undo_delta_blocks().size();
+  }
+  ASSERT_EQ(1, num_undo_blocks);
+
+  // All of the base data is intact, and the new rows still can't be seen
+  // before they were inserted.
+  NO_FATALS(VerifyTestRowsWithVerifier(kStartRow, TotalNumRows() + rows_per_rowset_,
+                                       kRowsEqual0));
+  NO_FATALS(VerifyTestRowsWithTimestampAndVerifier(kStartRow, TotalNumRows(),
+                                                   time_before_new_insert, kRowsEqual0));
+}
+
 // Test that "ghost" rows (deleted on one rowset, reinserted on another) don't
 // get revived after history GC.
 TEST_F(TabletHistoryGcTest, TestGhostRowsNotRevived) {
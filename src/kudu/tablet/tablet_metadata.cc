@@ -134,6 +134,9 @@ void TabletMetadata::CollectBlockIdPBs(const TabletSuperBlockPB& superblock,
   for (const RowSetDataPB& rowset : superblock.rowsets()) {
     for (const ColumnDataPB& column : rowset.columns()) {
       block_ids->push_back(column.block());
+      if (column.has_bitmap_index_block()) {
+        block_ids->push_back(column.bitmap_index_block());
+      }
     }
     for (const DeltaDataPB& redo : rowset.redo_deltas()) {
       block_ids->push_back(redo.block());
@@ -166,8 +169,11 @@ Status TabletMetadata::DeleteTabletData(TabletDataState delete_type,
   // we have been deleted.
   {
     std::lock_guard<LockType> l(data_lock_);
-    for (const shared_ptr<RowSetMetadata>& rsmd : rowsets_) {
-      AddOrphanedBlocksUnlocked(rsmd->GetAllBlocks());
+    // The blocks of a split tablet belong to the tablets it was split into.
+    if (split_child_tablet_ids_.empty()) {
+      for (const shared_ptr<RowSetMetadata>& rsmd : rowsets_) {
+        AddOrphanedBlocksUnlocked(rsmd->GetAllBlocks());
+      }
     }
     rowsets_.clear();
     tablet_data_state_ = delete_type;
@@ -342,6 +348,10 @@ Status TabletMetadata::LoadFromSuperBlock(const TabletSuperBlockPB& superblock)
     } else {
       tombstone_last_logged_opid_ = MinimumOpId();
     }
+
+    split_child_tablet_ids_.assign(superblock.split_child_tablet_ids().begin(),
+                                   superblock.split_child_tablet_ids().end());
+    split_partition_key_ = superblock.split_partition_key();
   }
 
   // Now is a good time to clean up any orphaned blocks that may have been
@@ -381,19 +391,12 @@ void TabletMetadata::DeleteOrphanedBlocks(const vector<BlockId>& blocks) {
     return;
   }
 
+  // Blocks that were already gone count as deleted, so they're also removed
+  // from the orphaned block list.
   vector<BlockId> deleted;
-  for (const BlockId& b : blocks) {
-    Status s = fs_manager()->DeleteBlock(b);
-    // If we get NotFound, then the block was actually successfully
-    // deleted before. So, we can remove it from our orphaned block list
-    // as if it was a success.
-    if (!s.ok() && !s.IsNotFound()) {
-      WARN_NOT_OK(s, Substitute("Could not delete block $0", b.ToString()));
-      continue;
-    }
-
-    deleted.push_back(b);
-  }
+  WARN_NOT_OK(fs_manager()->DeleteBlocks(blocks, &deleted),
+              Substitute("Could not delete $0 of $1 block(s)",
+                         blocks.size() - deleted.size(), blocks.size()));
 
   // Remove the successfully-deleted blocks from the set.
   {
@@ -562,10 +565,45 @@ Status TabletMetadata::ToSuperBlockUnlocked(TabletSuperBlockPB* super_block,
     block_id.CopyToPB(pb.mutable_orphaned_blocks()->Add());
   }
 
+  if (!split_child_tablet_ids_.empty()) {
+    for (const string& child_id : split_child_tablet_ids_) {
+      pb.add_split_child_tablet_ids(child_id);
+    }
+    pb.set_split_partition_key(split_partition_key_);
+  }
+
   super_block->Swap(&pb);
   return Status::OK();
 }
 
+Status TabletMetadata::SetSplitAndFlush(const string& split_partition_key,
+                                        const vector<string>& child_tablet_ids) {
+  DCHECK(!child_tablet_ids.empty());
+  {
+    std::lock_guard<LockType> l(data_lock_);
+    CHECK(split_child_tablet_ids_.empty()) << "Tablet " << tablet_id_ << " already split";
+    split_child_tablet_ids_ = child_tablet_ids;
+    split_partition_key_ = split_partition_key;
+  }
+  return Flush();
+}
+
+bool TabletMetadata::GetSplit(string* split_partition_key,
+                              vector<string>* child_tablet_ids) const {
+  std::lock_guard<LockType> l(data_lock_);
+  if (split_child_tablet_ids_.empty()) {
+    return false;
+  }
+  *split_partition_key = split_partition_key_;
+  *child_tablet_ids = split_child_tablet_ids_;
+  return true;
+}
+
+bool TabletMetadata::has_been_split() const {
+  std::lock_guard<LockType> l(data_lock_);
+  return !split_child_tablet_ids_.empty();
+}
+
 Status TabletMetadata::CreateRowSet(shared_ptr<RowSetMetadata> *rowset,
                                     const Schema& schema) {
   AtomicWord rowset_idx = Barrier_AtomicIncrement(&next_rowset_idx_, 1) - 1;
@@ -209,6 +209,20 @@ class TabletMetadata : public RefCountedThreadSafe<TabletMetadata> {
 
   consensus::OpId tombstone_last_logged_opid() const { return tombstone_last_logged_opid_; }
 
+  // Records that the tablet was split at 'split_partition_key' into the
+  // tablets 'child_tablet_ids', which own the blocks of its rowsets from
+  // then on, and flushes the superblock. The blocks of the rowsets are not
+  // deleted along with the tablet from then on.
+  Status SetSplitAndFlush(const std::string& split_partition_key,
+                          const std::vector<std::string>& child_tablet_ids);
+
+  // Returns true if the tablet has been split, along with the split
+  // partition key and the tablets it was split into.
+  bool GetSplit(std::string* split_partition_key,
+                std::vector<std::string>* child_tablet_ids) const;
+
+  bool has_been_split() const;
+
   // Loads the currently-flushed superblock from disk into the given protobuf.
   Status ReadSuperBlockFromDisk(TabletSuperBlockPB* superblock) const;
 
@@ -332,6 +346,11 @@ class TabletMetadata : public RefCountedThreadSafe<TabletMetadata> {
   // tombstoned. Has no meaning for non-tombstoned tablets.
   consensus::OpId tombstone_last_logged_opid_;
 
+  // The tablets this tablet was split into, if any, and the partition key
+  // they were split at. Protected by 'data_lock_'.
+  std::vector<std::string> split_child_tablet_ids_;
+  std::string split_partition_key_;
+
   // If this counter is > 0 then Flush() will not write any data to
   // disk.
   int32_t num_flush_pins_;
@@ -87,6 +87,21 @@ METRIC_DEFINE_counter(tablet, scanner_bytes_scanned_from_disk, "Scanner Bytes Sc
                       "and does not include data read from in-memory stores. However, it"
                       "includes both cache misses and cache hits.");
 
+METRIC_DEFINE_counter(tablet, scanner_cfile_cache_hit_bytes, "Scanner CFile Cache Hit Bytes",
+                      kudu::MetricUnit::kBytes,
+                      "Number of bytes of CFile blocks read by scan requests from the "
+                      "block cache.");
+
+METRIC_DEFINE_counter(tablet, scanner_cfile_cache_miss_bytes, "Scanner CFile Cache Miss Bytes",
+                      kudu::MetricUnit::kBytes,
+                      "Number of bytes of CFile blocks read by scan requests from disk "
+                      "because they were not in the block cache.");
+
+METRIC_DEFINE_counter(tablet, scanner_cpu_time_us, "Scanner CPU Time",
+                      kudu::MetricUnit::kMicroseconds,
+                      "Total CPU time spent by scan requests reading, filtering and "
+                      "collecting the rows of this tablet.");
+
 
 METRIC_DEFINE_counter(tablet, insertions_failed_dup_key, "Duplicate Key Inserts",
                       kudu::MetricUnit::kRows,
@@ -111,6 +126,11 @@ METRIC_DEFINE_counter(tablet, bytes_flushed, "Bytes Flushed",
                       kudu::MetricUnit::kBytes,
                       "Amount of data that has been flushed to disk by this tablet.");
 
+METRIC_DEFINE_counter(tablet, compact_rs_bytes_read, "RowSet Compaction Bytes Read",
+                      kudu::MetricUnit::kBytes,
+                      "Estimated on-disk size of the rowsets read by this tablet's rowset "
+                      "compactions. The data they write is counted in Bytes Flushed.");
+
 METRIC_DEFINE_histogram(tablet, bloom_lookups_per_op, "Bloom Lookups per Operation",
                         kudu::MetricUnit::kProbes,
                         "Tracks the number of bloom filter lookups performed by each "
@@ -157,6 +177,27 @@ METRIC_DEFINE_histogram(tablet, snapshot_read_inflight_wait_duration,
   "Time spent waiting for in-flight writes to complete for READ_AT_SNAPSHOT scans.",
   60000000LU, 2);
 
+METRIC_DEFINE_histogram(tablet, row_lock_wait_duration,
+  "Row Lock Wait Duration",
+  kudu::MetricUnit::kMicroseconds,
+  "Time spent by write operations waiting for row locks held by other "
+  "transactions on this tablet. Uncontended lock acquisitions are not included.",
+  60000000LU, 2);
+
+METRIC_DEFINE_histogram(tablet, write_op_prepare_duration,
+  "Write Op Prepare Duration",
+  kudu::MetricUnit::kMicroseconds,
+  "Time spent by write operations led by this tablet decoding their rows and "
+  "acquiring row locks before being started.",
+  60000000LU, 2);
+
+METRIC_DEFINE_histogram(tablet, write_op_replication_duration,
+  "Write Op Replication Duration",
+  kudu::MetricUnit::kMicroseconds,
+  "Time from the submission of write operations led by this tablet to consensus "
+  "until they were replicated to a majority of the tablet's replicas.",
+  60000000LU, 2);
+
 METRIC_DEFINE_gauge_uint32(tablet, flush_dms_running,
   "DeltaMemStore Flushes Running",
   kudu::MetricUnit::kMaintenanceOperations,
@@ -182,6 +223,16 @@ METRIC_DEFINE_gauge_uint32(tablet, delta_major_compact_rs_running,
   kudu::MetricUnit::kMaintenanceOperations,
   "Number of delta major compactions currently running.");
 
+METRIC_DEFINE_gauge_uint32(tablet, undo_delta_block_gc_running,
+  "Undo Delta Block GC Running",
+  kudu::MetricUnit::kMaintenanceOperations,
+  "Number of UNDO delta block GC operations currently running.");
+
+METRIC_DEFINE_gauge_uint32(tablet, expired_rowset_gc_running,
+  "Expired RowSet GC Running",
+  kudu::MetricUnit::kMaintenanceOperations,
+  "Number of expired rowset GC operations currently running.");
+
 METRIC_DEFINE_histogram(tablet, flush_dms_duration,
   "DeltaMemStore Flush Duration",
   kudu::MetricUnit::kMilliseconds,
@@ -207,11 +258,39 @@ METRIC_DEFINE_histogram(tablet, delta_major_compact_rs_duration,
   kudu::MetricUnit::kSeconds,
   "Seconds spent major delta compacting.", 60000000LU, 2);
 
+METRIC_DEFINE_histogram(tablet, undo_delta_block_gc_perform_duration,
+  "Undo Delta Block GC Perform Duration",
+  kudu::MetricUnit::kMilliseconds,
+  "Time spent deleting ancient UNDO delta blocks.", 60000LU, 1);
+
+METRIC_DEFINE_counter(tablet, undo_delta_block_gc_bytes_deleted,
+  "Undo Delta Block GC Bytes Deleted",
+  kudu::MetricUnit::kBytes,
+  "Number of bytes in the UNDO delta blocks deleted because all of their "
+  "history was older than the ancient history mark.");
+
+METRIC_DEFINE_histogram(tablet, expired_rowset_gc_perform_duration,
+  "Expired RowSet GC Perform Duration",
+  kudu::MetricUnit::kMilliseconds,
+  "Time spent deleting rowsets whose rows have all expired.", 60000LU, 1);
+
+METRIC_DEFINE_counter(tablet, expired_rowset_gc_bytes_deleted,
+  "Expired RowSet GC Bytes Deleted",
+  kudu::MetricUnit::kBytes,
+  "Number of bytes in the rowsets deleted because all of their rows had "
+  "expired.");
+
 METRIC_DEFINE_counter(tablet, leader_memory_pressure_rejections,
   "Leader Memory Pressure Rejections",
   kudu::MetricUnit::kRequests,
   "Number of RPC requests rejected due to memory pressure while LEADER.");
 
+METRIC_DEFINE_counter(tablet, leader_write_admission_rejections,
+  "Leader Write Admission Rejections",
+  kudu::MetricUnit::kRequests,
+  "Number of write RPC requests rejected while LEADER because the tablet took in "
+  "data faster than its flushes or its WAL could keep up with.");
+
 using strings::Substitute;
 using std::unordered_map;
 
@@ -233,17 +312,24 @@ TabletMetrics::TabletMetrics(const scoped_refptr<MetricEntity>& entity)
     MINIT(scanner_rows_scanned),
     MINIT(scanner_cells_scanned_from_disk),
     MINIT(scanner_bytes_scanned_from_disk),
+    MINIT(scanner_cfile_cache_hit_bytes),
+    MINIT(scanner_cfile_cache_miss_bytes),
+    MINIT(scanner_cpu_time_us),
     MINIT(scans_started),
     MINIT(bloom_lookups),
     MINIT(key_file_lookups),
     MINIT(delta_file_lookups),
     MINIT(mrs_lookups),
     MINIT(bytes_flushed),
+    MINIT(compact_rs_bytes_read),
     MINIT(bloom_lookups_per_op),
     MINIT(key_file_lookups_per_op),
     MINIT(delta_file_lookups_per_op),
     MINIT(commit_wait_duration),
     MINIT(snapshot_read_inflight_wait_duration),
+    MINIT(row_lock_wait_duration),
+    MINIT(write_op_prepare_duration),
+    MINIT(write_op_replication_duration),
     MINIT(write_op_duration_client_propagated_consistency),
     MINIT(write_op_duration_commit_wait_consistency),
     GINIT(flush_dms_running),
@@ -251,12 +337,19 @@ TabletMetrics::TabletMetrics(const scoped_refptr<MetricEntity>& entity)
     GINIT(compact_rs_running),
     GINIT(delta_minor_compact_rs_running),
     GINIT(delta_major_compact_rs_running),
+    GINIT(undo_delta_block_gc_running),
+    GINIT(expired_rowset_gc_running),
     MINIT(flush_dms_duration),
     MINIT(flush_mrs_duration),
     MINIT(compact_rs_duration),
     MINIT(delta_minor_compact_rs_duration),
     MINIT(delta_major_compact_rs_duration),
-    MINIT(leader_memory_pressure_rejections) {
+    MINIT(undo_delta_block_gc_perform_duration),
+    MINIT(undo_delta_block_gc_bytes_deleted),
+    MINIT(expired_rowset_gc_perform_duration),
+    MINIT(expired_rowset_gc_bytes_deleted),
+    MINIT(leader_memory_pressure_rejections),
+    MINIT(leader_write_admission_rejections) {
 }
 #undef MINIT
 #undef GINIT
@@ -57,6 +57,9 @@ struct TabletMetrics {
   scoped_refptr<Counter> scanner_rows_scanned;
   scoped_refptr<Counter> scanner_cells_scanned_from_disk;
   scoped_refptr<Counter> scanner_bytes_scanned_from_disk;
+  scoped_refptr<Counter> scanner_cfile_cache_hit_bytes;
+  scoped_refptr<Counter> scanner_cfile_cache_miss_bytes;
+  scoped_refptr<Counter> scanner_cpu_time_us;
   scoped_refptr<Counter> scans_started;
 
   // Probe stats
@@ -65,6 +68,7 @@ struct TabletMetrics {
   scoped_refptr<Counter> delta_file_lookups;
   scoped_refptr<Counter> mrs_lookups;
   scoped_refptr<Counter> bytes_flushed;
+  scoped_refptr<Counter> compact_rs_bytes_read;
 
   scoped_refptr<Histogram> bloom_lookups_per_op;
   scoped_refptr<Histogram> key_file_lookups_per_op;
@@ -72,6 +76,9 @@ struct TabletMetrics {
 
   scoped_refptr<Histogram> commit_wait_duration;
   scoped_refptr<Histogram> snapshot_read_inflight_wait_duration;
+  scoped_refptr<Histogram> row_lock_wait_duration;
+  scoped_refptr<Histogram> write_op_prepare_duration;
+  scoped_refptr<Histogram> write_op_replication_duration;
   scoped_refptr<Histogram> write_op_duration_client_propagated_consistency;
   scoped_refptr<Histogram> write_op_duration_commit_wait_consistency;
 
@@ -80,14 +87,23 @@ struct TabletMetrics {
   scoped_refptr<AtomicGauge<uint32_t> > compact_rs_running;
   scoped_refptr<AtomicGauge<uint32_t> > delta_minor_compact_rs_running;
   scoped_refptr<AtomicGauge<uint32_t> > delta_major_compact_rs_running;
+  scoped_refptr<AtomicGauge<uint32_t> > undo_delta_block_gc_running;
+  scoped_refptr<AtomicGauge<uint32_t> > expired_rowset_gc_running;
 
   scoped_refptr<Histogram> flush_dms_duration;
   scoped_refptr<Histogram> flush_mrs_duration;
   scoped_refptr<Histogram> compact_rs_duration;
   scoped_refptr<Histogram> delta_minor_compact_rs_duration;
   scoped_refptr<Histogram> delta_major_compact_rs_duration;
+  scoped_refptr<Histogram> undo_delta_block_gc_perform_duration;
+
+  scoped_refptr<Counter> undo_delta_block_gc_bytes_deleted;
+
+  scoped_refptr<Histogram> expired_rowset_gc_perform_duration;
+  scoped_refptr<Counter> expired_rowset_gc_bytes_deleted;
 
   scoped_refptr<Counter> leader_memory_pressure_rejections;
+  scoped_refptr<Counter> leader_write_admission_rejections;
 };
 
 } // namespace tablet
@@ -114,6 +114,53 @@ class MajorDeltaCompactionOp : public MaintenanceOp {
   Tablet* const tablet_;
 };
 
+// MaintenanceOp to delete UNDO delta files which are entirely older than
+// the ancient history mark.
+//
+// Unlike a major delta compaction, this doesn't rewrite any data: it only
+// drops whole files, so it's cheap enough to run whenever there's something
+// to reclaim.
+class UndoDeltaBlockGCOp : public MaintenanceOp {
+ public:
+  explicit UndoDeltaBlockGCOp(Tablet* tablet);
+
+  virtual void UpdateStats(MaintenanceOpStats* stats) OVERRIDE;
+
+  virtual bool Prepare() OVERRIDE;
+
+  virtual void Perform() OVERRIDE;
+
+  virtual scoped_refptr<Histogram> DurationHistogram() const OVERRIDE;
+
+  virtual scoped_refptr<AtomicGauge<uint32_t> > RunningGauge() const OVERRIDE;
+
+ private:
+  Tablet* const tablet_;
+};
+
+// MaintenanceOp to delete the rowsets of a tablet with a row TTL whose rows
+// have all expired.
+//
+// Like UndoDeltaBlockGCOp, this only drops whole rowsets rather than
+// compacting away the expired rows, so it doesn't rewrite any data.
+class ExpiredRowSetGCOp : public MaintenanceOp {
+ public:
+  explicit ExpiredRowSetGCOp(Tablet* tablet);
+
+  virtual void UpdateStats(MaintenanceOpStats* stats) OVERRIDE;
+
+  virtual bool Prepare() OVERRIDE;
+
+  virtual void Perform() OVERRIDE;
+
+  virtual scoped_refptr<Histogram> DurationHistogram() const OVERRIDE;
+
+  virtual scoped_refptr<AtomicGauge<uint32_t> > RunningGauge() const OVERRIDE;
+
+ private:
+  Tablet* const tablet_;
+};
+
 } // namespace tablet
 } // namespace kudu
 
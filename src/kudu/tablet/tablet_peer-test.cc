@@ -90,6 +90,7 @@ class TabletPeerTest : public KuduTabletTest {
   virtual void SetUp() OVERRIDE {
     KuduTabletTest::SetUp();
 
+    ASSERT_OK(ThreadPoolBuilder("prepare").Build(&prepare_pool_));
     ASSERT_OK(ThreadPoolBuilder("apply").Build(&apply_pool_));
 
     rpc::MessengerBuilder builder(CURRENT_TEST_NAME());
@@ -107,6 +108,7 @@ class TabletPeerTest : public KuduTabletTest {
     tablet_peer_.reset(
       new TabletPeer(make_scoped_refptr(tablet()->metadata()),
                      config_peer,
+                     prepare_pool_.get(),
                      apply_pool_.get(),
                      Bind(&TabletPeerTest::TabletPeerStateChangedCallback,
                           Unretained(this),
@@ -137,6 +139,8 @@ class TabletPeerTest : public KuduTabletTest {
     ASSERT_OK(tablet_peer_->Init(tablet(),
                                  clock(),
                                  messenger_,
+                                 nullptr,
+                                 nullptr,
                                  scoped_refptr<rpc::ResultTracker>(),
                                  log,
                                  metric_entity_));
@@ -154,6 +158,7 @@ class TabletPeerTest : public KuduTabletTest {
 
   virtual void TearDown() OVERRIDE {
     tablet_peer_->Shutdown();
+    prepare_pool_->Shutdown();
     apply_pool_->Shutdown();
     KuduTabletTest::TearDown();
   }
@@ -262,6 +267,7 @@ class TabletPeerTest : public KuduTabletTest {
   scoped_refptr<MetricEntity> metric_entity_;
   shared_ptr<Messenger> messenger_;
   scoped_refptr<TabletPeer> tablet_peer_;
+  gscoped_ptr<ThreadPool> prepare_pool_;
   gscoped_ptr<ThreadPool> apply_pool_;
 };
 
@@ -43,6 +43,7 @@
 #include "kudu/rpc/service_pool.h"
 #include "kudu/tablet/transactions/transaction_driver.h"
 #include "kudu/tablet/transactions/alter_schema_transaction.h"
+#include "kudu/tablet/transactions/write_coalescer.h"
 #include "kudu/tablet/transactions/write_transaction.h"
 #include "kudu/tablet/tablet_bootstrap.h"
 #include "kudu/tablet/tablet_metrics.h"
@@ -105,6 +106,7 @@ using tserver::TabletServerErrorPB;
 // ============================================================================
 TabletPeer::TabletPeer(const scoped_refptr<TabletMetadata>& meta,
                        const consensus::RaftPeerPB& local_peer_pb,
+                       ThreadPool* prepare_pool,
                        ThreadPool* apply_pool,
                        Callback<void(const std::string& reason)> mark_dirty_clbk)
     : meta_(meta),
@@ -112,9 +114,11 @@ TabletPeer::TabletPeer(const scoped_refptr<TabletMetadata>& meta,
       local_peer_pb_(local_peer_pb),
       state_(NOT_STARTED),
       last_status_("Tablet initializing..."),
+      prepare_pool_(prepare_pool),
       apply_pool_(apply_pool),
       log_anchor_registry_(new LogAnchorRegistry()),
-      mark_dirty_clbk_(std::move(mark_dirty_clbk)) {}
+      mark_dirty_clbk_(std::move(mark_dirty_clbk)),
+      write_coalescer_(new WriteCoalescer(this)) {}
 
 TabletPeer::~TabletPeer() {
   std::lock_guard<simple_spinlock> lock(lock_);
@@ -128,6 +132,8 @@ TabletPeer::~TabletPeer() {
 Status TabletPeer::Init(const shared_ptr<Tablet>& tablet,
                         const scoped_refptr<server::Clock>& clock,
                         const shared_ptr<Messenger>& messenger,
+                        consensus::MultiRaftHeartbeatBatcher* heartbeat_batcher,
+                        ThreadPool* raft_pool,
                         const scoped_refptr<ResultTracker>& result_tracker,
                         const scoped_refptr<Log>& log,
                         const scoped_refptr<MetricEntity>& metric_entity) {
@@ -135,13 +141,14 @@ Status TabletPeer::Init(const shared_ptr<Tablet>& tablet,
   DCHECK(tablet) << "A TabletPeer must be provided with a Tablet";
   DCHECK(log) << "A TabletPeer must be provided with a Log";
 
-  RETURN_NOT_OK(ThreadPoolBuilder("prepare").set_max_threads(1).Build(&prepare_pool_));
-  prepare_pool_->SetQueueLengthHistogram(
+  prepare_pool_token_ = prepare_pool_->NewToken(ThreadPool::ExecutionMode::SERIAL);
+  prepare_pool_token_->SetQueueLengthHistogram(
       METRIC_op_prepare_queue_length.Instantiate(metric_entity));
-  prepare_pool_->SetQueueTimeMicrosHistogram(
+  prepare_pool_token_->SetQueueTimeMicrosHistogram(
       METRIC_op_prepare_queue_time.Instantiate(metric_entity));
-  prepare_pool_->SetRunTimeMicrosHistogram(
+  prepare_pool_token_->SetRunTimeMicrosHistogram(
       METRIC_op_prepare_run_time.Instantiate(metric_entity));
+  apply_pool_token_ = apply_pool_->NewToken(ThreadPool::ExecutionMode::CONCURRENT);
 
   {
     std::lock_guard<simple_spinlock> lock(lock_);
@@ -168,6 +175,8 @@ Status TabletPeer::Init(const shared_ptr<Tablet>& tablet,
                                        clock_,
                                        this,
                                        messenger_,
+                                       heartbeat_batcher,
+                                       raft_pool,
                                        log_.get(),
                                        tablet_->mem_tracker(),
                                        mark_dirty_clbk_);
@@ -240,8 +249,11 @@ void TabletPeer::Shutdown() {
     txn_tracker_.WaitForAllToFinish();
   }
 
-  if (prepare_pool_) {
-    prepare_pool_->Shutdown();
+  if (prepare_pool_token_) {
+    prepare_pool_token_->Shutdown();
+  }
+  if (apply_pool_token_) {
+    apply_pool_token_->Shutdown();
   }
 
   if (log_) {
@@ -374,6 +386,16 @@ Status TabletPeer::RunLogGC() {
   return Status::OK();
 }
 
+Status TabletPeer::CheckpointMemRowSet() {
+  RETURN_NOT_OK(CheckRunning());
+  // Every transaction before the clean timestamp has committed; once the log
+  // is flushed, so are their COMMIT messages.
+  Timestamp timestamp = tablet_->mvcc_manager()->GetCleanTimestamp();
+  RETURN_NOT_OK(log_->WaitUntilAllFlushed());
+  return tablet_->CheckpointMemRowSet(
+      meta_->fs_manager()->GetTabletMrsCheckpointPath(tablet_id()), timestamp);
+}
+
 void TabletPeer::StatusMessage(const std::string& status) {
   std::lock_guard<simple_spinlock> lock(lock_);
   last_status_ = status;
@@ -487,6 +509,26 @@ Status TabletPeer::GetGCableDataSize(int64_t* retention_size) const {
   return Status::OK();
 }
 
+Timestamp TabletPeer::GetSafeTimeForReplicas() {
+  Timestamp safe_time;
+  if (!tablet_->mvcc_manager()->GetSafeTimeForReplicas(&safe_time).ok()) {
+    return Timestamp::kInvalidTimestamp;
+  }
+  return safe_time;
+}
+
+void TabletPeer::AdvanceSafeTime(Timestamp safe_time) {
+  // Replica transactions start on the serial prepare token, so queueing the
+  // adjustment behind them makes it take effect only after they started.
+  shared_ptr<Tablet> tablet = tablet_;
+  Status s = prepare_pool_token_->SubmitFunc([tablet, safe_time]() {
+      tablet->mvcc_manager()->OfflineAdjustSafeTime(safe_time);
+    });
+  if (PREDICT_FALSE(!s.ok())) {
+    VLOG(1) << "T " << tablet_id() << ": could not advance the safe time: " << s.ToString();
+  }
+}
+
 Status TabletPeer::StartReplicaTransaction(const scoped_refptr<ConsensusRound>& round) {
   {
     std::lock_guard<simple_spinlock> lock(lock_);
@@ -552,8 +594,8 @@ Status TabletPeer::NewLeaderTransactionDriver(gscoped_ptr<Transaction> transacti
     &txn_tracker_,
     consensus_.get(),
     log_.get(),
-    prepare_pool_.get(),
-    apply_pool_,
+    prepare_pool_token_.get(),
+    apply_pool_token_.get(),
     &txn_order_verifier_);
   RETURN_NOT_OK(tx_driver->Init(std::move(transaction), consensus::LEADER));
   driver->swap(tx_driver);
@@ -567,8 +609,8 @@ Status TabletPeer::NewReplicaTransactionDriver(gscoped_ptr<Transaction> transact
     &txn_tracker_,
     consensus_.get(),
     log_.get(),
-    prepare_pool_.get(),
-    apply_pool_,
+    prepare_pool_token_.get(),
+    apply_pool_token_.get(),
     &txn_order_verifier_);
   RETURN_NOT_OK(tx_driver->Init(std::move(transaction), consensus::REPLICA));
   driver->swap(tx_driver);
@@ -601,6 +643,10 @@ void TabletPeer::RegisterMaintenanceOps(MaintenanceManager* maint_mgr) {
   maint_mgr->RegisterOp(log_gc.get());
   maintenance_ops_.push_back(log_gc.release());
 
+  gscoped_ptr<MaintenanceOp> mrs_checkpoint_op(new CheckpointMRSOp(this));
+  maint_mgr->RegisterOp(mrs_checkpoint_op.get());
+  maintenance_ops_.push_back(mrs_checkpoint_op.release());
+
   tablet_->RegisterMaintenanceOps(maint_mgr);
 }
 
@@ -36,6 +36,10 @@
 
 namespace kudu {
 
+namespace consensus {
+class MultiRaftHeartbeatBatcher;
+}
+
 namespace log {
 class LogAnchorRegistry;
 }
@@ -51,6 +55,8 @@ class CatchUpServiceTest;
 
 class MaintenanceManager;
 class MaintenanceOp;
+class ThreadPool;
+class ThreadPoolToken;
 
 namespace tablet {
 class LeaderTransactionDriver;
@@ -59,6 +65,7 @@ class TabletPeer;
 class TabletStatusPB;
 class TabletStatusListener;
 class TransactionDriver;
+class WriteCoalescer;
 
 // Interface by which various tablet-related processes can report back their status
 // to TabletPeer without having to have a circular class dependency, and so that
@@ -82,14 +89,19 @@ class TabletPeer : public RefCountedThreadSafe<TabletPeer>,
   typedef std::map<int64_t, int64_t> MaxIdxToSegmentSizeMap;
 
   TabletPeer(const scoped_refptr<TabletMetadata>& meta,
-             const consensus::RaftPeerPB& local_peer_pb, ThreadPool* apply_pool,
+             const consensus::RaftPeerPB& local_peer_pb,
+             ThreadPool* prepare_pool,
+             ThreadPool* apply_pool,
              Callback<void(const std::string& reason)> mark_dirty_clbk);
 
   // Initializes the TabletPeer, namely creating the Log and initializing
-  // Consensus.
+  // Consensus. 'heartbeat_batcher' and 'raft_pool' may be null; see
+  // RaftConsensus::Create().
   Status Init(const std::shared_ptr<tablet::Tablet>& tablet,
               const scoped_refptr<server::Clock>& clock,
               const std::shared_ptr<rpc::Messenger>& messenger,
+              consensus::MultiRaftHeartbeatBatcher* heartbeat_batcher,
+              ThreadPool* raft_pool,
               const scoped_refptr<rpc::ResultTracker>& result_tracker,
               const scoped_refptr<log::Log>& log,
               const scoped_refptr<MetricEntity>& metric_entity);
@@ -116,6 +128,10 @@ class TabletPeer : public RefCountedThreadSafe<TabletPeer>,
   // MvccManager.
   Status SubmitWrite(std::unique_ptr<WriteTransactionState> tx_state);
 
+  // Returns the coalescer which merges the small writes submitted to this
+  // tablet at about the same time. Only used if WriteCoalescer::IsEnabled().
+  WriteCoalescer* write_coalescer() { return write_coalescer_.get(); }
+
   // Called by the tablet service to start an alter schema transaction.
   //
   // The transaction contains all the information required to execute the
@@ -135,6 +151,13 @@ class TabletPeer : public RefCountedThreadSafe<TabletPeer>,
   virtual Status StartReplicaTransaction(
       const scoped_refptr<consensus::ConsensusRound>& round) OVERRIDE;
 
+  // Used by consensus on leaders to obtain the safe time for followers.
+  virtual Timestamp GetSafeTimeForReplicas() OVERRIDE;
+
+  // Used by consensus on followers to advance the safe time once the leader's
+  // committed transactions are known to have started.
+  virtual void AdvanceSafeTime(Timestamp safe_time) OVERRIDE;
+
   consensus::Consensus* consensus() {
     std::lock_guard<simple_spinlock> lock(lock_);
     return consensus_.get();
@@ -155,6 +178,11 @@ class TabletPeer : public RefCountedThreadSafe<TabletPeer>,
     return tablet_;
   }
 
+  std::shared_ptr<rpc::Messenger> messenger() const {
+    std::lock_guard<simple_spinlock> lock(lock_);
+    return messenger_;
+  }
+
   const TabletStatePB state() const {
     std::lock_guard<simple_spinlock> lock(lock_);
     return state_;
@@ -246,6 +274,10 @@ class TabletPeer : public RefCountedThreadSafe<TabletPeer>,
   // Tells the tablet's log to garbage collect.
   Status RunLogGC();
 
+  // Checkpoints the tablet's MemRowSet as of the current clean timestamp, so
+  // that bootstrap needn't replay the operations it holds.
+  Status CheckpointMemRowSet();
+
   // Register the maintenance ops associated with this peer's tablet, also invokes
   // Tablet::RegisterMaintenanceOps().
   void RegisterMaintenanceOps(MaintenanceManager* maintenance_manager);
@@ -316,18 +348,22 @@ class TabletPeer : public RefCountedThreadSafe<TabletPeer>,
   // during them in order to reject RPCs, etc.
   mutable simple_spinlock state_change_lock_;
 
-  // IMPORTANT: correct execution of PrepareTask assumes that 'prepare_pool_'
-  // is single-threaded, moving to a multi-tablet setup where multiple TabletPeers
-  // use the same 'prepare_pool_' needs to enforce that, for a single
-  // TabletPeer, PrepareTasks are executed *serially*.
-  // TODO move the prepare pool to TabletServer.
-  gscoped_ptr<ThreadPool> prepare_pool_;
-
-  // Pool that executes apply tasks for transactions. This is a multi-threaded
-  // pool, constructor-injected by either the Master (for system tables) or
-  // the Tablet server.
+  // Pools that execute prepare and apply tasks for transactions. These are
+  // multi-threaded pools shared by all the tablets of the server,
+  // constructor-injected by either the Master (for system tables) or the
+  // Tablet server.
+  ThreadPool* prepare_pool_;
   ThreadPool* apply_pool_;
 
+  // The tokens this tablet submits its prepare and apply tasks through, so
+  // that a busy tablet can't hold back the tasks of the others.
+  //
+  // IMPORTANT: correct execution of PrepareTask assumes that the prepare
+  // tasks of a single TabletPeer are executed *serially*, which the SERIAL
+  // 'prepare_pool_token_' enforces.
+  std::unique_ptr<ThreadPoolToken> prepare_pool_token_;
+  std::unique_ptr<ThreadPoolToken> apply_pool_token_;
+
   scoped_refptr<server::Clock> clock_;
 
   scoped_refptr<log::LogAnchorRegistry> log_anchor_registry_;
@@ -345,6 +381,8 @@ class TabletPeer : public RefCountedThreadSafe<TabletPeer>,
   // The result tracker for writes.
   scoped_refptr<rpc::ResultTracker> result_tracker_;
 
+  gscoped_ptr<WriteCoalescer> write_coalescer_;
+
   DISALLOW_COPY_AND_ASSIGN(TabletPeer);
 };
 
@@ -35,6 +35,12 @@ DEFINE_int32(flush_threshold_mb, 1024,
              "or if the server-wide memory limit has been reached.");
 TAG_FLAG(flush_threshold_mb, experimental);
 
+DEFINE_int32(mrs_checkpoint_interval_secs, 0,
+             "How often to checkpoint a tablet's MemRowSet, so that the operations "
+             "it holds needn't be replayed when the tablet is bootstrapped. "
+             "0 disables checkpointing.");
+TAG_FLAG(mrs_checkpoint_interval_secs, experimental);
+
 METRIC_DEFINE_gauge_uint32(tablet, log_gc_running,
                            "Log GCs Running",
                            kudu::MetricUnit::kOperations,
@@ -44,6 +50,15 @@ METRIC_DEFINE_histogram(tablet, log_gc_duration,
                         kudu::MetricUnit::kMilliseconds,
                         "Time spent garbage collecting the logs.", 60000LU, 1);
 
+METRIC_DEFINE_gauge_uint32(tablet, checkpoint_mrs_running,
+                           "MemRowSet Checkpoints Running",
+                           kudu::MetricUnit::kMaintenanceOperations,
+                           "Number of MemRowSet checkpoints currently running.");
+METRIC_DEFINE_histogram(tablet, checkpoint_mrs_duration,
+                        "MemRowSet Checkpoint Duration",
+                        kudu::MetricUnit::kMilliseconds,
+                        "Time spent checkpointing MemRowSets.", 60000LU, 1);
+
 namespace kudu {
 namespace tablet {
 
@@ -236,5 +251,66 @@ scoped_refptr<AtomicGauge<uint32_t> > LogGCOp::RunningGauge() const {
   return log_gc_running_;
 }
 
+//
+// CheckpointMRSOp.
+//
+
+CheckpointMRSOp::CheckpointMRSOp(TabletPeer* tablet_peer)
+    : MaintenanceOp(StringPrintf("CheckpointMRSOp(%s)",
+                                 tablet_peer->tablet()->tablet_id().c_str()),
+                    MaintenanceOp::HIGH_IO_USAGE),
+      tablet_peer_(tablet_peer),
+      checkpoint_mrs_duration_(METRIC_checkpoint_mrs_duration.Instantiate(
+                                   tablet_peer->tablet()->GetMetricEntity())),
+      checkpoint_mrs_running_(METRIC_checkpoint_mrs_running.Instantiate(
+                                  tablet_peer->tablet()->GetMetricEntity(), 0)),
+      sem_(1) {
+  time_since_checkpoint_.start();
+}
+
+void CheckpointMRSOp::UpdateStats(MaintenanceOpStats* stats) {
+  std::lock_guard<simple_spinlock> l(lock_);
+  if (FLAGS_mrs_checkpoint_interval_secs <= 0 ||
+      tablet_peer_->tablet()->MemRowSetEmpty()) {
+    return;
+  }
+  double elapsed_ms = time_since_checkpoint_.elapsed().wall_millis();
+  if (elapsed_ms < FLAGS_mrs_checkpoint_interval_secs * 1000.0) {
+    return;
+  }
+  stats->set_runnable(sem_.GetValue() == 1);
+  // A checkpoint only shortens a future bootstrap, so it should lose out to
+  // anything that improves performance now.
+  stats->set_perf_improvement(0.01);
+}
+
+bool CheckpointMRSOp::Prepare() {
+  return sem_.try_lock();
+}
+
+void CheckpointMRSOp::Perform() {
+  CHECK(!sem_.try_lock());
+
+  Status s = tablet_peer_->CheckpointMemRowSet();
+  if (!s.ok()) {
+    LOG(WARNING) << "Failed to checkpoint MemRowSet of tablet " << tablet_peer_->tablet_id()
+                 << ": " << s.ToString();
+  }
+  {
+    std::lock_guard<simple_spinlock> l(lock_);
+    time_since_checkpoint_.start();
+  }
+
+  sem_.unlock();
+}
+
+scoped_refptr<Histogram> CheckpointMRSOp::DurationHistogram() const {
+  return checkpoint_mrs_duration_;
+}
+
+scoped_refptr<AtomicGauge<uint32_t> > CheckpointMRSOp::RunningGauge() const {
+  return checkpoint_mrs_running_;
+}
+
 }  // namespace tablet
 }  // namespace kudu
@@ -62,6 +62,8 @@ class FlushMRSOp : public MaintenanceOp {
 
   virtual scoped_refptr<AtomicGauge<uint32_t> > RunningGauge() const OVERRIDE;
 
+  virtual Lane lane() const OVERRIDE { return FLUSH_LANE; }
+
  private:
   // Lock protecting time_since_flush_.
   mutable simple_spinlock lock_;
@@ -94,6 +96,8 @@ class FlushDeltaMemStoresOp : public MaintenanceOp {
 
   virtual scoped_refptr<AtomicGauge<uint32_t> > RunningGauge() const OVERRIDE;
 
+  virtual Lane lane() const OVERRIDE { return FLUSH_LANE; }
+
  private:
   // Lock protecting time_since_flush_
   mutable simple_spinlock lock_;
@@ -127,6 +131,38 @@ class LogGCOp : public MaintenanceOp {
   mutable Semaphore sem_;
 };
 
+// Maintenance task that checkpoints the MemRowSet, so that the operations it
+// holds needn't be replayed at bootstrap. Runs every
+// --mrs_checkpoint_interval_secs while the MemRowSet is non-empty.
+//
+// Only one CheckpointMRSOp can run at a time.
+class CheckpointMRSOp : public MaintenanceOp {
+ public:
+  explicit CheckpointMRSOp(TabletPeer* tablet_peer);
+
+  virtual void UpdateStats(MaintenanceOpStats* stats) OVERRIDE;
+
+  virtual bool Prepare() OVERRIDE;
+
+  virtual void Perform() OVERRIDE;
+
+  virtual scoped_refptr<Histogram> DurationHistogram() const OVERRIDE;
+
+  virtual scoped_refptr<AtomicGauge<uint32_t> > RunningGauge() const OVERRIDE;
+
+  virtual Lane lane() const OVERRIDE { return FLUSH_LANE; }
+
+ private:
+  TabletPeer *const tablet_peer_;
+  scoped_refptr<Histogram> checkpoint_mrs_duration_;
+  scoped_refptr<AtomicGauge<uint32_t> > checkpoint_mrs_running_;
+  mutable Semaphore sem_;
+
+  // Lock protecting time_since_checkpoint_.
+  mutable simple_spinlock lock_;
+  Stopwatch time_since_checkpoint_;
+};
+
 } // namespace tablet
 } // namespace kudu
 
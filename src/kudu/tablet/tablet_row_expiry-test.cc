@@ -0,0 +1,148 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <cstdint>
+#include <memory>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include "kudu/common/partial_row.h"
+#include "kudu/common/schema.h"
+#include "kudu/gutil/casts.h"
+#include "kudu/gutil/walltime.h"
+#include "kudu/server/hybrid_clock.h"
+#include "kudu/tablet/local_tablet_writer.h"
+#include "kudu/tablet/tablet-test-util.h"
+#include "kudu/tablet/tablet.h"
+#include "kudu/util/test_macros.h"
+
+DECLARE_int32(tablet_history_max_age_sec);
+DECLARE_bool(use_mock_wall_clock);
+
+using kudu::server::HybridClock;
+
+namespace kudu {
+namespace tablet {
+
+// The TTL of the rows of the test tablet, in seconds.
+static const int64_t kTtlSeconds = 2;
+
+// How long the test tablet keeps history for, in seconds.
+static const int32_t kHistoryMaxAgeSec = 60;
+
+class TestTabletRowExpiry : public KuduTabletTest {
+ public:
+  TestTabletRowExpiry()
+   : KuduTabletTest(CreateBaseSchema(), TabletHarness::Options::HYBRID_CLOCK) {
+    FLAGS_use_mock_wall_clock = true;
+    FLAGS_tablet_history_max_age_sec = kHistoryMaxAgeSec;
+  }
+
+  virtual void SetUp() OVERRIDE {
+    NO_FATALS(KuduTabletTest::SetUp());
+    // The mock clock starts at 0, before which nothing can expire.
+    SetNow(GetCurrentTimeMicros());
+  }
+
+ protected:
+  int64_t Now() {
+    return HybridClock::GetPhysicalValueMicros(clock()->Now());
+  }
+
+  void SetNow(int64_t micros) {
+    down_cast<HybridClock*>(clock())->SetMockClockWallTimeForTests(micros);
+  }
+
+  // Inserts the keys [start, start + count) with the given timestamp.
+  void InsertRows(int32_t start, int32_t count, int64_t ts_micros) {
+    LocalTabletWriter writer(tablet().get(), &client_schema_);
+    KuduPartialRow row(&client_schema_);
+    for (int32_t i = start; i < start + count; i++) {
+      ASSERT_OK(row.SetInt32(0, i));
+      ASSERT_OK(row.SetUnixTimeMicros(1, ts_micros));
+      ASSERT_OK(writer.Insert(row));
+    }
+  }
+
+  uint64_t CountRows() {
+    uint64_t count = 0;
+    CHECK_OK(tablet()->CountRows(&count));
+    return count;
+  }
+
+ private:
+  Schema CreateBaseSchema() {
+    ColumnStorageAttributes attrs;
+    attrs.ttl_seconds = kTtlSeconds;
+    return Schema({ ColumnSchema("key", INT32),
+                    ColumnSchema("ts", UNIXTIME_MICROS, false, nullptr, nullptr, attrs) }, 1);
+  }
+};
+
+TEST_F(TestTabletRowExpiry, TestFlushDropsExpiredRows) {
+  const int64_t now = Now();
+  NO_FATALS(InsertRows(0, 10, now - 3600LL * 1000000));
+  NO_FATALS(InsertRows(10, 10, now + 3600LL * 1000000));
+  ASSERT_OK(tablet()->Flush());
+
+  ASSERT_EQ(1, tablet()->num_rowsets());
+  ASSERT_EQ(10, CountRows());
+  ASSERT_EQ(0, tablet()->EstimateBytesInExpiredRowSets());
+}
+
+TEST_F(TestTabletRowExpiry, TestExpiredRowsAndRowSetsAreRemoved) {
+  const int64_t now = Now();
+  const int64_t later = now + 3600LL * 1000000;
+
+  // A rowset with some rows about to expire, one with none, and one with
+  // nothing but rows about to expire.
+  NO_FATALS(InsertRows(0, 10, now));
+  NO_FATALS(InsertRows(10, 10, later));
+  ASSERT_OK(tablet()->Flush());
+  NO_FATALS(InsertRows(20, 10, later));
+  ASSERT_OK(tablet()->Flush());
+  NO_FATALS(InsertRows(30, 10, now));
+  ASSERT_OK(tablet()->Flush());
+  ASSERT_EQ(3, tablet()->num_rowsets());
+  ASSERT_EQ(40, CountRows());
+
+  // Rows which have expired since the ancient history mark may still be
+  // visible to a snapshot scan, so they're kept for now.
+  SetNow(now + (kTtlSeconds + 1) * 1000000);
+  ASSERT_EQ(0, tablet()->EstimateBytesInExpiredRowSets());
+  ASSERT_OK(tablet()->DeleteExpiredRowSets());
+  ASSERT_EQ(3, tablet()->num_rowsets());
+
+  SetNow(now + (kTtlSeconds + kHistoryMaxAgeSec + 1) * 1000000LL);
+
+  // Only the last rowset can be deleted outright.
+  ASSERT_GT(tablet()->EstimateBytesInExpiredRowSets(), 0);
+  ASSERT_OK(tablet()->DeleteExpiredRowSets());
+  ASSERT_EQ(2, tablet()->num_rowsets());
+  ASSERT_EQ(0, tablet()->EstimateBytesInExpiredRowSets());
+  ASSERT_EQ(30, CountRows());
+
+  // Compacting the rest drops the remaining expired rows.
+  ASSERT_OK(tablet()->Compact(Tablet::FORCE_COMPACT_ALL));
+  ASSERT_EQ(1, tablet()->num_rowsets());
+  ASSERT_EQ(20, CountRows());
+}
+
+} // namespace tablet
+} // namespace kudu
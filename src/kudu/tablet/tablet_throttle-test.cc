@@ -61,6 +61,33 @@ TEST_F(TestTabletThrottle, TestThrottle) {
   ASSERT_FALSE(t->ShouldThrottleAllow(1));
 }
 
+TEST_F(TestTabletThrottle, TestAdmissionControlWalPressure) {
+  std::shared_ptr<Tablet> t = this->tablet();
+  MonoDelta retry_after;
+
+  // An idle tablet with a mostly empty WAL queue admits every write.
+  for (int i = 0; i < 100; i++) {
+    ASSERT_TRUE(t->ShouldAdmitWrite(0.25, &retry_after));
+  }
+
+  // A full WAL queue rejects every write, hinting the longest backoff.
+  for (int i = 0; i < 100; i++) {
+    ASSERT_FALSE(t->ShouldAdmitWrite(1.0, &retry_after));
+    ASSERT_EQ(1000, retry_after.ToMilliseconds());
+  }
+
+  // In between, only some of the writes are rejected, with a shorter hint.
+  int num_rejected = 0;
+  for (int i = 0; i < 1000; i++) {
+    if (!t->ShouldAdmitWrite(0.75, &retry_after)) {
+      num_rejected++;
+      ASSERT_LT(retry_after.ToMilliseconds(), 1000);
+    }
+  }
+  ASSERT_GT(num_rejected, 0);
+  ASSERT_LT(num_rejected, 1000);
+}
+
 } // namespace tablet
 } // namespace kudu
 
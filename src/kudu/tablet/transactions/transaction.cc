@@ -74,7 +74,9 @@ TransactionMetrics::TransactionMetrics()
     successful_upserts(0),
     successful_updates(0),
     successful_deletes(0),
-    commit_wait_duration_usec(0) {
+    commit_wait_duration_usec(0),
+    prepare_duration_usec(0),
+    replication_duration_usec(0) {
 }
 
 void TransactionMetrics::Reset() {
@@ -82,6 +84,8 @@ void TransactionMetrics::Reset() {
   successful_updates = 0;
   successful_deletes = 0;
   commit_wait_duration_usec = 0;
+  prepare_duration_usec = 0;
+  replication_duration_usec = 0;
 }
 
 
@@ -50,6 +50,8 @@ struct TransactionMetrics {
   int successful_updates;
   int successful_deletes;
   uint64_t commit_wait_duration_usec;
+  uint64_t prepare_duration_usec;
+  uint64_t replication_duration_usec;
 };
 
 // Base class for transactions.
@@ -104,6 +106,17 @@ class Transaction {
   // transaction can't be cancelled without issuing an abort message.
   virtual Status Start() = 0;
 
+  // Returns true if this transaction has work to do in
+  // PrepareDuringReplication().
+  virtual bool HasPrepareDuringReplication() const { return false; }
+
+  // Executes the part of the prepare phase which can overlap with
+  // replication. LEADER replicas call this after Start(), once the
+  // transaction has been submitted to consensus, and before Apply().
+  // Since the transaction can no longer be aborted at this point, this must
+  // only do work which Apply() would otherwise redo, eg warming up state.
+  virtual void PrepareDuringReplication() {}
+
   // Executes the Apply() phase of the transaction, the actual actions of
   // this phase depend on the transaction type, but usually this is the
   // method where data-structures are changed.
@@ -21,10 +21,12 @@
 
 #include "kudu/consensus/consensus.h"
 #include "kudu/gutil/strings/strcat.h"
+#include "kudu/rpc/call_breakdown.h"
 #include "kudu/rpc/result_tracker.h"
 #include "kudu/tablet/tablet_peer.h"
 #include "kudu/tablet/transactions/transaction_tracker.h"
 #include "kudu/util/debug-util.h"
+#include "kudu/util/debug/binary_trace.h"
 #include "kudu/util/debug/trace_event.h"
 #include "kudu/util/logging.h"
 #include "kudu/util/threadpool.h"
@@ -84,14 +86,14 @@ class FollowerTransactionCompletionCallback : public TransactionCompletionCallba
 TransactionDriver::TransactionDriver(TransactionTracker *txn_tracker,
                                      Consensus* consensus,
                                      Log* log,
-                                     ThreadPool* prepare_pool,
-                                     ThreadPool* apply_pool,
+                                     ThreadPoolToken* prepare_pool_token,
+                                     ThreadPoolToken* apply_pool_token,
                                      TransactionOrderVerifier* order_verifier)
     : txn_tracker_(txn_tracker),
       consensus_(consensus),
       log_(log),
-      prepare_pool_(prepare_pool),
-      apply_pool_(apply_pool),
+      prepare_pool_token_(prepare_pool_token),
+      apply_pool_token_(apply_pool_token),
       order_verifier_(order_verifier),
       trace_(new Trace()),
       start_time_(MonoTime::Now()),
@@ -186,7 +188,7 @@ Status TransactionDriver::ExecuteAsync() {
   }
 
   if (s.ok()) {
-    s = prepare_pool_->SubmitClosure(
+    s = prepare_pool_token_->SubmitClosure(
       Bind(&TransactionDriver::PrepareAndStartTask, Unretained(this)));
   }
 
@@ -236,12 +238,20 @@ void TransactionDriver::RegisterFollowerTransactionOnResultTracker() {
 
 Status TransactionDriver::PrepareAndStart() {
   TRACE_EVENT1("txn", "PrepareAndStart", "txn", this);
+  BINARY_TRACE_SCOPE(debug::kBinaryTraceWrite, "prepare");
   VLOG_WITH_PREFIX(4) << "PrepareAndStart()";
   // Actually prepare and start the transaction.
   prepare_physical_timestamp_ = GetMonoTimeMicros();
 
   RETURN_NOT_OK(transaction_->Prepare());
   RETURN_NOT_OK(transaction_->Start());
+  mutable_state()->mutable_metrics()->prepare_duration_usec =
+      GetMonoTimeMicros() - prepare_physical_timestamp_;
+
+  // Leaders may finish preparing while the transaction is being replicated.
+  const bool prepare_during_replication =
+      transaction_->type() == consensus::LEADER &&
+      transaction_->HasPrepareDuringReplication();
 
   // Only take the lock long enough to take a local copy of the
   // replication state and set our prepare state. This ensures that
@@ -251,7 +261,9 @@ Status TransactionDriver::PrepareAndStart() {
   {
     std::lock_guard<simple_spinlock> lock(lock_);
     CHECK_EQ(prepare_state_, NOT_PREPARED);
-    prepare_state_ = PREPARED;
+    if (!prepare_during_replication) {
+      prepare_state_ = PREPARED;
+    }
     repl_state_copy = replication_state_;
 
     // If this is a follower transaction we need to register the transaction on the tracker here,
@@ -298,6 +310,16 @@ Status TransactionDriver::PrepareAndStart() {
         replication_state_ = REPLICATION_FAILED;
         return s;
       }
+
+      if (prepare_during_replication) {
+        TRACE_EVENT_FLOW_BEGIN0("txn", "PrepareDuringReplicationTask", this);
+        s = apply_pool_token_->SubmitClosure(
+            Bind(&TransactionDriver::PrepareDuringReplicationTask, Unretained(this)));
+        if (PREDICT_FALSE(!s.ok())) {
+          // The transaction can't be aborted anymore, so finish it here instead.
+          PrepareDuringReplicationTask();
+        }
+      }
       break;
     }
     case REPLICATING:
@@ -320,6 +342,25 @@ Status TransactionDriver::PrepareAndStart() {
   return Status::OK();
 }
 
+void TransactionDriver::PrepareDuringReplicationTask() {
+  TRACE_EVENT_FLOW_END0("txn", "PrepareDuringReplicationTask", this);
+  ADOPT_TRACE(trace());
+  transaction_->PrepareDuringReplication();
+
+  ReplicationState repl_state_copy;
+  {
+    std::lock_guard<simple_spinlock> lock(lock_);
+    CHECK_EQ(prepare_state_, NOT_PREPARED);
+    prepare_state_ = PREPARED;
+    repl_state_copy = replication_state_;
+  }
+
+  // If replication already finished, it left applying the transaction to us.
+  if (repl_state_copy == REPLICATED || repl_state_copy == REPLICATION_FAILED) {
+    CHECK_OK(ApplyAsync());
+  }
+}
+
 void TransactionDriver::HandleFailure(const Status& s) {
   VLOG_WITH_PREFIX(2) << "Failed transaction: " << s.ToString();
   CHECK(!s.ok());
@@ -386,7 +427,12 @@ void TransactionDriver::ReplicationFinished(const Status& status) {
   }
 
 
-  TRACE_COUNTER_INCREMENT("replication_time_us", replication_duration.ToMicroseconds());
+  TRACE_COUNTER_INCREMENT(rpc::kReplicationTimeTraceCounter,
+                          replication_duration.ToMicroseconds());
+  mutable_state()->mutable_metrics()->replication_duration_usec =
+      replication_duration.ToMicroseconds();
+  BINARY_TRACE_ELAPSED(debug::kBinaryTraceWrite, "replicate",
+                       replication_duration.ToMicroseconds(), 0);
 
   // If we have prepared and replicated, we're ready
   // to move ahead and apply this operation.
@@ -444,7 +490,7 @@ Status TransactionDriver::ApplyAsync() {
   }
 
   TRACE_EVENT_FLOW_BEGIN0("txn", "ApplyTask", this);
-  return apply_pool_->SubmitClosure(Bind(&TransactionDriver::ApplyTask, Unretained(this)));
+  return apply_pool_token_->SubmitClosure(Bind(&TransactionDriver::ApplyTask, Unretained(this)));
 }
 
 void TransactionDriver::ApplyTask() {
@@ -463,10 +509,16 @@ void TransactionDriver::ApplyTask() {
 
   {
     gscoped_ptr<CommitMsg> commit_msg;
-    CHECK_OK(transaction_->Apply(&commit_msg));
+    {
+      BINARY_TRACE_SCOPE(debug::kBinaryTraceWrite, "apply");
+      CHECK_OK(transaction_->Apply(&commit_msg));
+    }
     commit_msg->mutable_commited_op_id()->CopyFrom(op_id_copy_);
     SetResponseTimestamp(transaction_->state(), transaction_->state()->timestamp());
 
+    // The commit stage covers queuing the commit message, commit-wait and
+    // releasing the transaction.
+    BINARY_TRACE_SCOPE(debug::kBinaryTraceWrite, "commit");
     {
       TRACE_EVENT1("txn", "AsyncAppendCommit", "txn", this);
       CHECK_OK(log_->AsyncAppendCommit(std::move(commit_msg),
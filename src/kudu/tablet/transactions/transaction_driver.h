@@ -29,7 +29,7 @@
 #include "kudu/util/trace.h"
 
 namespace kudu {
-class ThreadPool;
+class ThreadPoolToken;
 
 namespace log {
 class Log;
@@ -54,7 +54,7 @@ class TransactionTracker;
 //      the operation is already "REPLICATING" (and thus we don't need to
 //      trigger replication ourself later on).
 //
-//  2 - ExecuteAsync() is called. This submits PrepareAndStartTask() to prepare_pool_
+//  2 - ExecuteAsync() is called. This submits PrepareAndStartTask() to prepare_pool_token_
 //      and returns immediately.
 //
 //  3 - PrepareAndStartTask() calls Prepare() and Start() on the transaction.
@@ -63,6 +63,11 @@ class TransactionTracker;
 //      also triggers consensus->Replicate() and changes the replication state to
 //      REPLICATING.
 //
+//      If the transaction has some preparation left which can overlap with
+//      replication (see Transaction::HasPrepareDuringReplication()), a leader
+//      only moves to PREPARED once PrepareDuringReplicationTask() has run it
+//      on the apply_pool_token_.
+//
 //      On the other hand, if we have already successfully replicated (eg we are the
 //      follower and ConsensusCommitted() has already been called, then we can move
 //      on to ApplyAsync().
@@ -73,11 +78,11 @@ class TransactionTracker;
 //      OpId. On followers, this can happen before Prepare() finishes, and thus
 //      we have to check whether we have already done step 3. On leaders, we
 //      don't start the consensus round until after Prepare, so this check always
-//      passes.
+//      passes, unless some of the preparation overlaps with replication.
 //
 //      If Prepare() has already completed, then we trigger ApplyAsync().
 //
-//  5 - ApplyAsync() submits ApplyTask() to the apply_pool_.
+//  5 - ApplyAsync() submits ApplyTask() to the apply_pool_token_.
 //      ApplyTask() calls transaction_->Apply().
 //
 //      When Apply() is called, changes are made to the in-memory data structures. These
@@ -186,8 +191,8 @@ class TransactionDriver : public RefCountedThreadSafe<TransactionDriver> {
   TransactionDriver(TransactionTracker* txn_tracker,
                     consensus::Consensus* consensus,
                     log::Log* log,
-                    ThreadPool* prepare_pool,
-                    ThreadPool* apply_pool,
+                    ThreadPoolToken* prepare_pool_token,
+                    ThreadPoolToken* apply_pool_token,
                     TransactionOrderVerifier* order_verifier);
 
   // Perform any non-constructor initialization. Sets the transaction
@@ -267,6 +272,12 @@ class TransactionDriver : public RefCountedThreadSafe<TransactionDriver> {
   // Actually prepare and start.
   Status PrepareAndStart();
 
+  // The task submitted to the apply threadpool, on leaders, to run
+  // Transaction::PrepareDuringReplication() once replication was triggered.
+  // Moves the transaction to PREPARED and applies it if it has already
+  // replicated.
+  void PrepareDuringReplicationTask();
+
   // Submits ApplyTask to the apply pool.
   Status ApplyAsync();
 
@@ -308,8 +319,8 @@ class TransactionDriver : public RefCountedThreadSafe<TransactionDriver> {
   TransactionTracker* const txn_tracker_;
   consensus::Consensus* const consensus_;
   log::Log* const log_;
-  ThreadPool* const prepare_pool_;
-  ThreadPool* const apply_pool_;
+  ThreadPoolToken* const prepare_pool_token_;
+  ThreadPoolToken* const apply_pool_token_;
   TransactionOrderVerifier* const order_verifier_;
 
   Status transaction_status_;
@@ -0,0 +1,330 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#include "kudu/tablet/transactions/write_coalescer.h"
+
+#include <algorithm>
+#include <string>
+#include <utility>
+
+#include <boost/bind.hpp>
+#include <gflags/gflags.h>
+
+#include "kudu/common/row_operations.h"
+#include "kudu/common/schema.h"
+#include "kudu/common/wire_protocol.h"
+#include "kudu/rpc/messenger.h"
+#include "kudu/tablet/tablet.h"
+#include "kudu/tablet/tablet_peer.h"
+#include "kudu/tablet/transactions/write_transaction.h"
+#include "kudu/tserver/tserver.pb.h"
+#include "kudu/util/flag_tags.h"
+#include "kudu/util/monotime.h"
+#include "kudu/util/trace.h"
+
+DEFINE_int32(write_coalescing_window_us, 0,
+             "How long, in microseconds, the leader of a tablet waits for more "
+             "small writes to arrive before replicating them together as a single "
+             "operation. 0 disables write coalescing.");
+TAG_FLAG(write_coalescing_window_us, experimental);
+TAG_FLAG(write_coalescing_window_us, runtime);
+
+DEFINE_int32(write_coalescing_max_request_bytes, 64 * 1024,
+             "The largest write request, in bytes of row data, which may be "
+             "coalesced with others. Larger requests are replicated on their own.");
+TAG_FLAG(write_coalescing_max_request_bytes, experimental);
+TAG_FLAG(write_coalescing_max_request_bytes, runtime);
+
+DEFINE_int32(write_coalescing_max_batch_bytes, 512 * 1024,
+             "The largest amount of row data, in bytes, which the coalesced write "
+             "requests replicated as a single operation may carry.");
+TAG_FLAG(write_coalescing_max_batch_bytes, experimental);
+TAG_FLAG(write_coalescing_max_batch_bytes, runtime);
+
+namespace kudu {
+namespace tablet {
+
+using rpc::Messenger;
+using rpc::RequestIdPB;
+using std::shared_ptr;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+using tserver::TabletServerErrorPB;
+using tserver::WriteRequestPB;
+using tserver::WriteResponsePB;
+
+struct WriteCoalescer::PendingWrite {
+  const WriteRequestPB* request;
+  WriteResponsePB* response;
+  const RequestIdPB* request_id;
+  gscoped_ptr<TransactionCompletionCallback> callback;
+
+  // The size of the row data of 'request'.
+  uint64_t bytes;
+};
+
+struct WriteCoalescer::Batch {
+  // Whether the writes of the batch were merged into 'request'.
+  bool merged() const {
+    return request.coalesced_requests_size() > 0;
+  }
+
+  // Responds to each of the writes of the batch, with 'status' and 'code'
+  // if the batch failed as a whole.
+  void Complete(const Status& status, TabletServerErrorPB::Code code) {
+    for (int i = 0; i < writes.size(); i++) {
+      PendingWrite* write = writes[i].get();
+      if (merged()) {
+        GetCoalescedWriteResponse(request, response, i, write->response);
+      }
+      if (!status.ok()) {
+        write->callback->set_error(status, code);
+      }
+      write->callback->TransactionCompleted();
+    }
+  }
+
+  vector<unique_ptr<PendingWrite>> writes;
+  uint64_t bytes = 0;
+
+  // The serialized schema of the writes, all of which have the same one.
+  string schema;
+
+  // The merged request of the writes and its response, only used if there is
+  // more than one write in the batch.
+  WriteRequestPB request;
+  WriteResponsePB response;
+};
+
+// Completes the writes of a batch once its transaction completes. The batch
+// is only owned by the callback once it's been called, so that the coalescer
+// can still respond to the writes itself if the transaction never starts.
+class WriteCoalescer::BatchCompletionCallback : public TransactionCompletionCallback {
+ public:
+  explicit BatchCompletionCallback(Batch* batch)
+      : batch_(batch) {
+  }
+
+  virtual void TransactionCompleted() OVERRIDE {
+    unique_ptr<Batch> batch(batch_);
+    batch->Complete(status_, code_);
+  }
+
+ private:
+  Batch* batch_;
+};
+
+WriteCoalescer::WriteCoalescer(TabletPeer* tablet_peer)
+    : tablet_peer_(tablet_peer),
+      flush_scheduled_(false) {
+}
+
+WriteCoalescer::~WriteCoalescer() {
+  std::lock_guard<simple_spinlock> l(lock_);
+  DCHECK(!flush_scheduled_);
+  DCHECK(pending_.empty());
+}
+
+bool WriteCoalescer::IsEnabled() {
+  return FLAGS_write_coalescing_window_us > 0;
+}
+
+bool WriteCoalescer::CanCoalesce(const WriteRequestPB& request, uint64_t bytes) {
+  // Columnar inserts aren't merged, and COMMIT_WAIT writes already wait out
+  // the clock error on their own.
+  return request.has_schema() &&
+      request.row_operations().columnar_inserts_size() == 0 &&
+      request.coalesced_requests_size() == 0 &&
+      request.external_consistency_mode() == CLIENT_PROPAGATED &&
+      bytes <= static_cast<uint64_t>(FLAGS_write_coalescing_max_request_bytes);
+}
+
+void WriteCoalescer::SubmitWrite(const WriteRequestPB* request,
+                                 WriteResponsePB* response,
+                                 const RequestIdPB* request_id,
+                                 gscoped_ptr<TransactionCompletionCallback> callback) {
+  unique_ptr<PendingWrite> write(new PendingWrite);
+  write->request = request;
+  write->response = response;
+  write->request_id = request_id;
+  write->callback = std::move(callback);
+  write->bytes = request->row_operations().rows().size() +
+      request->row_operations().indirect_data().size();
+
+  shared_ptr<Messenger> messenger = tablet_peer_->messenger();
+  if (PREDICT_FALSE(!messenger)) {
+    // Without a reactor to wait on, there's nothing to coalesce with.
+    vector<unique_ptr<PendingWrite>> writes;
+    writes.emplace_back(std::move(write));
+    SubmitPendingWrites(std::move(writes));
+    return;
+  }
+
+  {
+    std::lock_guard<simple_spinlock> l(lock_);
+    pending_.emplace_back(std::move(write));
+    if (flush_scheduled_) {
+      // The scheduled flush submits this write along with the others.
+      return;
+    }
+    flush_scheduled_ = true;
+  }
+
+  // Wait for more writes on a reactor rather than on the RPC service thread,
+  // which may serve other writes in the meantime.
+  TRACE("Waiting for more writes to coalesce");
+  messenger->ScheduleOnReactor(
+      boost::bind(&WriteCoalescer::FlushPendingWrites, this,
+                  scoped_refptr<TabletPeer>(tablet_peer_), _1),
+      MonoDelta::FromMicroseconds(FLAGS_write_coalescing_window_us));
+}
+
+void WriteCoalescer::FlushPendingWrites(const scoped_refptr<TabletPeer>& /* tablet_peer */,
+                                        const Status& status) {
+  vector<unique_ptr<PendingWrite>> writes;
+  {
+    std::lock_guard<simple_spinlock> l(lock_);
+    writes.swap(pending_);
+    flush_scheduled_ = false;
+  }
+  if (PREDICT_FALSE(!status.ok())) {
+    // The reactor is shutting down.
+    for (auto& write : writes) {
+      write->callback->set_error(status, TabletServerErrorPB::UNKNOWN_ERROR);
+      write->callback->TransactionCompleted();
+    }
+    return;
+  }
+  TRACE("Submitting $0 coalesced writes", writes.size());
+  SubmitPendingWrites(std::move(writes));
+}
+
+void WriteCoalescer::SubmitPendingWrites(vector<unique_ptr<PendingWrite>> writes) {
+  // Writes may only be merged if they have the same schema and consistency
+  // mode, which they almost always do. There are few open batches at once,
+  // so they are just looked up linearly.
+  vector<unique_ptr<Batch>> batches;
+  for (auto& write : writes) {
+    Status s = CheckRowOperations(*write->request);
+    if (PREDICT_FALSE(!s.ok())) {
+      // Let the write fail on its own, with its own error.
+      unique_ptr<Batch> single(new Batch);
+      single->writes.emplace_back(std::move(write));
+      SubmitBatch(std::move(single));
+      continue;
+    }
+    string schema = write->request->schema().SerializeAsString();
+    auto it = std::find_if(batches.begin(), batches.end(),
+                           [&](const unique_ptr<Batch>& b) {
+      return b->schema == schema &&
+          b->bytes + write->bytes <=
+              static_cast<uint64_t>(FLAGS_write_coalescing_max_batch_bytes);
+    });
+    if (it == batches.end()) {
+      batches.emplace_back(new Batch);
+      it = batches.end() - 1;
+      (*it)->schema = std::move(schema);
+    }
+    (*it)->bytes += write->bytes;
+    (*it)->writes.emplace_back(std::move(write));
+  }
+
+  for (auto& batch : batches) {
+    if (batch->writes.size() > 1) {
+      Status s = BuildCoalescedRequest(batch.get());
+      if (PREDICT_FALSE(!s.ok())) {
+        // Let each of the writes report its own error.
+        LOG(WARNING) << "T " << tablet_peer_->tablet_id()
+                     << ": Unable to coalesce writes: " << s.ToString();
+        for (auto& write : batch->writes) {
+          unique_ptr<Batch> single(new Batch);
+          single->writes.emplace_back(std::move(write));
+          SubmitBatch(std::move(single));
+        }
+        continue;
+      }
+    }
+    SubmitBatch(std::move(batch));
+  }
+}
+
+Status WriteCoalescer::CheckRowOperations(const WriteRequestPB& request) {
+  Schema client_schema;
+  RETURN_NOT_OK(SchemaFromPB(request.schema(), &client_schema));
+  if (client_schema.has_column_ids()) {
+    return Status::InvalidArgument("User requests should not have Column IDs");
+  }
+  shared_ptr<Tablet> tablet = tablet_peer_->shared_tablet();
+  if (!tablet) {
+    return Status::IllegalState("Tablet is not running");
+  }
+  return tablet->CheckWriteOperations(client_schema, request.row_operations());
+}
+
+Status WriteCoalescer::BuildCoalescedRequest(Batch* batch) {
+  const WriteRequestPB& first = *batch->writes[0]->request;
+  Schema client_schema;
+  RETURN_NOT_OK(SchemaFromPB(first.schema(), &client_schema));
+
+  WriteRequestPB* request = &batch->request;
+  request->set_tablet_id(first.tablet_id());
+  request->mutable_schema()->CopyFrom(first.schema());
+  request->set_external_consistency_mode(first.external_consistency_mode());
+  for (const auto& write : batch->writes) {
+    int num_ops;
+    RETURN_NOT_OK(AppendRowOperations(client_schema, write->request->row_operations(),
+                                      request->mutable_row_operations(), &num_ops));
+    WriteRequestPB::CoalescedRequestPB* coalesced = request->add_coalesced_requests();
+    if (write->request_id) {
+      coalesced->mutable_request_id()->CopyFrom(*write->request_id);
+    }
+    coalesced->set_num_row_operations(num_ops);
+    if (write->request->has_propagated_timestamp()) {
+      request->set_propagated_timestamp(std::max(request->propagated_timestamp(),
+                                                 write->request->propagated_timestamp()));
+    }
+  }
+  return Status::OK();
+}
+
+void WriteCoalescer::SubmitBatch(unique_ptr<Batch> batch) {
+  unique_ptr<WriteTransactionState> tx_state;
+  if (batch->merged()) {
+    // The requests of the writes are tracked through 'coalesced_requests'.
+    tx_state.reset(new WriteTransactionState(tablet_peer_, &batch->request, nullptr,
+                                             &batch->response));
+  } else {
+    DCHECK_EQ(1, batch->writes.size());
+    const PendingWrite& write = *batch->writes[0];
+    tx_state.reset(new WriteTransactionState(tablet_peer_, write.request, write.request_id,
+                                             write.response));
+  }
+  tx_state->set_completion_callback(gscoped_ptr<TransactionCompletionCallback>(
+      new BatchCompletionCallback(batch.get())));
+
+  // Once submitted, the batch belongs to its completion callback.
+  Batch* submitted = batch.release();
+  Status s = tablet_peer_->SubmitWrite(std::move(tx_state));
+  if (PREDICT_FALSE(!s.ok())) {
+    // The transaction never started, so its callback wasn't called.
+    batch.reset(submitted);
+    batch->Complete(s, TabletServerErrorPB::UNKNOWN_ERROR);
+  }
+}
+
+}  // namespace tablet
+}  // namespace kudu
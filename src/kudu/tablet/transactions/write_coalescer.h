@@ -0,0 +1,124 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#ifndef KUDU_TABLET_WRITE_COALESCER_H_
+#define KUDU_TABLET_WRITE_COALESCER_H_
+
+#include <memory>
+#include <vector>
+
+#include "kudu/gutil/gscoped_ptr.h"
+#include "kudu/gutil/macros.h"
+#include "kudu/gutil/ref_counted.h"
+#include "kudu/util/locks.h"
+#include "kudu/util/status.h"
+
+namespace kudu {
+
+namespace rpc {
+class RequestIdPB;
+}
+
+namespace tserver {
+class WriteRequestPB;
+class WriteResponsePB;
+}
+
+namespace tablet {
+
+class TabletPeer;
+class TransactionCompletionCallback;
+
+// Coalesces the small writes which a leader receives for a tablet at about
+// the same time into a single write transaction, so that they share one
+// Raft round, one WAL entry and one MVCC timestamp.
+//
+// The first write to arrive schedules a flush on a reactor thread after
+// --write_coalescing_window_us, and the writes arriving in the meantime queue
+// up behind it. The flush submits all of them. The writes which can be merged
+// (same schema and consistency mode) are submitted as one WriteRequestPB
+// listing the rows of each of them in its 'coalesced_requests', and each
+// write gets back its own response, with the per-row errors of its own rows,
+// once the merged transaction completes. A write which would fail as a whole,
+// e.g. because its rows don't belong to the tablet, is submitted on its own
+// so that it doesn't fail the others.
+//
+// Coalescing is disabled unless --write_coalescing_window_us is set.
+//
+// This class is thread-safe.
+class WriteCoalescer {
+ public:
+  explicit WriteCoalescer(TabletPeer* tablet_peer);
+  ~WriteCoalescer();
+
+  // Returns true if writes should go through a coalescer at all.
+  static bool IsEnabled();
+
+  // Returns true if 'request', which carries 'bytes' of row data, may be
+  // merged with others.
+  static bool CanCoalesce(const tserver::WriteRequestPB& request, uint64_t bytes);
+
+  // Submits the write 'request' to the tablet, possibly merged with others.
+  // 'request_id' is the id of its RPC if its result is tracked, otherwise
+  // NULL. 'request', 'response' and 'request_id' must stay valid until
+  // 'callback' is called, which it always is, whether the write succeeds or
+  // not, with its error set if the write couldn't be submitted.
+  void SubmitWrite(const tserver::WriteRequestPB* request,
+                   tserver::WriteResponsePB* response,
+                   const rpc::RequestIdPB* request_id,
+                   gscoped_ptr<TransactionCompletionCallback> callback);
+
+ private:
+  struct PendingWrite;
+  struct Batch;
+  class BatchCompletionCallback;
+
+  // Submits the writes queued up since the flush was scheduled, or fails
+  // them with 'status' if the flush couldn't run. 'tablet_peer' is the peer
+  // of this coalescer, which it keeps alive until the flush has run.
+  void FlushPendingWrites(const scoped_refptr<TabletPeer>& tablet_peer, const Status& status);
+
+  // Splits 'writes' into batches and submits each of them.
+  void SubmitPendingWrites(std::vector<std::unique_ptr<PendingWrite>> writes);
+
+  // Returns an error if the row operations of 'request' wouldn't prepare,
+  // in which case merging it with others would fail them too.
+  Status CheckRowOperations(const tserver::WriteRequestPB& request);
+
+  // Submits 'batch' as a single write transaction.
+  void SubmitBatch(std::unique_ptr<Batch> batch);
+
+  // Builds the merged request of the writes in 'batch' into its 'request'.
+  static Status BuildCoalescedRequest(Batch* batch);
+
+  TabletPeer* const tablet_peer_;
+
+  // Protects 'pending_' and 'flush_scheduled_'.
+  simple_spinlock lock_;
+
+  // The writes queued up since the flush was scheduled.
+  std::vector<std::unique_ptr<PendingWrite>> pending_;
+
+  // Whether a flush of 'pending_' is scheduled.
+  bool flush_scheduled_;
+
+  DISALLOW_COPY_AND_ASSIGN(WriteCoalescer);
+};
+
+}  // namespace tablet
+}  // namespace kudu
+
+#endif /* KUDU_TABLET_WRITE_COALESCER_H_ */
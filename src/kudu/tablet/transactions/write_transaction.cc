@@ -42,6 +42,14 @@ DEFINE_int32(tablet_inject_latency_on_apply_write_txn_ms, 0,
 TAG_FLAG(tablet_inject_latency_on_apply_write_txn_ms, unsafe);
 TAG_FLAG(tablet_inject_latency_on_apply_write_txn_ms, runtime);
 
+DEFINE_bool(write_txn_check_presence_during_replication, false,
+            "Whether the leader of a tablet checks if the rows inserted by a write "
+            "are already present while the write is being replicated, rather than "
+            "once it has been replicated. Only applies to writes which solely "
+            "insert rows.");
+TAG_FLAG(write_txn_check_presence_during_replication, experimental);
+TAG_FLAG(write_txn_check_presence_during_replication, runtime);
+
 namespace kudu {
 namespace tablet {
 
@@ -52,7 +60,10 @@ using consensus::WRITE_OP;
 using tserver::TabletServerErrorPB;
 using tserver::WriteRequestPB;
 using tserver::WriteResponsePB;
+using rpc::RequestIdPB;
+using rpc::ResultTracker;
 using std::unique_ptr;
+using std::vector;
 using strings::Substitute;
 
 WriteTransaction::WriteTransaction(unique_ptr<WriteTransactionState> state, DriverType type)
@@ -73,6 +84,14 @@ void WriteTransaction::NewReplicateMsg(gscoped_ptr<ReplicateMsg>* replicate_msg)
 Status WriteTransaction::Prepare() {
   TRACE_EVENT0("txn", "WriteTransaction::Prepare");
   TRACE("PREPARE: Starting");
+  if (state_->request()->coalesced_requests_size() > 0 && state_->result_tracker()) {
+    if (type() == consensus::REPLICA) {
+      TrackCoalescedRequests();
+    } else {
+      RETURN_NOT_OK(CheckDriverOfCoalescedRequests());
+    }
+  }
+
   // Decode everything first so that we give up if something major is wrong.
   Schema client_schema;
   RETURN_NOT_OK_PREPEND(SchemaFromPB(state_->request()->schema(), &client_schema),
@@ -109,6 +128,30 @@ Status WriteTransaction::Start() {
   return Status::OK();
 }
 
+bool WriteTransaction::HasPrepareDuringReplication() const {
+  if (!FLAGS_write_txn_check_presence_during_replication) {
+    return false;
+  }
+  for (const RowOp* op : state_->row_ops()) {
+    if (op->decoded_op.type != RowOperationsPB::INSERT) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void WriteTransaction::PrepareDuringReplication() {
+  TRACE_EVENT0("txn", "WriteTransaction::PrepareDuringReplication");
+  TRACE("Checking presence of inserted rows");
+  Status s = state()->tablet_peer()->tablet()->CheckPresenceDuringReplication(state());
+  if (PREDICT_FALSE(!s.ok())) {
+    // The operations which weren't checked will be checked on Apply().
+    LOG(WARNING) << "Unable to check presence of inserted rows for " << ToString()
+                 << ": " << s.ToString();
+  }
+  TRACE("Checked presence of inserted rows");
+}
+
 // FIXME: Since this is called as a void in a thread-pool callback,
 // it seems pointless to return a Status!
 Status WriteTransaction::Apply(gscoped_ptr<CommitMsg>* commit_msg) {
@@ -152,7 +195,21 @@ Status WriteTransaction::Apply(gscoped_ptr<CommitMsg>* commit_msg) {
 void WriteTransaction::Finish(TransactionResult result) {
   TRACE_EVENT0("txn", "WriteTransaction::Finish");
 
+  // Split the response to the coalesced requests before CommitOrAbort()
+  // resets it.
+  vector<WriteResponsePB> coalesced_responses;
+  if (result == Transaction::COMMITTED && !tracked_coalesced_requests_.empty()) {
+    coalesced_responses.resize(tracked_coalesced_requests_.size());
+    for (int i = 0; i < tracked_coalesced_requests_.size(); i++) {
+      GetCoalescedWriteResponse(*state()->request(), *state()->response(),
+                                tracked_coalesced_requests_[i].second,
+                                &coalesced_responses[i]);
+      coalesced_responses[i].set_timestamp(state()->timestamp().ToUint64());
+    }
+  }
+
   state()->CommitOrAbort(result);
+  RecordCoalescedResults(result, coalesced_responses);
 
   if (PREDICT_FALSE(result == Transaction::ABORTED)) {
     TRACE("FINISH: transaction aborted");
@@ -176,6 +233,9 @@ void WriteTransaction::Finish(TransactionResult result) {
       if (state()->external_consistency_mode() == COMMIT_WAIT) {
         metrics->commit_wait_duration->Increment(state_->metrics().commit_wait_duration_usec);
       }
+      metrics->write_op_prepare_duration->Increment(state_->metrics().prepare_duration_usec);
+      metrics->write_op_replication_duration->Increment(
+          state_->metrics().replication_duration_usec);
       uint64_t op_duration_usec =
           (MonoTime::Now() - start_time_).ToMicroseconds();
       switch (state()->external_consistency_mode()) {
@@ -192,6 +252,58 @@ void WriteTransaction::Finish(TransactionResult result) {
   }
 }
 
+void WriteTransaction::TrackCoalescedRequests() {
+  ResultTracker* tracker = state_->result_tracker();
+  const auto& requests = state_->request()->coalesced_requests();
+  for (int i = 0; i < requests.size(); i++) {
+    if (!requests.Get(i).has_request_id()) continue;
+    const RequestIdPB& request_id = requests.Get(i).request_id();
+    ResultTracker::RpcState rpc_state = tracker->TrackRpcOrChangeDriver(request_id);
+    switch (rpc_state) {
+      case ResultTracker::RpcState::NEW:
+        tracked_coalesced_requests_.emplace_back(request_id, i);
+        break;
+      // Like for single requests, if this request was already completed or is
+      // stale, its result isn't tracked again.
+      case ResultTracker::RpcState::STALE:
+      case ResultTracker::RpcState::COMPLETED:
+        VLOG(2) << tracker << " Coalesced follower Rpc was already COMPLETED or STALE: "
+                << rpc_state << " RequestId: " << request_id.ShortDebugString();
+        break;
+      default:
+        LOG(FATAL) << "Unexpected state: " << rpc_state;
+    }
+  }
+}
+
+Status WriteTransaction::CheckDriverOfCoalescedRequests() const {
+  for (const auto& request : state_->request()->coalesced_requests()) {
+    if (request.has_request_id() &&
+        !state_->result_tracker()->IsCurrentDriver(request.request_id())) {
+      return Status::AlreadyPresent(Substitute(
+          "There's already an attempt of the same operation on the server for request id: $0",
+          request.request_id().ShortDebugString()));
+    }
+  }
+  return Status::OK();
+}
+
+void WriteTransaction::RecordCoalescedResults(TransactionResult result,
+                                              const vector<WriteResponsePB>& responses) {
+  ResultTracker* tracker = state_->result_tracker();
+  for (int i = 0; i < tracked_coalesced_requests_.size(); i++) {
+    const RequestIdPB& request_id = tracked_coalesced_requests_[i].first;
+    if (result == Transaction::COMMITTED) {
+      tracker->RecordCompletionAndRespond(request_id, &responses[i]);
+    } else {
+      // As for single requests, the client will retry.
+      tracker->FailAndRespond(request_id, rpc::ErrorStatusPB::ERROR_SERVER_TOO_BUSY,
+                              Status::Aborted("Coalesced write transaction aborted"));
+    }
+  }
+  tracked_coalesced_requests_.clear();
+}
+
 string WriteTransaction::ToString() const {
   MonoTime now(MonoTime::Now());
   MonoDelta d = now - start_time_;
@@ -237,6 +349,11 @@ void WriteTransactionState::set_tablet_components(
   tablet_components_ = components;
 }
 
+void WriteTransactionState::set_presence_check_components(
+    const scoped_refptr<const TabletComponents>& components) {
+  presence_check_components_ = components;
+}
+
 void WriteTransactionState::AcquireSchemaLock(rw_semaphore* schema_lock) {
   TRACE("Acquiring schema lock in shared mode");
   shared_lock<rw_semaphore> temp(*schema_lock);
@@ -330,6 +447,7 @@ void WriteTransactionState::Reset() {
   tx_metrics_.Reset();
   timestamp_ = Timestamp::kInvalidTimestamp;
   tablet_components_ = nullptr;
+  presence_check_components_ = nullptr;
   schema_at_decode_time_ = nullptr;
 }
 
@@ -374,5 +492,32 @@ string WriteTransactionState::ToString() const {
                     row_ops_str);
 }
 
+void GetCoalescedWriteResponse(const WriteRequestPB& req,
+                               const WriteResponsePB& resp,
+                               int member_idx,
+                               WriteResponsePB* member_resp) {
+  DCHECK_LT(member_idx, req.coalesced_requests_size());
+  int first_row = 0;
+  for (int i = 0; i < member_idx; i++) {
+    first_row += req.coalesced_requests(i).num_row_operations();
+  }
+  int end_row = first_row + req.coalesced_requests(member_idx).num_row_operations();
+
+  if (resp.has_error()) {
+    member_resp->mutable_error()->CopyFrom(resp.error());
+  }
+  if (resp.has_timestamp()) {
+    member_resp->set_timestamp(resp.timestamp());
+  }
+  member_resp->clear_per_row_errors();
+  for (const auto& error : resp.per_row_errors()) {
+    if (error.row_index() >= first_row && error.row_index() < end_row) {
+      WriteResponsePB::PerRowErrorPB* member_error = member_resp->add_per_row_errors();
+      member_error->CopyFrom(error);
+      member_error->set_row_index(error.row_index() - first_row);
+    }
+  }
+}
+
 }  // namespace tablet
 }  // namespace kudu
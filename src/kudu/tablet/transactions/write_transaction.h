@@ -20,10 +20,12 @@
 
 #include <mutex>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "kudu/common/schema.h"
 #include "kudu/gutil/macros.h"
+#include "kudu/rpc/rpc_header.pb.h"
 #include "kudu/tablet/lock_manager.h"
 #include "kudu/tablet/mvcc.h"
 #include "kudu/tablet/tablet.pb.h"
@@ -111,6 +113,11 @@ class WriteTransactionState : public TransactionState {
   // in-memory edits.
   void set_tablet_components(const scoped_refptr<const TabletComponents>& components);
 
+  // Set the Tablet components that Tablet::CheckPresenceDuringReplication()
+  // probed, so that the rowsets the row operations point to outlive them.
+  void set_presence_check_components(
+      const scoped_refptr<const TabletComponents>& components);
+
   // Take a shared lock on the given schema lock.
   // This is required prior to decoding rows so that the schema does
   // not change in between performing the projection and applying
@@ -206,6 +213,10 @@ class WriteTransactionState : public TransactionState {
   // The tablet components, acquired at the same time as mvcc_tx_ is set.
   scoped_refptr<const TabletComponents> tablet_components_;
 
+  // The tablet components probed while the transaction was being replicated,
+  // if any.
+  scoped_refptr<const TabletComponents> presence_check_components_;
+
   // A lock held on the tablet's schema. Prevents concurrent schema change
   // from racing with a write.
   shared_lock<rw_semaphore> schema_lock_;
@@ -239,6 +250,15 @@ class WriteTransaction : public Transaction {
   // Actually starts the Mvcc transaction and assigns a timestamp to this transaction.
   virtual Status Start() OVERRIDE;
 
+  // Returns true if --write_txn_check_presence_during_replication is set and
+  // the transaction only inserts rows.
+  virtual bool HasPrepareDuringReplication() const OVERRIDE;
+
+  // Checks whether the inserted rows are already present in the tablet, so
+  // that Apply() doesn't have to. Inserting a duplicate key still fails on
+  // Apply(), like it does on the replicas which didn't check ahead.
+  virtual void PrepareDuringReplication() OVERRIDE;
+
   // Executes an Apply for a write transaction.
   //
   // Actually applies inserts/mutates into the tablet. After these start being
@@ -266,15 +286,47 @@ class WriteTransaction : public Transaction {
   virtual std::string ToString() const OVERRIDE;
 
  private:
+  // For transactions coalesced from several client requests by the leader
+  // (see WriteCoalescer), the results of the requests are tracked one by one:
+  // the leader responds to each of them, and followers record each result
+  // like they do for the request id of a single request.
+
+  // Registers the tracked coalesced requests with the result tracker. This
+  // transaction records the results of those which the tracker reports as
+  // new. Only called on followers.
+  void TrackCoalescedRequests();
+
+  // Returns an error if another attempt of one of the tracked coalesced
+  // requests took over as its driver. Only called on leaders.
+  Status CheckDriverOfCoalescedRequests() const;
+
+  // Records the results of the coalesced requests which this transaction
+  // registered. 'responses' holds the response to each of them, in the order
+  // of 'tracked_coalesced_requests_', if the transaction committed.
+  void RecordCoalescedResults(TransactionResult result,
+                              const std::vector<tserver::WriteResponsePB>& responses);
+
   // this transaction's start time
   MonoTime start_time_;
 
   std::unique_ptr<WriteTransactionState> state_;
 
+  // The coalesced requests whose results this transaction records, and the
+  // index of each in the request's 'coalesced_requests'.
+  std::vector<std::pair<rpc::RequestIdPB, int>> tracked_coalesced_requests_;
+
  private:
   DISALLOW_COPY_AND_ASSIGN(WriteTransaction);
 };
 
+// Sets 'member_resp' to the part of 'resp', the response to the coalesced
+// write 'req', which answers the 'member_idx'-th of its coalesced requests:
+// the per-row errors of its rows, with their indexes in its own request.
+void GetCoalescedWriteResponse(const tserver::WriteRequestPB& req,
+                               const tserver::WriteResponsePB& resp,
+                               int member_idx,
+                               tserver::WriteResponsePB* member_resp);
+
 }  // namespace tablet
 }  // namespace kudu
 
@@ -25,10 +25,12 @@
 #include "kudu/gutil/map-util.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/tools/ksck.h"
+#include "kudu/util/atomic.h"
 #include "kudu/util/scoped_cleanup.h"
 #include "kudu/util/test_util.h"
 
 DECLARE_string(color);
+DECLARE_int32(fetch_tablet_info_concurrency);
 
 namespace kudu {
 namespace tools {
@@ -84,7 +86,8 @@ class MockKsckTabletServer : public KsckTabletServer {
 class MockKsckMaster : public KsckMaster {
  public:
   MockKsckMaster()
-      : fetch_info_status_(Status::OK()) {
+      : fetch_info_status_(Status::OK()),
+        num_tablets_lists_retrieved_(0) {
   }
 
   virtual Status Connect() OVERRIDE {
@@ -102,6 +105,7 @@ class MockKsckMaster : public KsckMaster {
   }
 
   virtual Status RetrieveTabletsList(const shared_ptr<KsckTable>& table) OVERRIDE {
+    num_tablets_lists_retrieved_.Increment();
     return Status::OK();
   }
 
@@ -109,6 +113,7 @@ class MockKsckMaster : public KsckMaster {
   Status fetch_info_status_;
   TSMap tablet_servers_;
   vector<shared_ptr<KsckTable>> tables_;
+  AtomicInt<int32_t> num_tablets_lists_retrieved_;
 };
 
 class KsckTest : public KuduTest {
@@ -321,6 +326,15 @@ TEST_F(KsckTest, TestZeroTableCheck) {
   ASSERT_OK(RunKsck());
 }
 
+TEST_F(KsckTest, TestFetchTabletsOfManyTables) {
+  FLAGS_fetch_tablet_info_concurrency = 3;
+  for (int i = 0; i < 10; i++) {
+    master_->tables_.emplace_back(new KsckTable(Substitute("table-$0", i), Schema(), 3));
+  }
+  ASSERT_OK(ksck_->FetchTableAndTabletInfo());
+  ASSERT_EQ(10, master_->num_tablets_lists_retrieved_.Load());
+}
+
 TEST_F(KsckTest, TestOneTableCheck) {
   CreateOneTableOneTablet();
   ASSERT_OK(RunKsck());
@@ -34,6 +34,7 @@
 #include "kudu/tools/color.h"
 #include "kudu/util/atomic.h"
 #include "kudu/util/blocking_queue.h"
+#include "kudu/util/countdown_latch.h"
 #include "kudu/util/locks.h"
 #include "kudu/util/monotime.h"
 #include "kudu/util/threadpool.h"
@@ -61,6 +62,9 @@ DEFINE_uint64(checksum_snapshot_timestamp, ChecksumOptions::kCurrentTimestamp,
 
 DEFINE_int32(fetch_replica_info_concurrency, 20,
              "Number of concurrent tablet servers to fetch replica info from.");
+DEFINE_int32(fetch_tablet_info_concurrency, 20,
+             "Number of tables whose tablet locations are fetched from the "
+             "master concurrently.");
 
 // The stream to write output to. If this is NULL, defaults to cout.
 // This is used by tests to capture output.
@@ -126,8 +130,24 @@ Status KsckCluster::FetchTableAndTabletInfo() {
   RETURN_NOT_OK(master_->Connect());
   RETURN_NOT_OK(RetrieveTablesList());
   RETURN_NOT_OK(RetrieveTabletServers());
-  for (const shared_ptr<KsckTable>& table : tables()) {
-    RETURN_NOT_OK(RetrieveTabletsList(table));
+  if (tables_.empty()) {
+    return Status::OK();
+  }
+
+  // Clusters can have thousands of tables, so fetch their tablets in parallel.
+  gscoped_ptr<ThreadPool> pool;
+  RETURN_NOT_OK(ThreadPoolBuilder("ksck-tablets")
+                .set_max_threads(std::max(FLAGS_fetch_tablet_info_concurrency, 1))
+                .Build(&pool));
+  vector<Status> statuses(tables_.size());
+  for (int i = 0; i < tables_.size(); i++) {
+    const shared_ptr<KsckTable>& table = tables_[i];
+    Status* s = &statuses[i];
+    RETURN_NOT_OK(pool->SubmitFunc([this, &table, s]() { *s = RetrieveTabletsList(table); }));
+  }
+  pool->Wait();
+  for (const Status& s : statuses) {
+    RETURN_NOT_OK(s);
   }
   return Status::OK();
 }
@@ -175,6 +195,7 @@ Status Ksck::FetchInfoFromTabletServers() {
                 .Build(&pool));
 
   AtomicInt<int32_t> bad_servers(0);
+  CountDownLatch remaining(servers_count);
   VLOG(1) << "Fetching info from all the Tablet Servers";
   for (const KsckMaster::TSMap::value_type& entry : cluster_->tablet_servers()) {
     CHECK_OK(pool->SubmitFunc([&]() {
@@ -182,8 +203,14 @@ Status Ksck::FetchInfoFromTabletServers() {
           if (!s.ok()) {
             bad_servers.Increment();
           }
+          remaining.CountDown();
         }));
   }
+  // Report progress while waiting, since large clusters take a while.
+  while (!remaining.WaitFor(MonoDelta::FromSeconds(5))) {
+    Out() << Substitute("Fetched info from $0/$1 Tablet Servers",
+                        servers_count - remaining.count(), servers_count) << endl;
+  }
   pool->Wait();
 
   if (bad_servers.Load() == 0) {
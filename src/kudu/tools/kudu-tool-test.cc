@@ -43,6 +43,8 @@
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/gutil/strings/split.h"
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/gutil/strings/util.h"
+#include "kudu/integration-tests/external_mini_cluster.h"
 #include "kudu/tablet/local_tablet_writer.h"
 #include "kudu/tablet/tablet-harness.h"
 #include "kudu/tablet/tablet_metadata.h"
@@ -50,6 +52,7 @@
 #include "kudu/util/async_util.h"
 #include "kudu/util/env.h"
 #include "kudu/util/metrics.h"
+#include "kudu/util/net/sockaddr.h"
 #include "kudu/util/oid_generator.h"
 #include "kudu/util/path_util.h"
 #include "kudu/util/subprocess.h"
@@ -183,6 +186,7 @@ TEST_F(ToolTest, TestTopLevelHelp) {
       "local_replica.*Kudu replicas",
       "master.*Kudu Master",
       "pbc.*protobuf container",
+      "perf.*performance of a Kudu cluster",
       "remote_replica.*replicas on a Kudu Tablet Server",
       "table.*Kudu tables",
       "tablet.*Kudu tablets",
@@ -219,7 +223,9 @@ TEST_F(ToolTest, TestModeHelp) {
         "cmeta.*Operate on a local Kudu replica's consensus",
         "dump.*Dump a Kudu filesystem",
         "copy_from_remote.*Copy a replica",
-        "list.*Show list of Kudu replicas"
+        "bulk_load.*Load rows into a local replica",
+        "list.*Show list of Kudu replicas",
+        "scan.*Scan the rows of a local replica"
     };
     NO_FATALS(RunTestHelp("local_replica", kLocalReplicaModeRegexes));
   }
@@ -260,6 +266,12 @@ TEST_F(ToolTest, TestModeHelp) {
     };
     NO_FATALS(RunTestHelp("pbc", kPbcModeRegexes));
   }
+  {
+    const vector<string> kPerfModeRegexes = {
+        "ycsb.*Run a YCSB core workload",
+    };
+    NO_FATALS(RunTestHelp("perf", kPerfModeRegexes));
+  }
   {
     const vector<string> kRemoteReplicaModeRegexes = {
         "check.*Check if all replicas",
@@ -747,6 +759,105 @@ TEST_F(ToolTest, TestLocalReplicaOps) {
     SCOPED_TRACE(stdout);
     ASSERT_STR_MATCHES(stdout, kTestTablet);
   }
+  {
+    string stdout;
+    NO_FATALS(RunActionStdoutString(
+        Substitute("local_replica scan $0 $1 --columns=int_val,key "
+                   "--predicates=key>=7,int_val<90", kTestTablet, fs_paths), &stdout));
+    ASSERT_EQ("int_val,key\n70,7\n80,8", stdout);
+
+    NO_FATALS(RunActionStdoutString(
+        Substitute("local_replica scan $0 $1 --predicates=key>100", kTestTablet, fs_paths),
+        &stdout));
+    ASSERT_EQ("key,int_val,string_val", stdout);
+
+    // Rowsets are written to a file each in the columnar format.
+    const string kOutputDir = GetTestPath("scan");
+    NO_FATALS(RunActionStdoutString(
+        Substitute("local_replica scan $0 $1 --scan_format=columnar --output_dir=$2",
+                   kTestTablet, fs_paths, kOutputDir), &stdout));
+    faststring data;
+    ASSERT_OK(ReadFileToString(env_.get(), JoinPathSegments(kOutputDir, "rowset-0.kcol"), &data));
+    ASSERT_TRUE(HasPrefixString(data.ToString(), "kudcolv1"));
+
+    string stderr;
+    Status s = RunTool(Substitute("local_replica scan $0 $1 --predicates=foo=1",
+                                  kTestTablet, fs_paths),
+                       &stdout, &stderr, nullptr, nullptr);
+    ASSERT_TRUE(s.IsRuntimeError());
+    ASSERT_STR_CONTAINS(stderr, "No such column: foo");
+  }
+  {
+    // Keys within the existing rowset can't be bulk loaded.
+    const string kInputPath = GetTestPath("input.csv");
+    ASSERT_OK(WriteStringToFile(env_.get(), "key,int_val\n5,50\n", kInputPath));
+    string stdout;
+    string stderr;
+    Status s = RunTool(Substitute("local_replica bulk_load $0 $1 $2",
+                                  kTestTablet, kInputPath, fs_paths),
+                       &stdout, &stderr, nullptr, nullptr);
+    ASSERT_TRUE(s.IsRuntimeError());
+    ASSERT_STR_CONTAINS(stderr, "overlap those of rowset 0");
+
+    ASSERT_OK(WriteStringToFile(env_.get(),
+                                "string_val,key,int_val\n"
+                                "\"a,b\",101,1010\n"
+                                ",100,1000\n", kInputPath));
+    NO_FATALS(RunActionStdoutString(
+        Substitute("local_replica bulk_load $0 $1 $2", kTestTablet, kInputPath, fs_paths),
+        &stdout));
+    ASSERT_STR_CONTAINS(stdout, "Loaded 2 rows into 1 new rowsets");
+
+    NO_FATALS(RunActionStdoutString(
+        Substitute("local_replica scan $0 $1 --predicates=key>=9", kTestTablet, fs_paths),
+        &stdout));
+    ASSERT_STR_CONTAINS(stdout, "9,90,HelloWorld");
+    ASSERT_STR_CONTAINS(stdout, "100,1000,\n");
+    ASSERT_STR_CONTAINS(stdout, "101,1010,\"a,b\"");
+  }
+}
+
+TEST_F(ToolTest, TestPerfYcsb) {
+  ExternalMiniClusterOptions opts;
+  ExternalMiniCluster cluster(opts);
+  ASSERT_OK(cluster.Start());
+  string master_addr = cluster.master()->bound_rpc_addr().ToString();
+
+  // Load the table and run a closed-loop workload against it.
+  {
+    string stdout;
+    NO_FATALS(RunActionStdoutString(Substitute(
+        "perf ycsb $0 ycsb --ycsb_workload=a --ycsb_record_count=1000 "
+        "--ycsb_operation_count=1000 --ycsb_threads=2 --ycsb_num_tablets=2",
+        master_addr), &stdout));
+    SCOPED_TRACE(stdout);
+    ASSERT_STR_CONTAINS(stdout, "[LOAD] 1000 rows");
+    ASSERT_STR_CONTAINS(stdout, "closed loop");
+    ASSERT_STR_MATCHES(stdout, "\\[READ\\] count [0-9]+, errors 0, mean");
+    ASSERT_STR_MATCHES(stdout, "\\[UPDATE\\] count [0-9]+, errors 0, mean");
+  }
+
+  // Then run an open-loop workload with inserts and scans against the
+  // loaded table.
+  {
+    string stdout;
+    NO_FATALS(RunActionStdoutString(Substitute(
+        "perf ycsb $0 ycsb --ycsb_load=false --ycsb_workload=e "
+        "--ycsb_record_count=1000 --ycsb_operation_count=200 --ycsb_threads=2 "
+        "--ycsb_target_ops_per_sec=1000", master_addr), &stdout));
+    SCOPED_TRACE(stdout);
+    ASSERT_EQ(string::npos, stdout.find("[LOAD]"));
+    ASSERT_STR_CONTAINS(stdout, "open loop");
+    ASSERT_STR_MATCHES(stdout, "\\[SCAN\\] count [0-9]+, errors 0, mean");
+    ASSERT_EQ(string::npos, stdout.find("[READ]"));
+  }
+
+  // Unknown workloads are rejected.
+  string stderr;
+  Status s = RunTool(Substitute("perf ycsb $0 ycsb --ycsb_load=false --ycsb_workload=z",
+                                master_addr), nullptr, &stderr, nullptr, nullptr);
+  ASSERT_TRUE(s.IsRuntimeError());
+  ASSERT_STR_CONTAINS(stderr, "unknown YCSB workload");
 }
 
 } // namespace tools
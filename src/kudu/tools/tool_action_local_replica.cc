@@ -17,21 +17,26 @@
 
 #include "kudu/tools/tool_action.h"
 
+#include <algorithm>
 #include <iostream>
 #include <list>
+#include <mutex>
 #include <memory>
 #include <string>
 #include <utility>
 
 #include "kudu/cfile/cfile_reader.h"
+#include "kudu/common/column_predicate.h"
 #include "kudu/common/common.pb.h"
 #include "kudu/common/row_changelist.h"
 #include "kudu/common/row_operations.h"
 #include "kudu/common/rowblock.h"
+#include "kudu/common/scan_spec.h"
 #include "kudu/common/schema.h"
 #include "kudu/common/wire_protocol.h"
 #include "kudu/consensus/consensus_meta.h"
 #include "kudu/consensus/consensus.pb.h"
+#include "kudu/consensus/log_anchor_registry.h"
 #include "kudu/consensus/log_index.h"
 #include "kudu/consensus/log_reader.h"
 #include "kudu/consensus/log_util.h"
@@ -49,12 +54,15 @@
 #include "kudu/rpc/messenger.h"
 #include "kudu/tablet/cfile_set.h"
 #include "kudu/tablet/deltafile.h"
+#include "kudu/tablet/diskrowset.h"
 #include "kudu/tablet/rowset_metadata.h"
 #include "kudu/tablet/tablet.h"
 #include "kudu/tools/tool_action_common.h"
 #include "kudu/tserver/tablet_copy_client.h"
 #include "kudu/tserver/tserver.pb.h"
 #include "kudu/util/env.h"
+#include "kudu/util/atomic.h"
+#include "kudu/util/coding.h"
 #include "kudu/util/env_util.h"
 #include "kudu/util/logging.h"
 #include "kudu/util/mem_tracker.h"
@@ -63,6 +71,7 @@
 #include "kudu/util/net/net_util.h"
 #include "kudu/util/pb_util.h"
 #include "kudu/util/status.h"
+#include "kudu/util/threadpool.h"
 
 DEFINE_bool(dump_data, false,
             "Dump the data for each column in the rowset.");
@@ -74,6 +83,27 @@ DEFINE_bool(list_detail, false,
 DEFINE_int64(rowset_index, -1,
              "Index of the rowset in local replica, default value(-1) "
              "will dump all the rowsets of the local replica");
+DEFINE_string(columns, "",
+              "Comma-separated list of the columns to scan. All the columns "
+              "are scanned if empty.");
+DEFINE_string(predicates, "",
+              "Comma-separated list of predicates of the form "
+              "<column><op><value>, where <op> is one of =, <, <=, > and >=. "
+              "Rowsets which can't match the predicates are skipped.");
+DEFINE_string(scan_format, "csv",
+              "Format of the scanned rows: 'csv' or 'columnar'. The columnar "
+              "format is that of columnar scan results, and requires "
+              "--output_dir.");
+DEFINE_string(output_dir, "",
+              "Directory into which a file is written for each scanned "
+              "rowset. If empty, CSV rows are written to stdout.");
+DEFINE_int32(num_threads, 0,
+             "Number of rowsets to scan in parallel. If 0, all of them are "
+             "scanned in parallel.");
+
+DECLARE_int32(budgeted_compaction_target_rowset_size);
+DECLARE_int32(tablet_bloom_block_size);
+DECLARE_double(tablet_bloom_target_fp_rate);
 
 namespace kudu {
 namespace tools {
@@ -96,6 +126,7 @@ using rpc::MessengerBuilder;
 using std::cout;
 using std::endl;
 using std::list;
+using std::pair;
 using std::shared_ptr;
 using std::string;
 using std::unique_ptr;
@@ -107,8 +138,11 @@ using tablet::DeltaFileReader;
 using tablet::DeltaIterator;
 using tablet::DeltaKeyAndUpdate;
 using tablet::DeltaType;
+using tablet::DiskRowSet;
 using tablet::MvccSnapshot;
+using tablet::RollingDiskRowSetWriter;
 using tablet::RowSetMetadata;
+using tablet::RowSetMetadataVector;
 using tablet::Tablet;
 using tablet::TabletMetadata;
 using tserver::TabletCopyClient;
@@ -612,6 +646,601 @@ Status DumpMeta(const RunnerContext& context) {
   return Status::OK();
 }
 
+// The file written per rowset by 'local_replica scan --scan_format=columnar'
+// starts with kColumnarFileMagic and the length-prefixed SchemaPB of the
+// projection. Then, for each batch of rows, comes the length-prefixed
+// ColumnarRowBlockPB of the batch followed by its buffers in the order of
+// their sidecar indexes, each prefixed by its length as a fixed64. Length
+// prefixes are fixed32 unless noted.
+static const char* const kColumnarFileMagic = "kudcolv1";
+
+// The number of bytes of columnar buffers accumulated before writing a batch.
+static const size_t kColumnarBatchBytes = 1024 * 1024;
+
+// Parses 'str' as a value of 'col', allocating it from 'arena'.
+Status ParseCellValue(const ColumnSchema& col, const string& str, Arena* arena,
+                      const void** value) {
+  const TypeInfo* type = col.type_info();
+  void* buf = arena->AllocateBytes(type->size());
+  int64 i64;
+  uint64 u64;
+  switch (type->physical_type()) {
+    case INT8:
+    case INT16:
+    case INT32:
+    case INT64: {
+      if (!safe_strto64(str, &i64)) break;
+      int bits = type->size() * 8;
+      if (bits < 64 && (i64 < -(1LL << (bits - 1)) || i64 >= (1LL << (bits - 1)))) break;
+      switch (type->size()) {
+        case 1: *reinterpret_cast<int8_t*>(buf) = i64; break;
+        case 2: *reinterpret_cast<int16_t*>(buf) = i64; break;
+        case 4: *reinterpret_cast<int32_t*>(buf) = i64; break;
+        default: *reinterpret_cast<int64_t*>(buf) = i64; break;
+      }
+      *value = buf;
+      return Status::OK();
+    }
+    case UINT8:
+    case UINT16:
+    case UINT32:
+    case UINT64: {
+      if (!safe_strtou64(str, &u64)) break;
+      if (type->size() < 8 && u64 >> (type->size() * 8) != 0) break;
+      switch (type->size()) {
+        case 1: *reinterpret_cast<uint8_t*>(buf) = u64; break;
+        case 2: *reinterpret_cast<uint16_t*>(buf) = u64; break;
+        case 4: *reinterpret_cast<uint32_t*>(buf) = u64; break;
+        default: *reinterpret_cast<uint64_t*>(buf) = u64; break;
+      }
+      *value = buf;
+      return Status::OK();
+    }
+    case BOOL:
+      if (str != "true" && str != "false") break;
+      *reinterpret_cast<bool*>(buf) = str == "true";
+      *value = buf;
+      return Status::OK();
+    case FLOAT:
+      if (!safe_strtof(str, reinterpret_cast<float*>(buf))) break;
+      *value = buf;
+      return Status::OK();
+    case DOUBLE:
+      if (!safe_strtod(str, reinterpret_cast<double*>(buf))) break;
+      *value = buf;
+      return Status::OK();
+    case BINARY: {
+      Slice s(str);
+      if (!arena->RelocateSlice(s, reinterpret_cast<Slice*>(buf))) {
+        return Status::RuntimeError("Out of memory");
+      }
+      *value = buf;
+      return Status::OK();
+    }
+    default:
+      return Status::NotSupported(Substitute("Predicates on column $0 are not supported",
+                                             col.ToString()));
+  }
+  return Status::InvalidArgument(Substitute("Invalid value for column $0", col.ToString()),
+                                 str);
+}
+
+// Parses the comma-separated predicates in 'str', each of the form
+// '<column><op><value>' where <op> is one of =, <, <=, > and >=.
+Status ParsePredicates(const Schema& schema, const string& str, Arena* arena,
+                       vector<ColumnPredicate>* predicates) {
+  vector<string> preds = Split(str, ",", strings::SkipEmpty());
+  for (const string& pred : preds) {
+    size_t op_pos = pred.find_first_of("<>=");
+    if (op_pos == string::npos || op_pos == 0) {
+      return Status::InvalidArgument("Invalid predicate", pred);
+    }
+    size_t value_pos = op_pos + 1;
+    if (value_pos < pred.size() && pred[value_pos] == '=' && pred[op_pos] != '=') {
+      value_pos++;
+    }
+    string col_name = pred.substr(0, op_pos);
+    string op = pred.substr(op_pos, value_pos - op_pos);
+    int col_idx = schema.find_column(col_name);
+    if (col_idx == Schema::kColumnNotFound) {
+      return Status::NotFound("No such column", col_name);
+    }
+    const ColumnSchema& col = schema.column(col_idx);
+    const void* value;
+    RETURN_NOT_OK(ParseCellValue(col, pred.substr(value_pos), arena, &value));
+    if (op == "=") {
+      predicates->push_back(ColumnPredicate::Equality(col, value));
+    } else if (op == "<") {
+      predicates->push_back(ColumnPredicate::Range(col, nullptr, value));
+    } else if (op == ">=") {
+      predicates->push_back(ColumnPredicate::Range(col, value, nullptr));
+    } else if (op == ">") {
+      predicates->push_back(ColumnPredicate::ExclusiveRange(col, value, nullptr, arena));
+    } else if (op == "<=") {
+      boost::optional<ColumnPredicate> p =
+          ColumnPredicate::InclusiveRange(col, nullptr, value, arena);
+      if (p) {
+        predicates->push_back(*p);
+      }
+    } else {
+      return Status::InvalidArgument("Invalid predicate", pred);
+    }
+  }
+  return Status::OK();
+}
+
+// Appends 'cell' to 'out' as a CSV field.
+void AppendCsvField(const string& cell, string* out) {
+  if (cell.find_first_of(",\"\r\n") == string::npos) {
+    out->append(cell);
+    return;
+  }
+  out->push_back('"');
+  for (char c : cell) {
+    if (c == '"') {
+      out->push_back('"');
+    }
+    out->push_back(c);
+  }
+  out->push_back('"');
+}
+
+// A scan of the rowsets of a local replica.
+class LocalReplicaScanner {
+ public:
+  explicit LocalReplicaScanner(scoped_refptr<TabletMetadata> meta)
+      : meta_(std::move(meta)),
+        predicate_arena_(1024, 1024 * 1024),
+        num_rows_(0),
+        num_rowsets_pruned_(0) {
+  }
+
+  Status Init() {
+    const Schema& schema = meta_->schema();
+    vector<StringPiece> col_names;
+    vector<string> names = Split(FLAGS_columns, ",", strings::SkipEmpty());
+    if (names.empty()) {
+      for (int i = 0; i < schema.num_columns(); i++) {
+        names.push_back(schema.column(i).name());
+      }
+    }
+    for (const string& name : names) {
+      col_names.emplace_back(name);
+    }
+    RETURN_NOT_OK(schema.CreateProjectionByNames(col_names, &output_projection_));
+
+    RETURN_NOT_OK(ParsePredicates(schema, FLAGS_predicates, &predicate_arena_, &predicates_));
+
+    // The rowsets must also read the columns of the predicates.
+    for (const ColumnPredicate& pred : predicates_) {
+      if (output_projection_.find_column(pred.column().name()) == Schema::kColumnNotFound) {
+        col_names.emplace_back(pred.column().name());
+      }
+    }
+    RETURN_NOT_OK(schema.CreateProjectionByNames(col_names, &scan_projection_));
+
+    if (FLAGS_scan_format != "csv" && FLAGS_scan_format != "columnar") {
+      return Status::InvalidArgument("Unknown scan format", FLAGS_scan_format);
+    }
+    if (FLAGS_scan_format == "columnar" && FLAGS_output_dir.empty()) {
+      return Status::InvalidArgument("--output_dir is required for the columnar format");
+    }
+    if (!FLAGS_output_dir.empty()) {
+      RETURN_NOT_OK(env_util::CreateDirIfMissing(Env::Default(), FLAGS_output_dir));
+    }
+    return Status::OK();
+  }
+
+  // Scans all the rowsets, using one thread per rowset, up to
+  // --num_threads at a time.
+  Status Run() {
+    const auto& rowsets = meta_->rowsets();
+    if (rowsets.empty()) {
+      return Status::OK();
+    }
+    if (FLAGS_scan_format == "csv" && FLAGS_output_dir.empty()) {
+      string header;
+      AppendCsvHeader(&header);
+      cout << header;
+    }
+
+    int num_threads = FLAGS_num_threads > 0 ?
+        std::min<int>(FLAGS_num_threads, rowsets.size()) : rowsets.size();
+    gscoped_ptr<ThreadPool> pool;
+    RETURN_NOT_OK(ThreadPoolBuilder("local-scan")
+                  .set_min_threads(num_threads)
+                  .set_max_threads(num_threads)
+                  .Build(&pool));
+    vector<Status> statuses(rowsets.size());
+    for (int i = 0; i < rowsets.size(); i++) {
+      shared_ptr<RowSetMetadata> rs_meta = rowsets[i];
+      Status* s = &statuses[i];
+      RETURN_NOT_OK(pool->SubmitFunc([this, rs_meta, s]() { *s = ScanRowSet(rs_meta); }));
+    }
+    pool->Wait();
+    for (const Status& s : statuses) {
+      RETURN_NOT_OK(s);
+    }
+    LOG(INFO) << Substitute("Scanned $0 rows from $1 rowsets ($2 pruned)",
+                            num_rows_.Load(), rowsets.size(), num_rowsets_pruned_.Load());
+    return Status::OK();
+  }
+
+ private:
+  void AppendCsvHeader(string* out) const {
+    for (int i = 0; i < output_projection_.num_columns(); i++) {
+      if (i > 0) {
+        out->push_back(',');
+      }
+      AppendCsvField(output_projection_.column(i).name(), out);
+    }
+    out->push_back('\n');
+  }
+
+  // Appends the selected rows of 'block' to 'out' in CSV.
+  void AppendCsvRows(const RowBlock& block, string* out) const {
+    vector<int> col_idxs;
+    for (int i = 0; i < output_projection_.num_columns(); i++) {
+      col_idxs.push_back(block.schema().find_column(output_projection_.column(i).name()));
+    }
+    string cell;
+    for (size_t r = 0; r < block.nrows(); r++) {
+      if (!block.selection_vector()->IsRowSelected(r)) {
+        continue;
+      }
+      RowBlockRow row = block.row(r);
+      for (int i = 0; i < col_idxs.size(); i++) {
+        if (i > 0) {
+          out->push_back(',');
+        }
+        const ColumnSchema& col = block.schema().column(col_idxs[i]);
+        if (col.is_nullable() && row.is_null(col_idxs[i])) {
+          continue;
+        }
+        const void* ptr = row.cell_ptr(col_idxs[i]);
+        cell.clear();
+        if (col.type_info()->physical_type() == BINARY) {
+          cell = reinterpret_cast<const Slice*>(ptr)->ToString();
+        } else {
+          col.type_info()->AppendDebugStringForValue(ptr, &cell);
+        }
+        AppendCsvField(cell, out);
+      }
+      out->push_back('\n');
+    }
+  }
+
+  static Status AppendLengthPrefixed(WritableFile* file, const Slice& data, bool fixed64) {
+    faststring len;
+    if (fixed64) {
+      PutFixed64(&len, data.size());
+    } else {
+      PutFixed32(&len, data.size());
+    }
+    RETURN_NOT_OK(file->Append(len));
+    return file->Append(data);
+  }
+
+  static Status WriteColumnarBatch(ColumnarSerializedBatch* batch, WritableFile* file) {
+    ColumnarRowBlockPB pb;
+    pb.set_num_rows(batch->num_rows);
+    vector<faststring*> sidecars;
+    for (ColumnarSerializedBatch::Column& col : batch->columns) {
+      ColumnarRowBlockPB::Column* col_pb = pb.add_columns();
+      col_pb->set_data_sidecar(sidecars.size());
+      sidecars.push_back(col.data.get());
+      if (col.varlen_data && col.varlen_data->size() > 0) {
+        col_pb->set_varlen_data_sidecar(sidecars.size());
+        sidecars.push_back(col.varlen_data.get());
+      }
+      if (col.non_null_bitmap) {
+        col_pb->set_non_null_bitmap_sidecar(sidecars.size());
+        sidecars.push_back(col.non_null_bitmap.get());
+      }
+    }
+    RETURN_NOT_OK(AppendLengthPrefixed(file, pb.SerializeAsString(), false));
+    for (const faststring* sidecar : sidecars) {
+      RETURN_NOT_OK(AppendLengthPrefixed(file, Slice(*sidecar), true));
+    }
+    *batch = ColumnarSerializedBatch();
+    return Status::OK();
+  }
+
+  Status ScanRowSet(const shared_ptr<RowSetMetadata>& rs_meta) {
+    scoped_refptr<log::LogAnchorRegistry> registry(new log::LogAnchorRegistry());
+    shared_ptr<DiskRowSet> rs;
+    RETURN_NOT_OK_PREPEND(DiskRowSet::Open(rs_meta, registry.get(), &rs),
+                          Substitute("Could not open rowset $0", rs_meta->id()));
+
+    ScanSpec spec;
+    for (const ColumnPredicate& pred : predicates_) {
+      spec.AddPredicate(pred);
+    }
+    if (!rs->MayMatchPredicates(spec)) {
+      num_rowsets_pruned_.Increment();
+      return Status::OK();
+    }
+    gscoped_ptr<RowwiseIterator> iter;
+    RETURN_NOT_OK(rs->NewRowIterator(&scan_projection_,
+                                     MvccSnapshot::CreateSnapshotIncludingAllTransactions(),
+                                     &iter));
+    RETURN_NOT_OK(iter->Init(&spec));
+
+    bool columnar = FLAGS_scan_format == "columnar";
+    gscoped_ptr<WritableFile> file;
+    if (!FLAGS_output_dir.empty()) {
+      string path = JoinPathSegments(FLAGS_output_dir,
+                                     Substitute("rowset-$0.$1", rs_meta->id(),
+                                                columnar ? "kcol" : "csv"));
+      RETURN_NOT_OK(Env::Default()->NewWritableFile(path, &file));
+      if (columnar) {
+        SchemaPB schema_pb;
+        RETURN_NOT_OK(SchemaToPB(output_projection_, &schema_pb));
+        RETURN_NOT_OK(file->Append(kColumnarFileMagic));
+        RETURN_NOT_OK(AppendLengthPrefixed(file.get(), schema_pb.SerializeAsString(), false));
+      } else {
+        string header;
+        AppendCsvHeader(&header);
+        RETURN_NOT_OK(file->Append(header));
+      }
+    }
+
+    Arena arena(32 * 1024, 4 * 1024 * 1024);
+    RowBlock block(iter->schema(), 1024, &arena);
+    ColumnarSerializedBatch batch;
+    string csv;
+    while (iter->HasNext()) {
+      arena.Reset();
+      RETURN_NOT_OK(iter->NextBlock(&block));
+      size_t num_selected = block.selection_vector()->CountSelected();
+      if (num_selected == 0) {
+        continue;
+      }
+      num_rows_.IncrementBy(num_selected);
+      if (columnar) {
+        SerializeRowBlockColumnar(block, &output_projection_, &batch);
+        if (batch.TotalSize() >= kColumnarBatchBytes) {
+          RETURN_NOT_OK(WriteColumnarBatch(&batch, file.get()));
+        }
+        continue;
+      }
+      csv.clear();
+      AppendCsvRows(block, &csv);
+      if (file) {
+        RETURN_NOT_OK(file->Append(csv));
+      } else {
+        std::lock_guard<simple_spinlock> l(stdout_lock_);
+        cout << csv;
+      }
+    }
+    if (columnar && batch.num_rows > 0) {
+      RETURN_NOT_OK(WriteColumnarBatch(&batch, file.get()));
+    }
+    if (file) {
+      RETURN_NOT_OK(file->Close());
+    }
+    return Status::OK();
+  }
+
+  const scoped_refptr<TabletMetadata> meta_;
+
+  // The columns written out, and the columns read from the rowsets: the
+  // former and those of the predicates.
+  Schema output_projection_;
+  Schema scan_projection_;
+
+  // Holds the values of the predicates.
+  Arena predicate_arena_;
+  vector<ColumnPredicate> predicates_;
+
+  // Serializes writes of CSV rows to stdout.
+  simple_spinlock stdout_lock_;
+
+  AtomicInt<int64_t> num_rows_;
+  AtomicInt<int64_t> num_rowsets_pruned_;
+
+  DISALLOW_COPY_AND_ASSIGN(LocalReplicaScanner);
+};
+
+Status ScanLocalReplica(const RunnerContext& context) {
+  unique_ptr<FsManager> fs_manager;
+  RETURN_NOT_OK(FsInit(&fs_manager));
+  string tablet_id = FindOrDie(context.required_args, "tablet_id");
+
+  scoped_refptr<TabletMetadata> meta;
+  RETURN_NOT_OK(TabletMetadata::Load(fs_manager.get(), tablet_id, &meta));
+  LocalReplicaScanner scanner(std::move(meta));
+  RETURN_NOT_OK(scanner.Init());
+  return scanner.Run();
+}
+
+// Splits the CSV line 'line' into its fields, unquoting them as needed.
+Status ParseCsvLine(const string& line, vector<string>* fields) {
+  fields->clear();
+  string field;
+  bool quoted = false;
+  for (size_t i = 0; i < line.size(); i++) {
+    char c = line[i];
+    if (quoted) {
+      if (c != '"') {
+        field.push_back(c);
+      } else if (i + 1 < line.size() && line[i + 1] == '"') {
+        field.push_back('"');
+        i++;
+      } else {
+        quoted = false;
+      }
+    } else if (c == '"') {
+      quoted = true;
+    } else if (c == ',') {
+      fields->push_back(std::move(field));
+      field.clear();
+    } else {
+      field.push_back(c);
+    }
+  }
+  if (quoted) {
+    return Status::Corruption("Unterminated quoted field", line);
+  }
+  fields->push_back(std::move(field));
+  return Status::OK();
+}
+
+// Reads the CSV file at 'path' into rows of 'schema', allocated from
+// 'arena'. The first line names the columns of the file; columns missing
+// from the file get their default value, or NULL. Empty fields of nullable
+// columns are NULL, like in the output of 'local_replica scan'.
+Status ReadCsvRows(const string& path, const Schema& schema, Arena* arena,
+                   vector<uint8_t*>* rows) {
+  faststring data;
+  RETURN_NOT_OK(ReadFileToString(Env::Default(), path, &data));
+  vector<string> lines = Split(data.ToString(), "\n", strings::SkipEmpty());
+  if (lines.empty()) {
+    return Status::InvalidArgument("Input file has no header line", path);
+  }
+
+  // The index in the file of each column of the schema, or -1.
+  vector<string> fields;
+  RETURN_NOT_OK(ParseCsvLine(lines[0], &fields));
+  vector<int> field_idxs(schema.num_columns(), -1);
+  for (int i = 0; i < fields.size(); i++) {
+    int col_idx = schema.find_column(fields[i]);
+    if (col_idx == Schema::kColumnNotFound) {
+      return Status::NotFound("No such column", fields[i]);
+    }
+    field_idxs[col_idx] = i;
+  }
+  for (int i = 0; i < schema.num_columns(); i++) {
+    const ColumnSchema& col = schema.column(i);
+    if (field_idxs[i] == -1 && !col.is_nullable() && !col.has_write_default()) {
+      return Status::InvalidArgument("Input file is missing column", col.name());
+    }
+  }
+
+  for (int l = 1; l < lines.size(); l++) {
+    RETURN_NOT_OK(ParseCsvLine(lines[l], &fields));
+    if (fields.size() != field_idxs.size() - std::count(field_idxs.begin(),
+                                                        field_idxs.end(), -1)) {
+      return Status::Corruption(Substitute("Wrong number of fields on line $0", l + 1),
+                                lines[l]);
+    }
+    uint8_t* data = reinterpret_cast<uint8_t*>(arena->AllocateBytes(schema.byte_size()));
+    ContiguousRow row(&schema, data);
+    for (int i = 0; i < schema.num_columns(); i++) {
+      const ColumnSchema& col = schema.column(i);
+      const void* value = nullptr;
+      if (field_idxs[i] == -1) {
+        value = col.write_default_value();
+      } else if (!col.is_nullable() || !fields[field_idxs[i]].empty()) {
+        RETURN_NOT_OK_PREPEND(ParseCellValue(col, fields[field_idxs[i]], arena, &value),
+                              Substitute("Line $0", l + 1));
+      }
+      if (col.is_nullable()) {
+        row.set_null(i, value == nullptr);
+      }
+      if (value) {
+        memcpy(row.mutable_cell_ptr(i), value, col.type_info()->size());
+      }
+    }
+    rows->push_back(data);
+  }
+  return Status::OK();
+}
+
+Status BulkLoadLocalReplica(const RunnerContext& context) {
+  string tablet_id = FindOrDie(context.required_args, "tablet_id");
+  string input_path = FindOrDie(context.required_args, "input_path");
+
+  FsManager fs_manager(Env::Default(), FsManagerOpts());
+  RETURN_NOT_OK(fs_manager.Open());
+  scoped_refptr<TabletMetadata> meta;
+  RETURN_NOT_OK(TabletMetadata::Load(&fs_manager, tablet_id, &meta));
+  const Schema& schema = meta->schema();
+
+  Arena arena(1024 * 1024, 256 * 1024 * 1024);
+  vector<uint8_t*> rows;
+  RETURN_NOT_OK(ReadCsvRows(input_path, schema, &arena, &rows));
+  if (rows.empty()) {
+    cout << "No rows to load" << endl;
+    return Status::OK();
+  }
+
+  // Rowsets must be written in key order, and keys must be unique.
+  vector<pair<string, uint8_t*>> keyed_rows;
+  keyed_rows.reserve(rows.size());
+  faststring key_buf;
+  for (uint8_t* data : rows) {
+    ConstContiguousRow row(&schema, data);
+    bool contains;
+    RETURN_NOT_OK(meta->partition_schema().PartitionContainsRow(meta->partition(), row,
+                                                                &contains));
+    if (!contains) {
+      return Status::InvalidArgument("Row does not belong to the tablet's partition",
+                                     schema.DebugRowKey(row));
+    }
+    keyed_rows.emplace_back(schema.EncodeComparableKey(row, &key_buf).ToString(), data);
+  }
+  std::sort(keyed_rows.begin(), keyed_rows.end(),
+            [](const pair<string, uint8_t*>& a, const pair<string, uint8_t*>& b) {
+              return a.first < b.first;
+            });
+  for (int i = 1; i < keyed_rows.size(); i++) {
+    if (keyed_rows[i].first == keyed_rows[i - 1].first) {
+      return Status::AlreadyPresent(
+          "Duplicate key in input",
+          schema.DebugRowKey(ConstContiguousRow(&schema, keyed_rows[i].second)));
+    }
+  }
+
+  // Keys are only checked for uniqueness against the rowsets which may
+  // contain them, so the new rows must not fall within an existing rowset.
+  const string& min_key = keyed_rows.front().first;
+  const string& max_key = keyed_rows.back().first;
+  scoped_refptr<log::LogAnchorRegistry> registry(new log::LogAnchorRegistry());
+  for (const shared_ptr<RowSetMetadata>& rs_meta : meta->rowsets()) {
+    shared_ptr<DiskRowSet> rs;
+    RETURN_NOT_OK(DiskRowSet::Open(rs_meta, registry.get(), &rs));
+    string rs_min_key;
+    string rs_max_key;
+    RETURN_NOT_OK(rs->GetBounds(&rs_min_key, &rs_max_key));
+    if (min_key <= rs_max_key && rs_min_key <= max_key) {
+      return Status::IllegalState(Substitute(
+          "The keys to load overlap those of rowset $0", rs_meta->id()));
+    }
+  }
+
+  RollingDiskRowSetWriter writer(meta.get(), schema,
+                                 BloomFilterSizing::BySizeAndFPRate(
+                                     FLAGS_tablet_bloom_block_size,
+                                     FLAGS_tablet_bloom_target_fp_rate),
+                                 FLAGS_budgeted_compaction_target_rowset_size);
+  RETURN_NOT_OK(writer.Open());
+  Arena block_arena(32 * 1024, 4 * 1024 * 1024);
+  RowBlock block(schema, 1024, &block_arena);
+  for (size_t start = 0; start < keyed_rows.size(); start += block.row_capacity()) {
+    block_arena.Reset();
+    size_t n = std::min(block.row_capacity(), keyed_rows.size() - start);
+    block.Resize(n);
+    for (size_t i = 0; i < n; i++) {
+      ConstContiguousRow src(&schema, keyed_rows[start + i].second);
+      RowBlockRow dst = block.row(i);
+      RETURN_NOT_OK(CopyRow(src, &dst, &block_arena));
+    }
+    RETURN_NOT_OK(writer.AppendBlock(block));
+    RETURN_NOT_OK(writer.RollIfNecessary());
+  }
+  RETURN_NOT_OK(writer.Finish());
+
+  // Adopt all the new rowsets with a single superblock flush.
+  RowSetMetadataVector new_rowsets;
+  writer.GetWrittenRowSetMetadata(&new_rowsets);
+  RETURN_NOT_OK(meta->UpdateAndFlush(tablet::RowSetMetadataIds(), new_rowsets,
+                                     TabletMetadata::kNoMrsFlushed));
+  cout << Substitute("Loaded $0 rows into $1 new rowsets of tablet $2",
+                     keyed_rows.size(), new_rowsets.size(), tablet_id) << endl;
+  return Status::OK();
+}
+
 unique_ptr<Mode> BuildDumpMode() {
   unique_ptr<Action> dump_block_ids =
       ActionBuilder("block_ids", &DumpBlockIdsForLocalReplica)
@@ -711,11 +1340,42 @@ unique_ptr<Mode> BuildLocalReplicaMode() {
       .AddOptionalParameter("list_detail")
       .Build();
 
+  unique_ptr<Action> bulk_load =
+      ActionBuilder("bulk_load", &BulkLoadLocalReplica)
+      .Description("Load rows into a local replica as new rowsets, bypassing "
+                   "the write path")
+      .ExtraDescription("The replica must not be running, and must not have any "
+                        "unflushed writes to the keys being loaded. The new rows "
+                        "are visible at all timestamps. To keep the replicas of "
+                        "the tablet consistent, the same input has to be loaded "
+                        "into each of them.")
+      .AddRequiredParameter({ "tablet_id", "Tablet identifier" })
+      .AddRequiredParameter({ "input_path", "Path of a CSV file whose first line "
+        "names the columns of the rows that follow" })
+      .AddOptionalParameter("fs_wal_dir")
+      .AddOptionalParameter("fs_data_dirs")
+      .Build();
+
+  unique_ptr<Action> scan =
+      ActionBuilder("scan", &ScanLocalReplica)
+      .Description("Scan the rows of a local replica, one thread per rowset")
+      .AddRequiredParameter({ "tablet_id", "Tablet identifier" })
+      .AddOptionalParameter("fs_wal_dir")
+      .AddOptionalParameter("fs_data_dirs")
+      .AddOptionalParameter("columns")
+      .AddOptionalParameter("predicates")
+      .AddOptionalParameter("scan_format")
+      .AddOptionalParameter("output_dir")
+      .AddOptionalParameter("num_threads")
+      .Build();
+
   return ModeBuilder("local_replica")
       .Description("Operate on local Kudu replicas via the local filesystem")
       .AddMode(std::move(cmeta))
+      .AddAction(std::move(bulk_load))
       .AddAction(std::move(copy_from_remote))
       .AddAction(std::move(list))
+      .AddAction(std::move(scan))
       .AddMode(BuildDumpMode())
       .Build();
 }
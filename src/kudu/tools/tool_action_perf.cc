@@ -0,0 +1,624 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/tools/tool_action.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <gflags/gflags.h>
+
+#include "kudu/benchmarks/ycsb-schema.h"
+#include "kudu/client/client.h"
+#include "kudu/common/partial_row.h"
+#include "kudu/gutil/gscoped_ptr.h"
+#include "kudu/gutil/map-util.h"
+#include "kudu/gutil/stl_util.h"
+#include "kudu/gutil/strings/split.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/gutil/stringprintf.h"
+#include "kudu/util/hdr_histogram.h"
+#include "kudu/util/monotime.h"
+#include "kudu/util/random.h"
+#include "kudu/util/status.h"
+
+DEFINE_string(ycsb_workload, "a",
+              "The YCSB core workload to run, 'a' through 'f': a (50% reads, "
+              "50% updates), b (95% reads, 5% updates), c (reads only), d (95% "
+              "reads of recently inserted rows, 5% inserts), e (95% short "
+              "scans, 5% inserts) or f (50% reads, 50% read-modify-writes).");
+DEFINE_bool(ycsb_load, true,
+            "Whether to create the table and load --ycsb_record_count rows into "
+            "it before running the workload. If false, the table must already "
+            "hold the rows of a previous load with the same record count.");
+DEFINE_int64(ycsb_record_count, 100000,
+             "Number of rows loaded into the table, from which the rows "
+             "accessed by the workload are chosen.");
+DEFINE_int64(ycsb_operation_count, 100000,
+             "Number of operations the workload performs, in total.");
+DEFINE_int32(ycsb_threads, 16,
+             "Number of client threads loading the table and running the "
+             "workload.");
+DEFINE_double(ycsb_target_ops_per_sec, 0,
+              "If positive, run the workload open-loop: operations are issued "
+              "on a fixed schedule at this total rate, whether or not earlier "
+              "ones have completed, and latencies are measured from the time "
+              "each operation was scheduled. Otherwise each thread issues its "
+              "next operation as soon as the previous one completes.");
+DEFINE_int32(ycsb_field_length, 100,
+             "Length in bytes of the values of each of the ten fields of a row.");
+DEFINE_int32(ycsb_max_scan_length, 100,
+             "Maximum number of rows read by a scan of workload e. The number "
+             "read by each scan is chosen uniformly from 1 to this.");
+DEFINE_int32(ycsb_num_tablets, 8,
+             "Number of tablets of the table created to load into, range "
+             "partitioned over the key space.");
+DEFINE_int32(ycsb_num_replicas, 1,
+             "Replication factor of the table created to load into.");
+
+namespace kudu {
+namespace tools {
+
+using client::KuduClient;
+using client::KuduClientBuilder;
+using client::KuduInsert;
+using client::KuduPredicate;
+using client::KuduRowLookup;
+using client::KuduScanBatch;
+using client::KuduScanner;
+using client::KuduSchema;
+using client::KuduSession;
+using client::KuduTable;
+using client::KuduTableCreator;
+using client::KuduUpdate;
+using client::KuduValue;
+using client::sp::shared_ptr;
+using std::atomic;
+using std::cout;
+using std::endl;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+using strings::Substitute;
+
+namespace {
+
+const char* const kMasterAddressesArg = "master_addresses";
+const char* const kTableNameArg = "table_name";
+
+const int kNumFields = 10;
+const int kLoadBatchSize = 1000;
+
+// Latencies are tracked up to a minute, in microseconds.
+const int64_t kMaxTrackedLatencyUs = 60 * 1000 * 1000;
+const int kNumSignificantDigits = 3;
+
+enum YcsbOp {
+  kRead = 0,
+  kUpdate,
+  kInsert,
+  kScan,
+  kReadModifyWrite,
+  kNumOps
+};
+
+const char* YcsbOpName(YcsbOp op) {
+  switch (op) {
+    case kRead: return "READ";
+    case kUpdate: return "UPDATE";
+    case kInsert: return "INSERT";
+    case kScan: return "SCAN";
+    case kReadModifyWrite: return "READ-MODIFY-WRITE";
+    case kNumOps: break;
+  }
+  LOG(FATAL) << "Unknown YCSB operation: " << op;
+  return nullptr;
+}
+
+enum KeyDistribution {
+  kZipfian,
+  kLatest
+};
+
+// The operation mix of a core workload, as the fraction of each operation.
+struct YcsbWorkload {
+  double op_fractions[kNumOps];
+  KeyDistribution distribution;
+};
+
+Status ParseWorkload(const string& name, YcsbWorkload* workload) {
+  //                                    read  update insert scan  rmw
+  static const YcsbWorkload kA = { { 0.50, 0.50, 0,    0,    0    }, kZipfian };
+  static const YcsbWorkload kB = { { 0.95, 0.05, 0,    0,    0    }, kZipfian };
+  static const YcsbWorkload kC = { { 1,    0,    0,    0,    0    }, kZipfian };
+  static const YcsbWorkload kD = { { 0.95, 0,    0.05, 0,    0    }, kLatest };
+  static const YcsbWorkload kE = { { 0,    0,    0.05, 0.95, 0    }, kZipfian };
+  static const YcsbWorkload kF = { { 0.50, 0,    0,    0,    0.50 }, kZipfian };
+  if (name == "a") {
+    *workload = kA;
+  } else if (name == "b") {
+    *workload = kB;
+  } else if (name == "c") {
+    *workload = kC;
+  } else if (name == "d") {
+    *workload = kD;
+  } else if (name == "e") {
+    *workload = kE;
+  } else if (name == "f") {
+    *workload = kF;
+  } else {
+    return Status::InvalidArgument("unknown YCSB workload", name);
+  }
+  return Status::OK();
+}
+
+// The key of the row inserted 'keynum'-th. As in YCSB, the insertion order
+// is hashed with FNV-1a, so that consecutive inserts land all over the key
+// space.
+string YcsbKey(uint64_t keynum) {
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for (int i = 0; i < 8; i++) {
+    hash ^= (keynum >> (i * 8)) & 0xff;
+    hash *= 0x100000001b3ULL;
+  }
+  return StringPrintf("user%020llu", static_cast<unsigned long long>(hash));
+}
+
+// Generates integers in [0, items) following a Zipfian distribution, most
+// popular first, using the algorithm of Gray et al., "Quickly Generating
+// Billion-Record Synthetic Databases", like YCSB's ZipfianGenerator.
+class ZipfianGenerator {
+ public:
+  explicit ZipfianGenerator(uint64_t items)
+      : items_(items),
+        zetan_(Zeta(items)),
+        alpha_(1.0 / (1.0 - kTheta)),
+        eta_((1 - pow(2.0 / items, 1 - kTheta)) / (1 - Zeta(2) / zetan_)) {
+  }
+
+  uint64_t Next(Random* rng) const {
+    double u = rng->NextDoubleFraction();
+    double uz = u * zetan_;
+    if (uz < 1.0) {
+      return 0;
+    }
+    if (uz < 1.0 + pow(0.5, kTheta)) {
+      return 1;
+    }
+    uint64_t ret = items_ * pow(eta_ * u - eta_ + 1, alpha_);
+    return std::min(ret, items_ - 1);
+  }
+
+ private:
+  static constexpr double kTheta = 0.99;
+
+  static double Zeta(uint64_t n) {
+    double sum = 0;
+    for (uint64_t i = 0; i < n; i++) {
+      sum += 1 / pow(i + 1, kTheta);
+    }
+    return sum;
+  }
+
+  const uint64_t items_;
+  const double zetan_;
+  const double alpha_;
+  const double eta_;
+};
+
+// Returns the first error of 'session', or 's' if there is none.
+Status FirstSessionError(KuduSession* session, const Status& s) {
+  vector<client::KuduError*> errors;
+  ElementDeleter deleter(&errors);
+  bool overflowed;
+  session->GetPendingErrors(&errors, &overflowed);
+  if (errors.empty()) {
+    return s;
+  }
+  return errors[0]->status();
+}
+
+class YcsbRunner {
+ public:
+  YcsbRunner(shared_ptr<KuduClient> client, string table_name)
+      : client_(std::move(client)),
+        table_name_(std::move(table_name)),
+        num_inserted_(FLAGS_ycsb_record_count),
+        next_insert_(FLAGS_ycsb_record_count) {
+    for (auto& h : histograms_) {
+      h.reset(new HdrHistogram(kMaxTrackedLatencyUs, kNumSignificantDigits));
+    }
+    for (auto& e : errors_) {
+      e.store(0);
+    }
+  }
+
+  Status Init() {
+    RETURN_NOT_OK(ParseWorkload(FLAGS_ycsb_workload, &workload_));
+    if (FLAGS_ycsb_record_count <= 0) {
+      return Status::InvalidArgument("--ycsb_record_count must be positive");
+    }
+    if (FLAGS_ycsb_threads <= 0) {
+      return Status::InvalidArgument("--ycsb_threads must be positive");
+    }
+    if (FLAGS_ycsb_load) {
+      RETURN_NOT_OK(CreateTable());
+    }
+    RETURN_NOT_OK(client_->OpenTable(table_name_, &table_));
+    zipfian_.reset(new ZipfianGenerator(FLAGS_ycsb_record_count));
+    return Status::OK();
+  }
+
+  // Inserts the rows of the initial record count.
+  Status Load() {
+    MonoTime start = MonoTime::Now();
+    RETURN_NOT_OK(RunThreads([this](int thread_idx) { return LoadThread(thread_idx); }));
+    double secs = (MonoTime::Now() - start).ToSeconds();
+    cout << StringPrintf("[LOAD] %lld rows in %.3f s, %.1f rows/sec",
+                         static_cast<long long>(FLAGS_ycsb_record_count), secs,
+                         FLAGS_ycsb_record_count / secs) << endl;
+    return Status::OK();
+  }
+
+  // Runs the workload and prints the latency of each type of operation.
+  Status Run() {
+    MonoTime start = MonoTime::Now();
+    RETURN_NOT_OK(RunThreads([this](int thread_idx) { return RunThread(thread_idx); }));
+    double secs = (MonoTime::Now() - start).ToSeconds();
+
+    cout << StringPrintf("[OVERALL] workload %s, %s, %.3f s, %.1f ops/sec",
+                         FLAGS_ycsb_workload.c_str(),
+                         FLAGS_ycsb_target_ops_per_sec > 0 ? "open loop" : "closed loop",
+                         secs, FLAGS_ycsb_operation_count / secs) << endl;
+    for (int i = 0; i < kNumOps; i++) {
+      HdrHistogram h(*histograms_[i]);
+      int64_t errors = errors_[i].load();
+      if (h.TotalCount() == 0 && errors == 0) {
+        continue;
+      }
+      cout << StringPrintf("[%s] count %lld, errors %lld",
+                           YcsbOpName(static_cast<YcsbOp>(i)),
+                           static_cast<long long>(h.TotalCount()),
+                           static_cast<long long>(errors));
+      if (h.TotalCount() > 0) {
+        cout << StringPrintf(", mean %.1f us, p50 %llu us, p95 %llu us, p99 %llu us, "
+                             "p99.9 %llu us, max %llu us",
+                             h.MeanValue(),
+                             static_cast<unsigned long long>(h.ValueAtPercentile(50)),
+                             static_cast<unsigned long long>(h.ValueAtPercentile(95)),
+                             static_cast<unsigned long long>(h.ValueAtPercentile(99)),
+                             static_cast<unsigned long long>(h.ValueAtPercentile(99.9)),
+                             static_cast<unsigned long long>(h.MaxValue()));
+      }
+      cout << endl;
+    }
+    return Status::OK();
+  }
+
+ private:
+  Status CreateTable() {
+    KuduSchema schema(CreateYCSBSchema());
+    gscoped_ptr<KuduTableCreator> creator(client_->NewTableCreator());
+    creator->table_name(table_name_)
+        .schema(&schema)
+        .set_range_partition_columns({ "key" })
+        .num_replicas(FLAGS_ycsb_num_replicas);
+    // The keys are hashes, so split the range of hashes evenly.
+    for (int i = 1; i < FLAGS_ycsb_num_tablets; i++) {
+      KuduPartialRow* split = schema.NewRow();
+      uint64_t hash = std::numeric_limits<uint64_t>::max() / FLAGS_ycsb_num_tablets * i;
+      RETURN_NOT_OK(split->SetStringCopy(
+          "key", StringPrintf("user%020llu", static_cast<unsigned long long>(hash))));
+      creator->add_range_partition_split(split);
+    }
+    return creator->Create();
+  }
+
+  Status RunThreads(const std::function<Status(int)>& f) {
+    vector<Status> statuses(FLAGS_ycsb_threads);
+    vector<std::thread> threads;
+    for (int i = 0; i < FLAGS_ycsb_threads; i++) {
+      threads.emplace_back([&, i]() { statuses[i] = f(i); });
+    }
+    for (auto& t : threads) {
+      t.join();
+    }
+    for (const auto& s : statuses) {
+      RETURN_NOT_OK(s);
+    }
+    return Status::OK();
+  }
+
+  // Sets the fields of 'row' to random values, or only one random field if
+  // 'one_field' is true.
+  static Status SetFields(Random* rng, const string& value_buf, bool one_field,
+                          KuduPartialRow* row) {
+    int first = one_field ? rng->Uniform(kNumFields) : 0;
+    int last = one_field ? first + 1 : kNumFields;
+    for (int f = first; f < last; f++) {
+      size_t offset = rng->Uniform(value_buf.size() - FLAGS_ycsb_field_length + 1);
+      RETURN_NOT_OK(row->SetStringCopy(
+          Substitute("field$0", f),
+          Slice(value_buf.data() + offset, FLAGS_ycsb_field_length)));
+    }
+    return Status::OK();
+  }
+
+  // Returns a buffer of random printable characters, which random slices
+  // of are used as field values.
+  static string RandomValueBuffer(Random* rng) {
+    string buf(FLAGS_ycsb_field_length * 4, ' ');
+    for (auto& c : buf) {
+      c = ' ' + rng->Uniform(95);
+    }
+    return buf;
+  }
+
+  Status LoadThread(int thread_idx) {
+    Random rng(thread_idx);
+    string value_buf = RandomValueBuffer(&rng);
+    shared_ptr<KuduSession> session = client_->NewSession();
+    RETURN_NOT_OK(session->SetFlushMode(KuduSession::MANUAL_FLUSH));
+    session->SetTimeoutMillis(60000);
+
+    int64_t per_thread = FLAGS_ycsb_record_count / FLAGS_ycsb_threads;
+    int64_t begin = per_thread * thread_idx;
+    int64_t end = thread_idx == FLAGS_ycsb_threads - 1 ?
+        FLAGS_ycsb_record_count : begin + per_thread;
+    for (int64_t keynum = begin; keynum < end; keynum++) {
+      unique_ptr<KuduInsert> insert(table_->NewInsert());
+      RETURN_NOT_OK(insert->mutable_row()->SetStringCopy("key", YcsbKey(keynum)));
+      RETURN_NOT_OK(SetFields(&rng, value_buf, false, insert->mutable_row()));
+      RETURN_NOT_OK(session->Apply(insert.release()));
+      if ((keynum - begin + 1) % kLoadBatchSize == 0 || keynum == end - 1) {
+        Status s = session->Flush();
+        if (!s.ok()) {
+          return FirstSessionError(session.get(), s);
+        }
+      }
+    }
+    return Status::OK();
+  }
+
+  YcsbOp ChooseOp(Random* rng) const {
+    double r = rng->NextDoubleFraction();
+    for (int i = 0; i < kNumOps; i++) {
+      r -= workload_.op_fractions[i];
+      if (r < 0) {
+        return static_cast<YcsbOp>(i);
+      }
+    }
+    return kRead;
+  }
+
+  // Chooses the key of an existing row to access.
+  string ChooseKey(Random* rng) const {
+    uint64_t rank = zipfian_->Next(rng);
+    if (workload_.distribution == kLatest) {
+      // The most recently inserted rows are the most popular.
+      uint64_t latest = num_inserted_.load(std::memory_order_relaxed);
+      return YcsbKey(latest - 1 - std::min(rank, latest - 1));
+    }
+    // Scramble the ranks so that the popular rows are spread over the key
+    // space, rather than being the first rows inserted.
+    return YcsbKey(YcsbKeyHash(rank) % FLAGS_ycsb_record_count);
+  }
+
+  static uint64_t YcsbKeyHash(uint64_t rank) {
+    return rank * 0x9e3779b97f4a7c15ULL;
+  }
+
+  Status Read(const string& key, KuduRowLookup* lookup) {
+    unique_ptr<KuduPartialRow> row(table_->schema().NewRow());
+    RETURN_NOT_OK(row->SetStringCopy("key", key));
+    RETURN_NOT_OK(lookup->AddKey(*row));
+    vector<KuduScanBatch*> batches;
+    ElementDeleter deleter(&batches);
+    return lookup->Run(&batches);
+  }
+
+  Status Update(const string& key, Random* rng, const string& value_buf,
+                KuduSession* session) {
+    unique_ptr<KuduUpdate> update(table_->NewUpdate());
+    RETURN_NOT_OK(update->mutable_row()->SetStringCopy("key", key));
+    RETURN_NOT_OK(SetFields(rng, value_buf, true, update->mutable_row()));
+    Status s = session->Apply(update.release());
+    return s.ok() ? s : FirstSessionError(session, s);
+  }
+
+  Status Insert(Random* rng, const string& value_buf, KuduSession* session) {
+    int64_t keynum = next_insert_++;
+    unique_ptr<KuduInsert> insert(table_->NewInsert());
+    RETURN_NOT_OK(insert->mutable_row()->SetStringCopy("key", YcsbKey(keynum)));
+    RETURN_NOT_OK(SetFields(rng, value_buf, false, insert->mutable_row()));
+    Status s = session->Apply(insert.release());
+    if (!s.ok()) {
+      return FirstSessionError(session, s);
+    }
+    // Not exact when inserts complete out of order, which only means that
+    // a read may look for a row which is still being inserted.
+    int64_t inserted = num_inserted_.load();
+    while (inserted <= keynum &&
+           !num_inserted_.compare_exchange_weak(inserted, keynum + 1)) {
+    }
+    return Status::OK();
+  }
+
+  Status Scan(const string& start_key, Random* rng) {
+    KuduScanner scanner(table_.get());
+    RETURN_NOT_OK(scanner.AddConjunctPredicate(table_->NewComparisonPredicate(
+        "key", KuduPredicate::GREATER_EQUAL, KuduValue::CopyString(start_key))));
+    RETURN_NOT_OK(scanner.SetLimit(1 + rng->Uniform(FLAGS_ycsb_max_scan_length)));
+    RETURN_NOT_OK(scanner.Open());
+    KuduScanBatch batch;
+    while (scanner.HasMoreRows()) {
+      RETURN_NOT_OK(scanner.NextBatch(&batch));
+    }
+    return Status::OK();
+  }
+
+  Status RunOp(YcsbOp op, Random* rng, const string& value_buf,
+               KuduSession* session, KuduRowLookup* lookup) {
+    switch (op) {
+      case kRead:
+        return Read(ChooseKey(rng), lookup);
+      case kUpdate:
+        return Update(ChooseKey(rng), rng, value_buf, session);
+      case kInsert:
+        return Insert(rng, value_buf, session);
+      case kScan:
+        return Scan(ChooseKey(rng), rng);
+      case kReadModifyWrite: {
+        string key = ChooseKey(rng);
+        RETURN_NOT_OK(Read(key, lookup));
+        return Update(key, rng, value_buf, session);
+      }
+      case kNumOps:
+        break;
+    }
+    LOG(FATAL) << "Unknown YCSB operation: " << op;
+    return Status::OK();
+  }
+
+  Status RunThread(int thread_idx) {
+    Random rng(thread_idx + FLAGS_ycsb_threads);
+    string value_buf = RandomValueBuffer(&rng);
+    shared_ptr<KuduSession> session = client_->NewSession();
+    RETURN_NOT_OK(session->SetFlushMode(KuduSession::AUTO_FLUSH_SYNC));
+    KuduRowLookup lookup(table_.get());
+
+    int64_t num_ops = FLAGS_ycsb_operation_count / FLAGS_ycsb_threads;
+    if (thread_idx < FLAGS_ycsb_operation_count % FLAGS_ycsb_threads) {
+      num_ops++;
+    }
+
+    // In open-loop mode, every thread issues its share of the target rate on
+    // a fixed schedule.
+    bool open_loop = FLAGS_ycsb_target_ops_per_sec > 0;
+    MonoDelta interval;
+    if (open_loop) {
+      interval = MonoDelta::FromSeconds(FLAGS_ycsb_threads / FLAGS_ycsb_target_ops_per_sec);
+    }
+    MonoTime start = MonoTime::Now();
+    for (int64_t i = 0; i < num_ops; i++) {
+      MonoTime op_start;
+      if (open_loop) {
+        op_start = start + MonoDelta::FromNanoseconds(interval.ToNanoseconds() * i);
+        MonoTime now = MonoTime::Now();
+        if (now < op_start) {
+          SleepFor(op_start - now);
+        }
+      } else {
+        op_start = MonoTime::Now();
+      }
+
+      YcsbOp op = ChooseOp(&rng);
+      Status s = RunOp(op, &rng, value_buf, session.get(), &lookup);
+      if (!s.ok()) {
+        VLOG(1) << YcsbOpName(op) << " failed: " << s.ToString();
+        errors_[op]++;
+        continue;
+      }
+      int64_t us = (MonoTime::Now() - op_start).ToMicroseconds();
+      histograms_[op]->Increment(std::min(std::max<int64_t>(us, 0), kMaxTrackedLatencyUs));
+    }
+    return Status::OK();
+  }
+
+  const shared_ptr<KuduClient> client_;
+  const string table_name_;
+  shared_ptr<KuduTable> table_;
+
+  YcsbWorkload workload_;
+  unique_ptr<ZipfianGenerator> zipfian_;
+
+  // The number of rows known to be inserted, and the next row to insert.
+  atomic<int64_t> num_inserted_;
+  atomic<int64_t> next_insert_;
+
+  unique_ptr<HdrHistogram> histograms_[kNumOps];
+  atomic<int64_t> errors_[kNumOps];
+
+  DISALLOW_COPY_AND_ASSIGN(YcsbRunner);
+};
+
+Status RunYcsb(const RunnerContext& context) {
+  string master_addresses_str = FindOrDie(context.required_args,
+                                          kMasterAddressesArg);
+  vector<string> master_addresses = strings::Split(master_addresses_str, ",");
+  string table_name = FindOrDie(context.required_args, kTableNameArg);
+
+  shared_ptr<KuduClient> client;
+  RETURN_NOT_OK(KuduClientBuilder()
+                .master_server_addrs(master_addresses)
+                .Build(&client));
+
+  YcsbRunner runner(client, table_name);
+  RETURN_NOT_OK(runner.Init());
+  if (FLAGS_ycsb_load) {
+    RETURN_NOT_OK(runner.Load());
+  }
+  return runner.Run();
+}
+
+} // anonymous namespace
+
+unique_ptr<Mode> BuildPerfMode() {
+  unique_ptr<Action> ycsb =
+      ActionBuilder("ycsb", &RunYcsb)
+      .Description("Run a YCSB core workload against a Kudu cluster")
+      .ExtraDescription(
+          "Loads a table with the YCSB schema, then runs one of the YCSB core "
+          "workloads against it and prints the latency percentiles of each type "
+          "of operation. The workload runs closed-loop by default, or open-loop "
+          "at a fixed rate with --ycsb_target_ops_per_sec, in which case the "
+          "latencies include the time operations spent waiting behind slower "
+          "ones.")
+      .AddRequiredParameter({
+        kMasterAddressesArg,
+        "Comma-separated list of Kudu Master addresses where each address is "
+        "of form 'hostname:port'" })
+      .AddRequiredParameter({ kTableNameArg, "Name of the table to run against" })
+      .AddOptionalParameter("ycsb_field_length")
+      .AddOptionalParameter("ycsb_load")
+      .AddOptionalParameter("ycsb_max_scan_length")
+      .AddOptionalParameter("ycsb_num_replicas")
+      .AddOptionalParameter("ycsb_num_tablets")
+      .AddOptionalParameter("ycsb_operation_count")
+      .AddOptionalParameter("ycsb_record_count")
+      .AddOptionalParameter("ycsb_target_ops_per_sec")
+      .AddOptionalParameter("ycsb_threads")
+      .AddOptionalParameter("ycsb_workload")
+      .Build();
+
+  return ModeBuilder("perf")
+      .Description("Measure the performance of a Kudu cluster")
+      .AddAction(std::move(ycsb))
+      .Build();
+}
+
+} // namespace tools
+} // namespace kudu
@@ -185,7 +185,7 @@ unique_ptr<Mode> BuildTabletMode() {
       .AddRequiredParameter({ kTabletIdArg, "Tablet Identifier" })
       .AddRequiredParameter({ kReplicaUuidArg, "New replica's UUID" })
       .AddRequiredParameter(
-          { kReplicaTypeArg, "New replica's type. Must be VOTER or NON-VOTER."
+          { kReplicaTypeArg, "New replica's type. Must be VOTER or NON_VOTER."
           })
       .Build();
 
@@ -200,7 +200,7 @@ unique_ptr<Mode> BuildTabletMode() {
       .AddRequiredParameter({ kTabletIdArg, "Tablet Identifier" })
       .AddRequiredParameter({ kReplicaUuidArg, "Existing replica's UUID" })
       .AddRequiredParameter(
-          { kReplicaTypeArg, "Existing replica's new type. Must be VOTER or NON-VOTER."
+          { kReplicaTypeArg, "Existing replica's new type. Must be VOTER or NON_VOTER."
           })
       .Build();
 
@@ -17,6 +17,7 @@
 
 #include "kudu/tserver/heartbeater.h"
 
+#include <algorithm>
 #include <gflags/gflags.h>
 #include <glog/logging.h>
 #include <memory>
@@ -24,6 +25,7 @@
 #include <vector>
 
 #include "kudu/common/wire_protocol.h"
+#include "kudu/fs/fs_manager.h"
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/master/master.h"
@@ -33,7 +35,9 @@
 #include "kudu/tserver/tablet_server.h"
 #include "kudu/tserver/tablet_server_options.h"
 #include "kudu/tserver/ts_tablet_manager.h"
+#include "kudu/util/env.h"
 #include "kudu/util/flag_tags.h"
+#include "kudu/util/logging.h"
 #include "kudu/util/thread.h"
 #include "kudu/util/monotime.h"
 #include "kudu/util/net/net_util.h"
@@ -116,6 +120,7 @@ class Heartbeater::Thread {
   Status DoHeartbeat();
   Status SetupRegistration(ServerRegistrationPB* reg);
   void SetupCommonField(master::TSToMasterCommonPB* common);
+  void SetupLoad(master::TabletServerLoadPB* load);
   bool IsCurrentThread() const;
 
   // The host and port of the master that this thread will heartbeat to.
@@ -176,6 +181,12 @@ class Heartbeater::Thread {
   // the thread detects that the master has been elected leader.
   bool send_full_tablet_report_;
 
+  // The row counts sent with the last heartbeat, from which the rates of the
+  // next heartbeat are computed.
+  MonoTime last_load_time_;
+  int64_t last_rows_written_;
+  int64_t last_rows_scanned_;
+
   DISALLOW_COPY_AND_ASSIGN(Thread);
 };
 
@@ -275,7 +286,9 @@ Heartbeater::Thread::Thread(const HostPort& master_address, TabletServer* server
     cond_(&mutex_),
     should_run_(false),
     heartbeat_asap_(true),
-    send_full_tablet_report_(false) {
+    send_full_tablet_report_(false),
+    last_rows_written_(0),
+    last_rows_scanned_(0) {
 }
 
 Status Heartbeater::Thread::ConnectToMaster() {
@@ -296,6 +309,43 @@ Status Heartbeater::Thread::ConnectToMaster() {
   return Status::OK();
 }
 
+void Heartbeater::Thread::SetupLoad(master::TabletServerLoadPB* load) {
+  int64_t min_bytes_free = -1;
+  for (const string& dir : server_->fs_manager()->GetDataRootDirs()) {
+    int64_t bytes_free;
+    Status s = Env::Default()->GetBytesFree(dir, &bytes_free);
+    if (!s.ok()) {
+      KLOG_EVERY_N_SECS(WARNING, 60) << "Could not get the free space of " << dir
+                                     << ": " << s.ToString();
+      continue;
+    }
+    if (min_bytes_free < 0 || bytes_free < min_bytes_free) {
+      min_bytes_free = bytes_free;
+    }
+  }
+  if (min_bytes_free >= 0) {
+    load->set_min_data_dir_bytes_free(min_bytes_free);
+  }
+
+  int64_t rows_written;
+  int64_t rows_scanned;
+  server_->tablet_manager()->GetRowCounts(&rows_written, &rows_scanned);
+  MonoTime now = MonoTime::Now();
+  if (last_load_time_.Initialized()) {
+    double secs = (now - last_load_time_).ToSeconds();
+    if (secs > 0) {
+      // The counts go down when tablets are deleted or moved away.
+      load->set_rows_written_per_sec(
+          std::max<int64_t>(rows_written - last_rows_written_, 0) / secs);
+      load->set_rows_scanned_per_sec(
+          std::max<int64_t>(rows_scanned - last_rows_scanned_, 0) / secs);
+    }
+  }
+  last_load_time_ = now;
+  last_rows_written_ = rows_written;
+  last_rows_scanned_ = rows_scanned;
+}
+
 void Heartbeater::Thread::SetupCommonField(master::TSToMasterCommonPB* common) {
   common->mutable_ts_instance()->CopyFrom(server_->instance_pb());
 }
@@ -382,6 +432,7 @@ Status Heartbeater::Thread::DoHeartbeat() {
     GenerateIncrementalTabletReport(req.mutable_tablet_report());
   }
   req.set_num_live_tablets(server_->tablet_manager()->GetNumLiveTablets());
+  SetupLoad(req.mutable_load());
 
   RpcController rpc;
   rpc.set_timeout(MonoDelta::FromMilliseconds(FLAGS_heartbeat_rpc_timeout_ms));
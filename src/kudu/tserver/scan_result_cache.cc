@@ -0,0 +1,148 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#include "kudu/tserver/scan_result_cache.h"
+
+#include <cstring>
+#include <string>
+
+#include <glog/logging.h>
+
+#include "kudu/tserver/tserver.pb.h"
+#include "kudu/util/cache.h"
+#include "kudu/util/coding.h"
+
+METRIC_DEFINE_counter(server, scan_result_cache_hits,
+                      "Scan Result Cache Hits",
+                      kudu::MetricUnit::kRequests,
+                      "Number of new scan requests served from the scan result cache");
+
+METRIC_DEFINE_counter(server, scan_result_cache_inserts,
+                      "Scan Result Cache Inserts",
+                      kudu::MetricUnit::kRequests,
+                      "Number of scan results inserted into the scan result cache");
+
+using std::string;
+
+namespace kudu {
+namespace tserver {
+
+namespace {
+
+// A cached result is laid out as the lengths of the response and of its two
+// sidecars, followed by the serialized response and the sidecars.
+const int kNumLengths = 3;
+const size_t kHeaderSize = kNumLengths * sizeof(uint32_t);
+
+} // anonymous namespace
+
+ScanResultCache::ScanResultCache(size_t capacity,
+                                 const scoped_refptr<MetricEntity>& metric_entity)
+    : hits_(METRIC_scan_result_cache_hits.Instantiate(metric_entity)),
+      inserts_(METRIC_scan_result_cache_inserts.Instantiate(metric_entity)) {
+  if (capacity > 0) {
+    cache_.reset(NewLRUCache(DRAM_CACHE, capacity, "scan_result_cache"));
+  }
+}
+
+ScanResultCache::~ScanResultCache() {}
+
+bool ScanResultCache::IsCacheable(const ScanRequestPB& req) const {
+  if (!cache_ || !req.has_new_scan_request()) {
+    return false;
+  }
+  const NewScanRequestPB& scan_pb = req.new_scan_request();
+  // Requests for an empty first batch only open a scanner. Columnar results
+  // are made of a variable number of sidecars, which aren't worth caching.
+  return scan_pb.read_mode() == READ_AT_SNAPSHOT && scan_pb.has_snap_timestamp() &&
+      !(req.has_batch_size_bytes() && req.batch_size_bytes() == 0) &&
+      req.row_layout() != COLUMNAR;
+}
+
+void ScanResultCache::EncodeKey(const ScanRequestPB& req, uint32_t schema_version,
+                                faststring* key) {
+  // The fields which don't change the rows of the scan are left out. The
+  // batch size doesn't either, since only complete results are cached.
+  NewScanRequestPB scan_pb(req.new_scan_request());
+  scan_pb.clear_propagated_timestamp();
+  scan_pb.clear_cache_blocks();
+
+  uint8_t buf[sizeof(uint32_t)];
+  EncodeFixed32(buf, schema_version);
+  key->clear();
+  key->append(buf, sizeof(buf));
+  string pb_str;
+  CHECK(scan_pb.SerializeToString(&pb_str));
+  key->append(pb_str);
+}
+
+bool ScanResultCache::Lookup(const Slice& key, ScanResponsePB* resp,
+                             gscoped_ptr<faststring>* rows_data,
+                             gscoped_ptr<faststring>* indirect_data) {
+  DCHECK(cache_);
+  Cache::Handle* h = cache_->Lookup(key, Cache::EXPECT_IN_CACHE);
+  if (h == nullptr) {
+    return false;
+  }
+  Slice value = cache_->Value(h);
+  DCHECK_GE(value.size(), kHeaderSize);
+  uint32_t lengths[kNumLengths];
+  for (int i = 0; i < kNumLengths; i++) {
+    lengths[i] = DecodeFixed32(value.data() + i * sizeof(uint32_t));
+  }
+  const uint8_t* p = value.data() + kHeaderSize;
+  CHECK(resp->ParseFromArray(p, lengths[0]));
+  p += lengths[0];
+  (*rows_data)->assign_copy(p, lengths[1]);
+  p += lengths[1];
+  (*indirect_data)->assign_copy(p, lengths[2]);
+  cache_->Release(h);
+  hits_->Increment();
+  return true;
+}
+
+void ScanResultCache::Insert(const Slice& key, const ScanResponsePB& resp,
+                             const faststring& rows_data, const faststring& indirect_data) {
+  DCHECK(cache_);
+  string resp_str;
+  CHECK(resp.SerializeToString(&resp_str));
+  const uint32_t lengths[kNumLengths] = {
+    static_cast<uint32_t>(resp_str.size()),
+    static_cast<uint32_t>(rows_data.size()),
+    static_cast<uint32_t>(indirect_data.size())
+  };
+  size_t value_size = kHeaderSize + resp_str.size() + rows_data.size() + indirect_data.size();
+  Cache::PendingHandle* pending = cache_->Allocate(key, value_size, value_size);
+  if (pending == nullptr) {
+    // The result is too large for the cache.
+    return;
+  }
+  uint8_t* p = cache_->MutableValue(pending);
+  for (int i = 0; i < kNumLengths; i++) {
+    EncodeFixed32(p + i * sizeof(uint32_t), lengths[i]);
+  }
+  p += kHeaderSize;
+  memcpy(p, resp_str.data(), resp_str.size());
+  p += resp_str.size();
+  memcpy(p, rows_data.data(), rows_data.size());
+  p += rows_data.size();
+  memcpy(p, indirect_data.data(), indirect_data.size());
+  cache_->Release(cache_->Insert(pending, /* eviction_callback= */ nullptr));
+  inserts_->Increment();
+}
+
+} // namespace tserver
+} // namespace kudu
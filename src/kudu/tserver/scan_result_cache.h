@@ -0,0 +1,91 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#ifndef KUDU_TSERVER_SCAN_RESULT_CACHE_H
+#define KUDU_TSERVER_SCAN_RESULT_CACHE_H
+
+#include <cstdint>
+
+#include "kudu/gutil/gscoped_ptr.h"
+#include "kudu/gutil/macros.h"
+#include "kudu/gutil/ref_counted.h"
+#include "kudu/util/faststring.h"
+#include "kudu/util/metrics.h"
+#include "kudu/util/slice.h"
+
+namespace kudu {
+
+class Cache;
+
+namespace tserver {
+
+class ScanRequestPB;
+class ScanResponsePB;
+
+// A cache of the results of snapshot scans, so that scans which are issued
+// over and over with the same parameters, e.g. by dashboards, are served
+// from memory instead of re-reading and re-filtering the tablet's rowsets.
+//
+// A result may only be cached if the request fully determines it: it must be
+// a new READ_AT_SNAPSHOT scan of an explicit snapshot timestamp. Such a scan
+// waits for the snapshot to be safe before reading, so any later scan of the
+// same snapshot sees the same rows. Only results which fit in the first
+// response are cached, so that a hit needs no server-side scanner.
+//
+// Results are keyed by the scan request itself, along with the schema version
+// of the tablet, and are evicted in LRU order. The cache's memory is tracked
+// by the "scan_result_cache" MemTracker.
+//
+// This class is thread-safe.
+class ScanResultCache {
+ public:
+  // Creates a cache holding results of up to 'capacity' bytes. A cache with
+  // no capacity never caches anything.
+  ScanResultCache(size_t capacity, const scoped_refptr<MetricEntity>& metric_entity);
+  ~ScanResultCache();
+
+  // Returns true if the result of 'req' may be cached.
+  bool IsCacheable(const ScanRequestPB& req) const;
+
+  // Encodes into 'key' the key of the result of 'req', which must be
+  // cacheable, against a tablet with schema version 'schema_version'.
+  static void EncodeKey(const ScanRequestPB& req, uint32_t schema_version, faststring* key);
+
+  // Looks up the result for 'key'. If it is cached, fills in 'resp', except
+  // for the sidecar indexes and resource metrics, and the contents of its
+  // sidecars, and returns true.
+  bool Lookup(const Slice& key, ScanResponsePB* resp,
+              gscoped_ptr<faststring>* rows_data,
+              gscoped_ptr<faststring>* indirect_data);
+
+  // Caches 'resp', a complete result, along with the contents of its
+  // sidecars, as the result for 'key'.
+  void Insert(const Slice& key, const ScanResponsePB& resp,
+              const faststring& rows_data, const faststring& indirect_data);
+
+ private:
+  gscoped_ptr<Cache> cache_;
+
+  scoped_refptr<Counter> hits_;
+  scoped_refptr<Counter> inserts_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScanResultCache);
+};
+
+} // namespace tserver
+} // namespace kudu
+
+#endif
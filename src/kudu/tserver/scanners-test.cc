@@ -24,6 +24,7 @@
 #include "kudu/util/metrics.h"
 #include "kudu/util/test_util.h"
 
+DECLARE_int32(scanner_gc_check_interval_us);
 DECLARE_int32(scanner_ttl_ms);
 
 namespace kudu {
@@ -81,5 +82,33 @@ TEST(ScannerTest, TestExpire) {
   ASSERT_EQ(s2->id(), active_scanners[0]->id());
 }
 
+TEST(ScannerTest, TestExpireAfterAccess) {
+  scoped_refptr<TabletPeer> null_peer(nullptr);
+  FLAGS_scanner_ttl_ms = 100;
+  FLAGS_scanner_gc_check_interval_us = 10 * 1000;
+  MetricRegistry registry;
+  ScannerManager mgr(METRIC_ENTITY_server.Instantiate(&registry, "test"));
+  SharedScanner s1, s2;
+  mgr.NewScanner(null_peer, "", &s1);
+  mgr.NewScanner(null_peer, "", &s2);
+  ASSERT_TRUE(mgr.UnregisterScanner(s1->id()));
+
+  // Keep accessing the scanner past its original deadline: it is moved to
+  // later buckets rather than expired.
+  for (int i = 0; i < 4; i++) {
+    SleepFor(MonoDelta::FromMilliseconds(50));
+    s2->UpdateAccessTime();
+    mgr.RemoveExpiredScanners();
+    ASSERT_EQ(1, mgr.CountActiveScanners());
+  }
+  ASSERT_EQ(0, mgr.metrics_->scanners_expired->value());
+
+  // Once it's no longer accessed, it expires.
+  SleepFor(MonoDelta::FromMilliseconds(200));
+  mgr.RemoveExpiredScanners();
+  ASSERT_EQ(0, mgr.CountActiveScanners());
+  ASSERT_EQ(1, mgr.metrics_->scanners_expired->value());
+}
+
 } // namespace tserver
 } // namespace kudu
@@ -16,8 +16,11 @@
 // under the License.
 #include "kudu/tserver/scanners.h"
 
+#include <algorithm>
 #include <gflags/gflags.h>
 #include <mutex>
+#include <string>
+#include <vector>
 
 #include "kudu/common/iterator.h"
 #include "kudu/common/scan_spec.h"
@@ -25,6 +28,7 @@
 #include "kudu/gutil/map-util.h"
 #include "kudu/tserver/scanner_metrics.h"
 #include "kudu/util/flag_tags.h"
+#include "kudu/util/mem_tracker.h"
 #include "kudu/util/thread.h"
 #include "kudu/util/metrics.h"
 
@@ -35,6 +39,11 @@ TAG_FLAG(scanner_ttl_ms, advanced);
 DEFINE_int32(scanner_gc_check_interval_us, 5 * 1000L *1000L, // 5 seconds
              "Number of microseconds in the interval at which we remove expired scanners");
 TAG_FLAG(scanner_gc_check_interval_us, hidden);
+DEFINE_int32(scanner_memory_limit_mb, 1024,
+             "Server-wide limit on the memory used by the batches of scan results "
+             "being built. Batches are shrunk as the limit is approached, and scans "
+             "are asked to retry later once it is reached. -1 means no limit.");
+TAG_FLAG(scanner_memory_limit_mb, advanced);
 
 // TODO: would be better to scope this at a tablet level instead of
 // server level.
@@ -43,6 +52,9 @@ METRIC_DEFINE_gauge_size(server, active_scanners,
                          kudu::MetricUnit::kScanners,
                          "Number of scanners that are currently active");
 
+using std::string;
+using std::vector;
+
 namespace kudu {
 
 using tablet::TabletPeer;
@@ -51,7 +63,11 @@ namespace tserver {
 
 ScannerManager::ScannerManager(const scoped_refptr<MetricEntity>& metric_entity)
     : shutdown_(false),
-      shutdown_cv_(&shutdown_lock_) {
+      shutdown_cv_(&shutdown_lock_),
+      tick_epoch_(MonoTime::Now()) {
+  int64_t limit = FLAGS_scanner_memory_limit_mb < 0 ?
+      -1 : FLAGS_scanner_memory_limit_mb * 1024L * 1024L;
+  mem_tracker_ = MemTracker::FindOrCreateTracker(limit, "scanners");
   if (metric_entity) {
     metrics_.reset(new ScannerMetrics(metric_entity));
     METRIC_active_scanners.InstantiateFunctionGauge(
@@ -102,6 +118,11 @@ ScannerManager::ScannerMapStripe& ScannerManager::GetStripeByScannerId(const str
   return *scanner_maps_[slot];
 }
 
+int64_t ScannerManager::GetTick(const MonoTime& time) const {
+  return (time - tick_epoch_).ToMicroseconds() /
+      std::max(FLAGS_scanner_gc_check_interval_us, 1);
+}
+
 void ScannerManager::NewScanner(const scoped_refptr<TabletPeer>& tablet_peer,
                                 const std::string& requestor_string,
                                 SharedScanner* scanner) {
@@ -114,9 +135,14 @@ void ScannerManager::NewScanner(const scoped_refptr<TabletPeer>& tablet_peer,
     string id = oid_generator_.Next();
     scanner->reset(new Scanner(id, tablet_peer, requestor_string, metrics_.get()));
 
+    MonoTime deadline = (*scanner)->last_access_time() +
+        MonoDelta::FromMilliseconds(FLAGS_scanner_ttl_ms);
     ScannerMapStripe& stripe = GetStripeByScannerId(id);
     std::lock_guard<RWMutex> l(stripe.lock_);
     success = InsertIfNotPresent(&stripe.scanners_by_id_, id, *scanner);
+    if (success) {
+      stripe.expiration_buckets_[GetTick(deadline)].push_back(std::move(id));
+    }
   }
 }
 
@@ -152,26 +178,43 @@ void ScannerManager::ListScanners(std::vector<SharedScanner>* scanners) {
 
 void ScannerManager::RemoveExpiredScanners() {
   MonoDelta scanner_ttl = MonoDelta::FromMilliseconds(FLAGS_scanner_ttl_ms);
+  MonoTime now = MonoTime::Now();
+  int64_t now_tick = GetTick(now);
 
   for (ScannerMapStripe* stripe : scanner_maps_) {
     std::lock_guard<RWMutex> l(stripe->lock_);
-    for (auto it = stripe->scanners_by_id_.begin(); it != stripe->scanners_by_id_.end();) {
-      SharedScanner& scanner = it->second;
-      MonoDelta time_live =
-          scanner->TimeSinceLastAccess(MonoTime::Now());
-      if (time_live > scanner_ttl) {
-        // TODO: once we have a metric for the number of scanners expired, make this a
-        // VLOG(1).
-        LOG(INFO) << "Expiring scanner id: " << it->first << ", of tablet " << scanner->tablet_id()
-                  << ", after " << time_live.ToMicroseconds()
-                  << " us of inactivity, which is > TTL ("
-                  << scanner_ttl.ToMicroseconds() << " us).";
-        it = stripe->scanners_by_id_.erase(it);
-        if (metrics_) {
-          metrics_->scanners_expired->Increment();
+    auto& buckets = stripe->expiration_buckets_;
+    while (!buckets.empty() && buckets.begin()->first <= now_tick) {
+      vector<string> ids;
+      ids.swap(buckets.begin()->second);
+      buckets.erase(buckets.begin());
+      for (string& id : ids) {
+        auto it = stripe->scanners_by_id_.find(id);
+        if (it == stripe->scanners_by_id_.end()) {
+          // Already unregistered.
+          continue;
+        }
+        SharedScanner& scanner = it->second;
+        MonoTime last_access = scanner->last_access_time();
+        MonoDelta time_live = now - last_access;
+        if (time_live > scanner_ttl) {
+          // TODO: once we have a metric for the number of scanners expired, make this a
+          // VLOG(1).
+          LOG(INFO) << "Expiring scanner id: " << id << ", of tablet " << scanner->tablet_id()
+                    << ", after " << time_live.ToMicroseconds()
+                    << " us of inactivity, which is > TTL ("
+                    << scanner_ttl.ToMicroseconds() << " us).";
+          stripe->scanners_by_id_.erase(it);
+          if (metrics_) {
+            metrics_->scanners_expired->Increment();
+          }
+          continue;
         }
-      } else {
-        ++it;
+        // The scanner was accessed since it was bucketed: move it to the
+        // bucket of its new deadline, but no earlier than the next tick so
+        // that this pass terminates.
+        int64_t tick = std::max(GetTick(last_access + scanner_ttl), now_tick + 1);
+        buckets[tick].push_back(std::move(id));
       }
     }
   }
@@ -185,6 +228,9 @@ Scanner::Scanner(string id, const scoped_refptr<TabletPeer>& tablet_peer,
       call_seq_id_(0),
       start_time_(MonoTime::Now()),
       metrics_(metrics),
+      limit_(-1),
+      num_rows_returned_(0),
+      bytes_per_row_(0),
       arena_(1024, 1024 * 1024) {
   UpdateAccessTime();
 }
@@ -17,6 +17,7 @@
 #ifndef KUDU_TSERVER_SCANNERS_H
 #define KUDU_TSERVER_SCANNERS_H
 
+#include <map>
 #include <memory>
 #include <mutex>
 #include <string>
@@ -24,6 +25,7 @@
 #include <utility>
 #include <vector>
 
+#include "kudu/common/common.pb.h"
 #include "kudu/common/iterator_stats.h"
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/macros.h"
@@ -39,6 +41,7 @@
 
 namespace kudu {
 
+class MemTracker;
 class MetricEntity;
 class RowwiseIterator;
 class ScanSpec;
@@ -62,6 +65,9 @@ typedef std::shared_ptr<Scanner> SharedScanner;
 //
 // Since scanners keep resources on the server, the manager periodically
 // removes any scanners which have not been accessed since a configurable TTL.
+// Each stripe of scanners keeps a timer wheel of the GC ticks by which they
+// may have expired, so that a GC pass only visits the scanners which are due,
+// rather than every active scanner.
 class ScannerManager {
  public:
   explicit ScannerManager(const scoped_refptr<MetricEntity>& metric_entity);
@@ -93,11 +99,15 @@ class ScannerManager {
   // of all active scanners if under concurrent modifications.
   void ListScanners(std::vector<SharedScanner>* scanners);
 
-  // Iterate through scanners and remove any which are past their TTL.
+  // Remove any scanners which are past their TTL.
   void RemoveExpiredScanners();
 
+  // The server-wide budget for the batches of scan results being built.
+  const std::shared_ptr<MemTracker>& mem_tracker() const { return mem_tracker_; }
+
  private:
   FRIEND_TEST(ScannerTest, TestExpire);
+  FRIEND_TEST(ScannerTest, TestExpireAfterAccess);
 
   enum {
     kNumScannerMapStripes = 32
@@ -108,10 +118,16 @@ class ScannerManager {
   typedef std::pair<std::string, SharedScanner> ScannerMapEntry;
 
   struct ScannerMapStripe {
-    // Lock protecting the scanner map.
+    // Lock protecting the scanner map and the expiration buckets.
     mutable RWMutex lock_;
     // Map of the currently active scanners.
     ScannerMap scanners_by_id_;
+    // The IDs of the scanners of the stripe, keyed by the GC tick by which
+    // they expire unless accessed again. Accessing a scanner doesn't move it:
+    // once its bucket is due, the scanner is either expired or moved to the
+    // bucket of its new deadline. Unregistered scanners are dropped from
+    // their bucket once it's due.
+    std::map<int64_t, std::vector<std::string>> expiration_buckets_;
   };
 
   // Periodically call RemoveExpiredScanners().
@@ -119,6 +135,9 @@ class ScannerManager {
 
   ScannerMapStripe& GetStripeByScannerId(const string& scanner_id);
 
+  // Returns the GC tick that 'time' falls into.
+  int64_t GetTick(const MonoTime& time) const;
+
   // (Optional) scanner metrics for this instance.
   gscoped_ptr<ScannerMetrics> metrics_;
 
@@ -130,9 +149,14 @@ class ScannerManager {
 
   std::vector<ScannerMapStripe*> scanner_maps_;
 
+  // The time GC ticks are counted from.
+  const MonoTime tick_epoch_;
+
   // Generator for scanner IDs.
   ObjectIdGenerator oid_generator_;
 
+  std::shared_ptr<MemTracker> mem_tracker_;
+
   // Thread to remove expired scanners.
   scoped_refptr<kudu::Thread> removal_thread_;
 
@@ -241,6 +265,12 @@ class Scanner {
     return now - last_access_time_;
   }
 
+  // Returns the last time this scan was updated.
+  MonoTime last_access_time() const {
+    std::lock_guard<simple_spinlock> l(lock_);
+    return last_access_time_;
+  }
+
   // Returns the time this scan was started.
   const MonoTime& start_time() const { return start_time_; }
 
@@ -262,6 +292,43 @@ class Scanner {
   // See the note about 'set_client_projection_schema' above.
   const Schema* client_projection_schema() const { return client_projection_schema_.get(); }
 
+  // Records the aggregates which the scan computes instead of returning
+  // its rows. See NewScanRequestPB.aggregates.
+  void set_aggregates(const google::protobuf::RepeatedPtrField<AggregatePB>& aggregates) {
+    aggregates_ = aggregates;
+  }
+
+  const google::protobuf::RepeatedPtrField<AggregatePB>& aggregates() const {
+    return aggregates_;
+  }
+
+  // Limits the number of rows the scan returns. See NewScanRequestPB.limit.
+  void set_limit(int64_t limit) {
+    limit_ = limit;
+  }
+
+  bool has_limit() const {
+    return limit_ >= 0;
+  }
+
+  // Returns the number of rows the scan may still return before reaching
+  // its limit. Only valid if has_limit().
+  int64_t num_rows_remaining() const {
+    DCHECK(has_limit());
+    return limit_ - num_rows_returned_;
+  }
+
+  void add_num_rows_returned(int64_t num_rows) {
+    num_rows_returned_ += num_rows;
+  }
+
+  // The average size of the results of a scanned row so far, or 0 if no rows
+  // have been scanned yet. Used to size the blocks of rows read for a batch.
+  double bytes_per_row() const { return bytes_per_row_; }
+  void set_bytes_per_row(double bytes_per_row) {
+    bytes_per_row_ = bytes_per_row;
+  }
+
   // Get per-column stats for each iterator.
   void GetIteratorStats(std::vector<IteratorStats>* stats) const;
 
@@ -312,6 +379,17 @@ class Scanner {
   // schema used by the iterator.
   gscoped_ptr<Schema> client_projection_schema_;
 
+  // The aggregates computed by the scan, if any.
+  google::protobuf::RepeatedPtrField<AggregatePB> aggregates_;
+
+  // The maximum number of rows returned by the scan, or -1 if unlimited.
+  int64_t limit_;
+
+  // The number of rows returned by the scan so far.
+  int64_t num_rows_returned_;
+
+  double bytes_per_row_;
+
   gscoped_ptr<RowwiseIterator> iter_;
 
   AutoReleasePool autorelease_pool_;
@@ -17,9 +17,11 @@
 
 #include "kudu/tserver/tablet_copy_client.h"
 
+#include <atomic>
 #include <gflags/gflags.h>
 #include <glog/logging.h>
 #include <memory>
+#include <mutex>
 
 #include "kudu/common/wire_protocol.h"
 #include "kudu/consensus/consensus_meta.h"
@@ -31,6 +33,8 @@
 #include "kudu/gutil/strings/util.h"
 #include "kudu/gutil/walltime.h"
 #include "kudu/rpc/messenger.h"
+#include "kudu/rpc/rpc_controller.h"
+#include "kudu/rpc/rpc_header.pb.h"
 #include "kudu/rpc/transfer.h"
 #include "kudu/tablet/tablet.pb.h"
 #include "kudu/tablet/tablet_bootstrap.h"
@@ -42,8 +46,10 @@
 #include "kudu/util/env.h"
 #include "kudu/util/env_util.h"
 #include "kudu/util/flag_tags.h"
+#include "kudu/util/locks.h"
 #include "kudu/util/logging.h"
 #include "kudu/util/net/net_util.h"
+#include "kudu/util/threadpool.h"
 
 DEFINE_int32(tablet_copy_begin_session_timeout_ms, 3000,
              "Tablet server RPC client timeout for BeginTabletCopySession calls. "
@@ -62,6 +68,16 @@ DEFINE_int32(tablet_copy_dowload_file_inject_latency_ms, 0,
              "to take much longer. For use in tests only.");
 TAG_FLAG(tablet_copy_dowload_file_inject_latency_ms, hidden);
 
+DEFINE_int32(tablet_copy_download_threads, 4,
+             "Number of data blocks downloaded concurrently by each tablet copy.");
+TAG_FLAG(tablet_copy_download_threads, advanced);
+
+DEFINE_int32(tablet_copy_max_fetch_attempts, 5,
+             "Number of attempts at fetching each chunk of data from the tablet copy "
+             "source. A chunk whose fetch fails with a transient error is fetched again "
+             "from the same offset, rather than failing the whole tablet copy.");
+TAG_FLAG(tablet_copy_max_fetch_attempts, advanced);
+
 DECLARE_int32(tablet_copy_transfer_chunk_size_bytes);
 
 // RETURN_NOT_OK_PREPEND() with a remote-error unwinding step.
@@ -77,6 +93,7 @@ using consensus::OpId;
 using consensus::RaftConfigPB;
 using consensus::RaftPeerPB;
 using env_util::CopyFile;
+using fs::CreateBlockOptions;
 using fs::WritableBlock;
 using rpc::Messenger;
 using std::shared_ptr;
@@ -365,48 +382,69 @@ Status TabletCopyClient::DownloadWALs() {
 Status TabletCopyClient::DownloadBlocks() {
   CHECK(started_);
 
-  // Count up the total number of blocks to download.
-  int num_blocks = 0;
-  for (const RowSetDataPB& rowset : superblock_->rowsets()) {
-    num_blocks += rowset.columns_size();
-    num_blocks += rowset.redo_deltas_size();
-    num_blocks += rowset.undo_deltas_size();
-    if (rowset.has_bloom_block()) {
-      num_blocks++;
-    }
-    if (rowset.has_adhoc_index_block()) {
-      num_blocks++;
-    }
-  }
-
-  // Download each block, writing the new block IDs into the new superblock
-  // as each block downloads.
+  // Collect the blocks to download. The new block IDs are written into the
+  // new superblock as each block downloads.
   gscoped_ptr<TabletSuperBlockPB> new_sb(new TabletSuperBlockPB());
   new_sb->CopyFrom(*superblock_);
-  int block_count = 0;
-  LOG_WITH_PREFIX(INFO) << "Starting download of " << num_blocks << " data blocks...";
+  vector<BlockIdPB*> block_ids;
   for (RowSetDataPB& rowset : *new_sb->mutable_rowsets()) {
     for (ColumnDataPB& col : *rowset.mutable_columns()) {
-      RETURN_NOT_OK(DownloadAndRewriteBlock(col.mutable_block(),
-                                            &block_count, num_blocks));
+      block_ids.push_back(col.mutable_block());
+      if (col.has_bitmap_index_block()) {
+        block_ids.push_back(col.mutable_bitmap_index_block());
+      }
     }
     for (DeltaDataPB& redo : *rowset.mutable_redo_deltas()) {
-      RETURN_NOT_OK(DownloadAndRewriteBlock(redo.mutable_block(),
-                                            &block_count, num_blocks));
+      block_ids.push_back(redo.mutable_block());
     }
     for (DeltaDataPB& undo : *rowset.mutable_undo_deltas()) {
-      RETURN_NOT_OK(DownloadAndRewriteBlock(undo.mutable_block(),
-                                            &block_count, num_blocks));
+      block_ids.push_back(undo.mutable_block());
     }
     if (rowset.has_bloom_block()) {
-      RETURN_NOT_OK(DownloadAndRewriteBlock(rowset.mutable_bloom_block(),
-                                            &block_count, num_blocks));
+      block_ids.push_back(rowset.mutable_bloom_block());
     }
     if (rowset.has_adhoc_index_block()) {
-      RETURN_NOT_OK(DownloadAndRewriteBlock(rowset.mutable_adhoc_index_block(),
-                                            &block_count, num_blocks));
+      block_ids.push_back(rowset.mutable_adhoc_index_block());
+    }
+  }
+  int num_blocks = block_ids.size();
+  int num_threads = std::max(FLAGS_tablet_copy_download_threads, 1);
+  LOG_WITH_PREFIX(INFO) << "Starting download of " << num_blocks << " data blocks using "
+                        << num_threads << " threads...";
+
+  // Download the blocks concurrently. Once one fails, the blocks which haven't
+  // started downloading yet are skipped.
+  gscoped_ptr<ThreadPool> pool;
+  RETURN_NOT_OK(ThreadPoolBuilder("tablet-copy-download")
+                .set_max_threads(num_threads)
+                .Build(&pool));
+  std::atomic<int> block_count(0);
+  simple_spinlock error_lock;
+  Status first_error;
+  for (BlockIdPB* block_id : block_ids) {
+    Status s = pool->SubmitFunc([&, block_id]() {
+      {
+        std::lock_guard<simple_spinlock> l(error_lock);
+        if (!first_error.ok()) {
+          return;
+        }
+      }
+      Status s = DownloadAndRewriteBlock(block_id, &block_count, num_blocks);
+      if (!s.ok()) {
+        std::lock_guard<simple_spinlock> l(error_lock);
+        if (first_error.ok()) {
+          first_error = s;
+        }
+      }
+    });
+    if (!s.ok()) {
+      std::lock_guard<simple_spinlock> l(error_lock);
+      first_error = s;
+      break;
     }
   }
+  pool->Wait();
+  RETURN_NOT_OK(first_error);
 
   // The orphaned physical block ids at the remote have no meaning to us.
   new_sb->clear_orphaned_blocks();
@@ -462,10 +500,11 @@ Status TabletCopyClient::WriteConsensusMetadata() {
 }
 
 Status TabletCopyClient::DownloadAndRewriteBlock(BlockIdPB* block_id,
-                                                      int* block_count, int num_blocks) {
+                                                      std::atomic<int>* block_count,
+                                                      int num_blocks) {
   BlockId old_block_id(BlockId::FromPB(*block_id));
   UpdateStatusMessage(Substitute("Downloading block $0 ($1/$2)",
-                                 old_block_id.ToString(), *block_count,
+                                 old_block_id.ToString(), block_count->load(),
                                  num_blocks));
   BlockId new_block_id;
   RETURN_NOT_OK_PREPEND(DownloadBlock(old_block_id, &new_block_id),
@@ -481,7 +520,9 @@ Status TabletCopyClient::DownloadBlock(const BlockId& old_block_id,
   VLOG_WITH_PREFIX(1) << "Downloading block with block_id " << old_block_id.ToString();
 
   gscoped_ptr<WritableBlock> block;
-  RETURN_NOT_OK_PREPEND(fs_manager_->CreateNewBlock(&block),
+  CreateBlockOptions block_opts;
+  block_opts.tablet_id = tablet_id_;
+  RETURN_NOT_OK_PREPEND(fs_manager_->CreateNewBlock(block_opts, &block),
                         "Unable to create new block");
 
   DataIdPB data_id;
@@ -511,18 +552,37 @@ Status TabletCopyClient::DownloadFile(const DataIdPB& data_id,
     req.mutable_data_id()->CopyFrom(data_id);
     req.set_offset(offset);
     req.set_max_length(FLAGS_tablet_copy_transfer_chunk_size_bytes);
+    req.set_data_in_sidecar(true);
 
     FetchDataResponsePB resp;
-    RETURN_NOT_OK_UNWIND_PREPEND(proxy_->FetchData(req, &resp, &controller),
-                                controller,
-                                "Unable to fetch data from remote");
+    Status s;
+    for (int attempt = 1;; attempt++) {
+      controller.Reset();
+      s = proxy_->FetchData(req, &resp, &controller);
+      if (s.ok() || attempt >= FLAGS_tablet_copy_max_fetch_attempts ||
+          !IsTransientFetchError(s, controller)) {
+        break;
+      }
+      LOG_WITH_PREFIX(WARNING) << "Unable to fetch " << data_id.ShortDebugString()
+                               << " at offset " << offset << " (attempt " << attempt
+                               << "), retrying: " << s.ToString();
+      SleepFor(MonoDelta::FromMilliseconds(100 * attempt));
+    }
+    RETURN_NOT_OK_UNWIND_PREPEND(s, controller, "Unable to fetch data from remote");
+
+    // Servers which don't support sidecars return the data in the response.
+    Slice data(resp.chunk().data());
+    if (resp.chunk().has_data_sidecar()) {
+      RETURN_NOT_OK_PREPEND(controller.GetSidecar(resp.chunk().data_sidecar(), &data),
+                            "Unable to get the data sidecar");
+    }
 
     // Sanity-check for corruption.
-    RETURN_NOT_OK_PREPEND(VerifyData(offset, resp.chunk()),
+    RETURN_NOT_OK_PREPEND(VerifyData(offset, resp.chunk(), data),
                           Substitute("Error validating data item $0", data_id.ShortDebugString()));
 
     // Write the data.
-    RETURN_NOT_OK(appendable->Append(resp.chunk().data()));
+    RETURN_NOT_OK(appendable->Append(data));
 
     if (PREDICT_FALSE(FLAGS_tablet_copy_dowload_file_inject_latency_ms > 0)) {
       LOG_WITH_PREFIX(INFO) << "Injecting latency into file download: " <<
@@ -530,16 +590,30 @@ Status TabletCopyClient::DownloadFile(const DataIdPB& data_id,
       SleepFor(MonoDelta::FromMilliseconds(FLAGS_tablet_copy_dowload_file_inject_latency_ms));
     }
 
-    if (offset + resp.chunk().data().size() == resp.chunk().total_data_length()) {
+    if (offset + data.size() == resp.chunk().total_data_length()) {
       done = true;
     }
-    offset += resp.chunk().data().size();
+    offset += data.size();
   }
 
   return Status::OK();
 }
 
+bool TabletCopyClient::IsTransientFetchError(const Status& status,
+                                             const rpc::RpcController& controller) {
+  if (status.IsRemoteError()) {
+    const rpc::ErrorStatusPB* err = controller.error_response();
+    return err && err->has_code() && err->code() == rpc::ErrorStatusPB::ERROR_SERVER_TOO_BUSY;
+  }
+  return status.IsNetworkError() || status.IsTimedOut() || status.IsServiceUnavailable();
+}
+
 Status TabletCopyClient::VerifyData(uint64_t offset, const DataChunkPB& chunk) {
+  return VerifyData(offset, chunk, chunk.data());
+}
+
+Status TabletCopyClient::VerifyData(uint64_t offset, const DataChunkPB& chunk,
+                                    const Slice& data) {
   // Verify the offset is what we expected.
   if (offset != chunk.offset()) {
     return Status::InvalidArgument("Offset did not match what was asked for",
@@ -547,11 +621,11 @@ Status TabletCopyClient::VerifyData(uint64_t offset, const DataChunkPB& chunk) {
   }
 
   // Verify the checksum.
-  uint32_t crc32 = crc::Crc32c(chunk.data().data(), chunk.data().length());
+  uint32_t crc32 = crc::Crc32c(data.data(), data.size());
   if (PREDICT_FALSE(crc32 != chunk.crc32())) {
     return Status::Corruption(
         Substitute("CRC32 does not match at offset $0 size $1: $2 vs $3",
-          offset, chunk.data().size(), crc32, chunk.crc32()));
+          offset, data.size(), crc32, chunk.crc32()));
   }
   return Status::OK();
 }
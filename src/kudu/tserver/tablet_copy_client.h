@@ -17,6 +17,7 @@
 #ifndef KUDU_TSERVER_TABLET_COPY_CLIENT_H
 #define KUDU_TSERVER_TABLET_COPY_CLIENT_H
 
+#include <atomic>
 #include <string>
 #include <memory>
 #include <vector>
@@ -34,6 +35,7 @@ class BlockId;
 class BlockIdPB;
 class FsManager;
 class HostPort;
+class Slice;
 
 namespace consensus {
 class ConsensusMetadata;
@@ -137,7 +139,8 @@ class TabletCopyClient {
   // downloaded as part of initiating the tablet copy session.
   Status WriteConsensusMetadata();
 
-  // Download all blocks belonging to a tablet sequentially.
+  // Download all blocks belonging to a tablet, up to
+  // --tablet_copy_download_threads at a time.
   //
   // Blocks are given new IDs upon creation. On success, 'new_superblock_'
   // is populated to reflect the new block IDs and should be used in lieu
@@ -149,7 +152,8 @@ class TabletCopyClient {
   // On success:
   // - 'block_id' is set to the new ID of the downloaded block.
   // - 'block_count' is incremented.
-  Status DownloadAndRewriteBlock(BlockIdPB* block_id, int* block_count, int num_blocks);
+  Status DownloadAndRewriteBlock(BlockIdPB* block_id, std::atomic<int>* block_count,
+                                 int num_blocks);
 
   // Download a single block.
   // Data block is opened with options so that it will fsync() on close.
@@ -167,8 +171,17 @@ class TabletCopyClient {
   template<class Appendable>
   Status DownloadFile(const DataIdPB& data_id, Appendable* appendable);
 
+  // Returns true if a FetchData RPC which failed with 'status' may succeed
+  // if sent again.
+  static bool IsTransientFetchError(const Status& status,
+                                    const rpc::RpcController& controller);
+
   Status VerifyData(uint64_t offset, const DataChunkPB& resp);
 
+  // Like the above, but verifies 'data', the data of the chunk which may
+  // have been sent in a sidecar.
+  Status VerifyData(uint64_t offset, const DataChunkPB& resp, const Slice& data);
+
   // Return standard log prefix.
   std::string LogPrefix();
 
@@ -19,6 +19,7 @@
 #include <algorithm>
 #include <gflags/gflags.h>
 #include <glog/logging.h>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -28,6 +29,7 @@
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/gutil/map-util.h"
 #include "kudu/rpc/rpc_context.h"
+#include "kudu/rpc/rpc_sidecar.h"
 #include "kudu/tserver/tablet_copy_session.h"
 #include "kudu/tserver/tablet_peer_lookup.h"
 #include "kudu/tablet/tablet_peer.h"
@@ -70,6 +72,7 @@ namespace kudu {
 namespace tserver {
 
 using crc::Crc32c;
+using std::shared_ptr;
 using strings::Substitute;
 using tablet::TabletPeer;
 
@@ -207,8 +210,18 @@ void TabletCopyServiceImpl::FetchData(const FetchDataRequestPB* req,
   RPC_RETURN_NOT_OK(ValidateFetchRequestDataId(data_id, &error_code, session),
                     error_code, "Invalid DataId");
 
+  // The data is read straight into the buffer it's sent from: either the
+  // response itself, or a sidecar which is written to the socket as is.
   DataChunkPB* data_chunk = resp->mutable_chunk();
-  string* data = data_chunk->mutable_data();
+  shared_ptr<string> sidecar_data;
+  string* data;
+  if (req->data_in_sidecar()) {
+    sidecar_data = std::make_shared<string>();
+    data = sidecar_data.get();
+    data_chunk->set_data("");
+  } else {
+    data = data_chunk->mutable_data();
+  }
   int64_t total_data_length = 0;
   if (data_id.type() == DataIdPB::BLOCK) {
     // Fetching a data block chunk.
@@ -231,6 +244,14 @@ void TabletCopyServiceImpl::FetchData(const FetchDataRequestPB* req,
   uint32_t crc32 = Crc32c(data->data(), data->length());
   data_chunk->set_crc32(crc32);
 
+  if (sidecar_data) {
+    int idx;
+    Slice slice(*sidecar_data);
+    CHECK_OK(context->AddRpcSidecar(make_gscoped_ptr(
+        new rpc::RpcSidecar(slice, std::move(sidecar_data))), &idx));
+    data_chunk->set_data_sidecar(idx);
+  }
+
   context->RespondSuccess();
 }
 
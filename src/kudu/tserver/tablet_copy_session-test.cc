@@ -73,6 +73,7 @@ class TabletCopyTest : public KuduTabletTest {
   TabletCopyTest()
     : KuduTabletTest(Schema({ ColumnSchema("key", STRING),
                               ColumnSchema("val", INT32) }, 1)) {
+    CHECK_OK(ThreadPoolBuilder("test-prepare").Build(&prepare_pool_));
     CHECK_OK(ThreadPoolBuilder("test-exec").Build(&apply_pool_));
   }
 
@@ -109,6 +110,7 @@ class TabletCopyTest : public KuduTabletTest {
     tablet_peer_.reset(
         new TabletPeer(tablet()->metadata(),
                        config_peer,
+                       prepare_pool_.get(),
                        apply_pool_.get(),
                        Bind(&TabletCopyTest::TabletPeerStateChangedCallback,
                             Unretained(this),
@@ -133,6 +135,8 @@ class TabletCopyTest : public KuduTabletTest {
     ASSERT_OK(tablet_peer_->Init(tablet(),
                                  clock(),
                                  messenger,
+                                 nullptr,
+                                 nullptr,
                                  scoped_refptr<rpc::ResultTracker>(),
                                  log,
                                  metric_entity));
@@ -211,6 +215,7 @@ class TabletCopyTest : public KuduTabletTest {
 
   MetricRegistry metric_registry_;
   scoped_refptr<LogAnchorRegistry> log_anchor_registry_;
+  gscoped_ptr<ThreadPool> prepare_pool_;
   gscoped_ptr<ThreadPool> apply_pool_;
   scoped_refptr<TabletPeer> tablet_peer_;
   scoped_refptr<TabletCopySession> session_;
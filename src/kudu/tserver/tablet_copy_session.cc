@@ -236,6 +236,15 @@ static Status ReadFileChunkToBuf(const Info* info,
   TRACE("Tablet Copy: $0: $1 total bytes read. Total time elapsed: $2",
         data_name, response_data_size, chunk_timer.elapsed().ToString());
 
+  // Clients fetch files sequentially, so start reading the next chunk while
+  // this one is on the wire.
+  int64_t next_offset = offset + response_data_size;
+  if (next_offset < info->size) {
+    WARN_NOT_OK(info->Prefetch(next_offset,
+                               std::min<int64_t>(response_data_size, info->size - next_offset)),
+                Substitute("Unable to prefetch $0", data_name));
+  }
+
   *file_size = info->size;
   return Status::OK();
 }
@@ -61,6 +61,10 @@ struct ImmutableRandomAccessFileInfo {
   Status ReadFully(uint64_t offset, int64_t size, Slice* data, uint8_t* scratch) const {
     return env_util::ReadFully(readable.get(), offset, size, data, scratch);
   }
+
+  Status Prefetch(uint64_t offset, int64_t size) const {
+    return readable->Prefetch(offset, size);
+  }
 };
 
 // Caches block size and holds an exclusive reference to a ReadableBlock.
@@ -78,6 +82,10 @@ struct ImmutableReadableBlockInfo {
   Status ReadFully(uint64_t offset, int64_t size, Slice* data, uint8_t* scratch) const {
     return readable->Read(offset, size, data, scratch);
   }
+
+  Status Prefetch(uint64_t offset, int64_t size) const {
+    return readable->Prefetch(offset, size);
+  }
 };
 
 // A potential Learner must establish a TabletCopySession with the leader in order
@@ -18,6 +18,7 @@
 
 #include <memory>
 #include <sstream>
+#include <thread>
 
 #include <zlib.h>
 
@@ -31,6 +32,7 @@
 #include "kudu/tablet/tablet_bootstrap.h"
 #include "kudu/util/crc.h"
 #include "kudu/util/curl_util.h"
+#include "kudu/util/mem_tracker.h"
 #include "kudu/util/url-coding.h"
 #include "kudu/util/zlib.h"
 
@@ -56,7 +58,11 @@ DEFINE_int32(single_threaded_insert_latency_bench_insert_rows, 1000,
              "Number of rows to insert in the testing phase of the single threaded"
              " tablet server insert latency micro-benchmark");
 
+DECLARE_bool(checksum_use_stored_rowset_checksums);
+DECLARE_bool(write_txn_check_presence_during_replication);
 DECLARE_int32(scanner_batch_size_rows);
+DECLARE_int32(write_coalescing_window_us);
+DECLARE_int64(scan_result_cache_capacity_mb);
 DECLARE_int32(metrics_retirement_age_ms);
 DECLARE_string(block_manager);
 
@@ -64,6 +70,7 @@ DECLARE_string(block_manager);
 METRIC_DECLARE_counter(rows_inserted);
 METRIC_DECLARE_counter(rows_updated);
 METRIC_DECLARE_counter(rows_deleted);
+METRIC_DECLARE_counter(scan_result_cache_hits);
 METRIC_DECLARE_gauge_uint64(log_block_manager_blocks_under_management);
 
 namespace kudu {
@@ -180,6 +187,12 @@ TEST_F(TabletServerTest, TestWebPages) {
   ASSERT_STR_CONTAINS(buf.ToString(), "<th>key</th>");
   ASSERT_STR_CONTAINS(buf.ToString(), "<td>string NULLABLE</td>");
 
+  // Hot tablets page should list the tablet, whichever resource it's sorted by.
+  ASSERT_OK(c.FetchURL(Substitute("http://$0/hot-tablets", addr), &buf));
+  ASSERT_STR_CONTAINS(buf.ToString(), kTabletId);
+  ASSERT_OK(c.FetchURL(Substitute("http://$0/hot-tablets?sort=wal&n=1", addr), &buf));
+  ASSERT_STR_CONTAINS(buf.ToString(), kTabletId);
+
   // Test fetching metrics.
   // Fetching metrics has the side effect of retiring metrics, but not in a single pass.
   // So, we check a couple of times in a loop -- thus, if we had a bug where one of these
@@ -356,6 +369,130 @@ TEST_F(TabletServerTest, TestInsert) {
   ASSERT_GE(now_after.value(), now_before.value());
 }
 
+// Test that inserting duplicate keys still fails when the presence of the
+// inserted rows is checked while the write is being replicated, whether the
+// existing rows are in the MemRowSet or have been flushed.
+TEST_F(TabletServerTest, TestInsertCheckingPresenceDuringReplication) {
+  FLAGS_write_txn_check_presence_during_replication = true;
+
+  InsertTestRowsRemote(0, 1, 2);
+  ASSERT_OK(tablet_peer_->tablet()->Flush());
+  InsertTestRowsRemote(0, 3, 1);
+
+  WriteRequestPB req;
+  WriteResponsePB resp;
+  RpcController controller;
+  req.set_tablet_id(kTabletId);
+  ASSERT_OK(SchemaToPB(schema_, req.mutable_schema()));
+  RowOperationsPB* data = req.mutable_row_operations();
+  AddTestRowToPB(RowOperationsPB::INSERT, schema_, 1, 100, "flushed dupe", data);
+  AddTestRowToPB(RowOperationsPB::INSERT, schema_, 3, 300, "unflushed dupe", data);
+  AddTestRowToPB(RowOperationsPB::INSERT, schema_, 4, 400, "not a dupe", data);
+  SCOPED_TRACE(req.DebugString());
+  ASSERT_OK(proxy_->Write(req, &resp, &controller));
+  SCOPED_TRACE(resp.DebugString());
+  ASSERT_FALSE(resp.has_error());
+  ASSERT_EQ(2, resp.per_row_errors().size());
+  for (int i = 0; i < 2; i++) {
+    ASSERT_EQ(i, resp.per_row_errors().Get(i).row_index());
+    Status s = StatusFromPB(resp.per_row_errors().Get(i).error());
+    ASSERT_TRUE(s.IsAlreadyPresent()) << s.ToString();
+  }
+  VerifyRows(schema_, { KeyValue(1, 1), KeyValue(2, 2), KeyValue(3, 3), KeyValue(4, 400) });
+
+  // The replayed write must fail the same rows.
+  ASSERT_NO_FATAL_FAILURE(ShutdownAndRebuildTablet());
+  VerifyRows(schema_, { KeyValue(1, 1), KeyValue(2, 2), KeyValue(3, 3), KeyValue(4, 400) });
+}
+
+// Concurrent small writes are replicated as a single operation, and each of
+// them gets back the errors of its own rows, also once replayed.
+TEST_F(TabletServerTest, TestCoalescedWrites) {
+  FLAGS_write_coalescing_window_us = 100 * 1000;
+  InsertTestRowsRemote(0, 1, 1);
+
+  const int kNumWriters = 4;
+  vector<WriteResponsePB> resps(kNumWriters);
+  vector<Status> statuses(kNumWriters);
+  vector<std::thread> threads;
+  for (int i = 0; i < kNumWriters; i++) {
+    threads.emplace_back([&, i]() {
+      WriteRequestPB req;
+      req.set_tablet_id(kTabletId);
+      CHECK_OK(SchemaToPB(schema_, req.mutable_schema()));
+      RowOperationsPB* data = req.mutable_row_operations();
+      AddTestRowToPB(RowOperationsPB::INSERT, schema_, 10 + i, 10 + i, "not a dupe", data);
+      AddTestRowToPB(RowOperationsPB::INSERT, schema_, 1, 100, "dupe", data);
+      RpcController controller;
+      statuses[i] = proxy_->Write(req, &resps[i], &controller);
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+
+  vector<KeyValue> expected = { KeyValue(1, 1) };
+  for (int i = 0; i < kNumWriters; i++) {
+    ASSERT_OK(statuses[i]);
+    SCOPED_TRACE(resps[i].DebugString());
+    ASSERT_FALSE(resps[i].has_error());
+    ASSERT_EQ(1, resps[i].per_row_errors().size());
+    ASSERT_EQ(1, resps[i].per_row_errors(0).row_index());
+    Status s = StatusFromPB(resps[i].per_row_errors(0).error());
+    ASSERT_TRUE(s.IsAlreadyPresent()) << s.ToString();
+    expected.emplace_back(10 + i, 10 + i);
+  }
+  VerifyRows(schema_, expected);
+
+  ASSERT_NO_FATAL_FAILURE(ShutdownAndRebuildTablet());
+  VerifyRows(schema_, expected);
+}
+
+// A write which fails as a whole doesn't fail the writes it would have been
+// coalesced with.
+TEST_F(TabletServerTest, TestCoalescedWriteFailsAlone) {
+  FLAGS_write_coalescing_window_us = 100 * 1000;
+
+  const int kNumWriters = 4;
+  vector<WriteResponsePB> resps(kNumWriters);
+  vector<Status> statuses(kNumWriters);
+  vector<std::thread> threads;
+  for (int i = 0; i < kNumWriters; i++) {
+    threads.emplace_back([&, i]() {
+      WriteRequestPB req;
+      req.set_tablet_id(kTabletId);
+      CHECK_OK(SchemaToPB(schema_, req.mutable_schema()));
+      RowOperationsPB* data = req.mutable_row_operations();
+      if (i == 0) {
+        // An insert without a value for the non-nullable 'int_val' column.
+        AddTestKeyToPB(RowOperationsPB::INSERT, schema_, i, data);
+      } else {
+        AddTestRowToPB(RowOperationsPB::INSERT, schema_, i, i, "original", data);
+      }
+      RpcController controller;
+      statuses[i] = proxy_->Write(req, &resps[i], &controller);
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+
+  ASSERT_OK(statuses[0]);
+  ASSERT_TRUE(resps[0].has_error()) << resps[0].DebugString();
+  Status s = StatusFromPB(resps[0].error().status());
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+
+  vector<KeyValue> expected;
+  for (int i = 1; i < kNumWriters; i++) {
+    ASSERT_OK(statuses[i]);
+    SCOPED_TRACE(resps[i].DebugString());
+    ASSERT_FALSE(resps[i].has_error());
+    ASSERT_EQ(0, resps[i].per_row_errors().size());
+    expected.emplace_back(i, i);
+  }
+  VerifyRows(schema_, expected);
+}
+
 TEST_F(TabletServerTest, TestExternalConsistencyModes_ClientPropagated) {
   WriteRequestPB req;
   req.set_tablet_id(kTabletId);
@@ -1485,6 +1622,136 @@ TEST_F(TabletServerTest, TestScanWithPredicates) {
   ASSERT_EQ(50, results.size());
 }
 
+TEST_F(TabletServerTest, TestScanWithLimit) {
+  InsertTestRowsDirect(0, 1000);
+
+  for (int64_t limit : { 0, 1, 123, 1000, 2000 }) {
+    SCOPED_TRACE(limit);
+    ScanRequestPB req;
+    ScanResponsePB resp;
+    RpcController rpc;
+
+    NewScanRequestPB* scan = req.mutable_new_scan_request();
+    scan->set_tablet_id(kTabletId);
+    scan->set_limit(limit);
+    req.set_batch_size_bytes(0); // so it won't return data right away
+    ASSERT_OK(SchemaToColumnPBs(schema_, scan->mutable_projected_columns()));
+    rpc.RequireServerFeature(TabletServerFeatures::SCAN_LIMIT);
+    ASSERT_OK(proxy_->Scan(req, &resp, &rpc));
+    ASSERT_FALSE(resp.has_error()) << resp.error().ShortDebugString();
+
+    if (limit == 0) {
+      ASSERT_FALSE(resp.has_more_results());
+      continue;
+    }
+
+    // The scanner is drained in batches of a few hundred rows, so the limit
+    // has to be tracked across responses.
+    vector<string> results;
+    ASSERT_NO_FATAL_FAILURE(
+      DrainScannerToStrings(resp.scanner_id(), schema_, &results));
+    ASSERT_EQ(std::min<int64_t>(limit, 1000), results.size());
+  }
+}
+
+TEST_F(TabletServerTest, TestScanDeferredWithoutMemory) {
+  InsertTestRowsDirect(0, 100);
+
+  // Use up the scan memory budget.
+  shared_ptr<MemTracker> tracker = mini_server_->server()->scanner_manager()->mem_tracker();
+  gscoped_ptr<ScopedTrackedConsumption> consumption(
+      new ScopedTrackedConsumption(tracker, tracker->SpareCapacity()));
+
+  // The scanner is opened without returning any rows.
+  string scanner_id;
+  {
+    ScanRequestPB req;
+    ScanResponsePB resp;
+    RpcController rpc;
+    NewScanRequestPB* scan = req.mutable_new_scan_request();
+    scan->set_tablet_id(kTabletId);
+    ASSERT_OK(SchemaToColumnPBs(schema_, scan->mutable_projected_columns()));
+    ASSERT_OK(proxy_->Scan(req, &resp, &rpc));
+    ASSERT_FALSE(resp.has_error()) << resp.error().ShortDebugString();
+    ASSERT_TRUE(resp.has_more_results());
+    ASSERT_FALSE(resp.has_data());
+    scanner_id = resp.scanner_id();
+  }
+
+  // Continuing it is rejected as busy, leaving the scanner usable.
+  {
+    ScanRequestPB req;
+    ScanResponsePB resp;
+    RpcController rpc;
+    req.set_scanner_id(scanner_id);
+    req.set_call_seq_id(1);
+    Status s = proxy_->Scan(req, &resp, &rpc);
+    ASSERT_TRUE(s.IsRemoteError()) << s.ToString();
+    ASSERT_EQ(rpc::ErrorStatusPB::ERROR_SERVER_TOO_BUSY, rpc.error_response()->code());
+  }
+
+  consumption.reset();
+  vector<string> results;
+  NO_FATALS(DrainScannerToStrings(scanner_id, schema_, &results));
+  ASSERT_EQ(100, results.size());
+  ASSERT_EQ(0, tracker->consumption());
+}
+
+TEST_F(TabletServerTest, TestSnapshotScanServedFromResultCache) {
+  FLAGS_scan_result_cache_capacity_mb = 16;
+  ASSERT_OK(ShutdownAndRebuildTablet());
+  scoped_refptr<Counter> hits =
+      METRIC_scan_result_cache_hits.Instantiate(mini_server_->server()->metric_entity());
+
+  vector<uint64_t> write_timestamps;
+  InsertTestRowsRemote(0, 0, 10, 1, nullptr, kTabletId, &write_timestamps);
+
+  ScanRequestPB req;
+  NewScanRequestPB* scan = req.mutable_new_scan_request();
+  scan->set_tablet_id(kTabletId);
+  scan->set_read_mode(READ_AT_SNAPSHOT);
+  scan->set_snap_timestamp(write_timestamps.back() + 1);
+  ASSERT_OK(SchemaToColumnPBs(schema_, scan->mutable_projected_columns()));
+
+  auto do_scan = [&](vector<string>* results) {
+    ScanResponsePB resp;
+    RpcController rpc;
+    ASSERT_OK(proxy_->Scan(req, &resp, &rpc));
+    ASSERT_FALSE(resp.has_error()) << resp.error().ShortDebugString();
+    ASSERT_FALSE(resp.has_more_results());
+    NO_FATALS(StringifyRowsFromResponse(schema_, rpc, resp, results));
+  };
+
+  // Repeated scans of the snapshot are served from the cache.
+  vector<string> first_results;
+  NO_FATALS(do_scan(&first_results));
+  ASSERT_EQ(10, first_results.size());
+  ASSERT_EQ(0, hits->value());
+  for (int i = 1; i <= 3; i++) {
+    vector<string> results;
+    NO_FATALS(do_scan(&results));
+    ASSERT_EQ(first_results, results);
+    ASSERT_EQ(i, hits->value());
+  }
+
+  // Later writes don't change the result of the snapshot, and a scan of a
+  // later snapshot isn't served from the cache.
+  InsertTestRowsRemote(0, 10, 10, 1, nullptr, kTabletId, &write_timestamps);
+  {
+    vector<string> results;
+    NO_FATALS(do_scan(&results));
+    ASSERT_EQ(first_results, results);
+    ASSERT_EQ(4, hits->value());
+  }
+  scan->set_snap_timestamp(write_timestamps.back() + 1);
+  {
+    vector<string> results;
+    NO_FATALS(do_scan(&results));
+    ASSERT_EQ(20, results.size());
+    ASSERT_EQ(4, hits->value());
+  }
+}
+
 TEST_F(TabletServerTest, TestScanWithEncodedPredicates) {
   InsertTestRowsDirect(0, 100);
 
@@ -1895,6 +2162,41 @@ TEST_F(TabletServerTest, TestCreateTablet_TabletExists) {
   }
 }
 
+TEST_F(TabletServerTest, TestCreateTablets) {
+  CreateTabletsRequestPB req;
+  CreateTabletsResponsePB resp;
+  RpcController rpc;
+
+  req.set_dest_uuid(mini_server_->server()->fs_manager()->uuid());
+  Schema schema = SchemaBuilder(schema_).Build();
+  // The first tablet already exists, the others are new.
+  for (const string& tablet_id : { string(kTabletId), string("new_tablet_1"),
+                                   string("new_tablet_2") }) {
+    CreateTabletRequestPB* tablet_req = req.add_tablets();
+    tablet_req->set_table_id("testtb");
+    tablet_req->set_tablet_id(tablet_id);
+    tablet_req->set_table_name("testtb");
+    tablet_req->mutable_config()->CopyFrom(mini_server_->CreateLocalConfig());
+    ASSERT_OK(SchemaToPB(schema, tablet_req->mutable_schema()));
+  }
+
+  {
+    SCOPED_TRACE(req.DebugString());
+    ASSERT_OK(admin_proxy_->CreateTablets(req, &resp, &rpc));
+    SCOPED_TRACE(resp.DebugString());
+    ASSERT_FALSE(resp.has_error());
+    ASSERT_EQ(3, resp.tablets_size());
+    ASSERT_TRUE(resp.tablets(0).has_error());
+    ASSERT_EQ(TabletServerErrorPB::TABLET_ALREADY_EXISTS, resp.tablets(0).error().code());
+    ASSERT_FALSE(resp.tablets(1).has_error());
+    ASSERT_FALSE(resp.tablets(2).has_error());
+  }
+
+  for (const char* tablet_id : { "new_tablet_1", "new_tablet_2" }) {
+    ASSERT_OK(WaitForTabletRunning(tablet_id));
+  }
+}
+
 TEST_F(TabletServerTest, TestDeleteTablet) {
   scoped_refptr<TabletPeer> tablet;
 
@@ -2234,6 +2536,78 @@ TEST_F(TabletServerTest, TestChecksumScan) {
   ASSERT_FALSE(resp.has_more_results());
 }
 
+// Test that checksum scans of flushed rows use the checksums stored with the
+// rowsets, and only while those are valid.
+TEST_F(TabletServerTest, TestChecksumScanWithStoredChecksums) {
+  const int kNumRows = 10;
+  InsertTestRowsRemote(0, 0, kNumRows);
+  ASSERT_OK(tablet_peer_->tablet()->Flush());
+
+  // Scan a row per batch, so that a scan which reads any row has more
+  // results after the first request.
+  FLAGS_scanner_batch_size_rows = 1;
+  ChecksumRequestPB req;
+  req.mutable_new_request()->set_tablet_id(kTabletId);
+  req.mutable_new_request()->set_read_mode(READ_LATEST);
+  req.set_call_seq_id(0);
+  req.set_batch_size_bytes(1);
+  ASSERT_OK(SchemaToColumnPBs(schema_, req.mutable_new_request()->mutable_projected_columns(),
+                              SCHEMA_PB_WITHOUT_IDS));
+
+  uint64_t expected_crc = 0;
+  for (int i = 0; i < kNumRows; i++) {
+    expected_crc += CalcTestRowChecksum(i);
+  }
+
+  // The flushed rowset isn't read at all.
+  ChecksumResponsePB resp;
+  RpcController controller;
+  ASSERT_OK(proxy_->Checksum(req, &resp, &controller));
+  ASSERT_FALSE(resp.has_error()) << resp.error().DebugString();
+  ASSERT_EQ(expected_crc, resp.checksum());
+  ASSERT_EQ(kNumRows, resp.rows_checksummed());
+  ASSERT_FALSE(resp.has_more_results());
+
+  // Nor is it if only some of the columns are scanned, though the checksum
+  // is then computed from the rows read.
+  {
+    ChecksumRequestPB key_req = req;
+    ASSERT_OK(SchemaToColumnPBs(schema_.CreateKeyProjection(),
+                                key_req.mutable_new_request()->mutable_projected_columns(),
+                                SCHEMA_PB_WITHOUT_IDS));
+    controller.Reset();
+    ASSERT_OK(proxy_->Checksum(key_req, &resp, &controller));
+    ASSERT_FALSE(resp.has_error()) << resp.error().DebugString();
+    ASSERT_TRUE(resp.has_more_results());
+    ASSERT_EQ(1, resp.rows_checksummed());
+  }
+
+  // Once a row is deleted, the rowset has to be read, and the checksum
+  // reflects the deletion.
+  ASSERT_NO_FATAL_FAILURE(DeleteTestRowsRemote(0, 1));
+  expected_crc -= CalcTestRowChecksum(0);
+  FLAGS_scanner_batch_size_rows = 100;
+  req.set_batch_size_bytes(1024 * 1024);
+  controller.Reset();
+  ASSERT_OK(proxy_->Checksum(req, &resp, &controller));
+  ASSERT_FALSE(resp.has_error()) << resp.error().DebugString();
+  ASSERT_EQ(expected_crc, resp.checksum());
+  ASSERT_EQ(kNumRows - 1, resp.rows_checksummed());
+  ASSERT_FALSE(resp.has_more_results());
+
+  // After the rows are compacted, the checksum is stored again, and matches
+  // the one computed from the rows.
+  ASSERT_OK(tablet_peer_->tablet()->Compact(Tablet::FORCE_COMPACT_ALL));
+  for (bool use_stored : { true, false }) {
+    FLAGS_checksum_use_stored_rowset_checksums = use_stored;
+    controller.Reset();
+    ASSERT_OK(proxy_->Checksum(req, &resp, &controller));
+    ASSERT_FALSE(resp.has_error()) << resp.error().DebugString();
+    ASSERT_EQ(expected_crc, resp.checksum());
+    ASSERT_EQ(kNumRows - 1, resp.rows_checksummed());
+  }
+}
+
 class DelayFsyncLogHook : public log::Log::LogFaultHooks {
  public:
   DelayFsyncLogHook() : log_latch1_(1), test_latch1_(1) {}
@@ -17,7 +17,9 @@
 
 #include "kudu/tserver/tablet_server.h"
 
+#include <gflags/gflags.h>
 #include <glog/logging.h>
+#include <algorithm>
 #include <list>
 #include <vector>
 
@@ -28,16 +30,40 @@
 #include "kudu/server/rpc_server.h"
 #include "kudu/server/webserver.h"
 #include "kudu/tserver/heartbeater.h"
+#include "kudu/tserver/scan_result_cache.h"
 #include "kudu/tserver/scanners.h"
 #include "kudu/tserver/tablet_service.h"
 #include "kudu/tserver/ts_tablet_manager.h"
 #include "kudu/tserver/tserver-path-handlers.h"
 #include "kudu/tserver/tablet_copy_service.h"
+#include "kudu/util/env.h"
+#include "kudu/util/flag_tags.h"
 #include "kudu/util/maintenance_manager.h"
 #include "kudu/util/net/net_util.h"
 #include "kudu/util/net/sockaddr.h"
 #include "kudu/util/status.h"
 
+DEFINE_string(block_cache_save_path, "",
+              "If set, the tablet server writes the contents of the block cache to "
+              "this file when it shuts down, and loads them back when it next starts, "
+              "so that it does not start serving scans with a cold cache. With the "
+              "NVM block cache, this is typically a file on the NVM device.");
+TAG_FLAG(block_cache_save_path, experimental);
+
+DEFINE_int32(leader_transfer_on_shutdown_timeout_ms, 0,
+             "If positive, a tablet server which shuts down first hands the leadership "
+             "of its tablets to other replicas, and waits up to this long for them to "
+             "take over. This keeps writes available through rolling restarts. "
+             "0 disables the transfer.");
+TAG_FLAG(leader_transfer_on_shutdown_timeout_ms, advanced);
+
+DEFINE_int64(scan_result_cache_capacity_mb, 0,
+             "Capacity of the cache of the results of snapshot scans, in megabytes. "
+             "Repeated scans of the same snapshot timestamp with the same projection, "
+             "predicates and bounds are served from this cache, as long as their "
+             "complete result fits in a single response. 0 disables the cache.");
+TAG_FLAG(scan_result_cache_capacity_mb, experimental);
+
 using kudu::rpc::ServiceIf;
 using kudu::tablet::TabletPeer;
 using std::shared_ptr;
@@ -46,6 +72,17 @@ using std::vector;
 namespace kudu {
 namespace tserver {
 
+namespace {
+
+MaintenanceManager::Options MaintenanceManagerOptions(const TabletServerOptions& opts) {
+  MaintenanceManager::Options options = MaintenanceManager::DEFAULT_OPTIONS;
+  // Without data paths, the data is kept under the WAL path.
+  options.num_data_dirs = std::max<int32_t>(opts.fs_opts.data_paths.size(), 1);
+  return options;
+}
+
+} // anonymous namespace
+
 TabletServer::TabletServer(const TabletServerOptions& opts)
   : ServerBase("TabletServer", opts, "kudu.tabletserver"),
     initted_(false),
@@ -53,8 +90,11 @@ TabletServer::TabletServer(const TabletServerOptions& opts)
     opts_(opts),
     tablet_manager_(new TSTabletManager(fs_manager_.get(), this, metric_registry())),
     scanner_manager_(new ScannerManager(metric_entity())),
+    scan_result_cache_(new ScanResultCache(
+        std::max<int64_t>(FLAGS_scan_result_cache_capacity_mb, 0) * 1024 * 1024,
+        metric_entity())),
     path_handlers_(new TabletServerPathHandlers(this)),
-    maintenance_manager_(new MaintenanceManager(MaintenanceManager::DEFAULT_OPTIONS)) {
+    maintenance_manager_(new MaintenanceManager(MaintenanceManagerOptions(opts))) {
 }
 
 TabletServer::~TabletServer() {
@@ -80,6 +120,7 @@ Status TabletServer::Init() {
   CHECK(!initted_);
 
   cfile::BlockCache::GetSingleton()->StartInstrumentation(metric_entity());
+  LoadBlockCache();
 
   // Validate that the passed master address actually resolves.
   // We don't validate that we can connect at this point -- it should
@@ -137,12 +178,47 @@ void TabletServer::Shutdown() {
   if (initted_) {
     maintenance_manager_->Shutdown();
     WARN_NOT_OK(heartbeater_->Stop(), "Failed to stop TS Heartbeat thread");
+    // Hand off leadership while the RPC layer can still reach the successors.
+    if (FLAGS_leader_transfer_on_shutdown_timeout_ms > 0) {
+      tablet_manager_->TransferLeadershipOfAllTablets(
+          MonoDelta::FromMilliseconds(FLAGS_leader_transfer_on_shutdown_timeout_ms));
+    }
     ServerBase::Shutdown();
     tablet_manager_->Shutdown();
+    SaveBlockCache();
   }
 
   LOG(INFO) << "TabletServer shut down complete. Bye!";
 }
 
+void TabletServer::LoadBlockCache() {
+  if (FLAGS_block_cache_save_path.empty()) {
+    return;
+  }
+  Env* env = fs_manager_->env();
+  if (!env->FileExists(FLAGS_block_cache_save_path)) {
+    return;
+  }
+  int64_t num_loaded;
+  Status s = cfile::BlockCache::GetSingleton()->LoadFromFile(
+      env, FLAGS_block_cache_save_path, &num_loaded);
+  LOG(INFO) << "Loaded " << num_loaded << " blocks into the block cache from "
+            << FLAGS_block_cache_save_path;
+  WARN_NOT_OK(s, "Unable to load the saved block cache");
+
+  // Don't load the same contents again after a crash: they'd be out of date.
+  WARN_NOT_OK(env->DeleteFile(FLAGS_block_cache_save_path),
+              "Unable to delete the saved block cache");
+}
+
+void TabletServer::SaveBlockCache() {
+  if (FLAGS_block_cache_save_path.empty()) {
+    return;
+  }
+  WARN_NOT_OK(cfile::BlockCache::GetSingleton()->SaveToFile(
+                  fs_manager_->env(), FLAGS_block_cache_save_path),
+              "Unable to save the block cache");
+}
+
 } // namespace tserver
 } // namespace kudu
@@ -41,6 +41,7 @@ namespace tserver {
 
 class Heartbeater;
 class ScannerManager;
+class ScanResultCache;
 class TabletServerPathHandlers;
 class TSTabletManager;
 
@@ -73,6 +74,8 @@ class TabletServer : public server::ServerBase {
 
   ScannerManager* scanner_manager() { return scanner_manager_.get(); }
 
+  ScanResultCache* scan_result_cache() { return scan_result_cache_.get(); }
+
   Heartbeater* heartbeater() { return heartbeater_.get(); }
 
   void set_fail_heartbeats_for_tests(bool fail_heartbeats_for_tests) {
@@ -92,6 +95,10 @@ class TabletServer : public server::ServerBase {
 
   Status ValidateMasterAddressResolution() const;
 
+  // Load and save the block cache's contents. See --block_cache_save_path.
+  void LoadBlockCache();
+  void SaveBlockCache();
+
   bool initted_;
 
   // If true, all heartbeats will be seen as failed.
@@ -108,6 +115,10 @@ class TabletServer : public server::ServerBase {
   // dependencies.
   gscoped_ptr<ScannerManager> scanner_manager_;
 
+  // Cache of the results of repeated snapshot scans. Always non-NULL, but
+  // only caches results if --scan_result_cache_capacity_mb is positive.
+  gscoped_ptr<ScanResultCache> scan_result_cache_;
+
   // Thread responsible for heartbeating to the master.
   gscoped_ptr<Heartbeater> heartbeater_;
 
@@ -23,38 +23,46 @@
 #include <string>
 #include <vector>
 
+#include "kudu/common/aggregate.h"
 #include "kudu/common/iterator.h"
+#include "kudu/common/row_checksum.h"
 #include "kudu/common/scan_spec.h"
 #include "kudu/common/schema.h"
 #include "kudu/common/wire_protocol.h"
 #include "kudu/consensus/consensus.h"
+#include "kudu/consensus/log.h"
 #include "kudu/gutil/bind.h"
 #include "kudu/gutil/casts.h"
 #include "kudu/gutil/stl_util.h"
 #include "kudu/gutil/stringprintf.h"
 #include "kudu/gutil/strings/escaping.h"
+#include "kudu/gutil/walltime.h"
 #include "kudu/rpc/rpc_context.h"
 #include "kudu/rpc/rpc_sidecar.h"
 #include "kudu/server/hybrid_clock.h"
 #include "kudu/tablet/compaction.h"
+#include "kudu/tablet/delta_iterator_merger.h"
 #include "kudu/tablet/metadata.pb.h"
 #include "kudu/tablet/tablet_bootstrap.h"
 #include "kudu/tablet/tablet_metrics.h"
 #include "kudu/tablet/tablet_peer.h"
 #include "kudu/tablet/transactions/alter_schema_transaction.h"
+#include "kudu/tablet/transactions/write_coalescer.h"
 #include "kudu/tablet/transactions/write_transaction.h"
 #include "kudu/tserver/tablet_copy_service.h"
+#include "kudu/tserver/scan_result_cache.h"
 #include "kudu/tserver/scanners.h"
 #include "kudu/tserver/tablet_server.h"
 #include "kudu/tserver/ts_tablet_manager.h"
 #include "kudu/tserver/tserver.pb.h"
-#include "kudu/util/crc.h"
+#include "kudu/util/debug/binary_trace.h"
 #include "kudu/util/debug/trace_event.h"
 #include "kudu/util/faststring.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/logging.h"
 #include "kudu/util/mem_tracker.h"
 #include "kudu/util/monotime.h"
+#include "kudu/util/scoped_cleanup.h"
 #include "kudu/util/status.h"
 #include "kudu/util/status_callback.h"
 #include "kudu/util/trace.h"
@@ -71,10 +79,19 @@ TAG_FLAG(scanner_max_batch_size_bytes, advanced);
 TAG_FLAG(scanner_max_batch_size_bytes, runtime);
 
 DEFINE_int32(scanner_batch_size_rows, 100,
-             "The number of rows to batch for servicing scan requests.");
+             "The maximum number of rows to read at a time when servicing scan "
+             "requests. Fewer rows are read at a time when they are wide enough "
+             "to overshoot the batch size.");
 TAG_FLAG(scanner_batch_size_rows, advanced);
 TAG_FLAG(scanner_batch_size_rows, runtime);
 
+DEFINE_bool(checksum_use_stored_rowset_checksums, true,
+            "Whether checksum scans of whole rows use the checksums which are "
+            "stored with the base data of rowsets instead of reading rowsets "
+            "which have no updates since they were written.");
+TAG_FLAG(checksum_use_stored_rowset_checksums, advanced);
+TAG_FLAG(checksum_use_stored_rowset_checksums, runtime);
+
 // Fault injection flags.
 DEFINE_int32(scanner_inject_latency_on_each_batch_ms, 0,
              "If set, the scanner will pause the specified number of milliesconds "
@@ -99,6 +116,8 @@ using kudu::consensus::GetNodeInstanceRequestPB;
 using kudu::consensus::GetNodeInstanceResponsePB;
 using kudu::consensus::LeaderStepDownRequestPB;
 using kudu::consensus::LeaderStepDownResponsePB;
+using kudu::consensus::MultiRaftConsensusRequestPB;
+using kudu::consensus::MultiRaftConsensusResponsePB;
 using kudu::consensus::RunLeaderElectionRequestPB;
 using kudu::consensus::RunLeaderElectionResponsePB;
 using kudu::consensus::StartTabletCopyRequestPB;
@@ -109,10 +128,12 @@ using kudu::rpc::ResultTracker;
 using kudu::rpc::RpcContext;
 using kudu::server::HybridClock;
 using kudu::tablet::AlterSchemaTransactionState;
+using kudu::tablet::StoredChecksums;
 using kudu::tablet::Tablet;
 using kudu::tablet::TabletPeer;
 using kudu::tablet::TabletStatusPB;
 using kudu::tablet::TransactionCompletionCallback;
+using kudu::tablet::WriteCoalescer;
 using kudu::tablet::WriteTransactionState;
 using std::shared_ptr;
 using std::unique_ptr;
@@ -123,6 +144,8 @@ namespace kudu {
 namespace cfile {
 extern const char* CFILE_CACHE_MISS_BYTES_METRIC_NAME;
 extern const char* CFILE_CACHE_HIT_BYTES_METRIC_NAME;
+extern const char* CFILE_CACHE_MISS_METRIC_NAME;
+extern const char* CFILE_CACHE_HIT_METRIC_NAME;
 }
 }
 
@@ -131,6 +154,19 @@ namespace tserver {
 
 namespace {
 
+// Names of the trace counters incremented by scan requests, from which the
+// profile of a request is built along with the counters of the tablet and
+// its CFiles.
+const char* const kScanOpenTimeTraceCounter = "scan_open_us";
+const char* const kScanIterateTimeTraceCounter = "scan_iterate_us";
+const char* const kScanCollectTimeTraceCounter = "scan_collect_us";
+const char* const kScanRowsScannedTraceCounter = "scan_rows_scanned";
+const char* const kScanRowsReturnedTraceCounter = "scan_rows_returned";
+const char* const kScanBlocksReadTraceCounter = "scan_data_blocks_read";
+const char* const kScanCellsReadTraceCounter = "scan_cells_read";
+const char* const kScanBytesReadTraceCounter = "scan_bytes_read";
+const char* const kScanCellsSkippedTraceCounter = "scan_cells_skipped";
+
 // Lookup the given tablet, ensuring that it both exists and is RUNNING.
 // If it is not, responds to the RPC associated with 'context' after setting
 // resp->mutable_error() to indicate the failure reason.
@@ -248,14 +284,21 @@ static StatusCallback BindHandleResponse(const ReqType* req, RespType* resp, Rpc
 
 typedef ListTabletsResponsePB::StatusAndSchemaPB StatusAndSchemaPB;
 
+// The longest backoff hint given to the clients of writes rejected due to
+// memory pressure, as the server reaches its hard memory limit.
+static const int kMaxMemoryPressureBackoffMs = 1000;
+
+// If initialized, 'retry_after' hints how long the client should wait for
+// before retrying a request which was rejected because the server is busy.
 static void SetupErrorAndRespond(TabletServerErrorPB* error,
                                  const Status& s,
                                  TabletServerErrorPB::Code code,
-                                 rpc::RpcContext* context) {
+                                 rpc::RpcContext* context,
+                                 const MonoDelta& retry_after = MonoDelta()) {
   // Generic "service unavailable" errors will cause the client to retry later.
   if ((code == TabletServerErrorPB::UNKNOWN_ERROR ||
        code == TabletServerErrorPB::THROTTLED) && s.IsServiceUnavailable()) {
-    context->RespondRpcFailure(rpc::ErrorStatusPB::ERROR_SERVER_TOO_BUSY, s);
+    context->RespondRpcFailure(rpc::ErrorStatusPB::ERROR_SERVER_TOO_BUSY, s, retry_after);
     return;
   }
 
@@ -322,6 +365,11 @@ class ScanResultCollector {
 
   // Return the number of rows actually returned to the client.
   virtual int64_t NumRowsReturned() const = 0;
+
+  // Returns where a new scan may add up the checksums of the rowsets which
+  // it skips because their checksums are known, or NULL if the scan must
+  // read every row.
+  virtual StoredChecksums* stored_checksums() { return nullptr; }
 };
 
 namespace {
@@ -330,16 +378,11 @@ namespace {
 // in the RowBlock. If no row is selected, last_primary_key is not set.
 void SetLastRow(const RowBlock& row_block, faststring* last_primary_key) {
   // Find the last selected row and save its encoded key.
-  const SelectionVector* sel = row_block.selection_vector();
-  if (sel->AnySelected()) {
-    for (int i = sel->nrows() - 1; i >= 0; i--) {
-      if (sel->IsRowSelected(i)) {
-        RowBlockRow last_row = row_block.row(i);
-        const Schema* schema = last_row.schema();
-        schema->EncodeComparableKey(last_row, last_primary_key);
-        break;
-      }
-    }
+  size_t last_idx;
+  if (row_block.selection_vector()->FindLastSelected(&last_idx)) {
+    RowBlockRow last_row = row_block.row(last_idx);
+    const Schema* schema = last_row.schema();
+    schema->EncodeComparableKey(last_row, last_primary_key);
   }
 }
 
@@ -398,12 +441,117 @@ class ScanResultCopier : public ScanResultCollector {
   DISALLOW_COPY_AND_ASSIGN(ScanResultCopier);
 };
 
+// Copies the scan result into per-column buffers, for clients which asked
+// for the COLUMNAR row layout.
+class ColumnarScanResultCopier : public ScanResultCollector {
+ public:
+  ColumnarScanResultCopier()
+      : blocks_processed_(0),
+        num_rows_returned_(0) {
+  }
+
+  virtual void HandleRowBlock(const Schema* client_projection_schema,
+                              const RowBlock& row_block) OVERRIDE {
+    blocks_processed_++;
+    num_rows_returned_ += row_block.selection_vector()->CountSelected();
+    SerializeRowBlockColumnar(row_block, client_projection_schema, &batch_);
+    SetLastRow(row_block, &last_primary_key_);
+  }
+
+  virtual int BlocksProcessed() const OVERRIDE { return blocks_processed_; }
+
+  // Returns number of bytes buffered to return.
+  virtual int64_t ResponseSize() const OVERRIDE {
+    return batch_.TotalSize();
+  }
+
+  virtual const faststring& last_primary_key() const OVERRIDE {
+    return last_primary_key_;
+  }
+
+  virtual int64_t NumRowsReturned() const OVERRIDE {
+    return num_rows_returned_;
+  }
+
+  // Hands the buffers over to 'context' as sidecars and records their
+  // indexes in 'data'.
+  void AddSidecars(rpc::RpcContext* context, ColumnarRowBlockPB* data) {
+    data->set_num_rows(batch_.num_rows);
+    for (ColumnarSerializedBatch::Column& col : batch_.columns) {
+      ColumnarRowBlockPB::Column* col_pb = data->add_columns();
+      col_pb->set_data_sidecar(AddSidecar(context, std::move(col.data)));
+      if (col.varlen_data && col.varlen_data->size() > 0) {
+        col_pb->set_varlen_data_sidecar(AddSidecar(context, std::move(col.varlen_data)));
+      }
+      if (col.non_null_bitmap) {
+        col_pb->set_non_null_bitmap_sidecar(AddSidecar(context, std::move(col.non_null_bitmap)));
+      }
+    }
+  }
+
+ private:
+  static int AddSidecar(rpc::RpcContext* context, std::unique_ptr<faststring> buf) {
+    int idx;
+    CHECK_OK(context->AddRpcSidecar(make_gscoped_ptr(
+        new rpc::RpcSidecar(gscoped_ptr<faststring>(buf.release()))), &idx));
+    return idx;
+  }
+
+  ColumnarSerializedBatch batch_;
+  int blocks_processed_;
+  int64_t num_rows_returned_;
+  faststring last_primary_key_;
+
+  DISALLOW_COPY_AND_ASSIGN(ColumnarScanResultCopier);
+};
+
+// Computes partial aggregates over the scan result, for scans which asked
+// for aggregates instead of rows.
+class ScanResultAggregator : public ScanResultCollector {
+ public:
+  explicit ScanResultAggregator(const RepeatedPtrField<AggregatePB>& aggregates)
+      : aggregator_(aggregates),
+        blocks_processed_(0) {
+  }
+
+  virtual void HandleRowBlock(const Schema* client_projection_schema,
+                              const RowBlock& row_block) OVERRIDE {
+    blocks_processed_++;
+    aggregator_.AddRowBlock(row_block);
+    SetLastRow(row_block, &last_primary_key_);
+  }
+
+  virtual int BlocksProcessed() const OVERRIDE { return blocks_processed_; }
+
+  // Returns a constant -- like checksums, aggregates are returned based on
+  // a time budget.
+  virtual int64_t ResponseSize() const OVERRIDE { return 0; }
+
+  virtual const faststring& last_primary_key() const OVERRIDE {
+    return last_primary_key_;
+  }
+
+  virtual int64_t NumRowsReturned() const OVERRIDE {
+    return 0;
+  }
+
+  void ToPB(RepeatedPtrField<AggregateResultPB>* results) const {
+    aggregator_.ToPB(results);
+  }
+
+ private:
+  Aggregator aggregator_;
+  int blocks_processed_;
+  faststring last_primary_key_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScanResultAggregator);
+};
+
 // Checksums the scan result.
 class ScanResultChecksummer : public ScanResultCollector {
  public:
   ScanResultChecksummer()
-      : crc_(crc::GetCrc32cInstance()),
-        agg_checksum_(0),
+      : agg_checksum_(0),
         blocks_processed_(0),
         rows_checksummed_(0) {
   }
@@ -418,7 +566,7 @@ class ScanResultChecksummer : public ScanResultCollector {
     size_t nrows = row_block.nrows();
     for (size_t i = 0; i < nrows; i++) {
       if (!row_block.selection_vector()->IsRowSelected(i)) continue;
-      uint32_t row_crc = CalcRowCrc32(*client_projection_schema, row_block.row(i));
+      uint32_t row_crc = checksummer_.RowCrc32(*client_projection_schema, row_block.row(i));
       agg_checksum_ += row_crc;
       rows_checksummed_++;
     }
@@ -437,49 +585,26 @@ class ScanResultChecksummer : public ScanResultCollector {
     return 0;
   }
 
+  StoredChecksums* stored_checksums() OVERRIDE { return &stored_checksums_; }
+
   int64_t rows_checksummed() const {
-    return rows_checksummed_;
+    return rows_checksummed_ + stored_checksums_.num_rows;
   }
 
   // Accessors for initializing / setting the checksum.
   void set_agg_checksum(uint64_t value) { agg_checksum_ = value; }
-  uint64_t agg_checksum() const { return agg_checksum_; }
+  uint64_t agg_checksum() const { return agg_checksum_ + stored_checksums_.checksum; }
 
  private:
-  // Calculates a CRC32C for the given row.
-  uint32_t CalcRowCrc32(const Schema& projection, const RowBlockRow& row) {
-    tmp_buf_.clear();
-
-    for (size_t j = 0; j < projection.num_columns(); j++) {
-      uint32_t col_index = static_cast<uint32_t>(j);  // For the CRC.
-      tmp_buf_.append(&col_index, sizeof(col_index));
-      ColumnBlockCell cell = row.cell(j);
-      if (cell.is_nullable()) {
-        uint8_t is_defined = cell.is_null() ? 0 : 1;
-        tmp_buf_.append(&is_defined, sizeof(is_defined));
-        if (!is_defined) continue;
-      }
-      if (cell.typeinfo()->physical_type() == BINARY) {
-        const Slice* data = reinterpret_cast<const Slice *>(cell.ptr());
-        tmp_buf_.append(data->data(), data->size());
-      } else {
-        tmp_buf_.append(cell.ptr(), cell.size());
-      }
-    }
-
-    uint64_t row_crc = 0;
-    crc_->Compute(tmp_buf_.data(), tmp_buf_.size(), &row_crc, nullptr);
-    return static_cast<uint32_t>(row_crc); // CRC32 only uses the lower 32 bits.
-  }
-
-
-  faststring tmp_buf_;
-  crc::Crc* const crc_;
+  RowChecksummer checksummer_;
   uint64_t agg_checksum_;
   int blocks_processed_;
   int64_t rows_checksummed_;
   faststring encoded_last_row_;
 
+  // The rowsets skipped by a new scan, which were not checksummed above.
+  StoredChecksums stored_checksums_;
+
   DISALLOW_COPY_AND_ASSIGN(ScanResultChecksummer);
 };
 
@@ -496,6 +621,20 @@ static size_t GetMaxBatchSizeBytesHint(const ScanRequestPB* req) {
                   implicit_cast<uint32_t>(FLAGS_scanner_max_batch_size_bytes));
 }
 
+// The smallest batch of scan results worth building when memory is short.
+static const int64_t kMinScanBatchSizeBytes = 64 * 1024;
+
+// Reserves the memory of a batch of up to 'max_bytes' of scan results from
+// 'tracker', and returns its size. At most half of the spare capacity is
+// handed out at a time, so that batches shrink as concurrent scans fill up
+// the budget rather than the first ones taking all of it. Returns 0 if not
+// even a small batch fits.
+static int64_t ReserveScanBatchMemory(MemTracker* tracker, int64_t max_bytes) {
+  int64_t min_bytes = std::min(max_bytes, kMinScanBatchSizeBytes);
+  int64_t bytes = std::max(std::min(max_bytes, tracker->SpareCapacity() / 2), min_bytes);
+  return tracker->TryConsume(bytes) ? bytes : 0;
+}
+
 TabletServiceImpl::TabletServiceImpl(TabletServer* server)
   : TabletServerServiceIf(server->metric_entity(), server->result_tracker()),
     server_(server) {
@@ -594,52 +733,25 @@ void TabletServiceAdminImpl::CreateTablet(const CreateTabletRequestPB* req,
   TRACE_EVENT1("tserver", "CreateTablet",
                "tablet_id", req->tablet_id());
 
-  Schema schema;
-  Status s = SchemaFromPB(req->schema(), &schema);
-  DCHECK(schema.has_column_ids());
-  if (!s.ok()) {
-    SetupErrorAndRespond(resp->mutable_error(),
-                         Status::InvalidArgument("Invalid Schema."),
-                         TabletServerErrorPB::INVALID_SCHEMA, context);
+  TabletServerErrorPB::Code code;
+  Status s = server_->tablet_manager()->CreateNewTabletFromPB(*req, &code);
+  if (PREDICT_FALSE(!s.ok())) {
+    SetupErrorAndRespond(resp->mutable_error(), s, code, context);
     return;
   }
+  context->RespondSuccess();
+}
 
-  PartitionSchema partition_schema;
-  s = PartitionSchema::FromPB(req->partition_schema(), schema, &partition_schema);
-  if (!s.ok()) {
-    SetupErrorAndRespond(resp->mutable_error(),
-                         Status::InvalidArgument("Invalid PartitionSchema."),
-                         TabletServerErrorPB::INVALID_SCHEMA, context);
+void TabletServiceAdminImpl::CreateTablets(const CreateTabletsRequestPB* req,
+                                           CreateTabletsResponsePB* resp,
+                                           rpc::RpcContext* context) {
+  if (!CheckUuidMatchOrRespond(server_->tablet_manager(), "CreateTablets", req, resp, context)) {
     return;
   }
+  TRACE_EVENT1("tserver", "CreateTablets",
+               "num_tablets", req->tablets_size());
 
-  Partition partition;
-  Partition::FromPB(req->partition(), &partition);
-
-  LOG(INFO) << "Processing CreateTablet for tablet " << req->tablet_id()
-            << " (table=" << req->table_name()
-            << " [id=" << req->table_id() << "]), partition="
-            << partition_schema.PartitionDebugString(partition, schema);
-  VLOG(1) << "Full request: " << req->DebugString();
-
-  s = server_->tablet_manager()->CreateNewTablet(req->table_id(),
-                                                 req->tablet_id(),
-                                                 partition,
-                                                 req->table_name(),
-                                                 schema,
-                                                 partition_schema,
-                                                 req->config(),
-                                                 nullptr);
-  if (PREDICT_FALSE(!s.ok())) {
-    TabletServerErrorPB::Code code;
-    if (s.IsAlreadyPresent()) {
-      code = TabletServerErrorPB::TABLET_ALREADY_EXISTS;
-    } else {
-      code = TabletServerErrorPB::UNKNOWN_ERROR;
-    }
-    SetupErrorAndRespond(resp->mutable_error(), s, code, context);
-    return;
-  }
+  server_->tablet_manager()->CreateNewTablets(*req, resp);
   context->RespondSuccess();
 }
 
@@ -679,6 +791,40 @@ void TabletServiceAdminImpl::DeleteTablet(const DeleteTabletRequestPB* req,
   context->RespondSuccess();
 }
 
+void TabletServiceAdminImpl::SplitTablet(const SplitTabletRequestPB* req,
+                                         SplitTabletResponsePB* resp,
+                                         rpc::RpcContext* context) {
+  if (!CheckUuidMatchOrRespond(server_->tablet_manager(), "SplitTablet", req, resp, context)) {
+    return;
+  }
+  TRACE_EVENT1("tserver", "SplitTablet",
+               "tablet_id", req->tablet_id());
+  LOG(INFO) << "Processing SplitTablet for tablet " << req->tablet_id()
+            << " into " << req->left_tablet_id() << " and " << req->right_tablet_id()
+            << " from " << context->requestor_string();
+
+  string left_tablet_id = req->left_tablet_id();
+  string right_tablet_id = req->right_tablet_id();
+  Partition left_partition;
+  Partition right_partition;
+  boost::optional<TabletServerErrorPB::Code> error_code;
+  Status s = server_->tablet_manager()->SplitTablet(req->tablet_id(),
+                                                    &left_tablet_id,
+                                                    &right_tablet_id,
+                                                    &left_partition,
+                                                    &right_partition,
+                                                    &error_code);
+  if (PREDICT_FALSE(!s.ok())) {
+    HandleErrorResponse(req, resp, context, error_code, s);
+    return;
+  }
+  resp->set_left_tablet_id(left_tablet_id);
+  resp->set_right_tablet_id(right_tablet_id);
+  left_partition.ToPB(resp->mutable_left_partition());
+  right_partition.ToPB(resp->mutable_right_partition());
+  context->RespondSuccess();
+}
+
 void TabletServiceImpl::Write(const WriteRequestPB* req,
                               WriteResponsePB* resp,
                               rpc::RpcContext* context) {
@@ -691,6 +837,16 @@ void TabletServiceImpl::Write(const WriteRequestPB* req,
                                  &tablet_peer)) {
     return;
   }
+  resp->set_schema_version(tablet_peer->tablet_metadata()->schema_version());
+
+  // Send the client back to the master to find the tablets which took over
+  // the rows of a split tablet.
+  if (PREDICT_FALSE(tablet_peer->tablet_metadata()->has_been_split())) {
+    SetupErrorAndRespond(resp->mutable_error(),
+                         Status::NotFound("Tablet has been split", req->tablet_id()),
+                         TabletServerErrorPB::TABLET_NOT_FOUND, context);
+    return;
+  }
 
   shared_ptr<Tablet> tablet;
   TabletServerErrorPB::Code error_code;
@@ -702,6 +858,11 @@ void TabletServiceImpl::Write(const WriteRequestPB* req,
 
   uint64_t bytes = req->row_operations().rows().size() +
       req->row_operations().indirect_data().size();
+  for (const ColumnarInsertsPB& run : req->row_operations().columnar_inserts()) {
+    for (const ColumnarInsertsPB::Column& col : run.columns()) {
+      bytes += col.data().size() + col.varlen_data().size();
+    }
+  }
   if (!tablet->ShouldThrottleAllow(bytes)) {
     SetupErrorAndRespond(resp->mutable_error(),
                          Status::ServiceUnavailable("Rejecting Write request: throttled"),
@@ -710,6 +871,22 @@ void TabletServiceImpl::Write(const WriteRequestPB* req,
     return;
   }
 
+  // Reject a share of the writes, asking their clients to back off, while
+  // the tablet takes in data faster than its flushes or its WAL keep up with.
+  MonoDelta retry_after;
+  log::Log* log = tablet_peer->log();
+  if (!tablet->ShouldAdmitWrite(log ? log->GetAppendQueueFillRatio() : 0, &retry_after)) {
+    tablet->metrics()->leader_write_admission_rejections->Increment();
+    KLOG_EVERY_N_SECS(INFO, 1) << "Rejecting Write request: tablet is overloaded"
+                               << THROTTLE_MSG;
+    SetupErrorAndRespond(resp->mutable_error(),
+                         Status::ServiceUnavailable("Rejecting Write request: overloaded"),
+                         TabletServerErrorPB::THROTTLED,
+                         context,
+                         retry_after);
+    return;
+  }
+
   // Check for memory pressure; don't bother doing any additional work if we've
   // exceeded the limit.
   double capacity_pct;
@@ -723,9 +900,12 @@ void TabletServiceImpl::Write(const WriteRequestPB* req,
     } else {
       KLOG_EVERY_N_SECS(INFO, 1) << "Rejecting Write request: " << msg << THROTTLE_MSG;
     }
+    // The closer to the hard limit, the longer the client should back off.
     SetupErrorAndRespond(resp->mutable_error(), Status::ServiceUnavailable(msg),
                          TabletServerErrorPB::UNKNOWN_ERROR,
-                         context);
+                         context,
+                         MonoDelta::FromMilliseconds(
+                             kMaxMemoryPressureBackoffMs * std::min(capacity_pct, 100.0) / 100));
     return;
   }
 
@@ -738,11 +918,8 @@ void TabletServiceImpl::Write(const WriteRequestPB* req,
     return;
   }
 
-  unique_ptr<WriteTransactionState> tx_state(new WriteTransactionState(
-      tablet_peer.get(),
-      req,
-      context->AreResultsTracked() ? context->request_id() : nullptr,
-      resp));
+  const rpc::RequestIdPB* request_id =
+      context->AreResultsTracked() ? context->request_id() : nullptr;
 
   // If the client sent us a timestamp, decode it and update the clock so that all future
   // timestamps are greater than the passed timestamp.
@@ -757,6 +934,18 @@ void TabletServiceImpl::Write(const WriteRequestPB* req,
     return;
   }
 
+  // Small writes may be replicated together with others which arrive at about
+  // the same time. The coalescer always responds to the RPC.
+  if (WriteCoalescer::IsEnabled() && WriteCoalescer::CanCoalesce(*req, bytes)) {
+    tablet_peer->write_coalescer()->SubmitWrite(
+        req, resp, request_id,
+        gscoped_ptr<TransactionCompletionCallback>(
+            new RpcTransactionCompletionCallback<WriteResponsePB>(context, resp)));
+    return;
+  }
+
+  unique_ptr<WriteTransactionState> tx_state(new WriteTransactionState(
+      tablet_peer.get(), req, request_id, resp));
   tx_state->set_completion_callback(gscoped_ptr<TransactionCompletionCallback>(
       new RpcTransactionCompletionCallback<WriteResponsePB>(context,
                                                             resp)));
@@ -815,6 +1004,74 @@ void ConsensusServiceImpl::UpdateConsensus(const ConsensusRequestPB* req,
   context->RespondSuccess();
 }
 
+namespace {
+
+void SetupError(TabletServerErrorPB* error, const Status& s, TabletServerErrorPB::Code code) {
+  StatusToPB(s, error->mutable_status());
+  error->set_code(code);
+}
+
+// Applies one of the requests of a MultiRaftUpdateConsensus RPC, as
+// UpdateConsensus() would, except that errors are set in 'resp' rather than
+// responded with.
+void UpdateConsensusInBatch(TabletPeerLookupIf* tablet_manager,
+                            const ConsensusRequestPB& req,
+                            ConsensusResponsePB* resp) {
+  const string& local_uuid = tablet_manager->NodeInstance().permanent_uuid();
+  if (PREDICT_FALSE(req.has_dest_uuid() && req.dest_uuid() != local_uuid)) {
+    SetupError(resp->mutable_error(),
+               Status::InvalidArgument(Substitute("Wrong destination UUID requested. "
+                                                  "Local UUID: $0. Requested UUID: $1",
+                                                  local_uuid, req.dest_uuid())),
+               TabletServerErrorPB::WRONG_SERVER_UUID);
+    return;
+  }
+  scoped_refptr<TabletPeer> tablet_peer;
+  if (PREDICT_FALSE(!tablet_manager->GetTabletPeer(req.tablet_id(), &tablet_peer).ok())) {
+    SetupError(resp->mutable_error(), Status::NotFound("Tablet not found"),
+               TabletServerErrorPB::TABLET_NOT_FOUND);
+    return;
+  }
+  tablet::TabletStatePB state = tablet_peer->state();
+  if (PREDICT_FALSE(state != tablet::RUNNING)) {
+    SetupError(resp->mutable_error(),
+               Status::IllegalState("Tablet not RUNNING", tablet::TabletStatePB_Name(state)),
+               TabletServerErrorPB::TABLET_NOT_RUNNING);
+    return;
+  }
+  scoped_refptr<Consensus> consensus = tablet_peer->shared_consensus();
+  if (PREDICT_FALSE(!consensus)) {
+    SetupError(resp->mutable_error(),
+               Status::ServiceUnavailable("Consensus unavailable. Tablet not running"),
+               TabletServerErrorPB::TABLET_NOT_RUNNING);
+    return;
+  }
+  Status s = consensus->Update(&req, resp);
+  if (PREDICT_FALSE(!s.ok())) {
+    resp->Clear();
+    SetupError(resp->mutable_error(), s, TabletServerErrorPB::UNKNOWN_ERROR);
+  }
+}
+
+} // anonymous namespace
+
+void ConsensusServiceImpl::MultiRaftUpdateConsensus(const MultiRaftConsensusRequestPB* req,
+                                                    MultiRaftConsensusResponsePB* resp,
+                                                    rpc::RpcContext* context) {
+  DVLOG(3) << "Received Multi-Raft Consensus Update RPC: " << req->DebugString();
+  if (!CheckUuidMatchOrRespond(tablet_manager_, "MultiRaftUpdateConsensus", req, resp,
+                               context)) {
+    return;
+  }
+  // The requests carry no operations, so applying them is cheap enough to do
+  // one after the other on this thread.
+  for (const ConsensusRequestPB& tablet_req : req->requests()) {
+    DCHECK_EQ(0, tablet_req.ops_size());
+    UpdateConsensusInBatch(tablet_manager_, tablet_req, resp->add_responses());
+  }
+  context->RespondSuccess();
+}
+
 void ConsensusServiceImpl::RequestConsensusVote(const VoteRequestPB* req,
                                                 VoteResponsePB* resp,
                                                 rpc::RpcContext* context) {
@@ -911,7 +1168,9 @@ void ConsensusServiceImpl::LeaderStepDown(const LeaderStepDownRequestPB* req,
 
   scoped_refptr<Consensus> consensus;
   if (!GetConsensusOrRespond(tablet_peer, resp, context, &consensus)) return;
-  Status s = consensus->StepDown(resp);
+  Status s = req->has_new_leader_uuid() ?
+      consensus->TransferLeadership(req->new_leader_uuid(), resp) :
+      consensus->StepDown(resp);
   if (PREDICT_FALSE(!s.ok())) {
     SetupErrorAndRespond(resp->mutable_error(), s,
                          TabletServerErrorPB::UNKNOWN_ERROR,
@@ -1021,12 +1280,64 @@ void SetResourceMetrics(ResourceMetricsPB* metrics, rpc::RpcContext* context) {
   metrics->set_cfile_cache_hit_bytes(
     context->trace()->metrics()->GetMetric(cfile::CFILE_CACHE_HIT_BYTES_METRIC_NAME));
 }
+
+// Fills in the profile of a scan request from the counters of its trace.
+// 'start_time' and 'cpu_start_us' were taken when the handler started.
+void SetScanProfile(ScanProfilePB* profile, rpc::RpcContext* context,
+                    const MonoTime& start_time, int64_t cpu_start_us,
+                    bool from_result_cache) {
+  const TraceMetrics* m = context->trace()->metrics();
+  profile->set_handler_us((MonoTime::Now() - start_time).ToMicroseconds());
+  profile->set_open_us(m->GetMetric(kScanOpenTimeTraceCounter));
+  profile->set_iterate_us(m->GetMetric(kScanIterateTimeTraceCounter));
+  profile->set_collect_us(m->GetMetric(kScanCollectTimeTraceCounter));
+  profile->set_cpu_us(GetThreadCpuTimeMicros() - cpu_start_us);
+  profile->set_rows_scanned(m->GetMetric(kScanRowsScannedTraceCounter));
+  profile->set_rows_returned(m->GetMetric(kScanRowsReturnedTraceCounter));
+  profile->set_rowsets_scanned(m->GetMetric(tablet::kRowSetsScannedTraceCounter));
+  profile->set_rowsets_pruned_by_key_range(
+      m->GetMetric(tablet::kRowSetsPrunedByKeyRangeTraceCounter));
+  profile->set_rowsets_pruned_by_column_stats(
+      m->GetMetric(tablet::kRowSetsPrunedByColumnStatsTraceCounter));
+  profile->set_delta_stores_applied(m->GetMetric(tablet::kDeltaStoresAppliedTraceCounter));
+  profile->set_data_blocks_read(m->GetMetric(kScanBlocksReadTraceCounter));
+  profile->set_cells_read(m->GetMetric(kScanCellsReadTraceCounter));
+  profile->set_bytes_read(m->GetMetric(kScanBytesReadTraceCounter));
+  profile->set_cells_skipped(m->GetMetric(kScanCellsSkippedTraceCounter));
+  profile->set_cfile_cache_hits(m->GetMetric(cfile::CFILE_CACHE_HIT_METRIC_NAME));
+  profile->set_cfile_cache_misses(m->GetMetric(cfile::CFILE_CACHE_MISS_METRIC_NAME));
+  profile->set_cfile_cache_hit_bytes(m->GetMetric(cfile::CFILE_CACHE_HIT_BYTES_METRIC_NAME));
+  profile->set_cfile_cache_miss_bytes(m->GetMetric(cfile::CFILE_CACHE_MISS_BYTES_METRIC_NAME));
+  profile->set_result_cache_hits(from_result_cache ? 1 : 0);
+}
+
+// Hands the rows of a rowwise scan response over to 'context' as sidecars,
+// and records their indexes in 'data'.
+void AddRowwiseSidecars(rpc::RpcContext* context,
+                        gscoped_ptr<faststring> rows_data,
+                        gscoped_ptr<faststring> indirect_data,
+                        RowwiseRowBlockPB* data) {
+  int rows_idx;
+  CHECK_OK(context->AddRpcSidecar(make_gscoped_ptr(
+      new rpc::RpcSidecar(std::move(rows_data))), &rows_idx));
+  data->set_rows_sidecar(rows_idx);
+
+  // Add indirect data as a sidecar, if applicable.
+  if (indirect_data->size() > 0) {
+    int indirect_idx;
+    CHECK_OK(context->AddRpcSidecar(make_gscoped_ptr(
+        new rpc::RpcSidecar(std::move(indirect_data))), &indirect_idx));
+    data->set_indirect_data_sidecar(indirect_idx);
+  }
+}
 } // anonymous namespace
 
 void TabletServiceImpl::Scan(const ScanRequestPB* req,
                              ScanResponsePB* resp,
                              rpc::RpcContext* context) {
   TRACE_EVENT0("tserver", "TabletServiceImpl::Scan");
+  MonoTime start_time = MonoTime::Now();
+  int64_t cpu_start_us = GetThreadCpuTimeMicros();
   // Validate the request: user must pass a new_scan_request or
   // a scanner ID, but not both.
   if (PREDICT_FALSE(req->has_scanner_id() &&
@@ -1036,14 +1347,40 @@ void TabletServiceImpl::Scan(const ScanRequestPB* req,
     return;
   }
 
-  size_t batch_size_bytes = GetMaxBatchSizeBytesHint(req);
-  gscoped_ptr<faststring> rows_data(new faststring(batch_size_bytes * 11 / 10));
-  gscoped_ptr<faststring> indirect_data(new faststring(batch_size_bytes * 11 / 10));
+  // The columnar layout sizes its per-column buffers as the rows arrive.
+  bool columnar = req->row_layout() == COLUMNAR;
+  size_t buffer_size = columnar ? 0 : GetMaxBatchSizeBytesHint(req) * 11 / 10;
+  gscoped_ptr<faststring> rows_data(new faststring(buffer_size));
+  gscoped_ptr<faststring> indirect_data(new faststring(buffer_size));
   RowwiseRowBlockPB data;
-  ScanResultCopier collector(&data, rows_data.get(), indirect_data.get());
+  ScanResultCopier rowwise_collector(&data, rows_data.get(), indirect_data.get());
+  ColumnarScanResultCopier columnar_collector;
+  ScanResultCollector* collector = &rowwise_collector;
+  if (columnar) {
+    collector = &columnar_collector;
+  }
+
+  // Scans with aggregates return the partial aggregates over the rows
+  // processed by this request instead of the rows themselves. For continued
+  // scans, the aggregates were recorded in the scanner by the first request.
+  const RepeatedPtrField<AggregatePB>* aggregates = nullptr;
+  SharedScanner continued_scanner;
+  if (req->has_new_scan_request()) {
+    aggregates = &req->new_scan_request().aggregates();
+  } else if (req->has_scanner_id() &&
+             server_->scanner_manager()->LookupScanner(req->scanner_id(), &continued_scanner)) {
+    aggregates = &continued_scanner->aggregates();
+  }
+  gscoped_ptr<ScanResultAggregator> aggregate_collector;
+  if (aggregates != nullptr && !aggregates->empty()) {
+    aggregate_collector.reset(new ScanResultAggregator(*aggregates));
+    collector = aggregate_collector.get();
+  }
 
   bool has_more_results = false;
   TabletServerErrorPB::Code error_code = TabletServerErrorPB::UNKNOWN_ERROR;
+  ScanResultCache* result_cache = server_->scan_result_cache();
+  faststring cache_key;
   if (req->has_new_scan_request()) {
     const NewScanRequestPB& scan_pb = req->new_scan_request();
     scoped_refptr<TabletPeer> tablet_peer;
@@ -1051,10 +1388,36 @@ void TabletServiceImpl::Scan(const ScanRequestPB* req,
                                    &tablet_peer)) {
       return;
     }
+    resp->set_schema_version(tablet_peer->tablet_metadata()->schema_version());
+
+    // Repeated scans of a snapshot may be served from the result cache, as
+    // long as the snapshot could still be scanned.
+    if (result_cache->IsCacheable(*req)) {
+      ScanResultCache::EncodeKey(*req, resp->schema_version(), &cache_key);
+      shared_ptr<Tablet> tablet;
+      TabletServerErrorPB::Code unused_error_code;
+      Timestamp snap_timestamp;
+      snap_timestamp.FromUint64(scan_pb.snap_timestamp());
+      if (GetTabletRef(tablet_peer, &tablet, &unused_error_code).ok() &&
+          !tablet->GetHistoryGcOpts().IsAncientHistory(snap_timestamp) &&
+          result_cache->Lookup(Slice(cache_key), resp, &rows_data, &indirect_data)) {
+        TRACE("Served from the scan result cache");
+        if (resp->has_data()) {
+          AddRowwiseSidecars(context, std::move(rows_data), std::move(indirect_data),
+                             resp->mutable_data());
+        }
+        if (req->profile()) {
+          SetScanProfile(resp->mutable_profile(), context, start_time, cpu_start_us, true);
+        }
+        SetResourceMetrics(resp->mutable_resource_metrics(), context);
+        context->RespondSuccess();
+        return;
+      }
+    }
     string scanner_id;
     Timestamp scan_timestamp;
     Status s = HandleNewScanRequest(tablet_peer.get(), req, context,
-                                    &collector, &scanner_id, &scan_timestamp, &has_more_results,
+                                    collector, &scanner_id, &scan_timestamp, &has_more_results,
                                     &error_code);
     if (PREDICT_FALSE(!s.ok())) {
       SetupErrorAndRespond(resp->mutable_error(), s, error_code, context);
@@ -1069,7 +1432,7 @@ void TabletServiceImpl::Scan(const ScanRequestPB* req,
       resp->set_snap_timestamp(scan_timestamp.ToUint64());
     }
   } else if (req->has_scanner_id()) {
-    Status s = HandleContinueScanRequest(req, &collector, &has_more_results, &error_code);
+    Status s = HandleContinueScanRequest(req, collector, &has_more_results, &error_code);
     if (PREDICT_FALSE(!s.ok())) {
       SetupErrorAndRespond(resp->mutable_error(), s, error_code, context);
       return;
@@ -1081,32 +1444,36 @@ void TabletServiceImpl::Scan(const ScanRequestPB* req,
   }
   resp->set_has_more_results(has_more_results);
 
-  DVLOG(2) << "Blocks processed: " << collector.BlocksProcessed();
-  if (collector.BlocksProcessed() > 0) {
-    resp->mutable_data()->CopyFrom(data);
-
-    // Add sidecar data to context and record the returned indices.
-    int rows_idx;
-    CHECK_OK(context->AddRpcSidecar(make_gscoped_ptr(
-        new rpc::RpcSidecar(std::move(rows_data))), &rows_idx));
-    resp->mutable_data()->set_rows_sidecar(rows_idx);
-
-    // Add indirect data as a sidecar, if applicable.
-    if (indirect_data->size() > 0) {
-      int indirect_idx;
-      CHECK_OK(context->AddRpcSidecar(make_gscoped_ptr(
-          new rpc::RpcSidecar(std::move(indirect_data))), &indirect_idx));
-      resp->mutable_data()->set_indirect_data_sidecar(indirect_idx);
+  DVLOG(2) << "Blocks processed: " << collector->BlocksProcessed();
+  if (collector->BlocksProcessed() > 0) {
+    if (aggregate_collector) {
+      aggregate_collector->ToPB(resp->mutable_aggregate_results());
+    } else if (columnar) {
+      columnar_collector.AddSidecars(context, resp->mutable_columnar_data());
+    } else {
+      resp->mutable_data()->CopyFrom(data);
     }
 
     // Set the last row found by the collector.
     // We could have an empty batch if all the remaining rows are filtered by the predicate,
     // in which case do not set the last row.
-    const faststring& last = collector.last_primary_key();
+    const faststring& last = collector->last_primary_key();
     if (last.length() > 0) {
       resp->set_last_primary_key(last.ToString());
     }
   }
+
+  // A complete result is cached before its rows are handed over as sidecars.
+  if (cache_key.size() > 0 && !has_more_results) {
+    result_cache->Insert(Slice(cache_key), *resp, *rows_data, *indirect_data);
+  }
+  if (resp->has_data()) {
+    AddRowwiseSidecars(context, std::move(rows_data), std::move(indirect_data),
+                       resp->mutable_data());
+  }
+  if (req->profile()) {
+    SetScanProfile(resp->mutable_profile(), context, start_time, cpu_start_us, false);
+  }
   SetResourceMetrics(resp->mutable_resource_metrics(), context);
   context->RespondSuccess();
 }
@@ -1197,8 +1564,116 @@ void TabletServiceImpl::Checksum(const ChecksumRequestPB* req,
   context->RespondSuccess();
 }
 
+void TabletServiceImpl::SplitKeyRange(const SplitKeyRangeRequestPB* req,
+                                      SplitKeyRangeResponsePB* resp,
+                                      rpc::RpcContext* context) {
+  scoped_refptr<TabletPeer> tablet_peer;
+  if (!LookupTabletPeerOrRespond(server_->tablet_manager(), req->tablet_id(), resp, context,
+                                 &tablet_peer)) {
+    return;
+  }
+  shared_ptr<Tablet> tablet;
+  TabletServerErrorPB::Code error_code;
+  Status s = GetTabletRef(tablet_peer, &tablet, &error_code);
+  if (PREDICT_FALSE(!s.ok())) {
+    SetupErrorAndRespond(resp->mutable_error(), s, error_code, context);
+    return;
+  }
+  if (PREDICT_FALSE(req->target_chunk_size_bytes() == 0)) {
+    context->RespondFailure(Status::InvalidArgument("target chunk size must be positive"));
+    return;
+  }
+
+  Slice start_key(req->start_primary_key());
+  Slice stop_key(req->stop_primary_key());
+  vector<string> split_keys;
+  tablet->SplitKeyRange(req->has_start_primary_key() ? &start_key : nullptr,
+                        req->has_stop_primary_key() ? &stop_key : nullptr,
+                        req->target_chunk_size_bytes(),
+                        &split_keys);
+  for (string& key : split_keys) {
+    resp->add_split_primary_keys()->swap(key);
+  }
+  context->RespondSuccess();
+}
+
+void TabletServiceImpl::LookupRows(const LookupRowsRequestPB* req,
+                                   LookupRowsResponsePB* resp,
+                                   rpc::RpcContext* context) {
+  TRACE_EVENT1("tserver", "TabletServiceImpl::LookupRows",
+               "tablet_id", req->tablet_id());
+  scoped_refptr<TabletPeer> tablet_peer;
+  if (!LookupTabletPeerOrRespond(server_->tablet_manager(), req->tablet_id(), resp, context,
+                                 &tablet_peer)) {
+    return;
+  }
+  shared_ptr<Tablet> tablet;
+  TabletServerErrorPB::Code error_code;
+  Status s = GetTabletRef(tablet_peer, &tablet, &error_code);
+  if (PREDICT_FALSE(!s.ok())) {
+    SetupErrorAndRespond(resp->mutable_error(), s, error_code, context);
+    return;
+  }
+
+  Schema projection;
+  s = ColumnPBsToSchema(req->projected_columns(), &projection);
+  if (PREDICT_TRUE(s.ok()) && projection.has_column_ids()) {
+    s = Status::InvalidArgument("User requests should not have Column IDs");
+  }
+  if (PREDICT_FALSE(!s.ok())) {
+    SetupErrorAndRespond(resp->mutable_error(), s, TabletServerErrorPB::INVALID_SCHEMA, context);
+    return;
+  }
+
+  vector<Slice> keys;
+  keys.reserve(req->encoded_primary_keys_size());
+  for (const string& key : req->encoded_primary_keys()) {
+    keys.emplace_back(key);
+  }
+
+  gscoped_ptr<faststring> rows_data(new faststring());
+  gscoped_ptr<faststring> indirect_data(new faststring());
+  RowwiseRowBlockPB data;
+  ScanResultCopier collector(&data, rows_data.get(), indirect_data.get());
+  s = tablet->LookupRows(projection, keys, [&](const RowBlock& block) {
+        collector.HandleRowBlock(&projection, block);
+      });
+  if (PREDICT_FALSE(!s.ok())) {
+    // An invalid projection returns InvalidArgument.
+    SetupErrorAndRespond(resp->mutable_error(), s,
+                         s.IsInvalidArgument() ? TabletServerErrorPB::MISMATCHED_SCHEMA :
+                                                 TabletServerErrorPB::UNKNOWN_ERROR,
+                         context);
+    return;
+  }
+  TRACE("Found $0 rows of $1", collector.NumRowsReturned(), keys.size());
+
+  if (collector.BlocksProcessed() > 0) {
+    resp->mutable_data()->CopyFrom(data);
+    int rows_idx;
+    CHECK_OK(context->AddRpcSidecar(make_gscoped_ptr(
+        new rpc::RpcSidecar(std::move(rows_data))), &rows_idx));
+    resp->mutable_data()->set_rows_sidecar(rows_idx);
+    if (indirect_data->size() > 0) {
+      int indirect_idx;
+      CHECK_OK(context->AddRpcSidecar(make_gscoped_ptr(
+          new rpc::RpcSidecar(std::move(indirect_data))), &indirect_idx));
+      resp->mutable_data()->set_indirect_data_sidecar(indirect_idx);
+    }
+  }
+  context->RespondSuccess();
+}
+
 bool TabletServiceImpl::SupportsFeature(uint32_t feature) const {
-  return feature == TabletServerFeatures::COLUMN_PREDICATES;
+  return feature == TabletServerFeatures::COLUMN_PREDICATES ||
+      feature == TabletServerFeatures::COLUMNAR_LAYOUT ||
+      feature == TabletServerFeatures::AGGREGATES ||
+      feature == TabletServerFeatures::SCAN_LIMIT ||
+      feature == TabletServerFeatures::LEADER_LEASE_READS ||
+      feature == TabletServerFeatures::COLUMNAR_INSERTS ||
+      feature == TabletServerFeatures::SPLIT_KEY_RANGE ||
+      feature == TabletServerFeatures::LOOKUP_ROWS ||
+      feature == TabletServerFeatures::BLOOM_FILTER_PREDICATES;
 }
 
 void TabletServiceImpl::Shutdown() {
@@ -1283,6 +1758,7 @@ static Status DecodeEncodedKeyRange(const NewScanRequestPB& scan_pb,
 static Status SetupScanSpec(const NewScanRequestPB& scan_pb,
                             const Schema& tablet_schema,
                             const Schema& projection,
+                            Timestamp read_timestamp,
                             vector<ColumnSchema>* missing_cols,
                             gscoped_ptr<ScanSpec>* spec,
                             const SharedScanner& scanner) {
@@ -1305,6 +1781,23 @@ static Status SetupScanSpec(const NewScanRequestPB& scan_pb,
     ret->AddPredicate(std::move(*predicate));
   }
 
+  // Rows which have expired as of 'read_timestamp' are hidden, as if by a
+  // predicate selecting the ones which haven't.
+  int ttl_col_idx;
+  int64_t expiry_cutoff_micros;
+  if (tablet::Tablet::GetRowExpiry(tablet_schema, read_timestamp, &ttl_col_idx,
+                                   &expiry_cutoff_micros)) {
+    const ColumnSchema& col = tablet_schema.column(ttl_col_idx);
+    void* cutoff = scanner->arena()->AllocateBytes(sizeof(expiry_cutoff_micros));
+    memcpy(cutoff, &expiry_cutoff_micros, sizeof(expiry_cutoff_micros));
+    if (projection.find_column(col.name()) == Schema::kColumnNotFound &&
+        !ContainsKey(missing_col_names, col.name())) {
+      InsertOrDie(&missing_col_names, col.name());
+      missing_cols->push_back(col);
+    }
+    ret->AddPredicate(ColumnPredicate::Range(col, cutoff, nullptr));
+  }
+
   // Then the column range predicates.
   // TODO: remove this once all clients have moved to ColumnPredicatePB and
   // backwards compatibility can be broken.
@@ -1409,6 +1902,37 @@ Status TabletServiceImpl::HandleNewScanRequest(TabletPeer* tablet_peer,
     return Status::InvalidArgument("User requests should not have Column IDs");
   }
 
+  s = Aggregator::Validate(projection, scan_pb.aggregates());
+  if (PREDICT_FALSE(!s.ok())) {
+    *error_code = TabletServerErrorPB::INVALID_SCAN_SPEC;
+    return s;
+  }
+  scanner->set_aggregates(scan_pb.aggregates());
+
+  if (scan_pb.has_limit()) {
+    scanner->set_limit(std::min<uint64_t>(scan_pb.limit(), kint64max));
+  }
+
+  if (scan_pb.require_leader_lease()) {
+    if (scan_pb.read_mode() != READ_LATEST) {
+      *error_code = TabletServerErrorPB::INVALID_SCAN_SPEC;
+      return Status::InvalidArgument("Only READ_LATEST scans may require a leader lease");
+    }
+    // Check the lease before the scan takes its snapshot: writes acknowledged
+    // before the check are applied on the leader, so the snapshot sees them.
+    scoped_refptr<consensus::Consensus> consensus = tablet_peer->shared_consensus();
+    if (!consensus) {
+      *error_code = TabletServerErrorPB::TABLET_NOT_RUNNING;
+      return Status::ServiceUnavailable("Consensus unavailable. Tablet not running");
+    }
+    s = consensus->CheckLeaderLease();
+    if (PREDICT_FALSE(!s.ok())) {
+      *error_code = TabletServerErrorPB::NOT_THE_LEADER;
+      return s.CloneAndPrepend("Cannot serve a scan which requires a leader lease");
+    }
+    TRACE("Leader lease held");
+  }
+
   if (scan_pb.order_mode() == ORDERED) {
     // Ordered scans must be at a snapshot so that we perform a serializable read (which can be
     // resumed). Otherwise, this would be read committed isolation, which is not resumable.
@@ -1423,8 +1947,23 @@ Status TabletServiceImpl::HandleNewScanRequest(TabletPeer* tablet_peer,
   // Missing columns will contain the columns that are not mentioned in the client
   // projection but are actually needed for the scan, such as columns referred to by
   // predicates or key columns (if this is an ORDERED scan).
+  // The timestamp the scan reads at, which also decides which rows have
+  // expired, so that repeating a snapshot scan returns the same rows.
+  Timestamp read_timestamp;
+  if (scan_pb.read_mode() == READ_AT_SNAPSHOT) {
+    s = PickSnapshotTimestamp(scan_pb, &read_timestamp);
+    if (PREDICT_FALSE(!s.ok())) {
+      *error_code = s.IsInvalidArgument() ? TabletServerErrorPB::INVALID_SNAPSHOT
+                                          : TabletServerErrorPB::UNKNOWN_ERROR;
+      return s;
+    }
+  } else {
+    read_timestamp = server_->clock()->Now();
+  }
+
   vector<ColumnSchema> missing_cols;
-  s = SetupScanSpec(scan_pb, tablet_schema, projection, &missing_cols, &spec, scanner);
+  s = SetupScanSpec(scan_pb, tablet_schema, projection, read_timestamp, &missing_cols, &spec,
+                    scanner);
   if (PREDICT_FALSE(!s.ok())) {
     *error_code = TabletServerErrorPB::INVALID_SCAN_SPEC;
     return s;
@@ -1460,6 +1999,7 @@ Status TabletServiceImpl::HandleNewScanRequest(TabletPeer* tablet_peer,
   // Preset the error code for when creating the iterator on the tablet fails
   TabletServerErrorPB::Code tmp_error_code = TabletServerErrorPB::MISMATCHED_SCHEMA;
 
+  MonoTime open_start = MonoTime::Now();
   shared_ptr<Tablet> tablet;
   RETURN_NOT_OK(GetTabletRef(tablet_peer, &tablet, error_code));
   {
@@ -1477,8 +2017,11 @@ Status TabletServiceImpl::HandleNewScanRequest(TabletPeer* tablet_peer,
         break;
       }
       case READ_AT_SNAPSHOT: {
-        s = HandleScanAtSnapshot(scan_pb, rpc_context, projection, tablet, &iter, snap_timestamp);
-        if (!s.ok()) {
+        s = HandleScanAtSnapshot(scan_pb, rpc_context, projection, tablet, &iter,
+                                 read_timestamp);
+        if (s.ok()) {
+          *snap_timestamp = read_timestamp;
+        } else {
           tmp_error_code = TabletServerErrorPB::INVALID_SNAPSHOT;
         }
       }
@@ -1492,12 +2035,29 @@ Status TabletServiceImpl::HandleNewScanRequest(TabletPeer* tablet_peer,
   // as its predicates are pushed into lower-level iterators.
   gscoped_ptr<ScanSpec> orig_spec(new ScanSpec(*spec));
 
+  // A checksum scan may leave out the rowsets whose checksums are known, as
+  // long as it has no predicate, key bound or limit to drop any of their rows.
+  // Rowsets are only skipped if the projection is made of all of their
+  // columns, in order; see DiskRowSet::AddStoredChecksum().
+  StoredChecksums* stored_checksums = result_collector->stored_checksums();
+  if (PREDICT_TRUE(s.ok()) && stored_checksums != nullptr &&
+      FLAGS_checksum_use_stored_rowset_checksums &&
+      spec->predicates().empty() && spec->lower_bound_key() == nullptr &&
+      spec->exclusive_upper_bound_key() == nullptr &&
+      !scanner->has_limit() && scan_pb.aggregates_size() == 0) {
+    static_cast<Tablet::Iterator*>(iter.get())->SkipRowSetsWithStoredChecksums(
+        stored_checksums);
+  }
+
   if (PREDICT_TRUE(s.ok())) {
     TRACE_EVENT0("tserver", "iter->Init");
     s = iter->Init(spec.get());
   }
 
   TRACE("Iterator init: $0", s.ToString());
+  int64_t open_us = (MonoTime::Now() - open_start).ToMicroseconds();
+  TRACE_COUNTER_INCREMENT(kScanOpenTimeTraceCounter, open_us);
+  BINARY_TRACE_ELAPSED(debug::kBinaryTraceScan, "scan_open", open_us, 0);
 
   if (PREDICT_FALSE(s.IsInvalidArgument())) {
     // An invalid projection returns InvalidArgument above.
@@ -1542,7 +2102,8 @@ Status TabletServiceImpl::HandleNewScanRequest(TabletPeer* tablet_peer,
                                    "--tablet_history_max_age_sec");
   }
 
-  *has_more_results = iter->HasNext();
+  *has_more_results = iter->HasNext() &&
+      (!scanner->has_limit() || scanner->num_rows_remaining() > 0);
   TRACE("has_more: $0", *has_more_results);
   if (!*has_more_results) {
     // If there are no more rows, we can short circuit some work and respond immediately.
@@ -1563,8 +2124,17 @@ Status TabletServiceImpl::HandleNewScanRequest(TabletPeer* tablet_peer,
     // and call the second half directly
     ScanRequestPB continue_req(*req);
     continue_req.set_scanner_id(scanner->id());
-    RETURN_NOT_OK(HandleContinueScanRequest(&continue_req, result_collector, has_more_results,
-                                            error_code));
+    Status s = HandleContinueScanRequest(&continue_req, result_collector, has_more_results,
+                                         error_code);
+    if (s.IsServiceUnavailable()) {
+      // There's no memory for a first batch: return the scanner without any
+      // rows, and let the client's next request wait for memory instead.
+      TRACE("Deferring the first batch: $0", s.ToString());
+      scanner->IncrementCallSeqId();
+      *has_more_results = true;
+      return Status::OK();
+    }
+    RETURN_NOT_OK(s);
   } else {
     // Increment the scanner call sequence ID. HandleContinueScanRequest handles
     // this in the non-empty scan case.
@@ -1581,6 +2151,7 @@ Status TabletServiceImpl::HandleContinueScanRequest(const ScanRequestPB* req,
   DCHECK(req->has_scanner_id());
   TRACE_EVENT1("tserver", "TabletServiceImpl::HandleContinueScanRequest",
                "scanner_id", req->scanner_id());
+  BINARY_TRACE_SCOPE(debug::kBinaryTraceScan, "scan_continue");
 
   size_t batch_size_bytes = GetMaxBatchSizeBytesHint(req);
 
@@ -1598,6 +2169,25 @@ Status TabletServiceImpl::HandleContinueScanRequest(const ScanRequestPB* req,
     }
   }
 
+  // Reserve the memory of the batch from the server-wide scan budget, which
+  // may shrink it. If not even a small batch fits, the client is asked to
+  // retry later; this happens before the scanner is touched so that it may
+  // retry the same request.
+  const shared_ptr<MemTracker>& mem_tracker = server_->scanner_manager()->mem_tracker();
+  int64_t reserved_bytes = 0;
+  if (batch_size_bytes > 0) {
+    reserved_bytes = ReserveScanBatchMemory(mem_tracker.get(), batch_size_bytes);
+    if (reserved_bytes == 0) {
+      scanner->UpdateAccessTime();
+      *error_code = TabletServerErrorPB::UNKNOWN_ERROR;
+      return Status::ServiceUnavailable("Scan memory limit reached");
+    }
+    batch_size_bytes = reserved_bytes;
+  }
+  auto release_batch_memory = MakeScopedCleanup([&]() {
+    mem_tracker->Release(reserved_bytes);
+  });
+
   // If we early-exit out of this function, automatically unregister the scanner.
   ScopedUnregisterScanner unreg_scanner(server_->scanner_manager(), scanner->id());
 
@@ -1619,44 +2209,83 @@ Status TabletServiceImpl::HandleContinueScanRequest(const ScanRequestPB* req,
 
   RowwiseIterator* iter = scanner->iter();
 
-  // TODO: could size the RowBlock based on the user's requested batch size?
-  // If people had really large indirect objects, we would currently overshoot
-  // their requested batch size by a lot.
+  // Size the blocks of rows from the observed size of the results of a row,
+  // so that wide rows don't overshoot the batch size by much.
+  auto rows_for_bytes = [&](int64_t bytes) {
+    size_t max_rows = std::max(FLAGS_scanner_batch_size_rows, 1);
+    if (scanner->bytes_per_row() <= 0) {
+      return max_rows;
+    }
+    return std::max<size_t>(std::min<double>(max_rows, bytes / scanner->bytes_per_row()), 1);
+  };
   Arena arena(32 * 1024, 1 * 1024 * 1024);
-  RowBlock block(scanner->iter()->schema(),
-                 FLAGS_scanner_batch_size_rows, &arena);
+  gscoped_ptr<RowBlock> block(new RowBlock(iter->schema(), rows_for_bytes(batch_size_bytes),
+                                           &arena));
 
   // TODO: in the future, use the client timeout to set a budget. For now,
   // just use a half second, which should be plenty to amortize call overhead.
   int budget_ms = 500;
   MonoTime deadline = MonoTime::Now() + MonoDelta::FromMilliseconds(budget_ms);
 
+  // The CPU time and CFile reads of the scan are charged to its tablet. The
+  // CFile reads are counted in the RPC's trace by the CFile readers.
+  int64_t cpu_start_us = GetThreadCpuTimeMicros();
+  TraceMetrics* trace_metrics = Trace::CurrentTrace() ? Trace::CurrentTrace()->metrics() : nullptr;
+  int64_t cache_hit_bytes_start = 0;
+  int64_t cache_miss_bytes_start = 0;
+  if (trace_metrics) {
+    cache_hit_bytes_start = trace_metrics->GetMetric(cfile::CFILE_CACHE_HIT_BYTES_METRIC_NAME);
+    cache_miss_bytes_start = trace_metrics->GetMetric(cfile::CFILE_CACHE_MISS_BYTES_METRIC_NAME);
+  }
+
   int64_t rows_scanned = 0;
-  while (iter->HasNext()) {
+  int64_t iterate_ns = 0;
+  int64_t collect_ns = 0;
+  bool reached_limit = scanner->has_limit() && scanner->num_rows_remaining() == 0;
+  while (!reached_limit && iter->HasNext()) {
     if (PREDICT_FALSE(FLAGS_scanner_inject_latency_on_each_batch_ms > 0)) {
       SleepFor(MonoDelta::FromMilliseconds(FLAGS_scanner_inject_latency_on_each_batch_ms));
     }
 
-    Status s = iter->NextBlock(&block);
+    MonoTime iterate_start = MonoTime::Now();
+    Status s = iter->NextBlock(block.get());
+    MonoTime iterate_end = MonoTime::Now();
+    iterate_ns += (iterate_end - iterate_start).ToNanoseconds();
+    BINARY_TRACE_ELAPSED(debug::kBinaryTraceScan, "scan_next_block",
+                         (iterate_end - iterate_start).ToMicroseconds(), block->nrows());
     if (PREDICT_FALSE(!s.ok())) {
       LOG(WARNING) << "Copying rows from internal iterator for request " << req->ShortDebugString();
       *error_code = TabletServerErrorPB::UNKNOWN_ERROR;
       return s;
     }
 
-    if (PREDICT_TRUE(block.nrows() > 0)) {
+    if (PREDICT_TRUE(block->nrows() > 0)) {
       // Count the number of rows scanned, regardless of predicates or deletions.
       // The collector will separately count the number of rows actually returned to
       // the client.
-      rows_scanned += block.nrows();
-      result_collector->HandleRowBlock(scanner->client_projection_schema(), block);
+      rows_scanned += block->nrows();
+      if (scanner->has_limit()) {
+        // Drop the rows past the limit before they reach the collector.
+        SelectionVector* sel = block->selection_vector();
+        sel->ClearToSelectAtMost(scanner->num_rows_remaining());
+        scanner->add_num_rows_returned(sel->CountSelected());
+        reached_limit = scanner->num_rows_remaining() == 0;
+      }
+      result_collector->HandleRowBlock(scanner->client_projection_schema(), *block);
+      MonoDelta collect_time = MonoTime::Now() - iterate_end;
+      collect_ns += collect_time.ToNanoseconds();
+      BINARY_TRACE_ELAPSED(debug::kBinaryTraceScan, "scan_collect",
+                           collect_time.ToMicroseconds(), block->nrows());
     }
 
     int64_t response_size = result_collector->ResponseSize();
+    if (rows_scanned > 0) {
+      scanner->set_bytes_per_row(static_cast<double>(response_size) / rows_scanned);
+    }
 
     if (VLOG_IS_ON(2)) {
       // This may be fairly expensive if row block size is small
-      TRACE("Copied block (nrows=$0), new size=$1", block.nrows(), response_size);
+      TRACE("Copied block (nrows=$0), new size=$1", block->nrows(), response_size);
     }
 
     // TODO: should check if RPC got cancelled, once we implement RPC cancellation.
@@ -1668,6 +2297,12 @@ Status TabletServiceImpl::HandleContinueScanRequest(const ScanRequestPB* req,
     if (response_size >= batch_size_bytes) {
       break;
     }
+
+    // Shrink the block if the rest of the batch needs a lot fewer rows.
+    size_t rows = rows_for_bytes(batch_size_bytes - response_size);
+    if (rows < block->row_capacity() / 2) {
+      block.reset(new RowBlock(iter->schema(), rows, &arena));
+    }
   }
 
   // Update metrics based on this scan request.
@@ -1703,8 +2338,31 @@ Status TabletServiceImpl::HandleContinueScanRequest(const ScanRequestPB* req,
   tablet->metrics()->scanner_bytes_scanned_from_disk->IncrementBy(
       delta_stats.bytes_read_from_disk);
 
+  // The same numbers make up the profile of the request.
+  TRACE_COUNTER_INCREMENT(kScanIterateTimeTraceCounter, iterate_ns / 1000);
+  TRACE_COUNTER_INCREMENT(kScanCollectTimeTraceCounter, collect_ns / 1000);
+  TRACE_COUNTER_INCREMENT(kScanRowsScannedTraceCounter, rows_scanned);
+  BINARY_TRACE_SET_ARG(rows_scanned);
+  TRACE_COUNTER_INCREMENT(kScanRowsReturnedTraceCounter, result_collector->NumRowsReturned());
+  TRACE_COUNTER_INCREMENT(kScanBlocksReadTraceCounter, delta_stats.data_blocks_read_from_disk);
+  TRACE_COUNTER_INCREMENT(kScanCellsReadTraceCounter, delta_stats.cells_read_from_disk);
+  TRACE_COUNTER_INCREMENT(kScanBytesReadTraceCounter, delta_stats.bytes_read_from_disk);
+  TRACE_COUNTER_INCREMENT(kScanCellsSkippedTraceCounter, delta_stats.cells_skipped);
+
+  // Finally, the resources the scan request used.
+  tablet->metrics()->scanner_cpu_time_us->IncrementBy(
+      GetThreadCpuTimeMicros() - cpu_start_us);
+  if (trace_metrics) {
+    tablet->metrics()->scanner_cfile_cache_hit_bytes->IncrementBy(
+        trace_metrics->GetMetric(cfile::CFILE_CACHE_HIT_BYTES_METRIC_NAME) -
+        cache_hit_bytes_start);
+    tablet->metrics()->scanner_cfile_cache_miss_bytes->IncrementBy(
+        trace_metrics->GetMetric(cfile::CFILE_CACHE_MISS_BYTES_METRIC_NAME) -
+        cache_miss_bytes_start);
+  }
+
   scanner->UpdateAccessTime();
-  *has_more_results = !req->close_scanner() && iter->HasNext();
+  *has_more_results = !req->close_scanner() && !reached_limit && iter->HasNext();
   if (*has_more_results) {
     unreg_scanner.Cancel();
   } else {
@@ -1714,16 +2372,8 @@ Status TabletServiceImpl::HandleContinueScanRequest(const ScanRequestPB* req,
   return Status::OK();
 }
 
-Status TabletServiceImpl::HandleScanAtSnapshot(const NewScanRequestPB& scan_pb,
-                                               const RpcContext* rpc_context,
-                                               const Schema& projection,
-                                               const shared_ptr<Tablet>& tablet,
-                                               gscoped_ptr<RowwiseIterator>* iter,
-                                               Timestamp* snap_timestamp) {
-
-  // TODO check against the earliest boundary (i.e. how early can we go) right
-  // now we're keeping all undos/redos forever!
-
+Status TabletServiceImpl::PickSnapshotTimestamp(const NewScanRequestPB& scan_pb,
+                                                Timestamp* snap_timestamp) {
   // If the client sent a timestamp update our clock with it.
   if (scan_pb.has_propagated_timestamp()) {
     Timestamp propagated_timestamp(scan_pb.propagated_timestamp());
@@ -1758,6 +2408,19 @@ Status TabletServiceImpl::HandleScanAtSnapshot(const NewScanRequestPB& scan_pb,
                      server_->clock()->Stringify(max_allowed_ts)));
     }
   }
+  *snap_timestamp = tmp_snap_timestamp;
+  return Status::OK();
+}
+
+Status TabletServiceImpl::HandleScanAtSnapshot(const NewScanRequestPB& scan_pb,
+                                               const RpcContext* rpc_context,
+                                               const Schema& projection,
+                                               const shared_ptr<Tablet>& tablet,
+                                               gscoped_ptr<RowwiseIterator>* iter,
+                                               Timestamp snap_timestamp) {
+
+  // TODO check against the earliest boundary (i.e. how early can we go) right
+  // now we're keeping all undos/redos forever!
 
   tablet::MvccSnapshot snap;
 
@@ -1783,7 +2446,7 @@ Status TabletServiceImpl::HandleScanAtSnapshot(const NewScanRequestPB& scan_pb,
   MonoTime before = MonoTime::Now();
   RETURN_NOT_OK_PREPEND(
       tablet->mvcc_manager()->WaitForCleanSnapshotAtTimestamp(
-          tmp_snap_timestamp, &snap, deadline),
+          snap_timestamp, &snap, deadline),
       "could not wait for desired snapshot timestamp to be consistent");
 
   uint64_t duration_usec = (MonoTime::Now() - before).ToMicroseconds();
@@ -1797,7 +2460,6 @@ Status TabletServiceImpl::HandleScanAtSnapshot(const NewScanRequestPB& scan_pb,
     default: LOG(FATAL) << "Unexpected order mode.";
   }
   RETURN_NOT_OK(tablet->NewRowIterator(projection, snap, order, iter));
-  *snap_timestamp = tmp_snap_timestamp;
   return Status::OK();
 }
 
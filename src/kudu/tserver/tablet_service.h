@@ -71,6 +71,14 @@ class TabletServiceImpl : public TabletServerServiceIf {
                         ChecksumResponsePB* resp,
                         rpc::RpcContext* context) OVERRIDE;
 
+  virtual void SplitKeyRange(const SplitKeyRangeRequestPB* req,
+                             SplitKeyRangeResponsePB* resp,
+                             rpc::RpcContext* context) OVERRIDE;
+
+  virtual void LookupRows(const LookupRowsRequestPB* req,
+                          LookupRowsResponsePB* resp,
+                          rpc::RpcContext* context) OVERRIDE;
+
   bool SupportsFeature(uint32_t feature) const override;
 
   virtual void Shutdown() OVERRIDE;
@@ -90,12 +98,17 @@ class TabletServiceImpl : public TabletServerServiceIf {
                                    bool* has_more_results,
                                    TabletServerErrorPB::Code* error_code);
 
+  // Sets 'snap_timestamp' to the timestamp the snapshot scan 'scan_pb'
+  // should read at: the one the client asked for, or now if it didn't ask.
+  Status PickSnapshotTimestamp(const NewScanRequestPB& scan_pb,
+                               Timestamp* snap_timestamp);
+
   Status HandleScanAtSnapshot(const NewScanRequestPB& scan_pb,
                               const rpc::RpcContext* rpc_context,
                               const Schema& projection,
                               const std::shared_ptr<tablet::Tablet>& tablet,
                               gscoped_ptr<RowwiseIterator>* iter,
-                              Timestamp* snap_timestamp);
+                              Timestamp snap_timestamp);
 
   TabletServer* server_;
 };
@@ -107,6 +120,10 @@ class TabletServiceAdminImpl : public TabletServerAdminServiceIf {
                             CreateTabletResponsePB* resp,
                             rpc::RpcContext* context) OVERRIDE;
 
+  virtual void CreateTablets(const CreateTabletsRequestPB* req,
+                             CreateTabletsResponsePB* resp,
+                             rpc::RpcContext* context) OVERRIDE;
+
   virtual void DeleteTablet(const DeleteTabletRequestPB* req,
                             DeleteTabletResponsePB* resp,
                             rpc::RpcContext* context) OVERRIDE;
@@ -115,6 +132,10 @@ class TabletServiceAdminImpl : public TabletServerAdminServiceIf {
                            AlterSchemaResponsePB* resp,
                            rpc::RpcContext* context) OVERRIDE;
 
+  virtual void SplitTablet(const SplitTabletRequestPB* req,
+                           SplitTabletResponsePB* resp,
+                           rpc::RpcContext* context) OVERRIDE;
+
  private:
   TabletServer* server_;
 };
@@ -131,6 +152,10 @@ class ConsensusServiceImpl : public consensus::ConsensusServiceIf {
                                consensus::ConsensusResponsePB *resp,
                                rpc::RpcContext *context) OVERRIDE;
 
+  virtual void MultiRaftUpdateConsensus(const consensus::MultiRaftConsensusRequestPB* req,
+                                        consensus::MultiRaftConsensusResponsePB* resp,
+                                        rpc::RpcContext* context) OVERRIDE;
+
   virtual void RequestConsensusVote(const consensus::VoteRequestPB* req,
                                     consensus::VoteResponsePB* resp,
                                     rpc::RpcContext* context) OVERRIDE;
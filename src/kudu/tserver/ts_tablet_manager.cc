@@ -24,12 +24,14 @@
 #include <memory>
 #include <mutex>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "kudu/common/wire_protocol.h"
 #include "kudu/consensus/consensus_meta.h"
 #include "kudu/consensus/log.h"
 #include "kudu/consensus/metadata.pb.h"
+#include "kudu/consensus/multi_raft_batcher.h"
 #include "kudu/consensus/opid_util.h"
 #include "kudu/consensus/quorum_util.h"
 #include "kudu/fs/fs_manager.h"
@@ -44,6 +46,7 @@
 #include "kudu/tablet/tablet.pb.h"
 #include "kudu/tablet/tablet_bootstrap.h"
 #include "kudu/tablet/tablet_metadata.h"
+#include "kudu/tablet/tablet_metrics.h"
 #include "kudu/tablet/tablet_peer.h"
 #include "kudu/tserver/heartbeater.h"
 #include "kudu/tserver/tablet_copy_client.h"
@@ -67,11 +70,23 @@ DEFINE_int32(num_tablets_to_open_simultaneously, 0,
              "may make sense to manually tune this.");
 TAG_FLAG(num_tablets_to_open_simultaneously, advanced);
 
+DEFINE_int32(num_tablets_to_create_simultaneously, 8,
+             "Number of threads available to create the tablets of a single "
+             "CreateTablets request from the master. The fsyncs of the metadata "
+             "of tablets created at the same time share filesystem journal commits.");
+TAG_FLAG(num_tablets_to_create_simultaneously, advanced);
+
 DEFINE_int32(tablet_start_warn_threshold_ms, 500,
              "If a tablet takes more than this number of millis to start, issue "
              "a warning with a trace.");
 TAG_FLAG(tablet_start_warn_threshold_ms, hidden);
 
+DEFINE_bool(enable_multi_raft_heartbeat_batching, false,
+            "Whether the heartbeats which tablet leaders send to followers on the "
+            "same server are batched into a single RPC. All tablet servers must "
+            "support the MultiRaftUpdateConsensus RPC before this is enabled.");
+TAG_FLAG(enable_multi_raft_heartbeat_batching, experimental);
+
 DEFINE_double(fault_crash_after_blocks_deleted, 0.0,
               "Fraction of the time when the tablet will crash immediately "
               "after deleting the data blocks during tablet deletion. "
@@ -105,24 +120,25 @@ METRIC_DEFINE_histogram(server, op_apply_queue_length, "Operation Apply Queue Le
                         "Number of operations waiting to be applied to the tablet. "
                         "High queue lengths indicate that the server is unable to process "
                         "operations as fast as they are being written to the WAL.",
-                        10000, 2);
+                        10000, 2, STRIPED_HISTOGRAM);
 
 METRIC_DEFINE_histogram(server, op_apply_queue_time, "Operation Apply Queue Time",
                         MetricUnit::kMicroseconds,
                         "Time that operations spent waiting in the apply queue before being "
                         "processed. High queue times indicate that the server is unable to "
                         "process operations as fast as they are being written to the WAL.",
-                        10000000, 2);
+                        10000000, 2, STRIPED_HISTOGRAM);
 
 METRIC_DEFINE_histogram(server, op_apply_run_time, "Operation Apply Run Time",
                         MetricUnit::kMicroseconds,
                         "Time that operations spent being applied to the tablet. "
                         "High values may indicate that the server is under-provisioned or "
                         "that operations consist of very large batches.",
-                        10000000, 2);
+                        10000000, 2, STRIPED_HISTOGRAM);
 
 using consensus::ConsensusMetadata;
 using consensus::ConsensusStatePB;
+using consensus::MultiRaftHeartbeatBatcher;
 using consensus::OpId;
 using consensus::RaftConfigPB;
 using consensus::RaftPeerPB;
@@ -148,6 +164,23 @@ using tablet::TabletStatusListener;
 using tablet::TabletStatusPB;
 using tserver::TabletCopyClient;
 
+namespace {
+
+// A tablet to open on startup, along with what's known of the cost of its
+// bootstrap and of how soon it can serve once open.
+struct TabletToOpen {
+  scoped_refptr<TabletMetadata> meta;
+
+  // 0 if this replica is the only voter of the tablet, so that it can lead
+  // as soon as it's open; 1 if it's one of several voters; 2 otherwise.
+  int role_rank;
+
+  // The size of the tablet's WAL, most of which is replayed by the bootstrap.
+  uint64_t wal_bytes;
+};
+
+} // anonymous namespace
+
 TSTabletManager::TSTabletManager(FsManager* fs_manager,
                                  TabletServer* server,
                                  MetricRegistry* metric_registry)
@@ -156,7 +189,9 @@ TSTabletManager::TSTabletManager(FsManager* fs_manager,
     metric_registry_(metric_registry),
     state_(MANAGER_INITIALIZING) {
 
+  CHECK_OK(ThreadPoolBuilder("prepare").Build(&prepare_pool_));
   CHECK_OK(ThreadPoolBuilder("apply").Build(&apply_pool_));
+  CHECK_OK(ThreadPoolBuilder("raft").Build(&raft_pool_));
   apply_pool_->SetQueueLengthHistogram(
       METRIC_op_apply_queue_length.Instantiate(server_->metric_entity()));
   apply_pool_->SetQueueTimeMicrosHistogram(
@@ -182,6 +217,13 @@ Status TSTabletManager::Init() {
   RETURN_NOT_OK(ThreadPoolBuilder("tablet-bootstrap")
                 .set_max_threads(max_bootstrap_threads)
                 .Build(&open_tablet_pool_));
+  RETURN_NOT_OK(ThreadPoolBuilder("tablet-create")
+                .set_max_threads(std::max(FLAGS_num_tablets_to_create_simultaneously, 1))
+                .Build(&create_tablet_pool_));
+
+  if (FLAGS_enable_multi_raft_heartbeat_batching) {
+    heartbeat_batcher_.reset(new MultiRaftHeartbeatBatcher(server_->messenger()));
+  }
 
   // Search for tablets in the metadata dir.
   vector<string> tablet_ids;
@@ -189,7 +231,7 @@ Status TSTabletManager::Init() {
 
   InitLocalRaftPeerPB();
 
-  vector<scoped_refptr<TabletMetadata> > metas;
+  vector<TabletToOpen> to_open;
 
   // First, load all of the tablet metadata. We do this before we start
   // submitting the actual OpenTablet() tasks so that we don't have to compete
@@ -202,14 +244,41 @@ Status TSTabletManager::Init() {
       RETURN_NOT_OK(HandleNonReadyTabletOnStartup(meta));
       continue;
     }
-    metas.push_back(meta);
+
+    TabletToOpen t = { meta, 2, 0 };
+    unique_ptr<ConsensusMetadata> cmeta;
+    if (ConsensusMetadata::Load(fs_manager_, tablet_id, fs_manager_->uuid(), &cmeta).ok()) {
+      const RaftConfigPB& config = cmeta->committed_config();
+      if (IsRaftConfigVoter(fs_manager_->uuid(), config)) {
+        t.role_rank = consensus::CountVoters(config) == 1 ? 0 : 1;
+      }
+    }
+    Status s = fs_manager_->env()->GetFileSizeOnDiskRecursively(
+        fs_manager_->GetTabletWalDir(tablet_id), &t.wal_bytes);
+    if (!s.ok()) {
+      LOG(WARNING) << LogPrefix(tablet_id) << "Unable to get the size of the WAL: "
+                   << s.ToString();
+    }
+    to_open.push_back(std::move(t));
   }
 
+  // The pool opens tablets in the order they're submitted: open the tablets
+  // which can serve soonest first, and the quickest to bootstrap of those,
+  // so that as many tablets as possible serve early on after a restart.
+  std::stable_sort(to_open.begin(), to_open.end(),
+                   [](const TabletToOpen& a, const TabletToOpen& b) {
+                     return std::make_pair(a.role_rank, a.wal_bytes) <
+                         std::make_pair(b.role_rank, b.wal_bytes);
+                   });
+
   // Now submit the "Open" task for each.
-  for (const scoped_refptr<TabletMetadata>& meta : metas) {
+  for (const TabletToOpen& t : to_open) {
+    const scoped_refptr<TabletMetadata>& meta = t.meta;
+    VLOG(1) << LogPrefix(meta->tablet_id()) << "Queueing the tablet to be opened ("
+            << t.wal_bytes << " WAL bytes)";
     scoped_refptr<TransitionInProgressDeleter> deleter;
     {
-      std::lock_guard<rw_spinlock> lock(lock_);
+      std::lock_guard<percpu_rwlock> lock(lock_);
       CHECK_OK(StartTabletStateTransitionUnlocked(meta->tablet_id(), "opening tablet", &deleter));
     }
 
@@ -219,7 +288,7 @@ Status TSTabletManager::Init() {
   }
 
   {
-    std::lock_guard<rw_spinlock> lock(lock_);
+    std::lock_guard<percpu_rwlock> lock(lock_);
     state_ = MANAGER_RUNNING;
   }
 
@@ -233,7 +302,7 @@ Status TSTabletManager::WaitForAllBootstrapsToFinish() {
 
   Status s = Status::OK();
 
-  shared_lock<rw_spinlock> l(lock_);
+  shared_lock<rw_spinlock> l(lock_.get_lock());
   for (const TabletMap::value_type& entry : tablet_map_) {
     if (entry.second->state() == tablet::FAILED) {
       if (s.ok()) {
@@ -263,7 +332,7 @@ Status TSTabletManager::CreateNewTablet(const string& table_id,
   {
     // acquire the lock in exclusive mode as we'll add a entry to the
     // transition_in_progress_ set if the lookup fails.
-    std::lock_guard<rw_spinlock> lock(lock_);
+    std::lock_guard<percpu_rwlock> lock(lock_);
     TRACE("Acquired tablet manager lock");
 
     // Sanity check that the tablet isn't already registered.
@@ -309,6 +378,216 @@ Status TSTabletManager::CreateNewTablet(const string& table_id,
   return Status::OK();
 }
 
+Status TSTabletManager::CreateNewTabletFromPB(const CreateTabletRequestPB& req,
+                                              TabletServerErrorPB::Code* error_code) {
+  Schema schema;
+  Status s = SchemaFromPB(req.schema(), &schema);
+  DCHECK(schema.has_column_ids());
+  if (!s.ok()) {
+    *error_code = TabletServerErrorPB::INVALID_SCHEMA;
+    return Status::InvalidArgument("Invalid Schema.");
+  }
+
+  PartitionSchema partition_schema;
+  s = PartitionSchema::FromPB(req.partition_schema(), schema, &partition_schema);
+  if (!s.ok()) {
+    *error_code = TabletServerErrorPB::INVALID_SCHEMA;
+    return Status::InvalidArgument("Invalid PartitionSchema.");
+  }
+
+  Partition partition;
+  Partition::FromPB(req.partition(), &partition);
+
+  LOG(INFO) << "Processing CreateTablet for tablet " << req.tablet_id()
+            << " (table=" << req.table_name()
+            << " [id=" << req.table_id() << "]), partition="
+            << partition_schema.PartitionDebugString(partition, schema);
+  VLOG(1) << "Full request: " << req.DebugString();
+
+  s = CreateNewTablet(req.table_id(), req.tablet_id(), partition, req.table_name(),
+                      schema, partition_schema, req.config(), nullptr);
+  if (PREDICT_FALSE(!s.ok())) {
+    *error_code = s.IsAlreadyPresent() ? TabletServerErrorPB::TABLET_ALREADY_EXISTS
+                                       : TabletServerErrorPB::UNKNOWN_ERROR;
+  }
+  return s;
+}
+
+void TSTabletManager::CreateNewTablets(const CreateTabletsRequestPB& req,
+                                       CreateTabletsResponsePB* resp) {
+  TRACE("Creating $0 tablets", req.tablets_size());
+  // Each task only touches its own elements. Those of the tasks dropped
+  // because the pool was shut down keep their initial error.
+  vector<Status> statuses(req.tablets_size(),
+                          Status::ServiceUnavailable("Tablet server is shutting down"));
+  vector<TabletServerErrorPB::Code> codes(req.tablets_size(),
+                                          TabletServerErrorPB::TABLET_NOT_RUNNING);
+  auto create = [&](int i) {
+    statuses[i] = CreateNewTabletFromPB(req.tablets(i), &codes[i]);
+  };
+  unique_ptr<ThreadPoolToken> token = create_tablet_pool_->NewToken(
+      ThreadPool::ExecutionMode::CONCURRENT);
+  for (int i = 0; i < req.tablets_size(); i++) {
+    if (!token->SubmitFunc(boost::bind<void>(create, i)).ok()) {
+      break;
+    }
+  }
+  token->Wait();
+
+  for (int i = 0; i < req.tablets_size(); i++) {
+    CreateTabletResponsePB* tablet_resp = resp->add_tablets();
+    if (!statuses[i].ok()) {
+      StatusToPB(statuses[i], tablet_resp->mutable_error()->mutable_status());
+      tablet_resp->mutable_error()->set_code(codes[i]);
+    }
+  }
+}
+
+Status TSTabletManager::SplitTablet(const string& tablet_id,
+                                    string* left_tablet_id,
+                                    string* right_tablet_id,
+                                    Partition* left_partition,
+                                    Partition* right_partition,
+                                    boost::optional<TabletServerErrorPB::Code>* error_code) {
+  TRACE("Splitting tablet $0", tablet_id);
+  scoped_refptr<TabletPeer> tablet_peer;
+  scoped_refptr<TransitionInProgressDeleter> deleter;
+  {
+    std::lock_guard<percpu_rwlock> lock(lock_);
+    RETURN_NOT_OK(CheckRunningUnlocked(error_code));
+    if (!LookupTabletUnlocked(tablet_id, &tablet_peer)) {
+      *error_code = TabletServerErrorPB::TABLET_NOT_FOUND;
+      return Status::NotFound("Tablet not found", tablet_id);
+    }
+    Status s = StartTabletStateTransitionUnlocked(tablet_id, "splitting tablet", &deleter);
+    if (PREDICT_FALSE(!s.ok())) {
+      *error_code = TabletServerErrorPB::TABLET_NOT_RUNNING;
+      return s;
+    }
+  }
+
+  shared_ptr<Tablet> tablet = tablet_peer->shared_tablet();
+  scoped_refptr<consensus::Consensus> consensus = tablet_peer->shared_consensus();
+  if (!tablet || !consensus || tablet_peer->state() != tablet::RUNNING) {
+    *error_code = TabletServerErrorPB::TABLET_NOT_RUNNING;
+    return Status::IllegalState("Tablet not running", tablet_id);
+  }
+  if (consensus->role() != RaftPeerPB::LEADER) {
+    *error_code = TabletServerErrorPB::NOT_THE_LEADER;
+    return Status::IllegalState("Replica is not the leader of the tablet", tablet_id);
+  }
+
+  // The new tablets start out with just the local replica, which elects
+  // itself leader right away. The master then adds the other replicas,
+  // which are copied from it.
+  RaftConfigPB config;
+  for (const RaftPeerPB& peer : consensus->CommittedConfig().peers()) {
+    if (peer.permanent_uuid() == fs_manager_->uuid()) {
+      *config.add_peers() = peer;
+    }
+  }
+  CHECK_EQ(1, config.peers_size()) << "Leader not in its own config";
+
+  string split_partition_key;
+  vector<string> child_ids;
+  if (tablet_peer->tablet_metadata()->GetSplit(&split_partition_key, &child_ids)) {
+    CHECK_EQ(2, child_ids.size());
+    LOG(INFO) << LogPrefix(tablet_id) << "Already split into " << child_ids[0]
+              << " and " << child_ids[1];
+    *left_tablet_id = child_ids[0];
+    *right_tablet_id = child_ids[1];
+  }
+
+  // Compactions of the tablet must not change its rowsets while the new
+  // tablets take them over. They stay off once the tablet is split.
+  tablet->UnregisterMaintenanceOps();
+  vector<tablet::RowSetDataPB> left_rowsets;
+  vector<tablet::RowSetDataPB> right_rowsets;
+  Status s = tablet->Split(*left_tablet_id, *right_tablet_id, &split_partition_key,
+                           &left_rowsets, &right_rowsets);
+  if (!s.ok()) {
+    if (!tablet_peer->tablet_metadata()->has_been_split()) {
+      tablet->RegisterMaintenanceOps(server_->maintenance_manager());
+    }
+    *error_code = TabletServerErrorPB::UNKNOWN_ERROR;
+    return s.CloneAndPrepend("Unable to split tablet");
+  }
+
+  PartitionPB left_pb;
+  tablet_peer->tablet_metadata()->partition().ToPB(&left_pb);
+  PartitionPB right_pb = left_pb;
+  left_pb.set_partition_key_end(split_partition_key);
+  right_pb.set_partition_key_start(split_partition_key);
+  Partition::FromPB(left_pb, left_partition);
+  Partition::FromPB(right_pb, right_partition);
+
+  const scoped_refptr<TabletMetadata>& parent = tablet_peer->tablet_metadata();
+  s = CreateSplitTablet(parent, *left_tablet_id, *left_partition, left_rowsets, config);
+  if (s.ok()) {
+    s = CreateSplitTablet(parent, *right_tablet_id, *right_partition, right_rowsets, config);
+  }
+  if (!s.ok()) {
+    *error_code = TabletServerErrorPB::UNKNOWN_ERROR;
+    return s.CloneAndPrepend("Unable to create the tablets of the split");
+  }
+  return Status::OK();
+}
+
+Status TSTabletManager::CreateSplitTablet(const scoped_refptr<TabletMetadata>& parent,
+                                          const string& tablet_id,
+                                          const Partition& partition,
+                                          const vector<tablet::RowSetDataPB>& rowsets,
+                                          const RaftConfigPB& config) {
+  scoped_refptr<TransitionInProgressDeleter> deleter;
+  {
+    std::lock_guard<percpu_rwlock> lock(lock_);
+    scoped_refptr<TabletPeer> junk;
+    if (LookupTabletUnlocked(tablet_id, &junk)) {
+      // This is a retry, and the tablet was already created.
+      return Status::OK();
+    }
+    RETURN_NOT_OK(StartTabletStateTransitionUnlocked(tablet_id, "creating split tablet",
+                                                     &deleter));
+  }
+
+  scoped_refptr<TabletMetadata> meta;
+  RETURN_NOT_OK_PREPEND(
+    TabletMetadata::CreateNew(fs_manager_,
+                              tablet_id,
+                              parent->table_name(),
+                              parent->table_id(),
+                              parent->schema(),
+                              parent->partition_schema(),
+                              partition,
+                              TABLET_DATA_READY,
+                              &meta),
+    "Couldn't create tablet metadata");
+
+  // Hand the rowsets over, along with the MemRowSet IDs they were flushed
+  // from and the schema version they were written with.
+  tablet::TabletSuperBlockPB superblock;
+  RETURN_NOT_OK(meta->ToSuperBlock(&superblock));
+  for (const tablet::RowSetDataPB& rowset : rowsets) {
+    *superblock.add_rowsets() = rowset;
+  }
+  superblock.set_last_durable_mrs_id(parent->last_durable_mrs_id());
+  superblock.set_schema_version(parent->schema_version());
+  RETURN_NOT_OK_PREPEND(meta->ReplaceSuperBlock(superblock),
+                        "Couldn't hand the rowsets over to tablet " + tablet_id);
+
+  RaftConfigPB new_config = config;
+  new_config.set_opid_index(consensus::kInvalidOpIdIndex);
+  unique_ptr<ConsensusMetadata> cmeta;
+  RETURN_NOT_OK_PREPEND(ConsensusMetadata::Create(fs_manager_, tablet_id, fs_manager_->uuid(),
+                                                  new_config, consensus::kMinimumTerm, &cmeta),
+                        "Unable to create new ConsensusMeta for tablet " + tablet_id);
+  CreateAndRegisterTabletPeer(meta, NEW_PEER);
+  LOG(INFO) << LogPrefix(tablet_id) << "Created from the split of tablet " << parent->tablet_id()
+            << " with " << rowsets.size() << " rowsets";
+  return open_tablet_pool_->SubmitFunc(boost::bind(&TSTabletManager::OpenTablet,
+                                                   this, meta, deleter));
+}
+
 // If 'expr' fails, log a message, tombstone the given tablet, and return the
 // error status.
 #define TOMBSTONE_NOT_OK(expr, peer, msg) \
@@ -352,7 +631,7 @@ Status TSTabletManager::StartTabletCopy(
   bool replacing_tablet = false;
   scoped_refptr<TransitionInProgressDeleter> deleter;
   {
-    std::lock_guard<rw_spinlock> lock(lock_);
+    std::lock_guard<percpu_rwlock> lock(lock_);
     if (LookupTabletUnlocked(tablet_id, &old_tablet_peer)) {
       meta = old_tablet_peer->tablet_metadata();
       replacing_tablet = true;
@@ -460,6 +739,7 @@ scoped_refptr<TabletPeer> TSTabletManager::CreateAndRegisterTabletPeer(
   scoped_refptr<TabletPeer> tablet_peer(
       new TabletPeer(meta,
                      local_peer_pb_,
+                     prepare_pool_.get(),
                      apply_pool_.get(),
                      Bind(&TSTabletManager::MarkTabletDirty, Unretained(this), meta->tablet_id())));
   RegisterTablet(meta->tablet_id(), tablet_peer, mode);
@@ -486,7 +766,7 @@ Status TSTabletManager::DeleteTablet(
   {
     // Acquire the lock in exclusive mode as we'll add a entry to the
     // transition_in_progress_ map.
-    std::lock_guard<rw_spinlock> lock(lock_);
+    std::lock_guard<percpu_rwlock> lock(lock_);
     TRACE("Acquired tablet manager lock");
     RETURN_NOT_OK(CheckRunningUnlocked(error_code));
 
@@ -550,7 +830,7 @@ Status TSTabletManager::DeleteTablet(
 
   // We only remove DELETED tablets from the tablet map.
   if (delete_type == TABLET_DATA_DELETED) {
-    std::lock_guard<rw_spinlock> lock(lock_);
+    std::lock_guard<percpu_rwlock> lock(lock_);
     RETURN_NOT_OK(CheckRunningUnlocked(error_code));
     CHECK_EQ(1, tablet_map_.erase(tablet_id)) << tablet_id;
     InsertOrDie(&perm_deleted_tablet_ids_, tablet_id);
@@ -577,7 +857,7 @@ Status TSTabletManager::StartTabletStateTransitionUnlocked(
     const string& tablet_id,
     const string& reason,
     scoped_refptr<TransitionInProgressDeleter>* deleter) {
-  DCHECK(lock_.is_write_locked());
+  DCHECK(lock_.is_locked());
   if (ContainsKey(perm_deleted_tablet_ids_, tablet_id)) {
     // When a table is deleted, the master sends a DeleteTablet() RPC to every
     // replica of every tablet with the TABLET_DATA_DELETED parameter, which
@@ -666,6 +946,8 @@ void TSTabletManager::OpenTablet(const scoped_refptr<TabletMetadata>& meta,
     s =  tablet_peer->Init(tablet,
                            scoped_refptr<server::Clock>(server_->clock()),
                            server_->messenger(),
+                           heartbeat_batcher_.get(),
+                           raft_pool_.get(),
                            server_->result_tracker(),
                            log,
                            tablet->GetMetricEntity());
@@ -699,9 +981,49 @@ void TSTabletManager::OpenTablet(const scoped_refptr<TabletMetadata>& meta,
   }
 }
 
+void TSTabletManager::TransferLeadershipOfAllTablets(const MonoDelta& timeout) {
+  vector<scoped_refptr<TabletPeer> > peers;
+  GetTabletPeers(&peers);
+
+  vector<scoped_refptr<consensus::Consensus> > transferred;
+  for (const scoped_refptr<TabletPeer>& peer : peers) {
+    scoped_refptr<consensus::Consensus> consensus = peer->shared_consensus();
+    if (!consensus || consensus->role() != RaftPeerPB::LEADER) {
+      continue;
+    }
+    consensus::LeaderStepDownResponsePB resp;
+    Status s = consensus->TransferLeadership("", &resp);
+    if (s.ok() && resp.has_error()) {
+      s = StatusFromPB(resp.error().status());
+    }
+    if (!s.ok()) {
+      LOG(WARNING) << LogPrefix(peer->tablet_id()) << "Unable to transfer leadership: "
+                   << s.ToString();
+      continue;
+    }
+    transferred.push_back(consensus);
+  }
+  if (transferred.empty()) {
+    return;
+  }
+  LOG(INFO) << "Transferred leadership of " << transferred.size() << " tablets";
+
+  MonoTime deadline = MonoTime::Now() + timeout;
+  for (const scoped_refptr<consensus::Consensus>& consensus : transferred) {
+    while (MonoTime::Now() < deadline) {
+      const string leader = consensus->ConsensusState(
+          consensus::CONSENSUS_CONFIG_ACTIVE).leader_uuid();
+      if (!leader.empty() && leader != consensus->peer_uuid()) {
+        break;
+      }
+      SleepFor(MonoDelta::FromMilliseconds(10));
+    }
+  }
+}
+
 void TSTabletManager::Shutdown() {
   {
-    std::lock_guard<rw_spinlock> lock(lock_);
+    std::lock_guard<percpu_rwlock> lock(lock_);
     switch (state_) {
       case MANAGER_QUIESCING: {
         VLOG(1) << "Tablet manager shut down already in progress..";
@@ -725,6 +1047,7 @@ void TSTabletManager::Shutdown() {
 
   // Shut down the bootstrap pool, so new tablets are registered after this point.
   open_tablet_pool_->Shutdown();
+  create_tablet_pool_->Shutdown();
 
   // Take a snapshot of the peers list -- that way we don't have to hold
   // on to the lock while shutting them down, which might cause a lock
@@ -736,11 +1059,13 @@ void TSTabletManager::Shutdown() {
     peer->Shutdown();
   }
 
-  // Shut down the apply pool.
+  // Shut down the prepare, apply and raft pools.
+  prepare_pool_->Shutdown();
   apply_pool_->Shutdown();
+  raft_pool_->Shutdown();
 
   {
-    std::lock_guard<rw_spinlock> l(lock_);
+    std::lock_guard<percpu_rwlock> l(lock_);
     // We don't expect anyone else to be modifying the map after we start the
     // shut down process.
     CHECK_EQ(tablet_map_.size(), peers_to_shutdown.size())
@@ -754,7 +1079,7 @@ void TSTabletManager::Shutdown() {
 void TSTabletManager::RegisterTablet(const std::string& tablet_id,
                                      const scoped_refptr<TabletPeer>& tablet_peer,
                                      RegisterTabletPeerMode mode) {
-  std::lock_guard<rw_spinlock> lock(lock_);
+  std::lock_guard<percpu_rwlock> lock(lock_);
   // If we are replacing a tablet peer, we delete the existing one first.
   if (mode == REPLACEMENT_PEER && tablet_map_.erase(tablet_id) != 1) {
     LOG(FATAL) << "Unable to remove previous tablet peer " << tablet_id << ": not registered!";
@@ -768,7 +1093,7 @@ void TSTabletManager::RegisterTablet(const std::string& tablet_id,
 
 bool TSTabletManager::LookupTablet(const string& tablet_id,
                                    scoped_refptr<TabletPeer>* tablet_peer) const {
-  shared_lock<rw_spinlock> l(lock_);
+  shared_lock<rw_spinlock> l(lock_.get_lock());
   return LookupTabletUnlocked(tablet_id, tablet_peer);
 }
 
@@ -801,7 +1126,7 @@ const NodeInstancePB& TSTabletManager::NodeInstance() const {
 }
 
 void TSTabletManager::GetTabletPeers(vector<scoped_refptr<TabletPeer> >* tablet_peers) const {
-  shared_lock<rw_spinlock> l(lock_);
+  shared_lock<rw_spinlock> l(lock_.get_lock());
   AppendValuesFromMap(tablet_map_, tablet_peers);
 }
 
@@ -815,7 +1140,7 @@ void TSTabletManager::MarkTabletDirty(const std::string& tablet_id, const std::s
 
 int TSTabletManager::GetNumLiveTablets() const {
   int count = 0;
-  shared_lock<rw_spinlock> l(lock_);
+  shared_lock<rw_spinlock> l(lock_.get_lock());
   for (const auto& entry : tablet_map_) {
     tablet::TabletStatePB state = entry.second->state();
     if (state == tablet::BOOTSTRAPPING ||
@@ -826,6 +1151,23 @@ int TSTabletManager::GetNumLiveTablets() const {
   return count;
 }
 
+void TSTabletManager::GetRowCounts(int64_t* rows_written, int64_t* rows_scanned) const {
+  *rows_written = 0;
+  *rows_scanned = 0;
+  vector<scoped_refptr<TabletPeer>> peers;
+  GetTabletPeers(&peers);
+  for (const auto& peer : peers) {
+    Tablet* tablet = peer->tablet();
+    if (!tablet || !tablet->metrics()) {
+      continue;
+    }
+    const tablet::TabletMetrics* m = tablet->metrics();
+    *rows_written += m->rows_inserted->value() + m->rows_upserted->value() +
+        m->rows_updated->value() + m->rows_deleted->value();
+    *rows_scanned += m->scanner_rows_scanned->value();
+  }
+}
+
 void TSTabletManager::InitLocalRaftPeerPB() {
   DCHECK_EQ(state(), MANAGER_INITIALIZING);
   local_peer_pb_.set_permanent_uuid(fs_manager_->uuid());
@@ -856,7 +1198,7 @@ void TSTabletManager::CreateReportedTabletPB(const string& tablet_id,
 }
 
 void TSTabletManager::PopulateFullTabletReport(TabletReportPB* report) const {
-  shared_lock<rw_spinlock> shared_lock(lock_);
+  shared_lock<rw_spinlock> shared_lock(lock_.get_lock());
   for (const auto& e : tablet_map_) {
     CreateReportedTabletPB(e.first, e.second, report->add_updated_tablets());
   }
@@ -864,7 +1206,7 @@ void TSTabletManager::PopulateFullTabletReport(TabletReportPB* report) const {
 
 void TSTabletManager::PopulateIncrementalTabletReport(TabletReportPB* report,
                                                       const vector<string>& tablet_ids) const {
-  shared_lock<rw_spinlock> shared_lock(lock_);
+  shared_lock<rw_spinlock> shared_lock(lock_.get_lock());
   for (const auto& id : tablet_ids) {
     const scoped_refptr<tablet::TabletPeer>* tablet_peer =
         FindOrNull(tablet_map_, id);
@@ -920,6 +1262,10 @@ Status TSTabletManager::DeleteTabletData(const scoped_refptr<TabletMetadata>& me
       << "Unexpected data_state to delete tablet " << meta->tablet_id() << ": "
       << TabletDataState_Name(data_state) << " (" << data_state << ")";
 
+  // The MemRowSet checkpoint goes first: it must never outlive the data and
+  // log it was taken of, lest it be loaded into a tablet copied back here.
+  RETURN_NOT_OK(Tablet::DeleteMemRowSetCheckpoint(meta->fs_manager(), meta->tablet_id()));
+
   // Note: Passing an unset 'last_logged_opid' will retain the last_logged_opid
   // that was previously in the metadata.
   RETURN_NOT_OK(meta->DeleteTabletData(data_state, last_logged_opid));
@@ -960,11 +1306,11 @@ void TSTabletManager::LogAndTombstone(const scoped_refptr<TabletPeer>& peer,
 }
 
 TransitionInProgressDeleter::TransitionInProgressDeleter(
-    TransitionInProgressMap* map, rw_spinlock* lock, string entry)
+    TransitionInProgressMap* map, percpu_rwlock* lock, string entry)
     : in_progress_(map), lock_(lock), entry_(std::move(entry)) {}
 
 TransitionInProgressDeleter::~TransitionInProgressDeleter() {
-  std::lock_guard<rw_spinlock> lock(*lock_);
+  std::lock_guard<percpu_rwlock> lock(*lock_);
   CHECK(in_progress_->erase(entry_));
 }
 
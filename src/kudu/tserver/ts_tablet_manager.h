@@ -44,6 +44,7 @@ class Partition;
 class Schema;
 
 namespace consensus {
+class MultiRaftHeartbeatBatcher;
 class RaftConfigPB;
 } // namespace consensus
 
@@ -97,6 +98,11 @@ class TSTabletManager : public tserver::TabletPeerLookupIf {
   // the first tablet whose bootstrap failed.
   Status WaitForAllBootstrapsToFinish();
 
+  // Steps down as leader of every tablet this server leads, handing each one
+  // to its most caught-up voter. Then waits up to 'timeout' for other
+  // replicas to take over, so that clients can fail over right away.
+  void TransferLeadershipOfAllTablets(const MonoDelta& timeout);
+
   // Shut down all of the tablets, gracefully flushing before shutdown.
   void Shutdown();
 
@@ -116,6 +122,35 @@ class TSTabletManager : public tserver::TabletPeerLookupIf {
                          consensus::RaftConfigPB config,
                          scoped_refptr<tablet::TabletPeer>* tablet_peer);
 
+  // Like CreateNewTablet(), for the tablet described by 'req'. Sets
+  // 'error_code' on failure.
+  Status CreateNewTabletFromPB(const CreateTabletRequestPB& req,
+                               TabletServerErrorPB::Code* error_code);
+
+  // Creates the tablets of 'req' by calling CreateNewTabletFromPB() on each,
+  // several of them at a time, and fills in the outcome of each in 'resp'.
+  //
+  // Each creation fsyncs the tablet's metadata and consensus metadata, and
+  // running them concurrently lets the filesystem commit those fsyncs
+  // together rather than one after the other.
+  void CreateNewTablets(const CreateTabletsRequestPB& req, CreateTabletsResponsePB* resp);
+
+  // Split the tablet 'tablet_id', whose local replica must be the leader,
+  // into the new tablets 'left_tablet_id' and 'right_tablet_id' at a
+  // boundary between its rowsets (see Tablet::Split()). The new tablets
+  // take over the rowsets of the tablet, and start out with a single
+  // replica, on this server. Writes to the tablet fail from then on.
+  //
+  // If the tablet has already been split, 'left_tablet_id' and
+  // 'right_tablet_id' are set to the tablets of that split, and those of
+  // them which don't exist yet are created. This makes retries safe.
+  Status SplitTablet(const std::string& tablet_id,
+                     std::string* left_tablet_id,
+                     std::string* right_tablet_id,
+                     Partition* left_partition,
+                     Partition* right_partition,
+                     boost::optional<TabletServerErrorPB::Code>* error_code);
+
   // Delete the specified tablet.
   // 'delete_type' must be one of TABLET_DATA_DELETED or TABLET_DATA_TOMBSTONED
   // or else returns Status::IllegalArgument.
@@ -173,6 +208,10 @@ class TSTabletManager : public tserver::TabletPeerLookupIf {
   // Return the number of tablets in RUNNING or BOOTSTRAPPING state.
   int GetNumLiveTablets() const;
 
+  // Return the total number of rows ever written to and scanned from the
+  // tablets which are currently hosted.
+  void GetRowCounts(int64_t* rows_written, int64_t* rows_scanned) const;
+
   Status RunAllLogGC();
 
  private:
@@ -202,6 +241,15 @@ class TSTabletManager : public tserver::TabletPeerLookupIf {
                                             const std::string& reason,
                                             scoped_refptr<TransitionInProgressDeleter>* deleter);
 
+  // Creates and opens the new tablet 'tablet_id' of a split of 'parent',
+  // holding the rowsets 'rowsets' of the parent, with the single replica
+  // 'config'. Does nothing if the tablet is already registered.
+  Status CreateSplitTablet(const scoped_refptr<tablet::TabletMetadata>& parent,
+                           const std::string& tablet_id,
+                           const Partition& partition,
+                           const std::vector<tablet::RowSetDataPB>& rowsets,
+                           const consensus::RaftConfigPB& config);
+
   // Open a tablet meta from the local file system by loading its superblock.
   Status OpenTabletMeta(const std::string& tablet_id,
                         scoped_refptr<tablet::TabletMetadata>* metadata);
@@ -272,7 +320,7 @@ class TSTabletManager : public tserver::TabletPeerLookupIf {
                        const Status& s);
 
   TSTabletManagerStatePB state() const {
-    shared_lock<rw_spinlock> l(lock_);
+    shared_lock<rw_spinlock> l(lock_.get_lock());
     return state_;
   }
 
@@ -292,7 +340,10 @@ class TSTabletManager : public tserver::TabletPeerLookupIf {
 
   // Lock protecting tablet_map_, dirty_tablets_, state_,
   // transition_in_progress_, and perm_deleted_tablet_ids_.
-  mutable rw_spinlock lock_;
+  //
+  // Every RPC to a tablet looks up its peer under this lock, while the map only
+  // changes when tablets are created or deleted, so readers take it per-CPU.
+  mutable percpu_rwlock lock_;
 
   // Map from tablet ID to tablet
   TabletMap tablet_map_;
@@ -313,9 +364,23 @@ class TSTabletManager : public tserver::TabletPeerLookupIf {
   // Thread pool used to open the tablets async, whether bootstrap is required or not.
   gscoped_ptr<ThreadPool> open_tablet_pool_;
 
+  // Thread pool used by CreateNewTablets() to create tablets concurrently.
+  gscoped_ptr<ThreadPool> create_tablet_pool_;
+
+  // Thread pool for preparing transactions, shared between all tablets.
+  gscoped_ptr<ThreadPool> prepare_pool_;
+
   // Thread pool for apply transactions, shared between all tablets.
   gscoped_ptr<ThreadPool> apply_pool_;
 
+  // Thread pool for the Raft notifications which must run in order for each
+  // tablet, shared between all tablets through a serial token per tablet.
+  gscoped_ptr<ThreadPool> raft_pool_;
+
+  // Batches the heartbeats of all tablets' leaders, or null if
+  // --enable_multi_raft_heartbeat_batching is not set.
+  gscoped_ptr<consensus::MultiRaftHeartbeatBatcher> heartbeat_batcher_;
+
   DISALLOW_COPY_AND_ASSIGN(TSTabletManager);
 };
 
@@ -323,7 +388,7 @@ class TSTabletManager : public tserver::TabletPeerLookupIf {
 // when tablet bootstrap, create, and delete operations complete.
 class TransitionInProgressDeleter : public RefCountedThreadSafe<TransitionInProgressDeleter> {
  public:
-  TransitionInProgressDeleter(TransitionInProgressMap* map, rw_spinlock* lock,
+  TransitionInProgressDeleter(TransitionInProgressMap* map, percpu_rwlock* lock,
                               string entry);
 
  private:
@@ -331,7 +396,7 @@ class TransitionInProgressDeleter : public RefCountedThreadSafe<TransitionInProg
   ~TransitionInProgressDeleter();
 
   TransitionInProgressMap* const in_progress_;
-  rw_spinlock* const lock_;
+  percpu_rwlock* const lock_;
   const std::string entry_;
 };
 
@@ -34,11 +34,13 @@
 #include "kudu/server/webui_util.h"
 #include "kudu/tablet/tablet.pb.h"
 #include "kudu/tablet/tablet_bootstrap.h"
+#include "kudu/tablet/tablet_metrics.h"
 #include "kudu/tablet/tablet_peer.h"
 #include "kudu/tserver/scanners.h"
 #include "kudu/tserver/tablet_server.h"
 #include "kudu/tserver/ts_tablet_manager.h"
 #include "kudu/util/maintenance_manager.h"
+#include "kudu/util/metrics.h"
 #include "kudu/util/url-coding.h"
 
 using kudu::consensus::GetConsensusRole;
@@ -58,6 +60,8 @@ using std::shared_ptr;
 using std::vector;
 using strings::Substitute;
 
+METRIC_DECLARE_counter(log_bytes_logged);
+
 namespace kudu {
 namespace tserver {
 
@@ -101,6 +105,10 @@ Status TabletServerPathHandlers::Register(Webserver* server) {
     "/maintenance-manager", "",
     boost::bind(&TabletServerPathHandlers::HandleMaintenanceManagerPage, this, _1, _2),
     true /* styled */, false /* is_on_nav_bar */);
+  server->RegisterPathHandler(
+    "/hot-tablets", "",
+    boost::bind(&TabletServerPathHandlers::HandleHotTabletsPage, this, _1, _2),
+    true /* styled */, false /* is_on_nav_bar */);
 
   return Status::OK();
 }
@@ -511,6 +519,9 @@ void TabletServerPathHandlers::HandleDashboardsPage(const Webserver::WebRequest&
   *output << GetDashboardLine("maintenance-manager", "Maintenance Manager",
                               "List of operations that are currently running and those "
                               "that are registered.");
+  *output << GetDashboardLine("hot-tablets", "Hot Tablets",
+                              "Tablets which used the most CPU and I/O since the server "
+                              "started.");
 }
 
 string TabletServerPathHandlers::GetDashboardLine(const std::string& link,
@@ -580,5 +591,93 @@ void TabletServerPathHandlers::HandleMaintenanceManagerPage(const Webserver::Web
   *output << "</table>\n";
 }
 
+void TabletServerPathHandlers::HandleHotTabletsPage(const Webserver::WebRequest& req,
+                                                    std::ostringstream* output) {
+  // The resources a tablet is charged with, in the order of the columns of the
+  // page. Each of them is also a metric of the tablet.
+  enum Resource {
+    kScanCpu = 0,
+    kScanCacheHitBytes,
+    kScanCacheMissBytes,
+    kWalBytes,
+    kFlushedBytes,
+    kCompactionReadBytes,
+    kNumResources
+  };
+  static const char* const kResourceArgs[kNumResources] = {
+    "scan_cpu", "scan_cache_hit", "scan_cache_miss", "wal", "flushed", "compaction_read"
+  };
+  static const char* const kResourceNames[kNumResources] = {
+    "Scan CPU", "Scan cache hits", "Scan cache misses", "WAL written", "Flushed",
+    "Compaction read"
+  };
+
+  int sort_by = kScanCpu;
+  string sort_arg = FindWithDefault(req.parsed_args, "sort", kResourceArgs[kScanCpu]);
+  for (int i = 0; i < kNumResources; i++) {
+    if (sort_arg == kResourceArgs[i]) {
+      sort_by = i;
+    }
+  }
+  int num_tablets = 10;
+  string n_arg;
+  if (FindCopy(req.parsed_args, "n", &n_arg) && !safe_strto32(n_arg, &num_tablets)) {
+    num_tablets = 10;
+  }
+
+  struct TabletUsage {
+    scoped_refptr<TabletPeer> peer;
+    int64_t usage[kNumResources];
+  };
+  vector<TabletUsage> usages;
+  vector<scoped_refptr<TabletPeer> > peers;
+  tserver_->tablet_manager()->GetTabletPeers(&peers);
+  for (const scoped_refptr<TabletPeer>& peer : peers) {
+    shared_ptr<Tablet> tablet = peer->shared_tablet();
+    if (!tablet || !tablet->metrics()) {
+      continue;
+    }
+    const tablet::TabletMetrics* m = tablet->metrics();
+    TabletUsage u;
+    u.peer = peer;
+    u.usage[kScanCpu] = m->scanner_cpu_time_us->value();
+    u.usage[kScanCacheHitBytes] = m->scanner_cfile_cache_hit_bytes->value();
+    u.usage[kScanCacheMissBytes] = m->scanner_cfile_cache_miss_bytes->value();
+    u.usage[kWalBytes] = METRIC_log_bytes_logged.Instantiate(tablet->GetMetricEntity())->value();
+    u.usage[kFlushedBytes] = m->bytes_flushed->value();
+    u.usage[kCompactionReadBytes] = m->compact_rs_bytes_read->value();
+    usages.push_back(u);
+  }
+  std::sort(usages.begin(), usages.end(),
+            [&](const TabletUsage& a, const TabletUsage& b) {
+              return a.usage[sort_by] > b.usage[sort_by];
+            });
+  if (num_tablets >= 0 && usages.size() > static_cast<size_t>(num_tablets)) {
+    usages.resize(num_tablets);
+  }
+
+  *output << "<h1>Hot Tablets</h1>\n";
+  *output << "<p>The tablets which used the most of each resource since the server started. "
+          << "Click on a column to sort by it.</p>\n";
+  *output << "<table class='table table-striped'>\n";
+  *output << "  <tr><th>Table name</th><th>Tablet ID</th>";
+  for (int i = 0; i < kNumResources; i++) {
+    *output << Substitute("<th><a href=\"?sort=$0&n=$1\">$2</a></th>",
+                          kResourceArgs[i], num_tablets, kResourceNames[i]);
+  }
+  *output << "</tr>\n";
+  for (const TabletUsage& u : usages) {
+    *output << Substitute("  <tr><td>$0</td><td>$1</td><td>$2</td>",
+                          EscapeForHtmlToString(u.peer->tablet_metadata()->table_name()),
+                          TabletLink(u.peer->tablet_id()),
+                          HumanReadableElapsedTime::ToShortString(u.usage[kScanCpu] / 1e6));
+    for (int i = kScanCacheHitBytes; i < kNumResources; i++) {
+      *output << Substitute("<td>$0</td>", HumanReadableNumBytes::ToString(u.usage[i]));
+    }
+    *output << "</tr>\n";
+  }
+  *output << "</table>\n";
+}
+
 } // namespace tserver
 } // namespace kudu
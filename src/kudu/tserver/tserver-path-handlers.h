@@ -67,6 +67,8 @@ class TabletServerPathHandlers {
                             std::ostringstream* output);
   void HandleMaintenanceManagerPage(const Webserver::WebRequest& req,
                                     std::ostringstream* output);
+  void HandleHotTabletsPage(const Webserver::WebRequest& req,
+                            std::ostringstream* output);
   std::string ConsensusStatePBToHtml(const consensus::ConsensusStatePB& cstate) const;
   std::string ScannerToHtml(const Scanner& scanner) const;
   std::string IteratorStatsToHtml(const Schema& projection,
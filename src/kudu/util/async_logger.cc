@@ -0,0 +1,153 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#include "kudu/util/async_logger.h"
+
+#include <utility>
+
+#include "kudu/gutil/strings/substitute.h"
+
+using std::string;
+
+namespace kudu {
+
+AsyncLogger::AsyncLogger(google::base::Logger* wrapped, int64_t max_buffer_bytes)
+    : wrapped_(DCHECK_NOTNULL(wrapped)),
+      max_buffer_bytes_(max_buffer_bytes),
+      buffer_bytes_(0),
+      force_flush_(false),
+      num_unreported_drops_(0),
+      num_dropped_(0),
+      flush_seq_requested_(0),
+      flush_seq_done_(0),
+      running_(false),
+      stopping_(false) {
+}
+
+AsyncLogger::~AsyncLogger() {
+  Stop();
+}
+
+void AsyncLogger::Start() {
+  std::lock_guard<std::mutex> l(lock_);
+  DCHECK(!running_);
+  running_ = true;
+  thread_ = std::thread(&AsyncLogger::RunThread, this);
+}
+
+void AsyncLogger::Stop() {
+  {
+    std::lock_guard<std::mutex> l(lock_);
+    if (!running_ || stopping_) {
+      return;
+    }
+    stopping_ = true;
+    wake_writer_cond_.notify_one();
+  }
+  thread_.join();
+  std::lock_guard<std::mutex> l(lock_);
+  running_ = false;
+  stopping_ = false;
+}
+
+void AsyncLogger::Write(bool force_flush,
+                        time_t timestamp,
+                        const char* message,
+                        int message_len) {
+  {
+    std::lock_guard<std::mutex> l(lock_);
+    if (running_ && !stopping_) {
+      if (buffer_bytes_ + message_len > max_buffer_bytes_) {
+        num_unreported_drops_++;
+        num_dropped_++;
+        return;
+      }
+      buffer_.push_back({ timestamp, string(message, message_len) });
+      buffer_bytes_ += message_len;
+      force_flush_ |= force_flush;
+      wake_writer_cond_.notify_one();
+      return;
+    }
+  }
+  wrapped_->Write(force_flush, timestamp, message, message_len);
+}
+
+void AsyncLogger::Flush() {
+  std::unique_lock<std::mutex> l(lock_);
+  if (!running_ || stopping_) {
+    l.unlock();
+    wrapped_->Flush();
+    return;
+  }
+  int64_t seq = ++flush_seq_requested_;
+  wake_writer_cond_.notify_one();
+  flush_done_cond_.wait(l, [&]() { return flush_seq_done_ >= seq; });
+}
+
+uint32_t AsyncLogger::LogSize() {
+  return wrapped_->LogSize();
+}
+
+int64_t AsyncLogger::num_dropped_messages() const {
+  std::lock_guard<std::mutex> l(lock_);
+  return num_dropped_;
+}
+
+void AsyncLogger::RunThread() {
+  std::vector<Message> to_write;
+  std::unique_lock<std::mutex> l(lock_);
+  while (true) {
+    wake_writer_cond_.wait(l, [&]() {
+      return !buffer_.empty() || num_unreported_drops_ > 0 ||
+          flush_seq_requested_ > flush_seq_done_ || stopping_;
+    });
+    if (buffer_.empty() && num_unreported_drops_ == 0 &&
+        flush_seq_requested_ == flush_seq_done_) {
+      DCHECK(stopping_);
+      break;
+    }
+    to_write.swap(buffer_);
+    buffer_bytes_ = 0;
+    int64_t num_drops = num_unreported_drops_;
+    num_unreported_drops_ = 0;
+    int64_t flush_seq = flush_seq_requested_;
+    bool flush = force_flush_ || flush_seq > flush_seq_done_;
+    force_flush_ = false;
+    l.unlock();
+
+    // Write without holding the lock, so that the threads which log only
+    // wait for the writer to swap the buffers.
+    for (const Message& m : to_write) {
+      wrapped_->Write(false, m.timestamp, m.text.data(), m.text.size());
+    }
+    to_write.clear();
+    if (num_drops > 0) {
+      string msg = strings::Substitute(
+          "Dropped $0 log messages, since the log couldn't be written fast enough\n",
+          num_drops);
+      wrapped_->Write(false, time(nullptr), msg.data(), msg.size());
+    }
+    if (flush) {
+      wrapped_->Flush();
+    }
+
+    l.lock();
+    flush_seq_done_ = flush_seq;
+    flush_done_cond_.notify_all();
+  }
+}
+
+} // namespace kudu
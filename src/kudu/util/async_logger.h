@@ -0,0 +1,122 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#ifndef KUDU_UTIL_ASYNC_LOGGER_H
+#define KUDU_UTIL_ASYNC_LOGGER_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <glog/logging.h>
+
+#include "kudu/gutil/macros.h"
+
+namespace kudu {
+
+// A glog Logger which hands the messages of a severity over to a background
+// thread, which writes them to the wrapped logger. This keeps the threads
+// which log, e.g. the reactor and service threads, from stalling on a slow
+// log disk.
+//
+// The messages waiting to be written are bounded to 'max_buffer_bytes'.
+// Once that is reached, new messages are dropped rather than waited on, and
+// the number of dropped messages is written to the log once it catches up.
+//
+// Messages still buffered when the process crashes are lost, so FATAL
+// messages should not go through an AsyncLogger.
+class AsyncLogger : public google::base::Logger {
+ public:
+  // 'wrapped' must outlive this object.
+  AsyncLogger(google::base::Logger* wrapped, int64_t max_buffer_bytes);
+  ~AsyncLogger();
+
+  // Starts the writer thread. Messages are only buffered until then.
+  void Start();
+
+  // Writes the buffered messages, then stops the writer thread. Messages
+  // logged from then on are written to the wrapped logger directly.
+  void Stop();
+
+  void Write(bool force_flush,
+             time_t timestamp,
+             const char* message,
+             int message_len) override;
+
+  // Waits for the messages logged so far to be written, and flushes the
+  // wrapped logger.
+  void Flush() override;
+
+  uint32_t LogSize() override;
+
+  google::base::Logger* wrapped() const { return wrapped_; }
+
+  // The number of messages dropped since the logger was created.
+  int64_t num_dropped_messages() const;
+
+ private:
+  struct Message {
+    time_t timestamp;
+    std::string text;
+  };
+
+  void RunThread();
+
+  google::base::Logger* const wrapped_;
+  const int64_t max_buffer_bytes_;
+
+  std::thread thread_;
+
+  // Protects all of the following.
+  mutable std::mutex lock_;
+
+  // Signaled when there are messages to write, a flush to do, or the writer
+  // should stop.
+  std::condition_variable wake_writer_cond_;
+
+  // Signaled when the writer completed a flush.
+  std::condition_variable flush_done_cond_;
+
+  // The messages waiting for the writer, and their total size.
+  std::vector<Message> buffer_;
+  int64_t buffer_bytes_;
+
+  // Whether a message asked to flush the wrapped logger.
+  bool force_flush_;
+
+  // The number of messages dropped since the writer last reported drops,
+  // and since the logger was created.
+  int64_t num_unreported_drops_;
+  int64_t num_dropped_;
+
+  // Flush() requests get increasing sequence numbers: the last one requested,
+  // and the last one which the writer completed.
+  int64_t flush_seq_requested_;
+  int64_t flush_seq_done_;
+
+  bool running_;
+  bool stopping_;
+
+  DISALLOW_COPY_AND_ASSIGN(AsyncLogger);
+};
+
+} // namespace kudu
+#endif
@@ -70,6 +70,68 @@ TEST(TestBitMap, TestIteration2) {
   ASSERT_EQ("1", JoinElements(read_back, ","));
 }
 
+// Iterates over bitmaps longer than 255 bytes, with runs of whole words
+// without any set bits, and with set bits past the end of the bitmap.
+TEST(TestBitMap, TestIterationLongBitmap) {
+  const size_t kNumBits = 5000;
+  uint8_t bm[(kNumBits + 7) / 8 + 1];
+  memset(bm, 0, sizeof(bm));
+  std::vector<size_t> expected;
+  for (size_t i = 0; i < kNumBits; i += 997) {
+    BitmapSet(bm, i);
+    expected.push_back(i);
+  }
+  BitmapSet(bm, kNumBits - 1);
+  expected.push_back(kNumBits - 1);
+  BitmapSet(bm, kNumBits + 1);
+
+  std::vector<size_t> read_back;
+  ReadBackBitmap(bm, kNumBits, &read_back);
+  ASSERT_EQ(expected, read_back);
+  ASSERT_EQ(expected.size(), BitmapCountSet(bm, kNumBits));
+
+  size_t idx;
+  ASSERT_TRUE(BitmapFindLastSet(bm, kNumBits, &idx));
+  ASSERT_EQ(kNumBits - 1, idx);
+  ASSERT_TRUE(BitmapFindLastSet(bm, kNumBits - 1, &idx));
+  ASSERT_EQ(4985, idx);
+  ASSERT_TRUE(BitmapFindLastSet(bm, 997, &idx));
+  ASSERT_EQ(0, idx);
+  ASSERT_FALSE(BitmapFindLastSet(bm + 1, 900, &idx));
+  ASSERT_FALSE(BitmapFindLastSet(bm, 0, &idx));
+}
+
+TEST(TestBitMap, TestMergeAndCount) {
+  const size_t kNumBits = 300;
+  const size_t kNumBytes = (kNumBits + 7) / 8;
+  uint8_t a[kNumBytes];
+  uint8_t b[kNumBytes];
+  uint8_t merged[kNumBytes];
+  memset(a, 0, sizeof(a));
+  memset(b, 0, sizeof(b));
+  for (size_t i = 0; i < kNumBits; i++) {
+    if (i % 2 == 0) BitmapSet(a, i);
+    if (i % 3 == 0) BitmapSet(b, i);
+  }
+  ASSERT_EQ(150, BitmapCountSet(a, kNumBits));
+  ASSERT_EQ(100, BitmapCountSet(b, kNumBits));
+  ASSERT_EQ(3, BitmapCountSet(a, 5));
+
+  memcpy(merged, a, sizeof(a));
+  BitmapMergeAnd(merged, b, kNumBits);
+  ASSERT_EQ(50, BitmapCountSet(merged, kNumBits));
+  for (size_t i = 0; i < kNumBits; i++) {
+    ASSERT_EQ(i % 6 == 0, BitmapTest(merged, i)) << i;
+  }
+
+  memcpy(merged, a, sizeof(a));
+  BitmapMergeOr(merged, b, kNumBits);
+  ASSERT_EQ(200, BitmapCountSet(merged, kNumBits));
+  for (size_t i = 0; i < kNumBits; i++) {
+    ASSERT_EQ(i % 2 == 0 || i % 3 == 0, BitmapTest(merged, i)) << i;
+  }
+}
+
 TEST(TestBitmap, TestSetAndTestBits) {
   uint8_t bm[1];
   memset(bm, 0, sizeof(bm));
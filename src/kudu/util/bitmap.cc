@@ -14,6 +14,7 @@
 // KIND, either express or implied.  See the License for the
 // specific language governing permissions and limitations
 // under the License.
+#include <emmintrin.h>
 #include <glog/logging.h>
 #include <string>
 
@@ -60,6 +61,49 @@ void BitmapChangeBits(uint8_t *bitmap, size_t offset, size_t num_bits, bool valu
   }
 }
 
+void BitmapMergeOr(uint8_t *dst, const uint8_t *src, size_t n_bits) {
+  size_t n_bytes = BitmapSize(n_bits);
+  size_t i = 0;
+  for (; i + 16 <= n_bytes; i += 16) {
+    __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+    __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_or_si128(d, s));
+  }
+  for (; i < n_bytes; i++) {
+    dst[i] |= src[i];
+  }
+}
+
+void BitmapMergeAnd(uint8_t *dst, const uint8_t *src, size_t n_bits) {
+  size_t n_bytes = BitmapSize(n_bits);
+  size_t i = 0;
+  for (; i + 16 <= n_bytes; i += 16) {
+    __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+    __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_and_si128(d, s));
+  }
+  for (; i < n_bytes; i++) {
+    dst[i] &= src[i];
+  }
+}
+
+size_t BitmapCountSet(const uint8_t *bitmap, size_t num_bits) {
+  // We build with SSE4.2, so this compiles down to popcnt.
+  size_t count = 0;
+  size_t n_words = num_bits / 64;
+  for (size_t i = 0; i < n_words; i++) {
+    count += __builtin_popcountll(UNALIGNED_LOAD64(bitmap + i * 8));
+  }
+  size_t bit = n_words * 64;
+  for (; bit + 8 <= num_bits; bit += 8) {
+    count += Bits::CountOnesInByte(bitmap[bit >> 3]);
+  }
+  if (bit < num_bits) {
+    count += Bits::CountOnesInByte(bitmap[bit >> 3] & (0xff >> (8 - (num_bits - bit))));
+  }
+  return count;
+}
+
 bool BitmapFindFirst(const uint8_t *bitmap, size_t offset, size_t bitmap_size,
                      bool value, size_t *idx) {
   const uint64_t pattern64[2] = { 0xffffffffffffffff, 0x0000000000000000 };
@@ -112,6 +156,38 @@ bool BitmapFindFirst(const uint8_t *bitmap, size_t offset, size_t bitmap_size,
   return false;
 }
 
+bool BitmapFindLastSet(const uint8_t *bitmap, size_t bitmap_size, size_t *idx) {
+  if (bitmap_size == 0) {
+    return false;
+  }
+
+  // Check the last byte, ignoring the bits past the end of the bitmap.
+  size_t byte_idx = (bitmap_size - 1) >> 3;
+  uint8_t last = bitmap[byte_idx] & (0xff >> (7 - ((bitmap_size - 1) & 0x7)));
+  if (last != 0) {
+    *idx = (byte_idx << 3) + Bits::FindMSBSetNonZero(last);
+    return true;
+  }
+
+  // Check 64 bits at a time for a set bit, then the remaining bytes.
+  while (byte_idx >= 8) {
+    byte_idx -= 8;
+    uint64_t word = UNALIGNED_LOAD64(bitmap + byte_idx);
+    if (word != 0) {
+      *idx = (byte_idx << 3) + Bits::FindMSBSetNonZero64(word);
+      return true;
+    }
+  }
+  while (byte_idx > 0) {
+    byte_idx--;
+    if (bitmap[byte_idx] != 0) {
+      *idx = (byte_idx << 3) + Bits::FindMSBSetNonZero(bitmap[byte_idx]);
+      return true;
+    }
+  }
+  return false;
+}
+
 std::string BitmapToString(const uint8_t *bitmap, size_t num_bits) {
   std::string s;
   size_t index = 0;
@@ -19,8 +19,10 @@
 #ifndef KUDU_UTIL_BITMAP_H
 #define KUDU_UTIL_BITMAP_H
 
+#include <cstring>
 #include <string>
 #include "kudu/gutil/bits.h"
+#include "kudu/gutil/port.h"
 
 namespace kudu {
 
@@ -50,13 +52,15 @@ inline bool BitmapTest(const uint8_t *bitmap, size_t idx) {
 }
 
 // Merge the two bitmaps using bitwise or. Both bitmaps should have at least
-// n_bits valid bits.
-inline void BitmapMergeOr(uint8_t *dst, const uint8_t *src, size_t n_bits) {
-  size_t n_bytes = BitmapSize(n_bits);
-  for (size_t i = 0; i < n_bytes; i++) {
-    *dst++ |= *src++;
-  }
-}
+// n_bits valid bits. The last partial byte is merged whole.
+void BitmapMergeOr(uint8_t *dst, const uint8_t *src, size_t n_bits);
+
+// Merge the two bitmaps using bitwise and, with the same requirements as
+// BitmapMergeOr().
+void BitmapMergeAnd(uint8_t *dst, const uint8_t *src, size_t n_bits);
+
+// Return the number of set bits among the first num_bits bits.
+size_t BitmapCountSet(const uint8_t *bitmap, size_t num_bits);
 
 // Set bits from offset to (offset + num_bits) to the specified value
 void BitmapChangeBits(uint8_t *bitmap, size_t offset, size_t num_bits, bool value);
@@ -77,6 +81,9 @@ inline bool BitmapFindFirstZero(const uint8_t *bitmap, size_t offset,
   return BitmapFindFirst(bitmap, offset, bitmap_size, false, idx);
 }
 
+// Find the last set bit among the first bitmap_size bits.
+bool BitmapFindLastSet(const uint8_t *bitmap, size_t bitmap_size, size_t *idx);
+
 // Returns true if the bitmap contains only ones.
 inline bool BitMapIsAllSet(const uint8_t *bitmap, size_t offset, size_t bitmap_size) {
   DCHECK_LT(offset, bitmap_size);
@@ -140,7 +147,8 @@ class BitmapIterator {
   const uint8_t *map_;
 };
 
-// Iterator which yields the set bits in a bitmap.
+// Iterator which yields the set bits in a bitmap, skipping over a 64-bit
+// word at a time where no bits are set. Bits past n_bits are ignored.
 // Example usage:
 //   for (TrueBitIterator iter(bitmap, n_bits);
 //        !iter.done();
@@ -151,29 +159,27 @@ class TrueBitIterator {
  public:
   TrueBitIterator(const uint8_t *bitmap, size_t n_bits)
     : bitmap_(bitmap),
-      cur_byte_(0),
-      cur_byte_idx_(0),
+      cur_word_(0),
+      cur_word_idx_(0),
       n_bits_(n_bits),
-      n_bytes_(BitmapSize(n_bits_)),
+      n_words_((n_bits + 63) / 64),
       bit_idx_(0) {
-    if (n_bits_ == 0) {
-      cur_byte_idx_ = 1; // sets done
-    } else {
-      cur_byte_ = bitmap[0];
+    if (n_words_ > 0) {
+      cur_word_ = LoadWord(0);
       AdvanceToNextOneBit();
     }
   }
 
   TrueBitIterator &operator ++() {
     DCHECK(!done());
-    DCHECK(cur_byte_ & 1);
-    cur_byte_ &= (~1);
+    // Clear the lowest set bit, which is the current one.
+    cur_word_ &= cur_word_ - 1;
     AdvanceToNextOneBit();
     return *this;
   }
 
   bool done() const {
-    return cur_byte_idx_ >= n_bytes_;
+    return cur_word_idx_ >= n_words_;
   }
 
   size_t operator *() const {
@@ -182,28 +188,33 @@ class TrueBitIterator {
   }
 
  private:
-  void AdvanceToNextOneBit() {
-    while (cur_byte_ == 0) {
-      cur_byte_idx_++;
-      if (cur_byte_idx_ >= n_bytes_) return;
-      cur_byte_ = bitmap_[cur_byte_idx_];
-      bit_idx_ = cur_byte_idx_ * 8;
+  // Load the given word of the bitmap, with the bits past n_bits cleared.
+  uint64_t LoadWord(size_t word_idx) const {
+    const uint8_t *p = bitmap_ + word_idx * 8;
+    size_t bits = n_bits_ - word_idx * 64;
+    if (PREDICT_TRUE(bits >= 64)) {
+      return UNALIGNED_LOAD64(p);
     }
-    DVLOG(2) << "Found next nonzero byte at " << cur_byte_idx_
-             << " val=" << cur_byte_;
+    uint64_t word = 0;
+    memcpy(&word, p, BitmapSize(bits));
+    return word & ((1ULL << bits) - 1);
+  }
 
-    DCHECK_NE(cur_byte_, 0);
-    int set_bit = Bits::FindLSBSetNonZero(cur_byte_);
-    bit_idx_ += set_bit;
-    cur_byte_ >>= set_bit;
+  void AdvanceToNextOneBit() {
+    while (cur_word_ == 0) {
+      cur_word_idx_++;
+      if (cur_word_idx_ >= n_words_) return;
+      cur_word_ = LoadWord(cur_word_idx_);
+    }
+    bit_idx_ = cur_word_idx_ * 64 + Bits::FindLSBSetNonZero64(cur_word_);
   }
 
   const uint8_t *bitmap_;
-  uint8_t cur_byte_;
-  uint8_t cur_byte_idx_;
+  uint64_t cur_word_;
+  size_t cur_word_idx_;
 
   const size_t n_bits_;
-  const size_t n_bytes_;
+  const size_t n_words_;
   size_t bit_idx_;
 };
 
@@ -65,6 +65,24 @@ TEST(BlockingQueueTest, TestBlockingDrainTo) {
   ASSERT_EQ(3, out[2]);
 }
 
+TEST(BlockingQueueTest, TestBlockingDrainToWithDeadline) {
+  BlockingQueue<int32_t> test_queue(3);
+  vector<int32_t> out;
+  MonoTime deadline = MonoTime::Now() + MonoDelta::FromMilliseconds(10);
+  ASSERT_TRUE(test_queue.BlockingDrainTo(&out, deadline));
+  ASSERT_TRUE(out.empty());
+  ASSERT_GE(MonoTime::Now(), deadline);
+
+  ASSERT_EQ(test_queue.Put(1), QUEUE_SUCCESS);
+  ASSERT_EQ(test_queue.Put(2), QUEUE_SUCCESS);
+  ASSERT_TRUE(test_queue.BlockingDrainTo(&out, deadline));
+  ASSERT_EQ(vector<int32_t>({ 1, 2 }), out);
+
+  test_queue.Shutdown();
+  ASSERT_FALSE(test_queue.BlockingDrainTo(&out, deadline));
+  ASSERT_EQ(2, out.size());
+}
+
 TEST(BlockingQueueTest, TestTooManyInsertions) {
   BlockingQueue<int32_t> test_queue(2);
   ASSERT_EQ(test_queue.Put(123), QUEUE_SUCCESS);
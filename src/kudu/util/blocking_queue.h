@@ -26,6 +26,7 @@
 #include "kudu/gutil/basictypes.h"
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/util/condition_variable.h"
+#include "kudu/util/monotime.h"
 #include "kudu/util/mutex.h"
 
 namespace kudu {
@@ -105,13 +106,7 @@ class BlockingQueue {
     MutexLock l(lock_);
     while (true) {
       if (!list_.empty()) {
-        out->reserve(list_.size());
-        for (const T& elt : list_) {
-          out->push_back(elt);
-          decrement_size_unlocked(elt);
-        }
-        list_.clear();
-        not_full_.Signal();
+        DrainToUnlocked(out);
         return true;
       }
       if (shutdown_) {
@@ -121,6 +116,25 @@ class BlockingQueue {
     }
   }
 
+  // Like BlockingDrainTo(), but gives up waiting for elements at 'deadline',
+  // in which case nothing is appended to 'out' and true is returned.
+  bool BlockingDrainTo(std::vector<T>* out, const MonoTime& deadline) {
+    MutexLock l(lock_);
+    while (true) {
+      if (!list_.empty()) {
+        DrainToUnlocked(out);
+        return true;
+      }
+      if (shutdown_) {
+        return false;
+      }
+      MonoDelta wait_time = deadline.GetDeltaSince(MonoTime::Now());
+      if (wait_time.ToNanoseconds() <= 0 || !not_empty_.TimedWait(wait_time)) {
+        return true;
+      }
+    }
+  }
+
   // Attempts to put the given value in the queue.
   // Returns:
   //   QUEUE_SUCCESS: if successfully inserted
@@ -202,6 +216,12 @@ class BlockingQueue {
     return max_size_;
   }
 
+  // Returns the logical size of the elements in the queue.
+  size_t size() const {
+    MutexLock l(lock_);
+    return size_;
+  }
+
   std::string ToString() const {
     std::string ret;
 
@@ -221,6 +241,16 @@ class BlockingQueue {
   }
 
   // Decrements queue size. Must be called when 'lock_' is held.
+  void DrainToUnlocked(std::vector<T>* out) {
+    out->reserve(out->size() + list_.size());
+    for (const T& elt : list_) {
+      out->push_back(elt);
+      decrement_size_unlocked(elt);
+    }
+    list_.clear();
+    not_full_.Signal();
+  }
+
   void decrement_size_unlocked(const T& t) {
     size_ -= LOGICAL_SIZE::logical_size(t);
   }
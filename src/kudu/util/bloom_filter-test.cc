@@ -84,4 +84,39 @@ TEST(TestBloomFilter, TestInsertAndProbe) {
   ASSERT_NEAR(fp_rate, expected_fp_rate, 0.20*expected_fp_rate);
 }
 
+TEST(TestBloomFilter, TestSplitBlockInsertAndProbe) {
+  BloomFilterBuilder bfb(BloomFilterSizing::ByCountAndFPRate(2000, 0.01),
+                         BloomFilterFormat::kSplitBlock);
+  ASSERT_EQ(0, bfb.n_bytes() % BloomFilter::kSplitBlockBucketBytes);
+  ASSERT_EQ(BloomFilter::kSplitBlockHashes, bfb.n_hashes());
+
+  // The split block filter holds fewer keys than a classic filter of the
+  // same size, but should still achieve the requested false positive rate.
+  int n_keys = bfb.expected_count();
+  ASSERT_LT(n_keys, 2000);
+  ASSERT_GT(n_keys, 1500);
+  double expected_fp_rate = bfb.false_positive_rate();
+  ASSERT_LE(expected_fp_rate, 0.0101);
+
+  AddRandomKeys(kRandomSeed, n_keys, &bfb);
+  BloomFilter bf(bfb.slice(), bfb.n_hashes(), BloomFilterFormat::kSplitBlock);
+  CheckRandomKeys(kRandomSeed, n_keys, bf);
+
+  uint32_t num_queries = 100000;
+  uint32_t num_positives = 0;
+  for (int i = 0; i < num_queries; i++) {
+    uint64_t key = random();
+    Slice key_slice(reinterpret_cast<const uint8_t *>(&key), sizeof(key));
+    BloomKeyProbe probe(key_slice);
+    if (bf.MayContainKey(probe)) {
+      num_positives++;
+    }
+  }
+
+  double fp_rate = static_cast<double>(num_positives) / static_cast<double>(num_queries);
+  LOG(INFO) << "FP rate: " << fp_rate << " (" << num_positives << "/" << num_queries << ")";
+  LOG(INFO) << "Expected FP rate: " << expected_fp_rate;
+  ASSERT_NEAR(fp_rate, expected_fp_rate, 0.20*expected_fp_rate);
+}
+
 } // namespace kudu
@@ -17,6 +17,8 @@
 
 #include <math.h>
 
+#include <algorithm>
+
 #include "kudu/util/bloom_filter.h"
 #include "kudu/util/bitmap.h"
 
@@ -30,6 +32,54 @@ static int ComputeOptimalHashCount(size_t n_bits, size_t elems) {
   return n_hashes;
 }
 
+static double ClassicFalsePositiveRate(size_t n_bits, size_t n_hashes, size_t count) {
+  return pow(1 - exp(-static_cast<double>(n_hashes) * count / n_bits), n_hashes);
+}
+
+// Estimate the false positive rate of a split block filter of 'n_bits' bits
+// holding 'count' keys. The number of keys landing in a bucket is roughly
+// Poisson distributed, and a bucket holding i keys matches a missing key
+// with probability (1 - (31/32)^i)^8.
+static double SplitBlockFalsePositiveRate(size_t n_bits, size_t count) {
+  const double n_buckets = n_bits / (BloomFilter::kSplitBlockBucketBytes * 8);
+  const double lambda = count / n_buckets;
+  const int max_load = static_cast<int>(lambda + 10 * sqrt(lambda) + 10);
+  double p_load = exp(-lambda);
+  double fp_rate = 0;
+  for (int i = 0; i <= max_load; i++) {
+    fp_rate += p_load * pow(1 - pow(31.0 / 32, i), BloomFilter::kSplitBlockHashes);
+    p_load *= lambda / (i + 1);
+  }
+  return fp_rate;
+}
+
+static size_t FormatBytes(size_t n_bytes, BloomFilterFormat format) {
+  if (format != BloomFilterFormat::kSplitBlock) {
+    return n_bytes;
+  }
+  const size_t bucket = BloomFilter::kSplitBlockBucketBytes;
+  return std::max(bucket, (n_bytes + bucket - 1) / bucket * bucket);
+}
+
+// The number of keys a split block filter of 'n_bits' bits can hold while
+// staying within the false positive rate of a classic filter of the same
+// size sized for 'classic_count' keys.
+static size_t SplitBlockExpectedCount(size_t n_bits, size_t classic_count) {
+  const double target = ClassicFalsePositiveRate(
+      n_bits, ComputeOptimalHashCount(n_bits, classic_count), classic_count);
+  size_t lo = 1;
+  size_t hi = std::max<size_t>(classic_count, 1);
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo + 1) / 2;
+    if (SplitBlockFalsePositiveRate(n_bits, mid) <= target) {
+      lo = mid;
+    } else {
+      hi = mid - 1;
+    }
+  }
+  return lo;
+}
+
 BloomFilterSizing BloomFilterSizing::ByCountAndFPRate(
   size_t expected_count, double fp_rate) {
   CHECK_GT(fp_rate, 0);
@@ -53,11 +103,17 @@ BloomFilterSizing BloomFilterSizing::BySizeAndFPRate(size_t n_bytes, double fp_r
 }
 
 
-BloomFilterBuilder::BloomFilterBuilder(const BloomFilterSizing &sizing)
-  : n_bits_(sizing.n_bytes() * 8),
-    bitmap_(new uint8_t[sizing.n_bytes()]),
-    n_hashes_(ComputeOptimalHashCount(n_bits_, sizing.expected_count())),
-    expected_count_(sizing.expected_count()),
+BloomFilterBuilder::BloomFilterBuilder(const BloomFilterSizing &sizing,
+                                       BloomFilterFormat format)
+  : format_(format),
+    n_bits_(FormatBytes(sizing.n_bytes(), format) * 8),
+    bitmap_(new uint8_t[n_bits_ / 8]),
+    n_hashes_(format == BloomFilterFormat::kSplitBlock ?
+              BloomFilter::kSplitBlockHashes :
+              ComputeOptimalHashCount(n_bits_, sizing.expected_count())),
+    expected_count_(format == BloomFilterFormat::kSplitBlock ?
+                    SplitBlockExpectedCount(n_bits_, sizing.expected_count()) :
+                    sizing.expected_count()),
     n_inserted_(0) {
   Clear();
 }
@@ -72,11 +128,15 @@ double BloomFilterBuilder::false_positive_rate() const {
     << "expected_count_ not initialized: can't call this function on "
     << "a BloomFilter initialized from external data";
 
-  return pow(1 - exp(-static_cast<double>(n_hashes_) * expected_count_ / n_bits_), n_hashes_);
+  if (format_ == BloomFilterFormat::kSplitBlock) {
+    return SplitBlockFalsePositiveRate(n_bits_, expected_count_);
+  }
+  return ClassicFalsePositiveRate(n_bits_, n_hashes_, expected_count_);
 }
 
-BloomFilter::BloomFilter(const Slice &data, size_t n_hashes)
-  : n_bits_(data.size() * 8),
+BloomFilter::BloomFilter(const Slice &data, size_t n_hashes, BloomFilterFormat format)
+  : format_(format),
+    n_bits_(data.size() * 8),
     bitmap_(reinterpret_cast<const uint8_t *>(data.data())),
     n_hashes_(n_hashes)
 {}
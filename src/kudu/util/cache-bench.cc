@@ -0,0 +1,114 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "kudu/gutil/atomicops.h"
+#include "kudu/util/cache.h"
+#include "kudu/util/coding.h"
+#include "kudu/util/faststring.h"
+#include "kudu/util/monotime.h"
+#include "kudu/util/random.h"
+#include "kudu/util/stopwatch.h"
+#include "kudu/util/test_util.h"
+
+DEFINE_int32(cache_bench_threads, 16, "Number of threads looking up cache entries");
+DEFINE_int32(cache_bench_num_keys, 1000, "Number of distinct keys in the cache");
+DEFINE_int32(run_seconds, 1, "Seconds to run the benchmark for each policy");
+
+using std::string;
+using std::thread;
+using std::unique_ptr;
+using std::vector;
+
+namespace kudu {
+
+static string EncodeInt(int k) {
+  faststring result;
+  PutFixed32(&result, k);
+  return result.ToString();
+}
+
+// Measures the throughput of concurrent cache hits. Every key fits in the
+// cache, so this isolates the cost of the read path itself.
+class CacheBench : public KuduTest,
+                   public ::testing::WithParamInterface<CacheEvictionPolicy> {
+ public:
+  CacheBench() : should_run_(true) {}
+
+  void SetUp() override {
+    KuduTest::SetUp();
+    OverrideFlagForSlowTests("run_seconds", "10");
+
+    cache_.reset(NewLRUCache(DRAM_CACHE, 64 * 1024 * 1024, "cache_bench", GetParam()));
+    for (int i = 0; i < FLAGS_cache_bench_num_keys; i++) {
+      string key = EncodeInt(i);
+      Cache::PendingHandle* handle = CHECK_NOTNULL(cache_->Allocate(key, 0, 1));
+      cache_->Release(cache_->Insert(handle, nullptr));
+    }
+  }
+
+  void LookupThread(uint32_t seed, int64_t* lookups) {
+    Random r(seed);
+    int64_t count = 0;
+    while (base::subtle::Acquire_Load(&should_run_)) {
+      string key = EncodeInt(r.Uniform(FLAGS_cache_bench_num_keys));
+      Cache::Handle* h = CHECK_NOTNULL(cache_->Lookup(key, Cache::EXPECT_IN_CACHE));
+      cache_->Release(h);
+      count++;
+    }
+    *lookups = count;
+  }
+
+ protected:
+  unique_ptr<Cache> cache_;
+  Atomic32 should_run_;
+};
+
+INSTANTIATE_TEST_CASE_P(Policies, CacheBench,
+                        ::testing::Values(LRU_POLICY, SLRU_POLICY, CLOCK_POLICY));
+
+TEST_P(CacheBench, ConcurrentLookups) {
+  vector<int64_t> lookups(FLAGS_cache_bench_threads);
+  vector<thread> threads;
+  Stopwatch sw(Stopwatch::ALL_THREADS);
+  sw.start();
+  for (int i = 0; i < FLAGS_cache_bench_threads; i++) {
+    threads.emplace_back(&CacheBench::LookupThread, this, SeedRandom() + i, &lookups[i]);
+  }
+  SleepFor(MonoDelta::FromSeconds(FLAGS_run_seconds));
+  base::subtle::Release_Store(&should_run_, false);
+
+  int64_t total = 0;
+  for (int i = 0; i < threads.size(); i++) {
+    threads[i].join();
+    total += lookups[i];
+  }
+  sw.stop();
+
+  LOG(INFO) << "Policy:      " << GetParam();
+  LOG(INFO) << "Threads:     " << FLAGS_cache_bench_threads;
+  LOG(INFO) << "Lookups/sec: " << total / sw.elapsed().wall_seconds();
+}
+
+} // namespace kudu
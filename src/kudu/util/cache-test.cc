@@ -6,8 +6,9 @@
 #include <gflags/gflags.h>
 #include <gtest/gtest.h>
 #include <memory>
-
+#include <utility>
 #include <vector>
+
 #include "kudu/util/cache.h"
 #include "kudu/util/coding.h"
 #include "kudu/util/mem_tracker.h"
@@ -18,6 +19,9 @@
 DECLARE_string(nvm_cache_path);
 #endif // defined(__linux__)
 
+METRIC_DECLARE_counter(block_cache_probationary_segment_hits);
+METRIC_DECLARE_counter(block_cache_protected_segment_hits);
+
 namespace kudu {
 
 // Conversions between numeric keys/values and the types expected by Cache.
@@ -32,7 +36,7 @@ static int DecodeInt(const Slice& k) {
 }
 
 class CacheTest : public KuduTest,
-                  public ::testing::WithParamInterface<CacheType>,
+                  public ::testing::WithParamInterface<std::pair<CacheType, CacheEvictionPolicy>>,
                   public Cache::EvictionCallback {
  public:
 
@@ -46,6 +50,7 @@ class CacheTest : public KuduTest,
   std::shared_ptr<MemTracker> mem_tracker_;
   gscoped_ptr<Cache> cache_;
   MetricRegistry metric_registry_;
+  scoped_refptr<MetricEntity> entity_;
 
   static const int kCacheSize = 14*1024*1024;
 
@@ -58,18 +63,17 @@ class CacheTest : public KuduTest,
     }
 #endif // defined(__linux__)
 
-    cache_.reset(NewLRUCache(GetParam(), kCacheSize, "cache_test"));
+    cache_.reset(NewLRUCache(GetParam().first, kCacheSize, "cache_test", GetParam().second));
 
     MemTracker::FindTracker("cache_test-sharded_lru_cache", &mem_tracker_);
     // Since nvm cache does not have memtracker due to the use of
     // tcmalloc for this we only check for it in the DRAM case.
-    if (GetParam() == DRAM_CACHE) {
+    if (GetParam().first == DRAM_CACHE) {
       ASSERT_TRUE(mem_tracker_.get());
     }
 
-    scoped_refptr<MetricEntity> entity = METRIC_ENTITY_server.Instantiate(
-        &metric_registry_, "test");
-    cache_->SetMetrics(entity);
+    entity_ = METRIC_ENTITY_server.Instantiate(&metric_registry_, "test");
+    cache_->SetMetrics(entity_);
   }
 
   int Lookup(int key) {
@@ -96,9 +100,16 @@ class CacheTest : public KuduTest,
 };
 
 #if defined(__linux__)
-INSTANTIATE_TEST_CASE_P(CacheTypes, CacheTest, ::testing::Values(DRAM_CACHE, NVM_CACHE));
+INSTANTIATE_TEST_CASE_P(CacheTypes, CacheTest,
+                        ::testing::Values(std::make_pair(DRAM_CACHE, LRU_POLICY),
+                                          std::make_pair(DRAM_CACHE, SLRU_POLICY),
+                                          std::make_pair(DRAM_CACHE, CLOCK_POLICY),
+                                          std::make_pair(NVM_CACHE, LRU_POLICY)));
 #else
-INSTANTIATE_TEST_CASE_P(CacheTypes, CacheTest, ::testing::Values(DRAM_CACHE));
+INSTANTIATE_TEST_CASE_P(CacheTypes, CacheTest,
+                        ::testing::Values(std::make_pair(DRAM_CACHE, LRU_POLICY),
+                                          std::make_pair(DRAM_CACHE, SLRU_POLICY),
+                                          std::make_pair(DRAM_CACHE, CLOCK_POLICY)));
 #endif // defined(__linux__)
 
 TEST_P(CacheTest, TrackMemory) {
@@ -198,6 +209,40 @@ TEST_P(CacheTest, EvictionPolicy) {
   ASSERT_EQ(-1, Lookup(200));
 }
 
+// Entries which were reused should survive a scan over many entries which
+// are each looked up only once.
+TEST_P(CacheTest, ScanResistance) {
+  if (GetParam().second != SLRU_POLICY) {
+    LOG(INFO) << "Only segmented caches are scan-resistant";
+    return;
+  }
+  const int kNumHot = 10;
+  const int kNumElems = 1000;
+  const int kSizePerElem = kCacheSize / kNumElems;
+  for (int i = 0; i < kNumHot; i++) {
+    Insert(i, 100 + i);
+    ASSERT_EQ(100 + i, Lookup(i));
+  }
+
+  // A scan over twice the capacity of the cache, like a full table scan.
+  for (int i = 0; i < kNumElems * 2; i++) {
+    ASSERT_EQ(-1, Lookup(1000 + i));
+    Insert(1000 + i, 2000 + i, kSizePerElem);
+  }
+
+  for (int i = 0; i < kNumHot; i++) {
+    ASSERT_EQ(100 + i, Lookup(i));
+  }
+  ASSERT_EQ(-1, Lookup(1000));
+
+  // The first lookups of the hot entries found them in the probationary
+  // segment, and the last ones in the protected segment.
+  ASSERT_EQ(kNumHot, down_cast<Counter*>(entity_->FindOrNull(
+      METRIC_block_cache_probationary_segment_hits).get())->value());
+  ASSERT_EQ(kNumHot, down_cast<Counter*>(entity_->FindOrNull(
+      METRIC_block_cache_protected_segment_hits).get())->value());
+}
+
 TEST_P(CacheTest, HeavyEntries) {
   // Add a bunch of light and heavy entries and then count the combined
   // size of items still in the cache, which must be approximately the
@@ -225,6 +270,26 @@ TEST_P(CacheTest, HeavyEntries) {
   ASSERT_LE(cached_weight, kCacheSize + kCacheSize/10);
 }
 
+TEST_P(CacheTest, GetAllEntries) {
+  const int kNumEntries = 100;
+  for (int i = 0; i < kNumEntries; i++) {
+    Insert(i, 1000 + i);
+  }
+  std::vector<Cache::Handle*> handles;
+  cache_->GetAllEntries(&handles);
+  ASSERT_EQ(kNumEntries, handles.size());
+
+  std::vector<bool> seen(kNumEntries);
+  for (Cache::Handle* h : handles) {
+    int key = DecodeInt(cache_->Key(h));
+    ASSERT_EQ(1000 + key, DecodeInt(cache_->Value(h)));
+    ASSERT_FALSE(seen[key]);
+    seen[key] = true;
+    cache_->Release(h);
+  }
+  ASSERT_EQ(0, evicted_keys_.size());
+}
+
 TEST_P(CacheTest, NewId) {
   uint64_t a = cache_->NewId();
   uint64_t b = cache_->NewId();
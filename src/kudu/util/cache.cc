@@ -55,6 +55,8 @@ struct LRUHandle {
   uint32_t val_length;
   Atomic32 refs;
   uint32_t hash;      // Hash of key(); used for fast sharding and comparisons
+  bool in_protected_segment;  // See SLRU_POLICY.
+  Atomic32 referenced;        // See CLOCK_POLICY.
 
   // The storage for the key/value pair itself. The data is stored as:
   //   [key bytes ...] [padding up to 8-byte boundary] [value bytes ...]
@@ -164,14 +166,62 @@ class HandleTable {
   }
 };
 
+// Just reduce the reference count by 1.
+// Return true if last reference
+bool Unref(LRUHandle* e) {
+  DCHECK_GT(ANNOTATE_UNPROTECTED_READ(e->refs), 0);
+  return !base::RefCountDec(&e->refs);
+}
+
+// Call the user's eviction callback, if it exists, and free the entry.
+void FreeHandle(LRUHandle* e, MemTracker* mem_tracker, CacheMetrics* metrics) {
+  DCHECK_EQ(ANNOTATE_UNPROTECTED_READ(e->refs), 0);
+  if (e->eviction_callback) {
+    e->eviction_callback->EvictedEntry(e->key(), e->value());
+  }
+  mem_tracker->Release(e->charge);
+  if (PREDICT_TRUE(metrics)) {
+    metrics->cache_usage->DecrementBy(e->charge);
+    metrics->evictions->Increment();
+  }
+  delete [] e;
+}
+
+// Records a lookup in 'metrics', which may be NULL.
+void RecordLookup(CacheMetrics* metrics, bool was_hit, bool caching) {
+  if (!metrics) {
+    return;
+  }
+  metrics->lookups->Increment();
+  if (was_hit) {
+    if (caching) {
+      metrics->cache_hits_caching->Increment();
+    } else {
+      metrics->cache_hits->Increment();
+    }
+  } else {
+    if (caching) {
+      metrics->cache_misses_caching->Increment();
+    } else {
+      metrics->cache_misses->Increment();
+    }
+  }
+}
+
 // A single shard of sharded cache.
 class LRUCache {
  public:
   explicit LRUCache(MemTracker* tracker);
   ~LRUCache();
 
-  // Separate from constructor so caller can easily make an array of LRUCache
-  void SetCapacity(size_t capacity) { capacity_ = capacity; }
+  // Separate from constructor so caller can easily make an array of LRUCache.
+  //
+  // If 'protected_capacity' is non-zero, the cache uses the SLRU_POLICY
+  // eviction policy, with a protected segment of that size.
+  void SetCapacity(size_t capacity, size_t protected_capacity) {
+    capacity_ = capacity;
+    protected_capacity_ = protected_capacity;
+  }
 
   void SetMetrics(CacheMetrics* metrics) { metrics_ = metrics; }
 
@@ -180,27 +230,37 @@ class LRUCache {
   Cache::Handle* Lookup(const Slice& key, uint32_t hash, bool caching);
   void Release(Cache::Handle* handle);
   void Erase(const Slice& key, uint32_t hash);
+  // Appends a new reference to each entry, oldest first.
+  void GetAllEntries(vector<Cache::Handle*>* handles);
 
  private:
   void LRU_Remove(LRUHandle* e);
-  void LRU_Append(LRUHandle* e);
-  // Just reduce the reference count by 1.
-  // Return true if last reference
-  bool Unref(LRUHandle* e);
+  // Make "e" the newest entry of 'list', which is either &lru_ or &protected_.
+  void LRU_Append(LRUHandle* list, LRUHandle* e);
+  // Demotes the oldest protected entries to the probationary segment until
+  // the protected segment fits its capacity.
+  void DemoteProtectedOverflow();
   // Call the user's eviction callback, if it exists, and free the entry.
   void FreeEntry(LRUHandle* e);
 
   // Initialized before use.
   size_t capacity_;
+  size_t protected_capacity_;
 
   // mutex_ protects the following state.
   MutexType mutex_;
   size_t usage_;
+  size_t protected_usage_;
 
   // Dummy head of LRU list.
   // lru.prev is newest entry, lru.next is oldest entry.
+  // With SLRU_POLICY, this is the probationary segment.
   LRUHandle lru_;
 
+  // Dummy head of the protected segment's LRU list. Only used with
+  // SLRU_POLICY.
+  LRUHandle protected_;
+
   HandleTable table_;
 
   MemTracker* mem_tracker_;
@@ -209,86 +269,99 @@ class LRUCache {
 };
 
 LRUCache::LRUCache(MemTracker* tracker)
- : usage_(0),
+ : capacity_(0),
+   protected_capacity_(0),
+   usage_(0),
+   protected_usage_(0),
    mem_tracker_(tracker),
    metrics_(nullptr) {
-  // Make empty circular linked list
+  // Make empty circular linked lists
   lru_.next = &lru_;
   lru_.prev = &lru_;
+  protected_.next = &protected_;
+  protected_.prev = &protected_;
 }
 
 LRUCache::~LRUCache() {
-  for (LRUHandle* e = lru_.next; e != &lru_; ) {
-    LRUHandle* next = e->next;
-    DCHECK_EQ(e->refs, 1);  // Error if caller has an unreleased handle
-    if (Unref(e)) {
-      FreeEntry(e);
+  for (LRUHandle* list : { &lru_, &protected_ }) {
+    for (LRUHandle* e = list->next; e != list; ) {
+      LRUHandle* next = e->next;
+      DCHECK_EQ(e->refs, 1);  // Error if caller has an unreleased handle
+      if (Unref(e)) {
+        FreeEntry(e);
+      }
+      e = next;
     }
-    e = next;
   }
 }
 
-bool LRUCache::Unref(LRUHandle* e) {
-  DCHECK_GT(ANNOTATE_UNPROTECTED_READ(e->refs), 0);
-  return !base::RefCountDec(&e->refs);
-}
-
 void LRUCache::FreeEntry(LRUHandle* e) {
-  DCHECK_EQ(ANNOTATE_UNPROTECTED_READ(e->refs), 0);
-  if (e->eviction_callback) {
-    e->eviction_callback->EvictedEntry(e->key(), e->value());
-  }
-  mem_tracker_->Release(e->charge);
-  if (PREDICT_TRUE(metrics_)) {
-    metrics_->cache_usage->DecrementBy(e->charge);
-    metrics_->evictions->Increment();
-  }
-  delete [] e;
+  FreeHandle(e, mem_tracker_, metrics_);
 }
 
 void LRUCache::LRU_Remove(LRUHandle* e) {
   e->next->prev = e->prev;
   e->prev->next = e->next;
   usage_ -= e->charge;
+  if (e->in_protected_segment) {
+    protected_usage_ -= e->charge;
+    if (PREDICT_TRUE(metrics_)) {
+      metrics_->protected_segment_usage->DecrementBy(e->charge);
+    }
+  }
 }
 
-void LRUCache::LRU_Append(LRUHandle* e) {
-  // Make "e" newest entry by inserting just before lru_
-  e->next = &lru_;
-  e->prev = lru_.prev;
+void LRUCache::LRU_Append(LRUHandle* list, LRUHandle* e) {
+  // Make "e" newest entry by inserting just before the list head
+  e->next = list;
+  e->prev = list->prev;
   e->prev->next = e;
   e->next->prev = e;
   usage_ += e->charge;
+  e->in_protected_segment = list == &protected_;
+  if (e->in_protected_segment) {
+    protected_usage_ += e->charge;
+    if (PREDICT_TRUE(metrics_)) {
+      metrics_->protected_segment_usage->IncrementBy(e->charge);
+    }
+  }
+}
+
+void LRUCache::DemoteProtectedOverflow() {
+  while (protected_usage_ > protected_capacity_ && protected_.next != &protected_) {
+    LRUHandle* old = protected_.next;
+    LRU_Remove(old);
+    LRU_Append(&lru_, old);
+  }
 }
 
 Cache::Handle* LRUCache::Lookup(const Slice& key, uint32_t hash, bool caching) {
   LRUHandle* e;
+  bool was_protected = false;
   {
     std::lock_guard<MutexType> l(mutex_);
     e = table_.Lookup(key, hash);
     if (e != nullptr) {
       base::RefCountInc(&e->refs);
+      was_protected = e->in_protected_segment;
       LRU_Remove(e);
-      LRU_Append(e);
+      if (protected_capacity_ > 0) {
+        // A reused entry is promoted to (or refreshed in) the protected segment.
+        LRU_Append(&protected_, e);
+        DemoteProtectedOverflow();
+      } else {
+        LRU_Append(&lru_, e);
+      }
     }
   }
 
   // Do the metrics outside of the lock.
-  if (metrics_) {
-    metrics_->lookups->Increment();
-    bool was_hit = (e != nullptr);
-    if (was_hit) {
-      if (caching) {
-        metrics_->cache_hits_caching->Increment();
-      } else {
-        metrics_->cache_hits->Increment();
-      }
+  RecordLookup(metrics_, e != nullptr, caching);
+  if (metrics_ && e != nullptr && protected_capacity_ > 0) {
+    if (was_protected) {
+      metrics_->protected_segment_hits->Increment();
     } else {
-      if (caching) {
-        metrics_->cache_misses_caching->Increment();
-      } else {
-        metrics_->cache_misses->Increment();
-      }
+      metrics_->probationary_segment_hits->Increment();
     }
   }
 
@@ -319,7 +392,8 @@ Cache::Handle* LRUCache::Insert(LRUHandle* e, Cache::EvictionCallback *eviction_
   {
     std::lock_guard<MutexType> l(mutex_);
 
-    LRU_Append(e);
+    // New entries always start out in the probationary segment.
+    LRU_Append(&lru_, e);
 
     LRUHandle* old = table_.Insert(e);
     if (old != nullptr) {
@@ -330,8 +404,16 @@ Cache::Handle* LRUCache::Insert(LRUHandle* e, Cache::EvictionCallback *eviction_
       }
     }
 
-    while (usage_ > capacity_ && lru_.next != &lru_) {
-      LRUHandle* old = lru_.next;
+    while (usage_ > capacity_) {
+      // Only evict protected entries once no probationary one is left.
+      LRUHandle* old;
+      if (lru_.next != &lru_) {
+        old = lru_.next;
+      } else if (protected_.next != &protected_) {
+        old = protected_.next;
+      } else {
+        break;
+      }
       LRU_Remove(old);
       table_.Remove(old->key(), old->hash);
       if (Unref(old)) {
@@ -370,6 +452,241 @@ void LRUCache::Erase(const Slice& key, uint32_t hash) {
   }
 }
 
+void LRUCache::GetAllEntries(vector<Cache::Handle*>* handles) {
+  std::lock_guard<MutexType> l(mutex_);
+  // Probationary entries are evicted before protected ones.
+  for (LRUHandle* list : { &lru_, &protected_ }) {
+    for (LRUHandle* e = list->next; e != list; e = e->next) {
+      base::RefCountInc(&e->refs);
+      handles->push_back(reinterpret_cast<Cache::Handle*>(e));
+    }
+  }
+}
+
+// A single shard of a cache using the CLOCK_POLICY eviction policy.
+//
+// Lookups only take the shard's lock in shared mode: rather than moving the
+// entry to the head of a recency list, a hit just sets the entry's reference
+// bit. Inserts and erases take the lock exclusively. Entries are kept in a
+// ring which a "clock hand" sweeps when space is needed, clearing the
+// reference bits it passes and evicting the first entry whose bit is clear.
+class ClockCache {
+ public:
+  explicit ClockCache(MemTracker* tracker);
+  ~ClockCache();
+
+  // Separate from constructor so caller can easily make an array of ClockCache.
+  void SetCapacity(size_t capacity, size_t protected_capacity) {
+    DCHECK_EQ(0, protected_capacity);
+    capacity_ = capacity;
+  }
+
+  void SetMetrics(CacheMetrics* metrics) { metrics_ = metrics; }
+
+  Cache::Handle* Insert(LRUHandle* handle, Cache::EvictionCallback* eviction_callback);
+  // Like Cache::Lookup, but with an extra "hash" parameter.
+  Cache::Handle* Lookup(const Slice& key, uint32_t hash, bool caching);
+  void Release(Cache::Handle* handle);
+  void Erase(const Slice& key, uint32_t hash);
+  // Appends a new reference to each entry, in the order the hand visits them.
+  void GetAllEntries(vector<Cache::Handle*>* handles);
+
+ private:
+  void Ring_Remove(LRUHandle* e);
+  // Make "e" the last entry the hand will visit.
+  void Ring_Append(LRUHandle* e);
+  // Call the user's eviction callback, if it exists, and free the entry.
+  void FreeEntry(LRUHandle* e);
+
+  // Initialized before use.
+  size_t capacity_;
+
+  // lock_ protects the following state. Lookups only need it in shared mode,
+  // and may only modify entries' reference bits.
+  percpu_rwlock lock_;
+  size_t usage_;
+
+  // Dummy head of the ring of entries, which the hand skips over.
+  LRUHandle ring_;
+
+  // The next entry to be considered for eviction, or &ring_.
+  LRUHandle* hand_;
+
+  HandleTable table_;
+
+  MemTracker* mem_tracker_;
+
+  CacheMetrics* metrics_;
+};
+
+ClockCache::ClockCache(MemTracker* tracker)
+ : capacity_(0),
+   usage_(0),
+   hand_(&ring_),
+   mem_tracker_(tracker),
+   metrics_(nullptr) {
+  // Make empty circular linked list
+  ring_.next = &ring_;
+  ring_.prev = &ring_;
+}
+
+ClockCache::~ClockCache() {
+  for (LRUHandle* e = ring_.next; e != &ring_; ) {
+    LRUHandle* next = e->next;
+    DCHECK_EQ(e->refs, 1);  // Error if caller has an unreleased handle
+    if (Unref(e)) {
+      FreeEntry(e);
+    }
+    e = next;
+  }
+}
+
+void ClockCache::FreeEntry(LRUHandle* e) {
+  FreeHandle(e, mem_tracker_, metrics_);
+}
+
+void ClockCache::Ring_Remove(LRUHandle* e) {
+  if (hand_ == e) {
+    hand_ = e->next;
+  }
+  e->next->prev = e->prev;
+  e->prev->next = e->next;
+  usage_ -= e->charge;
+}
+
+void ClockCache::Ring_Append(LRUHandle* e) {
+  // Insert just behind the hand, so that "e" is visited after every other entry.
+  e->next = hand_;
+  e->prev = hand_->prev;
+  e->prev->next = e;
+  e->next->prev = e;
+  usage_ += e->charge;
+}
+
+Cache::Handle* ClockCache::Lookup(const Slice& key, uint32_t hash, bool caching) {
+  LRUHandle* e;
+  {
+    shared_lock<rw_spinlock> l(lock_.get_lock());
+    e = table_.Lookup(key, hash);
+    if (e != nullptr) {
+      base::RefCountInc(&e->refs);
+      // Avoid dirtying the entry's cache line when the bit is already set.
+      if (!base::subtle::NoBarrier_Load(&e->referenced)) {
+        base::subtle::NoBarrier_Store(&e->referenced, 1);
+      }
+    }
+  }
+
+  // Do the metrics outside of the lock.
+  RecordLookup(metrics_, e != nullptr, caching);
+
+  return reinterpret_cast<Cache::Handle*>(e);
+}
+
+void ClockCache::Release(Cache::Handle* handle) {
+  LRUHandle* e = reinterpret_cast<LRUHandle*>(handle);
+  bool last_reference = Unref(e);
+  if (last_reference) {
+    FreeEntry(e);
+  }
+}
+
+Cache::Handle* ClockCache::Insert(LRUHandle* e, Cache::EvictionCallback *eviction_callback) {
+  // Set the remaining LRUHandle members which were not already allocated during
+  // Allocate(). New entries start out referenced so that the hand does not
+  // evict them before it has passed every older entry.
+  e->eviction_callback = eviction_callback;
+  e->refs = 2;  // One from ClockCache, one for the returned handle
+  e->referenced = 1;
+  mem_tracker_->Consume(e->charge);
+  if (PREDICT_TRUE(metrics_)) {
+    metrics_->cache_usage->IncrementBy(e->charge);
+    metrics_->inserts->Increment();
+  }
+
+  LRUHandle* to_remove_head = nullptr;
+  {
+    std::lock_guard<percpu_rwlock> l(lock_);
+
+    LRUHandle* old = table_.Insert(e);
+    if (old != nullptr) {
+      Ring_Remove(old);
+      if (Unref(old)) {
+        old->next = to_remove_head;
+        to_remove_head = old;
+      }
+    }
+    Ring_Append(e);
+
+    // Every pass of the hand clears the bits it finds set, so this
+    // terminates after at most two revolutions.
+    while (usage_ > capacity_ && ring_.next != &ring_) {
+      if (hand_ == &ring_) {
+        hand_ = ring_.next;
+      }
+      LRUHandle* old = hand_;
+      if (base::subtle::NoBarrier_Load(&old->referenced)) {
+        base::subtle::NoBarrier_Store(&old->referenced, 0);
+        hand_ = old->next;
+        continue;
+      }
+      Ring_Remove(old);
+      table_.Remove(old->key(), old->hash);
+      if (Unref(old)) {
+        old->next = to_remove_head;
+        to_remove_head = old;
+      }
+    }
+  }
+
+  // we free the entries here outside of the lock for
+  // performance reasons
+  while (to_remove_head != nullptr) {
+    LRUHandle* next = to_remove_head->next;
+    FreeEntry(to_remove_head);
+    to_remove_head = next;
+  }
+
+  return reinterpret_cast<Cache::Handle*>(e);
+}
+
+void ClockCache::Erase(const Slice& key, uint32_t hash) {
+  LRUHandle* e;
+  bool last_reference = false;
+  {
+    std::lock_guard<percpu_rwlock> l(lock_);
+    e = table_.Remove(key, hash);
+    if (e != nullptr) {
+      Ring_Remove(e);
+      last_reference = Unref(e);
+    }
+  }
+  // lock not held here
+  // last_reference will only be true if e != NULL
+  if (last_reference) {
+    FreeEntry(e);
+  }
+}
+
+void ClockCache::GetAllEntries(vector<Cache::Handle*>* handles) {
+  std::lock_guard<percpu_rwlock> l(lock_);
+  if (ring_.next == &ring_) {
+    return;
+  }
+  LRUHandle* e = hand_;
+  do {
+    if (e != &ring_) {
+      base::RefCountInc(&e->refs);
+      handles->push_back(reinterpret_cast<Cache::Handle*>(e));
+    }
+    e = e->next;
+  } while (e != hand_);
+}
+
+// The fraction of the capacity of an SLRU_POLICY cache given to its
+// protected segment.
+const double kProtectedSegmentRatio = 0.8;
+
 // Determine the number of bits of the hash that should be used to determine
 // the cache shard. This, in turn, determines the number of shards.
 int DetermineShardBits() {
@@ -378,11 +695,13 @@ int DetermineShardBits() {
   return bits;
 }
 
+// 'ShardType' is either LRUCache or ClockCache.
+template<class ShardType>
 class ShardedLRUCache : public Cache {
  private:
   shared_ptr<MemTracker> mem_tracker_;
   gscoped_ptr<CacheMetrics> metrics_;
-  vector<LRUCache*> shards_;
+  vector<ShardType*> shards_;
   MutexType id_mutex_;
   uint64_t last_id_;
 
@@ -399,7 +718,7 @@ class ShardedLRUCache : public Cache {
   }
 
  public:
-  explicit ShardedLRUCache(size_t capacity, const string& id)
+  ShardedLRUCache(size_t capacity, const string& id, CacheEvictionPolicy policy)
       : last_id_(0),
         shard_bits_(DetermineShardBits()) {
     // A cache is often a singleton, so:
@@ -410,9 +729,11 @@ class ShardedLRUCache : public Cache {
 
     int num_shards = 1 << shard_bits_;
     const size_t per_shard = (capacity + (num_shards - 1)) / num_shards;
+    const size_t protected_per_shard =
+        policy == SLRU_POLICY ? per_shard * kProtectedSegmentRatio : 0;
     for (int s = 0; s < num_shards; s++) {
-      gscoped_ptr<LRUCache> shard(new LRUCache(mem_tracker_.get()));
-      shard->SetCapacity(per_shard);
+      gscoped_ptr<ShardType> shard(new ShardType(mem_tracker_.get()));
+      shard->SetCapacity(per_shard, protected_per_shard);
       shards_.push_back(shard.release());
     }
   }
@@ -441,6 +762,14 @@ class ShardedLRUCache : public Cache {
   virtual Slice Value(Handle* handle) OVERRIDE {
     return reinterpret_cast<LRUHandle*>(handle)->value();
   }
+  virtual Slice Key(Handle* handle) OVERRIDE {
+    return reinterpret_cast<LRUHandle*>(handle)->key();
+  }
+  virtual void GetAllEntries(vector<Handle*>* handles) OVERRIDE {
+    for (ShardType* shard : shards_) {
+      shard->GetAllEntries(handles);
+    }
+  }
   virtual uint64_t NewId() OVERRIDE {
     std::lock_guard<MutexType> l(id_mutex_);
     return ++(last_id_);
@@ -448,7 +777,7 @@ class ShardedLRUCache : public Cache {
 
   virtual void SetMetrics(const scoped_refptr<MetricEntity>& entity) OVERRIDE {
     metrics_.reset(new CacheMetrics(entity));
-    for (LRUCache* cache : shards_) {
+    for (ShardType* cache : shards_) {
       cache->SetMetrics(metrics_.get());
     }
   }
@@ -485,12 +814,17 @@ class ShardedLRUCache : public Cache {
 
 }  // end anonymous namespace
 
-Cache* NewLRUCache(CacheType type, size_t capacity, const string& id) {
+Cache* NewLRUCache(CacheType type, size_t capacity, const string& id,
+                   CacheEvictionPolicy policy) {
   switch (type) {
     case DRAM_CACHE:
-      return new ShardedLRUCache(capacity, id);
+      if (policy == CLOCK_POLICY) {
+        return new ShardedLRUCache<ClockCache>(capacity, id, policy);
+      }
+      return new ShardedLRUCache<LRUCache>(capacity, id, policy);
 #if !defined(__APPLE__)
     case NVM_CACHE:
+      CHECK_EQ(LRU_POLICY, policy) << "NVM caches only support LRU eviction";
       return NewLRUNvmCache(capacity, id);
 #endif
     default:
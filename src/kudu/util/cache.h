@@ -20,6 +20,7 @@
 
 #include <stdint.h>
 #include <string>
+#include <vector>
 
 #include "kudu/gutil/macros.h"
 #include "kudu/gutil/ref_counted.h"
@@ -36,9 +37,31 @@ enum CacheType {
   NVM_CACHE
 };
 
+enum CacheEvictionPolicy {
+  // Evict the least-recently-used entry.
+  LRU_POLICY,
+
+  // Segmented LRU. New entries enter a probationary segment, and are only
+  // promoted to a protected segment when they are looked up again. Entries
+  // are evicted from the probationary segment first. Entries which overflow
+  // the protected segment are demoted back to the probationary one.
+  //
+  // This makes the cache resistant to scans: a single pass over many
+  // entries can only displace other entries which were never reused.
+  SLRU_POLICY,
+
+  // CLOCK, an approximation of LRU. A hit only sets a reference bit on the
+  // entry instead of reordering a list, so lookups do not contend on the
+  // shard's mutex. This suits caches with many concurrent readers.
+  CLOCK_POLICY
+};
+
 // Create a new cache with a fixed size capacity.  This implementation
-// of Cache uses a least-recently-used eviction policy.
-Cache* NewLRUCache(CacheType type, size_t capacity, const std::string& id);
+// of Cache uses a least-recently-used eviction policy, or its segmented
+// variant or approximation selected by 'policy'. NVM caches only support
+// LRU_POLICY.
+Cache* NewLRUCache(CacheType type, size_t capacity, const std::string& id,
+                   CacheEvictionPolicy policy = LRU_POLICY);
 
 class Cache {
  public:
@@ -87,6 +110,18 @@ class Cache {
   // REQUIRES: handle must have been returned by a method on *this.
   virtual Slice Value(Handle* handle) = 0;
 
+  // Return the key of the entry referred to by a handle.
+  // REQUIRES: handle must not have been released yet.
+  // REQUIRES: handle must have been returned by a method on *this.
+  virtual Slice Key(Handle* handle) = 0;
+
+  // Appends a handle to every entry currently in the cache to 'handles'.
+  // Within each shard, entries are ordered from the first to the last to be
+  // evicted. The caller must Release() each of the handles.
+  //
+  // This is meant for saving the contents of a cache, e.g. at shutdown.
+  virtual void GetAllEntries(std::vector<Handle*>* handles) = 0;
+
   // If the cache contains entry for key, erase it.  Note that the
   // underlying entry will be kept around until all existing handles
   // to it have been released.
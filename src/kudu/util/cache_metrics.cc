@@ -45,9 +45,24 @@ METRIC_DEFINE_counter(server, block_cache_hits_caching,
                       "Use this number instead of cache_hits when trying to determine how "
                       "efficient the cache is");
 
+METRIC_DEFINE_counter(server, block_cache_probationary_segment_hits,
+                      "Block Cache Probationary Segment Hits", kudu::MetricUnit::kBlocks,
+                      "Number of lookups that found a block in the probationary segment "
+                      "of a segmented LRU cache. These blocks are then promoted to the "
+                      "protected segment.");
+METRIC_DEFINE_counter(server, block_cache_protected_segment_hits,
+                      "Block Cache Protected Segment Hits", kudu::MetricUnit::kBlocks,
+                      "Number of lookups that found a block in the protected segment "
+                      "of a segmented LRU cache");
+
 METRIC_DEFINE_gauge_uint64(server, block_cache_usage, "Block Cache Memory Usage",
                            kudu::MetricUnit::kBytes,
                            "Memory consumed by the block cache");
+METRIC_DEFINE_gauge_uint64(server, block_cache_protected_segment_usage,
+                           "Block Cache Protected Segment Memory Usage",
+                           kudu::MetricUnit::kBytes,
+                           "Memory consumed by the protected segment of a segmented "
+                           "LRU block cache");
 
 namespace kudu {
 
@@ -61,7 +76,10 @@ CacheMetrics::CacheMetrics(const scoped_refptr<MetricEntity>& entity)
     MINIT(cache_hits_caching, block_cache_hits_caching),
     MINIT(cache_misses, block_cache_misses),
     MINIT(cache_misses_caching, block_cache_misses_caching),
-    GINIT(cache_usage, block_cache_usage) {
+    MINIT(probationary_segment_hits, block_cache_probationary_segment_hits),
+    MINIT(protected_segment_hits, block_cache_protected_segment_hits),
+    GINIT(cache_usage, block_cache_usage),
+    GINIT(protected_segment_usage, block_cache_protected_segment_usage) {
 }
 #undef MINIT
 #undef GINIT
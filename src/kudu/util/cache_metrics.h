@@ -40,7 +40,12 @@ struct CacheMetrics {
   scoped_refptr<Counter> cache_misses;
   scoped_refptr<Counter> cache_misses_caching;
 
+  // Only maintained by caches with the SLRU_POLICY eviction policy.
+  scoped_refptr<Counter> probationary_segment_hits;
+  scoped_refptr<Counter> protected_segment_hits;
+
   scoped_refptr<AtomicGauge<uint64_t> > cache_usage;
+  scoped_refptr<AtomicGauge<uint64_t> > protected_segment_usage;
 };
 
 } // namespace kudu
@@ -19,6 +19,7 @@
 
 #include <glog/logging.h>
 #include <algorithm>
+#include <atomic>
 
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/macros.h"
@@ -35,7 +36,7 @@ namespace kudu {
 template<class State>
 class CowObject {
  public:
-  CowObject() {}
+  CowObject() : version_(0) {}
   ~CowObject() {}
 
   void ReadLock() const {
@@ -69,9 +70,16 @@ class CowObject {
     CHECK(dirty_state_);
     std::swap(state_, *dirty_state_);
     dirty_state_.reset();
+    version_.fetch_add(1, std::memory_order_release);
     lock_.CommitUnlock();
   }
 
+  // Return the number of committed mutations. May be called without holding
+  // the lock, to check whether the state changed since it was last read.
+  uint64_t version() const {
+    return version_.load(std::memory_order_acquire);
+  }
+
   // Return the current state, not reflecting any in-progress mutations.
   State& state() {
     DCHECK(lock_.HasReaders() || lock_.HasWriteLock());
@@ -99,6 +107,7 @@ class CowObject {
 
   State state_;
   gscoped_ptr<State> dirty_state_;
+  std::atomic<uint64_t> version_;
 
   DISALLOW_COPY_AND_ASSIGN(CowObject);
 };
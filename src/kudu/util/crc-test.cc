@@ -58,6 +58,24 @@ TEST_F(CrcTest, TestCRC32C) {
   ASSERT_EQ(0xa9421b7, data_crc); // Known value from crcutil usage test program.
 }
 
+TEST_F(CrcTest, TestExtendAndCopy) {
+  const string test_data("abcdefgh");
+  uint32_t expected = Crc32c(test_data.data(), test_data.length());
+  ASSERT_EQ(expected, Crc32cExtend(Crc32c(test_data.data(), 3), test_data.data() + 3,
+                                   test_data.length() - 3));
+
+  // Copy more than one chunk's worth of data.
+  gscoped_ptr<const uint8_t[]> data;
+  const uint8_t* buf;
+  size_t buflen;
+  GenerateBenchmarkData(&buf, &buflen);
+  data.reset(buf);
+  gscoped_ptr<uint8_t[]> copy(new uint8_t[buflen]);
+  uint32_t prefix_crc = Crc32c(buf, 100);
+  ASSERT_EQ(Crc32c(buf, buflen), Crc32cCopy(prefix_crc, copy.get(), buf + 100, buflen - 100));
+  ASSERT_EQ(0, memcmp(buf + 100, copy.get(), buflen - 100));
+}
+
 // Simple benchmark of CRC32C throughput.
 // We should expect about 8 bytes per cycle in throughput on a single core.
 TEST_F(CrcTest, BenchmarkCRC32C) {
@@ -16,6 +16,9 @@
 // under the License.
 #include "kudu/util/crc.h"
 
+#include <algorithm>
+#include <string.h>
+
 #include <crcutil/interface.h>
 
 #include "kudu/gutil/once.h"
@@ -26,6 +29,10 @@ namespace crc {
 
 using debug::ScopedLeakCheckDisabler;
 
+// The size of the chunks copied and checksummed at a time by Crc32cCopy(),
+// chosen to stay well within the L1 data cache.
+static const size_t kCopyChunkSize = 4096;
+
 static GoogleOnceType crc32c_once = GOOGLE_ONCE_INIT;
 static Crc* crc32c_instance = nullptr;
 
@@ -46,5 +53,27 @@ uint32_t Crc32c(const void* data, size_t length) {
   return static_cast<uint32_t>(crc32); // Only uses lower 32 bits.
 }
 
+uint32_t Crc32cExtend(uint32_t crc, const void* data, size_t length) {
+  uint64_t crc32 = crc;
+  GetCrc32cInstance()->Compute(data, length, &crc32);
+  return static_cast<uint32_t>(crc32);
+}
+
+uint32_t Crc32cCopy(uint32_t crc, void* dst, const void* src, size_t length) {
+  Crc* instance = GetCrc32cInstance();
+  uint64_t crc32 = crc;
+  uint8_t* d = static_cast<uint8_t*>(dst);
+  const uint8_t* s = static_cast<const uint8_t*>(src);
+  while (length > 0) {
+    size_t n = std::min(length, kCopyChunkSize);
+    memcpy(d, s, n);
+    instance->Compute(d, n, &crc32);
+    d += n;
+    s += n;
+    length -= n;
+  }
+  return static_cast<uint32_t>(crc32);
+}
+
 } // namespace crc
 } // namespace kudu
@@ -33,6 +33,15 @@ Crc* GetCrc32cInstance();
 // Helper function to simply calculate a CRC32C of the given data.
 uint32_t Crc32c(const void* data, size_t length);
 
+// Returns the CRC32C of the data whose CRC32C is 'crc', followed by 'data'.
+uint32_t Crc32cExtend(uint32_t crc, const void* data, size_t length);
+
+// Copies 'length' bytes from 'src' to 'dst' and returns the CRC32C of the data
+// whose CRC32C is 'crc' followed by the copied bytes. The copy is done in
+// cache-sized chunks which are checksummed right after being copied, so the
+// data is only brought into cache once rather than for separate passes.
+uint32_t Crc32cCopy(uint32_t crc, void* dst, const void* src, size_t length);
+
 } // namespace crc
 } // namespace kudu
 
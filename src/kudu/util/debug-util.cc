@@ -20,6 +20,7 @@
 #include <execinfo.h>
 #include <dirent.h>
 #include <glog/logging.h>
+#include <sched.h>
 #include <signal.h>
 #include <string>
 #include <sys/syscall.h>
@@ -28,6 +29,7 @@
 #include "kudu/gutil/spinlock.h"
 #include "kudu/gutil/stringprintf.h"
 #include "kudu/gutil/strings/numbers.h"
+#include "kudu/gutil/strings/substitute.h"
 #include "kudu/util/env.h"
 #include "kudu/util/errno.h"
 #include "kudu/util/monotime.h"
@@ -223,13 +225,30 @@ Status SetStackTraceSignal(int signum) {
 }
 
 std::string DumpThreadStack(int64_t tid) {
+  StackTrace stack;
+  // We give the thread ~1s to respond. In testing, threads typically respond within
+  // a few iterations of the loop, so this timeout is very conservative.
+  Status s = GetThreadStack(tid, &stack, MonoDelta::FromSeconds(1));
+  if (s.IsNotFound()) {
+    return "(unable to deliver signal: process may have exited)";
+  }
+  if (s.IsTimedOut()) {
+    return "(thread did not respond: maybe it is blocking signals)";
+  }
+  if (!s.ok()) {
+    return strings::Substitute("<unable to take thread stack: $0>", s.ToString());
+  }
+  return stack.Symbolize();
+}
+
+Status GetThreadStack(int64_t tid, StackTrace* stack, const MonoDelta& timeout) {
 #if defined(__linux__)
   base::SpinLockHolder h(&g_dumper_thread_lock);
 
   // Ensure that our signal handler is installed. We don't need any fancy GoogleOnce here
   // because of the mutex above.
   if (!InitSignalHandlerUnlocked(g_stack_trace_signum)) {
-    return "<unable to take thread stack: signal handler unavailable>";
+    return Status::ServiceUnavailable("signal handler unavailable");
   }
 
   // Set the target TID in our communication structure, so if we end up with any
@@ -248,38 +267,44 @@ std::string DumpThreadStack(int64_t tid) {
       SignalCommunication::Lock l;
       g_comm.target_tid = 0;
     }
-    return "(unable to deliver signal: process may have exited)";
+    return Status::NotFound("unable to deliver signal: process may have exited");
   }
 
-  // We give the thread ~1s to respond. In testing, threads typically respond within
-  // a few iterations of the loop, so this timeout is very conservative.
-  //
   // The main reason that a thread would not respond is that it has blocked signals. For
   // example, glibc's timer_thread doesn't respond to our signal, so we always time out
   // on that one.
-  string ret;
+  //
+  // Threads usually respond within microseconds, so poll quickly at first
+  // rather than sleeping, which matters to callers sampling many threads.
+  MonoTime deadline = MonoTime::Now() + timeout;
   int i = 0;
-  while (!base::subtle::Acquire_Load(&g_comm.result_ready) &&
-         i++ < 100) {
-    SleepFor(MonoDelta::FromMilliseconds(10));
+  while (!base::subtle::Acquire_Load(&g_comm.result_ready)) {
+    if (i++ < 100) {
+      sched_yield();
+    } else if (MonoTime::Now() < deadline) {
+      SleepFor(MonoDelta::FromMilliseconds(1));
+    } else {
+      break;
+    }
   }
 
+  Status s;
   {
     SignalCommunication::Lock l;
     CHECK_EQ(tid, g_comm.target_tid);
 
     if (!g_comm.result_ready) {
-      ret = "(thread did not respond: maybe it is blocking signals)";
+      s = Status::TimedOut("thread did not respond: maybe it is blocking signals");
     } else {
-      ret = g_comm.stack.Symbolize();
+      stack->CopyFrom(g_comm.stack);
     }
 
     g_comm.target_tid = 0;
     g_comm.result_ready = 0;
   }
-  return ret;
+  return s;
 #else // defined(__linux__)
-  return "(unsupported platform)";
+  return Status::NotSupported("unsupported platform");
 #endif
 }
 
@@ -368,44 +393,48 @@ string StackTrace::Symbolize() const {
   string ret;
   for (int i = 0; i < num_frames_; i++) {
     void* pc = frames_[i];
-
-    char tmp[1024];
-    const char* symbol = "(unknown)";
-
-    // The return address 'pc' on the stack is the address of the instruction
-    // following the 'call' instruction. In the case of calling a function annotated
-    // 'noreturn', this address may actually be the first instruction of the next
-    // function, because the function we care about ends with the 'call'.
-    // So, we subtract 1 from 'pc' so that we're pointing at the 'call' instead
-    // of the return address.
-    //
-    // For example, compiling a C program with -O2 that simply calls 'abort()' yields
-    // the following disassembly:
-    //     Disassembly of section .text:
-    //
-    //     0000000000400440 <main>:
-    //       400440:	48 83 ec 08          	sub    $0x8,%rsp
-    //       400444:	e8 c7 ff ff ff       	callq  400410 <abort@plt>
-    //
-    //     0000000000400449 <_start>:
-    //       400449:	31 ed                	xor    %ebp,%ebp
-    //       ...
-    //
-    // If we were to take a stack trace while inside 'abort', the return pointer
-    // on the stack would be 0x400449 (the first instruction of '_start'). By subtracting
-    // 1, we end up with 0x400448, which is still within 'main'.
-    //
-    // This also ensures that we point at the correct line number when using addr2line
-    // on logged stacks.
-    if (google::Symbolize(
-            reinterpret_cast<char *>(pc) - 1, tmp, sizeof(tmp))) {
-      symbol = tmp;
-    }
-    StringAppendF(&ret, "    @ %*p  %s\n", kPrintfPointerFieldWidth, pc, symbol);
+    StringAppendF(&ret, "    @ %*p  %s\n", kPrintfPointerFieldWidth, pc,
+                  SymbolizeFrame(pc).c_str());
   }
   return ret;
 }
 
+string StackTrace::SymbolizeFrame(void* pc) {
+  char tmp[1024];
+  const char* symbol = "(unknown)";
+
+  // The return address 'pc' on the stack is the address of the instruction
+  // following the 'call' instruction. In the case of calling a function annotated
+  // 'noreturn', this address may actually be the first instruction of the next
+  // function, because the function we care about ends with the 'call'.
+  // So, we subtract 1 from 'pc' so that we're pointing at the 'call' instead
+  // of the return address.
+  //
+  // For example, compiling a C program with -O2 that simply calls 'abort()' yields
+  // the following disassembly:
+  //     Disassembly of section .text:
+  //
+  //     0000000000400440 <main>:
+  //       400440:	48 83 ec 08          	sub    $0x8,%rsp
+  //       400444:	e8 c7 ff ff ff       	callq  400410 <abort@plt>
+  //
+  //     0000000000400449 <_start>:
+  //       400449:	31 ed                	xor    %ebp,%ebp
+  //       ...
+  //
+  // If we were to take a stack trace while inside 'abort', the return pointer
+  // on the stack would be 0x400449 (the first instruction of '_start'). By subtracting
+  // 1, we end up with 0x400448, which is still within 'main'.
+  //
+  // This also ensures that we point at the correct line number when using addr2line
+  // on logged stacks.
+  if (google::Symbolize(
+          reinterpret_cast<char *>(pc) - 1, tmp, sizeof(tmp))) {
+    symbol = tmp;
+  }
+  return symbol;
+}
+
 string StackTrace::ToLogFormatHexString() const {
   string ret;
   for (int i = 0; i < num_frames_; i++) {
@@ -23,6 +23,7 @@
 #include <vector>
 
 #include "kudu/gutil/strings/fastmem.h"
+#include "kudu/util/monotime.h"
 #include "kudu/util/status.h"
 
 namespace kudu {
@@ -57,6 +58,16 @@ Status SetStackTraceSignal(int signum);
 // may be active at a time.
 std::string DumpThreadStack(int64_t tid);
 
+class StackTrace;
+
+// Collect the stack trace of the given thread into 'stack', without
+// symbolizing it. Waits for up to 'timeout' for the thread to respond.
+//
+// Returns Status::NotFound if the thread doesn't exist, and
+// Status::TimedOut if it did not respond, e.g. because it blocks signals.
+// The same restrictions as DumpThreadStack() apply.
+Status GetThreadStack(int64_t tid, StackTrace* stack, const MonoDelta& timeout);
+
 // Return the current stack trace, stringified.
 std::string GetStackTrace();
 
@@ -106,7 +117,7 @@ class StackTrace {
     memcpy(this, &s, sizeof(s));
   }
 
-  bool Equals(const StackTrace& s) {
+  bool Equals(const StackTrace& s) const {
     return s.num_frames_ == num_frames_ &&
       strings::memeq(frames_, s.frames_,
                      num_frames_ * sizeof(frames_[0]));
@@ -153,6 +164,18 @@ class StackTrace {
 
   uint64_t HashCode() const;
 
+  int num_frames() const { return num_frames_; }
+
+  // Return the address of the 'idx'th frame, the innermost frame first.
+  void* frame(int idx) const {
+    return frames_[idx];
+  }
+
+  // Return the name of the function containing the return address 'pc' of a
+  // frame, or "(unknown)" if it can't be symbolized.
+  // This is not async-safe.
+  static std::string SymbolizeFrame(void* pc);
+
  private:
   enum {
     // The maximum number of stack frames to collect.
@@ -0,0 +1,145 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#include "kudu/util/debug/binary_trace.h"
+
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gflags/gflags.h>
+#include <gtest/gtest.h>
+
+#include "kudu/util/jsonreader.h"
+#include "kudu/util/test_macros.h"
+#include "kudu/util/test_util.h"
+
+DECLARE_int32(binary_trace_ring_size);
+
+using std::string;
+using std::vector;
+
+namespace kudu {
+namespace debug {
+
+class BinaryTraceTest : public KuduTest {
+ public:
+  void TearDown() override {
+    // The flag saver doesn't run the flag's validator, so restore the
+    // enabled categories explicitly.
+    ASSERT_NE("", google::SetCommandLineOption("binary_trace_categories", "all"));
+    KuduTest::TearDown();
+  }
+};
+
+TEST_F(BinaryTraceTest, TestScopedEvents) {
+  {
+    BINARY_TRACE_SCOPE(kBinaryTraceWrite, "outer");
+    BINARY_TRACE_SET_ARG(42);
+    {
+      BINARY_TRACE_SCOPE_ARG(kBinaryTraceScan, "inner", 7);
+    }
+  }
+  BINARY_TRACE_ELAPSED(kBinaryTraceWal, "elapsed", 1000, 0);
+
+  vector<BinaryTracer::Event> events;
+  BinaryTracer::GetCurrentThreadEventsForTests(&events);
+  ASSERT_GE(events.size(), 3);
+  const BinaryTracer::Event* e = &events[events.size() - 3];
+
+  // Events are recorded when they end.
+  ASSERT_STREQ("inner", e[0].name);
+  ASSERT_EQ(kBinaryTraceScan, e[0].category);
+  ASSERT_EQ(7, e[0].arg);
+  ASSERT_STREQ("outer", e[1].name);
+  ASSERT_EQ(kBinaryTraceWrite, e[1].category);
+  ASSERT_EQ(42, e[1].arg);
+  ASSERT_LE(e[1].start_us, e[0].start_us);
+  ASSERT_GE(e[1].start_us + e[1].duration_us, e[0].start_us + e[0].duration_us);
+  ASSERT_STREQ("elapsed", e[2].name);
+  ASSERT_EQ(1000, e[2].duration_us);
+}
+
+TEST_F(BinaryTraceTest, TestDisabledCategories) {
+  ASSERT_NE("", google::SetCommandLineOption("binary_trace_categories", "wal,scan"));
+  ASSERT_FALSE(BinaryTracer::Enabled(kBinaryTraceWrite));
+  ASSERT_TRUE(BinaryTracer::Enabled(kBinaryTraceWal));
+  ASSERT_TRUE(BinaryTracer::Enabled(kBinaryTraceScan));
+  ASSERT_EQ("", google::SetCommandLineOption("binary_trace_categories", "bogus"));
+
+  vector<BinaryTracer::Event> before;
+  BinaryTracer::GetCurrentThreadEventsForTests(&before);
+  {
+    BINARY_TRACE_SCOPE(kBinaryTraceWrite, "disabled");
+  }
+  vector<BinaryTracer::Event> after;
+  BinaryTracer::GetCurrentThreadEventsForTests(&after);
+  ASSERT_EQ(before.size(), after.size());
+}
+
+TEST_F(BinaryTraceTest, TestRingWrapsAround) {
+  // The ring size is read by each thread when it records its first event.
+  FLAGS_binary_trace_ring_size = 4;
+  vector<BinaryTracer::Event> events;
+  std::thread t([&]() {
+    for (int i = 0; i < 10; i++) {
+      BINARY_TRACE_ELAPSED(kBinaryTraceWrite, "event", 0, i);
+    }
+    BinaryTracer::GetCurrentThreadEventsForTests(&events);
+  });
+  t.join();
+  ASSERT_EQ(4, events.size());
+  for (int i = 0; i < 4; i++) {
+    ASSERT_EQ(6 + i, events[i].arg);
+  }
+}
+
+TEST_F(BinaryTraceTest, TestDumpChromeJson) {
+  {
+    BINARY_TRACE_SCOPE_ARG(kBinaryTraceScan, "dumped", 3);
+  }
+  std::ostringstream out;
+  BinaryTracer::DumpChromeJson(MonoDelta::FromSeconds(10), &out);
+
+  JsonReader r(out.str());
+  ASSERT_OK(r.Init());
+  vector<const rapidjson::Value*> events;
+  ASSERT_OK(r.ExtractObjectArray(r.root(), "traceEvents", &events));
+  bool found = false;
+  for (const rapidjson::Value* e : events) {
+    string name;
+    ASSERT_OK(r.ExtractString(e, "name", &name));
+    if (name != "dumped") {
+      continue;
+    }
+    found = true;
+    string cat, ph;
+    ASSERT_OK(r.ExtractString(e, "cat", &cat));
+    ASSERT_OK(r.ExtractString(e, "ph", &ph));
+    ASSERT_EQ("scan", cat);
+    ASSERT_EQ("X", ph);
+    const rapidjson::Value* args;
+    ASSERT_OK(r.ExtractObject(e, "args", &args));
+    int64_t arg;
+    ASSERT_OK(r.ExtractInt64(args, "arg", &arg));
+    ASSERT_EQ(3, arg);
+  }
+  ASSERT_TRUE(found) << out.str();
+}
+
+} // namespace debug
+} // namespace kudu
@@ -0,0 +1,314 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#include "kudu/util/debug/binary_trace.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <mutex>
+#include <unordered_set>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include "kudu/gutil/strings/split.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/flag_tags.h"
+#include "kudu/util/jsonwriter.h"
+#include "kudu/util/mutex.h"
+#include "kudu/util/thread.h"
+
+DEFINE_string(binary_trace_categories, "all",
+              "Comma-separated list of the categories of binary trace events to "
+              "record: 'write', 'wal' and 'scan', or 'all'. Empty to record none. "
+              "See /tracing/binary.");
+TAG_FLAG(binary_trace_categories, advanced);
+TAG_FLAG(binary_trace_categories, runtime);
+
+DEFINE_int32(binary_trace_ring_size, 1024,
+             "Number of the most recent binary trace events kept by each thread. "
+             "Only read when a thread records its first event.");
+TAG_FLAG(binary_trace_ring_size, advanced);
+
+using std::string;
+using std::unordered_set;
+using std::vector;
+using strings::Substitute;
+
+namespace kudu {
+namespace debug {
+
+namespace {
+
+const BinaryTraceCategory kCategories[] = {
+  kBinaryTraceWrite, kBinaryTraceWal, kBinaryTraceScan
+};
+
+bool ParseCategories(const string& value, uint32_t* mask) {
+  *mask = 0;
+  vector<string> names = strings::Split(value, ",", strings::SkipEmpty());
+  for (const string& name : names) {
+    if (name == "all") {
+      *mask |= kBinaryTraceAllCategories;
+      continue;
+    }
+    bool found = false;
+    for (BinaryTraceCategory c : kCategories) {
+      if (name == BinaryTraceCategoryName(c)) {
+        *mask |= c;
+        found = true;
+        break;
+      }
+    }
+    if (!found) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool ValidateCategories(const char* flagname, const string& value) {
+  uint32_t mask;
+  if (!ParseCategories(value, &mask)) {
+    LOG(ERROR) << Substitute("Invalid value for --$0: $1", flagname, value);
+    return false;
+  }
+  BinaryTracer::SetEnabledCategories(mask);
+  return true;
+}
+
+} // anonymous namespace
+
+static bool dummy = google::RegisterFlagValidator(
+    &FLAGS_binary_trace_categories, &ValidateCategories);
+
+const char* BinaryTraceCategoryName(BinaryTraceCategory category) {
+  switch (category) {
+    case kBinaryTraceWrite: return "write";
+    case kBinaryTraceWal: return "wal";
+    case kBinaryTraceScan: return "scan";
+    default: break;
+  }
+  LOG(FATAL) << "Unknown binary trace category: " << category;
+  return nullptr;
+}
+
+// The ring of the events of one thread. Registers itself with the set of
+// all rings for its lifetime, which is that of the thread.
+class BinaryTracer::Ring {
+ public:
+  Ring();
+  ~Ring();
+
+  void Add(const Event& event);
+
+  // Appends the events which ended at or after 'since_us', oldest first.
+  void Snapshot(MicrosecondsInt64 since_us, vector<Event>* events) const;
+
+  int64_t tid() const { return tid_; }
+  const string& thread_name() const { return thread_name_; }
+
+ private:
+  struct Slot {
+    std::atomic<uint64_t> seq;
+    std::atomic<const char*> name;
+    std::atomic<uint32_t> category;
+    std::atomic<int64_t> start_us;
+    std::atomic<int64_t> duration_us;
+    std::atomic<int64_t> arg;
+  };
+
+  const int64_t tid_;
+  const string thread_name_;
+  const int capacity_;
+  std::unique_ptr<Slot[]> slots_;
+
+  // The number of events ever added. Only written by the owning thread.
+  std::atomic<uint64_t> num_added_;
+
+  DISALLOW_COPY_AND_ASSIGN(Ring);
+};
+
+namespace {
+
+// All the live rings. The lock is held while reading a ring, so that its
+// thread can't destroy it meanwhile.
+struct RingRegistry {
+  Mutex lock;
+  unordered_set<BinaryTracer::Ring*> rings;
+};
+
+RingRegistry* GetRingRegistry() {
+  static RingRegistry* registry = new RingRegistry();
+  return registry;
+}
+
+} // anonymous namespace
+
+std::atomic<uint32_t> BinaryTracer::enabled_categories_(kBinaryTraceAllCategories);
+
+DEFINE_STATIC_THREAD_LOCAL(BinaryTracer::Ring, BinaryTracer, ring_);
+
+BinaryTracer::Ring::Ring()
+    : tid_(Thread::CurrentThreadId()),
+      thread_name_(Thread::current_thread() ? Thread::current_thread()->name() :
+                   Substitute("thread-$0", tid_)),
+      capacity_(std::max(FLAGS_binary_trace_ring_size, 1)),
+      slots_(new Slot[capacity_]),
+      num_added_(0) {
+  for (int i = 0; i < capacity_; i++) {
+    slots_[i].seq.store(0, std::memory_order_relaxed);
+  }
+  RingRegistry* registry = GetRingRegistry();
+  std::lock_guard<Mutex> l(registry->lock);
+  registry->rings.insert(this);
+}
+
+BinaryTracer::Ring::~Ring() {
+  RingRegistry* registry = GetRingRegistry();
+  std::lock_guard<Mutex> l(registry->lock);
+  registry->rings.erase(this);
+}
+
+void BinaryTracer::Ring::Add(const Event& event) {
+  uint64_t n = num_added_.load(std::memory_order_relaxed);
+  Slot& slot = slots_[n % capacity_];
+
+  uint64_t seq = slot.seq.load(std::memory_order_relaxed);
+  slot.seq.store(seq + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  slot.name.store(event.name, std::memory_order_relaxed);
+  slot.category.store(event.category, std::memory_order_relaxed);
+  slot.start_us.store(event.start_us, std::memory_order_relaxed);
+  slot.duration_us.store(event.duration_us, std::memory_order_relaxed);
+  slot.arg.store(event.arg, std::memory_order_relaxed);
+  slot.seq.store(seq + 2, std::memory_order_release);
+  num_added_.store(n + 1, std::memory_order_release);
+}
+
+void BinaryTracer::Ring::Snapshot(MicrosecondsInt64 since_us, vector<Event>* events) const {
+  uint64_t n = num_added_.load(std::memory_order_acquire);
+  uint64_t first = n > static_cast<uint64_t>(capacity_) ? n - capacity_ : 0;
+  for (uint64_t i = first; i < n; i++) {
+    const Slot& slot = slots_[i % capacity_];
+    uint64_t seq = slot.seq.load(std::memory_order_acquire);
+    if (seq & 1) {
+      continue;
+    }
+    Event e;
+    e.name = slot.name.load(std::memory_order_relaxed);
+    e.category = static_cast<BinaryTraceCategory>(
+        slot.category.load(std::memory_order_relaxed));
+    e.start_us = slot.start_us.load(std::memory_order_relaxed);
+    e.duration_us = slot.duration_us.load(std::memory_order_relaxed);
+    e.arg = slot.arg.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot.seq.load(std::memory_order_relaxed) != seq) {
+      continue;
+    }
+    if (e.start_us + e.duration_us >= since_us) {
+      events->push_back(e);
+    }
+  }
+}
+
+BinaryTracer::Ring* BinaryTracer::GetRing() {
+  INIT_STATIC_THREAD_LOCAL(BinaryTracer::Ring, ring_);
+  return ring_;
+}
+
+void BinaryTracer::Record(const Event& event) {
+  Ring* ring = ring_;
+  if (PREDICT_FALSE(ring == nullptr)) {
+    ring = GetRing();
+  }
+  ring->Add(event);
+}
+
+void BinaryTracer::GetCurrentThreadEventsForTests(vector<Event>* events) {
+  if (ring_) {
+    ring_->Snapshot(0, events);
+  }
+}
+
+void BinaryTracer::DumpChromeJson(const MonoDelta& window, std::ostringstream* out) {
+  MicrosecondsInt64 since_us = GetMonoTimeMicros() - window.ToMicroseconds();
+  int64_t pid = getpid();
+
+  JsonWriter jw(out, JsonWriter::COMPACT);
+  jw.StartObject();
+  jw.String("traceEvents");
+  jw.StartArray();
+  RingRegistry* registry = GetRingRegistry();
+  std::lock_guard<Mutex> l(registry->lock);
+  vector<Event> events;
+  for (const Ring* ring : registry->rings) {
+    events.clear();
+    ring->Snapshot(since_us, &events);
+    if (events.empty()) {
+      continue;
+    }
+    jw.StartObject();
+    jw.String("name");
+    jw.String("thread_name");
+    jw.String("ph");
+    jw.String("M");
+    jw.String("pid");
+    jw.Int64(pid);
+    jw.String("tid");
+    jw.Int64(ring->tid());
+    jw.String("args");
+    jw.StartObject();
+    jw.String("name");
+    jw.String(ring->thread_name());
+    jw.EndObject();
+    jw.EndObject();
+
+    for (const Event& e : events) {
+      jw.StartObject();
+      jw.String("name");
+      jw.String(e.name);
+      jw.String("cat");
+      jw.String(BinaryTraceCategoryName(e.category));
+      jw.String("ph");
+      jw.String("X");
+      jw.String("ts");
+      jw.Int64(e.start_us);
+      jw.String("dur");
+      jw.Int64(e.duration_us);
+      jw.String("pid");
+      jw.Int64(pid);
+      jw.String("tid");
+      jw.Int64(ring->tid());
+      if (e.arg != 0) {
+        jw.String("args");
+        jw.StartObject();
+        jw.String("arg");
+        jw.Int64(e.arg);
+        jw.EndObject();
+      }
+      jw.EndObject();
+    }
+  }
+  jw.EndArray();
+  jw.String("displayTimeUnit");
+  jw.String("ms");
+  jw.EndObject();
+}
+
+} // namespace debug
+} // namespace kudu
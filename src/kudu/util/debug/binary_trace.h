@@ -0,0 +1,210 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+//
+// Binary trace events: a low-overhead complement to TRACE_EVENT and TRACE().
+//
+// TRACE_EVENT (trace_event.h) is global, and has to be started explicitly
+// because it is too expensive to leave on; TRACE() (trace.h) formats a
+// string per message. Binary trace events instead record a fixed-size
+// record, holding only pointers to static strings and a few integers, into
+// a ring buffer owned by the calling thread. This costs about as much as
+// two clock reads, so the trace points of the write and scan pipelines are
+// enabled by default, and the last few seconds of activity can be looked
+// at after the fact, e.g. when a latency spike is noticed.
+//
+// Usage:
+//
+//   {
+//     BINARY_TRACE_SCOPE(kBinaryTraceWrite, "apply");
+//     ...
+//   }
+//
+// Every event belongs to a category. Categories may be compiled out by
+// defining KUDU_BINARY_TRACE_COMPILED_CATEGORIES to the mask of the ones
+// to keep, and disabled at runtime with --binary_trace_categories.
+//
+// The rings are only written by their thread, without locks, and are
+// snapshotted by readers using a sequence number per slot, like
+// CallBreakdownRing. A thread's events are dropped when it exits.
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "kudu/gutil/macros.h"
+#include "kudu/gutil/port.h"
+#include "kudu/gutil/walltime.h"
+#include "kudu/util/monotime.h"
+#include "kudu/util/threadlocal.h"
+
+namespace kudu {
+namespace debug {
+
+// The categories of binary trace events. Each is a bit of a mask.
+enum BinaryTraceCategory {
+  // The stages of a write: prepare, replicate, apply and commit.
+  kBinaryTraceWrite = 1 << 0,
+  // The appends and fsyncs of the WAL.
+  kBinaryTraceWal = 1 << 1,
+  // The stages of a scan.
+  kBinaryTraceScan = 1 << 2,
+
+  kBinaryTraceAllCategories = kBinaryTraceWrite | kBinaryTraceWal | kBinaryTraceScan
+};
+
+#ifndef KUDU_BINARY_TRACE_COMPILED_CATEGORIES
+#define KUDU_BINARY_TRACE_COMPILED_CATEGORIES kudu::debug::kBinaryTraceAllCategories
+#endif
+
+// Records the time spent in the rest of the enclosing scope as an event
+// named 'name', a string literal, in 'category'.
+#define BINARY_TRACE_SCOPE(category, name)                                     \
+  kudu::debug::ScopedBinaryTraceEvent<                                         \
+      ((KUDU_BINARY_TRACE_COMPILED_CATEGORIES) & (category)) != 0>             \
+      _binary_trace_event(category, name)
+
+// Like BINARY_TRACE_SCOPE, also recording the integer 'arg' (e.g. a number
+// of rows).
+#define BINARY_TRACE_SCOPE_ARG(category, name, arg)                            \
+  kudu::debug::ScopedBinaryTraceEvent<                                         \
+      ((KUDU_BINARY_TRACE_COMPILED_CATEGORIES) & (category)) != 0>             \
+      _binary_trace_event(category, name, arg)
+
+// Sets the integer of the event of the enclosing BINARY_TRACE_SCOPE, e.g.
+// once the number of rows is known.
+#define BINARY_TRACE_SET_ARG(arg) _binary_trace_event.set_arg(arg)
+
+// Records an event named 'name' in 'category' which ends now and lasted
+// 'elapsed_us', for stages which are timed already or which don't start
+// and end on the same thread.
+#define BINARY_TRACE_ELAPSED(category, name, elapsed_us, arg)                  \
+  do {                                                                         \
+    if (((KUDU_BINARY_TRACE_COMPILED_CATEGORIES) & (category)) != 0 &&         \
+        kudu::debug::BinaryTracer::Enabled(category)) {                        \
+      kudu::debug::BinaryTracer::RecordElapsed(category, name,                 \
+                                               elapsed_us, arg);               \
+    }                                                                          \
+  } while (0)
+
+// Returns the name of 'category'.
+const char* BinaryTraceCategoryName(BinaryTraceCategory category);
+
+// The registry of the per-thread rings.
+class BinaryTracer {
+ public:
+  // One event. 'name' is a string literal.
+  struct Event {
+    const char* name;
+    BinaryTraceCategory category;
+    MicrosecondsInt64 start_us;
+    int64_t duration_us;
+    int64_t arg;
+  };
+
+  // The ring of the events of one thread.
+  class Ring;
+
+  // Returns whether the events of 'category' are currently recorded.
+  static bool Enabled(BinaryTraceCategory category) {
+    return (enabled_categories_.load(std::memory_order_relaxed) & category) != 0;
+  }
+
+  // Records 'event' into the ring of the calling thread.
+  static void Record(const Event& event);
+
+  // Records an event ending now which lasted 'elapsed_us'.
+  static void RecordElapsed(BinaryTraceCategory category, const char* name,
+                            int64_t elapsed_us, int64_t arg) {
+    MicrosecondsInt64 now = GetMonoTimeMicros();
+    Record({ name, category, now - elapsed_us, elapsed_us, arg });
+  }
+
+  // Writes the events of all threads which ended within the last 'window'
+  // to 'out' as JSON in the Chrome trace event format, which may be loaded
+  // into chrome://tracing.
+  static void DumpChromeJson(const MonoDelta& window, std::ostringstream* out);
+
+  // Copies the events of the calling thread, oldest first. For tests.
+  static void GetCurrentThreadEventsForTests(std::vector<Event>* events);
+
+  // Sets the mask of recorded categories. Called when
+  // --binary_trace_categories changes.
+  static void SetEnabledCategories(uint32_t mask) {
+    enabled_categories_.store(mask, std::memory_order_relaxed);
+  }
+
+ private:
+  static Ring* GetRing();
+
+  static std::atomic<uint32_t> enabled_categories_;
+
+  DECLARE_STATIC_THREAD_LOCAL(Ring, ring_);
+
+  DISALLOW_IMPLICIT_CONSTRUCTORS(BinaryTracer);
+};
+
+template<bool kCompiledIn>
+class ScopedBinaryTraceEvent {
+ public:
+  ScopedBinaryTraceEvent(BinaryTraceCategory category, const char* name, int64_t arg = 0) {
+    if (!BinaryTracer::Enabled(category)) {
+      event_.name = nullptr;
+      return;
+    }
+    event_.name = name;
+    event_.category = category;
+    event_.start_us = GetMonoTimeMicros();
+    event_.arg = arg;
+  }
+
+  void set_arg(int64_t arg) {
+    event_.arg = arg;
+  }
+
+  ~ScopedBinaryTraceEvent() {
+    if (PREDICT_TRUE(event_.name != nullptr)) {
+      event_.duration_us = GetMonoTimeMicros() - event_.start_us;
+      BinaryTracer::Record(event_);
+    }
+  }
+
+ private:
+  BinaryTracer::Event event_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScopedBinaryTraceEvent);
+};
+
+// The events of categories which are compiled out cost nothing.
+template<>
+class ScopedBinaryTraceEvent<false> {
+ public:
+  ScopedBinaryTraceEvent(BinaryTraceCategory /* category */, const char* /* name */,
+                         int64_t /* arg */ = 0) {
+  }
+
+  void set_arg(int64_t /* arg */) {
+  }
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(ScopedBinaryTraceEvent);
+};
+
+} // namespace debug
+} // namespace kudu
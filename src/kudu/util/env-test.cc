@@ -452,6 +452,83 @@ TEST_F(TestEnv, TestReadFully) {
   ASSERT_STR_CONTAINS(status.ToString(), "EOF");
 }
 
+TEST_F(TestEnv, TestPrefetch) {
+  SeedRandom();
+  const string kTestPath = GetTestPath("test");
+  const int kFileSize = 64 * 1024;
+  WriteTestFile(env_.get(), kTestPath, kFileSize);
+  ASSERT_NO_FATAL_FAILURE();
+
+  // Prefetching never changes what a subsequent read returns, including
+  // for ranges which extend past the end of the file.
+  const int kReadLength = 10000;
+  Slice s;
+  gscoped_ptr<uint8_t[]> scratch(new uint8_t[kReadLength]);
+
+  shared_ptr<RandomAccessFile> raf;
+  ASSERT_OK(env_util::OpenFileForRandom(env_.get(), kTestPath, &raf));
+  ASSERT_OK(raf->Prefetch(0, kReadLength));
+  ASSERT_OK(raf->Prefetch(kFileSize - 100, kReadLength));
+  ASSERT_OK(env_util::ReadFully(raf.get(), 0, kReadLength, &s, scratch.get()));
+  VerifyTestData(s, 0);
+
+  gscoped_ptr<RWFile> rwf;
+  RWFileOptions opts;
+  opts.mode = Env::OPEN_EXISTING;
+  ASSERT_OK(env_->NewRWFile(opts, kTestPath, &rwf));
+  ASSERT_OK(rwf->Prefetch(kReadLength, kReadLength));
+  ASSERT_OK(rwf->Read(kReadLength, kReadLength, &s, scratch.get()));
+  VerifyTestData(s, kReadLength);
+}
+
+// A file reopened with OPEN_EXISTING_REUSE is written from its start, and
+// whatever wasn't written over is truncated when it's closed.
+TEST_F(TestEnv, TestReuseExistingWritableFile) {
+  const string kTestPath = GetTestPath("test");
+  const int kFileSize = 64 * 1024;
+  WriteTestFile(env_.get(), kTestPath, kFileSize);
+  ASSERT_NO_FATAL_FAILURE();
+
+  WritableFileOptions opts;
+  opts.mode = Env::OPEN_EXISTING_REUSE;
+  gscoped_ptr<WritableFile> file;
+  ASSERT_OK(env_->NewWritableFile(opts, kTestPath, &file));
+  ASSERT_EQ(0, file->Size());
+  ASSERT_OK(file->Append("hello"));
+  ASSERT_EQ(5, file->Size());
+  ASSERT_OK(file->Close());
+
+  uint64_t size;
+  ASSERT_OK(env_->GetFileSize(kTestPath, &size));
+  ASSERT_EQ(5, size);
+  faststring contents;
+  ASSERT_OK(ReadFileToString(env_.get(), kTestPath, &contents));
+  ASSERT_EQ("hello", contents.ToString());
+}
+
+TEST_F(TestEnv, TestMap) {
+  SeedRandom();
+  const string kTestPath = GetTestPath("test");
+  const int kFileSize = 64 * 1024;
+  WriteTestFile(env_.get(), kTestPath, kFileSize);
+  ASSERT_NO_FATAL_FAILURE();
+
+  gscoped_ptr<RWFile> rwf;
+  RWFileOptions opts;
+  opts.mode = Env::OPEN_EXISTING;
+  ASSERT_OK(env_->NewRWFile(opts, kTestPath, &rwf));
+
+  // Map a range that doesn't start on a page boundary. The mapping stays
+  // valid after the file is closed.
+  const int kOffset = 5000;
+  const int kLength = 20000;
+  gscoped_ptr<MappedRegion> region;
+  ASSERT_OK(rwf->Map(kOffset, kLength, &region));
+  ASSERT_OK(rwf->Close());
+  ASSERT_EQ(kLength, region->data().size());
+  VerifyTestData(region->data(), kOffset);
+}
+
 TEST_F(TestEnv, TestAppendVector) {
   WritableFileOptions opts;
   LOG(INFO) << "Testing AppendVector() only, NO pre-allocation";
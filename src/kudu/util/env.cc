@@ -22,6 +22,9 @@ WritableFile::~WritableFile() {
 RWFile::~RWFile() {
 }
 
+MappedRegion::~MappedRegion() {
+}
+
 FileLock::~FileLock() {
 }
 
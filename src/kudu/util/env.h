@@ -25,6 +25,7 @@
 namespace kudu {
 
 class FileLock;
+class MappedRegion;
 class RandomAccessFile;
 class RWFile;
 class SequentialFile;
@@ -44,10 +45,17 @@ class Env {
   // CREATE_IF_NON_EXISTING_TRUNCATE | opens + truncates | creates
   // CREATE_NON_EXISTING             | fails             | creates
   // OPEN_EXISTING                   | opens             | fails
+  // OPEN_EXISTING_REUSE             | opens             | fails
+  //
+  // A WritableFile opened with OPEN_EXISTING appends after the existing data,
+  // whereas one opened with OPEN_EXISTING_REUSE writes over it from the start
+  // of the file, reusing its blocks, and truncates whatever it didn't
+  // overwrite when closed.
   enum CreateMode {
     CREATE_IF_NON_EXISTING_TRUNCATE,
     CREATE_NON_EXISTING,
-    OPEN_EXISTING
+    OPEN_EXISTING,
+    OPEN_EXISTING_REUSE
   };
 
   Env() { }
@@ -152,6 +160,16 @@ class Env {
   // Synchronize the entry for a specific directory.
   virtual Status SyncDir(const std::string& dirname) = 0;
 
+  // Synchronize all written data of all files on the filesystem containing
+  // 'path', as if each of them had been synced.
+  //
+  // Returns NotSupported on platforms which can't do this in one call.
+  //
+  // On Linux before 5.8, a writeback error of one of the files may not be
+  // reported, so callers which need to know about it must sync the file
+  // itself.
+  virtual Status SyncFilesystem(const std::string& path) = 0;
+
   // Recursively delete the specified directory.
   // This should operate safely, not following any symlinks, etc.
   virtual Status DeleteRecursively(const std::string &dirname) = 0;
@@ -322,6 +340,14 @@ class RandomAccessFile {
   virtual Status Read(uint64_t offset, size_t n, Slice* result,
                       uint8_t *scratch) const = 0;
 
+  // Hints that the 'n' bytes starting at 'offset' will be read soon,
+  // allowing the implementation to begin fetching them asynchronously.
+  // Returns without waiting for any I/O to complete; a later Read() of the
+  // range is still required to obtain the data.
+  //
+  // Safe for concurrent use by multiple threads.
+  virtual Status Prefetch(uint64_t offset, size_t n) const { return Status::OK(); }
+
   // Returns the size of the file
   virtual Status Size(uint64_t *size) const = 0;
 
@@ -451,6 +477,25 @@ class RWFile {
   virtual Status Read(uint64_t offset, size_t length,
                       Slice* result, uint8_t* scratch) const = 0;
 
+  // See RandomAccessFile::Prefetch().
+  virtual Status Prefetch(uint64_t offset, size_t length) const { return Status::OK(); }
+
+  // Hints that the 'length' bytes starting at 'offset' won't be read again
+  // soon, allowing the implementation to drop them from any caches. Data
+  // that hasn't been written back yet is unaffected, so this is most useful
+  // after Flush() or Sync().
+  virtual Status DropCache(uint64_t offset, size_t length) const { return Status::OK(); }
+
+  // Maps the 'length' bytes starting at 'offset' into memory for reading,
+  // without copying them. The file must not be truncated below the end of
+  // the range while the mapping exists.
+  //
+  // Returns NotSupported if the implementation can't map files.
+  virtual Status Map(uint64_t offset, size_t length,
+                     gscoped_ptr<MappedRegion>* region) const {
+    return Status::NotSupported("Memory mapping not supported");
+  }
+
   // Writes 'data' to the file position given by 'offset'.
   virtual Status Write(uint64_t offset, const Slice& data) = 0;
 
@@ -507,6 +552,20 @@ class RWFile {
   DISALLOW_COPY_AND_ASSIGN(RWFile);
 };
 
+// A read-only memory mapping of part of a file, created by RWFile::Map().
+// The mapping is removed when the object is destroyed.
+class MappedRegion {
+ public:
+  MappedRegion() { }
+  virtual ~MappedRegion();
+
+  // The mapped bytes.
+  virtual Slice data() const = 0;
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(MappedRegion);
+};
+
 // Identifies a locked file.
 class FileLock {
  public:
@@ -582,6 +641,7 @@ class EnvWrapper : public Env {
   Status DeleteFile(const std::string& f) OVERRIDE { return target_->DeleteFile(f); }
   Status CreateDir(const std::string& d) OVERRIDE { return target_->CreateDir(d); }
   Status SyncDir(const std::string& d) OVERRIDE { return target_->SyncDir(d); }
+  Status SyncFilesystem(const std::string& p) OVERRIDE { return target_->SyncFilesystem(p); }
   Status DeleteDir(const std::string& d) OVERRIDE { return target_->DeleteDir(d); }
   Status DeleteRecursively(const std::string& d) OVERRIDE { return target_->DeleteRecursively(d); }
   Status GetFileSize(const std::string& f, uint64_t* s) OVERRIDE {
@@ -184,6 +184,77 @@ static Status IOError(const std::string& context, int err_number) {
   return Status::IOError(context, ErrnoToString(err_number), err_number);
 }
 
+// Asks the kernel to start reading the given range into the page cache.
+// The reads are queued to the device without blocking the caller, so many
+// ranges can be in flight at once without dedicating a thread to each.
+static Status DoPrefetch(int fd, const string& filename, uint64_t offset, size_t n) {
+#if defined(__linux__)
+  TRACE_COUNTER_INCREMENT("fadvise_willneed", 1);
+  int err = posix_fadvise(fd, offset, n, POSIX_FADV_WILLNEED);
+  if (err != 0) {
+    return IOError(filename, err);
+  }
+#endif
+  return Status::OK();
+}
+
+// Asks the kernel to drop the given range from the page cache. Dirty pages
+// and pages under writeback are skipped.
+static Status DoDropCache(int fd, const string& filename, uint64_t offset, size_t n) {
+#if defined(__linux__)
+  TRACE_COUNTER_INCREMENT("fadvise_dontneed", 1);
+  int err = posix_fadvise(fd, offset, n, POSIX_FADV_DONTNEED);
+  if (err != 0) {
+    return IOError(filename, err);
+  }
+#endif
+  return Status::OK();
+}
+
+class PosixMappedRegion : public MappedRegion {
+ public:
+  PosixMappedRegion(void* base, size_t mapped_length, Slice data)
+      : base_(base),
+        mapped_length_(mapped_length),
+        data_(data) {
+  }
+
+  ~PosixMappedRegion() {
+    PCHECK(munmap(base_, mapped_length_) == 0);
+  }
+
+  virtual Slice data() const OVERRIDE { return data_; }
+
+ private:
+  void* const base_;
+  const size_t mapped_length_;
+  const Slice data_;
+};
+
+// Maps the given range of the file read-only. mmap() requires the offset to
+// be page-aligned, so the mapping may start a little before 'offset'.
+static Status DoMap(int fd, const string& filename, uint64_t offset, size_t n,
+                    gscoped_ptr<MappedRegion>* region) {
+  ThreadRestrictions::AssertIOAllowed();
+  static const uint64_t kPageSize = sysconf(_SC_PAGESIZE);
+  uint64_t map_offset = offset - (offset % kPageSize);
+  size_t map_length = n + (offset - map_offset);
+  int flags = MAP_SHARED;
+#if defined(__linux__)
+  // Fault the pages in up front rather than one at a time as they're read.
+  flags |= MAP_POPULATE;
+#endif
+  void* base = mmap(nullptr, map_length, PROT_READ, flags, fd, map_offset);
+  if (base == MAP_FAILED) {
+    return IOError(filename, errno);
+  }
+  TRACE_COUNTER_INCREMENT("mmap_bytes", n);
+  region->reset(new PosixMappedRegion(
+      base, map_length,
+      Slice(reinterpret_cast<const uint8_t*>(base) + (offset - map_offset), n)));
+  return Status::OK();
+}
+
 static Status DoSync(int fd, const string& filename) {
   ThreadRestrictions::AssertIOAllowed();
   if (FLAGS_never_fsync) return Status::OK();
@@ -214,6 +285,7 @@ static Status DoOpen(const string& filename, Env::CreateMode mode, int* fd) {
       flags |= O_CREAT | O_EXCL;
       break;
     case Env::OPEN_EXISTING:
+    case Env::OPEN_EXISTING_REUSE:
       break;
     default:
       return Status::NotSupported(Substitute("Unknown create mode $0", mode));
@@ -290,6 +362,10 @@ class PosixRandomAccessFile: public RandomAccessFile {
     return s;
   }
 
+  virtual Status Prefetch(uint64_t offset, size_t n) const OVERRIDE {
+    return DoPrefetch(fd_, filename_, offset, n);
+  }
+
   virtual Status Size(uint64_t *size) const OVERRIDE {
     TRACE_EVENT1("io", "PosixRandomAccessFile::Size", "path", filename_);
     ThreadRestrictions::AssertIOAllowed();
@@ -315,12 +391,12 @@ class PosixRandomAccessFile: public RandomAccessFile {
 class PosixWritableFile : public WritableFile {
  public:
   PosixWritableFile(std::string fname, int fd, uint64_t file_size,
-                    bool sync_on_close)
+                    uint64_t pre_allocated_size, bool sync_on_close)
       : filename_(std::move(fname)),
         fd_(fd),
         sync_on_close_(sync_on_close),
         filesize_(file_size),
-        pre_allocated_size_(0),
+        pre_allocated_size_(pre_allocated_size),
         pending_sync_(false) {}
 
   ~PosixWritableFile() {
@@ -550,6 +626,19 @@ class PosixRWFile : public RWFile {
     return Status::OK();
   }
 
+  virtual Status Prefetch(uint64_t offset, size_t length) const OVERRIDE {
+    return DoPrefetch(fd_, filename_, offset, length);
+  }
+
+  virtual Status DropCache(uint64_t offset, size_t length) const OVERRIDE {
+    return DoDropCache(fd_, filename_, offset, length);
+  }
+
+  virtual Status Map(uint64_t offset, size_t length,
+                     gscoped_ptr<MappedRegion>* region) const OVERRIDE {
+    return DoMap(fd_, filename_, offset, length, region);
+  }
+
   virtual Status Write(uint64_t offset, const Slice& data) OVERRIDE {
     ThreadRestrictions::AssertIOAllowed();
     ssize_t written;
@@ -865,6 +954,25 @@ class PosixEnv : public Env {
     return Status::OK();
   }
 
+  virtual Status SyncFilesystem(const std::string& path) OVERRIDE {
+    TRACE_EVENT1("io", "SyncFilesystem", "path", path);
+    ThreadRestrictions::AssertIOAllowed();
+    if (FLAGS_never_fsync) return Status::OK();
+#if defined(__linux__)
+    int fd;
+    if ((fd = open(path.c_str(), O_RDONLY)) == -1) {
+      return IOError(path, errno);
+    }
+    ScopedFdCloser fd_closer(fd);
+    if (syncfs(fd) != 0) {
+      return IOError(path, errno);
+    }
+    return Status::OK();
+#else
+    return Status::NotSupported("Syncing a whole filesystem not supported on this platform");
+#endif
+  }
+
   virtual Status DeleteRecursively(const std::string &name) OVERRIDE {
     return Walk(name, POST_ORDER, Bind(&PosixEnv::DeleteRecursivelyCb,
                                        Unretained(this)));
@@ -1197,10 +1305,15 @@ class PosixEnv : public Env {
                                     const WritableFileOptions& opts,
                                     gscoped_ptr<WritableFile>* result) {
     uint64_t file_size = 0;
+    uint64_t pre_allocated_size = 0;
     if (opts.mode == OPEN_EXISTING) {
       RETURN_NOT_OK(GetFileSize(fname, &file_size));
+    } else if (opts.mode == OPEN_EXISTING_REUSE) {
+      // The existing blocks are written over as if they had been preallocated.
+      RETURN_NOT_OK(GetFileSize(fname, &pre_allocated_size));
     }
-    result->reset(new PosixWritableFile(fname, fd, file_size, opts.sync_on_close));
+    result->reset(new PosixWritableFile(fname, fd, file_size, pre_allocated_size,
+                                        opts.sync_on_close));
     return Status::OK();
   }
 
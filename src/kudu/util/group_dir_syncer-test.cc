@@ -0,0 +1,104 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#include "kudu/util/group_dir_syncer.h"
+
+#include <memory>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "kudu/util/atomic.h"
+#include "kudu/util/countdown_latch.h"
+#include "kudu/util/env.h"
+#include "kudu/util/monotime.h"
+#include "kudu/util/test_util.h"
+#include "kudu/util/thread.h"
+
+using std::string;
+using std::vector;
+
+namespace kudu {
+
+// Counts the directory syncs, which are made slow enough for callers to
+// pile up behind them, and optionally fails them.
+class SlowSyncDirEnv : public EnvWrapper {
+ public:
+  explicit SlowSyncDirEnv(Env* target)
+      : EnvWrapper(target),
+        num_syncs_(0) {
+  }
+
+  Status SyncDir(const std::string& dirname) override {
+    num_syncs_.Increment();
+    SleepFor(MonoDelta::FromMilliseconds(50));
+    RETURN_NOT_OK(error_);
+    return EnvWrapper::SyncDir(dirname);
+  }
+
+  int num_syncs() const { return num_syncs_.Load(); }
+
+  void set_error(Status error) { error_ = std::move(error); }
+
+ private:
+  AtomicInt<int32_t> num_syncs_;
+  Status error_;
+};
+
+class GroupDirSyncerTest : public KuduTest {};
+
+TEST_F(GroupDirSyncerTest, TestConcurrentSyncsAreCoalesced) {
+  const int kNumThreads = 16;
+  SlowSyncDirEnv env(env_.get());
+  const string dir = GetTestPath("dir");
+  ASSERT_OK(env.CreateDir(dir));
+
+  CountDownLatch start(1);
+  vector<Status> statuses(kNumThreads);
+  vector<scoped_refptr<Thread>> threads;
+  for (int i = 0; i < kNumThreads; i++) {
+    scoped_refptr<Thread> t;
+    Status* s = &statuses[i];
+    ASSERT_OK(Thread::Create("test", "syncer", [&, s]() {
+          start.Wait();
+          *s = GroupDirSyncer::Get()->SyncDir(&env, dir);
+        }, &t));
+    threads.push_back(t);
+  }
+  start.CountDown();
+  for (const auto& t : threads) {
+    t->Join();
+  }
+  for (const Status& s : statuses) {
+    ASSERT_OK(s);
+  }
+  // All the callers arriving during a sync are covered by the next one.
+  LOG(INFO) << env.num_syncs() << " syncs for " << kNumThreads << " callers";
+  ASSERT_GE(env.num_syncs(), 1);
+  ASSERT_LT(env.num_syncs(), kNumThreads);
+}
+
+TEST_F(GroupDirSyncerTest, TestErrorsArePropagated) {
+  SlowSyncDirEnv env(env_.get());
+  env.set_error(Status::IOError("injected"));
+  Status s = GroupDirSyncer::Get()->SyncDir(&env, GetTestDataDirectory());
+  ASSERT_TRUE(s.IsIOError()) << s.ToString();
+
+  env.set_error(Status::OK());
+  ASSERT_OK(GroupDirSyncer::Get()->SyncDir(&env, GetTestDataDirectory()));
+}
+
+} // namespace kudu
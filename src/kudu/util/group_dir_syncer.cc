@@ -0,0 +1,78 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#include "kudu/util/group_dir_syncer.h"
+
+#include <mutex>
+
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/env.h"
+
+using std::string;
+
+namespace kudu {
+
+GroupDirSyncer* GroupDirSyncer::Get() {
+  return Singleton<GroupDirSyncer>::get();
+}
+
+GroupDirSyncer::GroupDirSyncer()
+    : cond_(&lock_),
+      num_syncs_(0) {
+}
+
+Status GroupDirSyncer::SyncDir(Env* env, const string& dir) {
+  const string key = strings::Substitute("$0:$1", reinterpret_cast<uintptr_t>(env), dir);
+  std::lock_guard<Mutex> l(lock_);
+  DirState* state = &dirs_[key];
+  state->num_waiters++;
+
+  // A sync in progress may have started before the caller's changes to the
+  // directory, so only the next one to start is known to cover them.
+  const int64_t needed = state->started + 1;
+  while (state->completed < needed) {
+    if (state->started > state->completed) {
+      cond_.Wait();
+      continue;
+    }
+    int64_t seq = ++state->started;
+    Status s;
+    {
+      lock_.Release();
+      s = env->SyncDir(dir);
+      lock_.Acquire();
+    }
+    num_syncs_++;
+    state->completed = seq;
+    state->last_status = s;
+    cond_.Broadcast();
+  }
+
+  // Later syncs also cover the caller's changes, so the result of the last one
+  // is as good as that of the one the caller needed.
+  Status s = state->last_status;
+  if (--state->num_waiters == 0) {
+    dirs_.erase(key);
+  }
+  return s;
+}
+
+int64_t GroupDirSyncer::num_syncs_for_tests() const {
+  std::lock_guard<Mutex> l(lock_);
+  return num_syncs_;
+}
+
+} // namespace kudu
@@ -0,0 +1,85 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#pragma once
+
+#include <string>
+#include <unordered_map>
+
+#include "kudu/gutil/macros.h"
+#include "kudu/gutil/singleton.h"
+#include "kudu/util/condition_variable.h"
+#include "kudu/util/mutex.h"
+#include "kudu/util/status.h"
+
+namespace kudu {
+
+class Env;
+
+// Coalesces concurrent fsync()s of the same directory.
+//
+// Metadata files are replaced by writing a temporary file and renaming it
+// over the old one, after which the parent directory has to be synced for
+// the rename to be durable. When many tablets flush their metadata at once,
+// e.g. while elections run across all the tablets of a restarted server,
+// most of those directory syncs are redundant: a single sync makes all the
+// renames done before it started durable.
+//
+// SyncDir() returns once a sync of the directory which started after the
+// call has completed, so callers get the same guarantee as from
+// Env::SyncDir(). While a sync is in progress, newly arriving callers wait
+// for it to finish, and are then all covered by the next one.
+class GroupDirSyncer {
+ public:
+  static GroupDirSyncer* Get();
+
+  // Makes the entries of 'dir' durable. Thread-safe.
+  Status SyncDir(Env* env, const std::string& dir);
+
+  // The total number of syncs issued to the Envs, for tests.
+  int64_t num_syncs_for_tests() const;
+
+ private:
+  friend class Singleton<GroupDirSyncer>;
+
+  GroupDirSyncer();
+
+  struct DirState {
+    // The number of syncs started and completed. At most one sync of a
+    // directory is in progress at a time, so they complete in order.
+    int64_t started = 0;
+    int64_t completed = 0;
+
+    // The result of the last completed sync.
+    Status last_status;
+
+    // The number of callers waiting on the directory. The state is removed
+    // once there are none.
+    int num_waiters = 0;
+  };
+
+  mutable Mutex lock_;
+  ConditionVariable cond_;
+
+  // Protected by 'lock_'. Keyed by the Env as well as the path, since paths
+  // in different Envs may name different directories.
+  std::unordered_map<std::string, DirState> dirs_;
+  int64_t num_syncs_;
+
+  DISALLOW_COPY_AND_ASSIGN(GroupDirSyncer);
+};
+
+} // namespace kudu
@@ -165,23 +165,43 @@ void HdrHistogram::IncrementBy(int64_t value, int64_t count) {
   NoBarrier_AtomicIncrement(&total_count_, count);
   NoBarrier_AtomicIncrement(&total_sum_, value * count);
 
-  // Update min, if needed.
-  {
-    Atomic64 min_val;
-    while (PREDICT_FALSE(value < (min_val = MinValue()))) {
-      Atomic64 old_val = NoBarrier_CompareAndSwap(&min_value_, min_val, value);
-      if (PREDICT_TRUE(old_val == min_val)) break; // CAS success.
-    }
+  UpdateMin(value);
+  UpdateMax(value);
+}
+
+void HdrHistogram::UpdateMin(int64_t value) {
+  Atomic64 min_val;
+  while (PREDICT_FALSE(value < (min_val = NoBarrier_Load(&min_value_)))) {
+    Atomic64 old_val = NoBarrier_CompareAndSwap(&min_value_, min_val, value);
+    if (PREDICT_TRUE(old_val == min_val)) break; // CAS success.
+  }
+}
+
+void HdrHistogram::UpdateMax(int64_t value) {
+  Atomic64 max_val;
+  while (PREDICT_FALSE(value > (max_val = NoBarrier_Load(&max_value_)))) {
+    Atomic64 old_val = NoBarrier_CompareAndSwap(&max_value_, max_val, value);
+    if (PREDICT_TRUE(old_val == max_val)) break; // CAS success.
   }
+}
+
+void HdrHistogram::MergeFrom(const HdrHistogram& other) {
+  CHECK_EQ(highest_trackable_value_, other.highest_trackable_value_);
+  CHECK_EQ(num_significant_digits_, other.num_significant_digits_);
 
-  // Update max, if needed.
-  {
-    Atomic64 max_val;
-    while (PREDICT_FALSE(value > (max_val = MaxValue()))) {
-      Atomic64 old_val = NoBarrier_CompareAndSwap(&max_value_, max_val, value);
-      if (PREDICT_TRUE(old_val == max_val)) break; // CAS success.
+  // Same order as the copy constructor: sum and min first, max last.
+  NoBarrier_AtomicIncrement(&total_sum_, NoBarrier_Load(&other.total_sum_));
+  UpdateMin(NoBarrier_Load(&other.min_value_));
+  uint64_t total_merged_count = 0;
+  for (int i = 0; i < counts_array_length_; i++) {
+    uint64_t count = NoBarrier_Load(&other.counts_[i]);
+    if (count > 0) {
+      NoBarrier_AtomicIncrement(&counts_[i], count);
+      total_merged_count += count;
     }
   }
+  UpdateMax(NoBarrier_Load(&other.max_value_));
+  NoBarrier_AtomicIncrement(&total_count_, total_merged_count);
 }
 
 void HdrHistogram::IncrementWithExpectedInterval(int64_t value,
@@ -20,6 +20,10 @@
 #include <string>
 #include <vector>
 
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/async_logger.h"
+#include "kudu/util/countdown_latch.h"
+#include "kudu/util/locks.h"
 #include "kudu/util/logging_test_util.h"
 #include "kudu/util/logging.h"
 #include "kudu/util/monotime.h"
@@ -81,4 +85,110 @@ TEST(LoggingTest, TestAdvancedThrottling) {
   EXPECT_THAT(msgs[2], testing::ContainsRegex("test b$"));
 }
 
+namespace {
+
+// A logger which records the messages written to it, and whose writes block
+// for as long as 'unblock' hasn't been counted down.
+class BlockingLogger : public google::base::Logger {
+ public:
+  BlockingLogger() : unblock_(1), num_flushes_(0) {}
+
+  void Write(bool /*force_flush*/, time_t /*timestamp*/,
+             const char* message, int message_len) override {
+    unblock_.Wait();
+    std::lock_guard<simple_spinlock> l(lock_);
+    msgs_.emplace_back(message, message_len);
+  }
+
+  void Flush() override {
+    std::lock_guard<simple_spinlock> l(lock_);
+    num_flushes_++;
+  }
+
+  uint32_t LogSize() override {
+    return 0;
+  }
+
+  void Unblock() {
+    unblock_.CountDown();
+  }
+
+  vector<string> msgs() const {
+    std::lock_guard<simple_spinlock> l(lock_);
+    return msgs_;
+  }
+
+  int num_flushes() const {
+    std::lock_guard<simple_spinlock> l(lock_);
+    return num_flushes_;
+  }
+
+ private:
+  CountDownLatch unblock_;
+  mutable simple_spinlock lock_;
+  vector<string> msgs_;
+  int num_flushes_;
+};
+
+void WriteMessage(google::base::Logger* logger, const string& msg) {
+  logger->Write(false, time(nullptr), msg.data(), msg.size());
+}
+
+} // anonymous namespace
+
+// Test that writes to an AsyncLogger don't wait for the wrapped logger, and
+// that they are written in order once it catches up.
+TEST(LoggingTest, TestAsyncLogger) {
+  BlockingLogger wrapped;
+  AsyncLogger logger(&wrapped, 1024);
+  logger.Start();
+
+  // The writer thread is stuck on the first message, but logging goes on.
+  for (int i = 0; i < 10; i++) {
+    WriteMessage(&logger, strings::Substitute("message $0\n", i));
+  }
+  ASSERT_TRUE(wrapped.msgs().empty());
+
+  wrapped.Unblock();
+  logger.Flush();
+  vector<string> msgs = wrapped.msgs();
+  ASSERT_EQ(10, msgs.size());
+  for (int i = 0; i < msgs.size(); i++) {
+    EXPECT_EQ(strings::Substitute("message $0\n", i), msgs[i]);
+  }
+  EXPECT_EQ(1, wrapped.num_flushes());
+  EXPECT_EQ(0, logger.num_dropped_messages());
+  logger.Stop();
+}
+
+// Test that messages are dropped rather than blocking once the buffer is
+// full, and that the drops are reported in the log.
+TEST(LoggingTest, TestAsyncLoggerDropsWhenFull) {
+  BlockingLogger wrapped;
+  AsyncLogger logger(&wrapped, 100);
+  logger.Start();
+
+  const string msg(10, 'x');
+  for (int i = 0; i < 100; i++) {
+    WriteMessage(&logger, msg);
+  }
+  // The writer thread takes at most one buffer's worth of messages before it
+  // blocks, so between 10 and 20 of them are kept and the rest are dropped.
+  int64_t num_dropped = logger.num_dropped_messages();
+  ASSERT_GE(num_dropped, 80);
+  ASSERT_LE(num_dropped, 90);
+
+  wrapped.Unblock();
+  logger.Flush();
+  vector<string> msgs = wrapped.msgs();
+  ASSERT_EQ(101 - num_dropped, msgs.size());
+  EXPECT_THAT(msgs.back(), testing::ContainsRegex(
+      strings::Substitute("Dropped $0 log messages", num_dropped)));
+
+  // Once stopped, messages are written directly.
+  logger.Stop();
+  WriteMessage(&logger, "after stop");
+  EXPECT_EQ("after stop", wrapped.msgs().back());
+}
+
 } // namespace kudu
@@ -28,6 +28,7 @@
 
 #include "kudu/gutil/callback.h"
 #include "kudu/gutil/spinlock.h"
+#include "kudu/util/async_logger.h"
 #include "kudu/util/debug-util.h"
 #include "kudu/util/flag_tags.h"
 
@@ -36,6 +37,18 @@ DEFINE_string(log_filename, "",
     "full path is <log_dir>/<log_filename>.[INFO|WARN|ERROR|FATAL]");
 TAG_FLAG(log_filename, stable);
 
+DEFINE_bool(log_async, true,
+            "Whether the INFO, WARNING and ERROR log files are written by a "
+            "background thread. If so, logging never blocks on the disk: messages "
+            "are dropped, and the number dropped logged, when the buffer fills up. "
+            "FATAL messages are always written synchronously.");
+TAG_FLAG(log_async, advanced);
+
+DEFINE_int32(log_async_buffer_bytes_per_level, 2 * 1024 * 1024,
+             "The number of bytes of messages buffered for each log level when "
+             "--log_async is enabled.");
+TAG_FLAG(log_async_buffer_bytes_per_level, advanced);
+
 #define PROJ_NAME "kudu"
 
 bool logging_initialized = false;
@@ -100,6 +113,34 @@ SimpleSink* registered_sink = nullptr;
 // Protected by 'logging_mutex'.
 int initial_stderr_severity;
 
+// The loggers which write the log files of each severity in the background,
+// if --log_async is enabled. FATAL messages are never buffered.
+//
+// Protected by 'logging_mutex'.
+AsyncLogger* async_loggers[google::NUM_SEVERITIES] = {};
+
+void EnableAsyncLogging() {
+  for (int severity = google::INFO; severity < google::FATAL; ++severity) {
+    AsyncLogger* logger = new AsyncLogger(google::base::GetLogger(severity),
+                                          FLAGS_log_async_buffer_bytes_per_level);
+    logger->Start();
+    google::base::SetLogger(severity, logger);
+    async_loggers[severity] = logger;
+  }
+}
+
+void DisableAsyncLogging() {
+  for (int severity = google::INFO; severity < google::FATAL; ++severity) {
+    AsyncLogger* logger = async_loggers[severity];
+    if (!logger) continue;
+    // Write out the buffered messages before restoring the file logger, so
+    // that none of them are lost.
+    logger->Stop();
+    google::base::SetLogger(severity, logger->wrapped());
+    delete logger;
+    async_loggers[severity] = nullptr;
+  }
+}
 
 void UnregisterLoggingCallbackUnlocked() {
   CHECK(logging_mutex.IsHeld());
@@ -215,6 +256,10 @@ void InitGoogleLoggingSafe(const char* arg) {
     FLAGS_log_filename = google::ProgramInvocationShortName();
   }
 
+  if (FLAGS_log_async) {
+    EnableAsyncLogging();
+  }
+
   // File logging: on.
   // Stderr logging threshold: FLAGS_stderrthreshold.
   // Sink logging: off.
@@ -292,6 +337,7 @@ void ShutdownLoggingSafe() {
     UnregisterLoggingCallbackUnlocked();
   }
 
+  DisableAsyncLogging();
   google::ShutdownGoogleLogging();
 
   logging_initialized = false;
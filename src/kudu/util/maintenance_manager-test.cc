@@ -30,6 +30,8 @@
 #include "kudu/util/test_util.h"
 #include "kudu/util/thread.h"
 
+DECLARE_int32(maintenance_manager_ram_growth_window_ms);
+
 using std::shared_ptr;
 using std::vector;
 using strings::Substitute;
@@ -77,7 +79,8 @@ class TestMaintenanceOp : public MaintenanceOp {
  public:
   TestMaintenanceOp(const std::string& name,
                     IOUsage io_usage,
-                    const shared_ptr<MemTracker>& tracker)
+                    const shared_ptr<MemTracker>& tracker,
+                    Lane lane = COMPACTION_LANE)
     : MaintenanceOp(name, io_usage),
       consumption_(tracker, 500),
       logs_retained_bytes_(0),
@@ -86,7 +89,9 @@ class TestMaintenanceOp : public MaintenanceOp {
       maintenance_op_duration_(METRIC_maintenance_op_duration.Instantiate(metric_entity_)),
       maintenance_ops_running_(METRIC_maintenance_ops_running.Instantiate(metric_entity_, 0)),
       remaining_runs_(1),
-      sleep_time_(MonoDelta::FromSeconds(0)) {
+      sleep_time_(MonoDelta::FromSeconds(0)),
+      preemptible_(false),
+      lane_(lane) {
   }
 
   virtual ~TestMaintenanceOp() {}
@@ -101,14 +106,25 @@ class TestMaintenanceOp : public MaintenanceOp {
   }
 
   virtual void Perform() OVERRIDE {
+    MonoDelta sleep_time;
+    bool preemptible;
     {
       std::lock_guard<Mutex> guard(lock_);
       DLOG(INFO) << "Performing op " << name();
       CHECK_GE(remaining_runs_, 1);
       remaining_runs_--;
+      sleep_time = sleep_time_;
+      preemptible = preemptible_;
     }
 
-    SleepFor(sleep_time_);
+    if (!preemptible) {
+      SleepFor(sleep_time);
+      return;
+    }
+    MonoTime deadline = MonoTime::Now() + sleep_time;
+    while (MonoTime::Now() < deadline && !preempted()) {
+      SleepFor(MonoDelta::FromMilliseconds(10));
+    }
   }
 
   virtual void UpdateStats(MaintenanceOpStats* stats) OVERRIDE {
@@ -129,6 +145,11 @@ class TestMaintenanceOp : public MaintenanceOp {
     sleep_time_ = time;
   }
 
+  void set_preemptible(bool preemptible) {
+    std::lock_guard<Mutex> guard(lock_);
+    preemptible_ = preemptible;
+  }
+
   void set_ram_anchored(uint64_t ram_anchored) {
     std::lock_guard<Mutex> guard(lock_);
     consumption_.Reset(ram_anchored);
@@ -152,6 +173,10 @@ class TestMaintenanceOp : public MaintenanceOp {
     return maintenance_ops_running_;
   }
 
+  virtual Lane lane() const OVERRIDE {
+    return lane_;
+  }
+
  private:
   Mutex lock_;
 
@@ -169,6 +194,11 @@ class TestMaintenanceOp : public MaintenanceOp {
 
   // The amount of time each op invocation will sleep.
   MonoDelta sleep_time_;
+
+  // Whether an op invocation stops sleeping once it's preempted.
+  bool preemptible_;
+
+  const Lane lane_;
 };
 
 // Create an op and wait for it to start running.  Unregister it while it is
@@ -274,6 +304,76 @@ TEST_F(MaintenanceManagerTest, TestLogRetentionPrioritization) {
   manager_->UnregisterOp(&op2);
 }
 
+// Test that long ops of the compaction lane don't keep a flush from running, and
+// that they are preempted once it gets urgent to free memory.
+TEST_F(MaintenanceManagerTest, TestFlushLaneAndPreemption) {
+  TestMaintenanceOp compaction("compaction", MaintenanceOp::HIGH_IO_USAGE, test_tracker_);
+  compaction.set_ram_anchored(0);
+  compaction.set_perf_improvement(1);
+  compaction.set_remaining_runs(2);
+  compaction.set_sleep_time(MonoDelta::FromSeconds(60));
+  compaction.set_preemptible(true);
+  manager_->RegisterOp(&compaction);
+
+  // Both compaction threads get busy.
+  AssertEventually([&]() {
+      ASSERT_EQ(compaction.RunningGauge()->value(), 2);
+    });
+
+  TestMaintenanceOp flush("flush", MaintenanceOp::HIGH_IO_USAGE, test_tracker_,
+                          MaintenanceOp::FLUSH_LANE);
+  flush.set_ram_anchored(100);
+  flush.set_perf_improvement(1);
+  manager_->RegisterOp(&flush);
+  AssertEventually([&]() {
+      ASSERT_EQ(flush.DurationHistogram()->TotalCount(), 1);
+    });
+  ASSERT_EQ(compaction.RunningGauge()->value(), 2);
+  manager_->UnregisterOp(&flush);
+
+  // Going over the memory limit preempts the compactions, well before they'd
+  // have finished on their own.
+  TestMaintenanceOp memory_hog("memory_hog", MaintenanceOp::HIGH_IO_USAGE, test_tracker_,
+                               MaintenanceOp::FLUSH_LANE);
+  memory_hog.set_ram_anchored(1100);
+  memory_hog.set_remaining_runs(0);
+  manager_->RegisterOp(&memory_hog);
+  AssertEventually([&]() {
+      ASSERT_EQ(compaction.DurationHistogram()->TotalCount(), 2);
+    });
+  manager_->UnregisterOp(&memory_hog);
+  manager_->UnregisterOp(&compaction);
+}
+
+// Test that a flush is started ahead of the soft memory limit while memory is
+// anchored fast enough to reach it soon, and no longer once the growth stops.
+TEST_F(MaintenanceManagerTest, TestFlushAheadOfMemoryLimit) {
+  FLAGS_maintenance_manager_ram_growth_window_ms = 1;
+  manager_->Shutdown();
+
+  TestMaintenanceOp flush("flush", MaintenanceOp::HIGH_IO_USAGE, test_tracker_,
+                          MaintenanceOp::FLUSH_LANE);
+  flush.set_ram_anchored(100);
+  manager_->RegisterOp(&flush);
+
+  // Well under the soft limit, and not growing.
+  ASSERT_EQ(nullptr, manager_->FindBestOp());
+  SleepFor(MonoDelta::FromMilliseconds(10));
+  ASSERT_EQ(nullptr, manager_->FindBestOp());
+
+  // Still under the soft limit, but growing fast enough to reach it before
+  // a flush could finish.
+  SleepFor(MonoDelta::FromMilliseconds(10));
+  flush.set_ram_anchored(200);
+  ASSERT_EQ(&flush, manager_->FindBestOp());
+
+  // Once the growth stops, there's no hurry to flush anymore.
+  SleepFor(MonoDelta::FromMilliseconds(10));
+  ASSERT_EQ(nullptr, manager_->FindBestOp());
+
+  manager_->UnregisterOp(&flush);
+}
+
 // Test adding operations and make sure that the history of recently completed operations
 // is correct in that it wraps around and doesn't grow.
 TEST_F(MaintenanceManagerTest, TestCompletedOpsHistory) {
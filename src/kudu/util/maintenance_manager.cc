@@ -17,6 +17,7 @@
 
 #include "kudu/util/maintenance_manager.h"
 
+#include <algorithm>
 #include <gflags/gflags.h>
 #include <memory>
 #include <stdint.h>
@@ -39,11 +40,49 @@ using std::shared_ptr;
 using strings::Substitute;
 
 DEFINE_int32(maintenance_manager_num_threads, 1,
-             "Size of the maintenance manager thread pool. "
-             "For spinning disks, the number of threads should "
-             "not be above the number of devices.");
+             "Number of maintenance manager threads running compactions and "
+             "other ops which aren't flushes or GC. Flushes and GC ops have their "
+             "own threads, see --maintenance_manager_flush_threads and "
+             "--maintenance_manager_gc_threads. For spinning disks, the number of "
+             "threads should not be above the number of devices.");
 TAG_FLAG(maintenance_manager_num_threads, stable);
 
+DEFINE_int32(maintenance_manager_flush_threads, 1,
+             "Number of maintenance manager threads running ops which free "
+             "memory by flushing it to disk, so that these aren't held up by "
+             "long compactions.");
+TAG_FLAG(maintenance_manager_flush_threads, advanced);
+
+DEFINE_int32(maintenance_manager_gc_threads, 1,
+             "Number of maintenance manager threads running low IO ops which "
+             "free up logs or disk space.");
+TAG_FLAG(maintenance_manager_gc_threads, advanced);
+
+DEFINE_int32(maintenance_manager_max_high_io_ops_per_disk, 0,
+             "Maximum number of high IO maintenance ops, such as flushes and "
+             "compactions, which may run at once per data directory of the "
+             "server. 0 means no limit other than the number of threads.");
+TAG_FLAG(maintenance_manager_max_high_io_ops_per_disk, advanced);
+
+DEFINE_bool(maintenance_manager_flush_ahead, true,
+            "Whether to predict how fast the memory anchored by ops grows from "
+            "its recent rate, and start flushes before the soft memory limit is "
+            "reached rather than once it's exceeded. Flushes start early enough "
+            "to free the memory expected to be anchored while they run, favoring "
+            "the ops which retain the most logs.");
+TAG_FLAG(maintenance_manager_flush_ahead, advanced);
+
+DEFINE_int32(maintenance_manager_flush_ahead_min_lead_ms, 5000,
+             "Minimum time ahead of reaching the soft memory limit at which "
+             "flushes are started, with --maintenance_manager_flush_ahead. The "
+             "lead is also at least twice the recent duration of flushes.");
+TAG_FLAG(maintenance_manager_flush_ahead_min_lead_ms, advanced);
+
+DEFINE_int32(maintenance_manager_ram_growth_window_ms, 10000,
+             "Time over which the rate of growth of the memory anchored by each "
+             "op is smoothed, with --maintenance_manager_flush_ahead.");
+TAG_FLAG(maintenance_manager_ram_growth_window_ms, advanced);
+
 DEFINE_int32(maintenance_manager_polling_interval_ms, 250,
        "Polling interval for the maintenance manager scheduler, "
        "in milliseconds.");
@@ -75,9 +114,14 @@ MaintenanceOp::MaintenanceOp(std::string name, IOUsage io_usage)
     : name_(std::move(name)),
       running_(0),
       cancel_(false),
+      preempt_(false),
       io_usage_(io_usage) {
 }
 
+MaintenanceOp::Lane MaintenanceOp::lane() const {
+  return io_usage_ == LOW_IO_USAGE ? GC_LANE : COMPACTION_LANE;
+}
+
 MaintenanceOp::~MaintenanceOp() {
   CHECK(!manager_.get()) << "You must unregister the " << name_
          << " Op before destroying it.";
@@ -93,20 +137,36 @@ const MaintenanceManager::Options MaintenanceManager::DEFAULT_OPTIONS = {
   0,
   0,
   shared_ptr<MemTracker>(),
+  0,
 };
 
 MaintenanceManager::MaintenanceManager(const Options& options)
-  : num_threads_(options.num_threads <= 0 ?
-      FLAGS_maintenance_manager_num_threads : options.num_threads),
+  : num_threads_(std::max(options.num_threads <= 0 ?
+                              FLAGS_maintenance_manager_num_threads : options.num_threads, 1) +
+                 std::max(FLAGS_maintenance_manager_flush_threads, 1) +
+                 std::max(FLAGS_maintenance_manager_gc_threads, 1)),
+    max_high_io_ops_(std::max(FLAGS_maintenance_manager_max_high_io_ops_per_disk, 0) *
+                     options.num_data_dirs),
     cond_(&lock_),
     shutdown_(false),
     running_ops_(0),
+    running_high_io_ops_(0),
     polling_interval_ms_(options.polling_interval_ms <= 0 ?
           FLAGS_maintenance_manager_polling_interval_ms :
           options.polling_interval_ms),
     completed_ops_count_(0),
     parent_mem_tracker_(!options.parent_mem_tracker ?
-        MemTracker::GetRootTracker() : options.parent_mem_tracker) {
+        MemTracker::GetRootTracker() : options.parent_mem_tracker),
+    flush_ahead_op_(nullptr),
+    flush_ahead_ram_anchored_(0),
+    flush_duration_s_(0) {
+  lane_threads_[MaintenanceOp::FLUSH_LANE] = std::max(FLAGS_maintenance_manager_flush_threads, 1);
+  lane_threads_[MaintenanceOp::GC_LANE] = std::max(FLAGS_maintenance_manager_gc_threads, 1);
+  lane_threads_[MaintenanceOp::COMPACTION_LANE] = num_threads_ -
+      lane_threads_[MaintenanceOp::FLUSH_LANE] - lane_threads_[MaintenanceOp::GC_LANE];
+  for (auto& running : lane_running_ops_) {
+    running = 0;
+  }
   CHECK_OK(ThreadPoolBuilder("MaintenanceMgr").set_min_threads(num_threads_)
                .set_max_threads(num_threads_).Build(&thread_pool_));
   uint32_t history_size = options.history_size == 0 ?
@@ -178,6 +238,10 @@ void MaintenanceManager::UnregisterOp(MaintenanceOp* op) {
           << "waiting for it to complete";
     }
     ops_.erase(iter);
+    ram_growth_.erase(op);
+    if (flush_ahead_op_ == op) {
+      flush_ahead_op_ = nullptr;
+    }
   }
   LOG(INFO) << "Unregistered op " << op->name();
   op->cond_.reset();
@@ -197,6 +261,8 @@ void MaintenanceManager::RunSchedulerThread() {
       return;
     }
 
+    MaybePreemptOps();
+
     // Find the best op.
     MaintenanceOp* op = FindBestOp();
     if (!op) {
@@ -204,9 +270,14 @@ void MaintenanceManager::RunSchedulerThread() {
       continue;
     }
 
+    if (op == flush_ahead_op_) {
+      flushes_ahead_in_flight_[op] = flush_ahead_ram_anchored_;
+    }
+
     // Prepare the maintenance operation.
     op->running_++;
-    running_ops_++;
+    op->preempt_.Store(false);
+    UpdateRunningOps(op, 1);
     guard.unlock();
     bool ready = op->Prepare();
     guard.lock();
@@ -214,6 +285,8 @@ void MaintenanceManager::RunSchedulerThread() {
       LOG(INFO) << "Prepare failed for " << op->name()
                 << ".  Re-running scheduler.";
       op->running_--;
+      UpdateRunningOps(op, -1);
+      flushes_ahead_in_flight_.erase(op);
       op->cond_->Signal();
       continue;
     }
@@ -225,10 +298,12 @@ void MaintenanceManager::RunSchedulerThread() {
   }
 }
 
-// Finding the best operation goes through four filters:
+// Finding the best operation goes through five filters:
 // - If there's an Op that we can run quickly that frees log retention, we run it.
 // - If we've hit the overall process memory limit (note: this includes memory that the Ops cannot
 //   free), we run the Op with the highest RAM usage.
+// - If memory is anchored fast enough to reach the limit before a flush could finish, we run the
+//   flush which retains the most logs (and if many qualify, the one that frees up the most RAM).
 // - If there are Ops that retain logs, we run the one that has the highest retention (and if many
 //   qualify, then we run the one that also frees up the most RAM).
 // - Finally, if there's nothing else that we really need to do, we run the Op that will improve
@@ -238,7 +313,7 @@ void MaintenanceManager::RunSchedulerThread() {
 // hold on to. Low IO Ops go first since we can quickly run them, then we can look at memory usage.
 // Reversing those can starve the low IO Ops when the system is under intense memory pressure.
 //
-// In the third priority we're at a point where nothing's urgent and there's nothing we can run
+// In the fourth priority we're at a point where nothing's urgent and there's nothing we can run
 // quickly.
 // TODO We currently optimize for freeing log retention but we could consider having some sort of
 // sliding priority between log retention and RAM usage. For example, is an Op that frees
@@ -267,17 +342,35 @@ MaintenanceOp* MaintenanceManager::FindBestOp() {
   int64_t most_logs_retained_bytes_ram_anchored = 0;
   MaintenanceOp* most_logs_retained_bytes_op = nullptr;
 
+  int64_t flush_most_logs_retained_bytes = 0;
+  uint64_t flush_most_logs_retained_bytes_ram_anchored = 0;
+  MaintenanceOp* flush_most_logs_retained_bytes_op = nullptr;
+
   double best_perf_improvement = 0;
   MaintenanceOp* best_perf_improvement_op = nullptr;
+
+  MonoTime now = MonoTime::Now();
+  double ram_growth_bytes_per_sec = 0;
+  flush_ahead_op_ = nullptr;
   for (OpMapTy::value_type &val : ops_) {
     MaintenanceOp* op(val.first);
     MaintenanceOpStats& stats(val.second);
     // Update op stats.
     stats.Clear();
     op->UpdateStats(&stats);
-    if (op->cancelled() || !stats.valid() || !stats.runnable()) {
+    ram_growth_bytes_per_sec += UpdateRamGrowth(op, stats, now);
+    if (op->cancelled() || !stats.valid() || !stats.runnable() || !HasCapacityFor(op)) {
       continue;
     }
+    if (op->lane() == MaintenanceOp::FLUSH_LANE && stats.ram_anchored() > 0 &&
+        (!flush_most_logs_retained_bytes_op ||
+            stats.logs_retained_bytes() > flush_most_logs_retained_bytes ||
+            (stats.logs_retained_bytes() == flush_most_logs_retained_bytes &&
+                stats.ram_anchored() > flush_most_logs_retained_bytes_ram_anchored))) {
+      flush_most_logs_retained_bytes_op = op;
+      flush_most_logs_retained_bytes = stats.logs_retained_bytes();
+      flush_most_logs_retained_bytes_ram_anchored = stats.ram_anchored();
+    }
     if (stats.logs_retained_bytes() > low_io_most_logs_retained_bytes &&
         op->io_usage_ == MaintenanceOp::LOW_IO_USAGE) {
       low_io_most_logs_retained_bytes_op = op;
@@ -334,6 +427,22 @@ MaintenanceOp* MaintenanceManager::FindBestOp() {
     return most_mem_anchored_op;
   }
 
+  // Look at how fast memory is being anchored. If it would reach the soft limit
+  // before a flush started now finishes, flush ahead of the limit.
+  if (flush_most_logs_retained_bytes_op) {
+    double flush_ahead_bytes = FlushAheadBytes(ram_growth_bytes_per_sec);
+    if (flush_ahead_bytes > 0) {
+      VLOG_AND_TRACE("maintenance", 1)
+              << "Performing " << flush_most_logs_retained_bytes_op->name() << ", "
+              << "because memory is anchored at " << ram_growth_bytes_per_sec
+              << " bytes/s and " << flush_ahead_bytes << " more bytes must be flushed "
+              << "to stay under the soft memory limit";
+      flush_ahead_op_ = flush_most_logs_retained_bytes_op;
+      flush_ahead_ram_anchored_ = flush_most_logs_retained_bytes_ram_anchored;
+      return flush_most_logs_retained_bytes_op;
+    }
+  }
+
   if (most_logs_retained_bytes_op) {
     VLOG_AND_TRACE("maintenance", 1)
             << "Performing " << most_logs_retained_bytes_op->name() << ", "
@@ -353,6 +462,73 @@ MaintenanceOp* MaintenanceManager::FindBestOp() {
   return nullptr;
 }
 
+double MaintenanceManager::UpdateRamGrowth(MaintenanceOp* op, const MaintenanceOpStats& stats,
+                                           const MonoTime& now) {
+  uint64_t ram_anchored = stats.valid() ? stats.ram_anchored() : 0;
+  RamGrowth& growth = ram_growth_[op];
+  if (growth.last_sample.Initialized()) {
+    double elapsed_s = (now - growth.last_sample).ToSeconds();
+    // Anchored memory drops when the op runs; that doesn't mean it's anchored
+    // any slower, so only growth is sampled.
+    if (elapsed_s > 0 && ram_anchored >= growth.last_ram_anchored) {
+      double rate = (ram_anchored - growth.last_ram_anchored) / elapsed_s;
+      double weight = std::min(
+          1.0, elapsed_s * 1000 / std::max(FLAGS_maintenance_manager_ram_growth_window_ms, 1));
+      growth.bytes_per_sec += weight * (rate - growth.bytes_per_sec);
+    }
+  }
+  growth.last_ram_anchored = ram_anchored;
+  growth.last_sample = now;
+  return growth.bytes_per_sec;
+}
+
+double MaintenanceManager::FlushAheadBytes(double ram_growth_bytes_per_sec) const {
+  if (!FLAGS_maintenance_manager_flush_ahead || ram_growth_bytes_per_sec <= 0) {
+    return 0;
+  }
+  double lead_s = std::max(FLAGS_maintenance_manager_flush_ahead_min_lead_ms / 1000.0,
+                           2 * flush_duration_s_);
+  double bytes = ram_growth_bytes_per_sec * lead_s -
+      static_cast<double>(parent_mem_tracker_->SpareSoftCapacity());
+  for (const auto& entry : flushes_ahead_in_flight_) {
+    bytes -= entry.second;
+  }
+  return std::max(bytes, 0.0);
+}
+
+bool MaintenanceManager::HasCapacityFor(const MaintenanceOp* op) const {
+  if (lane_running_ops_[op->lane()] >= lane_threads_[op->lane()]) {
+    return false;
+  }
+  return op->io_usage() == MaintenanceOp::LOW_IO_USAGE ||
+      max_high_io_ops_ == 0 || running_high_io_ops_ < max_high_io_ops_;
+}
+
+void MaintenanceManager::UpdateRunningOps(MaintenanceOp* op, int delta) {
+  running_ops_ += delta;
+  lane_running_ops_[op->lane()] += delta;
+  if (op->io_usage() == MaintenanceOp::HIGH_IO_USAGE) {
+    running_high_io_ops_ += delta;
+  }
+  DCHECK_GE(lane_running_ops_[op->lane()], 0);
+  DCHECK_GE(running_high_io_ops_, 0);
+}
+
+void MaintenanceManager::MaybePreemptOps() {
+  if (lane_running_ops_[MaintenanceOp::COMPACTION_LANE] == 0 ||
+      !parent_mem_tracker_->AnySoftLimitExceeded(nullptr)) {
+    return;
+  }
+  for (OpMapTy::value_type& val : ops_) {
+    MaintenanceOp* op = val.first;
+    if (op->running_ > 0 && op->lane() == MaintenanceOp::COMPACTION_LANE && !op->preempted()) {
+      VLOG_AND_TRACE("maintenance", 1) << "Preempting " << op->name()
+                                       << " because we have exceeded our soft memory limit";
+      op->preempt_.Store(true);
+    }
+  }
+}
+
 void MaintenanceManager::LaunchOp(MaintenanceOp* op) {
   MonoTime start_time(MonoTime::Now());
   op->RunningGauge()->Increment();
@@ -378,8 +554,13 @@ void MaintenanceManager::LaunchOp(MaintenanceOp* op) {
   completed_ops_count_++;
 
   op->DurationHistogram()->Increment(delta.ToMilliseconds());
+  if (op->lane() == MaintenanceOp::FLUSH_LANE) {
+    flush_duration_s_ = flush_duration_s_ == 0 ? delta.ToSeconds() :
+        0.7 * flush_duration_s_ + 0.3 * delta.ToSeconds();
+  }
+  flushes_ahead_in_flight_.erase(op);
 
-  running_ops_--;
+  UpdateRunningOps(op, -1);
   op->running_--;
   op->cond_->Signal();
 }
@@ -143,6 +143,16 @@ class MaintenanceOp {
     HIGH_IO_USAGE // Everything else.
   };
 
+  // The scheduling lanes of the MaintenanceManager. Each lane has its own budget
+  // of worker threads, so that long ops of one lane (e.g. compactions) can't keep
+  // the ops of another (e.g. flushes) from running.
+  enum Lane {
+    FLUSH_LANE,      // Ops which free memory by writing it out to disk.
+    COMPACTION_LANE, // Ops which rewrite on-disk data to improve performance.
+    GC_LANE,         // Low impact ops which free up logs or disk space.
+    NUM_LANES
+  };
+
   explicit MaintenanceOp(std::string name, IOUsage io_usage);
   virtual ~MaintenanceOp();
 
@@ -172,6 +182,10 @@ class MaintenanceOp {
   // Returns the gauge for this op that tracks when this op is running. Cannot be NULL.
   virtual scoped_refptr<AtomicGauge<uint32_t> > RunningGauge() const = 0;
 
+  // Returns the lane this op is scheduled in. By default, LOW_IO_USAGE ops run
+  // in the GC lane and all others in the compaction lane.
+  virtual Lane lane() const;
+
   uint32_t running() { return running_; }
 
   std::string name() const { return name_; }
@@ -191,6 +205,14 @@ class MaintenanceOp {
     cancel_.Store(true);
   }
 
+  // Return true if the manager asked the running instances of this operation to
+  // stop early, because the server is under memory pressure. Unlike
+  // cancelled(), this only applies to the current run: ops which can abort a
+  // lengthy Perform() midway should poll this too, and may be rescheduled.
+  bool preempted() const {
+    return preempt_.Load();
+  }
+
  private:
   DISALLOW_COPY_AND_ASSIGN(MaintenanceOp);
 
@@ -205,6 +227,10 @@ class MaintenanceOp {
   // New operations will not be scheduled when this boolean is set.
   AtomicBool cancel_;
 
+  // Set by the manager to preempt the running instances of this op. Reset
+  // whenever a new instance is scheduled.
+  AtomicBool preempt_;
+
   // Condition variable which the UnregisterOp function can wait on.
   //
   // Note: 'cond_' is used with the MaintenanceManager's mutex. As such,
@@ -243,6 +269,9 @@ class MaintenanceManager : public std::enable_shared_from_this<MaintenanceManage
     int32_t polling_interval_ms;
     uint32_t history_size;
     std::shared_ptr<MemTracker> parent_mem_tracker;
+    // The number of data directories of the server, used to limit the number
+    // of HIGH_IO_USAGE ops running at once. 0 means no limit.
+    int32_t num_data_dirs;
   };
 
   explicit MaintenanceManager(const Options& options);
@@ -265,6 +294,7 @@ class MaintenanceManager : public std::enable_shared_from_this<MaintenanceManage
 
  private:
   FRIEND_TEST(MaintenanceManagerTest, TestLogRetentionPrioritization);
+  FRIEND_TEST(MaintenanceManagerTest, TestFlushAheadOfMemoryLimit);
   typedef std::map<MaintenanceOp*, MaintenanceOpStats,
           MaintenanceOpComparator> OpMapTy;
 
@@ -273,9 +303,36 @@ class MaintenanceManager : public std::enable_shared_from_this<MaintenanceManage
   // find the best op, or null if there is nothing we want to run
   MaintenanceOp* FindBestOp();
 
+  // Updates the smoothed rate at which 'op' anchors more memory, from the
+  // growth of its ram_anchored since the last call. Returns the rate in bytes
+  // per second.
+  double UpdateRamGrowth(MaintenanceOp* op, const MaintenanceOpStats& stats,
+                         const MonoTime& now);
+
+  // Returns how much memory flushes should start freeing now, so that memory
+  // anchored at a rate of 'ram_growth_bytes_per_sec' doesn't reach the soft
+  // memory limit before they finish. Flushes already started ahead of the
+  // limit count towards it. 0 if there's no need to flush ahead of the limit.
+  double FlushAheadBytes(double ram_growth_bytes_per_sec) const;
+
+  // Returns true if there's a free thread in the lane of 'op', and running it
+  // wouldn't exceed the limit of concurrent HIGH_IO_USAGE ops.
+  bool HasCapacityFor(const MaintenanceOp* op) const;
+
+  // Updates the number of running ops after an instance of 'op' was scheduled
+  // (delta = 1) or finished (delta = -1).
+  void UpdateRunningOps(MaintenanceOp* op, int delta);
+
+  // If the server is under memory pressure, preempts the running ops of the
+  // compaction lane, so that they stop competing with the ops freeing memory.
+  void MaybePreemptOps();
+
   void LaunchOp(MaintenanceOp* op);
 
   const int32_t num_threads_;
+  int32_t lane_threads_[MaintenanceOp::NUM_LANES];
+  // 0 if there's no limit.
+  const int32_t max_high_io_ops_;
   OpMapTy ops_; // registered operations
   Mutex lock_;
   scoped_refptr<kudu::Thread> monitor_thread_;
@@ -283,6 +340,8 @@ class MaintenanceManager : public std::enable_shared_from_this<MaintenanceManage
   ConditionVariable cond_;
   bool shutdown_;
   uint64_t running_ops_;
+  int32_t lane_running_ops_[MaintenanceOp::NUM_LANES];
+  int32_t running_high_io_ops_;
   int32_t polling_interval_ms_;
   // Vector used as a circular buffer for recently completed ops. Elements need to be added at
   // the completed_ops_count_ % the vector's size and then the count needs to be incremented.
@@ -290,6 +349,25 @@ class MaintenanceManager : public std::enable_shared_from_this<MaintenanceManage
   int64_t completed_ops_count_;
   std::shared_ptr<MemTracker> parent_mem_tracker_;
 
+  struct RamGrowth {
+    uint64_t last_ram_anchored = 0;
+    MonoTime last_sample;
+    double bytes_per_sec = 0;
+  };
+  std::map<MaintenanceOp*, RamGrowth> ram_growth_;
+
+  // The op which the last call to FindBestOp() picked to flush ahead of the
+  // memory limit, and the memory it anchored then. Null if none.
+  MaintenanceOp* flush_ahead_op_;
+  uint64_t flush_ahead_ram_anchored_;
+
+  // The memory anchored by the running flushes which were started ahead of the
+  // memory limit, keyed by op.
+  std::map<MaintenanceOp*, uint64_t> flushes_ahead_in_flight_;
+
+  // Smoothed duration of the ops of the flush lane, in seconds.
+  double flush_duration_s_;
+
   DISALLOW_COPY_AND_ASSIGN(MaintenanceManager);
 };
 
@@ -360,4 +360,40 @@ TEST(MemTrackerTest, TestMultiThreadedRegisterAndDestroy) {
   }
 }
 
+// Concurrent updates spread over the striped consumption counters must still
+// add up exactly, and TryConsume() must not let a tracker exceed its limit.
+TEST(MemTrackerTest, TestMultiThreadedConsumeAndTryConsume) {
+  const int kNumThreads = 8;
+  const int kNumIterations = 10000;
+  const int64_t kLimit = 1000;
+  shared_ptr<MemTracker> p = MemTracker::CreateTracker(-1, "parent");
+  shared_ptr<MemTracker> limited = MemTracker::CreateTracker(kLimit, "limited", p);
+  shared_ptr<MemTracker> unlimited = MemTracker::CreateTracker(-1, "unlimited", p);
+
+  std::atomic<int64_t> num_consumed(0);
+  vector<std::thread> threads;
+  for (int i = 0; i < kNumThreads; i++) {
+    threads.emplace_back([&]{
+        for (int j = 0; j < kNumIterations; j++) {
+          unlimited->Consume(j);
+          if (limited->TryConsume(1)) {
+            num_consumed++;
+          }
+          unlimited->Release(j);
+        }
+      });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  ASSERT_EQ(kLimit, num_consumed.load());
+  ASSERT_EQ(kLimit, limited->consumption());
+  ASSERT_EQ(0, unlimited->consumption());
+  ASSERT_EQ(kLimit, p->consumption());
+  ASSERT_GT(unlimited->peak_consumption(), 0);
+
+  limited->Release(kLimit);
+  ASSERT_EQ(0, p->consumption());
+}
+
 } // namespace kudu
@@ -29,6 +29,7 @@
 
 #include "kudu/gutil/map-util.h"
 #include "kudu/gutil/once.h"
+#include "kudu/gutil/sysinfo.h"
 #include "kudu/gutil/strings/join.h"
 #include "kudu/gutil/strings/human_readable.h"
 #include "kudu/gutil/strings/substitute.h"
@@ -169,7 +170,7 @@ MemTracker::MemTracker(ConsumptionFunction consumption_func, int64_t byte_limit,
       id_(id),
       descr_(Substitute("memory consumption for $0", id)),
       parent_(std::move(parent)),
-      consumption_(0),
+      peak_consumption_(0),
       consumption_func_(std::move(consumption_func)),
       rand_(GetRandomSeed32()),
       enable_logging_(false),
@@ -279,7 +280,38 @@ void MemTracker::ListTrackers(vector<shared_ptr<MemTracker>>* trackers) {
 void MemTracker::UpdateConsumption() {
   DCHECK(!consumption_func_.empty());
   DCHECK(parent_.get() == NULL);
-  consumption_.set_value(consumption_func_());
+  // Adjust by the difference rather than resetting the counter, so that
+  // concurrent readers never see it drop to zero.
+  int64_t value = consumption_func_();
+  consumption_.IncrementBy(value - consumption_.Value());
+  peak_consumption_.StoreMax(value, kMemOrderNoBarrier);
+}
+
+bool MemTracker::TryIncrementConsumption(int64_t bytes) {
+  DCHECK(has_limit());
+  if (bytes <= kLimitCheckChunkBytes &&
+      consumption_.Value() + bytes <= limit_ - kLimitCheckChunkBytes * base::NumCPUs()) {
+    consumption_.IncrementBy(bytes);
+    return true;
+  }
+  std::lock_guard<simple_spinlock> l(limit_lock_);
+  if (consumption() + bytes > limit_) {
+    return false;
+  }
+  consumption_.IncrementBy(bytes);
+  return true;
+}
+
+void MemTracker::MaybeSamplePeakConsumption(int64_t bytes) {
+  static __thread int64_t bytes_since_sample = 0;
+  bytes_since_sample += bytes;
+  if (PREDICT_TRUE(bytes_since_sample < kPeakSampleBytes)) {
+    return;
+  }
+  bytes_since_sample = 0;
+  for (auto& tracker : all_trackers_) {
+    tracker->consumption();
+  }
 }
 
 void MemTracker::Consume(int64_t bytes) {
@@ -299,11 +331,9 @@ void MemTracker::Consume(int64_t bytes) {
     LogUpdate(true, bytes);
   }
   for (auto& tracker : all_trackers_) {
-    tracker->consumption_.IncrementBy(bytes);
-    if (!tracker->consumption_func_.empty()) {
-      DCHECK_GE(tracker->consumption_.current_value(), 0);
-    }
+    tracker->IncrementConsumption(bytes);
   }
+  MaybeSamplePeakConsumption(bytes);
 }
 
 bool MemTracker::TryConsume(int64_t bytes) {
@@ -323,15 +353,14 @@ bool MemTracker::TryConsume(int64_t bytes) {
   for (i = all_trackers_.size() - 1; i >= 0; --i) {
     MemTracker *tracker = all_trackers_[i];
     if (tracker->limit_ < 0) {
-      tracker->consumption_.IncrementBy(bytes);
+      tracker->IncrementConsumption(bytes);
     } else {
-      if (!tracker->consumption_.TryIncrementBy(bytes, tracker->limit_)) {
+      if (!tracker->TryIncrementConsumption(bytes)) {
         // One of the trackers failed, attempt to GC memory or expand our limit. If that
         // succeeds, TryUpdate() again. Bail if either fails.
         if (!tracker->GcMemory(tracker->limit_ - bytes) ||
             tracker->ExpandLimit(bytes)) {
-          if (!tracker->consumption_.TryIncrementBy(
-                  bytes, tracker->limit_)) {
+          if (!tracker->TryIncrementConsumption(bytes)) {
             break;
           }
         } else {
@@ -342,6 +371,7 @@ bool MemTracker::TryConsume(int64_t bytes) {
   }
   // Everyone succeeded, return.
   if (i == -1) {
+    MaybeSamplePeakConsumption(bytes);
     return true;
   }
 
@@ -355,7 +385,7 @@ bool MemTracker::TryConsume(int64_t bytes) {
   // to adjust the consumption of the query tracker to stop the resource from never
   // getting used by a subsequent TryConsume()?
   for (int j = all_trackers_.size() - 1; j > i; --j) {
-    all_trackers_[j]->consumption_.IncrementBy(-bytes);
+    all_trackers_[j]->IncrementConsumption(-bytes);
   }
   return false;
 }
@@ -383,17 +413,11 @@ void MemTracker::Release(int64_t bytes) {
     LogUpdate(false, bytes);
   }
 
+  // The consumption isn't read back to check that it stays non-negative:
+  // summing the striped counter on every update would bring back the
+  // contention it avoids.
   for (auto& tracker : all_trackers_) {
-    tracker->consumption_.IncrementBy(-bytes);
-    // If a UDF calls FunctionContext::TrackAllocation() but allocates less than the
-    // reported amount, the subsequent call to FunctionContext::Free() may cause the
-    // process mem tracker to go negative until it is synced back to the tcmalloc
-    // metric. Don't blow up in this case. (Note that this doesn't affect non-process
-    // trackers since we can enforce that the reported memory usage is internally
-    // consistent.)
-    if (!tracker->consumption_func_.empty()) {
-      DCHECK_GE(tracker->consumption_.current_value(), 0);
-    }
+    tracker->IncrementConsumption(-bytes);
   }
 }
 
@@ -464,6 +488,15 @@ int64_t MemTracker::SpareCapacity() const {
   return result;
 }
 
+int64_t MemTracker::SpareSoftCapacity() const {
+  int64_t result = std::numeric_limits<int64_t>::max();
+  for (const auto& tracker : limit_trackers_) {
+    int64_t mem_left = tracker->soft_limit_ - tracker->consumption();
+    result = std::min(result, mem_left);
+  }
+  return result;
+}
+
 bool MemTracker::GcMemory(int64_t max_consumption) {
   if (max_consumption < 0) {
     // Impossible to GC enough memory to reach the goal.
@@ -17,6 +17,7 @@
 #ifndef KUDU_UTIL_MEM_TRACKER_H
 #define KUDU_UTIL_MEM_TRACKER_H
 
+#include <algorithm>
 #include <boost/function.hpp>
 #include <list>
 #include <memory>
@@ -25,10 +26,11 @@
 #include <vector>
 
 #include "kudu/gutil/ref_counted.h"
-#include "kudu/util/high_water_mark.h"
+#include "kudu/util/atomic.h"
 #include "kudu/util/locks.h"
 #include "kudu/util/mutex.h"
 #include "kudu/util/random.h"
+#include "kudu/util/striped64.h"
 
 namespace kudu {
 
@@ -69,6 +71,13 @@ class MemTracker;
 // this will be called before the process limit is reported as exceeded. GcFunctions are
 // called in the order they are added, so expensive functions should be added last.
 //
+// Consumption is kept in a striped counter, so that threads updating the same
+// trackers concurrently (most notably the root tracker, which is an ancestor of
+// every other tracker) spread their updates over several cache lines rather
+// than contending on a single one. Limits remain exact: TryConsume() serializes
+// the check and update of a tracker once its consumption is within a few
+// chunks of its limit, and only skips that when the limit is far away.
+//
 // This class is thread-safe.
 //
 // NOTE: this class has been partially ported over from Impala with
@@ -187,6 +196,10 @@ class MemTracker : public std::enable_shared_from_this<MemTracker> {
   // limits and a negative value if any limit is already exceeded.
   int64_t SpareCapacity() const;
 
+  // Like SpareCapacity(), but up to the soft limits of this tracker and its
+  // parents rather than their hard limits.
+  int64_t SpareSoftCapacity() const;
+
 
   int64_t limit() const { return limit_; }
   bool has_limit() const { return limit_ >= 0; }
@@ -194,14 +207,25 @@ class MemTracker : public std::enable_shared_from_this<MemTracker> {
 
   // Returns the memory consumed in bytes.
   int64_t consumption() const {
-    return consumption_.current_value();
+    int64_t value = consumption_.Value();
+    // StoreMax() always writes, so check first to keep the line shared.
+    if (PREDICT_FALSE(value > peak_consumption_.Load(kMemOrderNoBarrier))) {
+      peak_consumption_.StoreMax(value, kMemOrderNoBarrier);
+    }
+    return value;
   }
 
   // Note that if consumption_ is based on consumption_func_, this
   // will be the max value we've recorded in consumption(), not
   // necessarily the highest value consumption_func_ has ever
   // reached.
-  int64_t peak_consumption() const { return consumption_.max_value(); }
+  //
+  // The peak is sampled whenever the consumption is read and, on the update
+  // path, every kPeakSampleBytes consumed by a thread, so it may miss short
+  // spikes smaller than that.
+  int64_t peak_consumption() const {
+    return std::max(consumption(), peak_consumption_.Load(kMemOrderNoBarrier));
+  }
 
   // Retrieve the parent tracker, or NULL If one is not set.
   std::shared_ptr<MemTracker> parent() const { return parent_; }
@@ -243,6 +267,19 @@ class MemTracker : public std::enable_shared_from_this<MemTracker> {
     return limit_ >= 0 && limit_ < consumption();
   }
 
+  // Adds 'bytes' to the consumption of this tracker, without any limit check.
+  void IncrementConsumption(int64_t bytes) {
+    consumption_.IncrementBy(bytes);
+  }
+
+  // Adds 'bytes' to the consumption of this tracker if that doesn't take it
+  // over its limit. Returns true if the consumption was updated.
+  bool TryIncrementConsumption(int64_t bytes);
+
+  // Samples the peak consumption of all_trackers_ if the calling thread has
+  // consumed more than kPeakSampleBytes since it last did so.
+  void MaybeSamplePeakConsumption(int64_t bytes);
+
   // If consumption is higher than max_consumption, attempts to free memory by calling any
   // added GC functions.  Returns true if max_consumption is still exceeded. Takes
   // gc_lock. Updates metrics if initialized.
@@ -294,15 +331,28 @@ class MemTracker : public std::enable_shared_from_this<MemTracker> {
   // TODO: this is a stopgap.
   static const int64_t GC_RELEASE_SIZE = 128 * 1024L * 1024L;
 
+  // TryConsume() of at most this many bytes skips serializing on limit_lock_
+  // while the tracker is at least this many bytes per CPU below its limit. The
+  // striped counter may then overshoot the limit only if more threads than
+  // CPUs race between reading the consumption and updating it.
+  static const int64_t kLimitCheckChunkBytes = 256 * 1024L;
+
+  // See peak_consumption().
+  static const int64_t kPeakSampleBytes = 64 * 1024L;
+
   simple_spinlock gc_lock_;
 
+  // Serializes TryConsume() once the consumption is close to limit_.
+  simple_spinlock limit_lock_;
+
   int64_t limit_;
   int64_t soft_limit_;
   const std::string id_;
   const std::string descr_;
   std::shared_ptr<MemTracker> parent_;
 
-  HighWaterMark consumption_;
+  LongAdder consumption_;
+  mutable AtomicInt<int64_t> peak_consumption_;
 
   ConsumptionFunction consumption_func_;
 
@@ -174,6 +174,50 @@ TEST(TestArena, TestMemoryTrackingEnforced) {
   ASSERT_EQ(256, mem_tracker->consumption());
 }
 
+TEST(TestArena, TestChunkPoolRecyclesChunks) {
+  const int64_t kChunkSize = 64 * 1024;
+  ChunkPoolBufferAllocator* pool = ChunkPoolBufferAllocator::Get();
+  pool->ReleaseCachedChunks();
+  ASSERT_EQ(0, pool->cached_bytes());
+
+  // A freed chunk is handed out again to the next request of its size.
+  gscoped_ptr<Buffer> buffer(pool->Allocate(kChunkSize));
+  void* data = buffer->data();
+  buffer.reset();
+  ASSERT_EQ(kChunkSize, pool->cached_bytes());
+  buffer.reset(pool->Allocate(kChunkSize));
+  ASSERT_EQ(data, buffer->data());
+  ASSERT_EQ(0, pool->cached_bytes());
+
+  // Buffers whose size is not a power of two are not pooled.
+  gscoped_ptr<Buffer> odd_buffer(pool->Allocate(1000));
+  odd_buffer.reset();
+  ASSERT_EQ(0, pool->cached_bytes());
+
+  // The caches of exiting threads are moved to the shared pool.
+  thread t([&]() { buffer.reset(); });
+  t.join();
+  ASSERT_EQ(kChunkSize, pool->cached_bytes());
+  buffer.reset(pool->Allocate(kChunkSize));
+  ASSERT_EQ(data, buffer->data());
+  buffer.reset();
+
+  // Arenas return their chunks when destroyed, and later arenas reuse them.
+  size_t footprint;
+  for (int i = 0; i < 2; i++) {
+    Arena arena(1024, 16 * 1024);
+    for (int j = 0; j < 64; j++) {
+      ASSERT_TRUE(arena.AllocateBytes(1024));
+    }
+    footprint = arena.memory_footprint();
+    ASSERT_EQ(kChunkSize, pool->cached_bytes());
+  }
+  ASSERT_EQ(kChunkSize + footprint, pool->cached_bytes());
+
+  pool->ReleaseCachedChunks();
+  ASSERT_EQ(0, pool->cached_bytes());
+}
+
 TEST(TestArena, TestSTLAllocator) {
   Arena a(256, 256 * 1024);
   typedef vector<int, ArenaAllocator<int, false> > ArenaVector;
@@ -56,7 +56,7 @@ ArenaBase<THREADSAFE>::ArenaBase(
 
 template <bool THREADSAFE>
 ArenaBase<THREADSAFE>::ArenaBase(size_t initial_buffer_size, size_t max_buffer_size)
-    : buffer_allocator_(HeapBufferAllocator::Get()),
+    : buffer_allocator_(ChunkPoolBufferAllocator::Get()),
       max_buffer_size_(max_buffer_size),
       arena_footprint_(0),
       warned_(false) {
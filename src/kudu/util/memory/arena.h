@@ -90,8 +90,8 @@ class ArenaBase {
             size_t initial_buffer_size,
             size_t max_buffer_size);
 
-  // Creates an arena using a default (heap) allocator with unbounded capacity.
-  // Discretion advised.
+  // Creates an arena using a default (pooled heap) allocator with unbounded
+  // capacity. Discretion advised.
   ArenaBase(size_t initial_buffer_size, size_t max_buffer_size);
 
   // Adds content of the specified Slice to the arena, and returns a
@@ -152,6 +152,8 @@ class ArenaBase {
   // Unless allocations exceed max_buffer_size, repetitive filling up and
   // resetting normally lead to quickly settling memory footprint and ceasing
   // buffer allocations, as the arena keeps reusing a single, large buffer.
+  // The discarded buffers are returned to the allocator; the default one
+  // keeps them for reuse by other arenas (see ChunkPoolBufferAllocator).
   void Reset();
 
   // Returns the memory footprint of this arena, in bytes, defined as a sum of
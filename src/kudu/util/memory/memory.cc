@@ -20,6 +20,8 @@
 
 #include "kudu/util/memory/memory.h"
 
+#include "kudu/gutil/bits.h"
+#include "kudu/gutil/dynamic_annotations.h"
 #include "kudu/util/alignment.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/memory/overwrite.h"
@@ -85,6 +87,17 @@ DEFINE_bool(allocator_aligned_mode, false,
             "unless explicitly specified otherwise - to boost SIMD");
 TAG_FLAG(allocator_aligned_mode, hidden);
 
+DEFINE_int64(arena_chunk_thread_cache_bytes, 8 * 1024 * 1024,
+             "Maximum total size of the free arena chunks cached by each thread "
+             "for reuse by later arenas of the same thread.");
+TAG_FLAG(arena_chunk_thread_cache_bytes, advanced);
+
+DEFINE_int64(arena_chunk_pool_capacity_bytes, 256 * 1024 * 1024,
+             "Maximum total size of the free arena chunks kept in the shared "
+             "pool, in addition to the per-thread caches, for reuse by later "
+             "arenas of any thread.");
+TAG_FLAG(arena_chunk_pool_capacity_bytes, advanced);
+
 HeapBufferAllocator::HeapBufferAllocator()
   : aligned_mode_(FLAGS_allocator_aligned_mode) {
 }
@@ -170,6 +183,160 @@ void* HeapBufferAllocator::Realloc(void* previousData, size_t previousSize,
   }
 }
 
+const size_t ChunkPoolBufferAllocator::kMinChunkSize;
+const size_t ChunkPoolBufferAllocator::kMaxChunkSize;
+const int ChunkPoolBufferAllocator::kNumSizeClasses;
+
+DEFINE_STATIC_THREAD_LOCAL(ChunkPoolBufferAllocator::ThreadCache,
+                           ChunkPoolBufferAllocator, tls_cache_);
+__thread bool ChunkPoolBufferAllocator::tls_cache_destroyed_;
+
+ChunkPoolBufferAllocator::ThreadCache::~ThreadCache() {
+  pool->FlushThreadCache(this);
+  // Buffers may still be freed by the destructors of other thread locals.
+  tls_cache_destroyed_ = true;
+}
+
+ChunkPoolBufferAllocator::ChunkPoolBufferAllocator()
+    : mem_tracker_(MemTracker::CreateTracker(-1, "arena_chunk_pool")),
+      pooled_bytes_(0) {
+  static_assert(kMaxChunkSize == kMinChunkSize << (kNumSizeClasses - 1),
+                "kNumSizeClasses doesn't match the chunk size limits");
+}
+
+int ChunkPoolBufferAllocator::SizeClass(size_t size) {
+  if (size < kMinChunkSize || size > kMaxChunkSize || (size & (size - 1)) != 0) {
+    return -1;
+  }
+  return Bits::Log2Floor64(size / kMinChunkSize);
+}
+
+ChunkPoolBufferAllocator::ThreadCache* ChunkPoolBufferAllocator::GetThreadCache() {
+  if (PREDICT_FALSE(tls_cache_destroyed_)) {
+    return nullptr;
+  }
+  INIT_STATIC_THREAD_LOCAL(ThreadCache, tls_cache_, this);
+  return tls_cache_;
+}
+
+void* ChunkPoolBufferAllocator::TakeChunk(int size_class) {
+  const int64_t size = kMinChunkSize << size_class;
+  void* chunk = nullptr;
+  ThreadCache* cache = GetThreadCache();
+  if (cache != nullptr && !cache->chunks[size_class].empty()) {
+    chunk = cache->chunks[size_class].back();
+    cache->chunks[size_class].pop_back();
+    cache->bytes -= size;
+  } else {
+    std::lock_guard<simple_spinlock> l(lock_);
+    if (!pooled_chunks_[size_class].empty()) {
+      chunk = pooled_chunks_[size_class].back();
+      pooled_chunks_[size_class].pop_back();
+      pooled_bytes_ -= size;
+    }
+  }
+  if (chunk != nullptr) {
+    // Arenas poison their chunks until they hand out parts of them.
+    ASAN_UNPOISON_MEMORY_REGION(chunk, size);
+    mem_tracker_->Release(size);
+  }
+  return chunk;
+}
+
+bool ChunkPoolBufferAllocator::ReturnChunk(int size_class, void* chunk) {
+  const int64_t size = kMinChunkSize << size_class;
+  ThreadCache* cache = GetThreadCache();
+  if (cache != nullptr && cache->bytes + size <= FLAGS_arena_chunk_thread_cache_bytes) {
+    cache->chunks[size_class].push_back(chunk);
+    cache->bytes += size;
+  } else {
+    std::lock_guard<simple_spinlock> l(lock_);
+    if (pooled_bytes_ + size > FLAGS_arena_chunk_pool_capacity_bytes) {
+      return false;
+    }
+    pooled_chunks_[size_class].push_back(chunk);
+    pooled_bytes_ += size;
+  }
+  mem_tracker_->Consume(size);
+  return true;
+}
+
+void ChunkPoolBufferAllocator::FlushThreadCache(ThreadCache* cache) {
+  int64_t freed_bytes = 0;
+  {
+    std::lock_guard<simple_spinlock> l(lock_);
+    for (int i = 0; i < kNumSizeClasses; i++) {
+      const int64_t size = kMinChunkSize << i;
+      for (void* chunk : cache->chunks[i]) {
+        if (pooled_bytes_ + size <= FLAGS_arena_chunk_pool_capacity_bytes) {
+          pooled_chunks_[i].push_back(chunk);
+          pooled_bytes_ += size;
+        } else {
+          free(chunk);
+          freed_bytes += size;
+        }
+      }
+      cache->chunks[i].clear();
+    }
+  }
+  cache->bytes = 0;
+  mem_tracker_->Release(freed_bytes);
+}
+
+void ChunkPoolBufferAllocator::ReleaseCachedChunks() {
+  ThreadCache* cache = GetThreadCache();
+  if (cache != nullptr) {
+    FlushThreadCache(cache);
+  }
+  int64_t freed_bytes;
+  {
+    std::lock_guard<simple_spinlock> l(lock_);
+    for (auto& chunks : pooled_chunks_) {
+      for (void* chunk : chunks) {
+        free(chunk);
+      }
+      chunks.clear();
+    }
+    freed_bytes = pooled_bytes_;
+    pooled_bytes_ = 0;
+  }
+  mem_tracker_->Release(freed_bytes);
+}
+
+int64_t ChunkPoolBufferAllocator::cached_bytes() const {
+  return mem_tracker_->consumption();
+}
+
+Buffer* ChunkPoolBufferAllocator::AllocateInternal(size_t requested,
+                                                   size_t minimal,
+                                                   BufferAllocator* originator) {
+  int size_class = SizeClass(requested);
+  if (size_class >= 0) {
+    void* chunk = TakeChunk(size_class);
+    if (chunk != nullptr) {
+      return CreateBuffer(chunk, requested, originator);
+    }
+  }
+  return DelegateAllocate(HeapBufferAllocator::Get(), requested, minimal, originator);
+}
+
+bool ChunkPoolBufferAllocator::ReallocateInternal(size_t requested,
+                                                  size_t minimal,
+                                                  Buffer* buffer,
+                                                  BufferAllocator* originator) {
+  // Pooled chunks come from malloc() too, so they can be resized in place.
+  return DelegateReallocate(HeapBufferAllocator::Get(), requested, minimal, buffer,
+                            originator);
+}
+
+void ChunkPoolBufferAllocator::FreeInternal(Buffer* buffer) {
+  int size_class = SizeClass(buffer->size());
+  if (size_class >= 0 && ReturnChunk(size_class, buffer->data())) {
+    return;
+  }
+  DelegateFree(HeapBufferAllocator::Get(), buffer);
+}
+
 Buffer* ClearingBufferAllocator::AllocateInternal(size_t requested,
                                                   size_t minimal,
                                                   BufferAllocator* originator) {
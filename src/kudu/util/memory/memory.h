@@ -40,8 +40,10 @@
 #include <vector>
 
 #include "kudu/util/boost_mutex_utils.h"
+#include "kudu/util/locks.h"
 #include "kudu/util/memory/overwrite.h"
 #include "kudu/util/mutex.h"
+#include "kudu/util/threadlocal.h"
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/logging-inl.h"
 #include "kudu/gutil/macros.h"
@@ -291,6 +293,108 @@ class HeapBufferAllocator : public BufferAllocator {
   DISALLOW_COPY_AND_ASSIGN(HeapBufferAllocator);
 };
 
+// Allocates buffers on the heap, like HeapBufferAllocator, but keeps freed
+// buffers whose size is a power of two between kMinChunkSize and
+// kMaxChunkSize, and hands them out again to later requests of the same
+// size. These are the sizes arenas normally grow by, so arenas which are
+// repeatedly filled and destroyed (e.g. the ones of scanners, row blocks
+// and compactions) mostly reuse the same chunks rather than going through
+// malloc and free for every batch.
+//
+// Each thread keeps a small cache of free chunks, which it fills and drains
+// without synchronization. Chunks which don't fit in the cache of the
+// freeing thread, and the caches of exiting threads, are moved to a shared,
+// size-limited pool. Free chunks held by the caches and the pool are
+// accounted to the "arena_chunk_pool" MemTracker.
+class ChunkPoolBufferAllocator : public BufferAllocator {
+ public:
+  static const size_t kMinChunkSize = 1024;
+  static const size_t kMaxChunkSize = 4 * 1024 * 1024;
+
+  virtual ~ChunkPoolBufferAllocator() {}
+
+  // Returns a singleton instance of the pooling allocator.
+  static ChunkPoolBufferAllocator* Get() {
+    return Singleton<ChunkPoolBufferAllocator>::get();
+  }
+
+  virtual size_t Available() const OVERRIDE {
+    return numeric_limits<size_t>::max();
+  }
+
+  // Frees all the chunks held by the shared pool and by the cache of the
+  // calling thread.
+  void ReleaseCachedChunks();
+
+  // Returns the total size of the free chunks held by the shared pool and
+  // the caches of all threads.
+  int64_t cached_bytes() const;
+
+ private:
+  friend class Singleton<ChunkPoolBufferAllocator>;
+
+  // kMinChunkSize, 2 * kMinChunkSize, ..., kMaxChunkSize.
+  static const int kNumSizeClasses = 13;
+
+  // The free chunks of a single thread.
+  struct ThreadCache {
+    explicit ThreadCache(ChunkPoolBufferAllocator* pool)
+        : pool(pool),
+          bytes(0) {}
+    ~ThreadCache();
+
+    ChunkPoolBufferAllocator* const pool;
+    vector<void*> chunks[kNumSizeClasses];
+    int64_t bytes;
+  };
+
+  ChunkPoolBufferAllocator();
+
+  // Returns the size class of buffers of 'size' bytes, or -1 if such buffers
+  // are not pooled.
+  static int SizeClass(size_t size);
+
+  // Returns the cache of the calling thread, or NULL if the thread is
+  // exiting and its cache was already destroyed.
+  ThreadCache* GetThreadCache();
+
+  // Takes a free chunk of 'size_class' from the cache of the calling thread
+  // or the shared pool. Returns NULL if there is none.
+  void* TakeChunk(int size_class);
+
+  // Keeps the free 'chunk' of 'size_class' for reuse. Returns false if it
+  // fits neither in the cache of the calling thread nor in the shared pool,
+  // in which case it must be freed.
+  bool ReturnChunk(int size_class, void* chunk);
+
+  // Moves the chunks of 'cache' into the shared pool, freeing the ones
+  // which don't fit.
+  void FlushThreadCache(ThreadCache* cache);
+
+  virtual Buffer* AllocateInternal(size_t requested,
+                                   size_t minimal,
+                                   BufferAllocator* originator) OVERRIDE;
+
+  virtual bool ReallocateInternal(size_t requested,
+                                  size_t minimal,
+                                  Buffer* buffer,
+                                  BufferAllocator* originator) OVERRIDE;
+
+  virtual void FreeInternal(Buffer* buffer) OVERRIDE;
+
+  DECLARE_STATIC_THREAD_LOCAL(ThreadCache, tls_cache_);
+  static __thread bool tls_cache_destroyed_;
+
+  std::shared_ptr<MemTracker> mem_tracker_;
+
+  // Protects the shared pool.
+  mutable simple_spinlock lock_;
+  vector<void*> pooled_chunks_[kNumSizeClasses];
+  int64_t pooled_bytes_;
+
+  DISALLOW_COPY_AND_ASSIGN(ChunkPoolBufferAllocator);
+};
+
 // Wrapper around the delegate allocator, that clears all newly allocated
 // (and reallocated) memory.
 class ClearingBufferAllocator : public BufferAllocator {
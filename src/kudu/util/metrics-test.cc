@@ -201,6 +201,42 @@ TEST_F(MetricsTest, JsonPrintTest) {
   ASSERT_EQ("", out.str());
 }
 
+TEST_F(MetricsTest, PrometheusPrintTest) {
+  scoped_refptr<Counter> reqs = METRIC_reqs_pending.Instantiate(entity_);
+  reqs->IncrementBy(3);
+  scoped_refptr<Histogram> hist = METRIC_test_hist.Instantiate(entity_);
+  hist->Increment(5);
+  entity_->SetAttribute("test_attr", "attr \"val\"");
+  const string labels =
+      "entity_type=\"test_entity\",entity_id=\"my-test\",test_attr=\"attr \\\"val\\\"\"";
+
+  std::ostringstream out;
+  ASSERT_OK(registry_.WriteAsPrometheus(&out, { "*" }, MetricPrometheusOptions()));
+  ASSERT_STR_CONTAINS(out.str(), "# HELP kudu_reqs_pending Number of requests pending\n"
+                                 "# TYPE kudu_reqs_pending counter\n"
+                                 "kudu_reqs_pending{" + labels + "} 3\n");
+  ASSERT_STR_CONTAINS(out.str(), "# TYPE kudu_test_hist summary\n");
+  ASSERT_STR_CONTAINS(out.str(), "kudu_test_hist{" + labels + ",quantile=\"0.99\"} 5\n");
+  ASSERT_STR_CONTAINS(out.str(), "kudu_test_hist_sum{" + labels + "} 5\n");
+  ASSERT_STR_CONTAINS(out.str(), "kudu_test_hist_count{" + labels + "} 1\n");
+
+  // Only the metrics modified since the epoch was advanced are written.
+  MetricPrometheusOptions opts;
+  opts.only_modified_in_or_after_epoch = Metric::IncrementEpoch();
+  reqs->Increment();
+  out.str("");
+  ASSERT_OK(registry_.WriteAsPrometheus(&out, { "*" }, opts));
+  ASSERT_STR_CONTAINS(out.str(), "kudu_reqs_pending{" + labels + "} 4\n");
+  ASSERT_EQ(string::npos, out.str().find("kudu_test_hist"));
+
+  // Entities of other types are filtered out.
+  opts = MetricPrometheusOptions();
+  opts.entity_types = { "server" };
+  out.str("");
+  ASSERT_OK(registry_.WriteAsPrometheus(&out, { "*" }, opts));
+  ASSERT_EQ("", out.str());
+}
+
 // Test that metrics are retired when they are no longer referenced.
 TEST_F(MetricsTest, RetirementTest) {
   FLAGS_metrics_retirement_age_ms = 100;
@@ -16,9 +16,11 @@
 // under the License.
 #include "kudu/util/metrics.h"
 
+#include <cmath>
 #include <iostream>
 #include <sstream>
 #include <map>
+#include <sched.h>
 #include <set>
 
 #include <gflags/gflags.h>
@@ -28,6 +30,8 @@
 #include "kudu/gutil/map-util.h"
 #include "kudu/gutil/singleton.h"
 #include "kudu/gutil/stl_util.h"
+#include "kudu/gutil/sysinfo.h"
+#include "kudu/gutil/strings/numbers.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/hdr_histogram.h"
@@ -51,6 +55,7 @@ namespace kudu {
 using std::string;
 using std::vector;
 using strings::Substitute;
+using strings::SubstituteAndAppend;
 
 //
 // MetricUnit
@@ -190,6 +195,54 @@ bool MatchMetricInList(const string& metric_name,
   return false;
 }
 
+// Replaces the characters which may not appear in Prometheus metric and
+// label names with underscores.
+string PrometheusName(const string& name) {
+  string ret = name;
+  for (char& c : ret) {
+    if (!isalnum(c) && c != '_') {
+      c = '_';
+    }
+  }
+  if (ret.empty() || isdigit(ret[0])) {
+    ret.insert(0, "_");
+  }
+  return ret;
+}
+
+// Escapes 'str' for use in a Prometheus label value or, if 'quotes' is
+// false, in a HELP line.
+string PrometheusEscape(const string& str, bool quotes) {
+  string ret;
+  ret.reserve(str.size());
+  for (char c : str) {
+    switch (c) {
+      case '\\': ret.append("\\\\"); break;
+      case '\n': ret.append("\\n"); break;
+      case '"':
+        if (quotes) {
+          ret.append("\\\"");
+          break;
+        }
+        FALLTHROUGH_INTENDED;
+      default: ret.push_back(c); break;
+    }
+  }
+  return ret;
+}
+
+const char* PrometheusType(MetricType::Type type) {
+  switch (type) {
+    case MetricType::kGauge:
+      return "gauge";
+    case MetricType::kCounter:
+      return "counter";
+    case MetricType::kHistogram:
+      return "summary";
+  }
+  return "untyped";
+}
+
 } // anonymous namespace
 
 
@@ -252,6 +305,45 @@ Status MetricEntity::WriteAsJson(JsonWriter* writer,
   return Status::OK();
 }
 
+string MetricEntity::CollectForPrometheus(const vector<string>& requested_metrics,
+                                          const MetricPrometheusOptions& opts,
+                                          vector<scoped_refptr<Metric>>* metrics) const {
+  if (!opts.entity_types.empty() &&
+      std::find(opts.entity_types.begin(), opts.entity_types.end(),
+                prototype_->name()) == opts.entity_types.end()) {
+    return "";
+  }
+  bool select_all = MatchMetricInList(id(), requested_metrics);
+
+  // Label the samples with the attributes in alphabetical order.
+  std::map<string, string> attrs;
+  {
+    std::lock_guard<simple_spinlock> l(lock_);
+    attrs.insert(attributes_.begin(), attributes_.end());
+    for (const MetricMap::value_type& val : metric_map_) {
+      const MetricPrototype* prototype = val.first;
+      const scoped_refptr<Metric>& metric = val.second;
+
+      if (!select_all && !MatchMetricInList(prototype->name(), requested_metrics)) {
+        continue;
+      }
+      if (!metric->IsComputedOnRead() &&
+          metric->modification_epoch() < opts.only_modified_in_or_after_epoch) {
+        continue;
+      }
+      metrics->push_back(metric);
+    }
+  }
+
+  string labels = Substitute("entity_type=\"$0\",entity_id=\"$1\"",
+                             prototype_->name(), PrometheusEscape(id_, true));
+  for (const auto& attr : attrs) {
+    SubstituteAndAppend(&labels, ",$0=\"$1\"",
+                        PrometheusName(attr.first), PrometheusEscape(attr.second, true));
+  }
+  return labels;
+}
+
 void MetricEntity::RetireOldMetrics() {
   MonoTime now(MonoTime::Now());
 
@@ -348,6 +440,58 @@ Status MetricRegistry::WriteAsJson(JsonWriter* writer,
   return Status::OK();
 }
 
+Status MetricRegistry::WriteAsPrometheus(std::ostream* out,
+                                         const vector<string>& requested_metrics,
+                                         const MetricPrometheusOptions& opts) const {
+  EntityMap entities;
+  {
+    std::lock_guard<simple_spinlock> l(lock_);
+    entities = entities_;
+  }
+
+  // All the samples of a metric must follow its single HELP and TYPE lines,
+  // so group the selected metrics of all the entities by name, keeping the
+  // index of the labels of their entity.
+  vector<string> entity_labels;
+  std::map<string, vector<std::pair<int, scoped_refptr<Metric>>>> metrics_by_name;
+  for (const EntityMap::value_type& e : entities) {
+    vector<scoped_refptr<Metric>> metrics;
+    string labels = e.second->CollectForPrometheus(requested_metrics, opts, &metrics);
+    if (metrics.empty()) {
+      continue;
+    }
+    entity_labels.emplace_back(std::move(labels));
+    for (scoped_refptr<Metric>& metric : metrics) {
+      metrics_by_name[metric->prototype()->name()].emplace_back(entity_labels.size() - 1,
+                                                                std::move(metric));
+    }
+  }
+  entities.clear();
+
+  std::ostringstream samples;
+  for (const auto& e : metrics_by_name) {
+    const string name = "kudu_" + PrometheusName(e.first);
+    samples.str("");
+    for (const auto& sample : e.second) {
+      sample.second->WriteAsPrometheus(&samples, name, entity_labels[sample.first]);
+    }
+    // Metrics without numeric values have no samples, and no HELP or TYPE.
+    if (samples.tellp() == 0) {
+      continue;
+    }
+    const MetricPrototype* prototype = e.second[0].second->prototype();
+    *out << "# HELP " << name << " " << PrometheusEscape(prototype->description(), false)
+         << "\n";
+    *out << "# TYPE " << name << " " << PrometheusType(prototype->type()) << "\n";
+    *out << samples.str();
+  }
+
+  // See WriteAsJson() above.
+  metrics_by_name.clear();
+  const_cast<MetricRegistry*>(this)->RetireOldMetrics();
+  return Status::OK();
+}
+
 void MetricRegistry::RetireOldMetrics() {
   std::lock_guard<simple_spinlock> l(lock_);
   for (auto it = entities_.begin(); it != entities_.end();) {
@@ -480,13 +624,45 @@ scoped_refptr<MetricEntity> MetricRegistry::FindOrCreateEntity(
 //
 // Metric
 //
+std::atomic<int64_t> Metric::g_epoch_(1);
+
 Metric::Metric(const MetricPrototype* prototype)
-  : prototype_(prototype) {
+  : prototype_(prototype),
+    m_epoch_(g_epoch_.load(std::memory_order_relaxed)) {
 }
 
 Metric::~Metric() {
 }
 
+int64_t Metric::IncrementEpoch() {
+  return g_epoch_.fetch_add(1) + 1;
+}
+
+void Metric::UpdateModificationEpochSlowPath(int64_t current) {
+  // Another thread may be recording an older epoch concurrently.
+  int64_t epoch = m_epoch_.load(std::memory_order_relaxed);
+  while (epoch < current &&
+         !m_epoch_.compare_exchange_weak(epoch, current, std::memory_order_relaxed)) {
+  }
+}
+
+void WritePrometheusSample(std::ostream* out,
+                           const string& name,
+                           const string& labels,
+                           const string& value) {
+  *out << name << "{" << labels << "} " << value << "\n";
+}
+
+string PrometheusValue(double value) {
+  if (std::isnan(value)) {
+    return "NaN";
+  }
+  if (std::isinf(value)) {
+    return value > 0 ? "+Inf" : "-Inf";
+  }
+  return SimpleDtoa(value);
+}
+
 //
 // Gauge
 //
@@ -518,8 +694,11 @@ std::string StringGauge::value() const {
 }
 
 void StringGauge::set_value(const std::string& value) {
-  std::lock_guard<simple_spinlock> l(lock_);
-  value_ = value;
+  {
+    std::lock_guard<simple_spinlock> l(lock_);
+    value_ = value;
+  }
+  UpdateModificationEpoch();
 }
 
 void StringGauge::WriteValue(JsonWriter* writer) const {
@@ -548,6 +727,13 @@ void Counter::Increment() {
 
 void Counter::IncrementBy(int64_t amount) {
   value_.IncrementBy(amount);
+  UpdateModificationEpoch();
+}
+
+void Counter::WriteAsPrometheus(std::ostream* out,
+                                const string& name,
+                                const string& labels) const {
+  WritePrometheusSample(out, name, labels, PrometheusValue(value()));
 }
 
 Status Counter::WriteAsJson(JsonWriter* writer,
@@ -590,17 +776,95 @@ scoped_refptr<Histogram> HistogramPrototype::Instantiate(
 // Histogram
 /////////////////////////////////////////////////
 
+// The maximum number of stripes of a striped histogram. CPUs beyond this
+// share stripes.
+static const int kMaxHistogramStripes = 16;
+
 Histogram::Histogram(const HistogramPrototype* proto)
   : Metric(proto),
-    histogram_(new HdrHistogram(proto->max_trackable_value(), proto->num_sig_digits())) {
+    histogram_(new HdrHistogram(proto->max_trackable_value(), proto->num_sig_digits())),
+    num_stripes_(proto->striped() ?
+                 std::min(base::MaxCPUIndex() + 1, kMaxHistogramStripes) : 1) {
+  if (num_stripes_ > 1) {
+    stripes_.reset(new std::atomic<HdrHistogram*>[num_stripes_ - 1]);
+    for (int i = 0; i < num_stripes_ - 1; i++) {
+      stripes_[i].store(nullptr, std::memory_order_relaxed);
+    }
+  }
+}
+
+Histogram::~Histogram() {
+  for (int i = 0; i < num_stripes_ - 1; i++) {
+    delete stripes_[i].load(std::memory_order_relaxed);
+  }
+}
+
+HdrHistogram* Histogram::CurrentStripe() {
+  if (num_stripes_ == 1) {
+    return histogram_.get();
+  }
+#if defined(__linux__)
+  int idx = sched_getcpu() % num_stripes_;
+#else
+  // There's no cheap way to get the CPU, so use just one stripe.
+  int idx = 0;
+#endif
+  if (idx == 0) {
+    return histogram_.get();
+  }
+  std::atomic<HdrHistogram*>& stripe = stripes_[idx - 1];
+  HdrHistogram* h = stripe.load(std::memory_order_acquire);
+  if (PREDICT_FALSE(h == nullptr)) {
+    gscoped_ptr<HdrHistogram> new_h(new HdrHistogram(histogram_->highest_trackable_value(),
+                                                     histogram_->num_significant_digits()));
+    if (stripe.compare_exchange_strong(h, new_h.get(), std::memory_order_acq_rel)) {
+      h = new_h.release();
+    }
+  }
+  return h;
+}
+
+gscoped_ptr<HdrHistogram> Histogram::Snapshot() const {
+  gscoped_ptr<HdrHistogram> snapshot(new HdrHistogram(*histogram_));
+  for (int i = 0; i < num_stripes_ - 1; i++) {
+    const HdrHistogram* h = stripes_[i].load(std::memory_order_acquire);
+    if (h != nullptr) {
+      snapshot->MergeFrom(*h);
+    }
+  }
+  return snapshot.Pass();
 }
 
 void Histogram::Increment(int64_t value) {
-  histogram_->Increment(value);
+  CurrentStripe()->Increment(value);
+  UpdateModificationEpoch();
 }
 
 void Histogram::IncrementBy(int64_t value, int64_t amount) {
-  histogram_->IncrementBy(value, amount);
+  CurrentStripe()->IncrementBy(value, amount);
+  UpdateModificationEpoch();
+}
+
+void Histogram::WriteAsPrometheus(std::ostream* out,
+                                  const string& name,
+                                  const string& labels) const {
+  static const struct {
+    const char* quantile;
+    double percentile;
+  } kQuantiles[] = {
+    { "0.75", 75 },
+    { "0.95", 95 },
+    { "0.99", 99 },
+    { "0.999", 99.9 },
+    { "0.9999", 99.99 },
+  };
+  gscoped_ptr<HdrHistogram> snapshot = Snapshot();
+  for (const auto& q : kQuantiles) {
+    WritePrometheusSample(out, name, Substitute("$0,quantile=\"$1\"", labels, q.quantile),
+                          PrometheusValue(snapshot->ValueAtPercentile(q.percentile)));
+  }
+  WritePrometheusSample(out, name + "_sum", labels, PrometheusValue(snapshot->TotalSum()));
+  WritePrometheusSample(out, name + "_count", labels, PrometheusValue(snapshot->TotalCount()));
 }
 
 Status Histogram::WriteAsJson(JsonWriter* writer,
@@ -614,7 +878,8 @@ Status Histogram::WriteAsJson(JsonWriter* writer,
 
 Status Histogram::GetHistogramSnapshotPB(HistogramSnapshotPB* snapshot_pb,
                                          const MetricJsonOptions& opts) const {
-  HdrHistogram snapshot(*histogram_);
+  gscoped_ptr<HdrHistogram> merged = Snapshot();
+  const HdrHistogram& snapshot = *merged;
   snapshot_pb->set_name(prototype_->name());
   if (opts.include_schema_info) {
     snapshot_pb->set_type(MetricType::Name(prototype_->type()));
@@ -636,7 +901,7 @@ Status Histogram::GetHistogramSnapshotPB(HistogramSnapshotPB* snapshot_pb,
   snapshot_pb->set_max(snapshot.MaxValue());
 
   if (opts.include_raw_histograms) {
-    RecordedValuesIterator iter(&snapshot);
+    RecordedValuesIterator iter(merged.get());
     while (iter.HasNext()) {
       HistogramIterationValue value;
       RETURN_NOT_OK(iter.Next(&value));
@@ -648,22 +913,29 @@ Status Histogram::GetHistogramSnapshotPB(HistogramSnapshotPB* snapshot_pb,
 }
 
 uint64_t Histogram::CountInBucketForValueForTests(uint64_t value) const {
-  return histogram_->CountInBucketForValue(value);
+  return Snapshot()->CountInBucketForValue(value);
 }
 
 uint64_t Histogram::TotalCount() const {
-  return histogram_->TotalCount();
+  uint64_t total = histogram_->TotalCount();
+  for (int i = 0; i < num_stripes_ - 1; i++) {
+    const HdrHistogram* h = stripes_[i].load(std::memory_order_acquire);
+    if (h != nullptr) {
+      total += h->TotalCount();
+    }
+  }
+  return total;
 }
 
 uint64_t Histogram::MinValueForTests() const {
-  return histogram_->MinValue();
+  return Snapshot()->MinValue();
 }
 
 uint64_t Histogram::MaxValueForTests() const {
-  return histogram_->MaxValue();
+  return Snapshot()->MaxValue();
 }
 double Histogram::MeanValueForTests() const {
-  return histogram_->MeanValue();
+  return Snapshot()->MeanValue();
 }
 
 ScopedLatencyMetric::ScopedLatencyMetric(Histogram* latency_hist)
@@ -224,6 +224,9 @@
 /////////////////////////////////////////////////////
 
 #include <algorithm>
+#include <atomic>
+#include <iosfwd>
+#include <memory>
 #include <mutex>
 #include <string>
 #include <unordered_map>
@@ -279,9 +282,9 @@
   ::kudu::GaugePrototype<double> METRIC_##name(                      \
       ::kudu::MetricPrototype::CtorArgs(#entity, #name, label, unit, desc, ## __VA_ARGS__))
 
-#define METRIC_DEFINE_histogram(entity, name, label, unit, desc, max_val, num_sig_digits) \
+#define METRIC_DEFINE_histogram(entity, name, label, unit, desc, max_val, num_sig_digits, ...) \
   ::kudu::HistogramPrototype METRIC_##name(                                       \
-      ::kudu::MetricPrototype::CtorArgs(#entity, #name, label, unit, desc), \
+      ::kudu::MetricPrototype::CtorArgs(#entity, #name, label, unit, desc, ## __VA_ARGS__), \
     max_val, num_sig_digits)
 
 // The following macros act as forward declarations for entity types and metric prototypes.
@@ -411,6 +414,22 @@ struct MetricJsonOptions {
   bool include_schema_info;
 };
 
+struct MetricPrometheusOptions {
+  MetricPrometheusOptions() :
+    only_modified_in_or_after_epoch(0) {
+  }
+
+  // Only include the entities of these types (e.g. "server" or "tablet").
+  // Default: empty, i.e. all types.
+  std::vector<std::string> entity_types;
+
+  // Only include the metrics which were modified in or after this epoch
+  // (see Metric::IncrementEpoch()). Metrics whose value is computed when
+  // read, i.e. function gauges, are always included.
+  // Default: 0, i.e. all metrics.
+  int64_t only_modified_in_or_after_epoch;
+};
+
 class MetricEntityPrototype {
  public:
   explicit MetricEntityPrototype(const char* name);
@@ -465,6 +484,13 @@ class MetricEntity : public RefCountedThreadSafe<MetricEntity> {
                      const std::vector<std::string>& requested_metrics,
                      const MetricJsonOptions& opts) const;
 
+  // Appends the metrics of this entity selected by 'requested_metrics' and
+  // 'opts' to 'metrics', and returns the Prometheus labels identifying the
+  // entity. See MetricRegistry::WriteAsPrometheus().
+  std::string CollectForPrometheus(const std::vector<std::string>& requested_metrics,
+                                   const MetricPrometheusOptions& opts,
+                                   std::vector<scoped_refptr<Metric>>* metrics) const;
+
   const MetricMap& UnsafeMetricsMapForTests() const { return metric_map_; }
 
   // Mark that the given metric should never be retired until the metric
@@ -527,12 +553,43 @@ class Metric : public RefCountedThreadSafe<Metric> {
   virtual Status WriteAsJson(JsonWriter* writer,
                              const MetricJsonOptions& opts) const = 0;
 
+  // Writes the samples of this metric in the Prometheus text format, named
+  // 'name' and tagged with 'labels' (a comma-separated list of label="value"
+  // pairs). Metrics without a numeric value write nothing.
+  virtual void WriteAsPrometheus(std::ostream* out,
+                                 const std::string& name,
+                                 const std::string& labels) const = 0;
+
   const MetricPrototype* prototype() const { return prototype_; }
 
+  // Returns the last epoch in which this metric was modified.
+  int64_t modification_epoch() const {
+    return m_epoch_.load(std::memory_order_relaxed);
+  }
+
+  // Whether the value of this metric is computed when it is read, rather
+  // than tracked as it is modified, so its modification epoch is meaningless.
+  virtual bool IsComputedOnRead() const { return false; }
+
+  // Advances the current epoch, and returns the new one. Metrics modified
+  // from now on will have a modification epoch at least that large, so a
+  // monitoring system which calls this before each scrape can ask the next
+  // scrape for only the metrics modified since.
+  static int64_t IncrementEpoch();
+
  protected:
   explicit Metric(const MetricPrototype* prototype);
   virtual ~Metric();
 
+  // Records that this metric was modified in the current epoch. This only
+  // writes to the metric the first time it is modified in each epoch.
+  void UpdateModificationEpoch() {
+    int64_t current = g_epoch_.load(std::memory_order_relaxed);
+    if (PREDICT_FALSE(m_epoch_.load(std::memory_order_relaxed) < current)) {
+      UpdateModificationEpochSlowPath(current);
+    }
+  }
+
   const MetricPrototype* const prototype_;
 
  private:
@@ -544,6 +601,12 @@ class Metric : public RefCountedThreadSafe<Metric> {
   // uninitialized.
   MonoTime retire_time_;
 
+  void UpdateModificationEpochSlowPath(int64_t current);
+
+  // The current epoch, and the last one in which this metric was modified.
+  static std::atomic<int64_t> g_epoch_;
+  std::atomic<int64_t> m_epoch_;
+
   DISALLOW_COPY_AND_ASSIGN(Metric);
 };
 
@@ -573,6 +636,17 @@ class MetricRegistry {
                      const std::vector<std::string>& requested_metrics,
                      const MetricJsonOptions& opts) const;
 
+  // Writes metrics in this registry to 'out', in the Prometheus text
+  // exposition format. Metric names are prefixed with "kudu_", and each
+  // sample is labeled with the type, ID and attributes of its entity.
+  // Histograms are written as summaries.
+  //
+  // 'requested_metrics' is matched as in WriteAsJson(). See the
+  // MetricPrometheusOptions struct definition above for further filtering.
+  Status WriteAsPrometheus(std::ostream* out,
+                           const std::vector<std::string>& requested_metrics,
+                           const MetricPrometheusOptions& opts) const;
+
   // For each registered entity, retires orphaned metrics. If an entity has no more
   // metrics and there are no external references, entities are removed as well.
   //
@@ -637,7 +711,14 @@ class MetricPrototypeRegistry {
 enum PrototypeFlags {
   // Flag which causes a Gauge prototype to expose itself as if it
   // were a counter.
-  EXPOSE_AS_COUNTER = 1 << 0
+  EXPOSE_AS_COUNTER = 1 << 0,
+
+  // Flag which causes a Histogram to record values in a separate stripe
+  // per group of CPUs, which are merged when the histogram is read. This
+  // avoids contending on the same cache lines, at the cost of more memory,
+  // so it is meant for server-wide histograms which are updated by nearly
+  // every request.
+  STRIPED_HISTOGRAM = 1 << 1
 };
 
 class MetricPrototype {
@@ -723,6 +804,19 @@ class GaugePrototype : public MetricPrototype {
   DISALLOW_COPY_AND_ASSIGN(GaugePrototype);
 };
 
+// Writes the sample 'name{labels} value' in the Prometheus text format.
+void WritePrometheusSample(std::ostream* out,
+                           const std::string& name,
+                           const std::string& labels,
+                           const std::string& value);
+
+// Formats a metric value for the Prometheus text format.
+template<typename T>
+std::string PrometheusValue(const T& value) {
+  return std::to_string(value);
+}
+std::string PrometheusValue(double value);
+
 // Abstract base class to provide point-in-time metric values.
 class Gauge : public Metric {
  public:
@@ -745,6 +839,11 @@ class StringGauge : public Gauge {
               std::string initial_value);
   std::string value() const;
   void set_value(const std::string& value);
+
+  // Prometheus has no string values.
+  virtual void WriteAsPrometheus(std::ostream* out,
+                                 const std::string& name,
+                                 const std::string& labels) const OVERRIDE {}
  protected:
   virtual void WriteValue(JsonWriter* writer) const OVERRIDE;
  private:
@@ -766,12 +865,15 @@ class AtomicGauge : public Gauge {
   }
   virtual void set_value(const T& value) {
     value_.Store(static_cast<int64_t>(value), kMemOrderNoBarrier);
+    UpdateModificationEpoch();
   }
   void Increment() {
     value_.IncrementBy(1, kMemOrderNoBarrier);
+    UpdateModificationEpoch();
   }
   virtual void IncrementBy(int64_t amount) {
     value_.IncrementBy(amount, kMemOrderNoBarrier);
+    UpdateModificationEpoch();
   }
   void Decrement() {
     IncrementBy(-1);
@@ -780,6 +882,12 @@ class AtomicGauge : public Gauge {
     IncrementBy(-amount);
   }
 
+  virtual void WriteAsPrometheus(std::ostream* out,
+                                 const std::string& name,
+                                 const std::string& labels) const OVERRIDE {
+    WritePrometheusSample(out, name, labels, PrometheusValue(value()));
+  }
+
  protected:
   virtual void WriteValue(JsonWriter* writer) const OVERRIDE {
     writer->Value(value());
@@ -859,6 +967,14 @@ class FunctionGauge : public Gauge {
     writer->Value(value());
   }
 
+  virtual void WriteAsPrometheus(std::ostream* out,
+                                 const std::string& name,
+                                 const std::string& labels) const OVERRIDE {
+    WritePrometheusSample(out, name, labels, PrometheusValue(value()));
+  }
+
+  virtual bool IsComputedOnRead() const OVERRIDE { return true; }
+
   // Reset this FunctionGauge to return a specific value.
   // This should be used during destruction. If you want a settable
   // Gauge, use a normal Gauge instead of a FunctionGauge.
@@ -937,6 +1053,9 @@ class Counter : public Metric {
   void IncrementBy(int64_t amount);
   virtual Status WriteAsJson(JsonWriter* w,
                              const MetricJsonOptions& opts) const OVERRIDE;
+  virtual void WriteAsPrometheus(std::ostream* out,
+                                 const std::string& name,
+                                 const std::string& labels) const OVERRIDE;
 
  private:
   FRIEND_TEST(MetricsTest, SimpleCounterTest);
@@ -957,6 +1076,7 @@ class HistogramPrototype : public MetricPrototype {
 
   uint64_t max_trackable_value() const { return max_trackable_value_; }
   int num_sig_digits() const { return num_sig_digits_; }
+  bool striped() const { return args_.flags_ & STRIPED_HISTOGRAM; }
   virtual MetricType::Type type() const OVERRIDE { return MetricType::kHistogram; }
 
  private:
@@ -982,6 +1102,11 @@ class Histogram : public Metric {
   virtual Status WriteAsJson(JsonWriter* w,
                              const MetricJsonOptions& opts) const OVERRIDE;
 
+  // Written as a summary with the same percentiles as the JSON output.
+  virtual void WriteAsPrometheus(std::ostream* out,
+                                 const std::string& name,
+                                 const std::string& labels) const OVERRIDE;
+
   // Returns a snapshot of this histogram including the bucketed values and counts.
   Status GetHistogramSnapshotPB(HistogramSnapshotPB* snapshot,
                                 const MetricJsonOptions& opts) const;
@@ -993,10 +1118,27 @@ class Histogram : public Metric {
 
  private:
   FRIEND_TEST(MetricsTest, SimpleHistogramTest);
+  FRIEND_TEST(MultiThreadedMetricsTest, StripedHistogramIncrementTest);
   friend class MetricEntity;
   explicit Histogram(const HistogramPrototype* proto);
+  virtual ~Histogram();
 
+  // Returns the stripe to record values of the calling thread in.
+  HdrHistogram* CurrentStripe();
+
+  // Returns the values recorded in all the stripes.
+  gscoped_ptr<HdrHistogram> Snapshot() const;
+
+  // The first stripe, and the only one unless the histogram is striped.
   const gscoped_ptr<HdrHistogram> histogram_;
+
+  // The number of stripes. Stripe i records the values of the CPUs whose
+  // index is i modulo num_stripes_.
+  const int num_stripes_;
+
+  // Stripes 1 to num_stripes_ - 1, allocated when first used, so that
+  // striped histograms which are rarely updated stay small.
+  std::unique_ptr<std::atomic<HdrHistogram*>[]> stripes_;
   DISALLOW_COPY_AND_ASSIGN(Histogram);
 };
 
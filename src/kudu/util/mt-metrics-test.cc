@@ -26,6 +26,7 @@
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/util/debug/leakcheck_disabler.h"
+#include "kudu/util/histogram.pb.h"
 #include "kudu/util/jsonwriter.h"
 #include "kudu/util/metrics.h"
 #include "kudu/util/monotime.h"
@@ -85,6 +86,38 @@ TEST_F(MultiThreadedMetricsTest, CounterIncrementTest) {
   ASSERT_EQ(num_threads * num_increments, counter->value());
 }
 
+METRIC_DEFINE_histogram(test_entity, test_striped_hist, "Test Striped Histogram",
+                        MetricUnit::kMicroseconds, "Test striped histogram",
+                        1000000, 3, kudu::STRIPED_HISTOGRAM);
+
+// Record the values 1 to 'num_increments' in a Histogram.
+static void CountWithHistogram(scoped_refptr<Histogram> hist, int num_increments) {
+  for (int i = 1; i <= num_increments; i++) {
+    hist->Increment(i);
+  }
+}
+
+// Ensure that the stripes of a striped histogram add up to all the recorded
+// values, regardless of which CPUs the threads ran on.
+TEST_F(MultiThreadedMetricsTest, StripedHistogramIncrementTest) {
+  scoped_refptr<Histogram> hist = new Histogram(&METRIC_test_striped_hist);
+  int num_threads = FLAGS_mt_metrics_test_num_threads;
+  int num_increments = 1000;
+  boost::function<void()> f =
+      boost::bind(CountWithHistogram, hist, num_increments);
+  RunWithManyThreads(&f, num_threads);
+  ASSERT_EQ(num_threads * num_increments, hist->TotalCount());
+  ASSERT_EQ(1, hist->MinValueForTests());
+  ASSERT_EQ(num_increments, hist->MaxValueForTests());
+  ASSERT_EQ(num_threads, hist->CountInBucketForValueForTests(num_increments / 2));
+  ASSERT_DOUBLE_EQ((num_increments + 1) / 2.0, hist->MeanValueForTests());
+
+  HistogramSnapshotPB snapshot;
+  ASSERT_OK(hist->GetHistogramSnapshotPB(&snapshot, MetricJsonOptions()));
+  ASSERT_EQ(num_threads * num_increments, snapshot.total_count());
+  ASSERT_EQ(num_threads * num_increments * (num_increments + 1) / 2, snapshot.total_sum());
+}
+
 // Helper function to register a bunch of counters in a loop.
 void MultiThreadedMetricsTest::RegisterCounters(
     const scoped_refptr<MetricEntity>& metric_entity,
@@ -16,6 +16,7 @@
 // under the License.
 
 #include <arpa/inet.h>
+#include <ifaddrs.h>
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <netdb.h>
@@ -239,6 +240,23 @@ Status GetFQDN(string* hostname) {
   return Status::OK();
 }
 
+Status GetLocalAddresses(vector<Sockaddr>* addresses) {
+  struct ifaddrs* ifaddrs;
+  if (getifaddrs(&ifaddrs) != 0) {
+    int err = errno;
+    return Status::NetworkError("Unable to list network interfaces", ErrnoToString(err), err);
+  }
+  for (struct ifaddrs* ifa = ifaddrs; ifa != nullptr; ifa = ifa->ifa_next) {
+    if (ifa->ifa_addr && ifa->ifa_addr->sa_family == AF_INET) {
+      Sockaddr addr(*reinterpret_cast<struct sockaddr_in*>(ifa->ifa_addr));
+      addr.set_port(0);
+      addresses->push_back(addr);
+    }
+  }
+  freeifaddrs(ifaddrs);
+  return Status::OK();
+}
+
 Status SockaddrFromHostPort(const HostPort& host_port, Sockaddr* addr) {
   vector<Sockaddr> addrs;
   RETURN_NOT_OK(host_port.ResolveAddresses(&addrs));
@@ -106,6 +106,10 @@ Status GetHostname(std::string* hostname);
 // Return the local machine's FQDN.
 Status GetFQDN(std::string* fqdn);
 
+// Return the IPv4 addresses of the network interfaces of the local machine,
+// with port 0.
+Status GetLocalAddresses(std::vector<Sockaddr>* addresses);
+
 // Returns a single socket address from a HostPort.
 // If the hostname resolves to multiple addresses, returns the first in the
 // list and logs a message in verbose mode.
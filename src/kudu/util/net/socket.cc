@@ -23,8 +23,10 @@
 #include <netinet/tcp.h>
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <sys/un.h>
 #include <unistd.h>
 
+#include <cstddef>
 #include <limits>
 #include <string>
 
@@ -57,6 +59,37 @@ TAG_FLAG(socket_inject_short_recvs, unsafe);
 
 namespace kudu {
 
+// Sets 'addr' to the address in 'ss'. Unix domain sockets have no IP
+// address, so they are reported as the loopback address with port 0.
+static void SockaddrFromStorage(const struct sockaddr_storage& ss, Sockaddr* addr) {
+  if (ss.ss_family == AF_INET) {
+    *addr = reinterpret_cast<const struct sockaddr_in&>(ss);
+    return;
+  }
+  struct sockaddr_in sin;
+  memset(&sin, 0, sizeof(sin));
+  sin.sin_family = AF_INET;
+  sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  *addr = sin;
+}
+
+#if defined(__linux__)
+// Sets 'addr' and 'len' to the address of 'name' in the abstract namespace
+// of Unix domain sockets. Abstract names start with a null byte, and aren't
+// null-terminated.
+static Status AbstractSocketAddress(const string& name, struct sockaddr_un* addr,
+                                    socklen_t* len) {
+  if (name.size() + 1 > sizeof(addr->sun_path)) {
+    return Status::InvalidArgument("abstract socket name too long", name);
+  }
+  memset(addr, 0, sizeof(*addr));
+  addr->sun_family = AF_UNIX;
+  memcpy(addr->sun_path + 1, name.data(), name.size());
+  *len = offsetof(struct sockaddr_un, sun_path) + 1 + name.size();
+  return Status::OK();
+}
+#endif // defined(__linux__)
+
 Socket::Socket()
   : fd_(-1) {
 }
@@ -134,6 +167,18 @@ Status Socket::Init(int flags) {
   return Status::OK();
 }
 
+Status Socket::InitUnixDomain(int flags) {
+  int nonblocking_flag = (flags & FLAG_NONBLOCKING) ? SOCK_NONBLOCK : 0;
+  Reset(::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | nonblocking_flag, 0));
+  if (fd_ < 0) {
+    int err = errno;
+    return Status::NetworkError(std::string("error opening Unix domain socket: ") +
+                                ErrnoToString(err), Slice(), err);
+  }
+
+  return Status::OK();
+}
+
 #else
 
 Status Socket::Init(int flags) {
@@ -157,6 +202,10 @@ Status Socket::Init(int flags) {
   return Status::OK();
 }
 
+Status Socket::InitUnixDomain(int flags) {
+  return Status::NotSupported("Unix domain RPC sockets are only supported on Linux");
+}
+
 #endif // defined(__linux__)
 
 Status Socket::SetNoDelay(bool enabled) {
@@ -241,6 +290,17 @@ Status Socket::SetReuseAddr(bool flag) {
   return Status::OK();
 }
 
+Status Socket::SetReusePort(bool flag) {
+  int err;
+  int int_flag = flag ? 1 : 0;
+  if (setsockopt(fd_, SOL_SOCKET, SO_REUSEPORT, &int_flag, sizeof(int_flag)) == -1) {
+    err = errno;
+    return Status::NetworkError(std::string("failed to set SO_REUSEPORT: ") +
+                                ErrnoToString(err), Slice(), err);
+  }
+  return Status::OK();
+}
+
 Status Socket::BindAndListen(const Sockaddr &sockaddr,
                              int listenQueueSize) {
   RETURN_NOT_OK(SetReuseAddr(true));
@@ -258,28 +318,28 @@ Status Socket::Listen(int listen_queue_size) {
 }
 
 Status Socket::GetSocketAddress(Sockaddr *cur_addr) const {
-  struct sockaddr_in sin;
-  socklen_t len = sizeof(sin);
+  struct sockaddr_storage ss;
+  socklen_t len = sizeof(ss);
   DCHECK_GE(fd_, 0);
-  if (::getsockname(fd_, (struct sockaddr *)&sin, &len) == -1) {
+  if (::getsockname(fd_, (struct sockaddr *)&ss, &len) == -1) {
     int err = errno;
     return Status::NetworkError(string("getsockname error: ") +
                                 ErrnoToString(err), Slice(), err);
   }
-  *cur_addr = sin;
+  SockaddrFromStorage(ss, cur_addr);
   return Status::OK();
 }
 
 Status Socket::GetPeerAddress(Sockaddr *cur_addr) const {
-  struct sockaddr_in sin;
-  socklen_t len = sizeof(sin);
+  struct sockaddr_storage ss;
+  socklen_t len = sizeof(ss);
   DCHECK_GE(fd_, 0);
-  if (::getpeername(fd_, (struct sockaddr *)&sin, &len) == -1) {
+  if (::getpeername(fd_, (struct sockaddr *)&ss, &len) == -1) {
     int err = errno;
     return Status::NetworkError(string("getpeername error: ") +
                                 ErrnoToString(err), Slice(), err);
   }
-  *cur_addr = sin;
+  SockaddrFromStorage(ss, cur_addr);
   return Status::OK();
 }
 
@@ -305,7 +365,7 @@ Status Socket::Bind(const Sockaddr& bind_addr) {
 
 Status Socket::Accept(Socket *new_conn, Sockaddr *remote, int flags) {
   TRACE_EVENT0("net", "Socket::Accept");
-  struct sockaddr_in addr;
+  struct sockaddr_storage addr;
   socklen_t olen = sizeof(addr);
   DCHECK_GE(fd_, 0);
 #if defined(__linux__)
@@ -331,7 +391,7 @@ Status Socket::Accept(Socket *new_conn, Sockaddr *remote, int flags) {
   RETURN_NOT_OK(new_conn->SetCloseOnExec());
 #endif // defined(__linux__)
 
-  *remote = addr;
+  SockaddrFromStorage(addr, remote);
   TRACE_EVENT_INSTANT1("net", "Accepted", TRACE_EVENT_SCOPE_THREAD,
                        "remote", remote->ToString());
   return Status::OK();
@@ -366,6 +426,50 @@ Status Socket::Connect(const Sockaddr &remote) {
   return Status::OK();
 }
 
+#if defined(__linux__)
+
+Status Socket::BindAbstract(const string& name) {
+  struct sockaddr_un addr;
+  socklen_t len;
+  RETURN_NOT_OK(AbstractSocketAddress(name, &addr, &len));
+  DCHECK_GE(fd_, 0);
+  if (::bind(fd_, (const struct sockaddr*)&addr, len) < 0) {
+    int err = errno;
+    return Status::NetworkError(
+        strings::Substitute("error binding socket to abstract name $0: $1",
+                            name, ErrnoToString(err)),
+        Slice(), err);
+  }
+  return Status::OK();
+}
+
+Status Socket::ConnectAbstract(const string& name) {
+  TRACE_EVENT1("net", "Socket::ConnectAbstract",
+               "name", name);
+  struct sockaddr_un addr;
+  socklen_t len;
+  RETURN_NOT_OK(AbstractSocketAddress(name, &addr, &len));
+  DCHECK_GE(fd_, 0);
+  if (::connect(fd_, (const struct sockaddr*)&addr, len) < 0) {
+    int err = errno;
+    return Status::NetworkError(std::string("connect(2) error: ") +
+                                ErrnoToString(err), Slice(), err);
+  }
+  return Status::OK();
+}
+
+#else
+
+Status Socket::BindAbstract(const string& name) {
+  return Status::NotSupported("abstract socket names are only supported on Linux");
+}
+
+Status Socket::ConnectAbstract(const string& name) {
+  return Status::NotSupported("abstract socket names are only supported on Linux");
+}
+
+#endif // defined(__linux__)
+
 Status Socket::GetSockError() const {
   int val = 0, ret;
   socklen_t val_len = sizeof(val);
@@ -64,6 +64,12 @@ class Socket {
 
   Status Init(int flags); // See FLAG_NONBLOCKING
 
+  // Like Init(), but creates a Unix domain stream socket, for connections
+  // between the processes of a host. Unix domain sockets have no IP address:
+  // GetSocketAddress(), GetPeerAddress() and Accept() report them as the
+  // loopback address, with port 0.
+  Status InitUnixDomain(int flags);
+
   // Set or clear TCP_NODELAY
   Status SetNoDelay(bool enabled);
 
@@ -80,6 +86,11 @@ class Socket {
   // Sets SO_REUSEADDR to 'flag'. Should be used prior to Bind().
   Status SetReuseAddr(bool flag);
 
+  // Sets SO_REUSEPORT to 'flag'. Must be called before Bind(). On Linux,
+  // several sockets of the same user bound to the same address with this
+  // option share the incoming connections between them.
+  Status SetReusePort(bool flag);
+
   // Convenience method to invoke the common sequence:
   // 1) SetReuseAddr(true)
   // 2) Bind()
@@ -107,6 +118,11 @@ class Socket {
   // start connecting this socket to a remote address.
   Status Connect(const Sockaddr &remote);
 
+  // Bind or connect a Unix domain socket to 'name' in the abstract namespace,
+  // so that no file is created. Returns NotSupported other than on Linux.
+  Status BindAbstract(const std::string& name);
+  Status ConnectAbstract(const std::string& name);
+
   // get the error status using getsockopt(2)
   Status GetSockError() const;
 
@@ -0,0 +1,59 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#include "kudu/util/numa.h"
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "kudu/util/test_macros.h"
+
+using std::string;
+using std::vector;
+
+namespace kudu {
+
+TEST(NumaTest, TestParseCpuList) {
+  vector<int> cpus;
+  ASSERT_OK(ParseCpuList("0-3,8,10-11\n", &cpus));
+  ASSERT_EQ((vector<int>{ 0, 1, 2, 3, 8, 10, 11 }), cpus);
+
+  ASSERT_OK(ParseCpuList("5", &cpus));
+  ASSERT_EQ(vector<int>{ 5 }, cpus);
+
+  // Nodes without CPUs have an empty list.
+  ASSERT_OK(ParseCpuList("\n", &cpus));
+  ASSERT_TRUE(cpus.empty());
+
+  for (const string& bad : { "a", "1-", "3-1", "1-2-3", "1,,2" }) {
+    ASSERT_TRUE(ParseCpuList(bad, &cpus).IsCorruption()) << bad;
+  }
+}
+
+TEST(NumaTest, TestTopology) {
+  const NumaTopology* topology = NumaTopology::Get();
+  ASSERT_GE(topology->num_nodes(), 1);
+  for (int node = 0; node < topology->num_nodes(); node++) {
+    ASSERT_FALSE(topology->node_cpus(node).empty());
+  }
+#if defined(__linux__)
+  ASSERT_OK(topology->BindCurrentThreadToNode(0));
+#endif
+}
+
+} // namespace kudu
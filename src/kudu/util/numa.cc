@@ -0,0 +1,149 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#include "kudu/util/numa.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include "kudu/gutil/strings/numbers.h"
+#include "kudu/gutil/strings/split.h"
+#include "kudu/gutil/strings/strip.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/env.h"
+#include "kudu/util/errno.h"
+#include "kudu/util/faststring.h"
+#include "kudu/util/flag_tags.h"
+
+DEFINE_bool(numa_aware_thread_placement, false,
+            "Whether to bind each RPC reactor thread and service thread to a "
+            "NUMA node, spreading the threads of each group evenly over the "
+            "nodes, so that the memory they allocate stays local to the CPUs "
+            "they run on. Has no effect on machines with a single NUMA node.");
+TAG_FLAG(numa_aware_thread_placement, experimental);
+
+using std::string;
+using std::vector;
+using strings::Substitute;
+
+namespace kudu {
+
+Status ParseCpuList(const string& cpulist, vector<int>* cpus) {
+  string list = cpulist;
+  StripWhiteSpace(&list);
+  vector<int> result;
+  if (!list.empty()) {
+    vector<string> ranges = strings::Split(list, ",");
+    for (const string& range : ranges) {
+      vector<string> bounds = strings::Split(range, "-");
+      int32 first, last;
+      if (bounds.size() > 2 ||
+          !safe_strto32(bounds[0], &first) ||
+          !safe_strto32(bounds.back(), &last) ||
+          first < 0 || first > last) {
+        return Status::Corruption("invalid cpulist", cpulist);
+      }
+      for (int cpu = first; cpu <= last; cpu++) {
+        result.push_back(cpu);
+      }
+    }
+  }
+  cpus->swap(result);
+  return Status::OK();
+}
+
+const NumaTopology* NumaTopology::Get() {
+  return Singleton<NumaTopology>::get();
+}
+
+NumaTopology::NumaTopology() {
+#if defined(__linux__)
+  Env* env = Env::Default();
+  for (int node = 0;; node++) {
+    string path = Substitute("/sys/devices/system/node/node$0/cpulist", node);
+    if (!env->FileExists(path)) {
+      break;
+    }
+    faststring buf;
+    vector<int> cpus;
+    Status s = ReadFileToString(env, path, &buf);
+    if (s.ok()) {
+      s = ParseCpuList(buf.ToString(), &cpus);
+    }
+    if (!s.ok()) {
+      LOG(WARNING) << "Unable to read the CPUs of NUMA node " << node << ": "
+                   << s.ToString();
+      node_cpus_.clear();
+      break;
+    }
+    // Nodes with memory but no CPUs can't run threads.
+    if (!cpus.empty()) {
+      node_cpus_.emplace_back(std::move(cpus));
+    }
+  }
+#endif
+  if (node_cpus_.empty()) {
+    vector<int> cpus;
+    for (int cpu = 0; cpu < sysconf(_SC_NPROCESSORS_CONF); cpu++) {
+      cpus.push_back(cpu);
+    }
+    node_cpus_.emplace_back(std::move(cpus));
+  }
+}
+
+const vector<int>& NumaTopology::node_cpus(int node) const {
+  DCHECK_GE(node, 0);
+  DCHECK_LT(node, node_cpus_.size());
+  return node_cpus_[node];
+}
+
+Status NumaTopology::BindCurrentThreadToNode(int node) const {
+#if defined(__linux__)
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (int cpu : node_cpus(node)) {
+    CPU_SET(cpu, &set);
+  }
+  int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+  if (err != 0) {
+    return Status::RuntimeError(Substitute("unable to bind thread to NUMA node $0", node),
+                                ErrnoToString(err), err);
+  }
+  return Status::OK();
+#else
+  return Status::NotSupported("thread affinity is not supported on this platform");
+#endif
+}
+
+void MaybeBindThreadToNumaNode(const string& group, int index) {
+  if (!FLAGS_numa_aware_thread_placement) {
+    return;
+  }
+  const NumaTopology* topology = NumaTopology::Get();
+  if (topology->num_nodes() < 2) {
+    return;
+  }
+  int node = index % topology->num_nodes();
+  VLOG(1) << "Binding " << group << " thread " << index << " to NUMA node " << node;
+  WARN_NOT_OK(topology->BindCurrentThreadToNode(node),
+              Substitute("Unable to bind $0 thread $1 to NUMA node $2", group, index, node));
+}
+
+} // namespace kudu
@@ -0,0 +1,66 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "kudu/gutil/macros.h"
+#include "kudu/gutil/singleton.h"
+#include "kudu/util/status.h"
+
+namespace kudu {
+
+// The CPUs of the NUMA nodes of the machine, as reported by sysfs.
+//
+// Machines without NUMA, and machines whose topology can't be read, are
+// treated as a single node with all of the CPUs.
+class NumaTopology {
+ public:
+  // The topology of this machine, read on first use.
+  static const NumaTopology* Get();
+
+  int num_nodes() const { return node_cpus_.size(); }
+
+  // The CPUs of 'node', which must be less than num_nodes().
+  const std::vector<int>& node_cpus(int node) const;
+
+  // Restricts the calling thread to the CPUs of 'node'. Memory the thread
+  // touches first is then allocated on that node by the kernel's default
+  // first-touch policy.
+  Status BindCurrentThreadToNode(int node) const;
+
+ private:
+  friend class Singleton<NumaTopology>;
+
+  NumaTopology();
+
+  std::vector<std::vector<int>> node_cpus_;
+
+  DISALLOW_COPY_AND_ASSIGN(NumaTopology);
+};
+
+// Parses a sysfs cpulist such as "0-3,8,10-11" into the CPUs it lists.
+Status ParseCpuList(const std::string& cpulist, std::vector<int>* cpus);
+
+// If --numa_aware_thread_placement is set, binds the calling thread to a
+// NUMA node. 'index' is the index of the thread within 'group', a set of
+// like threads such as the reactors of a messenger, which are spread over
+// the nodes round-robin. Failures are logged and otherwise ignored.
+void MaybeBindThreadToNumaNode(const std::string& group, int index);
+
+} // namespace kudu
@@ -203,6 +203,8 @@ class NvmLRUCache {
   Cache::Handle* Lookup(const Slice& key, uint32_t hash, bool caching);
   void Release(Cache::Handle* handle);
   void Erase(const Slice& key, uint32_t hash);
+  // Appends a new reference to each entry, oldest first.
+  void GetAllEntries(vector<Cache::Handle*>* handles);
   void* AllocateAndRetry(size_t size);
 
  private:
@@ -451,6 +453,15 @@ void NvmLRUCache::Erase(const Slice& key, uint32_t hash) {
     FreeEntry(e);
   }
 }
+
+void NvmLRUCache::GetAllEntries(vector<Cache::Handle*>* handles) {
+  std::lock_guard<MutexType> l(mutex_);
+  for (LRUHandle* e = lru_.next; e != &lru_; e = e->next) {
+    base::RefCountInc(&e->refs);
+    handles->push_back(reinterpret_cast<Cache::Handle*>(e));
+  }
+}
+
 static const int kNumShardBits = 4;
 static const int kNumShards = 1 << kNumShardBits;
 
@@ -512,6 +523,14 @@ class ShardedLRUCache : public Cache {
   virtual Slice Value(Handle* handle) OVERRIDE {
     return reinterpret_cast<LRUHandle*>(handle)->value();
   }
+  virtual Slice Key(Handle* handle) OVERRIDE {
+    return reinterpret_cast<LRUHandle*>(handle)->key();
+  }
+  virtual void GetAllEntries(vector<Handle*>* handles) OVERRIDE {
+    for (NvmLRUCache* cache : shards_) {
+      cache->GetAllEntries(handles);
+    }
+  }
   virtual uint8_t* MutableValue(PendingHandle* handle) OVERRIDE {
     return reinterpret_cast<LRUHandle*>(handle)->val_ptr();
   }
@@ -447,6 +447,40 @@ TEST_P(TestPBContainerVersions, TestMultipleMessages) {
   ASSERT_OK(pb_reader.Close());
 }
 
+TEST_P(TestPBContainerVersions, TestAppendBatch) {
+  ProtoContainerTestPB pb;
+  pb.set_name("foo");
+
+  unique_ptr<WritablePBContainerFile> pb_writer;
+  ASSERT_OK(NewPBCWriter(version_, RWFileOptions(), &pb_writer));
+  ASSERT_OK(pb_writer->Init(pb));
+
+  // Mix batched and single appends.
+  vector<ProtoContainerTestPB> batch(5, pb);
+  vector<const google::protobuf::Message*> batch_ptrs;
+  for (int i = 0; i < batch.size(); i++) {
+    batch[i].set_value(i);
+    batch_ptrs.push_back(&batch[i]);
+  }
+  ASSERT_OK(pb_writer->AppendBatch(batch_ptrs));
+  pb.set_value(5);
+  ASSERT_OK(pb_writer->Append(pb));
+  ASSERT_OK(pb_writer->AppendBatch({}));
+  ASSERT_OK(pb_writer->Close());
+
+  gscoped_ptr<RandomAccessFile> reader;
+  ASSERT_OK(env_->NewRandomAccessFile(path_, &reader));
+  ReadablePBContainerFile pb_reader(std::move(reader));
+  ASSERT_OK(pb_reader.Open());
+  for (int i = 0; i < 6; i++) {
+    ProtoContainerTestPB read_pb;
+    ASSERT_OK(pb_reader.ReadNextPB(&read_pb));
+    ASSERT_EQ(i, read_pb.value());
+  }
+  ASSERT_TRUE(pb_reader.ReadNextPB(nullptr).IsEndOfFile());
+  ASSERT_OK(pb_reader.Close());
+}
+
 TEST_P(TestPBContainerVersions, TestInterleavedReadWrite) {
   ProtoContainerTestPB pb;
   pb.set_name("foo");
@@ -32,6 +32,7 @@
 #include <unordered_set>
 #include <vector>
 
+#include <gflags/gflags.h>
 #include <glog/logging.h>
 #include <google/protobuf/descriptor.h>
 #include <google/protobuf/descriptor.pb.h>
@@ -56,12 +57,20 @@
 #include "kudu/util/debug/trace_event.h"
 #include "kudu/util/env.h"
 #include "kudu/util/env_util.h"
+#include "kudu/util/flag_tags.h"
+#include "kudu/util/group_dir_syncer.h"
 #include "kudu/util/jsonwriter.h"
 #include "kudu/util/path_util.h"
 #include "kudu/util/pb_util-internal.h"
 #include "kudu/util/pb_util.pb.h"
 #include "kudu/util/status.h"
 
+DEFINE_bool(group_pb_file_dir_syncs, true,
+            "Whether concurrent syncs of the directory of protobuf files being "
+            "replaced, like tablet and consensus metadata, are coalesced into "
+            "fewer fsync() calls. Each write is still durable when it returns.");
+TAG_FLAG(group_pb_file_dir_syncs, advanced);
+
 using google::protobuf::Descriptor;
 using google::protobuf::DescriptorPool;
 using google::protobuf::DynamicMessageFactory;
@@ -104,6 +113,14 @@ namespace pb_util {
 
 static const char* const kTmpTemplateSuffix = ".tmp.XXXXXX";
 
+// Makes the rename of a file into 'path' durable.
+static Status SyncParentDir(Env* env, const string& path) {
+  if (FLAGS_group_pb_file_dir_syncs) {
+    return GroupDirSyncer::Get()->SyncDir(env, DirName(path));
+  }
+  return env->SyncDir(DirName(path));
+}
+
 // Protobuf container constants.
 static const uint32_t kPBContainerInvalidVersion = 0;
 static const uint32_t kPBContainerDefaultVersion = 2;
@@ -471,7 +488,7 @@ Status WritePBToPath(Env* env, const std::string& path,
   RETURN_NOT_OK_PREPEND(env->RenameFile(tmp_path, path), "Failed to rename tmp file to " + path);
   tmp_deleter.Cancel();
   if (sync == pb_util::SYNC) {
-    RETURN_NOT_OK_PREPEND(env->SyncDir(DirName(path)), "Failed to SyncDir() parent of " + path);
+    RETURN_NOT_OK_PREPEND(SyncParentDir(env, path), "Failed to SyncDir() parent of " + path);
   }
   return Status::OK();
 }
@@ -621,6 +638,19 @@ Status WritablePBContainerFile::Append(const Message& msg) {
   return Status::OK();
 }
 
+Status WritablePBContainerFile::AppendBatch(const vector<const Message*>& msgs) {
+  DCHECK_EQ(FileState::OPEN, state_);
+
+  faststring buf;
+  for (const Message* msg : msgs) {
+    RETURN_NOT_OK_PREPEND(AppendMsgToBuffer(*msg, &buf),
+                          "Failed to prepare buffer for writing");
+  }
+  RETURN_NOT_OK_PREPEND(AppendBytes(buf), "Failed to append data to file");
+
+  return Status::OK();
+}
+
 Status WritablePBContainerFile::Flush() {
   DCHECK_EQ(FileState::OPEN, state_);
 
@@ -872,7 +902,7 @@ Status WritePBContainerToPath(Env* env, const std::string& path,
                         "Failed to rename tmp file to " + path);
   tmp_deleter.Cancel();
   if (sync == pb_util::SYNC) {
-    RETURN_NOT_OK_PREPEND(env->SyncDir(DirName(path)),
+    RETURN_NOT_OK_PREPEND(SyncParentDir(env, path),
                           "Failed to SyncDir() parent of " + path);
   }
   return Status::OK();
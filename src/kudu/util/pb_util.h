@@ -22,6 +22,7 @@
 #define KUDU_UTIL_PB_UTIL_H
 
 #include <string>
+#include <vector>
 
 #include <gtest/gtest_prod.h>
 
@@ -289,6 +290,10 @@ class WritablePBContainerFile {
   // called prior to calling Append(), i.e. the file must be open.
   Status Append(const google::protobuf::Message& msg);
 
+  // Like Append() for each message in 'msgs', but writes all of them to the
+  // container at once.
+  Status AppendBatch(const std::vector<const google::protobuf::Message*>& msgs);
+
   // Asynchronously flushes all dirty container data to the filesystem.
   // The file must be open.
   Status Flush();
@@ -0,0 +1,130 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/util/sampling_profiler.h"
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <gflags/gflags.h>
+#include <gtest/gtest.h>
+
+#include "kudu/gutil/strings/split.h"
+#include "kudu/util/countdown_latch.h"
+#include "kudu/util/test_macros.h"
+#include "kudu/util/test_util.h"
+#include "kudu/util/thread.h"
+
+DECLARE_string(sampling_profiler_categories);
+
+using std::string;
+using std::vector;
+
+namespace kudu {
+
+class SamplingProfilerTest : public KuduTest {};
+
+TEST_F(SamplingProfilerTest, TestProfileCategory) {
+  ASSERT_EQ("reactor", SamplingProfiler::ProfileCategory({ "reactor", "rpc reactor-12", 12 }));
+  ASSERT_EQ("service", SamplingProfiler::ProfileCategory(
+      { "service pool", "rpc worker-13", 13 }));
+  ASSERT_EQ("apply", SamplingProfiler::ProfileCategory(
+      { "thread pool", "apply [worker]-14", 14 }));
+  ASSERT_EQ("maintenance", SamplingProfiler::ProfileCategory(
+      { "thread pool", "MaintenanceMgr [worker]-15", 15 }));
+  ASSERT_EQ("maintenance", SamplingProfiler::ProfileCategory(
+      { "maintenance", "maintenance_scheduler-16", 16 }));
+}
+
+#if defined(__linux__)
+
+namespace {
+void SampledSleeperThread(CountDownLatch* l) {
+  // Loop around WaitFor() rather than Wait(), like in debug-util-test, so
+  // that the thread handles signals under TSAN.
+  while (!l->WaitFor(MonoDelta::FromMilliseconds(10))) {
+  }
+}
+} // anonymous namespace
+
+TEST_F(SamplingProfilerTest, TestSampleThreads) {
+  FLAGS_sampling_profiler_categories = "test";
+  CountDownLatch l(1);
+  scoped_refptr<Thread> t;
+  ASSERT_OK(Thread::Create("test", "sampled thread", &SampledSleeperThread, &l, &t));
+
+  // The thread is listed shortly after it starts.
+  AssertEventually([&]() {
+    vector<ThreadListEntry> threads;
+    ListKuduThreads(&threads);
+    bool found = false;
+    for (const ThreadListEntry& e : threads) {
+      found |= e.tid == t->tid();
+    }
+    ASSERT_TRUE(found);
+  });
+
+  SamplingProfiler profiler;
+  const int kNumSamples = 5;
+  for (int i = 0; i < kNumSamples; i++) {
+    profiler.SampleOnce();
+  }
+
+  std::ostringstream out;
+  profiler.WriteFoldedStacks(SamplingProfiler::Filter(), &out);
+  int64_t total = 0;
+  vector<string> lines = strings::Split(out.str(), "\n", strings::SkipEmpty());
+  ASSERT_FALSE(lines.empty());
+  for (const string& line : lines) {
+    ASSERT_EQ(0, line.find("test;")) << line;
+    size_t space = line.rfind(' ');
+    ASSERT_NE(string::npos, space) << line;
+    total += std::stoll(line.substr(space + 1));
+  }
+  ASSERT_EQ(kNumSamples, total);
+  ASSERT_STR_CONTAINS(out.str(), "SampledSleeperThread");
+
+  // Only threads of the requested category are output.
+  SamplingProfiler::Filter filter;
+  filter.category = "reactor";
+  out.str("");
+  profiler.WriteFoldedStacks(filter, &out);
+  ASSERT_EQ("", out.str());
+
+  // The sleeping thread is rarely on a CPU.
+  filter.category = "test";
+  filter.on_cpu_only = true;
+  out.str("");
+  profiler.WriteFoldedStacks(filter, &out);
+  lines = strings::Split(out.str(), "\n", strings::SkipEmpty());
+  ASSERT_LE(lines.size(), kNumSamples);
+
+  l.CountDown();
+  t->Join();
+}
+
+TEST_F(SamplingProfilerTest, TestStartAndShutdown) {
+  SamplingProfiler profiler;
+  ASSERT_OK(profiler.Start());
+  profiler.Shutdown();
+  profiler.Shutdown();
+}
+
+#endif // defined(__linux__)
+
+} // namespace kudu
@@ -0,0 +1,264 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/util/sampling_profiler.h"
+
+#include <algorithm>
+#include <fstream>
+#include <mutex>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/bind.hpp>
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include "kudu/gutil/map-util.h"
+#include "kudu/gutil/strings/numbers.h"
+#include "kudu/gutil/strings/split.h"
+#include "kudu/util/flag_tags.h"
+#include "kudu/util/thread.h"
+#include "kudu/util/web_callback_registry.h"
+
+DEFINE_int32(sampling_profiler_interval_ms, 1000,
+             "Interval at which the sampling profiler collects the stacks of the "
+             "profiled threads, shown at /sampled-stacks. 0 disables the profiler.");
+TAG_FLAG(sampling_profiler_interval_ms, advanced);
+TAG_FLAG(sampling_profiler_interval_ms, runtime);
+
+DEFINE_int32(sampling_profiler_window_secs, 300,
+             "Number of seconds of samples kept by the sampling profiler.");
+TAG_FLAG(sampling_profiler_window_secs, advanced);
+TAG_FLAG(sampling_profiler_window_secs, runtime);
+
+DEFINE_string(sampling_profiler_categories, "reactor,service,apply,maintenance",
+              "Comma-separated list of the categories of threads sampled by the "
+              "sampling profiler, or '*' for all threads. Thread pool workers are "
+              "categorized by the name of their pool.");
+TAG_FLAG(sampling_profiler_categories, advanced);
+TAG_FLAG(sampling_profiler_categories, runtime);
+
+using std::string;
+using std::vector;
+
+namespace kudu {
+
+// The number of buckets which the window is split into. Samples expire a
+// bucket at a time.
+static const int kNumBuckets = 10;
+
+// How long to wait for a thread to respond to the signal. Threads which
+// don't respond within this time are likely blocking signals.
+static const MonoDelta kThreadStackTimeout = MonoDelta::FromMilliseconds(100);
+
+namespace {
+
+// Returns whether the thread 'tid' of this process is running or runnable,
+// according to /proc.
+bool IsThreadOnCpu(int64_t tid) {
+  std::ostringstream path;
+  path << "/proc/self/task/" << tid << "/stat";
+  std::ifstream f(path.str().c_str());
+  string line;
+  if (!std::getline(f, line)) {
+    return false;
+  }
+  // The state follows the name, which is in parentheses and may itself
+  // contain parentheses.
+  size_t close_paren = line.rfind(')');
+  return close_paren != string::npos && close_paren + 2 < line.size() &&
+      line[close_paren + 2] == 'R';
+}
+
+} // anonymous namespace
+
+size_t SamplingProfiler::SampleKeyHash::operator()(const SampleKey& k) const {
+  return std::hash<string>()(k.category) ^ k.stack.HashCode() ^ k.on_cpu;
+}
+
+bool SamplingProfiler::SampleKeyEqual::operator()(const SampleKey& a,
+                                                  const SampleKey& b) const {
+  return a.on_cpu == b.on_cpu && a.category == b.category && a.stack.Equals(b.stack);
+}
+
+SamplingProfiler::SamplingProfiler()
+    : stop_latch_(1) {
+}
+
+SamplingProfiler::~SamplingProfiler() {
+  Shutdown();
+}
+
+Status SamplingProfiler::Start() {
+  if (FLAGS_sampling_profiler_interval_ms <= 0) {
+    return Status::OK();
+  }
+  return Thread::Create("server", "sampling-profiler", &SamplingProfiler::RunThread,
+                        this, &thread_);
+}
+
+void SamplingProfiler::Shutdown() {
+  if (thread_) {
+    stop_latch_.CountDown();
+    thread_->Join();
+    thread_.reset();
+  }
+}
+
+void SamplingProfiler::RunThread() {
+  while (!stop_latch_.WaitFor(MonoDelta::FromMilliseconds(
+      std::max(FLAGS_sampling_profiler_interval_ms, 1)))) {
+    // The profiler may be disabled at runtime.
+    if (FLAGS_sampling_profiler_interval_ms > 0) {
+      SampleOnce();
+    }
+  }
+}
+
+string SamplingProfiler::ProfileCategory(const ThreadListEntry& thread) {
+  if (thread.category == "service pool") {
+    return "service";
+  }
+  if (thread.category == "thread pool") {
+    // Pool threads are called "<pool> [worker]-<tid>".
+    string pool = thread.name.substr(0, thread.name.find(" [worker]"));
+    return pool == "MaintenanceMgr" ? "maintenance" : pool;
+  }
+  return thread.category;
+}
+
+void SamplingProfiler::SampleOnce() {
+  vector<string> categories = strings::Split(FLAGS_sampling_profiler_categories, ",",
+                                             strings::SkipEmpty());
+  bool all_categories = std::find(categories.begin(), categories.end(), "*") !=
+      categories.end();
+
+  vector<ThreadListEntry> threads;
+  ListKuduThreads(&threads);
+  const int64_t self_tid = Thread::CurrentThreadId();
+
+  vector<SampleKey> samples;
+  for (const ThreadListEntry& t : threads) {
+    if (t.tid == self_tid) {
+      continue;
+    }
+    SampleKey key;
+    key.category = ProfileCategory(t);
+    if (!all_categories &&
+        std::find(categories.begin(), categories.end(), key.category) == categories.end()) {
+      continue;
+    }
+    // Check the state first: the signal wakes the thread up.
+    key.on_cpu = IsThreadOnCpu(t.tid);
+    Status s = GetThreadStack(t.tid, &key.stack, kThreadStackTimeout);
+    if (!s.ok()) {
+      // The thread may have exited since it was listed.
+      VLOG(2) << "Unable to sample thread " << t.name << ": " << s.ToString();
+      continue;
+    }
+    samples.push_back(std::move(key));
+  }
+
+  MonoTime now = MonoTime::Now();
+  MonoDelta window = MonoDelta::FromSeconds(std::max(FLAGS_sampling_profiler_window_secs, 1));
+  MonoDelta bucket_len = MonoDelta::FromNanoseconds(window.ToNanoseconds() / kNumBuckets);
+
+  std::lock_guard<simple_spinlock> l(lock_);
+  while (!buckets_.empty() && buckets_.front().start + window + bucket_len < now) {
+    buckets_.pop_front();
+  }
+  if (buckets_.empty() || buckets_.back().start + bucket_len <= now) {
+    buckets_.emplace_back();
+    buckets_.back().start = now;
+  }
+  SampleCounts& counts = buckets_.back().counts;
+  for (const SampleKey& sample : samples) {
+    counts[sample]++;
+  }
+}
+
+void SamplingProfiler::WriteFoldedStacks(const Filter& filter, std::ostream* out) const {
+  SampleCounts merged;
+  {
+    MonoTime now = MonoTime::Now();
+    std::lock_guard<simple_spinlock> l(lock_);
+    for (const Bucket& b : buckets_) {
+      if (filter.window.Initialized() && b.start + filter.window < now) {
+        continue;
+      }
+      for (const auto& entry : b.counts) {
+        const SampleKey& key = entry.first;
+        if ((!filter.category.empty() && key.category != filter.category) ||
+            (filter.on_cpu_only && !key.on_cpu)) {
+          continue;
+        }
+        // Merge the on- and off-CPU samples of the same stack.
+        SampleKey merged_key = key;
+        merged_key.on_cpu = false;
+        merged[merged_key] += entry.second;
+      }
+    }
+  }
+
+  // Symbolize outside of the lock, symbolizing each address once.
+  std::unordered_map<void*, string> symbols;
+  vector<std::pair<string, int64_t>> lines;
+  for (const auto& entry : merged) {
+    const StackTrace& stack = entry.first.stack;
+    string line = entry.first.category;
+    for (int i = stack.num_frames() - 1; i >= 0; i--) {
+      void* pc = stack.frame(i);
+      auto it = symbols.find(pc);
+      if (it == symbols.end()) {
+        string symbol = StackTrace::SymbolizeFrame(pc);
+        // ';' separates the frames, and the last space the count.
+        std::replace(symbol.begin(), symbol.end(), ';', ':');
+        std::replace(symbol.begin(), symbol.end(), ' ', '_');
+        it = symbols.emplace(pc, std::move(symbol)).first;
+      }
+      line.push_back(';');
+      line.append(it->second);
+    }
+    lines.emplace_back(std::move(line), entry.second);
+  }
+  std::sort(lines.begin(), lines.end());
+  for (const auto& line : lines) {
+    *out << line.first << " " << line.second << "\n";
+  }
+}
+
+void SamplingProfiler::RegisterPathHandler(WebCallbackRegistry* web) {
+  auto handler = [this](const WebCallbackRegistry::WebRequest& req,
+                        std::ostringstream* output) {
+    Filter filter;
+    filter.category = FindWithDefault(req.parsed_args, "category", "");
+    int32_t window_secs;
+    if (safe_strto32(FindWithDefault(req.parsed_args, "window_secs", ""), &window_secs) &&
+        window_secs > 0) {
+      filter.window = MonoDelta::FromSeconds(window_secs);
+    }
+    filter.on_cpu_only = ParseLeadingBoolValue(
+        FindWithDefault(req.parsed_args, "on_cpu", "false").c_str(), false);
+    WriteFoldedStacks(filter, output);
+  };
+  web->RegisterPathHandler("/sampled-stacks", "", handler, false, false);
+}
+
+} // namespace kudu
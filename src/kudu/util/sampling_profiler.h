@@ -0,0 +1,131 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#ifndef KUDU_UTIL_SAMPLING_PROFILER_H
+#define KUDU_UTIL_SAMPLING_PROFILER_H
+
+#include <cstdint>
+#include <deque>
+#include <iosfwd>
+#include <string>
+#include <unordered_map>
+
+#include "kudu/gutil/macros.h"
+#include "kudu/gutil/ref_counted.h"
+#include "kudu/util/countdown_latch.h"
+#include "kudu/util/debug-util.h"
+#include "kudu/util/locks.h"
+#include "kudu/util/monotime.h"
+#include "kudu/util/status.h"
+
+namespace kudu {
+
+class Thread;
+class WebCallbackRegistry;
+struct ThreadListEntry;
+
+// An always-on, low-frequency sampling profiler.
+//
+// Every --sampling_profiler_interval_ms, a background thread collects the
+// stack of every running thread of the profiled categories, using the same
+// signal as DumpThreadStack(). The samples are counted per category and
+// stack over a rolling window of the last --sampling_profiler_window_secs,
+// so that the stacks behind a latency spike can still be looked at once
+// the spike is over, without having had to attach a profiler in time.
+//
+// Every thread is sampled whether it is running or not, so the profile is
+// of wall-clock time. Each sample also records whether its thread was on a
+// CPU, from which an on-CPU profile can be extracted.
+class SamplingProfiler {
+ public:
+  SamplingProfiler();
+  ~SamplingProfiler();
+
+  // Starts the sampling thread, unless --sampling_profiler_interval_ms is 0.
+  Status Start();
+
+  // Stops the sampling thread, if it was started.
+  void Shutdown();
+
+  // Registers /sampled-stacks, which returns the sampled stacks as
+  // written by WriteFoldedStacks(). It accepts the 'category', 'window_secs'
+  // and 'on_cpu' arguments, which set the fields of Filter.
+  void RegisterPathHandler(WebCallbackRegistry* web);
+
+  // Samples the stack of every profiled thread once. Called periodically
+  // by the sampling thread.
+  void SampleOnce();
+
+  struct Filter {
+    // The category of the threads to output, or empty for all of them.
+    std::string category;
+
+    // Only the samples taken this recently are output. Uninitialized for
+    // the whole window.
+    MonoDelta window;
+
+    // Whether to only output the samples of threads which were on a CPU.
+    bool on_cpu_only = false;
+  };
+
+  // Writes the sampled stacks which match 'filter' to 'out', in the folded
+  // format read by flamegraph.pl: one line per distinct stack, made of the
+  // category of its threads followed by its frames, outermost first, all
+  // separated by ';', then a space and the number of samples of the stack.
+  void WriteFoldedStacks(const Filter& filter, std::ostream* out) const;
+
+  // Returns the category under which 'thread' is profiled. Thread pool
+  // workers are profiled under the name of their pool, except for those of
+  // the maintenance manager, which go with its scheduler thread under
+  // "maintenance". RPC service threads are profiled under "service".
+  static std::string ProfileCategory(const ThreadListEntry& thread);
+
+ private:
+  struct SampleKey {
+    std::string category;
+    bool on_cpu;
+    StackTrace stack;
+  };
+  struct SampleKeyHash {
+    size_t operator()(const SampleKey& k) const;
+  };
+  struct SampleKeyEqual {
+    bool operator()(const SampleKey& a, const SampleKey& b) const;
+  };
+  typedef std::unordered_map<SampleKey, int64_t, SampleKeyHash, SampleKeyEqual> SampleCounts;
+
+  // The samples taken during a slice of the window.
+  struct Bucket {
+    MonoTime start;
+    SampleCounts counts;
+  };
+
+  void RunThread();
+
+  // Protects buckets_.
+  mutable simple_spinlock lock_;
+
+  // The buckets covering the window, the oldest first.
+  std::deque<Bucket> buckets_;
+
+  CountDownLatch stop_latch_;
+  scoped_refptr<Thread> thread_;
+
+  DISALLOW_COPY_AND_ASSIGN(SamplingProfiler);
+};
+
+} // namespace kudu
+#endif /* KUDU_UTIL_SAMPLING_PROFILER_H */
@@ -164,6 +164,8 @@ class ThreadMgr {
   // already been removed, this is a no-op.
   void RemoveThread(const pthread_t& pthread_id, const string& category);
 
+  void ListThreads(vector<ThreadListEntry>* threads);
+
  private:
   // Container class for any details we want to capture about a thread
   // TODO: Add start-time.
@@ -328,6 +330,16 @@ void ThreadMgr::RemoveThread(const pthread_t& pthread_id, const string& category
   ANNOTATE_IGNORE_READS_AND_WRITES_END();
 }
 
+void ThreadMgr::ListThreads(vector<ThreadListEntry>* threads) {
+  threads->clear();
+  MutexLock l(lock_);
+  for (const ThreadCategoryMap::value_type& category : thread_categories_) {
+    for (const ThreadCategory::value_type& thread : category.second) {
+      threads->push_back({ category.first, thread.second.name(), thread.second.thread_id() });
+    }
+  }
+}
+
 void ThreadMgr::PrintThreadCategoryRows(const ThreadCategory& category,
     ostringstream* output) {
   for (const ThreadCategory::value_type& thread : category) {
@@ -406,6 +418,11 @@ Status StartThreadInstrumentation(const scoped_refptr<MetricEntity>& server_metr
   return thread_manager->StartInstrumentation(server_metrics, web);
 }
 
+void ListKuduThreads(vector<ThreadListEntry>* threads) {
+  GoogleOnceInit(&once, &InitThreading);
+  thread_manager->ListThreads(threads);
+}
+
 ThreadJoiner::ThreadJoiner(Thread* thr)
   : thread_(CHECK_NOTNULL(thr)),
     warn_after_ms_(kDefaultWarnAfterMs),
@@ -357,6 +357,18 @@ class Thread : public RefCountedThreadSafe<Thread> {
 // the given entity.
 Status StartThreadInstrumentation(const scoped_refptr<MetricEntity>& server_metrics,
                                   WebCallbackRegistry* web);
+
+// A running thread that was started through Thread.
+struct ThreadListEntry {
+  std::string category;
+  // The name of the thread, suffixed with its system thread ID.
+  std::string name;
+  int64_t tid;
+};
+
+// Sets 'threads' to all of the running threads that were started through
+// Thread, as listed by /threadz.
+void ListKuduThreads(std::vector<ThreadListEntry>* threads);
 } // namespace kudu
 
 #endif /* KUDU_UTIL_THREAD_H */
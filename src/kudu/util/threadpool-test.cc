@@ -18,7 +18,12 @@
 #include <boost/bind.hpp>
 #include <glog/logging.h>
 #include <gtest/gtest.h>
+#include <atomic>
 #include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
 
 #include "kudu/gutil/atomicops.h"
 #include "kudu/gutil/bind.h"
@@ -27,9 +32,13 @@
 #include "kudu/util/promise.h"
 #include "kudu/util/threadpool.h"
 #include "kudu/util/test_macros.h"
+#include "kudu/util/test_util.h"
 #include "kudu/util/trace.h"
 
 using std::shared_ptr;
+using std::string;
+using std::unique_ptr;
+using std::vector;
 
 namespace kudu {
 
@@ -249,6 +258,165 @@ TEST(TestThreadPool, TestPromises) {
   thread_pool->Shutdown();
 }
 
+namespace {
+// Records the order in which tasks ran.
+class TaskRecorder {
+ public:
+  void Record(const string& task) {
+    std::lock_guard<std::mutex> l(lock_);
+    tasks_.push_back(task);
+  }
+
+  vector<string> tasks() const {
+    std::lock_guard<std::mutex> l(lock_);
+    return tasks_;
+  }
+
+ private:
+  mutable std::mutex lock_;
+  vector<string> tasks_;
+};
+} // anonymous namespace
+
+// Test that the tasks of a SERIAL token run one at a time, in order, even
+// though the pool has threads to spare.
+TEST(TestThreadPool, TestSerialToken) {
+  gscoped_ptr<ThreadPool> thread_pool;
+  ASSERT_OK(BuildMinMaxTestPool(4, 4, &thread_pool));
+  unique_ptr<ThreadPoolToken> token = thread_pool->NewToken(ThreadPool::ExecutionMode::SERIAL);
+
+  const int kNumTasks = 100;
+  Atomic32 running = 0;
+  Atomic32 max_running = 0;
+  vector<int> order;
+  for (int i = 0; i < kNumTasks; i++) {
+    ASSERT_OK(token->SubmitFunc([&, i]() {
+          Atomic32 cur = base::subtle::NoBarrier_AtomicIncrement(&running, 1);
+          if (cur > base::subtle::NoBarrier_Load(&max_running)) {
+            base::subtle::NoBarrier_Store(&max_running, cur);
+          }
+          order.push_back(i);
+          boost::detail::yield(i);
+          base::subtle::NoBarrier_AtomicIncrement(&running, -1);
+        }));
+  }
+  token->Wait();
+  ASSERT_EQ(1, base::subtle::NoBarrier_Load(&max_running));
+  ASSERT_EQ(kNumTasks, order.size());
+  for (int i = 0; i < kNumTasks; i++) {
+    ASSERT_EQ(i, order[i]);
+  }
+}
+
+// Test that a token with many queued tasks doesn't hold back the tasks of
+// another token submitted after them.
+TEST(TestThreadPool, TestTokensServedRoundRobin) {
+  gscoped_ptr<ThreadPool> thread_pool;
+  ASSERT_OK(BuildMinMaxTestPool(1, 1, &thread_pool));
+  unique_ptr<ThreadPoolToken> hot = thread_pool->NewToken(ThreadPool::ExecutionMode::SERIAL);
+  unique_ptr<ThreadPoolToken> cold = thread_pool->NewToken(ThreadPool::ExecutionMode::SERIAL);
+
+  // Keep the only thread busy until all the tasks are queued.
+  CountDownLatch latch(1);
+  ASSERT_OK(hot->SubmitFunc([&]() { latch.Wait(); }));
+  TaskRecorder recorder;
+  for (int i = 0; i < 3; i++) {
+    ASSERT_OK(hot->SubmitFunc(boost::bind(&TaskRecorder::Record, &recorder, "hot")));
+  }
+  ASSERT_OK(cold->SubmitFunc(boost::bind(&TaskRecorder::Record, &recorder, "cold")));
+  ASSERT_EQ(3, hot->queue_length());
+  ASSERT_EQ(4, thread_pool->queue_length());
+  latch.CountDown();
+  thread_pool->Wait();
+
+  vector<string> expected = { "cold", "hot", "hot", "hot" };
+  ASSERT_EQ(expected, recorder.tasks());
+}
+
+// Test that every task submitted while idle threads are available gets one,
+// even when the tasks go to a token which is already queued: N tasks which
+// wait for each other on a pool of N threads must all make progress.
+TEST(TestThreadPool, TestIdleThreadsPickUpQueuedTokens) {
+  const int kNumThreads = 4;
+  gscoped_ptr<ThreadPool> thread_pool;
+  ASSERT_OK(BuildMinMaxTestPool(kNumThreads, kNumThreads, &thread_pool));
+  unique_ptr<ThreadPoolToken> token =
+      thread_pool->NewToken(ThreadPool::ExecutionMode::CONCURRENT);
+
+  for (ThreadPoolToken* t : { static_cast<ThreadPoolToken*>(nullptr), token.get() }) {
+    CountDownLatch latch(kNumThreads);
+    Atomic32 num_timed_out = 0;
+    auto task = [&]() {
+      latch.CountDown();
+      if (!latch.WaitFor(MonoDelta::FromSeconds(10))) {
+        base::subtle::NoBarrier_AtomicIncrement(&num_timed_out, 1);
+      }
+    };
+    for (int i = 0; i < kNumThreads; i++) {
+      if (t) {
+        ASSERT_OK(t->SubmitFunc(task));
+      } else {
+        ASSERT_OK(thread_pool->SubmitFunc(task));
+      }
+    }
+    thread_pool->Wait();
+    ASSERT_EQ(0, base::subtle::NoBarrier_Load(&num_timed_out));
+  }
+}
+
+// Test that shutting down a token drops its pending tasks and rejects new
+// ones, without affecting the pool's other tokens.
+TEST(TestThreadPool, TestTokenShutdown) {
+  gscoped_ptr<ThreadPool> thread_pool;
+  ASSERT_OK(BuildMinMaxTestPool(1, 1, &thread_pool));
+  unique_ptr<ThreadPoolToken> t1 = thread_pool->NewToken(ThreadPool::ExecutionMode::CONCURRENT);
+  unique_ptr<ThreadPoolToken> t2 = thread_pool->NewToken(ThreadPool::ExecutionMode::CONCURRENT);
+
+  CountDownLatch latch(1);
+  ASSERT_OK(thread_pool->SubmitFunc([&]() { latch.Wait(); }));
+  TaskRecorder recorder;
+  ASSERT_OK(t1->SubmitFunc(boost::bind(&TaskRecorder::Record, &recorder, "t1")));
+  ASSERT_OK(t2->SubmitFunc(boost::bind(&TaskRecorder::Record, &recorder, "t2")));
+  t1->Shutdown();
+  ASSERT_TRUE(t1->SubmitFunc(boost::bind(&TaskRecorder::Record, &recorder, "t1"))
+              .IsServiceUnavailable());
+  latch.CountDown();
+  t2->Wait();
+  thread_pool->Wait();
+
+  vector<string> expected = { "t2" };
+  ASSERT_EQ(expected, recorder.tasks());
+
+  // A token may outlive its pool, but can't be used anymore.
+  thread_pool.reset();
+  ASSERT_TRUE(t2->SubmitFunc(boost::bind(&TaskRecorder::Record, &recorder, "t2"))
+              .IsServiceUnavailable());
+}
+
+// Test that tokens may keep submitting while their pool is being destroyed.
+TEST(TestThreadPool, TestDestroyPoolWhileSubmittingToToken) {
+  gscoped_ptr<ThreadPool> thread_pool;
+  ASSERT_OK(BuildMinMaxTestPool(1, 1, &thread_pool));
+  unique_ptr<ThreadPoolToken> token =
+      thread_pool->NewToken(ThreadPool::ExecutionMode::CONCURRENT);
+
+  std::atomic<bool> destroyed(false);
+  std::thread submitter([&]() {
+      // Once the pool is gone, submissions must keep failing cleanly.
+      while (true) {
+        bool was_destroyed = destroyed.load();
+        Status s = token->SubmitFunc([]() {});
+        if (was_destroyed) {
+          CHECK(s.IsServiceUnavailable()) << s.ToString();
+          break;
+        }
+      }
+    });
+  SleepFor(MonoDelta::FromMilliseconds(10));
+  thread_pool.reset();
+  destroyed = true;
+  submitter.join();
+}
 
 METRIC_DEFINE_entity(test_entity);
 METRIC_DEFINE_histogram(test_entity, queue_length, "queue length",
@@ -291,6 +459,69 @@ TEST(TestThreadPool, TestMetrics) {
   ASSERT_EQ(kNumItems, run_time->TotalCount());
 }
 
+static void SubmitChildTasks(ThreadPool* pool, int depth, Atomic32* counter) {
+  base::subtle::NoBarrier_AtomicIncrement(counter, 1);
+  if (depth > 0) {
+    for (int i = 0; i < 2; i++) {
+      CHECK_OK(pool->SubmitFunc(boost::bind(&SubmitChildTasks, pool, depth - 1, counter)));
+    }
+  }
+}
+
+TEST(TestThreadPool, TestWorkStealingPool) {
+  MetricRegistry registry;
+  scoped_refptr<MetricEntity> entity = METRIC_ENTITY_test_entity.Instantiate(
+      &registry, "test entity");
+
+  gscoped_ptr<ThreadPool> thread_pool;
+  ASSERT_OK(ThreadPoolBuilder("test")
+            .set_max_threads(4)
+            .set_work_stealing(true)
+            .Build(&thread_pool));
+  scoped_refptr<Histogram> queue_length = METRIC_queue_length.Instantiate(entity);
+  scoped_refptr<Histogram> queue_time = METRIC_queue_time.Instantiate(entity);
+  scoped_refptr<Histogram> run_time = METRIC_run_time.Instantiate(entity);
+  thread_pool->SetQueueLengthHistogram(queue_length);
+  thread_pool->SetQueueTimeMicrosHistogram(queue_time);
+  thread_pool->SetRunTimeMicrosHistogram(run_time);
+
+  // Tasks submitted from outside of the pool, and by the tasks themselves to
+  // their worker's queue, all run.
+  Atomic32 counter(0);
+  const int kDepth = 10;
+  const int kNumTasks = (1 << (kDepth + 1)) - 1;
+  ASSERT_OK(thread_pool->SubmitFunc(
+      boost::bind(&SubmitChildTasks, thread_pool.get(), kDepth, &counter)));
+  thread_pool->Wait();
+  ASSERT_EQ(kNumTasks, base::subtle::NoBarrier_Load(&counter));
+  ASSERT_EQ(0, thread_pool->queue_length());
+  ASSERT_EQ(kNumTasks, queue_length->TotalCount());
+  ASSERT_EQ(kNumTasks, queue_time->TotalCount());
+  ASSERT_EQ(kNumTasks, run_time->TotalCount());
+
+  // A slow task on one worker doesn't hold up the others.
+  CountDownLatch latch(1);
+  ASSERT_OK(thread_pool->Submit(shared_ptr<Runnable>(new SlowTask(&latch))));
+  for (int i = 0; i < 100; i++) {
+    ASSERT_OK(thread_pool->SubmitFunc(boost::bind(&SimpleTaskMethod, 1, &counter)));
+  }
+  AssertEventually([&]() {
+      ASSERT_EQ(kNumTasks + 100, base::subtle::NoBarrier_Load(&counter));
+    });
+  ASSERT_FALSE(thread_pool->WaitFor(MonoDelta::FromMilliseconds(1)));
+  latch.CountDown();
+  thread_pool->Wait();
+
+  // Tokens aren't supported.
+  unique_ptr<ThreadPoolToken> token = thread_pool->NewToken(
+      ThreadPool::ExecutionMode::CONCURRENT);
+  ASSERT_TRUE(token->SubmitFunc(&IssueTraceStatement).IsNotSupported());
+
+  thread_pool->Shutdown();
+  ASSERT_EQ("Service unavailable: The pool has been shut down.",
+            thread_pool->SubmitFunc(&IssueTraceStatement).ToString());
+}
+
 // Test that a thread pool will crash if asked to run its own blocking
 // functions in a pool thread.
 //
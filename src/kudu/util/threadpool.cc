@@ -18,9 +18,12 @@
 #include "kudu/util/threadpool.h"
 
 #include <boost/function.hpp>
+#include <algorithm>
 #include <gflags/gflags.h>
 #include <glog/logging.h>
 #include <limits>
+#include <mutex>
+#include <sched.h>
 #include <string>
 
 #include "kudu/gutil/callback.h"
@@ -36,6 +39,15 @@ namespace kudu {
 
 using strings::Substitute;
 
+namespace {
+
+// The work-stealing pool the current thread is a worker of, if any, and its
+// index among the workers of that pool.
+__thread const ThreadPool* tls_work_stealing_pool = nullptr;
+__thread int tls_worker_idx = -1;
+
+} // anonymous namespace
+
 ////////////////////////////////////////////////////////
 // FunctionRunnable
 ////////////////////////////////////////////////////////
@@ -61,7 +73,8 @@ ThreadPoolBuilder::ThreadPoolBuilder(std::string name)
       min_threads_(0),
       max_threads_(base::NumCPUs()),
       max_queue_size_(std::numeric_limits<int>::max()),
-      idle_timeout_(MonoDelta::FromMilliseconds(500)) {}
+      idle_timeout_(MonoDelta::FromMilliseconds(500)),
+      work_stealing_(false) {}
 
 ThreadPoolBuilder& ThreadPoolBuilder::set_trace_metric_prefix(
     const std::string& prefix) {
@@ -92,6 +105,11 @@ ThreadPoolBuilder& ThreadPoolBuilder::set_idle_timeout(const MonoDelta& idle_tim
   return *this;
 }
 
+ThreadPoolBuilder& ThreadPoolBuilder::set_work_stealing(bool work_stealing) {
+  work_stealing_ = work_stealing;
+  return *this;
+}
+
 Status ThreadPoolBuilder::Build(gscoped_ptr<ThreadPool>* pool) const {
   pool->reset(new ThreadPool(*this));
   RETURN_NOT_OK((*pool)->Init());
@@ -108,13 +126,22 @@ ThreadPool::ThreadPool(const ThreadPoolBuilder& builder)
     max_threads_(builder.max_threads_),
     max_queue_size_(builder.max_queue_size_),
     idle_timeout_(builder.idle_timeout_),
+    work_stealing_(builder.work_stealing_),
     pool_status_(Status::Uninitialized("The pool was not initialized.")),
     idle_cond_(&lock_),
     no_threads_cond_(&lock_),
     not_empty_(&lock_),
     num_threads_(0),
     active_threads_(0),
-    queue_size_(0) {
+    queue_size_(0),
+    tokenless_(NewToken(ExecutionMode::CONCURRENT)),
+    pending_tasks_(0),
+    running_tasks_(0),
+    submissions_in_progress_(0),
+    shutting_down_(false),
+    next_worker_queue_(0),
+    work_available_(&sleep_lock_),
+    num_sleeping_workers_(0) {
 
   string prefix = !builder.trace_metric_prefix_.empty() ?
       builder.trace_metric_prefix_ : builder.name_;
@@ -129,6 +156,22 @@ ThreadPool::ThreadPool(const ThreadPoolBuilder& builder)
 
 ThreadPool::~ThreadPool() {
   Shutdown();
+
+  // Any token still around will reject the tasks submitted through it. The
+  // links are unlinked without holding lock_, since the tokens take it while
+  // holding their link.
+  tokenless_.reset();
+  std::vector<std::shared_ptr<ThreadPoolToken::PoolLink>> links;
+  {
+    MutexLock unique_lock(lock_);
+    for (ThreadPoolToken* token : tokens_) {
+      links.push_back(token->link_);
+    }
+  }
+  for (const auto& link : links) {
+    std::lock_guard<RWMutex> l(link->lock);
+    link->pool = nullptr;
+  }
 }
 
 Status ThreadPool::Init() {
@@ -137,6 +180,19 @@ Status ThreadPool::Init() {
     return Status::NotSupported("The thread pool is already initialized");
   }
   pool_status_ = Status::OK();
+  if (work_stealing_) {
+    for (int i = 0; i < max_threads_; i++) {
+      worker_queues_.emplace_back(new WorkerQueue);
+    }
+    for (int i = 0; i < max_threads_; i++) {
+      Status status = CreateWorkStealingThreadUnlocked(i);
+      if (!status.ok()) {
+        Shutdown();
+        return status;
+      }
+    }
+    return Status::OK();
+  }
   for (int i = 0; i < min_threads_; i++) {
     Status status = CreateThreadUnlocked();
     if (!status.ok()) {
@@ -147,14 +203,33 @@ Status ThreadPool::Init() {
   return Status::OK();
 }
 
-void ThreadPool::ClearQueue() {
-  for (QueueEntry& e : queue_) {
+void ThreadPool::ClearTokenQueueUnlocked(ThreadPoolToken* token) {
+  for (QueueEntry& e : token->entries_) {
     if (e.trace) {
       e.trace->Release();
     }
   }
-  queue_.clear();
-  queue_size_ = 0;
+  queue_size_ -= token->entries_.size();
+  token->entries_.clear();
+  token->queue_size_ = 0;
+  if (token->queued_) {
+    queue_.erase(std::find(queue_.begin(), queue_.end(), token));
+    token->queued_ = false;
+  }
+  if (token->active_tasks_ == 0) {
+    token->idle_cond_.Broadcast();
+  }
+  if (queue_size_ == 0 && active_threads_ == 0) {
+    idle_cond_.Broadcast();
+  }
+}
+
+void ThreadPool::ClearQueue() {
+  for (ThreadPoolToken* token : tokens_) {
+    ClearTokenQueueUnlocked(token);
+  }
+  DCHECK(queue_.empty());
+  DCHECK_EQ(0, queue_size_);
 }
 
 void ThreadPool::Shutdown() {
@@ -162,8 +237,12 @@ void ThreadPool::Shutdown() {
   CheckNotPoolThreadUnlocked();
 
   pool_status_ = Status::ServiceUnavailable("The pool has been shut down.");
-  ClearQueue();
-  not_empty_.Broadcast();
+  if (work_stealing_) {
+    ShutdownWorkStealingUnlocked();
+  } else {
+    ClearQueue();
+    not_empty_.Broadcast();
+  }
 
   // The Runnable doesn't have Abort() so we must wait
   // and hopefully the abort is done outside before calling Shutdown().
@@ -183,12 +262,33 @@ Status ThreadPool::SubmitFunc(const boost::function<void()>& func) {
 }
 
 Status ThreadPool::Submit(const std::shared_ptr<Runnable>& task) {
+  return DoSubmit(task, tokenless_.get());
+}
+
+std::unique_ptr<ThreadPoolToken> ThreadPool::NewToken(ExecutionMode mode) {
+  std::unique_ptr<ThreadPoolToken> token(new ThreadPoolToken(this, mode));
+  MutexLock unique_lock(lock_);
+  InsertOrDie(&tokens_, token.get());
+  return token;
+}
+
+Status ThreadPool::DoSubmit(const std::shared_ptr<Runnable>& task, ThreadPoolToken* token) {
   MonoTime submit_time = MonoTime::Now();
 
+  if (work_stealing_) {
+    if (PREDICT_FALSE(token != tokenless_.get())) {
+      return Status::NotSupported("Tokens are not supported by work-stealing pools.");
+    }
+    return DoSubmitWorkStealing(task, submit_time);
+  }
+
   MutexLock guard(lock_);
   if (PREDICT_FALSE(!pool_status_.ok())) {
     return pool_status_;
   }
+  if (PREDICT_FALSE(token->shut_down_)) {
+    return Status::ServiceUnavailable("The token has been shut down.");
+  }
 
   // Size limit check.
   if (queue_size_ == max_queue_size_) {
@@ -232,23 +332,94 @@ Status ThreadPool::Submit(const std::shared_ptr<Runnable>& task) {
   }
   e.submit_time = submit_time;
 
-  queue_.push_back(e);
+  token->entries_.push_back(e);
+  int token_length_at_submit = token->queue_size_++;
   int length_at_submit = queue_size_++;
+  bool newly_runnable = !token->queued_ && token->IsRunnableUnlocked();
+  if (newly_runnable) {
+    queue_.push_back(token);
+    token->queued_ = true;
+  }
 
   guard.Unlock();
+  // Signal even if the token was already queued: the workers serving it may
+  // all be busy, and an idle worker may pick up the new task.
   not_empty_.Signal();
 
   if (queue_length_histogram_) {
     queue_length_histogram_->Increment(length_at_submit);
   }
+  if (token->queue_length_histogram_) {
+    token->queue_length_histogram_->Increment(token_length_at_submit);
+  }
+
+  return Status::OK();
+}
+
+Status ThreadPool::DoSubmitWorkStealing(const std::shared_ptr<Runnable>& task,
+                                        const MonoTime& submit_time) {
+  // Announce the submission before checking for shutdown, so that Shutdown()
+  // either makes us fail, or waits for the task to be queued before dropping
+  // the queued tasks.
+  submissions_in_progress_++;
+  if (PREDICT_FALSE(shutting_down_.load())) {
+    submissions_in_progress_--;
+    return Status::ServiceUnavailable("The pool has been shut down.");
+  }
+  // The queue size limit is only approximate, since concurrent submissions
+  // may all pass the check.
+  if (PREDICT_FALSE(pending_tasks_.load() >= max_queue_size_)) {
+    int queue_size = pending_tasks_.load();
+    submissions_in_progress_--;
+    return Status::ServiceUnavailable(Substitute("Thread pool queue is full ($0 items)",
+                                                 queue_size));
+  }
 
+  QueueEntry e;
+  e.runnable = task;
+  e.trace = Trace::CurrentTrace();
+  if (e.trace) {
+    e.trace->AddRef();
+  }
+  e.submit_time = submit_time;
+
+  // Count the task before queuing it, so that a worker going to sleep never
+  // misses it: see WorkStealingDispatchThread().
+  int length_at_submit = pending_tasks_++;
+  WorkerQueue* queue;
+  if (tls_work_stealing_pool == this) {
+    queue = worker_queues_[tls_worker_idx].get();
+  } else {
+    queue = worker_queues_[next_worker_queue_++ % worker_queues_.size()].get();
+  }
+  {
+    std::lock_guard<simple_spinlock> l(queue->lock);
+    queue->entries.emplace_back(std::move(e));
+  }
+  submissions_in_progress_--;
+
+  if (num_sleeping_workers_.load() > 0) {
+    MutexLock l(sleep_lock_);
+    work_available_.Signal();
+  }
+
+  if (queue_length_histogram_) {
+    queue_length_histogram_->Increment(length_at_submit);
+  }
   return Status::OK();
 }
 
+bool ThreadPool::IsIdleUnlocked() const {
+  if (work_stealing_) {
+    return pending_tasks_.load() == 0 && running_tasks_.load() == 0;
+  }
+  return queue_size_ == 0 && active_threads_ == 0;
+}
+
 void ThreadPool::Wait() {
   MutexLock unique_lock(lock_);
   CheckNotPoolThreadUnlocked();
-  while ((!queue_.empty()) || (active_threads_ > 0)) {
+  while (!IsIdleUnlocked()) {
     idle_cond_.Wait();
   }
 }
@@ -260,7 +431,7 @@ bool ThreadPool::WaitUntil(const MonoTime& until) {
 bool ThreadPool::WaitFor(const MonoDelta& delta) {
   MutexLock unique_lock(lock_);
   CheckNotPoolThreadUnlocked();
-  while ((!queue_.empty()) || (active_threads_ > 0)) {
+  while (!IsIdleUnlocked()) {
     if (!idle_cond_.TimedWait(delta)) {
       return false;
     }
@@ -312,45 +483,39 @@ void ThreadPool::DispatchThread(bool permanent) {
       continue;
     }
 
-    // Fetch a pending task
-    QueueEntry entry = queue_.front();
+    // Fetch a pending task from the token at the front of the queue. If the
+    // token has more tasks which may run right away, send it to the back of
+    // the queue so that the other tokens get their turn first.
+    ThreadPoolToken* token = queue_.front();
     queue_.pop_front();
+    token->queued_ = false;
+    QueueEntry entry = token->entries_.front();
+    token->entries_.pop_front();
+    token->queue_size_--;
     queue_size_--;
+    token->active_tasks_++;
+    if (token->IsRunnableUnlocked()) {
+      queue_.push_back(token);
+      token->queued_ = true;
+      not_empty_.Signal();
+    }
     ++active_threads_;
 
     unique_lock.Unlock();
 
-    // Release the reference which was held by the queued item.
-    ADOPT_TRACE(entry.trace);
-    if (entry.trace) {
-      entry.trace->Release();
-    }
-
-    // Update metrics
-    MonoTime now(MonoTime::Now());
-    int64_t queue_time_us = (now - entry.submit_time).ToMicroseconds();
-    TRACE_COUNTER_INCREMENT(queue_time_trace_metric_name_, queue_time_us);
-    if (queue_time_us_histogram_) {
-      queue_time_us_histogram_->Increment(queue_time_us);
-    }
-
-    // Execute the task
-    {
-      MicrosecondsInt64 start_wall_us = GetMonoTimeMicros();
-      MicrosecondsInt64 start_cpu_us = GetThreadCpuTimeMicros();
+    RunTask(&entry, token);
 
-      entry.runnable->Run();
-
-      int64_t wall_us = GetMonoTimeMicros() - start_wall_us;
-      int64_t cpu_us = GetThreadCpuTimeMicros() - start_cpu_us;
+    unique_lock.Lock();
 
-      if (run_time_us_histogram_) {
-        run_time_us_histogram_->Increment(wall_us);
-      }
-      TRACE_COUNTER_INCREMENT(run_wall_time_trace_metric_name_, wall_us);
-      TRACE_COUNTER_INCREMENT(run_cpu_time_trace_metric_name_, cpu_us);
+    token->active_tasks_--;
+    if (!token->queued_ && token->IsRunnableUnlocked()) {
+      // The next task of a SERIAL token may run now.
+      queue_.push_back(token);
+      token->queued_ = true;
+      not_empty_.Signal();
+    } else if (token->active_tasks_ == 0 && token->entries_.empty()) {
+      token->idle_cond_.Broadcast();
     }
-    unique_lock.Lock();
 
     if (--active_threads_ == 0) {
       idle_cond_.Broadcast();
@@ -373,6 +538,136 @@ void ThreadPool::DispatchThread(bool permanent) {
   }
 }
 
+void ThreadPool::WorkStealingDispatchThread(int worker_idx) {
+  tls_work_stealing_pool = this;
+  tls_worker_idx = worker_idx;
+
+  QueueEntry entry;
+  while (!shutting_down_.load()) {
+    if (TryDequeueWorkStealing(worker_idx, &entry)) {
+      RunTask(&entry, tokenless_.get());
+      if (--running_tasks_ == 0 && pending_tasks_.load() == 0) {
+        MutexLock l(lock_);
+        idle_cond_.Broadcast();
+      }
+      continue;
+    }
+
+    // Submitters count a task before queuing it and only then look for
+    // sleeping workers, while we count ourselves as sleeping before looking
+    // for tasks one last time. Either they see us and wake us up, or we see
+    // their task.
+    MutexLock l(sleep_lock_);
+    if (shutting_down_.load()) {
+      break;
+    }
+    num_sleeping_workers_++;
+    if (pending_tasks_.load() == 0) {
+      work_available_.Wait();
+    }
+    num_sleeping_workers_--;
+  }
+  tls_work_stealing_pool = nullptr;
+
+  MutexLock unique_lock(lock_);
+  CHECK_EQ(threads_.erase(Thread::current_thread()), 1);
+  if (--num_threads_ == 0) {
+    no_threads_cond_.Broadcast();
+  }
+}
+
+bool ThreadPool::TryDequeueWorkStealing(int worker_idx, QueueEntry* entry) {
+  // Start with the worker's own queue, then go over the others in turn.
+  const int num_queues = worker_queues_.size();
+  for (int i = 0; i < num_queues; i++) {
+    WorkerQueue* queue = worker_queues_[(worker_idx + i) % num_queues].get();
+    std::lock_guard<simple_spinlock> l(queue->lock);
+    if (!queue->entries.empty()) {
+      *entry = std::move(queue->entries.front());
+      queue->entries.pop_front();
+      // Count the task as running before it stops being pending, so that the
+      // pool never looks idle in between.
+      running_tasks_++;
+      pending_tasks_--;
+      return true;
+    }
+  }
+  return false;
+}
+
+void ThreadPool::RunTask(QueueEntry* entry, ThreadPoolToken* token) {
+  // Release the reference which was held by the queued item.
+  ADOPT_TRACE(entry->trace);
+  if (entry->trace) {
+    entry->trace->Release();
+  }
+
+  // Update metrics
+  MonoTime now(MonoTime::Now());
+  int64_t queue_time_us = (now - entry->submit_time).ToMicroseconds();
+  TRACE_COUNTER_INCREMENT(queue_time_trace_metric_name_, queue_time_us);
+  if (queue_time_us_histogram_) {
+    queue_time_us_histogram_->Increment(queue_time_us);
+  }
+  if (token->queue_time_us_histogram_) {
+    token->queue_time_us_histogram_->Increment(queue_time_us);
+  }
+
+  // Execute the task
+  {
+    MicrosecondsInt64 start_wall_us = GetMonoTimeMicros();
+    MicrosecondsInt64 start_cpu_us = GetThreadCpuTimeMicros();
+
+    entry->runnable->Run();
+
+    int64_t wall_us = GetMonoTimeMicros() - start_wall_us;
+    int64_t cpu_us = GetThreadCpuTimeMicros() - start_cpu_us;
+
+    if (run_time_us_histogram_) {
+      run_time_us_histogram_->Increment(wall_us);
+    }
+    if (token->run_time_us_histogram_) {
+      token->run_time_us_histogram_->Increment(wall_us);
+    }
+    TRACE_COUNTER_INCREMENT(run_wall_time_trace_metric_name_, wall_us);
+    TRACE_COUNTER_INCREMENT(run_cpu_time_trace_metric_name_, cpu_us);
+  }
+
+  // Destroy the task before waking up anyone waiting on the token, since
+  // the task may refer to objects which go away along with the token.
+  entry->runnable.reset();
+}
+
+void ThreadPool::ShutdownWorkStealingUnlocked() {
+  {
+    MutexLock l(sleep_lock_);
+    shutting_down_ = true;
+    work_available_.Broadcast();
+  }
+  while (submissions_in_progress_.load() > 0) {
+    sched_yield();
+  }
+
+  // Drop the tasks which haven't started. Destroy them out of the queue
+  // locks, since their destructors may do anything.
+  for (const auto& queue : worker_queues_) {
+    std::deque<QueueEntry> entries;
+    {
+      std::lock_guard<simple_spinlock> l(queue->lock);
+      entries.swap(queue->entries);
+    }
+    for (QueueEntry& e : entries) {
+      if (e.trace) {
+        e.trace->Release();
+      }
+    }
+    pending_tasks_ -= static_cast<int>(entries.size());
+  }
+  if (IsIdleUnlocked()) {
+    idle_cond_.Broadcast();
+  }
+}
+
 Status ThreadPool::CreateThreadUnlocked() {
   // The first few threads are permanent, and do not time out.
   bool permanent = (num_threads_ < min_threads_);
@@ -386,6 +681,100 @@ Status ThreadPool::CreateThreadUnlocked() {
   return s;
 }
 
+////////////////////////////////////////////////////////
+// ThreadPoolToken
+////////////////////////////////////////////////////////
+
+Status ThreadPool::CreateWorkStealingThreadUnlocked(int worker_idx) {
+  scoped_refptr<Thread> t;
+  Status s = kudu::Thread::Create("thread pool", strings::Substitute("$0 [worker]", name_),
+                                  &ThreadPool::WorkStealingDispatchThread, this, worker_idx,
+                                  &t);
+  if (s.ok()) {
+    InsertOrDie(&threads_, t.get());
+    num_threads_++;
+  }
+  return s;
+}
+
+ThreadPoolToken::ThreadPoolToken(ThreadPool* pool, ThreadPool::ExecutionMode mode)
+    : link_(std::make_shared<PoolLink>()),
+      mode_(mode),
+      queue_size_(0),
+      active_tasks_(0),
+      queued_(false),
+      shut_down_(false),
+      idle_cond_(&pool->lock_) {
+  link_->pool = pool;
+}
+
+ThreadPoolToken::~ThreadPoolToken() {
+  shared_lock<RWMutex> l(link_->lock);
+  ThreadPool* pool = link_->pool;
+  if (!pool) {
+    return;
+  }
+  ShutdownUnlocked(pool);
+  MutexLock unique_lock(pool->lock_);
+  CHECK_EQ(1, pool->tokens_.erase(this));
+}
+
+Status ThreadPoolToken::SubmitClosure(const Closure& task) {
+  return SubmitFunc(boost::bind(&Closure::Run, task));
+}
+
+Status ThreadPoolToken::SubmitFunc(const boost::function<void()>& func) {
+  return Submit(std::shared_ptr<Runnable>(new FunctionRunnable(func)));
+}
+
+Status ThreadPoolToken::Submit(const std::shared_ptr<Runnable>& task) {
+  shared_lock<RWMutex> l(link_->lock);
+  if (PREDICT_FALSE(!link_->pool)) {
+    return Status::ServiceUnavailable("The pool has been destroyed.");
+  }
+  return link_->pool->DoSubmit(task, this);
+}
+
+void ThreadPoolToken::Shutdown() {
+  shared_lock<RWMutex> l(link_->lock);
+  if (!link_->pool) {
+    return;
+  }
+  ShutdownUnlocked(link_->pool);
+}
+
+void ThreadPoolToken::ShutdownUnlocked(ThreadPool* pool) {
+  MutexLock unique_lock(pool->lock_);
+  shut_down_ = true;
+  pool->ClearTokenQueueUnlocked(this);
+  while (active_tasks_ > 0) {
+    idle_cond_.Wait();
+  }
+}
+
+void ThreadPoolToken::Wait() {
+  shared_lock<RWMutex> l(link_->lock);
+  if (!link_->pool) {
+    return;
+  }
+  MutexLock unique_lock(link_->pool->lock_);
+  while (!entries_.empty() || active_tasks_ > 0) {
+    idle_cond_.Wait();
+  }
+}
+
+void ThreadPoolToken::SetQueueLengthHistogram(const scoped_refptr<Histogram>& hist) {
+  queue_length_histogram_ = hist;
+}
+
+void ThreadPoolToken::SetQueueTimeMicrosHistogram(const scoped_refptr<Histogram>& hist) {
+  queue_time_us_histogram_ = hist;
+}
+
+void ThreadPoolToken::SetRunTimeMicrosHistogram(const scoped_refptr<Histogram>& hist) {
+  run_time_us_histogram_ = hist;
+}
+
 void ThreadPool::CheckNotPoolThreadUnlocked() {
   Thread* current = Thread::current_thread();
   if (ContainsKey(threads_, current)) {
@@ -19,7 +19,8 @@
 
 #include <boost/function.hpp>
 #include <gtest/gtest_prod.h>
-#include <list>
+#include <atomic>
+#include <deque>
 #include <memory>
 #include <unordered_set>
 #include <string>
@@ -31,8 +32,10 @@
 #include "kudu/gutil/port.h"
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/util/condition_variable.h"
+#include "kudu/util/locks.h"
 #include "kudu/util/monotime.h"
 #include "kudu/util/mutex.h"
+#include "kudu/util/rw_mutex.h"
 #include "kudu/util/status.h"
 
 namespace kudu {
@@ -40,6 +43,7 @@ namespace kudu {
 class Histogram;
 class Thread;
 class ThreadPool;
+class ThreadPoolToken;
 class Trace;
 
 class Runnable {
@@ -90,6 +94,16 @@ class Runnable {
 //    We always keep at least min_threads.
 //    Default: 500 milliseconds.
 //
+// work_stealing: Whether each worker thread has its own queue of tasks, and
+//    steals tasks from the others' queues once its own is empty. Tasks
+//    submitted by a worker thread are queued on its own queue, the others are
+//    spread over the queues in turn. This avoids the single pool-wide lock
+//    which otherwise serializes every submission and dispatch, at the cost of
+//    keeping max_threads threads around at all times: min_threads and timeout
+//    are ignored. Tokens aren't supported: tasks submitted through them are
+//    rejected.
+//    Default: false.
+//
 class ThreadPoolBuilder {
  public:
   explicit ThreadPoolBuilder(std::string name);
@@ -101,12 +115,14 @@ class ThreadPoolBuilder {
   ThreadPoolBuilder& set_max_threads(int max_threads);
   ThreadPoolBuilder& set_max_queue_size(int max_queue_size);
   ThreadPoolBuilder& set_idle_timeout(const MonoDelta& idle_timeout);
+  ThreadPoolBuilder& set_work_stealing(bool work_stealing);
 
   const std::string& name() const { return name_; }
   int min_threads() const { return min_threads_; }
   int max_threads() const { return max_threads_; }
   int max_queue_size() const { return max_queue_size_; }
   const MonoDelta& idle_timeout() const { return idle_timeout_; }
+  bool work_stealing() const { return work_stealing_; }
 
   // Instantiate a new ThreadPool with the existing builder arguments.
   Status Build(gscoped_ptr<ThreadPool>* pool) const;
@@ -119,6 +135,7 @@ class ThreadPoolBuilder {
   int max_threads_;
   int max_queue_size_;
   MonoDelta idle_timeout_;
+  bool work_stealing_;
 
   DISALLOW_COPY_AND_ASSIGN(ThreadPoolBuilder);
 };
@@ -141,8 +158,23 @@ class ThreadPoolBuilder {
 //            .Build(&thread_pool));
 //    thread_pool->Submit(shared_ptr<Runnable>(new Task()));
 //    thread_pool->Submit(boost::bind(&Func, 10));
+//
+// Tasks may also be submitted through a ThreadPoolToken, obtained from
+// NewToken(). Each token has its own queue of tasks, and the pool hands out
+// work from the tokens with pending tasks in round-robin order, so that one
+// busy token can't starve the others. Tasks submitted directly to the pool
+// share a single, implicit token.
 class ThreadPool {
  public:
+  // How the tasks submitted through a ThreadPoolToken are run.
+  enum class ExecutionMode {
+    // The tasks are run one at a time, in submission order.
+    SERIAL,
+
+    // The tasks may be run concurrently with each other.
+    CONCURRENT
+  };
+
   ~ThreadPool();
 
   // Wait for the running tasks to complete and then shutdown the threads.
@@ -164,6 +196,11 @@ class ThreadPool {
   Status Submit(const std::shared_ptr<Runnable>& task)
       WARN_UNUSED_RESULT;
 
+  // Allocate a new token whose tasks run on this pool in the given mode.
+  // The token may outlive the pool, though any task submitted through it
+  // once the pool has been shut down is rejected.
+  std::unique_ptr<ThreadPoolToken> NewToken(ExecutionMode mode);
+
   // Wait until all the tasks are completed.
   void Wait();
 
@@ -175,9 +212,12 @@ class ThreadPool {
   // Returns true if the pool reached the idle state, false otherwise.
   bool WaitFor(const MonoDelta& delta);
 
-  // Return the current number of tasks waiting in the queue.
-  // Typically used for metrics.
+  // Return the current number of tasks waiting in the queue, across all
+  // tokens. Typically used for metrics.
   int queue_length() const {
+    if (work_stealing_) {
+      return pending_tasks_.load(std::memory_order_relaxed);
+    }
     return ANNOTATE_UNPROTECTED_READ(queue_size_);
   }
 
@@ -194,6 +234,7 @@ class ThreadPool {
 
  private:
   friend class ThreadPoolBuilder;
+  friend class ThreadPoolToken;
 
   // Create a new thread pool using a builder.
   explicit ThreadPool(const ThreadPoolBuilder& builder);
@@ -201,15 +242,50 @@ class ThreadPool {
   // Initialize the thread pool by starting the minimum number of threads.
   Status Init();
 
+  // Submit a task to be run on behalf of 'token'.
+  Status DoSubmit(const std::shared_ptr<Runnable>& task, ThreadPoolToken* token);
+
+  struct QueueEntry;
+
+  // Like DoSubmit() for a work-stealing pool, which doesn't take lock_.
+  Status DoSubmitWorkStealing(const std::shared_ptr<Runnable>& task,
+                              const MonoTime& submit_time);
+
+  // Returns true if there's no task queued or running. Requires that lock_ is
+  // held.
+  bool IsIdleUnlocked() const;
+
+  // Drop all the tasks queued for 'token'. Requires that lock_ is held.
+  void ClearTokenQueueUnlocked(ThreadPoolToken* token);
+
   // Clear all entries from queue_. Requires that lock_ is held.
   void ClearQueue();
 
   // Dispatcher responsible for dequeueing and executing the tasks
   void DispatchThread(bool permanent);
 
+  // Dispatcher of the worker thread 'worker_idx' of a work-stealing pool.
+  void WorkStealingDispatchThread(int worker_idx);
+
+  // Pops the next task of worker 'worker_idx', stealing one from another
+  // worker if it has none. Returns false if there was no task to run.
+  bool TryDequeueWorkStealing(int worker_idx, QueueEntry* entry);
+
+  // Runs the task of 'entry', submitted on behalf of 'token', updating the
+  // metrics. Must not be called with lock_ held.
+  void RunTask(QueueEntry* entry, ThreadPoolToken* token);
+
   // Create new thread. Required that lock_ is held.
   Status CreateThreadUnlocked();
 
+  // Create the worker thread 'worker_idx' of a work-stealing pool. Required
+  // that lock_ is held.
+  Status CreateWorkStealingThreadUnlocked(int worker_idx);
+
+  // Stops the threads of a work-stealing pool and drops the tasks which
+  // haven't started yet. Required that lock_ is held.
+  void ShutdownWorkStealingUnlocked();
+
   // Aborts if the current thread is a member of this thread pool.
   void CheckNotPoolThreadUnlocked();
 
@@ -225,11 +301,19 @@ class ThreadPool {
     MonoTime submit_time;
   };
 
+  // The queue of a worker thread of a work-stealing pool. The owner and the
+  // workers stealing from it take tasks from the front.
+  struct WorkerQueue {
+    simple_spinlock lock;
+    std::deque<QueueEntry> entries;
+  } CACHELINE_ALIGNED;
+
   const std::string name_;
   const int min_threads_;
   const int max_threads_;
   const int max_queue_size_;
   const MonoDelta idle_timeout_;
+  const bool work_stealing_;
 
   Status pool_status_;
   Mutex lock_;
@@ -238,8 +322,21 @@ class ThreadPool {
   ConditionVariable not_empty_;
   int num_threads_;
   int active_threads_;
+  // The total number of tasks queued across all tokens.
   int queue_size_;
-  std::list<QueueEntry> queue_;
+
+  // The tokens which have a task ready to run, in the order in which they'll
+  // be served. A token appears at most once. A SERIAL token is only queued
+  // while none of its tasks is running.
+  std::deque<ThreadPoolToken*> queue_;
+
+  // All the tokens allocated from this pool which haven't been destroyed yet.
+  //
+  // Protected by lock_.
+  std::unordered_set<ThreadPoolToken*> tokens_;
+
+  // The token which tasks submitted directly to the pool are queued on.
+  std::unique_ptr<ThreadPoolToken> tokenless_;
 
   // Pointers to all running threads. Raw pointers are safe because a Thread
   // may only go out of scope after being removed from threads_.
@@ -251,6 +348,24 @@ class ThreadPool {
   scoped_refptr<Histogram> queue_time_us_histogram_;
   scoped_refptr<Histogram> run_time_us_histogram_;
 
+  // The state of a work-stealing pool. lock_ is only taken to start and stop
+  // the threads and to wait for the pool to be idle.
+  std::vector<std::unique_ptr<WorkerQueue>> worker_queues_;
+  // The number of tasks queued, and of tasks running, over all the workers.
+  std::atomic<int> pending_tasks_;
+  std::atomic<int> running_tasks_;
+  // The number of submissions past the check of shutting_down_, which
+  // Shutdown() waits out before dropping the queued tasks.
+  std::atomic<int> submissions_in_progress_;
+  std::atomic<bool> shutting_down_;
+  // The queue the next task submitted from outside of the pool goes to.
+  std::atomic<uint32_t> next_worker_queue_;
+  // Idle workers sleep on work_available_, with sleep_lock_ held while they
+  // check for tasks and by submitters waking them up.
+  Mutex sleep_lock_;
+  ConditionVariable work_available_;
+  std::atomic<int> num_sleeping_workers_;
+
   const char* queue_time_trace_metric_name_;
   const char* run_wall_time_trace_metric_name_;
   const char* run_cpu_time_trace_metric_name_;
@@ -258,5 +373,98 @@ class ThreadPool {
   DISALLOW_COPY_AND_ASSIGN(ThreadPool);
 };
 
+// A handle through which tasks are submitted to a ThreadPool, whose tasks
+// are queued and run independently from those of the pool's other tokens.
+// See ThreadPool::ExecutionMode for how the tasks of a token are run.
+//
+// This class is thread safe.
+class ThreadPoolToken {
+ public:
+  // Drops the pending tasks and waits for the running ones, like Shutdown().
+  ~ThreadPoolToken();
+
+  // Submit a function using the kudu Closure system.
+  Status SubmitClosure(const Closure& task) WARN_UNUSED_RESULT;
+
+  // Submit a function binded using boost::bind(&FuncName, args...)
+  Status SubmitFunc(const boost::function<void()>& func) WARN_UNUSED_RESULT;
+
+  // Submit a Runnable class
+  Status Submit(const std::shared_ptr<Runnable>& task) WARN_UNUSED_RESULT;
+
+  // Drops the tasks of this token which haven't started yet and waits for
+  // the running ones to complete. Any task submitted afterwards is rejected.
+  //
+  // Must not be called from one of this token's tasks.
+  void Shutdown();
+
+  // Waits until all the tasks of this token are completed.
+  //
+  // Must not be called from one of this token's tasks.
+  void Wait();
+
+  // Return the current number of tasks of this token waiting in the queue.
+  int queue_length() const {
+    return ANNOTATE_UNPROTECTED_READ(queue_size_);
+  }
+
+  // Same as the ThreadPool methods of the same names, but only measuring the
+  // tasks of this token. These must be set before any task is submitted.
+  void SetQueueLengthHistogram(const scoped_refptr<Histogram>& hist);
+  void SetQueueTimeMicrosHistogram(const scoped_refptr<Histogram>& hist);
+  void SetRunTimeMicrosHistogram(const scoped_refptr<Histogram>& hist);
+
+ private:
+  friend class ThreadPool;
+
+  ThreadPoolToken(ThreadPool* pool, ThreadPool::ExecutionMode mode);
+
+  // Returns true if one of this token's tasks may be picked up by a worker
+  // thread. Requires that the pool's lock_ is held.
+  bool IsRunnableUnlocked() const {
+    return !entries_.empty() &&
+        (mode_ == ThreadPool::ExecutionMode::CONCURRENT || active_tasks_ == 0);
+  }
+
+  // The pool this token submits to. The pool sets 'pool' to nullptr when it
+  // is destroyed, after waiting for the token to release 'lock', so a token
+  // holding 'lock' for reading may use the pool. It's shared with the pool,
+  // since either one may be destroyed first.
+  struct PoolLink {
+    RWMutex lock;
+    ThreadPool* pool;
+  };
+
+  // Like Shutdown(), with the link to 'pool' held for reading.
+  void ShutdownUnlocked(ThreadPool* pool);
+
+  const std::shared_ptr<PoolLink> link_;
+  const ThreadPool::ExecutionMode mode_;
+
+  // All the fields below are protected by the pool's lock_.
+
+  // The tasks of this token which haven't started yet, in submission order.
+  std::deque<ThreadPool::QueueEntry> entries_;
+  int queue_size_;
+
+  // The number of tasks of this token which are running.
+  int active_tasks_;
+
+  // Whether this token is in the pool's queue_.
+  bool queued_;
+
+  // Whether Shutdown() has been called.
+  bool shut_down_;
+
+  // Signaled whenever the token has no pending or running task left.
+  ConditionVariable idle_cond_;
+
+  scoped_refptr<Histogram> queue_length_histogram_;
+  scoped_refptr<Histogram> queue_time_us_histogram_;
+  scoped_refptr<Histogram> run_time_us_histogram_;
+
+  DISALLOW_COPY_AND_ASSIGN(ThreadPoolToken);
+};
+
 } // namespace kudu
 #endif
@@ -217,6 +217,13 @@ build_lz4() {
   make -j$PARALLEL install
 }
 
+build_zstd() {
+  cd $ZSTD_DIR/lib
+  CFLAGS="$EXTRA_CFLAGS -fPIC" make -j$PARALLEL libzstd.a
+  make PREFIX=$PREFIX install-includes
+  cp libzstd.a $PREFIX/lib/
+}
+
 build_bitshuffle() {
   cd $BITSHUFFLE_DIR
   # bitshuffle depends on lz4, therefore set the flag I$PREFIX/include